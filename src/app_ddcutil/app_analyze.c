@@ -0,0 +1,504 @@
+/** @file app_analyze.c
+ *
+ *  Implement the ANALYZE command, which summarizes an archive of
+ *  capabilities strings and EDIDs without accessing any monitor.
+ *
+ *  Each argument is a file, a directory whose files are read recursively,
+ *  or "-" for standard input.  Without arguments standard input is read.
+ *  A file that starts with an EDID header is a binary EDID.  Otherwise each
+ *  line of a file is an item: a capabilities string, or an EDID in hex,
+ *  optionally containing blanks.  Empty lines and lines starting with '#'
+ *  are ignored, other lines are counted as unrecognized.
+ *
+ *  Items are parsed in parallel by tasks of the shared executor.
+ *  Capabilities strings are parsed by parse_capabilities_compact(), which
+ *  does not allocate memory.  The report is a JSON object having:
+ *   - capabilities: the number of strings by validity, and for each feature
+ *     the number of strings listing it, as well as bitmaps of the features
+ *     listed by any string and by every string
+ *   - models: the same information for each model named in the strings
+ *   - edids: the number of EDIDs, and the number for each monitor model
+ *
+ *  In a bitmap, bit n % 8 of byte n / 8 is set if feature n is listed.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+#include <ctype.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/data_structures.h"
+#include "util/edid.h"
+#include "util/file_util.h"
+#include "util/json_writer.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/executor.h"
+
+#include "vcp/parse_capabilities.h"
+#include "vcp/vcp_feature_codes.h"
+
+#include "app_ddcutil/app_analyze.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+#define ANALYZE_CHUNK_SIZE    256     // items parsed by a single task
+#define ANALYZE_MODEL_MAX      64     // longest model name recorded
+
+typedef struct {
+   bool   is_edid;
+   char * capabilities;
+   Byte   edid[128];
+} Analysis_Item;
+
+typedef struct {
+   int          ct;
+   int          validity_ct[3];       // indexed by Parsed_Capabilities_Validity
+   int          feature_ct[256];
+   Bit_Set_256  any_features;
+   Bit_Set_256  all_features;         // meaningful only if ct > 0
+} Caps_Summary;
+
+typedef struct {
+   char   mfg_id[EDID_MFG_ID_FIELD_SIZE];
+   char   model_name[EDID_MODEL_NAME_FIELD_SIZE];
+   ushort product_code;
+   int    ct;
+} Edid_Model_Summary;
+
+typedef struct {
+   GPtrArray *  items;
+   int          start;
+   int          end;
+   Caps_Summary caps;
+   GHashTable * models;               // model name -> Caps_Summary *
+   GHashTable * edid_models;          // model key -> Edid_Model_Summary *
+   int          edid_ct;
+   int          invalid_edid_ct;
+} Analysis_Chunk;
+
+typedef struct {
+   GPtrArray * items;                 // Analysis_Item *
+   int         file_ct;
+   int         unrecognized_ct;
+   int         unreadable_ct;
+} Analysis_Input;
+
+
+static void
+free_analysis_item(gpointer data) {
+   Analysis_Item * item = data;
+   free(item->capabilities);
+   free(item);
+}
+
+
+//
+// Input
+//
+
+// Returns true if the line, ignoring blanks, is the hex representation of an EDID
+static bool
+hex_line_to_edid(const char * line, Byte * edid) {
+   int digit_ct = 0;
+   Byte cur = 0;
+   for (const char * pos = line; *pos; pos++) {
+      if (*pos == ' ' || *pos == '\t' || *pos == ':')
+         continue;
+      if (!isxdigit((unsigned char) *pos))
+         return false;
+      int val = g_ascii_xdigit_value(*pos);
+      cur = (cur << 4) | val;
+      if (digit_ct % 2 == 1 && digit_ct / 2 < 128)
+         edid[digit_ct/2] = cur;
+      digit_ct++;
+   }
+   return digit_ct >= 256 && digit_ct % 2 == 0 && is_valid_edid_header(edid);
+}
+
+
+static void
+add_line(Analysis_Input * input, char * line) {
+   char * s = g_strstrip(line);
+   if (*s == '\0' || *s == '#')
+      return;
+   Analysis_Item * item = calloc(1, sizeof(Analysis_Item));
+   if (hex_line_to_edid(s, item->edid)) {
+      item->is_edid = true;
+   }
+   else if (*s == '(' || strstr(s, "vcp(") || strstr(s, "cmds(")) {
+      item->capabilities = strdup(s);
+   }
+   else {
+      free(item);
+      input->unrecognized_ct++;
+      return;
+   }
+   g_ptr_array_add(input->items, item);
+}
+
+
+static void
+add_stream(Analysis_Input * input, FILE * fp) {
+   char * line = NULL;
+   size_t bufsz = 0;
+   while (getline(&line, &bufsz, fp) >= 0)
+      add_line(input, line);
+   free(line);
+   input->file_ct++;
+}
+
+
+static void
+add_file(Analysis_Input * input, const char * fn) {
+   bool debug = false;
+   gchar * contents = NULL;
+   gsize len = 0;
+   GError * error = NULL;
+   if (!g_file_get_contents(fn, &contents, &len, &error)) {
+      f0printf(ferr(), "%s\n", error->message);
+      g_error_free(error);
+      input->unreadable_ct++;
+      return;
+   }
+   if (len >= 128 && is_valid_edid_header((Byte *) contents)) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Binary EDID: %s", fn);
+      Analysis_Item * item = calloc(1, sizeof(Analysis_Item));
+      item->is_edid = true;
+      memcpy(item->edid, contents, 128);
+      g_ptr_array_add(input->items, item);
+   }
+   else {
+      char ** lines = g_strsplit(contents, "\n", -1);
+      for (int ndx = 0; lines[ndx]; ndx++)
+         add_line(input, lines[ndx]);
+      g_strfreev(lines);
+   }
+   g_free(contents);
+   input->file_ct++;
+}
+
+
+static void add_path(Analysis_Input * input, const char * path);
+
+// satisfies Filename_Filter_Func
+static bool
+is_not_hidden(const char * simple_fn) {
+   return simple_fn[0] != '.';
+}
+
+// satisfies Dir_Foreach_Func
+static void
+add_dir_entry(const char * dirname, const char * fn, void * accumulator, int depth) {
+   char * path = g_strdup_printf("%s/%s", dirname, fn);
+   add_path(accumulator, path);
+   g_free(path);
+}
+
+static void
+add_path(Analysis_Input * input, const char * path) {
+   if (directory_exists(path))
+      dir_ordered_foreach(path, is_not_hidden, NULL, add_dir_entry, input, 0);
+   else
+      add_file(input, path);
+}
+
+
+//
+// Parsing
+//
+
+static void
+summary_add(Caps_Summary * summary, Compact_Capabilities * ccaps) {
+   if (summary->ct == 0)
+      summary->all_features = ccaps->features;
+   else
+      summary->all_features = bs256_and(summary->all_features, ccaps->features);
+   summary->any_features = bs256_or(summary->any_features, ccaps->features);
+   summary->ct++;
+   summary->validity_ct[ccaps->caps_validity]++;
+   for (int code = bs256_first_bit_set(ccaps->features);
+        code >= 0;
+        code = bs256_next_bit_set(&ccaps->features, code))
+      summary->feature_ct[code]++;
+}
+
+
+static void
+summary_merge(Caps_Summary * summary, Caps_Summary * other) {
+   if (other->ct == 0)
+      return;
+   if (summary->ct == 0)
+      summary->all_features = other->all_features;
+   else
+      summary->all_features = bs256_and(summary->all_features, other->all_features);
+   summary->any_features = bs256_or(summary->any_features, other->any_features);
+   summary->ct += other->ct;
+   for (int ndx = 0; ndx < 3; ndx++)
+      summary->validity_ct[ndx] += other->validity_ct[ndx];
+   for (int ndx = 0; ndx < 256; ndx++)
+      summary->feature_ct[ndx] += other->feature_ct[ndx];
+}
+
+
+// Copies the value of the model() segment, "" if none
+static void
+get_capabilities_model(const char * caps, char * buf, int bufsz) {
+   buf[0] = '\0';
+   const char * start = strstr(caps, "model(");
+   if (start) {
+      start += strlen("model(");
+      const char * end = strchr(start, ')');
+      if (end)
+         g_snprintf(buf, bufsz, "%.*s", (int) (end - start), start);
+   }
+}
+
+
+static Caps_Summary *
+get_model_summary(GHashTable * models, const char * model) {
+   Caps_Summary * summary = g_hash_table_lookup(models, model);
+   if (!summary) {
+      summary = calloc(1, sizeof(Caps_Summary));
+      g_hash_table_insert(models, g_strdup(model), summary);
+   }
+   return summary;
+}
+
+
+static void
+add_edid(Analysis_Chunk * chunk, Byte * edidbytes) {
+   Parsed_Edid * pedid = create_parsed_edid(edidbytes);
+   if (!pedid) {
+      chunk->invalid_edid_ct++;
+      return;
+   }
+   chunk->edid_ct++;
+   char * key = g_strdup_printf("%s|%s|%u", pedid->mfg_id, pedid->model_name, pedid->product_code);
+   Edid_Model_Summary * summary = g_hash_table_lookup(chunk->edid_models, key);
+   if (!summary) {
+      summary = calloc(1, sizeof(Edid_Model_Summary));
+      g_strlcpy(summary->mfg_id,     pedid->mfg_id,     sizeof(summary->mfg_id));
+      g_strlcpy(summary->model_name, pedid->model_name, sizeof(summary->model_name));
+      summary->product_code = pedid->product_code;
+      g_hash_table_insert(chunk->edid_models, key, summary);
+   }
+   else {
+      g_free(key);
+   }
+   summary->ct++;
+   free_parsed_edid(pedid);
+}
+
+
+// satisfies Executor_Task_Func
+static void
+analyze_chunk_task(gpointer data) {
+   bool debug = false;
+   Analysis_Chunk * chunk = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "items %d..%d", chunk->start, chunk->end-1);
+
+   Bit_Set_256 arena[256];
+   Compact_Capabilities ccaps;
+   char model[ANALYZE_MODEL_MAX];
+   for (int ndx = chunk->start; ndx < chunk->end; ndx++) {
+      Analysis_Item * item = g_ptr_array_index(chunk->items, ndx);
+      if (item->is_edid) {
+         add_edid(chunk, item->edid);
+      }
+      else {
+         parse_capabilities_compact(item->capabilities, strlen(item->capabilities),
+                                    arena, 256, &ccaps);
+         summary_add(&chunk->caps, &ccaps);
+         get_capabilities_model(item->capabilities, model, sizeof(model));
+         summary_add(get_model_summary(chunk->models, model), &ccaps);
+      }
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+//
+// Report
+//
+
+static void
+json_caps_summary(Json_Writer * jw, Caps_Summary * summary) {
+   json_key_int(jw, "count",   summary->ct);
+   json_key_int(jw, "valid",   summary->validity_ct[CAPABILITIES_VALID]);
+   json_key_int(jw, "usable",  summary->validity_ct[CAPABILITIES_USABLE]);
+   json_key_int(jw, "invalid", summary->validity_ct[CAPABILITIES_INVALID]);
+   json_key(jw, "features_any");
+   json_hex_bytes(jw, summary->any_features.bytes, 32);
+   json_key(jw, "features_all");
+   json_hex_bytes(jw, summary->all_features.bytes, 32);
+   json_key(jw, "features");
+   json_begin_array(jw);
+   for (int code = 0; code < 256; code++) {
+      if (summary->feature_ct[code] == 0)
+         continue;
+      char pct[16];
+      g_snprintf(pct, sizeof(pct), "%.1f", 100.0 * summary->feature_ct[code] / summary->ct);
+      json_begin_object(jw);
+      json_key_int(jw, "feature_code", code);
+      json_key_string(jw, "name", get_feature_name_by_id_only(code));
+      json_key_int(jw, "count", summary->feature_ct[code]);
+      json_key(jw, "percent");
+      json_raw(jw, pct);
+      json_end_object(jw);
+   }
+   json_end_array(jw);
+}
+
+
+static void
+report_analysis(
+      Analysis_Input * input,
+      Analysis_Chunk * total)
+{
+   Json_Writer * jw = json_writer_new(fout());
+   json_begin_object(jw);
+   json_key_int(jw, "files",        input->file_ct);
+   json_key_int(jw, "unreadable",   input->unreadable_ct);
+   json_key_int(jw, "unrecognized", input->unrecognized_ct);
+
+   json_key(jw, "capabilities");
+   json_begin_object(jw);
+   json_caps_summary(jw, &total->caps);
+   json_end_object(jw);
+
+   json_key(jw, "models");
+   json_begin_array(jw);
+   GList * models = g_list_sort(g_hash_table_get_keys(total->models), (GCompareFunc) g_strcmp0);
+   for (GList * cur = models; cur; cur = cur->next) {
+      json_begin_object(jw);
+      json_key_string(jw, "model", cur->data);
+      json_caps_summary(jw, g_hash_table_lookup(total->models, cur->data));
+      json_end_object(jw);
+   }
+   g_list_free(models);
+   json_end_array(jw);
+
+   json_key(jw, "edids");
+   json_begin_object(jw);
+   json_key_int(jw, "count",   total->edid_ct);
+   json_key_int(jw, "invalid", total->invalid_edid_ct);
+   json_key(jw, "models");
+   json_begin_array(jw);
+   GList * edid_models = g_list_sort(g_hash_table_get_keys(total->edid_models), (GCompareFunc) g_strcmp0);
+   for (GList * cur = edid_models; cur; cur = cur->next) {
+      Edid_Model_Summary * summary = g_hash_table_lookup(total->edid_models, cur->data);
+      json_begin_object(jw);
+      json_key_string(jw, "mfg_id",       summary->mfg_id);
+      json_key_string(jw, "model_name",   summary->model_name);
+      json_key_int(   jw, "product_code", summary->product_code);
+      json_key_int(   jw, "count",        summary->ct);
+      json_end_object(jw);
+   }
+   g_list_free(edid_models);
+   json_end_array(jw);
+   json_end_object(jw);
+
+   json_end_object(jw);
+   f0printf(fout(), "\n");
+   json_writer_free(jw);
+}
+
+
+static void
+init_chunk(Analysis_Chunk * chunk) {
+   chunk->models      = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free);
+   chunk->edid_models = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free);
+}
+
+
+// Adds the results of a chunk to the total, and frees the chunk's tables
+static void
+merge_chunk(Analysis_Chunk * total, Analysis_Chunk * chunk) {
+   summary_merge(&total->caps, &chunk->caps);
+   total->edid_ct += chunk->edid_ct;
+   total->invalid_edid_ct += chunk->invalid_edid_ct;
+
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, chunk->models);
+   while (g_hash_table_iter_next(&iter, &key, &value))
+      summary_merge(get_model_summary(total->models, key), value);
+   g_hash_table_iter_init(&iter, chunk->edid_models);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      Edid_Model_Summary * summary = value;
+      Edid_Model_Summary * total_summary = g_hash_table_lookup(total->edid_models, key);
+      if (total_summary) {
+         total_summary->ct += summary->ct;
+      }
+      else {
+         g_hash_table_iter_steal(&iter);
+         g_hash_table_insert(total->edid_models, key, summary);
+      }
+   }
+   g_hash_table_destroy(chunk->models);
+   g_hash_table_destroy(chunk->edid_models);
+}
+
+
+/** Executes the ANALYZE command.
+ *
+ *  @param  parsed_cmd  parsed command line, arguments are files,
+ *                      directories, or "-" for standard input
+ *  @return true if all inputs were read, false if not
+ */
+bool
+app_analyze(Parsed_Cmd * parsed_cmd) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "argct=%d", parsed_cmd->argct);
+
+   Analysis_Input input = {0};
+   input.items = g_ptr_array_new_with_free_func(free_analysis_item);
+   if (parsed_cmd->argct == 0)
+      add_stream(&input, stdin);
+   for (int ndx = 0; ndx < parsed_cmd->argct; ndx++) {
+      if (streq(parsed_cmd->args[ndx], "-"))
+         add_stream(&input, stdin);
+      else
+         add_path(&input, parsed_cmd->args[ndx]);
+   }
+
+   int chunk_ct = (input.items->len + ANALYZE_CHUNK_SIZE - 1) / ANALYZE_CHUNK_SIZE;
+   Analysis_Chunk * chunks = calloc(chunk_ct, sizeof(Analysis_Chunk));
+   Executor_Group * group = executor_group_new();
+   for (int ndx = 0; ndx < chunk_ct; ndx++) {
+      Analysis_Chunk * chunk = &chunks[ndx];
+      chunk->items = input.items;
+      chunk->start = ndx * ANALYZE_CHUNK_SIZE;
+      chunk->end   = MIN(chunk->start + ANALYZE_CHUNK_SIZE, input.items->len);
+      init_chunk(chunk);
+      executor_submit(group, NULL, analyze_chunk_task, chunk);
+   }
+   executor_wait_group(group);
+
+   Analysis_Chunk total = {0};
+   init_chunk(&total);
+   for (int ndx = 0; ndx < chunk_ct; ndx++)
+      merge_chunk(&total, &chunks[ndx]);
+   free(chunks);
+
+   report_analysis(&input, &total);
+
+   g_hash_table_destroy(total.models);
+   g_hash_table_destroy(total.edid_models);
+   bool ok = (input.unreadable_ct == 0);
+   DBGTRC_DONE(debug, TRACE_GROUP, "items=%d, returning %s", input.items->len, sbool(ok));
+   g_ptr_array_free(input.items, true);
+   return ok;
+}
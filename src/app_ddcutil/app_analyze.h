@@ -0,0 +1,19 @@
+/** @file app_analyze.h
+ *
+ *  Implement the ANALYZE command
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_ANALYZE_H_
+#define APP_ANALYZE_H_
+
+#include <stdbool.h>
+
+#include "cmdline/parsed_cmd.h"
+
+bool
+app_analyze(Parsed_Cmd * parsed_cmd);
+
+#endif /* APP_ANALYZE_H_ */
@@ -0,0 +1,533 @@
+/** @file app_benchmark.c
+ *
+ *  Implement the BENCHMARK command, which times display detection and the
+ *  basic DDC operations for one or all displays over a range of sleep
+ *  multipliers, with dynamic sleep adjustment both disabled and enabled.
+ *
+ *  Operations timed:
+ *   - detect:         detection of all displays
+ *   - edid:           EDID read (I2C displays only)
+ *   - getvcp:         reading feature x10 (brightness)
+ *   - setvcp:         writing the current value of feature x10, without verification
+ *   - capabilities:   reading the capabilities string, bypassing any cached value
+ *   - table:          reading a table feature, if one was specified
+ *   - topology:       scanning the DRM connectors and I2C buses in /sys and /dev,
+ *                     without DDC communication
+ *
+ *  With option --fs-root, /sys and /dev are read from a snapshot written by
+ *  command SNAPSHOT, and only the topology scan is timed, so detection
+ *  performance can be measured on a machine without the original hardware.
+ *
+ *  If built with failure simulation, option --bench-faults repeats the
+ *  benchmark under simulated I2C faults, so that the effect of the retry and
+ *  dynamic sleep adjustment policies on throughput can be measured.  Each
+ *  scenario is either the name of a preset or an inline failure simulation
+ *  control string, with lines separated by semicolons.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "public/ddcutil_types.h"
+
+#include "util/data_structures.h"
+#include "util/failsim.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/sysfs_i2c_util.h"
+#include "util/sysfs_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+#include "base/stats_export.h"
+#include "base/status_code_mgt.h"
+#include "base/thread_sleep_data.h"
+
+#include "i2c/i2c_bus_core.h"
+#include "i2c/i2c_sysfs.h"
+
+#include "ddc/ddc_displays.h"
+#include "ddc/ddc_multi_part_io.h"
+#include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_vcp.h"
+
+#include "app_ddcutil/app_benchmark.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+#define BENCHMARK_DEFAULT_ITERATIONS  10
+#define BENCHMARK_VCP_FEATURE       0x10
+
+typedef enum {
+   BENCH_DETECT,
+   BENCH_EDID,
+   BENCH_GETVCP,
+   BENCH_SETVCP,
+   BENCH_CAPABILITIES,
+   BENCH_TABLE,
+   BENCH_TOPOLOGY,
+} Bench_Op;
+#define BENCH_OP_CT  (BENCH_TOPOLOGY+1)
+
+static const char * bench_op_names[BENCH_OP_CT] = {
+      "detect", "edid", "getvcp", "setvcp", "capabilities", "table", "topology"};
+
+static const double default_multipliers[] = {1.0, 0.5};
+
+#define NO_FAULTS "none"
+
+#ifdef ENABLE_FAILSIM
+/** Preset fault scenarios for option --bench-faults */
+typedef struct {
+   const char * name;
+   const char * desc;
+   const char * control;     // failure simulation control lines, separated by ';'
+} Bench_Fault_Preset;
+
+static const Bench_Fault_Preset fault_presets[] = {
+   {"ddc-data-10",  "10% DDCRC_DDC_DATA with 100ms stalls",
+                    "invoke_i2c_reader DDCRC_DDC_DATA 10% 100;"
+                    "invoke_i2c_write_reader DDCRC_DDC_DATA 10% 100"},
+   {"nak-5",        "5% of writes not acknowledged",
+                    "invoke_i2c_writer base:ENXIO 5%"},
+   {"all-zero-5",   "5% of reads return all zero bytes",
+                    "invoke_i2c_reader DDCRC_READ_ALL_ZERO 5%"},
+   {"slow-bus-25",  "25% of transfers stall 50ms",
+                    "invoke_i2c_writer delay 25% 50;"
+                    "invoke_i2c_reader delay 25% 50"},
+};
+
+
+/** Loads the failure simulation table for a fault scenario.
+ *
+ *  @param  scenario  preset name or control string
+ *  @return true if successful, false if invalid scenario
+ */
+static bool
+load_fault_scenario(const char * scenario) {
+   const char * control = scenario;
+   for (int ndx = 0; ndx < ARRAY_SIZE(fault_presets); ndx++) {
+      if (streq(scenario, fault_presets[ndx].name))
+         control = fault_presets[ndx].control;
+   }
+   char * work = strdup(control);
+   bool ok = fsim_load_control_string(work);
+   free(work);
+   return ok;
+}
+#endif
+
+
+/** Timings of one operation on one display in one configuration */
+typedef struct {
+   char *   display;         // "all" for detection
+   char *   model;
+   char *   faults;          // fault scenario, "none" if no simulated faults
+   double   multiplier;
+   bool     dsa;
+   Bench_Op op;
+   GArray * millis;          // double, successful operations
+   int      error_ct;
+   uint64_t bytect;          // bytes read by successful table reads
+} Bench_Result;
+
+
+static Bench_Result *
+new_bench_result(GPtrArray * results, const char * display, const char * model,
+                 const char * faults, double multiplier, bool dsa, Bench_Op op)
+{
+   Bench_Result * result = calloc(1, sizeof(Bench_Result));
+   result->display    = strdup(display);
+   result->model      = strdup(model);
+   result->faults     = strdup(faults);
+   result->multiplier = multiplier;
+   result->dsa        = dsa;
+   result->op         = op;
+   result->millis     = g_array_new(false, false, sizeof(double));
+   g_ptr_array_add(results, result);
+   return result;
+}
+
+
+static void
+free_bench_result(void * data) {
+   Bench_Result * result = data;
+   free(result->display);
+   free(result->model);
+   free(result->faults);
+   g_array_free(result->millis, true);
+   free(result);
+}
+
+
+static void
+record_time(Bench_Result * result, uint64_t start_nanos, Error_Info * erec) {
+   if (erec) {
+      result->error_ct++;
+      errinfo_free(erec);
+   }
+   else {
+      double millis = (cur_monotonic_nanosec() - start_nanos) / 1000000.0;
+      g_array_append_val(result->millis, millis);
+   }
+}
+
+
+static int
+compare_doubles(const void * a, const void * b) {
+   double da = *(const double *) a;
+   double db = *(const double *) b;
+   return (da > db) - (da < db);
+}
+
+
+/** Summary statistics of a #Bench_Result */
+typedef struct {
+   int    ct;
+   double min;
+   double median;
+   double p99;
+   double error_rate;
+   double bytes_per_sec;
+} Bench_Summary;
+
+
+static Bench_Summary
+summarize(Bench_Result * result) {
+   Bench_Summary summary = {0};
+   GArray * millis = result->millis;
+   int total = millis->len + result->error_ct;
+   summary.ct = millis->len;
+   summary.error_rate = (total > 0) ? (double) result->error_ct / total : 0.0;
+   summary.min = summary.median = summary.p99 = summary.bytes_per_sec = NAN;
+   if (millis->len > 0) {
+      g_array_sort(millis, compare_doubles);
+      double * v = (double *) millis->data;
+      summary.min    = v[0];
+      summary.median = v[(millis->len-1)/2];
+      // nearest rank
+      summary.p99    = v[(int) ceil(0.99 * millis->len) - 1];
+      if (result->op == BENCH_TABLE) {
+         double total_millis = 0;
+         for (int ndx = 0; ndx < millis->len; ndx++)
+            total_millis += v[ndx];
+         summary.bytes_per_sec = (total_millis > 0) ? result->bytect * 1000.0 / total_millis : NAN;
+      }
+   }
+   return summary;
+}
+
+
+static void
+set_configuration(double multiplier, bool dsa) {
+   tsd_set_sleep_multiplier_factor(multiplier);
+   tsd_dsa_enable(dsa);
+}
+
+
+/** Times the DDC operations on one display in one configuration. */
+static void
+benchmark_display(
+      Display_Handle * dh,
+      const char *     faults,
+      int              iterations,
+      double           multiplier,
+      bool             dsa,
+      int              table_feature,
+      GPtrArray *      results)
+{
+   bool debug = false;
+   Display_Ref * dref = dh->dref;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, multiplier=%4.2f, dsa=%s",
+                                       dh_repr(dh), multiplier, sbool(dsa));
+
+   char display[40];
+   g_strlcpy(display, dpath_short_name_t(&dref->io_path), sizeof(display));
+   const char * model = (dref->pedid) ? dref->pedid->model_name : "";
+   Bench_Result * edid_result  = NULL;
+   Bench_Result * table_result = NULL;
+   if (dref->io_path.io_mode == DDCA_IO_I2C)
+      edid_result = new_bench_result(results, display, model, faults, multiplier, dsa, BENCH_EDID);
+   Bench_Result * get_result  = new_bench_result(results, display, model, faults, multiplier, dsa, BENCH_GETVCP);
+   Bench_Result * set_result  = new_bench_result(results, display, model, faults, multiplier, dsa, BENCH_SETVCP);
+   Bench_Result * caps_result = new_bench_result(results, display, model, faults, multiplier, dsa, BENCH_CAPABILITIES);
+   if (table_feature >= 0)
+      table_result = new_bench_result(results, display, model, faults, multiplier, dsa, BENCH_TABLE);
+
+   set_configuration(multiplier, dsa);
+   for (int iter = 0; iter < iterations; iter++) {
+      uint64_t start;
+      if (edid_result) {
+         Buffer * rawedid = buffer_new(256, __func__);
+         start = cur_monotonic_nanosec();
+         Status_Errno_DDC rc = i2c_get_raw_edid_by_fd(dh->fd, rawedid);
+         record_time(edid_result, start, (rc == 0) ? NULL : errinfo_new2(rc, __func__, NULL));
+         buffer_free(rawedid, __func__);
+      }
+
+      Parsed_Nontable_Vcp_Response * response = NULL;
+      start = cur_monotonic_nanosec();
+      Error_Info * erec = ddc_get_nontable_vcp_value(dh, BENCHMARK_VCP_FEATURE, &response);
+      record_time(get_result, start, erec);
+      if (response) {
+         if (response->supported_opcode) {
+            // rewrite the current value, so the display's state is unchanged
+            int curval = response->sh << 8 | response->sl;
+            start = cur_monotonic_nanosec();
+            erec = ddc_set_nontable_vcp_value(dh, BENCHMARK_VCP_FEATURE, curval);
+            record_time(set_result, start, erec);
+         }
+         free(response);
+      }
+
+      Buffer * caps = NULL;
+      start = cur_monotonic_nanosec();
+      erec = multi_part_read_with_retry(dh, DDC_PACKET_TYPE_CAPABILITIES_REQUEST, 0x00, false, &caps);
+      record_time(caps_result, start, erec);
+      if (caps)
+         buffer_free(caps, __func__);
+
+      if (table_result) {
+         Buffer * table_bytes = NULL;
+         start = cur_monotonic_nanosec();
+         erec = ddc_get_table_vcp_value(dh, table_feature, &table_bytes);
+         record_time(table_result, start, erec);
+         if (table_bytes) {
+            table_result->bytect += table_bytes->len;
+            buffer_free(table_bytes, __func__);
+         }
+      }
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Times the scan of /sys and /dev that precedes DDC communication during
+ *  display detection: the DRM connectors, the I2C bus attributes, and the
+ *  /dev/i2c-N devices.  The scan does not depend on the sleep multiplier.
+ */
+static void
+benchmark_topology(int iterations, GPtrArray * results) {
+   Bench_Result * result = new_bench_result(results, "all", "", NO_FAULTS, 1.0, false, BENCH_TOPOLOGY);
+   for (int iter = 0; iter < iterations; iter++) {
+      uint64_t start = cur_monotonic_nanosec();
+      sysfs_i2c_reset_bus_attrs();
+      get_sys_drm_connectors(true);
+      Bit_Set_256 busnos = get_possible_ddc_ci_bus_numbers();
+      Bit_Set_256_Iterator bus_iter = bs256_iter_new(busnos);
+      int busno;
+      while ( (busno = bs256_iter_next(bus_iter)) >= 0) {
+         if (i2c_device_exists(busno))
+            sysfs_i2c_get_bus_attrs(busno);
+      }
+      bs256_iter_free(bus_iter);
+      record_time(result, start, NULL);
+   }
+}
+
+
+static void
+report_text(GPtrArray * results, int iterations) {
+   rpt_vstring(0, "Benchmark results, %d iterations, times in milliseconds:", iterations);
+   rpt_nl();
+   rpt_vstring(1, "%-16s %-14s %-12s %-13s %5s %-4s %5s %9s %9s %9s %7s",
+                  "Display", "Model", "Faults", "Operation", "Mult", "DSA", "Ct",
+                  "Min", "Median", "P99", "Errors");
+   for (int ndx = 0; ndx < results->len; ndx++) {
+      Bench_Result * result = g_ptr_array_index(results, ndx);
+      Bench_Summary s = summarize(result);
+      rpt_vstring(1, "%-16s %-14s %-12s %-13s %5.2f %-4s %5d %9.2f %9.2f %9.2f %6.1f%%",
+                     result->display, result->model, result->faults, bench_op_names[result->op],
+                     result->multiplier, (result->dsa) ? "on" : "off", s.ct,
+                     s.min, s.median, s.p99, s.error_rate * 100);
+      if (result->op == BENCH_TABLE && !isnan(s.bytes_per_sec))
+         rpt_vstring(2, "Table read throughput: %.0f bytes/sec", s.bytes_per_sec);
+   }
+}
+
+
+static char *
+export_results(GPtrArray * results, DDCA_Stats_Export_Format format) {
+   Stats_Export * exp = stats_export_new(format);
+   const char * metrics[] = {
+         "ddcutil_benchmark_min_milliseconds",
+         "ddcutil_benchmark_median_milliseconds",
+         "ddcutil_benchmark_p99_milliseconds",
+         "ddcutil_benchmark_error_ratio",
+         "ddcutil_benchmark_operations",
+         "ddcutil_benchmark_table_bytes_per_second"};
+   const char * helps[] = {
+         "Minimum operation time",
+         "Median operation time",
+         "99th percentile operation time",
+         "Fraction of operations that failed",
+         "Number of successful operations",
+         "Table read throughput"};
+   for (int metric = 0; metric < ARRAY_SIZE(metrics); metric++) {
+      stats_export_metric(exp, metrics[metric], STATS_METRIC_GAUGE, helps[metric]);
+      for (int ndx = 0; ndx < results->len; ndx++) {
+         Bench_Result * result = g_ptr_array_index(results, ndx);
+         if (metric == 5 && result->op != BENCH_TABLE)
+            continue;
+         Bench_Summary s = summarize(result);
+         double values[] = {s.min, s.median, s.p99, s.error_rate, s.ct, s.bytes_per_sec};
+         char multiplier[20];
+         g_snprintf(multiplier, sizeof(multiplier), "%.2f", result->multiplier);
+         stats_export_sample(exp, metrics[metric], values[metric], 6,
+                             "display",    result->display,
+                             "model",      result->model,
+                             "faults",     result->faults,
+                             "operation",  bench_op_names[result->op],
+                             "multiplier", multiplier,
+                             "dsa",        (result->dsa) ? "on" : "off");
+      }
+   }
+   return stats_export_finish(exp);
+}
+
+
+/** Executes the BENCHMARK command.
+ *
+ *  Optional command arguments are the number of iterations and a table
+ *  feature code.  The sleep multipliers are taken from option
+ *  --bench-multipliers.
+ *
+ *  Display detection is timed last, since redetection invalidates the
+ *  display references in **drefs**.  If a root prefix for /sys and /dev is
+ *  set, only the topology scan is timed and **drefs** is ignored.
+ *
+ *  @param  parsed_cmd  parsed command line
+ *  @param  drefs       displays to benchmark
+ *  @return true if successful, false if invalid arguments
+ */
+bool
+app_benchmark(Parsed_Cmd * parsed_cmd, GPtrArray * drefs) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "display count=%d", drefs->len);
+
+   int iterations = BENCHMARK_DEFAULT_ITERATIONS;
+   int table_feature = -1;
+   if (parsed_cmd->argct > 0) {
+      if (!str_to_int(parsed_cmd->args[0], &iterations, 10) || iterations <= 0) {
+         f0printf(ferr(), "Invalid iteration count: %s\n", parsed_cmd->args[0]);
+         DBGTRC_DONE(debug, TRACE_GROUP, "Returning false");
+         return false;
+      }
+   }
+   if (parsed_cmd->argct > 1) {
+      Byte feature_code;
+      if (!any_one_byte_hex_string_to_byte_in_buf(parsed_cmd->args[1], &feature_code)) {
+         f0printf(ferr(), "Invalid feature code: %s\n", parsed_cmd->args[1]);
+         DBGTRC_DONE(debug, TRACE_GROUP, "Returning false");
+         return false;
+      }
+      table_feature = feature_code;
+   }
+
+   const double * multipliers = default_multipliers;
+   int multiplier_ct = ARRAY_SIZE(default_multipliers);
+   double cmdline_multipliers[MAX_BENCH_MULTIPLIERS];
+   if (parsed_cmd->bench_multiplier_ct > 0) {
+      for (int ndx = 0; ndx < parsed_cmd->bench_multiplier_ct; ndx++)
+         cmdline_multipliers[ndx] = parsed_cmd->bench_multipliers[ndx];
+      multipliers   = cmdline_multipliers;
+      multiplier_ct = parsed_cmd->bench_multiplier_ct;
+   }
+
+   double saved_multiplier = tsd_get_sleep_multiplier_factor();
+   bool   saved_dsa        = tsd_dsa_is_enabled();
+   bool   saved_verify     = ddc_get_verify_setvcp();
+   ddc_set_verify_setvcp(false);
+
+   GPtrArray * scenarios = g_ptr_array_new_with_free_func(g_free);
+   g_ptr_array_add(scenarios, g_strdup(NO_FAULTS));
+#ifdef ENABLE_FAILSIM
+   if (parsed_cmd->bench_faults) {
+      gchar ** pieces = g_strsplit(parsed_cmd->bench_faults, ",", -1);
+      for (int ndx = 0; pieces[ndx]; ndx++)
+         g_ptr_array_add(scenarios, g_strdup(g_strstrip(pieces[ndx])));
+      g_strfreev(pieces);
+   }
+   fsim_set_verbose(false);
+#endif
+
+   GPtrArray * results = g_ptr_array_new_with_free_func(free_bench_result);
+   bool offline = *fs_root_prefix();
+   for (int sndx = 0; sndx < scenarios->len && !offline; sndx++) {
+      char * faults = g_ptr_array_index(scenarios, sndx);
+#ifdef ENABLE_FAILSIM
+      fsim_clear_error_table();
+      if (!streq(faults, NO_FAULTS) && !load_fault_scenario(faults)) {
+         f0printf(ferr(), "Invalid fault scenario: %s\n", faults);
+         continue;
+      }
+#endif
+
+      for (int ndx = 0; ndx < drefs->len; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(drefs, ndx);
+         Display_Handle * dh = NULL;
+         DDCA_Status rc = ddc_open_display(dref, CALLOPT_ERR_MSG, &dh);
+         if (rc != 0) {
+            f0printf(ferr(), "Error %s opening display %s\n", psc_desc(rc), dref_repr_t(dref));
+            continue;
+         }
+         for (int mndx = 0; mndx < multiplier_ct; mndx++) {
+            benchmark_display(dh, faults, iterations, multipliers[mndx], false, table_feature, results);
+            benchmark_display(dh, faults, iterations, multipliers[mndx], true,  table_feature, results);
+         }
+         ddc_close_display(dh);
+      }
+   }
+#ifdef ENABLE_FAILSIM
+   fsim_clear_error_table();
+   fsim_set_verbose(true);
+#endif
+
+   benchmark_topology(iterations, results);
+
+   // without simulated faults, since redetection invalidates drefs
+   for (int mndx = 0; mndx < multiplier_ct && !offline; mndx++) {
+      for (int dsa = 0; dsa <= 1; dsa++) {
+         Bench_Result * result = new_bench_result(results, "all", "", NO_FAULTS, multipliers[mndx], dsa, BENCH_DETECT);
+         set_configuration(multipliers[mndx], dsa);
+         for (int iter = 0; iter < iterations; iter++) {
+            ddc_discard_detected_displays();
+            uint64_t start = cur_monotonic_nanosec();
+            ddc_ensure_displays_detected();
+            record_time(result, start, NULL);
+         }
+      }
+   }
+   g_ptr_array_free(scenarios, true);
+
+   set_configuration(saved_multiplier, saved_dsa);
+   ddc_set_verify_setvcp(saved_verify);
+
+   if (parsed_cmd->flags & CMD_FLAG_EXPORT_STATS) {
+      char * s = export_results(results, parsed_cmd->stats_export_format);
+      f0puts(s, fout());
+      free(s);
+   }
+   else {
+      report_text(results, iterations);
+   }
+   g_ptr_array_free(results, true);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning true");
+   return true;
+}
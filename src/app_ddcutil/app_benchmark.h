@@ -0,0 +1,20 @@
+/** @file app_benchmark.h
+ *
+ *  Implement the BENCHMARK command
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_BENCHMARK_H_
+#define APP_BENCHMARK_H_
+
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+
+#include "cmdline/parsed_cmd.h"
+
+bool
+app_benchmark(Parsed_Cmd * parsed_cmd, GPtrArray * drefs);
+
+#endif /* APP_BENCHMARK_H_ */
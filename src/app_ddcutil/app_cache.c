@@ -0,0 +1,232 @@
+/** @file app_cache.c
+ *
+ *  Implement the CACHE command, which fills, reports, exports, imports,
+ *  and prunes the persistent caches:
+ *  - cache prime             detect displays, and for each display save the
+ *                            VCP version, capabilities string, and which
+ *                            features are unsupported
+ *  - cache stats             report cache files and entry counts
+ *  - cache export <file>     write all cached data to a file
+ *  - cache import <file>     load a file written by "cache export"
+ *  - cache prune (days)      remove superseded capabilities entries, and
+ *                            learned monitor data older than days
+ *
+ *  Export and import allow caches to be prepared on one system and installed
+ *  on others with the same monitor models.  Data qualified by the EDID hash,
+ *  i.e. VCP versions and unsupported feature signaling, is only used on
+ *  systems with the identical EDID.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "public/ddcutil_types.h"
+#include "public/ddcutil_status_codes.h"
+
+#include "util/data_structures.h"
+#include "util/error_info.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/vcp_version.h"
+
+#include "vcp/parse_capabilities.h"
+#include "vcp/persistent_capabilities.h"
+
+#include "dynvcp/dyn_feature_codes.h"
+
+#include "ddc/ddc_displays.h"
+#include "ddc/ddc_feature_scan.h"
+#include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_read_capabilities.h"
+#include "ddc/ddc_vcp_version.h"
+
+#include "app_ddcutil/app_cache.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+#define CACHE_DEFAULT_PRUNE_DAYS  180
+
+
+/** Determines the non-table features to probe for a display: those listed
+ *  in its capabilities string, and all other readable features that are
+ *  defined for its VCP version.
+ */
+static Bit_Set_256
+probe_candidates(Display_Handle * dh, Parsed_Capabilities * pcaps) {
+   Bit_Set_256 listed = (pcaps) ? get_parsed_capabilities_feature_ids(pcaps, false) : EMPTY_BIT_SET_256;
+   Bit_Set_256 candidates = EMPTY_BIT_SET_256;
+   for (int code = 1; code < 256; code++) {
+      Display_Feature_Metadata * dfm =
+            dyn_get_cached_feature_metadata_by_dh(code, dh, bs256_contains(listed, code));
+      if (dfm && (dfm->feature_flags & DDCA_READABLE) && !(dfm->feature_flags & DDCA_TABLE))
+         candidates = bs256_insert(candidates, code);
+   }
+   return candidates;
+}
+
+
+static bool
+prime_display(Display_Ref * dref) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s", dref_repr_t(dref));
+
+   Display_Handle * dh = NULL;
+   DDCA_Status psc = ddc_open_display(dref, CALLOPT_WAIT|CALLOPT_ERR_MSG, &dh);
+   if (psc == 0) {
+      DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dh(dh);
+      char * capabilities_string = NULL;
+      Error_Info * ddc_excp = ddc_get_capabilities_string(dh, &capabilities_string);
+      psc = ERRINFO_STATUS(ddc_excp);
+      ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING() || report_freed_exceptions);
+
+      int supported_ct   = -1;
+      int unsupported_ct = -1;
+      if (dref->io_path.io_mode == DDCA_IO_I2C) {
+         Parsed_Capabilities * pcaps =
+               (capabilities_string) ? parse_capabilities_string(capabilities_string) : NULL;
+         Bit_Set_256 unsupported = EMPTY_BIT_SET_256;
+         Bit_Set_256 supported = ddc_scan_supported_features(dh, probe_candidates(dh, pcaps), &unsupported);
+         supported_ct   = bs256_count(supported);
+         unsupported_ct = bs256_count(unsupported);
+         if (pcaps)
+            free_parsed_capabilities(pcaps);
+      }
+      ddc_close_display(dh);    // saves the unsupported features
+
+      rpt_vstring(0, "Display %d: VCP version %s, capabilities %s",
+                     dref->dispno, format_vspec(vspec), (psc == 0) ? "saved" : psc_desc(psc));
+      if (supported_ct >= 0)
+         rpt_vstring(1, "%d features supported, %d features unsupported",
+                        supported_ct, unsupported_ct);
+   }
+   else {
+      rpt_vstring(0, "Display %d: Error opening display: %s", dref->dispno, psc_desc(psc));
+   }
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, psc, "");
+   return psc == 0;
+}
+
+
+static bool
+app_cache_prime() {
+   if (!is_capabilities_cache_enabled()) {
+      f0printf(ferr(), "Capabilities cache is disabled, nothing to prime\n");
+      return false;
+   }
+   bool ok = true;
+   ddc_ensure_displays_detected();
+   GPtrArray * drefs = ddc_get_filtered_displays(false);
+   if (drefs->len == 0)
+      f0printf(fout(), "No displays found\n");
+   for (int ndx = 0; ndx < drefs->len; ndx++)
+      ok = prime_display(g_ptr_array_index(drefs, ndx)) && ok;
+   g_ptr_array_free(drefs, true);
+   return ok;
+}
+
+
+static bool
+app_cache_export(const char * filename) {
+   FILE * fp = fopen(filename, "w");
+   if (!fp) {
+      f0printf(ferr(), "Unable to open %s: %s\n", filename, strerror(errno));
+      return false;
+   }
+   int ct = export_persistent_caches(fp);
+   bool ok = (fclose(fp) == 0);
+   if (ok)
+      f0printf(fout(), "Exported %d records to %s\n", ct, filename);
+   else
+      f0printf(ferr(), "Error writing %s: %s\n", filename, strerror(errno));
+   return ok;
+}
+
+
+static bool
+app_cache_import(const char * filename) {
+   if (!is_capabilities_cache_enabled()) {
+      f0printf(ferr(), "Capabilities cache is disabled, not importing\n");
+      return false;
+   }
+   int ct = 0;
+   Error_Info * erec = import_persistent_caches(filename, &ct);
+   if (erec) {
+      if (ERRINFO_STATUS(erec) == -ENOENT)
+         f0printf(ferr(), "File not found: %s\n", filename);
+      else
+         errinfo_report(erec, 0);
+      errinfo_free(erec);
+   }
+   f0printf(fout(), "Imported %d records from %s\n", ct, filename);
+   return !erec;
+}
+
+
+static bool
+app_cache_prune(const char * days_arg) {
+   int days = CACHE_DEFAULT_PRUNE_DAYS;
+   if (days_arg && (!str_to_int(days_arg, &days, 10) || days < 0)) {
+      f0printf(ferr(), "Invalid number of days: %s\n", days_arg);
+      return false;
+   }
+   int ct = prune_persistent_caches(days);
+   f0printf(fout(), "Removed %d cache entries\n", ct);
+   return true;
+}
+
+
+/** Executes the CACHE command.
+ *
+ *  @param  parsed_cmd  parsed command line, args[0] is the subcommand
+ *  @return true if success, false if not
+ */
+bool
+app_cache(Parsed_Cmd * parsed_cmd) {
+   bool debug = false;
+   char * subcommand = parsed_cmd->args[0];
+   char * arg = (parsed_cmd->argct > 1) ? parsed_cmd->args[1] : NULL;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "subcommand=%s, arg=%s", subcommand, arg);
+
+   bool ok = false;
+   if (is_abbrev(subcommand, "prime", 2) && !arg) {
+      ok = app_cache_prime();
+   }
+   else if (is_abbrev(subcommand, "stats", 2) && !arg) {
+      report_persistent_caches(0);
+      rpt_nl();
+      report_persistent_cache_lookups(0);
+      ok = true;
+   }
+   else if (is_abbrev(subcommand, "export", 2) && arg) {
+      ok = app_cache_export(arg);
+   }
+   else if (is_abbrev(subcommand, "import", 2) && arg) {
+      ok = app_cache_import(arg);
+   }
+   else if (is_abbrev(subcommand, "prune", 3)) {
+      ok = app_cache_prune(arg);
+   }
+   else {
+      f0printf(ferr(),
+            "Invalid CACHE command: %s %s\n"
+            "Expected: prime | stats | export <file> | import <file> | prune (days)\n",
+            subcommand, (arg) ? arg : "");
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", sbool(ok));
+   return ok;
+}
@@ -0,0 +1,19 @@
+/** @file app_cache.h
+ *
+ *  Implement the CACHE command
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_CACHE_H_
+#define APP_CACHE_H_
+
+#include <stdbool.h>
+
+#include "cmdline/parsed_cmd.h"
+
+bool
+app_cache(Parsed_Cmd * parsed_cmd);
+
+#endif /* APP_CACHE_H_ */
@@ -0,0 +1,296 @@
+/** @file app_calibrate.c
+ *
+ *  Implement the CALIBRATE command, which searches for the smallest sleep
+ *  time for each sleep event type that keeps the DDC error rate of a display
+ *  under a target, and saves the results as the persistent sleep adjustment
+ *  factors for the monitor model.
+ *
+ *  The search is performed with dynamic sleep adjustment enabled, so that
+ *  the sleep time for each event type is the spec value times the adjustment
+ *  factor for that event type.  While one event type is searched, the factors
+ *  of all others are pinned to their last good values, so that DDC errors
+ *  can be attributed to the event type being searched.  Error rates are taken
+ *  from the per-display status counts maintained by dynamic sleep adjustment,
+ *  which see every try, not just the final result of an operation.
+ *
+ *  Each sample consists of:
+ *   - reading feature x10 (brightness)
+ *   - writing the current value of feature x10 and reading it back
+ *   - reading the capabilities string, bypassing any cached value
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "public/ddcutil_types.h"
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+#include "base/dynamic_sleep.h"
+#include "base/status_code_mgt.h"
+#include "base/thread_sleep_data.h"
+
+#include "ddc/ddc_multi_part_io.h"
+#include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_vcp.h"
+
+#include "app_ddcutil/app_calibrate.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+#define CALIBRATE_DEFAULT_SAMPLES          10
+#define CALIBRATE_DEFAULT_MAX_ERROR_PCT    5.0
+#define CALIBRATE_VCP_FEATURE           0x10
+#define CALIBRATE_MIN_FACTOR             0.05   // fraction of spec sleep time
+#define CALIBRATE_MAX_FACTOR             1.0
+#define CALIBRATE_SEARCH_STEPS              6
+#define CALIBRATE_SAFETY_MARGIN          1.25   // applied to the smallest good factor
+
+static const Sleep_Event_Type calibrated_events[] = {
+      SE_WRITE_TO_READ,
+      SE_POST_WRITE,
+      SE_POST_READ,
+      SE_PRE_MULTI_PART_READ,
+      SE_MULTI_PART_WRITE_TO_READ,
+      SE_AFTER_EACH_CAP_TABLE_SEGMENT,
+};
+#define CALIBRATED_EVENT_CT ARRAY_SIZE(calibrated_events)
+
+
+/** Executes one calibration sample.
+ *
+ *  @param  dh  display handle
+ *  @return true if all operations succeeded
+ */
+static bool
+calibration_sample(Display_Handle * dh) {
+   bool ok = true;
+   Parsed_Nontable_Vcp_Response * response = NULL;
+   Error_Info * erec = ddc_get_nontable_vcp_value(dh, CALIBRATE_VCP_FEATURE, &response);
+   if (erec) {
+      ok = false;
+      errinfo_free(erec);
+   }
+   if (response) {
+      if (response->supported_opcode) {
+         // rewrite the current value, so the display's state is unchanged
+         int curval = response->sh << 8 | response->sl;
+         erec = ddc_set_nontable_vcp_value(dh, CALIBRATE_VCP_FEATURE, curval);
+         if (erec) {
+            ok = false;
+            errinfo_free(erec);
+         }
+         else {
+            Parsed_Nontable_Vcp_Response * verify_response = NULL;
+            erec = ddc_get_nontable_vcp_value(dh, CALIBRATE_VCP_FEATURE, &verify_response);
+            if (erec) {
+               ok = false;
+               errinfo_free(erec);
+            }
+            else if ((verify_response->sh << 8 | verify_response->sl) != curval) {
+               ok = false;
+            }
+            free(verify_response);
+         }
+      }
+      free(response);
+   }
+
+   Buffer * caps = NULL;
+   erec = multi_part_read_with_retry(dh, DDC_PACKET_TYPE_CAPABILITIES_REQUEST, 0x00, false, &caps);
+   if (erec) {
+      ok = false;
+      errinfo_free(erec);
+   }
+   if (caps)
+      buffer_free(caps, __func__);
+   return ok;
+}
+
+
+/** Runs calibration samples and returns the DDC error rate observed for
+ *  a sleep event type.
+ *
+ *  @param  dh          display handle
+ *  @param  event_type  sleep event type
+ *  @param  samples     number of samples
+ *  @param  sample_ct_loc  where to return the number of DDC status codes
+ *                      credited to the event type
+ *  @return error rate, 1.0 if any operation failed
+ */
+static double
+measure_error_rate(
+      Display_Handle * dh,
+      Sleep_Event_Type event_type,
+      int              samples,
+      int *            sample_ct_loc)
+{
+   Dsa_Event_Data * evd = &dsa_get_display_data(dh->dref)->event_data[event_type];
+   int ok_before    = evd->total_ok_status_count;
+   int error_before = evd->total_error_status_count;
+   bool all_ok = true;
+   for (int ndx = 0; ndx < samples; ndx++) {
+      if (!calibration_sample(dh))
+         all_ok = false;
+   }
+   int ok_ct    = evd->total_ok_status_count    - ok_before;
+   int error_ct = evd->total_error_status_count - error_before;
+   *sample_ct_loc = ok_ct + error_ct;
+   if (!all_ok)
+      return 1.0;
+   return (ok_ct + error_ct > 0) ? (double) error_ct / (ok_ct + error_ct) : 0.0;
+}
+
+
+/** Executes the CALIBRATE command.
+ *
+ *  Optional command arguments are the number of samples per trial and
+ *  the maximum acceptable DDC error rate, in percent.
+ *
+ *  @param  parsed_cmd  parsed command line
+ *  @param  dh          display handle
+ *  @return true if successful, false if invalid arguments or calibration failed
+ */
+bool
+app_calibrate(Parsed_Cmd * parsed_cmd, Display_Handle * dh) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+   assert(dh);
+
+   int    samples       = CALIBRATE_DEFAULT_SAMPLES;
+   double max_error_pct = CALIBRATE_DEFAULT_MAX_ERROR_PCT;
+   if (parsed_cmd->argct > 0) {
+      if (!str_to_int(parsed_cmd->args[0], &samples, 10) || samples <= 0) {
+         f0printf(ferr(), "Invalid sample count: %s\n", parsed_cmd->args[0]);
+         DBGTRC_DONE(debug, TRACE_GROUP, "Returning false");
+         return false;
+      }
+   }
+   if (parsed_cmd->argct > 1) {
+      float f;
+      if (!str_to_float(parsed_cmd->args[1], &f) || f < 0 || f >= 100) {
+         f0printf(ferr(), "Invalid error rate: %s\n", parsed_cmd->args[1]);
+         DBGTRC_DONE(debug, TRACE_GROUP, "Returning false");
+         return false;
+      }
+      max_error_pct = f;
+   }
+   double max_error_rate = max_error_pct / 100;
+
+   if (dh->dref->io_path.io_mode != DDCA_IO_I2C) {
+      f0printf(ferr(), "CALIBRATE command is supported only for I2C displays\n");
+      DBGTRC_DONE(debug, TRACE_GROUP, "Returning false");
+      return false;
+   }
+   if (!dh->dref->mmid) {
+      f0printf(ferr(), "Monitor model unknown, cannot save calibration\n");
+      DBGTRC_DONE(debug, TRACE_GROUP, "Returning false");
+      return false;
+   }
+
+   double saved_multiplier = tsd_get_sleep_multiplier_factor();
+   bool   saved_dsa        = tsd_dsa_is_enabled();
+   bool   saved_verify     = ddc_get_verify_setvcp();
+   tsd_set_sleep_multiplier_factor(1.0);
+   tsd_dsa_enable(true);
+   ddc_set_verify_setvcp(false);    // verification is performed explicitly
+
+   rpt_vstring(0, "Calibrating sleep times for display %s, model %s",
+                  dpath_short_name_t(&dh->dref->io_path), mmk_repr(*dh->dref->mmid));
+   rpt_vstring(0, "%d samples per trial, maximum DDC error rate %.1f%%", samples, max_error_pct);
+   rpt_nl();
+
+   double factors[CALIBRATED_EVENT_CT];
+   bool   calibrated[CALIBRATED_EVENT_CT];
+   for (int ndx = 0; ndx < CALIBRATED_EVENT_CT; ndx++) {
+      factors[ndx] = CALIBRATE_MAX_FACTOR;
+      calibrated[ndx] = false;
+      dsa_pin_adjustment_factor(dh->dref, calibrated_events[ndx], factors[ndx]);
+   }
+
+   bool ok = true;
+   int sample_ct = 0;
+   double error_rate = measure_error_rate(dh, SE_WRITE_TO_READ, samples, &sample_ct);
+   if (error_rate > max_error_rate) {
+      f0printf(ferr(), "DDC error rate %.1f%% using the spec sleep times, calibration not possible\n",
+                       error_rate * 100);
+      ok = false;
+   }
+
+   for (int ndx = 0; ok && ndx < CALIBRATED_EVENT_CT; ndx++) {
+      Sleep_Event_Type event_type = calibrated_events[ndx];
+      double good = CALIBRATE_MAX_FACTOR;
+      double bad  = CALIBRATE_MIN_FACTOR;
+
+      // first check whether the smallest factor is already good enough
+      dsa_pin_adjustment_factor(dh->dref, event_type, bad);
+      error_rate = measure_error_rate(dh, event_type, samples, &sample_ct);
+      if (sample_ct == 0) {
+         rpt_vstring(1, "%-32s not exercised", sleep_event_name(event_type));
+         dsa_pin_adjustment_factor(dh->dref, event_type, factors[ndx]);
+         continue;
+      }
+      if (error_rate <= max_error_rate) {
+         good = bad;
+      }
+      else {
+         for (int step = 0; step < CALIBRATE_SEARCH_STEPS; step++) {
+            double trial = (good + bad) / 2;
+            dsa_pin_adjustment_factor(dh->dref, event_type, trial);
+            error_rate = measure_error_rate(dh, event_type, samples, &sample_ct);
+            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s: factor %5.3f, error rate %5.3f",
+                            sleep_event_name(event_type), trial, error_rate);
+            if (error_rate <= max_error_rate)
+               good = trial;
+            else
+               bad = trial;
+         }
+      }
+      factors[ndx] = MIN(good * CALIBRATE_SAFETY_MARGIN, CALIBRATE_MAX_FACTOR);
+      calibrated[ndx] = true;
+      dsa_pin_adjustment_factor(dh->dref, event_type, factors[ndx]);
+      rpt_vstring(1, "%-32s factor %5.2f", sleep_event_name(event_type), factors[ndx]);
+   }
+
+   if (ok) {
+      // confirm the combination of factors
+      error_rate = measure_error_rate(dh, SE_WRITE_TO_READ, samples, &sample_ct);
+      rpt_nl();
+      if (error_rate > max_error_rate) {
+         f0printf(ferr(), "DDC error rate %.1f%% using the calibrated factors, results not saved\n",
+                          error_rate * 100);
+         ok = false;
+      }
+      else {
+         for (int ndx = 0; ndx < CALIBRATED_EVENT_CT; ndx++) {
+            if (calibrated[ndx])
+               dsa_set_persistent_adjustment_factor(dh->dref->mmid, calibrated_events[ndx], factors[ndx]);
+         }
+         dsa_save_persistent_stats();
+         char * fn = dsa_get_persistent_stats_file_name();
+         rpt_vstring(0, "Calibrated factors saved to %s", fn);
+         rpt_vstring(0, "They are used when dynamic sleep adjustment is enabled (option --dsa)");
+         free(fn);
+      }
+   }
+
+   dsa_unpin_adjustment_factors(dh->dref);
+   tsd_set_sleep_multiplier_factor(saved_multiplier);
+   tsd_dsa_enable(saved_dsa);
+   ddc_set_verify_setvcp(saved_verify);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s", sbool(ok));
+   return ok;
+}
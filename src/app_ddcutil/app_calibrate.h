@@ -0,0 +1,20 @@
+/** @file app_calibrate.h
+ *
+ *  Implement the CALIBRATE command
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_CALIBRATE_H_
+#define APP_CALIBRATE_H_
+
+#include <stdbool.h>
+
+#include "cmdline/parsed_cmd.h"
+#include "base/displays.h"
+
+bool
+app_calibrate(Parsed_Cmd * parsed_cmd, Display_Handle * dh);
+
+#endif /* APP_CALIBRATE_H_ */
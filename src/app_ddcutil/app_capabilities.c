@@ -10,6 +10,7 @@
 #include <config.h>
 
 #include <assert.h>
+#include <glib-2.0/glib.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,6 +18,7 @@
 
 #include "util/data_structures.h"
 #include "util/error_info.h"
+#include "util/json_writer.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
 
@@ -27,9 +29,18 @@
 #include "base/rtti.h"
 /** \endcond */
 
+#include "vcp/parsed_capabilities_feature.h"
+
+#include "dynvcp/dyn_feature_codes.h"
 #include "dynvcp/dyn_parsed_capabilities.h"
 
+#include "ddc/ddc_display_ref_reports.h"
+#include "ddc/ddc_displays.h"
+#include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_read_capabilities.h"
+#include "ddc/ddc_vcp_version.h"
+
+#include "app_ddcutil/app_dynamic_features.h"
 
 #include "app_ddcutil/app_capabilities.h"
 
@@ -38,6 +49,33 @@
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
 
 
+/** Reports why the capabilities string for a display could not be read.
+ *
+ *  @param psc           status code
+ *  @param display_desc  display description for messages
+ */
+static void
+report_capabilities_error(DDCA_Status psc, const char * display_desc)
+{
+   FILE * ferr = stderr;
+   switch(psc) {
+   case DDCRC_REPORTED_UNSUPPORTED:       // should not happen
+   case DDCRC_DETERMINED_UNSUPPORTED:
+      f0printf(ferr, "Unsupported request\n");
+      break;
+   case DDCRC_RETRIES:
+      f0printf(ferr,
+               "Unable to get capabilities for monitor on %s.  Maximum DDC retries exceeded.\n",
+               display_desc);
+      break;
+   default:
+      f0printf(ferr, "(%s) !!! Unable to get capabilities for monitor on %s\n",
+             __func__, display_desc);
+      DBGMSG("Unexpected status code: %s", psc_desc(psc));
+   }
+}
+
+
 /** Gets the capabilities string for a display.
  *
  *  The value is cached as this is an expensive operation.
@@ -55,7 +93,6 @@ app_get_capabilities_string(Display_Handle * dh, char ** capabilities_string_loc
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
 
-   FILE * ferr = stderr;
    Error_Info * ddc_excp = NULL;
    *capabilities_string_loc = NULL;
 
@@ -63,21 +100,7 @@ app_get_capabilities_string(Display_Handle * dh, char ** capabilities_string_loc
    DDCA_Status psc = ERRINFO_STATUS(ddc_excp);
 
    if (ddc_excp) {
-      switch(psc) {
-      case DDCRC_REPORTED_UNSUPPORTED:       // should not happen
-      case DDCRC_DETERMINED_UNSUPPORTED:
-         f0printf(ferr, "Unsupported request\n");
-         break;
-      case DDCRC_RETRIES:
-         f0printf(ferr,
-                  "Unable to get capabilities for monitor on %s.  Maximum DDC retries exceeded.\n",
-                  dh_repr(dh));
-         break;
-      default:
-         f0printf(ferr, "(%s) !!! Unable to get capabilities for monitor on %s\n",
-                __func__, dh_repr(dh));
-         DBGMSG("Unexpected status code: %s", psc_desc(psc));
-      }
+      report_capabilities_error(psc, dh_repr(dh));
       ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING() || report_freed_exceptions);
    }
 
@@ -108,39 +131,244 @@ app_show_parsed_capabilities(Display_Handle * dh, Parsed_Capabilities * pcap)
 }
 
 
+/** Reports a capabilities string, parsed unless the output level is terse.
+ *
+ *  @param  dref                display reference
+ *  @param  capabilities_string unparsed capabilities string
+ */
+static void
+show_capabilities_string(Display_Ref * dref, char * capabilities_string)
+{
+   FILE * fout = stdout;
+   bool synthesized = (dref->io_path.io_mode == DDCA_IO_USB);
+   DDCA_Output_Level ol = get_output_level();
+   if (ol == DDCA_OL_TERSE) {
+       f0printf(fout,
+               "%s capabilities string: %s\n",
+               (synthesized) ? "Synthesized unparsed" : "Unparsed",
+               capabilities_string);
+   }
+   else {
+      // pcaps is always set, but may be damaged if there was a parsing error
+      Parsed_Capabilities * pcaps = parse_capabilities_string(capabilities_string);
+      if (synthesized)
+         pcaps->raw_value_synthesized = true;
+      dyn_report_parsed_capabilities(pcaps, NULL, dref, 0);
+      free_parsed_capabilities(pcaps);
+   }
+}
+
+
+/** Writes a JSON object for the capabilities of a display, or for the
+ *  reason they could not be read.
+ *
+ *  @param  jw                  JSON writer
+ *  @param  dref                display reference
+ *  @param  capabilities_string unparsed capabilities string, NULL if not read
+ *  @param  psc                 status code of reading the capabilities string
+ */
+static void
+json_capabilities(
+      Json_Writer * jw,
+      Display_Ref * dref,
+      char *        capabilities_string,
+      DDCA_Status   psc)
+{
+   json_begin_object(jw);
+   json_key(jw, "display");
+   ddc_json_display_ref(jw, dref);
+   if (psc != 0) {
+      json_key_string(jw, "status", psc_name(psc));
+   }
+   else {
+      Parsed_Capabilities * pcaps = parse_capabilities_string(capabilities_string);
+      json_key(jw, "capabilities");
+      json_begin_object(jw);
+      json_key_string(jw, "raw",          capabilities_string);
+      json_key_bool(  jw, "synthesized",  dref->io_path.io_mode == DDCA_IO_USB);
+      json_key_string(jw, "model",        pcaps->model);
+      json_key_string(jw, "mccs_version", pcaps->mccs_version_string);
+      json_key(jw, "commands");
+      json_begin_array(jw);
+      Byte_Value_Array commands = parsed_capabilities_commands(pcaps);
+      for (int ndx = 0; commands && ndx < bva_length(commands); ndx++)
+         json_int(jw, bva_get(commands, ndx));
+      json_end_array(jw);
+      json_key(jw, "features");
+      json_begin_array(jw);
+      GPtrArray * vcp_features = parsed_capabilities_vcp_features(pcaps);
+      for (int ndx = 0; ndx < vcp_features->len; ndx++) {
+         Capabilities_Feature_Record * cfr = g_ptr_array_index(vcp_features, ndx);
+         Byte_Value_Array values = cfr_get_values(cfr);
+         json_begin_object(jw);
+         json_key_int(jw, "feature_code", cfr->feature_id);
+         json_key_string(jw, "name", dyn_get_feature_name(cfr->feature_id, dref));
+         if (values) {
+            json_key(jw, "values");
+            json_begin_array(jw);
+            for (int vndx = 0; vndx < bva_length(values); vndx++)
+               json_int(jw, bva_get(values, vndx));
+            json_end_array(jw);
+         }
+         json_end_object(jw);
+      }
+      json_end_array(jw);
+      if (pcaps->messages && pcaps->messages->len > 0) {
+         json_key(jw, "errors");
+         json_begin_array(jw);
+         for (int ndx = 0; ndx < pcaps->messages->len; ndx++)
+            json_string(jw, g_ptr_array_index(pcaps->messages, ndx));
+         json_end_array(jw);
+      }
+      json_end_object(jw);
+      free_parsed_capabilities(pcaps);
+   }
+   json_end_object(jw);
+}
+
+
 /** Implements the CAPABILITIES command.
  *
- *  @param  dh #Display_Handle
+ *  @param  dh   #Display_Handle
+ *  @param  json write output as JSON
  *  @return status code
  */
 DDCA_Status
-app_capabilities(Display_Handle * dh)
+app_capabilities(Display_Handle * dh, bool json)
 {
    bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, json=%s", dh_repr(dh), sbool(json));
    char * capabilities_string;
    DDCA_Status ddcrc;
-   FILE * fout = stdout;
 
    ddcrc = app_get_capabilities_string(dh, &capabilities_string);
-   if (ddcrc == 0) {
-      DDCA_Output_Level ol = get_output_level();
-      if (ol == DDCA_OL_TERSE) {
-          f0printf(fout,
-                  "%s capabilities string: %s\n",
-                       (dh->dref->io_path.io_mode == DDCA_IO_USB)
-                             ? "Synthesized unparsed"
-                             : "Unparsed",
-                  capabilities_string);
+   if (json) {
+      Json_Writer * jw = json_writer_new(stdout);
+      json_capabilities(jw, dh->dref, capabilities_string, ddcrc);
+      json_writer_free(jw);
+   }
+   else if (ddcrc == 0)
+      show_capabilities_string(dh->dref, capabilities_string);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Capabilities retrieval for one display of #app_capabilities_all_displays() */
+typedef struct {
+   Display_Ref * dref;
+   char *        capabilities_string;   // private copy, set if psc == 0
+   DDCA_Status   psc;
+} Capabilities_Worker_Rec;
+
+
+static gpointer
+capabilities_worker(gpointer data)
+{
+   bool debug = false;
+   Capabilities_Worker_Rec * rec = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s", dref_repr_t(rec->dref));
+
+   Display_Handle * dh = NULL;
+   rec->psc = ddc_open_display(rec->dref, CALLOPT_WAIT, &dh);
+   if (rec->psc == 0) {
+      get_vcp_version_by_dh(dh);     // while the display is open
+      char * capabilities_string = NULL;
+      Error_Info * ddc_excp = ddc_get_capabilities_string(dh, &capabilities_string);
+      rec->psc = ERRINFO_STATUS(ddc_excp);
+      if (capabilities_string)
+         rec->capabilities_string = strdup(capabilities_string);
+      ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING() || report_freed_exceptions);
+      ddc_close_display(dh);
+   }
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rec->psc, "dref=%s", dref_repr_t(rec->dref));
+   return NULL;
+}
+
+
+static int
+compare_worker_recs_by_dispno(const void * a, const void * b) {
+   const Capabilities_Worker_Rec * rec_a = a;
+   const Capabilities_Worker_Rec * rec_b = b;
+   return rec_a->dref->dispno - rec_b->dref->dispno;
+}
+
+
+/** Implements the CAPABILITIES command with option --all.
+ *
+ *  The capabilities strings of all valid displays are read concurrently,
+ *  with one thread per display.  Each display has its own bus, so the
+ *  reads do not contend with each other.  Once all threads have finished,
+ *  the results are reported in display number order.
+ *
+ *  @param  json  write output as JSON
+ *  @return 0 if the capabilities of every display were read,
+ *          otherwise the status code of the first display that failed
+ */
+DDCA_Status
+app_capabilities_all_displays(bool json)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "json=%s", sbool(json));
+   FILE * fout = stdout;
+   DDCA_Status ddcrc = 0;
+
+   ddc_ensure_displays_detected();
+   GPtrArray * drefs = ddc_get_filtered_displays(false);
+   int rec_ct = drefs->len;
+   Capabilities_Worker_Rec * recs = calloc(rec_ct, sizeof(Capabilities_Worker_Rec));
+   GThread ** threads = calloc(rec_ct, sizeof(GThread*));
+   for (int ndx = 0; ndx < rec_ct; ndx++) {
+      Capabilities_Worker_Rec * rec = &recs[ndx];
+      rec->dref = g_ptr_array_index(drefs, ndx);
+      app_check_dynamic_features(rec->dref);   // reports, so not in worker thread
+      threads[ndx] = g_thread_new("capabilities_worker", capabilities_worker, rec);
+   }
+   for (int ndx = 0; ndx < rec_ct; ndx++)
+      g_thread_join(threads[ndx]);
+   free(threads);
+   g_ptr_array_free(drefs, true);
+
+   qsort(recs, rec_ct, sizeof(Capabilities_Worker_Rec), compare_worker_recs_by_dispno);
+   if (json) {
+      Json_Writer * jw = json_writer_new(stdout);
+      json_begin_object(jw);
+      json_key(jw, "displays");
+      json_begin_array(jw);
+      for (int ndx = 0; ndx < rec_ct; ndx++) {
+         Capabilities_Worker_Rec * rec = &recs[ndx];
+         json_capabilities(jw, rec->dref, rec->capabilities_string, rec->psc);
+         free(rec->capabilities_string);
+         if (rec->psc != 0 && ddcrc == 0)
+            ddcrc = rec->psc;
       }
-      else {
-         // pcaps is always set, but may be damaged if there was a parsing error
-         Parsed_Capabilities * pcaps = parse_capabilities_string(capabilities_string);
-         app_show_parsed_capabilities(dh, pcaps);
-         free_parsed_capabilities(pcaps);
+      json_end_array(jw);
+      json_end_object(jw);
+      json_writer_free(jw);
+   }
+   else {
+      if (rec_ct == 0)
+         f0printf(fout, "No displays found\n");
+      for (int ndx = 0; ndx < rec_ct; ndx++) {
+         Capabilities_Worker_Rec * rec = &recs[ndx];
+         if (ndx > 0)
+            f0printf(fout, "\n");
+         f0printf(fout, "Display %d\n", rec->dref->dispno);
+         if (rec->psc == 0) {
+            show_capabilities_string(rec->dref, rec->capabilities_string);
+            free(rec->capabilities_string);
+         }
+         else {
+            report_capabilities_error(rec->psc, dref_repr_t(rec->dref));
+            if (ddcrc == 0)
+               ddcrc = rec->psc;
+         }
       }
    }
-   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   free(recs);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "rec_ct=%d", rec_ct);
    return ddcrc;
 }
 
@@ -148,5 +376,7 @@ void init_app_capabilities() {
    RTTI_ADD_FUNC(app_get_capabilities_string);
    RTTI_ADD_FUNC(app_show_parsed_capabilities);
    RTTI_ADD_FUNC(app_capabilities);
+   RTTI_ADD_FUNC(capabilities_worker);
+   RTTI_ADD_FUNC(app_capabilities_all_displays);
 }
 
@@ -26,7 +26,11 @@ app_show_parsed_capabilities(
 
 DDCA_Status
 app_capabilities(              // implements the CAPABILITIES command
-      Display_Handle * dh);
+      Display_Handle * dh,
+      bool             json);
+
+DDCA_Status
+app_capabilities_all_displays(bool json);   // implements CAPABILITIES --all
 
 void init_app_capabilities();
 
@@ -27,6 +27,7 @@
 #include "util/error_info.h"
 #include "util/file_util.h"
 #include "util/glib_util.h"
+#include "util/json_writer.h"
 #include "util/report_util.h"
 #include "util/xdg_util.h"
 /** \endcond */
@@ -36,8 +37,13 @@
 
 #include "i2c/i2c_bus_core.h"
 
+#include "ddc/ddc_display_ref_reports.h"
+#include "ddc/ddc_displays.h"
+#include "ddc/ddc_display_selection.h"
 #include "ddc/ddc_dumpload.h"
+#include "ddc/ddc_packet_io.h"
 
+#include "app_ddcutil/app_dynamic_features.h"
 #include "app_ddcutil/app_dumpload.h"
 
 static const char TRACE_GROUP = DDCA_TRC_TOP;
@@ -49,6 +55,7 @@ static const char TRACE_GROUP = DDCA_TRC_TOP;
  *
  * @param  edid         pointer to parsed edid
  * @param  time_millis  timestamp to use
+ * @param  snapshot     file name for a binary snapshot
  * @param  buf          buffer in which to return filename
  * @param  bufsz        buffer size
  */
@@ -56,6 +63,7 @@ static
 void create_simple_vcp_fn_by_edid(
           Parsed_Edid * edid,
           time_t        time_millis,
+          bool          snapshot,
           char *        buf,
           int           bufsz)
 {
@@ -64,32 +72,127 @@ void create_simple_vcp_fn_by_edid(
 
    char timestamp_text[30];
    format_timestamp(time_millis, timestamp_text, 30);
-   g_snprintf(buf, bufsz, "%s-%s-%s.vcp",
+   g_snprintf(buf, bufsz, "%s-%s-%s.%s",
               edid->model_name,
               edid->serial_ascii,
-              timestamp_text
+              timestamp_text,
+              (snapshot) ? "snapshot" : "vcp"
              );
    str_replace_char(buf, ' ', '_');     // convert blanks to underscores
 }
 
 
-/** Creates a VCP filename from a #Display_Handle and a timestamp.
+/** Writes DUMPVCP data to a file.
  *
- * @param  dh           display handle
- * @param  time_millis  timestamp to use
- * @param  buf          buffer in which to return filename
- * @param  bufsz        buffer size
+ *  @param  data      data to write, freed by this function
+ *  @param  edid      EDID of the display, used to generate the file name
+ *  @param  filename  name of file to write to,
+ *                    if NULL, the file name is generated
+ *  @param  snapshot  write a binary snapshot instead of text
+ *  @return status code
  */
-static
-void create_simple_vcp_fn_by_dh(
-          Display_Handle * dh,
-          time_t           time_millis,
-          char *           buf,
-          int              bufsz)
+static Status_Errno_DDC
+write_dumpload_data_file(
+      Dumpload_Data * data,
+      Parsed_Edid *   edid,
+      const char *    filename,
+      bool            snapshot)
 {
-   Parsed_Edid * edid = dh->dref->pedid;
-   assert(edid);
-   create_simple_vcp_fn_by_edid(edid, time_millis, buf, bufsz);
+   char * actual_filename = NULL;
+   FILE * fout = stdout;
+   FILE * ferr = stderr;
+   Status_Errno_DDC ddcrc = 0;
+
+   GPtrArray * strings  = (snapshot) ? NULL : convert_dumpload_data_to_string_array(data);
+   Buffer *    snapshot_buf = (snapshot) ? convert_dumpload_data_to_snapshot(data) : NULL;
+   FILE * output_fp = NULL;
+   if (filename) {
+      output_fp = fopen(filename, "w+");
+      if (!output_fp) {
+         ddcrc = -errno;
+         f0printf(ferr, "Unable to open %s for writing: %s\n", filename, strerror(errno));
+      }
+      actual_filename = strdup(filename);
+   }
+   else {
+      char simple_fn_buf[NAME_MAX+1];
+      time_t time_millis = data->timestamp_millis;
+      create_simple_vcp_fn_by_edid(
+                            edid,
+                            time_millis,
+                            snapshot,
+                            simple_fn_buf,
+                            sizeof(simple_fn_buf));
+      actual_filename = xdg_data_home_file("ddcutil",simple_fn_buf);
+      // control with MsgLevel?
+      f0printf(fout, "Writing file: %s\n", actual_filename);
+      ddcrc = fopen_mkdir(actual_filename, "w+", ferr, &output_fp);
+      ASSERT_IFF(output_fp, ddcrc == 0);
+      if (ddcrc != 0) {
+         f0printf(ferr, "Unable to create '%s', %s\n", actual_filename, strerror(-ddcrc));
+      }
+   }
+   free_dumpload_data(data);
+
+   if (output_fp) {
+      if (snapshot_buf) {
+         fwrite(snapshot_buf->bytes, 1, snapshot_buf->len, output_fp);
+      }
+      else {
+         int ct = strings->len;
+         int ndx;
+         for (ndx=0; ndx<ct; ndx++){
+            char * nextval = g_ptr_array_index(strings, ndx);
+            fprintf(output_fp, "%s\n", nextval);
+         }
+      }
+      fclose(output_fp);
+   }
+   else {
+      ddcrc = -errno;
+      f0printf(ferr, "Unable to open %s for writing: %s\n", actual_filename, strerror(errno));
+   }
+   if (strings)
+      g_ptr_array_free(strings, true);
+   if (snapshot_buf)
+      buffer_free(snapshot_buf, __func__);
+   free(actual_filename);
+   return ddcrc;
+}
+
+
+/** Writes DUMPVCP data for a display as a JSON object.
+ *
+ *  @param  jw     JSON writer
+ *  @param  dref   display reference
+ *  @param  data   data to write, NULL if DUMPVCP failed
+ *  @param  ddcrc  status code of DUMPVCP
+ */
+static void
+json_dumpload_data(Json_Writer * jw, Display_Ref * dref, Dumpload_Data * data, Status_Errno_DDC ddcrc)
+{
+   json_begin_object(jw);
+   json_key(jw, "display");
+   ddc_json_display_ref(jw, dref);
+   if (ddcrc != 0) {
+      json_key_string(jw, "status", psc_name(ddcrc));
+   }
+   else {
+      char timestamp_text[30];
+      format_timestamp(data->timestamp_millis, timestamp_text, sizeof(timestamp_text));
+      json_key_string(jw, "timestamp", timestamp_text);
+      json_key(jw, "values");
+      json_begin_array(jw);
+      for (int ndx = 0; ndx < vcp_value_set_size(data->vcp_values); ndx++) {
+         DDCA_Any_Vcp_Value * valrec = vcp_value_set_get(data->vcp_values, ndx);
+         json_begin_object(jw);
+         json_key_int(jw, "feature_code", valrec->opcode);
+         write_json_single_vcp_value_members(jw, valrec);
+         json_end_object(jw);
+      }
+      json_end_array(jw);
+   }
+   json_end_object(jw);
 }
 
 
@@ -98,69 +201,42 @@ void create_simple_vcp_fn_by_dh(
  *  @param  dh        display handle
  *  @param  filename  name of file to write to,
  *                    if NULL, the file name is generated
+ *  @param  json      write the data as JSON, to **filename** if specified,
+ *                    otherwise to stdout
+ *  @param  snapshot  write a binary snapshot, ignored if **json**
  *  @return status code
  *
  *  If the file name is generated, it is in the ddcutil subdirectory of the
  *  user's XDG home data directory, normally $HOME/.local/share/ddcutil/
  */
 Status_Errno_DDC
-app_dumpvcp_as_file(Display_Handle * dh, const char * filename)
+app_dumpvcp_as_file(Display_Handle * dh, const char * filename, bool json, bool snapshot)
 {
    bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, filename=%p->%s", dh_repr(dh), filename, filename);
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, filename=%p->%s, json=%s, snapshot=%s",
+                                       dh_repr(dh), filename, filename, sbool(json), sbool(snapshot));
 
-   char * actual_filename = NULL;
-   FILE * fout = stdout;
-   FILE * ferr = stderr;
    Dumpload_Data * data = NULL;
    Status_Errno_DDC ddcrc = dumpvcp_as_dumpload_data(dh, &data);
-   if (ddcrc == 0) {
-      GPtrArray * strings = convert_dumpload_data_to_string_array(data);
-      FILE * output_fp = NULL;
-      if (filename) {
-         output_fp = fopen(filename, "w+");
-         if (!output_fp) {
+   if (json) {
+      FILE * output_fp = (filename) ? fopen(filename, "w+") : stdout;
+      if (!output_fp) {
+         if (ddcrc == 0)
             ddcrc = -errno;
-            f0printf(ferr, "Unable to open %s for writing: %s\n", filename, strerror(errno));
-         }
-         actual_filename = strdup(filename);
-      }
-      else {
-         char simple_fn_buf[NAME_MAX+1];
-         time_t time_millis = data->timestamp_millis;
-         create_simple_vcp_fn_by_dh(
-                               dh,
-                               time_millis,
-                               simple_fn_buf,
-                               sizeof(simple_fn_buf));
-         actual_filename = xdg_data_home_file("ddcutil",simple_fn_buf);
-         // control with MsgLevel?
-         f0printf(fout, "Writing file: %s\n", actual_filename);
-         ddcrc = fopen_mkdir(actual_filename, "w+", ferr, &output_fp);
-         ASSERT_IFF(output_fp, ddcrc == 0);
-         if (ddcrc != 0) {
-            f0printf(ferr, "Unable to create '%s', %s\n", actual_filename, strerror(-ddcrc));
-         }
-      }
-      free_dumpload_data(data);
-
-      if (output_fp) {
-         int ct = strings->len;
-         int ndx;
-         for (ndx=0; ndx<ct; ndx++){
-            char * nextval = g_ptr_array_index(strings, ndx);
-            fprintf(output_fp, "%s\n", nextval);
-         }
-         fclose(output_fp);
+         f0printf(stderr, "Unable to open %s for writing: %s\n", filename, strerror(errno));
       }
       else {
-         ddcrc = -errno;
-         f0printf(ferr, "Unable to open %s for writing: %s\n", actual_filename, strerror(errno));
+         Json_Writer * jw = json_writer_new(output_fp);
+         json_dumpload_data(jw, dh->dref, data, ddcrc);
+         json_writer_free(jw);
+         if (filename)
+            fclose(output_fp);
       }
-
-      g_ptr_array_free(strings, true);
-      free(actual_filename);
+      if (data)
+         free_dumpload_data(data);
    }
+   else if (ddcrc == 0)
+      ddcrc = write_dumpload_data_file(data, dh->dref->pedid, filename, snapshot);
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
    return ddcrc;
 }
@@ -171,6 +247,9 @@ app_dumpvcp_as_file(Display_Handle * dh, const char * filename)
 //
 
 /** Reads a file into a newly allocated Dumpload_Data struct.
+ *
+ *  The file can contain either the text written by DUMPVCP or a
+ *  binary snapshot written by DUMPVCP --snapshot.
  *
  *  @param  fn  file name
  *  @return pointer to newly allocated #Dumpload_Data struct.
@@ -184,16 +263,26 @@ read_vcp_file(const char * fn)
    DBGMSF(debug, "Starting. fn=%s  ", fn );
 
    Dumpload_Data * data = NULL;
-   GPtrArray * g_line_array = g_ptr_array_sized_new(100);
-   g_ptr_array_set_free_func(g_line_array, g_free);
-   int rc = file_getlines(fn, g_line_array, false);
-   if (rc < 0) {
-      f0printf(ferr, "%s: %s\n", strerror(-rc), fn);
+   // parsed in place, without reading the file into an array of lines
+   GError * gerr = NULL;
+   GMappedFile * mapped = g_mapped_file_new(fn, false, &gerr);
+   if (!mapped) {
+      f0printf(ferr, "%s\n", gerr->message);
+      g_error_free(gerr);
    }
    else {
-      Error_Info * err = create_dumpload_data_from_g_ptr_array(g_line_array, &data);
+      const char * contents = g_mapped_file_get_contents(mapped);
+      gsize        length   = g_mapped_file_get_length(mapped);
+      Error_Info * err = NULL;
+      if (is_dumpload_snapshot((Byte *) contents, length))
+         err = create_dumpload_data_from_snapshot((Byte *) contents, length, &data);
+      else
+         err = create_dumpload_data_from_buffer(contents, length, '\n', &data);
       if (err) {
-         if (err->status_code == DDCRC_BAD_DATA) {
+         if (err->status_code == DDCRC_BAD_DATA && err->cause_ct == 0) {
+            f0printf(ferr, "Invalid data: %s\n", err->detail);
+         }
+         else if (err->status_code == DDCRC_BAD_DATA) {
             f0printf(ferr, "Invalid data:\n");
             for (int ndx = 0; ndx < err->cause_ct; ndx++) {
                f0printf(ferr, "   %s\n", err->causes[ndx]->detail);
@@ -207,7 +296,7 @@ read_vcp_file(const char * fn)
          }
       }
       errinfo_free(err);
-      g_ptr_array_free(g_line_array, true);
+      g_mapped_file_unref(mapped);
    }
 
    DBGMSF(debug, "Returning: %p  ", data );
@@ -261,6 +350,208 @@ app_loadvcp_by_file(const char * fn, Display_Handle * dh) {
 }
 
 
+//
+// Multiple displays
+//
+
+/** Work for one display of #app_loadvcp_by_files() or #app_dumpvcp_all_displays() */
+typedef struct {
+   Display_Ref *    dref;
+   GPtrArray *      load_data;   // Dumpload_Data * to apply, in command line order
+   Dumpload_Data *  dump_data;   // set by dump worker
+   Status_Errno_DDC ddcrc;
+} Dumpload_Worker_Rec;
+
+
+static gpointer
+loadvcp_worker(gpointer data)
+{
+   bool debug = false;
+   Dumpload_Worker_Rec * rec = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, file count=%d",
+                                       dref_repr_t(rec->dref), rec->load_data->len);
+
+   Display_Handle * dh = NULL;
+   rec->ddcrc = ddc_open_display(rec->dref, CALLOPT_WAIT|CALLOPT_ERR_MSG, &dh);
+   for (int ndx = 0; rec->ddcrc == 0 && ndx < rec->load_data->len; ndx++) {
+      Error_Info * ddc_excp = loadvcp_by_dumpload_data(g_ptr_array_index(rec->load_data, ndx), dh);
+      if (ddc_excp) {
+         rec->ddcrc = ddc_excp->status_code;
+         ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || report_freed_exceptions);
+      }
+   }
+   if (dh)
+      ddc_close_display(dh);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rec->ddcrc, "dref=%s", dref_repr_t(rec->dref));
+   return NULL;
+}
+
+
+static gpointer
+dumpvcp_worker(gpointer data)
+{
+   bool debug = false;
+   Dumpload_Worker_Rec * rec = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s", dref_repr_t(rec->dref));
+
+   Display_Handle * dh = NULL;
+   rec->ddcrc = ddc_open_display(rec->dref, CALLOPT_WAIT|CALLOPT_ERR_MSG, &dh);
+   if (rec->ddcrc == 0) {
+      rec->ddcrc = dumpvcp_as_dumpload_data(dh, &rec->dump_data);
+      ddc_close_display(dh);
+   }
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rec->ddcrc, "dref=%s", dref_repr_t(rec->dref));
+   return NULL;
+}
+
+
+/** Runs one worker thread per display and waits for all to finish.
+ *
+ *  @param  recs    array of #Dumpload_Worker_Rec
+ *  @param  func    thread function
+ */
+static void
+run_dumpload_workers(GPtrArray * recs, GThreadFunc func) {
+   GThread ** threads = calloc(recs->len, sizeof(GThread*));
+   for (int ndx = 0; ndx < recs->len; ndx++)
+      threads[ndx] = g_thread_new("dumpload_worker", func, g_ptr_array_index(recs, ndx));
+   for (int ndx = 0; ndx < recs->len; ndx++)
+      g_thread_join(threads[ndx]);
+   free(threads);
+}
+
+
+/** Applies the VCP settings stored in several files, each to the monitor
+ *  indicated in the file.
+ *
+ *  Files are matched to displays using the manufacturer id, model name and
+ *  serial number they contain.  The displays are loaded concurrently, one
+ *  thread per display.  Files for the same display are applied in order.
+ *
+ *  @param   fns    file names
+ *  @param   fn_ct  number of file names
+ *  @return  status code of the first failure, 0 if all succeeded
+ */
+Status_Errno_DDC
+app_loadvcp_by_files(char ** fns, int fn_ct) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn_ct=%d", fn_ct);
+   FILE * ferr = stderr;
+   Status_Errno_DDC ddcrc = 0;
+
+   GPtrArray * recs = g_ptr_array_new_with_free_func(free);
+   for (int ndx = 0; ndx < fn_ct; ndx++) {
+      Dumpload_Data * pdata = read_vcp_file(fns[ndx]);   // issues message if failure
+      if (!pdata) {
+         if (ddcrc == 0)
+            ddcrc = DDCRC_BAD_DATA;
+         continue;
+      }
+      Display_Identifier * did = create_mfg_model_sn_display_identifier(
+                                    pdata->mfg_id, pdata->model, pdata->serial_ascii);
+      Display_Ref * dref = get_display_ref_for_display_identifier(did, CALLOPT_NONE);
+      free_display_identifier(did);
+      if (!dref) {
+         f0printf(ferr, "Monitor not connected: %s - %s   \n", pdata->model, pdata->serial_ascii );
+         free_dumpload_data(pdata);
+         if (ddcrc == 0)
+            ddcrc = DDCRC_INVALID_DISPLAY;
+         continue;
+      }
+      Dumpload_Worker_Rec * rec = NULL;
+      for (int recndx = 0; recndx < recs->len && !rec; recndx++) {
+         Dumpload_Worker_Rec * cur = g_ptr_array_index(recs, recndx);
+         if (cur->dref == dref)
+            rec = cur;
+      }
+      if (!rec) {
+         rec = calloc(1, sizeof(Dumpload_Worker_Rec));
+         rec->dref = dref;
+         rec->load_data = g_ptr_array_new_with_free_func((GDestroyNotify) free_dumpload_data);
+         g_ptr_array_add(recs, rec);
+      }
+      g_ptr_array_add(rec->load_data, pdata);
+   }
+
+   run_dumpload_workers(recs, loadvcp_worker);
+
+   for (int ndx = 0; ndx < recs->len; ndx++) {
+      Dumpload_Worker_Rec * rec = g_ptr_array_index(recs, ndx);
+      if (rec->ddcrc != 0 && ddcrc == 0)
+         ddcrc = rec->ddcrc;
+      g_ptr_array_free(rec->load_data, true);
+   }
+   g_ptr_array_free(recs, true);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Executes the DUMPVCP command for all displays.
+ *
+ *  The settings of all valid displays are read concurrently, one thread
+ *  per display, and then written to generated file names in display
+ *  number order.
+ *
+ *  @param   json      write all data as a single JSON document on stdout
+ *  @param   snapshot  write binary snapshots, ignored if **json**
+ *  @return  status code of the first failure, 0 if all succeeded
+ */
+Status_Errno_DDC
+app_dumpvcp_all_displays(bool json, bool snapshot) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "json=%s, snapshot=%s", sbool(json), sbool(snapshot));
+   Status_Errno_DDC ddcrc = 0;
+
+   ddc_ensure_displays_detected();
+   GPtrArray * drefs = ddc_get_filtered_displays(false);
+   GPtrArray * recs = g_ptr_array_new_with_free_func(free);
+   for (int ndx = 0; ndx < drefs->len; ndx++) {
+      Dumpload_Worker_Rec * rec = calloc(1, sizeof(Dumpload_Worker_Rec));
+      rec->dref = g_ptr_array_index(drefs, ndx);
+      // MCCS vspec can affect whether a feature is NC or TABLE
+      app_check_dynamic_features(rec->dref);   // reports, so not in worker thread
+      g_ptr_array_add(recs, rec);
+   }
+   g_ptr_array_free(drefs, true);
+
+   run_dumpload_workers(recs, dumpvcp_worker);
+
+   // the display list is in display number order
+   Json_Writer * jw = NULL;
+   if (json) {
+      jw = json_writer_new(stdout);
+      json_begin_object(jw);
+      json_key(jw, "displays");
+      json_begin_array(jw);
+   }
+   for (int ndx = 0; ndx < recs->len; ndx++) {
+      Dumpload_Worker_Rec * rec = g_ptr_array_index(recs, ndx);
+      if (jw) {
+         json_dumpload_data(jw, rec->dref, rec->dump_data, rec->ddcrc);
+         if (rec->dump_data)
+            free_dumpload_data(rec->dump_data);
+      }
+      else if (rec->ddcrc == 0)
+         rec->ddcrc = write_dumpload_data_file(rec->dump_data, rec->dref->pedid, NULL, snapshot);
+      if (rec->ddcrc != 0 && ddcrc == 0)
+         ddcrc = rec->ddcrc;
+   }
+   if (jw) {
+      json_end_array(jw);
+      json_end_object(jw);
+      json_writer_free(jw);
+   }
+   g_ptr_array_free(recs, true);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
 #ifdef UNUSED
 bool app_loadvcp(const char * fn, Display_Identifier * pdid) {
    bool debug = false;
@@ -298,5 +589,9 @@ bool app_loadvcp(const char * fn, Display_Identifier * pdid) {
 void init_app_dumpload() {
    RTTI_ADD_FUNC(app_dumpvcp_as_file);
    RTTI_ADD_FUNC(app_loadvcp_by_file);
+   RTTI_ADD_FUNC(loadvcp_worker);
+   RTTI_ADD_FUNC(dumpvcp_worker);
+   RTTI_ADD_FUNC(app_loadvcp_by_files);
+   RTTI_ADD_FUNC(app_dumpvcp_all_displays);
 }
 
@@ -16,7 +16,13 @@ Status_Errno_DDC
 app_loadvcp_by_file(const char * fn, Display_Handle * dh);
 
 Status_Errno_DDC
-app_dumpvcp_as_file(Display_Handle * dh, const char * optional_filename);
+app_dumpvcp_as_file(Display_Handle * dh, const char * optional_filename, bool json, bool snapshot);
+
+Status_Errno_DDC
+app_loadvcp_by_files(char ** fns, int fn_ct);
+
+Status_Errno_DDC
+app_dumpvcp_all_displays(bool json, bool snapshot);
 
 void
 init_app_dumpload();
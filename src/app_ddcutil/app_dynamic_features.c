@@ -20,6 +20,7 @@
 #include "base/monitor_model_key.h"
 #include "base/rtti.h"
 
+#include "dynvcp/dyn_feature_codes.h"
 #include "dynvcp/dyn_feature_files.h"
 
 #include "app_dynamic_features.h"
@@ -102,6 +103,7 @@ void check_dynamic_features_old(Display_Ref * dref) {
             f0printf(fout(), "Processed feature definition file: %s\n", dfr->filename);
          dref->dfr = dfr;
       }
+      dyn_invalidate_cached_feature_metadata(dref);
 
       dref->flags |= DREF_DYNAMIC_FEATURES_CHECKED;
    }
@@ -11,10 +11,13 @@
 /** \cond */
 #include <assert.h>
 #include <errno.h>
+#include <glib-2.0/glib.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "util/data_structures.h"
 #include "util/error_info.h"
+#include "util/json_writer.h"
 #include "util/string_util.h"
 #include "util/report_util.h"
 
@@ -34,9 +37,14 @@
 
 #include "dynvcp/dyn_feature_codes.h"
 
+#include "ddc/ddc_display_ref_reports.h"
+#include "ddc/ddc_displays.h"
 #include "ddc/ddc_output.h"
+#include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_vcp_version.h"
 
+#include "app_ddcutil/app_dynamic_features.h"
+
 
 // Default trace class for this file
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
@@ -123,7 +131,7 @@ app_show_single_vcp_value_by_feature_id(
                               feature_id, dh_repr(dh), sbool(force) );
 
    Status_Errno_DDC         psc = 0;
-   Display_Feature_Metadata * dfm = dyn_get_feature_metadata_by_dh(
+   Display_Feature_Metadata * dfm = dyn_get_cached_feature_metadata_by_dh(
                                        feature_id,
                                        dh,
                                        force || feature_id >= 0xe0);  // with_default
@@ -133,7 +141,6 @@ app_show_single_vcp_value_by_feature_id(
    }
    else {
       psc = app_show_single_vcp_value_by_dfm(dh, dfm);
-      dfm_free(dfm);
    }
 
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, psc, "");
@@ -163,7 +170,7 @@ app_show_vcp_subset_values_by_dh(
           features_seen );
 
    GPtrArray * collector = NULL;
-   Status_Errno_DDC psc = ddc_show_vcp_values(dh, subset_id, collector, flags, features_seen);
+   Status_Errno_DDC psc = ddc_show_vcp_values(dh, subset_id, collector, flags, features_seen, NULL);
 
    if (features_seen)
       DBGTRC_RET_DDCRC(debug, TRACE_GROUP, psc, "features_seen=%s",
@@ -174,6 +181,58 @@ app_show_vcp_subset_values_by_dh(
 }
 
 
+/** Writes the VCP values for all features indicated by a #Feature_Set_Ref
+ *  as a JSON object containing the display and an array of feature values.
+ *
+ *  @param  dh      display handle
+ *  @param  fsref   feature set reference
+ *  @param  flags   feature set flags
+ *  @return status code
+ */
+static Status_Errno_DDC
+json_feature_set_values_by_dh(
+      Display_Handle *     dh,
+      Feature_Set_Ref *    fsref,
+      Feature_Set_Flags    flags)
+{
+   Status_Errno_DDC psc = 0;
+   Json_Writer * jw = json_writer_new(fout());
+   json_begin_object(jw);
+   json_key(jw, "display");
+   ddc_json_display_ref(jw, dh->dref);
+   json_key(jw, "features");
+   json_begin_array(jw);
+   if (fsref->subset == VCP_SUBSET_SINGLE_FEATURE ||
+       fsref->subset == VCP_SUBSET_MULTI_FEATURES)
+   {
+      Bit_Set_256_Iterator iter = bs256_iter_new(fsref->features);
+      for (int bitno = bs256_iter_next(iter); bitno >= 0; bitno = bs256_iter_next(iter)) {
+         Display_Feature_Metadata * dfm = dyn_get_cached_feature_metadata_by_dh(bitno, dh, true);
+         int rc = DDCRC_UNKNOWN_FEATURE;
+         if (dfm) {
+            rc = ddc_json_value_for_dfm(dh, dfm, false, jw);
+         }
+         else {
+            json_begin_object(jw);
+            json_key_int(jw, "feature_code", bitno);
+            json_key_string(jw, "status", psc_name(rc));
+            json_end_object(jw);
+         }
+         if (rc < 0)
+            psc = rc;
+      }
+      bs256_iter_free(iter);
+   }
+   else {
+      psc = ddc_show_vcp_values(dh, fsref->subset, NULL, flags, NULL, jw);
+   }
+   json_end_array(jw);
+   json_end_object(jw);
+   json_writer_free(jw);
+   return psc;
+}
+
+
 /**  Shows the VCP values for all features indicated by a #Feature_Set_Ref
  *
  *   @param  dh      display handle
@@ -209,6 +268,8 @@ app_show_feature_set_values_by_dh(
       flags |= FSF_RW_ONLY;
    if (parsed_cmd->flags & CMD_FLAG_RO_ONLY)
       flags |= FSF_RO_ONLY;
+   if (parsed_cmd->flags & CMD_FLAG_CAPS_ONLY)
+      flags |= FSF_CAPS_ONLY;
    // this is nonsense, getvcp on a WO feature should be caught by parser
    if (parsed_cmd->flags & CMD_FLAG_WO_ONLY) {
       // flags |= FSF_WO_ONLY;
@@ -227,8 +288,11 @@ app_show_feature_set_values_by_dh(
    }
    else if (fsref->subset == VCP_SUBSET_MULTI_FEATURES) {
 #endif
-   if (fsref->subset == VCP_SUBSET_SINGLE_FEATURE ||
-       fsref->subset == VCP_SUBSET_MULTI_FEATURES)
+   if (parsed_cmd->flags & CMD_FLAG_JSON) {
+      psc = json_feature_set_values_by_dh(dh, fsref, flags);
+   }
+   else if (fsref->subset == VCP_SUBSET_SINGLE_FEATURE ||
+            fsref->subset == VCP_SUBSET_MULTI_FEATURES)
    {
       int feature_ct = bs256_count(fsref->features);
       DBGMSF(debug, "VCP_SUBSET_MULTI_FEATURES, feature_ct=%d", feature_ct);
@@ -258,8 +322,142 @@ app_show_feature_set_values_by_dh(
 }
 
 
+/** GETVCP for one display of #app_show_feature_set_values_all_displays() */
+typedef struct {
+   Display_Ref *     dref;
+   Parsed_Cmd *      parsed_cmd;
+   DDCA_Output_Level output_level;    // of the calling thread
+   char *            output;          // what the worker wrote to fout()
+   size_t            output_size;
+   char *            errors;          // what the worker wrote to ferr()
+   size_t            errors_size;
+   Status_Errno_DDC  psc;
+} Getvcp_Worker_Rec;
+
+
+static gpointer
+getvcp_worker(gpointer data)
+{
+   bool debug = false;
+   Getvcp_Worker_Rec * rec = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s", dref_repr_t(rec->dref));
+
+   // output is collected, so that it can be written in display number order
+   FILE * outf = open_memstream(&rec->output, &rec->output_size);
+   FILE * errf = open_memstream(&rec->errors, &rec->errors_size);
+   set_fout(outf);
+   set_ferr(errf);
+   set_output_level(rec->output_level);
+
+   Display_Handle * dh = NULL;
+   rec->psc = ddc_open_display(rec->dref, CALLOPT_WAIT|CALLOPT_ERR_MSG, &dh);
+   if (rec->psc == 0) {
+      get_vcp_version_by_dh(dh);     // while the display is open
+      rec->psc = app_show_feature_set_values_by_dh(dh, rec->parsed_cmd);
+      ddc_close_display(dh);
+   }
+
+   set_fout_to_default();
+   set_ferr_to_default();
+   fclose(outf);
+   fclose(errf);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rec->psc, "dref=%s", dref_repr_t(rec->dref));
+   return NULL;
+}
+
+
+/** Implements the GETVCP command with option --all.
+ *
+ *  Displays are detected once, and the requested features of all valid
+ *  displays are read concurrently, one thread per display.  Displays on the
+ *  same physical adapter are still subject to the adapter concurrency limit.
+ *  Once all threads have finished, the output for each display is written
+ *  in display number order.
+ *
+ *  @param  parsed_cmd  parsed command line
+ *  @return 0 if the features of every display were read,
+ *          otherwise the status code of the first display that failed
+ */
+Status_Errno_DDC
+app_show_feature_set_values_all_displays(Parsed_Cmd * parsed_cmd)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+   bool json = parsed_cmd->flags & CMD_FLAG_JSON;
+   Status_Errno_DDC ddcrc = 0;
+
+   ddc_ensure_displays_detected();
+   GPtrArray * drefs = ddc_get_filtered_displays(false);
+   int rec_ct = drefs->len;
+   Getvcp_Worker_Rec * recs = calloc(rec_ct, sizeof(Getvcp_Worker_Rec));
+   GThread ** threads = calloc(rec_ct, sizeof(GThread*));
+   for (int ndx = 0; ndx < rec_ct; ndx++) {
+      Getvcp_Worker_Rec * rec = &recs[ndx];
+      rec->dref = g_ptr_array_index(drefs, ndx);
+      rec->parsed_cmd = parsed_cmd;
+      rec->output_level = get_output_level();
+      app_check_dynamic_features(rec->dref);   // reports, so not in worker thread
+      threads[ndx] = g_thread_new("getvcp_worker", getvcp_worker, rec);
+   }
+   for (int ndx = 0; ndx < rec_ct; ndx++)
+      g_thread_join(threads[ndx]);
+   free(threads);
+   g_ptr_array_free(drefs, true);
+
+   // ddc_get_filtered_displays() returns the displays in display number order
+   Json_Writer * jw = NULL;
+   if (json) {
+      jw = json_writer_new(fout());
+      json_begin_object(jw);
+      json_key(jw, "displays");
+      json_begin_array(jw);
+   }
+   else if (rec_ct == 0) {
+      f0printf(fout(), "No displays found\n");
+   }
+   for (int ndx = 0; ndx < rec_ct; ndx++) {
+      Getvcp_Worker_Rec * rec = &recs[ndx];
+      if (json) {
+         if (rec->output_size > 0) {
+            json_raw(jw, rec->output);
+         }
+         else {
+            json_begin_object(jw);
+            json_key(jw, "display");
+            ddc_json_display_ref(jw, rec->dref);
+            json_key_string(jw, "status", psc_name(rec->psc));
+            json_end_object(jw);
+         }
+      }
+      else {
+         if (ndx > 0)
+            f0printf(fout(), "\n");
+         f0printf(fout(), "Display %d\n", rec->dref->dispno);
+         fputs(rec->output, fout());
+      }
+      fputs(rec->errors, ferr());
+      free(rec->output);
+      free(rec->errors);
+      if (rec->psc != 0 && ddcrc == 0)
+         ddcrc = rec->psc;
+   }
+   if (json) {
+      json_end_array(jw);
+      json_end_object(jw);
+      json_writer_free(jw);
+   }
+   free(recs);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "rec_ct=%d", rec_ct);
+   return ddcrc;
+}
+
+
 void init_app_getvcp() {
    RTTI_ADD_FUNC(app_show_feature_set_values_by_dh);
+   RTTI_ADD_FUNC(getvcp_worker);
+   RTTI_ADD_FUNC(app_show_feature_set_values_all_displays);
    RTTI_ADD_FUNC(app_show_vcp_subset_values_by_dh);
    RTTI_ADD_FUNC(app_show_single_vcp_value_by_feature_id);
    RTTI_ADD_FUNC(app_show_single_vcp_value_by_dfm);
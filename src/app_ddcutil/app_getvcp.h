@@ -38,6 +38,10 @@ app_show_feature_set_values_by_dh(
       Display_Handle *      dh,
       Parsed_Cmd *          parsed_cmd);
 
+Status_Errno_DDC
+app_show_feature_set_values_all_displays(
+      Parsed_Cmd *          parsed_cmd);
+
 void
 init_app_getvcp();
 
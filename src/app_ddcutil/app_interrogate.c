@@ -100,7 +100,7 @@ void app_interrogate(Parsed_Cmd * parsed_cmd)
       }
       else {
          f0printf(fout(), "\nProbing display %d\n", dref->dispno);
-         app_probe_display_by_dref(dref);
+         app_probe_display_by_dref(dref, false);
          f0printf(fout(), "\nStatistics for probe of display %d:\n", dref->dispno);
          ddc_report_stats_main(DDCA_STATS_ALL, parsed_cmd->flags & CMD_FLAG_PER_THREAD_STATS, 0);
       }
@@ -14,6 +14,7 @@
 #include "base/rtti.h"
 
 #include "vcp/parse_capabilities.h"
+#include "vcp/persistent_capabilities.h"
 
 #include "ddc/ddc_displays.h"
 #include "ddc/ddc_output.h"
@@ -36,13 +37,25 @@ static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
 /** Probe a display specified by its #Display_Handle.
  *  Output is written to stdout.
  *
- *  @param dh display handle
+ *  @param dh       display handle
+ *  @param express  avoid DDC exchanges whose result is already known
+ *
+ *  @remark
+ *  In express mode:
+ *  - the capabilities string is taken from the capabilities cache if
+ *    present, and saved there, even if the cache is disabled
+ *  - table features are not scanned if the capabilities string does not
+ *    declare the Table Read commands
+ *  - features x0b and x0c are not read again if the scan did not find them
+ *
+ *  The report has the same format.  All steps use the same display, so
+ *  they are still performed in sequence.
  */
-void app_probe_display_by_dh(Display_Handle * dh)
+void app_probe_display_by_dh(Display_Handle * dh, bool express)
 {
    FILE * fout = stdout;
    bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, express=%s", dh_repr(dh), sbool(express));
 
    Error_Info * ddc_excp = NULL;
    Parsed_Edid * pedid = dh->dref->pedid;
@@ -74,14 +87,19 @@ void app_probe_display_by_dh(Display_Handle * dh)
    DDCA_Output_Level saved_ol = set_output_level(DDCA_OL_VERBOSE);   // affects this thread only
    char * capabilities_string = NULL;
    Parsed_Capabilities * pcaps = NULL;
+   bool table_reads_possible = true;
+   bool saved_cache_enabled = false;
+   if (express)
+      saved_cache_enabled = enable_capabilities_cache(true);
    DDCA_Status ddcrc = app_get_capabilities_string(dh, &capabilities_string);
+   if (express)
+      enable_capabilities_cache(saved_cache_enabled);
    if (ddcrc == 0) {
       // pcaps is always set, but may be damaged if there was a parsing error
       pcaps = parse_capabilities_string(capabilities_string);
       app_show_parsed_capabilities(dh, pcaps);
 
-      // how to pass this information down into app_show_vcp_subset_values_by_dh()?
-      bool table_reads_possible = parsed_capabilities_supports_table_commands(pcaps);
+      table_reads_possible = parsed_capabilities_supports_table_commands(pcaps);
       f0printf(fout, "\nMay support table reads:   %s\n", sbool(table_reads_possible));
    }
    set_output_level(saved_ol);
@@ -90,8 +108,11 @@ void app_probe_display_by_dh(Display_Handle * dh)
    // printf("\n\nScanning all VCP feature codes for display %d\n", dispno);
    f0printf(fout, "\nScanning all VCP feature codes for display %s\n", dh_repr(dh) );
    Bit_Set_256 features_seen = EMPTY_BIT_SET_256;
+   Feature_Set_Flags scan_flags = FSF_SHOW_UNSUPPORTED;
+   if (express && pcaps && !table_reads_possible)
+      scan_flags |= FSF_NOTABLE;
    app_show_vcp_subset_values_by_dh(
-         dh, VCP_SUBSET_SCAN, FSF_SHOW_UNSUPPORTED, &features_seen);
+         dh, VCP_SUBSET_SCAN, scan_flags, &features_seen);
 
    if (pcaps) {
       f0printf(fout, "\n\nComparing declared capabilities to observed features...\n");
@@ -180,33 +201,38 @@ void app_probe_display_by_dh(Display_Handle * dh)
    DDCA_Any_Vcp_Value * valrec;
    int color_temp_increment = 0;
    int color_temp_units = 0;
-   // get VCP 0B - color temperature increment
-   ddc_excp = ddc_get_vcp_value(dh,0x0b, DDCA_NON_TABLE_VCP_VALUE, &valrec);
-   if (!ddc_excp) {
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Value returned for feature x0b: %s",
-                                          summarize_single_vcp_value(valrec) );
-      color_temp_increment = valrec->val.c_nc.sl;
-      free_single_vcp_value(valrec);
-
-      // get x0c - color temperature request
-      ddc_excp = ddc_get_vcp_value(dh, 0x0c, DDCA_NON_TABLE_VCP_VALUE, &valrec);
+   if (express && !(bs256_contains(features_seen, 0x0b) && bs256_contains(features_seen, 0x0c))) {
+      f0printf(fout, "Unable to calculate color temperature from VCP features x0B and x0C\n");
+   }
+   else {
+      // get VCP 0B - color temperature increment
+      ddc_excp = ddc_get_vcp_value(dh,0x0b, DDCA_NON_TABLE_VCP_VALUE, &valrec);
       if (!ddc_excp) {
-         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Value returned for feature x0c: %s",
-                                              summarize_single_vcp_value(valrec) );
-         color_temp_units = valrec->val.c_nc.sl;
-         int color_temp = 3000 + color_temp_units * color_temp_increment;
-         f0printf(fout, "Color temperature increment (x0b) = %d degrees Kelvin\n", color_temp_increment);
-         f0printf(fout, "Color temperature request   (x0c) = %d\n", color_temp_units);
-         f0printf(fout, "Requested color temperature = (3000 deg Kelvin) + %d * (%d degrees Kelvin)"
-               " = %d degrees Kelvin\n",
-               color_temp_units,
-               color_temp_increment,
-               color_temp);
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Value returned for feature x0b: %s",
+                                             summarize_single_vcp_value(valrec) );
+         color_temp_increment = valrec->val.c_nc.sl;
+         free_single_vcp_value(valrec);
+
+         // get x0c - color temperature request
+         ddc_excp = ddc_get_vcp_value(dh, 0x0c, DDCA_NON_TABLE_VCP_VALUE, &valrec);
+         if (!ddc_excp) {
+            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Value returned for feature x0c: %s",
+                                                 summarize_single_vcp_value(valrec) );
+            color_temp_units = valrec->val.c_nc.sl;
+            int color_temp = 3000 + color_temp_units * color_temp_increment;
+            f0printf(fout, "Color temperature increment (x0b) = %d degrees Kelvin\n", color_temp_increment);
+            f0printf(fout, "Color temperature request   (x0c) = %d\n", color_temp_units);
+            f0printf(fout, "Requested color temperature = (3000 deg Kelvin) + %d * (%d degrees Kelvin)"
+                  " = %d degrees Kelvin\n",
+                  color_temp_units,
+                  color_temp_increment,
+                  color_temp);
+         }
+      }
+      if (ddc_excp) {
+         f0printf(fout, "Unable to calculate color temperature from VCP features x0B and x0C\n");
+         ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || report_freed_exceptions);
       }
-   }
-   if (ddc_excp) {
-      f0printf(fout, "Unable to calculate color temperature from VCP features x0B and x0C\n");
-      ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || report_freed_exceptions);
    }
 
    app_show_single_vcp_value_by_feature_id(dh, 0x14, true);
@@ -218,9 +244,10 @@ void app_probe_display_by_dh(Display_Handle * dh)
 /** Probe a display specified by a #Display_Ref.
  *  Output is written to stdout.
  *
- *  @param dref display reference
+ *  @param dref     display reference
+ *  @param express  see #app_probe_display_by_dh()
  */
-void app_probe_display_by_dref(Display_Ref * dref) {
+void app_probe_display_by_dref(Display_Ref * dref, bool express) {
    FILE * fout = stdout;
    Display_Handle * dh = NULL;
    Public_Status_Code psc = ddc_open_display(dref, CALLOPT_ERR_MSG, &dh);
@@ -229,7 +256,7 @@ void app_probe_display_by_dref(Display_Ref * dref) {
                      dref_short_name_t(dref), psc_desc(psc) );
    }
    else {
-      app_probe_display_by_dh(dh);
+      app_probe_display_by_dh(dh, express);
       ddc_close_display(dh);
    }
 }
@@ -10,8 +10,8 @@
 
 #include "base/displays.h"
 
-void app_probe_display_by_dref(Display_Ref * dref);
-void app_probe_display_by_dh(Display_Handle * dh);
+void app_probe_display_by_dref(Display_Ref * dref, bool express);
+void app_probe_display_by_dh(Display_Handle * dh, bool express);
 void init_app_probe();
 
 #endif /* APP_PROBE_H_ */
@@ -0,0 +1,202 @@
+/** @file app_sample.c
+ *
+ *  Implement the SAMPLE command, which reads features of one or all displays
+ *  at fixed intervals and writes a timestamped row for each value read,
+ *  as CSV or in InfluxDB line protocol.
+ *
+ *  The schedule does not drift: a display whose previous reads have not
+ *  completed when the next round is due skips the round, which is reported
+ *  in the missed column of its next row, see ddc_feature_sampler.c.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "public/ddcutil_types.h"
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/status_code_mgt.h"
+
+#include "ddc/ddc_feature_sampler.h"
+
+#include "app_ddcutil/app_sample.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+typedef struct {
+   GPtrArray *          drefs;
+   Sample_Output_Format format;
+   FILE *               fout;
+} Sample_Output;
+
+
+static void
+sample_signal_handler(int signum) {
+   ddc_stop_feature_sampling();
+}
+
+
+// Appends a line protocol tag value, escaping commas, spaces, and equal signs
+static void
+append_lp_tag(GString * line, const char * name, const char * value) {
+   g_string_append_printf(line, ",%s=", name);
+   for (const char * p = value; *p; p++) {
+      if (*p == ',' || *p == ' ' || *p == '=')
+         g_string_append_c(line, '\\');
+      g_string_append_c(line, *p);
+   }
+}
+
+
+// Appends a CSV field, quoting it if necessary
+static void
+append_csv_field(GString * line, const char * value) {
+   if (strpbrk(value, ",\"\n")) {
+      g_string_append_c(line, '"');
+      for (const char * p = value; *p; p++) {
+         if (*p == '"')
+            g_string_append_c(line, '"');
+         g_string_append_c(line, *p);
+      }
+      g_string_append_c(line, '"');
+   }
+   else
+      g_string_append(line, value);
+}
+
+
+static void
+write_sample(DDCA_Feature_Sample * sample, void * arg) {
+   Sample_Output * output = arg;
+   Display_Ref * dref = g_ptr_array_index(output->drefs, sample->display_ndx);
+   const char * display = dpath_short_name_t(&dref->io_path);
+   const char * model = (dref->pedid) ? dref->pedid->model_name : "";
+   uint16_t value = sample->value.sh << 8 | sample->value.sl;
+   uint16_t max   = sample->value.mh << 8 | sample->value.ml;
+   double latency_millis = sample->latency_nanos / 1000000.0;
+   char feature[8];
+   g_snprintf(feature, sizeof(feature), "0x%02x", sample->feature_code);
+
+   GString * line = g_string_sized_new(120);
+   if (output->format == SAMPLE_FORMAT_LINE_PROTOCOL) {
+      g_string_append(line, "ddcutil_feature");
+      append_lp_tag(line, "display", display);
+      if (*model)
+         append_lp_tag(line, "model", model);
+      append_lp_tag(line, "feature", feature);
+      g_string_append_printf(line, " status=%di,latency_ms=%.3f,missed=%di",
+                                   sample->status, latency_millis, sample->missed_ct);
+      if (sample->status == 0)
+         g_string_append_printf(line, ",value=%ui,max=%ui", value, max);
+      g_string_append_printf(line, " %"PRIu64, sample->scheduled_nanos);
+   }
+   else {
+      g_string_append_printf(line, "%"PRIu64".%03d,",
+                                   sample->scheduled_nanos / 1000000000,
+                                   (int) (sample->scheduled_nanos / 1000000 % 1000));
+      append_csv_field(line, display);
+      g_string_append_c(line, ',');
+      append_csv_field(line, model);
+      g_string_append_printf(line, ",%s,", feature);
+      if (sample->status == 0)
+         g_string_append_printf(line, "%u,%u", value, max);
+      else
+         g_string_append_c(line, ',');
+      g_string_append_printf(line, ",%s,%.3f,%d",
+                                   (sample->status == 0) ? "" : psc_name(sample->status),
+                                   latency_millis, sample->missed_ct);
+   }
+   fprintf(output->fout, "%s\n", line->str);
+   fflush(output->fout);
+   g_string_free(line, true);
+}
+
+
+/** Executes the SAMPLE command.
+ *
+ *  Command arguments are the interval in milliseconds, the number of rounds
+ *  (0 to continue until interrupted), and one or more feature codes.
+ *
+ *  @param  parsed_cmd  parsed command line
+ *  @param  drefs       displays to sample
+ *  @return true if successful, false if invalid arguments or error
+ */
+bool
+app_sample(Parsed_Cmd * parsed_cmd, GPtrArray * drefs) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "display count=%d", drefs->len);
+
+   bool ok = true;
+   int interval_millisec = 0;
+   int round_ct = 0;
+   if (!str_to_int(parsed_cmd->args[0], &interval_millisec, 10) || interval_millisec <= 0) {
+      f0printf(ferr(), "Invalid interval: %s\n", parsed_cmd->args[0]);
+      ok = false;
+   }
+   if (!str_to_int(parsed_cmd->args[1], &round_ct, 10) || round_ct < 0) {
+      f0printf(ferr(), "Invalid sample count: %s\n", parsed_cmd->args[1]);
+      ok = false;
+   }
+   int feature_ct = parsed_cmd->argct - 2;
+   DDCA_Vcp_Feature_Code * feature_codes = calloc(feature_ct, sizeof(DDCA_Vcp_Feature_Code));
+   for (int ndx = 0; ndx < feature_ct; ndx++) {
+      Byte feature_code;
+      if (!any_one_byte_hex_string_to_byte_in_buf(parsed_cmd->args[ndx+2], &feature_code)) {
+         f0printf(ferr(), "Invalid feature code: %s\n", parsed_cmd->args[ndx+2]);
+         ok = false;
+      }
+      feature_codes[ndx] = feature_code;
+   }
+   if (drefs->len == 0) {
+      f0printf(ferr(), "No displays to sample\n");
+      ok = false;
+   }
+
+   if (ok) {
+      Sample_Output output = {drefs, parsed_cmd->sample_format, stdout};
+      if (output.format == SAMPLE_FORMAT_CSV)
+         fprintf(output.fout, "timestamp,display,model,feature,value,max,status,latency_ms,missed\n");
+
+      struct sigaction sa, old_sigint, old_sigterm;
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = sample_signal_handler;
+      sigaction(SIGINT,  &sa, &old_sigint);
+      sigaction(SIGTERM, &sa, &old_sigterm);
+
+      int missed_ct = 0;
+      DDCA_Status ddcrc = ddc_sample_features(
+            (Display_Ref **) drefs->pdata, drefs->len,
+            feature_codes, feature_ct, interval_millisec, round_ct,
+            CALLOPT_ERR_MSG, write_sample, &output, &missed_ct);
+
+      sigaction(SIGINT,  &old_sigint,  NULL);
+      sigaction(SIGTERM, &old_sigterm, NULL);
+      if (ddcrc != 0) {
+         f0printf(ferr(), "Sampling failed: %s\n", psc_desc(ddcrc));
+         ok = false;
+      }
+      else if (missed_ct > 0) {
+         f0printf(ferr(), "%d deadlines missed, use a longer interval or fewer features\n", missed_ct);
+      }
+   }
+   free(feature_codes);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s", sbool(ok));
+   return ok;
+}
@@ -0,0 +1,20 @@
+/** @file app_sample.h
+ *
+ *  Implement the SAMPLE command
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_SAMPLE_H_
+#define APP_SAMPLE_H_
+
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+
+#include "cmdline/parsed_cmd.h"
+
+bool
+app_sample(Parsed_Cmd * parsed_cmd, GPtrArray * drefs);
+
+#endif /* APP_SAMPLE_H_ */
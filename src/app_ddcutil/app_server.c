@@ -0,0 +1,695 @@
+/** @file app_server.c
+ *
+ *  Implement the SERVE command, which runs **ddcutil** as a long lived
+ *  server, and the client side of option --use-server.
+ *
+ *  The server detects displays once, and then executes getvcp, setvcp,
+ *  and capabilities requests received over a Unix domain socket.  Display
+ *  detection, the capabilities and VCP value caches, and the dynamic sleep
+ *  data are shared by all requests, so a request does not pay for them.
+ *  Each client connection is serviced by its own thread.  Requests for
+ *  the same display are serialized by the display lock acquired by
+ *  ddc_open_display(), and their DDC transactions are ordered by the I/O
+ *  scheduler.
+ *
+ *  The server also publishes the values of commonly watched features, e.g.
+ *  brightness and input source, in shared memory (see ddc_published_state.c),
+ *  so that any number of processes can read them without DDC traffic.  A
+ *  poll thread checks feature x02 (New Control Value) of each display, and
+ *  rereads the features when it reports a change, and periodically regardless.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "util/data_structures.h"
+#include "util/error_info.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+/** \endcond */
+
+#include "base/core.h"
+#include "base/ddc_errno.h"
+#include "base/displays.h"
+#include "base/feature_set_ref.h"
+#include "base/rtti.h"
+
+#include "cmdline/parsed_cmd.h"
+
+#include "vcp/parse_capabilities.h"
+#include "vcp/vcp_feature_codes.h"
+
+#include "dynvcp/dyn_feature_codes.h"
+#include "dynvcp/dyn_parsed_capabilities.h"
+
+#include "ddc/ddc_display_selection.h"
+#include "ddc/ddc_displays.h"
+#include "ddc/ddc_io_scheduler.h"
+#include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_published_state.h"
+#include "ddc/ddc_read_capabilities.h"
+#include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_value_cache.h"
+
+#include "app_ddcutil/app_server.h"
+#include "app_ddcutil/app_setvcp.h"
+
+
+// Default trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+static volatile sig_atomic_t terminate_server = false;
+
+// Features whose values the server publishes without being asked
+static DDCA_Vcp_Feature_Code polled_features[] = {
+      0x10,       // Brightness
+      0x12,       // Contrast
+      0x60,       // Input Source
+      0xd6,       // Power Mode
+};
+static const int polled_feature_ct = sizeof(polled_features)/sizeof(DDCA_Vcp_Feature_Code);
+
+static GMutex poll_mutex;
+static GCond  poll_cond;            // signaled when the server terminates
+static bool   poll_shutdown = false;
+
+
+/** Returns the default location of the server socket,
+ *  $XDG_RUNTIME_DIR/ddcutil-server.sock if XDG_RUNTIME_DIR is set,
+ *  otherwise /tmp/ddcutil-server-<uid>.sock
+ *
+ *  @return socket path, caller is responsible for freeing
+ */
+char *
+app_server_default_socket_path() {
+   char * runtime_dir = getenv("XDG_RUNTIME_DIR");
+   if (runtime_dir && strlen(runtime_dir) > 0)
+      return g_strdup_printf("%s/ddcutil-server.sock", runtime_dir);
+   return g_strdup_printf("/tmp/ddcutil-server-%d.sock", getuid());
+}
+
+
+static char *
+socket_path(Parsed_Cmd * parsed_cmd) {
+   return (parsed_cmd->server_socket_fn)
+            ? g_strdup(parsed_cmd->server_socket_fn)
+            : app_server_default_socket_path();
+}
+
+
+static bool
+set_socket_address(const char * path, struct sockaddr_un * addr) {
+   memset(addr, 0, sizeof(*addr));
+   addr->sun_family = AF_UNIX;
+   if (strlen(path) >= sizeof(addr->sun_path)) {
+      f0printf(ferr(), "Socket path too long: %s\n", path);
+      return false;
+   }
+   strcpy(addr->sun_path, path);
+   return true;
+}
+
+
+/** Reads exactly len bytes, returns false on error or end of file */
+static bool
+read_fully(int fd, void * buf, size_t len) {
+   char * p = buf;
+   while (len > 0) {
+      ssize_t ct = read(fd, p, len);
+      if (ct < 0 && errno == EINTR)
+         continue;
+      if (ct <= 0)
+         return false;
+      p   += ct;
+      len -= ct;
+   }
+   return true;
+}
+
+
+/** Writes exactly len bytes, returns false on error */
+static bool
+write_fully(int fd, const void * buf, size_t len) {
+   const char * p = buf;
+   while (len > 0) {
+      ssize_t ct = write(fd, p, len);
+      if (ct < 0 && errno == EINTR)
+         continue;
+      if (ct < 0)
+         return false;
+      p   += ct;
+      len -= ct;
+   }
+   return true;
+}
+
+
+//
+// Server
+//
+
+static Display_Ref *
+find_requested_display(Server_Request * request) {
+   Display_Identifier * pdid = (request->display_id_type == SERVER_DISPLAY_BUSNO)
+                                  ? create_busno_display_identifier(request->display_id)
+                                  : create_dispno_display_identifier(request->display_id);
+   Display_Ref * dref = get_display_ref_for_display_identifier(pdid, CALLOPT_NONE);
+   free_display_identifier(pdid);
+   return dref;
+}
+
+
+/** Executes a single request.
+ *
+ *  @param  request       request received
+ *  @param  response      response to fill in
+ *  @param  data_loc      where to return data to follow the response,
+ *                        caller is responsible for freeing
+ */
+static void
+execute_server_request(
+      Server_Request *  request,
+      Server_Response * response,
+      char **           data_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "op=%d, display_id_type=%d, display_id=%d, feature_code=0x%02x",
+                   request->op, request->display_id_type, request->display_id, request->feature_code);
+
+   *data_loc = NULL;
+   Display_Handle * dh = NULL;
+   Display_Ref * dref = find_requested_display(request);
+   int status = (dref) ? ddc_open_display(dref, CALLOPT_WAIT, &dh) : DDCRC_INVALID_DISPLAY;
+   if (status == 0) {
+      Error_Info * ddc_excp = NULL;
+      switch(request->op) {
+      case SERVER_OP_GETVCP:
+      {
+         Parsed_Nontable_Vcp_Response * parsed_response = NULL;
+         ddc_excp = ddc_get_nontable_vcp_value_cached(dh, request->feature_code, &parsed_response);
+         if (!ddc_excp) {
+            response->mh = parsed_response->mh;
+            response->ml = parsed_response->ml;
+            response->sh = parsed_response->sh;
+            response->sl = parsed_response->sl;
+         }
+         free(parsed_response);
+         break;
+      }
+      case SERVER_OP_SETVCP:
+         ddc_excp = ddc_set_nontable_vcp_value(dh, request->feature_code, request->value);
+         break;
+      case SERVER_OP_SETVCP_PLUS:
+      case SERVER_OP_SETVCP_MINUS:
+      {
+         // the current value usually comes from the value cache
+         Display_Feature_Metadata * dfm =
+               dyn_get_cached_feature_metadata_by_dh(request->feature_code, dh, false);
+         if (!dfm || !(dfm->feature_flags & DDCA_CONT)) {
+            status = DDCRC_INVALID_OPERATION;
+            break;
+         }
+         int new_value = 0;
+         ddc_excp = app_relative_vcp_value(dh, request->feature_code,
+               (request->op == SERVER_OP_SETVCP_PLUS) ? VALUE_TYPE_RELATIVE_PLUS : VALUE_TYPE_RELATIVE_MINUS,
+               request->value, &new_value);
+         if (!ddc_excp)
+            ddc_excp = ddc_set_nontable_vcp_value(dh, request->feature_code, new_value);
+         if (!ddc_excp) {
+            response->sh = new_value >> 8;
+            response->sl = new_value & 0xff;
+         }
+         break;
+      }
+      case SERVER_OP_CAPABILITIES:
+      {
+         char * capabilities_string = NULL;
+         ddc_excp = ddc_get_capabilities_string(dh, &capabilities_string);
+         if (!ddc_excp)
+            *data_loc = strdup(capabilities_string);   // capabilities_string is owned by dh->dref
+         break;
+      }
+      default:
+         status = DDCRC_ARG;
+      }
+      if (ddc_excp) {
+         status = ERRINFO_STATUS(ddc_excp);
+         ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING() || report_freed_exceptions);
+      }
+      ddc_close_display(dh);
+   }
+   response->status = status;
+   response->data_len = (*data_loc) ? strlen(*data_loc) : 0;
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "status=%s", psc_desc(status));
+}
+
+
+/** Services the requests of one client until it disconnects. */
+static gpointer
+server_connection_thread(gpointer data) {
+   bool debug = false;
+   int fd = GPOINTER_TO_INT(data);
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d", fd);
+
+   Server_Request request;
+   while (read_fully(fd, &request, sizeof(request))) {
+      Server_Response response;
+      memset(&response, 0, sizeof(response));
+      memcpy(response.marker, SERVER_PROTOCOL_MARKER, 4);
+      char * data = NULL;
+      bool valid = memcmp(request.marker, SERVER_PROTOCOL_MARKER, 4) == 0 &&
+                   request.version == SERVER_PROTOCOL_VERSION;
+      if (valid)
+         execute_server_request(&request, &response, &data);
+      else
+         response.status = DDCRC_ARG;
+      bool ok = write_fully(fd, &response, sizeof(response)) &&
+                write_fully(fd, data, response.data_len);
+      free(data);
+      if (!ok || !valid)
+         break;
+   }
+   close(fd);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "fd=%d", fd);
+   return NULL;
+}
+
+
+/** Checks a display for changes, and rereads the polled features if
+ *  any were changed or if full_read is set.
+ *
+ *  @param  dref         display reference
+ *  @param  full_read    reread the features even if no change is reported
+ *  @param  unsupported  features found to be unsupported, not read again
+ */
+static void
+poll_display(Display_Ref * dref, bool full_read, Bit_Set_256 * unsupported) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, full_read=%s", dref_repr_t(dref), sbool(full_read));
+
+   Display_Handle * dh = NULL;
+   if (ddc_open_display(dref, CALLOPT_WAIT, &dh) == 0) {
+      bool changed = false;
+      if (!bs256_contains(*unsupported, 0x02)) {
+         Parsed_Nontable_Vcp_Response * response = NULL;
+         Error_Info * excp = ddc_get_nontable_vcp_value(dh, 0x02, &response);
+         if (!excp) {
+            changed = (response->sl == 0x02);
+            free(response);
+         }
+         else if (excp->status_code == DDCRC_REPORTED_UNSUPPORTED ||
+                  excp->status_code == DDCRC_DETERMINED_UNSUPPORTED)
+         {
+            *unsupported = bs256_insert(*unsupported, 0x02);
+         }
+         ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+      }
+
+      if (changed || full_read) {
+         // values read are published by ddc_get_nontable_vcp_value()
+         for (int ndx = 0; ndx < polled_feature_ct; ndx++) {
+            DDCA_Vcp_Feature_Code feature_code = polled_features[ndx];
+            if (bs256_contains(*unsupported, feature_code))
+               continue;
+            ddc_invalidate_cached_vcp_value(dref, feature_code);
+            Parsed_Nontable_Vcp_Response * response = NULL;
+            Error_Info * excp = ddc_get_nontable_vcp_value(dh, feature_code, &response);
+            if (excp && (excp->status_code == DDCRC_REPORTED_UNSUPPORTED ||
+                         excp->status_code == DDCRC_DETERMINED_UNSUPPORTED))
+               *unsupported = bs256_insert(*unsupported, feature_code);
+            ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+            free(response);
+         }
+      }
+      if (changed) {
+         // otherwise x02 continues to report that changes exist
+         Error_Info * excp = ddc_set_nontable_vcp_value(dh, 0x02, 0x01);
+         ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+      }
+      ddc_close_display(dh);
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+static gpointer
+server_poll_thread(gpointer data) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+   ddc_set_thread_io_priority(DDCA_IO_PRIORITY_BACKGROUND);
+
+   GPtrArray * drefs = ddc_get_filtered_displays(false);
+   Bit_Set_256 * unsupported = calloc(drefs->len, sizeof(Bit_Set_256));
+   int poll_ct = 0;
+   g_mutex_lock(&poll_mutex);
+   while (!poll_shutdown) {
+      g_mutex_unlock(&poll_mutex);
+      for (int ndx = 0; ndx < drefs->len; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(drefs, ndx);
+         if (dref->io_path.io_mode == DDCA_IO_I2C)
+            poll_display(dref, poll_ct % SERVER_POLL_FULL_READ_CT == 0, &unsupported[ndx]);
+      }
+      poll_ct++;
+      g_mutex_lock(&poll_mutex);
+      gint64 end_time = g_get_monotonic_time() + SERVER_POLL_INTERVAL_MILLISEC*1000;
+      while (!poll_shutdown && g_cond_wait_until(&poll_cond, &poll_mutex, end_time))
+         ;
+   }
+   g_mutex_unlock(&poll_mutex);
+   free(unsupported);
+   g_ptr_array_free(drefs, true);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "poll_ct=%d", poll_ct);
+   return NULL;
+}
+
+
+static void
+server_signal_handler(int signum) {
+   terminate_server = true;
+}
+
+
+/** Executes the SERVE command.
+ *
+ *  Does not return until interrupted by SIGINT or SIGTERM.
+ *
+ *  @param  parsed_cmd  parsed command line
+ *  @return false if the server could not be started
+ */
+bool
+app_serve(Parsed_Cmd * parsed_cmd) {
+   bool debug = false;
+   char * path = socket_path(parsed_cmd);
+   DBGTRC_STARTING(debug, TRACE_GROUP, "socket path=%s", path);
+
+   bool ok = false;
+   struct sockaddr_un addr;
+   int listen_fd = -1;
+   if (!set_socket_address(path, &addr))
+      goto bye;
+
+   listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (listen_fd < 0) {
+      f0printf(ferr(), "Unable to create socket: %s\n", strerror(errno));
+      goto bye;
+   }
+
+   // a server that is running accepts connections, a stale socket does not
+   if (connect(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+      f0printf(ferr(), "A ddcutil server is already listening on %s\n", path);
+      goto bye;
+   }
+   unlink(path);
+
+   // only the invoking user may connect
+   mode_t old_umask = umask(0077);
+   int rc = bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr));
+   umask(old_umask);
+   if (rc < 0 || listen(listen_fd, 16) < 0) {
+      f0printf(ferr(), "Unable to listen on %s: %s\n", path, strerror(errno));
+      goto bye;
+   }
+
+   ddc_enable_vcp_value_cache(true);
+   ddc_ensure_displays_detected();
+   f0printf(fout(), "ddcutil server listening on %s, %d display(s) detected\n",
+                    path, ddc_get_display_count(false));
+   GThread * poll_thread = NULL;
+   if (ddc_start_publishing_state())
+      poll_thread = g_thread_new("ddcutil_server_poll", server_poll_thread, NULL);
+   else
+      f0printf(ferr(), "Unable to publish display state in shared memory\n");
+   fflush(fout());
+
+   // no SA_RESTART, so that accept() is interrupted
+   struct sigaction sa;
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = server_signal_handler;
+   sigaction(SIGINT,  &sa, NULL);
+   sigaction(SIGTERM, &sa, NULL);
+   signal(SIGPIPE, SIG_IGN);      // client disconnected while writing response
+
+   while (!terminate_server) {
+      int fd = accept(listen_fd, NULL, NULL);
+      if (fd < 0) {
+         if (errno != EINTR)
+            f0printf(ferr(), "accept() failed: %s\n", strerror(errno));
+         continue;
+      }
+      g_thread_unref(g_thread_new("ddcutil_server", server_connection_thread, GINT_TO_POINTER(fd)));
+   }
+   unlink(path);
+   if (poll_thread) {
+      g_mutex_lock(&poll_mutex);
+      poll_shutdown = true;
+      g_cond_broadcast(&poll_cond);
+      g_mutex_unlock(&poll_mutex);
+      g_thread_join(poll_thread);
+   }
+   ddc_stop_publishing_state();
+   ok = true;
+
+bye:
+   if (listen_fd >= 0)
+      close(listen_fd);
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, ok, "socket path=%s", path);
+   free(path);
+   return ok;
+}
+
+
+//
+// Client
+//
+
+/** Sends one request, and reads its response.
+ *
+ *  @param  fd        connected socket
+ *  @param  request   request to send
+ *  @param  response  where to return the response
+ *  @param  data_loc  if non-NULL, where to return the data that follows the response
+ *  @return true if success, false if communication with the server failed
+ */
+static bool
+send_server_request(
+      int               fd,
+      Server_Request *  request,
+      Server_Response * response,
+      char **           data_loc)
+{
+   memcpy(request->marker, SERVER_PROTOCOL_MARKER, 4);
+   request->version = SERVER_PROTOCOL_VERSION;
+   if (!write_fully(fd, request, sizeof(*request)) ||
+       !read_fully(fd, response, sizeof(*response)) ||
+       memcmp(response->marker, SERVER_PROTOCOL_MARKER, 4) != 0)
+   {
+      return false;
+   }
+   char * data = calloc(1, response->data_len+1);
+   bool ok = read_fully(fd, data, response->data_len);
+   if (ok && data_loc)
+      *data_loc = data;
+   else
+      free(data);
+   return ok;
+}
+
+
+static bool
+is_server_feature(DDCA_Vcp_Feature_Code feature_code) {
+   VCP_Feature_Table_Entry * pentry = vcp_find_feature_by_hexid(feature_code);
+   return pentry && !is_table_feature_by_vcp_version(pentry, DDCA_VSPEC_ANY);
+}
+
+
+/** Checks whether a command can be executed by the server.
+ *
+ *  The server handles only the common cases: getvcp for a single known
+ *  non-table feature, setvcp of known non-table features, and capabilities,
+ *  with the display identified by display number or I2C bus number.
+ */
+static bool
+is_server_command(Parsed_Cmd * parsed_cmd) {
+   if (parsed_cmd->pdid &&
+       parsed_cmd->pdid->id_type != DISP_ID_DISPNO &&
+       parsed_cmd->pdid->id_type != DISP_ID_BUSNO)
+      return false;
+   if (parsed_cmd->flags & CMD_FLAG_ALL_DISPLAYS)
+      return false;
+
+   bool result = false;
+   switch(parsed_cmd->cmd_id) {
+   case CMDID_GETVCP:
+      result = parsed_cmd->fref->subset == VCP_SUBSET_SINGLE_FEATURE &&
+               is_server_feature(bs256_first_bit_set(parsed_cmd->fref->features));
+      break;
+   case CMDID_SETVCP:
+      result = true;
+      for (int ndx = 0; ndx < parsed_cmd->setvcp_values->len; ndx++) {
+         Parsed_Setvcp_Args * args = &g_array_index(parsed_cmd->setvcp_values, Parsed_Setvcp_Args, ndx);
+         if (!is_server_feature(args->feature_code))
+            result = false;
+      }
+      break;
+   case CMDID_CAPABILITIES:
+      result = true;
+      break;
+   default:
+      break;
+   }
+   return result;
+}
+
+
+/** Executes a GETVCP, SETVCP, or CAPABILITIES command using the server.
+ *
+ *  @param  parsed_cmd   parsed command line
+ *  @param  main_rc_loc  where to return the program exit code
+ *  @return true if the command was executed by the server,
+ *          false if it must be executed locally, e.g. because no
+ *          server is running
+ */
+bool
+app_server_execute(Parsed_Cmd * parsed_cmd, int * main_rc_loc) {
+   bool debug = false;
+   char * path = socket_path(parsed_cmd);
+   DBGTRC_STARTING(debug, TRACE_GROUP, "cmd=%s, socket path=%s", cmdid_name(parsed_cmd->cmd_id), path);
+
+   bool executed = false;
+   struct sockaddr_un addr;
+   int fd = -1;
+   if (!is_server_command(parsed_cmd) || !set_socket_address(path, &addr))
+      goto bye;
+   fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "No server listening on %s", path);
+      if (get_output_level() >= DDCA_OL_VERBOSE)
+         f0printf(fout(), "No ddcutil server listening on %s, executing command locally\n", path);
+      goto bye;
+   }
+   signal(SIGPIPE, SIG_IGN);      // server terminated while writing request
+
+   Server_Request request;
+   memset(&request, 0, sizeof(request));
+   request.display_id_type = (parsed_cmd->pdid && parsed_cmd->pdid->id_type == DISP_ID_BUSNO)
+                                ? SERVER_DISPLAY_BUSNO : SERVER_DISPLAY_DISPNO;
+   request.display_id = (!parsed_cmd->pdid)                           ? 1 :
+                        (parsed_cmd->pdid->id_type == DISP_ID_BUSNO)  ? parsed_cmd->pdid->busno
+                                                                      : parsed_cmd->pdid->dispno;
+   Server_Response response;
+   bool ok = true;        // no communication failure
+   int  status = 0;       // status of requests executed
+   FILE * fout = stdout;
+
+   switch(parsed_cmd->cmd_id) {
+   case CMDID_GETVCP:
+      request.op = SERVER_OP_GETVCP;
+      request.feature_code = bs256_first_bit_set(parsed_cmd->fref->features);
+      ok = send_server_request(fd, &request, &response, NULL);
+      if (ok && response.status == 0) {
+         if (get_output_level() == DDCA_OL_TERSE)
+            f0printf(fout, "VCP %02X C %d %d\n", request.feature_code,
+                     response.sh << 8 | response.sl, response.mh << 8 | response.ml);
+         else
+            f0printf(fout, "VCP code 0x%02x (%-30s): current value = %5d, max value = %5d\n",
+                     request.feature_code, get_feature_name_by_id_only(request.feature_code),
+                     response.sh << 8 | response.sl, response.mh << 8 | response.ml);
+      }
+      status = response.status;
+      break;
+
+   case CMDID_SETVCP:
+      for (int ndx = 0; ndx < parsed_cmd->setvcp_values->len && ok && status == 0; ndx++) {
+         Parsed_Setvcp_Args * args = &g_array_index(parsed_cmd->setvcp_values, Parsed_Setvcp_Args, ndx);
+         char * canonical = canonicalize_possible_hex_value(args->feature_value);
+         int value = 0;
+         bool valid = str_to_int(canonical, &value, 0) && value >= 0 && value <= 65535;
+         free(canonical);
+         if (!valid) {
+            f0printf(ferr(), "Invalid value for feature 0x%02x: %s\n", args->feature_code, args->feature_value);
+            status = DDCRC_ARG;
+            break;
+         }
+         request.op = (args->feature_value_type == VALUE_TYPE_RELATIVE_PLUS)  ? SERVER_OP_SETVCP_PLUS  :
+                      (args->feature_value_type == VALUE_TYPE_RELATIVE_MINUS) ? SERVER_OP_SETVCP_MINUS :
+                                                                                SERVER_OP_SETVCP;
+         request.feature_code = args->feature_code;
+         request.value = value;
+         ok = send_server_request(fd, &request, &response, NULL);
+         status = response.status;
+      }
+      break;
+
+   case CMDID_CAPABILITIES:
+   {
+      request.op = SERVER_OP_CAPABILITIES;
+      char * capabilities_string = NULL;
+      ok = send_server_request(fd, &request, &response, &capabilities_string);
+      if (ok && response.status == 0) {
+         if (get_output_level() == DDCA_OL_TERSE)
+            f0printf(fout, "Unparsed capabilities string: %s\n", capabilities_string);
+         else {
+            Parsed_Capabilities * pcaps = parse_capabilities_string(capabilities_string);
+            dyn_report_parsed_capabilities(pcaps, NULL, NULL, 0);
+            free_parsed_capabilities(pcaps);
+         }
+      }
+      free(capabilities_string);
+      status = response.status;
+      break;
+   }
+
+   default:
+      PROGRAM_LOGIC_ERROR("Unexpected command: %s", cmdid_name(parsed_cmd->cmd_id));
+   }
+
+   if (!ok) {
+      f0printf(ferr(), "Communication with ddcutil server on %s failed\n", path);
+      *main_rc_loc = EXIT_FAILURE;
+   }
+   else if (status != 0) {
+      if (status != DDCRC_ARG)
+         f0printf(ferr(), "Server request for feature 0x%02x failed: %s\n",
+                          request.feature_code, psc_desc(status));
+      *main_rc_loc = EXIT_FAILURE;
+   }
+   else
+      *main_rc_loc = EXIT_SUCCESS;
+   executed = true;
+
+bye:
+   if (fd >= 0)
+      close(fd);
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, executed, "");
+   free(path);
+   return executed;
+}
+
+
+void init_app_server() {
+   RTTI_ADD_FUNC(app_serve);
+   RTTI_ADD_FUNC(app_server_execute);
+   RTTI_ADD_FUNC(execute_server_request);
+   RTTI_ADD_FUNC(server_connection_thread);
+   RTTI_ADD_FUNC(poll_display);
+   RTTI_ADD_FUNC(server_poll_thread);
+}
@@ -0,0 +1,76 @@
+/** @file app_server.h
+ *
+ *  Implement the SERVE command, and the client side of option --use-server
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_SERVER_H_
+#define APP_SERVER_H_
+
+/** \cond */
+#include <stdbool.h>
+#include <stdint.h>
+/** \endcond */
+
+#include "cmdline/parsed_cmd.h"
+
+//
+// Wire protocol
+//
+// A client sends a sequence of fixed size requests over a Unix domain
+// stream socket.  The server answers each request with a fixed size response,
+// followed by response_data_len bytes of data, e.g. a capabilities string.
+// Both sides are on the same machine, so values are in host byte order.
+//
+
+#define SERVER_PROTOCOL_MARKER  "DDCS"
+#define SERVER_PROTOCOL_VERSION 1
+
+/** Request types */
+typedef enum {
+   SERVER_OP_GETVCP       = 1,    ///< get non-table feature value
+   SERVER_OP_SETVCP       = 2,    ///< set non-table feature value
+   SERVER_OP_CAPABILITIES = 3,    ///< get capabilities string
+   SERVER_OP_SETVCP_PLUS  = 4,    ///< increase Continuous feature value
+   SERVER_OP_SETVCP_MINUS = 5,    ///< decrease Continuous feature value
+} Server_Op;
+
+/** How the display is identified in a request */
+typedef enum {
+   SERVER_DISPLAY_DISPNO  = 1,    ///< ddcutil display number
+   SERVER_DISPLAY_BUSNO   = 2,    ///< I2C bus number
+} Server_Display_Id_Type;
+
+typedef struct {
+   char     marker[4];            ///< always SERVER_PROTOCOL_MARKER
+   uint16_t version;              ///< SERVER_PROTOCOL_VERSION
+   uint8_t  op;                   ///< #Server_Op
+   uint8_t  display_id_type;      ///< #Server_Display_Id_Type
+   int32_t  display_id;           ///< display number or bus number
+   uint8_t  feature_code;
+   uint8_t  reserved;
+   uint16_t value;                ///< new value, or change for SERVER_OP_SETVCP_PLUS/MINUS
+} Server_Request;
+
+typedef struct {
+   char     marker[4];            ///< always SERVER_PROTOCOL_MARKER
+   int32_t  status;               ///< ddcutil status code
+   uint8_t  mh;                   ///< max value high order byte, for SERVER_OP_GETVCP
+                                  ///< (for SERVER_OP_SETVCP_PLUS/MINUS, sh and sl are the value set)
+   uint8_t  ml;                   ///< max value low order byte
+   uint8_t  sh;                   ///< current value high order byte
+   uint8_t  sl;                   ///< current value low order byte
+   uint32_t data_len;             ///< length of data following the response
+} Server_Response;
+
+char * app_server_default_socket_path();
+
+bool app_serve(Parsed_Cmd * parsed_cmd);
+
+bool app_server_execute(Parsed_Cmd * parsed_cmd, int * main_rc_loc);
+
+void init_app_server();
+
+#endif /* APP_SERVER_H_ */
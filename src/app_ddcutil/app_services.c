@@ -15,6 +15,7 @@
 #include "app_interrogate.h"
 #endif
 #include "app_probe.h"
+#include "app_server.h"
 #include "app_setvcp.h"
 #include "app_watch.h"
 #include "app_vcpinfo.h"
@@ -28,6 +29,7 @@ void init_app_services() {
    init_app_interrogate();
 #endif
    init_app_probe();
+   init_app_server();
    init_app_setvcp();
    init_app_watch();
 }
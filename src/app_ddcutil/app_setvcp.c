@@ -9,6 +9,7 @@
 /** \cond */
 #include <assert.h>
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 /** \endcond */
 
@@ -22,13 +23,19 @@
 #include "base/ddc_packets.h"
 #include "base/feature_metadata.h"
 #include "base/rtti.h"
+#include "base/tuned_sleep.h"
 
 #include "cmdline/parsed_cmd.h"
 
+#include "ddc/ddc_async_requests.h"
+#include "ddc/ddc_displays.h"
 #include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_value_cache.h"
 
 #include "dynvcp/dyn_feature_codes.h"
 
+#include "app_ddcutil/app_dynamic_features.h"
+
 #include "app_setvcp.h"
 
 // Default trace class for this file
@@ -70,6 +77,58 @@ parse_vcp_value(
 }
 
 
+/** Computes the absolute value for a relative change of a Continuous feature.
+ *
+ *  The current value is taken from the VCP value cache if it holds an
+ *  unexpired value, e.g. from a recent read or write, so that repeated
+ *  increments need not each read the feature first.  If the cached value
+ *  turns out to be stale, verification of the write rereads the feature
+ *  and so corrects the cache.
+ *
+ *  @param  dh             display handle
+ *  @param  feature_code   feature code
+ *  @param  value_type     #VALUE_TYPE_RELATIVE_PLUS or #VALUE_TYPE_RELATIVE_MINUS
+ *  @param  delta          amount of change
+ *  @param  new_value_loc  where to return the new value, limited to the
+ *                         range 0..maximum value
+ *  @return NULL if success, #Error_Info if getting the current value failed
+ */
+Error_Info *
+app_relative_vcp_value(
+      Display_Handle *   dh,
+      Byte               feature_code,
+      Setvcp_Value_Type  value_type,
+      int                delta,
+      int *              new_value_loc)
+{
+   assert(value_type == VALUE_TYPE_RELATIVE_PLUS || value_type == VALUE_TYPE_RELATIVE_MINUS);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "feature=0x%02x, value_type=%s, delta=%d",
+                   feature_code, setvcp_value_type_name(value_type), delta);
+
+   Parsed_Nontable_Vcp_Response   response;
+   Parsed_Nontable_Vcp_Response * parsed_response = &response;
+   Error_Info * ddc_excp = ddc_get_nontable_vcp_value_cached_into(dh, feature_code, parsed_response);
+   if (!ddc_excp) {
+      int itemp;
+      if ( value_type == VALUE_TYPE_RELATIVE_PLUS) {
+         itemp = RESPONSE_CUR_VALUE(parsed_response) + delta;
+         if (itemp > RESPONSE_MAX_VALUE(parsed_response))
+            itemp = RESPONSE_MAX_VALUE(parsed_response);
+      }
+      else {
+         itemp = RESPONSE_CUR_VALUE(parsed_response)  - delta;
+         if (itemp < 0)
+            itemp = 0;
+      }
+      *new_value_loc = itemp;
+   }
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "*new_value_loc=%d", (ddc_excp) ? -1 : *new_value_loc);
+   return ddc_excp;
+}
+
+
 /** Parses the arguments passed for a single feature and sets the new value.
  *
  *   @param  dh          display handle
@@ -77,15 +136,17 @@ parse_vcp_value(
  *   @param  value_type  indicates if a relative value
  *   @param  new_value   new feature value (as string)
  *   @param  force       attempt to set feature even if feature code unrecognized
+ *   @param  written_loc if non-NULL, where to return the value written
  *   @return #Error_Info if error
  */
 Error_Info *
 app_set_vcp_value(
-      Display_Handle *  dh,
-      Byte              feature_code,
-      Setvcp_Value_Type value_type,
-      char *            new_value,
-      bool              force)
+      Display_Handle *     dh,
+      Byte                 feature_code,
+      Setvcp_Value_Type    value_type,
+      char *               new_value,
+      bool                 force,
+      DDCA_Any_Vcp_Value * written_loc)
 {
    assert(new_value && strlen(new_value) > 0);
    FILE * errf = ferr();   // at app level will always be stderr()
@@ -156,11 +217,7 @@ app_set_vcp_value(
 
          // Handle relative values
 
-         Parsed_Nontable_Vcp_Response * parsed_response;
-         ddc_excp = ddc_get_nontable_vcp_value(
-                       dh,
-                       feature_code,
-                       &parsed_response);
+         ddc_excp = app_relative_vcp_value(dh, feature_code, value_type, itemp, &itemp);
          if (ddc_excp) {
             ddcrc = ERRINFO_STATUS(ddc_excp);
             // is message needed?
@@ -173,19 +230,6 @@ app_set_vcp_value(
                           feature_code, psc_desc(ddcrc));
             goto bye;
          }
-
-         if ( value_type == VALUE_TYPE_RELATIVE_PLUS) {
-            itemp = RESPONSE_CUR_VALUE(parsed_response) + itemp;
-            if (itemp > RESPONSE_MAX_VALUE(parsed_response))
-               itemp = RESPONSE_MAX_VALUE(parsed_response);
-         }
-         else {
-            assert( value_type == VALUE_TYPE_RELATIVE_MINUS);
-            itemp = RESPONSE_CUR_VALUE(parsed_response)  - itemp;
-            if (itemp < 0)
-               itemp = 0;
-         }
-         free(parsed_response);
       }
 
       vrec.opcode        = feature_code;
@@ -195,6 +239,8 @@ app_set_vcp_value(
    }
 
    ddc_excp = ddc_set_vcp_value(dh, &vrec, NULL);
+   if (!ddc_excp && written_loc)
+      *written_loc = vrec;
 
    if (ddc_excp) {
       ddcrc = ERRINFO_STATUS(ddc_excp);
@@ -228,7 +274,20 @@ app_setvcp(Parsed_Cmd * parsed_cmd, Display_Handle * dh)
    DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
    Error_Info * ddc_excp = NULL;
    Status_Errno_DDC ddcrc = 0;
-   for (int ndx = 0; ndx < parsed_cmd->setvcp_values->len; ndx++) {
+   int value_ct = parsed_cmd->setvcp_values->len;
+
+   // With multiple values, verify all once written instead of each as it is written.
+   // The sleep after each write is deferred until the next DDC operation, so it
+   // overlaps the parsing and metadata lookup for the next value.
+   bool deferred_verify = value_ct > 1 && ddc_get_verify_setvcp();
+   DDCA_Any_Vcp_Value *  written      = calloc(value_ct, sizeof(DDCA_Any_Vcp_Value));
+   DDCA_Any_Vcp_Value ** written_ptrs = calloc(value_ct, sizeof(DDCA_Any_Vcp_Value*));
+   if (deferred_verify)
+      ddc_set_verify_setvcp(false);
+   bool old_thread_deferral = false;
+   if (value_ct > 1)
+      old_thread_deferral = enable_deferred_sleep_for_thread(true);
+   for (int ndx = 0; ndx < value_ct; ndx++) {
       Parsed_Setvcp_Args * cur =
             &g_array_index(parsed_cmd->setvcp_values, Parsed_Setvcp_Args, ndx);
       ddc_excp = app_set_vcp_value(
@@ -236,7 +295,9 @@ app_setvcp(Parsed_Cmd * parsed_cmd, Display_Handle * dh)
             cur->feature_code,
             cur->feature_value_type,
             cur->feature_value,
-            parsed_cmd->flags & CMD_FLAG_FORCE);
+            parsed_cmd->flags & CMD_FLAG_FORCE,
+            &written[ndx]);
+      written_ptrs[ndx] = &written[ndx];
       if (ddc_excp) {
          f0printf(ferr(), "%s\n", ddc_excp->detail);
          if (ddc_excp->status_code == DDCRC_RETRIES)
@@ -246,6 +307,113 @@ app_setvcp(Parsed_Cmd * parsed_cmd, Display_Handle * dh)
          break;
       }
    }
+   if (deferred_verify) {
+      ddc_set_verify_setvcp(true);
+      if (ddcrc == 0) {
+         ddc_excp = ddc_verify_multiple_vcp_values(dh, written_ptrs, value_ct);
+         if (ddc_excp) {
+            f0printf(ferr(), "%s: %s\n", ddc_excp->detail, errinfo_causes_string(ddc_excp));
+            ddcrc = ERRINFO_STATUS(ddc_excp);
+            ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING() || report_freed_exceptions);
+         }
+      }
+   }
+   if (value_ct > 1) {
+      enable_deferred_sleep_for_thread(old_thread_deferral);
+      CHECK_DEFERRED_SLEEP(dh);    // honor the sleep after the final write
+   }
+   free(written_ptrs);
+   free(written);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc,"");
+   return ddcrc;
+}
+
+
+/** Execute command SETVCP with option --all.
+ *
+ *  The value is written to all valid displays concurrently, see
+ *  #ddc_set_nontable_vcp_values_multi().  Only a single non-table feature
+ *  with an absolute value is supported, since a relative value would first
+ *  have to be read separately from each display.
+ *
+ *  @param  parsed_cmd  parsed command
+ *  @param  callopts    options for opening the displays
+ *  @return 0 if the value was set on every display,
+ *          otherwise the status code of the first display that failed
+ */
+Status_Errno_DDC
+app_setvcp_all_displays(Parsed_Cmd * parsed_cmd, Call_Options callopts)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+   FILE * errf = ferr();
+   Status_Errno_DDC ddcrc = 0;
+
+   Parsed_Setvcp_Args * args = &g_array_index(parsed_cmd->setvcp_values, Parsed_Setvcp_Args, 0);
+   int new_value = 0;
+   if (parsed_cmd->setvcp_values->len != 1 || args->feature_value_type != VALUE_TYPE_ABSOLUTE) {
+      f0printf(errf, "Option --all requires a single feature and an absolute value\n");
+      ddcrc = DDCRC_ARG;
+   }
+   else if (!parse_vcp_value(args->feature_value, &new_value)) {
+      f0printf(errf, "Invalid VCP value: %s\n", args->feature_value);
+      ddcrc = DDCRC_ARG;
+   }
+   if (ddcrc != 0)
+      goto bye;
+
+   Byte feature_code = args->feature_code;
+   bool with_default = (parsed_cmd->flags & CMD_FLAG_FORCE) || feature_code >= 0xe0;
+   ddc_ensure_displays_detected();
+   GPtrArray * all_drefs = ddc_get_filtered_displays(false);
+   GPtrArray * drefs = g_ptr_array_sized_new(all_drefs->len);
+   for (int ndx = 0; ndx < all_drefs->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(all_drefs, ndx);
+      app_check_dynamic_features(dref);
+      Display_Feature_Metadata * dfm =
+            dyn_get_feature_metadata_by_dref(feature_code, dref, with_default);
+      if (!dfm) {
+         f0printf(errf, "Display %d: Unrecognized VCP feature code: 0x%02x\n", dref->dispno, feature_code);
+         ddcrc = DDCRC_UNKNOWN_FEATURE;
+      }
+      else if (!(dfm->feature_flags & DDCA_WRITABLE)) {
+         f0printf(errf, "Display %d: Feature 0x%02x (%s) is not writable\n",
+                        dref->dispno, feature_code, dfm->feature_name);
+         ddcrc = DDCRC_INVALID_OPERATION;
+      }
+      else if (dfm->feature_flags & DDCA_TABLE) {
+         f0printf(errf, "Display %d: Option --all is not supported for Table feature 0x%02x (%s)\n",
+                        dref->dispno, feature_code, dfm->feature_name);
+         ddcrc = DDCRC_INVALID_OPERATION;
+      }
+      else {
+         g_ptr_array_add(drefs, dref);
+      }
+      dfm_free(dfm);   // handles dfm == NULL
+   }
+   if (all_drefs->len == 0)
+      f0printf(fout(), "No displays found\n");
+   g_ptr_array_free(all_drefs, true);
+
+   DDCA_Status * statuses = calloc(drefs->len, sizeof(DDCA_Status));
+   ddc_set_nontable_vcp_values_multi(
+         (Display_Ref **) drefs->pdata, drefs->len, feature_code, new_value, callopts, statuses);
+   for (int ndx = 0; ndx < drefs->len; ndx++) {
+      if (statuses[ndx] == 0)
+         continue;
+      Display_Ref * dref = g_ptr_array_index(drefs, ndx);
+      if (statuses[ndx] == DDCRC_VERIFY)
+         f0printf(errf, "Display %d: Verification failed for feature %02x\n", dref->dispno, feature_code);
+      else
+         f0printf(errf, "Display %d: Setting value failed for feature %02x, rc=%s\n",
+                        dref->dispno, feature_code, psc_desc(statuses[ndx]));
+      if (ddcrc == 0)
+         ddcrc = statuses[ndx];
+   }
+   free(statuses);
+   g_ptr_array_free(drefs, true);
+
+bye:
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc,"");
    return ddcrc;
 }
@@ -253,5 +421,7 @@ app_setvcp(Parsed_Cmd * parsed_cmd, Display_Handle * dh)
 
 void init_app_setvcp() {
    RTTI_ADD_FUNC(app_setvcp);
+   RTTI_ADD_FUNC(app_setvcp_all_displays);
    RTTI_ADD_FUNC(app_set_vcp_value);
+   RTTI_ADD_FUNC(app_relative_vcp_value);
 }
@@ -9,15 +9,30 @@
 #ifndef APP_SETVCP_H_
 #define APP_SETVCP_H_
 
+#include "util/error_info.h"
 #include "cmdline/parsed_cmd.h"
+#include "base/core.h"
 #include "base/displays.h"
 #include "base/status_code_mgt.h"
 
+Error_Info *
+app_relative_vcp_value(
+      Display_Handle *  dh,
+      Byte              feature_code,
+      Setvcp_Value_Type value_type,
+      int               delta,
+      int *             new_value_loc);
+
 Status_Errno_DDC
 app_setvcp(
       Parsed_Cmd *      parsed_cmd,
       Display_Handle *  dh);
 
+Status_Errno_DDC
+app_setvcp_all_displays(
+      Parsed_Cmd *      parsed_cmd,
+      Call_Options      callopts);
+
 void init_app_setvcp();
 
 #endif /* APP_SETVCP_H_ */
@@ -0,0 +1,296 @@
+/** @file app_snapshot.c
+ *
+ *  Implement the SNAPSHOT command, which copies the parts of /sys and /dev
+ *  that display detection examines into a directory.  With option --fs-root
+ *  the copy is read instead of the real file system, so that topology
+ *  scanning can be benchmarked on a machine without the original hardware.
+ *
+ *  Copied:
+ *   - the entries of /sys/class/drm and /sys/bus/i2c/devices, which are
+ *     symbolic links, and the /sys/devices subtrees they refer to
+ *   - the attribute files of the ancestors of those subtrees, e.g. the
+ *     class and vendor of the video adapter
+ *   - the directories referred to by symbolic links in the copied trees,
+ *     e.g. driver and module, without their subdirectories
+ *   - /dev/i2c-N, as empty regular files
+ *
+ *  Symbolic links are recreated with their original, relative, text, so
+ *  realpath() works within the snapshot.  Attribute files that cannot be
+ *  read, e.g. write only files such as bind, are skipped.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-2.0/glib.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+
+#include "app_ddcutil/app_snapshot.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+#define SNAPSHOT_MAX_ATTR_SIZE   65536
+#define SNAPSHOT_MAX_DIRS        10000   // guards against runaway link chains
+
+typedef struct {
+   char *       root;            // snapshot directory
+   GHashTable * copied;          // sysfs directory -> depth copied + 1
+   GQueue *     pending;         // Pending_Dir *, link targets still to copy
+   int          dir_ct;
+   int          file_ct;
+   int          link_ct;
+   int          error_ct;
+} Snapshot;
+
+typedef struct {
+   char * path;
+   int    link_depth;
+} Pending_Dir;
+
+
+static void
+snapshot_path(Snapshot * snap, const char * path, char * buf, int bufsz) {
+   g_snprintf(buf, bufsz, "%s%s", snap->root, path);
+}
+
+
+static void
+copy_attr_file(Snapshot * snap, const char * path) {
+   int fd = open(path, O_RDONLY | O_NONBLOCK);
+   if (fd < 0)
+      return;
+   char * data = malloc(SNAPSHOT_MAX_ATTR_SIZE);
+   ssize_t ct = read(fd, data, SNAPSHOT_MAX_ATTR_SIZE);
+   close(fd);
+   if (ct >= 0) {
+      char dest[PATH_MAX];
+      snapshot_path(snap, path, dest, PATH_MAX);
+      int outfd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (outfd >= 0 && write(outfd, data, ct) == ct)
+         snap->file_ct++;
+      else
+         snap->error_ct++;
+      if (outfd >= 0)
+         close(outfd);
+   }
+   free(data);
+}
+
+
+static void
+copy_symlink(Snapshot * snap, const char * path, int link_depth) {
+   char text[PATH_MAX];
+   ssize_t len = readlink(path, text, PATH_MAX-1);
+   if (len < 0)
+      return;
+   text[len] = '\0';
+   char dest[PATH_MAX];
+   snapshot_path(snap, path, dest, PATH_MAX);
+   if (symlink(text, dest) == 0)
+      snap->link_ct++;
+   else if (errno != EEXIST)
+      snap->error_ct++;
+
+   if (link_depth > 0) {
+      char * target = realpath(path, NULL);
+      if (target && str_starts_with(target, "/sys/")) {
+         struct stat statbuf;
+         if (stat(target, &statbuf) == 0 && S_ISDIR(statbuf.st_mode)) {
+            Pending_Dir * pending = g_new(Pending_Dir, 1);
+            pending->path       = target;
+            pending->link_depth = link_depth-1;
+            g_queue_push_tail(snap->pending, pending);
+            target = NULL;
+         }
+      }
+      free(target);
+   }
+}
+
+
+/** Copies a sysfs directory.
+ *
+ *  @param  snap        snapshot being written
+ *  @param  path        real path of directory
+ *  @param  depth       levels of subdirectories to copy
+ *  @param  link_depth  levels of symbolic links whose targets are copied
+ */
+static void
+copy_dir(Snapshot * snap, const char * path, int depth, int link_depth) {
+   int prior = GPOINTER_TO_INT(g_hash_table_lookup(snap->copied, path));
+   if (prior > depth || g_hash_table_size(snap->copied) >= SNAPSHOT_MAX_DIRS)
+      return;
+   g_hash_table_replace(snap->copied, g_strdup(path), GINT_TO_POINTER(depth+1));
+
+   char dest[PATH_MAX];
+   snapshot_path(snap, path, dest, PATH_MAX);
+   if (g_mkdir_with_parents(dest, 0755) != 0) {
+      snap->error_ct++;
+      return;
+   }
+   if (prior == 0)
+      snap->dir_ct++;
+
+   DIR * dir = opendir(path);
+   if (!dir)
+      return;
+   struct dirent * dent;
+   while ((dent = readdir(dir)) != NULL) {
+      if (streq(dent->d_name, ".") || streq(dent->d_name, ".."))
+         continue;
+      char child[PATH_MAX];
+      g_snprintf(child, PATH_MAX, "%s/%s", path, dent->d_name);
+      struct stat statbuf;
+      if (lstat(child, &statbuf) != 0)
+         continue;
+      if (S_ISLNK(statbuf.st_mode))
+         copy_symlink(snap, child, link_depth);
+      else if (S_ISREG(statbuf.st_mode)) {
+         if (statbuf.st_mode & (S_IRUSR|S_IRGRP|S_IROTH))
+            copy_attr_file(snap, child);
+      }
+      else if (S_ISDIR(statbuf.st_mode) && depth > 0)
+         copy_dir(snap, child, depth-1, link_depth);
+   }
+   closedir(dir);
+}
+
+
+// Copies the attribute files of the ancestors of a /sys/devices directory
+static void
+copy_ancestors(Snapshot * snap, const char * path) {
+   char * work = g_strdup(path);
+   char * slash;
+   while ((slash = strrchr(work, '/')) != NULL && slash - work > strlen("/sys/devices")) {
+      *slash = '\0';
+      copy_dir(snap, work, 0, 1);
+   }
+   g_free(work);
+}
+
+
+// Copies a directory of symbolic links such as /sys/class/drm,
+// and the trees to which they refer
+static void
+copy_link_dir(Snapshot * snap, const char * path, int target_depth) {
+   copy_dir(snap, path, 0, 0);
+   DIR * dir = opendir(path);
+   if (!dir) {
+      rpt_vstring(1, "Unable to open %s: %s", path, strerror(errno));
+      snap->error_ct++;
+      return;
+   }
+   struct dirent * dent;
+   while ((dent = readdir(dir)) != NULL) {
+      if (str_starts_with(dent->d_name, "."))
+         continue;
+      char child[PATH_MAX];
+      g_snprintf(child, PATH_MAX, "%s/%s", path, dent->d_name);
+      char * target = realpath(child, NULL);
+      if (target && str_starts_with(target, "/sys/devices/")) {
+         copy_dir(snap, target, target_depth, 2);
+         copy_ancestors(snap, target);
+      }
+      free(target);
+   }
+   closedir(dir);
+}
+
+
+static void
+copy_dev_i2c(Snapshot * snap) {
+   char dest[PATH_MAX];
+   snapshot_path(snap, "/dev", dest, PATH_MAX);
+   g_mkdir_with_parents(dest, 0755);
+   DIR * dir = opendir("/dev");
+   if (!dir)
+      return;
+   struct dirent * dent;
+   while ((dent = readdir(dir)) != NULL) {
+      if (str_starts_with(dent->d_name, "i2c-")) {
+         g_snprintf(dest, PATH_MAX, "%s/dev/%s", snap->root, dent->d_name);
+         int fd = open(dest, O_WRONLY | O_CREAT, 0644);
+         if (fd >= 0) {
+            close(fd);
+            snap->file_ct++;
+         }
+         else
+            snap->error_ct++;
+      }
+   }
+   closedir(dir);
+}
+
+
+/** Executes the SNAPSHOT command.
+ *
+ *  @param  dirname  directory in which to write the snapshot, created if
+ *                   it does not exist
+ *  @return true if successful, false if the snapshot could not be written
+ */
+bool
+app_snapshot(const char * dirname) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dirname=%s", dirname);
+
+   bool ok = false;
+   char * root = realpath(dirname, NULL);
+   if (!root) {
+      if (g_mkdir_with_parents(dirname, 0755) == 0)
+         root = realpath(dirname, NULL);
+   }
+   if (!root) {
+      f0printf(ferr(), "Unable to create directory %s: %s\n", dirname, strerror(errno));
+   }
+   else if (streq(root, "/")) {
+      f0printf(ferr(), "Snapshot directory cannot be /\n");
+   }
+   else {
+      Snapshot snap = {0};
+      snap.root    = root;
+      snap.copied  = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+      snap.pending = g_queue_new();
+
+      copy_link_dir(&snap, "/sys/class/drm",       2);
+      copy_link_dir(&snap, "/sys/bus/i2c/devices", 2);
+      Pending_Dir * pending;
+      while ((pending = g_queue_pop_head(snap.pending)) != NULL) {
+         copy_dir(&snap, pending->path, 0, pending->link_depth);
+         free(pending->path);
+         g_free(pending);
+      }
+      copy_dev_i2c(&snap);
+
+      rpt_vstring(0, "Wrote %d directories, %d files, %d symbolic links to %s",
+                     snap.dir_ct, snap.file_ct, snap.link_ct, root);
+      if (snap.error_ct > 0)
+         rpt_vstring(0, "%d entries could not be written", snap.error_ct);
+      ok = (snap.dir_ct > 0);
+
+      g_queue_free(snap.pending);
+      g_hash_table_destroy(snap.copied);
+   }
+   free(root);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s", sbool(ok));
+   return ok;
+}
@@ -0,0 +1,17 @@
+/** @file app_snapshot.h
+ *
+ *  Implement the SNAPSHOT command
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_SNAPSHOT_H_
+#define APP_SNAPSHOT_H_
+
+#include <stdbool.h>
+
+bool
+app_snapshot(const char * dirname);
+
+#endif /* APP_SNAPSHOT_H_ */
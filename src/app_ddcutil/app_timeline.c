@@ -0,0 +1,272 @@
+/** @file app_timeline.c
+ *
+ *  Implement the TIMELINE command, which summarizes a timeline of DDC
+ *  transactions captured using option --timeline.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "public/ddcutil_types.h"
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/io_timeline.h"
+#include "base/parms.h"
+#include "base/status_code_mgt.h"
+
+#include "app_ddcutil/app_timeline.h"
+
+
+typedef struct {
+   int      ct;
+   int      error_ct;
+   uint64_t total_nanos;
+   uint64_t min_nanos;
+   uint64_t max_nanos;
+} Duration_Summary;
+
+typedef struct {
+   int      ct;
+   uint64_t requested_micros;
+   uint64_t actual_nanos;
+} Sleep_Summary;
+
+typedef struct {
+   int              busno;
+   Duration_Summary events[IO_TIMELINE_EVENT_CT];
+   GHashTable *     sleeps;                              // sleep event name -> Sleep_Summary *
+   GHashTable *     status_cts;                          // status code -> count
+   int              tries_by_number[MAX_MAX_TRIES+1];
+   int              successes_by_number[MAX_MAX_TRIES+1];
+} Bus_Summary;
+
+
+static Bus_Summary *
+new_bus_summary(int busno) {
+   Bus_Summary * bs = calloc(1, sizeof(Bus_Summary));
+   bs->busno = busno;
+   bs->sleeps = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+   bs->status_cts = g_hash_table_new(g_direct_hash, g_direct_equal);
+   return bs;
+}
+
+
+static void
+free_bus_summary(void * data) {
+   Bus_Summary * bs = data;
+   g_hash_table_destroy(bs->sleeps);
+   g_hash_table_destroy(bs->status_cts);
+   free(bs);
+}
+
+
+static void
+add_duration(Duration_Summary * ds, uint64_t nanos, int status) {
+   if (ds->ct == 0 || nanos < ds->min_nanos)
+      ds->min_nanos = nanos;
+   if (nanos > ds->max_nanos)
+      ds->max_nanos = nanos;
+   ds->total_nanos += nanos;
+   ds->ct++;
+   if (status != 0)
+      ds->error_ct++;
+}
+
+
+/** Adds one timeline line to the summaries.
+ *
+ *  @param  line       line, without trailing newline
+ *  @param  summaries  busno -> #Bus_Summary
+ *  @param  first_nanos  set to earliest start time seen
+ *  @param  last_nanos   set to latest end time seen
+ *  @return true if the line was valid
+ */
+static bool
+add_timeline_line(
+      const char * line,
+      GHashTable * summaries,
+      uint64_t *   first_nanos,
+      uint64_t *   last_nanos)
+{
+   bool ok = false;
+   gchar ** fields = g_strsplit(line, ",", 0);
+   if (g_strv_length(fields) == 9) {
+      uint64_t start_nanos    = g_ascii_strtoull(fields[0], NULL, 10);
+      uint64_t duration_nanos = g_ascii_strtoull(fields[1], NULL, 10);
+      int busno               = atoi(fields[3]);
+      int tryctr              = atoi(fields[4]);
+      Io_Timeline_Event event = io_timeline_event_from_name(fields[5]);
+      const char * detail     = fields[6];
+      int requested_micros    = atoi(fields[7]);
+      int status              = atoi(fields[8]);
+
+      if (event >= 0) {
+         ok = true;
+         if (*first_nanos == 0 || start_nanos < *first_nanos)
+            *first_nanos = start_nanos;
+         if (start_nanos + duration_nanos > *last_nanos)
+            *last_nanos = start_nanos + duration_nanos;
+
+         Bus_Summary * bs = g_hash_table_lookup(summaries, GINT_TO_POINTER(busno));
+         if (!bs) {
+            bs = new_bus_summary(busno);
+            g_hash_table_insert(summaries, GINT_TO_POINTER(busno), bs);
+         }
+         add_duration(&bs->events[event], duration_nanos, status);
+
+         if (event == TLE_SLEEP) {
+            Sleep_Summary * ss = g_hash_table_lookup(bs->sleeps, detail);
+            if (!ss) {
+               ss = calloc(1, sizeof(Sleep_Summary));
+               g_hash_table_insert(bs->sleeps, g_strdup(detail), ss);
+            }
+            ss->ct++;
+            ss->requested_micros += requested_micros;
+            ss->actual_nanos     += duration_nanos;
+         }
+         else if (event == TLE_TRY) {
+            if (tryctr > MAX_MAX_TRIES)
+               tryctr = MAX_MAX_TRIES;
+            bs->tries_by_number[tryctr]++;
+            if (status == 0)
+               bs->successes_by_number[tryctr]++;
+         }
+
+         if (status != 0 && event != TLE_TRY) {   // try status repeats that of its last operation
+            int ct = GPOINTER_TO_INT(g_hash_table_lookup(bs->status_cts, GINT_TO_POINTER(status)));
+            g_hash_table_insert(bs->status_cts, GINT_TO_POINTER(status), GINT_TO_POINTER(ct+1));
+         }
+      }
+   }
+   g_strfreev(fields);
+   return ok;
+}
+
+
+static gint
+busno_compare(gconstpointer a, gconstpointer b) {
+   return GPOINTER_TO_INT(a) - GPOINTER_TO_INT(b);
+}
+
+
+static void
+report_bus_summary(Bus_Summary * bs, int depth) {
+   int d1 = depth+1;
+   int d2 = depth+2;
+   rpt_vstring(depth, "Bus /dev/i2c-%d:", bs->busno);
+
+   rpt_vstring(d1, "%-12s %7s %7s %10s %10s %10s", "Operation", "Count", "Errors", "Avg ms", "Min ms", "Max ms");
+   for (int ndx = 0; ndx < IO_TIMELINE_EVENT_CT; ndx++) {
+      Duration_Summary * ds = &bs->events[ndx];
+      if (ds->ct > 0) {
+         rpt_vstring(d1, "%-12s %7d %7d %10.3f %10.3f %10.3f",
+                     io_timeline_event_name(ndx), ds->ct, ds->error_ct,
+                     ds->total_nanos / (ds->ct * 1000000.0),
+                     ds->min_nanos / 1000000.0,
+                     ds->max_nanos / 1000000.0);
+      }
+   }
+
+   if (g_hash_table_size(bs->sleeps) > 0) {
+      rpt_nl();
+      rpt_vstring(d1, "%-30s %7s %14s %14s %12s", "Sleep event", "Count", "Requested ms", "Actual ms", "Overshoot %");
+      GList * keys = g_list_sort(g_hash_table_get_keys(bs->sleeps), (GCompareFunc) strcmp);
+      for (GList * cur = keys; cur; cur = cur->next) {
+         Sleep_Summary * ss = g_hash_table_lookup(bs->sleeps, cur->data);
+         double requested_millis = ss->requested_micros / 1000.0;
+         double actual_millis    = ss->actual_nanos / 1000000.0;
+         rpt_vstring(d1, "%-30s %7d %14.3f %14.3f %12.1f",
+                     (char *) cur->data, ss->ct, requested_millis, actual_millis,
+                     (requested_millis > 0) ? 100.0 * (actual_millis - requested_millis) / requested_millis : 0.0);
+      }
+      g_list_free(keys);
+   }
+
+   if (bs->events[TLE_TRY].ct > 0) {
+      rpt_nl();
+      rpt_label(d1, "Tries by try number:");
+      for (int ndx = 1; ndx <= MAX_MAX_TRIES; ndx++) {
+         if (bs->tries_by_number[ndx] > 0)
+            rpt_vstring(d2, "Try %2d: %6d attempted, %6d succeeded",
+                        ndx, bs->tries_by_number[ndx], bs->successes_by_number[ndx]);
+      }
+   }
+
+   if (g_hash_table_size(bs->status_cts) > 0) {
+      rpt_nl();
+      rpt_label(d1, "Status codes of failed operations:");
+      GList * keys = g_list_sort(g_hash_table_get_keys(bs->status_cts), busno_compare);
+      for (GList * cur = keys; cur; cur = cur->next) {
+         int status = GPOINTER_TO_INT(cur->data);
+         rpt_vstring(d2, "%6d %-28s %6d", status, psc_name(status),
+                     GPOINTER_TO_INT(g_hash_table_lookup(bs->status_cts, cur->data)));
+      }
+      g_list_free(keys);
+   }
+   rpt_nl();
+}
+
+
+/** Executes the TIMELINE command, reporting a summary of a timeline file.
+ *
+ *  @param  filename  timeline file, as written using option --timeline
+ *  @return true if success, false if the file cannot be read or is not a timeline
+ */
+bool
+app_timeline_summary(const char * filename) {
+   bool debug = false;
+   DBGMSF(debug, "Starting. filename=%s", filename);
+
+   FILE * fp = fopen(filename, "r");
+   if (!fp) {
+      f0printf(ferr(), "Unable to open %s: %s\n", filename, strerror(errno));
+      return false;
+   }
+
+   bool ok = true;
+   char line[200];
+   if (!fgets(line, sizeof(line), fp) || !str_starts_with(line, IO_TIMELINE_HEADER)) {
+      f0printf(ferr(), "%s is not a ddcutil timeline file\n", filename);
+      ok = false;
+   }
+   else {
+      GHashTable * summaries = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_bus_summary);
+      uint64_t first_nanos = 0;
+      uint64_t last_nanos  = 0;
+      int      invalid_ct  = 0;
+      while (fgets(line, sizeof(line), fp)) {
+         g_strchomp(line);
+         if (*line == '\0' || *line == '#' || str_starts_with(line, "start_nanos"))
+            continue;
+         if (!add_timeline_line(line, summaries, &first_nanos, &last_nanos))
+            invalid_ct++;
+      }
+
+      rpt_vstring(0, "Timeline %s: %.3f seconds", filename, (last_nanos - first_nanos) / 1000000000.0);
+      if (invalid_ct > 0)
+         rpt_vstring(0, "Invalid lines ignored: %d", invalid_ct);
+      rpt_nl();
+      GList * busnos = g_list_sort(g_hash_table_get_keys(summaries), busno_compare);
+      for (GList * cur = busnos; cur; cur = cur->next)
+         report_bus_summary(g_hash_table_lookup(summaries, cur->data), 0);
+      g_list_free(busnos);
+      g_hash_table_destroy(summaries);
+   }
+   fclose(fp);
+
+   DBGMSF(debug, "Done. Returning %s", sbool(ok));
+   return ok;
+}
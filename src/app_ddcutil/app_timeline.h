@@ -0,0 +1,17 @@
+/** @file app_timeline.h
+ *
+ *  Implement the TIMELINE command
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_TIMELINE_H_
+#define APP_TIMELINE_H_
+
+#include <stdbool.h>
+
+bool
+app_timeline_summary(const char * filename);
+
+#endif /* APP_TIMELINE_H_ */
@@ -11,7 +11,6 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
-#include <sys/ioctl.h>
 #include <unistd.h>
 
 #include "util/error_info.h"
@@ -19,11 +18,6 @@
 #include "util/report_util.h"
 /** \endcond */
 
-#ifdef USE_USB
-#include "usb_util/hiddev_reports.h"
-#include "usb_util/hiddev_util.h"
-#endif
-
 #include "base/core.h"
 #include "base/ddc_errno.h"
 #include "base/rtti.h"
@@ -42,6 +36,9 @@
 #include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_vcp_version.h"
 #include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_change_watch.h"
+#include "ddc/ddc_vcp_value_cache.h"
+#include "ddc/ddc_vcp_change_watch.h"
 
 #include "app_ddcutil/app_getvcp.h"
 
@@ -92,6 +89,8 @@ show_changed_feature(Display_Handle * dh, Byte * p_changed_feature) {
           x52_error->status_code == DDCRC_DETERMINED_UNSUPPORTED)
       {
          // printf("Feature x02 (New Control Value) reports new control values exist, but feature x52 (Active Control) unsupported\n");
+         // which values changed is unknown
+         ddc_invalidate_all_cached_vcp_values(dh->dref);
          result = errinfo_new2(x52_error->status_code, __func__,
                "Feature x02 (New Control Value) reports that changed VCP feature values exist, but feature x52 (Active Control) is unsupported");
          errinfo_free(x52_error);
@@ -107,8 +106,10 @@ show_changed_feature(Display_Handle * dh, Byte * p_changed_feature) {
      *p_changed_feature = nontable_response_loc->sl;
      free(nontable_response_loc);
      DBGMSF(debug, "getvcp(x52) returned value 0x%02x", *p_changed_feature);
-     if (*p_changed_feature)
+     if (*p_changed_feature) {
+        ddc_invalidate_cached_vcp_value(dh->dref, *p_changed_feature);
         app_show_single_vcp_value_by_feature_id(dh, *p_changed_feature, false);
+     }
   }
   return result;
 }
@@ -232,41 +233,18 @@ app_read_changes(Display_Handle * dh, bool force_no_fifo, bool* changes_reported
 
 
 #ifdef USE_USB
+static Display_Handle * usb_watch_dh = NULL;
+
+// Called on the USB watch thread with the new value of a changed feature
 static void
-app_read_changes_usb(Display_Handle * dh) {
+app_usb_vcp_changed(DDCA_Status psc, DDCA_Any_Vcp_Value * valrec) {
    bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
-   // bool new_values_found = false;
-
-   assert(dh->dref->io_path.io_mode == DDCA_IO_USB);
-   int fd = dh->fd;
-   int flaguref = HIDDEV_FLAG_UREF;
-   struct hiddev_usage_ref uref;
-   int rc = ioctl(fd, HIDIOCSFLAG, &flaguref);
-   if (rc < 0) {
-      REPORT_IOCTL_ERROR("HIDIOCSFLAG", errno);
-      return;
-   }
-
-   ssize_t ct = read(fd, &uref, sizeof(uref));
-   if (ct < 0) {
-      int errsv = errno;
-      // report the error
-      printf("(%s) read failed, errno=%d\n", __func__, errsv);
-   }
-   else if (ct > 0) {
-      rpt_vstring(1, "Read new value:");
-      if (ct < sizeof(uref)) {
-         rpt_vstring(1, "Short read");
-      }
-      else {
-         dbgrpt_hiddev_usage_ref(&uref, 1);
-         rpt_vstring(1, "New value: 0x%04x (%d)", uref.value, uref.value);
-      }
-   }
-   else {
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "tick");
-   }
+   DBGTRC_STARTING(debug, TRACE_GROUP, "psc=%s, feature_code=0x%02x", psc_desc(psc), valrec->opcode);
+   if (psc == 0)
+      app_show_single_vcp_value_by_feature_id(usb_watch_dh, valrec->opcode, false);
+   else
+      printf("Error reading changed feature 0x%02x: %s\n", valrec->opcode, psc_desc(psc));
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
 #endif
 
@@ -288,30 +266,38 @@ app_read_changes_forever(Display_Handle * dh, bool force_no_fifo) {
    // show version here instead of in called function to declutter debug output:
    DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dh(dh);
    DBGMSF(debug, "VCP version: %d.%d", vspec.major, vspec.minor);
+#ifdef USE_USB
+   // USB monitors send an input report when a control changes, so there
+   // is nothing to poll.  The watch thread calls app_usb_vcp_changed().
+   if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
+      usb_watch_dh = dh;
+      DDCA_Status rc = ddc_watch_vcp_changes(dh, app_usb_vcp_changed);
+      if (rc != 0) {
+         printf("Unable to watch display %s: %s\n", dh_repr(dh), psc_desc(rc));
+         return;
+      }
+      while (true)
+         pause();
+   }
+#endif
+
    reset_vcp_x02(dh);
    while(true) {
       bool changes_reported = false;
-#ifdef USE_USB
-      if (dh->dref->io_path.io_mode == DDCA_IO_USB)
-         app_read_changes_usb(dh);
-      else
-#endif
-      {
-         Error_Info * erec = app_read_changes(dh, force_no_fifo, &changes_reported);
-         if (erec) {
-            if (debug)
-               DBGMSG("Fatal error reading changes: %s", errinfo_summary(erec));
-
-            printf("%s\n", erec->detail);
-            DDCA_Status rc = erec->status_code;
-            errinfo_free(erec);
-            if (rc == DDCRC_NULL_RESPONSE) {
-               printf("Continuing WATCH execution\n");
-            }
-            else {
-               printf("Terminating WATCH\n");
-               return;
-            }
+      Error_Info * erec = app_read_changes(dh, force_no_fifo, &changes_reported);
+      if (erec) {
+         if (debug)
+            DBGMSG("Fatal error reading changes: %s", errinfo_summary(erec));
+
+         printf("%s\n", erec->detail);
+         DDCA_Status rc = erec->status_code;
+         errinfo_free(erec);
+         if (rc == DDCRC_NULL_RESPONSE) {
+            printf("Continuing WATCH execution\n");
+         }
+         else {
+            printf("Terminating WATCH\n");
+            return;
          }
       }
 
@@ -323,7 +309,7 @@ app_read_changes_forever(Display_Handle * dh, bool force_no_fifo) {
 
 void init_app_watch() {
    RTTI_ADD_FUNC(app_read_changes);
-#ifdef USB
-   RTTI_ADD_FUNC(app_read_changes_usb);
+#ifdef USE_USB
+   RTTI_ADD_FUNC(app_usb_vcp_changed);
 #endif
 }
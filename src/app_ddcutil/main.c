@@ -1,957 +1,1393 @@
-/** @file main.c
- *
- *  ddcutil standalone application mainline
- */
-
-// Copyright (C) 2014-2022 Sanford Rockowitz <rockowitz@minsoft.com>
-// SPDX-License-Identifier: GPL-2.0-or-later
-
-/** \cond */
-#include <config.h>
-
-#include <assert.h>
-#include <ctype.h>
-#include <errno.h>
-#include <glib-2.0/glib.h>
-#include <setjmp.h>
-#include <sys/stat.h>
-#include <stdbool.h>
-#include <stdio.h>
-
-#include <stdlib.h>
-#include <string.h>
-#include <syslog.h>
-#include <unistd.h>
-
-#include "util/data_structures.h"
-#include "util/ddcutil_config_file.h"
-#include "util/error_info.h"
-#include "util/failsim.h"
-#include "util/file_util.h"
-#include "util/glib_string_util.h"
-#include "util/i2c_util.h"
-#include "util/linux_util.h"
-#include "util/report_util.h"
-#include "util/simple_ini_file.h"
-#include "util/string_util.h"
-#include "util/subprocess_util.h"
-#include "util/sysfs_filter_functions.h"
-#include "util/sysfs_i2c_util.h"
-#include "util/sysfs_util.h"
-#include "util/xdg_util.h"
-/** \endcond */
-
-#include "public/ddcutil_types.h"
-
-#include "base/base_init.h"
-#include "base/build_info.h"
-#include "base/core.h"
-#include "base/ddc_errno.h"
-#include "base/ddc_packets.h"
-#include "base/displays.h"
-#include "base/dynamic_sleep.h"
-#include "base/linux_errno.h"
-#include "base/monitor_model_key.h"
-#include "base/parms.h"
-#include "base/rtti.h"
-#include "base/sleep.h"
-#include "base/status_code_mgt.h"
-#include "base/thread_retry_data.h"
-#include "base/thread_sleep_data.h"
-#include "base/tuned_sleep.h"
-
-#include "i2c/i2c_sysfs.h"
-
-#include "vcp/parse_capabilities.h"
-#include "vcp/persistent_capabilities.h"
-#include "vcp/vcp_feature_codes.h"
-
-#include "dynvcp/dyn_feature_files.h"
-#include "dynvcp/dyn_parsed_capabilities.h"
-
-#include "i2c/i2c_bus_core.h"
-#include "i2c/i2c_strategy_dispatcher.h"
-
+/** @file main.c
+ *
+ *  ddcutil standalone application mainline
+ */
+
+// Copyright (C) 2014-2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <config.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <setjmp.h>
+#include <sys/stat.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include "util/data_structures.h"
+#include "util/ddcutil_config_file.h"
+#include "util/error_info.h"
+#include "util/failsim.h"
+#include "util/file_util.h"
+#include "util/glib_string_util.h"
+#include "util/i2c_util.h"
+#include "util/json_writer.h"
+#include "util/linux_util.h"
+#include "util/report_util.h"
+#include "util/simple_ini_file.h"
+#include "util/string_util.h"
+#include "util/subprocess_util.h"
+#include "util/sysfs_filter_functions.h"
+#include "util/sysfs_i2c_util.h"
+#include "util/sysfs_util.h"
+#include "util/xdg_util.h"
+/** \endcond */
+
+#include "public/ddcutil_types.h"
+
+#include "base/base_init.h"
+#include "base/build_info.h"
+#include "base/core.h"
+#include "base/ddc_errno.h"
+#include "base/ddc_packets.h"
+#include "base/io_timeline.h"
+#include "base/displays.h"
+#include "base/dynamic_sleep.h"
+#include "base/execution_stats.h"
+#include "base/linux_errno.h"
+#include "base/monitor_model_key.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/sleep.h"
+#include "base/status_code_mgt.h"
+#include "base/thread_retry_data.h"
+#include "base/thread_sleep_data.h"
+#include "base/trace_ring.h"
+#include "base/tuned_sleep.h"
+
+#include "i2c/i2c_sysfs.h"
+
+#include "vcp/parse_capabilities.h"
+#include "vcp/persistent_capabilities.h"
+#include "vcp/vcp_feature_codes.h"
+
+#include "dynvcp/dyn_feature_files.h"
+#include "dynvcp/dyn_parsed_capabilities.h"
+
+#include "i2c/i2c_bus_core.h"
+#include "i2c/i2c_io_trace.h"
+#include "i2c/i2c_strategy_dispatcher.h"
+
 #ifdef USE_USB
-#include "usb/usb_displays.h"
+#include "usb/usb_displays.h"
 #endif
-
-#include "ddc/ddc_common_init.h"
-#include "ddc/ddc_displays.h"
-#include "ddc/ddc_display_ref_reports.h"
-#include "ddc/ddc_display_selection.h"
-#include "ddc/ddc_multi_part_io.h"
-#include "ddc/ddc_output.h"
-#include "ddc/ddc_packet_io.h"
-#include "ddc/ddc_read_capabilities.h"
-#include "ddc/ddc_services.h"
-#include "ddc/ddc_try_stats.h"
-#include "ddc/ddc_vcp_version.h"
-#include "ddc/ddc_vcp.h"
-
-#include "cmdline/cmd_parser_aux.h"    // for parse_feature_id_or_subset(), should it be elsewhere?
-#include "cmdline/cmd_parser.h"
-#include "cmdline/parsed_cmd.h"
-
-#include "test/testcases.h"
-
-#include "app_ddcutil/app_capabilities.h"
-#include "app_ddcutil/app_dynamic_features.h"
-#include "app_ddcutil/app_dumpload.h"
-#include "app_ddcutil/app_experimental.h"
-#include "app_ddcutil/app_interrogate.h"
-#include "app_ddcutil/app_probe.h"
-#include "app_ddcutil/app_getvcp.h"
-#include "app_ddcutil/app_services.h"
-#include "app_ddcutil/app_setvcp.h"
-#include "app_ddcutil/app_vcpinfo.h"
-#include "app_ddcutil/app_watch.h"
-#ifdef INCLUDE_TESTCASES
-#include "app_ddcutil/app_testcases.h"
-#endif
-
-#include "app_sysenv/query_sysenv.h"
-#ifdef USE_USB
-#include "app_sysenv/query_sysenv_usb.h"
+
+#include "ddc/ddc_common_init.h"
+#include "ddc/ddc_displays.h"
+#include "ddc/ddc_display_ref_reports.h"
+#include "ddc/ddc_display_selection.h"
+#include "ddc/ddc_multi_part_io.h"
+#include "ddc/ddc_output.h"
+#include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_read_capabilities.h"
+#include "ddc/ddc_services.h"
+#include "ddc/ddc_try_stats.h"
+#include "ddc/ddc_vcp_version.h"
+#include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_value_cache.h"
+
+#include "cmdline/cmd_parser_aux.h"    // for parse_feature_id_or_subset(), should it be elsewhere?
+#include "cmdline/cmd_parser.h"
+#include "cmdline/parsed_cmd.h"
+
+#include "test/testcases.h"
+
+#include "app_ddcutil/app_capabilities.h"
+#include "app_ddcutil/app_dynamic_features.h"
+#include "app_ddcutil/app_dumpload.h"
+#include "app_ddcutil/app_experimental.h"
+#include "app_ddcutil/app_interrogate.h"
+#include "app_ddcutil/app_probe.h"
+#include "app_ddcutil/app_getvcp.h"
+#include "app_ddcutil/app_services.h"
+#include "app_ddcutil/app_sample.h"
+#include "app_ddcutil/app_setvcp.h"
+#include "app_ddcutil/app_snapshot.h"
+#include "app_ddcutil/app_analyze.h"
+#include "app_ddcutil/app_server.h"
+#include "app_ddcutil/app_benchmark.h"
+#include "app_ddcutil/app_cache.h"
+#include "app_ddcutil/app_calibrate.h"
+#include "app_ddcutil/app_timeline.h"
+#include "app_ddcutil/app_vcpinfo.h"
+#include "app_ddcutil/app_watch.h"
+#ifdef INCLUDE_TESTCASES
+#include "app_ddcutil/app_testcases.h"
 #endif
-
-
-// Default trace class for this file
-static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
-
-static void add_rtti_functions();
-
-
-//
-// Report core settings and command line options
-//
-
-static void
-report_performance_options(int depth)
-{
-      int d1 = depth+1;
-      rpt_label(depth, "Performance and Retry Options:");
-      rpt_vstring(d1, "Deferred sleep enabled:                      %s", sbool( is_deferred_sleep_enabled() ) );
-#ifdef OLD   // SLEEP_SUPPRESSION
-      rpt_vstring(d1, "Sleep suppression (reduced sleeps) enabled:  %s", sbool( is_sleep_suppression_enabled() ) );
-#endif
-      bool dsa_enabled =  tsd_get_dsa_enabled_default();
-      rpt_vstring(d1, "Dynamic sleep adjustment enabled:            %s", sbool(dsa_enabled) );
-      if ( dsa_enabled )
-        rpt_vstring(d1, "Sleep multiplier factor:                %5.2f", tsd_get_sleep_multiplier_factor() );
-      rpt_nl();
-}
-
-
-static void
-report_optional_features(Parsed_Cmd * parsed_cmd, int depth) {
-   rpt_vstring( depth, "%.*s%-*s%s", 0, "", 28, "User defined features:",
-                       (enable_dynamic_features) ? "enabled" : "disabled" );
-                       // "Enable user defined features" is too long a title
-   rpt_nl();
-}
-
-
-static void
-report_all_options(Parsed_Cmd * parsed_cmd, char * config_fn, char * default_options, int depth)
-{
-    bool debug = false;
-    DBGMSF(debug, "Executing...");
-
-    show_ddcutil_version();
-    rpt_vstring(depth, "%.*s%-*s%s", 0, "", 28, "Configuration file:",
-                         (config_fn) ? config_fn : "(none)");
-    if (config_fn)
-       rpt_vstring(depth, "%.*s%-*s%s", 0, "", 28, "Configuration file options:", default_options);
-
-
-    if (parsed_cmd->output_level >= DDCA_OL_VV)
-       report_build_options(depth);
-    show_reporting();  // uses fout()
-    report_optional_features(parsed_cmd, depth);
-    report_tracing(depth);
-    report_performance_options(depth);
-    report_experimental_options(parsed_cmd, depth);
-
-    DBGMSF(debug, "Done");
-}
-
-
-//
-// Initialization functions called only once but factored out of main() to clarify mainline
-//
-
-#ifdef UNUSED
-#ifdef TARGET_LINUX
-
-static bool
-validate_environment_using_libkmod()
-{
-   bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "");
-
-   bool ok = false;
-   if (is_module_loaded_using_sysfs("i2c_dev")) {  // only finds loadable modules, not those built into kernel
-      ok = true;
-   }
-   else {
-      int module_status = module_status_using_libkmod("i2c-dev");
-      if (module_status == 0) {   // MODULE_STATUS_NOT_FOUND
-         ok = false;
-         fprintf(stderr, "Module i2c-dev is not loaded and not built into the kernel.\n");
-      }
-      else if (module_status == KERNEL_MODULE_BUILTIN) {   // 1
-         ok = true;
-      }
-      else if (module_status == KERNEL_MODULE_LOADABLE_FILE) {   //
-
-         int rc = is_module_loaded_using_libkmod("i2c_dev");
-         if (rc == 0) {
-            fprintf(stderr, "Loadable module i2c-dev exists but is not loaded.\n");
-            ok = false;
-         }
-         else if (rc == 1) {
-            ok = true;
-         }
-         else {
-            assert(rc < 0);
-            fprintf(stderr, "ddcutil cannot determine if loadable module i2c-dev is loaded.\n");
-            ok = true;  // make this just a warning, we'll fail later if not in kernel
-            fprintf(stderr, "Execution may fail.\n");
-         }
-      }
-
-      else {
-         assert(module_status < 0);
-         fprintf(stderr, "ddcutil cannot determine if module i2c-dev is loaded or built into the kernel.\n");
-         ok = true;  // make this just a warning, we'll fail later if not in kernel
-         fprintf(stderr, "Execution may fail.\n");
-      }
-   }
-
-   DBGTRC_RET_BOOL(debug, TRACE_GROUP, ok, "");
-   return ok;
-}
-#endif
-#endif
-
-
-static bool
-validate_environment()
-{
-   bool debug = false;
-   DBGMSF(debug, "Starting");
-   bool ok;
-
-   ok = dev_i2c_devices_exist();
-   if (!ok)
-      fprintf(stderr, "No /dev/i2c devices exist.\n");
-
-#ifdef OLD
-#ifdef TARGET_LINUX
-   if (is_module_loaded_using_sysfs("i2c_dev")) {
-      ok = true;
-   }
-   else {
-      ok = validate_environment_using_libkmod();
-   }
-#else
-   ok = true;
-#endif
-#endif
-
-   if (!ok) {
-      fprintf(stderr, "ddcutil requires module i2c-dev.\n");
-      // DBGMSF(debug, "Forcing ok = true");
-      // ok = true;  // make it just a warning in case we're wrong
-   }
-
-   DBGMSF(debug, "Done.    Returning: %s", sbool(ok));
-   return ok;
-}
-
-
-static void verify_i2c_access() {
-   bool debug = false;
-   DBGMSF(debug, "Starting");
-
-   Bit_Set_256 buses_without_devices = EMPTY_BIT_SET_256;
-   Bit_Set_256 inaccessible_devices  = EMPTY_BIT_SET_256;
-
-   Bit_Set_256 buses = get_possible_ddc_ci_bus_numbers();  //sysfs bus numbers, not dev-i2c
-   DBGMSF(debug, "I2C buses to check: %s", bs256_to_string(buses, "x", " "));
-   if (bs256_count(buses) > 0) {
-      Bit_Set_256_Iterator iter = bs256_iter_new(buses);
-      int busno;
-      while ( (busno = bs256_iter_next(iter)) >= 0)  {
-         char fnbuf[20];   // oversize to avoid -Wformat-truncation error
-         snprintf(fnbuf, sizeof(fnbuf), "/dev/i2c-%d", busno);
-         int rc;
-         int errsv;
-         // DBGMSF(debug, "Calling access() for %s", fnbuf);
-         rc = access(fnbuf, R_OK|W_OK);
-         if (rc < 0) {
-            errsv = errno;   // EACCESS if lack permissions, ENOENT if file doesn't exist
-            if (errsv == ENOENT) {
-               buses_without_devices = bs256_insert(buses_without_devices, busno);
-               rpt_vstring(0, "Device %s does not exist. Error = %s",
-                              fnbuf, linux_errno_desc(errsv));
-            }
-            else {
-               assert(errsv == EACCES);
-               inaccessible_devices = bs256_insert(inaccessible_devices, busno);
-               rpt_vstring(0,"Device %s is not readable and writable.  Error = %s",
-                           fnbuf, linux_errno_desc(errsv) );
-               include_open_failures_reported(busno);
-            }
-         }
-      }
-      bs256_iter_free(iter);
-   }
-
-   // DBGMSF(debug, "buses: %d", bs256_count(buses));
-   // DBGMSF(debug, "buses_without_devices: %d", bs256_count(buses_without_devices));
-   // DBGMSF(debug, "inaccessible_devices: %d",  bs256_count(inaccessible_devices));
-   if (bs256_count(buses) == 0) {
-      printf("No display adapters with i2c buses exist.\n");
-      printf("No /sys/bus/i2c buses that might be used for DDC/CI communication exist.\n");
-   }
-   else {
-      if (bs256_count(buses_without_devices) > 0) {
-         printf("/sys/bus/i2c buses without /dev/i2c-N devices: %s\n",
-                bs256_to_string_decimal(buses_without_devices, "/sys/bus/i2c/devices/i2c-", " ") );
-         printf("Driver i2c_dev must be loaded or builtin\n");
-         printf("See https://www.ddcutil.com/kernel_module\n");
-      }
-      if (bs256_count(inaccessible_devices) > 0) {
-         printf("Devices possibly used for DDC/CCI communication cannot be opened: %s\n",
-                bs256_to_string_decimal(inaccessible_devices, "/dev/i2c-", " "));
-         printf("See https://www.ddcutil.com/i2c_permissions\n");
-      }
-   }
-
-   DBGMSF(debug, "Done");
-}
-
-
-/** Master initialization function
- *
- *   \param  parsed_cmd  parsed command line
- *   \return ok if successful, false if error
- */
-static bool
-master_initializer(Parsed_Cmd * parsed_cmd) {
-   bool debug = false;
-   DBGMSF(debug, "Starting ...");
-   bool ok = false;
-   submaster_initializer(parsed_cmd);   // shared with libddcutil
-
-#ifdef ENABLE_ENVCMDS
-   if (parsed_cmd->cmd_id != CMDID_ENVIRONMENT) {
-      // will be reported by the environment command
-      if (!validate_environment())
-         goto bye;
-   }
-
-   init_sysenv();
-#else
-   if (!validate_environment())
-      goto bye;
-#endif
-
-   if (!init_experimental_options(parsed_cmd))
-      goto bye;
-   ok = true;
-
-bye:
-   DBGMSF(debug, "Done");
-   return ok;
-}
-
-
-static void
-ensure_vcp_version_set(Display_Handle * dh)
-{
-   bool debug = false;
-   DBGMSF(debug, "Starting. dh=%s", dh_repr(dh));
-   DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dh(dh);
-   if (vspec.major < 2 && get_output_level() >= DDCA_OL_NORMAL) {
-      f0printf(stdout, "VCP (aka MCCS) version for display is undetected or less than 2.0. "
-            "Output may not be accurate.\n");
-   }
-   DBGMSF(debug, "Done");
-}
-
-
-typedef enum {
-   DISPLAY_ID_REQUIRED,
-   DISPLAY_ID_USE_DEFAULT,
-   DISPLAY_ID_OPTIONAL
-} Displayid_Requirement;
-
-
-const char *
-displayid_requirement_name(Displayid_Requirement id) {
-   char * result = NULL;
-   switch (id) {
-   case DISPLAY_ID_REQUIRED:    result = "DISPLAY_ID_REQUIRED";     break;
-   case DISPLAY_ID_USE_DEFAULT: result = "DISPLAY_ID_USE_DEFAULT";  break;
-   case DISPLAY_ID_OPTIONAL:    result = "DISPLAY_ID_OPTIONAL";     break;
-   }
-   return result;
-}
-
-
-/** Returns a display reference for the display specified on the command line,
- *  or, if a display is not optional for the command, a reference to the
- *  default display (--display 1).
- *
- *  \param  parsed_cmd  parsed command line
- *  \param  displayid_required how to handle no display specified on command line
- *  \param  dref_loc  where to return display reference
- *  \retval DDCRC_OK
- *  \retval DDCRC_INVALID_DISPLAY
- */
-Status_Errno_DDC
-find_dref(
-      Parsed_Cmd * parsed_cmd,
-      Displayid_Requirement displayid_required,
-      Display_Ref ** dref_loc)
-{
-   bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "did: %s, set_default_display: %s",
-                                    did_repr(parsed_cmd->pdid),
-                                    displayid_requirement_name(displayid_required));
-   FILE * outf = fout();
-   Status_Errno_DDC final_result = DDCRC_OK;
-   Display_Ref * dref = NULL;
-   Call_Options callopts = CALLOPT_ERR_MSG;        // emit error messages
-   if (parsed_cmd->flags & CMD_FLAG_FORCE)
-      callopts |= CALLOPT_FORCE;
-
-   Display_Identifier * did_work = parsed_cmd->pdid;
-   if (did_work && did_work->id_type == DISP_ID_BUSNO) {
-      DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "Special handling for explicit --busno");
-      int busno = did_work->busno;
-      // is this really a monitor?
-      I2C_Bus_Info * businfo = i2c_detect_single_bus(busno);
-      if (businfo) {
-         if (businfo->flags & I2C_BUS_ADDR_0X50)  {
-            dref = create_bus_display_ref(busno);
-            dref->dispno = DISPNO_INVALID;      // or should it be DISPNO_NOT_SET?
-            dref->pedid = businfo->edid;    // needed?
-            dref->mmid  = monitor_model_key_new(
-                             dref->pedid->mfg_id,
-                             dref->pedid->model_name,
-                             dref->pedid->product_code);
-
-            // dref->pedid = i2c_get_parsed_edid_by_busno(did_work->busno);
-            dref->detail = businfo;
-            dref->flags |= DREF_DDC_IS_MONITOR_CHECKED;
-            dref->flags |= DREF_DDC_IS_MONITOR;
-            dref->flags |= DREF_TRANSIENT;
-            if (!ddc_initial_checks_by_dref(dref)) {
-               f0printf(outf, "DDC communication failed for monitor on bus /dev/i2c-%d\n", busno);
-               free_display_ref(dref);
-               i2c_free_bus_info(businfo);
-               dref = NULL;
-               final_result = DDCRC_INVALID_DISPLAY;
-            }
-            else {
-               DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Synthetic Display_Ref");
-               final_result = DDCRC_OK;
-            }
-         }  // has edid
-         else {   // no EDID found
-            f0printf(fout(), "No monitor detected on bus /dev/i2c-%d\n", busno);
-            i2c_free_bus_info(businfo);
-            final_result = DDCRC_INVALID_DISPLAY;
-         }
-      }    // businfo allocated
-      else {
-         f0printf(fout(), "Bus /dev/i2c-%d not found\n", busno);
-         final_result = DDCRC_INVALID_DISPLAY;
-      }
-   }       // DISP_ID_BUSNO
-   else {
-      if (!did_work && displayid_required == DISPLAY_ID_OPTIONAL) {
-         DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "No monitor specified, none required for command");
-         dref = NULL;
-         final_result = DDCRC_OK;
-      }
-      else {
-         DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "No monitor specified, treat as  --display 1");
-         bool temporary_did_work = false;
-         if (!did_work) {
-            did_work = create_dispno_display_identifier(1);   // default monitor
-            temporary_did_work = true;
-         }
-         // assert(did_work);
-         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Detecting displays...");
-         ddc_ensure_displays_detected();
-         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "display detection complete");
-         dref = get_display_ref_for_display_identifier(did_work, callopts);
-         if (temporary_did_work)
-            free_display_identifier(did_work);
-         final_result = (dref) ? DDCRC_OK : DDCRC_INVALID_DISPLAY;
-      }
-   }  // !DISP_ID_BUSNO
-
-   *dref_loc = dref;
-   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, final_result,
-                 "*dref_loc = %p -> %s",
-                 *dref_loc,
-                 dref_repr_t(*dref_loc) );
-   return final_result;
-}
-
-
-/** Execute commands that either require a display or for which a display is optional.
- *  If a display is required, it has been opened and its display handle is passed
- *  as an argument.
- *
- *  \param parsed_cmd  parsed command line
- *  \param dh          display handle, if NULL no display was specified on the
- *                     command line and the command does not require a display
- *  \retval EXIT_SUCCESS
- *  \retval EXIT_FAILURE
- */
-int
-execute_cmd_with_optional_display_handle(
-      Parsed_Cmd *     parsed_cmd,
-      Display_Handle * dh)
-{
-   bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "dh = %p -> %s", dh, dh_repr(dh));
-   int main_rc = EXIT_SUCCESS;
-
-   if (dh) {
-      if (!vcp_version_eq(parsed_cmd->mccs_vspec, DDCA_VSPEC_UNKNOWN)) {
-         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Forcing mccs_vspec=%d.%d",
-                            parsed_cmd->mccs_vspec.major, parsed_cmd->mccs_vspec.minor);
-         dh->dref->vcp_version_cmdline = parsed_cmd->mccs_vspec;
-      }
-   }
-
-   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s", cmdid_name(parsed_cmd->cmd_id));
-   switch(parsed_cmd->cmd_id) {
-
-   case CMDID_LOADVCP:
-      {
-         // check_dynamic_features();
-         // ensure_vcp_version_set();
-
-         tsd_dsa_enable(parsed_cmd->flags & CMD_FLAG_DSA);
-         // loadvcp will search monitors to find the one matching the
-         // identifiers in the record
-         ddc_ensure_displays_detected();
-         Status_Errno_DDC ddcrc = app_loadvcp_by_file(parsed_cmd->args[0], dh);
-         main_rc = (ddcrc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
-         break;
-      }
-
-   case CMDID_CAPABILITIES:
-      {
-         assert(dh);
-         app_check_dynamic_features(dh->dref);
-         ensure_vcp_version_set(dh);
-
-         DDCA_Status ddcrc = app_capabilities(dh);
-         main_rc = (ddcrc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
-         break;
-      }
-
-   case CMDID_GETVCP:
-      {
-         assert(dh);
-         app_check_dynamic_features(dh->dref);
-         ensure_vcp_version_set(dh);
-
-         Public_Status_Code psc = app_show_feature_set_values_by_dh(dh, parsed_cmd);
-         main_rc = (psc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
-      }
-      break;
-
-   case CMDID_SETVCP:
-      {
-         assert(dh);
-         app_check_dynamic_features(dh->dref);
-         ensure_vcp_version_set(dh);
-
-         int rc = app_setvcp(parsed_cmd, dh);
-         main_rc = (rc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
-      }
-      break;
-
-   case CMDID_SAVE_SETTINGS:
-      assert(dh);
-      if (parsed_cmd->argct != 0) {
-         f0printf(fout(), "SCS command takes no arguments\n");
-         main_rc = EXIT_FAILURE;
-      }
-      else if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
-         f0printf(fout(), "SCS command is not supported for USB devices\n");
-         main_rc = EXIT_FAILURE;
-      }
-      else {
-         main_rc = EXIT_SUCCESS;
-         Error_Info * ddc_excp = ddc_save_current_settings(dh);
-         if (ddc_excp)  {
-            f0printf(fout(), "Save current settings failed. rc=%s\n", psc_desc(ddc_excp->status_code));
-            if (ddc_excp->status_code == DDCRC_RETRIES)
-               f0printf(fout(), "    Try errors: %s", errinfo_causes_string(ddc_excp) );
-            errinfo_report(ddc_excp, 0);   // ** ALTERNATIVE **/
-            errinfo_free(ddc_excp);
-            // ERRINFO_FREE_WITH_REPORT(ddc_excp, report_exceptions);
-            main_rc = EXIT_FAILURE;
-         }
-      }
-      break;
-
-   case CMDID_DUMPVCP:
-      {
-         assert(dh);
-         // MCCS vspec can affect whether a feature is NC or TABLE
-         app_check_dynamic_features(dh->dref);
-         ensure_vcp_version_set(dh);
-
-         Public_Status_Code psc =
-               app_dumpvcp_as_file(dh, (parsed_cmd->argct > 0)
-                                      ? parsed_cmd->args[0]
-                                      : NULL );
-         main_rc = (psc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
-         break;
-      }
-
-   case CMDID_READCHANGES:
-      assert(dh);
-      app_check_dynamic_features(dh->dref);
-      ensure_vcp_version_set(dh);
-
-      app_read_changes_forever(dh, parsed_cmd->flags & CMD_FLAG_X52_NO_FIFO);     // only returns if fatal error
-      main_rc = EXIT_FAILURE;
-      break;
-
-   case CMDID_PROBE:
-      assert(dh);
-      app_check_dynamic_features(dh->dref);
-      ensure_vcp_version_set(dh);
-
-      app_probe_display_by_dh(dh);
-      main_rc = EXIT_SUCCESS;
-      break;
-
-   default:
-      main_rc = EXIT_FAILURE;
-      break;
-   }    // switch
-
-   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s(%d)",
-                                   (main_rc == 0) ? "EXIT_SUCCESS" : "EXIT_FAILURE",
-                                   main_rc);
-   return main_rc;
-}
-
-
-//
-// Mainline
-//
-
-/** **ddcutil** program mainline.
-  *
-  * @param argc   number of command line arguments
-  * @param argv   pointer to array of argument strings
-  *
-  * @retval  EXIT_SUCCESS normal exit
-  * @retval  EXIT_FAILURE an error occurred
-  */
-int
-main(int argc, char *argv[]) {
-   bool main_debug = false;
-   char * s = getenv("DDCUTIL_DEBUG_MAIN");
-   if (s && strlen(s) > 0)
-      main_debug = true;
-
-   int main_rc = EXIT_FAILURE;
-   bool start_time_reported = false;
-
-   time_t program_start_time = time(NULL);
-   char * program_start_time_s = asctime(localtime(&program_start_time));
-   if (program_start_time_s[strlen(program_start_time_s)-1] == 0x0a)
-        program_start_time_s[strlen(program_start_time_s)-1] = 0;
-
-   Parsed_Cmd * parsed_cmd = NULL;
-   add_rtti_functions();      // add entries for this file
-   init_base_services();      // so tracing related modules are initialized
-   DBGMSF(main_debug, "init_base_services() complete, ol = %s",
-                      output_level_name(get_output_level()) );
-
-   GPtrArray * config_file_errs = g_ptr_array_new_with_free_func(g_free);
-   char ** new_argv = NULL;
-   int     new_argc = 9;
-   char *  untokenized_cmd_prefix = NULL;
-   char *  configure_fn = NULL;
-
-   int apply_config_rc = apply_config_file(
-                    "ddcutil",     // use this section of config file
-                    argc,
-                    argv,
-                    &new_argc,
-                    &new_argv,
-                    &untokenized_cmd_prefix,
-                    &configure_fn,
-                    config_file_errs);
-#ifdef LATER
-   if (untokenized_cmd_prefix && strlen(untokenized_cmd_prefix) > 0)
-      fprintf(fout(), "Applying ddcutil options from %s: %s\n", configure_fn,
-            untokenized_cmd_prefix);
-#endif
-   DBGMSF(main_debug, "apply_config_file() returned %s", psc_desc(apply_config_rc));
-   if (config_file_errs->len > 0) {
-      f0printf(ferr(), "Errors processing ddcutil configuration file %s:\n", configure_fn);
-      for (int ndx = 0; ndx < config_file_errs->len; ndx++) {
-         char * s = g_strdup_printf("   %s\n", (char *) g_ptr_array_index(config_file_errs, ndx));
-         f0printf(ferr(), s);
-         free(s);
-      }
-   }
-   g_ptr_array_free(config_file_errs, true);
-
-   if (apply_config_rc < 0)
-      goto bye;
-
-   assert(new_argc == ntsa_length(new_argv));
-
-   if (main_debug) {
-      DBGMSG("new_argc = %d, new_argv:", new_argc);
-      rpt_ntsa(new_argv, 1);
-   }
-
-   parsed_cmd = parse_command(new_argc, new_argv, MODE_DDCUTIL);
-   DBGMSF(main_debug, "parse_command() returned %p", parsed_cmd);
-   ntsa_free(new_argv, true);
-
-   if (!parsed_cmd) {
-      goto bye;      // main_rc == EXIT_FAILURE
-   }
-
-   init_tracing(parsed_cmd);
-
-   // tracing is sufficiently initialized, can report start time
-   start_time_reported = parsed_cmd->traced_groups    ||
-                         parsed_cmd->traced_functions ||
-                         parsed_cmd->traced_files     ||
-                         IS_TRACING()                 ||
-                         main_debug;
-   if (main_debug)
-      printf("(%s) start_time_reported = %s\n", __func__, SBOOL(start_time_reported));
-   DBGMSF(start_time_reported, "Starting %s execution, %s",
-               parser_mode_name(parsed_cmd->parser_mode),
-               program_start_time_s);
-   if (trace_to_syslog) {
-      openlog("ddcutil",          // prepended to every log message
-              LOG_CONS |          // write to system console if error sending to system logger
-              LOG_PID,            // include caller's process id
-              LOG_USER);          // generic user program, syslogger can use to determine how to handle
-      syslog(LOG_INFO, "Starting.  ddcutil version %s", get_full_ddcutil_version());
-
-   }
-
-   bool ok = master_initializer(parsed_cmd);
-   if (!ok)
-      goto bye;
-   if (parsed_cmd->flags&CMD_FLAG_SHOW_SETTINGS)
-      report_all_options(parsed_cmd, configure_fn, untokenized_cmd_prefix, 0);
-
-   // xdg_tests(); // for development
-
-   // Initialization complete, rtti now contains entries for all traced functions
-   // Check that any functions specified on --trcfunc are actually traced.
-   // dbgrpt_rtti_func_name_table(0);
-   if (parsed_cmd->traced_functions) {
-      for (int ndx = 0; ndx < ntsa_length(parsed_cmd->traced_functions); ndx++) {
-         char * func_name = parsed_cmd->traced_functions[ndx];
-         // DBGMSG("Verifying: %s", func_name);
-         if (!rtti_get_func_addr_by_name(func_name)) {
-            rpt_vstring(0, "Traced function not found: %s", func_name);
-            goto bye;
-         }
-      }
-   }
-
-   if (parsed_cmd->flags & CMD_FLAG_F2) {
-      consolidated_i2c_sysfs_report(0);
-      // rpt_label(0, "*** Tests Done ***");
-      // rpt_nl();
-   }
-
-   Call_Options callopts = CALLOPT_NONE;
-   if (parsed_cmd->flags & CMD_FLAG_FORCE)
-      callopts |= CALLOPT_FORCE;
-
-   main_rc = EXIT_SUCCESS;     // from now on assume success;
-   DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Initialization complete, process commands");
-
-   if (parsed_cmd->cmd_id == CMDID_LISTVCP) {    // vestigial
-      app_listvcp(stdout);
-      main_rc = EXIT_SUCCESS;
-   }
-
-   else if (parsed_cmd->cmd_id == CMDID_VCPINFO) {
-      bool vcpinfo_ok = app_vcpinfo(parsed_cmd);
-      main_rc = (vcpinfo_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
-   }
-
-#ifdef INCLUDE_TESTCASES
-   else if (parsed_cmd->cmd_id == CMDID_LISTTESTS) {
-      show_test_cases();
-      main_rc = EXIT_SUCCESS;
-   }
-#endif
-
-   // start of commands that actually access monitors
-
-   else if (parsed_cmd->cmd_id == CMDID_DETECT) {
-      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Detecting displays...");
-      verify_i2c_access();
-
-      if ( parsed_cmd->flags & CMD_FLAG_F4) {
-         test_display_detection_variants();
-      }
-      else {     // normal case
-         ddc_ensure_displays_detected();
-         ddc_report_displays(/*include_invalid_displays=*/ true, 0);
-      }
-      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Display detection complete");
-      main_rc = EXIT_SUCCESS;
-   }
-
-#ifdef INCLUDE_TESTCASES
-   else if (parsed_cmd->cmd_id == CMDID_TESTCASE) {
-      bool ok = app_testcases(parsed_cmd);
-      main_rc = (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
-   }
-#endif
-
-
-#ifdef ENABLE_ENVCMDS
-   else if (parsed_cmd->cmd_id == CMDID_ENVIRONMENT) {
-      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command ENVIRONMENT...");
-      dup2(1,2);   // redirect stderr to stdout
-      query_sysenv();
-      main_rc = EXIT_SUCCESS;
-   }
-
-   else if (parsed_cmd->cmd_id == CMDID_USBENV) {
-#ifdef USE_USB
-      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command USBENV...");
-      dup2(1,2);   // redirect stderr to stdout
-      query_usbenv();
-      main_rc = EXIT_SUCCESS;
-#else
-      f0printf(fout(), "ddcutil was not built with support for USB connected monitors\n");
-      main_rc = EXIT_FAILURE;
-#endif
-   }
-#endif
-
-   else if (parsed_cmd->cmd_id == CMDID_CHKUSBMON) {
-#ifdef USE_USB
-      // DBGMSG("Processing command chkusbmon...\n");
-      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command CHKUSBMON...");
-      bool is_monitor = check_usb_monitor( parsed_cmd->args[0] );
-      main_rc = (is_monitor) ? EXIT_SUCCESS : EXIT_FAILURE;
-#else
-      PROGRAM_LOGIC_ERROR("ddcutil not built with USB support");
-      main_rc = EXIT_FAILURE;
-#endif
-   }
-
-#ifdef ENABLE_ENVCMDS
-   else if (parsed_cmd->cmd_id == CMDID_INTERROGATE) {
-      app_interrogate(parsed_cmd);
-      main_rc = EXIT_SUCCESS;
-   }
-#endif
-
-   // *** Commands that may require Display Identifier ***
-   else {
-      verify_i2c_access();
-      Display_Ref * dref = NULL;
-      Status_Errno_DDC  rc =
-      find_dref(parsed_cmd,
-               (parsed_cmd->cmd_id == CMDID_LOADVCP) ? DISPLAY_ID_OPTIONAL : DISPLAY_ID_REQUIRED,
-               &dref);
-      if (rc != DDCRC_OK) {
-         main_rc = EXIT_FAILURE;
-      }
-      else {
-         Display_Handle * dh = NULL;
-         if (dref) {
-            DBGMSF(main_debug,
-                   "mainline - display detection complete, about to call ddc_open_display() for dref" );
-            Status_Errno_DDC ddcrc = ddc_open_display(dref, callopts |CALLOPT_ERR_MSG, &dh);
-            ASSERT_IFF( (ddcrc==0), dh);
-            if (!dh) {
-               f0printf(ferr(), "Error %s opening display ref %s", psc_desc(ddcrc), dref_repr_t(dref));
-               main_rc = EXIT_FAILURE;
-            }
-         }  // dref
-
-         if (main_rc == EXIT_SUCCESS) {
-            // affects all current threads and new threads
-            tsd_dsa_enable_globally(parsed_cmd->flags & CMD_FLAG_DSA);
-            main_rc = execute_cmd_with_optional_display_handle(parsed_cmd, dh);
-         }
-
-         if (dh)
-               ddc_close_display(dh);
-         if (dref && (dref->flags & DREF_TRANSIENT))
-            free_display_ref(dref);
-      }
-   }
-
-   if (parsed_cmd->stats_types != DDCA_STATS_NONE
-#ifdef ENABLE_ENVCMDS
-         && parsed_cmd->cmd_id != CMDID_INTERROGATE
-#endif
-      )
-   {
-      ddc_report_stats_main(parsed_cmd->stats_types, parsed_cmd->flags & CMD_FLAG_PER_THREAD_STATS, 0);
-      // report_timestamp_history();  // debugging function
-   }
-
-bye:
-   free(untokenized_cmd_prefix);
-   free(configure_fn);
-   free_regex_hash_table();
-   DBGTRC_DONE(main_debug, TRACE_GROUP, "main_rc=%d", main_rc);
-
-   time_t end_time = time(NULL);
-   char * end_time_s = asctime(localtime(&end_time));
-   if (end_time_s[strlen(end_time_s)-1] == 0x0a)
-      end_time_s[strlen(end_time_s)-1] = 0;
-   DBGMSF(start_time_reported, "ddcutil execution complete, %s", end_time_s);
-
-   if (parsed_cmd)
-      free_parsed_cmd(parsed_cmd);
-   release_base_services();
-   if (trace_to_syslog) {
-      syslog(LOG_INFO, "Terminating. Returning %d", main_rc);
-      closelog();
-   }
-   return main_rc;
-}
-
-
-static void add_rtti_functions() {
-   RTTI_ADD_FUNC(main);
-   RTTI_ADD_FUNC(execute_cmd_with_optional_display_handle);
-   RTTI_ADD_FUNC(find_dref);
-#ifdef UNUSED
-#ifdef TARGET_LINUX
-   RTTI_ADD_FUNC(validate_environment_using_libkmod);
-#endif
-#endif
-   init_app_services();
-}
+
+#include "app_sysenv/query_sysenv.h"
+#ifdef USE_USB
+#include "app_sysenv/query_sysenv_usb.h"
+#endif
+
+
+// Default trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+static void add_rtti_functions();
+
+
+//
+// Report core settings and command line options
+//
+
+static void
+report_performance_options(int depth)
+{
+      int d1 = depth+1;
+      rpt_label(depth, "Performance and Retry Options:");
+      rpt_vstring(d1, "Deferred sleep enabled:                      %s", sbool( is_deferred_sleep_enabled() ) );
+#ifdef OLD   // SLEEP_SUPPRESSION
+      rpt_vstring(d1, "Sleep suppression (reduced sleeps) enabled:  %s", sbool( is_sleep_suppression_enabled() ) );
+#endif
+      bool dsa_enabled =  tsd_get_dsa_enabled_default();
+      rpt_vstring(d1, "Dynamic sleep adjustment enabled:            %s", sbool(dsa_enabled) );
+      if ( dsa_enabled )
+        rpt_vstring(d1, "Sleep multiplier factor:                %5.2f", tsd_get_sleep_multiplier_factor() );
+      rpt_nl();
+}
+
+
+static void
+report_optional_features(Parsed_Cmd * parsed_cmd, int depth) {
+   rpt_vstring( depth, "%.*s%-*s%s", 0, "", 28, "User defined features:",
+                       (enable_dynamic_features) ? "enabled" : "disabled" );
+                       // "Enable user defined features" is too long a title
+   rpt_nl();
+}
+
+
+static void
+report_all_options(Parsed_Cmd * parsed_cmd, char * config_fn, char * default_options, int depth)
+{
+    bool debug = false;
+    DBGMSF(debug, "Executing...");
+
+    show_ddcutil_version();
+    rpt_vstring(depth, "%.*s%-*s%s", 0, "", 28, "Configuration file:",
+                         (config_fn) ? config_fn : "(none)");
+    if (config_fn)
+       rpt_vstring(depth, "%.*s%-*s%s", 0, "", 28, "Configuration file options:", default_options);
+
+
+    if (parsed_cmd->output_level >= DDCA_OL_VV)
+       report_build_options(depth);
+    show_reporting();  // uses fout()
+    report_optional_features(parsed_cmd, depth);
+    report_tracing(depth);
+    report_performance_options(depth);
+    report_experimental_options(parsed_cmd, depth);
+
+    DBGMSF(debug, "Done");
+}
+
+
+//
+// Initialization functions called only once but factored out of main() to clarify mainline
+//
+
+#ifdef UNUSED
+#ifdef TARGET_LINUX
+
+static bool
+validate_environment_using_libkmod()
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   bool ok = false;
+   if (is_module_loaded_using_sysfs("i2c_dev")) {  // only finds loadable modules, not those built into kernel
+      ok = true;
+   }
+   else {
+      int module_status = module_status_using_libkmod("i2c-dev");
+      if (module_status == 0) {   // MODULE_STATUS_NOT_FOUND
+         ok = false;
+         fprintf(stderr, "Module i2c-dev is not loaded and not built into the kernel.\n");
+      }
+      else if (module_status == KERNEL_MODULE_BUILTIN) {   // 1
+         ok = true;
+      }
+      else if (module_status == KERNEL_MODULE_LOADABLE_FILE) {   //
+
+         int rc = is_module_loaded_using_libkmod("i2c_dev");
+         if (rc == 0) {
+            fprintf(stderr, "Loadable module i2c-dev exists but is not loaded.\n");
+            ok = false;
+         }
+         else if (rc == 1) {
+            ok = true;
+         }
+         else {
+            assert(rc < 0);
+            fprintf(stderr, "ddcutil cannot determine if loadable module i2c-dev is loaded.\n");
+            ok = true;  // make this just a warning, we'll fail later if not in kernel
+            fprintf(stderr, "Execution may fail.\n");
+         }
+      }
+
+      else {
+         assert(module_status < 0);
+         fprintf(stderr, "ddcutil cannot determine if module i2c-dev is loaded or built into the kernel.\n");
+         ok = true;  // make this just a warning, we'll fail later if not in kernel
+         fprintf(stderr, "Execution may fail.\n");
+      }
+   }
+
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, ok, "");
+   return ok;
+}
+#endif
+#endif
+
+
+static bool
+validate_environment()
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting");
+   bool ok;
+
+   ok = dev_i2c_devices_exist();
+   if (!ok)
+      fprintf(stderr, "No /dev/i2c devices exist.\n");
+
+#ifdef OLD
+#ifdef TARGET_LINUX
+   if (is_module_loaded_using_sysfs("i2c_dev")) {
+      ok = true;
+   }
+   else {
+      ok = validate_environment_using_libkmod();
+   }
+#else
+   ok = true;
+#endif
+#endif
+
+   if (!ok) {
+      fprintf(stderr, "ddcutil requires module i2c-dev.\n");
+      // DBGMSF(debug, "Forcing ok = true");
+      // ok = true;  // make it just a warning in case we're wrong
+   }
+
+   DBGMSF(debug, "Done.    Returning: %s", sbool(ok));
+   return ok;
+}
+
+
+static void verify_i2c_access() {
+   bool debug = false;
+   DBGMSF(debug, "Starting");
+
+   Bit_Set_256 buses_without_devices = EMPTY_BIT_SET_256;
+   Bit_Set_256 inaccessible_devices  = EMPTY_BIT_SET_256;
+
+   Bit_Set_256 buses = get_possible_ddc_ci_bus_numbers();  //sysfs bus numbers, not dev-i2c
+   DBGMSF(debug, "I2C buses to check: %s", bs256_to_string(buses, "x", " "));
+   if (bs256_count(buses) > 0) {
+      Bit_Set_256_Iterator iter = bs256_iter_new(buses);
+      int busno;
+      while ( (busno = bs256_iter_next(iter)) >= 0)  {
+         char fnbuf[20];   // oversize to avoid -Wformat-truncation error
+         snprintf(fnbuf, sizeof(fnbuf), "/dev/i2c-%d", busno);
+         int rc;
+         int errsv;
+         // DBGMSF(debug, "Calling access() for %s", fnbuf);
+         rc = access(fnbuf, R_OK|W_OK);
+         if (rc < 0) {
+            errsv = errno;   // EACCESS if lack permissions, ENOENT if file doesn't exist
+            if (errsv == ENOENT) {
+               buses_without_devices = bs256_insert(buses_without_devices, busno);
+               rpt_vstring(0, "Device %s does not exist. Error = %s",
+                              fnbuf, linux_errno_desc(errsv));
+            }
+            else {
+               assert(errsv == EACCES);
+               inaccessible_devices = bs256_insert(inaccessible_devices, busno);
+               rpt_vstring(0,"Device %s is not readable and writable.  Error = %s",
+                           fnbuf, linux_errno_desc(errsv) );
+               include_open_failures_reported(busno);
+            }
+         }
+      }
+      bs256_iter_free(iter);
+   }
+
+   // DBGMSF(debug, "buses: %d", bs256_count(buses));
+   // DBGMSF(debug, "buses_without_devices: %d", bs256_count(buses_without_devices));
+   // DBGMSF(debug, "inaccessible_devices: %d",  bs256_count(inaccessible_devices));
+   if (bs256_count(buses) == 0) {
+      printf("No display adapters with i2c buses exist.\n");
+      printf("No /sys/bus/i2c buses that might be used for DDC/CI communication exist.\n");
+   }
+   else {
+      if (bs256_count(buses_without_devices) > 0) {
+         printf("/sys/bus/i2c buses without /dev/i2c-N devices: %s\n",
+                bs256_to_string_decimal(buses_without_devices, "/sys/bus/i2c/devices/i2c-", " ") );
+         printf("Driver i2c_dev must be loaded or builtin\n");
+         printf("See https://www.ddcutil.com/kernel_module\n");
+      }
+      if (bs256_count(inaccessible_devices) > 0) {
+         printf("Devices possibly used for DDC/CCI communication cannot be opened: %s\n",
+                bs256_to_string_decimal(inaccessible_devices, "/dev/i2c-", " "));
+         printf("See https://www.ddcutil.com/i2c_permissions\n");
+      }
+   }
+
+   DBGMSF(debug, "Done");
+}
+
+
+/** Master initialization function
+ *
+ *   \param  parsed_cmd  parsed command line
+ *   \return ok if successful, false if error
+ */
+static bool
+master_initializer(Parsed_Cmd * parsed_cmd) {
+   bool debug = false;
+   DBGMSF(debug, "Starting ...");
+   bool ok = false;
+   submaster_initializer(parsed_cmd);   // shared with libddcutil
+
+#ifdef ENABLE_ENVCMDS
+   if (parsed_cmd->cmd_id != CMDID_ENVIRONMENT) {
+      // will be reported by the environment command
+      if (!validate_environment())
+         goto bye;
+   }
+
+   init_sysenv();
+#else
+   if (!validate_environment())
+      goto bye;
+#endif
+
+   if (!init_experimental_options(parsed_cmd))
+      goto bye;
+   ok = true;
+
+bye:
+   DBGMSF(debug, "Done");
+   return ok;
+}
+
+
+static void
+ensure_vcp_version_set(Display_Handle * dh)
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting. dh=%s", dh_repr(dh));
+   DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dh(dh);
+   if (vspec.major < 2 && get_output_level() >= DDCA_OL_NORMAL) {
+      f0printf(stdout, "VCP (aka MCCS) version for display is undetected or less than 2.0. "
+            "Output may not be accurate.\n");
+   }
+   DBGMSF(debug, "Done");
+}
+
+
+typedef enum {
+   DISPLAY_ID_REQUIRED,
+   DISPLAY_ID_USE_DEFAULT,
+   DISPLAY_ID_OPTIONAL
+} Displayid_Requirement;
+
+
+const char *
+displayid_requirement_name(Displayid_Requirement id) {
+   char * result = NULL;
+   switch (id) {
+   case DISPLAY_ID_REQUIRED:    result = "DISPLAY_ID_REQUIRED";     break;
+   case DISPLAY_ID_USE_DEFAULT: result = "DISPLAY_ID_USE_DEFAULT";  break;
+   case DISPLAY_ID_OPTIONAL:    result = "DISPLAY_ID_OPTIONAL";     break;
+   }
+   return result;
+}
+
+
+/** Returns a display reference for the display specified on the command line,
+ *  or, if a display is not optional for the command, a reference to the
+ *  default display (--display 1).
+ *
+ *  \param  parsed_cmd  parsed command line
+ *  \param  displayid_required how to handle no display specified on command line
+ *  \param  dref_loc  where to return display reference
+ *  \retval DDCRC_OK
+ *  \retval DDCRC_INVALID_DISPLAY
+ */
+Status_Errno_DDC
+find_dref(
+      Parsed_Cmd * parsed_cmd,
+      Displayid_Requirement displayid_required,
+      Display_Ref ** dref_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "did: %s, set_default_display: %s",
+                                    did_repr(parsed_cmd->pdid),
+                                    displayid_requirement_name(displayid_required));
+   FILE * outf = fout();
+   Status_Errno_DDC final_result = DDCRC_OK;
+   Display_Ref * dref = NULL;
+   Call_Options callopts = CALLOPT_ERR_MSG;        // emit error messages
+   if (parsed_cmd->flags & CMD_FLAG_FORCE)
+      callopts |= CALLOPT_FORCE;
+
+   Display_Identifier * did_work = parsed_cmd->pdid;
+   if (did_work && did_work->id_type == DISP_ID_BUSNO) {
+      DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "Special handling for explicit --busno");
+      int busno = did_work->busno;
+      // is this really a monitor?
+      I2C_Bus_Info * businfo = i2c_detect_single_bus(busno);
+      if (businfo) {
+         if (businfo->flags & I2C_BUS_ADDR_0X50)  {
+            dref = create_bus_display_ref(busno);
+            dref->dispno = DISPNO_INVALID;      // or should it be DISPNO_NOT_SET?
+            dref->pedid = businfo->edid;    // needed?
+            dref->mmid  = monitor_model_key_new(
+                             dref->pedid->mfg_id,
+                             dref->pedid->model_name,
+                             dref->pedid->product_code);
+
+            // dref->pedid = i2c_get_parsed_edid_by_busno(did_work->busno);
+            dref->detail = businfo;
+            dref->flags |= DREF_DDC_IS_MONITOR_CHECKED;
+            dref->flags |= DREF_DDC_IS_MONITOR;
+            dref->flags |= DREF_TRANSIENT;
+            if (!ddc_initial_checks_by_dref(dref)) {
+               f0printf(outf, "DDC communication failed for monitor on bus /dev/i2c-%d\n", busno);
+               free_display_ref(dref);
+               i2c_free_bus_info(businfo);
+               dref = NULL;
+               final_result = DDCRC_INVALID_DISPLAY;
+            }
+            else {
+               DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Synthetic Display_Ref");
+               final_result = DDCRC_OK;
+            }
+         }  // has edid
+         else {   // no EDID found
+            f0printf(fout(), "No monitor detected on bus /dev/i2c-%d\n", busno);
+            i2c_free_bus_info(businfo);
+            final_result = DDCRC_INVALID_DISPLAY;
+         }
+      }    // businfo allocated
+      else {
+         f0printf(fout(), "Bus /dev/i2c-%d not found\n", busno);
+         final_result = DDCRC_INVALID_DISPLAY;
+      }
+   }       // DISP_ID_BUSNO
+   else {
+      if (!did_work && displayid_required == DISPLAY_ID_OPTIONAL) {
+         DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "No monitor specified, none required for command");
+         dref = NULL;
+         final_result = DDCRC_OK;
+      }
+      else {
+         DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "No monitor specified, treat as  --display 1");
+         bool temporary_did_work = false;
+         if (!did_work) {
+            did_work = create_dispno_display_identifier(1);   // default monitor
+            temporary_did_work = true;
+         }
+         // assert(did_work);
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Detecting displays...");
+         ddc_ensure_displays_detected();
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "display detection complete");
+         dref = get_display_ref_for_display_identifier(did_work, callopts);
+         if (temporary_did_work)
+            free_display_identifier(did_work);
+         final_result = (dref) ? DDCRC_OK : DDCRC_INVALID_DISPLAY;
+      }
+   }  // !DISP_ID_BUSNO
+
+   *dref_loc = dref;
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, final_result,
+                 "*dref_loc = %p -> %s",
+                 *dref_loc,
+                 dref_repr_t(*dref_loc) );
+   return final_result;
+}
+
+
+/** Execute commands that either require a display or for which a display is optional.
+ *  If a display is required, it has been opened and its display handle is passed
+ *  as an argument.
+ *
+ *  \param parsed_cmd  parsed command line
+ *  \param dh          display handle, if NULL no display was specified on the
+ *                     command line and the command does not require a display
+ *  \retval EXIT_SUCCESS
+ *  \retval EXIT_FAILURE
+ */
+int
+execute_cmd_with_optional_display_handle(
+      Parsed_Cmd *     parsed_cmd,
+      Display_Handle * dh)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh = %p -> %s", dh, dh_repr(dh));
+   int main_rc = EXIT_SUCCESS;
+
+   if (dh) {
+      if (!vcp_version_eq(parsed_cmd->mccs_vspec, DDCA_VSPEC_UNKNOWN)) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Forcing mccs_vspec=%d.%d",
+                            parsed_cmd->mccs_vspec.major, parsed_cmd->mccs_vspec.minor);
+         dh->dref->vcp_version_cmdline = parsed_cmd->mccs_vspec;
+      }
+   }
+
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s", cmdid_name(parsed_cmd->cmd_id));
+   switch(parsed_cmd->cmd_id) {
+
+   case CMDID_LOADVCP:
+      {
+         // check_dynamic_features();
+         // ensure_vcp_version_set();
+
+         tsd_dsa_enable(parsed_cmd->flags & CMD_FLAG_DSA);
+         // loadvcp will search monitors to find the one matching the
+         // identifiers in the record
+         ddc_ensure_displays_detected();
+         Status_Errno_DDC ddcrc = 0;
+         if (parsed_cmd->argct == 1)
+            ddcrc = app_loadvcp_by_file(parsed_cmd->args[0], dh);
+         else if (dh) {
+            f0printf(ferr(), "A display cannot be specified when loading multiple files\n");
+            ddcrc = DDCRC_ARG;
+         }
+         else
+            ddcrc = app_loadvcp_by_files(parsed_cmd->args, parsed_cmd->argct);
+         main_rc = (ddcrc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+         break;
+      }
+
+   case CMDID_CAPABILITIES:
+      {
+         assert(dh);
+         app_check_dynamic_features(dh->dref);
+         ensure_vcp_version_set(dh);
+
+         DDCA_Status ddcrc = app_capabilities(dh, parsed_cmd->flags & CMD_FLAG_JSON);
+         main_rc = (ddcrc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
+         break;
+      }
+
+   case CMDID_GETVCP:
+      {
+         assert(dh);
+         app_check_dynamic_features(dh->dref);
+         ensure_vcp_version_set(dh);
+
+         Public_Status_Code psc = app_show_feature_set_values_by_dh(dh, parsed_cmd);
+         main_rc = (psc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
+      }
+      break;
+
+   case CMDID_SETVCP:
+      {
+         assert(dh);
+         app_check_dynamic_features(dh->dref);
+         ensure_vcp_version_set(dh);
+
+         int rc = app_setvcp(parsed_cmd, dh);
+         main_rc = (rc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+      }
+      break;
+
+   case CMDID_SAVE_SETTINGS:
+      assert(dh);
+      if (parsed_cmd->argct != 0) {
+         f0printf(fout(), "SCS command takes no arguments\n");
+         main_rc = EXIT_FAILURE;
+      }
+      else if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
+         f0printf(fout(), "SCS command is not supported for USB devices\n");
+         main_rc = EXIT_FAILURE;
+      }
+      else {
+         main_rc = EXIT_SUCCESS;
+         Error_Info * ddc_excp = ddc_save_current_settings(dh);
+         if (ddc_excp)  {
+            f0printf(fout(), "Save current settings failed. rc=%s\n", psc_desc(ddc_excp->status_code));
+            if (ddc_excp->status_code == DDCRC_RETRIES)
+               f0printf(fout(), "    Try errors: %s", errinfo_causes_string(ddc_excp) );
+            errinfo_report(ddc_excp, 0);   // ** ALTERNATIVE **/
+            errinfo_free(ddc_excp);
+            // ERRINFO_FREE_WITH_REPORT(ddc_excp, report_exceptions);
+            main_rc = EXIT_FAILURE;
+         }
+      }
+      break;
+
+   case CMDID_DUMPVCP:
+      {
+         assert(dh);
+         // MCCS vspec can affect whether a feature is NC or TABLE
+         app_check_dynamic_features(dh->dref);
+         ensure_vcp_version_set(dh);
+
+         Public_Status_Code psc =
+               app_dumpvcp_as_file(dh, (parsed_cmd->argct > 0)
+                                      ? parsed_cmd->args[0]
+                                      : NULL,
+                                   parsed_cmd->flags & CMD_FLAG_JSON,
+                                   parsed_cmd->flags & CMD_FLAG_SNAPSHOT);
+         main_rc = (psc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
+         break;
+      }
+
+   case CMDID_READCHANGES:
+      assert(dh);
+      app_check_dynamic_features(dh->dref);
+      ensure_vcp_version_set(dh);
+
+      app_read_changes_forever(dh, parsed_cmd->flags & CMD_FLAG_X52_NO_FIFO);     // only returns if fatal error
+      main_rc = EXIT_FAILURE;
+      break;
+
+   case CMDID_PROBE:
+      assert(dh);
+      app_check_dynamic_features(dh->dref);
+      ensure_vcp_version_set(dh);
+
+      app_probe_display_by_dh(dh, parsed_cmd->flags & CMD_FLAG_PROBE_EXPRESS);
+      main_rc = EXIT_SUCCESS;
+      break;
+
+   case CMDID_CALIBRATE:
+      assert(dh);
+      main_rc = (app_calibrate(parsed_cmd, dh)) ? EXIT_SUCCESS : EXIT_FAILURE;
+      break;
+
+   default:
+      main_rc = EXIT_FAILURE;
+      break;
+   }    // switch
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s(%d)",
+                                   (main_rc == 0) ? "EXIT_SUCCESS" : "EXIT_FAILURE",
+                                   main_rc);
+   return main_rc;
+}
+
+
+//
+// Batch command
+//
+
+/** A display opened by the batch command */
+typedef struct {
+   char *           key;     // did_repr() of the display identifier, "" for the default display
+   Display_Ref *    dref;
+   Display_Handle * dh;
+   bool             alias;   // another identifier for a display opened by an earlier entry
+} Batch_Display;
+
+
+/** Parses one line of a batch script as a **ddcutil** command line.
+ *
+ *  Options that are given on the line override those given on the batch
+ *  command line, all others are taken from the batch command line.
+ *
+ *  \param  line           script line
+ *  \param  batch_cmd      parsed batch command line
+ *  \param  default_flags  flags set when no options are specified
+ *  \return parsed command, NULL if invalid
+ */
+static Parsed_Cmd *
+parse_batch_line(
+      const char * line,
+      Parsed_Cmd * batch_cmd,
+      uint64_t     default_flags)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "line=|%s|", line);
+
+   gint     tokenct = 0;
+   gchar ** tokens = NULL;
+   GError * gerror = NULL;
+   Parsed_Cmd * line_cmd = NULL;
+   if (!g_shell_parse_argv(line, &tokenct, &tokens, &gerror)) {
+      f0printf(ferr(), "Invalid command: %s\n", gerror->message);
+      g_error_free(gerror);
+   }
+   else {
+      char ** line_argv = calloc(tokenct+2, sizeof(char*));
+      line_argv[0] = "ddcutil";
+      for (int ndx = 0; ndx < tokenct; ndx++)
+         line_argv[ndx+1] = tokens[ndx];
+      line_cmd = parse_command(tokenct+1, line_argv, MODE_DDCUTIL);
+      free(line_argv);
+      g_strfreev(tokens);
+   }
+
+   if (line_cmd) {
+      switch (line_cmd->cmd_id) {
+      case CMDID_GETVCP:
+      case CMDID_SETVCP:
+      case CMDID_CAPABILITIES:
+      case CMDID_SAVE_SETTINGS:
+         break;
+      default:
+         f0printf(ferr(), "Command %s is not valid in a batch\n", cmdid_name(line_cmd->cmd_id));
+         free_parsed_cmd(line_cmd);
+         line_cmd = NULL;
+      }
+   }
+
+   if (line_cmd) {
+      uint64_t line_options = line_cmd->flags ^ default_flags;
+      line_cmd->flags = (batch_cmd->flags & ~line_options) | (line_cmd->flags & line_options);
+      if (vcp_version_eq(line_cmd->mccs_vspec, DDCA_VSPEC_UNKNOWN))
+         line_cmd->mccs_vspec = batch_cmd->mccs_vspec;
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %p", line_cmd);
+   return line_cmd;
+}
+
+
+/** Returns the open display handle for the display a batch command applies to,
+ *  opening the display if this is the first command for it.
+ *
+ *  \param  batch_displays  displays already opened
+ *  \param  line_cmd        parsed script line
+ *  \param  batch_cmd       parsed batch command line
+ *  \param  callopts        options for ddc_open_display()
+ *  \return display handle, NULL if the display cannot be found or opened
+ */
+static Display_Handle *
+get_batch_display_handle(
+      GPtrArray *  batch_displays,
+      Parsed_Cmd * line_cmd,
+      Parsed_Cmd * batch_cmd,
+      Call_Options callopts)
+{
+   bool debug = false;
+   Display_Identifier * line_pdid = line_cmd->pdid;
+   if (!line_cmd->pdid)
+      line_cmd->pdid = batch_cmd->pdid;
+   char * key = (line_cmd->pdid) ? did_repr(line_cmd->pdid) : "";
+   DBGTRC_STARTING(debug, TRACE_GROUP, "key=%s", key);
+
+   Display_Handle * dh = NULL;
+   for (int ndx = 0; ndx < batch_displays->len && !dh; ndx++) {
+      Batch_Display * bd = g_ptr_array_index(batch_displays, ndx);
+      if (streq(bd->key, key))
+         dh = bd->dh;
+   }
+   if (!dh) {
+      Display_Ref * dref = NULL;
+      if (find_dref(line_cmd, DISPLAY_ID_REQUIRED, &dref) == DDCRC_OK) {
+         // the display may already be open under a different identifier
+         bool alias = false;
+         for (int ndx = 0; ndx < batch_displays->len && !dh; ndx++) {
+            Batch_Display * bd = g_ptr_array_index(batch_displays, ndx);
+            if (dpath_eq(bd->dref->io_path, dref->io_path)) {
+               dh = bd->dh;
+               alias = true;
+               if (dref != bd->dref && (dref->flags & DREF_TRANSIENT))
+                  free_display_ref(dref);
+               dref = bd->dref;
+            }
+         }
+         Status_Errno_DDC ddcrc = 0;
+         if (!dh)
+            ddcrc = ddc_open_display(dref, callopts | CALLOPT_ERR_MSG, &dh);
+         if (dh) {
+            Batch_Display * bd = calloc(1, sizeof(Batch_Display));
+            bd->key   = strdup(key);
+            bd->dref  = dref;
+            bd->dh    = dh;
+            bd->alias = alias;
+            g_ptr_array_add(batch_displays, bd);
+         }
+         else {
+            f0printf(ferr(), "Error %s opening display ref %s\n", psc_desc(ddcrc), dref_repr_t(dref));
+            if (dref->flags & DREF_TRANSIENT)
+               free_display_ref(dref);
+         }
+      }
+   }
+   line_cmd->pdid = line_pdid;
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", dh_repr(dh));
+   return dh;
+}
+
+
+/** Executes the commands in a batch script.
+ *
+ *  Each line of the script is a getvcp, setvcp, capabilities, or scs
+ *  command, optionally with display selection and command specific options.
+ *  Displays are detected once, each display is opened when the first
+ *  command for it is executed and remains open until the script completes,
+ *  and sleeps are deferred across commands.  The output of each command
+ *  is written as soon as it completes.
+ *
+ *  \param  batch_cmd  parsed batch command line
+ *  \param  callopts   options for ddc_open_display()
+ *  \retval EXIT_SUCCESS  all commands succeeded
+ *  \retval EXIT_FAILURE  at least one command failed, or the script could not be read
+ */
+static int
+execute_batch(
+      Parsed_Cmd * batch_cmd,
+      Call_Options callopts)
+{
+   bool debug = false;
+   char * fn = (batch_cmd->argct > 0) ? batch_cmd->args[0] : "-";
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn=%s", fn);
+
+   FILE * script = (streq(fn, "-")) ? stdin : fopen(fn, "r");
+   if (!script) {
+      f0printf(ferr(), "Unable to open %s: %s\n", fn, strerror(errno));
+      DBGTRC_DONE(debug, TRACE_GROUP, "Returning EXIT_FAILURE");
+      return EXIT_FAILURE;
+   }
+
+   // flags that are set if a line contains no options
+   uint64_t default_flags = 0;
+   char * default_argv[] = {"ddcutil", "detect", NULL};
+   Parsed_Cmd * default_cmd = parse_command(2, default_argv, MODE_DDCUTIL);
+   if (default_cmd) {
+      default_flags = default_cmd->flags;
+      free_parsed_cmd(default_cmd);
+   }
+
+   GPtrArray * batch_displays = g_ptr_array_new();
+   bool saved_deferred_sleep = enable_deferred_sleep_for_thread(true);
+   bool saved_value_cache = ddc_enable_vcp_value_cache(true);   // e.g. base for relative setvcp
+   int main_rc = EXIT_SUCCESS;
+   char * line = NULL;
+   size_t linesz = 0;
+   int linectr = 0;
+   while (getline(&line, &linesz, script) >= 0) {
+      linectr++;
+      char * trimmed = g_strstrip(line);
+      if (strlen(trimmed) == 0 || trimmed[0] == '#')
+         continue;
+      if (get_output_level() >= DDCA_OL_VERBOSE)
+         f0printf(fout(), "Line %d: %s\n", linectr, trimmed);
+
+      int line_rc = EXIT_FAILURE;
+      Parsed_Cmd * line_cmd = parse_batch_line(trimmed, batch_cmd, default_flags);
+      if (line_cmd) {
+         Display_Handle * dh =
+               get_batch_display_handle(batch_displays, line_cmd, batch_cmd, callopts);
+         if (dh)
+            line_rc = execute_cmd_with_optional_display_handle(line_cmd, dh);
+         free_parsed_cmd(line_cmd);
+      }
+      if (line_rc != EXIT_SUCCESS) {
+         f0printf(ferr(), "Batch command at line %d failed: %s\n", linectr, trimmed);
+         main_rc = EXIT_FAILURE;
+      }
+      fflush(fout());
+      fflush(ferr());
+   }
+   free(line);
+   if (script != stdin)
+      fclose(script);
+
+   for (int ndx = 0; ndx < batch_displays->len; ndx++) {
+      Batch_Display * bd = g_ptr_array_index(batch_displays, ndx);
+      if (!bd->alias) {
+         CHECK_DEFERRED_SLEEP(bd->dh);    // the monitor may be accessed as soon as we exit
+         ddc_close_display(bd->dh);
+         if (bd->dref->flags & DREF_TRANSIENT)
+            free_display_ref(bd->dref);
+      }
+      free(bd->key);
+      free(bd);
+   }
+   g_ptr_array_free(batch_displays, true);
+   enable_deferred_sleep_for_thread(saved_deferred_sleep);
+   ddc_enable_vcp_value_cache(saved_value_cache);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s(%d)",
+                                   (main_rc == 0) ? "EXIT_SUCCESS" : "EXIT_FAILURE",
+                                   main_rc);
+   return main_rc;
+}
+
+
+//
+// Mainline
+//
+
+/** **ddcutil** program mainline.
+  *
+  * @param argc   number of command line arguments
+  * @param argv   pointer to array of argument strings
+  *
+  * @retval  EXIT_SUCCESS normal exit
+  * @retval  EXIT_FAILURE an error occurred
+  */
+int
+main(int argc, char *argv[]) {
+   bool main_debug = false;
+   char * s = getenv("DDCUTIL_DEBUG_MAIN");
+   if (s && strlen(s) > 0)
+      main_debug = true;
+
+   int main_rc = EXIT_FAILURE;
+   bool start_time_reported = false;
+
+   time_t program_start_time = time(NULL);
+   char * program_start_time_s = asctime(localtime(&program_start_time));
+   if (program_start_time_s[strlen(program_start_time_s)-1] == 0x0a)
+        program_start_time_s[strlen(program_start_time_s)-1] = 0;
+
+   Parsed_Cmd * parsed_cmd = NULL;
+   RECORD_STARTUP_INIT(add_rtti_functions);      // add entries for this file
+   RECORD_STARTUP_INIT(init_base_services);      // so tracing related modules are initialized
+   DBGMSF(main_debug, "init_base_services() complete, ol = %s",
+                      output_level_name(get_output_level()) );
+
+   GPtrArray * config_file_errs = g_ptr_array_new_with_free_func(g_free);
+   char ** new_argv = NULL;
+   int     new_argc = 9;
+   char *  untokenized_cmd_prefix = NULL;
+   char *  configure_fn = NULL;
+
+   int apply_config_rc = 0;
+   RECORD_STARTUP_PHASE("apply_config_file",
+         apply_config_rc = apply_config_file(
+                    "ddcutil",     // use this section of config file
+                    argc,
+                    argv,
+                    &new_argc,
+                    &new_argv,
+                    &untokenized_cmd_prefix,
+                    &configure_fn,
+                    config_file_errs) );
+#ifdef LATER
+   if (untokenized_cmd_prefix && strlen(untokenized_cmd_prefix) > 0)
+      fprintf(fout(), "Applying ddcutil options from %s: %s\n", configure_fn,
+            untokenized_cmd_prefix);
+#endif
+   DBGMSF(main_debug, "apply_config_file() returned %s", psc_desc(apply_config_rc));
+   if (config_file_errs->len > 0) {
+      f0printf(ferr(), "Errors processing ddcutil configuration file %s:\n", configure_fn);
+      for (int ndx = 0; ndx < config_file_errs->len; ndx++) {
+         char * s = g_strdup_printf("   %s\n", (char *) g_ptr_array_index(config_file_errs, ndx));
+         f0printf(ferr(), s);
+         free(s);
+      }
+   }
+   g_ptr_array_free(config_file_errs, true);
+
+   if (apply_config_rc < 0)
+      goto bye;
+
+   assert(new_argc == ntsa_length(new_argv));
+
+   if (main_debug) {
+      DBGMSG("new_argc = %d, new_argv:", new_argc);
+      rpt_ntsa(new_argv, 1);
+   }
+
+   RECORD_STARTUP_PHASE("parse_command",
+         parsed_cmd = parse_command(new_argc, new_argv, MODE_DDCUTIL) );
+   DBGMSF(main_debug, "parse_command() returned %p", parsed_cmd);
+   ntsa_free(new_argv, true);
+
+   if (!parsed_cmd) {
+      goto bye;      // main_rc == EXIT_FAILURE
+   }
+
+   init_tracing(parsed_cmd);
+
+   // tracing is sufficiently initialized, can report start time
+   start_time_reported = parsed_cmd->traced_groups    ||
+                         parsed_cmd->traced_functions ||
+                         parsed_cmd->traced_files     ||
+                         IS_TRACING()                 ||
+                         main_debug;
+   if (main_debug)
+      printf("(%s) start_time_reported = %s\n", __func__, SBOOL(start_time_reported));
+   DBGMSF(start_time_reported, "Starting %s execution, %s",
+               parser_mode_name(parsed_cmd->parser_mode),
+               program_start_time_s);
+   if (trace_to_syslog) {
+      openlog("ddcutil",          // prepended to every log message
+              LOG_CONS |          // write to system console if error sending to system logger
+              LOG_PID,            // include caller's process id
+              LOG_USER);          // generic user program, syslogger can use to determine how to handle
+      syslog(LOG_INFO, "Starting.  ddcutil version %s", get_full_ddcutil_version());
+
+   }
+
+   bool ok = false;
+   RECORD_STARTUP_PHASE("master_initializer", ok = master_initializer(parsed_cmd) );
+   if (!ok)
+      goto bye;
+   if (parsed_cmd->flags&CMD_FLAG_SHOW_SETTINGS)
+      report_all_options(parsed_cmd, configure_fn, untokenized_cmd_prefix, 0);
+
+   // xdg_tests(); // for development
+
+   // Initialization complete, rtti now contains entries for all traced functions
+   // Check that any functions specified on --trcfunc are actually traced.
+   // dbgrpt_rtti_func_name_table(0);
+   if (parsed_cmd->traced_functions) {
+      for (int ndx = 0; ndx < ntsa_length(parsed_cmd->traced_functions); ndx++) {
+         char * func_name = parsed_cmd->traced_functions[ndx];
+         // DBGMSG("Verifying: %s", func_name);
+         if (!rtti_get_func_addr_by_name(func_name)) {
+            rpt_vstring(0, "Traced function not found: %s", func_name);
+            goto bye;
+         }
+      }
+   }
+
+   if (parsed_cmd->flags & CMD_FLAG_F2) {
+      consolidated_i2c_sysfs_report(0);
+      // rpt_label(0, "*** Tests Done ***");
+      // rpt_nl();
+   }
+
+   Call_Options callopts = CALLOPT_NONE;
+   if (parsed_cmd->flags & CMD_FLAG_FORCE)
+      callopts |= CALLOPT_FORCE;
+
+   main_rc = EXIT_SUCCESS;     // from now on assume success;
+   DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Initialization complete, process commands");
+
+   if (parsed_cmd->cmd_id == CMDID_LISTVCP) {    // vestigial
+      app_listvcp(stdout);
+      main_rc = EXIT_SUCCESS;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_VCPINFO) {
+      bool vcpinfo_ok = app_vcpinfo(parsed_cmd);
+      main_rc = (vcpinfo_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_TIMELINE) {
+      bool timeline_ok = app_timeline_summary(parsed_cmd->args[0]);
+      main_rc = (timeline_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_CACHE) {
+      if (is_abbrev(parsed_cmd->args[0], "prime", 2))
+         verify_i2c_access();
+      bool cache_ok = app_cache(parsed_cmd);
+      main_rc = (cache_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_SNAPSHOT) {
+      bool snapshot_ok = app_snapshot(parsed_cmd->args[0]);
+      main_rc = (snapshot_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_ANALYZE) {
+      bool analyze_ok = app_analyze(parsed_cmd);
+      main_rc = (analyze_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+#ifdef INCLUDE_TESTCASES
+   else if (parsed_cmd->cmd_id == CMDID_LISTTESTS) {
+      show_test_cases();
+      main_rc = EXIT_SUCCESS;
+   }
+#endif
+
+   // start of commands that actually access monitors
+
+   else if (parsed_cmd->cmd_id == CMDID_DETECT) {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Detecting displays...");
+      verify_i2c_access();
+
+      if ( parsed_cmd->flags & CMD_FLAG_F4) {
+         test_display_detection_variants();
+      }
+      else {     // normal case
+         ddc_ensure_displays_detected();
+         if (parsed_cmd->flags & CMD_FLAG_JSON) {
+            Json_Writer * jw = json_writer_new(stdout);
+            ddc_json_displays(/*include_invalid_displays=*/ true, jw);
+            json_writer_free(jw);
+         }
+         else
+            ddc_report_displays(/*include_invalid_displays=*/ true, 0);
+      }
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Display detection complete");
+      main_rc = EXIT_SUCCESS;
+   }
+
+#ifdef INCLUDE_TESTCASES
+   else if (parsed_cmd->cmd_id == CMDID_TESTCASE) {
+      bool ok = app_testcases(parsed_cmd);
+      main_rc = (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+#endif
+
+
+#ifdef ENABLE_ENVCMDS
+   else if (parsed_cmd->cmd_id == CMDID_ENVIRONMENT) {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command ENVIRONMENT...");
+      dup2(1,2);   // redirect stderr to stdout
+      query_sysenv();
+      main_rc = EXIT_SUCCESS;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_USBENV) {
+#ifdef USE_USB
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command USBENV...");
+      dup2(1,2);   // redirect stderr to stdout
+      query_usbenv();
+      main_rc = EXIT_SUCCESS;
+#else
+      f0printf(fout(), "ddcutil was not built with support for USB connected monitors\n");
+      main_rc = EXIT_FAILURE;
+#endif
+   }
+#endif
+
+   else if (parsed_cmd->cmd_id == CMDID_CHKUSBMON) {
+#ifdef USE_USB
+      // DBGMSG("Processing command chkusbmon...\n");
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command CHKUSBMON...");
+      bool is_monitor = check_usb_monitor( parsed_cmd->args[0] );
+      main_rc = (is_monitor) ? EXIT_SUCCESS : EXIT_FAILURE;
+#else
+      PROGRAM_LOGIC_ERROR("ddcutil not built with USB support");
+      main_rc = EXIT_FAILURE;
+#endif
+   }
+
+#ifdef ENABLE_ENVCMDS
+   else if (parsed_cmd->cmd_id == CMDID_INTERROGATE) {
+      app_interrogate(parsed_cmd);
+      main_rc = EXIT_SUCCESS;
+   }
+#endif
+
+   else if ( (parsed_cmd->cmd_id == CMDID_CAPABILITIES || parsed_cmd->cmd_id == CMDID_DUMPVCP) &&
+             (parsed_cmd->flags & CMD_FLAG_ALL_DISPLAYS) )
+   {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command %s --all...",
+                                               cmdid_name(parsed_cmd->cmd_id));
+      verify_i2c_access();
+      tsd_dsa_enable_globally(parsed_cmd->flags & CMD_FLAG_DSA);
+      DDCA_Status ddcrc = (parsed_cmd->cmd_id == CMDID_CAPABILITIES)
+                                ? app_capabilities_all_displays(parsed_cmd->flags & CMD_FLAG_JSON)
+                                : app_dumpvcp_all_displays(parsed_cmd->flags & CMD_FLAG_JSON,
+                                                           parsed_cmd->flags & CMD_FLAG_SNAPSHOT);
+      main_rc = (ddcrc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_GETVCP && (parsed_cmd->flags & CMD_FLAG_ALL_DISPLAYS)) {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command GETVCP --all...");
+      verify_i2c_access();
+      tsd_dsa_enable_globally(parsed_cmd->flags & CMD_FLAG_DSA);
+      Status_Errno_DDC ddcrc = app_show_feature_set_values_all_displays(parsed_cmd);
+      main_rc = (ddcrc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_SETVCP && (parsed_cmd->flags & CMD_FLAG_ALL_DISPLAYS)) {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command SETVCP --all...");
+      verify_i2c_access();
+      tsd_dsa_enable_globally(parsed_cmd->flags & CMD_FLAG_DSA);
+      Status_Errno_DDC ddcrc = app_setvcp_all_displays(parsed_cmd, callopts);
+      main_rc = (ddcrc==0) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_BENCHMARK) {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command BENCHMARK...");
+      GPtrArray * drefs = NULL;
+      Display_Ref * transient_dref = NULL;
+      if (parsed_cmd->fs_root_dir) {
+         // only the topology scan, the snapshot has no usable /dev/i2c-N
+         drefs = g_ptr_array_new();
+      }
+      else if (parsed_cmd->flags & CMD_FLAG_ALL_DISPLAYS) {
+         verify_i2c_access();
+         ddc_ensure_displays_detected();
+         drefs = ddc_get_filtered_displays(false);
+      }
+      else {
+         verify_i2c_access();
+         Display_Ref * dref = NULL;
+         if (find_dref(parsed_cmd, DISPLAY_ID_REQUIRED, &dref) == DDCRC_OK) {
+            drefs = g_ptr_array_new();
+            g_ptr_array_add(drefs, dref);
+            if (dref->flags & DREF_TRANSIENT)
+               transient_dref = dref;
+         }
+      }
+      if (!drefs) {
+         main_rc = EXIT_FAILURE;
+      }
+      else {
+         // n. detection is benchmarked last, it frees the detected Display_Refs
+         bool benchmark_ok = app_benchmark(parsed_cmd, drefs);
+         main_rc = (benchmark_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+         g_ptr_array_free(drefs, true);
+         if (transient_dref)
+            free_display_ref(transient_dref);
+      }
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_SAMPLE) {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command SAMPLE...");
+      verify_i2c_access();
+      GPtrArray * drefs = NULL;
+      Display_Ref * transient_dref = NULL;
+      if (parsed_cmd->flags & CMD_FLAG_ALL_DISPLAYS) {
+         ddc_ensure_displays_detected();
+         drefs = ddc_get_filtered_displays(false);
+      }
+      else {
+         Display_Ref * dref = NULL;
+         if (find_dref(parsed_cmd, DISPLAY_ID_REQUIRED, &dref) == DDCRC_OK) {
+            drefs = g_ptr_array_new();
+            g_ptr_array_add(drefs, dref);
+            if (dref->flags & DREF_TRANSIENT)
+               transient_dref = dref;
+         }
+      }
+      if (!drefs) {
+         main_rc = EXIT_FAILURE;
+      }
+      else {
+         bool sample_ok = app_sample(parsed_cmd, drefs);
+         main_rc = (sample_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+         g_ptr_array_free(drefs, true);
+         if (transient_dref)
+            free_display_ref(transient_dref);
+      }
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_SERVE) {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command SERVE...");
+      verify_i2c_access();
+      tsd_dsa_enable_globally(parsed_cmd->flags & CMD_FLAG_DSA);
+      bool serve_ok = app_serve(parsed_cmd);
+      main_rc = (serve_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   else if ( (parsed_cmd->flags & CMD_FLAG_USE_SERVER) &&
+             app_server_execute(parsed_cmd, &main_rc) )
+   {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Command %s executed by ddcutil server",
+                                               cmdid_name(parsed_cmd->cmd_id));
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_BATCH) {
+      DBGTRC_NOPREFIX(main_debug, TRACE_GROUP, "Processing command BATCH...");
+      verify_i2c_access();
+      tsd_dsa_enable_globally(parsed_cmd->flags & CMD_FLAG_DSA);
+      main_rc = execute_batch(parsed_cmd, callopts);
+   }
+
+   // *** Commands that may require Display Identifier ***
+   else {
+      verify_i2c_access();
+      Display_Ref * dref = NULL;
+      Status_Errno_DDC  rc =
+      find_dref(parsed_cmd,
+               (parsed_cmd->cmd_id == CMDID_LOADVCP) ? DISPLAY_ID_OPTIONAL : DISPLAY_ID_REQUIRED,
+               &dref);
+      if (rc != DDCRC_OK) {
+         main_rc = EXIT_FAILURE;
+      }
+      else {
+         Display_Handle * dh = NULL;
+         if (dref) {
+            DBGMSF(main_debug,
+                   "mainline - display detection complete, about to call ddc_open_display() for dref" );
+            Status_Errno_DDC ddcrc = ddc_open_display(dref, callopts |CALLOPT_ERR_MSG, &dh);
+            ASSERT_IFF( (ddcrc==0), dh);
+            if (!dh) {
+               f0printf(ferr(), "Error %s opening display ref %s", psc_desc(ddcrc), dref_repr_t(dref));
+               main_rc = EXIT_FAILURE;
+            }
+         }  // dref
+
+         if (main_rc == EXIT_SUCCESS) {
+            // affects all current threads and new threads
+            tsd_dsa_enable_globally(parsed_cmd->flags & CMD_FLAG_DSA);
+            main_rc = execute_cmd_with_optional_display_handle(parsed_cmd, dh);
+         }
+
+         if (dh)
+               ddc_close_display(dh);
+         if (dref && (dref->flags & DREF_TRANSIENT))
+            free_display_ref(dref);
+      }
+   }
+
+   if ( (parsed_cmd->stats_types != DDCA_STATS_NONE || (parsed_cmd->flags & CMD_FLAG_EXPORT_STATS))
+#ifdef ENABLE_ENVCMDS
+         && parsed_cmd->cmd_id != CMDID_INTERROGATE
+#endif
+         // BENCHMARK writes its own results in the export format
+         && !(parsed_cmd->cmd_id == CMDID_BENCHMARK && (parsed_cmd->flags & CMD_FLAG_EXPORT_STATS))
+      )
+   {
+      if (parsed_cmd->flags & CMD_FLAG_EXPORT_STATS) {
+         char * s = ddc_export_stats_main(parsed_cmd->stats_export_format);
+         fputs(s, stdout);
+         free(s);
+      }
+      else
+         ddc_report_stats_main(parsed_cmd->stats_types, parsed_cmd->flags & CMD_FLAG_PER_THREAD_STATS, 0);
+      // report_timestamp_history();  // debugging function
+   }
+
+   if (parsed_cmd->flags & CMD_FLAG_TRACE_RING)
+      report_trace_ring(0);
+   io_timeline_stop();
+   i2c_trace_stop_recording();
+
+bye:
+   free(untokenized_cmd_prefix);
+   free(configure_fn);
+   free_regex_hash_table();
+   DBGTRC_DONE(main_debug, TRACE_GROUP, "main_rc=%d", main_rc);
+
+   time_t end_time = time(NULL);
+   char * end_time_s = asctime(localtime(&end_time));
+   if (end_time_s[strlen(end_time_s)-1] == 0x0a)
+      end_time_s[strlen(end_time_s)-1] = 0;
+   DBGMSF(start_time_reported, "ddcutil execution complete, %s", end_time_s);
+
+   if (parsed_cmd)
+      free_parsed_cmd(parsed_cmd);
+   release_base_services();
+   if (trace_to_syslog) {
+      syslog(LOG_INFO, "Terminating. Returning %d", main_rc);
+      closelog();
+   }
+   return main_rc;
+}
+
+
+static void add_rtti_functions() {
+   RTTI_ADD_FUNC(main);
+   RTTI_ADD_FUNC(execute_cmd_with_optional_display_handle);
+   RTTI_ADD_FUNC(find_dref);
+   RTTI_ADD_FUNC(parse_batch_line);
+   RTTI_ADD_FUNC(get_batch_display_handle);
+   RTTI_ADD_FUNC(execute_batch);
+#ifdef UNUSED
+#ifdef TARGET_LINUX
+   RTTI_ADD_FUNC(validate_environment_using_libkmod);
+#endif
+#endif
+   init_app_services();
+}
@@ -13,13 +13,19 @@
 
 // #define _GNU_SOURCE 1       // for function group_member
 #include <assert.h>
+#include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
+#include <glib-2.0/glib.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/utsname.h>
 
 #include "util/data_structures.h"
 #include "util/edid.h"
+#include "util/file_util.h"
 #include "util/linux_util.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
@@ -43,6 +49,7 @@
 
 #include "base/build_info.h"
 #include "base/core.h"
+#include "base/executor.h"
 #include "base/linux_errno.h"
 #include "base/parms.h"
 #include "base/rtti.h"
@@ -710,6 +717,336 @@ void final_analysis(Env_Accumulator * accum, int depth) {
    }
 }
 
+//
+// Additional checks for remote diagnosis
+//
+// The probes are independent of each other, except that those accessing
+// I2C buses or the device cross reference table must execute in their
+// original order.  Several of them execute slow external commands such as
+// i2cdetect and journalctl.  Each probe writes its report to its own buffer.
+// The probes flagged serial execute in table order on a single thread, each
+// of the others on a thread of its own.  When all have completed the buffers
+// are written in table order, so the report is unchanged.
+//
+
+typedef void (*Sysenv_Probe_Func)(Env_Accumulator * accum);
+
+typedef struct {
+   const char *      name;
+   Sysenv_Probe_Func func;
+   bool              serial;    // accesses I2C buses or the device cross reference table
+} Sysenv_Probe;
+
+
+static void probe_modules_and_drivers(Env_Accumulator * accum) {
+   query_loaded_modules_using_libkmod();
+   rpt_nl();
+
+   // printf("Gathering card and driver information...\n");
+   query_proc_modules_for_video();
+   if (!accum->is_arm) {
+      // rpt_nl();
+      // query_card_and_driver_using_lspci();
+      //rpt_nl();
+      //query_card_and_driver_using_lspci_alt();
+   }
+   rpt_nl();
+
+   if ( driver_name_list_find_exact(accum->driver_list, "nvidia")) {
+      query_proc_driver_nvidia();
+      rpt_nl();
+   }
+   if (driver_name_list_find_exact(accum->driver_list, "amdgpu")) {
+      rpt_vstring(0, "amdgpu configuration parameters:");
+      query_sys_amdgpu_parameters(1);
+      rpt_nl();
+   }
+
+   rpt_vstring(0, "Checking display manager environment variables...");
+   char * s = getenv("DISPLAY");
+   rpt_vstring(1, "DISPLAY=%s", (s) ? s : "(not set)");
+   s = getenv("WAYLAND_DISPLAY");
+   rpt_vstring(1, "WAYLAND_DISPLAY=%s", (s) ? s : "(not set)");
+   s = getenv("XDG_SESSION_TYPE");
+   rpt_vstring(1, "XDG_SESSION_TYPE=%s", (s) ? s : "(not set)");
+   rpt_nl();
+}
+
+
+static void probe_i2c_buses(Env_Accumulator * accum) {
+   query_i2c_buses();
+   rpt_nl();
+}
+
+
+static void probe_xrandr(Env_Accumulator * accum) {
+   rpt_vstring(0,"xrandr connection report:");
+   execute_shell_cmd_rpt("xrandr|grep connected", 1 /* depth */);
+   rpt_nl();
+}
+
+
+/** Reports running processes whose command name contains a string.
+ *  Equivalent to "ps aux | grep <name>", without spawning processes.
+ *
+ *  \param  name   string to look for
+ *  \param  depth  logical indentation depth
+ */
+static void report_processes_named(const char * name, int depth) {
+   DIR * dir = opendir("/proc");
+   if (!dir) {
+      rpt_vstring(depth, "Unable to open /proc: %s", strerror(errno));
+      return;
+   }
+   struct dirent * ent;
+   while ( (ent = readdir(dir)) ) {
+      if (!isdigit(ent->d_name[0]))
+         continue;
+      char fn[PATH_MAX];
+      g_snprintf(fn, sizeof(fn), "/proc/%s/comm", ent->d_name);
+      char * comm = file_get_first_line(fn, /*verbose*/ false);
+      if (comm && strstr(comm, name)) {
+         g_snprintf(fn, sizeof(fn), "/proc/%s/cmdline", ent->d_name);
+         gchar * cmdline = NULL;
+         gsize   len = 0;
+         if (g_file_get_contents(fn, &cmdline, &len, NULL)) {
+            for (int ndx = 0; ndx+1 < len; ndx++) {    // arguments are null separated
+               if (cmdline[ndx] == '\0')
+                  cmdline[ndx] = ' ';
+            }
+         }
+         rpt_vstring(depth, "pid %-8s %s", ent->d_name, (cmdline && len > 0) ? cmdline : comm);
+         g_free(cmdline);
+      }
+      free(comm);
+   }
+   closedir(dir);
+}
+
+
+static void probe_conflicting_programs(Env_Accumulator * accum) {
+   rpt_vstring(0,"Checking for possibly conflicting programs...");
+   report_processes_named("ddccontrol", 1);
+   rpt_nl();
+   // equivalent to "lsmod | grep ddcci"
+   char * module_terms[] = {"ddcci", NULL};
+   GPtrArray * module_lines = g_ptr_array_new_with_free_func(g_free);
+   if (read_file_with_filter(module_lines, "/proc/modules", module_terms, false, 0) > 0) {
+      for (int ndx = 0; ndx < module_lines->len; ndx++)
+         rpt_title(g_ptr_array_index(module_lines, ndx), 1);
+   }
+   g_ptr_array_free(module_lines, true);
+   rpt_nl();
+}
+
+
+static void probe_i2c_using_shell_commands(Env_Accumulator * accum) {
+   bool debug = false;
+   if (sysfs_quick_test)
+      DBGMSG("!!! Skipping i2cdetect and get-edid|parse-edid to speed up testing !!!");
+   else {
+      query_using_shell_command(accum->dev_i2c_device_numbers,
+                                "i2cdetect -y %d",   // command to issue
+                                "i2cdetect");        // command name for error message
+      rpt_nl();
+      query_using_shell_command(accum->dev_i2c_device_numbers,
+                                "get-edid -b %d -i | parse-edid",   // command to issue
+                                "get-edid | parse-edid");        // command name for error message
+
+      if (get_output_level() >= DDCA_OL_VV) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "--VV only output: test_read_variants()");
+         test_edid_read_variants(accum);
+      }
+   }
+}
+
+
+#ifdef USE_X11
+static void probe_x11(Env_Accumulator * accum) {
+   query_x11();
+}
+#endif
+
+
+#ifdef ENABLE_UDEV
+static void probe_udev(Env_Accumulator * accum) {
+   probe_i2c_devices_using_udev();
+
+   // temp
+   // get_i2c_smbus_devices_using_udev();
+}
+#endif
+
+
+static void probe_config_files_and_logs(Env_Accumulator * accum) {
+   if (sysfs_quick_test)
+      DBGMSG("!!! Skipping config file and log checking to speed up testing !!!");
+   else {
+      probe_config_files(accum);
+      probe_logs(accum);
+   }
+}
+
+
+static void probe_drm(Env_Accumulator * accum) {
+#ifdef USE_LIBDRM
+   probe_using_libdrm();
+#else
+   rpt_vstring(0, "Not built with libdrm support.  Skipping DRM related checks");
+#endif
+
+   query_drm_using_sysfs();
+   rpt_nl();
+}
+
+
+static void probe_drm_i2c_nodes(Env_Accumulator * accum) {
+   rpt_title("Query file system for i2c nodes under /sys/class/drm/card*...", 0);
+   execute_shell_cmd_rpt("ls -ld /sys/class/drm/card*/card*/i2c*", 1);
+   rpt_title("Query file system for i2c nodes under /sys/class/drm/card*/ddc/i2c-dev/...", 0);
+   execute_shell_cmd_rpt("ls -ld /sys/class/drm/card*/card*/ddc/i2c-dev/i2c*", 1);
+}
+
+
+static void probe_device_xref(Env_Accumulator * accum) {
+   device_xref_report(0);
+}
+
+
+static void probe_modules_config(Env_Accumulator * accum) {
+   probe_modules_d(0);
+}
+
+
+static void probe_sysfs_i2c(Env_Accumulator * accum) {
+   dump_sysfs_i2c();
+   rpt_nl();
+
+#ifdef OLD
+   if (get_output_level() >= DDCA_OL_VV) {
+      rpt_nl();
+      rpt_label(0, "*** Calling get_sysfs_drm_card_numbers(), get_sysfs_drm_displays() from ddc_watch.c... ***");
+      Byte_Bit_Flags drm_card_numbers = get_sysfs_drm_card_numbers();
+      if (bbf_count_set(drm_card_numbers) > 0) {
+         query_drm_using_sysfs();
+      }
+   }
+#endif
+
+#ifdef TMI
+#ifdef ENABLE_UDEV
+   if (get_output_level() >= DDCA_OL_VV) {
+      rpt_nl();
+      query_using_shell_command(accum->dev_i2c_device_numbers,
+     //   "udevadm info --attribute-walk --path=$(udevadm info --query=path --name=i2c-%d)",
+        "udevadm info --attribute-walk /dev/i2c-%d",
+                                "udevadm");
+   }
+#endif
+#endif
+}
+
+
+static void probe_xdg_files(Env_Accumulator * accum) {
+   query_xdg_files(0);
+}
+
+
+static Sysenv_Probe additional_probes[] = {
+   {"modules",             probe_modules_and_drivers,      false},
+   {"i2c_buses",           probe_i2c_buses,                true},
+   {"xrandr",              probe_xrandr,                   false},
+   {"conflicting",         probe_conflicting_programs,     false},
+   {"i2c_shell_commands",  probe_i2c_using_shell_commands, true},
+   {"raw_scan",            raw_scan_i2c_devices,           true},
+#ifdef USE_X11
+   {"x11",                 probe_x11,                      true},
+#endif
+#ifdef ENABLE_UDEV
+   {"udev",                probe_udev,                     true},
+#endif
+   {"config_and_logs",     probe_config_files_and_logs,    false},
+   {"drm",                 probe_drm,                      true},
+   {"drm_i2c_nodes",       probe_drm_i2c_nodes,            false},
+   {"device_xref",         probe_device_xref,              true},
+   {"modules_config",      probe_modules_config,           false},
+   {"sysfs_i2c",           probe_sysfs_i2c,                true},
+   {"xdg_files",           probe_xdg_files,                false},
+};
+#define ADDITIONAL_PROBE_CT ARRAY_SIZE(additional_probes)
+
+
+typedef struct {
+   Env_Accumulator * accum;
+   DDCA_Output_Level output_level;
+   int               probe_ndx;
+   char *            output;
+} Sysenv_Probe_Task_Rec;
+
+
+// satisfies Executor_Task_Func
+static void
+sysenv_probe_task(gpointer data) {
+   bool debug = false;
+   Sysenv_Probe_Task_Rec * rec = data;
+   Sysenv_Probe * probe = &additional_probes[rec->probe_ndx];
+   DBGTRC_STARTING(debug, TRACE_GROUP, "probe=%s", probe->name);
+   // output settings are thread specific, and the worker thread is shared
+   DDCA_Output_Level saved_output_level = set_output_level(rec->output_level);
+   size_t size = 0;
+   FILE * fp = open_memstream(&rec->output, &size);
+   set_fout(fp);
+   set_ferr(fp);
+   probe->func(rec->accum);
+   set_fout_to_default();
+   set_ferr_to_default();
+   fclose(fp);
+   set_output_level(saved_output_level);
+   DBGTRC_DONE(debug, TRACE_GROUP, "probe=%s, output size=%zu", probe->name, size);
+}
+
+
+/** Executes the probes in #additional_probes concurrently, and writes
+ *  their reports in table order.
+ *
+ *  The probes marked serial share an executor affinity, so they are
+ *  executed one at a time, in table order.
+ *
+ *  @param  accum  accumulated environment information
+ */
+static void
+run_additional_probes(Env_Accumulator * accum) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   Sysenv_Probe_Task_Rec recs[ADDITIONAL_PROBE_CT];
+   Executor_Group * group = executor_group_new();
+   for (int ndx = 0; ndx < ADDITIONAL_PROBE_CT; ndx++) {
+      Sysenv_Probe_Task_Rec * rec = &recs[ndx];
+      rec->accum        = accum;
+      rec->output_level = get_output_level();
+      rec->probe_ndx    = ndx;
+      rec->output       = NULL;
+      executor_submit(group,
+                      (additional_probes[ndx].serial) ? "sysenv_serial_probes" : NULL,
+                      sysenv_probe_task,
+                      rec);
+   }
+   executor_wait_group(group);
+
+   FILE * fh = fout();
+   for (int ndx = 0; ndx < ADDITIONAL_PROBE_CT; ndx++) {
+      if (recs[ndx].output) {
+         fputs(recs[ndx].output, fh);
+         free(recs[ndx].output);
+      }
+   }
+   fflush(fh);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "probes: %d", (int) ADDITIONAL_PROBE_CT);
+}
+
+
 //
 // Mainline
 //
@@ -819,132 +1156,7 @@ void query_sysenv() {
                                  1);     // logical depth
       // printf("Detected: %d displays\n", display_ct);   // not needed
 
-      query_loaded_modules_using_libkmod();
-      rpt_nl();
-
-      // printf("Gathering card and driver information...\n");
-      query_proc_modules_for_video();
-      if (!accumulator->is_arm) {
-         // rpt_nl();
-         // query_card_and_driver_using_lspci();
-         //rpt_nl();
-         //query_card_and_driver_using_lspci_alt();
-      }
-      rpt_nl();
-
-      if ( driver_name_list_find_exact(accumulator->driver_list, "nvidia")) {
-         query_proc_driver_nvidia();
-         rpt_nl();
-      }
-      if (driver_name_list_find_exact(accumulator->driver_list, "amdgpu")) {
-         rpt_vstring(0, "amdgpu configuration parameters:");
-         query_sys_amdgpu_parameters(1);
-         rpt_nl();
-      }
-
-      rpt_vstring(0, "Checking display manager environment variables...");
-      char * s = getenv("DISPLAY");
-      rpt_vstring(1, "DISPLAY=%s", (s) ? s : "(not set)");
-      s = getenv("WAYLAND_DISPLAY");
-      rpt_vstring(1, "WAYLAND_DISPLAY=%s", (s) ? s : "(not set)");
-      s = getenv("XDG_SESSION_TYPE");
-      rpt_vstring(1, "XDG_SESSION_TYPE=%s", (s) ? s : "(not set)");
-      rpt_nl();
-
-      query_i2c_buses();
-      rpt_nl();
-
-      rpt_vstring(0,"xrandr connection report:");
-      execute_shell_cmd_rpt("xrandr|grep connected", 1 /* depth */);
-      rpt_nl();
-
-      rpt_vstring(0,"Checking for possibly conflicting programs...");
-      execute_shell_cmd_rpt("ps aux | grep ddccontrol | grep -v grep", 1);
-      rpt_nl();
-      execute_shell_cmd_rpt("lsmod | grep ddcci | grep -v grep", 1);
-      rpt_nl();
-
-      if (sysfs_quick_test)
-         DBGMSG("!!! Skipping i2cdetect and get-edid|parse-edid to speed up testing !!!");
-      else {
-         query_using_shell_command(accumulator->dev_i2c_device_numbers,
-                                   "i2cdetect -y %d",   // command to issue
-                                   "i2cdetect");        // command name for error message
-         rpt_nl();
-         query_using_shell_command(accumulator->dev_i2c_device_numbers,
-                                   "get-edid -b %d -i | parse-edid",   // command to issue
-                                   "get-edid | parse-edid");        // command name for error message
-
-         if (get_output_level() >= DDCA_OL_VV) {
-            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "--VV only output: test_read_variants()");
-            test_edid_read_variants(accumulator);
-         }
-      }
-      raw_scan_i2c_devices(accumulator);
-
-#ifdef USE_X11
-      query_x11();
-#endif
-
-#ifdef ENABLE_UDEV
-      probe_i2c_devices_using_udev();
-#endif
-
-      // temp
-      // get_i2c_smbus_devices_using_udev();
-
-      if (sysfs_quick_test)
-         DBGMSG("!!! Skipping config file and log checking to speed up testing !!!");
-      else {
-         probe_config_files(accumulator);
-         probe_logs(accumulator);
-      }
-
-#ifdef USE_LIBDRM
-      probe_using_libdrm();
-#else
-      rpt_vstring(0, "Not built with libdrm support.  Skipping DRM related checks");
-#endif
-
-      query_drm_using_sysfs();
-      rpt_nl();
-
-      rpt_title("Query file system for i2c nodes under /sys/class/drm/card*...", 0);
-      execute_shell_cmd_rpt("ls -ld /sys/class/drm/card*/card*/i2c*", 1);
-      rpt_title("Query file system for i2c nodes under /sys/class/drm/card*/ddc/i2c-dev/...", 0);
-      execute_shell_cmd_rpt("ls -ld /sys/class/drm/card*/card*/ddc/i2c-dev/i2c*", 1);
-
-      device_xref_report(0);
-
-      probe_modules_d(0);
-
-      dump_sysfs_i2c();
-      rpt_nl();
-
-#ifdef OLD
-      if (get_output_level() >= DDCA_OL_VV) {
-         rpt_nl();
-         rpt_label(0, "*** Calling get_sysfs_drm_card_numbers(), get_sysfs_drm_displays() from ddc_watch.c... ***");
-         Byte_Bit_Flags drm_card_numbers = get_sysfs_drm_card_numbers();
-         if (bbf_count_set(drm_card_numbers) > 0) {
-            query_drm_using_sysfs();
-         }
-      }
-#endif
-
-#ifdef TMI
-#ifdef ENABLE_UDEV
-      if (get_output_level() >= DDCA_OL_VV) {
-         rpt_nl();
-         query_using_shell_command(accumulator->dev_i2c_device_numbers,
-        //   "udevadm info --attribute-walk --path=$(udevadm info --query=path --name=i2c-%d)",
-           "udevadm info --attribute-walk /dev/i2c-%d",
-                                   "udevadm");
-      }
-#endif
-#endif
-
-      query_xdg_files(0);
+      run_additional_probes(accumulator);
 
       rpt_label(0, "*** environment command complete ***");
    }
@@ -956,6 +1168,8 @@ void query_sysenv() {
 
 void init_sysenv() {
    RTTI_ADD_FUNC(query_sysenv);
+   RTTI_ADD_FUNC(run_additional_probes);
+   RTTI_ADD_FUNC(sysenv_probe_task);
 #ifdef ENABLE_UDEV
    RTTI_ADD_FUNC(probe_i2c_devices_using_udev);
 #endif
@@ -24,6 +24,9 @@
 #include "util/report_util.h"
 #include "util/string_util.h"
 #include "util/subprocess_util.h"
+#ifdef PROBE_USING_SYSTEMD
+#include "util/systemd_util.h"
+#endif
 
 #include "base/core.h"
 #include "base/status_code_mgt.h"
@@ -33,6 +36,8 @@
 
 #include "query_sysenv_logs.h"
 
+#define MAX_JOURNAL_ENTRIES 50000    // bounds the scan of a large journal
+
 
 static bool probe_log(
       char *  log_fn,
@@ -184,6 +189,82 @@ static bool probe_cmd(
 }
 
 
+/** Reports the filtered lines of a message array.
+ *
+ *  \param  lines        array of messages, NULL if the source could not be read
+ *  \param  depth        logical indentation depth
+ *  \return true if the source was read
+ */
+static bool report_found_lines(GPtrArray * lines, int depth) {
+   if (!lines)
+      return false;
+   if (lines->len == 0) {
+      rpt_title("No lines found after filtering", depth);
+   }
+   else {
+      for (int ndx = 0; ndx < lines->len; ndx++) {
+         rpt_title(g_ptr_array_index(lines, ndx), depth+1);
+      }
+   }
+   rpt_nl();
+   return true;
+}
+
+
+/** Reads the kernel log buffer from /dev/kmsg, the source used by dmesg.
+ *
+ *  Each read() returns one record, of the form
+ *  "priority,sequence,timestamp,flags;message", possibly followed by
+ *  continuation lines.  Lines are formatted as by dmesg.
+ *
+ *  \param  filter_terms  null terminated array of strings, only
+ *                        messages containing one of them are kept
+ *  \param  ignore_case   ignore case when testing filter terms
+ *  \return GPtrArray of newly allocated lines,
+ *          NULL if /dev/kmsg cannot be read, e.g. if dmesg_restrict is set
+ */
+static GPtrArray * read_kmsg(char ** filter_terms, bool ignore_case) {
+   bool debug = false;
+   int fd = open("/dev/kmsg", O_RDONLY | O_NONBLOCK);
+   if (fd < 0) {
+      DBGMSF(debug, "Unable to open /dev/kmsg, errno=%d", errno);
+      return NULL;
+   }
+
+   GPtrArray * lines = g_ptr_array_new_full(1000, g_free);
+   char record[8192];    // maximum record size is 1024 + header, continuation lines
+   for (;;) {
+      ssize_t ct = read(fd, record, sizeof(record)-1);
+      if (ct < 0) {
+         if (errno == EPIPE)    // record overwritten while reading
+            continue;
+         if (errno != EAGAIN)
+            DBGMSF(debug, "read() failed, errno=%d", errno);
+         break;                 // EAGAIN: no more records
+      }
+      record[ct] = '\0';
+      char * msg = strchr(record, ';');
+      if (!msg)
+         continue;
+      *msg++ = '\0';
+      char * eol = strchr(msg, '\n');
+      if (eol)
+         *eol = '\0';
+      if (!apply_filter_terms(msg, filter_terms, ignore_case))
+         continue;
+
+      unsigned int   priority, sequence;
+      unsigned long long timestamp = 0;       // microseconds since boot
+      sscanf(record, "%u,%u,%llu", &priority, &sequence, &timestamp);
+      g_ptr_array_add(lines, g_strdup_printf("[%5llu.%06llu] %s",
+                                             timestamp / 1000000, timestamp % 1000000, msg));
+   }
+   close(fd);
+   DBGMSF(debug, "Returning %d lines", lines->len);
+   return lines;
+}
+
+
 /** Scans log files for lines of interest.
  *
  *  Depending on operating environment, some subset of
@@ -270,13 +351,22 @@ void probe_logs(Env_Accumulator * accum) {
    // it's a heisenbug.  Just use the more verbose journalctl output
    logs_checked |= LOG_DMESG;
 
-   rpt_title("Scanning dmesg output for I2C related entries...", depth+1);
-   log_dmesg_found = probe_cmd(
-         "dmesg",
-         drivers_plus_addl_matches,
-         true,    // ignore_case
-         0,       // no limit
-         depth+1);
+   rpt_title("Scanning kernel log buffer for I2C related entries...", depth+1);
+   GPtrArray * kmsg_lines = read_kmsg(drivers_plus_addl_matches, /*ignore_case*/ true);
+   if (kmsg_lines) {
+      rpt_vstring(depth+1, "Reading file: /dev/kmsg");
+      log_dmesg_found = report_found_lines(kmsg_lines, depth+1);
+      g_ptr_array_free(kmsg_lines, true);
+   }
+   else {
+      // e.g. if kernel.dmesg_restrict is set, dmesg will likely fail as well
+      log_dmesg_found = probe_cmd(
+            "dmesg",
+            drivers_plus_addl_matches,
+            true,    // ignore_case
+            0,       // no limit
+            depth+1);
+   }
    if (log_dmesg_found)
       logs_found |= LOG_DMESG;
 
@@ -284,27 +374,26 @@ void probe_logs(Env_Accumulator * accum) {
 
    logs_checked |= LOG_JOURNALCTL;
 
-#ifdef ALT
-   // if don't use this version, don't need to link with libsystemd
-   DBGMSG("Using get_current_boot_messages...");
-   rpt_title("Checking journalctl for I2C related entries...", depth+1);
-   GPtrArray * journalctl_msgs = get_current_boot_messages(drivers_plus_addl_matches, /* ignore case */true, 0);
-   if (journalctl_msgs) {
-      // log_journalctl_found = true;
-      logs_found |= LOG_JOURNALCTL;
-
-      for (int ndx = 0; ndx < journalctl_msgs->len; ndx++) {
-         rpt_vstring(depth+2, "%s", g_ptr_array_index(journalctl_msgs, ndx));
-      }
-   }
-   rpt_nl();
-#endif
-
    // has a few more lines from nvidia-persistence, lines have timestamp, hostname, and subsystem
    rpt_title("Scanning journalctl output for I2C related entries...", depth+1);
-   log_dmesg_found = probe_cmd("journalctl --no-pager --boot", drivers_plus_addl_matches, /*ignore_case*/ true, 0, depth+1);
-   if (log_dmesg_found)
-      logs_found |= LOG_DMESG;
+   GPtrArray * journal_msgs = NULL;
+#ifdef PROBE_USING_SYSTEMD
+   // read the journal directly instead of executing journalctl
+   journal_msgs = get_current_boot_messages(
+         drivers_plus_addl_matches, /*ignore_case*/ true, 0, MAX_JOURNAL_ENTRIES);
+#endif
+   bool log_journal_found = false;
+   if (journal_msgs) {
+      rpt_vstring(depth+1, "Examining last %d journal entries for current boot", MAX_JOURNAL_ENTRIES);
+      log_journal_found = report_found_lines(journal_msgs, depth+1);
+      g_ptr_array_free(journal_msgs, true);
+   }
+   else {
+      log_journal_found = probe_cmd("journalctl --no-pager --boot",
+                                    drivers_plus_addl_matches, /*ignore_case*/ true, 0, depth+1);
+   }
+   if (log_journal_found)
+      logs_found |= LOG_JOURNALCTL;
     rpt_nl();
 
    // *** Xorg.0.log ***
@@ -9,6 +9,7 @@
 
  
 #include <glib-2.0/glib.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
@@ -202,8 +203,9 @@ void dump_original_sys_scans() {
    if (get_output_level() >= DDCA_OL_VV) {
       rpt_nl();
       rpt_label(0, "*** Detail for /sys/bus/i2c/devices (Initial Version) ***");
+      char dirbuf[PATH_MAX];
       dir_ordered_foreach(
-            "/sys/bus/i2c/devices",
+            fs_rooted_path("/sys/bus/i2c/devices", dirbuf, PATH_MAX),
             NULL,                 // fn_filter
             i2c_compare,
             each_i2c_device_new,
@@ -213,7 +215,7 @@ void dump_original_sys_scans() {
       rpt_nl();
       rpt_label(0, "*** Detail for /sys/class/drm  (Initial Version) ***");
       dir_ordered_foreach(
-            "/sys/class/drm",
+            fs_rooted_path("/sys/class/drm", dirbuf, PATH_MAX),
             predicate_cardN_connector,
             gaux_ptr_scomp,    // GCompareFunc
             each_drm_device,    //
@@ -12,6 +12,7 @@
 #include <dirent.h>
 #include <errno.h>
 #include <glib-2.0/glib.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <string.h>
 #include <sys/types.h>
@@ -538,14 +539,14 @@ void each_i2c_device(
 {
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_NONE, "dirname=%s, fn=%s", dirname, fn);
-   assert(streq(dirname, "/sys/bus/i2c/devices"));
+   assert(str_ends_with(dirname, "/sys/bus/i2c/devices"));
 
    Env_Accumulator * accum = accumulator;
-   char cur_dir_name[100];
-   sprintf(cur_dir_name, "%s/%s", dirname, fn);
+   char cur_dir_name[PATH_MAX];
+   g_snprintf(cur_dir_name, PATH_MAX, "%s/%s", dirname, fn);
    char * dev_name = read_sysfs_attr(cur_dir_name, "name", true);
-   char buf[106];
-   snprintf(buf, 106, "%s/name:", cur_dir_name);
+   char buf[PATH_MAX+6];
+   snprintf(buf, sizeof(buf), "%s/name:", cur_dir_name);
    rpt_vstring(depth, "%-34s %s", buf, dev_name);
    free(dev_name);
 
@@ -580,12 +581,13 @@ void query_sys_bus_i2c(Env_Accumulator * accumulator) {
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
    accumulator->sys_bus_i2c_device_numbers = bva_create();
    rpt_vstring(0,"Examining /sys/bus/i2c/devices...");
-   char * dname = "/sys/bus/i2c";
+   char dirbuf[PATH_MAX];
+   char * dname = fs_rooted_path("/sys/bus/i2c", dirbuf, PATH_MAX);
    if (!directory_exists(dname)) {
       rpt_vstring(1, "Directory not found: %s", dname);
    }
    else {
-      char * dname = "/sys/bus/i2c/devices";
+      char * dname = fs_rooted_path("/sys/bus/i2c/devices", dirbuf, PATH_MAX);
       accumulator->sysfs_i2c_devices_exist = false;
       // each entry in /sys/bus/i2c/devices is a symbolic link
       dir_ordered_foreach(dname, NULL, i2c_compare, each_i2c_device, accumulator, 1);
@@ -757,11 +759,12 @@ void query_drm_using_sysfs()
    int depth = 1;
    int d0 = depth;
    rpt_nl();
+   char dirbuf[PATH_MAX];
    char * dname =
 #ifdef TARGET_BSD
              "/compat/linux/sys/class/drm";
 #else
-             "/sys/class/drm";
+             fs_rooted_path("/sys/class/drm", dirbuf, PATH_MAX);
 #endif
 
    rpt_vstring(d0, "*** Examining %s ***", dname);
@@ -0,0 +1,228 @@
+/** \file api_call_stats.c
+ *
+ *  Call count and elapsed time of each public API function.
+ *
+ *  Each ddca_ function begins with #API_TIMED(), which on first use
+ *  registers a record for the function and caches it in a static variable
+ *  at the call site.  Subsequent calls update the record using only atomic
+ *  operations, so timing adds two clock reads and a few atomic increments
+ *  to each call.  Elapsed times are also counted in decade buckets, from
+ *  under 10 microseconds to over 1 second.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/report_util.h"
+#include "util/timestamp.h"
+
+#include "base/api_call_stats.h"
+
+#define API_CALL_BUCKET_CT 7
+
+// Upper bound, in microseconds, of each bucket except the last
+static const uint64_t bucket_limits[API_CALL_BUCKET_CT-1] =
+      {10, 100, 1000, 10000, 100000, 1000000};
+
+// Upper bounds in seconds, for export
+static const char * bucket_names[API_CALL_BUCKET_CT] =
+      {"0.00001", "0.0001", "0.001", "0.01", "0.1", "1", "+Inf"};
+
+#define API_CALL_STATS_MARKER "APIC"
+struct Api_Call_Stats {
+   char         marker[4];
+   const char * funcname;
+   uint64_t     call_ct;                          // atomic access
+   uint64_t     total_nanos;                      // atomic access
+   uint64_t     max_nanos;                        // atomic access
+   uint64_t     bucket_cts[API_CALL_BUCKET_CT];   // atomic access
+};
+
+// Records are never freed, so cached pointers remain valid
+static GPtrArray * api_call_recs;     // protected by api_call_mutex
+static GMutex      api_call_mutex;
+
+
+static Api_Call_Stats *
+register_api_function(const char * funcname) {
+   g_mutex_lock(&api_call_mutex);
+   if (!api_call_recs)
+      api_call_recs = g_ptr_array_new();
+   Api_Call_Stats * result = NULL;
+   for (int ndx = 0; ndx < api_call_recs->len; ndx++) {
+      Api_Call_Stats * cur = g_ptr_array_index(api_call_recs, ndx);
+      if (strcmp(cur->funcname, funcname) == 0) {
+         result = cur;
+         break;
+      }
+   }
+   if (!result) {
+      result = g_new0(Api_Call_Stats, 1);
+      memcpy(result->marker, API_CALL_STATS_MARKER, 4);
+      result->funcname = funcname;
+      g_ptr_array_add(api_call_recs, result);
+   }
+   g_mutex_unlock(&api_call_mutex);
+   return result;
+}
+
+
+/** Starts timing an API call.  Called by #API_TIMED().
+ *
+ *  \param  site_stats  static variable at the call site caching the record
+ *  \param  funcname    function name
+ *  \return timer to be passed to #api_call_timer_end()
+ */
+Api_Call_Timer api_call_timer_start(Api_Call_Stats ** site_stats, const char * funcname) {
+   Api_Call_Stats * stats = __atomic_load_n(site_stats, __ATOMIC_ACQUIRE);
+   if (!stats) {
+      stats = register_api_function(funcname);
+      __atomic_store_n(site_stats, stats, __ATOMIC_RELEASE);
+   }
+   Api_Call_Timer timer = {stats, cur_monotonic_nanosec()};
+   return timer;
+}
+
+
+/** Records the elapsed time of an API call.  Invoked automatically when
+ *  the timer declared by #API_TIMED() goes out of scope.
+ *
+ *  \param  timer  started by #api_call_timer_start()
+ */
+void api_call_timer_end(Api_Call_Timer * timer) {
+   Api_Call_Stats * stats = timer->stats;
+   uint64_t elapsed = cur_monotonic_nanosec() - timer->start_nanos;
+   uint64_t micros = elapsed / 1000;
+   int bucket = 0;
+   while (bucket < API_CALL_BUCKET_CT-1 && micros >= bucket_limits[bucket])
+      bucket++;
+   __atomic_fetch_add(&stats->bucket_cts[bucket], 1, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&stats->call_ct, 1, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&stats->total_nanos, elapsed, __ATOMIC_RELAXED);
+   uint64_t cur = __atomic_load_n(&stats->max_nanos, __ATOMIC_RELAXED);
+   while (elapsed > cur &&
+          !__atomic_compare_exchange_n(&stats->max_nanos, &cur, elapsed,
+                                       false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+      ;
+}
+
+
+static gint
+compare_funcname(gconstpointer a, gconstpointer b) {
+   const Api_Call_Stats * s1 = *(Api_Call_Stats * const *) a;
+   const Api_Call_Stats * s2 = *(Api_Call_Stats * const *) b;
+   return strcmp(s1->funcname, s2->funcname);
+}
+
+
+// Returns the records of called functions, sorted by name.
+// Caller must free the array but not the records.
+static GPtrArray *
+get_called_functions() {
+   GPtrArray * result = g_ptr_array_new();
+   g_mutex_lock(&api_call_mutex);
+   int ct = (api_call_recs) ? api_call_recs->len : 0;
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Api_Call_Stats * cur = g_ptr_array_index(api_call_recs, ndx);
+      assert(memcmp(cur->marker, API_CALL_STATS_MARKER, 4) == 0);
+      if (__atomic_load_n(&cur->call_ct, __ATOMIC_RELAXED) > 0)
+         g_ptr_array_add(result, cur);
+   }
+   g_mutex_unlock(&api_call_mutex);
+   g_ptr_array_sort(result, compare_funcname);
+   return result;
+}
+
+
+/** Resets the statistics of all API functions */
+void reset_api_call_stats() {
+   g_mutex_lock(&api_call_mutex);
+   int ct = (api_call_recs) ? api_call_recs->len : 0;
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Api_Call_Stats * cur = g_ptr_array_index(api_call_recs, ndx);
+      __atomic_store_n(&cur->call_ct,     0, __ATOMIC_RELAXED);
+      __atomic_store_n(&cur->total_nanos, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&cur->max_nanos,   0, __ATOMIC_RELAXED);
+      for (int bndx = 0; bndx < API_CALL_BUCKET_CT; bndx++)
+         __atomic_store_n(&cur->bucket_cts[bndx], 0, __ATOMIC_RELAXED);
+   }
+   g_mutex_unlock(&api_call_mutex);
+}
+
+
+/** Reports the statistics of each API function that has been called.
+ *  Nothing is reported if no API function has been called, e.g. when
+ *  running the command line program.
+ *
+ *  \param depth logical indentation depth
+ */
+void report_api_call_stats(int depth) {
+   int d1 = depth+1;
+   GPtrArray * called = get_called_functions();
+   if (called->len > 0) {
+      rpt_title("API function calls:", depth);
+      rpt_vstring(d1, "%-44s %8s %11s %10s %10s   %s",
+                      "Function", "Calls", "Total (ms)", "Avg (us)", "Max (us)",
+                      "<10us <100us <1ms <10ms <100ms <1s >=1s");
+      for (int ndx = 0; ndx < called->len; ndx++) {
+         Api_Call_Stats * cur = g_ptr_array_index(called, ndx);
+         uint64_t ct    = __atomic_load_n(&cur->call_ct,     __ATOMIC_RELAXED);
+         uint64_t total = __atomic_load_n(&cur->total_nanos, __ATOMIC_RELAXED);
+         uint64_t max   = __atomic_load_n(&cur->max_nanos,   __ATOMIC_RELAXED);
+         char buckets[100] = "";
+         for (int bndx = 0; bndx < API_CALL_BUCKET_CT; bndx++) {
+            int len = strlen(buckets);
+            g_snprintf(buckets+len, sizeof(buckets)-len, "%s%"PRIu64, (bndx > 0) ? " " : "",
+                       __atomic_load_n(&cur->bucket_cts[bndx], __ATOMIC_RELAXED));
+         }
+         rpt_vstring(d1, "%-44s %8"PRIu64" %11.3f %10"PRIu64" %10"PRIu64"   %s",
+                         cur->funcname, ct, total / 1000000.0,
+                         (ct > 0) ? total / ct / 1000 : 0, max / 1000, buckets);
+      }
+      rpt_nl();
+   }
+   g_ptr_array_free(called, true);
+}
+
+
+/** Exports the statistics of each API function that has been called.
+ *
+ *  \param exp  export instance
+ */
+void export_api_call_stats(Stats_Export * exp) {
+   stats_export_metric(exp, "ddcutil_api_calls_total", STATS_METRIC_COUNTER,
+                            "Number of calls, by API function");
+   stats_export_metric(exp, "ddcutil_api_call_seconds_total", STATS_METRIC_COUNTER,
+                            "Total elapsed time of calls, by API function");
+   stats_export_metric(exp, "ddcutil_api_call_max_seconds", STATS_METRIC_GAUGE,
+                            "Maximum elapsed time of a call, by API function");
+   stats_export_metric(exp, "ddcutil_api_call_bucket_count", STATS_METRIC_COUNTER,
+                            "Number of calls with elapsed time less than le, by API function");
+   GPtrArray * called = get_called_functions();
+   for (int ndx = 0; ndx < called->len; ndx++) {
+      Api_Call_Stats * cur = g_ptr_array_index(called, ndx);
+      stats_export_sample(exp, "ddcutil_api_calls_total",
+                          __atomic_load_n(&cur->call_ct, __ATOMIC_RELAXED),
+                          1, "function", cur->funcname);
+      stats_export_sample(exp, "ddcutil_api_call_seconds_total",
+                          __atomic_load_n(&cur->total_nanos, __ATOMIC_RELAXED) / 1e9,
+                          1, "function", cur->funcname);
+      stats_export_sample(exp, "ddcutil_api_call_max_seconds",
+                          __atomic_load_n(&cur->max_nanos, __ATOMIC_RELAXED) / 1e9,
+                          1, "function", cur->funcname);
+      uint64_t cumulative = 0;
+      for (int bndx = 0; bndx < API_CALL_BUCKET_CT; bndx++) {
+         cumulative += __atomic_load_n(&cur->bucket_cts[bndx], __ATOMIC_RELAXED);
+         stats_export_sample(exp, "ddcutil_api_call_bucket_count", cumulative,
+                             2, "function", cur->funcname, "le", bucket_names[bndx]);
+      }
+   }
+   g_ptr_array_free(called, true);
+}
@@ -0,0 +1,43 @@
+/** \file api_call_stats.h
+ *
+ *  Call count and elapsed time of each public API function.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef API_CALL_STATS_H_
+#define API_CALL_STATS_H_
+
+/** \cond */
+#include <inttypes.h>
+/** \endcond */
+
+#include "base/stats_export.h"
+
+typedef struct Api_Call_Stats Api_Call_Stats;
+
+typedef struct {
+   Api_Call_Stats * stats;
+   uint64_t         start_nanos;
+} Api_Call_Timer;
+
+Api_Call_Timer api_call_timer_start(Api_Call_Stats ** site_stats, const char * funcname);
+void           api_call_timer_end(Api_Call_Timer * timer);
+
+/** Times the enclosing API function.
+ *
+ *  Must be the first statement of the function.  The elapsed time is
+ *  recorded when the function returns, on whatever path.  Time spent in
+ *  API functions called by the function is included in its time.
+ */
+#define API_TIMED() \
+   static Api_Call_Stats * api_call_site_stats = NULL; \
+   __attribute__((cleanup(api_call_timer_end))) Api_Call_Timer api_call_timer = \
+         api_call_timer_start(&api_call_site_stats, __func__)
+
+void   reset_api_call_stats();
+void   report_api_call_stats(int depth);
+void   export_api_call_stats(Stats_Export * exp);
+
+#endif /* API_CALL_STATS_H_ */
@@ -9,13 +9,21 @@
 
 #include "core.h"
 #include "ddc_packets.h"
+#include "display_health.h"
 #include "displays.h"
 #include "dynamic_features.h"
 #include "dynamic_sleep.h"
 #include "execution_stats.h"
+#include "executor.h"
+#include "io_timeline.h"
 #include "linux_errno.h"
+#include "monitor_quirks.h"
 #include "per_thread_data.h"
+#include "persistent_store.h"
+#include "shared_sleep.h"
 #include "sleep.h"
+#include "thread_sched.h"
+#include "trace_writer.h"
 #include "tuned_sleep.h"
 
 #include "base_init.h"
@@ -28,20 +36,32 @@ void init_base_services() {
    if (debug)
       printf("(%s) Starting.\n", __func__);
    errinfo_init(psc_name, psc_desc);
-   init_sleep_stats();
-   init_tuned_sleep();
-   init_execution_stats();
-   init_status_code_mgt();
+   RECORD_STARTUP_INIT(init_sleep_stats);
+   RECORD_STARTUP_INIT(init_tuned_sleep);
+   RECORD_STARTUP_INIT(init_shared_sleep);
+   RECORD_STARTUP_INIT(init_thread_sched);
+   RECORD_STARTUP_INIT(init_execution_stats);
+   RECORD_STARTUP_INIT(init_executor);
+   RECORD_STARTUP_INIT(init_io_timeline);
+   RECORD_STARTUP_INIT(init_status_code_mgt);
    // init_linux_errno();
-   init_thread_data_module();
-   init_displays();
-   init_ddc_packets();
-   init_dynamic_sleep();
-   init_base_dynamic_features();
+   RECORD_STARTUP_INIT(init_thread_data_module);
+   RECORD_STARTUP_INIT(init_displays);
+   RECORD_STARTUP_INIT(init_monitor_quirks);
+   RECORD_STARTUP_INIT(init_persistent_store);
+   RECORD_STARTUP_INIT(init_ddc_packets);
+   RECORD_STARTUP_INIT(init_dynamic_sleep);
+   RECORD_STARTUP_INIT(init_display_health);
+   RECORD_STARTUP_INIT(init_base_dynamic_features);
    if (debug)
       printf("(%s) Done\n", __func__);
 }
 
 void release_base_services() {
+   release_executor();
+   stop_trace_writer();
+   io_timeline_stop();
+   release_dynamic_sleep();
+   release_shared_sleep();
    release_thread_data_module();
 }
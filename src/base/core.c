@@ -53,6 +53,7 @@
 #include "base/core_per_thread_settings.h"
 #include "base/ddc_errno.h"
 #include "base/linux_errno.h"
+#include "base/trace_writer.h"
 
 #include "base/core.h"
 
@@ -179,6 +180,32 @@ DDCA_Trace_Group trace_class_name_to_value(char * name) {
 
 static DDCA_Trace_Group trace_levels = DDCA_TRC_NONE;   // 0x00
 
+// traced_function_table and traced_file_table were initially implemented using
+// GHashTable.  The implementation had bugs, and given that (a) these data structures
+// are used only for testing and (b) there will be at most a handful of entries in the
+// tables, a simpler GPtrArray implementation is used.
+
+static GPtrArray  * traced_function_table = NULL;
+static GPtrArray  * traced_file_table     = NULL;
+
+/** Set if any trace group, function, or file is being traced.
+ *  Tested by the DBGTRC macros before evaluating their arguments.
+ */
+bool dbgtrc_any_enabled = false;
+
+// Incremented when the traced functions or files change, invalidating
+// the decisions cached in each Dbgtrc_Site.  Starts at 1 so that a
+// zero initialized site is never valid.
+static uint32_t trace_config_generation = 1;
+
+static void trace_config_changed() {
+   dbgtrc_any_enabled = trace_levels != DDCA_TRC_NONE ||
+                        (traced_function_table && traced_function_table->len > 0) ||
+                        (traced_file_table     && traced_file_table->len     > 0);
+   __atomic_add_fetch(&trace_config_generation, 1, __ATOMIC_RELEASE);
+}
+
+
 /** Replaces the groups to be traced.
  *
  * @param trace_flags bit flags indicating groups to trace
@@ -190,6 +217,7 @@ void set_trace_groups(DDCA_Trace_Group trace_flags) {
    DBGMSF(debug, "trace_flags=0x%04x\n", trace_flags);
 
    trace_levels = trace_flags;
+   trace_config_changed();
 }
 
 
@@ -204,18 +232,10 @@ void add_trace_groups(DDCA_Trace_Group trace_flags) {
    DBGMSF(debug, "trace_flags=0x%04x\n", trace_flags);
 
    trace_levels |= trace_flags;
+   trace_config_changed();
 }
 
 
-// traced_function_table and traced_file_table were initially implemented using
-// GHashTable.  The implementation had bugs, and given that (a) these data structures
-// are used only for testing and (b) there will be at most a handful of entries in the
-// tables, a simpler GPtrArray implementation is used.
-
-static GPtrArray  * traced_function_table = NULL;
-static GPtrArray  * traced_file_table     = NULL;
-
-
 /** Adds a function to the list of functions to be traced.
  *
  *  @param funcname function name
@@ -231,6 +251,7 @@ void add_traced_function(const char * funcname) {
    bool missing = (gaux_string_ptr_array_find(traced_function_table, funcname) < 0);
    if (missing)
       g_ptr_array_add(traced_function_table, g_strdup(funcname));
+   trace_config_changed();
 
    if (debug)
       printf("(%s) Done. funcname=|%s|, missing=%s\n",
@@ -271,6 +292,7 @@ void add_traced_file(const char * filename) {
       g_ptr_array_add(traced_file_table, bname);
    else
       free(bname);
+   trace_config_changed();
    if (debug)
       printf("(%s) Done. filename=|%s|, bname=|%s|, missing=%s\n",
              __func__, filename, bname, SBOOL(missing));
@@ -296,7 +318,7 @@ bool is_traced_function(const char * funcname) {
  */
 bool is_traced_file(const char * filename) {
    bool result = false;
-   if (filename) {
+   if (filename && traced_file_table) {
       char * bname = g_path_get_basename(filename);
       result = (traced_file_table && gaux_string_ptr_array_find(traced_file_table, bname) >= 0);
       // printf("(%s) filename=|%s|, bname=|%s|, returning: %s\n", __func__, filename, bname, SBOOL(result));
@@ -418,6 +440,43 @@ bool is_tracing(DDCA_Trace_Group trace_group, const char * filename, const char
 }
 
 
+/** Variant of #is_tracing() that caches whether the calling function or
+ *  file is being traced.
+ *
+ *  The trace group test is inexpensive and is always performed.  The
+ *  searches of the traced function and file lists are performed only if
+ *  the trace configuration has changed since the cached value was saved.
+ *
+ * @param site        cache for the call site
+ * @param trace_group group to check
+ * @param filename    file from which check is occurring
+ * @param funcname    function from which check is occurring
+ *
+ * @return **true** if tracing enabled, **false** if not
+ *
+ * @remark
+ * Normally called using macro IS_TRACING_SITE().  The cached value is
+ * stored as a single word, so threads sharing a site do not need a lock.
+ */
+bool is_tracing_site(
+      Dbgtrc_Site *    site,
+      DDCA_Trace_Group trace_group,
+      const char *     filename,
+      const char *     funcname)
+{
+   if (trace_group == DDCA_TRC_ALL || (trace_levels & trace_group))
+      return true;
+
+   uint32_t generation = __atomic_load_n(&trace_config_generation, __ATOMIC_ACQUIRE);
+   Dbgtrc_Site cached = __atomic_load_n(site, __ATOMIC_RELAXED);
+   if ((cached >> 1) != (generation & 0x7fffffff)) {
+      bool traced = is_traced_function(funcname) || is_traced_file(filename);
+      cached = (generation << 1) | traced;
+      __atomic_store_n(site, cached, __ATOMIC_RELAXED);
+   }
+   return cached & 1;
+}
+
 
 //
 // Error_Info reporting
@@ -882,8 +941,10 @@ static bool vdbgtrc(
    }
 #endif
 
+      // severe messages are not queued, see trace_writer.c
       if (trace_to_syslog || (options & DBGTRC_OPTIONS_SYSLOG)) {
-         syslog(LOG_INFO, "%s", syslog_buf);
+         if ((options & DBGTRC_OPTIONS_SEVERE) || !trace_writer_enqueue(NULL, true, syslog_buf))
+            syslog(LOG_INFO, "%s", syslog_buf);
       }
 
       if (is_tracing(trace_group, filename, funcname)) {
@@ -894,9 +955,11 @@ static bool vdbgtrc(
          else {
             where = thread_settings->fout;
          }
-         f0puts(buf2, where);
-         f0putc('\n', where);
-         fflush(fout());
+         if ((options & DBGTRC_OPTIONS_SEVERE) || !where || !trace_writer_enqueue(where, false, buf2)) {
+            f0puts(buf2, where);
+            f0putc('\n', where);
+            fflush(fout());
+         }
       }
       free(buffer);
       free(buf2);
@@ -85,6 +85,8 @@ extern bool dbgtrc_show_time;       // prefix debug/trace messages with elapsed
 extern bool dbgtrc_show_wall_time;  // prefix debug/trace messages with wall time
 extern bool dbgtrc_show_thread_id;  // prefix debug/trace messages with thread id
 
+extern bool dbgtrc_any_enabled;     // any trace group, function or file is being traced
+
 void set_libddcutil_output_destination(const char * filename, const char * traced_unit);
 void add_traced_function(const char * funcname);
 bool is_traced_function( const char * funcname);
@@ -101,20 +103,50 @@ void report_tracing(int depth);
 
 bool is_tracing(DDCA_Trace_Group trace_group, const char * filename, const char * funcname);
 
+/** Per call site cache of whether the function or file containing a trace
+ *  call is being traced, as (configuration generation << 1) | traced.
+ *  Declared as a static variable at each site by the macros below, so that
+ *  the traced function and file lists are searched only once per site after
+ *  each change to the trace configuration.
+ */
+typedef uint32_t Dbgtrc_Site;
+
+bool is_tracing_site(
+      Dbgtrc_Site *    site,
+      DDCA_Trace_Group trace_group,
+      const char *     filename,
+      const char *     funcname);
+
+#ifdef DISABLE_RUNTIME_TRACING
+// Built with --disable-runtime-tracing.  Trace sites are constant false, so the
+// compiler discards them along with the evaluation of their arguments.
+// The debug flag is still referenced to avoid unused variable warnings.
+#define IS_TRACING_SITE(trace_group) (false)
+#define DBGMSF_ENABLED(debug_flag) (false && (debug_flag))
+#else
+/** Checks if tracing is active for a call site, caching the result of
+ *  the function and file searches in a static variable local to the site.
+ */
+#define IS_TRACING_SITE(trace_group) \
+    ({ static Dbgtrc_Site _dbgtrc_site = 0; \
+       dbgtrc_any_enabled && is_tracing_site(&_dbgtrc_site, (trace_group), __FILE__, __func__); })
+#define DBGMSF_ENABLED(debug_flag) (debug_flag)
+#endif
+
 /** Checks if tracking is currently active for the globally defined TRACE_GROUP value,
  *  current file and function.
  *
  *  Wrappers call to **is_tracing()**, using the current **TRACE_GROUP** value,
  *  filename, and function as implicit arguments.
  */
-#define IS_TRACING() is_tracing(TRACE_GROUP, __FILE__, __func__)
+#define IS_TRACING() IS_TRACING_SITE(TRACE_GROUP)
 
-#define IS_TRACING_GROUP(grp) is_tracing((grp), __FILE__, __func__)
+#define IS_TRACING_GROUP(grp) IS_TRACING_SITE(grp)
 
-#define IS_TRACING_BY_FUNC_OR_FILE() is_tracing(DDCA_TRC_NONE, __FILE__, __func__)
+#define IS_TRACING_BY_FUNC_OR_FILE() IS_TRACING_SITE(DDCA_TRC_NONE)
 
 #define IS_DBGTRC(debug_flag, group) \
-    ( (debug_flag)  || is_tracing((group), __FILE__, __func__) )
+    ( DBGMSF_ENABLED(debug_flag)  || IS_TRACING_SITE(group) )
 
 typedef uint16_t Dbgtrc_Options;
 #define DBGTRC_OPTIONS_NONE   0
@@ -144,7 +176,8 @@ bool is_reporting_ddc(
       DDCA_Trace_Group trace_group,
       const char *     filename,
       const char *     funcname);
-#define IS_REPORTING_DDC() is_reporting_ddc(TRACE_GROUP, __FILE__, __func__)
+#define IS_REPORTING_DDC() \
+    ( is_report_ddc_errors_enabled() || IS_TRACING_SITE(TRACE_GROUP) )
 
 bool ddcmsg(
       DDCA_Trace_Group trace_group,
@@ -162,8 +195,10 @@ bool ddcmsg(
  * @param ...
  */
 #define DDCMSGX(debug_flag, trace_group, format, ...) \
-   ddcmsg(( (debug_flag) ) ? 0xff : (trace_group), \
-            __func__, __LINE__, __FILE__, format, ##__VA_ARGS__)
+   do { bool _tracing = IS_DBGTRC(debug_flag, trace_group); \
+        if (_tracing || is_report_ddc_errors_enabled()) \
+           ddcmsg( (_tracing) ? DDCA_TRC_ALL : DDCA_TRC_NONE, \
+                   __func__, __LINE__, __FILE__, format, ##__VA_ARGS__); } while(0)
 
 
 /** Macro that wrappers function ddcmsg(), passing the current TRACE_GROUP,
@@ -174,8 +209,7 @@ bool ddcmsg(
  * @param ...
  */
 #define DDCMSG(debug_flag, format, ...) \
-   ddcmsg(( (debug_flag) ) ? 0xff : (TRACE_GROUP), \
-            __func__, __LINE__, __FILE__, format, ##__VA_ARGS__)
+   DDCMSGX(debug_flag, TRACE_GROUP, format, ##__VA_ARGS__)
 
 
 // Show report levels for all types
@@ -301,50 +335,62 @@ bool dbgtrc_returning_expression(
           __func__, __LINE__, __FILE__, format, ##__VA_ARGS__)
 
 #define DBGMSF(debug_flag, format, ...) \
-   do { if (debug_flag) dbgtrc(DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
+   do { if (DBGMSF_ENABLED(debug_flag)) dbgtrc(DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
         __func__, __LINE__, __FILE__, format, ##__VA_ARGS__); }  while(0)
 
 // For messages that are issued either if tracing is enabled for the appropriate trace group or
 // if a debug flag is set.
+//
+// If neither is the case the arguments are not evaluated, so a disabled trace
+// site costs a single test of dbgtrc_any_enabled.  Whether a site is traced is
+// decided by IS_DBGTRC(), so dbgtrc() is passed DDCA_TRC_ALL.
 #define DBGTRC(debug_flag, trace_group, format, ...) \
-    dbgtrc( (debug_flag) ? DDCA_TRC_ALL : (trace_group), DBGTRC_OPTIONS_NONE, \
-            __func__, __LINE__, __FILE__, format, ##__VA_ARGS__)
+   do { if (IS_DBGTRC(debug_flag, trace_group)) \
+      dbgtrc( DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
+            __func__, __LINE__, __FILE__, format, ##__VA_ARGS__); } while(0)
 
 #define DBGTRC_SYSLOG(debug_flag, trace_group, format, ...) \
-    dbgtrc( (debug_flag) ? DDCA_TRC_ALL : (trace_group), DBGTRC_OPTIONS_SYSLOG, \
-            __func__, __LINE__, __FILE__, format, ##__VA_ARGS__)
+   do { if (IS_DBGTRC(debug_flag, trace_group)) \
+      dbgtrc( DDCA_TRC_ALL, DBGTRC_OPTIONS_SYSLOG, \
+            __func__, __LINE__, __FILE__, format, ##__VA_ARGS__); } while(0)
 
 #define DBGTRC_STARTING(debug_flag, trace_group, format, ...) \
-    dbgtrc( (debug_flag) ? DDCA_TRC_ALL : (trace_group), DBGTRC_OPTIONS_NONE, \
-            __func__, __LINE__, __FILE__, "Starting  "format, ##__VA_ARGS__)
+   do { if (IS_DBGTRC(debug_flag, trace_group)) \
+      dbgtrc( DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
+            __func__, __LINE__, __FILE__, "Starting  "format, ##__VA_ARGS__); } while(0)
 
 #define DBGTRC_DONE(debug_flag, trace_group, format, ...) \
-    dbgtrc( (debug_flag) ? DDCA_TRC_ALL : (trace_group), DBGTRC_OPTIONS_NONE, \
-            __func__, __LINE__, __FILE__, "Done      "format, ##__VA_ARGS__)
+   do { if (IS_DBGTRC(debug_flag, trace_group)) \
+      dbgtrc( DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
+            __func__, __LINE__, __FILE__, "Done      "format, ##__VA_ARGS__); } while(0)
 
 #define DBGTRC_NOPREFIX(debug_flag, trace_group, format, ...) \
-    dbgtrc( (debug_flag) ? DDCA_TRC_ALL : (trace_group), DBGTRC_OPTIONS_NONE, \
-            __func__, __LINE__, __FILE__, "          "format, ##__VA_ARGS__)
+   do { if (IS_DBGTRC(debug_flag, trace_group)) \
+      dbgtrc( DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
+            __func__, __LINE__, __FILE__, "          "format, ##__VA_ARGS__); } while(0)
 
 #define DBGTRC_RET_DDCRC(debug_flag, trace_group, rc, format, ...) \
-    dbgtrc_ret_ddcrc( \
-          (debug_flag) ? DDCA_TRC_ALL : (trace_group), DBGTRC_OPTIONS_NONE, \
-          __func__, __LINE__, __FILE__, rc, format, ##__VA_ARGS__)
+   do { if (IS_DBGTRC(debug_flag, trace_group)) \
+      dbgtrc_ret_ddcrc( \
+          DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
+          __func__, __LINE__, __FILE__, rc, format, ##__VA_ARGS__); } while(0)
 
 #define DBGTRC_RET_BOOL(debug_flag, trace_group, bool_result, format, ...) \
-    dbgtrc_returning_expression( \
-          (debug_flag) ? DDCA_TRC_ALL : (trace_group), \
+   do { if (IS_DBGTRC(debug_flag, trace_group)) \
+      dbgtrc_returning_expression( \
+          DDCA_TRC_ALL, \
           DBGTRC_OPTIONS_NONE, \
-          __func__, __LINE__, __FILE__, SBOOL(bool_result), format, ##__VA_ARGS__)
+          __func__, __LINE__, __FILE__, SBOOL(bool_result), format, ##__VA_ARGS__); } while(0)
 
 #define DBGTRC_RET_ERRINFO(debug_flag, trace_group, errinfo_result, format, ...) \
-    dbgtrc_returning_errinfo( \
-          (debug_flag) ? DDCA_TRC_ALL : (trace_group), DBGTRC_OPTIONS_NONE, \
-          __func__, __LINE__, __FILE__, errinfo_result, format, ##__VA_ARGS__)
+   do { if (IS_DBGTRC(debug_flag, trace_group)) \
+      dbgtrc_returning_errinfo( \
+          DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
+          __func__, __LINE__, __FILE__, errinfo_result, format, ##__VA_ARGS__); } while(0)
 
 // typedef (*dbg_struct_func)(void * structptr, int depth);
 #define DBGMSF_RET_STRUCT(_flag, _structname, _dbgfunc, _structptr) \
-if (_flag) { \
+if (DBGMSF_ENABLED(_flag)) { \
    dbgtrc(DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
          __func__, __LINE__, __FILE__, "Returning %s at %p", #_structname, _structptr); \
    if (_structptr) { \
@@ -353,7 +399,7 @@ if (_flag) { \
 }
 
 #define DBGTRC_RET_STRUCT(_flag, _trace_group, _structname, _dbgfunc, _structptr) \
-if ( (_flag) || (is_tracing(_trace_group, __FILE__, __func__)) ) { \
+if ( IS_DBGTRC(_flag, _trace_group) ) { \
    dbgtrc(DDCA_TRC_ALL, DBGTRC_OPTIONS_NONE, \
           __func__, __LINE__, __FILE__, \
           "Returning %s at %p", #_structname, _structptr); \
@@ -9,6 +9,8 @@
 #include <config.h>
 
 #include <assert.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -222,7 +224,80 @@ bool isNullPacket(DDC_Packet * packet) {
 }
 
 
+//
+// Per-thread packet pool
+//
+// Every DDC exchange creates a request packet and a response packet, and
+// frees both when done.  Freed packets whose buffers have the standard size
+// are kept on a short per-thread list and reused, so that once a thread has
+// performed its first exchange, subsequent exchanges do not allocate memory.
+//
+
+#define DDC_PACKET_POOL_SIZE     4
+#define DDC_PACKET_POOL_BUFSIZE  (MAX_DDC_PACKET_INC_CHECKSUM+1)
+
+typedef struct {
+   int          ct;
+   DDC_Packet * packets[DDC_PACKET_POOL_SIZE];
+} DDC_Packet_Pool;
+
+// totals for all threads
+static uint64_t packet_create_ct  = 0;   // packets requested
+static uint64_t packet_reuse_ct   = 0;   // of which taken from a pool
+static uint64_t packet_destroy_ct = 0;   // packets actually freed
+
+
+static void destroy_ddc_packet(DDC_Packet * packet) {
+   bool debug = false;
+   __atomic_add_fetch(&packet_destroy_ct, 1, __ATOMIC_RELAXED);
+   DBGMSF(debug, "calling free_buffer() for packet->buf=%p", packet->raw_bytes);
+   buffer_free(packet->raw_bytes, "free DDC packet");
+
+   DBGMSF(debug, "freeing packet=%p", packet);
+   free(packet);
+}
+
+
+static void free_packet_pool(gpointer data) {
+   DDC_Packet_Pool * pool = data;
+   for (int ndx = 0; ndx < pool->ct; ndx++)
+      destroy_ddc_packet(pool->packets[ndx]);
+   free(pool);
+}
+
+
+static GPrivate packet_pool_key = G_PRIVATE_INIT(free_packet_pool);
+
+static DDC_Packet_Pool * get_thread_packet_pool() {
+   DDC_Packet_Pool * pool = g_private_get(&packet_pool_key);
+   if (!pool) {
+      pool = calloc(1, sizeof(DDC_Packet_Pool));
+      g_private_set(&packet_pool_key, pool);
+   }
+   return pool;
+}
+
+
+/** Reports how often DDC packets were reused from the per-thread pools.
+ *
+ *  \param depth  logical indentation depth
+ */
+void report_ddc_packet_stats(int depth) {
+   uint64_t create_ct  = __atomic_load_n(&packet_create_ct,  __ATOMIC_RELAXED);
+   uint64_t reuse_ct   = __atomic_load_n(&packet_reuse_ct,   __ATOMIC_RELAXED);
+   uint64_t destroy_ct = __atomic_load_n(&packet_destroy_ct, __ATOMIC_RELAXED);
+   rpt_label(depth, "DDC packet allocation:");
+   rpt_vstring(depth+1, "Packets created:        %10"PRIu64, create_ct);
+   rpt_vstring(depth+1, "Reused from pool:       %10"PRIu64, reuse_ct);
+   rpt_vstring(depth+1, "Newly allocated:        %10"PRIu64, create_ct - reuse_ct);
+   rpt_vstring(depth+1, "Freed:                  %10"PRIu64, destroy_ct);
+}
+
+
 /** Frees a #DDC_Packet
+ *
+ *  If the packet has a standard size buffer, it is returned to the
+ *  current thread's packet pool instead of being freed.
  *
  *  \param packet pointer to packet to free
  */
@@ -233,34 +308,56 @@ void free_ddc_packet(DDC_Packet * packet) {
    // dump_packet(packet);
 
    if (packet) {
-      if (packet->parsed.raw_parsed) {
-         DBGMSF(debug, "freeing packet->parsed.raw_parsed=%p", packet->parsed.raw_parsed);
-         free(packet->parsed.raw_parsed);
+      // packet->parsed points into packet->parsed_storage, nothing to free
+      DDC_Packet_Pool * pool = get_thread_packet_pool();
+      if (packet->raw_bytes->buffer_size == DDC_PACKET_POOL_BUFSIZE &&
+          packet->raw_bytes->size_increment == 0 &&
+          pool->ct < DDC_PACKET_POOL_SIZE)
+      {
+         DBGMSF(debug, "returning packet=%p to pool", packet);
+         pool->packets[pool->ct++] = packet;
+      }
+      else {
+         destroy_ddc_packet(packet);
       }
-
-      DBGMSF(debug, "calling free_buffer() for packet->buf=%p", packet->raw_bytes);
-      buffer_free(packet->raw_bytes, "free DDC packet");
-
-      DBGMSF(debug, "freeing packet=%p", packet);
-      free(packet);
    }
    DBGMSF(debug, "Done" );
 }
 
 
 /** Base function for creating any DDC packet
+ *
+ *  If **max_size** does not exceed the standard packet size, a packet
+ *  is taken from the current thread's pool if one is available.
  *
  *  \param  max_size  size of buffer allocated for packet bytes
  *  \param  tag       debug string (may be NULL)
- *  \return pointer to newly allocated #DDC_Packet
+ *  \return pointer to #DDC_Packet, to be released using #free_ddc_packet()
  */
 DDC_Packet *
 create_empty_ddc_packet(int max_size, const char * tag) {
    bool debug = false;
    DBGMSF(debug, "Starting. max_size=%d, tag=%s", max_size, (tag) ? tag : "(nil)");
 
-   DDC_Packet * packet = malloc(sizeof(DDC_Packet));
-   packet->raw_bytes = buffer_new(max_size, "empty DDC packet");
+   DDC_Packet * packet = NULL;
+   __atomic_add_fetch(&packet_create_ct, 1, __ATOMIC_RELAXED);
+   if (max_size <= DDC_PACKET_POOL_BUFSIZE) {
+      DDC_Packet_Pool * pool = get_thread_packet_pool();
+      if (pool->ct > 0) {
+         __atomic_add_fetch(&packet_reuse_ct, 1, __ATOMIC_RELAXED);
+         packet = pool->packets[--pool->ct];
+         memset(packet->raw_bytes->bytes, 0, DDC_PACKET_POOL_BUFSIZE);
+         packet->raw_bytes->len = 0;
+      }
+      else {
+         packet = malloc(sizeof(DDC_Packet));
+         packet->raw_bytes = buffer_new(DDC_PACKET_POOL_BUFSIZE, "empty DDC packet");
+      }
+   }
+   else {
+      packet = malloc(sizeof(DDC_Packet));
+      packet->raw_bytes = buffer_new(max_size, "empty DDC packet");
+   }
    if (tag) {
       strncpy(packet->tag, tag, sizeof(packet->tag));  // no need to check if packet->tag truncated
       packet->tag[sizeof(packet->tag)-1] = '\0';
@@ -865,6 +962,110 @@ interpret_vcp_feature_response_std(
 }
 
 
+/** Decodes the raw response to a Get VCP Feature request in a single pass,
+ *  without creating a #DDC_Packet.
+ *
+ *  Performs the checks of #create_ddc_typed_response_packet() for
+ *  expected type DDC_PACKET_TYPE_QUERY_VCP_RESPONSE: source address, length,
+ *  checksum, response opcode, result code, and VCP feature code.  The 11 byte
+ *  response is the innermost data of every getvcp and poll, so the checksum
+ *  is accumulated as the fields are extracted instead of in a separate walk
+ *  of a copied buffer.
+ *
+ * \param  i2c_response_bytes    raw bytes read, starting with the source address
+ * \param  bytect                number of bytes read
+ * \param  requested_vcp_code    feature code of the request
+ * \param  parsed_response       pointer to #Parsed_Nontable_Vcp_Response struct to be filled in
+ *
+ * 
+etval 0    success
+ * 
+etval DDCRC_NULL_RESPONSE
+ * 
+etval DDCRC_DDC_DATA
+ *
+ * 
+emark
+ * As with #interpret_vcp_feature_response_std(), it is not an error if the
+ * result code indicates an unsupported feature.
+ */
+Status_DDC
+decode_ddc_getvcp_response(
+       Byte *                        i2c_response_bytes,
+       int                           bytect,
+       Byte                          requested_vcp_code,
+       Parsed_Nontable_Vcp_Response* parsed_response)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "requested_vcp_code: 0x%02x, i2c_response_bytes: %s",
+          requested_vcp_code, hexstring3_t(i2c_response_bytes, bytect, " ", 4, false));
+
+   memset(parsed_response, 0, sizeof(Parsed_Nontable_Vcp_Response));
+   Byte * b = i2c_response_bytes;
+   if (bytect > 2 && b[0] == 0x6e && b[1] == 0x6e) {
+      DDCMSG(debug, "Quirk: response packet starts with double 0x6e");
+      b++;
+      bytect--;
+   }
+
+   Status_DDC result = DDCRC_DDC_DATA;
+   if (bytect < 3 || b[0] != 0x6e) {
+      DDCMSG(debug, "Unexpected source address 0x%02x, should be 0x6e", b[0]);
+   }
+   else if ((b[1] & 0x7f) == 0) {
+      // DDC Null Message: 6e 80 be
+      if ((0x50 ^ b[0] ^ b[1]) == b[2])
+         result = DDCRC_NULL_RESPONSE;
+      else
+         DDCMSG(debug, "Invalid checksum in DDC Null Message");
+   }
+   else if ((b[1] & 0x7f) != 8 || bytect < 11) {
+      DDCMSG(debug, "Invalid response data length: %d, should be 8", b[1] & 0x7f);
+   }
+   else {
+      // b[2]: feature reply opcode, b[3]: result code, b[4]: VCP opcode,
+      // b[5]: VCP type code, b[6..9]: mh, ml, sh, sl, b[10]: checksum
+      Byte checksum = 0x50 ^ b[0] ^ b[1] ^ b[2] ^ b[3] ^ b[4] ^ b[5] ^ b[6] ^ b[7] ^ b[8] ^ b[9];
+      if (checksum != b[10]) {
+         DDCMSG(debug, "Actual checksum 0x%02x, expected 0x%02x", b[10], checksum);
+      }
+      else if (b[2] != DDC_PACKET_TYPE_QUERY_VCP_RESPONSE) {
+         DDCMSG(debug, "Unexpected response type 0x%02x", b[2]);
+      }
+      else if (b[4] != requested_vcp_code) {
+         DDCMSG(debug, "Unexpected VCP opcode 0x%02x, should be 0x%02x", b[4], requested_vcp_code);
+         parsed_response->vcp_code = b[4];
+      }
+      else if (b[3] == 0x01) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Unsupported VCP Code: 0x%02x", b[4]);
+         parsed_response->vcp_code       = b[4];
+         parsed_response->valid_response = true;
+         result = DDCRC_OK;
+      }
+      else if (b[3] != 0x00) {
+         DDCMSG(debug, "Unexpected result code: 0x%02x", b[3]);
+         parsed_response->vcp_code = b[4];
+      }
+      else {
+         parsed_response->vcp_code         = b[4];
+         parsed_response->valid_response   = true;
+         parsed_response->supported_opcode = true;
+         parsed_response->mh = b[6];
+         parsed_response->ml = b[7];
+         parsed_response->sh = b[8];
+         parsed_response->sl = b[9];
+         result = DDCRC_OK;
+      }
+   }
+
+   if (result < 0)
+      log_status_code(result, __func__);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, result, "");
+   return result;
+}
+
+
 void
 dbgrpt_interpreted_nontable_vcp_response(
         Parsed_Nontable_Vcp_Response * interpreted, int depth)
@@ -950,7 +1151,8 @@ create_ddc_typed_response_packet(
       case DDC_PACKET_TYPE_TABLE_READ_RESPONSE:
          {
             Interpreted_Multi_Part_Read_Fragment * aux_data
-                  = calloc(1, sizeof(Interpreted_Multi_Part_Read_Fragment));
+                  = memset(&packet->parsed_storage.multi_part_read_fragment, 0,
+                           sizeof(Interpreted_Multi_Part_Read_Fragment));
             packet->parsed.multi_part_read_fragment = aux_data;
             rc = interpret_multi_part_read_response(
                    expected_type,
@@ -963,7 +1165,8 @@ create_ddc_typed_response_packet(
       case DDC_PACKET_TYPE_QUERY_VCP_RESPONSE:
          {
             Parsed_Nontable_Vcp_Response * aux_data
-                  = calloc(1, sizeof(Parsed_Nontable_Vcp_Response));
+                  = memset(&packet->parsed_storage.nontable_response, 0,
+                           sizeof(Parsed_Nontable_Vcp_Response));
             packet->parsed.nontable_response = aux_data;
             rc = interpret_vcp_feature_response_std(
                     get_data_start(packet),
@@ -1029,7 +1232,8 @@ create_ddc_multi_part_read_response_packet(
          rc = COUNT_STATUS_CODE(DDCRC_DDC_DATA);    // was DDCRC_INVALID_DATA
       }
       else {
-         Interpreted_Multi_Part_Read_Fragment * aux_data = calloc(1, sizeof(Interpreted_Multi_Part_Read_Fragment));
+         Interpreted_Multi_Part_Read_Fragment * aux_data =
+               memset(&packet->parsed_storage.multi_part_read_fragment, 0, sizeof(Interpreted_Multi_Part_Read_Fragment));
          packet->parsed.multi_part_read_fragment = aux_data;
 
          rc = interpret_multi_part_read_response(
@@ -1089,7 +1293,8 @@ create_ddc_getvcp_response_packet(
          rc = COUNT_STATUS_CODE(DDCRC_DDC_DATA);     // was DDCRC_INVALID_DATA
       }
       else {
-         Parsed_Nontable_Vcp_Response * aux_data = calloc(1, sizeof(Parsed_Nontable_Vcp_Response));
+         Parsed_Nontable_Vcp_Response * aux_data =
+               memset(&packet->parsed_storage.nontable_response, 0, sizeof(Parsed_Nontable_Vcp_Response));
          packet->parsed.nontable_response = aux_data;
 
          rc =  interpret_vcp_feature_response_std(
@@ -1204,6 +1409,7 @@ Status_DDC get_vcp_cur_value(DDC_Packet * packet, int * value_ptr) {
 void init_ddc_packets() {
    RTTI_ADD_FUNC(create_ddc_base_response_packet);
    RTTI_ADD_FUNC(create_ddc_getvcp_response_packet);
+   RTTI_ADD_FUNC(decode_ddc_getvcp_response);
 // RTTI_ADD_FUNC(create_ddc_multi_part_read_response_packet);  // unused
    RTTI_ADD_FUNC(create_ddc_response_packet);
    RTTI_ADD_FUNC(create_ddc_typed_response_packet);
@@ -113,6 +113,10 @@ struct {
       Interpreted_Multi_Part_Read_Fragment * multi_part_read_fragment;
       void *                                 raw_parsed;
    } parsed;
+   union {                              ///< storage pointed to by \p parsed
+      Parsed_Nontable_Vcp_Response           nontable_response;
+      Interpreted_Multi_Part_Read_Fragment   multi_part_read_fragment;
+   } parsed_storage;
 
    // additional fields for new way of parsing result data
    // Parsed_Response_Data * parsed_response;
@@ -120,6 +124,7 @@ struct {
 
 void dbgrpt_packet(DDC_Packet * packet, int depth);
 void free_ddc_packet(DDC_Packet * packet);
+void report_ddc_packet_stats(int depth);
 
 bool is_double_byte(Byte * pb);
 
@@ -206,6 +211,20 @@ create_ddc_getvcp_request_packet(
       Byte          vcp_code,
       const char *  tag);
 
+Status_DDC
+interpret_vcp_feature_response_std(
+      Byte *                         vcp_data_bytes,
+      int                            bytect,
+      Byte                           requested_vcp_code,
+      Parsed_Nontable_Vcp_Response * parsed_response);
+
+Status_DDC
+decode_ddc_getvcp_response(
+      Byte *                         i2c_response_bytes,
+      int                            bytect,
+      Byte                           requested_vcp_code,
+      Parsed_Nontable_Vcp_Response * parsed_response);
+
 Status_DDC
 create_ddc_getvcp_response_packet(
       Byte *        i2c_response_bytes,
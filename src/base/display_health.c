@@ -0,0 +1,264 @@
+/** \file display_health.c
+ *
+ *  Rolling health score of each display, from its recent DDC exchanges.
+ *
+ *  The score, from 0 to 100, starts at 100 and is reduced by:
+ *  - up to 60 points for the recent fraction of tries that failed,
+ *    an exponentially weighted moving average over write/read exchanges
+ *  - up to 20 points for the 95th percentile of the elapsed time of the
+ *    last #HEALTH_LATENCY_SAMPLE_CT write/read exchanges, see
+ *    #DISPLAY_HEALTH_LATENCY_GOOD_MILLIS and #DISPLAY_HEALTH_LATENCY_BAD_MILLIS
+ *  - up to 20 points for the current sleep multiplier, including the
+ *    dynamic sleep adjustment, see #DISPLAY_HEALTH_SLEEP_FACTOR_BAD
+ *
+ *  Unlike the cumulative statistics in ddc_try_stats.c and latency_stats.c,
+ *  the score reflects only recent behavior, so a display recovers once its
+ *  errors stop.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "ddcutil_types.h"
+
+#include "util/report_util.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/dynamic_sleep.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/stats_export.h"
+#include "base/thread_sleep_data.h"
+
+#include "base/display_health.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_BASE;
+
+#define HEALTH_LATENCY_SAMPLE_CT  64
+#define HEALTH_ERROR_RATE_WEIGHT  0.125    // weight of newest exchange in error rate
+
+#define DISPLAY_HEALTH_MARKER "DHLT"
+typedef struct {
+   char         marker[4];
+   DDCA_IO_Path io_path;
+   double       error_rate;
+   uint32_t     latency_micros[HEALTH_LATENCY_SAMPLE_CT];   // circular
+   int          latency_ct;              // valid entries in latency_micros
+   int          latency_next;            // where next entry is stored
+   double       sleep_factor;            // as of the latest exchange
+} Display_Health_Data;
+
+// Records are never freed
+static GPtrArray * display_health_recs;   // protected by display_health_mutex
+static GMutex      display_health_mutex;
+
+
+// Must be called with display_health_mutex held
+static Display_Health_Data *
+find_display_health_data(DDCA_IO_Path io_path, bool create) {
+   if (!display_health_recs)
+      display_health_recs = g_ptr_array_new();
+   for (int ndx = 0; ndx < display_health_recs->len; ndx++) {
+      Display_Health_Data * cur = g_ptr_array_index(display_health_recs, ndx);
+      assert(memcmp(cur->marker, DISPLAY_HEALTH_MARKER, 4) == 0);
+      if (dpath_eq(cur->io_path, io_path))
+         return cur;
+   }
+   Display_Health_Data * result = NULL;
+   if (create) {
+      result = g_new0(Display_Health_Data, 1);
+      memcpy(result->marker, DISPLAY_HEALTH_MARKER, 4);
+      result->io_path = io_path;
+      result->sleep_factor = 1.0;
+      g_ptr_array_add(display_health_recs, result);
+   }
+   return result;
+}
+
+
+static double
+current_sleep_factor(Display_Ref * dref) {
+   double factor = tsd_get_display_sleep_multiplier_factor(dref);
+   if (tsd_get_display_dynamic_sleep_enabled(dref))
+      factor *= dsa_get_max_adjustment_factor(dref);
+   return factor;
+}
+
+
+static int
+compare_uint32(const void * a, const void * b) {
+   uint32_t v1 = *(const uint32_t *) a;
+   uint32_t v2 = *(const uint32_t *) b;
+   return (v1 > v2) - (v1 < v2);
+}
+
+
+// Returns the penalty for value between good (0 points) and bad (max_points)
+static double
+penalty(double value, double good, double bad, double max_points) {
+   if (value <= good)
+      return 0;
+   if (value >= bad)
+      return max_points;
+   return max_points * (value - good) / (bad - good);
+}
+
+
+// Must be called with display_health_mutex held
+static void
+summarize(Display_Health_Data * rec, double sleep_factor, DDCA_Display_Health * health) {
+   memset(health, 0, sizeof(DDCA_Display_Health));
+   health->sleep_factor = sleep_factor;
+   if (rec) {
+      health->error_rate = rec->error_rate;
+      health->sample_ct  = rec->latency_ct;
+      if (rec->latency_ct > 0) {
+         uint32_t sorted[HEALTH_LATENCY_SAMPLE_CT];
+         memcpy(sorted, rec->latency_micros, rec->latency_ct * sizeof(uint32_t));
+         qsort(sorted, rec->latency_ct, sizeof(uint32_t), compare_uint32);
+         health->p95_latency_micros = sorted[(rec->latency_ct * 95 - 1) / 100];
+      }
+   }
+
+   double score = 100.0
+         - 60.0 * health->error_rate
+         - penalty(health->p95_latency_micros / 1000.0,
+                   DISPLAY_HEALTH_LATENCY_GOOD_MILLIS, DISPLAY_HEALTH_LATENCY_BAD_MILLIS, 20.0)
+         - penalty(sleep_factor, 1.0, DISPLAY_HEALTH_SLEEP_FACTOR_BAD, 20.0);
+   health->score = (score < 0) ? 0 : (int) (score + 0.5);
+}
+
+
+/** Records the result of a write/read exchange with a display.
+ *
+ *  \param  dref           display reference
+ *  \param  psc            final status code of the exchange
+ *  \param  tryct          number of tries
+ *  \param  elapsed_nanos  elapsed time of the exchange, including retries
+ */
+void record_display_health(Display_Ref * dref, int psc, int tryct, uint64_t elapsed_nanos) {
+   bool debug = false;
+   double sleep_factor = current_sleep_factor(dref);
+   int errct = (psc == 0) ? tryct-1 : tryct;
+   double cur_rate = (tryct > 0) ? (double) errct / tryct : 0.0;
+
+   g_mutex_lock(&display_health_mutex);
+   Display_Health_Data * rec = find_display_health_data(dref->io_path, true);
+   if (rec->latency_ct == 0)
+      rec->error_rate = cur_rate;
+   else
+      rec->error_rate += HEALTH_ERROR_RATE_WEIGHT * (cur_rate - rec->error_rate);
+   uint64_t micros = elapsed_nanos / 1000;
+   rec->latency_micros[rec->latency_next] = (micros > UINT32_MAX) ? UINT32_MAX : micros;
+   rec->latency_next = (rec->latency_next + 1) % HEALTH_LATENCY_SAMPLE_CT;
+   if (rec->latency_ct < HEALTH_LATENCY_SAMPLE_CT)
+      rec->latency_ct++;
+   rec->sleep_factor = sleep_factor;
+   double error_rate = rec->error_rate;
+   g_mutex_unlock(&display_health_mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "dref=%s, psc=%d, tryct=%d, error_rate=%4.2f",
+                              dref_repr_t(dref), psc, tryct, error_rate);
+}
+
+
+/** Gets the current health of a display.
+ *
+ *  \param  dref    display reference
+ *  \param  health  where to return the health
+ */
+void get_display_health(Display_Ref * dref, DDCA_Display_Health * health) {
+   double sleep_factor = current_sleep_factor(dref);
+   g_mutex_lock(&display_health_mutex);
+   summarize(find_display_health_data(dref->io_path, false), sleep_factor, health);
+   g_mutex_unlock(&display_health_mutex);
+}
+
+
+/** Returns the current health score of a display.
+ *
+ *  \param  dref    display reference
+ *  \return score, 0..100
+ */
+int get_display_health_score(Display_Ref * dref) {
+   DDCA_Display_Health health;
+   get_display_health(dref, &health);
+   return health.score;
+}
+
+
+/** Discards the recent history of all displays */
+void reset_display_health() {
+   g_mutex_lock(&display_health_mutex);
+   if (display_health_recs) {
+      for (int ndx = 0; ndx < display_health_recs->len; ndx++) {
+         Display_Health_Data * rec = g_ptr_array_index(display_health_recs, ndx);
+         rec->error_rate   = 0.0;
+         rec->latency_ct   = 0;
+         rec->latency_next = 0;
+      }
+   }
+   g_mutex_unlock(&display_health_mutex);
+}
+
+
+/** Reports the health of each display on which exchanges have occurred.
+ *  The sleep factor is that of the latest exchange.
+ *
+ *  \param depth logical indentation depth
+ */
+void report_display_health(int depth) {
+   int d1 = depth+1;
+   rpt_title("Display health:", depth);
+   g_mutex_lock(&display_health_mutex);
+   int ct = (display_health_recs) ? display_health_recs->len : 0;
+   if (ct == 0)
+      rpt_vstring(d1, "No exchanges");
+   else
+      rpt_vstring(d1, "%-20s %5s  %10s  %12s  %12s  %7s",
+                      "Display", "Score", "Error rate", "p95 (usec)", "Sleep factor", "Samples");
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Display_Health_Data * rec = g_ptr_array_index(display_health_recs, ndx);
+      DDCA_Display_Health health;
+      summarize(rec, rec->sleep_factor, &health);
+      rpt_vstring(d1, "%-20s %5d  %10.3f  %12"PRIu64"  %12.2f  %7d",
+                      dpath_repr_t(&rec->io_path), health.score, health.error_rate,
+                      health.p95_latency_micros, health.sleep_factor, health.sample_ct);
+   }
+   g_mutex_unlock(&display_health_mutex);
+}
+
+
+/** Exports the health score of each display.
+ *
+ *  \param exp  export instance
+ */
+void export_display_health(Stats_Export * exp) {
+   stats_export_metric(exp, "ddcutil_display_health_score", STATS_METRIC_GAUGE,
+                            "Health of recent DDC exchanges, 0..100, by display");
+   g_mutex_lock(&display_health_mutex);
+   int ct = (display_health_recs) ? display_health_recs->len : 0;
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Display_Health_Data * rec = g_ptr_array_index(display_health_recs, ndx);
+      DDCA_Display_Health health;
+      summarize(rec, rec->sleep_factor, &health);
+      char * display = g_strdup(dpath_repr_t(&rec->io_path));
+      stats_export_sample(exp, "ddcutil_display_health_score", health.score, 1, "display", display);
+      g_free(display);
+   }
+   g_mutex_unlock(&display_health_mutex);
+}
+
+
+void init_display_health() {
+   RTTI_ADD_FUNC(record_display_health);
+}
@@ -0,0 +1,29 @@
+/** \file display_health.h
+ *
+ *  Rolling health score of each display, from its recent DDC exchanges.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DISPLAY_HEALTH_H_
+#define DISPLAY_HEALTH_H_
+
+/** \cond */
+#include <inttypes.h>
+/** \endcond */
+
+#include "ddcutil_types.h"
+
+#include "base/displays.h"
+#include "base/stats_export.h"
+
+void   record_display_health(Display_Ref * dref, int psc, int tryct, uint64_t elapsed_nanos);
+void   get_display_health(Display_Ref * dref, DDCA_Display_Health * health);
+int    get_display_health_score(Display_Ref * dref);
+void   reset_display_health();
+void   report_display_health(int depth);
+void   export_display_health(Stats_Export * exp);
+void   init_display_health();
+
+#endif /* DISPLAY_HEALTH_H_ */
@@ -15,7 +15,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "util/alloc_stats.h"
 #include "util/data_structures.h"
+#include "util/glib_string_util.h"
 #include "util/glib_util.h"
 #include "util/string_util.h"
 #include "util/report_util.h"
@@ -120,13 +122,11 @@ Display_Async_Rec * display_async_rec_new(DDCA_IO_Path dpath) {
 
    newrec->request_queue = g_queue_new();
    g_mutex_init(&newrec->request_queue_lock);
-#ifdef FUTURE
-   newrec->request_execution_thread =
-         g_thread_new(
-               strdup(dpath_repr_t(dref)),       // thread name
-               NULL,                             // GThreadFunc    *** TEMP ***
-               dref->request_queue);             // or just dref?, how to pass dh?
-#endif
+   g_cond_init(&newrec->request_queue_cond);
+   // request_execution_thread is started by ddc_queue_async_request()
+
+   g_mutex_init(&newrec->transaction_lock);
+   g_cond_init(&newrec->transaction_cond);
 
    return newrec;
 }
@@ -578,7 +578,7 @@ char * dpath_repr_t(DDCA_IO_Path * dpath) {
 // *** Display_Ref ***
 
 static Display_Ref * create_base_display_ref(DDCA_IO_Path io_path) {
-   Display_Ref * dref = calloc(1, sizeof(Display_Ref));
+   Display_Ref * dref = counted_calloc(ALLOC_DISPLAY_REF, sizeof(Display_Ref));
    memcpy(dref->marker, DISPLAY_REF_MARKER, 4);
    dref->io_path = io_path;
    dref->vcp_version_xdf = DDCA_VSPEC_UNQUERIED;
@@ -658,6 +658,23 @@ Display_Ref * clone_display_ref(Display_Ref * old) {
 #endif
 
 
+/** Frees the resolved feature metadata cached for a display reference.
+ *
+ *  \param  dref  display reference
+ *
+ *  \remark
+ *  Pointers obtained from the cache are invalid after this call.
+ */
+void dref_free_dfm_cache(Display_Ref * dref) {
+   if (dref->dfm_cache) {
+      for (int ndx = 0; ndx < 256; ndx++)
+         dfm_free(dref->dfm_cache[ndx]);
+      free(dref->dfm_cache);
+      dref->dfm_cache = NULL;
+   }
+}
+
+
 /** Frees a display reference.
  *
  *  \param  dref  ptr to display reference to free, if NULL no operation is performed
@@ -683,16 +700,29 @@ DDCA_Status free_display_ref(Display_Ref * dref) {
          else {
             if (dref->usb_hiddev_name)       // always set using strdup()
                free(dref->usb_hiddev_name);
-            if (dref->capabilities_string)   // always a private copy
-               free(dref->capabilities_string);
+            if (dref->capabilities_string)   // interned, see gaux_intern_string()
+               gaux_release_interned_string(dref->capabilities_string);
             if (dref->mmid)                  // always a private copy
                free(dref->mmid);
             // 9/2017: what about pedid, detail2?
             // what to do with gdl, request_queue?
             if (dref->dfr)
                dfr_free(dref->dfr);
+            dref_free_dfm_cache(dref);
+            if (dref->feature_set_cache)     // free func set by creator
+               g_ptr_array_free(dref->feature_set_cache, true);
+            free(dref->vcp_value_cache);
+            free(dref->verify_history);
+            if (dref->table_value_memo) {
+               for (int ndx = 0; ndx < 256; ndx++) {
+                  if (dref->table_value_memo[ndx])
+                     buffer_free(dref->table_value_memo[ndx], __func__);
+               }
+               free(dref->table_value_memo);
+            }
+            g_free(dref->power_state.drm_connector);
             dref->marker[3] = 'x';
-            free(dref);
+            counted_free(ALLOC_DISPLAY_REF, dref, sizeof(Display_Ref));
          }
       }
    }
@@ -740,6 +770,7 @@ void dbgrpt_display_ref(Display_Ref * dref, int depth) {
    rpt_vstring(d1, "vcp_version_xdf:  %s", format_vspec(dref->vcp_version_xdf) );
    rpt_vstring(d1, "flags:            %s", interpret_dref_flags_t(dref->flags) );
    rpt_vstring(d1, "mmid:             %s", (dref->mmid) ? mmk_repr(*dref->mmid) : "NULL");
+   rpt_vstring(d1, "unsupported:      %s", bs256_to_string(dref->unsupported_features, "x", " "));
 
    DBGMSF(debug, "Done");
 }
@@ -793,6 +824,7 @@ Display_Handle * create_base_display_handle(int fd, Display_Ref * dref) {
    memcpy(dh->marker, DISPLAY_HANDLE_MARKER, 4);
    dh->fd = fd;
    dh->dref = dref;
+   g_rec_mutex_init(&dh->io_mutex);
    if (dref->io_path.io_mode == DDCA_IO_I2C) {
       dh->repr = g_strdup_printf(
                      "Display_Handle[i2c-%d: fd=%d @%p]",
@@ -887,6 +919,7 @@ void   free_display_handle(Display_Handle * dh) {
    DBGTRC_STARTING(debug, DDCA_TRC_BASE, "dh=%p -> %s", dh, dh_repr(dh));
    if (dh && memcmp(dh->marker, DISPLAY_HANDLE_MARKER, 4) == 0) {
       dh->marker[3] = 'x';
+      g_rec_mutex_clear(&dh->io_mutex);
       free(dh->repr);
       free(dh);
    }
@@ -953,6 +986,9 @@ Value_Name_Table dref_flags_table = {
       VN(DREF_DDC_USES_MH_ML_SH_SL_ZERO_FOR_UNSUPPORTED),
       VN(DREF_DDC_USES_DDC_FLAG_FOR_UNSUPPORTED),
       VN(DREF_DDC_DOES_NOT_INDICATE_UNSUPPORTED),
+      VN(DREF_UNSUPPORTED_FEATURES_CHECKED),
+      VN(DREF_UNSUPPORTED_FEATURES_CHANGED),
+      VN(DREF_I2C_COMBINED_WRITE_READ),
       VN(DREF_DDC_BUSY),
       VN(CALLOPT_NONE),                // special entry
       VN_END
@@ -13,6 +13,7 @@
 #include <stdbool.h>
 
 #include "util/coredefs.h"
+#include "util/data_structures.h"
 #include "util/edid.h"
 /** \endcond */
 
@@ -21,6 +22,7 @@
 
 #include "core.h"
 #include "dynamic_features.h"
+#include "feature_metadata.h"
 #include "feature_set_ref.h"
 #include "vcp_version.h"
 
@@ -73,10 +75,31 @@ typedef struct Display_Async {
    GThread *     thread_owning_display_lock;     // id of thread owning lock (type int is placeholder)
    GMutex        display_lock;
 
-   // for future request queue structure
+   // queue of Display_Async_Request, see ddc_async_requests.c
    GQueue *      request_queue;
-   GMutex        request_queue_lock;
-   GThread *     request_execution_thread;  // or in DH?
+   GMutex        request_queue_lock;         // protects the request fields
+   GCond         request_queue_cond;         // signaled when queue or execution state changes
+   GThread *     request_execution_thread;   // started when first request queued
+   bool          request_executing;
+   bool          request_thread_shutdown;
+   gint64        save_settings_due;          // g_get_monotonic_time() of debounced save, 0 if none
+   struct _display_handle * save_settings_dh;   // handle for debounced save
+
+   // scheduling of DDC transactions on the bus, see ddc_io_scheduler.c
+   GMutex        transaction_lock;           // protects the transaction fields
+   GCond         transaction_cond;           // signaled when a transaction ends
+   GThread *     transaction_thread;         // thread performing a transaction, NULL if none
+   int           transaction_depth;          // nesting level within transaction_thread
+   int           transactions_waiting[DDCA_IO_PRIORITY_INTERACTIVE+1];  // by priority
+   uint64_t      next_transaction_start;     // nanosec, CLOCK_MONOTONIC, if rate limited
+   uint64_t      next_background_start;      // nanosec, CLOCK_MONOTONIC, if display unhealthy
+   struct Adapter_Slots * adapter_slots;     // shared by buses on the same physical adapter
+   bool          adapter_slots_resolved;
+   bool          holds_adapter_slot;         // transaction_thread holds one of adapter_slots
+   uint64_t      settle_until;               // nanosec, CLOCK_MONOTONIC, see ddc_settle_window.c
+   uint64_t      settle_write_time;          // nanosec, CLOCK_MONOTONIC, of disruptive write
+   Byte          settle_feature;             // feature of disruptive write
+   bool          settle_probing;             // next transaction measures the settle window
 } Display_Async_Rec;
 
 
@@ -166,8 +189,17 @@ typedef uint16_t Dref_Flags;
 #define DREF_DDC_USES_MH_ML_SH_SL_ZERO_FOR_UNSUPPORTED 0x0400
 #define DREF_DDC_USES_DDC_FLAG_FOR_UNSUPPORTED         0x0200
 #define DREF_DDC_DOES_NOT_INDICATE_UNSUPPORTED         0x0100
+#define DREF_UNSUPPORTED_FEATURES_CHECKED              0x1000
+#define DREF_UNSUPPORTED_FEATURES_CHANGED              0x2000
+#define DREF_I2C_COMBINED_WRITE_READ                   0x4000
 #define DREF_DDC_BUSY                                  0x8000
 
+// How the monitor indicates that a feature is unsupported
+#define DREF_DDC_UNSUPPORTED_SIGNALING_FLAGS (DREF_DDC_USES_NULL_RESPONSE_FOR_UNSUPPORTED    | \
+                                              DREF_DDC_USES_MH_ML_SH_SL_ZERO_FOR_UNSUPPORTED | \
+                                              DREF_DDC_USES_DDC_FLAG_FOR_UNSUPPORTED         | \
+                                              DREF_DDC_DOES_NOT_INDICATE_UNSUPPORTED)
+
 char * interpret_dref_flags_t(Dref_Flags flags);    // replaces dref_basic_flags()?
 
 // define in ddcutil_types.h?, or perhaps use -1 for generic invalid, put type of invalid in Dref_Flags?
@@ -177,6 +209,36 @@ char * interpret_dref_flags_t(Dref_Flags flags);    // replaces dref_basic_flags
 #define DISPNO_REMOVED -3
 #define DISPNO_BUSY    -4
 
+/** Cached value of a non-table VCP feature, see ddc_vcp_value_cache.c */
+typedef struct {
+   uint64_t expires_at;      // nanosec, CLOCK_MONOTONIC, 0 if no value cached
+   Byte     mh;
+   Byte     ml;
+   Byte     sh;
+   Byte     sl;
+} Cached_Vcp_Value;
+
+/** Recent verifications of writes to a feature, see ddc_adaptive_verify.c */
+typedef struct {
+   uint16_t pass_streak;       // consecutive verifications that passed
+   uint16_t unverified_ct;     // writes not verified since the last verification
+} Verify_History;
+
+/** Per display settings that override the thread or global settings.
+ *  Zero values mean that the thread or global setting applies. */
+typedef struct {
+   double   sleep_multiplier;        // 0 if not set
+   Byte     max_tries[4];            // indexed by Retry_Operation, 0 if not set
+   int8_t   dynamic_sleep;           // 1 enabled, -1 disabled, 0 if not set
+} Display_Io_Settings;
+
+/** Power state of a display, see ddc_power_state.c */
+typedef struct {
+   char *   drm_connector;   // DRM connector name, "" if none, NULL if not yet determined
+   bool     dpms_off;        // connector dpms attribute was other than "On" when last read
+   uint64_t asleep_until;    // nanosec, CLOCK_MONOTONIC, if xD6 reported a power saving mode
+} Display_Power_State;
+
 #define DISPLAY_REF_MARKER "DREF"
 /** A **Display_Ref** is a logical display identifier.
  * It can contain an I2C bus number or a USB bus number/device number pair.
@@ -197,8 +259,18 @@ typedef struct _display_ref {
    void *                   detail;                // I2C_Bus_Info or Usb_Monitor_Info
    Display_Async_Rec *      async_rec;
    Dynamic_Features_Rec *   dfr;                   // user defined feature metadata
-   uint64_t                 next_i2c_io_after;     // nanosec
+   uint64_t                 next_i2c_io_after;     // nanosec, CLOCK_MONOTONIC
+   Bit_Set_256              unsupported_features;  // features known to be unsupported
    struct _display_ref *    actual_display;        // if dispno == -2
+   Display_Feature_Metadata ** dfm_cache;          // 256 entries, resolved feature metadata
+   DDCA_MCCS_Version_Spec   dfm_cache_vspec;       // VCP version for which dfm_cache was built
+   GPtrArray *              feature_set_cache;     // Dyn_Feature_Set *, see dyn_create_feature_set()
+   Cached_Vcp_Value *       vcp_value_cache;       // 256 entries, allocated on first use
+   Buffer **                table_value_memo;      // 256 entries, allocated on first use
+   Verify_History *         verify_history;        // 256 entries, allocated on first use
+   Display_Power_State      power_state;
+   Display_Io_Settings      io_settings;           // per display overrides
+   int                      null_response_backoff_millis;  // delay before retrying a DDC Null Message, 0 if none
 } Display_Ref;
 
 #define ASSERT_DREF_IO_MODE(_dref, _mode)  \
@@ -212,6 +284,7 @@ void          dbgrpt_display_ref(Display_Ref * dref, int depth);
 char *        dref_short_name_t(Display_Ref * dref);
 char *        dref_repr_t(Display_Ref * dref);  // value valid until next call
 DDCA_Status   free_display_ref(Display_Ref * dref);
+void          dref_free_dfm_cache(Display_Ref * dref);
 
 // Do two Display_Ref's identify the same device?
 bool dref_eq(Display_Ref* this, Display_Ref* that);
@@ -221,11 +294,12 @@ bool dref_eq(Display_Ref* this, Display_Ref* that);
 
 #define DISPLAY_HANDLE_MARKER "DSPH"
 /** Describes an open display device. */
-typedef struct {
+typedef struct _display_handle {
    char         marker[4];
    Display_Ref* dref;
    int          fd;     // file descriptor
    char *       repr;
+   GRecMutex    io_mutex;  // serializes operations on the handle by different threads
 } Display_Handle;
 
 Display_Handle * create_base_display_handle(int fd, Display_Ref * dref);
@@ -1,6 +1,22 @@
 /** @file dynamic_sleep.c
  *
  *  Experimental dynamic sleep adjustment
+ *
+ *  For each display and sleep event type, an exponentially weighted moving
+ *  average of the DDC error rate is maintained.  When it exceeds
+ *  #DSA_ERROR_RATE_THRESHOLD the sleep time is lengthened.  After a run of
+ *  good status codes the sleep time is tentatively shortened, towards
+ *  #DSA_TARGET_SLEEP_FRACTION of the spec value.  The shorter time is kept
+ *  if the error rate stays below the threshold for #DSA_PROBE_SAMPLE_CT
+ *  status codes, otherwise the prior time is restored and the interval
+ *  before the next probe is doubled.  Sleep times therefore track what a
+ *  monitor currently needs, instead of remaining at the longest time ever
+ *  required.
+ *
+ *  Some monitors answer the first exchange after being idle for a few
+ *  seconds more slowly than the following ones.  The sleep for that first
+ *  exchange is therefore multiplied by a separate factor, learned for each
+ *  range of idle time, so that bursts of exchanges keep the short sleep.
  */
 
 // Copyright (C) 2020-2022 Sanford Rockowitz <rockowitz@minsoft.com>
@@ -18,16 +34,22 @@
 
 #include "ddcutil_status_codes.h"
 
+#include "util/error_info.h"
+#include "util/file_util.h"
 #include "util/glib_util.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/xdg_util.h"
 
 #include "base/core.h"
+#include "base/last_io_event.h"
 #include "base/sleep.h"
 #include "base/parms.h"
 #include "base/ddc_errno.h"
 #include "base/linux_errno.h"
+#include "base/monitor_model_key.h"
 #include "base/rtti.h"
+#include "base/stats_export.h"
 #include "base/thread_sleep_data.h"
 
 #include "base/dynamic_sleep.h"
@@ -36,206 +58,816 @@
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_NONE;
 
 
-void dsa_record_ddcrw_status_code(int rc) {
+//
+// Persistent adjustment factors
+//
+// The sleep adjustment factors learned for a monitor model are saved in
+// file $HOME/.cache/ddcutil/dsa, so that the next execution starts with
+// the learned values instead of relearning them from 1.0.  There is one
+// factor for each sleep event type.  Keys have the form
+// <monitor model string>:<sleep event name>
+//
+
+#define DSA_FRAGMENT_PACING_NAME "FRAGMENT_PACING"   // persistent value name, not a sleep event
+
+static GHashTable * dsa_persistent_hash = NULL;  // model string:event name -> double *
+static bool         dsa_persistent_hash_changed = false;
+static GMutex       dsa_persistent_mutex;
+
+
+/** Returns the name of the file that stores persistent sleep adjustment factors
+ *
+ *  \return name of file, normally $HOME/.cache/ddcutil/dsa
+ */
+/* caller is responsible for freeing returned value */
+char * dsa_get_persistent_stats_file_name() {
+   return xdg_cache_home_file("ddcutil", "dsa");
+}
+
+
+static void dbgrpt_dsa_persistent_hash0(int depth) {
+   if (!dsa_persistent_hash)
+      rpt_label(depth, "No dsa persistent hash table");
+   else if (g_hash_table_size(dsa_persistent_hash) == 0)
+      rpt_label(depth, "Empty dsa persistent hash table");
+   else {
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, dsa_persistent_hash);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         rpt_vstring(depth, "%s : %5.2f", (char *) key, *(double*) value);
+      }
+   }
+}
+
+
+// Called with dsa_persistent_mutex locked
+static Error_Info * dsa_load_persistent_stats_file() {
    bool debug = false;
-   DBGMSF(debug, "rc=%s", psc_desc(rc));
-   Per_Thread_Data * tsd = tsd_get_thread_sleep_data();
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   if (dsa_persistent_hash)
+      g_hash_table_destroy(dsa_persistent_hash);
+   dsa_persistent_hash = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+   dsa_persistent_hash_changed = false;
+
+   char * data_file_name = dsa_get_persistent_stats_file_name();
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "data_file_name: %s", data_file_name);
+   GPtrArray * linearray = g_ptr_array_new_with_free_func(g_free);
+   Error_Info * errs = file_getlines_errinfo(data_file_name, linearray);
+   free(data_file_name);
+   if (!errs) {
+      for (int ndx = 0; ndx < linearray->len; ndx++) {
+         char * aline = strtrim(g_ptr_array_index(linearray, ndx));
+         if (strlen(aline) > 0 && aline[0] != '*' && aline[0] != '#') {
+            // model names can contain colons, the factor cannot
+            char * colon = strrchr(aline, ':');
+            double factor = 0.0;
+            if (colon) {
+               *colon = '\0';
+               char * endptr = NULL;
+               factor = strtod(colon+1, &endptr);
+               if (endptr == colon+1 || *endptr != '\0')
+                  factor = 0.0;
+            }
+            if (factor <= 0.0) {
+               if (!errs)
+                  errs = errinfo_new(DDCRC_BAD_DATA, __func__);
+               errinfo_add_cause(errs, errinfo_new2(DDCRC_BAD_DATA, __func__,
+                                                    "Line %d, Invalid entry: %s", ndx+1, aline));
+            }
+            else {
+               double * pfactor = malloc(sizeof(double));
+               *pfactor = factor;
+               g_hash_table_insert(dsa_persistent_hash, strdup(aline), pfactor);
+            }
+         }
+         free(aline);
+      }
+   }
+   g_ptr_array_free(linearray, true);
 
-   if (rc == DDCRC_OK) {
-      tsd->cur_ok_status_count++;
-      tsd->total_ok_status_count++;
+   if (debug || IS_TRACING()) {
+      DBGTRC_RET_ERRINFO(true, TRACE_GROUP, errs, "dsa_persistent_hash:");
+      dbgrpt_dsa_persistent_hash0(2);
    }
-   else if (rc == DDCRC_DDC_DATA ||
-            rc == DDCRC_READ_ALL_ZERO ||
-            rc == -ENXIO  || // this is problematic - could indicate data error or actual response
-            rc == -EIO    ||   // but that's ok - be pessimistic re error rates
-            rc == DDCRC_NULL_RESPONSE  // can be either a valid "No Value" response, or indicate a display error
-           )
-   {
-      tsd->cur_error_status_count++;
-      tsd->total_error_status_count++;
+   return errs;
+}
+
+
+// Called with dsa_persistent_mutex locked
+static void dsa_ensure_persistent_stats_loaded() {
+   if (!dsa_persistent_hash) {
+      Error_Info * errs = dsa_load_persistent_stats_file();
+      if (errs) {
+         if (ERRINFO_STATUS(errs) == -ENOENT)
+            errinfo_free(errs);
+         else
+            ERRINFO_FREE_WITH_REPORT(errs, true);
+      }
    }
-   else {
-      DBGMSF(debug, "other status code: %s", psc_desc(rc));
-      tsd->total_other_status_ct++;
+}
+
+
+// Caller is responsible for freeing the returned value
+static char * dsa_persistent_key(DDCA_Monitor_Model_Key * mmk, const char * value_name) {
+   return g_strdup_printf("%s:%s", monitor_model_string(mmk), value_name);
+}
+
+
+static double dsa_get_persistent_value(
+      DDCA_Monitor_Model_Key * mmk,
+      const char *             value_name)
+{
+   bool debug = false;
+   double result = 1.0;     // also the neutral value of every persistent factor
+   if (mmk) {
+      char * key = dsa_persistent_key(mmk, value_name);
+      g_mutex_lock(&dsa_persistent_mutex);
+      dsa_ensure_persistent_stats_loaded();
+      double * pfactor = g_hash_table_lookup(dsa_persistent_hash, key);
+      if (pfactor)
+         result = *pfactor;
+      g_mutex_unlock(&dsa_persistent_mutex);
+      DBGTRC(debug, TRACE_GROUP, "key=%s, returning %5.2f", key, result);
+      g_free(key);
    }
-   DBGMSF(debug, "Done. current_ok_status_count=%d, current_error_status_count=%d",
-                 tsd->cur_ok_status_count, tsd->cur_error_status_count);
+   return result;
 }
 
 
-static void dsa_reset_cur_status_counts() {
+static void dsa_set_persistent_value(
+      DDCA_Monitor_Model_Key * mmk,
+      const char *             value_name,
+      double                   factor)
+{
    bool debug = false;
-   DBGTRC(debug, TRACE_GROUP, "Executing");
-   Per_Thread_Data * data = tsd_get_thread_sleep_data();
+   if (!mmk)
+      return;
+   char * key = dsa_persistent_key(mmk, value_name);
+   DBGTRC(debug, TRACE_GROUP, "key=%s, factor=%5.2f", key, factor);
+   g_mutex_lock(&dsa_persistent_mutex);
+   dsa_ensure_persistent_stats_loaded();
+   double * pfactor = g_hash_table_lookup(dsa_persistent_hash, key);
+   if (!pfactor) {
+      pfactor = malloc(sizeof(double));
+      g_hash_table_insert(dsa_persistent_hash, strdup(key), pfactor);
+      *pfactor = 0.0;
+   }
+   if (*pfactor != factor) {
+      *pfactor = factor;
+      dsa_persistent_hash_changed = true;
+   }
+   g_mutex_unlock(&dsa_persistent_mutex);
+   g_free(key);
+}
 
-   data->cur_ok_status_count = 0;
-   data->cur_error_status_count = 0;
+
+/** Looks up the saved sleep adjustment factor for a monitor model
+ *  and sleep event type.
+ *
+ *  \param  mmk         monitor model key, may be NULL
+ *  \param  event_type  sleep event type
+ *  \return saved factor, 1.0 if none
+ */
+double dsa_get_persistent_adjustment_factor(
+      DDCA_Monitor_Model_Key * mmk,
+      Sleep_Event_Type         event_type)
+{
+   return dsa_get_persistent_value(mmk, sleep_event_name(event_type));
 }
 
 
-static int dsa_required_status_sample_size = 3;
+/** Records the current sleep adjustment factor for a monitor model
+ *  and sleep event type.
+ *  The value is written to the file system by #dsa_save_persistent_stats().
+ *
+ *  \param  mmk         monitor model key, may be NULL
+ *  \param  event_type  sleep event type
+ *  \param  factor      sleep adjustment factor
+ */
+void dsa_set_persistent_adjustment_factor(
+      DDCA_Monitor_Model_Key * mmk,
+      Sleep_Event_Type         event_type,
+      double                   factor)
+{
+   dsa_set_persistent_value(mmk, sleep_event_name(event_type), factor);
+}
+
 
-bool dsa_error_rate_is_high(Per_Thread_Data * tsd) {
-   assert(tsd);
+/** Writes the saved sleep adjustment factors to the file system,
+ *  if any have changed.
+ */
+void dsa_save_persistent_stats() {
    bool debug = false;
-   bool result = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "current_ok_status_count=%d, current_error_status_count=%d",
-         tsd->cur_ok_status_count, tsd->cur_error_status_count);
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dsa_persistent_hash_changed=%s",
+                                       sbool(dsa_persistent_hash_changed));
+   g_mutex_lock(&dsa_persistent_mutex);
+   if (dsa_persistent_hash && dsa_persistent_hash_changed) {
+      char * data_file_name = dsa_get_persistent_stats_file_name();
+      FILE * fp = NULL;
+      fopen_mkdir(data_file_name, "w", ferr(), &fp);
+      if (fp) {
+         fprintf(fp, "* Dynamic sleep adjustment factors, maintained by ddcutil\n");
+         GHashTableIter iter;
+         gpointer key, value;
+         g_hash_table_iter_init(&iter, dsa_persistent_hash);
+         while (g_hash_table_iter_next(&iter, &key, &value)) {
+            int ct = fprintf(fp, "%s:%.4f\n", (char *) key, *(double*) value);
+            if (ct < 0) {
+               SEVEREMSG("Error writing to file %s:%s", data_file_name, strerror(errno) );
+               break;
+            }
+         }
+         fclose(fp);
+         dsa_persistent_hash_changed = false;
+      }
+      free(data_file_name);
+   }
+   g_mutex_unlock(&dsa_persistent_mutex);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
 
-   double dsa_error_rate_threshold = .1;
 
-   double error_rate = 0.0;    // outside of loop for final debug message
+/** Releases the saved sleep adjustment factors table. */
+void dsa_release_persistent_stats() {
+   g_mutex_lock(&dsa_persistent_mutex);
+   if (dsa_persistent_hash) {
+      g_hash_table_destroy(dsa_persistent_hash);
+      dsa_persistent_hash = NULL;
+   }
+   g_mutex_unlock(&dsa_persistent_mutex);
+}
 
-   int current_total_count = tsd->cur_ok_status_count + tsd->cur_error_status_count;
 
-   if ( (current_total_count) >= dsa_required_status_sample_size) {
-      if (current_total_count <= 4) {
-         dsa_error_rate_threshold = .5;
-         // adjustment_check_interval = 3;
-      }
-      else if (current_total_count <= 10) {
-         dsa_error_rate_threshold = .3;
-         // adjustment_check_interval = 4;
-      }
-      else {
-         dsa_error_rate_threshold = .1;
-         // adjustment_check_interval = 5;
+//
+// Per-display dynamic sleep adjustment data
+//
+// Sleep adjustment state is maintained for each display, not for each
+// thread, since it is the monitor that determines the required sleep time.
+// Records are keyed by io path, so they survive thread churn and the
+// recreation of Display_Refs.  A record is reinitialized if a different
+// monitor model appears on the same io path.
+//
+// Within a display record, adjustment factors and status statistics are
+// maintained separately for each sleep event type, so that e.g. a short
+// write-to-read delay can shrink without affecting the delay before
+// a multi-part read.  A DDC status code is credited to all sleep event
+// types that occurred on the display since the previous status code.
+//
+
+static GPtrArray * dsa_display_data_recs = NULL;   // array of Dsa_Display_Data *
+static GMutex      dsa_display_data_mutex;
+
+// Idle gap ranges, see dsa_get_idle_adjustment_factor()
+static const int    dsa_idle_gap_millis[DSA_IDLE_BUCKET_CT]  = {0, 1000, 5000, 30000};
+static const char * dsa_idle_value_names[DSA_IDLE_BUCKET_CT] = {NULL, "IDLE_1S", "IDLE_5S", "IDLE_30S"};
+
+
+static void dsa_init_display_data(Dsa_Display_Data * dsad, Display_Ref * dref) {
+   memset(dsad, 0, sizeof(Dsa_Display_Data));
+   memcpy(dsad->marker, DSA_DISPLAY_DATA_MARKER, 4);
+   dsad->io_path = dref->io_path;
+   dsad->mmk = (dref->mmid) ? *dref->mmid : monitor_model_key_undefined_value();
+   for (int ndx = 0; ndx < DSA_SLEEP_EVENT_CT; ndx++) {
+      dsad->event_data[ndx].cur_sleep_adjustment_factor =
+            dsa_get_persistent_adjustment_factor(dref->mmid, ndx);
+      dsad->event_data[ndx].probe_interval = DSA_PROBE_INTERVAL_MIN;
+   }
+   dsad->fragment_pacing_factor = dsa_get_persistent_value(dref->mmid, DSA_FRAGMENT_PACING_NAME);
+   dsad->idle_factors[0] = 1.0;
+   for (int ndx = 1; ndx < DSA_IDLE_BUCKET_CT; ndx++)
+      dsad->idle_factors[ndx] = dsa_get_persistent_value(dref->mmid, dsa_idle_value_names[ndx]);
+}
+
+
+/** Returns the dynamic sleep adjustment record for a display,
+ *  creating it if necessary.
+ *
+ *  \param  dref  display reference
+ *  \return pointer to #Dsa_Display_Data
+ */
+Dsa_Display_Data * dsa_get_display_data(Display_Ref * dref) {
+   bool debug = false;
+   assert(dref);
+   Dsa_Display_Data * result = NULL;
+
+   g_mutex_lock(&dsa_display_data_mutex);
+   if (!dsa_display_data_recs)
+      dsa_display_data_recs = g_ptr_array_new_with_free_func(free);
+   for (int ndx = 0; ndx < dsa_display_data_recs->len; ndx++) {
+      Dsa_Display_Data * cur = g_ptr_array_index(dsa_display_data_recs, ndx);
+      if (dpath_eq(cur->io_path, dref->io_path)) {
+         result = cur;
+         break;
       }
+   }
+   if (!result) {
+      result = calloc(1, sizeof(Dsa_Display_Data));
+      dsa_init_display_data(result, dref);
+      g_ptr_array_add(dsa_display_data_recs, result);
+   }
+   else if (dref->mmid && !monitor_model_key_eq(result->mmk, *dref->mmid)) {
+      DBGTRC(debug, TRACE_GROUP, "Monitor model changed on %s", dpath_repr_t(&dref->io_path));
+      dsa_init_display_data(result, dref);
+   }
+   g_mutex_unlock(&dsa_display_data_mutex);
+
+   return result;
+}
+
 
-      error_rate = (1.0 * tsd->cur_error_status_count) / (current_total_count);
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP,
-                    "ok_status_count=%d, error_status_count=%d,"
-                    " error_rate = %7.2f, error_rate_threshold= %7.2f",
-                    tsd->cur_ok_status_count, tsd->cur_error_status_count,
-                    error_rate, dsa_error_rate_threshold);
-      result = (error_rate > dsa_error_rate_threshold);
-   }
-   // DBGMSF(debug, "%s", sbool(result));
-   DBGTRC_DONE(debug, TRACE_GROUP, "total_count=%d, error_rate=%4.2f, returning %s",
-                 current_total_count, error_rate, sbool(result));
+/** Returns the largest current sleep adjustment factor of a display,
+ *  over all sleep event types.
+ *
+ *  \param  dref  display reference
+ *  \return adjustment factor
+ */
+double dsa_get_max_adjustment_factor(Display_Ref * dref) {
+   Dsa_Display_Data * dsad = dsa_get_display_data(dref);
+   double result = 0.0;
+   for (int ndx = 0; ndx < DSA_SLEEP_EVENT_CT; ndx++) {
+      if (dsad->event_data[ndx].cur_sleep_adjustment_factor > result)
+         result = dsad->event_data[ndx].cur_sleep_adjustment_factor;
+   }
    return result;
 }
 
 
-int dsa_calc_sleep_time(int cur_sleep_time_millis, int spec_sleep_time_millis) {
-   double current_sleep_time = cur_sleep_time_millis;
-   double spec_sleep_time = spec_sleep_time_millis;
+//
+// Capabilities fragment pacing
+//
+// A capabilities string is read in many fragments, each followed by the
+// 50 ms delay that the DDC/CI spec requires, though most monitors need much
+// less.  The delay between fragments is learned for each display separately
+// from the sleep adjustment factors above: it shrinks after a run of good
+// fragments, and is doubled, up to the spec value, when a fragment fails.
+//
+
+#define DSA_FRAGMENT_PACING_MIN     0.2     // fraction of spec delay
+#define DSA_FRAGMENT_PACING_OK_RUN  4       // good fragments before shrinking
+#define DSA_FRAGMENT_PACING_STEP    0.8
+
+/** Returns the fraction of the spec delay to sleep between capabilities
+ *  fragments on a display.
+ *
+ *  \param  dh  display handle
+ *  \return pacing factor, between #DSA_FRAGMENT_PACING_MIN and 1.0
+ */
+double dsa_get_fragment_pacing_factor(Display_Handle * dh) {
+   Dsa_Display_Data * dsad = dsa_get_display_data(dh->dref);
+   return dsad->fragment_pacing_factor;
+}
+
+
+/** Adjusts the capabilities fragment pacing for a display.
+ *
+ *  \param  dh  display handle
+ *  \param  ok  true if the fragment was read successfully
+ */
+void dsa_record_fragment_status(Display_Handle * dh, bool ok) {
    bool debug = false;
-   int result;
-   if (current_sleep_time <= .2 * spec_sleep_time)
-      result = 4.0 * current_sleep_time;
-   else if (current_sleep_time <= .6 * spec_sleep_time)
-      result = 3.0 * current_sleep_time;
-   else if (current_sleep_time <= 1.0 * spec_sleep_time)
-      result = 2.0 * current_sleep_time;
-   else if (current_sleep_time <= 3.0 * spec_sleep_time)
-      result = 1.5 * current_sleep_time;
-   else
-      result = spec_sleep_time;
-
-   DBGMSF(debug, "cur_sleep_time_millis = %d, returning %d",
-                 cur_sleep_time_millis, result);
+   Dsa_Display_Data * dsad = dsa_get_display_data(dh->dref);
+   double old_factor = dsad->fragment_pacing_factor;
+   if (ok) {
+      if (++dsad->fragment_ok_ct >= DSA_FRAGMENT_PACING_OK_RUN) {
+         dsad->fragment_ok_ct = 0;
+         dsad->fragment_pacing_factor *= DSA_FRAGMENT_PACING_STEP;
+         if (dsad->fragment_pacing_factor < DSA_FRAGMENT_PACING_MIN)
+            dsad->fragment_pacing_factor = DSA_FRAGMENT_PACING_MIN;
+      }
+   }
+   else {
+      dsad->fragment_ok_ct = 0;
+      dsad->fragment_pacing_factor *= 2;
+      if (dsad->fragment_pacing_factor > 1.0)
+         dsad->fragment_pacing_factor = 1.0;
+   }
+   if (dsad->fragment_pacing_factor != old_factor) {
+      DBGTRC(debug, TRACE_GROUP, "dh=%s, fragment pacing factor %4.2f -> %4.2f",
+                                 dh_repr(dh), old_factor, dsad->fragment_pacing_factor);
+      dsa_set_persistent_value(dh->dref->mmid, DSA_FRAGMENT_PACING_NAME, dsad->fragment_pacing_factor);
+   }
+}
+
+
+//
+// Idle gap adjustment
+//
+// The idle gap before an exchange is the time between its write and the
+// preceding transfer on the display's file descriptor, see
+// get_io_transfer_gap().  A display handle whose file descriptor has no
+// earlier transfer is treated as idle for the longest range.
+//
+// For each range there is a factor, saved per monitor model, by which the
+// sleep between the write and the read of the exchange is multiplied.  The
+// status code of that exchange adjusts only this factor, not the error rate
+// of the sleep event type: an error doubles the factor, a run of good
+// status codes shrinks it towards 1.0.  A longer idle gap uses at least
+// the factor of every shorter range.
+//
+
+#define DSA_IDLE_FACTOR_MAX   8.0
+#define DSA_IDLE_OK_RUN       4       // good first exchanges before shrinking
+
+
+/** Returns the factor by which the sleep between the write and read of an
+ *  exchange is multiplied because of the idle gap preceding the write.
+ *
+ *  If the factor is not 1.0, the next status code recorded by
+ *  #dsa_record_ddcrw_status_code() adjusts it.
+ *
+ *  \param  dh          display handle
+ *  \param  dsa_factor  sleep adjustment factor for the sleep event type
+ *  \return idle adjustment factor, 1.0 if no idle gap
+ */
+double dsa_get_idle_adjustment_factor(Display_Handle * dh, double dsa_factor) {
+   bool debug = false;
+   Dsa_Display_Data * dsad = dsa_get_display_data(dh->dref);
+   if (dsad->pinned_event_types)      // calibrating
+      return 1.0;
+
+   uint64_t gap_nanos = get_io_transfer_gap(dh->fd);
+   int bucket = 0;
+   for (int ndx = 1; ndx < DSA_IDLE_BUCKET_CT; ndx++) {
+      if (gap_nanos >= (uint64_t) dsa_idle_gap_millis[ndx] * (1000*1000))
+         bucket = ndx;
+   }
+   if (bucket == 0)
+      return 1.0;
+
+   double result = 1.0;
+   for (int ndx = 1; ndx <= bucket; ndx++) {
+      if (dsad->idle_factors[ndx] > result)
+         result = dsad->idle_factors[ndx];
+   }
+   // do not exceed the longest sleep dynamic adjustment allows
+   double max_factor = DSA_MAX_SLEEP_FRACTION / tsd_get_display_sleep_multiplier_factor(dh->dref);
+   if (dsa_factor * result > max_factor)
+      result = (dsa_factor < max_factor) ? max_factor / dsa_factor : 1.0;
+
+   dsad->idle_pending_bucket = bucket;
+   dsad->idle_pending_factor = result;
+   DBGTRC(debug, TRACE_GROUP, "dh=%s, gap=%"PRId64" ms (-1 if unknown), bucket=%s, returning %4.2f",
+          dh_repr(dh), (gap_nanos == UINT64_MAX) ? -1 : (int64_t) (gap_nanos / (1000*1000)),
+          dsa_idle_value_names[bucket], result);
    return result;
 }
 
 
-double dsa_calc_adjustment_factor(
-      int spec_sleep_time_millis,
-      double multiplier_factor,
-      double cur_factor)
-{
+// Adjusts the idle factor of the range of the pending exchange
+static void dsa_record_idle_status(Display_Handle * dh, Dsa_Display_Data * dsad, bool is_ok) {
    bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP,
-             "spec_sleep_time_millis=%d, multiplier_factor=%4.1f, cur_factor=%4.1f",
-             spec_sleep_time_millis, multiplier_factor, cur_factor);
-   int cur_sleep_time_millis = spec_sleep_time_millis * multiplier_factor * cur_factor;
-   int new_sleep_time_millis = dsa_calc_sleep_time(cur_sleep_time_millis, spec_sleep_time_millis);
-   double new_factor = new_sleep_time_millis / (spec_sleep_time_millis * multiplier_factor);
-   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %4.1f", new_factor);
-   return new_factor;
+   int bucket = dsad->idle_pending_bucket;
+   double old_factor = dsad->idle_factors[bucket];
+   dsad->total_idle_exchange_ct++;
+   if (is_ok) {
+      if (++dsad->idle_ok_cts[bucket] >= DSA_IDLE_OK_RUN) {
+         dsad->idle_ok_cts[bucket] = 0;
+         dsad->idle_factors[bucket] *= DSA_PROBE_STEP;
+         if (dsad->idle_factors[bucket] < 1.0)
+            dsad->idle_factors[bucket] = 1.0;
+      }
+   }
+   else {
+      dsad->total_idle_error_ct++;
+      dsad->idle_ok_cts[bucket] = 0;
+      dsad->idle_factors[bucket] = 2 * dsad->idle_pending_factor;
+      if (dsad->idle_factors[bucket] > DSA_IDLE_FACTOR_MAX)
+         dsad->idle_factors[bucket] = DSA_IDLE_FACTOR_MAX;
+   }
+   if (dsad->idle_factors[bucket] != old_factor) {
+      DBGTRC(debug, TRACE_GROUP, "dh=%s, %s factor %4.2f -> %4.2f",
+             dh_repr(dh), dsa_idle_value_names[bucket], old_factor, dsad->idle_factors[bucket]);
+      dsa_set_persistent_value(dh->dref->mmid, dsa_idle_value_names[bucket], dsad->idle_factors[bucket]);
+   }
 }
 
 
-double dsa_update_adjustment_factor(Display_Handle * dh, int spec_sleep_time_millis) {
+//
+// Dynamic sleep adjustment
+//
+
+void dsa_record_ddcrw_status_code(Display_Handle * dh, int rc) {
+   bool debug = false;
+   DBGMSF(debug, "dh=%s, rc=%s", dh_repr(dh), psc_desc(rc));
+   Dsa_Display_Data * dsad = dsa_get_display_data(dh->dref);
+
+   bool is_ok    = (rc == DDCRC_OK);
+   bool is_error = (rc == DDCRC_DDC_DATA ||
+                    rc == DDCRC_READ_ALL_ZERO ||
+                    rc == -ENXIO  || // this is problematic - could indicate data error or actual response
+                    rc == -EIO         // but that's ok - be pessimistic re error rates
+                   );
+   // DDCRC_NULL_RESPONSE is either a valid "No Value" response, or indicates
+   // a busy display.  Neither says anything about the sleep times, and null
+   // response retries have their own backoff, see ddc_write_read_with_retry().
+   if (!is_ok && !is_error) {
+      DBGMSF(debug, "other status code: %s", psc_desc(rc));
+      dsad->total_other_status_ct++;
+   }
+   else if (dsad->idle_pending_bucket > 0) {
+      // first exchange after an idle gap
+      dsa_record_idle_status(dh, dsad, is_ok);
+   }
+   else {
+      for (int ndx = 0; ndx < DSA_SLEEP_EVENT_CT; ndx++) {
+         if (dsad->pending_event_types & (1 << ndx)) {
+            Dsa_Event_Data * evd = &dsad->event_data[ndx];
+            if (is_ok)
+               evd->total_ok_status_count++;
+            else
+               evd->total_error_status_count++;
+            evd->error_rate += DSA_ERROR_RATE_WEIGHT * ((is_ok ? 0.0 : 1.0) - evd->error_rate);
+            evd->sample_ct++;
+            DBGMSF(debug, "%s: sample_ct=%d, error_rate=%5.3f",
+                          sleep_event_name(ndx), evd->sample_ct, evd->error_rate);
+         }
+      }
+   }
+   dsad->pending_event_types = 0;
+   dsad->idle_pending_bucket = 0;
+}
+
+
+// Starts a new measurement after the factor has changed
+static void dsa_reset_cur_status_counts(Dsa_Event_Data * evd) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Executing");
+
+   evd->error_rate = 0.0;
+   evd->sample_ct = 0;
+}
+
+
+/** Adjusts the sleep adjustment factor for a sleep event type on a display,
+ *  using the status codes recorded since the factor last changed, and
+ *  returns the factor to use for the next sleep.
+ *
+ *  \param  dh                      display handle
+ *  \param  event_type              sleep event type
+ *  \param  spec_sleep_time_millis  sleep time specified by DDC/CI
+ *  \return sleep adjustment factor
+ */
+double dsa_update_adjustment_factor(
+      Display_Handle * dh,
+      Sleep_Event_Type event_type,
+      int              spec_sleep_time_millis)
+{
    bool debug = false;
    Per_Thread_Data * tsd = tsd_get_thread_sleep_data();
-   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, dynamic_sleep_enabled for current thread = %s",
-                            dh_repr(dh),              sbool(tsd->dynamic_sleep_enabled));
-   if (!tsd->dynamic_sleep_enabled) {
-      int result = tsd->sleep_multiplier_factor;
+   DBGTRC_STARTING(debug, TRACE_GROUP,
+                   "dh=%s, event_type=%s, dynamic_sleep_enabled for current thread = %s",
+                   dh_repr(dh), sleep_event_name(event_type), sbool(tsd->dynamic_sleep_enabled));
+   double sleep_multiplier_factor = tsd_get_display_sleep_multiplier_factor(dh->dref);
+   if (!tsd_get_display_dynamic_sleep_enabled(dh->dref)) {
+      int result = sleep_multiplier_factor;
       DBGTRC_DONE(debug, TRACE_GROUP, "dsa disabled, returning %7.1f", result);
       return result;
    }
 
-   if (dh != tsd->cur_dh) {
-      tsd->cur_dh = dh;
-      dsa_reset_cur_status_counts();
-      tsd->cur_sleep_adjustment_factor  = 1.0;
-      DBGTRC_DONE(debug, TRACE_GROUP, "dh changed, returning %4.2f" ,
-                                      tsd->cur_sleep_adjustment_factor);
-      return tsd->cur_sleep_adjustment_factor;
-   }
-
-   DBGTRC_NOPREFIX(debug, TRACE_GROUP,
-                   "calls_since_last_check = %d, adjustment_check_interval = %d",
-                   tsd->calls_since_last_check, tsd->adjustment_check_interval);
-   bool sleep_adjustment_changed = false;
-   double max_factor = (spec_sleep_time_millis/tsd->sleep_multiplier_factor) * 3.0f;
-   if (tsd->calls_since_last_check > tsd->adjustment_check_interval) {
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Performing check");
-      tsd->calls_since_last_check = 0;
-      tsd->total_adjustment_checks++;
-
-      int current_total_count = tsd->cur_ok_status_count + tsd->cur_error_status_count;
-
-      if ( current_total_count >= dsa_required_status_sample_size) {
-         if (dsa_error_rate_is_high(tsd)) {
-            if (tsd->cur_sleep_adjustment_factor < max_factor) {
-               // double d = 2 * tsd->current_sleep_adjustment_factor;
-               double d = dsa_calc_adjustment_factor(
-                     spec_sleep_time_millis,
-                     tsd->sleep_multiplier_factor,
-                     tsd->cur_sleep_adjustment_factor);
-               if (d <= max_factor) {
-                     tsd->cur_sleep_adjustment_factor = d;
-               }
-               else {
-                  tsd->cur_sleep_adjustment_factor = max_factor;
-               }
-               sleep_adjustment_changed = true;
-               tsd->total_adjustment_ct++;
-               // tsd->adjustment_check_interval = 2 * tsd->adjustment_check_interval;
-            }
-            DBGTRC_NOPREFIX(debug, TRACE_GROUP,
-                  "sleep_adjustment_changed = %s, "
-                   "New sleep_adjustment_factor %5.2f",
-                   sbool(sleep_adjustment_changed),
-                   tsd->cur_sleep_adjustment_factor);
-         }
+   Dsa_Display_Data * dsad = dsa_get_display_data(dh->dref);
+   Dsa_Event_Data *   evd  = &dsad->event_data[event_type];
+   dsad->pending_event_types |= (1 << event_type);
+
+   if (dsad->pinned_event_types & (1 << event_type)) {
+      DBGTRC_DONE(debug, TRACE_GROUP, "factor pinned, returning %5.2f", evd->cur_sleep_adjustment_factor);
+      return evd->cur_sleep_adjustment_factor;
+   }
 
-         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "sleep_adjustment_changed=%s", sbool(sleep_adjustment_changed));
-         if (sleep_adjustment_changed)
-            dsa_reset_cur_status_counts();
+   // factor limits, relative to the sleep multiplier
+   double min_factor = DSA_TARGET_SLEEP_FRACTION / sleep_multiplier_factor;
+   double max_factor = DSA_MAX_SLEEP_FRACTION    / sleep_multiplier_factor;
+   double old_factor = evd->cur_sleep_adjustment_factor;
+   bool   settled    = false;    // new factor is not tentative
+
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "sample_ct=%d, error_rate=%5.3f, probing=%s",
+                   evd->sample_ct, evd->error_rate, sbool(evd->probing));
+   if (evd->sample_ct >= DSA_MIN_SAMPLE_CT && evd->error_rate > DSA_ERROR_RATE_THRESHOLD) {
+      if (evd->probing) {
+         // the shorter sleep is not sufficient, back off from probing
+         evd->cur_sleep_adjustment_factor = evd->probe_prior_factor;
+         evd->probing = false;
+         evd->probe_interval *= 2;
+         if (evd->probe_interval > DSA_PROBE_INTERVAL_MAX)
+            evd->probe_interval = DSA_PROBE_INTERVAL_MAX;
+      }
+      else {
+         evd->cur_sleep_adjustment_factor *= DSA_INCREASE_STEP;
+         if (evd->cur_sleep_adjustment_factor > max_factor)
+            evd->cur_sleep_adjustment_factor = max_factor;
       }
-      else
-         DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "Inadequate sample size");
+      settled = true;
+      dsa_reset_cur_status_counts(evd);
    }
-   else
-      tsd->calls_since_last_check++;
+   else if (evd->probing) {
+      if (evd->sample_ct >= DSA_PROBE_SAMPLE_CT) {
+         evd->probing = false;
+         evd->total_probe_kept_ct++;
+         evd->probe_interval = DSA_PROBE_INTERVAL_MIN;
+         settled = true;
+         evd->total_adjustment_ct++;
+         dsa_reset_cur_status_counts(evd);
+      }
+   }
+   else if (evd->sample_ct >= evd->probe_interval &&
+            evd->error_rate <= DSA_ERROR_RATE_THRESHOLD &&
+            evd->cur_sleep_adjustment_factor > min_factor)
+   {
+      evd->probe_prior_factor = evd->cur_sleep_adjustment_factor;
+      evd->cur_sleep_adjustment_factor *= DSA_PROBE_STEP;
+      if (evd->cur_sleep_adjustment_factor < min_factor)
+         evd->cur_sleep_adjustment_factor = min_factor;
+      evd->probing = true;
+      evd->total_probe_ct++;
+      dsa_reset_cur_status_counts(evd);
+   }
+
+   if (evd->cur_sleep_adjustment_factor != old_factor) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s: sleep adjustment factor %5.2f -> %5.2f%s",
+                      sleep_event_name(event_type), old_factor, evd->cur_sleep_adjustment_factor,
+                      (evd->probing) ? " (probe)" : "");
+      if (!evd->probing)
+         evd->total_adjustment_ct++;
+   }
+   if (settled)
+      dsa_set_persistent_adjustment_factor(
+            dh->dref->mmid, event_type, evd->cur_sleep_adjustment_factor);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "sample_ct=%d, error_rate=%5.3f, returning %5.2f",
+           evd->sample_ct, evd->error_rate, evd->cur_sleep_adjustment_factor);
+   return evd->cur_sleep_adjustment_factor;
+}
+
+
+/** Fixes the sleep adjustment factor for a sleep event type on a display,
+ *  so that it is not changed by #dsa_update_adjustment_factor().
+ *  Status counts for the event type continue to be maintained.
+ *  Used when calibrating sleep times.
+ *
+ *  \param  dref        display reference
+ *  \param  event_type  sleep event type
+ *  \param  factor      sleep adjustment factor
+ */
+void dsa_pin_adjustment_factor(Display_Ref * dref, Sleep_Event_Type event_type, double factor) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, event_type=%s, factor=%5.2f",
+                   dref_repr_t(dref), sleep_event_name(event_type), factor);
+   Dsa_Display_Data * dsad = dsa_get_display_data(dref);
+   dsad->pinned_event_types |= (1 << event_type);
+   dsad->event_data[event_type].cur_sleep_adjustment_factor = factor;
+   dsad->event_data[event_type].probing = false;
+   dsa_reset_cur_status_counts(&dsad->event_data[event_type]);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Releases all sleep adjustment factors of a display fixed by
+ *  #dsa_pin_adjustment_factor().
+ *
+ *  \param  dref        display reference
+ */
+void dsa_unpin_adjustment_factors(Display_Ref * dref) {
+   Dsa_Display_Data * dsad = dsa_get_display_data(dref);
+   dsad->pinned_event_types = 0;
+}
+
+
+//
+// Reporting
+//
+
+/** Reports the dynamic sleep adjustment data for a single display.
+ *
+ *  \param  dsad   pointer to #Dsa_Display_Data
+ *  \param  depth  logical indentation depth
+ */
+void dsa_report_display_data(Dsa_Display_Data * dsad, int depth) {
+   int d1 = depth+1;
+   int d2 = depth+2;
+   rpt_vstring(depth, "Display %s, model %s:",
+                      dpath_repr_t(&dsad->io_path), mmk_repr(dsad->mmk));
+   rpt_vstring(d1, "Total ignored status codes:      %5d",   dsad->total_other_status_ct);
+   for (int ndx = 0; ndx < DSA_SLEEP_EVENT_CT; ndx++) {
+      Dsa_Event_Data * evd = &dsad->event_data[ndx];
+      if (evd->total_ok_status_count + evd->total_error_status_count == 0)
+         continue;
+      rpt_vstring(d1, "%s:", sleep_event_name(ndx));
+      rpt_vstring(d2, "Total successful reads:          %5d",   evd->total_ok_status_count);
+      rpt_vstring(d2, "Total reads with DDC error:      %5d",   evd->total_error_status_count);
+      rpt_vstring(d2, "Current error rate:              %5.3f", evd->error_rate);
+      rpt_vstring(d2, "Number of adjustments:           %5d",   evd->total_adjustment_ct);
+      rpt_vstring(d2, "Probes kept/attempted:     %5d/%5d",     evd->total_probe_kept_ct, evd->total_probe_ct);
+      rpt_vstring(d2, "Final sleep adjustment:          %5.2f%s", evd->cur_sleep_adjustment_factor,
+                      (evd->probing) ? " (probe)" : "");
+   }
+   if (dsad->total_idle_exchange_ct > 0) {
+      rpt_vstring(d1, "First exchanges after idle gap:");
+      rpt_vstring(d2, "Total exchanges:                 %5d",   dsad->total_idle_exchange_ct);
+      rpt_vstring(d2, "Total exchanges with DDC error:  %5d",   dsad->total_idle_error_ct);
+      for (int ndx = 1; ndx < DSA_IDLE_BUCKET_CT; ndx++)
+         rpt_vstring(d2, "Idle gap %6d ms adjustment:   %5.2f",
+                         dsa_idle_gap_millis[ndx], dsad->idle_factors[ndx]);
+   }
+}
+
 
-   DBGTRC_DONE(debug, TRACE_GROUP,
-           "current_ok_status_count=%d, current_error_status_count=%d, returning %5.2f",
-           tsd->cur_ok_status_count,
-           tsd->cur_error_status_count,
-           tsd->cur_sleep_adjustment_factor);
-   return tsd->cur_sleep_adjustment_factor;
+/** Reports the dynamic sleep adjustment data for all displays.
+ *
+ *  \param  depth  logical indentation depth
+ */
+void dsa_report_all_display_data(int depth) {
+   rpt_label(depth, "Per display dynamic sleep adjustment data:");
+   g_mutex_lock(&dsa_display_data_mutex);
+   if (!dsa_display_data_recs || dsa_display_data_recs->len == 0)
+      rpt_label(depth+1, "None");
+   else {
+      for (int ndx = 0; ndx < dsa_display_data_recs->len; ndx++)
+         dsa_report_display_data(g_ptr_array_index(dsa_display_data_recs, ndx), depth+1);
+   }
+   g_mutex_unlock(&dsa_display_data_mutex);
+}
+
+
+/** Exports the dynamic sleep adjustment data for all displays.
+ *
+ *  \param  exp  export instance
+ */
+void dsa_export_all_display_data(Stats_Export * exp) {
+   struct {
+      const char *      name;
+      Stats_Metric_Type type;
+      const char *      help;
+   } metrics[] = {
+      {"ddcutil_dsa_ok_total",           STATS_METRIC_COUNTER, "Reads without DDC error, by display and sleep event type"},
+      {"ddcutil_dsa_error_total",        STATS_METRIC_COUNTER, "Reads with DDC error, by display and sleep event type"},
+      {"ddcutil_dsa_adjustments_total",  STATS_METRIC_COUNTER, "Number of sleep adjustments, by display and sleep event type"},
+      {"ddcutil_dsa_adjustment_factor",  STATS_METRIC_GAUGE,   "Current sleep adjustment factor, by display and sleep event type"},
+      {"ddcutil_dsa_error_rate",         STATS_METRIC_GAUGE,   "Moving average of the DDC error rate, by display and sleep event type"},
+      {"ddcutil_dsa_probes_total",       STATS_METRIC_COUNTER, "Tentative sleep decreases, by display and sleep event type"},
+      {"ddcutil_dsa_probes_kept_total",  STATS_METRIC_COUNTER, "Tentative sleep decreases kept, by display and sleep event type"},
+   };
+
+   g_mutex_lock(&dsa_display_data_mutex);
+   for (int mndx = 0; mndx < ARRAY_SIZE(metrics); mndx++) {
+      stats_export_metric(exp, metrics[mndx].name, metrics[mndx].type, metrics[mndx].help);
+      for (int ndx = 0; dsa_display_data_recs && ndx < dsa_display_data_recs->len; ndx++) {
+         Dsa_Display_Data * dsad = g_ptr_array_index(dsa_display_data_recs, ndx);
+         for (int endx = 0; endx < DSA_SLEEP_EVENT_CT; endx++) {
+            Dsa_Event_Data * evd = &dsad->event_data[endx];
+            if (evd->total_ok_status_count + evd->total_error_status_count == 0)
+               continue;
+            double value = 0;
+            switch(mndx) {
+            case 0: value = evd->total_ok_status_count;       break;
+            case 1: value = evd->total_error_status_count;    break;
+            case 2: value = evd->total_adjustment_ct;         break;
+            case 3: value = evd->cur_sleep_adjustment_factor; break;
+            case 4: value = evd->error_rate;                  break;
+            case 5: value = evd->total_probe_ct;              break;
+            case 6: value = evd->total_probe_kept_ct;         break;
+            }
+            stats_export_sample(exp, metrics[mndx].name, value, 3,
+                                "display", dpath_repr_t(&dsad->io_path),
+                                "model",   mmk_repr(dsad->mmk),
+                                "event",   sleep_event_name(endx));
+         }
+      }
+   }
+   stats_export_metric(exp, "ddcutil_dsa_idle_adjustment_factor", STATS_METRIC_GAUGE,
+                            "Sleep adjustment for the first exchange after an idle gap, by display and gap");
+   for (int ndx = 0; dsa_display_data_recs && ndx < dsa_display_data_recs->len; ndx++) {
+      Dsa_Display_Data * dsad = g_ptr_array_index(dsa_display_data_recs, ndx);
+      if (dsad->total_idle_exchange_ct == 0)
+         continue;
+      for (int bndx = 1; bndx < DSA_IDLE_BUCKET_CT; bndx++)
+         stats_export_sample(exp, "ddcutil_dsa_idle_adjustment_factor", dsad->idle_factors[bndx], 3,
+                             "display", dpath_repr_t(&dsad->io_path),
+                             "model",   mmk_repr(dsad->mmk),
+                             "gap",     dsa_idle_value_names[bndx]);
+   }
+   g_mutex_unlock(&dsa_display_data_mutex);
 }
 
 
 void init_dynamic_sleep() {
-   RTTI_ADD_FUNC(dsa_calc_adjustment_factor);
-   RTTI_ADD_FUNC(dsa_calc_sleep_time);
    RTTI_ADD_FUNC(dsa_update_adjustment_factor);
-   RTTI_ADD_FUNC(dsa_error_rate_is_high);
+   RTTI_ADD_FUNC(dsa_get_idle_adjustment_factor);
+   RTTI_ADD_FUNC(dsa_get_display_data);
+   RTTI_ADD_FUNC(dsa_pin_adjustment_factor);
+   RTTI_ADD_FUNC(dsa_load_persistent_stats_file);
+   RTTI_ADD_FUNC(dsa_save_persistent_stats);
+}
+
+
+/** Saves persistent sleep adjustment factors and releases module resources. */
+void release_dynamic_sleep() {
+   dsa_save_persistent_stats();
+   dsa_release_persistent_stats();
+   g_mutex_lock(&dsa_display_data_mutex);
+   if (dsa_display_data_recs) {
+      g_ptr_array_free(dsa_display_data_recs, true);
+      dsa_display_data_recs = NULL;
+   }
+   g_mutex_unlock(&dsa_display_data_mutex);
 }
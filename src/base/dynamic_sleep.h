@@ -17,11 +17,70 @@
 #include "util/timestamp.h"
 
 #include "base/displays.h"
+#include "base/execution_stats.h"   // for Sleep_Event_Type
+#include "base/stats_export.h"
 #include "base/status_code_mgt.h"
 
-void   dsa_record_ddcrw_status_code(int rc);
-double dsa_update_adjustment_factor(Display_Handle * dh, int spec_sleep_time_millis);
+#define DSA_SLEEP_EVENT_CT (SE_SPECIAL+1)
+#define DSA_IDLE_BUCKET_CT 4     // idle gap ranges, 0 is no idle gap
+
+/** Dynamic sleep adjustment state for a single sleep event type */
+typedef struct {
+   double error_rate;               // moving average since the last factor change
+   int    sample_ct;                // status codes since the last factor change
+   int    total_ok_status_count;
+   int    total_error_status_count;
+   int    total_adjustment_ct;      // increases, and probes kept or abandoned
+   int    total_probe_ct;
+   int    total_probe_kept_ct;
+   int    probe_interval;           // good status codes before the next probe
+   bool   probing;                  // cur_sleep_adjustment_factor is tentative
+   double probe_prior_factor;       // factor restored if the probe fails
+   double cur_sleep_adjustment_factor;
+} Dsa_Event_Data;
+
+#define DSA_DISPLAY_DATA_MARKER "DSAD"
+/** Dynamic sleep adjustment state for a single display */
+typedef struct {
+   char                   marker[4];
+   DDCA_IO_Path           io_path;     // key
+   DDCA_Monitor_Model_Key mmk;
+   int                    total_other_status_ct;
+   uint16_t               pending_event_types;   // bit flags, indexed by Sleep_Event_Type
+   uint16_t               pinned_event_types;    // bit flags, factors not adjusted
+   Dsa_Event_Data         event_data[DSA_SLEEP_EVENT_CT];
+   double                 fragment_pacing_factor;  // capabilities fragment delay, fraction of spec
+   int                    fragment_ok_ct;          // good fragments since last pacing change
+   double                 idle_factors[DSA_IDLE_BUCKET_CT];  // first exchange after idle, index 0 unused
+   int                    idle_ok_cts[DSA_IDLE_BUCKET_CT];   // good first exchanges since last change
+   int                    idle_pending_bucket;     // exchange awaiting its status, 0 if none
+   double                 idle_pending_factor;     // idle factor applied to that exchange
+   int                    total_idle_exchange_ct;
+   int                    total_idle_error_ct;
+} Dsa_Display_Data;
+
+Dsa_Display_Data * dsa_get_display_data(Display_Ref * dref);
+void   dsa_report_display_data(Dsa_Display_Data * dsad, int depth);
+void   dsa_report_all_display_data(int depth);
+void   dsa_export_all_display_data(Stats_Export * exp);
+
+void   dsa_record_ddcrw_status_code(Display_Handle * dh, int rc);
+double dsa_update_adjustment_factor(Display_Handle * dh, Sleep_Event_Type event_type, int spec_sleep_time_millis);
+double dsa_get_idle_adjustment_factor(Display_Handle * dh, double dsa_factor);
 int    dsa_get_sleep_time(Display_Handle * dh, int spec_sleep_time_millis);
+void   dsa_pin_adjustment_factor(Display_Ref * dref, Sleep_Event_Type event_type, double factor);
+void   dsa_unpin_adjustment_factors(Display_Ref * dref);
+double dsa_get_max_adjustment_factor(Display_Ref * dref);
+double dsa_get_fragment_pacing_factor(Display_Handle * dh);
+void   dsa_record_fragment_status(Display_Handle * dh, bool ok);
 void   init_dynamic_sleep();
+void   release_dynamic_sleep();
+
+// Persistent adjustment factors
+char * dsa_get_persistent_stats_file_name();
+double dsa_get_persistent_adjustment_factor(DDCA_Monitor_Model_Key * mmk, Sleep_Event_Type event_type);
+void   dsa_set_persistent_adjustment_factor(DDCA_Monitor_Model_Key * mmk, Sleep_Event_Type event_type, double factor);
+void   dsa_save_persistent_stats();
+void   dsa_release_persistent_stats();
 
 #endif /* DYNAMIC_SLEEP_H_ */
@@ -1,5 +1,10 @@
 /** \file execution_stats.c
  *  Record execution statistics, mainly the count and elapsed time of system calls.
+ *
+ *  The counters updated on the I/O path are kept in a separate shard for each
+ *  thread, so that threads performing DDC I/O concurrently do not serialize
+ *  on a global mutex.  A thread updates only its own shard, using atomic
+ *  operations.  The shards are summed when statistics are reported.
  */
 
 // Copyright (C) 2014-2021 Sanford Rockowitz <rockowitz@minsoft.com>
@@ -22,9 +27,11 @@
 
 #include "base/core.h"
 #include "base/sleep.h"
+#include "base/op_profile.h"
 #include "base/parms.h"
 #include "base/ddc_errno.h"
 #include "base/linux_errno.h"
+#include "base/stats_export.h"
 
 #include "base/execution_stats.h"
 
@@ -57,6 +64,34 @@ typedef struct {
    char *       name;
 } Status_Code_Counts;
 
+typedef enum {
+   PRIMARY_STATUS_CODES,
+   RETRYABLE_STATUS_CODES
+} Status_Code_Counts_Id;
+#define STATUS_CODE_COUNTS_CT 2
+
+static char * status_code_counts_names[] = {
+      "DDC Related Errors",
+      "Errors Wrapped in Retry" };
+
+#define IO_EVENT_TYPE_CT  (IE_OTHER+1)
+#define SLEEP_EVENT_ID_CT (SE_SPECIAL+1)
+
+// Statistics recorded by a single thread.
+// Counters are updated only by the owning thread, but may be read or reset
+// from another thread, hence the atomic operations.
+#define STATS_SHARD_MARKER "STSH"
+typedef struct {
+   char                 marker[4];
+   int                  io_call_count[IO_EVENT_TYPE_CT];
+   uint64_t             io_call_nanosec[IO_EVENT_TYPE_CT];
+   int                  sleep_event_cts[SLEEP_EVENT_ID_CT];
+   // hash tables cannot be updated atomically, the mutex is only
+   // contended while status counts are reported or reset
+   GMutex               status_code_counts_mutex;
+   Status_Code_Counts * status_code_counts[STATUS_CODE_COUNTS_CT];
+} Stats_Shard;
+
 
 //
 // Global Variables
@@ -66,17 +101,65 @@ typedef struct {
 // static long                 last_io_timestamp = -1;
 static uint64_t             program_start_timestamp;
 static uint64_t             resettable_start_timestamp;
-static Status_Code_Counts * primary_error_code_counts;
-static Status_Code_Counts * retryable_error_code_counts;
-static GMutex               status_code_counts_mutex;
 static GMutex               global_stats_mutex;
 
+// Shards are retained after their thread terminates, so that its statistics
+// are included in reports.
+static GPtrArray *          stats_shards;
+static GMutex               stats_shards_mutex;
+static GPrivate             stats_shard_key = G_PRIVATE_INIT(NULL);
+
 
 static bool                 debug_status_code_counts_mutex  = false;
 static bool                 debug_global_stats_mutex = false;
 static bool                 debug_sleep_stats_mutex = false;
 
 
+static Status_Code_Counts * new_status_code_counts(char * name);
+
+
+/** Returns the statistics shard for the current thread, creating it
+ *  if necessary.
+ */
+static Stats_Shard *
+get_thread_stats_shard() {
+   Stats_Shard * shard = g_private_get(&stats_shard_key);
+   if (!shard) {
+      shard = g_new0(Stats_Shard, 1);
+      memcpy(shard->marker, STATS_SHARD_MARKER, 4);
+      g_mutex_init(&shard->status_code_counts_mutex);
+      for (int ndx = 0; ndx < STATUS_CODE_COUNTS_CT; ndx++)
+         shard->status_code_counts[ndx] = new_status_code_counts(status_code_counts_names[ndx]);
+
+      g_mutex_lock(&stats_shards_mutex);
+      if (!stats_shards)
+         stats_shards = g_ptr_array_new();
+      g_ptr_array_add(stats_shards, shard);
+      g_mutex_unlock(&stats_shards_mutex);
+
+      g_private_set(&stats_shard_key, shard);
+   }
+   return shard;
+}
+
+
+// Applies a function to every shard, holding stats_shards_mutex
+typedef void (*Stats_Shard_Func)(Stats_Shard * shard, void * arg);
+
+static void
+stats_shards_apply_all(Stats_Shard_Func func, void * arg) {
+   g_mutex_lock(&stats_shards_mutex);
+   if (stats_shards) {
+      for (int ndx = 0; ndx < stats_shards->len; ndx++) {
+         Stats_Shard * shard = g_ptr_array_index(stats_shards, ndx);
+         assert(memcmp(shard->marker, STATS_SHARD_MARKER, 4) == 0);
+         func(shard, arg);
+      }
+   }
+   g_mutex_unlock(&stats_shards_mutex);
+}
+
+
 //
 // IO Event Tracking
 //
@@ -88,28 +171,50 @@ IO_Event_Type_Stats io_event_stats[] = {
       {IE_READ,       "IE_READ",       "read calls",             0, 0},
       {IE_IOCTL_WRITE,"I2_IOCTL_WRITE","i2c writes using ioctl", 0, 0},
       {IE_IOCTL_READ, "I2_IOCTL_READ", "i2c reads using ioctl",  0, 0},
-//    {IE_WRITE_READ, "IE_WRITE_READ", "write/read calls",       0, 0},
+      {IE_WRITE_READ, "IE_WRITE_READ", "write/read calls",       0, 0},
       {IE_OPEN,       "IE_OPEN",       "open file calls",        0, 0},
       {IE_CLOSE,      "IE_CLOSE",      "close file calls",       0, 0},
       {IE_OTHER,      "IE_OTHER",      "other I/O calls",        0, 0},
 };
-#define IO_EVENT_TYPE_CT (sizeof(io_event_stats)/sizeof(IO_Event_Type_Stats))
-static GMutex io_event_stats_mutex;
 static bool   debug_io_event_stats_mutex;
 
+
+static void
+reset_shard_io_event_stats(Stats_Shard * shard, void * arg) {
+   for (int ndx = 0; ndx < IO_EVENT_TYPE_CT; ndx++) {
+      __atomic_store_n(&shard->io_call_count[ndx],   0, __ATOMIC_RELAXED);
+      __atomic_store_n(&shard->io_call_nanosec[ndx], 0, __ATOMIC_RELAXED);
+   }
+}
+
 static
 void reset_io_event_stats() {
    bool debug = false || debug_io_event_stats_mutex;
    DBGMSF(debug, "Starting");
 
-   g_mutex_lock(&io_event_stats_mutex);
+   stats_shards_apply_all(reset_shard_io_event_stats, NULL);
+
+   DBGMSF(debug, "Done");
+}
+
+
+static void
+add_shard_io_event_stats(Stats_Shard * shard, void * arg) {
+   IO_Event_Type_Stats * totals = arg;
    for (int ndx = 0; ndx < IO_EVENT_TYPE_CT; ndx++) {
-      io_event_stats[ndx].call_count   = 0;
-      io_event_stats[ndx].call_nanosec = 0;
+      totals[ndx].call_count   += __atomic_load_n(&shard->io_call_count[ndx],   __ATOMIC_RELAXED);
+      totals[ndx].call_nanosec += __atomic_load_n(&shard->io_call_nanosec[ndx], __ATOMIC_RELAXED);
    }
-   g_mutex_unlock(&io_event_stats_mutex);
+}
 
-   DBGMSF(debug, "Done");
+/** Sums the IO event statistics of all threads.
+ *
+ *  @param totals  array of #IO_EVENT_TYPE_CT entries to fill in
+ */
+static void
+get_io_event_totals(IO_Event_Type_Stats * totals) {
+   memcpy(totals, io_event_stats, sizeof(io_event_stats));   // ids, names, zero counts
+   stats_shards_apply_all(add_shard_io_event_stats, totals);
 }
 
 
@@ -139,19 +244,23 @@ int max_event_name_length() {
 
 
 static int total_io_event_count() {
+   IO_Event_Type_Stats totals[IO_EVENT_TYPE_CT];
+   get_io_event_totals(totals);
    int total = 0;
    int ndx = 0;
    for (;ndx < IO_EVENT_TYPE_CT; ndx++)
-      total += io_event_stats[ndx].call_count;
+      total += totals[ndx].call_count;
    return total;
 }
 
 // unused
 uint64_t total_io_event_nanosec() {
+   IO_Event_Type_Stats totals[IO_EVENT_TYPE_CT];
+   get_io_event_totals(totals);
    uint64_t total = 0;
    int ndx = 0;
    for (;ndx < IO_EVENT_TYPE_CT; ndx++)
-      total += io_event_stats[ndx].call_nanosec;
+      total += totals[ndx].call_nanosec;
    return total;
 }
 
@@ -182,15 +291,13 @@ void log_io_call(
    DBGMSF(debug, "event_type=%d %-10s, elapsed_nanos=%"PRIu64", as millis=%"PRIu64,
                   event_type, io_event_name(event_type), elapsed_nanos, elapsed_nanos/(1000*1000) );
 
-   g_mutex_lock(&io_event_stats_mutex);
-
-   io_event_stats[event_type].call_count++;
-   io_event_stats[event_type].call_nanosec += elapsed_nanos;
+   Stats_Shard * shard = get_thread_stats_shard();
+   __atomic_fetch_add(&shard->io_call_count[event_type],   1,             __ATOMIC_RELAXED);
+   __atomic_fetch_add(&shard->io_call_nanosec[event_type], elapsed_nanos, __ATOMIC_RELAXED);
+   op_profile_add_io(event_type, elapsed_nanos);
 
-   g_mutex_unlock(&io_event_stats_mutex);
-
-   DBGMSF(debug, "Updated total nanosec = %"PRIu64", as millis=%"PRIu64,
-                  io_event_stats[event_type].call_nanosec, io_event_stats[event_type].call_nanosec /(1000*1000) );
+   DBGMSF(debug, "Updated thread nanosec = %"PRIu64", as millis=%"PRIu64,
+                  shard->io_call_nanosec[event_type], shard->io_call_nanosec[event_type] /(1000*1000) );
 }
 
 
@@ -201,6 +308,8 @@ void log_io_call(
 void report_io_call_stats(int depth) {
    int d1 = depth+1;
    rpt_title("Call Stats:", depth);
+   IO_Event_Type_Stats totals[IO_EVENT_TYPE_CT];
+   get_io_event_totals(totals);
    int total_ct = 0;
    uint64_t total_nanos = 0;
    int ndx = 0;
@@ -209,8 +318,8 @@ void report_io_call_stats(int depth) {
    // DBGMSG("max_name_length=%d", max_name_length);
    rpt_vstring(d1, "%-40s Count    Millisec  (      Nanosec)", "Type");
    for (;ndx < IO_EVENT_TYPE_CT; ndx++) {
-      if (io_event_stats[ndx].call_count > 0) {
-         IO_Event_Type_Stats* curstat = &io_event_stats[ndx];
+      if (totals[ndx].call_count > 0) {
+         IO_Event_Type_Stats* curstat = &totals[ndx];
          char buf[100];
          snprintf(buf, 100, "%-22s (%s)", curstat->desc, curstat->name);
          rpt_vstring(d1, "%-40s  %4d  %10" PRIu64 "  (%13" PRIu64 ")",
@@ -242,12 +351,14 @@ get_non_sleep_call_totals () {
    Non_Sleep_Call_Totals totals;
    totals.count = 0;
    totals.nanos = 0;
+   IO_Event_Type_Stats io_totals[IO_EVENT_TYPE_CT];
+   get_io_event_totals(io_totals);
     int ndx = 0;
     // int max_name_length = max_event_name_length();
 
     for (;ndx < IO_EVENT_TYPE_CT; ndx++) {
-       if (io_event_stats[ndx].call_count > 0) {
-          IO_Event_Type_Stats* curstat = &io_event_stats[ndx];
+       if (io_totals[ndx].call_count > 0) {
+          IO_Event_Type_Stats* curstat = &io_totals[ndx];
 
           totals.count += curstat->call_count;
           totals.nanos += curstat->call_nanosec;
@@ -272,55 +383,93 @@ Status_Code_Counts * new_status_code_counts(char * name) {
    bool debug = false || debug_status_code_counts_mutex;
    DBGMSF(debug, "Starting");
 
-   g_mutex_lock(&status_code_counts_mutex);
    Status_Code_Counts * pcounts = calloc(1,sizeof(Status_Code_Counts));
    memcpy(pcounts->marker, STATUS_CODE_COUNTS_MARKER, 4);
    pcounts->error_counts_hash =  g_hash_table_new(NULL,NULL);
    pcounts->total_status_counts = 0;
    if (name)
       pcounts->name = strdup(name);
-   g_mutex_unlock(&status_code_counts_mutex);
 
    DBGMSF(debug, "Done");
    return pcounts;
 }
 
 static void
-reset_status_code_counts_struct(Status_Code_Counts * pcounts) {
-   bool debug = false || debug_status_code_counts_mutex;
-   DBGMSF(debug, "Starting");
-   assert(pcounts);
+free_status_code_counts(Status_Code_Counts * pcounts) {
+   assert(pcounts && memcmp(pcounts->marker, STATUS_CODE_COUNTS_MARKER, 4) == 0);
+   g_hash_table_destroy(pcounts->error_counts_hash);
+   free(pcounts->name);
+   free(pcounts);
+}
 
-   g_mutex_lock(&status_code_counts_mutex);
-   if (pcounts->error_counts_hash)
+static void
+reset_shard_status_code_counts(Stats_Shard * shard, void * arg) {
+   g_mutex_lock(&shard->status_code_counts_mutex);
+   for (int ndx = 0; ndx < STATUS_CODE_COUNTS_CT; ndx++) {
+      Status_Code_Counts * pcounts = shard->status_code_counts[ndx];
       g_hash_table_remove_all(pcounts->error_counts_hash);
-   pcounts->total_status_counts = 0;
-   g_mutex_unlock(&status_code_counts_mutex);
+      pcounts->total_status_counts = 0;
+   }
+   g_mutex_unlock(&shard->status_code_counts_mutex);
+}
 
+static void
+reset_status_code_counts() {
+   bool debug = false || debug_status_code_counts_mutex;
+   DBGMSF(debug, "Starting");
+   stats_shards_apply_all(reset_shard_status_code_counts, NULL);
    DBGMSF(debug, "Done");
 }
 
 
+typedef struct {
+   Status_Code_Counts_Id id;
+   Status_Code_Counts *  totals;
+} Status_Code_Counts_Merge;
 
 static void
-reset_status_code_counts() {
-   reset_status_code_counts_struct(primary_error_code_counts);
-   reset_status_code_counts_struct(retryable_error_code_counts);
+add_shard_status_code_counts(Stats_Shard * shard, void * arg) {
+   Status_Code_Counts_Merge * merge = arg;
+   g_mutex_lock(&shard->status_code_counts_mutex);
+   Status_Code_Counts * pcounts = shard->status_code_counts[merge->id];
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, pcounts->error_counts_hash);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      int ct = GPOINTER_TO_INT(g_hash_table_lookup(merge->totals->error_counts_hash, key));
+      g_hash_table_insert(merge->totals->error_counts_hash, key,
+                          GINT_TO_POINTER(ct + GPOINTER_TO_INT(value)));
+   }
+   merge->totals->total_status_counts += pcounts->total_status_counts;
+   g_mutex_unlock(&shard->status_code_counts_mutex);
 }
 
+/** Sums the status code counts of all threads.
+ *
+ *  @param  id  which counts
+ *  @return newly allocated #Status_Code_Counts, caller must free
+ */
+static Status_Code_Counts *
+get_status_code_totals(Status_Code_Counts_Id id) {
+   Status_Code_Counts_Merge merge = {id, new_status_code_counts(status_code_counts_names[id])};
+   stats_shards_apply_all(add_shard_status_code_counts, &merge);
+   return merge.totals;
+}
 
 
 static
-int log_any_status_code(Status_Code_Counts * pcounts, int rc, const char * caller_name) {
+int log_any_status_code(Status_Code_Counts_Id id, int rc, const char * caller_name) {
    bool debug = false || debug_status_code_counts_mutex;
    DBGMSF(debug, "caller=%s, rc=%d", caller_name, rc);
-   assert(pcounts->error_counts_hash);
 
    if (rc == 0) {
       DBGMSG("Called with rc = 0, from function %s", caller_name);
    }
 
-   g_mutex_lock(&status_code_counts_mutex);
+   Stats_Shard * shard = get_thread_stats_shard();
+   Status_Code_Counts * pcounts = shard->status_code_counts[id];
+   assert(pcounts->error_counts_hash);
+   g_mutex_lock(&shard->status_code_counts_mutex);
    pcounts->total_status_counts++;
    // n. if key rc not found, returns NULL, which is 0
    int ct = GPOINTER_TO_INT(g_hash_table_lookup(pcounts->error_counts_hash,  GINT_TO_POINTER(rc)) );
@@ -332,7 +481,7 @@ int log_any_status_code(Status_Code_Counts * pcounts, int rc, const char * calle
    int newct =
 #endif
    GPOINTER_TO_INT(g_hash_table_lookup(pcounts->error_counts_hash,  GINT_TO_POINTER(rc)) );
-   g_mutex_unlock(&status_code_counts_mutex);
+   g_mutex_unlock(&shard->status_code_counts_mutex);
    // DBGMSG("new count for key %d = %d", rc, newct);
    assert(newct == ct+1);
 
@@ -354,10 +503,9 @@ int log_any_status_code(Status_Code_Counts * pcounts, int rc, const char * calle
 Public_Status_Code
 log_status_code(Public_Status_Code rc, const char * caller_name) {
    // DBGMSG("rc=%d, caller_name=%s", rc, caller_name);
-   Status_Code_Counts * pcounts = primary_error_code_counts;
    // if ( ddcrc_is_derived_status_code(rc) )
    //    pcounts = secondary_status_code_counts;
-   log_any_status_code(pcounts, rc, caller_name);
+   log_any_status_code(PRIMARY_STATUS_CODES, rc, caller_name);
    return rc;
 }
 
@@ -374,8 +522,7 @@ log_status_code(Public_Status_Code rc, const char * caller_name) {
 Public_Status_Code
 log_retryable_status_code(Public_Status_Code rc, const char * caller_name) {
    // DBGMSG("rc=%d, caller_name=%s", rc, caller_name);
-   Status_Code_Counts * pcounts = retryable_error_code_counts;
-   log_any_status_code(pcounts, rc, caller_name);
+   log_any_status_code(RETRYABLE_STATUS_CODES, rc, caller_name);
    return rc;
 }
 
@@ -455,11 +602,15 @@ void report_specific_status_counts(Status_Code_Counts * pcounts, int depth) {
 /** Master function to display status counts
  */
 void report_all_status_counts(int depth) {
-   report_specific_status_counts(primary_error_code_counts, 0);
+   Status_Code_Counts * pcounts = get_status_code_totals(PRIMARY_STATUS_CODES);
+   report_specific_status_counts(pcounts, 0);
+   free_status_code_counts(pcounts);
    // show_specific_status_counts(secondary_status_code_counts);    // not used
 
    rpt_nl();
-   report_specific_status_counts(retryable_error_code_counts, 0);
+   pcounts = get_status_code_totals(RETRYABLE_STATUS_CODES);
+   report_specific_status_counts(pcounts, 0);
+   free_status_code_counts(pcounts);
    rpt_nl();
 }
 
@@ -511,7 +662,6 @@ static const char * sleep_event_names[] = {
       "SE_POST_CAP_TABLE_COMMAND",
       "SE_SPECIAL",
      };
-#define SLEEP_EVENT_ID_CT (sizeof(sleep_event_names)/sizeof(char *))
 
 int max_sleep_event_name_size() {
    int result = 0;
@@ -527,36 +677,37 @@ const char * sleep_event_name(Sleep_Event_Type event_type) {
    // ensure sleep_event_names stays in sync with Sync_Event_Type
 #ifndef NDEBUG
    const int sleep_event_type_count = SE_SPECIAL+1;   // relies on values in enum assigned from 0
-   assert( SLEEP_EVENT_ID_CT ==  sleep_event_type_count);
+   assert( sizeof(sleep_event_names)/sizeof(char *) ==  sleep_event_type_count);
 #endif
    return sleep_event_names[event_type];
 }
 
-static int sleep_event_cts_by_id[SLEEP_EVENT_ID_CT];
-static int total_sleep_event_ct = 0;
-
-static GMutex sleep_stats_mutex;
-
+static void
+reset_shard_sleep_event_counts(Stats_Shard * shard, void * arg) {
+   for (int ndx = 0; ndx < SLEEP_EVENT_ID_CT; ndx++)
+      __atomic_store_n(&shard->sleep_event_cts[ndx], 0, __ATOMIC_RELAXED);
+}
 
 void reset_sleep_event_counts() {
    bool debug = false || debug_sleep_stats_mutex;
    DBGMSF(debug, "Starting");
 
-   g_mutex_lock(&sleep_stats_mutex);
-   for (int ndx = 0; ndx < SLEEP_EVENT_ID_CT; ndx++) {
-      sleep_event_cts_by_id[ndx] = 0;
-   }
-   g_mutex_unlock(&sleep_stats_mutex);
+   stats_shards_apply_all(reset_shard_sleep_event_counts, NULL);
 
    DBGMSF(debug, "Done");
 }
 
 void record_sleep_event(Sleep_Event_Type event_type) {
-   // For better performance, separate mutex for each index in array
-   g_mutex_lock(&sleep_stats_mutex);
-   sleep_event_cts_by_id[event_type]++;
-   total_sleep_event_ct++;
-   g_mutex_unlock(&sleep_stats_mutex);
+   Stats_Shard * shard = get_thread_stats_shard();
+   __atomic_fetch_add(&shard->sleep_event_cts[event_type], 1, __ATOMIC_RELAXED);
+}
+
+
+static void
+add_shard_sleep_event_counts(Stats_Shard * shard, void * arg) {
+   int * totals = arg;
+   for (int ndx = 0; ndx < SLEEP_EVENT_ID_CT; ndx++)
+      totals[ndx] += __atomic_load_n(&shard->sleep_event_cts[ndx], __ATOMIC_RELAXED);
 }
 
 
@@ -567,6 +718,13 @@ void record_sleep_event(Sleep_Event_Type event_type) {
 void report_execution_stats(int depth) {
    int sleep_name_field_size = max_sleep_event_name_size();
    int d1 = depth+1;
+   int sleep_event_cts_by_id[SLEEP_EVENT_ID_CT] = {0};
+   stats_shards_apply_all(add_shard_sleep_event_counts, sleep_event_cts_by_id);
+   int total_sleep_event_ct = 0;
+   for (int id=0; id < SLEEP_EVENT_ID_CT; id++)
+      total_sleep_event_ct += sleep_event_cts_by_id[id];
+   Status_Code_Counts * primary_error_code_counts = get_status_code_totals(PRIMARY_STATUS_CODES);
+
    rpt_title("IO and Sleep Events:", depth);
    rpt_vstring(d1, "Total IO events:      %5d", total_io_event_count());
    rpt_vstring(d1, "IO error count:       %5d", get_true_io_error_count(primary_error_code_counts));
@@ -576,6 +734,143 @@ void report_execution_stats(int depth) {
    for (int id=0; id < SLEEP_EVENT_ID_CT; id++) {
       rpt_vstring(d1, "%-*s  %4d", sleep_name_field_size, sleep_event_names[id], sleep_event_cts_by_id[id]);
    }
+   free_status_code_counts(primary_error_code_counts);
+}
+
+
+//
+// Export
+//
+
+static void
+export_status_code_counts(Stats_Export * exp, Status_Code_Counts_Id id, const char * counts_label) {
+   Status_Code_Counts * pcounts = get_status_code_totals(id);
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, pcounts->error_counts_hash);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      int rc = GPOINTER_TO_INT(key);
+      Status_Code_Info * desc = find_status_code_info(rc);
+      char code_buf[20];
+      g_snprintf(code_buf, sizeof(code_buf), "%d", rc);
+      stats_export_sample(exp, "ddcutil_status_codes_total", GPOINTER_TO_INT(value), 3,
+                          "counts", counts_label,
+                          "code",   code_buf,
+                          "name",   (desc) ? desc->name : "");
+   }
+   free_status_code_counts(pcounts);
+}
+
+
+/** Exports the I/O event, status code and sleep event counts.
+ *
+ *  \param  exp  export instance
+ */
+void export_execution_stats(Stats_Export * exp) {
+   IO_Event_Type_Stats totals[IO_EVENT_TYPE_CT];
+   get_io_event_totals(totals);
+   stats_export_metric(exp, "ddcutil_io_calls_total", STATS_METRIC_COUNTER,
+                            "Number of I/O calls by event type");
+   for (int ndx = 0; ndx < IO_EVENT_TYPE_CT; ndx++)
+      stats_export_sample(exp, "ddcutil_io_calls_total", totals[ndx].call_count, 1,
+                               "event", totals[ndx].name);
+   stats_export_metric(exp, "ddcutil_io_call_seconds_total", STATS_METRIC_COUNTER,
+                            "Elapsed time of I/O calls by event type");
+   for (int ndx = 0; ndx < IO_EVENT_TYPE_CT; ndx++)
+      stats_export_sample(exp, "ddcutil_io_call_seconds_total", totals[ndx].call_nanosec / 1e9, 1,
+                               "event", totals[ndx].name);
+
+   stats_export_metric(exp, "ddcutil_status_codes_total", STATS_METRIC_COUNTER,
+                            "Occurrences of error status codes, "
+                            "counts=retryable for errors within a retry loop");
+   export_status_code_counts(exp, PRIMARY_STATUS_CODES,   "primary");
+   export_status_code_counts(exp, RETRYABLE_STATUS_CODES, "retryable");
+
+   int sleep_event_cts_by_id[SLEEP_EVENT_ID_CT] = {0};
+   stats_shards_apply_all(add_shard_sleep_event_counts, sleep_event_cts_by_id);
+   stats_export_metric(exp, "ddcutil_sleep_events_total", STATS_METRIC_COUNTER,
+                            "Number of sleeps by sleep event type");
+   for (int id = 0; id < SLEEP_EVENT_ID_CT; id++)
+      stats_export_sample(exp, "ddcutil_sleep_events_total", sleep_event_cts_by_id[id], 1,
+                               "event", sleep_event_names[id]);
+}
+
+
+//
+// Startup phase timing
+//
+
+#define MAX_STARTUP_PHASES 100
+
+typedef struct {
+   const char * phase_name;
+   int          depth;
+   uint64_t     start_nanos;
+   uint64_t     elapsed_nanos;
+} Startup_Phase;
+
+// Not initialized by init_execution_stats(), since phases are recorded
+// before and during init_base_services().
+static Startup_Phase startup_phases[MAX_STARTUP_PHASES];
+static int           startup_phase_ct = 0;
+static int           open_startup_phase_ct = 0;
+static GMutex        startup_phase_mutex;
+
+
+/** Records the start of a startup phase.
+ *
+ *  @param  phase_name  phase name, must be a string constant
+ *  @return handle to pass to #startup_phase_end(), -1 if the table is full
+ */
+int startup_phase_begin(const char * phase_name) {
+   int ndx = -1;
+   g_mutex_lock(&startup_phase_mutex);
+   if (startup_phase_ct < MAX_STARTUP_PHASES) {
+      ndx = startup_phase_ct++;
+      startup_phases[ndx].phase_name    = phase_name;
+      startup_phases[ndx].depth         = open_startup_phase_ct;
+      startup_phases[ndx].elapsed_nanos = 0;
+      startup_phases[ndx].start_nanos   = cur_monotonic_nanosec();
+   }
+   open_startup_phase_ct++;
+   g_mutex_unlock(&startup_phase_mutex);
+   return ndx;
+}
+
+
+/** Records the end of a startup phase.
+ *
+ *  @param  phase_ndx  value returned by #startup_phase_begin()
+ */
+void startup_phase_end(int phase_ndx) {
+   uint64_t end_nanos = cur_monotonic_nanosec();
+   g_mutex_lock(&startup_phase_mutex);
+   if (phase_ndx >= 0)
+      startup_phases[phase_ndx].elapsed_nanos = end_nanos - startup_phases[phase_ndx].start_nanos;
+   open_startup_phase_ct--;
+   g_mutex_unlock(&startup_phase_mutex);
+}
+
+
+/** Reports the time spent in each recorded startup phase, in the order
+ *  the phases were started.  Nested phases are indented below the phase
+ *  that contains them.
+ *
+ *  @param depth logical indentation depth
+ */
+void report_startup_phases(int depth) {
+   g_mutex_lock(&startup_phase_mutex);
+   if (startup_phase_ct > 0) {
+      rpt_label(depth, "Startup phase timing (microseconds):");
+      for (int ndx = 0; ndx < startup_phase_ct; ndx++) {
+         Startup_Phase * phase = &startup_phases[ndx];
+         int indent = 2 * phase->depth;
+         rpt_vstring(depth+1, "%*s%-*s %10"PRIu64,
+                     indent, "", 45-indent, phase->phase_name, phase->elapsed_nanos / 1000);
+      }
+      rpt_nl();
+   }
+   g_mutex_unlock(&startup_phase_mutex);
 }
 
 
@@ -588,8 +883,6 @@ void report_execution_stats(int depth) {
  * Must be called once at program startup.
  */
 void init_execution_stats() {
-   primary_error_code_counts   = new_status_code_counts("DDC Related Errors");
-   retryable_error_code_counts = new_status_code_counts("Errors Wrapped in Retry");
    // secondary_status_code_counts = new_status_code_counts("Derived and Other Errors");
    program_start_timestamp     = cur_realtime_nanosec();
    resettable_start_timestamp  = program_start_timestamp;
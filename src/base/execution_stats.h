@@ -20,6 +20,7 @@
 #include "util/timestamp.h"
 
 #include "base/displays.h"
+#include "base/stats_export.h"
 #include "base/status_code_mgt.h"
 
 
@@ -35,6 +36,21 @@ void reset_execution_stats();
 void report_elapsed_stats(int depth);
 void report_elapsed_summary(int depth);
 
+// Startup Phase Timing
+
+int  startup_phase_begin(const char * phase_name);
+void startup_phase_end(int phase_ndx);
+void report_startup_phases(int depth);
+
+#define RECORD_STARTUP_PHASE(phase_name, cmd_to_time)  { \
+   int _phase_ndx = startup_phase_begin(phase_name); \
+   cmd_to_time; \
+   startup_phase_end(_phase_ndx); \
+}
+
+// Times a parameterless initialization function, using its name as the phase name
+#define RECORD_STARTUP_INIT(init_func)  RECORD_STARTUP_PHASE(#init_func, init_func())
+
 
 // IO Event Tracking
 
@@ -47,7 +63,7 @@ typedef enum {
    IE_READ,                ///< read event
    IE_IOCTL_WRITE,         ///< i2c writes using ioctl()
    IE_IOCTL_READ,          ///< i2c reads using ioctl()
-// IE_WRITE_READ,          ///< write/read operation, typical for I2C
+   IE_WRITE_READ,          ///< write/read operation, typical for I2C
    IE_OPEN,                ///< device file open
    IE_CLOSE,               ///< device file close
    IE_OTHER                ///< other IO event
@@ -101,4 +117,7 @@ void record_sleep_event(Sleep_Event_Type event_type);
 
 void report_execution_stats(int depth);
 
+// Export
+void export_execution_stats(Stats_Export * exp);
+
 #endif /* EXECUTION_STATS_H_ */
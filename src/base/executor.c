@@ -0,0 +1,412 @@
+/** @file executor.c
+ *
+ *  Shared pool of worker threads for the library's parallel operations,
+ *  e.g. initial display checks, I2C bus probing and capabilities prefetch,
+ *  so that these do not each create their own threads.
+ *
+ *  Each worker has a queue of tasks.  A task submitted by a worker is added
+ *  to that worker's queue, other tasks are distributed round robin.  A
+ *  worker takes tasks from the head of its own queue.  When its queue is
+ *  empty it steals from the tail of another worker's queue.
+ *
+ *  A task can instead be given an affinity, normally the physical adapter
+ *  through which a display is reached.  Tasks with the same affinity are
+ *  executed one at a time, in the order submitted.
+ *
+ *  A thread waiting for a group of tasks that is itself a worker executes
+ *  queued tasks while it waits, so nested use cannot exhaust the workers.
+ *
+ *  Tasks that run for the life of the program, such as the display watch
+ *  or the per-display request workers, keep their own threads.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+/** \endcond */
+
+#include "base/core.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/stats_export.h"
+#include "base/thread_sched.h"
+
+#include "base/executor.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_NONE;
+
+struct Executor_Group {
+   int pending;                   // tasks submitted and not yet completed
+};
+
+typedef struct {
+   char *   key;
+   GQueue * tasks;                // Executor_Task *
+   bool     running;              // one of its tasks is executing
+} Executor_Lane;
+
+typedef struct {
+   Executor_Task_Func func;
+   gpointer           data;
+   Executor_Group *   group;      // may be NULL
+   Executor_Lane *    lane;       // NULL if no affinity
+} Executor_Task;
+
+typedef struct {
+   int       ndx;
+   GQueue *  tasks;               // Executor_Task * without affinity
+   GThread * thread;
+   bool      running;
+} Executor_Worker;
+
+// All fields are protected by executor_mutex
+static GMutex      executor_mutex;
+static GCond       executor_cond;          // signaled when a task is queued or completes
+static GPtrArray * workers = NULL;         // Executor_Worker *
+static int         worker_target = EXECUTOR_WORKER_COUNT_DEFAULT;
+static int         next_worker = 0;        // for round robin distribution
+static GHashTable * lanes = NULL;          // affinity -> Executor_Lane *
+static GQueue *    runnable_lanes = NULL;  // lanes with tasks, none executing
+static bool        shutting_down = false;
+static GPrivate    current_worker_key;     // Executor_Worker * of the current thread
+
+static uint64_t    own_task_ct = 0;
+static uint64_t    stolen_task_ct = 0;
+static uint64_t    affinity_task_ct = 0;
+static uint64_t    helped_task_ct = 0;     // executed by a worker waiting for a group
+
+
+// Must be called with executor_mutex held
+static int queued_task_count() {
+   int result = 0;
+   for (int ndx = 0; workers && ndx < workers->len; ndx++)
+      result += g_queue_get_length(((Executor_Worker *) g_ptr_array_index(workers, ndx))->tasks);
+   for (GList * cur = (runnable_lanes) ? runnable_lanes->head : NULL; cur; cur = cur->next)
+      result += g_queue_get_length(((Executor_Lane *) cur->data)->tasks);
+   return result;
+}
+
+
+// Must be called with executor_mutex held.
+// Returns the next task for a worker, NULL if there is none.
+static Executor_Task *
+take_task(Executor_Worker * self, bool helping) {
+   Executor_Task * task = NULL;
+   if (self)
+      task = g_queue_pop_head(self->tasks);
+   if (task) {
+      own_task_ct++;
+   }
+   else if (runnable_lanes && !g_queue_is_empty(runnable_lanes)) {
+      Executor_Lane * lane = g_queue_pop_head(runnable_lanes);
+      lane->running = true;
+      task = g_queue_pop_head(lane->tasks);
+      affinity_task_ct++;
+   }
+   else {
+      for (int ndx = 0; workers && ndx < workers->len && !task; ndx++) {
+         Executor_Worker * victim = g_ptr_array_index(workers, ndx);
+         if (victim != self)
+            task = g_queue_pop_tail(victim->tasks);
+      }
+      if (task)
+         stolen_task_ct++;
+   }
+   if (task && helping)
+      helped_task_ct++;
+   return task;
+}
+
+
+// Executes a task, then records its completion
+static void
+run_task(Executor_Task * task) {
+   task->func(task->data);
+
+   g_mutex_lock(&executor_mutex);
+   Executor_Lane * lane = task->lane;
+   if (lane) {
+      lane->running = false;
+      if (!g_queue_is_empty(lane->tasks)) {
+         g_queue_push_tail(runnable_lanes, lane);
+      }
+      else {
+         g_hash_table_remove(lanes, lane->key);
+         g_queue_free(lane->tasks);
+         g_free(lane->key);
+         free(lane);
+      }
+   }
+   if (task->group)
+      task->group->pending--;
+   g_cond_broadcast(&executor_cond);
+   g_mutex_unlock(&executor_mutex);
+   free(task);
+}
+
+
+static gpointer
+executor_worker_thread(gpointer data) {
+   bool debug = false;
+   Executor_Worker * self = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "worker %d", self->ndx);
+   g_private_set(&current_worker_key, self);
+   apply_worker_thread_sched();
+
+   g_mutex_lock(&executor_mutex);
+   for (;;) {
+      Executor_Task * task = take_task(self, false);
+      if (task) {
+         g_mutex_unlock(&executor_mutex);
+         run_task(task);
+         g_mutex_lock(&executor_mutex);
+      }
+      else if (shutting_down || self->ndx >= worker_target) {
+         break;
+      }
+      else {
+         g_cond_wait(&executor_cond, &executor_mutex);
+      }
+   }
+   self->running = false;
+   g_mutex_unlock(&executor_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "worker %d", self->ndx);
+   return NULL;
+}
+
+
+// Must be called with executor_mutex held
+static void
+start_workers() {
+   if (!workers)
+      workers = g_ptr_array_new();
+   for (int ndx = 0; ndx < worker_target && !shutting_down; ndx++) {
+      Executor_Worker * worker = NULL;
+      if (ndx < workers->len) {
+         worker = g_ptr_array_index(workers, ndx);
+      }
+      else {
+         worker = calloc(1, sizeof(Executor_Worker));
+         worker->ndx = ndx;
+         worker->tasks = g_queue_new();
+         g_ptr_array_add(workers, worker);
+      }
+      if (!worker->running) {
+         if (worker->thread) {      // exited after the worker count was reduced
+            GThread * exited = worker->thread;
+            worker->thread = NULL;
+            g_mutex_unlock(&executor_mutex);
+            g_thread_join(exited);
+            g_mutex_lock(&executor_mutex);
+            if (worker->running)    // restarted by another thread meanwhile
+               continue;
+         }
+         worker->running = true;
+         worker->thread = g_thread_new("ddc_executor", executor_worker_thread, worker);
+      }
+   }
+}
+
+
+/** Sets the number of worker threads.
+ *
+ *  @param worker_ct  number of threads, must be > 0
+ *
+ *  @remark
+ *  If the workers have already been started, their number is adjusted.
+ *  Excess workers exit once their queues are empty.
+ */
+void executor_set_worker_count(int worker_ct) {
+   assert(worker_ct > 0);
+   g_mutex_lock(&executor_mutex);
+   worker_target = worker_ct;
+   if (workers)
+      start_workers();
+   g_cond_broadcast(&executor_cond);
+   g_mutex_unlock(&executor_mutex);
+}
+
+
+/** Returns the number of worker threads.
+ *
+ *  @return number of threads
+ */
+int executor_get_worker_count() {
+   return worker_target;
+}
+
+
+/** Creates a group of tasks whose completion can be waited for by
+ *  #executor_wait_group().
+ *
+ *  @return new group
+ */
+Executor_Group * executor_group_new() {
+   return calloc(1, sizeof(Executor_Group));
+}
+
+
+/** Schedules a task for execution by a worker thread.
+ *
+ *  @param  group     group that the task is part of, may be NULL
+ *  @param  affinity  tasks with the same non-NULL affinity are executed
+ *                    one at a time, in the order submitted
+ *  @param  func      function to execute
+ *  @param  data      argument to func
+ */
+void executor_submit(
+      Executor_Group *   group,
+      const char *       affinity,
+      Executor_Task_Func func,
+      gpointer           data)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "group=%p, affinity=%s", group, affinity);
+   Executor_Task * task = calloc(1, sizeof(Executor_Task));
+   task->func  = func;
+   task->data  = data;
+   task->group = group;
+
+   g_mutex_lock(&executor_mutex);
+   assert(!shutting_down);
+   start_workers();
+   if (group)
+      group->pending++;
+   if (affinity) {
+      if (!lanes) {
+         lanes = g_hash_table_new(g_str_hash, g_str_equal);
+         runnable_lanes = g_queue_new();
+      }
+      Executor_Lane * lane = g_hash_table_lookup(lanes, affinity);
+      if (!lane) {
+         lane = calloc(1, sizeof(Executor_Lane));
+         lane->key = g_strdup(affinity);
+         lane->tasks = g_queue_new();
+         g_hash_table_insert(lanes, lane->key, lane);
+      }
+      task->lane = lane;
+      if (!lane->running && g_queue_is_empty(lane->tasks))
+         g_queue_push_tail(runnable_lanes, lane);
+      g_queue_push_tail(lane->tasks, task);
+   }
+   else {
+      Executor_Worker * self = g_private_get(&current_worker_key);
+      if (!self) {
+         self = g_ptr_array_index(workers, next_worker % worker_target);
+         next_worker = (next_worker + 1) % worker_target;
+      }
+      g_queue_push_tail(self->tasks, task);
+   }
+   g_cond_broadcast(&executor_cond);
+   g_mutex_unlock(&executor_mutex);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Waits for all tasks in a group to complete, then frees the group.
+ *
+ *  If called from a worker thread, the thread executes queued tasks
+ *  while waiting.
+ *
+ *  @param  group  group to wait for
+ */
+void executor_wait_group(Executor_Group * group) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "group=%p", group);
+   Executor_Worker * self = g_private_get(&current_worker_key);
+   g_mutex_lock(&executor_mutex);
+   while (group->pending > 0) {
+      Executor_Task * task = (self) ? take_task(self, true) : NULL;
+      if (task) {
+         g_mutex_unlock(&executor_mutex);
+         run_task(task);
+         g_mutex_lock(&executor_mutex);
+      }
+      else {
+         g_cond_wait(&executor_cond, &executor_mutex);
+      }
+   }
+   g_mutex_unlock(&executor_mutex);
+   free(group);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Reports whether the current thread is an executor worker.
+ *
+ *  @return true/false
+ */
+bool executor_is_worker_thread() {
+   return g_private_get(&current_worker_key);
+}
+
+
+/** Exports the number of worker threads, the number of queued tasks, and
+ *  the number of tasks executed, by how the worker obtained the task.
+ *
+ *  @param exp  export instance
+ */
+void export_executor_stats(Stats_Export * exp) {
+   g_mutex_lock(&executor_mutex);
+   int queued_ct = queued_task_count();
+   uint64_t own_ct      = own_task_ct;
+   uint64_t stolen_ct   = stolen_task_ct;
+   uint64_t affinity_ct = affinity_task_ct;
+   uint64_t helped_ct   = helped_task_ct;
+   g_mutex_unlock(&executor_mutex);
+
+   stats_export_metric(exp, "ddcutil_executor_workers", STATS_METRIC_GAUGE,
+                            "Configured executor worker threads");
+   stats_export_sample(exp, "ddcutil_executor_workers", worker_target, 0);
+   stats_export_metric(exp, "ddcutil_executor_queued_tasks", STATS_METRIC_GAUGE,
+                            "Tasks waiting for an executor worker");
+   stats_export_sample(exp, "ddcutil_executor_queued_tasks", queued_ct, 0);
+   stats_export_metric(exp, "ddcutil_executor_tasks_total", STATS_METRIC_COUNTER,
+                            "Tasks executed, by how the worker obtained the task");
+   stats_export_sample(exp, "ddcutil_executor_tasks_total", own_ct,      1, "source", "own");
+   stats_export_sample(exp, "ddcutil_executor_tasks_total", stolen_ct,   1, "source", "stolen");
+   stats_export_sample(exp, "ddcutil_executor_tasks_total", affinity_ct, 1, "source", "affinity");
+   stats_export_sample(exp, "ddcutil_executor_tasks_total", helped_ct,   1, "source", "waiting");
+}
+
+
+/** Stops the worker threads after the queued tasks have been executed.
+ *
+ *  Called at library termination.
+ */
+void release_executor() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+   g_mutex_lock(&executor_mutex);
+   shutting_down = true;
+   g_cond_broadcast(&executor_cond);
+   GPtrArray * old_workers = workers;
+   workers = NULL;
+   g_mutex_unlock(&executor_mutex);
+
+   if (old_workers) {
+      for (int ndx = 0; ndx < old_workers->len; ndx++) {
+         Executor_Worker * worker = g_ptr_array_index(old_workers, ndx);
+         if (worker->thread)
+            g_thread_join(worker->thread);
+         g_queue_free(worker->tasks);
+         free(worker);
+      }
+      g_ptr_array_free(old_workers, true);
+   }
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+void init_executor() {
+   RTTI_ADD_FUNC(executor_submit);
+   RTTI_ADD_FUNC(executor_wait_group);
+   RTTI_ADD_FUNC(release_executor);
+}
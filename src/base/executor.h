@@ -0,0 +1,38 @@
+/** @file executor.h
+ *
+ *  Shared pool of worker threads for the library's parallel operations
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+/** \cond */
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+/** \endcond */
+
+#include "base/stats_export.h"
+
+/** Function executed by a task */
+typedef void (*Executor_Task_Func)(gpointer data);
+
+/** Tasks whose completion can be waited for together */
+typedef struct Executor_Group Executor_Group;
+
+void             executor_set_worker_count(int worker_ct);
+int              executor_get_worker_count();
+Executor_Group * executor_group_new();
+void             executor_submit(Executor_Group *   group,
+                                 const char *       affinity,
+                                 Executor_Task_Func func,
+                                 gpointer           data);
+void             executor_wait_group(Executor_Group * group);
+bool             executor_is_worker_thread();
+void             export_executor_stats(Stats_Export * exp);
+void             release_executor();
+void             init_executor();
+
+#endif /* EXECUTOR_H_ */
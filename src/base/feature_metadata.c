@@ -263,6 +263,24 @@ sl_value_table_lookup(
 }
 
 
+/** Creates a direct lookup of the names in a feature value table, so that
+ *  a value is named by indexing rather than a search of the table.
+ *
+ *  @param  value_entries  feature value table
+ *  @return index, caller must free
+ */
+SL_Value_Index *
+new_sl_value_index(DDCA_Feature_Value_Entry * value_entries) {
+   SL_Value_Index * index = calloc(1, sizeof(SL_Value_Index));
+   for (DDCA_Feature_Value_Entry * cur = value_entries; cur->value_name; cur++) {
+      // first entry wins, as for sl_value_table_lookup()
+      if (!index->names[cur->value_code])
+         index->names[cur->value_code] = cur->value_name;
+   }
+   return index;
+}
+
+
 // DDCA_Feature_Metadata
 
 /** Output a debug report of a #DDCA_Feature_Metadata instance
@@ -377,6 +395,7 @@ dfm_free(
       free(meta->feature_name);
       free(meta->feature_desc);
       free_sl_value_table(meta->sl_values);
+      free(meta->sl_value_index);
       // free_sl_value_table(meta->latest_sl_values);
       free(meta);
    }
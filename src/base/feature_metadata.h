@@ -90,6 +90,15 @@ free_sl_value_table(DDCA_Feature_Value_Entry * table);
 char *
 sl_value_table_lookup(DDCA_Feature_Value_Entry * value_entries, Byte value_id);
 
+/** Value names of a feature value table, indexed by value.
+ *  The names are those of the table, which must outlive the index. */
+typedef struct {
+   char * names[256];
+} SL_Value_Index;
+
+SL_Value_Index *
+new_sl_value_index(DDCA_Feature_Value_Entry * value_entries);
+
 
 // Feature Flags
 
@@ -121,6 +130,7 @@ struct {
    char *                                  feature_name;
    char *                                  feature_desc;
    DDCA_Feature_Value_Entry *              sl_values;     /**< valid when DDCA_SIMPLE_NC set */
+   SL_Value_Index *                        sl_value_index; /**< index of sl_values, built on first use */
    // DDCA_Feature_Value_Entry *           latest_sl_values;
    DDCA_Feature_Flags                      feature_flags;
    Format_Normal_Feature_Detail_Function   nontable_formatter;
@@ -79,7 +79,10 @@ typedef enum {
    FSF_WO_ONLY               = 0x10,
 
    // applies to single feature feature set
-   FSF_FORCE                 = 0x20
+   FSF_FORCE                 = 0x20,
+
+   // applies to feature sets read from a display, not in feature set cache key
+   FSF_CAPS_ONLY             = 0x40
 } Feature_Set_Flags;
 #define FSF_READABLE_ONLY    (FSF_RW_ONLY | FSF_RO_ONLY)
 
@@ -0,0 +1,163 @@
+/** \file io_timeline.c
+ *
+ *  Timeline capture of DDC transactions.
+ *
+ *  While capture is active, every I2C write and read, every sleep that
+ *  delays access to the bus, and every try of a DDC exchange is written
+ *  to a CSV file, one line per event, with its start time, duration,
+ *  bus number, try number and status code.  Unlike the execution
+ *  statistics, which are totals, the timeline preserves the exact
+ *  sequence of events, so that it can be analyzed offline, e.g. using
+ *  command **ddcutil timeline**.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/linux_util.h"
+#include "util/string_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/rtti.h"
+
+#include "base/io_timeline.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_BASE;
+
+bool io_timeline_active = false;
+
+static FILE *   timeline_fp = NULL;
+static GMutex   timeline_mutex;         // serializes writes to timeline_fp
+static GPrivate try_key = G_PRIVATE_INIT(NULL);
+
+static const char * timeline_event_names[] = {
+      "write",
+      "read",
+      "write_read",
+      "sleep",
+      "try",
+};
+
+
+/** Returns the name of a timeline event, as written to the timeline file */
+const char * io_timeline_event_name(Io_Timeline_Event event) {
+   assert(ARRAY_SIZE(timeline_event_names) == IO_TIMELINE_EVENT_CT);
+   assert(event >= 0 && event < IO_TIMELINE_EVENT_CT);
+   return timeline_event_names[event];
+}
+
+
+/** Converts the name of a timeline event to its value.
+ *
+ *  \param  name  event name
+ *  \return event value, -1 if not found
+ */
+Io_Timeline_Event io_timeline_event_from_name(const char * name) {
+   for (int ndx = 0; ndx < IO_TIMELINE_EVENT_CT; ndx++) {
+      if (streq(name, timeline_event_names[ndx]))
+         return ndx;
+   }
+   return -1;
+}
+
+
+/** Starts capturing a timeline.
+ *
+ *  \param  filename  file to write, replaced if it exists
+ *  \return true if success, false if the file cannot be opened
+ */
+bool io_timeline_start(const char * filename) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "filename=%s", filename);
+
+   io_timeline_stop();
+   FILE * fp = fopen(filename, "w");
+   if (!fp) {
+      fprintf(ferr(), "Unable to open timeline file %s: %s\n", filename, strerror(errno));
+   }
+   else {
+      fprintf(fp, "%s\n%s\n", IO_TIMELINE_HEADER, IO_TIMELINE_COLUMNS);
+      g_mutex_lock(&timeline_mutex);
+      timeline_fp = fp;
+      io_timeline_active = true;
+      g_mutex_unlock(&timeline_mutex);
+   }
+
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, fp, "");
+   return fp;
+}
+
+
+/** Stops capturing a timeline, and closes the timeline file. */
+void io_timeline_stop() {
+   g_mutex_lock(&timeline_mutex);
+   io_timeline_active = false;
+   if (timeline_fp) {
+      fclose(timeline_fp);
+      timeline_fp = NULL;
+   }
+   g_mutex_unlock(&timeline_mutex);
+}
+
+
+/** Sets the try number recorded with the current thread's events.
+ *
+ *  \param tryctr  1 based try number, 0 if not within a retry loop
+ *
+ *  \remark
+ *  This setting is thread-specific.
+ */
+void io_timeline_set_try(int tryctr) {
+   g_private_set(&try_key, GINT_TO_POINTER(tryctr));
+}
+
+
+/** Writes an event ending now to the timeline.
+ *
+ *  Normally called using macro #IO_TIMELINE_RECORD().
+ *
+ *  \param busno             I2C bus number
+ *  \param event             event type
+ *  \param detail            e.g. sleep event name, may be NULL
+ *  \param start_nanos       start time, CLOCK_MONOTONIC
+ *  \param requested_micros  requested sleep time, 0 for events other than sleeps
+ *  \param status            status code
+ */
+void io_timeline_record(
+      int               busno,
+      Io_Timeline_Event event,
+      const char *      detail,
+      uint64_t          start_nanos,
+      int               requested_micros,
+      int               status)
+{
+   uint64_t end_nanos = cur_monotonic_nanosec();
+   int tryctr = GPOINTER_TO_INT(g_private_get(&try_key));
+
+   g_mutex_lock(&timeline_mutex);
+   if (timeline_fp) {
+      fprintf(timeline_fp, "%"PRIu64",%"PRIu64",%jd,%d,%d,%s,%s,%d,%d\n",
+              start_nanos,
+              (end_nanos > start_nanos) ? end_nanos - start_nanos : 0,
+              get_thread_id(), busno, tryctr,
+              io_timeline_event_name(event), (detail) ? detail : "",
+              requested_micros, status);
+   }
+   g_mutex_unlock(&timeline_mutex);
+}
+
+
+void init_io_timeline() {
+   RTTI_ADD_FUNC(io_timeline_start);
+}
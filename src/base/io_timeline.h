@@ -0,0 +1,73 @@
+/** \file io_timeline.h
+ *
+ *  Timeline capture of DDC transactions
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef IO_TIMELINE_H_
+#define IO_TIMELINE_H_
+
+/** \cond */
+#include <stdbool.h>
+#include <stdint.h>
+/** \endcond */
+
+#include "util/timestamp.h"
+
+/** Timeline events */
+typedef enum {
+   TLE_WRITE,          ///< I2C write
+   TLE_READ,           ///< I2C read
+   TLE_WRITE_READ,     ///< combined I2C write and read
+   TLE_SLEEP,          ///< sleep before accessing the bus
+   TLE_TRY,            ///< one try of a DDC exchange, including writes, reads, and sleeps
+} Io_Timeline_Event;
+#define IO_TIMELINE_EVENT_CT (TLE_TRY+1)
+
+/** Header line identifying a timeline file */
+#define IO_TIMELINE_HEADER "# ddcutil io timeline v1"
+
+/** Column names, which follow the header line */
+#define IO_TIMELINE_COLUMNS "start_nanos,duration_nanos,thread,busno,try,event,detail,requested_micros,status"
+
+extern bool io_timeline_active;
+
+const char *      io_timeline_event_name(Io_Timeline_Event event);
+Io_Timeline_Event io_timeline_event_from_name(const char * name);
+
+bool io_timeline_start(const char * filename);
+void io_timeline_stop();
+void io_timeline_set_try(int tryctr);
+void io_timeline_record(
+      int               busno,
+      Io_Timeline_Event event,
+      const char *      detail,
+      uint64_t          start_nanos,
+      int               requested_micros,
+      int               status);
+
+/** Returns the current time if a timeline is being captured, 0 if not */
+static inline uint64_t
+io_timeline_now() {
+   return (io_timeline_active) ? cur_monotonic_nanosec() : 0;
+}
+
+/** Records an event ending now, if a timeline is being captured.
+ *
+ *  \param _busno             I2C bus number
+ *  \param _event             #Io_Timeline_Event
+ *  \param _detail            e.g. sleep event name, may be NULL
+ *  \param _start_nanos       start time, as returned by #io_timeline_now()
+ *  \param _requested_micros  requested sleep time, 0 for events other than sleeps
+ *  \param _status            status code
+ */
+#define IO_TIMELINE_RECORD(_busno, _event, _detail, _start_nanos, _requested_micros, _status) \
+   do { if (io_timeline_active) \
+           io_timeline_record((_busno), (_event), (_detail), (_start_nanos), (_requested_micros), (_status)); \
+   } while(0)
+
+void init_io_timeline();
+
+#endif /* IO_TIMELINE_H_ */
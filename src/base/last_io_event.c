@@ -6,6 +6,7 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <glib-2.0/glib.h>
 
@@ -20,10 +21,13 @@ G_LOCK_DEFINE_STATIC(timestamps_lock);
 
 // Maintain timestamps
 
+// Indexed by file descriptor, entries for unused descriptors are NULL
 static GPtrArray * timestamps = NULL;
 
 
 static void free_io_event_timestamp_internal(gpointer data) {
+   if (!data)       // slot for an unused file descriptor
+      return;
    IO_Event_Timestamp * ptr = (IO_Event_Timestamp *) data;
    assert(memcmp(ptr->marker, IO_EVENT_TIMESTAMP_MARKER, 4) == 0);
    ptr->marker[3] = 'X';
@@ -33,22 +37,34 @@ static void free_io_event_timestamp_internal(gpointer data) {
 }
 
 
+// Must be called with timestamps_lock held
 static IO_Event_Timestamp* find_io_event_timestamp(int fd) {
    assert(timestamps);
    IO_Event_Timestamp * result = NULL;
-
-   for (int ndx = 0; ndx < timestamps->len; ndx++) {
-      IO_Event_Timestamp * cur = g_ptr_array_index(timestamps, ndx);
-      if (cur->fd == fd) {
-         result = cur;
-         break;
-      }
-   }
+   if (fd >= 0 && fd < timestamps->len)
+      result = g_ptr_array_index(timestamps, fd);
    // DBGMSG("Returning %p", result);
    return result;
 }
 
 
+// Must be called with timestamps_lock held
+static IO_Event_Timestamp * get_io_event_timestamp_locked(int fd) {
+   assert(fd >= 0);
+   IO_Event_Timestamp * ts = find_io_event_timestamp(fd);
+   if (!ts) {
+      ts = calloc(1, sizeof(IO_Event_Timestamp));
+      memcpy(ts->marker, IO_EVENT_TIMESTAMP_MARKER, 4);
+      ts->fd = fd;
+      ts->transfer_gap = UINT64_MAX;
+      if (fd >= timestamps->len)
+         g_ptr_array_set_size(timestamps, fd+1);
+      g_ptr_array_index(timestamps, fd) = ts;
+   }
+   return ts;
+}
+
+
 static void ensure_initialized() {
    if (g_once_init_enter(&leave_event_initialized)) {
       if (!timestamps) {     // first call?
@@ -63,13 +79,7 @@ IO_Event_Timestamp * get_io_event_timestamp(int fd)
 {
    ensure_initialized();
    G_LOCK(timestamps_lock);
-   IO_Event_Timestamp * ts = find_io_event_timestamp(fd);
-   if (!ts) {
-      ts = calloc(1, sizeof(IO_Event_Timestamp));
-      memcpy(ts->marker, IO_EVENT_TIMESTAMP_MARKER, 4);
-      ts->fd = fd;
-      g_ptr_array_add(timestamps, ts);
-   }
+   IO_Event_Timestamp * ts = get_io_event_timestamp_locked(fd);
    G_UNLOCK(timestamps_lock);
    assert(ts);
    return ts;
@@ -79,13 +89,34 @@ IO_Event_Timestamp * get_io_event_timestamp(int fd)
 // IO_Event_Timestamp * new_io_event_timestamp(int fd);
 
 
+/** Returns the time between the most recent read or write on a file
+ *  descriptor and the read or write before it, i.e. how long the device
+ *  was idle before the most recent transfer.
+ *
+ *  @param  fd  Linux file descriptor
+ *  @return nanosec, UINT64_MAX if fewer than two transfers have been recorded
+ */
+uint64_t get_io_transfer_gap(int fd) {
+   ensure_initialized();
+   uint64_t result = UINT64_MAX;
+   G_LOCK(timestamps_lock);
+   IO_Event_Timestamp * ts = find_io_event_timestamp(fd);
+   if (ts)
+      result = ts->transfer_gap;
+   G_UNLOCK(timestamps_lock);
+   return result;
+}
+
+
 void free_io_event_timestamp(int fd) {
    ensure_initialized();
    assert(timestamps);
    G_LOCK(timestamps_lock);
    IO_Event_Timestamp * ts = find_io_event_timestamp(fd);
-   if (ts)
-      g_ptr_array_remove(timestamps, ts);
+   if (ts) {
+      g_ptr_array_index(timestamps, fd) = NULL;
+      free_io_event_timestamp_internal(ts);
+   }
    G_UNLOCK(timestamps_lock);
 }
 
@@ -101,8 +132,12 @@ void record_io_finish(
       char *        function)
 {
    bool debug = false;
+   if (fd < 0)      // failed open()
+      return;
+   ensure_initialized();
 
-   IO_Event_Timestamp * tsrec = get_io_event_timestamp(fd);
+   G_LOCK(timestamps_lock);
+   IO_Event_Timestamp * tsrec = get_io_event_timestamp_locked(fd);
    assert(tsrec);
 
    uint64_t prior_nanos = 0;
@@ -129,9 +164,12 @@ void record_io_finish(
 
    }
 
-   DBGTRC_NOPREFIX(trace_finish_timestamps | debug, DDCA_TRC_NONE,
-          "fd=%d, event_type = %-10s, function = %-20s, delta: %"PRIu64" nanosec, %"PRIu64" millisec)",     // PRIU64,
-                   fd, io_event_name(event_type), function, delta_nanos, delta_nanos_then_millis);
+   if (event_type != IE_OPEN && event_type != IE_CLOSE && event_type != IE_OTHER) {
+      if (tsrec->transfer_finish_time)
+         tsrec->transfer_gap = (finish_time > tsrec->transfer_finish_time)
+                                  ? finish_time - tsrec->transfer_finish_time : 0;
+      tsrec->transfer_finish_time = finish_time;
+   }
 
    // tsrec->fd = fd;   // unnecessary
    tsrec->event_type  = event_type;
@@ -139,6 +177,11 @@ void record_io_finish(
    tsrec->lineno      = lineno;
    tsrec->finish_time = finish_time;
    tsrec->function    =  function;
+   G_UNLOCK(timestamps_lock);
+
+   DBGTRC_NOPREFIX(trace_finish_timestamps | debug, DDCA_TRC_NONE,
+          "fd=%d, event_type = %-10s, function = %-20s, delta: %"PRIu64" nanosec, %"PRIu64" millisec)",     // PRIU64,
+                   fd, io_event_name(event_type), function, delta_nanos, delta_nanos_then_millis);
 }
 
 
@@ -21,9 +21,12 @@ struct {
    int           lineno;
    char *        function;
    int           fd;       // Linux file descriptor
+   uint64_t      transfer_finish_time;   // most recent read or write, 0 if none
+   uint64_t      transfer_gap;           // between the two most recent transfers, UINT64_MAX if unknown
 } IO_Event_Timestamp;
 
 IO_Event_Timestamp * get_io_event_timestamp(int fd);
+uint64_t get_io_transfer_gap(int fd);
 // IO_Event_Timestamp * new_io_event_timestamp(int fd);
 void free_io_event_timestamp(int fd);
 
@@ -0,0 +1,556 @@
+/** \file latency_stats.c
+ *
+ *  Latency distributions of DDC operations, by display, and of sleeps,
+ *  by sleep event type.
+ *
+ *  Distributions are recorded in log-linear histograms, in the manner of
+ *  HdrHistogram.  Values below 2**LATENCY_SUB_BUCKET_BITS microseconds are
+ *  counted exactly.  Each higher power of 2 is divided into
+ *  2**(LATENCY_SUB_BUCKET_BITS-1) equal buckets, so a reported percentile
+ *  is within about 6% of the true value.  Buckets are updated atomically,
+ *  without locking.
+ *
+ *  For delta exports, see stats_export.c, the histograms are copied into a
+ *  #Latency_Baseline, and the distribution since the baseline is computed
+ *  from the differences of the bucket counts.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <string.h>
+/** \endcond */
+
+#include "ddcutil_types.h"
+
+#include "util/report_util.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/execution_stats.h"
+#include "base/stats_export.h"
+
+#include "base/latency_stats.h"
+
+
+//
+// Histograms
+//
+
+#define LATENCY_SUB_BUCKET_BITS  5
+#define LATENCY_HALF_BUCKET_CT   (1 << (LATENCY_SUB_BUCKET_BITS-1))
+#define LATENCY_MAX_VALUE_BITS   36        // about 19 hours in microseconds
+#define LATENCY_BUCKET_CT        ((LATENCY_MAX_VALUE_BITS-LATENCY_SUB_BUCKET_BITS+2) * LATENCY_HALF_BUCKET_CT)
+
+typedef struct {
+   uint32_t counts[LATENCY_BUCKET_CT];
+   uint64_t total_ct;
+   uint64_t max_micros;
+} Latency_Histogram;
+
+
+static inline int
+bucket_index(uint64_t micros) {
+   if (micros >= ((uint64_t)1 << LATENCY_MAX_VALUE_BITS))
+      micros = ((uint64_t)1 << LATENCY_MAX_VALUE_BITS) - 1;
+   if (micros < (1 << LATENCY_SUB_BUCKET_BITS))
+      return micros;
+   int msb = 63 - __builtin_clzll(micros);
+   int magnitude = msb - LATENCY_SUB_BUCKET_BITS + 1;
+   int sub_bucket = micros >> magnitude;      // in [LATENCY_HALF_BUCKET_CT, 2*LATENCY_HALF_BUCKET_CT)
+   return magnitude * LATENCY_HALF_BUCKET_CT + sub_bucket;
+}
+
+
+// Returns the highest value counted in a bucket
+static inline uint64_t
+bucket_highest_value(int ndx) {
+   if (ndx < (1 << LATENCY_SUB_BUCKET_BITS))
+      return ndx;
+   int magnitude = ndx / LATENCY_HALF_BUCKET_CT - 1;
+   uint64_t sub_bucket = ndx - magnitude * LATENCY_HALF_BUCKET_CT;
+   return ((sub_bucket+1) << magnitude) - 1;
+}
+
+
+static void
+histogram_record(Latency_Histogram * h, uint64_t micros) {
+   __atomic_fetch_add(&h->counts[bucket_index(micros)], 1, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&h->total_ct, 1, __ATOMIC_RELAXED);
+   uint64_t cur = __atomic_load_n(&h->max_micros, __ATOMIC_RELAXED);
+   while (micros > cur &&
+          !__atomic_compare_exchange_n(&h->max_micros, &cur, micros,
+                                       false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+      ;
+}
+
+
+static void
+histogram_reset(Latency_Histogram * h) {
+   for (int ndx = 0; ndx < LATENCY_BUCKET_CT; ndx++)
+      __atomic_store_n(&h->counts[ndx], 0, __ATOMIC_RELAXED);
+   __atomic_store_n(&h->total_ct,   0, __ATOMIC_RELAXED);
+   __atomic_store_n(&h->max_micros, 0, __ATOMIC_RELAXED);
+}
+
+
+// Copies a histogram while recording may continue concurrently
+static void
+histogram_copy(Latency_Histogram * dest, Latency_Histogram * src) {
+   for (int ndx = 0; ndx < LATENCY_BUCKET_CT; ndx++)
+      dest->counts[ndx] = __atomic_load_n(&src->counts[ndx], __ATOMIC_RELAXED);
+   dest->total_ct   = __atomic_load_n(&src->total_ct,   __ATOMIC_RELAXED);
+   dest->max_micros = __atomic_load_n(&src->max_micros, __ATOMIC_RELAXED);
+}
+
+
+static DDCA_Latency_Summary
+summarize_counts(uint32_t * counts, uint64_t max_micros) {
+   uint64_t total_ct = 0;
+   for (int ndx = 0; ndx < LATENCY_BUCKET_CT; ndx++)
+      total_ct += counts[ndx];
+
+   DDCA_Latency_Summary summary = {0};
+   summary.count = total_ct;
+   summary.max   = max_micros;
+   if (total_ct == 0)
+      return summary;
+
+   uint64_t * percentiles[] = {&summary.p50, &summary.p90, &summary.p99};
+   int        pcts[]        = {50,           90,           99};
+   uint64_t seen_ct = 0;
+   int pndx = 0;
+   for (int ndx = 0; ndx < LATENCY_BUCKET_CT && pndx < 3; ndx++) {
+      seen_ct += counts[ndx];
+      while (pndx < 3 && seen_ct * 100 >= total_ct * pcts[pndx]) {
+         uint64_t value = bucket_highest_value(ndx);
+         *percentiles[pndx++] = (value < summary.max) ? value : summary.max;
+      }
+   }
+   return summary;
+}
+
+
+/** Summarizes a histogram.
+ *
+ *  The counts are copied before the percentiles are calculated, so
+ *  recording may continue concurrently.
+ */
+static DDCA_Latency_Summary
+histogram_summarize(Latency_Histogram * h) {
+   Latency_Histogram copy;
+   histogram_copy(&copy, h);
+   return summarize_counts(copy.counts, copy.max_micros);
+}
+
+
+/** Summarizes the values recorded in a histogram after an earlier copy of it.
+ *
+ *  The maximum of the delta is not recorded, so it is estimated as the
+ *  highest value of the highest nonempty bucket.  If any count is lower than
+ *  in the earlier copy, the histogram has been reset, and all its values are
+ *  summarized.
+ *
+ *  \param  cur    current copy
+ *  \param  prior  earlier copy, if NULL summarize all values
+ */
+static DDCA_Latency_Summary
+histogram_summarize_delta(Latency_Histogram * cur, Latency_Histogram * prior) {
+   if (!prior)
+      return summarize_counts(cur->counts, cur->max_micros);
+   uint32_t counts[LATENCY_BUCKET_CT];
+   int top_ndx = -1;
+   for (int ndx = 0; ndx < LATENCY_BUCKET_CT; ndx++) {
+      if (cur->counts[ndx] < prior->counts[ndx])
+         return summarize_counts(cur->counts, cur->max_micros);
+      counts[ndx] = cur->counts[ndx] - prior->counts[ndx];
+      if (counts[ndx] > 0)
+         top_ndx = ndx;
+   }
+   uint64_t max_micros = 0;
+   if (top_ndx >= 0)
+      max_micros = MIN(bucket_highest_value(top_ndx), cur->max_micros);
+   return summarize_counts(counts, max_micros);
+}
+
+
+//
+// Display operation latency
+//
+
+static const char * latency_operation_names[] = {
+      "write/read",
+      "multi-part read",
+      "capabilities",
+      "set vcp",
+      "lock wait",
+};
+
+
+/** Returns a description of a #DDCA_Latency_Operation */
+const char * latency_operation_name(DDCA_Latency_Operation op) {
+   assert(op >= 0 && op < DDCA_LATENCY_OPERATION_CT);
+   return latency_operation_names[op];
+}
+
+
+#define DISPLAY_LATENCY_MARKER "DLAT"
+typedef struct {
+   char              marker[4];
+   DDCA_IO_Path      io_path;
+   Latency_Histogram operations[DDCA_LATENCY_OPERATION_CT];
+} Display_Latency_Data;
+
+// Records are never freed, so a pointer obtained while holding the mutex
+// remains valid after it is released
+static GPtrArray * display_latency_recs;     // protected by display_latency_mutex
+static GMutex      display_latency_mutex;
+
+
+static Display_Latency_Data *
+get_display_latency_data(DDCA_IO_Path io_path) {
+   g_mutex_lock(&display_latency_mutex);
+   if (!display_latency_recs)
+      display_latency_recs = g_ptr_array_new();
+
+   Display_Latency_Data * result = NULL;
+   for (int ndx = 0; ndx < display_latency_recs->len; ndx++) {
+      Display_Latency_Data * cur = g_ptr_array_index(display_latency_recs, ndx);
+      assert(memcmp(cur->marker, DISPLAY_LATENCY_MARKER, 4) == 0);
+      if (dpath_eq(cur->io_path, io_path)) {
+         result = cur;
+         break;
+      }
+   }
+   if (!result) {
+      result = g_new0(Display_Latency_Data, 1);
+      memcpy(result->marker, DISPLAY_LATENCY_MARKER, 4);
+      result->io_path = io_path;
+      g_ptr_array_add(display_latency_recs, result);
+   }
+   g_mutex_unlock(&display_latency_mutex);
+   return result;
+}
+
+
+/** Records the elapsed time of an operation on a display.
+ *
+ *  \param  io_path        display
+ *  \param  op             operation
+ *  \param  elapsed_nanos  elapsed time in nanoseconds
+ */
+void record_display_latency(DDCA_IO_Path io_path, DDCA_Latency_Operation op, uint64_t elapsed_nanos) {
+   assert(op >= 0 && op < DDCA_LATENCY_OPERATION_CT);
+   Display_Latency_Data * rec = get_display_latency_data(io_path);
+   histogram_record(&rec->operations[op], elapsed_nanos / 1000);
+}
+
+
+//
+// Sleep latency
+//
+
+#define SLEEP_EVENT_TYPE_CT (SE_SPECIAL+1)
+
+static Latency_Histogram requested_sleep_histograms[SLEEP_EVENT_TYPE_CT];
+static Latency_Histogram actual_sleep_histograms[SLEEP_EVENT_TYPE_CT];
+
+
+/** Records the requested and actual time of a sleep.
+ *
+ *  \param  event_type       sleep event type
+ *  \param  requested_nanos  requested sleep time in nanoseconds
+ *  \param  actual_nanos     actual sleep time in nanoseconds
+ */
+void record_sleep_latency(Sleep_Event_Type event_type, uint64_t requested_nanos, uint64_t actual_nanos) {
+   assert(event_type >= 0 && event_type < SLEEP_EVENT_TYPE_CT);
+   histogram_record(&requested_sleep_histograms[event_type], requested_nanos / 1000);
+   histogram_record(&actual_sleep_histograms[event_type],    actual_nanos / 1000);
+}
+
+
+//
+// Reset, report, snapshot
+//
+
+/** Resets all latency distributions */
+void reset_latency_stats() {
+   g_mutex_lock(&display_latency_mutex);
+   if (display_latency_recs) {
+      for (int ndx = 0; ndx < display_latency_recs->len; ndx++) {
+         Display_Latency_Data * rec = g_ptr_array_index(display_latency_recs, ndx);
+         for (int op = 0; op < DDCA_LATENCY_OPERATION_CT; op++)
+            histogram_reset(&rec->operations[op]);
+      }
+   }
+   g_mutex_unlock(&display_latency_mutex);
+
+   for (int ndx = 0; ndx < SLEEP_EVENT_TYPE_CT; ndx++) {
+      histogram_reset(&requested_sleep_histograms[ndx]);
+      histogram_reset(&actual_sleep_histograms[ndx]);
+   }
+}
+
+
+/** Returns a snapshot of all latency distributions.
+ *
+ *  \return newly allocated #DDCA_Stats_Snapshot,
+ *          caller should free using #free_latency_stats_snapshot()
+ */
+DDCA_Stats_Snapshot *
+get_latency_stats_snapshot() {
+   DDCA_Stats_Snapshot * snapshot = g_new0(DDCA_Stats_Snapshot, 1);
+
+   g_mutex_lock(&display_latency_mutex);
+   snapshot->display_ct = (display_latency_recs) ? display_latency_recs->len : 0;
+   snapshot->displays = g_new0(DDCA_Display_Latency_Stats, snapshot->display_ct);
+   for (int ndx = 0; ndx < snapshot->display_ct; ndx++) {
+      Display_Latency_Data * rec = g_ptr_array_index(display_latency_recs, ndx);
+      snapshot->displays[ndx].io_path = rec->io_path;
+      for (int op = 0; op < DDCA_LATENCY_OPERATION_CT; op++)
+         snapshot->displays[ndx].operations[op] = histogram_summarize(&rec->operations[op]);
+   }
+   g_mutex_unlock(&display_latency_mutex);
+
+   snapshot->sleep_event_ct = SLEEP_EVENT_TYPE_CT;
+   snapshot->sleep_events = g_new0(DDCA_Sleep_Event_Latency_Stats, SLEEP_EVENT_TYPE_CT);
+   for (int ndx = 0; ndx < SLEEP_EVENT_TYPE_CT; ndx++) {
+      DDCA_Sleep_Event_Latency_Stats * cur = &snapshot->sleep_events[ndx];
+      cur->sleep_event_name = sleep_event_name(ndx);
+      cur->requested = histogram_summarize(&requested_sleep_histograms[ndx]);
+      cur->actual    = histogram_summarize(&actual_sleep_histograms[ndx]);
+   }
+
+   return snapshot;
+}
+
+
+/** Frees a snapshot returned by #get_latency_stats_snapshot()
+ *
+ *  \param  snapshot  pointer to snapshot, if NULL do nothing
+ */
+void
+free_latency_stats_snapshot(DDCA_Stats_Snapshot * snapshot) {
+   if (snapshot) {
+      g_free(snapshot->displays);
+      g_free(snapshot->sleep_events);
+      g_free(snapshot);
+   }
+}
+
+
+//
+// Baselines for delta exports
+//
+
+struct Latency_Baseline {
+   int                 display_ct;
+   DDCA_IO_Path *      io_paths;
+   Latency_Histogram * operations;      // display_ct * DDCA_LATENCY_OPERATION_CT
+   Latency_Histogram   requested_sleep[SLEEP_EVENT_TYPE_CT];
+   Latency_Histogram   actual_sleep[SLEEP_EVENT_TYPE_CT];
+};
+
+
+/** Copies all latency histograms.
+ *
+ *  \return newly allocated #Latency_Baseline,
+ *          caller should free using #free_latency_baseline()
+ */
+Latency_Baseline *
+capture_latency_baseline() {
+   Latency_Baseline * baseline = g_new0(Latency_Baseline, 1);
+
+   g_mutex_lock(&display_latency_mutex);
+   baseline->display_ct = (display_latency_recs) ? display_latency_recs->len : 0;
+   baseline->io_paths   = g_new0(DDCA_IO_Path, baseline->display_ct);
+   baseline->operations = g_new0(Latency_Histogram, baseline->display_ct * DDCA_LATENCY_OPERATION_CT);
+   for (int ndx = 0; ndx < baseline->display_ct; ndx++) {
+      Display_Latency_Data * rec = g_ptr_array_index(display_latency_recs, ndx);
+      baseline->io_paths[ndx] = rec->io_path;
+      for (int op = 0; op < DDCA_LATENCY_OPERATION_CT; op++)
+         histogram_copy(&baseline->operations[ndx * DDCA_LATENCY_OPERATION_CT + op], &rec->operations[op]);
+   }
+   g_mutex_unlock(&display_latency_mutex);
+
+   for (int ndx = 0; ndx < SLEEP_EVENT_TYPE_CT; ndx++) {
+      histogram_copy(&baseline->requested_sleep[ndx], &requested_sleep_histograms[ndx]);
+      histogram_copy(&baseline->actual_sleep[ndx],    &actual_sleep_histograms[ndx]);
+   }
+   return baseline;
+}
+
+
+/** Returns a snapshot of the latency distributions of the values recorded
+ *  between two baselines.
+ *
+ *  \param  from  earlier baseline, if NULL the distributions of all values
+ *                up to **to** are returned
+ *  \param  to    later baseline
+ *  \return newly allocated #DDCA_Stats_Snapshot,
+ *          caller should free using #free_latency_stats_snapshot()
+ */
+DDCA_Stats_Snapshot *
+get_latency_stats_delta(Latency_Baseline * from, Latency_Baseline * to) {
+   DDCA_Stats_Snapshot * snapshot = g_new0(DDCA_Stats_Snapshot, 1);
+
+   snapshot->display_ct = to->display_ct;
+   snapshot->displays = g_new0(DDCA_Display_Latency_Stats, snapshot->display_ct);
+   for (int ndx = 0; ndx < to->display_ct; ndx++) {
+      int from_ndx = -1;
+      for (int fndx = 0; from && fndx < from->display_ct && from_ndx < 0; fndx++) {
+         if (dpath_eq(from->io_paths[fndx], to->io_paths[ndx]))
+            from_ndx = fndx;
+      }
+      snapshot->displays[ndx].io_path = to->io_paths[ndx];
+      for (int op = 0; op < DDCA_LATENCY_OPERATION_CT; op++) {
+         snapshot->displays[ndx].operations[op] = histogram_summarize_delta(
+               &to->operations[ndx * DDCA_LATENCY_OPERATION_CT + op],
+               (from_ndx >= 0) ? &from->operations[from_ndx * DDCA_LATENCY_OPERATION_CT + op] : NULL);
+      }
+   }
+
+   snapshot->sleep_event_ct = SLEEP_EVENT_TYPE_CT;
+   snapshot->sleep_events = g_new0(DDCA_Sleep_Event_Latency_Stats, SLEEP_EVENT_TYPE_CT);
+   for (int ndx = 0; ndx < SLEEP_EVENT_TYPE_CT; ndx++) {
+      DDCA_Sleep_Event_Latency_Stats * cur = &snapshot->sleep_events[ndx];
+      cur->sleep_event_name = sleep_event_name(ndx);
+      cur->requested = histogram_summarize_delta(&to->requested_sleep[ndx],
+                                                 (from) ? &from->requested_sleep[ndx] : NULL);
+      cur->actual    = histogram_summarize_delta(&to->actual_sleep[ndx],
+                                                 (from) ? &from->actual_sleep[ndx] : NULL);
+   }
+
+   return snapshot;
+}
+
+
+/** Frees a #Latency_Baseline
+ *
+ *  \param  baseline  pointer to baseline, if NULL do nothing
+ */
+void
+free_latency_baseline(Latency_Baseline * baseline) {
+   if (baseline) {
+      g_free(baseline->io_paths);
+      g_free(baseline->operations);
+      g_free(baseline);
+   }
+}
+
+
+static void
+report_latency_summary(const char * label, DDCA_Latency_Summary * summary, int depth) {
+   rpt_vstring(depth, "%-30s %7"PRIu64"  %9"PRIu64"  %9"PRIu64"  %9"PRIu64"  %9"PRIu64,
+                      label, summary->count, summary->p50, summary->p90, summary->p99, summary->max);
+}
+
+
+/** Reports the latency distributions.
+ *
+ *  \param depth logical indentation depth
+ */
+void report_latency_stats(int depth) {
+   int d1 = depth+1;
+   int d2 = depth+2;
+   DDCA_Stats_Snapshot * snapshot = get_latency_stats_snapshot();
+
+   rpt_title("Operation latency by display (microseconds):", depth);
+   if (snapshot->display_ct == 0)
+      rpt_vstring(d1, "No operations");
+   for (int ndx = 0; ndx < snapshot->display_ct; ndx++) {
+      DDCA_Display_Latency_Stats * cur = &snapshot->displays[ndx];
+      rpt_vstring(d1, "%s:", dpath_repr_t(&cur->io_path));
+      rpt_vstring(d2, "%-30s %7s  %9s  %9s  %9s  %9s", "Operation", "Count", "p50", "p90", "p99", "max");
+      for (int op = 0; op < DDCA_LATENCY_OPERATION_CT; op++) {
+         if (cur->operations[op].count > 0)
+            report_latency_summary(latency_operation_name(op), &cur->operations[op], d2);
+      }
+   }
+   rpt_nl();
+
+   rpt_title("Requested and actual sleep by event type (microseconds):", depth);
+   rpt_vstring(d1, "%-30s %7s  %9s  %9s  %9s  %9s", "Sleep event type", "Count", "p50", "p90", "p99", "max");
+   for (int ndx = 0; ndx < snapshot->sleep_event_ct; ndx++) {
+      DDCA_Sleep_Event_Latency_Stats * cur = &snapshot->sleep_events[ndx];
+      if (cur->requested.count == 0)
+         continue;
+      char buf[60];
+      g_snprintf(buf, sizeof(buf), "%s requested", cur->sleep_event_name);
+      report_latency_summary(buf, &cur->requested, d1);
+      g_snprintf(buf, sizeof(buf), "%s actual", cur->sleep_event_name);
+      report_latency_summary(buf, &cur->actual, d1);
+   }
+
+   free_latency_stats_snapshot(snapshot);
+}
+
+
+static void
+export_latency_summary(Stats_Export * exp, const char * name, DDCA_Latency_Summary * summary,
+                       const char * label1, const char * value1,
+                       const char * label2, const char * value2)
+{
+   char count_name[100];
+   g_snprintf(count_name, sizeof(count_name), "%s_count", name);
+   const char * quantiles[] = {"0.5", "0.9", "0.99", "1"};
+   uint64_t     values[]    = {summary->p50, summary->p90, summary->p99, summary->max};
+   for (int ndx = 0; ndx < 4; ndx++)
+      stats_export_sample(exp, name, values[ndx] / 1e6, 3,
+                          label1, value1, label2, value2, "quantile", quantiles[ndx]);
+   stats_export_sample(exp, count_name, summary->count, 2, label1, value1, label2, value2);
+}
+
+
+/** Exports the latency distributions as summaries.
+ *  Quantile 1 is the maximum.  If the export has a baseline cursor,
+ *  the distributions of the values recorded since the baseline.
+ *
+ *  \param exp  export instance
+ */
+void export_latency_stats(Stats_Export * exp) {
+   DDCA_Stats_Snapshot * snapshot = NULL;
+   if (exp->baseline || exp->capture) {
+      Latency_Baseline * current = capture_latency_baseline();
+      snapshot = get_latency_stats_delta((exp->baseline) ? exp->baseline->latency : NULL, current);
+      if (exp->capture) {
+         // may be the same cursor as the baseline, which has been used
+         free_latency_baseline(exp->capture->latency);
+         exp->capture->latency = current;
+      }
+      else
+         free_latency_baseline(current);
+   }
+   else
+      snapshot = get_latency_stats_snapshot();
+
+   stats_export_metric(exp, "ddcutil_operation_latency_seconds", STATS_METRIC_SUMMARY,
+                            "Elapsed time of DDC operations, by display and operation");
+   for (int ndx = 0; ndx < snapshot->display_ct; ndx++) {
+      DDCA_Display_Latency_Stats * cur = &snapshot->displays[ndx];
+      char * display = g_strdup(dpath_repr_t(&cur->io_path));
+      for (int op = 0; op < DDCA_LATENCY_OPERATION_CT; op++) {
+         if (cur->operations[op].count > 0)
+            export_latency_summary(exp, "ddcutil_operation_latency_seconds", &cur->operations[op],
+                                   "display", display, "operation", latency_operation_name(op));
+      }
+      g_free(display);
+   }
+
+   stats_export_metric(exp, "ddcutil_sleep_duration_seconds", STATS_METRIC_SUMMARY,
+                            "Requested and actual sleep time, by sleep event type");
+   for (int ndx = 0; ndx < snapshot->sleep_event_ct; ndx++) {
+      DDCA_Sleep_Event_Latency_Stats * cur = &snapshot->sleep_events[ndx];
+      if (cur->requested.count == 0)
+         continue;
+      export_latency_summary(exp, "ddcutil_sleep_duration_seconds", &cur->requested,
+                             "event", cur->sleep_event_name, "kind", "requested");
+      export_latency_summary(exp, "ddcutil_sleep_duration_seconds", &cur->actual,
+                             "event", cur->sleep_event_name, "kind", "actual");
+   }
+
+   free_latency_stats_snapshot(snapshot);
+}
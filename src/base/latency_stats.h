@@ -0,0 +1,38 @@
+/** \file latency_stats.h
+ *
+ *  Latency distributions of DDC operations, by display, and of sleeps,
+ *  by sleep event type.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LATENCY_STATS_H_
+#define LATENCY_STATS_H_
+
+/** \cond */
+#include <inttypes.h>
+/** \endcond */
+
+#include "ddcutil_types.h"
+
+#include "base/execution_stats.h"
+#include "base/stats_export.h"
+
+const char * latency_operation_name(DDCA_Latency_Operation op);
+
+void   record_display_latency(DDCA_IO_Path io_path, DDCA_Latency_Operation op, uint64_t elapsed_nanos);
+void   record_sleep_latency(Sleep_Event_Type event_type, uint64_t requested_nanos, uint64_t actual_nanos);
+
+void   reset_latency_stats();
+void   report_latency_stats(int depth);
+void   export_latency_stats(Stats_Export * exp);
+
+DDCA_Stats_Snapshot * get_latency_stats_snapshot();
+void   free_latency_stats_snapshot(DDCA_Stats_Snapshot * snapshot);
+
+Latency_Baseline *    capture_latency_baseline();
+DDCA_Stats_Snapshot * get_latency_stats_delta(Latency_Baseline * from, Latency_Baseline * to);
+void   free_latency_baseline(Latency_Baseline * baseline);
+
+#endif /* LATENCY_STATS_H_ */
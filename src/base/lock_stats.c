@@ -0,0 +1,228 @@
+/** \file lock_stats.c
+ *
+ *  Optional counts of acquisitions and wait times of internal locks.
+ *
+ *  When enabled, each instrumented lock first attempts a non-blocking
+ *  acquisition.  Only if that fails is the time spent waiting measured, so
+ *  an uncontended acquisition costs one extra atomic increment.  When
+ *  disabled the cost is a single test of #lock_stats_enabled.
+ *
+ *  The statistics show whether threads performing DDC I/O serialize on
+ *  the locks guarding a display, the retry statistics, or the per-thread
+ *  data, e.g. to confirm the benefit of changes to the locking.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/report_util.h"
+#include "util/timestamp.h"
+
+#include "base/lock_stats.h"
+
+bool lock_stats_enabled = false;
+
+static GPtrArray * lock_stats_recs;     // protected by lock_stats_mutex
+static GMutex      lock_stats_mutex;
+
+
+/** Enables or disables recording of lock statistics.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ */
+bool enable_lock_stats(bool onoff) {
+   return __atomic_exchange_n(&lock_stats_enabled, onoff, __ATOMIC_RELAXED);
+}
+
+
+static void
+register_lock_stats(Lock_Stats * stats) {
+   g_mutex_lock(&lock_stats_mutex);
+   if (!stats->registered) {
+      if (!lock_stats_recs)
+         lock_stats_recs = g_ptr_array_new();
+      g_ptr_array_add(lock_stats_recs, stats);
+      __atomic_store_n(&stats->registered, true, __ATOMIC_RELEASE);
+   }
+   g_mutex_unlock(&lock_stats_mutex);
+}
+
+
+/** Records an acquisition of a lock.
+ *
+ *  \param  stats       lock statistics
+ *  \param  contended   true if the lock was not immediately available
+ *  \param  wait_nanos  time spent waiting for the lock
+ */
+void record_lock_acquisition(Lock_Stats * stats, bool contended, uint64_t wait_nanos) {
+   if (!__atomic_load_n(&stats->registered, __ATOMIC_ACQUIRE))
+      register_lock_stats(stats);
+   __atomic_fetch_add(&stats->acquire_ct, 1, __ATOMIC_RELAXED);
+   if (contended) {
+      __atomic_fetch_add(&stats->contended_ct, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&stats->total_wait_nanos, wait_nanos, __ATOMIC_RELAXED);
+      uint64_t cur = __atomic_load_n(&stats->max_wait_nanos, __ATOMIC_RELAXED);
+      while (wait_nanos > cur &&
+             !__atomic_compare_exchange_n(&stats->max_wait_nanos, &cur, wait_nanos,
+                                          false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+         ;
+   }
+}
+
+
+/** Locks a mutex, recording the acquisition if lock statistics are enabled.
+ *
+ *  \param  mutex  mutex to lock
+ *  \param  stats  statistics for the mutex
+ */
+void lock_stats_mutex_lock(GMutex * mutex, Lock_Stats * stats) {
+   if (!lock_stats_enabled) {
+      g_mutex_lock(mutex);
+   }
+   else if (g_mutex_trylock(mutex)) {
+      record_lock_acquisition(stats, false, 0);
+   }
+   else {
+      uint64_t start = cur_monotonic_nanosec();
+      g_mutex_lock(mutex);
+      record_lock_acquisition(stats, true, cur_monotonic_nanosec() - start);
+   }
+}
+
+
+/** Acquires a read lock, recording the acquisition if lock statistics are
+ *  enabled.
+ *
+ *  \param  lock   lock
+ *  \param  stats  statistics for the lock
+ */
+void lock_stats_rw_lock_reader_lock(GRWLock * lock, Lock_Stats * stats) {
+   if (!lock_stats_enabled) {
+      g_rw_lock_reader_lock(lock);
+   }
+   else if (g_rw_lock_reader_trylock(lock)) {
+      record_lock_acquisition(stats, false, 0);
+   }
+   else {
+      uint64_t start = cur_monotonic_nanosec();
+      g_rw_lock_reader_lock(lock);
+      record_lock_acquisition(stats, true, cur_monotonic_nanosec() - start);
+   }
+}
+
+
+/** Acquires a write lock, recording the acquisition if lock statistics are
+ *  enabled.
+ *
+ *  \param  lock   lock
+ *  \param  stats  statistics for the lock
+ */
+void lock_stats_rw_lock_writer_lock(GRWLock * lock, Lock_Stats * stats) {
+   if (!lock_stats_enabled) {
+      g_rw_lock_writer_lock(lock);
+   }
+   else if (g_rw_lock_writer_trylock(lock)) {
+      record_lock_acquisition(stats, false, 0);
+   }
+   else {
+      uint64_t start = cur_monotonic_nanosec();
+      g_rw_lock_writer_lock(lock);
+      record_lock_acquisition(stats, true, cur_monotonic_nanosec() - start);
+   }
+}
+
+
+/** Resets the statistics of all locks */
+void reset_lock_stats() {
+   g_mutex_lock(&lock_stats_mutex);
+   int ct = (lock_stats_recs) ? lock_stats_recs->len : 0;
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Lock_Stats * cur = g_ptr_array_index(lock_stats_recs, ndx);
+      __atomic_store_n(&cur->acquire_ct,       0, __ATOMIC_RELAXED);
+      __atomic_store_n(&cur->contended_ct,     0, __ATOMIC_RELAXED);
+      __atomic_store_n(&cur->total_wait_nanos, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&cur->max_wait_nanos,   0, __ATOMIC_RELAXED);
+   }
+   g_mutex_unlock(&lock_stats_mutex);
+}
+
+
+/** Reports the statistics of each lock that has been acquired while
+ *  recording was enabled.  Nothing is reported if recording was never
+ *  enabled.
+ *
+ *  \param depth logical indentation depth
+ */
+void report_lock_stats(int depth) {
+   int d1 = depth+1;
+   g_mutex_lock(&lock_stats_mutex);
+   int ct = (lock_stats_recs) ? lock_stats_recs->len : 0;
+   if (ct > 0 || lock_stats_enabled) {
+      rpt_title("Lock contention:", depth);
+      if (ct == 0)
+         rpt_vstring(d1, "No locks acquired");
+      else
+         rpt_vstring(d1, "%-28s %-20s %10s %10s %12s %12s",
+                         "Lock", "Display", "Acquired", "Contended", "Wait (ms)", "Max (usec)");
+      for (int ndx = 0; ndx < ct; ndx++) {
+         Lock_Stats * cur = g_ptr_array_index(lock_stats_recs, ndx);
+         rpt_vstring(d1, "%-28s %-20s %10"PRIu64" %10"PRIu64" %12.3f %12"PRIu64,
+                         cur->lock_name, (cur->display) ? cur->display : "",
+                         __atomic_load_n(&cur->acquire_ct,   __ATOMIC_RELAXED),
+                         __atomic_load_n(&cur->contended_ct, __ATOMIC_RELAXED),
+                         __atomic_load_n(&cur->total_wait_nanos, __ATOMIC_RELAXED) / 1000000.0,
+                         __atomic_load_n(&cur->max_wait_nanos,   __ATOMIC_RELAXED) / 1000);
+      }
+      rpt_nl();
+   }
+   g_mutex_unlock(&lock_stats_mutex);
+}
+
+
+static void
+export_lock_sample(Stats_Export * exp, const char * name, double value, Lock_Stats * stats) {
+   if (stats->display)
+      stats_export_sample(exp, name, value, 2, "lock", stats->lock_name, "display", stats->display);
+   else
+      stats_export_sample(exp, name, value, 1, "lock", stats->lock_name);
+}
+
+
+/** Exports the statistics of each lock that has been acquired while
+ *  recording was enabled.
+ *
+ *  \param exp  export instance
+ */
+void export_lock_stats(Stats_Export * exp) {
+   g_mutex_lock(&lock_stats_mutex);
+   int ct = (lock_stats_recs) ? lock_stats_recs->len : 0;
+   if (ct > 0) {
+      stats_export_metric(exp, "ddcutil_lock_acquisitions_total", STATS_METRIC_COUNTER,
+                               "Number of acquisitions, by lock");
+      stats_export_metric(exp, "ddcutil_lock_contended_total", STATS_METRIC_COUNTER,
+                               "Number of acquisitions that had to wait, by lock");
+      stats_export_metric(exp, "ddcutil_lock_wait_seconds_total", STATS_METRIC_COUNTER,
+                               "Total time spent waiting, by lock");
+      stats_export_metric(exp, "ddcutil_lock_wait_max_seconds", STATS_METRIC_GAUGE,
+                               "Maximum time spent waiting for one acquisition, by lock");
+   }
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Lock_Stats * cur = g_ptr_array_index(lock_stats_recs, ndx);
+      export_lock_sample(exp, "ddcutil_lock_acquisitions_total",
+                         __atomic_load_n(&cur->acquire_ct, __ATOMIC_RELAXED), cur);
+      export_lock_sample(exp, "ddcutil_lock_contended_total",
+                         __atomic_load_n(&cur->contended_ct, __ATOMIC_RELAXED), cur);
+      export_lock_sample(exp, "ddcutil_lock_wait_seconds_total",
+                         __atomic_load_n(&cur->total_wait_nanos, __ATOMIC_RELAXED) / 1e9, cur);
+      export_lock_sample(exp, "ddcutil_lock_wait_max_seconds",
+                         __atomic_load_n(&cur->max_wait_nanos, __ATOMIC_RELAXED) / 1e9, cur);
+   }
+   g_mutex_unlock(&lock_stats_mutex);
+}
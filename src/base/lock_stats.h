@@ -0,0 +1,48 @@
+/** \file lock_stats.h
+ *
+ *  Optional counts of acquisitions and wait times of internal locks.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LOCK_STATS_H_
+#define LOCK_STATS_H_
+
+/** \cond */
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdbool.h>
+/** \endcond */
+
+#include "base/stats_export.h"
+
+/** Statistics for one lock, or for the lock of one display.
+ *
+ *  Instances are typically static, initialized with only **lock_name**
+ *  (and **display** for a display lock), and are registered for reporting
+ *  the first time an acquisition is recorded.  They must never be freed.
+ */
+typedef struct {
+   const char * lock_name;
+   const char * display;            ///< display, or NULL if not a display lock
+   bool         registered;         ///< atomic access
+   uint64_t     acquire_ct;         ///< atomic access
+   uint64_t     contended_ct;       ///< acquisitions that had to wait, atomic access
+   uint64_t     total_wait_nanos;   ///< atomic access
+   uint64_t     max_wait_nanos;     ///< atomic access
+} Lock_Stats;
+
+extern bool lock_stats_enabled;
+
+bool   enable_lock_stats(bool onoff);
+void   record_lock_acquisition(Lock_Stats * stats, bool contended, uint64_t wait_nanos);
+void   lock_stats_mutex_lock(GMutex * mutex, Lock_Stats * stats);
+void   lock_stats_rw_lock_reader_lock(GRWLock * lock, Lock_Stats * stats);
+void   lock_stats_rw_lock_writer_lock(GRWLock * lock, Lock_Stats * stats);
+
+void   reset_lock_stats();
+void   report_lock_stats(int depth);
+void   export_lock_stats(Stats_Export * exp);
+
+#endif /* LOCK_STATS_H_ */
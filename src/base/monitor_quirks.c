@@ -1,15 +1,51 @@
-/** @file monitor_quirks.c */
+/** @file monitor_quirks.c
+ *
+ *  Database of monitor models requiring special handling.
+ *
+ *  Entries are keyed by monitor model.  A small table is compiled into the
+ *  library.  Entries can be added or overridden in the INI style file
+ *  **ddcutil/quirks** on the XDG configuration path, e.g.
+ *  $HOME/.config/ddcutil/quirks. Each section is named by the model id
+ *  string, as used for user defined feature files, e.g.
+ *
+ *      [DEL-DELL_U3011-16485]
+ *      combined-write-read  = yes
+ *      sleep-multiplier     = 0.5
+ *      unsupported-features = 0x14 0xdc
+ *      no-setting           = no
+ *      no-mfg-range         = no
+ *      unreliable-capabilities = no
+ *      message              = text shown by ddcutil detect
+ *
+ *  Values in the file replace those of a built-in entry for the same model.
+ */
 
 // Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+/** \cond */
+#include <glib-2.0/glib.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
 #include "private/ddcutil_types_private.h"
 
 #include "util/coredefs_base.h"
+#include "util/report_util.h"
+#include "util/simple_ini_file.h"
+#include "util/string_util.h"
+#include "util/xdg_util.h"
+
 #include "base/core.h"
 #include "base/monitor_model_key.h"
+#include "base/rtti.h"
+
 #include "base/monitor_quirks.h"
 
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_BASE;
+
 typedef struct {
    DDCA_Monitor_Model_Key mmk;
    Monitor_Quirk_Data     data;
@@ -18,23 +54,191 @@ typedef struct {
 static Monitor_Quirk_Table_Entry quirk_table[] = {
    {{ "XMI", "Mi Monitor", 13380, true}, { MQ_NO_SETTING,   NULL}},
 // {{ "DEL", "DELL U3011", 16485, true}, { MQ_NO_MFG_RANGE, "msg 1"}},    // for testing
+// {{ "DEL", "DELL P2411H", 41099, true}, { MQ_COMBINED_WRITE_READ_OK, NULL}},  // for testing
 // {{ "NEC", "P241W",      26715, true}, { MQ_NO_SETTING,   "msg 2"}},    // for testing
 };
 int quirk_table_size = ARRAY_SIZE(quirk_table);
 
+static GMutex            quirks_mutex;                // protects the following
+static Parsed_Ini_File * quirks_file = NULL;          // user quirks file, NULL if none
+static bool              quirks_file_loaded = false;
+static GHashTable *      resolved_quirks = NULL;      // lower case model id -> Monitor_Quirk_Data *, NULL if none
+
+
+static void
+load_quirks_file() {
+   bool debug = false;
+   char * fn = find_xdg_config_file("ddcutil", "quirks");
+   DBGTRC_STARTING(debug, TRACE_GROUP, "quirks file: %s", fn);
+   if (fn) {
+      GPtrArray * errmsgs = g_ptr_array_new_with_free_func(g_free);
+      if (ini_file_load(fn, errmsgs, false, &quirks_file) != 0)
+         quirks_file = NULL;
+      for (guint ndx = 0; ndx < errmsgs->len; ndx++)
+         fprintf(ferr(), "%s: %s\n", fn, (char *) g_ptr_array_index(errmsgs, ndx));
+      g_ptr_array_free(errmsgs, true);
+      free(fn);
+   }
+   DBGTRC_DONE(debug, TRACE_GROUP, "quirks_file=%p", quirks_file);
+}
+
+
+static bool
+parse_ini_bool(const char * s, bool * result_loc) {
+   if (strcasecmp(s, "yes") == 0 || strcasecmp(s, "true") == 0 || streq(s, "1"))
+      *result_loc = true;
+   else if (strcasecmp(s, "no") == 0 || strcasecmp(s, "false") == 0 || streq(s, "0"))
+      *result_loc = false;
+   else
+      return false;
+   return true;
+}
+
+
+static void
+set_quirk_flag(Monitor_Quirk_Data * data, Monitor_Quirk_Type flag, bool onoff) {
+   if (onoff)
+      data->quirk_type |= flag;
+   else
+      data->quirk_type &= ~flag;
+}
+
+
+/** Applies the settings of the user quirks file section for a model.
+ *
+ *  @param  segment  section name, in lower case
+ *  @param  data     quirk data to update
+ *  @return true if the file contains the section
+ */
+static bool
+apply_quirks_file_section(const char * segment, Monitor_Quirk_Data * data) {
+   bool debug = false;
+   bool found = false;
+   bool bval;
+   char * s;
+
+   if ( (s = ini_file_get_value(quirks_file, segment, "no-setting")) && parse_ini_bool(s, &bval) ) {
+      set_quirk_flag(data, MQ_NO_SETTING, bval);
+      found = true;
+   }
+   if ( (s = ini_file_get_value(quirks_file, segment, "no-mfg-range")) && parse_ini_bool(s, &bval) ) {
+      set_quirk_flag(data, MQ_NO_MFG_RANGE, bval);
+      found = true;
+   }
+   if ( (s = ini_file_get_value(quirks_file, segment, "unreliable-capabilities")) && parse_ini_bool(s, &bval) ) {
+      set_quirk_flag(data, MQ_UNRELIABLE_CAPABILITIES, bval);
+      found = true;
+   }
+   if ( (s = ini_file_get_value(quirks_file, segment, "message")) ) {
+      data->quirk_type |= MQ_OTHER;
+      data->quirk_msg = g_strdup(s);
+      found = true;
+   }
+   if ( (s = ini_file_get_value(quirks_file, segment, "combined-write-read")) && parse_ini_bool(s, &bval) ) {
+      set_quirk_flag(data, MQ_COMBINED_WRITE_READ_OK, bval);
+      set_quirk_flag(data, MQ_SEPARATE_WRITE_READ, !bval);
+      found = true;
+   }
+   if ( (s = ini_file_get_value(quirks_file, segment, "sleep-multiplier")) ) {
+      float fval;
+      if (str_to_float(s, &fval) && fval >= 0) {
+         data->sleep_multiplier = fval;
+         found = true;
+      }
+   }
+   if ( (s = ini_file_get_value(quirks_file, segment, "unsupported-features")) ) {
+      Bit_Set_256 features = EMPTY_BIT_SET_256;
+      gchar ** pieces = g_strsplit_set(s, " ,", -1);
+      for (int ndx = 0; pieces[ndx]; ndx++) {
+         Byte code;
+         if (*pieces[ndx] && any_one_byte_hex_string_to_byte_in_buf(pieces[ndx], &code))
+            features = bs256_insert(features, code);
+      }
+      g_strfreev(pieces);
+      data->unsupported_features = features;
+      found = true;
+   }
+   DBGMSF(debug, "segment=%s, returning %s", segment, sbool(found));
+   return found;
+}
+
 
+/** Gets the special handling required for a monitor model.
+ *
+ *  The built-in table is combined with the user quirks file, which is
+ *  read on first use.  The result is computed once for each model.
+ *
+ *  @param  mmk  monitor model key
+ *  @return pointer to #Monitor_Quirk_Data, NULL if none, do not free
+ */
 Monitor_Quirk_Data *
 get_monitor_quirks(DDCA_Monitor_Model_Key * mmk) {
    bool debug = false;
    DBGMSF(debug, "quirk_table_size=%d, mmk=%s", quirk_table_size, mmk_repr(*mmk));
-   Monitor_Quirk_Data * result = NULL;
 
-   for (int ndx = 0; ndx < quirk_table_size; ndx++) {
-      DBGMSF(debug,  "ndx=%d, mmk=%s", ndx, mmk_repr(quirk_table[ndx].mmk));
-      if (monitor_model_key_eq(*mmk, quirk_table[ndx].mmk)) {
-         result = &quirk_table[ndx].data;
-         break;
+   char * model_id = model_id_string(mmk->mfg_id, mmk->model_name, mmk->product_code);
+   strlower(model_id);             // hash key is case insensitive, as are ini file section names
+
+   g_mutex_lock(&quirks_mutex);
+   if (!quirks_file_loaded) {
+      load_quirks_file();
+      quirks_file_loaded = true;
+   }
+   if (!resolved_quirks)
+      resolved_quirks = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+   Monitor_Quirk_Data * result = NULL;
+   gpointer value = NULL;
+   if (g_hash_table_lookup_extended(resolved_quirks, model_id, NULL, &value)) {
+      result = value;
+      free(model_id);
+   }
+   else {
+      Monitor_Quirk_Data * builtin = NULL;
+      for (int ndx = 0; ndx < quirk_table_size; ndx++) {
+         DBGMSF(debug,  "ndx=%d, mmk=%s", ndx, mmk_repr(quirk_table[ndx].mmk));
+         if (monitor_model_key_eq(*mmk, quirk_table[ndx].mmk)) {
+            builtin = &quirk_table[ndx].data;
+            break;
+         }
       }
+      result = builtin;
+      if (quirks_file) {
+         Monitor_Quirk_Data * data = calloc(1, sizeof(Monitor_Quirk_Data));
+         if (builtin)
+            *data = *builtin;
+         if (apply_quirks_file_section(model_id, data))
+            result = data;
+         else
+            free(data);
+      }
+      g_hash_table_insert(resolved_quirks, model_id, result);  // n. result may be NULL
    }
+   g_mutex_unlock(&quirks_mutex);
+
+   DBGMSF(debug, "Returning %p", result);
    return result;
 }
+
+
+/** Emits a debug report of a #Monitor_Quirk_Data instance
+ *
+ *  @param  quirk  pointer to instance
+ *  @param  depth  logical indentation depth
+ */
+void
+dbgrpt_monitor_quirks(Monitor_Quirk_Data * quirk, int depth) {
+   rpt_structure_loc("Monitor_Quirk_Data", quirk, depth);
+   int d1 = depth+1;
+   rpt_vstring(d1, "quirk_type:           0x%02x", quirk->quirk_type);
+   rpt_vstring(d1, "quirk_msg:            %s", (quirk->quirk_msg) ? quirk->quirk_msg : "");
+   rpt_vstring(d1, "sleep_multiplier:     %4.2f", quirk->sleep_multiplier);
+   rpt_vstring(d1, "unsupported_features: %s",
+                   bs256_to_string(quirk->unsupported_features, "x", " "));
+}
+
+
+void
+init_monitor_quirks() {
+   RTTI_ADD_FUNC(load_quirks_file);
+}
@@ -8,21 +8,32 @@
 
 #include "private/ddcutil_types_private.h"
 
-#include "base/monitor_quirks.h"
+#include "util/data_structures.h"
 
 typedef enum {
    MQ_NONE         = 0,
    MQ_NO_SETTING   = 1,
    MQ_NO_MFG_RANGE = 2,
    MQ_OTHER        = 4,
+   MQ_COMBINED_WRITE_READ_OK = 8,  ///< tolerates write and read in a single I2C transaction
+   MQ_SEPARATE_WRITE_READ    = 16, ///< requires separate write and read, even if combined is the default
+   MQ_UNRELIABLE_CAPABILITIES = 32, ///< capabilities string omits supported features
 } Monitor_Quirk_Type;
 
 typedef struct {
    Monitor_Quirk_Type quirk_type;
    char *             quirk_msg;
+   double             sleep_multiplier;      ///< sleep multiplier for the model, 0 if not set
+   Bit_Set_256        unsupported_features;  ///< features known to be unsupported
 } Monitor_Quirk_Data;
 
 Monitor_Quirk_Data *
 get_monitor_quirks(DDCA_Monitor_Model_Key * mmk);
 
+void
+dbgrpt_monitor_quirks(Monitor_Quirk_Data * quirk, int depth);
+
+void
+init_monitor_quirks();
+
 #endif /* MONITOR_QUIRKS_H_ */
@@ -0,0 +1,309 @@
+/** \file op_profile.c
+ *
+ *  Breakdown of the elapsed time of high level DDC operations into
+ *  sleeps, I2C calls, lock waits and CPU time.
+ *
+ *  The process wide totals in execution_stats.c and sleep.c show where
+ *  time is spent overall, but not which operation on which display it is
+ *  spent on.  Here, each getvcp, setvcp, capabilities read, table read,
+ *  and detection check of a display is profiled on the thread performing
+ *  it.  The functions that sleep, perform I/O, wait for the display lock,
+ *  or retry add their elapsed time to the thread's current operation, if
+ *  any.  The time not otherwise attributed is CPU time, i.e. packet
+ *  construction and parsing, tracing, etc.
+ *
+ *  The time of tries that were retried is reported separately.  It
+ *  overlaps the other components, and indicates how much would be saved
+ *  if the first try succeeded.
+ *
+ *  Totals are accumulated by display and operation type when each
+ *  operation completes.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/report_util.h"
+#include "util/timestamp.h"
+
+#include "base/op_profile.h"
+
+static GPrivate op_profile_key;       // Op_Profile * of current thread's operation
+
+static const char * op_profile_type_names[] = {
+      "getvcp",
+      "setvcp",
+      "capabilities",
+      "table read",
+      "detection",
+};
+
+static const char * op_profile_component_names[] = {
+      "tuned_sleep",
+      "deferred_sleep",
+      "i2c_write",
+      "i2c_read",
+      "i2c_write_read",
+      "other_io",
+      "lock_wait",
+};
+
+#define OP_PROFILE_TOTALS_MARKER "OPPT"
+typedef struct {
+   uint64_t     op_ct;
+   uint64_t     wall_nanos;
+   uint64_t     component_nanos[OP_PROFILE_COMPONENT_CT];
+   uint64_t     retry_nanos;
+   uint64_t     retry_ct;
+} Op_Profile_Totals;
+
+typedef struct {
+   char              marker[4];
+   DDCA_IO_Path      io_path;
+   char              model[DDCA_EDID_MODEL_NAME_FIELD_SIZE];
+   Op_Profile_Totals totals[OP_PROFILE_TYPE_CT];
+} Display_Op_Profiles;
+
+static GPtrArray * display_op_profiles;     // protected by op_profile_mutex
+static GMutex      op_profile_mutex;
+
+
+/** Starts profiling an operation on the current thread.
+ *
+ *  If an operation is already being profiled the new one is not,
+ *  and its time is attributed to the existing operation.
+ *
+ *  \param  prof  context, which must remain valid until #op_profile_end()
+ *  \param  type  operation type
+ *  \param  dref  display on which the operation is performed
+ */
+void op_profile_begin(Op_Profile * prof, Op_Profile_Type type, Display_Ref * dref) {
+   assert(type >= 0 && type < OP_PROFILE_TYPE_CT);
+   memset(prof, 0, sizeof(Op_Profile));
+   if (g_private_get(&op_profile_key))
+      return;
+   prof->active      = true;
+   prof->type        = type;
+   prof->dref        = dref;
+   prof->start_nanos = cur_monotonic_nanosec();
+   g_private_set(&op_profile_key, prof);
+}
+
+
+// Must be called with op_profile_mutex held
+static Display_Op_Profiles *
+get_display_op_profiles(Display_Ref * dref) {
+   if (!display_op_profiles)
+      display_op_profiles = g_ptr_array_new();
+   Display_Op_Profiles * result = NULL;
+   for (int ndx = 0; ndx < display_op_profiles->len; ndx++) {
+      Display_Op_Profiles * cur = g_ptr_array_index(display_op_profiles, ndx);
+      assert(memcmp(cur->marker, OP_PROFILE_TOTALS_MARKER, 4) == 0);
+      if (dpath_eq(cur->io_path, dref->io_path)) {
+         result = cur;
+         break;
+      }
+   }
+   if (!result) {
+      result = g_new0(Display_Op_Profiles, 1);
+      memcpy(result->marker, OP_PROFILE_TOTALS_MARKER, 4);
+      result->io_path = dref->io_path;
+      g_ptr_array_add(display_op_profiles, result);
+   }
+   if (!result->model[0] && dref->pedid)
+      g_strlcpy(result->model, dref->pedid->model_name, sizeof(result->model));
+   return result;
+}
+
+
+/** Ends profiling an operation, adding its times to the totals for its
+ *  display and type.  Invoked automatically for a context declared by
+ *  #OP_PROFILE().
+ *
+ *  \param  prof  context passed to #op_profile_begin()
+ */
+void op_profile_end(Op_Profile * prof) {
+   if (!prof->active)
+      return;
+   uint64_t wall_nanos = cur_monotonic_nanosec() - prof->start_nanos;
+   g_private_set(&op_profile_key, NULL);
+   prof->active = false;
+
+   g_mutex_lock(&op_profile_mutex);
+   Op_Profile_Totals * totals = &get_display_op_profiles(prof->dref)->totals[prof->type];
+   totals->op_ct++;
+   totals->wall_nanos += wall_nanos;
+   for (int ndx = 0; ndx < OP_PROFILE_COMPONENT_CT; ndx++)
+      totals->component_nanos[ndx] += prof->component_nanos[ndx];
+   totals->retry_nanos += prof->retry_nanos;
+   totals->retry_ct    += prof->retry_ct;
+   g_mutex_unlock(&op_profile_mutex);
+}
+
+
+/** Adds time to a component of the current thread's operation, if any.
+ *
+ *  \param  component  component
+ *  \param  nanos      elapsed time
+ */
+void op_profile_add(Op_Profile_Component component, uint64_t nanos) {
+   Op_Profile * prof = g_private_get(&op_profile_key);
+   if (prof)
+      prof->component_nanos[component] += nanos;
+}
+
+
+/** Adds the time of an I/O call to the current thread's operation, if any.
+ *
+ *  \param  event_type  I/O event type
+ *  \param  nanos       elapsed time
+ */
+void op_profile_add_io(IO_Event_Type event_type, uint64_t nanos) {
+   Op_Profile * prof = g_private_get(&op_profile_key);
+   if (prof) {
+      Op_Profile_Component component;
+      switch(event_type) {
+      case IE_WRITE:
+      case IE_IOCTL_WRITE:  component = OPC_I2C_WRITE;       break;
+      case IE_READ:
+      case IE_IOCTL_READ:   component = OPC_I2C_READ;        break;
+      case IE_WRITE_READ:   component = OPC_I2C_WRITE_READ;  break;
+      default:              component = OPC_OTHER_IO;
+      }
+      prof->component_nanos[component] += nanos;
+   }
+}
+
+
+/** Records the tries of a retry loop that were followed by another try.
+ *
+ *  \param  retry_ct  number of retries
+ *  \param  nanos     time from the start of the first try to the start of the last
+ */
+void op_profile_add_retries(int retry_ct, uint64_t nanos) {
+   Op_Profile * prof = g_private_get(&op_profile_key);
+   if (prof && retry_ct > 0) {
+      prof->retry_ct    += retry_ct;
+      prof->retry_nanos += nanos;
+   }
+}
+
+
+// Returns the unattributed time of an operation
+static uint64_t
+cpu_nanos(Op_Profile_Totals * totals) {
+   uint64_t attributed = 0;
+   for (int ndx = 0; ndx < OP_PROFILE_COMPONENT_CT; ndx++)
+      attributed += totals->component_nanos[ndx];
+   return (totals->wall_nanos > attributed) ? totals->wall_nanos - attributed : 0;
+}
+
+
+/** Discards the totals for all displays */
+void reset_op_profiles() {
+   g_mutex_lock(&op_profile_mutex);
+   int ct = (display_op_profiles) ? display_op_profiles->len : 0;
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Display_Op_Profiles * cur = g_ptr_array_index(display_op_profiles, ndx);
+      memset(cur->totals, 0, sizeof(cur->totals));
+   }
+   g_mutex_unlock(&op_profile_mutex);
+}
+
+
+static double
+pct(uint64_t part, uint64_t whole) {
+   return (whole > 0) ? 100.0 * part / whole : 0.0;
+}
+
+
+/** Reports, for each display and operation type, the elapsed time and the
+ *  percentage of it spent in each component.
+ *
+ *  \param depth logical indentation depth
+ */
+void report_op_profiles(int depth) {
+   int d1 = depth+1;
+   int d2 = depth+2;
+   rpt_title("Operation time breakdown:", depth);
+   g_mutex_lock(&op_profile_mutex);
+   int ct = (display_op_profiles) ? display_op_profiles->len : 0;
+   if (ct == 0)
+      rpt_vstring(d1, "No operations");
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Display_Op_Profiles * cur = g_ptr_array_index(display_op_profiles, ndx);
+      rpt_vstring(d1, "%s %s", dpath_repr_t(&cur->io_path), cur->model);
+      rpt_vstring(d2, "%-12s %6s %10s  %6s %6s %6s %6s %6s %6s %6s %6s  %10s",
+                      "Operation", "Count", "Total (ms)",
+                      "Sleep", "Defer", "Write", "Read", "Wr/Rd", "Oth IO", "Lock", "CPU",
+                      "Retries");
+      for (int otype = 0; otype < OP_PROFILE_TYPE_CT; otype++) {
+         Op_Profile_Totals * t = &cur->totals[otype];
+         if (t->op_ct == 0)
+            continue;
+         uint64_t w = t->wall_nanos;
+         rpt_vstring(d2, "%-12s %6"PRIu64" %10.1f  %5.1f%% %5.1f%% %5.1f%% %5.1f%% %5.1f%% %5.1f%% %5.1f%% %5.1f%%  %4"PRIu64" %4.1f%%",
+                         op_profile_type_names[otype], t->op_ct, w / 1e6,
+                         pct(t->component_nanos[OPC_TUNED_SLEEP],    w),
+                         pct(t->component_nanos[OPC_DEFERRED_SLEEP], w),
+                         pct(t->component_nanos[OPC_I2C_WRITE],      w),
+                         pct(t->component_nanos[OPC_I2C_READ],       w),
+                         pct(t->component_nanos[OPC_I2C_WRITE_READ], w),
+                         pct(t->component_nanos[OPC_OTHER_IO],       w),
+                         pct(t->component_nanos[OPC_LOCK_WAIT],      w),
+                         pct(cpu_nanos(t), w),
+                         t->retry_ct, pct(t->retry_nanos, w));
+      }
+   }
+   g_mutex_unlock(&op_profile_mutex);
+}
+
+
+/** Exports the elapsed time of each component, by display and operation type.
+ *
+ *  \param exp  export instance
+ */
+void export_op_profiles(Stats_Export * exp) {
+   stats_export_metric(exp, "ddcutil_operations_total", STATS_METRIC_COUNTER,
+                            "Number of high level operations, by display and operation");
+   stats_export_metric(exp, "ddcutil_operation_seconds_total", STATS_METRIC_COUNTER,
+                            "Elapsed time of high level operations, by display, operation and component");
+   stats_export_metric(exp, "ddcutil_operation_retries_total", STATS_METRIC_COUNTER,
+                            "Number of retries within high level operations, by display and operation");
+   stats_export_metric(exp, "ddcutil_operation_retry_seconds_total", STATS_METRIC_COUNTER,
+                            "Time spent in tries that were retried, by display and operation");
+   g_mutex_lock(&op_profile_mutex);
+   int ct = (display_op_profiles) ? display_op_profiles->len : 0;
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Display_Op_Profiles * cur = g_ptr_array_index(display_op_profiles, ndx);
+      char * display = g_strdup(dpath_repr_t(&cur->io_path));
+      for (int otype = 0; otype < OP_PROFILE_TYPE_CT; otype++) {
+         Op_Profile_Totals * t = &cur->totals[otype];
+         if (t->op_ct == 0)
+            continue;
+         const char * op = op_profile_type_names[otype];
+         stats_export_sample(exp, "ddcutil_operations_total", t->op_ct,
+                                  2, "display", display, "operation", op);
+         stats_export_sample(exp, "ddcutil_operation_seconds_total", t->wall_nanos / 1e9,
+                                  3, "display", display, "operation", op, "component", "total");
+         for (int cndx = 0; cndx < OP_PROFILE_COMPONENT_CT; cndx++)
+            stats_export_sample(exp, "ddcutil_operation_seconds_total", t->component_nanos[cndx] / 1e9,
+                                     3, "display", display, "operation", op,
+                                        "component", op_profile_component_names[cndx]);
+         stats_export_sample(exp, "ddcutil_operation_seconds_total", cpu_nanos(t) / 1e9,
+                                  3, "display", display, "operation", op, "component", "cpu");
+         stats_export_sample(exp, "ddcutil_operation_retries_total", t->retry_ct,
+                                  2, "display", display, "operation", op);
+         stats_export_sample(exp, "ddcutil_operation_retry_seconds_total", t->retry_nanos / 1e9,
+                                  2, "display", display, "operation", op);
+      }
+      g_free(display);
+   }
+   g_mutex_unlock(&op_profile_mutex);
+}
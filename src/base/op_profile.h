@@ -0,0 +1,79 @@
+/** \file op_profile.h
+ *
+ *  Breakdown of the elapsed time of high level DDC operations into
+ *  sleeps, I2C calls, lock waits and CPU time.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef OP_PROFILE_H_
+#define OP_PROFILE_H_
+
+/** \cond */
+#include <inttypes.h>
+#include <stdbool.h>
+/** \endcond */
+
+#include "base/displays.h"
+#include "base/execution_stats.h"
+#include "base/stats_export.h"
+
+/** High level operations whose time is broken down */
+typedef enum {
+   OPT_GETVCP,             ///< get non-table VCP feature value
+   OPT_SETVCP,             ///< set VCP feature value, including verification
+   OPT_CAPABILITIES,       ///< read capabilities string
+   OPT_TABLE_READ,         ///< get table VCP feature value
+   OPT_DETECTION,          ///< initial checks of a display during detection
+} Op_Profile_Type;
+#define OP_PROFILE_TYPE_CT (OPT_DETECTION+1)
+
+/** Mutually exclusive components of an operation's elapsed time.
+ *  The time not attributed to any of them is reported as CPU time.
+ */
+typedef enum {
+   OPC_TUNED_SLEEP,        ///< sleeps required by the DDC/CI protocol
+   OPC_DEFERRED_SLEEP,     ///< waits for a deferred sleep to expire
+   OPC_I2C_WRITE,          ///< write() and ioctl() writes
+   OPC_I2C_READ,           ///< read() and ioctl() reads
+   OPC_I2C_WRITE_READ,     ///< combined ioctl() write and read
+   OPC_OTHER_IO,           ///< open(), close() and other I/O calls
+   OPC_LOCK_WAIT,          ///< waiting for the display lock
+} Op_Profile_Component;
+#define OP_PROFILE_COMPONENT_CT (OPC_LOCK_WAIT+1)
+
+/** Context of an operation being profiled, normally declared by #OP_PROFILE() */
+typedef struct {
+   bool             active;                ///< false if nested in another operation
+   Op_Profile_Type  type;
+   Display_Ref *    dref;
+   uint64_t         start_nanos;
+   uint64_t         component_nanos[OP_PROFILE_COMPONENT_CT];
+   uint64_t         retry_nanos;           ///< time spent in tries that were retried
+   int              retry_ct;
+} Op_Profile;
+
+void   op_profile_begin(Op_Profile * prof, Op_Profile_Type type, Display_Ref * dref);
+void   op_profile_end(Op_Profile * prof);
+void   op_profile_add(Op_Profile_Component component, uint64_t nanos);
+void   op_profile_add_io(IO_Event_Type event_type, uint64_t nanos);
+void   op_profile_add_retries(int retry_ct, uint64_t nanos);
+
+/** Profiles the remainder of the enclosing block as an operation of the
+ *  given type on a display.
+ *
+ *  Must precede any statement that jumps forward past it.  The profile
+ *  ends when the block is exited, on whatever path.  An operation started
+ *  while another is being profiled on the same thread is attributed to
+ *  the outer operation, e.g. the getvcp calls performed during detection.
+ */
+#define OP_PROFILE(_type, _dref) \
+   __attribute__((cleanup(op_profile_end))) Op_Profile op_profile_ctx; \
+   op_profile_begin(&op_profile_ctx, (_type), (_dref))
+
+void   reset_op_profiles();
+void   report_op_profiles(int depth);
+void   export_op_profiles(Stats_Export * exp);
+
+#endif /* OP_PROFILE_H_ */
@@ -33,6 +33,8 @@
 #define DDC_TIMEOUT_USE_DEFAULT                      -1  ///< Use the default timeout
 #define DDC_TIMEOUT_NONE                              0  ///< No timeout
 #define DDC_TIMEOUT_MILLIS_NULL_RESPONSE_INCREMENT  100  ///< Used for dynamic tuned sleep in case of DDC Null Message response
+#define DDC_NULL_RESPONSE_BACKOFF_MIN_MILLIS         20  ///< Initial per display delay before retrying a DDC Null Message
+#define DDC_NULL_RESPONSE_BACKOFF_MAX_MILLIS        320  ///< Maximum per display delay before retrying a DDC Null Message
 
 
 //
@@ -40,11 +42,15 @@
 //
 
 #define DEFAULT_I2C_READ_BYTEWISE      false                   ///< Use single byte reads
+#define DEFAULT_I2C_COMBINED_WRITE_READ false   ///< single ioctl for write and read, all monitors
+#define DEFAULT_I2C_AUTO_WRITE_READ     false   ///< probe each bus for the faster write/read mode
 #define DEFAULT_EDID_WRITE_BEFORE_READ true
 #define DEFAULT_EDID_READ_SIZE           0                     ///< 128, 256, 0=>dynamic
 #define EDID_BUFFER_SIZE               256                     ///< always 256
 
 #define DEFAULT_EDID_READ_BYTEWISE        false
+#define DEFAULT_EDID_READ_USES_SYSFS      false   ///< take EDID from /sys/class/drm when possible
+#define DEFAULT_FD_POOL_IDLE_MILLISEC     0       ///< keep fd of closed display open, 0 = disabled
 
 // Strategy    Bytewise    read edid uses local i2c call                      read edid uses i2c layer
 // FILEIO      false       ok                                                 ok
@@ -76,6 +82,12 @@
 /** Maximum number of values on setvcp command */
 #define MAX_SETVCP_VALUES    50
 
+/** Maximum number of files on loadvcp command */
+#define MAX_LOADVCP_FILES    16
+
+/** Maximum number of sleep multipliers on benchmark command */
+#define MAX_BENCH_MULTIPLIERS 8
+
 /** Maximum command arguments */
 // #define MAX_ARGS (MAX_SETVCP_VALUES*2)   // causes CMDID_* undefined
 #define MAX_ARGS 100        // hack
@@ -85,6 +97,15 @@
 #define DISPLAY_CHECK_ASYNC_NEVER    0xff
 #define DISPLAY_CHECK_ASYNC_THRESHOLD_STANDARD  3
 #define DISPLAY_CHECK_ASYNC_THRESHOLD_DEFAULT   DISPLAY_CHECK_ASYNC_NEVER
+/** Number of worker threads shared by display checks, bus probing and capabilities prefetch */
+#define EXECUTOR_WORKER_COUNT_DEFAULT           4
+
+/** Parallelize I2C bus probing during detection if at least this number of buses */
+#define BUS_CHECK_ASYNC_NEVER                   0xff
+#define BUS_CHECK_ASYNC_THRESHOLD_STANDARD      4
+#define BUS_CHECK_ASYNC_THRESHOLD_DEFAULT       BUS_CHECK_ASYNC_NEVER
+/** Time allowed for probing a single I2C bus during detection, 0 = no limit */
+#define I2C_BUS_CHECK_TIMEOUT_MILLIS         2000
 
 #define DEFAULT_SLEEP_LESS true
 
@@ -95,7 +116,81 @@
 #endif
 
 #define DEFAULT_ENABLE_CACHED_CAPABILITIES true
+#define DEFAULT_ENABLE_CACHED_DISPLAYS     false
 #define DEFAULT_ENABLE_UDF true
 
+/** How long a cached value of a read/write feature is used */
+#define DEFAULT_VCP_VALUE_CACHE_TTL_MILLISEC     2000
+/** How long a cached value of a read only feature that can change is used */
+#define DEFAULT_VCP_VALUE_CACHE_RO_TTL_MILLISEC   500
+
+/** Factor applied to sleep times when first probing features for getvcp scan */
+#define DDC_SCAN_PROBE_SLEEP_MULTIPLIER          0.5
+
+/** Maximum DDC transactions per second on a bus, 0 = no limit */
+#define DEFAULT_MAX_DDC_TRANSACTION_RATE           0
+
+/** Maximum simultaneous DDC transactions on buses sharing a physical adapter, 0 = no limit */
+#define DEFAULT_MAX_ADAPTER_CONCURRENCY            0
+
+/** Display health score, see display_health.c */
+#define DISPLAY_HEALTH_LATENCY_GOOD_MILLIS       100  ///< p95 write/read latency without penalty
+#define DISPLAY_HEALTH_LATENCY_BAD_MILLIS       1000  ///< p95 write/read latency with maximum penalty
+#define DISPLAY_HEALTH_SLEEP_FACTOR_BAD          4.0  ///< sleep factor with maximum penalty
+#define DISPLAY_HEALTH_UNHEALTHY_SCORE            50  ///< background polling is deferred below this score
+#define DISPLAY_HEALTH_BACKGROUND_INTERVAL_MILLIS  1000  ///< minimum interval between background transactions on an unhealthy display
+
+/** Dynamic sleep adjustment, see dynamic_sleep.c */
+#define DSA_ERROR_RATE_WEIGHT                    0.1  ///< weight of newest status code in error rate
+#define DSA_ERROR_RATE_THRESHOLD                 0.1  ///< error rate above which sleep is lengthened
+#define DSA_MIN_SAMPLE_CT                          8  ///< status codes needed after a change before acting
+#define DSA_INCREASE_STEP                        1.5  ///< factor by which sleep is lengthened
+#define DSA_PROBE_STEP                           0.8  ///< factor by which sleep is tentatively shortened
+#define DSA_PROBE_SAMPLE_CT                       16  ///< error free status codes that confirm a probe
+#define DSA_PROBE_INTERVAL_MIN                    32  ///< good status codes before the first probe
+#define DSA_PROBE_INTERVAL_MAX                  1024  ///< limit of the interval after failed probes
+#define DSA_TARGET_SLEEP_FRACTION                0.1  ///< fraction of spec sleep time probes aim for
+#define DSA_MAX_SLEEP_FRACTION                   3.0  ///< longest sleep, as fraction of spec sleep time
+
+/** Quiet interval before a debounced Save Current Settings is sent, 0 = not debounced */
+#define DEFAULT_SAVE_SETTINGS_DEBOUNCE_MILLISEC    0
+
+/** Skip DDC transactions with displays known to be in a power saving state */
+#define DEFAULT_ENABLE_POWER_STATE_TRACKING      true
+/** How long a power saving mode reported by feature xD6 suppresses transactions */
+#define DDC_POWER_SAVING_BACKOFF_MILLISEC       10000
+
+/** Settle windows that hold transactions after writes that disrupt DDC, see ddc_settle_window.c */
+#define SETTLE_WINDOW_MIN_MILLIS                 50  ///< shorter learned windows are dropped
+#define SETTLE_WINDOW_MAX_MILLIS               5000  ///< longest learned window
+#define SETTLE_WINDOW_MARGIN                   1.25  ///< factor applied to the observed recovery time
+#define SETTLE_WINDOW_SHRINK_FACTOR             0.9  ///< factor applied after a first try success
+
+/** Adaptive verification of writes, see ddc_adaptive_verify.c */
+#define ADAPTIVE_VERIFY_CONFIDENT_STREAK         10  ///< consecutive passes after which writes are sampled
+#define ADAPTIVE_VERIFY_SAMPLE_INTERVAL           8  ///< once confident, every this many writes is verified
+
+/** Poll interval limits when watching displays for VCP feature changes */
+#define VCP_CHANGE_WATCH_MIN_INTERVAL_MILLISEC   500
+#define VCP_CHANGE_WATCH_MAX_INTERVAL_MILLISEC  8000
+
+/** Retries performed by the kernel for I2C transfers that fail with EAGAIN, 0 = adapter default */
+#define DEFAULT_I2C_KERNEL_RETRIES                 0
+
+/** Interval at which a ddcutil server checks displays for changes of published features */
+#define SERVER_POLL_INTERVAL_MILLISEC           1000
+/** Every this many polls the published features are reread, even if no change is reported */
+#define SERVER_POLL_FULL_READ_CT                  10
+
+/** Record binary trace events, see trace_ring.c */
+#define DEFAULT_ENABLE_TRACE_RING                false
+/** Number of trace events retained per thread */
+#define TRACE_RING_EVENT_CT                      1024
+
+/** Interval at which queued trace messages are written, see trace_writer.c */
+#define TRACE_WRITER_INTERVAL_MILLIS               10
+/** Queued trace messages beyond which messages are written synchronously */
+#define TRACE_WRITER_MAX_PENDING               100000
+
 
 #endif /* PARMS_H_ */
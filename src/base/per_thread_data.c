@@ -11,13 +11,16 @@
 #include <string.h>
 #include <sys/types.h>
 
+#include "util/alloc_stats.h"
 #include "util/debug_util.h"
 #include "util/glib_util.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/timestamp.h"
 
 #include "base/core.h"
 #include "base/displays.h"
+#include "base/lock_stats.h"
 #include "base/parms.h"
 #include "base/sleep.h"
 #include "base/thread_retry_data.h"    // temp circular
@@ -27,6 +30,8 @@
 
 // Master table of sleep data for all threads
 GHashTable *    per_thread_data_hash = NULL;
+static GRecMutex per_thread_data_hash_mutex;   // guards insertion and iteration
+static GPrivate  this_thread_ptd;              // cached pointer, owned by per_thread_data_hash
 static GPrivate this_thread_has_lock;
 static GPrivate lock_depth; // GINT_TO_POINTER(0);
 static bool     debug_mutex = false;
@@ -42,6 +47,8 @@ void dbgrpt_per_thread_data_locks(int depth) {
 
 static bool    cross_thread_operation_active = false;
 static GMutex  cross_thread_operation_mutex;
+static Lock_Stats cross_thread_operation_lock_stats = {.lock_name = "ptd_cross_thread_operation"};
+static Lock_Stats cross_thread_block_lock_stats     = {.lock_name = "ptd_cross_thread_block"};
 static pid_t   cross_thread_operation_owner;
 
 // The locking strategy relies on the fact that in practice conflicts
@@ -79,7 +86,7 @@ bool ptd_cross_thread_operation_start() {
    if (thread_lock_depth == 0) {    // (A)
    // if (!thread_has_lock) {
       // thread_lock_depth is per-thread, so must be unchanged from (A)
-      g_mutex_lock(&cross_thread_operation_mutex);
+      lock_stats_mutex_lock(&cross_thread_operation_mutex, &cross_thread_operation_lock_stats);
       lock_performed = true;
       cross_thread_operation_active = true;
 
@@ -131,9 +138,15 @@ void ptd_cross_thread_operation_block() {
    intmax_t cur_threadid = thread_settings->tid;
    if (cross_thread_operation_active && cur_threadid != cross_thread_operation_owner) {
       __sync_fetch_and_add(&cross_thread_operation_blocked_count, 1);
+      uint64_t start = (lock_stats_enabled) ? cur_monotonic_nanosec() : 0;
       do {
          sleep_millis(10);
       } while (cross_thread_operation_active);
+      if (lock_stats_enabled)
+         record_lock_acquisition(&cross_thread_block_lock_stats, true, cur_monotonic_nanosec() - start);
+   }
+   else if (lock_stats_enabled) {
+      record_lock_acquisition(&cross_thread_block_lock_stats, false, 0);
    }
 }
 
@@ -144,7 +157,7 @@ void per_thread_data_destroy(void * data) {
    if (data) {
       Per_Thread_Data * ptd = data;
       free(ptd->description);
-      free(ptd);
+      counted_free(ALLOC_THREAD_DATA, ptd, sizeof(Per_Thread_Data));
    }
 }
 
@@ -181,9 +194,17 @@ static void init_per_thread_data(Per_Thread_Data * ptd) {
  *  to a block on the heap because the of a problems when the thread is closed.
  *  Valgrind complains of access errors for closed threads, even though the
  *  struct is on the heap and still readable.
+ *  @remark
+ *  After the first call on a thread the pointer is cached in a thread-local
+ *  variable, so the hash table is only consulted once per thread.  The table
+ *  remains the owner of the struct and is what reports iterate over.
  */
 Per_Thread_Data * ptd_get_per_thread_data() {
    bool debug = false;
+   Per_Thread_Data * cached = g_private_get(&this_thread_ptd);
+   if (cached)
+      return cached;
+
    // intmax_t cur_thread_id = get_thread_id();
    Thread_Output_Settings * thread_settings = get_thread_settings();
    intmax_t cur_thread_id = thread_settings->tid;
@@ -192,12 +213,13 @@ Per_Thread_Data * ptd_get_per_thread_data() {
    assert(per_thread_data_hash);    // allocated by init_thread_data_module()
    // DBGMSG("per_thread_data_hash = %p", per_thread_data_hash);
    // n. data hash for current thread can only be looked up from current thread,
-   // so there's nothing can happen to per_thread_data_hash before g_hash_table_insert()
+   // but other threads may be inserting their own entries or iterating
+   g_rec_mutex_lock(&per_thread_data_hash_mutex);
    Per_Thread_Data * data = g_hash_table_lookup(per_thread_data_hash,
                                             GINT_TO_POINTER(cur_thread_id));
    if (!data) {
       DBGMSF(debug, "==> Per_Thread_Data not found for thread %d", cur_thread_id);
-      data = g_new0(Per_Thread_Data, 1);
+      data = counted_calloc(ALLOC_THREAD_DATA, sizeof(Per_Thread_Data));
       data->thread_id = cur_thread_id;
       g_private_set(&lock_depth, GINT_TO_POINTER(0));
       init_per_thread_data(data);
@@ -213,6 +235,8 @@ Per_Thread_Data * ptd_get_per_thread_data() {
       // if (debug)
       //   dbgrpt_per_thread_data(data, 1);
    }
+   g_rec_mutex_unlock(&per_thread_data_hash_mutex);
+   g_private_set(&this_thread_ptd, data);
    // ptd_unlock_if_needed(this_function_owns_lock);
    return data;
 }
@@ -297,24 +321,8 @@ void dbgrpt_per_thread_data(Per_Thread_Data * data, int depth) {
    rpt_vstring(d1, "sleep_multiplier_changer_ct:      %15d",   data->sleep_multipler_changer_ct);
    rpt_vstring(d1, "highest_sleep_multiplier_ct:      %15d",   data->highest_sleep_multiplier_value);
 
-   rpt_vstring(d1,"cur_dh:                 %s", dh_repr(data->cur_dh) );
-
    // Dynamic sleep adjustment:
    rpt_bool("dynamic_sleep_enabled",      NULL, data->dynamic_sleep_enabled,     d1);
-   rpt_int("cur_ok_status_count",         NULL, data->cur_ok_status_count,       d1);
-   rpt_int("cur_error_status_count",      NULL, data->cur_error_status_count,    d1);
-   rpt_int("total_ok_status_count",       NULL, data->total_ok_status_count,     d1);
-   rpt_int("total_error",                 NULL, data->total_error_status_count,  d1);
-   rpt_int("other_status_ct",             NULL, data->total_other_status_ct,     d1);
-
-   rpt_int("calls_since_last_check",      NULL, data->calls_since_last_check,    d1);
-   rpt_int("total_adjustment_checks",     NULL, data->total_adjustment_checks,   d1);
-   rpt_int("adjustment_ct",               NULL, data->total_adjustment_ct,       d1);
-// rpt_int("max_adjustment_ct",           NULL, data->total_max_adjustment_ct,   d1);
-// rpt_int("non_adjustment_ct",           NULL, data->total_non_adjustment_ct,   d1);
-
-   rpt_vstring(d1, "cur_sleep_adjustmet_factor     %15.2f", data->cur_sleep_adjustment_factor);
-// rpt_vstring(d1, "thread_adjustment_increment        %15.2f", data->thread_adjustment_increment);
 
    // Maxtries history
    rpt_bool("retry data initialized"    , NULL, data->thread_retry_data_defined, d1);
@@ -353,6 +361,7 @@ void ptd_apply_all(Ptd_Func func, void * arg) {
    bool debug = false;
    assert(per_thread_data_hash);    // allocated by init_thread_data_module()
 
+   g_rec_mutex_lock(&per_thread_data_hash_mutex);
       GHashTableIter iter;
       gpointer key, value;
       g_hash_table_iter_init (&iter,per_thread_data_hash);
@@ -361,6 +370,7 @@ void ptd_apply_all(Ptd_Func func, void * arg) {
          DBGMSF(debug, "Thread id: %d", data->thread_id);
          func(data, arg);
       }
+   g_rec_mutex_unlock(&per_thread_data_hash_mutex);
 
    ptd_cross_thread_operation_end();
 }
@@ -380,6 +390,7 @@ void ptd_apply_all_sorted(Ptd_Func func, void * arg) {
    ptd_cross_thread_operation_start();
    assert(per_thread_data_hash);
 
+   g_rec_mutex_lock(&per_thread_data_hash_mutex);
    DBGMSF(debug, "hash table size = %d", g_hash_table_size(per_thread_data_hash));
    GList * keys = g_hash_table_get_keys (per_thread_data_hash);
    GList * new_head = g_list_sort(keys, gaux_ptr_intcomp);
@@ -393,6 +404,7 @@ void ptd_apply_all_sorted(Ptd_Func func, void * arg) {
       func(data, arg);
    }
    g_list_free(new_head);   // would keys also work?
+   g_rec_mutex_unlock(&per_thread_data_hash_mutex);
 
    ptd_cross_thread_operation_end();
    DBGMSF(debug, "Done");
@@ -21,7 +21,6 @@
 #include "base/displays.h"
 
 extern GHashTable *  per_thread_data_hash;
-extern GMutex        per_thread_data_mutex;    // temp, replace by function calls
 
 void init_thread_data_module();     // module initialization
 void release_thread_data_module();  // release all resources
@@ -60,25 +59,8 @@ typedef struct {
    int    sleep_multipler_changer_ct;      // number of function calls that adjusted multiplier ct
 
    // For Dynamic Sleep Adjustment
+   // n. adjustment state is maintained per display, see dynamic_sleep.h
    bool   dynamic_sleep_enabled;
-   int    cur_ok_status_count;
-   int    cur_error_status_count;
-   int    total_ok_status_count;
-   int    total_error_status_count;
-   int    total_other_status_ct;
-   int    calls_since_last_check;
-   int    adjustment_check_interval;
-   int    total_adjustment_checks;
-   int    total_adjustment_ct;
-// int    total_non_adjustment_ct;
-// int    total_max_adjustment_ct;
-// int    spec_sleep_time_millis;
-
-   Display_Handle * cur_dh;
-// double cur_sleep_time_millis;
-// double cur_sleep_multiplier_factor;
-   double cur_sleep_adjustment_factor;
-// double thread_adjustment_increment;
 
 // #ifdef UNUSED
    // Retry management
@@ -0,0 +1,480 @@
+/** @file persistent_store.c
+ *
+ *  Single file store for data learned about monitors.
+ *
+ *  Records are typed, e.g. #PSTORE_VCP_VERSION, and keyed by a string that the
+ *  caller derives from the monitor model key or EDID.  Values are strings whose
+ *  format is private to the caller.  The file is read once per process, the
+ *  first time any record is requested, instead of once per type of data.
+ *
+ *  The file is line oriented text:
+ *  - the first line identifies the file format version.  A file with any other
+ *    first line is ignored, and is replaced when a record is next saved.
+ *  - each subsequent line has the form
+ *    <record type> TAB <key> TAB <time last set> TAB <value>
+ *
+ *  Updates are made under an exclusive lock on a companion lock file. The data
+ *  file is reread, so that records saved by concurrent processes are kept, the
+ *  change is applied, and a new file is written and renamed into place.  Readers
+ *  therefore never see a partially written file and need not lock.
+ *
+ *  The number of records is bounded.  When the limit is exceeded, the records
+ *  that were least recently set are discarded.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+/** \endcond */
+
+#include "util/file_util.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/xdg_util.h"
+
+#include "base/core.h"
+#include "base/rtti.h"
+
+#include "base/persistent_store.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_BASE;
+
+#define PSTORE_VERSION_LINE  "# ddcutil monitor data, version 1"
+#define PSTORE_MAX_RECORDS   500
+
+typedef struct {
+   char *   value;
+   uint64_t timestamp;      // time record was last set, seconds since the epoch
+} Pstore_Record;
+
+// Keyed by "<record type>\t<key>", protected by pstore_mutex
+static GHashTable * pstore_records = NULL;
+static GMutex       pstore_mutex;
+
+
+static void free_pstore_record(gpointer data) {
+   Pstore_Record * rec = data;
+   free(rec->value);
+   free(rec);
+}
+
+
+static GHashTable * new_pstore_table() {
+   return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_pstore_record);
+}
+
+
+/** Returns the name of the file that stores learned monitor data.
+ *
+ *  \return name of file, normally $HOME/.cache/ddcutil/monitor_data
+ */
+/* caller is responsible for freeing returned value */
+char * get_persistent_store_file_name() {
+   return xdg_cache_home_file("ddcutil", "monitor_data");
+}
+
+
+static bool valid_pstore_field(const char * s) {
+   return s && !strpbrk(s, "\t\n");
+}
+
+
+// Parses the contents of the store file in place.  Invalid lines are skipped.
+static GHashTable * parse_pstore_data(const char * data, size_t size) {
+   bool debug = false;
+   GHashTable * records = new_pstore_table();
+   size_t hdrlen = strlen(PSTORE_VERSION_LINE);
+   if (size <= hdrlen || memcmp(data, PSTORE_VERSION_LINE, hdrlen) != 0 || data[hdrlen] != '\n') {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Missing or unrecognized version line");
+      return records;
+   }
+
+   const char * end = data + size;
+   const char * line = data + hdrlen + 1;
+   const char * eol;
+   int linectr = 1;
+   // n. a final line without newline is incomplete and ignored
+   while (line < end && (eol = memchr(line, '\n', end-line)) ) {
+      linectr++;
+      const char * tab1 = memchr(line, '\t', eol-line);
+      const char * tab2 = (tab1) ? memchr(tab1+1, '\t', eol-(tab1+1)) : NULL;
+      const char * tab3 = (tab2) ? memchr(tab2+1, '\t', eol-(tab2+1)) : NULL;
+      char tsbuf[24];
+      if (tab3 && tab1 > line && tab2 > tab1+1 && tab3-(tab2+1) < sizeof(tsbuf)) {
+         memcpy(tsbuf, tab2+1, tab3-(tab2+1));
+         tsbuf[tab3-(tab2+1)] = '\0';
+         Pstore_Record * rec = calloc(1, sizeof(Pstore_Record));
+         rec->timestamp = g_ascii_strtoull(tsbuf, NULL, 10);
+         rec->value = strndup(tab3+1, eol-(tab3+1));
+         // the compound key is the start of the line, up to the second tab
+         g_hash_table_replace(records, g_strndup(line, tab2-line), rec);
+      }
+      else {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Invalid line %d", linectr);
+      }
+      line = eol+1;
+   }
+   return records;
+}
+
+
+// Reads the store file.  A missing file yields an empty table.
+static GHashTable * read_pstore_file(const char * fn) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn=%s", fn);
+
+   GHashTable * records = NULL;
+   int fd = open(fn, O_RDONLY|O_CLOEXEC);
+   if (fd >= 0) {
+      struct stat statbuf;
+      if (fstat(fd, &statbuf) == 0 && statbuf.st_size > 0) {
+         char * data = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (data != MAP_FAILED) {
+            records = parse_pstore_data(data, statbuf.st_size);
+            munmap(data, statbuf.st_size);
+         }
+      }
+      close(fd);
+   }
+   else {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Error opening file: %s", strerror(errno));
+   }
+   if (!records)
+      records = new_pstore_table();
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning table with %d records", g_hash_table_size(records));
+   return records;
+}
+
+
+static gint compare_record_timestamps(gconstpointer a, gconstpointer b) {
+   uint64_t ts_a = ((Pstore_Record *) g_hash_table_lookup(pstore_records, *(char **) a))->timestamp;
+   uint64_t ts_b = ((Pstore_Record *) g_hash_table_lookup(pstore_records, *(char **) b))->timestamp;
+   return (ts_a < ts_b) ? -1 : (ts_a > ts_b) ? 1 : 0;
+}
+
+
+// Discards the least recently set records if there are more than PSTORE_MAX_RECORDS.
+// Must be called with pstore_mutex held.
+static void evict_pstore_records() {
+   int excess = g_hash_table_size(pstore_records) - PSTORE_MAX_RECORDS;
+   if (excess > 0) {
+      GPtrArray * keys = g_ptr_array_new_with_free_func(g_free);
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, pstore_records);
+      while (g_hash_table_iter_next(&iter, &key, &value))
+         g_ptr_array_add(keys, g_strdup(key));
+      g_ptr_array_sort(keys, compare_record_timestamps);
+      for (int ndx = 0; ndx < excess; ndx++)
+         g_hash_table_remove(pstore_records, g_ptr_array_index(keys, ndx));
+      g_ptr_array_free(keys, true);
+   }
+}
+
+
+// Writes the current table to a temporary file and renames it to fn.
+// Must be called with pstore_mutex held.
+static bool write_pstore_file(const char * fn) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn=%s", fn);
+
+   bool ok = false;
+   char * tmp_fn = g_strdup_printf("%s.%d", fn, getpid());
+   FILE * fp = NULL;
+   fopen_mkdir(tmp_fn, "w", ferr(), &fp);
+   if (fp) {
+      ok = fprintf(fp, "%s\n", PSTORE_VERSION_LINE) > 0;
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, pstore_records);
+      while (ok && g_hash_table_iter_next(&iter, &key, &value)) {
+         char * type_and_key = key;
+         Pstore_Record * rec = value;
+         char * tab = strchr(type_and_key, '\t');
+         ok = fprintf(fp, "%.*s\t%s\t%"PRIu64"\t%s\n",
+                      (int) (tab-type_and_key), type_and_key, tab+1,
+                      rec->timestamp, rec->value) > 0;
+      }
+      ok = (fclose(fp) == 0) && ok;
+      if (ok)
+         ok = rename(tmp_fn, fn) == 0;
+      if (!ok) {
+         SEVEREMSG("Error writing to file %s:%s", fn, strerror(errno) );
+         unlink(tmp_fn);
+      }
+   }
+   g_free(tmp_fn);
+
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, ok, "");
+   return ok;
+}
+
+
+// Must be called with pstore_mutex held
+static void ensure_pstore_loaded() {
+   if (!pstore_records) {
+      char * fn = get_persistent_store_file_name();
+      pstore_records = read_pstore_file(fn);
+      free(fn);
+   }
+}
+
+
+typedef enum {
+   PSTORE_UPDATE_SET,
+   PSTORE_UPDATE_DELETE_TYPE,
+   PSTORE_UPDATE_PRUNE
+} Pstore_Update_Type;
+
+
+/** Rereads the store file under an exclusive lock, applies a change,
+ *  and rewrites the file.
+ *
+ *  The in-memory table is replaced by the merged table even if the file
+ *  could not be written, so that the change is effective for this process.
+ *
+ *  Must be called with pstore_mutex held.
+ */
+static bool update_pstore_file(
+      Pstore_Update_Type update_type,
+      const char *       type_and_key,   // for PSTORE_UPDATE_SET
+      Pstore_Record *    rec,            // for PSTORE_UPDATE_SET, ownership transferred
+      const char *       record_type,    // for PSTORE_UPDATE_DELETE_TYPE
+      uint64_t           max_age_secs,   // for PSTORE_UPDATE_PRUNE
+      int *              removed_ct_loc) // for PSTORE_UPDATE_DELETE_TYPE, PSTORE_UPDATE_PRUNE
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "update_type=%d", update_type);
+
+   bool ok = false;
+   char * fn = get_persistent_store_file_name();
+   char * lock_fn = g_strdup_printf("%s.lock", fn);
+   FILE * lockfp = NULL;
+   fopen_mkdir(lock_fn, "a", ferr(), &lockfp);
+   if (lockfp)
+      flock(fileno(lockfp), LOCK_EX);
+
+   if (pstore_records)
+      g_hash_table_destroy(pstore_records);
+   pstore_records = read_pstore_file(fn);
+
+   if (update_type == PSTORE_UPDATE_SET) {
+      g_hash_table_replace(pstore_records, g_strdup(type_and_key), rec);
+      evict_pstore_records();
+   }
+   else {
+      int removed_ct = 0;
+      uint64_t now = time(NULL);
+      char * prefix = (record_type) ? g_strdup_printf("%s\t", record_type) : NULL;
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, pstore_records);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         Pstore_Record * rec = value;
+         bool remove = (update_type == PSTORE_UPDATE_DELETE_TYPE)
+                            ? str_starts_with(key, prefix)
+                            : rec->timestamp + max_age_secs < now;
+         if (remove) {
+            g_hash_table_iter_remove(&iter);
+            removed_ct++;
+         }
+      }
+      g_free(prefix);
+      if (removed_ct_loc)
+         *removed_ct_loc = removed_ct;
+   }
+
+   if (lockfp) {
+      ok = write_pstore_file(fn);
+      flock(fileno(lockfp), LOCK_UN);
+      fclose(lockfp);
+   }
+   g_free(lock_fn);
+   free(fn);
+
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, ok, "");
+   return ok;
+}
+
+
+/** Looks up a record.
+ *
+ *  \param  record_type  record type, e.g. #PSTORE_VCP_VERSION
+ *  \param  key          record key
+ *  \return copy of the record's value, caller must free, NULL if not found
+ */
+char * pstore_get(const char * record_type, const char * key) {
+   assert(record_type && key);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "record_type=%s, key=|%s|", record_type, key);
+
+   char * result = NULL;
+   char * type_and_key = g_strdup_printf("%s\t%s", record_type, key);
+   g_mutex_lock(&pstore_mutex);
+   ensure_pstore_loaded();
+   Pstore_Record * rec = g_hash_table_lookup(pstore_records, type_and_key);
+   if (rec)
+      result = strdup(rec->value);
+   g_mutex_unlock(&pstore_mutex);
+   g_free(type_and_key);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", result);
+   return result;
+}
+
+
+/** Saves a record, replacing any prior record with the same type and key,
+ *  and writes the store to the file system.
+ *
+ *  \param  record_type  record type, e.g. #PSTORE_VCP_VERSION
+ *  \param  key          record key, may not contain tabs or newlines
+ *  \param  value        record value, may not contain tabs or newlines
+ *  \return true if the record was written to the file system
+ */
+bool pstore_set(const char * record_type, const char * key, const char * value) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "record_type=%s, key=|%s|, value=|%s|",
+                                       record_type, key, value);
+   bool ok = false;
+   if (!valid_pstore_field(record_type) || !valid_pstore_field(key) || !valid_pstore_field(value)) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Invalid character in record");
+   }
+   else {
+      Pstore_Record * rec = calloc(1, sizeof(Pstore_Record));
+      rec->value = strdup(value);
+      rec->timestamp = time(NULL);
+      char * type_and_key = g_strdup_printf("%s\t%s", record_type, key);
+      g_mutex_lock(&pstore_mutex);
+      ok = update_pstore_file(PSTORE_UPDATE_SET, type_and_key, rec, NULL, 0, NULL);
+      g_mutex_unlock(&pstore_mutex);
+      g_free(type_and_key);
+   }
+
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, ok, "");
+   return ok;
+}
+
+
+/** Deletes all records of a type, both in memory and on the file system.
+ *
+ *  \param  record_type  record type, e.g. #PSTORE_VCP_VERSION
+ */
+void pstore_delete_records(const char * record_type) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "record_type=%s", record_type);
+
+   char * fn = get_persistent_store_file_name();
+   bool file_exists = regular_file_exists(fn);
+   free(fn);
+
+   g_mutex_lock(&pstore_mutex);
+   if (file_exists) {
+      update_pstore_file(PSTORE_UPDATE_DELETE_TYPE, NULL, NULL, record_type, 0, NULL);
+   }
+   else if (pstore_records) {
+      g_hash_table_destroy(pstore_records);
+      pstore_records = NULL;
+   }
+   g_mutex_unlock(&pstore_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Deletes the records that have not been set within a time period.
+ *
+ *  \param  max_age_secs  maximum age of retained records, in seconds
+ *  \return number of records deleted
+ */
+int pstore_prune(uint64_t max_age_secs) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "max_age_secs=%"PRIu64, max_age_secs);
+
+   int removed_ct = 0;
+   g_mutex_lock(&pstore_mutex);
+   update_pstore_file(PSTORE_UPDATE_PRUNE, NULL, NULL, NULL, max_age_secs, &removed_ct);
+   g_mutex_unlock(&pstore_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %d", removed_ct);
+   return removed_ct;
+}
+
+
+/** Calls a function for each record of a type, or for all records.
+ *
+ *  \param  record_type  record type, NULL for all records
+ *  \param  func         function to call
+ *  \param  data         passed to **func**
+ *  \return number of records for which **func** was called
+ *
+ *  \remark
+ *  **func** must not call other functions of this module.
+ */
+int pstore_foreach(const char * record_type, Pstore_Record_Func func, void * data) {
+   int ct = 0;
+   g_mutex_lock(&pstore_mutex);
+   ensure_pstore_loaded();
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, pstore_records);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      char * type_and_key = key;
+      char * tab = strchr(type_and_key, '\t');
+      *tab = '\0';     // temporarily split the compound key
+      if (!record_type || streq(record_type, type_and_key)) {
+         if (func)
+            func(type_and_key, tab+1, ((Pstore_Record *) value)->value, data);
+         ct++;
+      }
+      *tab = '\t';
+   }
+   g_mutex_unlock(&pstore_mutex);
+   return ct;
+}
+
+
+/** Emits a debug report of the records currently loaded.
+ *
+ *  \param depth  logical indentation depth
+ */
+void dbgrpt_persistent_store(int depth) {
+   g_mutex_lock(&pstore_mutex);
+   rpt_vstring(depth, "Persistent store records at %p", pstore_records);
+   if (pstore_records) {
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, pstore_records);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         Pstore_Record * rec = value;
+         rpt_vstring(depth+1, "%s : %s  (set %"PRIu64")", (char *) key, rec->value, rec->timestamp);
+      }
+   }
+   g_mutex_unlock(&pstore_mutex);
+}
+
+
+void init_persistent_store() {
+   RTTI_ADD_FUNC(read_pstore_file);
+   RTTI_ADD_FUNC(write_pstore_file);
+   RTTI_ADD_FUNC(update_pstore_file);
+   RTTI_ADD_FUNC(pstore_get);
+   RTTI_ADD_FUNC(pstore_set);
+   RTTI_ADD_FUNC(pstore_delete_records);
+   RTTI_ADD_FUNC(pstore_prune);
+}
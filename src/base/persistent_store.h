@@ -0,0 +1,36 @@
+/** @file persistent_store.h
+ *
+ *  Single file store for data learned about monitors, e.g. VCP versions
+ *  and features that a model does not support.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef PERSISTENT_STORE_H_
+#define PERSISTENT_STORE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Record types
+#define PSTORE_UNSUPPORTED_FEATURES  "unsupported_features"
+#define PSTORE_VCP_VERSION           "vcp_version"
+#define PSTORE_UNSUPPORTED_SIGNALING "unsupported_signaling"
+#define PSTORE_SETTLE_WINDOWS        "settle_windows"
+#define PSTORE_REMEMBERED_VALUES     "vcp_values"
+
+char * get_persistent_store_file_name();
+char * pstore_get(const char * record_type, const char * key);
+bool   pstore_set(const char * record_type, const char * key, const char * value);
+void   pstore_delete_records(const char * record_type);
+int    pstore_prune(uint64_t max_age_secs);
+
+/** Function called for each record by #pstore_foreach() */
+typedef void (*Pstore_Record_Func)(
+      const char * record_type, const char * key, const char * value, void * data);
+int    pstore_foreach(const char * record_type, Pstore_Record_Func func, void * data);
+void   dbgrpt_persistent_store(int depth);
+void   init_persistent_store();
+
+#endif /* PERSISTENT_STORE_H_ */
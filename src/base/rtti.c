@@ -1,12 +1,19 @@
 /* @file rtti.c
  * Runtime trace information
+ *
+ * Registration only records the function address and the (static) name
+ * string in an array.  The array is sorted by address the first time a
+ * name is looked up after registration, so startup pays no hashing or
+ * string duplication cost for a table that is only needed when tracing.
  */
 
-// Copyright (C) 2018-2021 Sanford Rockowitz <rockowitz@minsoft.com>
+// Copyright (C) 2018-2022 Sanford Rockowitz <rockowitz@minsoft.com>
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 
 #include <glib-2.0/glib.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
  
 #include "util/report_util.h"
@@ -14,39 +21,110 @@
 #include "base/rtti.h"
 
 
-static GHashTable * func_name_table = NULL;
+typedef struct {
+   void *       func_addr;
+   const char * func_name;
+   int          seqno;         // registration order
+} Rtti_Func_Entry;
 
+#define RTTI_INITIAL_ENTRIES 400
 
+static Rtti_Func_Entry   initial_entries[RTTI_INITIAL_ENTRIES];
+static Rtti_Func_Entry * func_entries      = initial_entries;
+static int               func_entry_ct     = 0;
+static int               func_entry_max    = RTTI_INITIAL_ENTRIES;
+static bool              func_entries_sorted = true;
+static GMutex            func_entries_mutex;
+
+
+/** Registers a function name.
+ *
+ *  @param func_addr  function address
+ *  @param func_name  function name, must be a string constant
+ */
 void rtti_func_name_table_add(void * func_addr, const char * func_name) {
-   if (!func_name_table)
-      func_name_table =  g_hash_table_new(g_direct_hash, g_direct_equal);
-   g_hash_table_insert(func_name_table, func_addr, strdup(func_name));
+   g_mutex_lock(&func_entries_mutex);
+   if (func_entry_ct == func_entry_max) {
+      func_entry_max *= 2;
+      if (func_entries == initial_entries) {
+         func_entries = g_new(Rtti_Func_Entry, func_entry_max);
+         memcpy(func_entries, initial_entries, sizeof(initial_entries));
+      }
+      else {
+         func_entries = g_renew(Rtti_Func_Entry, func_entries, func_entry_max);
+      }
+   }
+   func_entries[func_entry_ct].func_addr = func_addr;
+   func_entries[func_entry_ct].func_name = func_name;
+   func_entries[func_entry_ct].seqno     = func_entry_ct;
+   func_entry_ct++;
+   func_entries_sorted = false;
+   g_mutex_unlock(&func_entries_mutex);
+}
+
+
+static int compare_entry_addrs(const void * a, const void * b) {
+   uintptr_t addr_a = (uintptr_t) ((Rtti_Func_Entry *) a)->func_addr;
+   uintptr_t addr_b = (uintptr_t) ((Rtti_Func_Entry *) b)->func_addr;
+   return (addr_a < addr_b) ? -1 : (addr_a > addr_b) ? 1 : 0;
+}
+
+
+// Orders by address, and for equal addresses most recent registration first
+static int compare_entries_for_sort(const void * a, const void * b) {
+   int result = compare_entry_addrs(a, b);
+   if (result == 0)
+      result = ((Rtti_Func_Entry *) b)->seqno - ((Rtti_Func_Entry *) a)->seqno;
+   return result;
+}
+
+
+// Sorts the table by address if entries have been added since the last sort.
+// If a function is registered more than once, the last registration is
+// retained, as when the table was a GHashTable.
+// Must be called with func_entries_mutex locked.
+static void sort_func_entries() {
+   if (!func_entries_sorted) {
+      qsort(func_entries, func_entry_ct, sizeof(Rtti_Func_Entry), compare_entries_for_sort);
+      int unique_ct = 0;
+      for (int ndx = 0; ndx < func_entry_ct; ndx++) {
+         if (unique_ct > 0 && func_entries[unique_ct-1].func_addr == func_entries[ndx].func_addr)
+            continue;
+         func_entries[unique_ct++] = func_entries[ndx];
+      }
+      func_entry_ct = unique_ct;
+      for (int ndx = 0; ndx < func_entry_ct; ndx++)
+         func_entries[ndx].seqno = ndx;
+      func_entries_sorted = true;
+   }
 }
 
 
 char * rtti_get_func_name_by_addr(void * ptr) {
    char * result = "";
-   if (func_name_table && ptr) {
-      result = g_hash_table_lookup(func_name_table, ptr);
-      if (!result)
-         result = "<Not Found>";
+   if (func_entry_ct > 0 && ptr) {
+      g_mutex_lock(&func_entries_mutex);
+      sort_func_entries();
+      Rtti_Func_Entry key = {ptr, NULL};
+      Rtti_Func_Entry * found = bsearch(&key, func_entries, func_entry_ct,
+                                        sizeof(Rtti_Func_Entry), compare_entry_addrs);
+      result = (found) ? (char *) found->func_name : "<Not Found>";
+      g_mutex_unlock(&func_entries_mutex);
    }
    return result;
 }
 
+
 void * rtti_get_func_addr_by_name(char * name) {
    void * result = NULL;
-   if (func_name_table) {
-      GHashTableIter iter;
-      gpointer key, value;
-      g_hash_table_iter_init(&iter, func_name_table);
-      while (g_hash_table_iter_next(&iter, &key, &value)) {
-         if (streq(name, (char *) value)) {
-            result = key;
-            break;
-         }
+   g_mutex_lock(&func_entries_mutex);
+   for (int ndx = 0; ndx < func_entry_ct; ndx++) {
+      if (streq(name, func_entries[ndx].func_name)) {
+         result = func_entries[ndx].func_addr;
+         break;
       }
    }
+   g_mutex_unlock(&func_entries_mutex);
    // printf("(%s) name=%s, returning %s\n", __func__, name, SBOOL(result));
    return result;
 }
@@ -54,14 +132,10 @@ void * rtti_get_func_addr_by_name(char * name) {
 
 void dbgrpt_rtti_func_name_table(int depth) {
    int d1 = depth+1;
-   rpt_vstring(depth, "Function name table at %p", func_name_table);
-   if (func_name_table) {
-      GHashTableIter iter;
-      gpointer key, value;
-      g_hash_table_iter_init(&iter, func_name_table);
-      while (g_hash_table_iter_next(&iter, &key, &value)) {
-         rpt_vstring(d1, "%p: %s", key, (char *) value);
-      }
-   }
+   g_mutex_lock(&func_entries_mutex);
+   sort_func_entries();
+   rpt_vstring(depth, "Function name table at %p, %d entries", func_entries, func_entry_ct);
+   for (int ndx = 0; ndx < func_entry_ct; ndx++)
+      rpt_vstring(d1, "%p: %s", func_entries[ndx].func_addr, func_entries[ndx].func_name);
+   g_mutex_unlock(&func_entries_mutex);
 }
-
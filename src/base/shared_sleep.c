@@ -0,0 +1,237 @@
+/** @file shared_sleep.c
+ *
+ *  Cross-process coordination of the earliest time at which the next
+ *  I2C operation on a bus may occur.
+ *
+ *  Deferred sleep (see tuned_sleep.c) records in the Display_Ref the time
+ *  before which the next I2C operation must not occur.  That value is only
+ *  visible within the current process.  If multiple processes, e.g. a
+ *  libddcutil client and the ddcutil command, access the same /dev/i2c
+ *  device, each is unaware of the other's operations.
+ *
+ *  This file maintains a small record for each bus in a memory mapped
+ *  file in /dev/shm, containing the time the last I2C operation completed
+ *  and the earliest time at which the next operation may occur.  Times are
+ *  CLOCK_MONOTONIC values, which are system wide.  Fields are read and
+ *  updated atomically, so no lock is required.
+ *
+ *  If the shared file cannot be created or mapped, coordination is silently
+ *  disabled for the bus and only in-process information is used.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+/** \endcond */
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/rtti.h"
+
+#include "base/shared_sleep.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_SLEEP;
+
+#define SHARED_SLEEP_DIR      "/dev/shm"
+#define SHARED_SLEEP_VERSION  1
+
+/** Per-bus record shared across processes */
+typedef struct {
+   uint32_t version;
+   uint32_t reserved;
+   uint64_t last_io_completed_nanos;    // CLOCK_MONOTONIC
+   uint64_t next_io_after_nanos;        // CLOCK_MONOTONIC
+} Shared_Bus_Sleep_Rec;
+
+static bool         shared_sleep_enabled = false;
+static GHashTable * shared_recs = NULL;      // busno -> Shared_Bus_Sleep_Rec *, NULL if mapping failed
+static GMutex       shared_recs_mutex;
+
+
+/** Enables or disables cross-process sleep coordination.
+ *
+ *  @param  onoff new setting
+ *  @return old setting
+ */
+bool enable_shared_sleep(bool onoff) {
+   bool old = shared_sleep_enabled;
+   shared_sleep_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether cross-process sleep coordination is enabled.
+ *  @return true/false
+ */
+bool is_shared_sleep_enabled() {
+   return shared_sleep_enabled;
+}
+
+
+static Shared_Bus_Sleep_Rec * map_shared_rec(int busno) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d", busno);
+
+   Shared_Bus_Sleep_Rec * result = NULL;
+   char fn[80];
+   g_snprintf(fn, sizeof(fn), "%s/ddcutil-i2c-%d", SHARED_SLEEP_DIR, busno);
+   int fd = open(fn, O_RDWR|O_CREAT|O_CLOEXEC, 0666);
+   if (fd < 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Error opening %s: %s", fn, strerror(errno));
+      goto bye;
+   }
+   // so that processes run by other users can share the record, ignore umask
+   fchmod(fd, 0666);
+   struct stat statbuf;
+   if (fstat(fd, &statbuf) == 0 && statbuf.st_size < sizeof(Shared_Bus_Sleep_Rec)) {
+      if (ftruncate(fd, sizeof(Shared_Bus_Sleep_Rec)) < 0) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "ftruncate() failed: %s", strerror(errno));
+         close(fd);
+         goto bye;
+      }
+   }
+   void * addr = mmap(NULL, sizeof(Shared_Bus_Sleep_Rec), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (addr == MAP_FAILED) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "mmap() failed: %s", strerror(errno));
+      goto bye;
+   }
+   result = addr;
+   uint32_t expected = 0;
+   __atomic_compare_exchange_n(&result->version, &expected, SHARED_SLEEP_VERSION,
+                               false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&result->version, __ATOMIC_SEQ_CST) != SHARED_SLEEP_VERSION) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Unexpected version in %s", fn);
+      munmap(addr, sizeof(Shared_Bus_Sleep_Rec));
+      result = NULL;
+   }
+
+bye:
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %p", result);
+   return result;
+}
+
+
+static Shared_Bus_Sleep_Rec * get_shared_rec(int busno) {
+   if (!shared_sleep_enabled || busno < 0)
+      return NULL;
+
+   Shared_Bus_Sleep_Rec * result = NULL;
+   g_mutex_lock(&shared_recs_mutex);
+   if (!shared_recs)
+      shared_recs = g_hash_table_new(g_direct_hash, g_direct_equal);
+   gpointer value = NULL;
+   if (g_hash_table_lookup_extended(shared_recs, GINT_TO_POINTER(busno), NULL, &value)) {
+      result = value;
+   }
+   else {
+      result = map_shared_rec(busno);
+      // save failures too, so that mapping is not retried on every call
+      g_hash_table_insert(shared_recs, GINT_TO_POINTER(busno), result);
+   }
+   g_mutex_unlock(&shared_recs_mutex);
+   return result;
+}
+
+
+/** Returns the earliest time at which the next I2C operation on a bus may
+ *  occur, as recorded by any process.
+ *
+ *  @param  busno  I2C bus number
+ *  @return CLOCK_MONOTONIC time in nanoseconds, 0 if not known
+ */
+uint64_t shared_sleep_get_next_io_after(int busno) {
+   Shared_Bus_Sleep_Rec * rec = get_shared_rec(busno);
+   return (rec) ? __atomic_load_n(&rec->next_io_after_nanos, __ATOMIC_SEQ_CST) : 0;
+}
+
+
+/** Records the earliest time at which the next I2C operation on a bus
+ *  may occur.  The shared value is only ever increased.
+ *
+ *  @param  busno                I2C bus number
+ *  @param  next_io_after_nanos  CLOCK_MONOTONIC time in nanoseconds
+ */
+void shared_sleep_set_next_io_after(int busno, uint64_t next_io_after_nanos) {
+   Shared_Bus_Sleep_Rec * rec = get_shared_rec(busno);
+   if (rec) {
+      uint64_t cur = __atomic_load_n(&rec->next_io_after_nanos, __ATOMIC_SEQ_CST);
+      while (next_io_after_nanos > cur &&
+             !__atomic_compare_exchange_n(&rec->next_io_after_nanos, &cur, next_io_after_nanos,
+                                          false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+      {
+         // cur has been updated with the current value, retry
+      }
+   }
+}
+
+
+/** Records that an I2C operation on a bus has just completed.
+ *
+ *  @param  busno  I2C bus number
+ */
+void shared_sleep_record_io_completed(int busno) {
+   Shared_Bus_Sleep_Rec * rec = get_shared_rec(busno);
+   if (rec)
+      __atomic_store_n(&rec->last_io_completed_nanos, cur_monotonic_nanosec(), __ATOMIC_SEQ_CST);
+}
+
+
+/** Reports the shared sleep record for a bus.
+ *
+ *  @param  busno  I2C bus number
+ *  @param  depth  logical indentation depth
+ */
+void report_shared_sleep(int busno, int depth) {
+   Shared_Bus_Sleep_Rec * rec = get_shared_rec(busno);
+   if (!rec)
+      rpt_vstring(depth, "No shared sleep record for bus %d", busno);
+   else {
+      uint64_t now = cur_monotonic_nanosec();
+      uint64_t last = __atomic_load_n(&rec->last_io_completed_nanos, __ATOMIC_SEQ_CST);
+      uint64_t next = __atomic_load_n(&rec->next_io_after_nanos, __ATOMIC_SEQ_CST);
+      rpt_vstring(depth, "Shared sleep record for bus %d:", busno);
+      rpt_vstring(depth+1, "Last I/O completed:   %"PRIu64" milliseconds ago",
+                           (now > last) ? (now-last)/(1000*1000) : 0);
+      rpt_vstring(depth+1, "Next I/O allowed in:  %"PRIu64" milliseconds",
+                           (next > now) ? (next-now)/(1000*1000) : 0);
+   }
+}
+
+
+/** Module initialization */
+void init_shared_sleep() {
+   RTTI_ADD_FUNC(map_shared_rec);
+}
+
+
+/** Unmaps all shared records */
+void release_shared_sleep() {
+   g_mutex_lock(&shared_recs_mutex);
+   if (shared_recs) {
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, shared_recs);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         if (value)
+            munmap(value, sizeof(Shared_Bus_Sleep_Rec));
+      }
+      g_hash_table_destroy(shared_recs);
+      shared_recs = NULL;
+   }
+   g_mutex_unlock(&shared_recs_mutex);
+}
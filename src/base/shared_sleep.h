@@ -0,0 +1,30 @@
+/** @file shared_sleep.h
+ *
+ *  Cross-process coordination of the earliest time at which the next
+ *  I2C operation on a bus may occur.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef SHARED_SLEEP_H_
+#define SHARED_SLEEP_H_
+
+/** \cond */
+#include <inttypes.h>
+#include <stdbool.h>
+/** \endcond */
+
+bool     enable_shared_sleep(bool onoff);
+bool     is_shared_sleep_enabled();
+
+uint64_t shared_sleep_get_next_io_after(int busno);
+void     shared_sleep_set_next_io_after(int busno, uint64_t next_io_after_nanos);
+void     shared_sleep_record_io_completed(int busno);
+
+void     report_shared_sleep(int busno, int depth);
+
+void     init_shared_sleep();
+void     release_shared_sleep();
+
+#endif /* SHARED_SLEEP_H_ */
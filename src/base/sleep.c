@@ -11,9 +11,11 @@
 
 
 /** \cond */
+#include <errno.h>
 #include <glib-2.0/glib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 /** \endcond */
 
@@ -22,6 +24,8 @@
 
 #include "base/core.h"
 #include "base/sleep.h"
+#include "base/stats_export.h"
+#include "base/thread_sched.h"
 
 
 //
@@ -36,7 +40,13 @@ void init_sleep_stats() {
    G_LOCK(sleep_stats);
    sleep_stats.total_sleep_calls = 0;
    sleep_stats.requested_sleep_milliseconds = 0;
+   sleep_stats.requested_sleep_nanos = 0;
    sleep_stats.actual_sleep_nanos = 0;
+   sleep_stats.total_overshoot_nanos = 0;
+   sleep_stats.max_overshoot_nanos = 0;
+   sleep_stats.realtime_sleep_calls = 0;
+   sleep_stats.realtime_overshoot_nanos = 0;
+   sleep_stats.realtime_max_overshoot_nanos = 0;
    G_UNLOCK(sleep_stats);
 }
 
@@ -70,9 +80,57 @@ void report_sleep_stats(int depth) {
                    stats_copy.total_sleep_calls);
    rpt_vstring(d1, "Requested sleep time milliseconds :             %10d",
                    stats_copy.requested_sleep_milliseconds);
+   rpt_vstring(d1, "Requested sleep milliseconds (nanosec):         %10"PRIu64"  (%13" PRIu64 ")",
+                   stats_copy.requested_sleep_nanos / (1000*1000),
+                   stats_copy.requested_sleep_nanos);
    rpt_vstring(d1, "Actual sleep milliseconds (nanosec):            %10"PRIu64"  (%13" PRIu64 ")",
                    stats_copy.actual_sleep_nanos / (1000*1000),
                    stats_copy.actual_sleep_nanos);
+   rpt_vstring(d1, "Total wakeup overshoot microseconds:            %10"PRIu64,
+                   stats_copy.total_overshoot_nanos / 1000);
+   rpt_vstring(d1, "Maximum wakeup overshoot microseconds:          %10"PRIu64,
+                   stats_copy.max_overshoot_nanos / 1000);
+   if (stats_copy.total_sleep_calls > 0)
+      rpt_vstring(d1, "Average wakeup overshoot microseconds:          %10"PRIu64,
+                      stats_copy.total_overshoot_nanos / 1000 / stats_copy.total_sleep_calls);
+   if (stats_copy.realtime_sleep_calls > 0) {
+      rpt_vstring(d1, "Sleep calls by real time threads:               %10d",
+                      stats_copy.realtime_sleep_calls);
+      rpt_vstring(d1, "   Average wakeup overshoot microseconds:       %10"PRIu64,
+                      stats_copy.realtime_overshoot_nanos / 1000 / stats_copy.realtime_sleep_calls);
+      rpt_vstring(d1, "   Maximum wakeup overshoot microseconds:       %10"PRIu64,
+                      stats_copy.realtime_max_overshoot_nanos / 1000);
+   }
+}
+
+
+/** Exports the accumulated sleep statistics
+ *
+ * \param exp  export instance
+ */
+void export_sleep_stats(Stats_Export * exp) {
+   Sleep_Stats stats_copy = get_sleep_stats();
+   stats_export_metric(exp, "ddcutil_sleep_calls_total", STATS_METRIC_COUNTER,
+                            "Number of sleep calls");
+   stats_export_sample(exp, "ddcutil_sleep_calls_total", stats_copy.total_sleep_calls, 0);
+   stats_export_metric(exp, "ddcutil_sleep_requested_seconds_total", STATS_METRIC_COUNTER,
+                            "Requested sleep time");
+   stats_export_sample(exp, "ddcutil_sleep_requested_seconds_total", stats_copy.requested_sleep_nanos / 1e9, 0);
+   stats_export_metric(exp, "ddcutil_sleep_actual_seconds_total", STATS_METRIC_COUNTER,
+                            "Actual sleep time");
+   stats_export_sample(exp, "ddcutil_sleep_actual_seconds_total", stats_copy.actual_sleep_nanos / 1e9, 0);
+   stats_export_metric(exp, "ddcutil_sleep_overshoot_seconds_total", STATS_METRIC_COUNTER,
+                            "Time by which sleeps exceeded their wakeup time");
+   stats_export_sample(exp, "ddcutil_sleep_overshoot_seconds_total", stats_copy.total_overshoot_nanos / 1e9, 0);
+   stats_export_metric(exp, "ddcutil_sleep_max_overshoot_seconds", STATS_METRIC_GAUGE,
+                            "Maximum time by which a sleep exceeded its wakeup time");
+   stats_export_sample(exp, "ddcutil_sleep_max_overshoot_seconds", stats_copy.max_overshoot_nanos / 1e9, 0);
+   stats_export_metric(exp, "ddcutil_sleep_realtime_calls_total", STATS_METRIC_COUNTER,
+                            "Number of sleep calls by threads with real time scheduling");
+   stats_export_sample(exp, "ddcutil_sleep_realtime_calls_total", stats_copy.realtime_sleep_calls, 0);
+   stats_export_metric(exp, "ddcutil_sleep_realtime_overshoot_seconds_total", STATS_METRIC_COUNTER,
+                            "Time by which sleeps by threads with real time scheduling exceeded their wakeup time");
+   stats_export_sample(exp, "ddcutil_sleep_realtime_overshoot_seconds_total", stats_copy.realtime_overshoot_nanos / 1e9, 0);
 }
 
 
@@ -80,22 +138,72 @@ void report_sleep_stats(int depth) {
 // Perform Sleep
 //
 
-/** Sleep for the specified number of milliseconds and
+/** Sleep until an absolute time on the monotonic clock and
  *  record sleep statistics.
  *
- * \param milliseconds number of milliseconds to sleep
+ *  Using an absolute deadline avoids drift caused by rounding the
+ *  sleep interval and by any time spent preparing for the sleep.
+ *  If the deadline has already passed, returns immediately.
+ *
+ * \param deadline_nanos time to wake up, as returned by #cur_monotonic_nanosec()
  */
-void sleep_millis(int milliseconds) {
-   uint64_t start_nanos = cur_realtime_nanosec();
-   usleep(milliseconds*1000);   // usleep takes microseconds, not milliseconds
+void sleep_until_monotonic_nanos(uint64_t deadline_nanos) {
+   uint64_t start_nanos = cur_monotonic_nanosec();
+   if (deadline_nanos <= start_nanos)
+      return;
+
+   struct timespec deadline;
+   deadline.tv_sec  = deadline_nanos / (1000*1000*1000);
+   deadline.tv_nsec = deadline_nanos % (1000*1000*1000);
+   int rc;
+   do {
+      // n. clock_nanosleep() returns the error number, it does not set errno
+      rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+   } while (rc == EINTR);
+
+   uint64_t end_nanos = cur_monotonic_nanosec();
+   uint64_t overshoot_nanos = (end_nanos > deadline_nanos) ? end_nanos - deadline_nanos : 0;
+   uint64_t requested_nanos = deadline_nanos - start_nanos;
+   bool     realtime = is_realtime_worker_thread();
+
    G_LOCK(sleep_stats);
-   sleep_stats.actual_sleep_nanos += (cur_realtime_nanosec()-start_nanos);
-   sleep_stats.requested_sleep_milliseconds += milliseconds;
+   sleep_stats.actual_sleep_nanos += (end_nanos-start_nanos);
+   sleep_stats.requested_sleep_nanos += requested_nanos;
+   sleep_stats.requested_sleep_milliseconds += requested_nanos / (1000*1000);
+   sleep_stats.total_overshoot_nanos += overshoot_nanos;
+   if (overshoot_nanos > sleep_stats.max_overshoot_nanos)
+      sleep_stats.max_overshoot_nanos = overshoot_nanos;
    sleep_stats.total_sleep_calls++;
+   if (realtime) {
+      sleep_stats.realtime_sleep_calls++;
+      sleep_stats.realtime_overshoot_nanos += overshoot_nanos;
+      if (overshoot_nanos > sleep_stats.realtime_max_overshoot_nanos)
+         sleep_stats.realtime_max_overshoot_nanos = overshoot_nanos;
+   }
    G_UNLOCK(sleep_stats);
 }
 
 
+/** Sleep for the specified number of microseconds and
+ *  record sleep statistics.
+ *
+ * \param microseconds number of microseconds to sleep
+ */
+void sleep_micros(uint64_t microseconds) {
+   sleep_until_monotonic_nanos(cur_monotonic_nanosec() + microseconds * 1000);
+}
+
+
+/** Sleep for the specified number of milliseconds and
+ *  record sleep statistics.
+ *
+ * \param milliseconds number of milliseconds to sleep
+ */
+void sleep_millis(int milliseconds) {
+   sleep_micros(milliseconds * (uint64_t) 1000);
+}
+
+
 /** Sleep for the specified number of milliseconds, record
  *  sleep statistics, and perform tracing.
  *
@@ -124,3 +232,61 @@ void sleep_millis_with_trace(
 
    sleep_millis(milliseconds);
 }
+
+
+/** Sleep for the specified number of microseconds, record
+ *  sleep statistics, and perform tracing.
+ *
+ * \param microseconds number of microseconds to sleep
+ * \param func         name of function that invoked sleep
+ * \param lineno       line number in file where sleep was invoked
+ * \param filename     name of file from which sleep was invoked
+ * \param message      text to be appended to trace message
+ */
+void sleep_micros_with_trace(
+        uint64_t     microseconds,
+        const char * func,
+        int          lineno,
+        const char * filename,
+        const char * message)
+{
+   bool debug = false;
+
+   if (!message)
+      message = "";
+
+   DBGTRC_NOPREFIX(debug, DDCA_TRC_SLEEP,
+                   "Sleeping for %"PRIu64" microseconds. %s", microseconds, message);
+
+   sleep_micros(microseconds);
+}
+
+
+/** Sleep until an absolute time on the monotonic clock, record
+ *  sleep statistics, and perform tracing.
+ *
+ * \param deadline_nanos time to wake up, as returned by #cur_monotonic_nanosec()
+ * \param func           name of function that invoked sleep
+ * \param lineno         line number in file where sleep was invoked
+ * \param filename       name of file from which sleep was invoked
+ * \param message        text to be appended to trace message
+ */
+void sleep_until_with_trace(
+        uint64_t     deadline_nanos,
+        const char * func,
+        int          lineno,
+        const char * filename,
+        const char * message)
+{
+   bool debug = false;
+
+   if (!message)
+      message = "";
+
+   uint64_t now = cur_monotonic_nanosec();
+   DBGTRC_NOPREFIX(debug, DDCA_TRC_SLEEP,
+                   "Sleeping for %"PRIu64" microseconds. %s",
+                   (deadline_nanos > now) ? (deadline_nanos - now)/1000 : 0, message);
+
+   sleep_until_monotonic_nanos(deadline_nanos);
+}
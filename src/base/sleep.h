@@ -14,15 +14,31 @@
 
 #include <inttypes.h>
 
+#include "base/stats_export.h"
+
 // Perform sleep
 
 void sleep_millis(int milliseconds);
+void sleep_micros(uint64_t microseconds);
+void sleep_until_monotonic_nanos(uint64_t deadline_nanos);
 void sleep_millis_with_trace(
         int          milliseconds,
         const char * func,
         int          lineno,
         const char * filename,
         const char * message);
+void sleep_micros_with_trace(
+        uint64_t     microseconds,
+        const char * func,
+        int          lineno,
+        const char * filename,
+        const char * message);
+void sleep_until_with_trace(
+        uint64_t     deadline_nanos,
+        const char * func,
+        int          lineno,
+        const char * filename,
+        const char * message);
 
 #define SLEEP_MILLIS_WITH_TRACE(_millis, _msg) \
    sleep_millis_with_trace(_millis, __func__, __LINE__, __FILE__, _msg)
@@ -32,11 +48,18 @@ void sleep_millis_with_trace(
 typedef struct {
    uint64_t actual_sleep_nanos;
    int      requested_sleep_milliseconds;
+   uint64_t requested_sleep_nanos;
+   uint64_t total_overshoot_nanos;     // actual wakeup time - requested wakeup time
+   uint64_t max_overshoot_nanos;
    int      total_sleep_calls;
+   int      realtime_sleep_calls;      // sleeps by threads with real time scheduling
+   uint64_t realtime_overshoot_nanos;
+   uint64_t realtime_max_overshoot_nanos;
 } Sleep_Stats;
 
 void         init_sleep_stats();
 Sleep_Stats  get_sleep_stats();
 void         report_sleep_stats(int depth);
+void         export_sleep_stats(Stats_Export * exp);
 
 #endif /* BASE_SLEEP_H_ */
@@ -0,0 +1,273 @@
+/** \file stats_export.c
+ *
+ *  Writes statistics in machine readable formats.
+ *
+ *  Statistics are written as a sequence of metrics, each consisting of a
+ *  name, type, help text, and a number of samples.  A sample has a name,
+ *  which is the metric name possibly with a suffix such as "_count",
+ *  optional labels, and a value.  This is the data model of the Prometheus
+ *  text exposition format, which is written directly.  In JSON format the
+ *  same information is written as an object with a "metrics" array.
+ *
+ *  Statistics can also be exported as deltas since a #Stats_Cursor, so that
+ *  multiple consumers can each observe rates without resetting the global
+ *  counters.  The samples of counter metrics are exported as the difference
+ *  from the value recorded in the cursor.  If a counter is lower than its
+ *  recorded value it has been reset, and its current value is exported.
+ *  Gauges are exported unchanged.  The latency summaries are computed from
+ *  the histogram counts recorded since the cursor, see latency_stats.c.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <math.h>
+#include <stdarg.h>
+#include <string.h>
+/** \endcond */
+
+#include "ddcutil_types.h"
+
+#include "base/latency_stats.h"
+
+#include "base/stats_export.h"
+
+
+static const char * metric_type_names[] = {"counter", "gauge", "summary"};
+
+
+// Appends a string, escaped for a JSON string or a Prometheus label value
+static void
+append_escaped(GString * buf, const char * s, bool json) {
+   for (const char * p = s; *p; p++) {
+      switch (*p) {
+      case '"':  g_string_append(buf, "\\\""); break;
+      case '\\': g_string_append(buf, "\\\\"); break;
+      case '\n': g_string_append(buf, "\\n");  break;
+      default:
+         if (json && (unsigned char) *p < 0x20)
+            g_string_append_printf(buf, "\\u%04x", *p);
+         else
+            g_string_append_c(buf, *p);
+      }
+   }
+}
+
+
+static void
+append_value(GString * buf, double value) {
+   if (isnan(value))
+      g_string_append(buf, "NaN");
+   else
+      g_string_append_printf(buf, "%.15g", value);
+}
+
+
+/** Creates an empty #Stats_Cursor, to be set by exporting with it as
+ *  the capture cursor, see #stats_export_new_with_cursor().
+ *
+ *  \return newly allocated cursor
+ */
+Stats_Cursor *
+stats_cursor_new() {
+   Stats_Cursor * cursor = g_new0(Stats_Cursor, 1);
+   memcpy(cursor->marker, STATS_CURSOR_MARKER, 4);
+   cursor->counters = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+   return cursor;
+}
+
+
+/** Checks that a pointer received from a client refers to a #Stats_Cursor */
+bool
+stats_cursor_is_valid(void * cursor) {
+   return cursor && memcmp(((Stats_Cursor *) cursor)->marker, STATS_CURSOR_MARKER, 4) == 0;
+}
+
+
+/** Frees a #Stats_Cursor.
+ *
+ *  \param  cursor  cursor to free, if NULL do nothing
+ */
+void
+stats_cursor_free(Stats_Cursor * cursor) {
+   if (cursor) {
+      assert(memcmp(cursor->marker, STATS_CURSOR_MARKER, 4) == 0);
+      g_hash_table_destroy(cursor->counters);
+      free_latency_baseline(cursor->latency);
+      cursor->marker[3] = 'x';
+      g_free(cursor);
+   }
+}
+
+
+/** Creates a #Stats_Export instance.
+ *
+ *  \param  format  output format
+ *  \return newly allocated instance, to be completed by #stats_export_finish()
+ */
+Stats_Export *
+stats_export_new(DDCA_Stats_Export_Format format) {
+   return stats_export_new_with_cursor(format, NULL, NULL);
+}
+
+
+/** Creates a #Stats_Export instance that exports deltas, records the
+ *  current values, or both.  **baseline** and **capture** may be the same
+ *  cursor, which then advances to the current values.
+ *
+ *  \param  format    output format
+ *  \param  baseline  if non-NULL, counters are exported as deltas from this cursor
+ *  \param  capture   if non-NULL, receives the current values
+ *  \return newly allocated instance, to be completed by #stats_export_finish()
+ */
+Stats_Export *
+stats_export_new_with_cursor(DDCA_Stats_Export_Format format,
+                             Stats_Cursor * baseline, Stats_Cursor * capture)
+{
+   Stats_Export * exp = g_new0(Stats_Export, 1);
+   memcpy(exp->marker, STATS_EXPORT_MARKER, 4);
+   exp->format = format;
+   exp->baseline = baseline;
+   exp->capture  = capture;
+   exp->buf = g_string_sized_new(4096);
+   if (format == DDCA_STATS_FORMAT_JSON)
+      g_string_append(exp->buf, "{\n  \"metrics\": [");
+   return exp;
+}
+
+
+static void
+end_metric(Stats_Export * exp) {
+   if (exp->in_metric && exp->format == DDCA_STATS_FORMAT_JSON)
+      g_string_append(exp->buf, "\n    ]}");
+   exp->in_metric = false;
+}
+
+
+/** Starts a new metric.  Subsequent samples belong to this metric.
+ *
+ *  \param  exp   export instance
+ *  \param  name  metric name, e.g. "ddcutil_io_calls_total"
+ *  \param  type  metric type
+ *  \param  help  description
+ */
+void
+stats_export_metric(Stats_Export * exp, const char * name, Stats_Metric_Type type, const char * help) {
+   assert(exp && memcmp(exp->marker, STATS_EXPORT_MARKER, 4) == 0);
+   end_metric(exp);
+   if (exp->format == DDCA_STATS_FORMAT_JSON) {
+      g_string_append(exp->buf, (exp->metric_ct > 0) ? ",\n    " : "\n    ");
+      g_string_append_printf(exp->buf, "{\"name\": \"%s\", \"type\": \"%s\", \"help\": \"",
+                                       name, metric_type_names[type]);
+      append_escaped(exp->buf, help, true);
+      g_string_append(exp->buf, "\", \"samples\": [");
+   }
+   else {
+      g_string_append_printf(exp->buf, "# HELP %s %s\n", name, help);
+      g_string_append_printf(exp->buf, "# TYPE %s %s\n", name, metric_type_names[type]);
+   }
+   exp->in_metric = true;
+   exp->metric_type = type;
+   exp->metric_ct++;
+   exp->sample_ct = 0;
+}
+
+
+/** Writes a sample of the current metric.
+ *
+ *  \param  exp       export instance
+ *  \param  name      sample name, the metric name possibly with a suffix
+ *  \param  value     sample value
+ *  \param  label_ct  number of labels
+ *  \param  ...       label_ct pairs of (const char *) label name and label value
+ */
+void
+stats_export_sample(Stats_Export * exp, const char * name, double value, int label_ct, ...) {
+   assert(exp && memcmp(exp->marker, STATS_EXPORT_MARKER, 4) == 0);
+   assert(exp->in_metric);
+   bool json = (exp->format == DDCA_STATS_FORMAT_JSON);
+   GString * buf = exp->buf;
+   // identifies the sample across exports, e.g. name{label1="a",label2="b"}
+   GString * key = NULL;
+   if ((exp->baseline || exp->capture) && exp->metric_type == STATS_METRIC_COUNTER)
+      key = g_string_new(name);
+
+   if (json) {
+      g_string_append(buf, (exp->sample_ct > 0) ? ",\n      " : "\n      ");
+      g_string_append_printf(buf, "{\"name\": \"%s\", \"labels\": {", name);
+   }
+   else {
+      g_string_append(buf, name);
+      if (label_ct > 0)
+         g_string_append_c(buf, '{');
+   }
+
+   va_list args;
+   va_start(args, label_ct);
+   for (int ndx = 0; ndx < label_ct; ndx++) {
+      const char * label_name  = va_arg(args, const char *);
+      const char * label_value = va_arg(args, const char *);
+      if (ndx > 0)
+         g_string_append(buf, (json) ? ", " : ",");
+      g_string_append_printf(buf, (json) ? "\"%s\": \"" : "%s=\"", label_name);
+      append_escaped(buf, label_value, json);
+      g_string_append_c(buf, '"');
+      if (key)
+         g_string_append_printf(key, "%c%s=\"%s\"", (ndx == 0) ? '{' : ',', label_name, label_value);
+   }
+   va_end(args);
+
+   if (key) {
+      double current = value;
+      if (exp->baseline) {
+         double * prior = g_hash_table_lookup(exp->baseline->counters, key->str);
+         if (prior && value >= *prior)     // else counter was reset
+            value -= *prior;
+      }
+      if (exp->capture) {
+         double * saved = g_new(double, 1);
+         *saved = current;
+         g_hash_table_replace(exp->capture->counters, g_strdup(key->str), saved);
+      }
+      g_string_free(key, true);
+   }
+
+   if (json) {
+      g_string_append(buf, "}, \"value\": ");
+      // JSON has no NaN
+      if (isnan(value))
+         g_string_append(buf, "null");
+      else
+         append_value(buf, value);
+      g_string_append_c(buf, '}');
+   }
+   else {
+      if (label_ct > 0)
+         g_string_append_c(buf, '}');
+      g_string_append_c(buf, ' ');
+      append_value(buf, value);
+      g_string_append_c(buf, '\n');
+   }
+   exp->sample_ct++;
+}
+
+
+/** Completes the output and frees the #Stats_Export instance.
+ *
+ *  \param  exp  export instance
+ *  \return exported statistics, caller must free
+ */
+char *
+stats_export_finish(Stats_Export * exp) {
+   assert(exp && memcmp(exp->marker, STATS_EXPORT_MARKER, 4) == 0);
+   end_metric(exp);
+   if (exp->format == DDCA_STATS_FORMAT_JSON)
+      g_string_append(exp->buf, "\n  ]\n}\n");
+   char * result = g_string_free(exp->buf, false);
+   exp->marker[3] = 'x';
+   g_free(exp);
+   return result;
+}
@@ -0,0 +1,59 @@
+/** \file stats_export.h
+ *
+ *  Writes statistics in machine readable formats.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef STATS_EXPORT_H_
+#define STATS_EXPORT_H_
+
+/** \cond */
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+/** \endcond */
+
+#include "ddcutil_types.h"
+
+typedef enum {
+   STATS_METRIC_COUNTER,
+   STATS_METRIC_GAUGE,
+   STATS_METRIC_SUMMARY
+} Stats_Metric_Type;
+
+typedef struct Latency_Baseline Latency_Baseline;   // see latency_stats.c
+
+#define STATS_CURSOR_MARKER "SCUR"
+/** Values of the statistics at some point in time, from which deltas are exported */
+typedef struct {
+   char               marker[4];
+   GHashTable *       counters;      // sample key -> double *, samples of counter metrics
+   Latency_Baseline * latency;       // copies of the latency histograms
+} Stats_Cursor;
+
+#define STATS_EXPORT_MARKER "SEXP"
+typedef struct {
+   char                     marker[4];
+   DDCA_Stats_Export_Format format;
+   GString *                buf;
+   bool                     in_metric;
+   int                      metric_ct;
+   int                      sample_ct;     // samples of current metric
+   Stats_Metric_Type        metric_type;   // of current metric
+   Stats_Cursor *           baseline;      // if set, counters are exported as deltas from it
+   Stats_Cursor *           capture;       // if set, receives the current values
+} Stats_Export;
+
+Stats_Cursor * stats_cursor_new();
+bool           stats_cursor_is_valid(void * cursor);
+void           stats_cursor_free(Stats_Cursor * cursor);
+
+Stats_Export * stats_export_new(DDCA_Stats_Export_Format format);
+Stats_Export * stats_export_new_with_cursor(DDCA_Stats_Export_Format format,
+                                            Stats_Cursor * baseline, Stats_Cursor * capture);
+void           stats_export_metric(Stats_Export * exp, const char * name, Stats_Metric_Type type, const char * help);
+void           stats_export_sample(Stats_Export * exp, const char * name, double value, int label_ct, ...);
+char *         stats_export_finish(Stats_Export * exp);
+
+#endif /* STATS_EXPORT_H_ */
@@ -0,0 +1,212 @@
+/** @file thread_sched.c
+ *
+ *  Optional real time scheduling and CPU affinity for threads that perform
+ *  DDC I/O, i.e. the asynchronous request workers and the display detection
+ *  threads.
+ *
+ *  DDC exchanges are sequences of writes, sleeps, and reads.  On a heavily
+ *  loaded system a thread waking from a sleep can be scheduled late, which
+ *  lengthens the interval between a write and the following read and can
+ *  exceed a monitor's reply timeout.  Running the threads with SCHED_FIFO or
+ *  SCHED_RR at a low real time priority reduces the wakeup latency.  Sleeps
+ *  performed by such threads are counted separately in the sleep statistics,
+ *  so the effect can be checked.
+ *
+ *  Setting a real time policy requires CAP_SYS_NICE or an RLIMIT_RTPRIO
+ *  limit.  If it fails the thread continues with normal scheduling.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#define _GNU_SOURCE      // for pthread_setaffinity_np()
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/rtti.h"
+
+#include "base/thread_sched.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_BASE;
+
+static GMutex    sched_mutex;                // protects the following
+static int       worker_policy = SCHED_OTHER;
+static int       worker_priority = 0;
+static bool      worker_affinity_set = false;
+static cpu_set_t worker_cpus;
+static bool      failure_reported = false;
+
+static GPrivate  realtime_thread_key;        // non-NULL if current thread uses real time policy
+
+
+/** Sets the scheduling policy for DDC I/O worker threads started subsequently.
+ *
+ *  @param  policy    SCHED_FIFO, SCHED_RR, or SCHED_OTHER
+ *  @param  priority  real time priority, ignored for SCHED_OTHER
+ *  @return true if the priority is valid for the policy, false if not
+ */
+bool set_worker_thread_sched_policy(int policy, int priority) {
+   bool debug = false;
+   bool ok = true;
+   if (policy != SCHED_OTHER) {
+      int minpri = sched_get_priority_min(policy);
+      int maxpri = sched_get_priority_max(policy);
+      ok = (minpri >= 0 && priority >= minpri && priority <= maxpri);
+   }
+   if (ok) {
+      g_mutex_lock(&sched_mutex);
+      worker_policy   = policy;
+      worker_priority = (policy == SCHED_OTHER) ? 0 : priority;
+      g_mutex_unlock(&sched_mutex);
+   }
+   DBGTRC(debug, TRACE_GROUP, "policy=%d, priority=%d. Returning %s",
+                              policy, priority, sbool(ok));
+   return ok;
+}
+
+
+/** Parses a policy name for #set_worker_thread_sched_policy().
+ *
+ *  @param  name  "fifo", "rr", or "other"
+ *  @return policy, -1 if name is invalid
+ */
+int parse_sched_policy_name(const char * name) {
+   int result = -1;
+   if (streq(name, "fifo"))
+      result = SCHED_FIFO;
+   else if (streq(name, "rr"))
+      result = SCHED_RR;
+   else if (streq(name, "other"))
+      result = SCHED_OTHER;
+   return result;
+}
+
+
+static bool
+parse_cpu_list(const char * cpu_list, cpu_set_t * cpus) {
+   CPU_ZERO(cpus);
+   Null_Terminated_String_Array pieces = strsplit(cpu_list, ",");
+   bool ok = (pieces[0] != NULL);
+   for (int ndx = 0; pieces[ndx] && ok; ndx++) {
+      int first = -1;
+      int last  = -1;
+      char * hyphen = strchr(pieces[ndx], '-');
+      if (hyphen) {
+         *hyphen = '\0';
+         ok = str_to_int(pieces[ndx], &first, 10) && str_to_int(hyphen+1, &last, 10);
+      }
+      else {
+         ok = str_to_int(pieces[ndx], &first, 10);
+         last = first;
+      }
+      ok = ok && first >= 0 && first <= last && last < CPU_SETSIZE;
+      for (int cpu = first; ok && cpu <= last; cpu++)
+         CPU_SET(cpu, cpus);
+   }
+   ntsa_free(pieces, true);
+   return ok;
+}
+
+
+/** Checks the syntax of a CPU list for #set_worker_thread_cpu_affinity().
+ *
+ *  @param  cpu_list  comma separated list of CPU numbers and ranges
+ *  @return true if valid, false if not
+ */
+bool is_valid_cpu_list(const char * cpu_list) {
+   cpu_set_t cpus;
+   return parse_cpu_list(cpu_list, &cpus);
+}
+
+
+/** Sets the CPUs on which DDC I/O worker threads started subsequently may run.
+ *
+ *  @param  cpu_list  comma separated list of CPU numbers and ranges,
+ *                    e.g. "0,2-3", or NULL to remove the restriction
+ *  @return true if cpu_list is valid, false if not
+ */
+bool set_worker_thread_cpu_affinity(const char * cpu_list) {
+   bool debug = false;
+   cpu_set_t cpus;
+   CPU_ZERO(&cpus);
+   bool ok = !cpu_list || parse_cpu_list(cpu_list, &cpus);
+   if (ok) {
+      g_mutex_lock(&sched_mutex);
+      worker_affinity_set = (cpu_list != NULL);
+      worker_cpus = cpus;
+      g_mutex_unlock(&sched_mutex);
+   }
+   DBGTRC(debug, TRACE_GROUP, "cpu_list=%s. Returning %s", cpu_list, sbool(ok));
+   return ok;
+}
+
+
+/** Applies the scheduling policy and CPU affinity set by
+ *  #set_worker_thread_sched_policy() and #set_worker_thread_cpu_affinity()
+ *  to the current thread.
+ *
+ *  Called at the start of each DDC I/O worker thread.  Failures are reported
+ *  once per process, after which the thread continues with its existing
+ *  scheduling.
+ */
+void apply_worker_thread_sched() {
+   bool debug = false;
+   g_mutex_lock(&sched_mutex);
+   int       policy       = worker_policy;
+   int       priority     = worker_priority;
+   bool      affinity_set = worker_affinity_set;
+   cpu_set_t cpus         = worker_cpus;
+   g_mutex_unlock(&sched_mutex);
+
+   if (policy != SCHED_OTHER) {
+      struct sched_param param = {.sched_priority = priority};
+      int rc = pthread_setschedparam(pthread_self(), policy, &param);
+      if (rc == 0) {
+         g_private_set(&realtime_thread_key, GINT_TO_POINTER(1));
+      }
+      else {
+         g_mutex_lock(&sched_mutex);
+         if (!failure_reported) {
+            f0printf(ferr(), "Unable to set real time scheduling for DDC I/O threads: %s\n",
+                             strerror(rc));
+            failure_reported = true;
+         }
+         g_mutex_unlock(&sched_mutex);
+      }
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "pthread_setschedparam() returned %d", rc);
+   }
+
+   if (affinity_set) {
+      int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "pthread_setaffinity_np() returned %d", rc);
+   }
+}
+
+
+/** Reports whether the current thread runs with a real time scheduling policy
+ *  set by #apply_worker_thread_sched().
+ *
+ *  @return true/false
+ */
+bool is_realtime_worker_thread() {
+   return g_private_get(&realtime_thread_key) != NULL;
+}
+
+
+void init_thread_sched() {
+   RTTI_ADD_FUNC(set_worker_thread_sched_policy);
+   RTTI_ADD_FUNC(set_worker_thread_cpu_affinity);
+   RTTI_ADD_FUNC(apply_worker_thread_sched);
+}
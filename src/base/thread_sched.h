@@ -0,0 +1,22 @@
+/** @file thread_sched.h
+ *
+ *  Optional real time scheduling and CPU affinity for DDC I/O worker threads
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef THREAD_SCHED_H_
+#define THREAD_SCHED_H_
+
+#include <stdbool.h>
+
+int  parse_sched_policy_name(const char * name);
+bool set_worker_thread_sched_policy(int policy, int priority);
+bool is_valid_cpu_list(const char * cpu_list);
+bool set_worker_thread_cpu_affinity(const char * cpu_list);
+void apply_worker_thread_sched();
+bool is_realtime_worker_thread();
+void init_thread_sched();
+
+#endif /* THREAD_SCHED_H_ */
@@ -24,6 +24,7 @@
 #include "base/parms.h"
 #include "base/core.h"
 #include "base/sleep.h"
+#include "base/stats_export.h"
 
 #include "base/per_thread_data.h"
 #include "base/thread_sleep_data.h"
@@ -76,21 +77,8 @@ void report_thread_sleep_data(Per_Thread_Data * data, int depth) {
    rpt_label(  d2,    "Number of function calls");
    rpt_vstring(d2,    "   that performed adjustment:      %d", data->sleep_multipler_changer_ct);
 
-   if ( data->dynamic_sleep_enabled ) {
-      rpt_label(  d1, "Dynamic Sleep Adjustment:  ");
-      rpt_vstring(d2, "Total successful reads:          %5d",   data->total_ok_status_count);
-      rpt_vstring(d2, "Total reads with DDC error:      %5d",   data->total_error_status_count);
-      rpt_vstring(d2, "Total ignored status codes:      %5d",   data->total_other_status_ct);
-      rpt_vstring(d2, "Current sleep adjustment factor: %5.2f", data->cur_sleep_adjustment_factor);
-//    rpt_vstring(d2, "Thread adjustment increment:     %5.2f", data->thread_adjustment_increment);
-      rpt_vstring(d2, "Adjustment check interval        %5d",   data->adjustment_check_interval);
-
-      rpt_vstring(d2, "Calls since last check:          %5d",   data->calls_since_last_check);
-      rpt_vstring(d2, "Total adjustment checks:         %5d",   data->total_adjustment_checks);
-      rpt_vstring(d2, "Number of adjustments:           %5d",   data->total_adjustment_ct);
-//    rpt_vstring(d2, "Number of excess adjustments:    %5d",   data->total_max_adjustment_ct);
-      rpt_vstring(d2, "Final sleep adjustment:          %5.2f", data->cur_sleep_adjustment_factor);
-   }
+   // n. dynamic sleep adjustment data is maintained per display,
+   // see dsa_report_all_display_data()
 }
 
 
@@ -128,6 +116,72 @@ void report_all_thread_sleep_data(int depth) {
 }
 
 
+// Collects the exported values of each thread, so that each metric can be
+// written for all threads in turn
+typedef struct {
+   pid_t  thread_id;
+   double sleep_multiplier_factor;
+   int    sleep_multiplier_ct;
+   int    highest_sleep_multiplier_value;
+   int    sleep_multipler_changer_ct;
+   bool   dynamic_sleep_enabled;
+} Thread_Sleep_Export;
+
+static void collect_thread_sleep_data(Per_Thread_Data * data, void * arg) {
+   GArray * collected = arg;
+   Thread_Sleep_Export cur = {
+         data->thread_id,
+         data->sleep_multiplier_factor,
+         data->sleep_multiplier_ct,
+         data->highest_sleep_multiplier_value,
+         data->sleep_multipler_changer_ct,
+         data->dynamic_sleep_enabled };
+   g_array_append_val(collected, cur);
+}
+
+
+/** Exports the sleep data of all threads, including those that have closed.
+ *
+ *  @param exp  export instance
+ */
+void export_all_thread_sleep_data(Stats_Export * exp) {
+   assert(per_thread_data_hash);
+   GArray * collected = g_array_new(false, false, sizeof(Thread_Sleep_Export));
+   ptd_apply_all_sorted(&collect_thread_sleep_data, collected);
+
+   struct {
+      const char *      name;
+      Stats_Metric_Type type;
+      const char *      help;
+   } metrics[] = {
+      {"ddcutil_thread_sleep_multiplier_factor", STATS_METRIC_GAUGE,   "Sleep multiplier factor"},
+      {"ddcutil_thread_sleep_multiplier_count",  STATS_METRIC_GAUGE,   "Current sleep multiplier adjustment"},
+      {"ddcutil_thread_sleep_multiplier_highest",STATS_METRIC_GAUGE,   "Highest sleep multiplier adjustment"},
+      {"ddcutil_thread_sleep_multiplier_changes_total",
+                                                 STATS_METRIC_COUNTER, "Number of calls that adjusted the sleep multiplier"},
+      {"ddcutil_thread_dynamic_sleep_enabled",   STATS_METRIC_GAUGE,   "1 if dynamic sleep adjustment is enabled"},
+   };
+   for (int mndx = 0; mndx < ARRAY_SIZE(metrics); mndx++) {
+      stats_export_metric(exp, metrics[mndx].name, metrics[mndx].type, metrics[mndx].help);
+      for (int ndx = 0; ndx < collected->len; ndx++) {
+         Thread_Sleep_Export * cur = &g_array_index(collected, Thread_Sleep_Export, ndx);
+         double value = 0;
+         switch(mndx) {
+         case 0: value = cur->sleep_multiplier_factor;         break;
+         case 1: value = cur->sleep_multiplier_ct;             break;
+         case 2: value = cur->highest_sleep_multiplier_value;  break;
+         case 3: value = cur->sleep_multipler_changer_ct;      break;
+         case 4: value = cur->dynamic_sleep_enabled;           break;
+         }
+         char tid_buf[20];
+         g_snprintf(tid_buf, sizeof(tid_buf), "%d", cur->thread_id);
+         stats_export_sample(exp, metrics[mndx].name, value, 1, "thread", tid_buf);
+      }
+   }
+   g_array_free(collected, true);
+}
+
+
 //
 // Obtain, initialize, and reset sleep data for current thread
 //
@@ -148,11 +202,9 @@ void init_thread_sleep_data(Per_Thread_Data * data) {
    data->sleep_multiplier_ct = default_sleep_multiplier_count;
    data->highest_sleep_multiplier_value = 1;
 
-   data->cur_sleep_adjustment_factor = 1.0;
    data->initialized = true;
    data->sleep_multiplier_factor = default_sleep_multiplier_factor;
    // data->thread_adjustment_increment = default_sleep_multiplier_factor;
-   data->adjustment_check_interval = 2;
 
    data->thread_sleep_data_defined = true;   // vs data->initialized
    DBGMSF(debug, "Done. sleep_multiplier_factor = %5.2f", data->sleep_multiplier_factor);
@@ -252,6 +304,34 @@ double tsd_get_sleep_multiplier_factor() {
 }
 
 
+/** Gets the sleep multiplier factor to use for a display, i.e. the
+ *  display's own setting if one has been set, otherwise the value for
+ *  the current thread.
+ *
+ *  @param  dref  display reference
+ *  @return sleep multiplier factor
+ */
+double tsd_get_display_sleep_multiplier_factor(Display_Ref * dref) {
+   if (dref && dref->io_settings.sleep_multiplier > 0)
+      return dref->io_settings.sleep_multiplier;
+   return tsd_get_sleep_multiplier_factor();
+}
+
+
+/** Reports whether dynamic sleep adjustment applies to a display, i.e.
+ *  the display's own setting if one has been set, otherwise the setting
+ *  for the current thread.
+ *
+ *  @param  dref  display reference
+ *  @return true if dynamic sleep adjustment is enabled
+ */
+bool tsd_get_display_dynamic_sleep_enabled(Display_Ref * dref) {
+   if (dref && dref->io_settings.dynamic_sleep != 0)
+      return dref->io_settings.dynamic_sleep > 0;
+   return tsd_get_thread_sleep_data()->dynamic_sleep_enabled;
+}
+
+
 /** Sets the sleep multiplier factor for the current thread.
  *
  *  @param factor  sleep multiplier factor
@@ -371,6 +451,12 @@ void tsd_enable_dynamic_sleep(bool enabled) {
 #endif
 
 
+// Ptd_Func signature
+static void set_dsa_enabled_by_data(Per_Thread_Data * data, void * arg) {
+   data->dynamic_sleep_enabled = GPOINTER_TO_INT(arg);
+}
+
+
 /** Enable or disable dynamic sleep adjustment on all existing threads
  *
  *  @param enable  true/false
@@ -381,16 +467,8 @@ void tsd_enable_dsa_all(bool enable) {
    bool debug = false;
    DBGMSF(debug, "Starting. enable = %s", sbool(enable) );
    default_dynamic_sleep_enabled = enable;  // for initializing new threads
-   if (per_thread_data_hash) {
-      GHashTableIter iter;
-      gpointer key, value;
-      g_hash_table_iter_init (&iter,per_thread_data_hash);
-      while (g_hash_table_iter_next (&iter, &key, &value)) {
-         Per_Thread_Data * data = value;
-         DBGMSF(debug, "Thread id: %d", data->thread_id);
-         data->dynamic_sleep_enabled = enable;
-      }
-   }
+   if (per_thread_data_hash)
+      ptd_apply_all(set_dsa_enabled_by_data, GINT_TO_POINTER(enable));
    ptd_cross_thread_operation_end();
 }
 
@@ -12,6 +12,7 @@
 
 
 #include "base/per_thread_data.h"
+#include "base/stats_export.h"
 
 
 void init_thread_sleep_data(Per_Thread_Data * data);
@@ -42,6 +43,10 @@ double tsd_get_default_sleep_multiplier_factor();
 double tsd_get_sleep_multiplier_factor();
 void   tsd_set_sleep_multiplier_factor(double factor);
 
+//  Per display overrides of the per thread settings
+double tsd_get_display_sleep_multiplier_factor(Display_Ref * dref);
+bool   tsd_get_display_dynamic_sleep_enabled(Display_Ref * dref);
+
 //  sleep_multiplier_ct is set by functions performing I2C retry
 //  Per thread
 int    tsd_get_sleep_multiplier_ct();
@@ -51,5 +56,6 @@ void   tsd_bump_sleep_multiplier_changer_ct();
 // Reporting
 void   report_thread_sleep_data(Per_Thread_Data * data, int depth);
 void   report_all_thread_sleep_data(int depth);
+void   export_all_thread_sleep_data(Stats_Export * exp);
 
 #endif /* THREAD_SLEEP_DATA_H_ */
@@ -0,0 +1,212 @@
+/** \file trace_ring.c
+ *
+ *  Per-thread ring buffers of binary trace events.
+ *
+ *  Unlike the DBGTRC macros, which format their message when called,
+ *  #TRACE_EVENT() stores only a timestamp, an event id, and a few integer
+ *  arguments in a fixed size ring buffer owned by the current thread.
+ *  Recording takes no lock and does not allocate, so it can be left
+ *  enabled in production.  The events are formatted only when the buffers
+ *  are dumped using #report_trace_ring(), e.g. after an intermittent
+ *  failure has occurred.
+ *
+ *  Each ring holds the most recent #TRACE_RING_EVENT_CT events of its
+ *  thread.  Rings are retained after their thread terminates, so that
+ *  its events are still reported.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/linux_util.h"
+#include "util/report_util.h"
+#include "util/timestamp.h"
+
+#include "base/parms.h"
+
+#include "base/trace_ring.h"
+
+
+bool trace_ring_enabled = DEFAULT_ENABLE_TRACE_RING;
+
+static struct {
+   const char * name;
+   const char * format;
+} trace_event_info[] = {
+   {"WRITE_READ_START",  "busno=%d, max_read_bytes=%d"},
+   {"WRITE_READ_DONE",   "busno=%d, rc=%d"},
+   {"WRITE_ONLY_DONE",   "busno=%d, rc=%d"},
+   {"TRY_DONE",          "retry_type=%d, tries=%d, rc=%d"},
+   {"I2C_WRITE",         "fd=%d, bytect=%d, rc=%d"},
+   {"I2C_READ",          "fd=%d, bytect=%d, rc=%d"},
+   {"I2C_WRITE_READ",    "fd=%d, write_bytect=%d, read_bytect=%d, rc=%d"},
+   {"SLEEP",             "busno=%d, event=%d, requested_micros=%d, deferred=%d"},
+};
+
+#define TRACE_RING_MARKER "TRRG"
+typedef struct {
+   char        marker[4];
+   intmax_t    thread_id;
+   uint32_t    event_ct;       // total events recorded, next slot is event_ct % TRACE_RING_EVENT_CT
+   Trace_Event events[TRACE_RING_EVENT_CT];
+} Trace_Ring;
+
+static GPrivate   trace_ring_key = G_PRIVATE_INIT(NULL);   // rings are never freed
+static GPtrArray* trace_rings = NULL;
+static GMutex     trace_rings_mutex;
+
+
+/** Enables or disables recording of trace events.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global, not thread-specific.
+ */
+bool enable_trace_ring(bool onoff) {
+   bool old = trace_ring_enabled;
+   trace_ring_enabled = onoff;
+   return old;
+}
+
+
+/** Returns the name of a trace event */
+const char * trace_event_name(Trace_Event_Id id) {
+   assert(sizeof(trace_event_info)/sizeof(trace_event_info[0]) == TRACE_EVENT_ID_CT);
+   return (id >= 0 && id < TRACE_EVENT_ID_CT) ? trace_event_info[id].name : "UNKNOWN";
+}
+
+
+static Trace_Ring *
+get_thread_trace_ring() {
+   Trace_Ring * ring = g_private_get(&trace_ring_key);
+   if (!ring) {
+      ring = calloc(1, sizeof(Trace_Ring));
+      memcpy(ring->marker, TRACE_RING_MARKER, 4);
+      ring->thread_id = get_thread_id();
+      g_private_set(&trace_ring_key, ring);
+
+      g_mutex_lock(&trace_rings_mutex);
+      if (!trace_rings)
+         trace_rings = g_ptr_array_new();
+      g_ptr_array_add(trace_rings, ring);
+      g_mutex_unlock(&trace_rings_mutex);
+   }
+   return ring;
+}
+
+
+/** Records an event in the current thread's ring buffer.
+ *
+ *  Normally called using macro #TRACE_EVENT().
+ */
+void trace_ring_record(
+      Trace_Event_Id id,
+      int32_t        arg0,
+      int32_t        arg1,
+      int32_t        arg2,
+      int32_t        arg3)
+{
+   Trace_Ring * ring = get_thread_trace_ring();
+   uint32_t ct = ring->event_ct;
+   Trace_Event * event = &ring->events[ct % TRACE_RING_EVENT_CT];
+   event->timestamp = cur_monotonic_nanosec();
+   event->event_id  = id;
+   event->args[0]   = arg0;
+   event->args[1]   = arg1;
+   event->args[2]   = arg2;
+   event->args[3]   = arg3;
+   // publish the event to report_trace_ring()
+   __atomic_store_n(&ring->event_ct, ct+1, __ATOMIC_RELEASE);
+}
+
+
+/** Discards the events recorded by all threads.
+ *
+ *  \remark
+ *  Events being recorded concurrently may or may not be discarded.
+ */
+void reset_trace_ring() {
+   g_mutex_lock(&trace_rings_mutex);
+   if (trace_rings) {
+      for (int ndx = 0; ndx < trace_rings->len; ndx++) {
+         Trace_Ring * ring = g_ptr_array_index(trace_rings, ndx);
+         __atomic_store_n(&ring->event_ct, 0, __ATOMIC_RELEASE);
+      }
+   }
+   g_mutex_unlock(&trace_rings_mutex);
+}
+
+
+typedef struct {
+   Trace_Event event;
+   intmax_t    thread_id;
+} Thread_Trace_Event;
+
+static gint
+thread_trace_event_compare(gconstpointer a, gconstpointer b) {
+   const Thread_Trace_Event * e1 = a;
+   const Thread_Trace_Event * e2 = b;
+   return (e1->event.timestamp < e2->event.timestamp) ? -1 :
+          (e1->event.timestamp > e2->event.timestamp) ?  1 : 0;
+}
+
+
+/** Reports the events recorded by all threads, in time order.
+ *
+ *  \param depth  logical indentation depth
+ *
+ *  \remark
+ *  Events are copied without stopping the threads recording them, so
+ *  the oldest events of a busy thread may have been overwritten while
+ *  being copied.
+ */
+void report_trace_ring(int depth) {
+   GArray * events = g_array_new(false, false, sizeof(Thread_Trace_Event));
+
+   g_mutex_lock(&trace_rings_mutex);
+   if (trace_rings) {
+      for (int ndx = 0; ndx < trace_rings->len; ndx++) {
+         Trace_Ring * ring = g_ptr_array_index(trace_rings, ndx);
+         uint32_t ct = __atomic_load_n(&ring->event_ct, __ATOMIC_ACQUIRE);
+         uint32_t first = (ct > TRACE_RING_EVENT_CT) ? ct - TRACE_RING_EVENT_CT : 0;
+         for (uint32_t seqno = first; seqno < ct; seqno++) {
+            Thread_Trace_Event tte;
+            tte.event     = ring->events[seqno % TRACE_RING_EVENT_CT];
+            tte.thread_id = ring->thread_id;
+            g_array_append_val(events, tte);
+         }
+      }
+   }
+   g_mutex_unlock(&trace_rings_mutex);
+
+   g_array_sort(events, thread_trace_event_compare);
+
+   rpt_vstring(depth, "Trace events (%d):", events->len);
+   uint64_t base = (events->len > 0) ? g_array_index(events, Thread_Trace_Event, 0).event.timestamp : 0;
+   for (int ndx = 0; ndx < events->len; ndx++) {
+      Thread_Trace_Event * tte = &g_array_index(events, Thread_Trace_Event, ndx);
+      Trace_Event * ev = &tte->event;
+      char buf[100] = "";
+      if (ev->event_id >= 0 && ev->event_id < TRACE_EVENT_ID_CT) {
+         // formats consume at most TRACE_EVENT_ARG_CT arguments, any excess is ignored
+         g_snprintf(buf, sizeof(buf), trace_event_info[ev->event_id].format,
+                    ev->args[0], ev->args[1], ev->args[2], ev->args[3]);
+      }
+      rpt_vstring(depth+1, "+%10.3f ms  [%6jd] %-18s %s",
+                  (ev->timestamp - base) / 1000000.0,
+                  tte->thread_id,
+                  trace_event_name(ev->event_id),
+                  buf);
+   }
+   g_array_free(events, true);
+}
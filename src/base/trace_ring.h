@@ -0,0 +1,67 @@
+/** \file trace_ring.h
+ *
+ *  Per-thread ring buffers of binary trace events
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef TRACE_RING_H_
+#define TRACE_RING_H_
+
+#include "config.h"
+
+/** \cond */
+#include <stdbool.h>
+#include <stdint.h>
+/** \endcond */
+
+/** Trace event identifiers.
+ *  Each event records up to #TRACE_EVENT_ARG_CT integer arguments,
+ *  whose meaning is given by the event's format string in trace_ring.c.
+ */
+typedef enum {
+   TRE_WRITE_READ_START,    ///< busno, max_read_bytes
+   TRE_WRITE_READ_DONE,     ///< busno, status code
+   TRE_WRITE_ONLY_DONE,     ///< busno, status code
+   TRE_TRY_DONE,            ///< retry type, tries, status code
+   TRE_I2C_WRITE,           ///< fd, bytect, rc
+   TRE_I2C_READ,            ///< fd, bytect, rc
+   TRE_I2C_WRITE_READ,      ///< fd, write bytect, read bytect, rc
+   TRE_SLEEP,               ///< busno, sleep event type, requested microsec, deferred
+} Trace_Event_Id;
+#define TRACE_EVENT_ID_CT (TRE_SLEEP+1)
+
+#define TRACE_EVENT_ARG_CT 4
+
+typedef struct {
+   uint64_t       timestamp;                    ///< nanosec, CLOCK_MONOTONIC
+   Trace_Event_Id event_id;
+   int32_t        args[TRACE_EVENT_ARG_CT];
+} Trace_Event;
+
+extern bool trace_ring_enabled;
+
+void trace_ring_record(Trace_Event_Id id, int32_t arg0, int32_t arg1, int32_t arg2, int32_t arg3);
+
+/** Records a trace event in the current thread's ring buffer.
+ *
+ *  If recording is disabled this costs a single test of #trace_ring_enabled.
+ *  If ddcutil is configured with --disable-trace-ring the call is
+ *  compiled out entirely.
+ */
+#ifdef ENABLE_TRACE_RING
+#define TRACE_EVENT(_id, _arg0, _arg1, _arg2, _arg3) \
+   do { if (trace_ring_enabled) \
+           trace_ring_record((_id), (_arg0), (_arg1), (_arg2), (_arg3)); } while(0)
+#else
+#define TRACE_EVENT(_id, _arg0, _arg1, _arg2, _arg3) \
+   do { } while(0)
+#endif
+
+bool         enable_trace_ring(bool onoff);
+const char * trace_event_name(Trace_Event_Id id);
+void         reset_trace_ring();
+void         report_trace_ring(int depth);
+
+#endif /* TRACE_RING_H_ */
@@ -0,0 +1,230 @@
+/** \file trace_writer.c
+ *
+ *  Background thread that writes trace and system log messages.
+ *
+ *  Formatting a trace message is cheap, but writing it to a file, which is
+ *  flushed after every message, or to the system log is not.  When tracing
+ *  DDC I/O, that time is added between the write and the read of an
+ *  exchange, which changes the timing being investigated.
+ *
+ *  When the writer is active, #vdbgtrc() instead pushes the formatted
+ *  message onto a queue, and returns.  The queue is a singly linked stack
+ *  updated using atomic operations, so queueing a message takes no lock.
+ *  Every #TRACE_WRITER_INTERVAL_MILLIS the writer thread takes all queued
+ *  messages, restores their original order, writes them using buffered
+ *  output, and flushes each destination once.
+ *
+ *  The queue is drained when the writer is stopped, at exit, and, using
+ *  unbuffered writes, if the process is terminated by a fatal signal.
+ *  Messages are written synchronously if the writer is not active or more
+ *  than #TRACE_WRITER_MAX_PENDING messages are queued.
+ *
+ *  Since trace messages are written later, they are no longer interleaved
+ *  exactly with other output to the same destination.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+/** \endcond */
+
+#include "base/parms.h"
+
+#include "base/trace_writer.h"
+
+typedef struct Trace_Writer_Msg {
+   struct Trace_Writer_Msg * next;
+   FILE *                    dest;        // NULL if to_syslog
+   bool                      to_syslog;
+   char                      text[];
+} Trace_Writer_Msg;
+
+static Trace_Writer_Msg * queue_head = NULL;   // most recently queued, atomic access
+static int                pending_ct = 0;      // atomic access
+static bool               writer_active = false;
+static bool               stop_requested = false;
+static GThread *          writer_thread = NULL;
+static GMutex             drain_mutex;         // serializes draining the queue
+static bool               atexit_registered = false;
+
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGABRT, SIGFPE, SIGILL};
+
+
+// Takes all queued messages, returning them oldest first
+static Trace_Writer_Msg *
+take_queued_messages() {
+   Trace_Writer_Msg * newest = __atomic_exchange_n(&queue_head, NULL, __ATOMIC_ACQ_REL);
+   Trace_Writer_Msg * oldest = NULL;
+   while (newest) {
+      Trace_Writer_Msg * next = newest->next;
+      newest->next = oldest;
+      oldest = newest;
+      newest = next;
+   }
+   return oldest;
+}
+
+
+static void
+drain_queue() {
+   g_mutex_lock(&drain_mutex);
+   FILE * dests[4];
+   int    dest_ct = 0;
+   Trace_Writer_Msg * msg = take_queued_messages();
+   while (msg) {
+      Trace_Writer_Msg * next = msg->next;
+      if (msg->to_syslog) {
+         syslog(LOG_INFO, "%s", msg->text);
+      }
+      else {
+         fputs(msg->text, msg->dest);
+         fputc('\n', msg->dest);
+         int ndx = 0;
+         while (ndx < dest_ct && dests[ndx] != msg->dest)
+            ndx++;
+         if (ndx == dest_ct) {
+            if (dest_ct < 4)
+               dests[dest_ct++] = msg->dest;
+            else
+               fflush(msg->dest);
+         }
+      }
+      __atomic_sub_fetch(&pending_ct, 1, __ATOMIC_RELAXED);
+      free(msg);
+      msg = next;
+   }
+   for (int ndx = 0; ndx < dest_ct; ndx++)
+      fflush(dests[ndx]);
+   g_mutex_unlock(&drain_mutex);
+}
+
+
+static gpointer
+trace_writer_thread_func(gpointer data) {
+   while (!__atomic_load_n(&stop_requested, __ATOMIC_ACQUIRE)) {
+      g_usleep(TRACE_WRITER_INTERVAL_MILLIS * 1000);
+      drain_queue();
+   }
+   drain_queue();
+   return NULL;
+}
+
+
+// Writes the messages still queued using only async-signal-safe calls,
+// then terminates the process with the original signal.
+static void
+fatal_signal_handler(int signum) {
+   Trace_Writer_Msg * msg = take_queued_messages();
+   for (; msg; msg = msg->next) {
+      if (msg->dest) {
+         int fd = fileno(msg->dest);
+         ssize_t rc = write(fd, msg->text, strlen(msg->text));
+         if (rc >= 0)
+            rc = write(fd, "\n", 1);
+         (void) rc;
+      }
+   }
+   signal(signum, SIG_DFL);
+   raise(signum);
+}
+
+
+/** Starts the trace writer thread.
+ *
+ *  \return true if the writer is active, false if the thread could not be started
+ */
+bool start_trace_writer() {
+   if (writer_active)
+      return true;
+   __atomic_store_n(&stop_requested, false, __ATOMIC_RELEASE);
+   GError * error = NULL;
+   writer_thread = g_thread_try_new("trace_writer", trace_writer_thread_func, NULL, &error);
+   if (!writer_thread) {
+      fprintf(stderr, "Unable to start trace writer thread: %s\n", error->message);
+      g_error_free(error);
+      return false;
+   }
+
+   struct sigaction action;
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = fatal_signal_handler;
+   sigemptyset(&action.sa_mask);
+   action.sa_flags = SA_RESETHAND;
+   for (int ndx = 0; ndx < sizeof(fatal_signals)/sizeof(fatal_signals[0]); ndx++)
+      sigaction(fatal_signals[ndx], &action, NULL);
+   if (!atexit_registered) {
+      atexit(stop_trace_writer);
+      atexit_registered = true;
+   }
+   __atomic_store_n(&writer_active, true, __ATOMIC_RELEASE);
+   return true;
+}
+
+
+/** Stops the trace writer thread, after it has written all queued messages.
+ *  Subsequent messages are written synchronously.
+ */
+void stop_trace_writer() {
+   if (!__atomic_exchange_n(&writer_active, false, __ATOMIC_ACQ_REL))
+      return;
+   __atomic_store_n(&stop_requested, true, __ATOMIC_RELEASE);
+   g_thread_join(writer_thread);
+   writer_thread = NULL;
+   drain_queue();    // messages queued while the thread was stopping
+   for (int ndx = 0; ndx < sizeof(fatal_signals)/sizeof(fatal_signals[0]); ndx++)
+      signal(fatal_signals[ndx], SIG_DFL);
+}
+
+
+/** Writes all queued messages, without waiting for the writer thread.
+ *  Used before a destination is closed.
+ */
+void flush_trace_writer() {
+   drain_queue();
+}
+
+
+/** Reports whether trace messages are being queued for the writer thread.
+ *
+ *  \return true/false
+ */
+bool is_trace_writer_active() {
+   return __atomic_load_n(&writer_active, __ATOMIC_ACQUIRE);
+}
+
+
+/** Queues a message for the writer thread.
+ *
+ *  \param  dest       where to write the message, ignored if to_syslog
+ *  \param  to_syslog  write the message to the system log
+ *  \param  text       message text, without trailing newline
+ *  \return true if queued, false if the caller should write the message
+ */
+bool trace_writer_enqueue(FILE * dest, bool to_syslog, const char * text) {
+   if (!is_trace_writer_active() ||
+       __atomic_load_n(&pending_ct, __ATOMIC_RELAXED) >= TRACE_WRITER_MAX_PENDING)
+      return false;
+   assert(dest || to_syslog);
+
+   int textlen = strlen(text);
+   Trace_Writer_Msg * msg = malloc(sizeof(Trace_Writer_Msg) + textlen + 1);
+   msg->dest      = (to_syslog) ? NULL : dest;
+   msg->to_syslog = to_syslog;
+   memcpy(msg->text, text, textlen+1);
+   __atomic_add_fetch(&pending_ct, 1, __ATOMIC_RELAXED);
+
+   msg->next = __atomic_load_n(&queue_head, __ATOMIC_RELAXED);
+   while (!__atomic_compare_exchange_n(&queue_head, &msg->next, msg,
+                                       true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      ;
+   return true;
+}
@@ -0,0 +1,23 @@
+/** \file trace_writer.h
+ *
+ *  Background thread that writes trace and system log messages.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef TRACE_WRITER_H_
+#define TRACE_WRITER_H_
+
+/** \cond */
+#include <stdbool.h>
+#include <stdio.h>
+/** \endcond */
+
+bool start_trace_writer();
+void stop_trace_writer();
+void flush_trace_writer();
+bool is_trace_writer_active();
+bool trace_writer_enqueue(FILE * dest, bool to_syslog, const char * text);
+
+#endif /* TRACE_WRITER_H_ */
@@ -8,16 +8,25 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <assert.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
 #include <sys/types.h>
 
 #include "public/ddcutil_types.h"
 
+#include "util/timestamp.h"
+
 #include "base/core.h"
 #include "base/dynamic_sleep.h"
 #include "base/execution_stats.h"
+#include "base/io_timeline.h"
+#include "base/latency_stats.h"
+#include "base/op_profile.h"
 #include "base/rtti.h"
+#include "base/shared_sleep.h"
 #include "base/sleep.h"
 #include "base/thread_sleep_data.h"
+#include "base/trace_ring.h"
 
 // Trace class for this file
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_NONE;
@@ -36,6 +45,7 @@ static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_NONE;
 //
 
 static bool deferred_sleep_enabled = false;
+static GPrivate thread_deferred_sleep_key;    // deferred sleep forced for current thread
 
 
 /** Enables or disables deferred sleep.
@@ -58,6 +68,22 @@ bool is_deferred_sleep_enabled() {
 }
 
 
+/** Enables or disables deferred sleep for the current thread only,
+ *  irrespective of the global setting.
+ *
+ *  Used by operations such as batched feature reads, which know that
+ *  the next DDC request follows immediately.
+ *
+ *  @param  onoff new setting
+ *  @return old setting
+ */
+bool enable_deferred_sleep_for_thread(bool onoff) {
+   bool old = GPOINTER_TO_INT(g_private_get(&thread_deferred_sleep_key));
+   g_private_set(&thread_deferred_sleep_key, GINT_TO_POINTER(onoff));
+   return old;
+}
+
+
 //
 // Perform sleep
 //
@@ -77,9 +103,10 @@ bool is_deferred_sleep_enabled() {
  *  The time is further adjusted by the sleep factor and sleep multiplier
  *  currently in effect.
  *
- *  @todo
- *  Take into account the time since the last monitor return in the
- *  current thread.
+ *  With dynamic sleep adjustment, the write to read sleep of the first
+ *  exchange after an idle gap is lengthened as learned for the display, see
+ *  #dsa_get_idle_adjustment_factor().
+ *
  *  @todo
  *  Take into account per-display error statistics.  Would require
  *  error statistics be maintained on a per-display basis, either
@@ -91,28 +118,37 @@ bool is_deferred_sleep_enabled() {
  * @param lineno      line number in file where sleep was invoked
  * @param filename    name of file from which sleep was invoked
  * @param msg         text to append to trace message
+ * @param no_sleep    if true, do not sleep, only calculate the deadline
+ * @return time until which the display should not be accessed,
+ *         nanosec, CLOCK_MONOTONIC
  */
-void tuned_sleep_with_trace(
+static uint64_t
+tuned_sleep_internal(
       Display_Handle * dh,
       Sleep_Event_Type event_type,
       int              special_sleep_time_millis,
       const char *     func,
       int              lineno,
       const char *     filename,
-      const char *     msg)
+      const char *     msg,
+      bool             no_sleep)
 {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP,
-         "Sleep event type = %s, dh=%s, special_sleep_time_millis=%d",
-         sleep_event_name(event_type), dh_repr(dh), special_sleep_time_millis);
+         "Sleep event type = %s, dh=%s, special_sleep_time_millis=%d, no_sleep=%s",
+         sleep_event_name(event_type), dh_repr(dh), special_sleep_time_millis, sbool(no_sleep));
    assert(dh);
    assert( (event_type != SE_SPECIAL && special_sleep_time_millis == 0) ||
            (event_type == SE_SPECIAL && special_sleep_time_millis >  0) );
 
    DDCA_IO_Mode io_mode = dh->dref->io_path.io_mode;
+   if (io_mode == DDCA_IO_I2C)
+      shared_sleep_record_io_completed(dh->dref->io_path.path.i2c_busno);
 
    int spec_sleep_time_millis = 0;    // should be a default
    bool deferrable_sleep = false;
+   bool defer_ok = deferred_sleep_enabled ||
+                   GPOINTER_TO_INT(g_private_get(&thread_deferred_sleep_key));
 
    if (io_mode == DDCA_IO_I2C) {
       switch(event_type) {
@@ -133,16 +169,16 @@ void tuned_sleep_with_trace(
             // 4.4 Set VCP Feature:
             //   The host should wait at least 50ms to ensure next message is received by the display
             spec_sleep_time_millis = DDC_TIMEOUT_MILLIS_POST_NORMAL_COMMAND;
-            deferrable_sleep = deferred_sleep_enabled;
+            deferrable_sleep = defer_ok;
             break;
       case (SE_POST_READ):
-            deferrable_sleep = deferred_sleep_enabled;
+            deferrable_sleep = defer_ok;
             spec_sleep_time_millis = DDC_TIMEOUT_MILLIS_POST_NORMAL_COMMAND;
             break;
       case (SE_POST_SAVE_SETTINGS):
             // 4.5 Save Current Settings:
             // The host should wait at least 200 ms before sending the next message to the display
-            deferrable_sleep = deferred_sleep_enabled;
+            deferrable_sleep = defer_ok;
             spec_sleep_time_millis = DDC_TIMEOUT_MILLIS_POST_SAVE_SETTINGS;   // per DDC spec
             break;
       case SE_MULTI_PART_WRITE_TO_READ:
@@ -165,7 +201,7 @@ void tuned_sleep_with_trace(
       case SE_POST_CAP_TABLE_COMMAND:
          // unused, SE_AFTER_EACH_CAP_TABLE_SEGMENT called after each segment, not
          // just between segments
-         deferrable_sleep = deferred_sleep_enabled;
+         deferrable_sleep = defer_ok;
          spec_sleep_time_millis = DDC_TIMEOUT_MILLIS_POST_CAP_TABLE_COMMAND;
          break;
 
@@ -194,7 +230,6 @@ void tuned_sleep_with_trace(
 
    // TODO:
    //   get error rate (total calls, total errors), current adjustment value
-   //   adjust by time since last i2c event
 
    Per_Thread_Data * tsd = tsd_get_thread_sleep_data();
 
@@ -207,55 +242,130 @@ void tuned_sleep_with_trace(
           spec_sleep_time_millis,
           tsd->sleep_multiplier_factor, sbool(deferrable_sleep) );
 
-   int adjusted_sleep_time_millis = spec_sleep_time_millis; // will be changed
-   double sleep_multiplier_factor = tsd_get_sleep_multiplier_factor();  // set by --sleep-multiplier
-   if (tsd->dynamic_sleep_enabled) {
-      dsa_update_adjustment_factor(dh, spec_sleep_time_millis);
-      adjusted_sleep_time_millis =
-            tsd->cur_sleep_adjustment_factor * sleep_multiplier_factor * spec_sleep_time_millis;
+   uint64_t adjusted_sleep_time_micros = spec_sleep_time_millis * 1000; // will be changed
+   // set by --sleep-multiplier, or for the display
+   double sleep_multiplier_factor = tsd_get_display_sleep_multiplier_factor(dh->dref);
+   if (tsd_get_display_dynamic_sleep_enabled(dh->dref)) {
+      double dsa_factor = dsa_update_adjustment_factor(dh, event_type, spec_sleep_time_millis);
+      // only a write/read exchange has a status code to learn from
+      double idle_factor = (event_type == SE_WRITE_TO_READ)
+                                ? dsa_get_idle_adjustment_factor(dh, dsa_factor) : 1.0;
+      adjusted_sleep_time_micros =
+            dsa_factor * idle_factor * sleep_multiplier_factor * spec_sleep_time_millis * 1000;
       DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE,
                 "using dynamic sleep: true,"
                 " adjustment factor: %4.2f,"
-                " adjusted_sleep_time_millis = %d",
-                tsd->cur_sleep_adjustment_factor,
-                adjusted_sleep_time_millis);
+                " idle adjustment factor: %4.2f,"
+                " adjusted_sleep_time_micros = %"PRIu64,
+                dsa_factor,
+                idle_factor,
+                adjusted_sleep_time_micros);
    }
    else {
       // DBGMSG("sleep_multiplier_factor = %5.2f", sleep_multiplier_factor);
       // crude, should be sensitive to event type?
       int sleep_multiplier_ct = tsd_get_sleep_multiplier_ct();  // per thread
-      adjusted_sleep_time_millis = sleep_multiplier_ct * sleep_multiplier_factor *
-                                          spec_sleep_time_millis;
+      adjusted_sleep_time_micros = sleep_multiplier_ct * sleep_multiplier_factor *
+                                          spec_sleep_time_millis * 1000;
       DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE,
              "using dynamic sleep: false,"
              " sleep_multiplier_ct = %d,"
-             " modified_sleep_time_millis=%d",
+             " modified_sleep_time_micros=%"PRIu64,
              sleep_multiplier_ct,
-             adjusted_sleep_time_millis);
+             adjusted_sleep_time_micros);
    }
 
    record_sleep_event(event_type);
+   TRACE_EVENT(TRE_SLEEP, dh->dref->io_path.path.i2c_busno, event_type,
+               adjusted_sleep_time_micros, deferrable_sleep || no_sleep);
+
+   // message is only used for tracing
+   char msg_buf[100] = "";
+   if (dbgtrc_any_enabled) {
+      const char * evname = sleep_event_name(event_type);
+      if (msg)
+         g_snprintf(msg_buf, 100, "Event type: %s, %s", evname, msg);
+      else
+         g_snprintf(msg_buf, 100, "Event_type: %s", evname);
+   }
 
-   char msg_buf[100];
-   const char * evname = sleep_event_name(event_type);
-   if (msg)
-      g_snprintf(msg_buf, 100, "Event type: %s, %s", evname, msg);
-   else
-      g_snprintf(msg_buf, 100, "Event_type: %s", evname);
-
-   if (deferrable_sleep) {
-      uint64_t new_deferred_time =
-            cur_realtime_nanosec() + (1000 *1000) * (int) adjusted_sleep_time_millis;
-      if (new_deferred_time > dh->dref->next_i2c_io_after) {
+   uint64_t deadline = cur_monotonic_nanosec() + 1000 * adjusted_sleep_time_micros;
+   // let other processes using the bus know when it is next available
+   shared_sleep_set_next_io_after(dh->dref->io_path.path.i2c_busno, deadline);
+   if (deferrable_sleep || no_sleep) {
+      if (deadline > dh->dref->next_i2c_io_after) {
          DBGTRC(debug, DDCA_TRC_NONE, "Setting deferred sleep");
-         dh->dref->next_i2c_io_after = new_deferred_time;
+         dh->dref->next_i2c_io_after = deadline;
       }
    }
    else {
-      sleep_millis_with_trace(adjusted_sleep_time_millis, func, lineno, filename, msg_buf);
+      uint64_t start_nanos = cur_monotonic_nanosec();
+      sleep_until_with_trace(deadline, func, lineno, filename, msg_buf);
+      uint64_t actual_nanos = cur_monotonic_nanosec() - start_nanos;
+      record_sleep_latency(event_type, 1000 * adjusted_sleep_time_micros, actual_nanos);
+      op_profile_add(OPC_TUNED_SLEEP, actual_nanos);
+      IO_TIMELINE_RECORD(dh->dref->io_path.path.i2c_busno, TLE_SLEEP, sleep_event_name(event_type),
+                         start_nanos, adjusted_sleep_time_micros, 0);
    }
 
-   DBGTRC_DONE(debug, TRACE_GROUP, "");
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %"PRIu64, deadline);
+   return deadline;
+}
+
+
+void tuned_sleep_with_trace(
+      Display_Handle * dh,
+      Sleep_Event_Type event_type,
+      int              special_sleep_time_millis,
+      const char *     func,
+      int              lineno,
+      const char *     filename,
+      const char *     msg)
+{
+   tuned_sleep_internal(dh, event_type, special_sleep_time_millis,
+                        func, lineno, filename, msg, false);
+}
+
+
+/** Calculates the time until which a display must not be accessed after a
+ *  sleep event, as #tuned_sleep_with_trace() would, but does not sleep.
+ *
+ *  The deadline is recorded in the display reference, so that the next
+ *  #check_deferred_sleep() for the display honors it.  This allows a
+ *  single thread to perform IO on multiple displays, accessing each
+ *  one when its deadline has passed instead of sleeping.
+ *
+ *  @param  dh          display handle
+ *  @param  event_type  reason for sleep
+ *  @return deadline, nanosec, CLOCK_MONOTONIC
+ */
+uint64_t tuned_sleep_deadline(
+      Display_Handle * dh,
+      Sleep_Event_Type event_type)
+{
+   return tuned_sleep_internal(dh, event_type, 0, __func__, __LINE__, __FILE__, NULL, true);
+}
+
+
+/** Returns the time before which the display must not be accessed, i.e. the
+ *  time until which #check_deferred_sleep() would sleep.
+ *
+ *  If cross-process coordination is enabled, the time recorded for the bus
+ *  by other processes is also considered.
+ *
+ *  @param  dh   #Display_Handle
+ *  @return nanosec, CLOCK_MONOTONIC
+ */
+uint64_t deferred_sleep_deadline(Display_Handle * dh) {
+   uint64_t next_io_after = dh->dref->next_i2c_io_after;
+   if (dh->dref->io_path.io_mode == DDCA_IO_I2C) {
+      // another process may have used the bus more recently
+      uint64_t shared_next_io_after =
+            shared_sleep_get_next_io_after(dh->dref->io_path.path.i2c_busno);
+      if (shared_next_io_after > next_io_after)
+         next_io_after = shared_next_io_after;
+   }
+   return next_io_after;
 }
 
 
@@ -263,7 +373,9 @@ void tuned_sleep_with_trace(
  *  for a display handle, and if so sleeps for the difference.
  *
  *  The delayed io start time is stored in the display reference associated with
- *  the display handle, so persists across open and close
+ *  the display handle, so persists across open and close.  If cross-process
+ *  coordination is enabled, the time recorded for the bus by other processes
+ *  is also considered.
  *
  *  @param  dh        #Display_Handle
  *  #param  func      name of function performing check
@@ -277,14 +389,17 @@ void check_deferred_sleep(
       const char *     filename)
 {
    bool debug = false;
-   uint64_t curtime = cur_realtime_nanosec();
-   // DBGMSF(debug, "curtime=%"PRIu64", next_i2c_io_after=%"PRIu64,
-   //               curtime / (1000*1000), dh->dref->next_i2c_io_after/(1000*1000));
+   uint64_t curtime = cur_monotonic_nanosec();
    DBGTRC(debug, DDCA_TRC_NONE,"Checking from %s() at line %d in file %s", func, lineno, filename);
-   if (dh->dref->next_i2c_io_after > curtime) {
-      int sleep_time = (dh->dref->next_i2c_io_after - curtime)/ (1000*1000);
-      DBGTRC(debug, DDCA_TRC_NONE, "Sleeping for %d milliseconds", sleep_time);
-      sleep_millis_with_trace(sleep_time, func, lineno, filename, "deferred");
+   uint64_t next_io_after = deferred_sleep_deadline(dh);
+   if (next_io_after > curtime) {
+      DBGTRC(debug, DDCA_TRC_NONE, "Sleeping for %"PRIu64" microseconds",
+                                   (next_io_after - curtime) / 1000);
+      // sleep until the absolute deadline, no truncation of the remaining time
+      sleep_until_with_trace(next_io_after, func, lineno, filename, "deferred");
+      op_profile_add(OPC_DEFERRED_SLEEP, cur_monotonic_nanosec() - curtime);
+      IO_TIMELINE_RECORD(dh->dref->io_path.path.i2c_busno, TLE_SLEEP, "deferred",
+                         curtime, (next_io_after - curtime) / 1000, 0);
    }
    else {
       DBGTRC(debug, DDCA_TRC_NONE, "No sleep necessary");
@@ -295,5 +410,5 @@ void check_deferred_sleep(
 /** Module initialization */
 void init_tuned_sleep() {
    RTTI_ADD_FUNC(check_deferred_sleep);
-   RTTI_ADD_FUNC(tuned_sleep_with_trace);
+   RTTI_ADD_FUNC(tuned_sleep_internal);
 }
@@ -12,6 +12,7 @@
 
 /** \cond */
 #include <stdbool.h>
+#include <stdint.h>
 // #include "public/ddcutil_types.h"
 /** \endcond */
 #include "base/displays.h"
@@ -19,6 +20,7 @@
 
 bool enable_deferred_sleep(bool enable);
 bool is_deferred_sleep_enabled();
+bool enable_deferred_sleep_for_thread(bool onoff);
 
 void check_deferred_sleep(
       Display_Handle * dh,
@@ -35,6 +37,12 @@ void tuned_sleep_with_trace(
       const char *     filename,
       const char *     msg);
 
+uint64_t tuned_sleep_deadline(
+      Display_Handle * dh,
+      Sleep_Event_Type event_type);
+
+uint64_t deferred_sleep_deadline(Display_Handle * dh);
+
 // Convenience macros:
 
 #define CHECK_DEFERRED_SLEEP(_dh) \
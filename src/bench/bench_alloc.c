@@ -0,0 +1,82 @@
+/** @file bench_alloc.c
+ *
+ *  Counts heap allocations made while a benchmark runs.
+ *
+ *  With glibc, malloc() and friends are replaced by wrappers that count
+ *  calls and forward to the glibc implementations.  Since the replacement
+ *  is by symbol interposition, allocations made inside glib and libc itself,
+ *  e.g. by g_strdup() or strdup(), are counted as well.
+ *
+ *  On other C libraries allocations are not counted.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bench/bench_harness.h"
+
+#ifdef __GLIBC__
+
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t nmemb, size_t size);
+extern void * __libc_realloc(void * ptr, size_t size);
+extern void   __libc_free(void * ptr);
+
+static bool     counting    = false;
+static uint64_t alloc_count = 0;     // the harness is single threaded
+
+void * malloc(size_t size) {
+   if (counting)
+      alloc_count++;
+   return __libc_malloc(size);
+}
+
+void * calloc(size_t nmemb, size_t size) {
+   if (counting)
+      alloc_count++;
+   return __libc_calloc(nmemb, size);
+}
+
+void * realloc(void * ptr, size_t size) {
+   if (counting)
+      alloc_count++;
+   return __libc_realloc(ptr, size);
+}
+
+void free(void * ptr) {
+   __libc_free(ptr);
+}
+
+bool bench_alloc_counting_supported() {
+   return true;
+}
+
+void bench_alloc_counting_start() {
+   alloc_count = 0;
+   counting = true;
+}
+
+uint64_t bench_alloc_counting_stop() {
+   counting = false;
+   return alloc_count;
+}
+
+#else
+
+bool bench_alloc_counting_supported() {
+   return false;
+}
+
+void bench_alloc_counting_start() {
+}
+
+uint64_t bench_alloc_counting_stop() {
+   return 0;
+}
+
+#endif
@@ -0,0 +1,225 @@
+/** @file bench_corpus.c
+ *
+ *  Capabilities strings and EDIDs used as benchmark input.
+ *
+ *  A built-in corpus is always present, so that results from different
+ *  builds are comparable.  Additional samples can be loaded from a
+ *  directory containing capabilities strings, in files named *.caps, and
+ *  binary EDIDs, in files named *.edid, e.g. copied from
+ *  /sys/class/drm/card0-DP-1/edid.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench/bench_corpus.h"
+
+
+static struct {
+   const char * name;
+   const char * capabilities;
+} builtin_capabilities[] = {
+   {"LG 25UM65",
+      "(prot(monitor)type(LED)model(25UM65)cmds(01 02 03 0C E3 F3)"
+      "vcp(0203(10 00)0405080B0C101214(05 07 08 0B) 16181A5260(03 04)6C6E70"
+      "87ACAEB6C0C6C8C9D6(01 04)DFE4E5E6E7E8E9EAEBED(00 10 20 40)EE(00 01)"
+      "FE(01 02 03)FF)mswhql(1)mccs_ver(2.1))"},
+   {"Asus PB287",
+      "(prot(monitor) type(LCD)model LCDPB287 cmds(01 02 03 07 0C F3) "
+      "vcp(02 04 05 08 0B 0C 10 12 14(05 06 08 0B) 16 18 1A 60(11 12 0F) "
+      "62 6C 6E 70 8D(01 02) A8 AC AE B6 C6 C8 C9 D6(01 04) DF) "
+      "mccs_ver(2.1)asset_eep(32)mpu(01)mswhql(1))"},
+   {"Dell U2415",
+      "(prot(monitor)type(LCD)model(U2415)cmds(01 02 03 07 0C E3 F3)"
+      "vcp(02 04 05 08 10 12 14(01 04 05 06 08 09 0B 0C) 16 18 1A 52 60(0F 11 12 ) "
+      "AA(01 02 04 ) AC AE B2 B6 C6 C8 C9 D6(01 04 05) DC(00 02 03 05 ) DF "
+      "E0 E1 E2(00 1D 01 02 04 0E 12 14 19 ) F0(0C ) F1 F2 FD)"
+      "mswhql(1)asset_eep(40)mccs_ver(2.1))"},
+   {"HP Z27n",
+      "(prot(monitor)type(LCD)model(HP Z27n)cmds(01 02 03 07 0C E3 F3)"
+      "vcp(02 04 05 08 0B 0C 10 12 14(01 02 04 05 06 08 0B) 16 18 1A 52 60(0F 10 11 12 13) "
+      "62 6C 6E 70 86(02 03 07 08) 87 8D(01 02) AC AE B6 C0 C6 C8 C9 CA(01 02) "
+      "CC(02 03 04 05 06 07 08 09 0A 0C 0D 14 16 1E) D6(01 04 05) "
+      "DC(01 02 03 05 06 07 08 09 0A 0B) DF E9 EA)"
+      "mswhql(1)asset_eep(40)mccs_ver(2.2))"},
+};
+
+
+// EDIDs constructed to match those of the named monitors, with valid checksums
+static struct {
+   const char * name;
+   Byte         bytes[128];
+} builtin_edids[] = {
+   {"Dell U2415", {
+      0x00,0xff,0xff,0xff,0xff,0xff,0xff,0x00,0x10,0xac,0xbc,0xa0,0x4c,0x47,0x32,0x30,
+      0x0c,0x1b,0x01,0x04,0xa5,0x34,0x20,0x78,0x3a,0xee,0x95,0xa3,0x54,0x4c,0x99,0x26,
+      0x0f,0x50,0x54,0xa5,0x4b,0x00,0x71,0x4f,0x81,0x80,0xa9,0x40,0xd1,0xc0,0xd1,0x00,
+      0x81,0xc0,0x01,0x01,0x01,0x01,0x28,0x3c,0x80,0xa0,0x70,0xb0,0x23,0x40,0x30,0x20,
+      0x36,0x00,0x06,0x44,0x21,0x00,0x00,0x1a,0x00,0x00,0x00,0xff,0x00,0x37,0x4d,0x54,
+      0x30,0x31,0x37,0x34,0x53,0x30,0x32,0x47,0x4c,0x0a,0x00,0x00,0x00,0xfc,0x00,0x44,
+      0x45,0x4c,0x4c,0x20,0x55,0x32,0x34,0x31,0x35,0x0a,0x20,0x20,0x00,0x00,0x00,0xfd,
+      0x00,0x31,0x4c,0x1e,0x53,0x11,0x00,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x01,0x33,
+   }},
+   {"LG 25UM65", {
+      0x00,0xff,0xff,0xff,0xff,0xff,0xff,0x00,0x1e,0x6d,0xf1,0x59,0xa1,0xe3,0x01,0x00,
+      0x03,0x1a,0x01,0x04,0xa5,0x3a,0x18,0x78,0x3a,0xee,0x95,0xa3,0x54,0x4c,0x99,0x26,
+      0x0f,0x50,0x54,0xa5,0x4b,0x00,0x71,0x4f,0x81,0x80,0xa9,0x40,0xd1,0xc0,0xd1,0x00,
+      0x81,0xc0,0x01,0x01,0x01,0x01,0x44,0x48,0x00,0xa0,0xa0,0x38,0x1f,0x40,0x30,0x20,
+      0x3a,0x00,0xa1,0x1c,0x21,0x00,0x00,0x1a,0x00,0x00,0x00,0xfd,0x00,0x38,0x3d,0x1e,
+      0x5a,0x13,0x00,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x00,0x00,0x00,0xfc,0x00,0x32,
+      0x35,0x55,0x4d,0x36,0x35,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x00,0x00,0x00,0xff,
+      0x00,0x36,0x30,0x33,0x4e,0x54,0x48,0x4d,0x38,0x42,0x31,0x37,0x31,0x0a,0x01,0x95,
+   }},
+   {"Acer XB271HU", {
+      0x00,0xff,0xff,0xff,0xff,0xff,0xff,0x00,0x04,0x72,0x19,0x04,0xe2,0xd2,0x50,0x71,
+      0x28,0x1c,0x01,0x04,0xa5,0x3c,0x22,0x78,0x3a,0xee,0x95,0xa3,0x54,0x4c,0x99,0x26,
+      0x0f,0x50,0x54,0xa5,0x4b,0x00,0x71,0x4f,0x81,0x80,0xa9,0x40,0xd1,0xc0,0xd1,0x00,
+      0x81,0xc0,0x01,0x01,0x01,0x01,0x56,0x5e,0x00,0xa0,0xa0,0xa0,0x29,0x50,0x30,0x20,
+      0x35,0x00,0x55,0x50,0x21,0x00,0x00,0x1a,0x00,0x00,0x00,0xff,0x00,0x54,0x39,0x54,
+      0x45,0x45,0x30,0x30,0x31,0x38,0x35,0x32,0x30,0x0a,0x00,0x00,0x00,0xfd,0x00,0x1e,
+      0x90,0xde,0xde,0x3c,0x00,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x00,0x00,0x00,0xfc,
+      0x00,0x58,0x42,0x32,0x37,0x31,0x48,0x55,0x0a,0x20,0x20,0x20,0x20,0x20,0x00,0x5d,
+   }},
+   {"Apple Cinema HD", {
+      0x00,0xff,0xff,0xff,0xff,0xff,0xff,0x00,0x06,0x10,0x27,0x92,0x45,0x2a,0x21,0x02,
+      0x05,0x13,0x01,0x04,0xa5,0x40,0x28,0x78,0x3a,0xee,0x95,0xa3,0x54,0x4c,0x99,0x26,
+      0x0f,0x50,0x54,0xa5,0x4b,0x00,0x71,0x4f,0x81,0x80,0xa9,0x40,0xd1,0xc0,0xd1,0x00,
+      0x81,0xc0,0x01,0x01,0x01,0x01,0xb0,0x68,0x00,0xa0,0xa0,0x40,0x2e,0x60,0x30,0x20,
+      0x36,0x00,0x81,0x90,0x21,0x00,0x00,0x1a,0x00,0x00,0x00,0xfc,0x00,0x43,0x69,0x6e,
+      0x65,0x6d,0x61,0x20,0x48,0x44,0x0a,0x20,0x20,0x20,0x00,0x00,0x00,0xff,0x00,0x43,
+      0x59,0x39,0x31,0x34,0x33,0x4c,0x59,0x58,0x4d,0x50,0x0a,0x20,0x00,0x00,0x00,0x10,
+      0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xb9,
+   }},
+};
+
+
+static GPtrArray * capabilities = NULL;
+static GPtrArray * edids = NULL;
+
+
+static void free_corpus_capabilities(void * data) {
+   Corpus_Capabilities * caps = data;
+   free(caps->name);
+   free(caps->capabilities);
+   free(caps);
+}
+
+
+static void free_corpus_edid(void * data) {
+   Corpus_Edid * edid = data;
+   free(edid->name);
+   free(edid);
+}
+
+
+static void add_capabilities(const char * name, const char * value) {
+   Corpus_Capabilities * caps = calloc(1, sizeof(Corpus_Capabilities));
+   caps->name = strdup(name);
+   caps->capabilities = g_strstrip(strdup(value));
+   g_ptr_array_add(capabilities, caps);
+}
+
+
+static void add_edid(const char * name, const Byte * bytes) {
+   Corpus_Edid * edid = calloc(1, sizeof(Corpus_Edid));
+   edid->name = strdup(name);
+   memcpy(edid->bytes, bytes, 128);
+   g_ptr_array_add(edids, edid);
+}
+
+
+/** Creates the built-in corpus. */
+void corpus_init() {
+   if (capabilities)
+      return;
+   capabilities = g_ptr_array_new_with_free_func(free_corpus_capabilities);
+   edids        = g_ptr_array_new_with_free_func(free_corpus_edid);
+   for (int ndx = 0; ndx < G_N_ELEMENTS(builtin_capabilities); ndx++)
+      add_capabilities(builtin_capabilities[ndx].name, builtin_capabilities[ndx].capabilities);
+   for (int ndx = 0; ndx < G_N_ELEMENTS(builtin_edids); ndx++)
+      add_edid(builtin_edids[ndx].name, builtin_edids[ndx].bytes);
+}
+
+
+/** Adds the capabilities strings and EDIDs in a directory to the corpus.
+ *
+ *  @param dirname  directory name
+ *  @return true if successful, false if the directory or a file could not be read
+ */
+bool corpus_load_dir(const char * dirname) {
+   corpus_init();
+   GError * error = NULL;
+   GDir * dir = g_dir_open(dirname, 0, &error);
+   if (!dir) {
+      fprintf(stderr, "Unable to open %s: %s\n", dirname, error->message);
+      g_error_free(error);
+      return false;
+   }
+   bool ok = true;
+   const char * fn;
+   while ( (fn = g_dir_read_name(dir)) ) {
+      bool is_caps = g_str_has_suffix(fn, ".caps");
+      bool is_edid = g_str_has_suffix(fn, ".edid");
+      if (!is_caps && !is_edid)
+         continue;
+      char * path = g_build_filename(dirname, fn, NULL);
+      char * contents = NULL;
+      gsize  len = 0;
+      if (!g_file_get_contents(path, &contents, &len, &error)) {
+         fprintf(stderr, "Unable to read %s: %s\n", path, error->message);
+         g_clear_error(&error);
+         ok = false;
+      }
+      else if (is_caps) {
+         add_capabilities(fn, contents);
+      }
+      else if (len == 128 || len == 256) {
+         add_edid(fn, (Byte *) contents);
+      }
+      else {
+         fprintf(stderr, "Invalid EDID length %d in %s\n", (int) len, path);
+         ok = false;
+      }
+      g_free(contents);
+      g_free(path);
+   }
+   g_dir_close(dir);
+   return ok;
+}
+
+
+/** Returns the capabilities strings of the corpus.
+ *
+ *  @return array of #Corpus_Capabilities
+ */
+GPtrArray * corpus_capabilities() {
+   corpus_init();
+   return capabilities;
+}
+
+
+/** Returns the EDIDs of the corpus.
+ *
+ *  @return array of #Corpus_Edid
+ */
+GPtrArray * corpus_edids() {
+   corpus_init();
+   return edids;
+}
+
+
+/** Releases the corpus. */
+void corpus_release() {
+   if (capabilities) {
+      g_ptr_array_free(capabilities, true);
+      g_ptr_array_free(edids, true);
+      capabilities = NULL;
+      edids = NULL;
+   }
+}
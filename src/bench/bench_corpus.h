@@ -0,0 +1,35 @@
+/** @file bench_corpus.h
+ *
+ *  Capabilities strings and EDIDs used as benchmark input
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef BENCH_CORPUS_H_
+#define BENCH_CORPUS_H_
+
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+
+#include "util/coredefs.h"
+
+/** A capabilities string in the corpus */
+typedef struct {
+   char * name;
+   char * capabilities;
+} Corpus_Capabilities;
+
+/** An EDID in the corpus */
+typedef struct {
+   char * name;
+   Byte   bytes[128];
+} Corpus_Edid;
+
+void        corpus_init();
+bool        corpus_load_dir(const char * dirname);
+GPtrArray * corpus_capabilities();     // Corpus_Capabilities *
+GPtrArray * corpus_edids();            // Corpus_Edid *
+void        corpus_release();
+
+#endif /* BENCH_CORPUS_H_ */
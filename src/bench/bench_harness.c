@@ -0,0 +1,205 @@
+/** @file bench_harness.c
+ *
+ *  Microbenchmark harness.
+ *
+ *  Each benchmark function is called with a doubling iteration count until
+ *  a round takes at least the minimum time.  The round is then repeated,
+ *  and the fastest of the repetitions is reported, which filters out most
+ *  scheduling noise.
+ *
+ *  Results can be saved to a tab separated file and compared with the
+ *  results saved by an earlier build.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/timestamp.h"
+
+#include "bench/bench_harness.h"
+
+#define BENCH_DEFAULT_MIN_TIME_MILLIS  200
+#define BENCH_REPETITIONS                3
+#define BENCH_MAX_ITERATIONS   (1ULL << 32)
+
+static int         min_time_millis = BENCH_DEFAULT_MIN_TIME_MILLIS;
+static char *      filter          = NULL;
+static GPtrArray * stats           = NULL;    // Bench_Stat *
+
+
+/** Sets the minimum duration of a timed round.
+ *
+ *  @param millis  duration in milliseconds
+ */
+void bench_set_min_time_millis(int millis) {
+   min_time_millis = millis;
+}
+
+
+/** Restricts the benchmarks that are run to those whose name
+ *  contains a string.
+ *
+ *  @param substring  string, NULL to run all benchmarks
+ */
+void bench_set_filter(const char * substring) {
+   free(filter);
+   filter = (substring) ? strdup(substring) : NULL;
+}
+
+
+static uint64_t
+timed_round(Bench_Func func, void * arg, uint64_t iterations, uint64_t * allocs_loc) {
+   uint64_t start = cur_monotonic_nanosec();
+   bench_alloc_counting_start();
+   for (uint64_t ndx = 0; ndx < iterations; ndx++)
+      func(arg);
+   *allocs_loc = bench_alloc_counting_stop();
+   return cur_monotonic_nanosec() - start;
+}
+
+
+/** Times a benchmark function and records the result.
+ *
+ *  @param name  benchmark name
+ *  @param func  function performing one operation
+ *  @param arg   argument passed to **func**
+ */
+void bench_run(const char * name, Bench_Func func, void * arg) {
+   if (filter && !strstr(name, filter))
+      return;
+
+   uint64_t min_time_nanos = min_time_millis * 1000000ULL;
+   uint64_t allocs = 0;
+   func(arg);     // warm up caches and lazily initialized tables
+   uint64_t iterations = 1;
+   uint64_t elapsed = timed_round(func, arg, iterations, &allocs);
+   while (elapsed < min_time_nanos && iterations < BENCH_MAX_ITERATIONS) {
+      iterations *= 2;
+      elapsed = timed_round(func, arg, iterations, &allocs);
+   }
+   uint64_t best = elapsed;
+   for (int ndx = 1; ndx < BENCH_REPETITIONS; ndx++) {
+      elapsed = timed_round(func, arg, iterations, &allocs);
+      if (elapsed < best)
+         best = elapsed;
+   }
+
+   Bench_Stat * stat = calloc(1, sizeof(Bench_Stat));
+   stat->name          = strdup(name);
+   stat->iterations    = iterations;
+   stat->ns_per_op     = (double) best / iterations;
+   stat->allocs_per_op = (bench_alloc_counting_supported()) ? (double) allocs / iterations : -1;
+   if (!stats)
+      stats = g_ptr_array_new();
+   g_ptr_array_add(stats, stat);
+   fprintf(stderr, ".");
+}
+
+
+/** Writes the results of all benchmarks run.
+ *
+ *  @param fh  where to write the report
+ */
+void bench_report(FILE * fh) {
+   fprintf(stderr, "\n");
+   fprintf(fh, "%-48s %12s %12s %12s\n", "Benchmark", "Iterations", "ns/op", "allocs/op");
+   for (int ndx = 0; stats && ndx < stats->len; ndx++) {
+      Bench_Stat * stat = g_ptr_array_index(stats, ndx);
+      if (stat->allocs_per_op < 0)
+         fprintf(fh, "%-48s %12"PRIu64" %12.1f %12s\n",
+                     stat->name, stat->iterations, stat->ns_per_op, "n/a");
+      else
+         fprintf(fh, "%-48s %12"PRIu64" %12.1f %12.2f\n",
+                     stat->name, stat->iterations, stat->ns_per_op, stat->allocs_per_op);
+   }
+}
+
+
+/** Saves the results of all benchmarks run, one line per benchmark,
+ *  with tab separated name, ns/op and allocs/op.
+ *
+ *  @param fn  file name
+ *  @return true if successful, false if the file could not be written
+ */
+bool bench_save(const char * fn) {
+   FILE * fp = fopen(fn, "w");
+   if (!fp) {
+      fprintf(stderr, "Unable to open %s: %s\n", fn, strerror(errno));
+      return false;
+   }
+   for (int ndx = 0; stats && ndx < stats->len; ndx++) {
+      Bench_Stat * stat = g_ptr_array_index(stats, ndx);
+      fprintf(fp, "%s\t%.2f\t%.2f\n", stat->name, stat->ns_per_op, stat->allocs_per_op);
+   }
+   fclose(fp);
+   return true;
+}
+
+
+/** Compares the results of all benchmarks run with results saved
+ *  by #bench_save().
+ *
+ *  @param baseline_fn  file written by #bench_save()
+ *  @param fh           where to write the comparison
+ *  @return true if successful, false if the file could not be read
+ */
+bool bench_compare(const char * baseline_fn, FILE * fh) {
+   FILE * fp = fopen(baseline_fn, "r");
+   if (!fp) {
+      fprintf(stderr, "Unable to open %s: %s\n", baseline_fn, strerror(errno));
+      return false;
+   }
+   GHashTable * baseline = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+   char line[300];
+   while (fgets(line, sizeof(line), fp)) {
+      char ** fields = g_strsplit(g_strchomp(line), "\t", 3);
+      if (g_strv_length(fields) == 3) {
+         double * values = g_new(double, 2);
+         values[0] = g_ascii_strtod(fields[1], NULL);
+         values[1] = g_ascii_strtod(fields[2], NULL);
+         g_hash_table_insert(baseline, g_strdup(fields[0]), values);
+      }
+      g_strfreev(fields);
+   }
+   fclose(fp);
+
+   fprintf(fh, "\nComparison with %s:\n", baseline_fn);
+   fprintf(fh, "%-48s %12s %12s %8s %10s %10s\n",
+               "Benchmark", "old ns/op", "new ns/op", "delta", "old allocs", "new allocs");
+   for (int ndx = 0; stats && ndx < stats->len; ndx++) {
+      Bench_Stat * stat = g_ptr_array_index(stats, ndx);
+      double * old = g_hash_table_lookup(baseline, stat->name);
+      if (!old) {
+         fprintf(fh, "%-48s %12s %12.1f\n", stat->name, "-", stat->ns_per_op);
+         continue;
+      }
+      double delta = (old[0] > 0) ? (stat->ns_per_op - old[0]) * 100 / old[0] : NAN;
+      fprintf(fh, "%-48s %12.1f %12.1f %+7.1f%% %10.2f %10.2f\n",
+                  stat->name, old[0], stat->ns_per_op, delta, old[1], stat->allocs_per_op);
+   }
+   g_hash_table_destroy(baseline);
+   return true;
+}
+
+
+/** Releases all recorded results. */
+void bench_release() {
+   for (int ndx = 0; stats && ndx < stats->len; ndx++) {
+      Bench_Stat * stat = g_ptr_array_index(stats, ndx);
+      free(stat->name);
+      free(stat);
+   }
+   if (stats) {
+      g_ptr_array_free(stats, true);
+      stats = NULL;
+   }
+   bench_set_filter(NULL);
+}
@@ -0,0 +1,46 @@
+/** @file bench_harness.h
+ *
+ *  Microbenchmark harness: times a function over enough iterations to give
+ *  a stable result, counts heap allocations per call, and saves or compares
+ *  results across builds.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef BENCH_HARNESS_H_
+#define BENCH_HARNESS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Function that performs one operation to be timed */
+typedef void (*Bench_Func)(void * arg);
+
+/** Result of one benchmark */
+typedef struct {
+   char *   name;
+   uint64_t iterations;
+   double   ns_per_op;
+   double   allocs_per_op;      // < 0 if allocations are not counted
+} Bench_Stat;
+
+// Run settings
+void   bench_set_min_time_millis(int millis);
+void   bench_set_filter(const char * substring);
+
+void   bench_run(const char * name, Bench_Func func, void * arg);
+
+// Reporting
+void   bench_report(FILE * fh);
+bool   bench_save(const char * fn);
+bool   bench_compare(const char * baseline_fn, FILE * fh);
+void   bench_release();
+
+// Allocation counting, implemented in bench_alloc.c
+bool     bench_alloc_counting_supported();
+void     bench_alloc_counting_start();
+uint64_t bench_alloc_counting_stop();
+
+#endif /* BENCH_HARNESS_H_ */
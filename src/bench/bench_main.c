@@ -0,0 +1,325 @@
+/** @file bench_main.c
+ *
+ *  Microbenchmarks of CPU bound code: parsing capabilities strings and
+ *  EDIDs, DDC packet checksums and interpretation, Bit_Set_256 operations,
+ *  Value_Name_Title lookups, and feature value formatting.
+ *
+ *  Each benchmark reports the time and number of heap allocations per
+ *  operation.  Results can be saved with --save and compared with those of
+ *  another build with --compare.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "public/ddcutil_types.h"
+
+#include "util/data_structures.h"
+#include "util/edid.h"
+
+#include "base/base_init.h"
+#include "base/ddc_packets.h"
+#include "base/feature_metadata.h"
+#include "base/monitor_model_key.h"
+
+#include "vcp/parse_capabilities.h"
+#include "vcp/vcp_feature_values.h"
+
+#include "dynvcp/dyn_feature_codes.h"
+
+#include "ddc/ddc_services.h"
+
+#include "bench/bench_corpus.h"
+#include "bench/bench_harness.h"
+
+
+// Keeps the compiler from discarding results
+static volatile uintptr_t sink;
+
+#define BENCH_NAME_SIZE 100
+
+
+//
+// Capabilities and EDID parsing
+//
+
+static void bench_parse_capabilities(void * arg) {
+   Corpus_Capabilities * caps = arg;
+   Parsed_Capabilities * pcaps = parse_capabilities_string(caps->capabilities);
+   sink = (uintptr_t) pcaps;
+   free_parsed_capabilities(pcaps);
+}
+
+
+static void bench_parse_edid(void * arg) {
+   Corpus_Edid * edid = arg;
+   Parsed_Edid * parsed_edid = create_parsed_edid(edid->bytes);
+   sink = (uintptr_t) parsed_edid;
+   if (parsed_edid)
+      free_parsed_edid(parsed_edid);
+}
+
+
+//
+// DDC packets
+//
+
+// Get VCP Feature Reply for feature x10, max value 100, current value 50
+static Byte getvcp_response[11] = {0x6e, 0x88, 0x02, 0x00, 0x10, 0x00, 0x00, 0x64, 0x00, 0x32};
+
+
+static void bench_ddc_checksum(void * arg) {
+   sink = ddc_checksum(getvcp_response, 10, true);
+}
+
+
+static void bench_interpret_vcp_response(void * arg) {
+   Parsed_Nontable_Vcp_Response parsed_response;
+   Status_DDC rc = interpret_vcp_feature_response_std(getvcp_response+2, 8, 0x10, &parsed_response);
+   sink = rc + parsed_response.sl;
+}
+
+
+// Includes checksum validation, as performed on every DDC response
+static void bench_create_getvcp_response_packet(void * arg) {
+   DDC_Packet * packet = NULL;
+   Status_DDC rc = create_ddc_typed_response_packet(
+         getvcp_response, sizeof(getvcp_response),
+         DDC_PACKET_TYPE_QUERY_VCP_RESPONSE, 0x10, __func__, &packet);
+   assert(rc == 0);
+   sink = rc;
+   free_ddc_packet(packet);
+}
+
+
+//
+// Bit_Set_256
+//
+
+static Bit_Set_256 sample_features;    // features of the first capabilities string
+
+static void bench_bs256_build(void * arg) {
+   Bit_Set_256 result = EMPTY_BIT_SET_256;
+   for (int ndx = 0; ndx < 256; ndx += 3)
+      result = bs256_insert(result, ndx);
+   sink = bs256_contains(result, 0x10);
+}
+
+
+static void bench_bs256_count(void * arg) {
+   sink = bs256_count(sample_features);
+}
+
+
+static void bench_bs256_contains(void * arg) {
+   int ct = 0;
+   for (int ndx = 0; ndx < 256; ndx++) {
+      if (bs256_contains(sample_features, ndx))
+         ct++;
+   }
+   sink = ct;
+}
+
+
+static void bench_bs256_iterate(void * arg) {
+   int ct = 0;
+   for (int pos = bs256_first_bit_set(sample_features); pos >= 0;
+        pos = bs256_next_bit_set(&sample_features, pos))
+      ct++;
+   sink = ct;
+}
+
+
+static void bench_bs256_to_string(void * arg) {
+   sink = (uintptr_t) bs256_to_string(sample_features, "x", ", ");   // thread local buffer
+}
+
+
+//
+// Value_Name_Title lookups
+//
+
+#define SMALL_VNT_CT    8
+#define LARGE_VNT_CT  200
+
+// Not freed, since lookup indexes are keyed by table address
+static Value_Name_Title * small_table;
+static Value_Name_Title * large_table;
+
+static Value_Name_Title * create_vnt_table(int ct) {
+   Value_Name_Title * table = calloc(ct+1, sizeof(Value_Name_Title));
+   for (int ndx = 0; ndx < ct; ndx++) {
+      table[ndx].value = ndx;
+      table[ndx].name  = g_strdup_printf("VALUE_%03d", ndx);
+      table[ndx].title = g_strdup_printf("Value %d", ndx);
+   }
+   table[ct] = (Value_Name_Title) VNT_END;
+   return table;
+}
+
+
+static void bench_vnt_name_small(void * arg) {
+   sink = (uintptr_t) vnt_name(small_table, SMALL_VNT_CT-1);
+}
+
+
+static void bench_vnt_name_large(void * arg) {
+   sink = (uintptr_t) vnt_name(large_table, LARGE_VNT_CT-1);
+}
+
+
+static void bench_vnt_find_id_large(void * arg) {
+   sink = vnt_find_id(large_table, "VALUE_150", false, false, 0xff);
+}
+
+
+static void bench_vnt_find_id_large_ignore_case(void * arg) {
+   sink = vnt_find_id(large_table, "value_150", false, true, 0xff);
+}
+
+
+//
+// Feature value formatting
+//
+// The part of ddc_get_formatted_value_for_dfm() that follows reading the
+// raw value: feature metadata lookup and formatting the value.
+//
+
+typedef struct {
+   DDCA_Vcp_Feature_Code  feature_code;
+   DDCA_Any_Vcp_Value *   valrec;
+} Format_Case;
+
+
+static void bench_format_value(void * arg) {
+   Format_Case * fc = arg;
+   Display_Feature_Metadata * dfm = dyn_get_feature_metadata_by_mmk_and_vspec(
+         fc->feature_code, monitor_model_key_undefined_value(), DDCA_VSPEC_V22, true);
+   char * formatted = NULL;
+   dyn_format_feature_detail(dfm, DDCA_VSPEC_V22, fc->valrec, &formatted);
+   sink = (uintptr_t) formatted;
+   free(formatted);
+   dfm_free(dfm);
+}
+
+
+//
+// Mainline
+//
+
+static void run_benchmarks() {
+   char name[BENCH_NAME_SIZE];
+
+   GPtrArray * capabilities = corpus_capabilities();
+   for (int ndx = 0; ndx < capabilities->len; ndx++) {
+      Corpus_Capabilities * caps = g_ptr_array_index(capabilities, ndx);
+      g_snprintf(name, sizeof(name), "parse_capabilities_string/%s", caps->name);
+      bench_run(name, bench_parse_capabilities, caps);
+   }
+
+   GPtrArray * edids = corpus_edids();
+   for (int ndx = 0; ndx < edids->len; ndx++) {
+      Corpus_Edid * edid = g_ptr_array_index(edids, ndx);
+      g_snprintf(name, sizeof(name), "create_parsed_edid/%s", edid->name);
+      bench_run(name, bench_parse_edid, edid);
+   }
+
+   // checksum covers the source address 0x6e and the virtual host address 0x50
+   getvcp_response[10] = 0x50 ^ ddc_checksum(getvcp_response, 10, false);
+   bench_run("ddc_checksum/getvcp_response",         bench_ddc_checksum,                  NULL);
+   bench_run("interpret_vcp_feature_response_std",    bench_interpret_vcp_response,        NULL);
+   bench_run("create_ddc_typed_response_packet/getvcp", bench_create_getvcp_response_packet, NULL);
+
+   Corpus_Capabilities * caps0 = g_ptr_array_index(capabilities, 0);
+   Parsed_Capabilities * pcaps = parse_capabilities_string(caps0->capabilities);
+   sample_features = get_parsed_capabilities_feature_ids(pcaps, false);
+   free_parsed_capabilities(pcaps);
+   bench_run("bs256_insert/86",      bench_bs256_build,     NULL);
+   bench_run("bs256_count",          bench_bs256_count,     NULL);
+   bench_run("bs256_contains/256",   bench_bs256_contains,  NULL);
+   bench_run("bs256_next_bit_set",   bench_bs256_iterate,   NULL);
+   bench_run("bs256_to_string",      bench_bs256_to_string, NULL);
+
+   small_table = create_vnt_table(SMALL_VNT_CT);
+   large_table = create_vnt_table(LARGE_VNT_CT);
+   bench_run("vnt_name/8",                    bench_vnt_name_small,                NULL);
+   bench_run("vnt_name/200",                  bench_vnt_name_large,                NULL);
+   bench_run("vnt_find_id/200",               bench_vnt_find_id_large,             NULL);
+   bench_run("vnt_find_id/200/ignore_case",   bench_vnt_find_id_large_ignore_case, NULL);
+
+   Format_Case format_cases[] = {
+         {0x10, create_cont_vcp_value(0x10, 100, 50)},                      // brightness, continuous
+         {0x14, create_nontable_vcp_value(0x14, 0x00, 0x0b, 0x00, 0x05)},   // color preset, sl lookup
+         {0x60, create_nontable_vcp_value(0x60, 0x00, 0x12, 0x00, 0x0f)},   // input source
+         {0xdf, create_nontable_vcp_value(0xdf, 0x00, 0x00, 0x02, 0x02)},   // VCP version
+   };
+   for (int ndx = 0; ndx < G_N_ELEMENTS(format_cases); ndx++) {
+      g_snprintf(name, sizeof(name), "format_feature_value/x%02x", format_cases[ndx].feature_code);
+      bench_run(name, bench_format_value, &format_cases[ndx]);
+      free_single_vcp_value(format_cases[ndx].valrec);
+   }
+}
+
+
+int main(int argc, char * argv[]) {
+   int    min_time_millis = 0;
+   char * filter          = NULL;
+   char * corpus_dir      = NULL;
+   char * save_fn         = NULL;
+   char * compare_fn      = NULL;
+
+   GOptionEntry option_entries[] = {
+      {"min-time", 't', 0, G_OPTION_ARG_INT,      &min_time_millis, "Minimum duration of a timed round", "milliseconds"},
+      {"filter",   'f', 0, G_OPTION_ARG_STRING,   &filter,          "Run only benchmarks whose name contains string", "string"},
+      {"corpus",   'c', 0, G_OPTION_ARG_FILENAME, &corpus_dir,      "Directory containing additional *.caps and *.edid files", "directory"},
+      {"save",     's', 0, G_OPTION_ARG_FILENAME, &save_fn,         "Save results to file", "filename"},
+      {"compare",  'b', 0, G_OPTION_ARG_FILENAME, &compare_fn,      "Compare results with those saved in file", "filename"},
+      {NULL}
+   };
+   GError * error = NULL;
+   GOptionContext * context = g_option_context_new("- ddcutil microbenchmarks");
+   g_option_context_add_main_entries(context, option_entries, NULL);
+   if (!g_option_context_parse(context, &argc, &argv, &error)) {
+      fprintf(stderr, "Option parsing failed: %s\n", error->message);
+      g_error_free(error);
+      g_option_context_free(context);
+      return EXIT_FAILURE;
+   }
+   g_option_context_free(context);
+
+   init_base_services();
+   init_ddc_services();
+
+   bool ok = true;
+   corpus_init();
+   if (corpus_dir)
+      ok = corpus_load_dir(corpus_dir);
+   if (min_time_millis > 0)
+      bench_set_min_time_millis(min_time_millis);
+   bench_set_filter(filter);
+
+   if (ok) {
+      run_benchmarks();
+      bench_report(stdout);
+      if (compare_fn)
+         ok = bench_compare(compare_fn, stdout);
+      if (save_fn)
+         ok = bench_save(save_fn) && ok;
+   }
+
+   bench_release();
+   corpus_release();
+   g_free(filter);
+   g_free(corpus_dir);
+   g_free(save_fn);
+   g_free(compare_fn);
+   return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -37,7 +37,7 @@ static Cmd_Desc cmdinfo[] = {
    {CMDID_TESTCASE,     "testcase",       3,  1,       1},
    {CMDID_LISTTESTS,    "listtests",      5,  0,       0},
 #endif
-   {CMDID_LOADVCP,      "loadvcp",        3,  1,       1},
+   {CMDID_LOADVCP,      "loadvcp",        3,  1,       MAX_LOADVCP_FILES},
    {CMDID_DUMPVCP,      "dumpvcp",        3,  0,       1},
 #ifdef ENABLE_ENVCMDS
    {CMDID_INTERROGATE,  "interrogate",    3,  0,       0},
@@ -53,6 +53,15 @@ static Cmd_Desc cmdinfo[] = {
 #endif
    {CMDID_PROBE,        "probe",          5,  0,       0},
    {CMDID_SAVE_SETTINGS,"scs",            3,  0,       0},
+   {CMDID_BATCH,        "batch",          5,  0,       1},
+   {CMDID_TIMELINE,     "timeline",       5,  1,       1},
+   {CMDID_SERVE,        "serve",          5,  0,       0},
+   {CMDID_BENCHMARK,    "benchmark",      5,  0,       2},
+   {CMDID_CALIBRATE,    "calibrate",      5,  0,       2},
+   {CMDID_CACHE,        "cache",          5,  1,       2},
+   {CMDID_SNAPSHOT,     "snapshot",       4,  1,       1},
+   {CMDID_SAMPLE,       "sample",         4,  3,       MAX_GETVCP_VALUES+2},
+   {CMDID_ANALYZE,      "analyze",        3,  0,       MAX_ARGS},
 };
 static int cmdct = sizeof(cmdinfo)/sizeof(Cmd_Desc);
 
@@ -422,8 +431,17 @@ char * commands_list_help =
        "   getvcp <feature-code-or-group>          Report VCP feature value(s)\n"
        "   setvcp <feature-code> [+|-] <new-value> Set VCP feature value\n"
        "   dumpvcp (filename)                      Write color profile related settings to file\n"
-       "   loadvcp <filename>                      Load profile related settings from file\n"
+       "   loadvcp <filename> ...                  Load profile related settings from file(s)\n"
        "   scs                                     Store current settings in monitor's nonvolatile storage\n"
+       "   batch (filename)                        Execute getvcp, setvcp, capabilities, scs commands from file\n"
+       "   timeline <filename>                     Summarize timeline captured using option --timeline\n"
+       "   serve                                   Execute requests of other ddcutil processes\n"
+       "   benchmark (iterations) (table-feature)  Time detection and DDC operations\n"
+       "   calibrate (samples) (max-error-pct)     Find and save minimum sleep times for monitor model\n"
+       "   cache prime|stats|export|import|prune   Fill, report, copy, or trim persistent caches\n"
+       "   snapshot <directory>                    Copy /sys and /dev entries examined by detection\n"
+       "   sample <millisec> <count> <feature>...  Read features at fixed intervals\n"
+       "   analyze (file-or-directory) ...         Summarize saved capabilities strings and EDIDs\n"
 #ifdef INCLUDE_TESTCASES
        "   testcase <testcase-number>\n"
        "   listtests\n"
@@ -543,7 +561,7 @@ char * stats_multiple_call_option_help =
        "Stats:\n"
        "  The argument to --stats is a statistics class.  Specify the --stats option multiple\n"
        "  times to activate multiple statistics classes, e.g. \"--stats calls --stats errors\"\n"
-       "  Valid statistics classes are:  TRY, TRIES, ERRS, ERRORS, CALLS, ALL.\n"
+       "  Valid statistics classes are:  TRY, TRIES, ERRS, ERRORS, CALLS, LATENCY, MEMORY, ALL.\n"
        "  Statistics class names are not case sensitive and can abbreviated to 3 characters.\n"
        "  If no argument is specified, or ALL is specified, then all statistics classes are\n"
        "  output.\n"
@@ -24,6 +24,7 @@
 #include "base/core.h"
 #include "base/displays.h"
 #include "base/parms.h"
+#include "base/thread_sched.h"
 
 #include "cmdline/cmd_parser_aux.h"
 #include "cmdline/cmd_parser.h"
@@ -34,6 +35,7 @@
 static char *            usbwork       = NULL;
 static DDCA_Output_Level output_level  = DDCA_OL_NORMAL;
 static DDCA_Stats_Type   stats_work    = DDCA_STATS_NONE;
+static int               stats_format_work = -1;   // -1 = not set
 
 
 // Callback function for processing --terse, --verbose and synonyms
@@ -92,6 +94,12 @@ stats_arg_func(const    gchar* option_name,
       else if ( is_abbrev(v2,"ELAPSED",3) || is_abbrev(v2, "TIME",3)) {
          stats_work |= DDCA_STATS_ELAPSED;
       }
+      else if ( is_abbrev(v2,"LATENCY",3)) {
+         stats_work |= DDCA_STATS_LATENCY;
+      }
+      else if ( is_abbrev(v2,"MEMORY",3)) {
+         stats_work |= DDCA_STATS_MEMORY;
+      }
       else
          ok = false;
       free(v2);
@@ -106,6 +114,33 @@ stats_arg_func(const    gchar* option_name,
    return ok;
 }
 
+
+// Callback function for processing --stats-format
+static gboolean
+stats_format_arg_func(const    gchar* option_name,
+                      const    gchar* value,
+                      gpointer data,
+                      GError** error)
+{
+   bool debug = false;
+   DBGMSF(debug,"option_name=|%s|, value|%s|, data=%p", option_name, value, data);
+
+   bool ok = true;
+   char * v2 = strdup_uc(value);
+   if (streq(v2, "JSON"))
+      stats_format_work = DDCA_STATS_FORMAT_JSON;
+   else if (is_abbrev(v2, "PROMETHEUS", 4))
+      stats_format_work = DDCA_STATS_FORMAT_PROMETHEUS;
+   else
+      ok = false;
+   free(v2);
+
+   if (!ok) {
+      g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED, "invalid stats format: %s", value );
+   }
+   return ok;
+}
+
 // #define FUTURE
 #ifdef FUTURE
    gboolean debug_pre_parse_func(
@@ -170,11 +205,16 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
    gboolean force_flag     = false;
    gboolean force_slave_flag = false;
    gboolean show_unsupported_flag = false;
+   gboolean caps_only_flag = false;
+   gboolean express_flag = false;
    gboolean version_flag   = false;
    gboolean timestamp_trace_flag = false;
    gboolean wall_timestamp_trace_flag = false;
    gboolean thread_id_trace_flag = false;
+   gboolean trace_ring_flag      = false;
+   gboolean lock_stats_flag      = false;
    gboolean syslog_flag    = false;
+   gboolean async_trace_flag = false;
    gboolean verify_flag    = false;
    gboolean noverify_flag  = false;
 #ifdef OLD
@@ -203,6 +243,17 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
    gboolean per_thread_stats_flag = false;
    gboolean show_settings_flag = false;
    gboolean dsa_flag       = false;
+   gboolean adaptive_maxtries_flag = false;
+   gboolean edid_from_sysfs_flag = false;
+   gboolean edid_only_flag = false;
+   gboolean combined_write_read_flag = false;
+   gboolean auto_write_read_flag = false;
+   gboolean prefetch_capabilities_flag = false;
+   gboolean all_displays_flag = false;
+   gboolean skip_unchanged_flag = false;
+   gboolean use_server_flag = false;
+   gboolean json_flag      = false;
+   gboolean snapshot_flag  = false;
    gboolean f1_flag        = false;
    gboolean f2_flag        = false;
    gboolean f3_flag        = false;
@@ -215,6 +266,9 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
    gboolean enable_cc_flag = DEFAULT_ENABLE_CACHED_CAPABILITIES;
    const char * enable_cc_expl =  (enable_cc_flag) ? "Enable cached capabilities (default)" : "Enable cached capabilities";
    const char * disable_cc_expl = (enable_cc_flag) ? "Disable cached capabilities" : "Disable cached capabilities (default)";
+   gboolean enable_cd_flag = DEFAULT_ENABLE_CACHED_DISPLAYS;
+   const char * enable_cd_expl =  (enable_cd_flag) ? "Enable cached display detection (default)" : "Enable cached display detection";
+   const char * disable_cd_expl = (enable_cd_flag) ? "Disable cached display detection" : "Disable cached display detection (default)";
    // gboolean enable_cc_flag_set = false;
    // gboolean disable_cc_flag_set = false;
 
@@ -234,10 +288,21 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
    gint     dispwork       = -1;
    char *   maxtrywork      = NULL;
    gint     edid_read_size_work = -1;
+   gint     async_threads_work = -1;
+   gint     adapter_concurrency_work = -1;
+   gint     i2c_kernel_retries_work = -1;
+   gchar *  rt_policy_work = NULL;
+   gint     rt_priority_work = -1;
+   gchar *  cpu_affinity_work = NULL;
    gint     i1_work = -1;
    char *   failsim_fn_work = NULL;
+   char *   timeline_fn_work = NULL;
+   char *   server_socket_work = NULL;
    // gboolean enable_failsim_flag = false;
    char *   sleep_multiplier_work = NULL;
+   char *   bench_multipliers_work = NULL;
+   char *   bench_faults_work = NULL;
+   char *   sample_format_work = NULL;
 
    GOptionEntry libddcutil_only_options[] = {
          {"libddcutil-trace-file",
@@ -268,6 +333,8 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
          {"rw",      '\0', 0, G_OPTION_ARG_NONE,     &rw_only_flag,     "Include only RW features",         NULL},
          {"ro",      '\0', 0, G_OPTION_ARG_NONE,     &ro_only_flag,     "Include only RO features",         NULL},
          {"wo",      '\0', 0, G_OPTION_ARG_NONE,     &wo_only_flag,     "Include only WO features",         NULL},
+         {"caps-only",'\0',0, G_OPTION_ARG_NONE,     &caps_only_flag,   "Include only features in cached capabilities", NULL},
+         {"express", '\0', 0, G_OPTION_ARG_NONE,     &express_flag,     "Probe without repeating known DDC exchanges", NULL},
 
          // Output control
          {"verbose", 'v',  G_OPTION_FLAG_NO_ARG,
@@ -294,8 +361,12 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
       {"ddc",     '\0', 0, G_OPTION_ARG_NONE,     &ddc_flag,         "Report DDC protocol and data errors", NULL},
       {"stats",   's',  G_OPTION_FLAG_OPTIONAL_ARG,
                            G_OPTION_ARG_CALLBACK, stats_arg_func,    "Show performance statistics",  "stats type"},
+      {"stats-format",
+                  '\0', 0, G_OPTION_ARG_CALLBACK, stats_format_arg_func, "Write statistics in a machine readable format",  "json|prometheus"},
       {"per-thread-stats",
                   '\0', 0, G_OPTION_ARG_NONE,     &per_thread_stats_flag, "Include per-thread statistics",   NULL},
+      {"lock-stats",
+                  '\0', 0, G_OPTION_ARG_NONE,     &lock_stats_flag,  "Record lock contention statistics",   NULL},
 
       // Behavior options
 #ifdef USE_USB
@@ -320,10 +391,28 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
       {"noverify",'\0', 0, G_OPTION_ARG_NONE,     &noverify_flag,    "Do not read VCP value after setting it", NULL},
 //    {"nodetect",'\0', 0, G_OPTION_ARG_NONE,     &nodetect_flag,    "Skip initial monitor detection",  NULL},
       {"async",   '\0', 0, G_OPTION_ARG_NONE,     &async_flag,       "Enable asynchronous display detection", NULL},
+      {"edid-only",
+                  '\0', 0, G_OPTION_ARG_NONE,     &edid_only_flag,   "Detect displays by EDID only, without DDC communication", NULL},
+      {"async-threads",
+                  '\0', 0, G_OPTION_ARG_INT,      &async_threads_work, "Worker threads for asynchronous operations", "number"},
+      {"adapter-concurrency",
+                  '\0', 0, G_OPTION_ARG_INT,      &adapter_concurrency_work, "Maximum simultaneous DDC exchanges per video adapter", "number"},
+      {"i2c-retries",
+                  '\0', 0, G_OPTION_ARG_INT,      &i2c_kernel_retries_work, "Kernel retries of I2C transfers that fail with EAGAIN", "count"},
+      {"rt-policy",
+                  '\0', 0, G_OPTION_ARG_STRING,   &rt_policy_work, "Real time scheduling policy for DDC I/O threads", "fifo|rr"},
+      {"rt-priority",
+                  '\0', 0, G_OPTION_ARG_INT,      &rt_priority_work, "Real time priority for DDC I/O threads", "number"},
+      {"cpu-affinity",
+                  '\0', 0, G_OPTION_ARG_STRING,   &cpu_affinity_work, "CPUs on which DDC I/O threads run", "cpu list"},
       {"enable-capabilities-cache",
                   '\0', 0, G_OPTION_ARG_NONE,     &enable_cc_flag,   enable_cc_expl,     NULL},
       {"disable-capabilities-cache", '\0', G_OPTION_FLAG_REVERSE,
                            G_OPTION_ARG_NONE,     &enable_cc_flag,   disable_cc_expl ,   NULL},
+      {"enable-displays-cache",
+                  '\0', 0, G_OPTION_ARG_NONE,     &enable_cd_flag,   enable_cd_expl,     NULL},
+      {"disable-displays-cache", '\0', G_OPTION_FLAG_REVERSE,
+                           G_OPTION_ARG_NONE,     &enable_cd_flag,   disable_cd_expl ,   NULL},
 
       {"udf",     '\0', 0, G_OPTION_ARG_NONE,     &enable_udf_flag,  enable_udf_expl,    NULL},
       {"enable-udf",'\0',0,G_OPTION_ARG_NONE,     &enable_udf_flag,  enable_udf_expl,    NULL},
@@ -335,8 +424,16 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
 
       // Performance and retry
       {"maxtries",'\0', 0, G_OPTION_ARG_STRING,   &maxtrywork,       "Max try adjustment",  "comma separated list" },
+      {"adaptive-maxtries",
+                  '\0', 0, G_OPTION_ARG_NONE,     &adaptive_maxtries_flag, "Adjust max tries per display based on observed retries", NULL},
       {"sleep-multiplier", '\0', 0,
                            G_OPTION_ARG_STRING,   &sleep_multiplier_work, "Multiplication factor for DDC sleeps", "number"},
+      {"bench-multipliers", '\0', 0,
+                           G_OPTION_ARG_STRING,   &bench_multipliers_work, "Sleep multipliers used by BENCHMARK", "comma separated list"},
+      {"bench-faults", '\0', 0,
+                           G_OPTION_ARG_STRING,   &bench_faults_work, "Simulated fault scenarios used by BENCHMARK", "comma separated list"},
+      {"sample-format", '\0', 0,
+                           G_OPTION_ARG_STRING,   &sample_format_work, "Output format of SAMPLE", "csv|lp"},
 
 #ifdef OLD
       {"less-sleep" ,'\0', 0, G_OPTION_ARG_NONE, &reduce_sleeps_flag, "Eliminate some sleeps (default)",  NULL},
@@ -360,6 +457,23 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
       {"dsa",                     '\0', 0, G_OPTION_ARG_NONE, &dsa_flag, "Enable dynamic sleep adjustment",  NULL},
       {"edid-read-size",
                       '\0', 0, G_OPTION_ARG_INT,         &edid_read_size_work, "Number of EDID bytes to read", "128,256" },
+      {"edid-from-sysfs",
+                      '\0', 0, G_OPTION_ARG_NONE,        &edid_from_sysfs_flag, "Take EDID from /sys/class/drm when possible", NULL},
+      {"i2c-combined-write-read",
+                      '\0', 0, G_OPTION_ARG_NONE,        &combined_write_read_flag, "Write and read in a single I2C transaction", NULL},
+      {"i2c-auto-write-read",
+                      '\0', 0, G_OPTION_ARG_NONE,        &auto_write_read_flag, "Use a single I2C transaction on buses where it is measured faster", NULL},
+      {"prefetch-capabilities",
+                      '\0', 0, G_OPTION_ARG_NONE,        &prefetch_capabilities_flag, "Read capabilities in the background after display detection", NULL},
+      {"all",         '\0', 0, G_OPTION_ARG_NONE,        &all_displays_flag, "Apply CAPABILITIES, DUMPVCP, GETVCP, SETVCP, BENCHMARK, or SAMPLE command to all displays", NULL},
+      {"all-displays",'\0', 0, G_OPTION_ARG_NONE,        &all_displays_flag, "Synonym for --all", NULL},
+      {"skip-unchanged",
+                      '\0', 0, G_OPTION_ARG_NONE,        &skip_unchanged_flag, "LOADVCP writes only values that differ from the current ones", NULL},
+      {"json",        '\0', 0, G_OPTION_ARG_NONE,        &json_flag, "Write DETECT, GETVCP, CAPABILITIES, and DUMPVCP output as JSON", NULL},
+      {"snapshot",    '\0', 0, G_OPTION_ARG_NONE,        &snapshot_flag, "DUMPVCP writes a binary snapshot instead of text", NULL},
+      {"use-server",  '\0', 0, G_OPTION_ARG_NONE,        &use_server_flag, "Send GETVCP, SETVCP, and CAPABILITIES to a running ddcutil server", NULL},
+      {"server-socket",
+                      '\0', 0, G_OPTION_ARG_FILENAME,    &server_socket_work, "Socket used by SERVE and --use-server", "file name"},
       {NULL},
    };
 
@@ -377,9 +491,17 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
       {"wts",        '\0', 0, G_OPTION_ARG_NONE,         &wall_timestamp_trace_flag, "Prepend trace msgs with wall time",  NULL},
       {"thread-id",  '\0', 0, G_OPTION_ARG_NONE,         &thread_id_trace_flag, "Prepend trace msgs with thread id",  NULL},
       {"tid",        '\0', 0, G_OPTION_ARG_NONE,         &thread_id_trace_flag, "Prepend trace msgs with thread id",  NULL},
+      {"trace-ring", '\0', 0, G_OPTION_ARG_NONE,         &trace_ring_flag,      "Record binary trace events, report on exit",  NULL},
       {"syslog",     '\0', 0, G_OPTION_ARG_NONE,         &syslog_flag,           "Write trace messages to system log",  NULL},
+      {"async-trace",'\0', 0, G_OPTION_ARG_NONE,         &async_trace_flag,     "Write trace messages from a background thread",  NULL},
       {"debug-parse",'\0', 0,  G_OPTION_ARG_NONE,        &debug_parse_flag,     "Report parsed command",    NULL},
       {"failsim",    '\0', 0,  G_OPTION_ARG_FILENAME,    &failsim_fn_work,      "Enable simulation", "control file name"},
+      {"timeline",   '\0', 0,  G_OPTION_ARG_FILENAME,    &timeline_fn_work,     "Write timeline of DDC transactions", "file name"},
+      {"simulate-monitor",
+                     '\0', 0,  G_OPTION_ARG_FILENAME,    &parsed_cmd->simulated_monitor_fn, "Answer DDC/CI requests from a simulated monitor", "control file name"},
+      {"i2c-record", '\0', 0,  G_OPTION_ARG_FILENAME,    &parsed_cmd->i2c_record_fn, "Record raw I2C writes and reads", "file name"},
+      {"i2c-replay", '\0', 0,  G_OPTION_ARG_FILENAME,    &parsed_cmd->i2c_replay_fn, "Replay I2C writes and reads recorded by --i2c-record", "file name"},
+      {"fs-root",    '\0', 0,  G_OPTION_ARG_FILENAME,    &parsed_cmd->fs_root_dir, "Read /sys and /dev from a snapshot in this directory", "directory"},
 
 
       // Generic options to aid development
@@ -511,6 +633,11 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
       parsing_ok = false;
    }
 
+   if (parsed_cmd->simulated_monitor_fn && parsed_cmd->i2c_replay_fn) {
+      fprintf(stderr, "Options --simulate-monitor and --i2c-replay are mutually exclusive\n");
+      parsing_ok = false;
+   }
+
    if (reduce_sleeps_specified)
       fprintf(stderr, "Deprecated option ignored: --enable-sleep-less, --disable-sleep-less, etc.\n");
    if (force_slave_flag)
@@ -534,6 +661,10 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
 
    parsed_cmd->output_level     = output_level;
    parsed_cmd->stats_types      = stats_work;
+   if (stats_format_work >= 0) {
+      parsed_cmd->flags |= CMD_FLAG_EXPORT_STATS;
+      parsed_cmd->stats_export_format = stats_format_work;
+   }
    parsed_cmd->i1               = i1_work;
    SET_CMDFLAG(CMD_FLAG_DDCDATA,           ddc_flag);
 #ifdef OLD
@@ -542,7 +673,10 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
    SET_CMDFLAG(CMD_FLAG_TIMESTAMP_TRACE,   timestamp_trace_flag);
    SET_CMDFLAG(CMD_FLAG_WALLTIME_TRACE,    wall_timestamp_trace_flag);
    SET_CMDFLAG(CMD_FLAG_THREAD_ID_TRACE,   thread_id_trace_flag);
+   SET_CMDFLAG(CMD_FLAG_TRACE_RING,        trace_ring_flag);
+   SET_CMDFLAG(CMD_FLAG_LOCK_STATS,        lock_stats_flag);
    SET_CMDFLAG(CMD_FLAG_SYSLOG,            syslog_flag);
+   SET_CMDFLAG(CMD_FLAG_ASYNC_TRACE,       async_trace_flag);
    SET_CMDFLAG(CMD_FLAG_VERIFY,            verify_flag || !noverify_flag);
    // if (verify_flag || !noverify_flag)
    //    parsed_cmd->flags |= CMD_FLAG_VERIFY;
@@ -553,6 +687,8 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
    SET_CMDFLAG(CMD_FLAG_REPORT_FREED_EXCP, report_freed_excp_flag);
    SET_CMDFLAG(CMD_FLAG_NOTABLE,           notable_flag);
    SET_CMDFLAG(CMD_FLAG_SHOW_UNSUPPORTED,  show_unsupported_flag);
+   SET_CMDFLAG(CMD_FLAG_CAPS_ONLY,         caps_only_flag);
+   SET_CMDFLAG(CMD_FLAG_PROBE_EXPRESS,     express_flag);
    SET_CMDFLAG(CMD_FLAG_RW_ONLY,           rw_only_flag);
    SET_CMDFLAG(CMD_FLAG_RO_ONLY,           ro_only_flag);
    SET_CMDFLAG(CMD_FLAG_WO_ONLY,           wo_only_flag);
@@ -567,6 +703,17 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
 #endif
    SET_CMDFLAG(CMD_FLAG_DSA,               dsa_flag);
    SET_CMDFLAG(CMD_FLAG_DEFER_SLEEPS,      deferred_sleep_flag);
+   SET_CMDFLAG(CMD_FLAG_ADAPTIVE_MAXTRIES, adaptive_maxtries_flag);
+   SET_CMDFLAG(CMD_FLAG_EDID_FROM_SYSFS,   edid_from_sysfs_flag);
+   SET_CMDFLAG(CMD_FLAG_EDID_ONLY,         edid_only_flag);
+   SET_CMDFLAG(CMD_FLAG_I2C_COMBINED_WRITE_READ, combined_write_read_flag);
+   SET_CMDFLAG(CMD_FLAG_I2C_AUTO_WRITE_READ, auto_write_read_flag);
+   SET_CMDFLAG(CMD_FLAG_PREFETCH_CAPABILITIES, prefetch_capabilities_flag);
+   SET_CMDFLAG(CMD_FLAG_ALL_DISPLAYS,       all_displays_flag);
+   SET_CMDFLAG(CMD_FLAG_SKIP_UNCHANGED,     skip_unchanged_flag);
+   SET_CMDFLAG(CMD_FLAG_USE_SERVER,         use_server_flag);
+   SET_CMDFLAG(CMD_FLAG_JSON,               json_flag);
+   SET_CMDFLAG(CMD_FLAG_SNAPSHOT,           snapshot_flag);
    SET_CMDFLAG(CMD_FLAG_F1,                f1_flag);
    SET_CMDFLAG(CMD_FLAG_F2,                f2_flag);
    SET_CMDFLAG(CMD_FLAG_F3,                f3_flag);
@@ -578,6 +725,10 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
    SET_CMDFLAG(CMD_FLAG_SHOW_SETTINGS,     show_settings_flag);
 
    SET_CLR_CMDFLAG(CMD_FLAG_ENABLE_CACHED_CAPABILITIES, enable_cc_flag);
+   SET_CLR_CMDFLAG(CMD_FLAG_ENABLE_CACHED_DISPLAYS,     enable_cd_flag);
+
+   parsed_cmd->timeline_fn = timeline_fn_work;
+   parsed_cmd->server_socket_fn = server_socket_work;
 
    if (failsim_fn_work) {
 #ifdef ENABLE_FAILSIM
@@ -590,6 +741,27 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
 #endif
    }
 
+   if (sample_format_work) {
+      if (streq(sample_format_work, "csv"))
+         parsed_cmd->sample_format = SAMPLE_FORMAT_CSV;
+      else if (streq(sample_format_work, "lp") || streq(sample_format_work, "line"))
+         parsed_cmd->sample_format = SAMPLE_FORMAT_LINE_PROTOCOL;
+      else {
+         fprintf(stderr, "Invalid sample format: %s\n", sample_format_work);
+         parsing_ok = false;
+      }
+      free(sample_format_work);
+   }
+
+   if (bench_faults_work) {
+#ifdef ENABLE_FAILSIM
+      parsed_cmd->bench_faults = bench_faults_work;
+#else
+      fprintf(stderr, "ddcutil not built with failure simulation support.  --bench-faults option invalid.\n");
+      parsing_ok = false;
+#endif
+   }
+
 #undef SET_CMDFLAG
 #undef SET_CLR_CMDFLAG
 
@@ -773,6 +945,27 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
       }
    }
 
+   if (bench_multipliers_work) {
+      DBGMSF(debug, "bench_multipliers_work = |%s|", bench_multipliers_work);
+      Null_Terminated_String_Array pieces = strsplit(bench_multipliers_work, ",");
+      int ct = ntsa_length(pieces);
+      bool arg_ok = (ct > 0 && ct <= MAX_BENCH_MULTIPLIERS);
+      for (int ndx = 0; ndx < ct && arg_ok; ndx++) {
+         float multiplier = 0.0f;
+         arg_ok = str_to_float(pieces[ndx], &multiplier) &&
+                  multiplier > 0.0f && multiplier < 100.0;
+         parsed_cmd->bench_multipliers[ndx] = multiplier;
+      }
+      ntsa_free(pieces, true);
+      if (!arg_ok) {
+          fprintf(stderr, "Invalid bench-multipliers: %s\n", bench_multipliers_work );
+          parsing_ok = false;
+      }
+      else {
+         parsed_cmd->bench_multiplier_ct = ct;
+      }
+   }
+
    DBGMSF(debug, "edid_read_size_work = %d", edid_read_size_work);
    if (edid_read_size_work !=  -1 &&
        edid_read_size_work != 128 &&
@@ -785,6 +978,58 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
    else
       parsed_cmd->edid_read_size = edid_read_size_work;
 
+   if (async_threads_work != -1 && async_threads_work < 1) {
+      fprintf(stderr, "Invalid async thread count: %d\n", async_threads_work);
+      parsing_ok = false;
+   }
+   else
+      parsed_cmd->async_threads = async_threads_work;
+
+   if (adapter_concurrency_work < -1) {
+      fprintf(stderr, "Invalid adapter concurrency: %d\n", adapter_concurrency_work);
+      parsing_ok = false;
+   }
+   else
+      parsed_cmd->adapter_concurrency = adapter_concurrency_work;
+
+   if (i2c_kernel_retries_work < -1) {
+      fprintf(stderr, "Invalid I2C retry count: %d\n", i2c_kernel_retries_work);
+      parsing_ok = false;
+   }
+   else
+      parsed_cmd->i2c_kernel_retries = i2c_kernel_retries_work;
+
+   if (rt_policy_work || rt_priority_work >= 0) {
+      // --rt-priority alone implies fifo, --rt-policy alone implies the lowest priority
+      int policy = (rt_policy_work) ? parse_sched_policy_name(rt_policy_work) : parse_sched_policy_name("fifo");
+      if (policy < 0 || streq(rt_policy_work, "other")) {
+         fprintf(stderr, "Invalid real time scheduling policy: %s\n", rt_policy_work);
+         parsing_ok = false;
+      }
+      else {
+         int priority = (rt_priority_work >= 0) ? rt_priority_work : 1;
+         if (priority < 1 || priority > 99) {
+            fprintf(stderr, "Invalid real time priority: %d\n", rt_priority_work);
+            parsing_ok = false;
+         }
+         else {
+            parsed_cmd->rt_policy   = policy;
+            parsed_cmd->rt_priority = priority;
+         }
+      }
+      g_free(rt_policy_work);
+   }
+
+   if (cpu_affinity_work) {
+      if (!is_valid_cpu_list(cpu_affinity_work)) {
+         fprintf(stderr, "Invalid CPU list: %s\n", cpu_affinity_work);
+         parsing_ok = false;
+      }
+      else
+         parsed_cmd->cpu_affinity = strdup(cpu_affinity_work);
+      g_free(cpu_affinity_work);
+   }
+
 #ifdef COMMA_DELIMITED_TRACE
    if (tracework) {
        bool saved_debug = debug;
@@ -976,6 +1221,28 @@ Parsed_Cmd * parse_command(int argc, char * argv[], Parser_Mode parser_mode) {
             parsed_cmd->flags &= ~CMD_FLAG_NOTABLE;
          }
 
+         if (parsing_ok && (parsed_cmd->flags & CMD_FLAG_EDID_ONLY) && parsed_cmd->cmd_id != CMDID_DETECT) {
+            fprintf(stderr, "Option --edid-only is valid only for command DETECT\n");
+            parsing_ok = false;
+         }
+
+         if (parsing_ok && (parsed_cmd->flags & CMD_FLAG_ALL_DISPLAYS)) {
+            if (parsed_cmd->cmd_id != CMDID_CAPABILITIES && parsed_cmd->cmd_id != CMDID_DUMPVCP &&
+                parsed_cmd->cmd_id != CMDID_GETVCP       && parsed_cmd->cmd_id != CMDID_SETVCP  &&
+                parsed_cmd->cmd_id != CMDID_BENCHMARK    && parsed_cmd->cmd_id != CMDID_SAMPLE) {
+               fprintf(stderr, "Option --all is valid only for commands CAPABILITIES, DUMPVCP, GETVCP, SETVCP, BENCHMARK, and SAMPLE\n");
+               parsing_ok = false;
+            }
+            else if (parsed_cmd->cmd_id == CMDID_DUMPVCP && parsed_cmd->argct > 0) {
+               fprintf(stderr, "Option --all cannot be combined with a file name\n");
+               parsing_ok = false;
+            }
+            else if (explicit_display_spec_ct > 0) {
+               fprintf(stderr, "Option --all cannot be combined with a display specification\n");
+               parsing_ok = false;
+            }
+         }
+
          if (parsing_ok && parsed_cmd->cmd_id == CMDID_GETVCP
                         && (parsed_cmd->flags & CMD_FLAG_WO_ONLY) ) {
             fprintf(stdout, "Ignoring option --wo-only\n");
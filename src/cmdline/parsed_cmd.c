@@ -58,6 +58,15 @@ Value_Name_Table cmd_id_table = {
       VNT(CMDID_CHKUSBMON     ,  "chkusbmon"),
       VNT(CMDID_PROBE         ,  "probe"),
       VNT(CMDID_SAVE_SETTINGS ,  "save settings"),
+      VNT(CMDID_BATCH         ,  "batch"),
+      VNT(CMDID_TIMELINE      ,  "timeline"),
+      VNT(CMDID_SERVE         ,  "serve"),
+      VNT(CMDID_BENCHMARK     ,  "benchmark"),
+      VNT(CMDID_CALIBRATE     ,  "calibrate"),
+      VNT(CMDID_CACHE         ,  "cache"),
+      VNT(CMDID_SNAPSHOT      ,  "snapshot"),
+      VNT(CMDID_SAMPLE        ,  "sample"),
+      VNT(CMDID_ANALYZE       ,  "analyze"),
       VNT_END
 };
 
@@ -114,6 +123,10 @@ Parsed_Cmd *  new_parsed_cmd() {
    // parsed_cmd->output_level = OL_DEFAULT;
    parsed_cmd->output_level = DDCA_OL_NORMAL;
    parsed_cmd->edid_read_size = -1;   // if set, values are >= 0
+   parsed_cmd->async_threads = -1;    // if set, values are > 0
+   parsed_cmd->adapter_concurrency = -1;   // if set, values are >= 0
+   parsed_cmd->i2c_kernel_retries = -1;    // if set, values are >= 0
+   parsed_cmd->rt_policy = -1;             // if set, SCHED_FIFO or SCHED_RR
    parsed_cmd->i1 = -1;               // if set, values are >= 0
 #ifdef OLD
    parsed_cmd->flags |= CMD_FLAG_NODETECT;
@@ -128,6 +141,8 @@ Parsed_Cmd *  new_parsed_cmd() {
       parsed_cmd->flags |= CMD_FLAG_ENABLE_USB;
    if (DEFAULT_ENABLE_CACHED_CAPABILITIES)
       parsed_cmd->flags |= CMD_FLAG_ENABLE_CACHED_CAPABILITIES;
+   if (DEFAULT_ENABLE_CACHED_DISPLAYS)
+      parsed_cmd->flags |= CMD_FLAG_ENABLE_CACHED_DISPLAYS;
    return parsed_cmd;
 }
 
@@ -146,7 +161,15 @@ void free_parsed_cmd(Parsed_Cmd * parsed_cmd) {
       free_display_identifier(parsed_cmd->pdid);
    free(parsed_cmd->raw_command);
    free(parsed_cmd->failsim_control_fn);
+   free(parsed_cmd->bench_faults);
+   free(parsed_cmd->simulated_monitor_fn);
+   free(parsed_cmd->i2c_record_fn);
+   free(parsed_cmd->i2c_replay_fn);
+   free(parsed_cmd->timeline_fn);
+   free(parsed_cmd->fs_root_dir);
+   free(parsed_cmd->server_socket_fn);
    free(parsed_cmd->fref);
+   free(parsed_cmd->cpu_affinity);
    ntsa_free(parsed_cmd->traced_files, true);
    ntsa_free(parsed_cmd->traced_functions, true);
    g_array_free(parsed_cmd->setvcp_values, true);
@@ -184,6 +207,8 @@ void dbgrpt_parsed_cmd(Parsed_Cmd * parsed_cmd, int depth) {
 
       rpt_int_as_hex(
                "stats",            NULL, parsed_cmd->stats_types,                       d1);
+      rpt_bool("export stats:",    NULL, parsed_cmd->flags & CMD_FLAG_EXPORT_STATS,     d1);
+      rpt_bool("lock stats:",      NULL, parsed_cmd->flags & CMD_FLAG_LOCK_STATS,       d1);
       rpt_bool("ddcdata",          NULL, parsed_cmd->flags & CMD_FLAG_DDCDATA,          d1);
       rpt_str( "output_level",     NULL, output_level_name(parsed_cmd->output_level),   d1);
 #ifdef OLD
@@ -221,6 +246,14 @@ void dbgrpt_parsed_cmd(Parsed_Cmd * parsed_cmd, int depth) {
 
       rpt_bool("enable_failure_simulation", NULL, parsed_cmd->flags & CMD_FLAG_ENABLE_FAILSIM,   d1);
       rpt_str("failsim_control_fn", NULL, parsed_cmd->failsim_control_fn,                        d1);
+      rpt_str("bench_faults",       NULL, parsed_cmd->bench_faults,                              d1);
+      rpt_str("simulated_monitor_fn", NULL, parsed_cmd->simulated_monitor_fn,                    d1);
+      rpt_str("i2c_record_fn",      NULL, parsed_cmd->i2c_record_fn,                             d1);
+      rpt_str("i2c_replay_fn",      NULL, parsed_cmd->i2c_replay_fn,                             d1);
+      rpt_str("timeline_fn",        NULL, parsed_cmd->timeline_fn,                               d1);
+      rpt_str("fs_root_dir",        NULL, parsed_cmd->fs_root_dir,                               d1);
+      rpt_int("sample_format",      NULL, parsed_cmd->sample_format,                             d1);
+      rpt_str("server_socket_fn",   NULL, parsed_cmd->server_socket_fn,                          d1);
 #ifdef OLD
       rpt_bool("nodetect",          NULL, parsed_cmd->flags & CMD_FLAG_NODETECT,                 d1);
 #endif
@@ -232,14 +265,21 @@ void dbgrpt_parsed_cmd(Parsed_Cmd * parsed_cmd, int depth) {
       rpt_bool("ro only",           NULL, parsed_cmd->flags & CMD_FLAG_RO_ONLY,                  d1);
       rpt_bool("wo only",           NULL, parsed_cmd->flags & CMD_FLAG_WO_ONLY,                  d1);
       rpt_bool("show unsupported",  NULL, parsed_cmd->flags & CMD_FLAG_SHOW_UNSUPPORTED,         d1);
+      rpt_bool("caps only",         NULL, parsed_cmd->flags & CMD_FLAG_CAPS_ONLY,                d1);
+      rpt_bool("express probe",     NULL, parsed_cmd->flags & CMD_FLAG_PROBE_EXPRESS,            d1);
       rpt_bool("enable udf",        NULL, parsed_cmd->flags & CMD_FLAG_ENABLE_UDF,               d1);
       rpt_bool("enable usb",        NULL, parsed_cmd->flags & CMD_FLAG_ENABLE_USB,               d1);
+      rpt_bool("edid only",         NULL, parsed_cmd->flags & CMD_FLAG_EDID_ONLY,                d1);
       rpt_bool("timestamp prefix:", NULL, parsed_cmd->flags & CMD_FLAG_TIMESTAMP_TRACE,          d1);
       rpt_bool("walltime prefix:",  NULL, parsed_cmd->flags & CMD_FLAG_WALLTIME_TRACE,           d1);
+      rpt_bool("trace ring:",       NULL, parsed_cmd->flags & CMD_FLAG_TRACE_RING,               d1);
+      rpt_bool("use server:",       NULL, parsed_cmd->flags & CMD_FLAG_USE_SERVER,               d1);
       rpt_bool("thread id prefix:", NULL, parsed_cmd->flags & CMD_FLAG_THREAD_ID_TRACE,          d1);
       rpt_bool("show settings:",    NULL, parsed_cmd->flags & CMD_FLAG_SHOW_SETTINGS,            d1);
       rpt_bool("enable cached capabilities:",
                                     NULL, parsed_cmd->flags & CMD_FLAG_ENABLE_CACHED_CAPABILITIES, d1);
+      rpt_bool("enable cached displays:",
+                                    NULL, parsed_cmd->flags & CMD_FLAG_ENABLE_CACHED_DISPLAYS, d1);
    // rpt_bool("clear persistent cache:",
    //                               NULL, parsed_cmd->flags & CMD_FLAG_CLEAR_PERSISTENT_CACHE,   d1);
       rpt_str ("MCCS version spec", NULL, format_vspec(parsed_cmd->mccs_vspec),                  d1);
@@ -258,6 +298,7 @@ void dbgrpt_parsed_cmd(Parsed_Cmd * parsed_cmd, int depth) {
 #endif
       rpt_bool("defer sleeps:",     NULL, parsed_cmd->flags & CMD_FLAG_DEFER_SLEEPS,            d1);
       rpt_bool("dynamic_sleep_adjustment:", NULL, parsed_cmd->flags & CMD_FLAG_DSA,             d1);
+      rpt_bool("adaptive maxtries:", NULL, parsed_cmd->flags & CMD_FLAG_ADAPTIVE_MAXTRIES,      d1);
       rpt_bool("per_thread_stats:", NULL, parsed_cmd->flags & CMD_FLAG_PER_THREAD_STATS,        d1);
       rpt_bool("x52 not fifo:",     NULL, parsed_cmd->flags & CMD_FLAG_X52_NO_FIFO,             d1);
       rpt_int("setvcp value count:",NULL, parsed_cmd->setvcp_values->len,                       d1);
@@ -269,8 +310,23 @@ void dbgrpt_parsed_cmd(Parsed_Cmd * parsed_cmd, int depth) {
                          elem->feature_value);
       }
       rpt_int( "edid_read_size:",   NULL, parsed_cmd->edid_read_size,                d1);
+      rpt_int( "async_threads:",    NULL, parsed_cmd->async_threads,                 d1);
+      rpt_int( "adapter_concurrency:", NULL, parsed_cmd->adapter_concurrency,        d1);
+      rpt_int( "i2c_kernel_retries:",  NULL, parsed_cmd->i2c_kernel_retries,         d1);
+      rpt_int( "rt_policy:",           NULL, parsed_cmd->rt_policy,                  d1);
+      rpt_int( "rt_priority:",         NULL, parsed_cmd->rt_priority,                d1);
+      rpt_str( "cpu_affinity:",        NULL, parsed_cmd->cpu_affinity,               d1);
+      rpt_bool("edid from sysfs:",  NULL, parsed_cmd->flags & CMD_FLAG_EDID_FROM_SYSFS, d1);
+      rpt_bool("combined write/read:", NULL, parsed_cmd->flags & CMD_FLAG_I2C_COMBINED_WRITE_READ, d1);
+      rpt_bool("auto write/read:",  NULL, parsed_cmd->flags & CMD_FLAG_I2C_AUTO_WRITE_READ, d1);
+      rpt_bool("prefetch capabilities:", NULL, parsed_cmd->flags & CMD_FLAG_PREFETCH_CAPABILITIES, d1);
+      rpt_bool("all displays:",     NULL, parsed_cmd->flags & CMD_FLAG_ALL_DISPLAYS, d1);
+      rpt_bool("skip unchanged:",   NULL, parsed_cmd->flags & CMD_FLAG_SKIP_UNCHANGED, d1);
+      rpt_bool("json output:",      NULL, parsed_cmd->flags & CMD_FLAG_JSON,         d1);
+      rpt_bool("snapshot output:",  NULL, parsed_cmd->flags & CMD_FLAG_SNAPSHOT,     d1);
       rpt_str ("library trace file:", NULL, parsed_cmd->library_trace_file,          d1);
       rpt_bool("write to syslog:",  NULL, parsed_cmd->flags & CMD_FLAG_SYSLOG,       d1);
+      rpt_bool("async trace:",      NULL, parsed_cmd->flags & CMD_FLAG_ASYNC_TRACE,  d1);
       rpt_int( "i1",                NULL, parsed_cmd->i1,                            d1);
       rpt_bool("f1",                NULL, parsed_cmd->flags & CMD_FLAG_F1,           d1);
       rpt_bool("f2",                NULL, parsed_cmd->flags & CMD_FLAG_F2,           d1);
@@ -42,6 +42,15 @@ typedef enum {
    CMDID_CHKUSBMON     =   0x4000,
    CMDID_PROBE         =   0x8000,
    CMDID_SAVE_SETTINGS = 0x010000,
+   CMDID_BATCH         = 0x020000,
+   CMDID_TIMELINE      = 0x040000,
+   CMDID_SERVE         = 0x080000,
+   CMDID_BENCHMARK     = 0x100000,
+   CMDID_CALIBRATE     = 0x200000,
+   CMDID_CACHE         = 0x400000,
+   CMDID_SNAPSHOT      = 0x800000,
+   CMDID_SAMPLE       = 0x1000000,
+   CMDID_ANALYZE      = 0x2000000,
 } Cmd_Id_Type;
 
 typedef enum {
@@ -87,8 +96,36 @@ typedef enum {
 //                           = 0x1000000000,
    CMD_FLAG_WALLTIME_TRACE   = 0x2000000000,
    CMD_FLAG_SYSLOG           = 0x4000000000,
+   CMD_FLAG_ADAPTIVE_MAXTRIES= 0x8000000000,
+   CMD_FLAG_EDID_FROM_SYSFS = 0x010000000000,
+   CMD_FLAG_ENABLE_CACHED_DISPLAYS
+                           = 0x020000000000,
+   CMD_FLAG_I2C_COMBINED_WRITE_READ
+                           = 0x040000000000,
+   CMD_FLAG_PREFETCH_CAPABILITIES
+                           = 0x080000000000,
+   CMD_FLAG_ALL_DISPLAYS   = 0x100000000000,
+   CMD_FLAG_SKIP_UNCHANGED = 0x200000000000,
+   CMD_FLAG_EXPORT_STATS   = 0x400000000000,
+   CMD_FLAG_TRACE_RING     = 0x800000000000,
+   CMD_FLAG_USE_SERVER   = 0x01000000000000,
+   CMD_FLAG_JSON         = 0x02000000000000,
+   CMD_FLAG_I2C_AUTO_WRITE_READ
+                         = 0x04000000000000,
+   CMD_FLAG_SNAPSHOT     = 0x08000000000000,
+   CMD_FLAG_ASYNC_TRACE  = 0x10000000000000,
+   CMD_FLAG_CAPS_ONLY    = 0x20000000000000,
+   CMD_FLAG_PROBE_EXPRESS = 0x40000000000000,
+   CMD_FLAG_LOCK_STATS   = 0x80000000000000,
+   CMD_FLAG_EDID_ONLY  = 0x0100000000000000,
 } Parsed_Cmd_Flags;
 
+/** Output format of command SAMPLE */
+typedef
+enum {SAMPLE_FORMAT_CSV,
+      SAMPLE_FORMAT_LINE_PROTOCOL
+} Sample_Output_Format;
+
 typedef
 enum {VALUE_TYPE_ABSOLUTE,
       VALUE_TYPE_RELATIVE_PLUS,
@@ -115,7 +152,16 @@ struct {
    Feature_Set_Ref*       fref;
    GArray *               setvcp_values;
    DDCA_Stats_Type        stats_types;
+   DDCA_Stats_Export_Format stats_export_format;
+   Sample_Output_Format   sample_format;
    char *                 failsim_control_fn;
+   char *                 bench_faults;       // fault scenarios used by BENCHMARK
+   char *                 simulated_monitor_fn;
+   char *                 i2c_record_fn;
+   char *                 i2c_replay_fn;
+   char *                 timeline_fn;
+   char *                 fs_root_dir;        // prefix for /sys and /dev paths
+   char *                 server_socket_fn;
    Display_Identifier*    pdid;
 // Display_Selector*      display_selector;   // for future use
    DDCA_Trace_Group       traced_groups;
@@ -124,9 +170,17 @@ struct {
    DDCA_Output_Level      output_level;
    uint16_t               max_tries[3];
    float                  sleep_multiplier;
+   float                  bench_multipliers[MAX_BENCH_MULTIPLIERS];
+   int                    bench_multiplier_ct;
    DDCA_MCCS_Version_Spec mccs_vspec;
 // DDCA_MCCS_Version_Id   mccs_version_id;
    int                    edid_read_size;
+   int                    async_threads;
+   int                    adapter_concurrency;
+   int                    i2c_kernel_retries;
+   int                    rt_policy;          // -1 if not set
+   int                    rt_priority;
+   char *                 cpu_affinity;       // CPU list for DDC I/O threads
    uint64_t               flags;      // Parsed_Cmd_Flags
    char *                 library_trace_file;
    int                    i1;         // for temporary use
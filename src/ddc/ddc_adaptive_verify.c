@@ -0,0 +1,166 @@
+/** @file ddc_adaptive_verify.c
+ *
+ *  Skips most verifications of writes to a feature once the display has
+ *  reliably applied the values written.
+ *
+ *  Verifying a write reads the feature back, which roughly doubles the
+ *  cost of a write.  When adaptive verification is enabled, the outcome of
+ *  each verification is tracked separately for each display and feature.
+ *  After #ADAPTIVE_VERIFY_CONFIDENT_STREAK consecutive verifications have
+ *  passed, only every #ADAPTIVE_VERIFY_SAMPLE_INTERVAL'th write is verified.
+ *  A mismatch returns the feature to verifying every write.  A read back
+ *  that fails with an I/O error does not change the history.
+ *
+ *  Writes whose caller requests the value read back are always verified.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/stats_export.h"
+
+#include "ddc/ddc_adaptive_verify.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+static bool     adaptive_verify_enabled = false;
+static GMutex   verify_history_mutex;       // protects Display_Ref.verify_history
+static uint64_t passed_ct  = 0;             // atomic access
+static uint64_t failed_ct  = 0;             // atomic access
+static uint64_t skipped_ct = 0;             // atomic access
+
+
+/** Enables or disables adaptive verification of writes.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global, not thread-specific.  Whether writes are
+ *  verified at all remains a thread-specific setting.
+ */
+bool ddc_enable_adaptive_verify(bool onoff) {
+   bool old = adaptive_verify_enabled;
+   adaptive_verify_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether adaptive verification of writes is enabled.
+ *
+ *  \return true/false
+ */
+bool ddc_is_adaptive_verify_enabled() {
+   return adaptive_verify_enabled;
+}
+
+
+// Must be called with verify_history_mutex held
+static Verify_History *
+get_verify_history(Display_Ref * dref, Byte feature_code) {
+   if (!dref->verify_history)
+      dref->verify_history = calloc(256, sizeof(Verify_History));
+   return &dref->verify_history[feature_code];
+}
+
+
+/** Decides whether the verification of a write can be skipped.
+ *  Each call is counted as a write to be verified.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  feature written
+ *  \return true if the verification is to be skipped
+ */
+bool
+ddc_skip_verification(Display_Ref * dref, Byte feature_code) {
+   bool debug = false;
+   if (!adaptive_verify_enabled)
+      return false;
+
+   bool skip = false;
+   g_mutex_lock(&verify_history_mutex);
+   Verify_History * history = get_verify_history(dref, feature_code);
+   if (history->pass_streak >= ADAPTIVE_VERIFY_CONFIDENT_STREAK) {
+      if (++history->unverified_ct < ADAPTIVE_VERIFY_SAMPLE_INTERVAL)
+         skip = true;
+      else
+         history->unverified_ct = 0;
+   }
+   g_mutex_unlock(&verify_history_mutex);
+
+   if (skip)
+      __atomic_add_fetch(&skipped_ct, 1, __ATOMIC_RELAXED);
+   DBGTRC(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x, returning %s",
+                              dref_repr_t(dref), feature_code, sbool(skip));
+   return skip;
+}
+
+
+/** Records the outcome of a verification.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  feature written
+ *  \param  psc           0 if the verification passed, DDCRC_VERIFY if the
+ *                        value read differs, other if the read failed
+ */
+void
+ddc_record_verification(Display_Ref * dref, Byte feature_code, DDCA_Status psc) {
+   bool debug = false;
+   if (!adaptive_verify_enabled || (psc != 0 && psc != DDCRC_VERIFY))
+      return;
+
+   g_mutex_lock(&verify_history_mutex);
+   Verify_History * history = get_verify_history(dref, feature_code);
+   if (psc == 0) {
+      if (history->pass_streak < UINT16_MAX)
+         history->pass_streak++;
+   }
+   else {
+      history->pass_streak   = 0;
+      history->unverified_ct = 0;
+   }
+   int streak = history->pass_streak;
+   g_mutex_unlock(&verify_history_mutex);
+
+   __atomic_add_fetch((psc == 0) ? &passed_ct : &failed_ct, 1, __ATOMIC_RELAXED);
+   DBGTRC(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x, psc=%s, pass_streak=%d",
+                              dref_repr_t(dref), feature_code, psc_name_code(psc), streak);
+}
+
+
+/** Exports the counts of verifications passed, failed, and skipped
+ *  while adaptive verification is enabled.
+ *
+ *  \param exp  export instance
+ */
+void
+export_adaptive_verify_stats(Stats_Export * exp) {
+   stats_export_metric(exp, "ddcutil_adaptive_verify_total", STATS_METRIC_COUNTER,
+                            "Verifications of writes with adaptive verification enabled, by result");
+   stats_export_sample(exp, "ddcutil_adaptive_verify_total",
+                       __atomic_load_n(&passed_ct, __ATOMIC_RELAXED),  1, "result", "passed");
+   stats_export_sample(exp, "ddcutil_adaptive_verify_total",
+                       __atomic_load_n(&failed_ct, __ATOMIC_RELAXED),  1, "result", "failed");
+   stats_export_sample(exp, "ddcutil_adaptive_verify_total",
+                       __atomic_load_n(&skipped_ct, __ATOMIC_RELAXED), 1, "result", "skipped");
+}
+
+
+void
+init_ddc_adaptive_verify() {
+   RTTI_ADD_FUNC(ddc_skip_verification);
+   RTTI_ADD_FUNC(ddc_record_verification);
+}
@@ -0,0 +1,28 @@
+/** @file ddc_adaptive_verify.h
+ *
+ *  Skips most verifications of writes to features that reliably apply them
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_ADAPTIVE_VERIFY_H_
+#define DDC_ADAPTIVE_VERIFY_H_
+
+#include <stdbool.h>
+
+#include "ddcutil_types.h"
+
+#include "util/coredefs.h"
+
+#include "base/displays.h"
+#include "base/stats_export.h"
+
+bool ddc_enable_adaptive_verify(bool onoff);
+bool ddc_is_adaptive_verify_enabled();
+bool ddc_skip_verification(Display_Ref * dref, Byte feature_code);
+void ddc_record_verification(Display_Ref * dref, Byte feature_code, DDCA_Status psc);
+void export_adaptive_verify_stats(Stats_Export * exp);
+void init_ddc_adaptive_verify();
+
+#endif /* DDC_ADAPTIVE_VERIFY_H_ */
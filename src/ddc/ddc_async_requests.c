@@ -0,0 +1,1017 @@
+/** @file ddc_async_requests.c
+ *
+ *  Per-display queue of VCP get/set requests.
+ *
+ *  Each display has at most one worker thread, started when the first
+ *  request for the display is queued.  The thread executes the requests for
+ *  the display in the order they were queued, and calls the request's
+ *  notification function as each one completes.  This allows a client to
+ *  drive multiple monitors concurrently without blocking on DDC round trips.
+ *
+ *  The queue, its lock, and the worker thread are maintained in the
+ *  display's #Display_Async_Rec.
+ *
+ *  If setvcp coalescing is enabled, a write to a feature replaces any write
+ *  to the same feature on the same display that is still waiting in the
+ *  queue.  When a slider generates a stream of values, only the newest one
+ *  is sent once the bus is free, and verification is performed only after
+ *  the last write.
+ *
+ *  If save settings debouncing is enabled, a request to save the current
+ *  settings of a display is not performed immediately.  It is performed by
+ *  the worker thread once no further save request for the display has been
+ *  made for the debounce interval, so a client that saves after every
+ *  change of a slider sends only one Save Current Settings command, and
+ *  pays the post-save delay only once.
+ *
+ *  A ramp request changes a continuous feature to a new value gradually
+ *  over a given time, e.g. to fade brightness.  The worker thread paces the
+ *  intermediate writes itself, and a newer write to the feature ends the
+ *  ramp in progress.
+ *
+ *  Queued reads are performed with background priority and queued writes
+ *  with interactive priority, see ddc_io_scheduler.c.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/error_info.h"
+#include "util/report_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/thread_sched.h"
+
+#include "ddc/ddc_completion_queue.h"
+#include "ddc/ddc_io_scheduler.h"
+#include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_remembered_values.h"
+#include "ddc/ddc_vcp.h"
+
+#include "ddc/ddc_async_requests.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+static GMutex      worker_recs_mutex;
+static GPtrArray * worker_recs = NULL;   // Display_Async_Rec's with a worker thread
+
+static bool        setvcp_coalescing_enabled = false;
+static int         save_settings_debounce_millisec = DEFAULT_SAVE_SETTINGS_DEBOUNCE_MILLISEC;
+
+
+/** Enables or disables coalescing of queued writes to the same feature.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global, not thread-specific.
+ */
+bool ddc_enable_setvcp_coalescing(bool onoff) {
+   bool old = setvcp_coalescing_enabled;
+   setvcp_coalescing_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether coalescing of queued writes is enabled.
+ *
+ *  \return true/false
+ */
+bool ddc_is_setvcp_coalescing_enabled() {
+   return setvcp_coalescing_enabled;
+}
+
+
+/** Sets the interval for debouncing Save Current Settings requests.
+ *
+ *  \param  millisec  interval, 0 to disable debouncing
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global, not thread-specific.
+ */
+int ddc_set_save_settings_debounce(int millisec) {
+   assert(millisec >= 0);
+   int old = save_settings_debounce_millisec;
+   save_settings_debounce_millisec = millisec;
+   return old;
+}
+
+
+/** Returns the interval for debouncing Save Current Settings requests.
+ *
+ *  \return interval in milliseconds, 0 if debouncing is disabled
+ */
+int ddc_get_save_settings_debounce() {
+   return save_settings_debounce_millisec;
+}
+
+
+/** Finds a coalescable write to a feature that is waiting in a display's queue.
+ *
+ *  \param  async_rec     queue for display
+ *  \param  feature_code  VCP feature code
+ *  \return pending request, NULL if none
+ *
+ *  \remark
+ *  The caller must hold the queue lock.
+ */
+static Display_Async_Request *
+find_pending_coalesced_set(
+      Display_Async_Rec *   async_rec,
+      DDCA_Vcp_Feature_Code feature_code)
+{
+   for (GList * cur = async_rec->request_queue->head; cur; cur = cur->next) {
+      Display_Async_Request * request = cur->data;
+      if (request->coalesce &&
+          request->request_type == DDCA_Q_VCP_SET &&
+          request->feature_code == feature_code)
+         return request;
+   }
+   return NULL;
+}
+
+
+/** Checks whether a write to a feature is waiting in a display's queue,
+ *  i.e. whether a ramp of the feature has been superseded.
+ *
+ *  \param  async_rec     queue for display
+ *  \param  feature_code  VCP feature code
+ *  \return true if a write is waiting
+ *
+ *  \remark
+ *  The caller must hold the queue lock.
+ */
+static bool
+is_set_request_pending(
+      Display_Async_Rec *   async_rec,
+      DDCA_Vcp_Feature_Code feature_code)
+{
+   for (GList * cur = async_rec->request_queue->head; cur; cur = cur->next) {
+      Display_Async_Request * request = cur->data;
+      if (request->request_type == DDCA_Q_VCP_SET && request->feature_code == feature_code)
+         return true;
+   }
+   return false;
+}
+
+
+/** Maps the elapsed fraction of a ramp to the fraction of the change in value */
+static double
+ramp_ease(DDCA_Ramp_Easing easing, double t) {
+   switch(easing) {
+   case DDCA_RAMP_EASE_IN:      return t * t;
+   case DDCA_RAMP_EASE_OUT:     return t * (2 - t);
+   case DDCA_RAMP_EASE_IN_OUT:  return t * t * (3 - 2*t);
+   default:                     return t;
+   }
+}
+
+
+/** Ramps a non-table feature from its current value to the request's value.
+ *
+ *  The value written at each step is computed from the time elapsed since the
+ *  ramp started, not from a step count, so if a write is delayed, e.g. by a
+ *  retry or an increased dynamic sleep adjustment, the intermediate values
+ *  that are already due are skipped instead of the ramp falling behind.
+ *  Steps are paced by the shortest time one write has been measured to take
+ *  on the display, including its post-write sleep, but are never more
+ *  frequent than the value changes.
+ *
+ *  The ramp is abandoned, keeping the last value written, as soon as another
+ *  write to the feature is queued for the display.  If the worker thread is
+ *  asked to shut down, the target value is written immediately.
+ *
+ *  \param  request      ramp request
+ *  \param  written_loc  where to return the last value written
+ *  \return #Error_Info if failure, NULL if success
+ */
+static Error_Info *
+execute_ramp(Display_Async_Request * request, uint16_t * written_loc) {
+   bool debug = false;
+   Display_Handle * dh = request->dh;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x, target=%d, ramp_millisec=%d, easing=%d",
+                   dh_repr(dh), request->feature_code, request->new_value,
+                   request->ramp_millisec, request->ramp_easing);
+
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   Parsed_Nontable_Vcp_Response * response = NULL;
+   Error_Info * excp = ddc_get_nontable_vcp_value(dh, request->feature_code, &response);
+   if (excp)
+      goto bye;
+   int start_value = RESPONSE_CUR_VALUE(response);
+   int target = request->new_value;
+   if (RESPONSE_MAX_VALUE(response) > 0 && target > RESPONSE_MAX_VALUE(response))
+      target = RESPONSE_MAX_VALUE(response);
+   free(response);
+
+   int delta = target - start_value;
+   uint64_t duration = request->ramp_millisec * (uint64_t) 1000000;
+   uint64_t value_interval = (delta != 0) ? duration / abs(delta) : duration;
+   uint64_t write_interval = 0;     // shortest measured write, 0 until measured
+   uint64_t start_time = cur_monotonic_nanosec();
+   int last_written = start_value;
+   int step_ct = 0;
+   *written_loc = start_value;
+
+   bool cancelled = false;
+   while (!cancelled) {
+      uint64_t now = cur_monotonic_nanosec();
+      int value = target;
+      if (now - start_time < duration) {
+         double change = delta * ramp_ease(request->ramp_easing, (double) (now - start_time) / duration);
+         value = start_value + (int) ((change < 0) ? change - 0.5 : change + 0.5);
+      }
+      if (value != last_written) {
+         excp = ddc_set_nontable_vcp_value(dh, request->feature_code, value);
+         if (excp)
+            break;
+         uint64_t elapsed = cur_monotonic_nanosec() - now;
+         if (write_interval == 0 || elapsed < write_interval)
+            write_interval = elapsed;
+         last_written = value;
+         *written_loc = value;
+         step_ct++;
+      }
+      if (value == target)
+         break;
+
+      uint64_t next_step = now + ((write_interval > value_interval) ? write_interval : value_interval);
+      g_mutex_lock(&async_rec->request_queue_lock);
+      while ( !(cancelled = is_set_request_pending(async_rec, request->feature_code)) &&
+              !async_rec->request_thread_shutdown)
+      {
+         now = cur_monotonic_nanosec();
+         if (now >= next_step)
+            break;
+         g_cond_wait_until(&async_rec->request_queue_cond, &async_rec->request_queue_lock,
+                           g_get_monotonic_time() + (next_step - now) / 1000 + 1);
+      }
+      if (async_rec->request_thread_shutdown)
+         duration = 0;    // go directly to target
+      g_mutex_unlock(&async_rec->request_queue_lock);
+   }
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "step_ct=%d, write_interval=%"PRIu64" nanosec, cancelled=%s",
+                                       step_ct, write_interval, sbool(cancelled));
+
+bye:
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, excp, "*written_loc=%d", *written_loc);
+   return excp;
+}
+
+
+static void execute_async_request(Display_Async_Request * request) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, request_type=0x%02x, feature_code=0x%02x",
+                   dh_repr(request->dh), request->request_type, request->feature_code);
+
+   Error_Info * excp = NULL;
+   DDCA_Any_Vcp_Value * valrec = NULL;
+   // queued reads are typically polling, while queued writes are driven by the user
+   DDCA_IO_Priority saved_priority = ddc_set_thread_io_priority(
+         (request->request_type == DDCA_Q_VCP_GET) ? DDCA_IO_PRIORITY_BACKGROUND
+                                                   : DDCA_IO_PRIORITY_INTERACTIVE);
+   if (request->request_type == DDCA_Q_VCP_GET) {
+      excp = ddc_get_vcp_value(request->dh, request->feature_code, request->value_type, &valrec);
+      if (!excp && request->value_loc && valrec->value_type == DDCA_NON_TABLE_VCP_VALUE) {
+         request->value_loc->mh = valrec->val.c_nc.mh;
+         request->value_loc->ml = valrec->val.c_nc.ml;
+         request->value_loc->sh = valrec->val.c_nc.sh;
+         request->value_loc->sl = valrec->val.c_nc.sl;
+      }
+   }
+   else {
+      assert(request->request_type == DDCA_Q_VCP_SET);
+      uint16_t written_value = request->new_value;
+      if (request->ramp_millisec > 0)
+         excp = execute_ramp(request, &written_value);
+      else
+         excp = ddc_set_nontable_vcp_value(request->dh, request->feature_code, request->new_value);
+      if (!excp) {
+         valrec = calloc(1, sizeof(DDCA_Any_Vcp_Value));
+         valrec->opcode = request->feature_code;
+         valrec->value_type = DDCA_NON_TABLE_VCP_VALUE;
+         valrec->val.c_nc.sh = written_value >> 8;
+         valrec->val.c_nc.sl = written_value & 0xff;
+
+         if (request->verify) {
+            // a newer value for the feature is already waiting, verify after it instead
+            Display_Async_Rec * async_rec = request->dh->dref->async_rec;
+            g_mutex_lock(&async_rec->request_queue_lock);
+            bool superseded = find_pending_coalesced_set(async_rec, request->feature_code);
+            g_mutex_unlock(&async_rec->request_queue_lock);
+            if (superseded)
+               DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Newer value pending, skipping verification");
+            else
+               excp = ddc_verify_vcp_value(request->dh, valrec, NULL);
+         }
+      }
+   }
+   ddc_set_thread_io_priority(saved_priority);
+   DDCA_Status psc = ERRINFO_STATUS(excp);
+   ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+   if (request->status_loc)
+      *request->status_loc = psc;
+   if (request->completed_loc)
+      *request->completed_loc = cur_monotonic_nanosec();
+
+   // on failure, the client is still told which feature the notification is for
+   if (!valrec) {
+      valrec = calloc(1, sizeof(DDCA_Any_Vcp_Value));
+      valrec->opcode = request->feature_code;
+      valrec->value_type = request->value_type;
+   }
+
+   if (request->completion_queue) {
+      DDCA_Completion completion = {0};
+      completion.user_data    = request->user_data;
+      completion.dh           = request->dh;
+      completion.is_write     = (request->request_type == DDCA_Q_VCP_SET);
+      completion.feature_code = request->feature_code;
+      completion.status       = psc;
+      if (psc == 0 && valrec->value_type == DDCA_NON_TABLE_VCP_VALUE) {
+         completion.value.mh = valrec->val.c_nc.mh;
+         completion.value.ml = valrec->val.c_nc.ml;
+         completion.value.sh = valrec->val.c_nc.sh;
+         completion.value.sl = valrec->val.c_nc.sl;
+      }
+      ddc_post_completion(request->completion_queue, &completion);
+   }
+   else if (request->refresh)
+      ddc_finish_remembered_value_refresh(request->dh->dref, request->feature_code, psc, valrec,
+            (request->has_prior_value) ? &request->prior_value : NULL, request->callback);
+   else if (request->callback)
+      request->callback(psc, valrec);
+
+   if (valrec->value_type == DDCA_TABLE_VCP_VALUE)
+      free(valrec->val.t.bytes);
+   free(valrec);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "psc=%s", psc_desc(psc));
+}
+
+
+static void execute_debounced_save(Display_Handle * dh) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+
+   DDCA_IO_Priority saved_priority = ddc_set_thread_io_priority(DDCA_IO_PRIORITY_BACKGROUND);
+   Error_Info * excp = ddc_save_current_settings(dh);
+   ddc_set_thread_io_priority(saved_priority);
+   DDCA_Status psc = ERRINFO_STATUS(excp);
+   // there is no client waiting for the result, so report it
+   ERRINFO_FREE_WITH_REPORT(excp, true);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, psc, "");
+}
+
+
+static inline bool
+is_save_settings_due(Display_Async_Rec * async_rec) {
+   return async_rec->save_settings_due != 0 &&
+          g_get_monotonic_time() >= async_rec->save_settings_due;
+}
+
+
+static gpointer async_request_worker(gpointer data) {
+   bool debug = false;
+   Display_Async_Rec * async_rec = data;
+   assert(memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dpath=%s", dpath_repr_t(&async_rec->dpath));
+   apply_worker_thread_sched();
+
+   g_mutex_lock(&async_rec->request_queue_lock);
+   while (true) {
+      while (g_queue_is_empty(async_rec->request_queue) &&
+             !async_rec->request_thread_shutdown &&
+             !is_save_settings_due(async_rec))
+      {
+         if (async_rec->save_settings_due)
+            g_cond_wait_until(&async_rec->request_queue_cond, &async_rec->request_queue_lock,
+                              async_rec->save_settings_due);
+         else
+            g_cond_wait(&async_rec->request_queue_cond, &async_rec->request_queue_lock);
+      }
+
+      if (g_queue_is_empty(async_rec->request_queue)) {
+         if (!async_rec->save_settings_due)
+            break;     // shutdown requested and queue is drained
+
+         // save is due, or shutdown requested
+         Display_Handle * dh = async_rec->save_settings_dh;
+         async_rec->save_settings_due = 0;
+         async_rec->save_settings_dh = NULL;
+         async_rec->request_executing = true;
+         g_mutex_unlock(&async_rec->request_queue_lock);
+
+         execute_debounced_save(dh);
+
+         g_mutex_lock(&async_rec->request_queue_lock);
+         async_rec->request_executing = false;
+         g_cond_broadcast(&async_rec->request_queue_cond);
+         continue;
+      }
+
+      Display_Async_Request * request = g_queue_pop_head(async_rec->request_queue);
+      async_rec->request_executing = true;
+      g_mutex_unlock(&async_rec->request_queue_lock);
+
+      assert(memcmp(request->marker, DISPLAY_ASYNC_REQUEST_MARKER, 4) == 0);
+      execute_async_request(request);
+      free(request);
+
+      g_mutex_lock(&async_rec->request_queue_lock);
+      async_rec->request_executing = false;
+      g_cond_broadcast(&async_rec->request_queue_cond);
+   }
+   g_mutex_unlock(&async_rec->request_queue_lock);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "dpath=%s", dpath_repr_t(&async_rec->dpath));
+   return NULL;
+}
+
+
+/** Starts the worker thread for a display if it is not already running.
+ *
+ *  \param  async_rec  queue for display
+ *
+ *  \remark
+ *  The caller must hold the queue lock.
+ */
+static void
+start_worker_thread(Display_Async_Rec * async_rec) {
+   if (!async_rec->request_execution_thread) {
+      char thread_name[40];
+      g_snprintf(thread_name, 40, "ddc-%s", dpath_short_name_t(&async_rec->dpath));
+      async_rec->request_execution_thread =
+            g_thread_new(thread_name, async_request_worker, async_rec);
+      g_mutex_lock(&worker_recs_mutex);
+      if (!worker_recs)
+         worker_recs = g_ptr_array_new();
+      g_ptr_array_add(worker_recs, async_rec);
+      g_mutex_unlock(&worker_recs_mutex);
+   }
+}
+
+
+/** Adds a request to a display's queue, starting the worker thread if necessary.
+ *
+ *  \param  async_rec  queue for display
+ *  \param  request    request to queue
+ *  \retval 0                        request queued
+ *  \retval DDCRC_INVALID_OPERATION  display is being closed, request not queued
+ *
+ *  \remark
+ *  If the request is a coalescable write and a write to the same feature is
+ *  still waiting in the queue, the waiting request is updated in place and
+ *  **request** is freed.
+ */
+static DDCA_Status
+queue_request(
+      Display_Async_Rec *     async_rec,
+      Display_Async_Request * request)
+{
+   bool debug = false;
+   DDCA_Status ddcrc = 0;
+
+   g_mutex_lock(&async_rec->request_queue_lock);
+   if (async_rec->request_thread_shutdown) {
+      ddcrc = DDCRC_INVALID_OPERATION;
+      free(request);
+   }
+   else {
+      Display_Async_Request * pending = NULL;
+      if (request->coalesce)
+         pending = find_pending_coalesced_set(async_rec, request->feature_code);
+      if (pending) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP,
+               "Replacing pending value 0x%04x for feature 0x%02x with 0x%04x",
+               pending->new_value, request->feature_code, request->new_value);
+         pending->new_value = request->new_value;
+         pending->verify    = request->verify;
+         pending->callback  = request->callback;
+         free(request);
+      }
+      else {
+         g_queue_push_tail(async_rec->request_queue, request);
+         start_worker_thread(async_rec);
+         g_cond_broadcast(&async_rec->request_queue_cond);
+      }
+   }
+   g_mutex_unlock(&async_rec->request_queue_lock);
+
+   return ddcrc;
+}
+
+
+static Display_Async_Request *
+new_async_request(
+      Display_Handle *         dh,
+      DDCA_Queued_Request_Type request_type,
+      DDCA_Vcp_Feature_Code    feature_code,
+      DDCA_Vcp_Value_Type      value_type,
+      uint16_t                 new_value,
+      DDCA_Notification_Func   callback)
+{
+   Display_Async_Request * request = calloc(1, sizeof(Display_Async_Request));
+   memcpy(request->marker, DISPLAY_ASYNC_REQUEST_MARKER, 4);
+   request->request_type = request_type;
+   request->dh           = dh;
+   request->feature_code = feature_code;
+   request->value_type   = value_type;
+   request->new_value    = new_value;
+   request->callback     = callback;
+   return request;
+}
+
+
+/** Queues a request for execution by the worker thread for a display.
+ *
+ *  \param  dh            handle for open display
+ *  \param  request_type  DDCA_Q_VCP_GET or DDCA_Q_VCP_SET
+ *  \param  feature_code  VCP feature code
+ *  \param  value_type    value type of feature, for DDCA_Q_VCP_GET
+ *  \param  new_value     value to set, for DDCA_Q_VCP_SET
+ *  \param  callback      function to call when the request completes
+ *  \retval 0                        request queued
+ *  \retval DDCRC_INVALID_OPERATION  display is being closed
+ *
+ *  \remark
+ *  The #DDCA_Any_Vcp_Value passed to the callback is valid only for the
+ *  duration of the callback.
+ */
+DDCA_Status ddc_queue_async_request(
+      Display_Handle *         dh,
+      DDCA_Queued_Request_Type request_type,
+      DDCA_Vcp_Feature_Code    feature_code,
+      DDCA_Vcp_Value_Type      value_type,
+      uint16_t                 new_value,
+      DDCA_Notification_Func   callback)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, request_type=0x%02x, feature_code=0x%02x",
+                   dh_repr(dh), request_type, feature_code);
+   assert(request_type == DDCA_Q_VCP_GET || request_type == DDCA_Q_VCP_SET);
+
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+
+   Display_Async_Request * request =
+         new_async_request(dh, request_type, feature_code, value_type, new_value, callback);
+   DDCA_Status ddcrc = queue_request(async_rec, request);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Queues a write of a non-table feature that may be collapsed with other
+ *  writes to the same feature.
+ *
+ *  If a write to the feature is still waiting in the display's queue, its
+ *  value is replaced by **new_value** and no new request is queued.
+ *  Verification, if enabled for the calling thread, is performed only if
+ *  no newer value for the feature is waiting when the write completes.
+ *
+ *  \param  dh            handle for open display
+ *  \param  feature_code  VCP feature code
+ *  \param  new_value     value to set
+ *  \param  callback      function to call when the write completes, may be NULL
+ *  \retval 0                        request queued or coalesced
+ *  \retval DDCRC_INVALID_OPERATION  display is being closed
+ */
+DDCA_Status ddc_queue_coalesced_set_request(
+      Display_Handle *         dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint16_t                 new_value,
+      DDCA_Notification_Func   callback)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x, new_value=0x%04x",
+                   dh_repr(dh), feature_code, new_value);
+
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+
+   Display_Async_Request * request =
+         new_async_request(dh, DDCA_Q_VCP_SET, feature_code, DDCA_NON_TABLE_VCP_VALUE, new_value, callback);
+   request->coalesce = true;
+   request->verify   = ddc_get_verify_setvcp();  // verify setting is thread specific
+   DDCA_Status ddcrc = queue_request(async_rec, request);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Queues a gradual change of a continuous feature to a new value.
+ *
+ *  The ramp is performed by the display's worker thread, see #execute_ramp().
+ *  Queueing another write to the feature, including another ramp, ends the
+ *  ramp in progress and continues from the value it last wrote.
+ *
+ *  \param  dh                 handle for open display
+ *  \param  feature_code       VCP feature code
+ *  \param  target_value       final value
+ *  \param  duration_millisec  duration of the ramp
+ *  \param  easing             progression of the value over the ramp
+ *  \param  callback           function to call when the ramp completes or is
+ *                             abandoned, may be NULL
+ *  \retval 0                        request queued
+ *  \retval DDCRC_INVALID_OPERATION  display is being closed
+ */
+DDCA_Status ddc_queue_ramp_request(
+      Display_Handle *         dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint16_t                 target_value,
+      int                      duration_millisec,
+      DDCA_Ramp_Easing         easing,
+      DDCA_Notification_Func   callback)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x, target_value=%d, duration_millisec=%d",
+                   dh_repr(dh), feature_code, target_value, duration_millisec);
+
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+
+   Display_Async_Request * request =
+         new_async_request(dh, DDCA_Q_VCP_SET, feature_code, DDCA_NON_TABLE_VCP_VALUE, target_value, callback);
+   request->ramp_millisec = (duration_millisec > 0) ? duration_millisec : 0;
+   request->ramp_easing   = easing;
+   DDCA_Status ddcrc = queue_request(async_rec, request);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Requests that the current settings of a display be saved once save
+ *  requests for the display stop arriving.
+ *
+ *  The Save Current Settings command is sent by the display's worker thread
+ *  when no further request has been made for the debounce interval, or when
+ *  the display is closed.  Each request restarts the interval.
+ *
+ *  \param  dh    handle for open I2C display
+ *  \retval 0                        save scheduled
+ *  \retval DDCRC_INVALID_OPERATION  display is being closed
+ */
+DDCA_Status ddc_queue_debounced_save(Display_Handle * dh) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+   assert(dh->dref->io_path.io_mode == DDCA_IO_I2C);
+
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+
+   DDCA_Status ddcrc = 0;
+   g_mutex_lock(&async_rec->request_queue_lock);
+   if (async_rec->request_thread_shutdown) {
+      ddcrc = DDCRC_INVALID_OPERATION;
+   }
+   else {
+      async_rec->save_settings_due =
+            g_get_monotonic_time() + (gint64) save_settings_debounce_millisec * 1000;
+      async_rec->save_settings_dh = dh;
+      start_worker_thread(async_rec);
+      g_cond_broadcast(&async_rec->request_queue_cond);
+   }
+   g_mutex_unlock(&async_rec->request_queue_lock);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Sets a non-table VCP feature to the same value on multiple displays.
+ *
+ *  Each display is opened and the write is queued to the display's worker
+ *  thread, so the writes to all displays proceed concurrently.  Displays on
+ *  the same physical adapter are still subject to the adapter concurrency
+ *  limit (see #ddc_set_max_adapter_concurrency()).  The function returns
+ *  once every write has completed and the displays have been closed.
+ *
+ *  \param  drefs         array of display references
+ *  \param  dref_ct       number of display references
+ *  \param  feature_code  VCP feature code
+ *  \param  new_value     value to set
+ *  \param  callopts      options for opening the displays
+ *  \param  statuses      array of **dref_ct** status codes, set to the
+ *                        status of opening and writing each display
+ *
+ *  \remark
+ *  The write is verified if verification is enabled for the calling thread.
+ */
+void ddc_set_nontable_vcp_values_multi(
+      Display_Ref **           drefs,
+      int                      dref_ct,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint16_t                 new_value,
+      Call_Options             callopts,
+      DDCA_Status *            statuses)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref_ct=%d, feature_code=0x%02x, new_value=0x%04x",
+                   dref_ct, feature_code, new_value);
+
+   bool verify = ddc_get_verify_setvcp();   // verify setting is thread specific
+   Display_Handle ** dhs = calloc(dref_ct, sizeof(Display_Handle *));
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      statuses[ndx] = ddc_open_display(drefs[ndx], callopts, &dhs[ndx]);
+      if (statuses[ndx] != 0)
+         continue;
+      Display_Async_Rec * async_rec = dhs[ndx]->dref->async_rec;
+      assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+      Display_Async_Request * request =
+            new_async_request(dhs[ndx], DDCA_Q_VCP_SET, feature_code, DDCA_NON_TABLE_VCP_VALUE, new_value, NULL);
+      request->verify     = verify;
+      request->status_loc = &statuses[ndx];
+      DDCA_Status ddcrc = queue_request(async_rec, request);
+      if (ddcrc != 0)
+         statuses[ndx] = ddcrc;
+   }
+
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      if (dhs[ndx]) {
+         ddc_wait_async_requests(dhs[ndx]);
+         ddc_close_display(dhs[ndx]);
+      }
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s: %s", dref_repr_t(drefs[ndx]), psc_desc(statuses[ndx]));
+   }
+   free(dhs);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Gets the value of a non-table VCP feature from multiple displays.
+ *
+ *  As for #ddc_set_nontable_vcp_values_multi(), each display is opened and
+ *  the read is queued to the display's worker thread, so the reads proceed
+ *  concurrently, subject to the adapter concurrency limit.  The function
+ *  returns once every read has completed and the displays have been closed.
+ *
+ *  \param  drefs         array of display references
+ *  \param  dref_ct       number of display references
+ *  \param  feature_code  VCP feature code
+ *  \param  callopts      options for opening the displays
+ *  \param  valrecs       array of **dref_ct** values, set to the value read
+ *                        from each display, zeroed if the read failed
+ *  \param  statuses      array of **dref_ct** status codes, set to the
+ *                        status of opening and reading each display
+ */
+void ddc_get_nontable_vcp_values_multi(
+      Display_Ref **           drefs,
+      int                      dref_ct,
+      DDCA_Vcp_Feature_Code    feature_code,
+      Call_Options             callopts,
+      DDCA_Non_Table_Vcp_Value * valrecs,
+      DDCA_Status *            statuses)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref_ct=%d, feature_code=0x%02x", dref_ct, feature_code);
+
+   Display_Handle ** dhs = calloc(dref_ct, sizeof(Display_Handle *));
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      memset(&valrecs[ndx], 0, sizeof(DDCA_Non_Table_Vcp_Value));
+      statuses[ndx] = ddc_open_display(drefs[ndx], callopts, &dhs[ndx]);
+      if (statuses[ndx] != 0)
+         continue;
+      Display_Async_Rec * async_rec = dhs[ndx]->dref->async_rec;
+      assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+      Display_Async_Request * request =
+            new_async_request(dhs[ndx], DDCA_Q_VCP_GET, feature_code, DDCA_NON_TABLE_VCP_VALUE, 0, NULL);
+      request->status_loc = &statuses[ndx];
+      request->value_loc  = &valrecs[ndx];
+      DDCA_Status ddcrc = queue_request(async_rec, request);
+      if (ddcrc != 0)
+         statuses[ndx] = ddcrc;
+   }
+
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      if (dhs[ndx]) {
+         ddc_wait_async_requests(dhs[ndx]);
+         ddc_close_display(dhs[ndx]);
+      }
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s: %s", dref_repr_t(drefs[ndx]), psc_desc(statuses[ndx]));
+   }
+   free(dhs);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Queues a read of a non-table feature whose results are stored rather
+ *  than passed to a callback.  Used for periodic sampling, see
+ *  ddc_feature_sampler.c.
+ *
+ *  \param  dh             handle for open display
+ *  \param  feature_code   VCP feature code
+ *  \param  value_loc      receives the value read, unchanged if the read fails
+ *  \param  status_loc     receives the status of the read
+ *  \param  completed_loc  receives the time the read completed
+ *  \retval 0                        request queued
+ *  \retval DDCRC_INVALID_OPERATION  display is being closed
+ *
+ *  \remark
+ *  The values may be examined once #ddc_has_pending_async_requests()
+ *  returns false.
+ */
+DDCA_Status ddc_queue_sample_request(
+      Display_Handle *         dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      DDCA_Non_Table_Vcp_Value * value_loc,
+      DDCA_Status *            status_loc,
+      uint64_t *               completed_loc)
+{
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+   Display_Async_Request * request =
+         new_async_request(dh, DDCA_Q_VCP_GET, feature_code, DDCA_NON_TABLE_VCP_VALUE, 0, NULL);
+   request->value_loc     = value_loc;
+   request->status_loc    = status_loc;
+   request->completed_loc = completed_loc;
+   return queue_request(async_rec, request);
+}
+
+
+/** Queues a background read of a feature whose remembered value has been
+ *  returned to a client, see #ddc_get_remembered_vcp_value().
+ *
+ *  \param  dh            display handle
+ *  \param  feature_code  VCP feature code
+ *  \param  prior_value   value returned to the client, NULL if none
+ *  \param  callback      called if the value read differs from **prior_value**
+ *  \retval 0                        request queued
+ *  \retval DDCRC_INVALID_OPERATION  display is being closed
+ */
+DDCA_Status ddc_queue_refresh_request(
+      Display_Handle *         dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      const DDCA_Non_Table_Vcp_Value * prior_value,
+      DDCA_Notification_Func   callback)
+{
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+   Display_Async_Request * request =
+         new_async_request(dh, DDCA_Q_VCP_GET, feature_code, DDCA_NON_TABLE_VCP_VALUE, 0, callback);
+   request->refresh = true;
+   if (prior_value) {
+      request->has_prior_value = true;
+      request->prior_value     = *prior_value;
+   }
+   return queue_request(async_rec, request);
+}
+
+
+/** Queues a non-table get or set request whose completion is appended to a
+ *  completion queue, see ddc_completion_queue.c, instead of being reported
+ *  by a callback.
+ *
+ *  \param  cq            completion queue
+ *  \param  dh            display handle
+ *  \param  request_type  DDCA_Q_VCP_GET or DDCA_Q_VCP_SET
+ *  \param  feature_code  VCP feature code
+ *  \param  new_value     value to write, for DDCA_Q_VCP_SET
+ *  \param  user_data     returned in the completion
+ *  \retval 0                        request queued
+ *  \retval DDCRC_INVALID_OPERATION  display is being closed
+ */
+DDCA_Status ddc_queue_completion_request(
+      Completion_Queue *       cq,
+      Display_Handle *         dh,
+      DDCA_Queued_Request_Type request_type,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint16_t                 new_value,
+      uint64_t                 user_data)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, request_type=0x%02x, feature_code=0x%02x, user_data=%"PRIu64,
+                                       dh_repr(dh), request_type, feature_code, user_data);
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+   Display_Async_Request * request =
+         new_async_request(dh, request_type, feature_code, DDCA_NON_TABLE_VCP_VALUE, new_value, NULL);
+   request->completion_queue = cq;
+   request->user_data        = user_data;
+   ddc_retain_completion_queue(cq);     // released when the completion is posted
+   DDCA_Status ddcrc = queue_request(async_rec, request);
+   if (ddcrc != 0)
+      ddc_release_completion_queue(cq);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Reports whether requests queued for a display have not yet completed,
+ *  without waiting.
+ *
+ *  \param  dh  display handle
+ *  \return true if a request is queued or executing, false if not
+ */
+bool ddc_has_pending_async_requests(Display_Handle * dh) {
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   if (!async_rec)
+      return false;
+   g_mutex_lock(&async_rec->request_queue_lock);
+   bool pending = !g_queue_is_empty(async_rec->request_queue) || async_rec->request_executing;
+   g_mutex_unlock(&async_rec->request_queue_lock);
+   return pending;
+}
+
+
+/** Waits until all requests queued for a display have completed.
+ *
+ *  Called before a display handle is closed, since the queued requests
+ *  refer to the handle.  A pending debounced save is performed immediately.
+ *
+ *  \param  dh  display handle
+ */
+void ddc_wait_async_requests(Display_Handle * dh) {
+   bool debug = false;
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   if (!async_rec || !async_rec->request_execution_thread)
+      return;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+
+   // the worker thread may not itself wait for its queue to drain
+   assert(g_thread_self() != async_rec->request_execution_thread);
+   g_mutex_lock(&async_rec->request_queue_lock);
+   if (async_rec->save_settings_due) {
+      async_rec->save_settings_due = 1;    // i.e. now
+      g_cond_broadcast(&async_rec->request_queue_cond);
+   }
+   while (!g_queue_is_empty(async_rec->request_queue) ||
+          async_rec->request_executing ||
+          async_rec->save_settings_due)
+      g_cond_wait(&async_rec->request_queue_cond, &async_rec->request_queue_lock);
+   g_mutex_unlock(&async_rec->request_queue_lock);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Stops all worker threads, after they complete their queued requests.
+ *
+ *  Called at library termination.
+ */
+void ddc_terminate_async_requests() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   g_mutex_lock(&worker_recs_mutex);
+   if (worker_recs) {
+      for (int ndx = 0; ndx < worker_recs->len; ndx++) {
+         Display_Async_Rec * async_rec = g_ptr_array_index(worker_recs, ndx);
+         g_mutex_lock(&async_rec->request_queue_lock);
+         async_rec->request_thread_shutdown = true;
+         g_cond_broadcast(&async_rec->request_queue_cond);
+         g_mutex_unlock(&async_rec->request_queue_lock);
+
+         g_thread_join(async_rec->request_execution_thread);   // also releases reference
+
+         g_mutex_lock(&async_rec->request_queue_lock);
+         async_rec->request_execution_thread = NULL;
+         async_rec->request_thread_shutdown = false;
+         g_mutex_unlock(&async_rec->request_queue_lock);
+      }
+      g_ptr_array_free(worker_recs, true);
+      worker_recs = NULL;
+   }
+   g_mutex_unlock(&worker_recs_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+void init_ddc_async_requests() {
+   RTTI_ADD_FUNC(execute_ramp);
+   RTTI_ADD_FUNC(execute_async_request);
+   RTTI_ADD_FUNC(async_request_worker);
+   RTTI_ADD_FUNC(ddc_queue_async_request);
+   RTTI_ADD_FUNC(ddc_queue_coalesced_set_request);
+   RTTI_ADD_FUNC(ddc_queue_ramp_request);
+   RTTI_ADD_FUNC(execute_debounced_save);
+   RTTI_ADD_FUNC(ddc_queue_debounced_save);
+   RTTI_ADD_FUNC(ddc_set_nontable_vcp_values_multi);
+   RTTI_ADD_FUNC(ddc_get_nontable_vcp_values_multi);
+   RTTI_ADD_FUNC(ddc_wait_async_requests);
+   RTTI_ADD_FUNC(ddc_terminate_async_requests);
+}
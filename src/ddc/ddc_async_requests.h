@@ -0,0 +1,105 @@
+/** @file ddc_async_requests.h
+ *
+ *  Per-display queue of VCP get/set requests, executed by a worker thread
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_ASYNC_REQUESTS_H_
+#define DDC_ASYNC_REQUESTS_H_
+
+#include <stdbool.h>
+
+#include "ddcutil_types.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+
+#define DISPLAY_ASYNC_REQUEST_MARKER "DAQR"
+/** A request queued for execution by a display's worker thread */
+typedef struct {
+   char                     marker[4];
+   DDCA_Queued_Request_Type request_type;    // DDCA_Q_VCP_GET or DDCA_Q_VCP_SET
+   Display_Handle *         dh;
+   DDCA_Vcp_Feature_Code    feature_code;
+   DDCA_Vcp_Value_Type      value_type;      // for DDCA_Q_VCP_GET
+   uint16_t                 new_value;       // for DDCA_Q_VCP_SET
+   DDCA_Notification_Func   callback;
+   bool                     coalesce;        // may be replaced by a newer write to the feature
+   bool                     verify;          // read back value after write
+   DDCA_Status *            status_loc;      // if set, receives the status of the request
+   DDCA_Non_Table_Vcp_Value * value_loc;     // if set, receives the value read by DDCA_Q_VCP_GET
+   uint64_t *               completed_loc;   // if set, receives the completion time, CLOCK_MONOTONIC nanosec
+   int                      ramp_millisec;   // if > 0, DDCA_Q_VCP_SET ramps to new_value over this time
+   DDCA_Ramp_Easing         ramp_easing;
+   bool                     refresh;         // DDCA_Q_VCP_GET of a remembered value, see ddc_remembered_values.c
+   bool                     has_prior_value;
+   DDCA_Non_Table_Vcp_Value prior_value;     // remembered value returned to the client
+   struct Completion_Queue * completion_queue;  // if set, receives the completion instead of callback
+   uint64_t                 user_data;       // for completion_queue
+} Display_Async_Request;
+
+bool ddc_enable_setvcp_coalescing(bool onoff);
+bool ddc_is_setvcp_coalescing_enabled();
+int  ddc_set_save_settings_debounce(int millisec);
+int  ddc_get_save_settings_debounce();
+
+DDCA_Status ddc_queue_async_request(
+      Display_Handle *         dh,
+      DDCA_Queued_Request_Type request_type,
+      DDCA_Vcp_Feature_Code    feature_code,
+      DDCA_Vcp_Value_Type      value_type,
+      uint16_t                 new_value,
+      DDCA_Notification_Func   callback);
+DDCA_Status ddc_queue_coalesced_set_request(
+      Display_Handle *         dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint16_t                 new_value,
+      DDCA_Notification_Func   callback);
+DDCA_Status ddc_queue_ramp_request(
+      Display_Handle *         dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint16_t                 target_value,
+      int                      duration_millisec,
+      DDCA_Ramp_Easing         easing,
+      DDCA_Notification_Func   callback);
+DDCA_Status ddc_queue_debounced_save(Display_Handle * dh);
+DDCA_Status ddc_queue_sample_request(
+      Display_Handle *         dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      DDCA_Non_Table_Vcp_Value * value_loc,
+      DDCA_Status *            status_loc,
+      uint64_t *               completed_loc);
+DDCA_Status ddc_queue_refresh_request(
+      Display_Handle *         dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      const DDCA_Non_Table_Vcp_Value * prior_value,
+      DDCA_Notification_Func   callback);
+DDCA_Status ddc_queue_completion_request(
+      struct Completion_Queue * cq,
+      Display_Handle *         dh,
+      DDCA_Queued_Request_Type request_type,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint16_t                 new_value,
+      uint64_t                 user_data);
+bool ddc_has_pending_async_requests(Display_Handle * dh);
+void ddc_set_nontable_vcp_values_multi(
+      Display_Ref **           drefs,
+      int                      dref_ct,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint16_t                 new_value,
+      Call_Options             callopts,
+      DDCA_Status *            statuses);
+void ddc_get_nontable_vcp_values_multi(
+      Display_Ref **           drefs,
+      int                      dref_ct,
+      DDCA_Vcp_Feature_Code    feature_code,
+      Call_Options             callopts,
+      DDCA_Non_Table_Vcp_Value * valrecs,
+      DDCA_Status *            statuses);
+void ddc_wait_async_requests(Display_Handle * dh);
+void ddc_terminate_async_requests();
+void init_ddc_async_requests();
+
+#endif /* DDC_ASYNC_REQUESTS_H_ */
@@ -14,21 +14,35 @@
 #include "config.h"
 
 #include "util/string_util.h"
+#include "util/sysfs_util.h"
 
 #include "base/core.h"
+#include "base/io_timeline.h"
+#include "base/lock_stats.h"
 #include "base/parms.h"
+#include "base/shared_sleep.h"
+#include "base/thread_sched.h"
 #include "base/thread_retry_data.h"
 #include "base/thread_sleep_data.h"
+#include "base/trace_ring.h"
+#include "base/trace_writer.h"
 #include "base/tuned_sleep.h"
 
 #include "vcp/persistent_capabilities.h"
 
 #include "dynvcp/dyn_feature_files.h"
 
+#include "i2c/i2c_bus_core.h"
 #include "i2c/i2c_execute.h"
+#include "i2c/i2c_io_trace.h"
+#include "i2c/i2c_simulated_monitor.h"
 #include "i2c/i2c_strategy_dispatcher.h"
 
 #include "ddc_displays.h"
+#include "ddc_displays_cache.h"
+#include "ddc_dumpload.h"
+#include "ddc_io_scheduler.h"
+#include "ddc_read_capabilities.h"
 #include "ddc_services.h"
 #include "ddc_try_stats.h"
 #include "ddc_vcp.h"
@@ -43,6 +57,8 @@ void init_tracing(Parsed_Cmd * parsed_cmd)
       printf("(%s) Starting.\n",__func__);
    if (parsed_cmd->flags & (CMD_FLAG_SYSLOG))
       trace_to_syslog = true;
+   if (parsed_cmd->flags & CMD_FLAG_ASYNC_TRACE)
+      start_trace_writer();
    if (parsed_cmd->flags & CMD_FLAG_TIMESTAMP_TRACE)      // timestamps on debug and trace messages?
        dbgtrc_show_time = true;                           // extern in core.h
    if (parsed_cmd->flags & CMD_FLAG_WALLTIME_TRACE)       // wall timestamps on debug and trace messages?
@@ -50,6 +66,14 @@ void init_tracing(Parsed_Cmd * parsed_cmd)
     if (parsed_cmd->flags & CMD_FLAG_THREAD_ID_TRACE)     // timestamps on debug and trace messages?
        dbgtrc_show_thread_id = true;                      // extern in core.h
     report_freed_exceptions = parsed_cmd->flags & CMD_FLAG_REPORT_FREED_EXCP;   // extern in core.h
+    if (parsed_cmd->flags & CMD_FLAG_TRACE_RING)
+       enable_trace_ring(true);
+    if (parsed_cmd->flags & CMD_FLAG_LOCK_STATS)
+       enable_lock_stats(true);
+#ifdef DISABLE_RUNTIME_TRACING
+    if (parsed_cmd->traced_groups || parsed_cmd->traced_functions || parsed_cmd->traced_files)
+       fprintf(stderr, "Tracing is not supported by this build of ddcutil. Trace options ignored.\n");
+#endif
     add_trace_groups(parsed_cmd->traced_groups);
     // if (parsed_cmd->s1)
     //    set_trace_destination(parsed_cmd->s1, parser_mode_name(parsed_cmd->parser_mode));
@@ -95,6 +119,53 @@ static bool init_failsim(Parsed_Cmd * parsed_cmd) {
 }
 
 
+static bool init_fs_root(Parsed_Cmd * parsed_cmd) {
+   if (parsed_cmd->fs_root_dir) {
+      if (!set_fs_root_prefix(parsed_cmd->fs_root_dir)) {
+         fprintf(stderr, "Not a directory: %s\n", parsed_cmd->fs_root_dir);
+         return false;
+      }
+   }
+   return true;
+}
+
+
+static bool init_simulated_monitor(Parsed_Cmd * parsed_cmd) {
+   if (parsed_cmd->simulated_monitor_fn) {
+      Status_Errno_DDC rc = simmon_load_control_file(parsed_cmd->simulated_monitor_fn);
+      if (rc != 0) {
+         fprintf(stderr, "Error loading simulated monitor control file %s: %s\n",
+                         parsed_cmd->simulated_monitor_fn, psc_desc(rc));
+         return false;
+      }
+      i2c_set_io_strategy(I2C_IO_STRATEGY_SIMULATED);
+   }
+   return true;
+}
+
+
+static bool init_i2c_trace(Parsed_Cmd * parsed_cmd) {
+   if (parsed_cmd->i2c_replay_fn) {
+      Status_Errno_DDC rc = i2c_replay_load(parsed_cmd->i2c_replay_fn);
+      if (rc != 0) {
+         fprintf(stderr, "Error loading I2C trace file %s: %s\n",
+                         parsed_cmd->i2c_replay_fn, psc_desc(rc));
+         return false;
+      }
+      i2c_set_io_strategy(I2C_IO_STRATEGY_REPLAY);
+   }
+   if (parsed_cmd->i2c_record_fn) {
+      Status_Errno rc = i2c_trace_start_recording(parsed_cmd->i2c_record_fn);
+      if (rc != 0) {
+         fprintf(stderr, "Error opening I2C trace file %s: %s\n",
+                         parsed_cmd->i2c_record_fn, psc_desc(rc));
+         return false;
+      }
+   }
+   return true;
+}
+
+
 static void init_max_tries(Parsed_Cmd * parsed_cmd)
 {
    // n. MAX_MAX_TRIES checked during command line parsing
@@ -137,12 +208,26 @@ static void init_max_tries(Parsed_Cmd * parsed_cmd)
 static void init_performance_options(Parsed_Cmd * parsed_cmd)
 {
    enable_deferred_sleep( parsed_cmd->flags & CMD_FLAG_DEFER_SLEEPS);
+   // coordinate deferred sleeps with other processes using the same bus
+   enable_shared_sleep( parsed_cmd->flags & CMD_FLAG_DEFER_SLEEPS);
+   try_data_enable_adaptive_maxtries( parsed_cmd->flags & CMD_FLAG_ADAPTIVE_MAXTRIES);
 
    int threshold = DISPLAY_CHECK_ASYNC_NEVER;
    if (parsed_cmd->flags & CMD_FLAG_ASYNC) {
       threshold = DISPLAY_CHECK_ASYNC_THRESHOLD_STANDARD;
       ddc_set_async_threshold(threshold);
+      i2c_set_bus_check_async_threshold(BUS_CHECK_ASYNC_THRESHOLD_STANDARD);
    }
+   if (parsed_cmd->async_threads > 0)
+      ddc_set_async_pool_size(parsed_cmd->async_threads);
+   if (parsed_cmd->adapter_concurrency >= 0)
+      ddc_set_max_adapter_concurrency(parsed_cmd->adapter_concurrency);
+   if (parsed_cmd->i2c_kernel_retries >= 0)
+      i2c_set_kernel_retries(parsed_cmd->i2c_kernel_retries);
+   if (parsed_cmd->rt_policy >= 0)
+      set_worker_thread_sched_policy(parsed_cmd->rt_policy, parsed_cmd->rt_priority);
+   if (parsed_cmd->cpu_affinity)
+      set_worker_thread_cpu_affinity(parsed_cmd->cpu_affinity);
 
    if (parsed_cmd->sleep_multiplier != 0 && parsed_cmd->sleep_multiplier != 1) {
       tsd_set_sleep_multiplier_factor(parsed_cmd->sleep_multiplier);         // for current thread
@@ -163,6 +248,12 @@ bool submaster_initializer(Parsed_Cmd * parsed_cmd) {
 
    if (!init_failsim(parsed_cmd))
       goto bye;      // main_rc == EXIT_FAILURE
+   if (!init_fs_root(parsed_cmd))
+      goto bye;
+   if (!init_simulated_monitor(parsed_cmd))
+      goto bye;
+   if (!init_i2c_trace(parsed_cmd))
+      goto bye;
 
    // global variable in dyn_dynamic_features:
    enable_dynamic_features = parsed_cmd->flags & CMD_FLAG_ENABLE_UDF;
@@ -170,6 +261,13 @@ bool submaster_initializer(Parsed_Cmd * parsed_cmd) {
 
    if (parsed_cmd->edid_read_size >= 0)
       EDID_Read_Size = parsed_cmd->edid_read_size;
+   EDID_Read_Uses_Sysfs = parsed_cmd->flags & CMD_FLAG_EDID_FROM_SYSFS;
+   if (parsed_cmd->flags & CMD_FLAG_I2C_COMBINED_WRITE_READ)
+      I2C_Combined_Write_Read = true;
+   if (parsed_cmd->flags & CMD_FLAG_I2C_AUTO_WRITE_READ)
+      I2C_Auto_Write_Read = true;
+   ddc_enable_capabilities_prefetch(parsed_cmd->flags & CMD_FLAG_PREFETCH_CAPABILITIES);
+   ddc_enable_differential_loadvcp(parsed_cmd->flags & CMD_FLAG_SKIP_UNCHANGED);
 
     init_ddc_services();   // n. initializes start timestamp
     // overrides setting in init_ddc_services():
@@ -191,9 +289,16 @@ bool submaster_initializer(Parsed_Cmd * parsed_cmd) {
    ddc_enable_usb_display_detection( parsed_cmd->flags & CMD_FLAG_ENABLE_USB );
    assert (rc == DDCRC_OK);
  #endif
+   ddc_enable_edid_only_detection(parsed_cmd->flags & CMD_FLAG_EDID_ONLY);
 
    init_performance_options(parsed_cmd);
    enable_capabilities_cache(parsed_cmd->flags & CMD_FLAG_ENABLE_CACHED_CAPABILITIES);
+   enable_displays_cache(parsed_cmd->flags & CMD_FLAG_ENABLE_CACHED_DISPLAYS);
+
+   if (parsed_cmd->timeline_fn) {
+      if (!io_timeline_start(parsed_cmd->timeline_fn))
+         goto bye;
+   }
 
    ok = true;
 
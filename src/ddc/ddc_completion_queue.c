@@ -0,0 +1,195 @@
+/** @file ddc_completion_queue.c
+ *
+ *  Completions of queued VCP requests, for clients that run their own event
+ *  loop, e.g. using epoll or a GLib main loop, instead of receiving callbacks
+ *  on library threads.
+ *
+ *  A completion queue owns an eventfd.  When a display's worker thread, see
+ *  ddc_async_requests.c, completes a request submitted with the queue, it
+ *  appends a #DDCA_Completion and increments the eventfd counter, making the
+ *  descriptor readable.  #ddc_drain_completions() removes completions in
+ *  batches, and resets the counter once the queue is empty, so the descriptor
+ *  is readable exactly while completions are waiting.
+ *
+ *  The queue is reference counted.  Each outstanding request holds a
+ *  reference, so the client may free the queue while requests are pending.
+ *  Their completions are then discarded.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "ddcutil_types.h"
+
+#include "base/core.h"
+#include "base/rtti.h"
+
+#include "ddc/ddc_completion_queue.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define COMPLETION_QUEUE_MARKER "DCPQ"
+struct Completion_Queue {
+   char     marker[4];
+   int      efd;
+   GMutex   mutex;            // protects the following fields
+   GArray * completions;      // DDCA_Completion
+   int      refct;            // client reference plus outstanding requests
+   bool     freed;            // client reference released
+};
+
+
+/** Creates a completion queue.
+ *
+ *  \return new queue, NULL if the eventfd cannot be created, in which case
+ *          errno is set
+ */
+Completion_Queue *
+ddc_new_completion_queue() {
+   bool debug = false;
+   int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   if (efd < 0) {
+      DBGTRC(debug, TRACE_GROUP, "eventfd() failed: %s", strerror(errno));
+      return NULL;
+   }
+   Completion_Queue * cq = calloc(1, sizeof(Completion_Queue));
+   memcpy(cq->marker, COMPLETION_QUEUE_MARKER, 4);
+   cq->efd = efd;
+   g_mutex_init(&cq->mutex);
+   cq->completions = g_array_new(false, false, sizeof(DDCA_Completion));
+   cq->refct = 1;
+   DBGTRC(debug, TRACE_GROUP, "Returning %p, efd=%d", cq, efd);
+   return cq;
+}
+
+
+/** Checks that a pointer received from a client refers to a completion
+ *  queue that the client has not freed.
+ *
+ *  \param  cq  pointer to check
+ *  \return **cq** as a #Completion_Queue, NULL if invalid
+ */
+Completion_Queue *
+ddc_validated_completion_queue(void * cq) {
+   Completion_Queue * result = cq;
+   if (!result || memcmp(result->marker, COMPLETION_QUEUE_MARKER, 4) != 0 || result->freed)
+      return NULL;
+   return result;
+}
+
+
+/** Adds a reference to a queue, held by an outstanding request. */
+void
+ddc_retain_completion_queue(Completion_Queue * cq) {
+   g_mutex_lock(&cq->mutex);
+   cq->refct++;
+   g_mutex_unlock(&cq->mutex);
+}
+
+
+static void
+destroy_completion_queue(Completion_Queue * cq) {
+   close(cq->efd);
+   g_array_free(cq->completions, true);
+   g_mutex_clear(&cq->mutex);
+   cq->marker[3] = 'x';
+   free(cq);
+}
+
+
+/** Releases a reference to a queue, destroying it when none remain.
+ *  Called once by the client, and once for each completed request.
+ */
+void
+ddc_release_completion_queue(Completion_Queue * cq) {
+   g_mutex_lock(&cq->mutex);
+   bool destroy = (--cq->refct == 0);
+   g_mutex_unlock(&cq->mutex);
+   if (destroy)
+      destroy_completion_queue(cq);
+}
+
+
+/** Returns the eventfd of a queue, readable while completions are waiting. */
+int
+ddc_get_completion_queue_fd(Completion_Queue * cq) {
+   return cq->efd;
+}
+
+
+/** Appends a completion and releases the reference held by its request.
+ *  Called on the worker thread that executed the request.
+ *
+ *  \param  cq          completion queue
+ *  \param  completion  completion, copied
+ */
+void
+ddc_post_completion(Completion_Queue * cq, DDCA_Completion * completion) {
+   bool debug = false;
+   g_mutex_lock(&cq->mutex);
+   if (!cq->freed) {
+      g_array_append_val(cq->completions, *completion);
+      uint64_t one = 1;
+      if (write(cq->efd, &one, sizeof(one)) < 0)
+         DBGTRC(debug, TRACE_GROUP, "write() to eventfd failed: %s", strerror(errno));
+   }
+   g_mutex_unlock(&cq->mutex);
+   ddc_release_completion_queue(cq);
+}
+
+
+/** Removes waiting completions.
+ *
+ *  \param  cq           completion queue
+ *  \param  completions  where to return the completions, in the order posted
+ *  \param  max_ct       size of **completions**
+ *  \return number of completions returned
+ */
+int
+ddc_drain_completions(Completion_Queue * cq, DDCA_Completion * completions, int max_ct) {
+   bool debug = false;
+   g_mutex_lock(&cq->mutex);
+   int ct = MIN(max_ct, (int) cq->completions->len);
+   if (ct > 0) {
+      memcpy(completions, cq->completions->data, ct * sizeof(DDCA_Completion));
+      g_array_remove_range(cq->completions, 0, ct);
+   }
+   if (cq->completions->len == 0) {
+      // resets the counter, fails with EAGAIN if it is already 0
+      uint64_t counter;
+      if (read(cq->efd, &counter, sizeof(counter)) < 0 && errno != EAGAIN)
+         DBGTRC(debug, TRACE_GROUP, "read() from eventfd failed: %s", strerror(errno));
+   }
+   g_mutex_unlock(&cq->mutex);
+   return ct;
+}
+
+
+/** Releases the client's reference to a queue.  Completions of requests
+ *  still outstanding are discarded.
+ *
+ *  \param  cq  completion queue
+ */
+void
+ddc_free_completion_queue(Completion_Queue * cq) {
+   g_mutex_lock(&cq->mutex);
+   cq->freed = true;
+   g_mutex_unlock(&cq->mutex);
+   ddc_release_completion_queue(cq);
+}
+
+
+void
+init_ddc_completion_queue() {
+   RTTI_ADD_FUNC(ddc_new_completion_queue);
+}
@@ -0,0 +1,28 @@
+/** @file ddc_completion_queue.h
+ *
+ *  Completions of queued VCP requests, signaled using an eventfd
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_COMPLETION_QUEUE_H_
+#define DDC_COMPLETION_QUEUE_H_
+
+#include <stdbool.h>
+
+#include "ddcutil_types.h"
+
+typedef struct Completion_Queue Completion_Queue;
+
+Completion_Queue * ddc_new_completion_queue();
+Completion_Queue * ddc_validated_completion_queue(void * cq);
+void               ddc_retain_completion_queue(Completion_Queue * cq);
+void               ddc_release_completion_queue(Completion_Queue * cq);
+void               ddc_free_completion_queue(Completion_Queue * cq);
+int                ddc_get_completion_queue_fd(Completion_Queue * cq);
+void               ddc_post_completion(Completion_Queue * cq, DDCA_Completion * completion);
+int                ddc_drain_completions(Completion_Queue * cq, DDCA_Completion * completions, int max_ct);
+void               init_ddc_completion_queue();
+
+#endif /* DDC_COMPLETION_QUEUE_H_ */
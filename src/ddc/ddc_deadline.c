@@ -0,0 +1,180 @@
+/** @file ddc_deadline.c
+ *
+ *  Per-thread deadlines and cancellation of DDC operations.
+ *
+ *  A thread can set a deadline, and a cancel token, for the DDC operations
+ *  it performs.  They are checked at safe points, i.e. before each try of a
+ *  DDC exchange, before each fragment of a multi-part read or write, and
+ *  while waiting to open a display.  An operation that is stopped fails with
+ *  DDCRC_TIMEOUT or DDCRC_CANCELLED.  Since a safe point is never within an
+ *  exchange, the display is left in a consistent state.
+ *
+ *  A cancel token can be cancelled from any thread.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/error_info.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/rtti.h"
+#include "base/status_code_mgt.h"
+
+#include "ddc/ddc_deadline.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDCIO;
+
+static GPrivate deadline_key     = G_PRIVATE_INIT(g_free);   // uint64_t *, CLOCK_MONOTONIC nanoseconds
+static GPrivate cancel_token_key = G_PRIVATE_INIT(NULL);     // Cancel_Token *
+
+
+/** Creates a new cancel token.
+ *
+ *  \return newly allocated token, not cancelled
+ */
+Cancel_Token * ddc_new_cancel_token() {
+   Cancel_Token * token = calloc(1, sizeof(Cancel_Token));
+   memcpy(token->marker, CANCEL_TOKEN_MARKER, 4);
+   return token;
+}
+
+
+/** Frees a cancel token.
+ *
+ *  \param token  pointer to #Cancel_Token, if NULL do nothing
+ */
+void ddc_free_cancel_token(Cancel_Token * token) {
+   if (token) {
+      assert(memcmp(token->marker, CANCEL_TOKEN_MARKER, 4) == 0);
+      token->marker[3] = 'x';
+      free(token);
+   }
+}
+
+
+/** Cancels the operations of all threads using a token.
+ *
+ *  \param token  pointer to #Cancel_Token
+ */
+void ddc_cancel(Cancel_Token * token) {
+   assert(token && memcmp(token->marker, CANCEL_TOKEN_MARKER, 4) == 0);
+   __atomic_store_n(&token->cancelled, 1, __ATOMIC_RELEASE);
+}
+
+
+/** Tests whether a token has been cancelled.
+ *
+ *  \param token  pointer to #Cancel_Token, may be NULL
+ *  \return true if cancelled
+ */
+bool ddc_is_cancelled(Cancel_Token * token) {
+   return token && __atomic_load_n(&token->cancelled, __ATOMIC_ACQUIRE);
+}
+
+
+/** Sets the deadline for DDC operations performed by the current thread.
+ *
+ *  \param  deadline_nanos  CLOCK_MONOTONIC time in nanoseconds, 0 for no deadline
+ *  \return prior deadline
+ *
+ *  \remark
+ *  This setting is thread-specific.
+ */
+uint64_t ddc_set_thread_deadline(uint64_t deadline_nanos) {
+   uint64_t old = ddc_get_thread_deadline();
+   uint64_t * loc = g_private_get(&deadline_key);
+   if (!loc) {
+      loc = g_new0(uint64_t, 1);
+      g_private_set(&deadline_key, loc);
+   }
+   *loc = deadline_nanos;
+   return old;
+}
+
+
+/** Returns the deadline for DDC operations performed by the current thread.
+ *
+ *  \return CLOCK_MONOTONIC time in nanoseconds, 0 if no deadline
+ */
+uint64_t ddc_get_thread_deadline() {
+   uint64_t * loc = g_private_get(&deadline_key);
+   return (loc) ? *loc : 0;
+}
+
+
+/** Sets the cancel token checked by DDC operations of the current thread.
+ *
+ *  \param  token  pointer to #Cancel_Token, NULL for none
+ *  \return prior token
+ *
+ *  \remark
+ *  This setting is thread-specific.  The token is not owned by the thread,
+ *  and must not be freed while set.
+ */
+Cancel_Token * ddc_set_thread_cancel_token(Cancel_Token * token) {
+   Cancel_Token * old = g_private_get(&cancel_token_key);
+   g_private_set(&cancel_token_key, token);
+   return old;
+}
+
+
+/** Returns the cancel token checked by DDC operations of the current thread.
+ *
+ *  \return pointer to #Cancel_Token, NULL if none
+ */
+Cancel_Token * ddc_get_thread_cancel_token() {
+   return g_private_get(&cancel_token_key);
+}
+
+
+/** Checks whether the current thread's operation should stop.
+ *
+ *  \retval DDCRC_CANCELLED  the thread's cancel token has been cancelled
+ *  \retval DDCRC_TIMEOUT    the thread's deadline has passed
+ *  \retval 0                operation can continue
+ */
+DDCA_Status ddc_check_deadline_status() {
+   if (ddc_is_cancelled(ddc_get_thread_cancel_token()))
+      return DDCRC_CANCELLED;
+   uint64_t deadline = ddc_get_thread_deadline();
+   if (deadline && cur_monotonic_nanosec() >= deadline)
+      return DDCRC_TIMEOUT;
+   return 0;
+}
+
+
+/** Called at a safe point to check whether the current thread's operation
+ *  should stop.
+ *
+ *  \param  func  name of the calling function
+ *  \return #Error_Info with status DDCRC_CANCELLED or DDCRC_TIMEOUT,
+ *          NULL if operation can continue
+ */
+Error_Info * ddc_check_deadline(const char * func) {
+   bool debug = false;
+   Error_Info * excp = NULL;
+   DDCA_Status ddcrc = ddc_check_deadline_status();
+   if (ddcrc) {
+      excp = errinfo_new2(ddcrc, func,
+               (ddcrc == DDCRC_CANCELLED) ? "Operation cancelled" : "Deadline passed");
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "func=%s, returning %s", func, psc_name_code(ddcrc));
+   }
+   return excp;
+}
+
+
+void init_ddc_deadline() {
+   RTTI_ADD_FUNC(ddc_check_deadline);
+}
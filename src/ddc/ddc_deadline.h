@@ -0,0 +1,40 @@
+/** @file ddc_deadline.h
+ *
+ *  Per-thread deadlines and cancellation of DDC operations
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_DEADLINE_H_
+#define DDC_DEADLINE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ddcutil_types.h"
+
+#include "util/error_info.h"
+
+#define CANCEL_TOKEN_MARKER "CTOK"
+typedef struct {
+   char  marker[4];
+   int   cancelled;           // accessed atomically
+} Cancel_Token;
+
+Cancel_Token * ddc_new_cancel_token();
+void           ddc_free_cancel_token(Cancel_Token * token);
+void           ddc_cancel(Cancel_Token * token);
+bool           ddc_is_cancelled(Cancel_Token * token);
+
+uint64_t       ddc_set_thread_deadline(uint64_t deadline_nanos);
+uint64_t       ddc_get_thread_deadline();
+Cancel_Token * ddc_set_thread_cancel_token(Cancel_Token * token);
+Cancel_Token * ddc_get_thread_cancel_token();
+
+DDCA_Status    ddc_check_deadline_status();
+Error_Info *   ddc_check_deadline(const char * func);
+
+void init_ddc_deadline();
+
+#endif /* DDC_DEADLINE_H_ */
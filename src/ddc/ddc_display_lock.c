@@ -1,6 +1,10 @@
 /** \f ddc_display_lock.c
  *  Provides locking for displays to ensure that a given display is not
  *  opened simultaneously from multiple threads.
+ *
+ *  The lock belongs to the open display, not to the thread that opened it,
+ *  so a display handle can be used and closed on any thread.  Threads waiting
+ *  for a display are granted it in the order in which they asked for it.
  */
 
 // Copyright (C) 2018-2022 Sanford Rockowitz <rockowitz@minsoft.com>
@@ -23,15 +27,22 @@
 #include <assert.h>
 
 #include <glib-2.0/glib.h>
+#include <inttypes.h>
 #include <string.h>
 
 #include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/timestamp.h"
 
 #include "base/displays.h"
+#include "base/latency_stats.h"
+#include "base/lock_stats.h"
+#include "base/op_profile.h"
 #include "base/rtti.h"
 #include "base/status_code_mgt.h"
 
+#include "ddc/ddc_deadline.h"
+
 #include "ddc/ddc_display_lock.h"
 
 #include "ddcutil_types.h"
@@ -40,6 +51,8 @@
 // Trace class for this file
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDCIO;
 
+#define CANCEL_CHECK_INTERVAL_MICROS  100000
+
 #define DISTINCT_DISPLAY_DESC_MARKER "DDSC"
 typedef struct {
    char         marker[4];
@@ -49,10 +62,20 @@ typedef struct {
    char *       edid_model_name;
    char *       edid_serial_ascii;
 #endif
-   GMutex       display_mutex;
-   GThread *    display_mutex_thread;     // thread owning mutex
+   GMutex       display_mutex;            // protects the following fields
+   GCond        display_cond;             // signalled when the lock is released
+   guint        next_ticket;              // ticket given to the next locker
+   guint        serving_ticket;           // ticket that currently holds the lock
+   GList *      abandoned_tickets;        // tickets of waiters that gave up, to be skipped
+   GThread *    display_mutex_thread;     // thread that acquired the lock, also read
+                                          // atomically without holding display_mutex
+   Lock_Stats   display_mutex_stats;      // acquisitions of display_mutex
+   Lock_Stats   display_lock_stats;       // acquisitions of the display lock, i.e. a ticket
 } Distinct_Display_Desc;
 
+// The lock is held iff serving_ticket != next_ticket, i.e. a ticket has been
+// issued that has not yet been released.
+
 
 #ifdef REDUNDANT
 bool io_path_eq(DDCA_IO_Path path1, DDCA_IO_Path path2) {
@@ -79,11 +102,12 @@ bool io_path_eq(DDCA_IO_Path path1, DDCA_IO_Path path2) {
 #endif
 
 
+#ifdef TOO_MANY_EDGE_CASES
+// Matches on io path are found using descriptors_by_io_path
 static bool display_desc_matches(Distinct_Display_Desc * ddesc, Display_Ref * dref) {
    bool result = false;
    if (dpath_eq(ddesc->io_path, dref->io_path))
       result = true;
-#ifdef TOO_MANY_EDGE_CASES
    else {
       if (dref->pedid) {
       if (streq(dref->pedid->mfg_id,       ddesc->edid_mfg)        &&
@@ -98,43 +122,85 @@ static bool display_desc_matches(Distinct_Display_Desc * ddesc, Display_Ref * dr
          DBGMSG("Null EDID");
       }
    }
-#endif
    return result;
 }
+#endif
 
 
 static GPtrArray * display_descriptors = NULL;  // array of Distinct_Display_Desc *
-static GMutex descriptors_mutex;                // single threads access to display_descriptors
+static GHashTable * descriptors_by_io_path = NULL; // DDCA_IO_Path * -> Distinct_Display_Desc *
+static GRWLock descriptors_lock;                // protects display_descriptors and descriptors_by_io_path
+static Lock_Stats descriptors_lock_stats = {.lock_name = "display_descriptors"};
+static uint64_t lock_wait_timeout_millis = 0;   // limit on DDISP_WAIT, 0 = wait indefinitely
+
+
+static guint io_path_hash(gconstpointer key) {
+   const DDCA_IO_Path * path = key;
+   guint result = path->io_mode << 24;
+   switch(path->io_mode) {
+   case DDCA_IO_I2C:
+      result ^= path->path.i2c_busno;
+      break;
+   case DDCA_IO_ADL:
+      result ^= (path->path.adlno.iAdapterIndex << 12) ^ path->path.adlno.iDisplayIndex;
+      break;
+   case DDCA_IO_USB:
+      result ^= path->path.hiddev_devno;
+      break;
+   }
+   return result;
+}
+
+
+static gboolean io_path_equal(gconstpointer a, gconstpointer b) {
+   return dpath_eq(*(const DDCA_IO_Path *) a, *(const DDCA_IO_Path *) b);
+}
+#ifdef BAD
 static GMutex master_display_lock_mutex;
+#endif
 
 
-// must be called when lock not held by current thread, o.w. deadlock
+// The io path of a descriptor does not change once created, so no lock is needed
 static char * distinct_display_ref_repr_t(Distinct_Display_Ref id) {
    static GPrivate  repr_key = G_PRIVATE_INIT(g_free);
    char * buf = get_thread_fixed_buffer(&repr_key, 100);
-   g_mutex_lock(&descriptors_mutex);
    Distinct_Display_Desc * ref = (Distinct_Display_Desc *) id;
    assert(memcmp(ref->marker, DISTINCT_DISPLAY_DESC_MARKER, 4) == 0);
    g_snprintf(buf, 100, "Distinct_Display_Ref[%s @%p]", dpath_repr_t(&ref->io_path), ref);
-   g_mutex_unlock(&descriptors_mutex);
    return buf;
 }
 
 
+static Distinct_Display_Desc * find_display_desc(Display_Ref * dref) {
+   Distinct_Display_Desc * result = g_hash_table_lookup(descriptors_by_io_path, &dref->io_path);
+#ifdef TOO_MANY_EDGE_CASES
+   // matches on EDID identifiers require a full scan
+   for (int ndx=0; !result && ndx < display_descriptors->len; ndx++) {
+      Distinct_Display_Desc * cur = g_ptr_array_index(display_descriptors, ndx);
+      if (display_desc_matches(cur, dref) )
+         result = cur;
+   }
+#endif
+   return result;
+}
+
+
 Distinct_Display_Ref get_distinct_display_ref(Display_Ref * dref) {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s", dref_repr_t(dref));
 
-   void * result = NULL;
-   g_mutex_lock(&descriptors_mutex);
-
-   for (int ndx=0; ndx < display_descriptors->len; ndx++) {
-      Distinct_Display_Desc * cur = g_ptr_array_index(display_descriptors, ndx);
-      if (display_desc_matches(cur, dref) ) {
-         result = cur;
-         break;
-      }
+   // Descriptors are never freed, so once found one can be used without a lock.
+   // Lookups share the lock, only the creation of a descriptor is exclusive.
+   lock_stats_rw_lock_reader_lock(&descriptors_lock, &descriptors_lock_stats);
+   void * result = find_display_desc(dref);
+   g_rw_lock_reader_unlock(&descriptors_lock);
+   if (result) {
+      DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %p -> %s", result,  distinct_display_ref_repr_t(result));
+      return result;
    }
+
+   lock_stats_rw_lock_writer_lock(&descriptors_lock, &descriptors_lock_stats);
+   result = find_display_desc(dref);     // another thread may have created it meanwhile
    if (!result) {
       Distinct_Display_Desc * new_desc = calloc(1, sizeof(Distinct_Display_Desc));
       memcpy(new_desc->marker, DISTINCT_DISPLAY_DESC_MARKER, 4);
@@ -145,70 +211,171 @@ Distinct_Display_Ref get_distinct_display_ref(Display_Ref * dref) {
       new_desc->edid_serial_ascii = strdup(dref->pedid->serial_ascii);
 #endif
       g_mutex_init(&new_desc->display_mutex);
+      g_cond_init(&new_desc->display_cond);
+      char * display = g_strdup(dpath_repr_t(&new_desc->io_path));
+      new_desc->display_mutex_stats.lock_name = "display_mutex";
+      new_desc->display_mutex_stats.display   = display;
+      new_desc->display_lock_stats.lock_name  = "display_lock";
+      new_desc->display_lock_stats.display    = display;
       g_ptr_array_add(display_descriptors, new_desc);
+      g_hash_table_insert(descriptors_by_io_path, &new_desc->io_path, new_desc);
       result = new_desc;
    }
-
-   g_mutex_unlock(&descriptors_mutex);
+   g_rw_lock_writer_unlock(&descriptors_lock);
 
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %p -> %s", result,  distinct_display_ref_repr_t(result));
    return result;
 }
 
 
-/** Locks a distinct display.
+/** Sets the maximum time #lock_distinct_display() waits when **DDISP_WAIT**
+ *  is set.
+ *
+ *  \param  millis  timeout in milliseconds, 0 to wait indefinitely
+ *  \return prior value
+ */
+uint64_t ddc_set_display_lock_timeout(uint64_t millis) {
+   uint64_t old = __atomic_exchange_n(&lock_wait_timeout_millis, millis, __ATOMIC_RELAXED);
+   return old;
+}
+
+
+/** Locks a distinct display, waiting at most a given time.
+ *
+ *  If the display is locked and **DDISP_WAIT** is set, the caller waits in
+ *  a first come, first served queue, until the timeout expires or the
+ *  deadline set for the thread by #ddc_set_thread_deadline() passes,
+ *  whichever is first.  The time taken to acquire the lock is recorded as
+ *  a #DDCA_LATENCY_LOCK_WAIT latency for the display and, if lock statistics
+ *  are enabled, as an acquisition of the display lock.
+ *
+ *  A display that is locked by another thread and need not be waited for
+ *  is recognized without taking the display mutex.
  *
  *  \param  id                 distinct display identifier
  *  \param  flags              if **DDISP_WAIT** set, wait for locking
+ *  \param  timeout_millis     maximum wait in milliseconds, 0 for no limit
  *  \retval DDCRC_OK           success
  *  \retval DDCRC_LOCKED       locking failed, display already locked by another
- *                             thread and DDISP_WAIT not set
+ *                             thread and DDISP_WAIT not set or the timeout expired
  *  \retval DDCRC_ALREADY_OPEN display already locked in current thread
+ *  \retval DDCRC_TIMEOUT      the thread's deadline passed while waiting
+ *  \retval DDCRC_CANCELLED    the thread's cancel token was cancelled while waiting
  */
 DDCA_Status
-lock_distinct_display(
+lock_distinct_display_with_timeout(
       Distinct_Display_Ref   id,
-      Distinct_Display_Flags flags)
+      Distinct_Display_Flags flags,
+      uint64_t               timeout_millis)
 {
    bool debug = false;
-   DBGTRC_STARTING(debug, TRACE_GROUP, "id=%p -> %s", id, distinct_display_ref_repr_t(id));
+   DBGTRC_STARTING(debug, TRACE_GROUP, "id=%p -> %s, timeout_millis=%"PRIu64,
+                                       id, distinct_display_ref_repr_t(id), timeout_millis);
 
    DDCA_Status ddcrc = 0;
+   int64_t wait_nanos = -1;     // set if the lock is acquired
    Distinct_Display_Desc * ddesc = (Distinct_Display_Desc *) id;
    // TODO:  If this function is exposed in API, change assert to returning illegal argument status code
    TRACED_ASSERT(memcmp(ddesc->marker, DISTINCT_DISPLAY_DESC_MARKER, 4) == 0);
-   bool self_thread = false;
-   g_mutex_lock(&master_display_lock_mutex);  //wrong - will hold lock during wait
-   if (ddesc->display_mutex_thread == g_thread_self() )
-      self_thread = true;
-   g_mutex_unlock(&master_display_lock_mutex);
-   if (self_thread) {
+
+   // The owner is set only by the owning thread, so it reliably identifies
+   // a lock held by the current thread, and any other owner means the
+   // display is locked.
+   GThread * owner = g_atomic_pointer_get(&ddesc->display_mutex_thread);
+   if (owner == g_thread_self()) {
       DBGMSG("Attempting to lock display already locked by current thread");
       ddcrc = DDCRC_ALREADY_OPEN;    // poor
+      DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "id=%p -> %s", id, distinct_display_ref_repr_t(id));
+      return ddcrc;
+   }
+   if (owner && !(flags & DDISP_WAIT)) {
+      ddcrc = DDCRC_LOCKED;
+      DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "id=%p -> %s", id, distinct_display_ref_repr_t(id));
+      return ddcrc;
+   }
+
+   lock_stats_mutex_lock(&ddesc->display_mutex, &ddesc->display_mutex_stats);
+   bool locked = (ddesc->serving_ticket != ddesc->next_ticket);
+   if (locked && ddesc->display_mutex_thread == g_thread_self()) {
+      DBGMSG("Attempting to lock display already locked by current thread");
+      ddcrc = DDCRC_ALREADY_OPEN;    // poor
+   }
+   else if (locked && !(flags & DDISP_WAIT)) {
+      ddcrc = DDCRC_LOCKED;
    }
    else {
-      bool locked = true;
-      if (flags & DDISP_WAIT) {
-         g_mutex_lock(&ddesc->display_mutex);
+      uint64_t wait_start = cur_monotonic_nanosec();
+      gint64 timeout_end_time = (timeout_millis) ? g_get_monotonic_time() + timeout_millis * 1000 : 0;
+      guint ticket = ddesc->next_ticket++;
+      bool check_deadline = ddc_get_thread_deadline() || ddc_get_thread_cancel_token() || timeout_end_time;
+      while (ddesc->serving_ticket != ticket) {
+         if (!check_deadline) {
+            g_cond_wait(&ddesc->display_cond, &ddesc->display_mutex);
+            continue;
+         }
+         // wake at the deadline or timeout, and periodically to check for cancellation
+         gint64 end_time = g_get_monotonic_time() + CANCEL_CHECK_INTERVAL_MICROS;
+         uint64_t deadline = ddc_get_thread_deadline();
+         if (deadline && deadline/1000 < end_time)
+            end_time = deadline/1000;
+         if (timeout_end_time && timeout_end_time < end_time)
+            end_time = timeout_end_time;
+         g_cond_wait_until(&ddesc->display_cond, &ddesc->display_mutex, end_time);
+         if (ddesc->serving_ticket != ticket) {
+            ddcrc = ddc_check_deadline_status();
+            if (!ddcrc && timeout_end_time && g_get_monotonic_time() >= timeout_end_time)
+               ddcrc = DDCRC_LOCKED;
+            if (ddcrc) {
+               ddesc->abandoned_tickets = g_list_prepend(ddesc->abandoned_tickets, GUINT_TO_POINTER(ticket));
+               break;
+            }
+         }
       }
-      else {
-         locked = g_mutex_trylock(&ddesc->display_mutex);
-         if (!locked)
-            ddcrc = DDCRC_LOCKED;
+      if (ddcrc == 0) {
+         g_atomic_pointer_set(&ddesc->display_mutex_thread, g_thread_self());
+         wait_nanos = cur_monotonic_nanosec() - wait_start;
+         if (lock_stats_enabled)
+            record_lock_acquisition(&ddesc->display_lock_stats, locked, wait_nanos);
       }
-      if (locked)
-         ddesc->display_mutex_thread = g_thread_self();
    }
+   g_mutex_unlock(&ddesc->display_mutex);
+   if (wait_nanos >= 0) {
+      record_display_latency(ddesc->io_path, DDCA_LATENCY_LOCK_WAIT, wait_nanos);
+      op_profile_add(OPC_LOCK_WAIT, wait_nanos);
+   }
+
    // need a new DDC status code
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "id=%p -> %s", id, distinct_display_ref_repr_t(id));
    return ddcrc;
 }
 
 
+/** Locks a distinct display.
+ *
+ *  If **DDISP_WAIT** is set, waits at most the time set by
+ *  #ddc_set_display_lock_timeout().  See #lock_distinct_display_with_timeout().
+ *
+ *  \param  id                 distinct display identifier
+ *  \param  flags              if **DDISP_WAIT** set, wait for locking
+ *  \return status code, as for #lock_distinct_display_with_timeout()
+ */
+DDCA_Status
+lock_distinct_display(
+      Distinct_Display_Ref   id,
+      Distinct_Display_Flags flags)
+{
+   uint64_t timeout_millis = __atomic_load_n(&lock_wait_timeout_millis, __ATOMIC_RELAXED);
+   return lock_distinct_display_with_timeout(id, flags, timeout_millis);
+}
+
+
 /** Unlocks a distinct display.
+ *
+ *  The display need not have been locked by the current thread, since
+ *  a display handle can be closed on any thread.
  *
  *  \param id  distinct display identifier
- *  \retval DDCRC_LOCKED attempting to unlock a display owned by a different thread
+ *  \retval DDCRC_LOCKED attempting to unlock a display that is not locked
  *  \retval DDCRC_OK
  */
 DDCA_Status unlock_distinct_display(Distinct_Display_Ref id) {
@@ -218,16 +385,22 @@ DDCA_Status unlock_distinct_display(Distinct_Display_Ref id) {
    Distinct_Display_Desc * ddesc = (Distinct_Display_Desc *) id;
    // TODO:  If this function is exposed in API, change assert to returning illegal argument status code
    TRACED_ASSERT(memcmp(ddesc->marker, DISTINCT_DISPLAY_DESC_MARKER, 4) == 0);
-   g_mutex_lock(&master_display_lock_mutex);
-   if (ddesc->display_mutex_thread != g_thread_self()) {
-      DBGMSG("Attempting to unlock display lock owned by different thread");
+   g_mutex_lock(&ddesc->display_mutex);
+   if (ddesc->serving_ticket == ddesc->next_ticket) {
+      DBGMSG("Attempting to unlock display that is not locked");
       ddcrc = DDCRC_LOCKED;
    }
    else {
-      ddesc->display_mutex_thread = NULL;
-      g_mutex_unlock(&ddesc->display_mutex);
+      g_atomic_pointer_set(&ddesc->display_mutex_thread, NULL);
+      ddesc->serving_ticket++;
+      GList * abandoned;
+      while ( (abandoned = g_list_find(ddesc->abandoned_tickets, GUINT_TO_POINTER(ddesc->serving_ticket))) ) {
+         ddesc->abandoned_tickets = g_list_delete_link(ddesc->abandoned_tickets, abandoned);
+         ddesc->serving_ticket++;
+      }
+      g_cond_broadcast(&ddesc->display_cond);
    }
-   g_mutex_unlock(&master_display_lock_mutex);
+   g_mutex_unlock(&ddesc->display_mutex);
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "id=%p -> %s", id, distinct_display_ref_repr_t(id));
    return ddcrc;
 }
@@ -244,7 +417,7 @@ void unlock_all_distinct_displays() {
    bool debug = true;
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
    g_mutex_lock(&master_display_lock_mutex);   // are both locks needed?
-   g_mutex_lock(&descriptors_mutex);
+   g_rw_lock_writer_lock(&descriptors_lock);
     for (int ndx=0; ndx < display_descriptors->len; ndx++) {
        Distinct_Display_Desc * cur = g_ptr_array_index(display_descriptors, ndx);
        DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%2d - %p  %-28s",
@@ -256,7 +429,7 @@ void unlock_all_distinct_displays() {
        // Calling g_mutex_unlock() on a mutex that is not locked by the current thread leads to undefined behaviour.
        g_mutex_unlock(&cur->display_mutex);
     }
-    g_mutex_unlock(&descriptors_mutex);
+    g_rw_lock_writer_unlock(&descriptors_lock);
     g_mutex_unlock(&master_display_lock_mutex);
     DBGTRC_DONE(debug, TRACE_GROUP, "");
  }
@@ -269,7 +442,7 @@ void unlock_all_distinct_displays() {
  */
 void dbgrpt_distinct_display_descriptors(int depth) {
    rpt_vstring(depth, "display_descriptors@%p", display_descriptors);
-   g_mutex_lock(&descriptors_mutex);
+   g_rw_lock_reader_lock(&descriptors_lock);
    int d1 = depth+1;
    for (int ndx=0; ndx < display_descriptors->len; ndx++) {
       Distinct_Display_Desc * cur = g_ptr_array_index(display_descriptors, ndx);
@@ -281,19 +454,21 @@ void dbgrpt_distinct_display_descriptors(int depth) {
                        cur->edid_model_name,
                        cur->edid_serial_ascii);
 #endif
-      rpt_vstring(d1, "%2d - %p  %-28s  thread ptr=%p",
+      rpt_vstring(d1, "%2d - %p  %-28s  thread ptr=%p, waiting=%u",
                        ndx, cur,
-                       dpath_repr_t(&cur->io_path), (void*) &cur->display_mutex_thread );
+                       dpath_repr_t(&cur->io_path), (void*) cur->display_mutex_thread,
+                       (cur->next_ticket != cur->serving_ticket) ? cur->next_ticket - cur->serving_ticket - 1 : 0);
    }
-   g_mutex_unlock(&descriptors_mutex);
+   g_rw_lock_reader_unlock(&descriptors_lock);
 }
 
 
 /** Initializes this module */
 void init_ddc_display_lock(void) {
    display_descriptors= g_ptr_array_new();
+   descriptors_by_io_path = g_hash_table_new(io_path_hash, io_path_equal);
 
    RTTI_ADD_FUNC(get_distinct_display_ref);
-   RTTI_ADD_FUNC(lock_distinct_display);
+   RTTI_ADD_FUNC(lock_distinct_display_with_timeout);
    RTTI_ADD_FUNC(unlock_distinct_display);
 }
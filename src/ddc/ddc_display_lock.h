@@ -8,6 +8,7 @@
 #define DDC_DISPLAY_LOCK_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "ddcutil_types.h"
 
@@ -16,7 +17,8 @@
 
 typedef enum {
    DDISP_NONE  = 0x00,     ///< No flags set
-   DDISP_WAIT  = 0x01      ///< If true, #lock_distinct_display() should wait
+   DDISP_WAIT  = 0x01      ///< If true, #lock_distinct_display() should wait, subject to
+                           ///< the timeout set by #ddc_set_display_lock_timeout()
 } Distinct_Display_Flags;
 
 typedef void * Distinct_Display_Ref;
@@ -26,6 +28,9 @@ void init_ddc_display_lock(void);
 Distinct_Display_Ref get_distinct_display_ref(Display_Ref * dref);
 
 DDCA_Status lock_distinct_display(Distinct_Display_Ref id, Distinct_Display_Flags flags);
+DDCA_Status lock_distinct_display_with_timeout(
+      Distinct_Display_Ref id, Distinct_Display_Flags flags, uint64_t timeout_millis);
+uint64_t    ddc_set_display_lock_timeout(uint64_t millis);
 
 DDCA_Status unlock_distinct_display(Distinct_Display_Ref id);
 
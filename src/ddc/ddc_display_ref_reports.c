@@ -14,6 +14,7 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#include "util/json_writer.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
 
@@ -213,11 +214,14 @@ ddc_report_display_by_dref(Display_Ref * dref, int depth) {
       break;
    }
 
-   TRACED_ASSERT(dref->flags & DREF_DDC_COMMUNICATION_CHECKED);
-
    DDCA_Output_Level output_level = get_output_level();
 
-   if (output_level >= DDCA_OL_NORMAL) {
+   if (!(dref->flags & DREF_DDC_COMMUNICATION_CHECKED)) {
+      TRACED_ASSERT(ddc_is_edid_only_detection_enabled());
+      if (output_level >= DDCA_OL_NORMAL)
+         rpt_vstring(d1, "DDC communication not checked");
+   }
+   else if (output_level >= DDCA_OL_NORMAL) {
       if (!(dref->flags & DREF_DDC_COMMUNICATION_WORKING) ) {
          rpt_vstring(d1, "DDC communication failed");
          char msgbuf[100] = {0};
@@ -313,21 +317,12 @@ ddc_report_display_by_dref(Display_Ref * dref, int depth) {
          // DBGMSG("mmk = %s", mmk_repr(mmk) );
          Monitor_Quirk_Data * quirk = get_monitor_quirks(&mmk);
          if (quirk) {
-            char * msg = NULL;
-            switch(quirk->quirk_type) {
-            case  MQ_NONE:
-               break;
-            case MQ_NO_SETTING:
-               msg = "WARNING: Setting feature values has been reported to permanently cripple this monitor!";
-               break;
-            case MQ_NO_MFG_RANGE:
-               msg = "WARNING: Setting manufacturer reserved features has been reported to permanently cripple this monitor!";
-               break;
-            case MQ_OTHER:
-               msg = quirk->quirk_msg;
-            }
-            if (msg)
-               rpt_vstring(d1, msg);
+            if (quirk->quirk_type & MQ_NO_SETTING)
+               rpt_vstring(d1, "WARNING: Setting feature values has been reported to permanently cripple this monitor!");
+            if (quirk->quirk_type & MQ_NO_MFG_RANGE)
+               rpt_vstring(d1, "WARNING: Setting manufacturer reserved features has been reported to permanently cripple this monitor!");
+            if ((quirk->quirk_type & MQ_OTHER) && quirk->quirk_msg)
+               rpt_vstring(d1, "%s", quirk->quirk_msg);
          }
       }
    }
@@ -354,7 +349,7 @@ ddc_report_displays(bool include_invalid_displays, int depth) {
    ddc_ensure_displays_detected();
 
    int display_ct = 0;
-   GPtrArray * all_displays = ddc_get_all_displays();
+   GPtrArray * all_displays = ddc_get_displays_snapshot();
    for (int ndx=0; ndx<all_displays->len; ndx++) {
       Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
       TRACED_ASSERT(memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0);
@@ -364,6 +359,7 @@ ddc_report_displays(bool include_invalid_displays, int depth) {
          rpt_title("",0);
       }
    }
+   ddc_free_displays_snapshot(all_displays);
    if (display_ct == 0) {
       rpt_vstring(depth, "No %sdisplays found.", (!include_invalid_displays) ? "active " : "");
       if ( get_output_level() >= DDCA_OL_NORMAL ) {
@@ -377,6 +373,106 @@ ddc_report_displays(bool include_invalid_displays, int depth) {
 }
 
 
+/** Writes a #Display_Ref as a JSON object.
+ *
+ *  @param  jw    JSON writer
+ *  @param  dref  display reference
+ *
+ *  @remark
+ *  As for #ddc_report_display_by_dref(), the VCP version is read from
+ *  the monitor if communication is working and it is not yet known.
+ */
+void
+ddc_json_display_ref(Json_Writer * jw, Display_Ref * dref) {
+   TRACED_ASSERT(dref && memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0);
+   json_begin_object(jw);
+   json_key_int(jw, "dispno", dref->dispno);
+   switch(dref->dispno) {
+   case DISPNO_BUSY:    json_key_string(jw, "status", "busy");    break;
+   case DISPNO_REMOVED: json_key_string(jw, "status", "removed"); break;
+   case DISPNO_PHANTOM: json_key_string(jw, "status", "phantom"); break;
+   case DISPNO_INVALID: json_key_string(jw, "status", "invalid"); break;
+   default:             json_key_string(jw, "status", "valid");
+   }
+   if (dref->io_path.io_mode == DDCA_IO_I2C) {
+      json_key_int(jw, "busno", dref->io_path.path.i2c_busno);
+      Sys_Drm_Connector * connector = find_sys_drm_connector_by_busno(dref->io_path.path.i2c_busno);
+      if (!connector && dref->pedid)
+         connector = find_sys_drm_connector_by_edid(dref->pedid->bytes);
+      if (connector)
+         json_key_string(jw, "drm_connector", connector->connector_name);
+   }
+   else if (dref->io_path.io_mode == DDCA_IO_USB) {
+      json_key_int(jw, "usb_bus",    dref->usb_bus);
+      json_key_int(jw, "usb_device", dref->usb_device);
+      json_key_string(jw, "hiddev",  dref->usb_hiddev_name);
+   }
+   if (dref->pedid) {
+      Parsed_Edid * pedid = dref->pedid;
+      json_key(jw, "edid");
+      json_begin_object(jw);
+      json_key_string(jw, "mfg_id",        pedid->mfg_id);
+      json_key_string(jw, "model",         pedid->model_name);
+      json_key_string(jw, "serial_number", pedid->serial_ascii);
+      json_key_int(   jw, "binary_serial_number", pedid->serial_binary);
+      json_key_int(   jw, "product_code",  pedid->product_code);
+      json_key_int(   jw, (pedid->is_model_year) ? "model_year" : "manufacture_year", pedid->year);
+      json_key(jw, "bytes");
+      json_hex_bytes(jw, pedid->bytes, 128);
+      json_end_object(jw);
+   }
+   bool working = dref->flags & DREF_DDC_COMMUNICATION_WORKING;
+   json_key_bool(jw, "ddc_checked", dref->flags & DREF_DDC_COMMUNICATION_CHECKED);
+   json_key_bool(jw, "ddc_working", working);
+   json_key(jw, "vcp_version");
+   DDCA_MCCS_Version_Spec vspec = (working) ? get_vcp_version_by_dref(dref) : DDCA_VSPEC_UNKNOWN;
+   if (vspec.major == 0) {
+      json_null(jw);
+   }
+   else {
+      char buf[20];
+      g_snprintf(buf, sizeof(buf), "%d.%d", vspec.major, vspec.minor);
+      json_string(jw, buf);
+   }
+   json_end_object(jw);
+}
+
+
+/** Writes all displays found as a JSON object whose "displays" member
+ *  is an array of #Display_Ref objects.
+ *
+ *  @param  include_invalid_displays  if false, report only valid displays
+ *  @param  jw                        JSON writer
+ *  @return total number of displays reported
+ */
+int
+ddc_json_displays(bool include_invalid_displays, Json_Writer * jw) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "include_invalid_displays=%s", sbool(include_invalid_displays));
+
+   ddc_ensure_displays_detected();
+
+   int display_ct = 0;
+   json_begin_object(jw);
+   json_key(jw, "displays");
+   json_begin_array(jw);
+   GPtrArray * all_displays = ddc_get_displays_snapshot();
+   for (int ndx=0; ndx<all_displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
+      if (dref->dispno > 0 || include_invalid_displays) {
+         display_ct++;
+         ddc_json_display_ref(jw, dref);
+      }
+   }
+   ddc_free_displays_snapshot(all_displays);
+   json_end_array(jw);
+   json_end_object(jw);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %d", display_ct);
+   return display_ct;
+}
+
+
 /** Debugging function to display the contents of a #Display_Ref.
  *
  * @param dref  pointer to #Display_Ref
@@ -471,6 +567,7 @@ void init_ddc_display_ref_reports() {
    RTTI_ADD_FUNC(get_controller_mfg_string_t);
    RTTI_ADD_FUNC(get_firmware_version_string_t);
    RTTI_ADD_FUNC(ddc_report_display_by_dref);
+   RTTI_ADD_FUNC(ddc_json_displays);
 }
 
 
@@ -9,12 +9,16 @@
 #include <glib-2.0/glib.h>
 #include <stdbool.h>
 
+#include "util/json_writer.h"
+
 #include "base/displays.h"
 
 // Display_Ref Reports
 void ddc_report_display_by_dref(Display_Ref * dref, int depth);
 int  ddc_report_displays(bool include_invalid_displays, int depth);
 void ddc_dbgrpt_display_ref(Display_Ref * drec, int depth);
+void ddc_json_display_ref(Json_Writer * jw, Display_Ref * dref);
+int  ddc_json_displays(bool include_invalid_displays, Json_Writer * jw);
 void ddc_dbgrpt_drefs(char * msg, GPtrArray* ptrarray, int depth);
 
 // Initialization
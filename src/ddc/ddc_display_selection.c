@@ -49,6 +49,7 @@ typedef struct {
    char *  model_name;
    char *  serial_ascii;
    Byte *  edidbytes;
+   uint64_t edidbytes_hash;   // set iff edidbytes, see edid_bytes_hash()
 } Display_Criteria;
 
 
@@ -147,7 +148,8 @@ ddc_test_display_ref_criteria(Display_Ref * dref, Display_Criteria * criteria) {
          !streq(dref->pedid->serial_ascii, criteria->serial_ascii) )
       goto bye;
 
-   if (criteria->edidbytes && memcmp(dref->pedid->bytes, criteria->edidbytes, 128) != 0)
+   if (criteria->edidbytes && (dref->pedid->bytes_hash != criteria->edidbytes_hash ||
+                               memcmp(dref->pedid->bytes, criteria->edidbytes, 128) != 0) )
       goto bye;
 
    result = true;
@@ -157,10 +159,165 @@ bye:
 }
 
 
+//
+// Display list indexes
+//
+// Each maps an identifier to the first display in the master display list
+// having that identifier, so the result is the same as that of a linear
+// scan.  The indexes are rebuilt when the display list generation changes.
+//
+
+typedef struct {
+   bool         valid;
+   uint32_t     generation;
+   GHashTable * by_dispno;        // dispno -> Display_Ref *
+   GHashTable * by_busno;         // I2C bus number -> Display_Ref *
+   GHashTable * by_hiddev;        // hiddev device number -> Display_Ref *
+   GHashTable * by_edid;          // 128 byte EDID -> Display_Ref *
+   GHashTable * by_mfg_model_sn;  // "mfg|model|sn" -> Display_Ref *
+} Display_Index;
+
+static Display_Index display_index;
+static GMutex        display_index_mutex;
+
+
+static guint edid_hash(gconstpointer key) {
+   uint64_t hash = edid_bytes_hash(key);
+   return (guint) (hash ^ (hash >> 32));
+}
+
+
+static gboolean edid_equal(gconstpointer a, gconstpointer b) {
+   return memcmp(a, b, 128) == 0;
+}
+
+
+static char * mfg_model_sn_key(const char * mfg_id, const char * model_name, const char * serial_ascii) {
+   return g_strdup_printf("%s|%s|%s", mfg_id, model_name, serial_ascii);
+}
+
+
+static void index_insert(GHashTable * table, gpointer key, Display_Ref * dref, bool owned_key) {
+   if (g_hash_table_contains(table, key)) {
+      if (owned_key)
+         g_free(key);
+   }
+   else {
+      g_hash_table_insert(table, key, dref);
+   }
+}
+
+
+// Must be called with display_index_mutex held
+static void rebuild_display_index(GPtrArray * all_displays, uint32_t generation) {
+   bool debug = false;
+   if (!display_index.by_dispno) {
+      display_index.by_dispno       = g_hash_table_new(g_direct_hash, g_direct_equal);
+      display_index.by_busno        = g_hash_table_new(g_direct_hash, g_direct_equal);
+      display_index.by_hiddev       = g_hash_table_new(g_direct_hash, g_direct_equal);
+      display_index.by_edid         = g_hash_table_new(edid_hash, edid_equal);
+      display_index.by_mfg_model_sn = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+   }
+   else {
+      g_hash_table_remove_all(display_index.by_dispno);
+      g_hash_table_remove_all(display_index.by_busno);
+      g_hash_table_remove_all(display_index.by_hiddev);
+      g_hash_table_remove_all(display_index.by_edid);
+      g_hash_table_remove_all(display_index.by_mfg_model_sn);
+   }
+
+   for (int ndx = 0; ndx < all_displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
+      TRACED_ASSERT(memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0);
+      index_insert(display_index.by_dispno, GINT_TO_POINTER(dref->dispno), dref, false);
+      if (dref->io_path.io_mode == DDCA_IO_I2C)
+         index_insert(display_index.by_busno, GINT_TO_POINTER(dref->io_path.path.i2c_busno), dref, false);
+      else if (dref->io_path.io_mode == DDCA_IO_USB)
+         index_insert(display_index.by_hiddev, GINT_TO_POINTER(dref->io_path.path.hiddev_devno), dref, false);
+      if (dref->pedid) {
+         index_insert(display_index.by_edid, dref->pedid->bytes, dref, false);
+         index_insert(display_index.by_mfg_model_sn,
+                      mfg_model_sn_key(dref->pedid->mfg_id, dref->pedid->model_name, dref->pedid->serial_ascii),
+                      dref, true);
+      }
+   }
+   display_index.valid = true;
+   display_index.generation = generation;
+   DBGMSF(debug, "Rebuilt display index for generation %u, %d displays", generation, all_displays->len);
+}
+
+
+/** Looks up the criteria in the display list indexes.
+ *
+ *  @param  criteria   criteria to look up
+ *  @param  found_loc  where to return the #Display_Ref, NULL if no display matches
+ *  @return true if the criteria could be resolved using the indexes,
+ *          false if a linear scan is required
+ */
+static bool
+ddc_find_display_ref_using_index(Display_Criteria * criteria, Display_Ref ** found_loc) {
+   GHashTable * table = NULL;
+   gpointer     key   = NULL;
+   char *       owned_key = NULL;
+   int          criteria_ct = 0;
+   if (criteria->dispno >= 0) {
+      criteria_ct++;
+      table = display_index.by_dispno;
+      key = GINT_TO_POINTER(criteria->dispno);
+   }
+   if (criteria->i2c_busno >= 0) {
+      criteria_ct++;
+      table = display_index.by_busno;
+      key = GINT_TO_POINTER(criteria->i2c_busno);
+   }
+   if (criteria->edidbytes) {
+      criteria_ct++;
+      table = display_index.by_edid;
+      key = criteria->edidbytes;
+   }
+   if (criteria->mfg_id || criteria->model_name || criteria->serial_ascii) {
+      // empty fields match anything, which only a scan can handle
+      if (!criteria->mfg_id       || strlen(criteria->mfg_id)       == 0 ||
+          !criteria->model_name   || strlen(criteria->model_name)   == 0 ||
+          !criteria->serial_ascii || strlen(criteria->serial_ascii) == 0)
+         return false;
+      criteria_ct++;
+      owned_key = mfg_model_sn_key(criteria->mfg_id, criteria->model_name, criteria->serial_ascii);
+   }
+#ifdef USE_USB
+   // hiddev criteria also compare the device name, which only a scan can handle
+   if (criteria->hiddev >= 0 || criteria->usb_busno >= 0 || criteria->usb_devno >= 0)
+      return false;
+#endif
+   if (criteria_ct != 1) {
+      g_free(owned_key);
+      return false;
+   }
+
+   g_mutex_lock(&display_index_mutex);
+   // read the generation first, so a list published meanwhile causes a later rebuild
+   uint32_t generation = ddc_get_display_list_generation();
+   if (!display_index.valid || display_index.generation != generation) {
+      GPtrArray * snapshot = ddc_get_displays_snapshot();
+      rebuild_display_index(snapshot, generation);
+      ddc_free_displays_snapshot(snapshot);
+   }
+   if (owned_key)
+      table = display_index.by_mfg_model_sn;
+   *found_loc = g_hash_table_lookup(table, (owned_key) ? owned_key : key);
+   g_mutex_unlock(&display_index_mutex);
+   g_free(owned_key);
+   return true;
+}
+
+
 static Display_Ref *
 ddc_find_display_ref_by_criteria(Display_Criteria * criteria) {
    Display_Ref * result = NULL;
-   GPtrArray * all_displays = ddc_get_all_displays();
+   if (ddc_find_display_ref_using_index(criteria, &result))
+      return result;
+
+   GPtrArray * all_displays = ddc_get_displays_snapshot();
    for (int ndx = 0; ndx < all_displays->len; ndx++) {
       Display_Ref * drec = g_ptr_array_index(all_displays, ndx);
       TRACED_ASSERT(memcmp(drec->marker, DISPLAY_REF_MARKER, 4) == 0);
@@ -169,6 +326,7 @@ ddc_find_display_ref_by_criteria(Display_Criteria * criteria) {
          break;
       }
    }
+   ddc_free_displays_snapshot(all_displays);
    return result;
 }
 
@@ -206,6 +364,7 @@ ddc_find_display_ref_by_display_identifier(Display_Identifier * did) {
       break;
    case DISP_ID_EDID:
       criteria->edidbytes = did->edidbytes;
+      criteria->edidbytes_hash = edid_bytes_hash(did->edidbytes);
       break;
    case DISP_ID_DISPNO:
       criteria->dispno = did->dispno;
@@ -241,6 +400,101 @@ ddc_find_display_ref_by_display_identifier(Display_Identifier * did) {
 }
 
 
+//
+// Resolved display identifier cache
+//
+// Batch and daemon clients issue the same display selector repeatedly.
+// Maps a key built from each #Display_Identifier to the #Display_Ref it
+// resolved to, including NULL for "not found".  Cleared when the display
+// list generation changes.
+//
+
+#define RESOLVED_DID_CACHE_MAX 32
+
+static GHashTable * resolved_did_cache = NULL;   // key -> Display_Ref *, may be NULL
+static uint32_t     resolved_did_generation = 0;
+static GMutex       resolved_did_mutex;
+
+
+static char * resolved_did_cache_key(Display_Identifier * did) {
+   char * result = NULL;
+   switch(did->id_type) {
+   case DISP_ID_BUSNO:
+      result = g_strdup_printf("b%d", did->busno);
+      break;
+   case DISP_ID_MONSER:
+      result = g_strdup_printf("m%s|%s|%s", did->mfg_id, did->model_name, did->serial_ascii);
+      break;
+   case DISP_ID_EDID:
+   {
+      char * hs = hexstring(did->edidbytes, 128);
+      result = g_strdup_printf("e%s", hs);
+      free(hs);
+      break;
+   }
+   case DISP_ID_DISPNO:
+      result = g_strdup_printf("d%d", did->dispno);
+      break;
+   case DISP_ID_USB:
+      result = g_strdup_printf("u%d.%d", did->usb_bus, did->usb_device);
+      break;
+   case DISP_ID_HIDDEV:
+      result = g_strdup_printf("h%d", did->hiddev_devno);
+      break;
+   }
+   return result;
+}
+
+
+/** Looks up a #Display_Identifier in the resolved identifier cache,
+ *  searching the display list on a miss.
+ *
+ *  @param did display identifier to search for
+ *  @return #Display_Ref for the display, NULL if not found or
+ *          display doesn't support DDC
+ */
+static Display_Ref *
+ddc_find_display_ref_by_display_identifier_cached(Display_Identifier * did) {
+   bool debug = false;
+   char * key = resolved_did_cache_key(did);
+   if (!key)
+      return ddc_find_display_ref_by_display_identifier(did);
+
+   Display_Ref * result = NULL;
+   gpointer cached = NULL;
+   g_mutex_lock(&resolved_did_mutex);
+   // read the generation first, so a list published meanwhile invalidates the entry
+   uint32_t generation = ddc_get_display_list_generation();
+   if (!resolved_did_cache)
+      resolved_did_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+   else if (resolved_did_generation != generation)
+      g_hash_table_remove_all(resolved_did_cache);
+   resolved_did_generation = generation;
+   bool found = g_hash_table_lookup_extended(resolved_did_cache, key, NULL, &cached);
+   g_mutex_unlock(&resolved_did_mutex);
+
+   if (found) {
+      result = cached;
+      DBGMSF(debug, "Cache hit for %s, returning %p", key, (void*) result);
+      g_free(key);
+   }
+   else {
+      result = ddc_find_display_ref_by_display_identifier(did);
+      g_mutex_lock(&resolved_did_mutex);
+      if (resolved_did_generation == generation) {
+         if (g_hash_table_size(resolved_did_cache) >= RESOLVED_DID_CACHE_MAX)
+            g_hash_table_remove_all(resolved_did_cache);
+         g_hash_table_replace(resolved_did_cache, key, result);
+      }
+      else {
+         g_free(key);
+      }
+      g_mutex_unlock(&resolved_did_mutex);
+   }
+   return result;
+}
+
+
 /** Searches the detected displays for one matching the criteria in a
  *  #Display_Identifier.
  *
@@ -258,7 +512,7 @@ get_display_ref_for_display_identifier(
                 Display_Identifier* pdid,
                 Call_Options        callopts)
 {
-   Display_Ref * dref = ddc_find_display_ref_by_display_identifier(pdid);
+   Display_Ref * dref = ddc_find_display_ref_by_display_identifier_cached(pdid);
    if ( !dref && (callopts & CALLOPT_ERR_MSG) ) {
       f0printf(ferr(), "Display not found\n");
    }
@@ -13,6 +13,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <time.h>
@@ -21,9 +23,12 @@
 #include "util/edid.h"
 #include "util/error_info.h"
 #include "util/failsim.h"
+#include "util/glib_util.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/sysfs_i2c_util.h"
 #include "util/sysfs_util.h"
+#include "util/timestamp.h"
 #ifdef ENABLE_UDEV
 #include "util/udev_usb_util.h"
 #include "util/udev_util.h"
@@ -35,12 +40,18 @@
 
 #include "base/core.h"
 #include "base/ddc_packets.h"
+#include "base/execution_stats.h"
+#include "base/executor.h"
 #include "base/feature_metadata.h"
 #include "base/linux_errno.h"
 #include "base/monitor_model_key.h"
+#include "base/monitor_quirks.h"
+#include "base/op_profile.h"
 #include "base/parms.h"
 #include "base/rtti.h"
+#include "base/thread_sched.h"
 
+#include "vcp/persistent_capabilities.h"
 #include "vcp/vcp_feature_codes.h"
 
 #include "i2c/i2c_bus_core.h"
@@ -54,24 +65,59 @@
 #include "dynvcp/dyn_feature_files.h"
 
 #include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_read_capabilities.h"
 #include "ddc/ddc_vcp.h"
 #include "ddc/ddc_vcp_version.h"
 
 #include "ddc/ddc_display_ref_reports.h"
+#include "ddc/ddc_displays_cache.h"
 #include "ddc/ddc_displays.h"
+#ifdef BUILD_SHARED_LIB
+#include "ddc/ddc_watch_displays.h"
+#endif
 
 // Default trace class for this file
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
 
 static GPtrArray * all_displays = NULL;         // all detected displays
 static GPtrArray * display_open_errors = NULL;  // array of Bus_Open_Error
+static GPtrArray * retired_displays = NULL;     // Display_Refs removed by incremental redetection
+static GPtrArray * retired_bus_infos = NULL;    // I2C_Bus_Info's they may refer to
 static int dispno_max = 0;                      // highest assigned display number
+static uint32_t display_list_generation = 0;   // incremented whenever all_displays changes
+
+// Once published, the all_displays array is never modified.  Detection,
+// redetection and discarding build a new array and publish it in place of
+// the old one, which is freed when the last reference to it is released.
+// Threads other than the one performing detection iterate over a
+// reference obtained by ddc_get_displays_snapshot(), so they never hold
+// a lock while doing so.
+static GRWLock     all_displays_lock;           // protects the all_displays pointer
+static GMutex      display_detection_mutex;     // serializes detection, redetection and discard
+static gint        snapshots_outstanding = 0;   // references from ddc_get_displays_snapshot()
+static GMutex      deferred_drefs_mutex;
+static GPtrArray * deferred_drefs = NULL;       // discarded while snapshots were outstanding
 static int async_threshold = DISPLAY_CHECK_ASYNC_THRESHOLD_DEFAULT;
+
+// Progressive detection, see ddc_start_display_detection()
+typedef struct {
+   DDCA_Display_Detection_Callback_Func func;
+   GPtrArray *                          reported;   // Display_Refs passed to func
+} Detection_Progress;
+static GMutex               detection_progress_mutex;   // protects the following
+static Detection_Progress * detection_progress = NULL;  // set while progressive detection runs
+static GPtrArray *          ready_displays = NULL;      // reported, but not yet published
+
+// Targeted resolution, see ddc_get_targeted_display_ref()
+static GMutex      targeted_displays_mutex;   // protects targeted_displays
+static GPtrArray * targeted_displays = NULL;  // Display_Refs resolved before detection
+
 #ifdef USE_USB
 static bool detect_usb_displays = true;
 #else
 static bool detect_usb_displays = false;
 #endif
+static bool edid_only_detection = false;
 
 //
 // Functions to perform initial checks
@@ -91,6 +137,19 @@ ddc_set_async_threshold(int threshold) {
 }
 
 
+/** Sets the number of threads used for async display examination.
+ *
+ *  The threads are those of the shared executor, see executor.c, so the
+ *  setting also applies to bus probing and capabilities prefetch.
+ *
+ *  @param pool_size  number of threads, must be > 0
+ */
+void
+ddc_set_async_pool_size(int pool_size) {
+   executor_set_worker_count(pool_size);
+}
+
+
 static inline bool
 value_bytes_zero_for_any_value(DDCA_Any_Vcp_Value * pvalrec) {
    bool result = pvalrec && pvalrec->value_type ==  DDCA_NON_TABLE_VCP_VALUE &&
@@ -102,6 +161,94 @@ value_bytes_zero_for_any_value(DDCA_Any_Vcp_Value * pvalrec) {
 }
 
 
+//
+// Automatic selection of combined or separate I2C write/read
+//
+
+// Video drivers on which a combined write/read has failed, used as a set
+static GHashTable * combined_write_read_failing_drivers = NULL;
+static GMutex       combined_write_read_drivers_mutex;
+
+
+static bool
+is_combined_write_read_failing_driver(const char * driver) {
+   g_mutex_lock(&combined_write_read_drivers_mutex);
+   bool result = combined_write_read_failing_drivers &&
+                 g_hash_table_contains(combined_write_read_failing_drivers, driver);
+   g_mutex_unlock(&combined_write_read_drivers_mutex);
+   return result;
+}
+
+
+static void
+record_combined_write_read_failing_driver(const char * driver) {
+   g_mutex_lock(&combined_write_read_drivers_mutex);
+   if (!combined_write_read_failing_drivers)
+      combined_write_read_failing_drivers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+   g_hash_table_add(combined_write_read_failing_drivers, g_strdup(driver));
+   g_mutex_unlock(&combined_write_read_drivers_mutex);
+}
+
+
+/** Repeats the initial feature request using a combined I2C write/read,
+ *  and keeps the combined mode for the display if the request has the same
+ *  outcome and is faster than with a separate write and read.
+ *
+ *  @param dh              display handle for open I2C bus
+ *  @param feature_code    feature read by the initial request
+ *  @param separate_psc    status of the request with separate write and read
+ *  @param separate_nanos  elapsed time of that request
+ */
+static void
+ddc_select_i2c_write_read_mode(
+      Display_Handle *      dh,
+      DDCA_Vcp_Feature_Code feature_code,
+      Public_Status_Code    separate_psc,
+      uint64_t              separate_nanos)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x, separate_psc=%s, separate_nanos=%"PRIu64,
+                          dh_repr(dh), feature_code, psc_name_code(separate_psc), separate_nanos);
+   Display_Ref * dref = dh->dref;
+   Monitor_Quirk_Data * quirk = get_monitor_quirks(dref->mmid);
+   char * driver = get_driver_for_busno(dref->io_path.path.i2c_busno);
+
+   if (quirk && (quirk->quirk_type & MQ_SEPARATE_WRITE_READ)) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Monitor requires separate write and read");
+   }
+   else if (driver && is_combined_write_read_failing_driver(driver)) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Combined write/read already failed for driver %s", driver);
+   }
+   else {
+      DDCA_Any_Vcp_Value * pvalrec = NULL;
+      dref->flags |= DREF_I2C_COMBINED_WRITE_READ;
+      uint64_t start = cur_monotonic_nanosec();
+      Error_Info * ddc_excp = ddc_get_vcp_value(dh, feature_code, DDCA_NON_TABLE_VCP_VALUE, &pvalrec);
+      uint64_t combined_nanos = cur_monotonic_nanosec() - start;
+      Public_Status_Code psc = (ddc_excp) ? ddc_excp->status_code : 0;
+      if (ddc_excp)
+         errinfo_free(ddc_excp);
+      if (pvalrec)
+         free_single_vcp_value(pvalrec);
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "combined write/read: psc=%s, nanos=%"PRIu64,
+                                          psc_name_code(psc), combined_nanos);
+
+      if (psc != separate_psc) {
+         dref->flags &= ~DREF_I2C_COMBINED_WRITE_READ;
+         if (driver)
+            record_combined_write_read_failing_driver(driver);
+      }
+      else if (combined_nanos >= separate_nanos) {
+         dref->flags &= ~DREF_I2C_COMBINED_WRITE_READ;
+      }
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "dh=%s, driver=%s, combined write/read: %s",
+                     dh_repr(dh), driver, sbool(dref->flags & DREF_I2C_COMBINED_WRITE_READ));
+   free(driver);
+}
+
+
 /** Collects initial monitor checks to perform them on a single open of the
  *  monitor device, and to avoid repeating them.
  *
@@ -130,6 +277,11 @@ value_bytes_zero_for_any_value(DDCA_Any_Vcp_Value * pvalrec) {
  *  Note that the test here is not perfect, as a Null Response might
  *  in fact indicate a transient error, but that is rare.
  *  @remark
+ *  How the monitor indicates an unsupported feature is saved in the
+ *  capabilities cache.  If it is already known, communication is instead
+ *  checked by reading feature xdf, which is needed for the VCP version in
+ *  any case, and the feature x00 request and its retries are avoided.
+ *  @remark
  *  Output level should have been set <= DDCA_OL_NORMAL prior to this call since
  *  verbose output is distracting.
  */
@@ -144,11 +296,19 @@ ddc_initial_checks_by_dh(Display_Handle * dh) {
    DDCA_Any_Vcp_Value * pvalrec;
 
    if (!(dh->dref->flags & DREF_DDC_COMMUNICATION_CHECKED)) {
+      Dref_Flags saved_signaling = 0;
+      if (dh->dref->io_path.io_mode == DDCA_IO_I2C && dh->dref->mmid && dh->dref->pedid)
+         saved_signaling = get_persistent_unsupported_signaling(dh->dref->mmid, dh->dref->pedid->bytes) &
+                           DREF_DDC_UNSUPPORTED_SIGNALING_FLAGS;
+      DDCA_Vcp_Feature_Code probe_code = (saved_signaling) ? 0xdf : 0x00;
+
       Public_Status_Code psc = 0;
-      Error_Info * ddc_excp = ddc_get_vcp_value(dh, 0x00, DDCA_NON_TABLE_VCP_VALUE, &pvalrec);
+      uint64_t start = cur_monotonic_nanosec();
+      Error_Info * ddc_excp = ddc_get_vcp_value(dh, probe_code, DDCA_NON_TABLE_VCP_VALUE, &pvalrec);
+      uint64_t elapsed_nanos = cur_monotonic_nanosec() - start;
       psc = (ddc_excp) ? ddc_excp->status_code : 0;
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "ddc_get_vcp_value() for feature 0x00 returned: %s, pvalrec=%p",
-                             errinfo_summary(ddc_excp), pvalrec);
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "ddc_get_vcp_value() for feature 0x%02x returned: %s, pvalrec=%p",
+                             probe_code, errinfo_summary(ddc_excp), pvalrec);
       TRACED_ASSERT( (psc == 0 && pvalrec) || (psc != 0 && !pvalrec) );
 
       if (psc == DDCRC_RETRIES && debug)
@@ -175,7 +335,22 @@ ddc_initial_checks_by_dh(Display_Handle * dh) {
          {
             dh->dref->flags |= DREF_DDC_COMMUNICATION_WORKING;
 
-            if (psc == DDCRC_REPORTED_UNSUPPORTED)
+            if (saved_signaling) {
+               DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Using saved unsupported feature signaling: %s",
+                                                   interpret_dref_flags_t(saved_signaling));
+               dh->dref->flags |= saved_signaling;
+               if ( vcp_version_eq(dh->dref->vcp_version_xdf, DDCA_VSPEC_UNQUERIED)) { // may have been forced by option --mccs
+                  dh->dref->vcp_version_xdf = DDCA_VSPEC_UNKNOWN;     // pre MCCS v2 monitor if xdf unsupported
+                  if (psc == 0) {
+                     dh->dref->vcp_version_xdf.major = pvalrec->val.c_nc.sh;
+                     dh->dref->vcp_version_xdf.minor = pvalrec->val.c_nc.sl;
+                     set_persistent_vcp_version(dh->dref->mmid, dh->dref->pedid->bytes,
+                                                dh->dref->vcp_version_xdf);
+                  }
+               }
+            }
+
+            else if (psc == DDCRC_REPORTED_UNSUPPORTED)
                dh->dref->flags |= DREF_DDC_USES_DDC_FLAG_FOR_UNSUPPORTED;
 
             else if (psc == DDCRC_NULL_RESPONSE || psc == DDCRC_ALL_RESPONSES_NULL)
@@ -198,6 +373,13 @@ ddc_initial_checks_by_dh(Display_Handle * dh) {
                   dh->dref->flags |= DREF_DDC_DOES_NOT_INDICATE_UNSUPPORTED;
                }
             }
+
+            if (!saved_signaling && dh->dref->mmid && dh->dref->pedid)
+               set_persistent_unsupported_signaling(dh->dref->mmid, dh->dref->pedid->bytes,
+                     dh->dref->flags & DREF_DDC_UNSUPPORTED_SIGNALING_FLAGS);
+
+            if (I2C_Auto_Write_Read && !(dh->dref->flags & DREF_I2C_COMBINED_WRITE_READ))
+               ddc_select_i2c_write_read_mode(dh, probe_code, psc, elapsed_nanos);
          }  // end, communication working
 
          else {   // communication failed
@@ -213,6 +395,8 @@ ddc_initial_checks_by_dh(Display_Handle * dh) {
             }
          }
       }    // end, io_mode == DDC_IO_I2C
+      if (pvalrec)
+         free_single_vcp_value(pvalrec);
       dh->dref->flags |= DREF_DDC_COMMUNICATION_CHECKED;
 
      if ( dh->dref->flags & DREF_DDC_COMMUNICATION_WORKING ) {
@@ -244,6 +428,14 @@ ddc_initial_checks_by_dref(Display_Ref * dref) {
    DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s", dref_repr_t(dref));
    DBGTRC_NOPREFIX(debug, TRACE_GROUP, "dref->flags: %s", interpret_dref_flags_t(dref->flags));
 
+   if (dref->flags & DREF_DDC_COMMUNICATION_CHECKED) {
+      // e.g. results restored from the displays cache
+      bool result = dref->flags & DREF_DDC_COMMUNICATION_WORKING;
+      DBGTRC_DONE(debug, TRACE_GROUP, "Already checked. Returning %s", sbool(result));
+      return result;
+   }
+   OP_PROFILE(OPT_DETECTION, dref);
+
    bool result = false;
    Display_Handle * dh = NULL;
    Public_Status_Code psc = 0;
@@ -265,26 +457,84 @@ ddc_initial_checks_by_dref(Display_Ref * dref) {
 }
 
 
-/** Performs initial checks in a thread
+/** Returns an identifier for the physical adapter through which a display
+ *  is reached, see #get_physical_adapter_for_busno().
  *
- *  @param data display reference
+ *  @param  dref  display reference
+ *  @return sysfs path of the adapter, caller must free,
+ *          NULL if not an I2C display or the adapter cannot be determined
  */
-void *
-threaded_initial_checks_by_dref(gpointer data) {
-   bool debug = false;
+static char *
+physical_adapter_key(Display_Ref * dref) {
+   char * result = NULL;
+   if (dref->io_path.io_mode == DDCA_IO_I2C)
+      result = get_physical_adapter_for_busno(dref->io_path.path.i2c_busno);
+   return result;
+}
+
+
+/** If progressive detection is in progress, reports a display.
+ *
+ *  The display is recorded in #ready_displays, so it is accepted as valid
+ *  before the display list is published.
+ *
+ *  @param  dref  display reference
+ */
+static void
+report_ready_display(Display_Ref * dref) {
+   DDCA_Display_Detection_Callback_Func func = NULL;
+   g_mutex_lock(&detection_progress_mutex);
+   if (detection_progress) {
+      if (!ready_displays)
+         ready_displays = g_ptr_array_new();
+      g_ptr_array_add(ready_displays, dref);
+      g_ptr_array_add(detection_progress->reported, dref);
+      func = detection_progress->func;
+   }
+   g_mutex_unlock(&detection_progress_mutex);
+   if (func)
+      func(dref);
+}
+
 
+/** Performs initial checks on a display and, if DDC communication works,
+ *  reports the display to progressive detection.
+ *
+ *  @param  dref  display reference
+ */
+static void
+initial_checks_and_report(Display_Ref * dref) {
+   if (ddc_initial_checks_by_dref(dref))
+      report_ready_display(dref);
+}
+
+
+/** Performs initial checks on a display.
+ *
+ *  Satisfies Executor_Task_Func.
+ *
+ *  @param data  pointer to #Display_Ref
+ */
+static void
+threaded_initial_checks(gpointer data) {
+   bool debug = false;
    Display_Ref * dref = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref = %s", dref_repr_t(dref));
    TRACED_ASSERT(memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0 );
-   DBGTRC_STARTING(debug, TRACE_GROUP, "dref = %s", dref_repr_t(dref) );
 
-   ddc_initial_checks_by_dref(dref);
-   // g_thread_exit(NULL);
-   DBGTRC_DONE(debug, TRACE_GROUP, "Returning NULL. dref = %s,", dref_repr_t(dref) );
-   return NULL;
+   initial_checks_and_report(dref);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
 
 
-/** Spawns threads to perform initial checks and waits for them all to complete.
+/** Performs initial checks using the shared executor, and waits for them
+ *  all to complete.
+ *
+ *  Each display's check is given the display's physical adapter as its
+ *  affinity.  The displays on an adapter are therefore checked serially,
+ *  so that buses on the same adapter are not used at the same time, while
+ *  different adapters are checked in parallel.
  *
  *  @param all_displays #GPtrArray of pointers to #Display_Ref
  */
@@ -292,25 +542,18 @@ void ddc_async_scan(GPtrArray * all_displays) {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "all_displays=%p, display_count=%d", all_displays, all_displays->len);
 
-   GPtrArray * threads = g_ptr_array_new();
+   Executor_Group * group = executor_group_new();
    for (int ndx = 0; ndx < all_displays->len; ndx++) {
       Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
       TRACED_ASSERT( memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0 );
 
-      GThread * th =
-      g_thread_new(
-            dref_repr_t(dref),                // thread name
-            threaded_initial_checks_by_dref,
-            dref);                            // pass pointer to display ref as data
-      g_ptr_array_add(threads, th);
-   }
-   DBGMSF(debug, "Started %d threads", threads->len);
-   for (int ndx = 0; ndx < threads->len; ndx++) {
-      GThread * thread = g_ptr_array_index(threads, ndx);
-      g_thread_join(thread);  // implicitly unrefs the GThread
+      char * key = physical_adapter_key(dref);
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "dref=%s, adapter=%s", dref_repr_t(dref), key);
+      executor_submit(group, key, threaded_initial_checks, dref);
+      free(key);
    }
-   DBGMSF(debug, "Threads joined");
-   g_ptr_array_free(threads, true);
+   executor_wait_group(group);
+   DBGMSF(debug, "All checks complete");
 
    DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
@@ -328,12 +571,59 @@ ddc_non_async_scan(GPtrArray * all_displays) {
    for (int ndx = 0; ndx < all_displays->len; ndx++) {
       Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
       TRACED_ASSERT( memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0 );
-      ddc_initial_checks_by_dref(dref);
+      initial_checks_and_report(dref);
    }
    DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
 
 
+/** Checks DDC communication with newly found displays and assigns their
+ *  display numbers.
+ *
+ *  With EDID-only detection the displays are not checked, and every
+ *  display is assigned a number.
+ *
+ *  @param drefs  #GPtrArray of pointers to #Display_Ref
+ */
+static void
+check_and_number_displays(GPtrArray * drefs) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "display count=%d, async_threshold=%d, edid_only_detection=%s",
+                                       drefs->len, async_threshold, sbool(edid_only_detection));
+
+   if (edid_only_detection) {
+      for (int ndx = 0; ndx < drefs->len; ndx++)
+         report_ready_display(g_ptr_array_index(drefs, ndx));
+   }
+   else {
+      // verbose output is distracting within scans
+      // saved and reset here so that async threads are not adjusting output level
+      DDCA_Output_Level olev = get_output_level();
+      if (olev == DDCA_OL_VERBOSE)
+         set_output_level(DDCA_OL_NORMAL);
+      if (drefs->len >= async_threshold)
+         ddc_async_scan(drefs);
+      else
+         ddc_non_async_scan(drefs);
+      if (olev == DDCA_OL_VERBOSE)
+         set_output_level(olev);
+   }
+
+   for (int ndx = 0; ndx < drefs->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(drefs, ndx);
+      TRACED_ASSERT( memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0 );
+      if (edid_only_detection || (dref->flags & DREF_DDC_COMMUNICATION_WORKING))
+         dref->dispno = ++dispno_max;
+      else if (dref->flags & DREF_DDC_BUSY)
+         dref->dispno = DISPNO_BUSY;
+      else
+         dref->dispno = DISPNO_INVALID;   // -1
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "dispno_max=%d", dispno_max);
+}
+
+
 //
 // Functions to get display information
 //
@@ -343,6 +633,10 @@ ddc_non_async_scan(GPtrArray * all_displays) {
  *  Detection must already have occurred.
  *
  *  @return **GPtrArray of #Display_Ref instances
+ *
+ *  @remark
+ *  The array is freed by a concurrent redetection.  Code that can run in
+ *  parallel with redetection should use #ddc_get_displays_snapshot().
  */
 GPtrArray *
 ddc_get_all_displays() {
@@ -352,6 +646,76 @@ ddc_get_all_displays() {
 }
 
 
+/** Gets a reference to the current list of detected displays.
+ *
+ *  The list is not changed by later detection or redetection, which
+ *  publish a new list instead, and the #Display_Ref instances it contains
+ *  are not freed while any reference is outstanding.
+ *
+ *  @return **GPtrArray of #Display_Ref instances, empty if displays have
+ *          not been detected.  Release with #ddc_free_displays_snapshot().
+ */
+GPtrArray *
+ddc_get_displays_snapshot() {
+   g_rw_lock_reader_lock(&all_displays_lock);
+   GPtrArray * result = (all_displays) ? g_ptr_array_ref(all_displays) : g_ptr_array_new();
+   g_atomic_int_inc(&snapshots_outstanding);
+   g_rw_lock_reader_unlock(&all_displays_lock);
+   return result;
+}
+
+
+static void
+free_deferred_drefs() {
+   g_mutex_lock(&deferred_drefs_mutex);
+   if (deferred_drefs && g_atomic_int_get(&snapshots_outstanding) == 0) {
+      for (int ndx = 0; ndx < deferred_drefs->len; ndx++) {
+         DDCA_Status ddcrc = free_display_ref(g_ptr_array_index(deferred_drefs, ndx));
+         TRACED_ASSERT(ddcrc==0);
+      }
+      g_ptr_array_free(deferred_drefs, true);
+      deferred_drefs = NULL;
+   }
+   g_mutex_unlock(&deferred_drefs_mutex);
+}
+
+
+/** Releases a reference obtained by #ddc_get_displays_snapshot().
+ *
+ *  @param snapshot  array of #Display_Ref
+ */
+void
+ddc_free_displays_snapshot(GPtrArray * snapshot) {
+   g_ptr_array_unref(snapshot);
+   if (g_atomic_int_dec_and_test(&snapshots_outstanding))
+      free_deferred_drefs();
+}
+
+
+/** Replaces the published list of detected displays.
+ *
+ *  Must be called with #display_detection_mutex held.
+ *
+ *  @param  new_list  new list, NULL if displays have been discarded
+ */
+static void
+publish_display_list(GPtrArray * new_list) {
+   g_rw_lock_writer_lock(&all_displays_lock);
+   GPtrArray * old_list = all_displays;
+   all_displays = new_list;
+   __atomic_add_fetch(&display_list_generation, 1, __ATOMIC_RELEASE);
+   g_rw_lock_writer_unlock(&all_displays_lock);
+   if (old_list)
+      g_ptr_array_unref(old_list);
+
+   // displays reported by progressive detection are now in the list
+   g_mutex_lock(&detection_progress_mutex);
+   if (ready_displays)
+      g_ptr_array_set_size(ready_displays, 0);
+   g_mutex_unlock(&detection_progress_mutex);
+}
+
+
 /** Gets a list of all detected displays, optionally excluding those
  *  that are invalid.
  *
@@ -362,13 +726,15 @@ ddc_get_filtered_displays(bool include_invalid_displays) {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "include_invalid_displays=%s", sbool(include_invalid_displays));
    TRACED_ASSERT(all_displays);
-   GPtrArray * result = g_ptr_array_sized_new(all_displays->len);
-   for (int ndx = 0; ndx < all_displays->len; ndx++) {
-      Display_Ref * cur = g_ptr_array_index(all_displays, ndx);
+   GPtrArray * snapshot = ddc_get_displays_snapshot();
+   GPtrArray * result = g_ptr_array_sized_new(snapshot->len);
+   for (int ndx = 0; ndx < snapshot->len; ndx++) {
+      Display_Ref * cur = g_ptr_array_index(snapshot, ndx);
       if (include_invalid_displays || cur->dispno > 0) {
          g_ptr_array_add(result, cur);
       }
    }
+   ddc_free_displays_snapshot(snapshot);
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning array of size %d", result->len);
    if (debug || IS_TRACING()) {
       ddc_dbgrpt_drefs("Display_Refs:", result, 2);
@@ -385,15 +751,17 @@ ddc_get_filtered_displays(bool include_invalid_displays) {
 int
 ddc_get_display_count(bool include_invalid_displays) {
    int display_ct = -1;
-   if (all_displays) {
+   if (ddc_displays_already_detected()) {
       display_ct = 0;
-      for (int ndx=0; ndx<all_displays->len; ndx++) {
-         Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
+      GPtrArray * snapshot = ddc_get_displays_snapshot();
+      for (int ndx=0; ndx<snapshot->len; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(snapshot, ndx);
          TRACED_ASSERT(memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0);
          if (dref->dispno > 0 || include_invalid_displays) {
             display_ct++;
          }
       }
+      ddc_free_displays_snapshot(snapshot);
    }
    return display_ct;
 }
@@ -417,8 +785,12 @@ ddc_get_bus_open_errors() {
 
 static bool
 edid_ids_match(Parsed_Edid * edid1, Parsed_Edid * edid2) {
+   // identical EDIDs are interned, see create_interned_parsed_edid()
+   if (edid1 == edid2)
+      return true;
    bool result = false;
-   result = streq(edid1->mfg_id,        edid2->mfg_id)        &&
+   result = edid1->ids_hash          == edid2->ids_hash       &&
+            streq(edid1->mfg_id,        edid2->mfg_id)        &&
             streq(edid1->model_name,    edid2->model_name)    &&
             edid1->product_code      == edid2->product_code   &&
             streq(edid1->serial_ascii,  edid2->serial_ascii)  &&
@@ -530,6 +902,9 @@ filter_phantom_displays(GPtrArray * all_displays) {
          Display_Ref * invalid_ref = g_ptr_array_index(invalid_displays, invalid_ndx);
          for (int valid_ndx = 0; valid_ndx < valid_displays->len; valid_ndx++) {
             Display_Ref *  valid_ref = g_ptr_array_index(valid_displays, valid_ndx);
+            // cheap test first, most pairs on a wall of identical panels differ by serial number
+            if (invalid_ref->pedid->ids_hash != valid_ref->pedid->ids_hash)
+               continue;
             if (is_phantom_display(invalid_ref, valid_ref)) {
                invalid_ref->dispno = DISPNO_PHANTOM;    // -2
                invalid_ref->actual_display = valid_ref;
@@ -570,7 +945,232 @@ void dbgrpt_bus_open_errors(GPtrArray * open_errors, int depth) {
 }
 
 
+/** Creates a #Display_Ref for a monitor detected on an I2C bus.
+ *
+ *  @param  businfo  bus information, must have an EDID
+ *  @return newly allocated #Display_Ref
+ */
+static Display_Ref *
+create_i2c_display_ref(I2C_Bus_Info * businfo) {
+   Display_Ref * dref = create_bus_display_ref(businfo->busno);
+   dref->dispno = DISPNO_INVALID;   // -1, guilty until proven innocent
+   dref->pedid = businfo->edid;    // needed?
+   dref->mmid  = monitor_model_key_new(
+                    dref->pedid->mfg_id,
+                    dref->pedid->model_name,
+                    dref->pedid->product_code);
+
+   // drec->detail.bus_detail = businfo;
+   dref->detail = businfo;
+   dref->flags |= DREF_DDC_IS_MONITOR_CHECKED;
+   dref->flags |= DREF_DDC_IS_MONITOR;
+   Monitor_Quirk_Data * quirk = get_monitor_quirks(dref->mmid);
+   bool combined_write_read = I2C_Combined_Write_Read;
+   if (quirk && (quirk->quirk_type & MQ_COMBINED_WRITE_READ_OK))
+      combined_write_read = true;
+   if (quirk && (quirk->quirk_type & MQ_SEPARATE_WRITE_READ))
+      combined_write_read = false;
+   if (combined_write_read)
+      dref->flags |= DREF_I2C_COMBINED_WRITE_READ;
+   if (quirk && quirk->sleep_multiplier > 0 && dref->io_settings.sleep_multiplier == 0)
+      dref->io_settings.sleep_multiplier = quirk->sleep_multiplier;
+   return dref;
+}
+
+
+//
+// Targeted display resolution
+//
+// Most library clients address a single known monitor.  Before displays
+// have been detected, an identifier that specifies an I2C bus number, or an
+// EDID whose bus can be found from the DRM connectors in sysfs, is resolved
+// by probing only that bus.  Global detection is deferred until a client
+// needs the full display list.  It then adopts the Display_Refs already
+// created, so that they remain valid.  Display numbers are only assigned by
+// global detection, so until then a targeted Display_Ref has dispno
+// DISPNO_NOT_SET.
+//
+
+/** Finds the I2C bus of the display having an EDID, using the DRM
+ *  connectors in sysfs.
+ *
+ *  @param  edidbytes  128 byte EDID
+ *  @return bus number, -1 if not found
+ */
+static int
+find_busno_by_edid_in_sysfs(Byte * edidbytes) {
+   int result = -1;
+   GPtrArray * connectors = get_sys_drm_connectors(false);
+   for (int ndx = 0; connectors && ndx < connectors->len; ndx++) {
+      Sys_Drm_Connector * cur = g_ptr_array_index(connectors, ndx);
+      if (cur->i2c_busno >= 0 && cur->edid_size >= 128 &&
+          memcmp(cur->edid_bytes, edidbytes, 128) == 0)
+      {
+         result = cur->i2c_busno;
+         break;
+      }
+   }
+   return result;
+}
+
+
+// Must be called with #targeted_displays_mutex held
+static Display_Ref *
+find_targeted_display(int busno) {
+   for (int ndx = 0; targeted_displays && ndx < targeted_displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(targeted_displays, ndx);
+      if (dref->io_path.path.i2c_busno == busno)
+         return dref;
+   }
+   return NULL;
+}
+
+
+/** Resolves a #Display_Identifier by probing only the I2C bus it
+ *  designates, if displays have not yet been detected.
+ *
+ *  @param  did  display identifier
+ *  @return #Display_Ref of a display with working DDC communication,
+ *          NULL if the identifier does not designate a single bus, displays
+ *          have already been detected, or the display was not found, in
+ *          which case the caller performs normal resolution
+ */
+Display_Ref *
+ddc_get_targeted_display_ref(Display_Identifier * did) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "did=%s", did_repr(did));
+   Display_Ref * dref = NULL;
+   int busno = -1;
+   if (!ddc_displays_already_detected()) {
+      if (did->id_type == DISP_ID_BUSNO)
+         busno = did->busno;
+      else if (did->id_type == DISP_ID_EDID)
+         busno = find_busno_by_edid_in_sysfs(did->edidbytes);
+   }
+
+   if (busno >= 0) {
+      g_mutex_lock(&display_detection_mutex);
+      if (!all_displays) {
+         g_mutex_lock(&targeted_displays_mutex);
+         dref = find_targeted_display(busno);
+         g_mutex_unlock(&targeted_displays_mutex);
+         if (!dref) {
+            I2C_Bus_Info * businfo = i2c_detect_single_bus(busno);
+            if ( businfo && (businfo->flags & I2C_BUS_ADDR_0X50) && businfo->edid &&
+                 (did->id_type != DISP_ID_EDID || memcmp(businfo->edid->bytes, did->edidbytes, 128) == 0) )
+            {
+               dref = create_i2c_display_ref(businfo);
+               if (ddc_initial_checks_by_dref(dref)) {
+                  dref->dispno = DISPNO_NOT_SET;
+                  g_mutex_lock(&targeted_displays_mutex);
+                  if (!targeted_displays)
+                     targeted_displays = g_ptr_array_new();
+                  g_ptr_array_add(targeted_displays, dref);
+                  g_mutex_unlock(&targeted_displays_mutex);
+                  businfo = NULL;    // now referenced by dref
+               }
+               else {
+                  dref->flags |= DREF_TRANSIENT;
+                  free_display_ref(dref);
+                  dref = NULL;
+               }
+            }
+            if (businfo)
+               i2c_free_bus_info(businfo);
+         }
+      }
+      g_mutex_unlock(&display_detection_mutex);
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "busno=%d, returning %s", busno, dref_repr_t(dref));
+   return dref;
+}
+
+
+/** Creates the #Display_Ref for a bus found by global detection, reusing
+ *  the one created by targeted resolution, if any.
+ *
+ *  Must be called with #display_detection_mutex held.
+ *
+ *  @param  businfo  bus found by global detection
+ *  @return #Display_Ref
+ */
+static Display_Ref *
+adopt_or_create_i2c_display_ref(I2C_Bus_Info * businfo) {
+   g_mutex_lock(&targeted_displays_mutex);
+   Display_Ref * dref = find_targeted_display(businfo->busno);
+   if (dref) {
+      if (memcmp(dref->pedid->bytes, businfo->edid->bytes, 128) == 0) {
+         // the targeted probe's bus info may still be in use by an open display
+         if (!retired_bus_infos)
+            retired_bus_infos = g_ptr_array_new();
+         g_ptr_array_add(retired_bus_infos, dref->detail);
+         dref->detail = businfo;
+         dref->pedid  = businfo->edid;
+         g_ptr_array_remove(targeted_displays, dref);
+      }
+      else {
+         dref = NULL;   // monitor changed, retired below
+      }
+   }
+   g_mutex_unlock(&targeted_displays_mutex);
+   if (!dref)
+      dref = create_i2c_display_ref(businfo);
+   return dref;
+}
+
+
+/** Retires targeted Display_Refs that global detection did not adopt.
+ *
+ *  Must be called with #display_detection_mutex held.
+ */
+static void
+retire_targeted_displays() {
+   g_mutex_lock(&targeted_displays_mutex);
+   if (targeted_displays) {
+      if (!retired_displays)
+         retired_displays = g_ptr_array_new();
+      if (!retired_bus_infos)
+         retired_bus_infos = g_ptr_array_new();
+      for (int ndx = 0; ndx < targeted_displays->len; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(targeted_displays, ndx);
+         dref->dispno = DISPNO_REMOVED;
+         g_ptr_array_add(retired_displays, dref);
+         g_ptr_array_add(retired_bus_infos, dref->detail);
+      }
+      g_ptr_array_free(targeted_displays, true);
+      targeted_displays = NULL;
+   }
+   g_mutex_unlock(&targeted_displays_mutex);
+}
+
+
+#ifdef USE_USB
+/* Output settings of the thread calling ddc_detect_all_displays(),
+ * applied to the USB detection thread */
+typedef struct {
+   FILE *              fout;
+   FILE *              ferr;
+   DDCA_Output_Level   output_level;
+} Usb_Detection_Thread_Data;
+
+
+static gpointer
+usb_detection_thread(gpointer data) {
+   Usb_Detection_Thread_Data * td = data;
+   set_fout(td->fout);
+   set_ferr(td->ferr);
+   set_output_level(td->output_level);
+   free(td);
+   return get_usb_monitor_list();
+}
+#endif
+
+
 /** Detects all connected displays by querying the I2C and USB subsystems.
+ *
+ *  The USB monitors are probed on a separate thread while the I2C buses
+ *  are checked.  I2C displays precede USB displays in the result.
  *
  *  @param  open_errors_loc where to return address of #GPtrArray of #Bus_Open_Error
  *  @return array of #Display_Ref
@@ -584,24 +1184,31 @@ ddc_detect_all_displays(GPtrArray ** i2c_open_errors_loc) {
    GPtrArray * bus_open_errors = g_ptr_array_new();
    GPtrArray * display_list = g_ptr_array_new();
 
+#ifdef USE_USB
+   // USB devices are separate hardware, probe them while the I2C buses are checked
+   GThread * usb_thread = NULL;
+   if (detect_usb_displays) {
+      Usb_Detection_Thread_Data * td = calloc(1, sizeof(Usb_Detection_Thread_Data));
+      td->fout = fout();
+      td->ferr = ferr();
+      td->output_level = get_output_level();
+      usb_thread = g_thread_new("usb_detection", usb_detection_thread, td);
+   }
+#endif
+
+   // if the cached results are still valid, the buses are not probed
+   // EDID-only detection neither uses nor saves the cache, which records DDC checks
+   GArray * cached_checks = (edid_only_detection) ? NULL : ddc_restore_cached_detection();
    int busct = i2c_detect_buses();
    DBGMSF(debug, "i2c_detect_buses() returned: %d", busct);
+   i2c_set_probe_hints(NULL);
    uint busndx = 0;
    for (busndx=0; busndx < busct; busndx++) {
       I2C_Bus_Info * businfo = i2c_get_bus_info_by_index(busndx);
       if ( (businfo->flags & I2C_BUS_ADDR_0X50)  && businfo->edid ) {
-         Display_Ref * dref = create_bus_display_ref(businfo->busno);
-         dref->dispno = DISPNO_INVALID;   // -1, guilty until proven innocent
-         dref->pedid = businfo->edid;    // needed?
-         dref->mmid  = monitor_model_key_new(
-                          dref->pedid->mfg_id,
-                          dref->pedid->model_name,
-                          dref->pedid->product_code);
-
-         // drec->detail.bus_detail = businfo;
-         dref->detail = businfo;
-         dref->flags |= DREF_DDC_IS_MONITOR_CHECKED;
-         dref->flags |= DREF_DDC_IS_MONITOR;
+         Display_Ref * dref = adopt_or_create_i2c_display_ref(businfo);
+         if (cached_checks && !(dref->flags & DREF_DDC_COMMUNICATION_CHECKED))
+            ddc_apply_cached_display_check(cached_checks, dref);
          g_ptr_array_add(display_list, dref);
       }
       else if ( !(businfo->flags & I2C_BUS_ACCESSIBLE) ) {
@@ -612,10 +1219,11 @@ ddc_detect_all_displays(GPtrArray ** i2c_open_errors_loc) {
          g_ptr_array_add(bus_open_errors, boe);
       }
    }
+   retire_targeted_displays();
 
 #ifdef USE_USB
-   if (detect_usb_displays) {
-      GPtrArray * usb_monitors = get_usb_monitor_list();  // array of USB_Monitor_Info
+   if (usb_thread) {
+      GPtrArray * usb_monitors = g_thread_join(usb_thread);  // array of USB_Monitor_Info
       // DBGMSF(debug, "Found %d USB displays", usb_monitors->len);
       for (int ndx=0; ndx<usb_monitors->len; ndx++) {
          Usb_Monitor_Info  * curmon = g_ptr_array_index(usb_monitors,ndx);
@@ -654,34 +1262,12 @@ ddc_detect_all_displays(GPtrArray ** i2c_open_errors_loc) {
    }
 #endif
 
-   // verbose output is distracting within scans
-   // saved and reset here so that async threads are not adjusting output level
-   DDCA_Output_Level olev = get_output_level();
-   if (olev == DDCA_OL_VERBOSE)
-      set_output_level(DDCA_OL_NORMAL);
-
-   DBGMSF(debug, "display_list->len=%d, async_threshold=%d",
-                 display_list->len, async_threshold);
-   if (display_list->len >= async_threshold)
-      ddc_async_scan(display_list);
-   else
-      ddc_non_async_scan(display_list);
-
-   if (olev == DDCA_OL_VERBOSE)
-      set_output_level(olev);
-
-   // assign display numbers
-   for (int ndx = 0; ndx < display_list->len; ndx++) {
-      Display_Ref * dref = g_ptr_array_index(display_list, ndx);
-      TRACED_ASSERT( memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0 );
-      if (dref->flags & DREF_DDC_COMMUNICATION_WORKING)
-         dref->dispno = ++dispno_max;
-      else if (dref->flags & DREF_DDC_BUSY)
-         dref->dispno = DISPNO_BUSY;
-      else {
-         dref->dispno = DISPNO_INVALID;   // -1;
-      }
-   }
+   check_and_number_displays(display_list);
+
+   if (cached_checks)
+      g_array_free(cached_checks, true);
+   else if (!edid_only_detection)
+      ddc_save_detection_cache(display_list);
 
    filter_phantom_displays(display_list);
 
@@ -713,9 +1299,18 @@ void
 ddc_ensure_displays_detected() {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
-   if (!all_displays) {
-      // i2c_detect_buses();  // called in ddc_detect_all_displays()
-      all_displays = ddc_detect_all_displays(&display_open_errors);
+   if (!ddc_displays_already_detected()) {
+      g_mutex_lock(&display_detection_mutex);
+      if (!all_displays) {
+         // i2c_detect_buses();  // called in ddc_detect_all_displays()
+         RECORD_STARTUP_PHASE("display detection",
+               publish_display_list(ddc_detect_all_displays(&display_open_errors)) );
+         ddc_start_capabilities_prefetch(all_displays);
+#ifdef BUILD_SHARED_LIB
+         ddc_ensure_watch_displays_started();
+#endif
+      }
+      g_mutex_unlock(&display_detection_mutex);
    }
    DBGTRC_DONE(debug, TRACE_GROUP,
                "all_displays=%p, all_displays has %d displays",
@@ -723,58 +1318,396 @@ ddc_ensure_displays_detected() {
 }
 
 
-/** Discards all detected displays.
+static gpointer
+progressive_detection_thread(gpointer data) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+   Detection_Progress * progress = data;
+   apply_worker_thread_sched();
+
+   ddc_ensure_displays_detected();
+
+   g_mutex_lock(&detection_progress_mutex);
+   detection_progress = NULL;
+   g_mutex_unlock(&detection_progress_mutex);
+
+   // report the displays that were detected by another thread, or that
+   // had already been detected
+   GPtrArray * snapshot = ddc_get_displays_snapshot();
+   for (int ndx = 0; ndx < snapshot->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(snapshot, ndx);
+      if (dref->dispno > 0 && !gaux_ptr_array_find_with_equal_func(progress->reported, dref, g_direct_equal, NULL))
+         progress->func(dref);
+   }
+   ddc_free_displays_snapshot(snapshot);
+   progress->func(NULL);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Reported %d displays during checks", progress->reported->len);
+   g_ptr_array_free(progress->reported, true);
+   free(progress);
+   return NULL;
+}
+
+
+/** Starts display detection in a background thread, reporting each display
+ *  as soon as DDC communication with it has been verified.
  *
- *  - All open displays are closed
- *  - The list of open displays in #all_displays is discarded
- *  - The list of errors in #display_open_errors is discarded
- *  - The list of detected I2C buses is discarded
- *  - The USB monitor list is discarded
+ *  **func** is called with each valid display, on the thread that checked
+ *  it, while other displays are still being checked.  The #Display_Ref can
+ *  be opened at once, but its display number is assigned only once
+ *  detection is complete.  **func** is then called with NULL.
+ *
+ *  If displays have already been detected, **func** is called for each
+ *  valid display and then with NULL, from the background thread.
+ *
+ *  @param  func  function to call
+ *  @retval DDCRC_OK                 detection started
+ *  @retval DDCRC_INVALID_OPERATION  a progressive detection is already in progress
  */
-void
-ddc_discard_detected_displays() {
+DDCA_Status
+ddc_start_display_detection(DDCA_Display_Detection_Callback_Func func) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "func=%p", func);
+   DDCA_Status ddcrc = 0;
+
+   g_mutex_lock(&detection_progress_mutex);
+   if (detection_progress) {
+      ddcrc = DDCRC_INVALID_OPERATION;
+   }
+   else {
+      detection_progress = calloc(1, sizeof(Detection_Progress));
+      detection_progress->func = func;
+      detection_progress->reported = g_ptr_array_new();
+      g_thread_unref(g_thread_new("progressive_detection",
+                                  progressive_detection_thread, detection_progress));
+   }
+   g_mutex_unlock(&detection_progress_mutex);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Returns the generation number of the display list.
+ *
+ *  The number changes whenever displays are detected, redetected or
+ *  discarded, so a caller can tell whether information it obtained
+ *  earlier is still current.  It is 0 only before displays are first
+ *  detected.
+ */
+uint32_t
+ddc_get_display_list_generation() {
+   return __atomic_load_n(&display_list_generation, __ATOMIC_ACQUIRE);
+}
+
+
+/** Implements #ddc_discard_detected_displays().
+ *  Must be called with #display_detection_mutex held.
+ */
+static void
+discard_detected_displays() {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
    // grab locks to prevent any opens?
+   ddc_wait_capabilities_prefetch(NULL);
+   ddc_discard_model_capabilities();
    ddc_close_all_displays();
 #ifdef USE_USB
    discard_usb_monitor_list();
 #endif
    if (all_displays) {
-      for (int ndx = 0; ndx < all_displays->len; ndx++) {
-         Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
+      GPtrArray * old_list = g_ptr_array_ref(all_displays);
+      publish_display_list(NULL);
+      g_mutex_lock(&deferred_drefs_mutex);
+      for (int ndx = 0; ndx < old_list->len; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(old_list, ndx);
          dref->flags |= DREF_TRANSIENT;  // hack to allow all Display References to be freed
 #ifndef NDEBUG
-         DDCA_Status ddcrc = free_display_ref(dref);
-         TRACED_ASSERT(ddcrc==0);
+         if (g_atomic_int_get(&snapshots_outstanding) > 0) {
+            // freed when the last snapshot is released
+            if (!deferred_drefs)
+               deferred_drefs = g_ptr_array_new();
+            g_ptr_array_add(deferred_drefs, dref);
+         }
+         else {
+            DDCA_Status ddcrc = free_display_ref(dref);
+            TRACED_ASSERT(ddcrc==0);
+         }
 #endif
       }
-      g_ptr_array_free(all_displays, true);
-      all_displays = NULL;
+      g_mutex_unlock(&deferred_drefs_mutex);
+      g_ptr_array_unref(old_list);
       if (display_open_errors) {
          g_ptr_array_free(display_open_errors, true);
          display_open_errors = NULL;
       }
    }
+   retire_targeted_displays();
+   if (retired_displays) {
+      for (int ndx = 0; ndx < retired_displays->len; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(retired_displays, ndx);
+         dref->flags |= DREF_TRANSIENT;
+         free_display_ref(dref);
+      }
+      g_ptr_array_free(retired_displays, true);
+      retired_displays = NULL;
+   }
+   if (retired_bus_infos) {
+      for (int ndx = 0; ndx < retired_bus_infos->len; ndx++)
+         i2c_free_bus_info(g_ptr_array_index(retired_bus_infos, ndx));
+      g_ptr_array_free(retired_bus_infos, true);
+      retired_bus_infos = NULL;
+   }
    free_sys_drm_connectors();
+   sysfs_i2c_reset_bus_attrs();
    i2c_discard_buses();
    DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
 
 
+/** Discards all detected displays.
+ *
+ *  - All open displays are closed
+ *  - The list of open displays in #all_displays is discarded
+ *  - The list of errors in #display_open_errors is discarded
+ *  - The list of detected I2C buses is discarded
+ *  - The USB monitor list is discarded
+ *
+ *  #Display_Ref instances referenced by an outstanding snapshot are freed
+ *  when the last snapshot is released.
+ */
 void
+ddc_discard_detected_displays() {
+   g_mutex_lock(&display_detection_mutex);
+   discard_detected_displays();
+   g_mutex_unlock(&display_detection_mutex);
+}
+
+
+/** Records the state of each DRM connector, for detecting which connectors
+ *  changed between detections.
+ *
+ *  @return hash table of connector name -> "busno edid"
+ */
+static GHashTable *
+snapshot_drm_connectors() {
+   GHashTable * snapshot = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+   GPtrArray * connectors = get_sys_drm_connectors(false);
+   for (int ndx = 0; connectors && ndx < connectors->len; ndx++) {
+      Sys_Drm_Connector * cur = g_ptr_array_index(connectors, ndx);
+      bool has_edid = cur->status && streq(cur->status, "connected") && cur->edid_size >= 128;
+      char * state = g_strdup_printf("%d %s", cur->i2c_busno,
+                        (has_edid) ? hexstring3_t(cur->edid_bytes, 128, "", 1, false) : "-");
+      g_hash_table_insert(snapshot, g_strdup(cur->connector_name), state);
+   }
+   return snapshot;
+}
+
+
+static void
+insert_connector_busno(Bit_Set_256 * busnos, const char * state) {
+   int busno = -1;
+   if (state && sscanf(state, "%d", &busno) == 1 && busno >= 0 && busno < 256)
+      *busnos = bs256_insert(*busnos, busno);
+}
+
+
+/** Determines which I2C buses need to be probed again.
+ *
+ *  A bus is affected if its DRM connector was added, removed, or its EDID
+ *  changed, if the /dev/i2c device appeared or disappeared, or if it has
+ *  a display but no DRM connector, so that changes cannot be recognized.
+ *
+ *  @param  prev  connector snapshot before redetection
+ *  @param  cur   connector snapshot now
+ *  @return set of bus numbers
+ */
+static Bit_Set_256
+find_changed_buses(GHashTable * prev, GHashTable * cur) {
+   bool debug = false;
+   Bit_Set_256 changed = EMPTY_BIT_SET_256;
+   Bit_Set_256 connector_buses = EMPTY_BIT_SET_256;
+
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, prev);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      char * cur_state = g_hash_table_lookup(cur, key);
+      if (!cur_state || !streq(cur_state, value)) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Connector %s changed or removed", (char*) key);
+         insert_connector_busno(&changed, value);
+         insert_connector_busno(&changed, cur_state);
+      }
+   }
+   g_hash_table_iter_init(&iter, cur);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      insert_connector_busno(&connector_buses, value);
+      if (!g_hash_table_contains(prev, key)) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Connector %s added", (char*) key);
+         insert_connector_busno(&changed, value);
+      }
+   }
+
+   Bit_Set_256 current_buses = EMPTY_BIT_SET_256;
+   Byte_Value_Array busnos = i2c_get_device_numbers();
+   for (int ndx = 0; ndx < bva_length(busnos); ndx++) {
+      int busno = bva_get(busnos, ndx);
+      current_buses = bs256_insert(current_buses, busno);
+      if (!i2c_find_bus_info_by_busno(busno) && !bs256_contains(i2c_get_nondisplay_buses(), busno))
+         changed = bs256_insert(changed, busno);           // new /dev/i2c device
+   }
+   bva_free(busnos);
+   // buses without monitors that were removed
+   changed = bs256_or(changed, bs256_and_not(i2c_get_nondisplay_buses(), current_buses));
+   int busct = i2c_detect_buses();      // already detected, returns count
+   for (int ndx = 0; ndx < busct; ndx++) {
+      I2C_Bus_Info * businfo = i2c_get_bus_info_by_index(ndx);
+      if (!bs256_contains(current_buses, businfo->busno))
+         changed = bs256_insert(changed, businfo->busno);  // device removed
+      else if (businfo->edid && !bs256_contains(connector_buses, businfo->busno))
+         changed = bs256_insert(changed, businfo->busno);  // cannot tell if changed
+   }
+
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "changed buses: %s", bs256_to_string_decimal(changed, "", " "));
+   return changed;
+}
+
+
+/** Updates the detected displays, probing only the I2C buses whose
+ *  connectors changed.
+ *
+ *  The #Display_Ref for each unchanged display remains valid.  A #Display_Ref
+ *  for a display that was removed or changed is marked #DISPNO_REMOVED and
+ *  removed from the list of detected displays, but is not freed until the
+ *  displays are discarded, so that clients holding it do not reference freed
+ *  memory.
+ *
+ *  The updated list is built as a copy of the current list, and published
+ *  when complete.
+ *
+ *  @return true if the update was performed,
+ *          false if full detection is required
+ */
+static bool
+ddc_redetect_changed_displays() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   if (!all_displays || detect_usb_displays) {
+      DBGTRC_DONE(debug, TRACE_GROUP, "Returning false. Incremental redetection not possible");
+      return false;
+   }
+   ddc_close_pooled_fds();          // device files may no longer be valid
+   GHashTable * prev = snapshot_drm_connectors();
+   get_sys_drm_connectors(true);   // rescan
+   GHashTable * cur = snapshot_drm_connectors();
+   if (g_hash_table_size(prev) == 0 && g_hash_table_size(cur) == 0) {
+      // no DRM connectors, changes cannot be recognized
+      g_hash_table_destroy(prev);
+      g_hash_table_destroy(cur);
+      DBGTRC_DONE(debug, TRACE_GROUP, "Returning false. No DRM connectors");
+      return false;
+   }
+   Bit_Set_256 changed = find_changed_buses(prev, cur);
+   g_hash_table_destroy(prev);
+   g_hash_table_destroy(cur);
+
+   if (!retired_displays)
+      retired_displays = g_ptr_array_new();
+   if (!retired_bus_infos)
+      retired_bus_infos = g_ptr_array_new();
+
+   GPtrArray * new_list = g_ptr_array_sized_new(all_displays->len);
+   for (int ndx = 0; ndx < all_displays->len; ndx++)
+      g_ptr_array_add(new_list, g_ptr_array_index(all_displays, ndx));
+
+   GPtrArray * new_drefs = g_ptr_array_new();
+   for (int busno = 0; busno < 256; busno++) {
+      if (!bs256_contains(changed, busno))
+         continue;
+      for (int ndx = new_list->len-1; ndx >= 0; ndx--) {
+         Display_Ref * dref = g_ptr_array_index(new_list, ndx);
+         if (dref->io_path.io_mode == DDCA_IO_I2C && dref->io_path.path.i2c_busno == busno) {
+            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Retiring %s", dref_repr_t(dref));
+            dref->dispno = DISPNO_REMOVED;
+            g_ptr_array_remove_index(new_list, ndx);
+            g_ptr_array_add(retired_displays, dref);
+         }
+      }
+      I2C_Bus_Info * old_businfo = i2c_detach_bus_info(busno);
+      if (old_businfo)
+         g_ptr_array_add(retired_bus_infos, old_businfo);
+      I2C_Bus_Info * businfo = i2c_add_bus(busno);   // NULL if device no longer exists
+      if (businfo && (businfo->flags & I2C_BUS_ADDR_0X50) && businfo->edid)
+         g_ptr_array_add(new_drefs, create_i2c_display_ref(businfo));
+   }
+
+   check_and_number_displays(new_drefs);
+   for (int ndx = 0; ndx < new_drefs->len; ndx++)
+      g_ptr_array_add(new_list, g_ptr_array_index(new_drefs, ndx));
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%d displays added", new_drefs->len);
+   g_ptr_array_free(new_drefs, true);
+
+   // I2C open errors are recomputed from the current bus information
+   if (display_open_errors)
+      g_ptr_array_free(display_open_errors, true);
+   display_open_errors = NULL;
+   int busct = i2c_detect_buses();
+   for (int ndx = 0; ndx < busct; ndx++) {
+      I2C_Bus_Info * businfo = i2c_get_bus_info_by_index(ndx);
+      if ( !(businfo->flags & I2C_BUS_ACCESSIBLE) ) {
+         if (!display_open_errors)
+            display_open_errors = g_ptr_array_new();
+         Bus_Open_Error * boe = calloc(1, sizeof(Bus_Open_Error));
+         boe->io_mode = DDCA_IO_I2C;
+         boe->devno = businfo->busno;
+         boe->error = businfo->open_errno;
+         g_ptr_array_add(display_open_errors, boe);
+      }
+   }
+
+   filter_phantom_displays(new_list);
+   if (!edid_only_detection)
+      ddc_save_detection_cache(new_list);
+   publish_display_list(new_list);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning true");
+   return true;
+}
+
+
+/** Redetects displays.
+ *
+ *  If possible, only the I2C buses whose DRM connectors changed are probed,
+ *  and the existing #Display_Ref instances for other displays remain valid.
+ *  Otherwise all displays are discarded and detected again.
+ *
+ *  @return true if only changed buses were probed,
+ *          false if all #Display_Ref instances were freed
+ */
+bool
 ddc_redetect_displays() {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "all_displays=%p", all_displays);
-   ddc_discard_detected_displays();
-   // i2c_detect_buses(); // called in ddc_detect_all_displays()
-   all_displays = ddc_detect_all_displays(&display_open_errors);
+   g_mutex_lock(&display_detection_mutex);
+   bool incremental = ddc_redetect_changed_displays();
+   if (!incremental) {
+      discard_detected_displays();
+      // i2c_detect_buses(); // called in ddc_detect_all_displays()
+      publish_display_list(ddc_detect_all_displays(&display_open_errors));
+   }
+   ddc_start_capabilities_prefetch(all_displays);
+#ifdef BUILD_SHARED_LIB
+   ddc_ensure_watch_displays_started();
+#endif
    if (debug) {
       ddc_dbgrpt_drefs("all_displays:", all_displays, 1);
       // dbgrpt_valid_display_refs(1);
    }
-   DBGTRC_DONE(debug, TRACE_GROUP, "all_displays=%p, all_displays->len = %d",
-                                   all_displays, all_displays->len);
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s. all_displays=%p, all_displays->len = %d",
+                                   sbool(incremental), all_displays, all_displays->len);
+   g_mutex_unlock(&display_detection_mutex);
+   return incremental;
 }
 
 
@@ -789,6 +1722,7 @@ ddc_is_valid_display_ref(Display_Ref * dref) {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%p -> %s", dref, dref_repr_t(dref));
    bool result = false;
+   g_rw_lock_reader_lock(&all_displays_lock);
    if (all_displays) {
       for (int ndx = 0; ndx < all_displays->len; ndx++) {
          Display_Ref* cur = g_ptr_array_index(all_displays, ndx);
@@ -801,6 +1735,21 @@ ddc_is_valid_display_ref(Display_Ref * dref) {
          }
       }
    }
+   g_rw_lock_reader_unlock(&all_displays_lock);
+   if (!result) {
+      // resolved by probing a single bus, not yet detected
+      g_mutex_lock(&targeted_displays_mutex);
+      result = targeted_displays &&
+               gaux_ptr_array_find_with_equal_func(targeted_displays, dref, g_direct_equal, NULL);
+      g_mutex_unlock(&targeted_displays_mutex);
+   }
+   if (!result) {
+      // reported by progressive detection, not yet published
+      g_mutex_lock(&detection_progress_mutex);
+      result = ready_displays &&
+               gaux_ptr_array_find_with_equal_func(ready_displays, dref, g_direct_equal, NULL);
+      g_mutex_unlock(&detection_progress_mutex);
+   }
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s. dref=%p, dispno=%d", sbool(result), dref, dref->dispno);
    return result;
 }
@@ -813,7 +1762,7 @@ ddc_is_valid_display_ref(Display_Ref * dref) {
 bool
 ddc_displays_already_detected()
 {
-   return all_displays;
+   return g_atomic_pointer_get(&all_displays);
 }
 
 
@@ -859,17 +1808,66 @@ ddc_is_usb_display_detection_enabled() {
 }
 
 
+/** Controls whether display detection reads only EDIDs.
+ *
+ *  With EDID-only detection, I2C buses are not probed for slave address
+ *  x37 and an EDID exposed in /sys/class/drm is used without opening the
+ *  bus, see #i2c_enable_edid_only_probing().  No initial checks are
+ *  performed, so the flags of the #Display_Ref do not include
+ *  #DREF_DDC_COMMUNICATION_CHECKED, and every display is assigned a
+ *  display number.
+ *
+ *  Must be called before any function that triggers display detection.
+ *
+ *  @param  onoff  true for EDID-only detection, false for full detection
+ *  @retval DDCRC_OK  normal
+ *  @retval DDCRC_INVALID_OPERATION function called after displays have been detected
+ */
+DDCA_Status
+ddc_enable_edid_only_detection(bool onoff) {
+   bool debug = false;
+   DBGMSF(debug, "Starting. onoff=%s", sbool(onoff));
+
+   DDCA_Status rc = DDCRC_OK;
+   if (ddc_displays_already_detected()) {
+      rc = DDCRC_INVALID_OPERATION;
+   }
+   else {
+      edid_only_detection = onoff;
+      i2c_enable_edid_only_probing(onoff);
+   }
+   DBGMSF(debug, "Done.     Returning %s", psc_name_code(rc));
+   return rc;
+}
+
+
+/** Indicates whether display detection reads only EDIDs
+ *
+ *  @return true/false
+ */
+bool
+ddc_is_edid_only_detection_enabled() {
+   return edid_only_detection;
+}
+
+
 void
 init_ddc_displays() {
    RTTI_ADD_FUNC(ddc_async_scan);
+   RTTI_ADD_FUNC(check_and_number_displays);
+   RTTI_ADD_FUNC(threaded_initial_checks);
    RTTI_ADD_FUNC(ddc_detect_all_displays);
    RTTI_ADD_FUNC(ddc_initial_checks_by_dh);
+   RTTI_ADD_FUNC(ddc_select_i2c_write_read_mode);
    RTTI_ADD_FUNC(ddc_initial_checks_by_dref);
    RTTI_ADD_FUNC(ddc_is_valid_display_ref);
    RTTI_ADD_FUNC(ddc_non_async_scan);
+   RTTI_ADD_FUNC(progressive_detection_thread);
+   RTTI_ADD_FUNC(ddc_start_display_detection);
+   RTTI_ADD_FUNC(ddc_redetect_changed_displays);
    RTTI_ADD_FUNC(ddc_redetect_displays);
+   RTTI_ADD_FUNC(find_changed_buses);
    RTTI_ADD_FUNC(filter_phantom_displays);
    RTTI_ADD_FUNC(is_phantom_display);
-   RTTI_ADD_FUNC(threaded_initial_checks_by_dref);
 }
 
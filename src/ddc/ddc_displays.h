@@ -22,10 +22,13 @@
 
 // Initial Checks
 void ddc_set_async_threshold(int threshold);
+void ddc_set_async_pool_size(int pool_size);
 bool ddc_initial_checks_by_dref(Display_Ref * dref);
 
 // Get Display Information
 GPtrArray * ddc_get_all_displays();  // returns GPtrArray of Display_Ref instances, including invalid displays
+GPtrArray * ddc_get_displays_snapshot();
+void        ddc_free_displays_snapshot(GPtrArray * snapshot);
 GPtrArray * ddc_get_filtered_displays(bool include_invalid_displays);
 GPtrArray * ddc_get_bus_open_errors();
 int ddc_get_display_count(bool include_invalid_displays);
@@ -33,11 +36,16 @@ int ddc_get_display_count(bool include_invalid_displays);
 
 // Display Detection
 void ddc_ensure_displays_detected();
+Display_Ref * ddc_get_targeted_display_ref(Display_Identifier * did);
+DDCA_Status ddc_start_display_detection(DDCA_Display_Detection_Callback_Func func);
 void ddc_discard_detected_displays();
-void ddc_redetect_displays();
+bool ddc_redetect_displays();
+uint32_t ddc_get_display_list_generation();
 bool ddc_displays_already_detected();
 DDCA_Status ddc_enable_usb_display_detection(bool onoff);
 bool ddc_is_usb_display_detection_enabled();
+DDCA_Status ddc_enable_edid_only_detection(bool onoff);
+bool ddc_is_edid_only_detection_enabled();
 void dbgrpt_bus_open_errors(GPtrArray * open_errors, int depth);
 bool ddc_is_valid_display_ref(Display_Ref * dref);
 
@@ -0,0 +1,462 @@
+/** @file ddc_displays_cache.c
+ *
+ *  Saves the results of display detection in a file, so that later
+ *  executions can skip probing the I2C buses and performing the initial
+ *  DDC checks on each display.
+ *
+ *  The file records, for each /dev/i2c device, the #I2C_Bus_Info settings,
+ *  the DRM connector that uses the bus, the EDID, and the results of the
+ *  initial checks.  Before the cached results are used they are validated
+ *  against the current system, using only inexpensive sysfs reads:
+ *  - the set of /dev/i2c devices must be unchanged
+ *  - each cached display must still be connected to the same DRM connector,
+ *    on the same bus, and the connector's EDID must be unchanged
+ *  - no other DRM connector may have a monitor connected
+ *
+ *  If any test fails, or a display has no DRM connector, full detection is
+ *  performed and the file is rewritten.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "public/ddcutil_types.h"
+
+#include "util/data_structures.h"
+#include "util/edid.h"
+#include "util/error_info.h"
+#include "util/file_util.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/xdg_util.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/rtti.h"
+#include "base/vcp_version.h"
+
+#include "i2c/i2c_bus_core.h"
+#include "i2c/i2c_strategy_dispatcher.h"
+#include "i2c/i2c_sysfs.h"
+
+#include "ddc/ddc_displays_cache.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+static bool displays_cache_enabled = false;    // default set in parser
+
+// flags set by ddc_initial_checks_by_dh() that are saved in the cache
+#define CACHED_DREF_FLAGS (DREF_DDC_COMMUNICATION_CHECKED                 | \
+                           DREF_DDC_COMMUNICATION_WORKING                 | \
+                           DREF_DDC_USES_NULL_RESPONSE_FOR_UNSUPPORTED    | \
+                           DREF_DDC_USES_MH_ML_SH_SL_ZERO_FOR_UNSUPPORTED | \
+                           DREF_DDC_USES_DDC_FLAG_FOR_UNSUPPORTED         | \
+                           DREF_DDC_DOES_NOT_INDICATE_UNSUPPORTED         | \
+                           DREF_I2C_COMBINED_WRITE_READ)
+
+
+/** Returns the name of the file that stores display detection results
+ *
+ *  \return name of file, normally $HOME/.cache/ddcutil/displays
+ */
+/* caller is responsible for freeing returned value */
+char * get_displays_cache_file_name() {
+   return xdg_cache_home_file("ddcutil", "displays");
+}
+
+
+static void delete_displays_cache_file() {
+   bool debug = false;
+   char * fn = get_displays_cache_file_name();
+   if (regular_file_exists(fn)) {
+      DBGMSF(debug, "Deleting file: %s", fn);
+      int rc = unlink(fn);
+      if (rc < 0) {
+         // should never occur
+         fprintf(fout(), "Unexpected error deleting file %s: %s\n",
+                         fn, strerror(errno));
+      }
+   }
+   free(fn);
+}
+
+
+/** Enables saving display detection results in a file.
+ *
+ *  \param  onoff   true to enable, false to disable
+ *  \return old setting
+ *
+ *  \remark
+ *  Disabling the cache deletes the file.
+ */
+bool enable_displays_cache(bool onoff) {
+   bool old = displays_cache_enabled;
+   displays_cache_enabled = onoff;
+   if (!onoff)
+      delete_displays_cache_file();
+   return old;
+}
+
+
+bool is_displays_cache_enabled() {
+   return displays_cache_enabled;
+}
+
+
+static Sys_Drm_Connector *
+find_connector_by_name(GPtrArray * connectors, const char * connector_name) {
+   for (int ndx = 0; ndx < connectors->len; ndx++) {
+      Sys_Drm_Connector * cur = g_ptr_array_index(connectors, ndx);
+      if (streq(cur->connector_name, connector_name))
+         return cur;
+   }
+   return NULL;
+}
+
+
+static inline bool
+connector_has_edid(Sys_Drm_Connector * connector) {
+   return connector->status && streq(connector->status, "connected") && connector->edid_size >= 128;
+}
+
+
+/** Checks whether saved bus information still describes the system.
+ *
+ *  \param  buses            #GPtrArray of #I2C_Bus_Info read from the cache
+ *  \param  connector_names  #GPtrArray of DRM connector names, parallel to **buses**
+ *  \return true if the cached information can be used, false if not
+ */
+static bool
+cache_matches_system(GPtrArray * buses, GPtrArray * connector_names) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "bus count=%d", buses->len);
+   bool ok = true;
+
+   Byte_Value_Array current_busnos = i2c_get_device_numbers();
+   if (bva_length(current_busnos) != buses->len) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Number of I2C buses changed");
+      ok = false;
+   }
+   for (int ndx = 0; ok && ndx < buses->len; ndx++) {
+      I2C_Bus_Info * businfo = g_ptr_array_index(buses, ndx);
+      if (bva_get(current_busnos, ndx) != businfo->busno) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "I2C bus numbers changed");
+         ok = false;
+      }
+   }
+   bva_free(current_busnos);
+
+   GPtrArray * connectors = get_sys_drm_connectors(false);
+   // each cached display must still be present, with the same EDID
+   for (int ndx = 0; ok && ndx < buses->len; ndx++) {
+      I2C_Bus_Info * businfo = g_ptr_array_index(buses, ndx);
+      if (!businfo->edid)
+         continue;
+      char * connector_name = g_ptr_array_index(connector_names, ndx);
+      Sys_Drm_Connector * connector = (connectors && connector_name)
+                                        ? find_connector_by_name(connectors, connector_name)
+                                        : NULL;
+      if (!connector                          ||
+          connector->i2c_busno != businfo->busno ||
+          !connector_has_edid(connector)      ||
+          memcmp(connector->edid_bytes, businfo->edid->bytes, 128) != 0)
+      {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Display on bus %d changed or cannot be validated",
+                                             businfo->busno);
+         ok = false;
+      }
+   }
+   // no monitor may have been connected elsewhere
+   for (int cndx = 0; ok && connectors && cndx < connectors->len; cndx++) {
+      Sys_Drm_Connector * connector = g_ptr_array_index(connectors, cndx);
+      if (!connector_has_edid(connector) || connector->i2c_busno < 0)
+         continue;
+      bool found = false;
+      for (int ndx = 0; ndx < buses->len && !found; ndx++) {
+         I2C_Bus_Info * businfo = g_ptr_array_index(buses, ndx);
+         found = businfo->busno == connector->i2c_busno && businfo->edid;
+      }
+      if (!found) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "New display on connector %s", connector->connector_name);
+         ok = false;
+      }
+   }
+
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, ok, "");
+   return ok;
+}
+
+
+/** Parses one line of the cache file.
+ *
+ *  \param  aline              line to parse
+ *  \param  check              where to return the initial check results
+ *  \param  connector_name_loc where to return the connector name, NULL if none
+ *  \return newly allocated #I2C_Bus_Info, NULL if the line is invalid
+ */
+static I2C_Bus_Info *
+parse_cache_line(char * aline, Cached_Display_Check * check, char ** connector_name_loc) {
+   int           busno;
+   unsigned int  bus_flags;
+   unsigned long functionality;
+   char          driver[64];
+   char          connector_name[64];
+   unsigned int  dref_flags;
+   int           vmajor, vminor;
+   char          edid_hex[520];
+
+   *connector_name_loc = NULL;
+   int ct = sscanf(aline, "%d %x %lx %63s %63s %x %d.%d %519s",
+                   &busno, &bus_flags, &functionality, driver, connector_name,
+                   &dref_flags, &vmajor, &vminor, edid_hex);
+   if (ct != 9 || busno < 0)
+      return NULL;
+
+   I2C_Bus_Info * businfo = i2c_new_bus_info(busno);
+   businfo->flags         = bus_flags;
+   businfo->functionality = functionality;
+   if (!streq(driver, "-"))
+      businfo->driver = strdup(driver);
+   if (!streq(edid_hex, "-")) {
+      Byte * edid_bytes = NULL;
+      int bytect = hhs_to_byte_array(edid_hex, &edid_bytes);
+      if (bytect == 128)
+         businfo->edid = create_interned_parsed_edid(edid_bytes, "CACHE");
+      free(edid_bytes);
+      if (!businfo->edid) {
+         i2c_free_bus_info(businfo);
+         return NULL;
+      }
+   }
+   if (!streq(connector_name, "-"))
+      *connector_name_loc = strdup(connector_name);
+
+   check->busno = busno;
+   check->dref_flags = dref_flags & CACHED_DREF_FLAGS;
+   check->vcp_version.major = vmajor;
+   check->vcp_version.minor = vminor;
+   return businfo;
+}
+
+
+/** Saves the cached probe results for buses whose connector is known, so
+ *  that buses that still show the same monitor need not be fully probed.
+ *
+ *  \param  buses            #GPtrArray of #I2C_Bus_Info read from the cache
+ *  \param  connector_names  #GPtrArray of DRM connector names, parallel to **buses**
+ */
+static void
+install_probe_hints(GPtrArray * buses, GPtrArray * connector_names) {
+   bool debug = false;
+   GHashTable * hints = i2c_new_probe_hints();
+   for (int ndx = 0; ndx < buses->len; ndx++) {
+      I2C_Bus_Info * businfo = g_ptr_array_index(buses, ndx);
+      char * connector_name  = g_ptr_array_index(connector_names, ndx);
+      if (businfo->driver && connector_name && !(businfo->flags & I2C_BUS_BUSY)) {
+         i2c_add_probe_hint(hints, businfo->driver, connector_name, businfo->flags,
+                            (businfo->edid) ? businfo->edid->bytes : NULL);
+      }
+   }
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%d probe hints", g_hash_table_size(hints));
+   i2c_set_probe_hints(hints);
+}
+
+
+/** Reads the cache file and, if it still describes the system, installs
+ *  the cached I2C bus information so that the buses are not probed.
+ *  Otherwise, the per-connector results are installed as probe hints,
+ *  see #i2c_set_probe_hints().
+ *
+ *  \return #GArray of #Cached_Display_Check, to be passed to
+ *          #ddc_apply_cached_display_check(),
+ *          NULL if the cache is disabled, absent, or no longer valid
+ *
+ *  \remark
+ *  The caller is responsible for freeing the returned array.
+ */
+GArray * ddc_restore_cached_detection() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "displays_cache_enabled=%s", sbool(displays_cache_enabled));
+
+   GArray * checks = NULL;
+   if (displays_cache_enabled) {
+      char * data_file_name = get_displays_cache_file_name();
+      GPtrArray * linearray = g_ptr_array_new_with_free_func(g_free);
+      Error_Info * errs = file_getlines_errinfo(data_file_name, linearray);
+      free(data_file_name);
+      if (errs) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s", errinfo_summary(errs));
+         errinfo_free(errs);
+      }
+      else {
+         bool ok = true;
+         GPtrArray * buses = g_ptr_array_new();
+         GPtrArray * connector_names = g_ptr_array_new_with_free_func(free);
+         checks = g_array_new(false, true, sizeof(Cached_Display_Check));
+         for (int ndx = 0; ok && ndx < linearray->len; ndx++) {
+            char * aline = strtrim(g_ptr_array_index(linearray, ndx));
+            if (strlen(aline) > 0 && aline[0] != '#') {
+               Cached_Display_Check check;
+               char * connector_name = NULL;
+               I2C_Bus_Info * businfo = parse_cache_line(aline, &check, &connector_name);
+               if (businfo) {
+                  g_ptr_array_add(buses, businfo);
+                  g_ptr_array_add(connector_names, connector_name);
+                  g_array_append_val(checks, check);
+               }
+               else {
+                  DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Invalid line %d: %s", ndx+1, aline);
+                  ok = false;
+               }
+            }
+            free(aline);
+         }
+
+         bool parsed = ok;
+         if (ok)
+            ok = cache_matches_system(buses, connector_names);
+         if (ok) {
+            i2c_restore_buses(buses);
+         }
+         else {
+            if (parsed)
+               install_probe_hints(buses, connector_names);
+            for (int ndx = 0; ndx < buses->len; ndx++)
+               i2c_free_bus_info(g_ptr_array_index(buses, ndx));
+            g_array_free(checks, true);
+            checks = NULL;
+         }
+         g_ptr_array_free(buses, true);
+         g_ptr_array_free(connector_names, true);
+      }
+      g_ptr_array_free(linearray, true);
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %p", checks);
+   return checks;
+}
+
+
+/** Sets the initial check results for a display from the cache, so that
+ *  the checks are not repeated.
+ *
+ *  \param  checks  array returned by #ddc_restore_cached_detection()
+ *  \param  dref    display reference
+ */
+void ddc_apply_cached_display_check(GArray * checks, Display_Ref * dref) {
+   bool debug = false;
+   if (dref->io_path.io_mode != DDCA_IO_I2C)
+      return;
+   for (int ndx = 0; ndx < checks->len; ndx++) {
+      Cached_Display_Check * check = &g_array_index(checks, Cached_Display_Check, ndx);
+      if (check->busno == dref->io_path.path.i2c_busno &&
+          (check->dref_flags & DREF_DDC_COMMUNICATION_CHECKED))
+      {
+         Dref_Flags cached_flags = check->dref_flags;
+         // the write/read mode measured by --i2c-auto-write-read is only reused in that mode
+         if (!I2C_Auto_Write_Read)
+            cached_flags &= ~DREF_I2C_COMBINED_WRITE_READ;
+         dref->flags |= cached_flags;
+         if (vcp_version_eq(dref->vcp_version_xdf, DDCA_VSPEC_UNQUERIED))  // may have been forced by --mccs
+            dref->vcp_version_xdf = check->vcp_version;
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "dref=%s, flags: %s",
+                         dref_repr_t(dref), interpret_dref_flags_t(dref->flags));
+         break;
+      }
+   }
+}
+
+
+/** Saves the results of display detection in the cache file.
+ *
+ *  Nothing is saved if a bus or display was busy, since the results of its
+ *  checks are incomplete.
+ *
+ *  \param  display_list  #GPtrArray of #Display_Ref
+ */
+void ddc_save_detection_cache(GPtrArray * display_list) {
+   bool debug = false;
+   if (!displays_cache_enabled)
+      return;
+   char * data_file_name = get_displays_cache_file_name();
+   DBGTRC_STARTING(debug, TRACE_GROUP, "data_file_name=%s", data_file_name);
+
+   bool busy = false;
+   int busct = i2c_detect_buses();    // already detected, returns count
+   for (int ndx = 0; ndx < busct && !busy; ndx++)
+      busy = i2c_get_bus_info_by_index(ndx)->flags & I2C_BUS_BUSY;
+   for (int ndx = 0; ndx < display_list->len && !busy; ndx++)
+      busy = ((Display_Ref*) g_ptr_array_index(display_list, ndx))->flags & DREF_DDC_BUSY;
+
+   if (busy) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Busy bus or display, not saving");
+      delete_displays_cache_file();
+   }
+   else {
+      FILE * fp = NULL;
+      fopen_mkdir(data_file_name, "w", ferr(), &fp);
+      if (fp) {
+         fprintf(fp, "# busno bus_flags functionality driver connector dref_flags vcp_version edid\n");
+         // in bus number order, including buses without monitors, which
+         // are retained only as numbers, see i2c_get_nondisplay_buses()
+         Bit_Set_256 nondisplay_buses = i2c_get_nondisplay_buses();
+         for (int busno = 0; busno < 256; busno++) {
+            if (bs256_contains(nondisplay_buses, busno)) {
+               Sys_Drm_Connector * connector = find_sys_drm_connector_by_busno(busno);
+               int ct = fprintf(fp, "%d %04x 0 - %s 0000 0.0 -\n",
+                      busno, I2C_BUS_NONDISPLAY_FLAGS,
+                      (connector) ? connector->connector_name : "-");
+               if (ct < 0) {
+                  SEVEREMSG("Error writing to file %s:%s", data_file_name, strerror(errno) );
+                  break;
+               }
+               continue;
+            }
+            I2C_Bus_Info * businfo = i2c_find_bus_info_by_busno(busno);
+            if (!businfo)
+               continue;
+            Display_Ref * dref = NULL;
+            for (int dndx = 0; dndx < display_list->len && !dref; dndx++) {
+               Display_Ref * cur = g_ptr_array_index(display_list, dndx);
+               if (cur->io_path.io_mode == DDCA_IO_I2C && cur->io_path.path.i2c_busno == businfo->busno)
+                  dref = cur;
+            }
+            Sys_Drm_Connector * connector = find_sys_drm_connector_by_busno(businfo->busno);
+            int ct = fprintf(fp, "%d %04x %lx %s %s %04x %d.%d %s\n",
+                   businfo->busno,
+                   businfo->flags,
+                   businfo->functionality,
+                   (businfo->driver) ? businfo->driver : "-",
+                   (connector) ? connector->connector_name : "-",
+                   (dref) ? dref->flags & CACHED_DREF_FLAGS : 0,
+                   (dref) ? dref->vcp_version_xdf.major : 0,
+                   (dref) ? dref->vcp_version_xdf.minor : 0,
+                   (businfo->edid) ? hexstring3_t(businfo->edid->bytes, 128, "", 1, false) : "-");
+            if (ct < 0) {
+               SEVEREMSG("Error writing to file %s:%s", data_file_name, strerror(errno) );
+               break;
+            }
+         }
+         fclose(fp);
+      }
+   }
+
+   free(data_file_name);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+void init_ddc_displays_cache() {
+   RTTI_ADD_FUNC(cache_matches_system);
+   RTTI_ADD_FUNC(ddc_restore_cached_detection);
+   RTTI_ADD_FUNC(ddc_apply_cached_display_check);
+   RTTI_ADD_FUNC(ddc_save_detection_cache);
+}
@@ -0,0 +1,34 @@
+/** @file ddc_displays_cache.h
+ *
+ *  Persistent cache of display detection results
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_DISPLAYS_CACHE_H_
+#define DDC_DISPLAYS_CACHE_H_
+
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+
+#include "base/displays.h"
+
+/** Initial check results for one display, as read from the cache */
+typedef struct {
+   int                     busno;
+   uint16_t                dref_flags;      // DREF_DDC_* flags set by initial checks
+   DDCA_MCCS_Version_Spec  vcp_version;
+} Cached_Display_Check;
+
+char * get_displays_cache_file_name();
+bool   enable_displays_cache(bool onoff);
+bool   is_displays_cache_enabled();
+
+GArray * ddc_restore_cached_detection();
+void     ddc_apply_cached_display_check(GArray * checks, Display_Ref * dref);
+void     ddc_save_detection_cache(GPtrArray * display_list);
+
+void     init_ddc_displays_cache();
+
+#endif /* DDC_DISPLAYS_CACHE_H_ */
@@ -50,6 +50,24 @@
 
 #include "ddc/ddc_dumpload.h"
 
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+static bool differential_loadvcp = false;
+
+
+/** Controls whether loadvcp writes only the values that differ from the
+ *  monitor's current values.
+ *
+ *  @param  onoff  true to enable, false to disable
+ *  @return prior setting
+ */
+bool ddc_enable_differential_loadvcp(bool onoff) {
+   bool old = differential_loadvcp;
+   differential_loadvcp = onoff;
+   return old;
+}
+
 
 /** Frees a #Dumpload_Data struct.  The underlying Vcp_Value_set is also freed.
  *
@@ -100,230 +118,215 @@ void dbgrpt_dumpload_data(Dumpload_Data * data, int depth) {
             _expl " at line %d: %s", linectr, line) );
 
 
-/** Given an array of strings stored in a GPtrArray,
- *  convert it a #Dumpload_Data struct.
+/** Parses one line of dumpload data.
  *
- *  @param   garray      array of strings
- *  @return  pointer to newly allocated Dumpload_Data struct, or
- *                NULL if the data is not valid.
- *                It is the responsibility of the caller to free this struct.
+ *  @param  data     #Dumpload_Data struct to which the line's value is added
+ *  @param  line     line, modified by trimming trailing blanks
+ *  @param  linectr  line number, for error messages
+ *  @param  errs     errors are added as causes of this #Error_Info
+ *  @return true if the line is valid, false if not
  */
-Error_Info *
-create_dumpload_data_from_g_ptr_array(
-      GPtrArray * garray,
-      Dumpload_Data ** dumpload_data_loc)
+static bool
+parse_dumpload_line(
+      Dumpload_Data * data,
+      char *          line,
+      int             linectr,
+      Error_Info *    errs)
 {
-   bool debug = false;
-   DBGMSF(debug, "Starting.");
-
-   Error_Info * errs = errinfo_new(DDCRC_BAD_DATA, __func__);
-   *dumpload_data_loc = NULL;
-
-   Dumpload_Data * data = calloc(1, sizeof(Dumpload_Data));
-#ifndef NDEBUG
-   bool valid_data = true;
-#endif
-   // default:
-   data->vcp_version.major = 2;
-   data->vcp_version.minor = 0;
-   data->vcp_values = vcp_value_set_new(15);      // 15 = initial size
-
+   bool    valid_data = true;
    int     ct;
-   int     linectr = 0;
-
-   while ( linectr < garray->len ) {
-      char *  line = NULL;
-      char    s0[32], s1[257], s2[16];
-      char *  head;
-      char *  rest;
-
-      line = g_ptr_array_index(garray,linectr);
-      linectr++;
-
-      *s0 = '\0'; *s1 = '\0'; *s2 = '\0';
-      head = line;
-      while (*head == ' ') head++;
-      ct = sscanf(head, "%31s %256s %15s", s0, s1, s2);
-      if (ct > 0 && *s0 != '*' && *s0 != '#') {
-         if (ct == 1) {
-            // printf("Invalid data at line %d: %s\n", linectr, line);
-            // Error_Info * err = errinfo_new2(
-            //                       DDCRC_BAD_DATA, __func__,
-            //                       "Invalid data at line %d: %s", linectr, line);
-            // errinfo_add_cause(errs, err);
-            ADD_DATA_ERROR("Invalid data");
-#ifndef NDEBUG
-            valid_data = false;
-#endif
+   char    s0[32], s1[257], s2[16];
+   char *  head;
+   char *  rest;
+
+   *s0 = '\0'; *s1 = '\0'; *s2 = '\0';
+   head = line;
+   while (*head == ' ') head++;
+   ct = sscanf(head, "%31s %256s %15s", s0, s1, s2);
+   if (ct > 0 && *s0 != '*' && *s0 != '#') {
+      if (ct == 1) {
+         // printf("Invalid data at line %d: %s\n", linectr, line);
+         // Error_Info * err = errinfo_new2(
+         //                       DDCRC_BAD_DATA, __func__,
+         //                       "Invalid data at line %d: %s", linectr, line);
+         // errinfo_add_cause(errs, err);
+         ADD_DATA_ERROR("Invalid data");
+         valid_data = false;
+      }
+      else {
+         rest = head + strlen(s0);;
+         while (*rest == ' ') rest++;
+         char * last = rest + strlen(rest) - 1;
+         // we already parsed a second token, so don't need to worry that last becomes < head
+         while (*last == ' ' || *last == '\n') {
+            *last-- = '\0';
          }
-         else {
-            rest = head + strlen(s0);;
-            while (*rest == ' ') rest++;
-            char * last = rest + strlen(rest) - 1;
-            // we already parsed a second token, so don't need to worry that last becomes < head
-            while (*last == ' ' || *last == '\n') {
-               *last-- = '\0';
-            }
-            // DBGMSG("rest=|%s|", rest );
-
-            if (streq(s0, "BUS")) {
-               // ignore
-               // ct = sscanf(s1, "%d", &data->busno);
-               // if (ct == 0) {
-               //    fprintf(stderr, "Invalid bus number at line %d: %s\n", linectr, line);
-               //    valid_data = false;
-               // }
-            }
-            else if (streq(s0, "PRODUCT_CODE")) {
-               int ival;
-               bool ok = str_to_int(s1, &ival, 10);
-               if (ok && ival >= 0 && ival <= 65535)
-                  data->product_code = (uint16_t) ival;
-#ifndef NDEBUG
-               else
-                  valid_data = false;
-#endif
-            }
-            else if (streq(s0, "EDID") || streq(s0, "EDIDSTR")) {
-               STRLCPY(data->edidstr, s1, sizeof(data->edidstr));
-            }
-            else if (streq(s0, "MFG_ID")) {
-               memcpy(data->mfg_id, s1, sizeof(data->mfg_id));
-            }
-            else if (streq(s0, "MODEL")) {
-               STRLCPY(data->model, rest, sizeof(data->model));
-            }
-            else if (streq(s0, "SN")) {
-               STRLCPY(data->serial_ascii, rest, sizeof(data->serial_ascii));
-            }
-            else if (streq(s0, "VCP_VERSION")) {
-               data->vcp_version = parse_vspec(s1);
-               // using VCP_SPEC_UNKNOWN as value when invalid,
-               // what if monitor had no version, so 0.0 was output?
-               if ( vcp_version_eq( data->vcp_version, DDCA_VSPEC_UNKNOWN) ) {
-                  // f0printf(ferr(), "Invalid VCP VERSION at line %d: %s\n", linectr, line);
-                  // errinfo_add_cause(
-                  //            errs,
-                  //            errinfo_new2(
-                  //                  DDCRC_BAD_DATA, __func__,
-                  //                  "Invalid VCP VERSION at line %d: %s\n", linectr, line) );
-                  ADD_DATA_ERROR("Invalid VCP VERSION");
-#ifndef NDEBUG
-                  valid_data = false;
-#endif
-               }
+         // DBGMSG("rest=|%s|", rest );
+
+         if (streq(s0, "BUS")) {
+            // ignore
+            // ct = sscanf(s1, "%d", &data->busno);
+            // if (ct == 0) {
+            //    fprintf(stderr, "Invalid bus number at line %d: %s\n", linectr, line);
+            //    valid_data = false;
+            // }
+         }
+         else if (streq(s0, "PRODUCT_CODE")) {
+            int ival;
+            bool ok = str_to_int(s1, &ival, 10);
+            if (ok && ival >= 0 && ival <= 65535)
+               data->product_code = (uint16_t) ival;
+            else
+               valid_data = false;
+         }
+         else if (streq(s0, "EDID") || streq(s0, "EDIDSTR")) {
+            STRLCPY(data->edidstr, s1, sizeof(data->edidstr));
+         }
+         else if (streq(s0, "MFG_ID")) {
+            memcpy(data->mfg_id, s1, sizeof(data->mfg_id));
+         }
+         else if (streq(s0, "MODEL")) {
+            STRLCPY(data->model, rest, sizeof(data->model));
+         }
+         else if (streq(s0, "SN")) {
+            STRLCPY(data->serial_ascii, rest, sizeof(data->serial_ascii));
+         }
+         else if (streq(s0, "VCP_VERSION")) {
+            data->vcp_version = parse_vspec(s1);
+            // using VCP_SPEC_UNKNOWN as value when invalid,
+            // what if monitor had no version, so 0.0 was output?
+            if ( vcp_version_eq( data->vcp_version, DDCA_VSPEC_UNKNOWN) ) {
+               // f0printf(ferr(), "Invalid VCP VERSION at line %d: %s\n", linectr, line);
+               // errinfo_add_cause(
+               //            errs,
+               //            errinfo_new2(
+               //                  DDCRC_BAD_DATA, __func__,
+               //                  "Invalid VCP VERSION at line %d: %s\n", linectr, line) );
+               ADD_DATA_ERROR("Invalid VCP VERSION");
+               valid_data = false;
             }
-            else if (streq(s0, "TIMESTAMP_TEXT")   ||
-                     streq(s0, "TIMESTAMP_MILLIS")
+         }
+         else if (streq(s0, "TIMESTAMP_TEXT")   ||
+                  streq(s0, "TIMESTAMP_MILLIS")
 
-                    ) {
-               // do nothing, just recognize valid field
+                 ) {
+            // do nothing, just recognize valid field
+         }
+         else if (streq(s0, "VCP")) {
+            if (ct != 3) {
+               // f0printf(ferr(), "Invalid VCP data at line %d: %s\n", linectr, line);
+               ADD_DATA_ERROR("Invalid VCP data");
+               valid_data = false;
             }
-            else if (streq(s0, "VCP")) {
-               if (ct != 3) {
-                  // f0printf(ferr(), "Invalid VCP data at line %d: %s\n", linectr, line);
-                  ADD_DATA_ERROR("Invalid VCP data");
-#ifndef NDEBUG
+            else {   // found feature id and value
+               Byte feature_id;
+               bool ok = hhs_to_byte_in_buf(s1, &feature_id);
+               if (!ok) {
+                  // f0printf(ferr(), "Invalid opcode at line %d: %s", linectr, s1);
+                  ADD_DATA_ERROR("Invalid  opcode");
                   valid_data = false;
-#endif
                }
-               else {   // found feature id and value
-                  Byte feature_id;
-                  bool ok = hhs_to_byte_in_buf(s1, &feature_id);
-                  if (!ok) {
-                     // f0printf(ferr(), "Invalid opcode at line %d: %s", linectr, s1);
-                     ADD_DATA_ERROR("Invalid  opcode");
-#ifndef NDEBUG
-                     valid_data = false;
-#endif
-                  }
-                  else {     // valid opcode
-                     DDCA_Any_Vcp_Value * valrec = NULL;
-                     // look up opcode, is it valid?
-
-                     // table values need special handling
-
-                     // Problem: without VCP version, can't look up feature in
-                     // VCP code table and definitively know if it's a table feature.
-                     // One solution: rework data structures to parse later
-                     // second solution: vcp version in dumpload data
-
-                     DDCA_Monitor_Model_Key mmk = monitor_model_key_value(
-                           data->mfg_id, data->model, data->product_code);
-
-                     Display_Feature_Metadata * dfm =
-                                              dyn_get_feature_metadata_by_mmk_and_vspec(
-                                                   feature_id,
-                                                   mmk,
-                                                   data->vcp_version,
-                                                   /*with_default=*/ true);
-                     bool is_table_feature = dfm->feature_flags & DDCA_NORMAL_TABLE;
-
-                     if (is_table_feature) {
-                        // s2 is hex string
-                        Byte * ba;
-                        int bytect =  hhs_to_byte_array(s2, &ba);
-                        if (bytect < 0) {
-                           // f0printf(ferr(),
-                           //          "Invalid hex string value for opcode at line %d: %s\n",
-                           //          linectr, line);
-                           ADD_DATA_ERROR("Invalid hex string value for opcode");
-#ifndef NDEBUG
-                           valid_data = false;
-#endif
-                        }
-                        else {
-                           valrec = create_table_vcp_value_by_bytes(
-                                 feature_id,
-                                 ba,
-                                 bytect);
-                           free(ba);
-                        }
+               else {     // valid opcode
+                  DDCA_Any_Vcp_Value * valrec = NULL;
+                  // look up opcode, is it valid?
+
+                  // table values need special handling
+
+                  // Problem: without VCP version, can't look up feature in
+                  // VCP code table and definitively know if it's a table feature.
+                  // One solution: rework data structures to parse later
+                  // second solution: vcp version in dumpload data
+
+                  DDCA_Monitor_Model_Key mmk = monitor_model_key_value(
+                        data->mfg_id, data->model, data->product_code);
+
+                  Display_Feature_Metadata * dfm =
+                                           dyn_get_feature_metadata_by_mmk_and_vspec(
+                                                feature_id,
+                                                mmk,
+                                                data->vcp_version,
+                                                /*with_default=*/ true);
+                  bool is_table_feature = dfm->feature_flags & DDCA_NORMAL_TABLE;
+
+                  if (is_table_feature) {
+                     // s2 is hex string
+                     Byte * ba;
+                     int bytect =  hhs_to_byte_array(s2, &ba);
+                     if (bytect < 0) {
+                        // f0printf(ferr(),
+                        //          "Invalid hex string value for opcode at line %d: %s\n",
+                        //          linectr, line);
+                        ADD_DATA_ERROR("Invalid hex string value for opcode");
+                        valid_data = false;
                      }
-                     else {   // non-table feature
-                        ushort feature_value;
-                        ct = sscanf(s2, "%hu", &feature_value);
-                        if (ct == 0) {
-                           // f0printf(ferr(), "Invalid value for opcode at line %d: %s\n", linectr, line);
-                           ADD_DATA_ERROR("Invalid value for opcode");
-#ifndef NDEBUG
-                           valid_data = false;
-#endif
-                        }
-                        else {
-                           // good opcode and value
-                           // TODO: opcode and value should be saved in local vars
-                           valrec = create_cont_vcp_value(
+                     else {
+                        valrec = create_table_vcp_value_by_bytes(
                               feature_id,
-                              0,   // max_val, unused for LOADVCP
-                              feature_value);
-                        }
-                     }   // non-table feature
-                     if (valrec) {
-                        data->vcp_value_ct++;
-                        vcp_value_set_add(data->vcp_values, valrec);
+                              ba,
+                              bytect);
+                        free(ba);
                      }
-                     dfm_free(dfm);
-                  } // valid opcode
-
-               } // found feature id and value
-            }  // VCP
-
-            else {
-               // f0printf(ferr(), "Unexpected field \"%s\" at line %d: %s\n", s0, linectr, line );
-               errinfo_add_cause(
-                          errs,
-                          errinfo_new2(
-                                DDCRC_BAD_DATA, __func__,
-                                "Unexpected field \"%s\" at line %d: %s", s0, linectr, line) );
-#ifndef NDEBUG
-               valid_data = false;
-#endif
-            }
-         }    // more than 1 field on line
-      }       // non-comment line
-   }          // one line of file
+                  }
+                  else {   // non-table feature
+                     ushort feature_value;
+                     ct = sscanf(s2, "%hu", &feature_value);
+                     if (ct == 0) {
+                        // f0printf(ferr(), "Invalid value for opcode at line %d: %s\n", linectr, line);
+                        ADD_DATA_ERROR("Invalid value for opcode");
+                        valid_data = false;
+                     }
+                     else {
+                        // good opcode and value
+                        // TODO: opcode and value should be saved in local vars
+                        valrec = create_cont_vcp_value(
+                           feature_id,
+                           0,   // max_val, unused for LOADVCP
+                           feature_value);
+                     }
+                  }   // non-table feature
+                  if (valrec) {
+                     data->vcp_value_ct++;
+                     vcp_value_set_add(data->vcp_values, valrec);
+                  }
+                  dfm_free(dfm);
+               } // valid opcode
+
+            } // found feature id and value
+         }  // VCP
 
+         else {
+            // f0printf(ferr(), "Unexpected field \"%s\" at line %d: %s\n", s0, linectr, line );
+            errinfo_add_cause(
+                       errs,
+                       errinfo_new2(
+                             DDCRC_BAD_DATA, __func__,
+                             "Unexpected field \"%s\" at line %d: %s", s0, linectr, line) );
+            valid_data = false;
+         }
+      }    // more than 1 field on line
+   }       // non-comment line
+   return valid_data;
+}
+
+
+static Dumpload_Data *
+new_dumpload_data() {
+   Dumpload_Data * data = calloc(1, sizeof(Dumpload_Data));
+   // default:
+   data->vcp_version.major = 2;
+   data->vcp_version.minor = 0;
+   data->vcp_values = vcp_value_set_new(15);      // 15 = initial size
+   return data;
+}
+
+
+static Error_Info *
+complete_dumpload_data(
+      Dumpload_Data *  data,
+      bool             valid_data,
+      Error_Info *     errs,
+      Dumpload_Data ** dumpload_data_loc)
+{
    assert( ( valid_data && errs->cause_ct == 0 ) ||
            (!valid_data && errs->cause_ct >  0) );
    if (errs->cause_ct == 0) {
@@ -331,15 +334,93 @@ create_dumpload_data_from_g_ptr_array(
       errs = NULL;
    }
    else {
-      if (data) {
-         free_dumpload_data(data);
-         data = NULL;
-      }
+      free_dumpload_data(data);
+      data = NULL;
    }
    *dumpload_data_loc = data;
    return errs;
 }
 
+
+/** Given an array of strings stored in a GPtrArray,
+ *  convert it a #Dumpload_Data struct.
+ *
+ *  @param   garray      array of strings
+ *  @param   dumpload_data_loc  where to return pointer to newly allocated
+ *                       Dumpload_Data struct, NULL if the data is not valid.
+ *                       It is the responsibility of the caller to free this struct.
+ *  @return  NULL if success, #Error_Info with a cause for each invalid line if not
+ */
+Error_Info *
+create_dumpload_data_from_g_ptr_array(
+      GPtrArray * garray,
+      Dumpload_Data ** dumpload_data_loc)
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting.");
+
+   Error_Info * errs = errinfo_new(DDCRC_BAD_DATA, __func__);
+   Dumpload_Data * data = new_dumpload_data();
+   bool valid_data = true;
+   for (int ndx = 0; ndx < garray->len; ndx++) {
+      if (!parse_dumpload_line(data, g_ptr_array_index(garray,ndx), ndx+1, errs))
+         valid_data = false;
+   }
+   return complete_dumpload_data(data, valid_data, errs, dumpload_data_loc);
+}
+
+
+/** Parses dumpload data directly from a buffer, e.g. a memory mapped
+ *  file, without first splitting it into an array of lines.
+ *
+ *  @param   buf         data, need not be null terminated
+ *  @param   bufsz       number of bytes in **buf**
+ *  @param   separator   character separating lines, normally '\n'
+ *  @param   dumpload_data_loc  where to return pointer to newly allocated
+ *                       Dumpload_Data struct, NULL if the data is not valid.
+ *                       It is the responsibility of the caller to free this struct.
+ *  @return  NULL if success, #Error_Info with a cause for each invalid line if not
+ */
+Error_Info *
+create_dumpload_data_from_buffer(
+      const char *     buf,
+      size_t           bufsz,
+      char             separator,
+      Dumpload_Data ** dumpload_data_loc)
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting. bufsz=%zu", bufsz);
+
+   Error_Info * errs = errinfo_new(DDCRC_BAD_DATA, __func__);
+   Dumpload_Data * data = new_dumpload_data();
+   bool valid_data = true;
+   char line[400];      // longest valid line is EDID
+   int linectr = 0;
+   const char * pos = buf;
+   const char * end = buf + bufsz;
+   while (pos < end) {
+      const char * eol = memchr(pos, separator, end-pos);
+      if (!eol)
+         eol = end;
+      size_t linesz = eol - pos;
+      linectr++;
+      if (linesz >= sizeof(line)) {
+         memcpy(line, pos, 40);    // shown in message
+         strcpy(line+40, "...");
+         ADD_DATA_ERROR("Line too long");
+         valid_data = false;
+      }
+      else {
+         memcpy(line, pos, linesz);
+         line[linesz] = '\0';
+         if (!parse_dumpload_line(data, line, linectr, errs))
+            valid_data = false;
+      }
+      pos = eol + 1;
+   }
+   return complete_dumpload_data(data, valid_data, errs, dumpload_data_loc);
+}
+
 #undef ADD_DATA_ERROR
 
 
@@ -350,7 +431,8 @@ create_dumpload_data_from_g_ptr_array(
  * @return  #Ddc_Error reflecting the first error, or NULL if no errors
  *
  * This function stops applying values on the first error encountered, and
- * returns the value of that error as its status code.
+ * returns the value of that error as its status code.  If write verification
+ * is enabled, the values are verified as a batch after all have been written.
  *
  * @remark
  * Consider not stopping on error, instead accumulate errors in Error_Info.
@@ -364,6 +446,8 @@ ddc_set_multiple(
    Error_Info *        ddc_excp = NULL;
    int value_ct = vcp_value_set_size(vset);
 
+   // verify all values once written, instead of each immediately after writing it
+   bool verify = ddc_set_verify_setvcp(false);
    int ndx;
    for (ndx=0; ndx < value_ct; ndx++) {
       DDCA_Any_Vcp_Value * vrec
@@ -388,11 +472,145 @@ ddc_set_multiple(
       }
 
    } // for loop
+   ddc_set_verify_setvcp(verify);
+
+   if (!ddc_excp && verify) {
+      ddc_excp = ddc_verify_multiple_vcp_values(dh, (DDCA_Any_Vcp_Value **) vset->pdata, value_ct);
+      if (ddc_excp)
+         f0printf(ferr(), "%s: %s\n", ddc_excp->detail, errinfo_causes_string(ddc_excp));
+   }
 
    return ddc_excp;
 }
 
 
+// Features whose setting can change the values of other features, e.g.
+// selecting a color preset resets the RGB gains.  They are written first.
+static const Byte interacting_features[] = {
+      0xdc,          // display mode
+      0x14,          // select color preset
+      0x0c,          // color temperature request
+};
+
+
+static bool
+is_interacting_feature(Byte feature_code) {
+   for (int ndx = 0; ndx < ARRAY_SIZE(interacting_features); ndx++) {
+      if (interacting_features[ndx] == feature_code)
+         return true;
+   }
+   return false;
+}
+
+
+static bool
+vcp_values_equal(DDCA_Any_Vcp_Value * v1, DDCA_Any_Vcp_Value * v2) {
+   if (v1->value_type != v2->value_type)
+      return false;
+   if (v1->value_type == DDCA_NON_TABLE_VCP_VALUE)
+      return VALREC_CUR_VAL(v1) == VALREC_CUR_VAL(v2);
+   return v1->val.t.bytect == v2->val.t.bytect &&
+          memcmp(v1->val.t.bytes, v2->val.t.bytes, v1->val.t.bytect) == 0;
+}
+
+
+static DDCA_Any_Vcp_Value *
+find_vcp_value(Vcp_Value_Set vset, Byte feature_code) {
+   for (int ndx = 0; ndx < vcp_value_set_size(vset); ndx++) {
+      DDCA_Any_Vcp_Value * vrec = vcp_value_set_get(vset, ndx);
+      if (vrec->opcode == feature_code)
+         return vrec;
+   }
+   return NULL;
+}
+
+
+/** Sets multiple VCP values, skipping those that already have their
+ *  target value.
+ *
+ *  The current values are read in a single scan of the profile related
+ *  features.  Features that interact with others are written first.  Once
+ *  one of them has been changed, the current values of the remaining
+ *  features may be stale, so they are all written.
+ *
+ * @param   dh      display handle
+ * @param   vset    values to set
+ * @return  #Ddc_Error reflecting the first error, or NULL if no errors
+ *
+ * If the current values cannot be read, all values are written.
+ */
+static Error_Info *
+ddc_set_multiple_differential(
+      Display_Handle* dh,
+      Vcp_Value_Set   vset)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+
+   Vcp_Value_Set current = vcp_value_set_new(50);
+   Public_Status_Code psc =
+         ddc_collect_raw_subset_values(dh, VCP_SUBSET_PROFILE, current, true, ferr());
+   if (psc != 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP,
+            "Unable to read current values: %s. Writing all values.", psc_desc(psc));
+      free_vcp_value_set(current);
+      current = NULL;
+   }
+
+   // interacting features first, then the rest in file order
+   int value_ct = vcp_value_set_size(vset);
+   Vcp_Value_Set ordered = g_ptr_array_sized_new(value_ct);   // borrowed records
+   for (int pass = 0; pass < 2; pass++) {
+      for (int ndx = 0; ndx < value_ct; ndx++) {
+         DDCA_Any_Vcp_Value * vrec = vcp_value_set_get(vset, ndx);
+         if ( is_interacting_feature(vrec->opcode) == (pass == 0) )
+            vcp_value_set_add(ordered, vrec);
+      }
+   }
+
+   Error_Info * ddc_excp = NULL;
+   Vcp_Value_Set changed = g_ptr_array_sized_new(value_ct);   // borrowed records
+   bool current_values_valid = (current != NULL);
+   for (int ndx = 0; ndx < value_ct; ndx++) {
+      DDCA_Any_Vcp_Value * vrec = vcp_value_set_get(ordered, ndx);
+      DDCA_Any_Vcp_Value * cur = (current_values_valid) ? find_vcp_value(current, vrec->opcode) : NULL;
+      if (cur && vcp_values_equal(vrec, cur)) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Feature 0x%02x unchanged", vrec->opcode);
+         continue;
+      }
+      vcp_value_set_add(changed, vrec);
+      if (is_interacting_feature(vrec->opcode))
+         current_values_valid = false;
+   }
+
+   if (get_output_level() >= DDCA_OL_VERBOSE)
+      f0printf(fout(), "Writing %d of %d values, the others are unchanged\n",
+                       vcp_value_set_size(changed), value_ct);
+   if (vcp_value_set_size(changed) > 0)
+      ddc_excp = ddc_set_multiple(dh, changed);
+
+   g_ptr_array_free(changed, true);
+   g_ptr_array_free(ordered, true);
+   if (current)
+      free_vcp_value_set(current);
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
+   return ddc_excp;
+}
+
+
+static bool
+edid_hash_matches(Dumpload_Data * pdata, Parsed_Edid * pedid) {
+   Byte  hash[32];
+   gsize hashsz = sizeof(hash);
+   GChecksum * checksum = g_checksum_new(G_CHECKSUM_SHA256);
+   g_checksum_update(checksum, pedid->bytes, 128);
+   g_checksum_get_digest(checksum, hash, &hashsz);
+   g_checksum_free(checksum);
+   return memcmp(hash, pdata->edid_hash, sizeof(hash)) == 0;
+}
+
+
 /** Applies VCP settings from a #Dumpload_Data struct to
  *  the monitor specified in that data structure.
  *
@@ -426,6 +644,10 @@ loadvcp_by_dumpload_data(
       // If explicit display specified, check that the data is valid for it
       assert(dh->dref->pedid);
       bool ok = true;
+      if (pdata->edid_hash_set && !edid_hash_matches(pdata, dh->dref->pedid)) {
+         f0printf(errf, "EDID in snapshot does not match that of specified device\n");
+         ok = false;
+      }
       if ( !streq(dh->dref->pedid->model_name, pdata->model) ) {
          f0printf(errf,
             "Monitor model in data (%s) does not match that for specified device (%s)\n",
@@ -467,6 +689,13 @@ loadvcp_by_dumpload_data(
          goto bye;
       }
 
+      if (pdata->edid_hash_set && !edid_hash_matches(pdata, dref->pedid)) {
+         f0printf(errf, "EDID in snapshot does not match that of monitor %s - %s\n",
+                        pdata->model, pdata->serial_ascii );
+         psc = DDCRC_INVALID_DISPLAY;
+         goto bye;
+      }
+
       // return code == 0 iff dh set
       ddc_open_display(dref, CALLOPT_ERR_MSG, &dh);
       if (!dh) {
@@ -475,7 +704,10 @@ loadvcp_by_dumpload_data(
       }
    }
 
-   ddc_excp = ddc_set_multiple(dh, pdata->vcp_values);
+   if (differential_loadvcp)
+      ddc_excp = ddc_set_multiple_differential(dh, pdata->vcp_values);
+   else
+      ddc_excp = ddc_set_multiple(dh, pdata->vcp_values);
    psc = (ddc_excp) ? ddc_excp->status_code : 0;
 
    // close the display only if this function opened it
@@ -490,6 +722,44 @@ bye:
 }
 
 
+/** Applies the values parsed by #create_dumpload_data_from_g_ptr_array() or
+ *  #create_dumpload_data_from_buffer() to the selected monitor.
+ *
+ *  \param  ddc_excp  parse errors
+ *  \param  pdata     parsed data, NULL if errors
+ *  \param  dh        display handle
+ *  \param  verbose   report the data loaded
+ *  \return pointer to #Ddc_Error describing the first error, NULL if if success
+ */
+static Error_Info *
+loadvcp_parsed_dumpload_data(
+      Error_Info *     ddc_excp,
+      Dumpload_Data *  pdata,
+      Display_Handle * dh,
+      bool             verbose)
+{
+   assert( (ddc_excp == NULL && pdata != NULL) ||
+           (ddc_excp != NULL && pdata == NULL) );
+   if (!pdata) {
+      // f0printf(ferr(), "Unable to load VCP data from string\n");
+      // psc = DDCRC_ARG;     // was DDCRC_INVALID_DATA;
+      // ddc_excp = errinfo_new(psc, __func__);
+   }
+   else {
+      if (verbose) {
+           f0printf(fout(), "Loading VCP settings for monitor \"%s\", sn \"%s\" \n",
+                           pdata->model, pdata->serial_ascii);
+           rpt_push_output_dest(fout());
+           dbgrpt_dumpload_data(pdata, 0);
+           rpt_pop_output_dest();
+      }
+      ddc_excp = loadvcp_by_dumpload_data(pdata, dh);
+      free_dumpload_data(pdata);
+   }
+   return ddc_excp;
+}
+
+
 /** Reads the monitor identification and VCP values from a null terminated
  *  string array and applies those values to the selected monitor.
  *
@@ -519,25 +789,8 @@ loadvcp_by_ntsa(
    Dumpload_Data * pdata = NULL;
    ddc_excp = create_dumpload_data_from_g_ptr_array(garray, &pdata);
    DBGMSF(debug, "create_dumpload_data_from_g_ptr_array() returned %p", pdata);
-   assert( (ddc_excp == NULL && pdata != NULL) ||
-           (ddc_excp != NULL && pdata == NULL) );
-   if (!pdata) {
-      // f0printf(ferr(), "Unable to load VCP data from string\n");
-      // psc = DDCRC_ARG;     // was DDCRC_INVALID_DATA;
-      // ddc_excp = errinfo_new(psc, __func__);
-   }
-   else {
-      if (verbose) {
-           f0printf(fout(), "Loading VCP settings for monitor \"%s\", sn \"%s\" \n",
-                           pdata->model, pdata->serial_ascii);
-           rpt_push_output_dest(fout());
-           dbgrpt_dumpload_data(pdata, 0);
-           rpt_pop_output_dest();
-      }
-      ddc_excp = loadvcp_by_dumpload_data(pdata, dh);
-      free_dumpload_data(pdata);
-   }
-   return ddc_excp;
+   g_ptr_array_free(garray, false);     // strings are owned by ntsa
+   return loadvcp_parsed_dumpload_data(ddc_excp, pdata, dh, verbose);
 }
 
 
@@ -555,11 +808,14 @@ loadvcp_by_string(
       char *           catenated,
       Display_Handle * dh)
 {
-   Null_Terminated_String_Array nta = strsplit(catenated, ";");
-   Error_Info * ddc_excp = loadvcp_by_ntsa(nta, dh);
+   bool debug = false;
+   DBGMSF(debug, "Starting.  catenated=%s", catenated);
+   bool verbose = debug || (get_output_level() >= DDCA_OL_VERBOSE);
 
-   ntsa_free(nta, /* free_strings */ true);
-   return ddc_excp;
+   Dumpload_Data * pdata = NULL;
+   Error_Info * ddc_excp =
+         create_dumpload_data_from_buffer(catenated, strlen(catenated), ';', &pdata);
+   return loadvcp_parsed_dumpload_data(ddc_excp, pdata, dh, verbose);
 }
 
 
@@ -873,7 +1129,152 @@ dumpvcp_as_string(Display_Handle * dh, char ** result_loc) {
 }
 
 
+//
+// Binary snapshots
+//
+// A snapshot holds the identification and non-table VCP values of a dump
+// in a fixed layout, so that it can be read without parsing text.
+// Multi-byte fields are little endian.
+//
+//   offset  size
+//        0     4  magic "DDCS"
+//        4     1  snapshot format version
+//        5     2  VCP version major, minor
+//        7     1  reserved
+//        8     2  product code
+//       10     4  manufacturer id, null padded
+//       14    14  model name, null padded
+//       28    14  serial number, null padded
+//       42    32  SHA-256 hash of the EDID
+//       74     8  timestamp
+//       82     2  number of values
+//       84   3*n  values: feature code, sh, sl
+//
+
+#define SNAPSHOT_MAGIC           "DDCS"
+#define SNAPSHOT_FORMAT_VERSION  1
+#define SNAPSHOT_HEADER_SIZE     84
+#define SNAPSHOT_VALUE_SIZE       3
+
+
+/** Checks whether a buffer starts like a binary snapshot.
+ *
+ *  \param  buf    data
+ *  \param  bufsz  number of bytes in **buf**
+ *  \return true if the buffer begins with the snapshot magic number
+ */
+bool
+is_dumpload_snapshot(const Byte * buf, size_t bufsz) {
+   return bufsz >= 4 && memcmp(buf, SNAPSHOT_MAGIC, 4) == 0;
+}
+
+
+/** Converts a binary snapshot to a #Dumpload_Data struct.
+ *
+ *  \param  buf         snapshot
+ *  \param  bufsz       number of bytes in **buf**
+ *  \param  dumpload_data_loc  where to return pointer to newly allocated
+ *                      Dumpload_Data struct, NULL if the snapshot is not valid.
+ *                      It is the responsibility of the caller to free this struct.
+ *  \return NULL if success, #Error_Info with status DDCRC_BAD_DATA if not
+ */
+Error_Info *
+create_dumpload_data_from_snapshot(
+      const Byte *     buf,
+      size_t           bufsz,
+      Dumpload_Data ** dumpload_data_loc)
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting. bufsz=%zu", bufsz);
+   *dumpload_data_loc = NULL;
+
+   if (!is_dumpload_snapshot(buf, bufsz) || bufsz < SNAPSHOT_HEADER_SIZE)
+      return errinfo_new2(DDCRC_BAD_DATA, __func__, "Not a snapshot");
+   if (buf[4] != SNAPSHOT_FORMAT_VERSION)
+      return errinfo_new2(DDCRC_BAD_DATA, __func__, "Unsupported snapshot format version %d", buf[4]);
+   int value_ct = buf[82] | (buf[83] << 8);
+   if (bufsz != SNAPSHOT_HEADER_SIZE + value_ct*SNAPSHOT_VALUE_SIZE)
+      return errinfo_new2(DDCRC_BAD_DATA, __func__,
+                          "Snapshot size %zu does not match value count %d", bufsz, value_ct);
+
+   Dumpload_Data * data = calloc(1, sizeof(Dumpload_Data));
+   data->vcp_version.major = buf[5];
+   data->vcp_version.minor = buf[6];
+   data->product_code = buf[8] | (buf[9] << 8);
+   memcpy(data->mfg_id,       buf+10, 3);       // terminating nulls from calloc()
+   memcpy(data->model,        buf+14, 13);
+   memcpy(data->serial_ascii, buf+28, 13);
+   memcpy(data->edid_hash,    buf+42, 32);
+   data->edid_hash_set = true;
+   uint64_t timestamp = 0;
+   for (int ndx = 7; ndx >= 0; ndx--)
+      timestamp = (timestamp << 8) | buf[74+ndx];
+   data->timestamp_millis = timestamp;
+
+   data->vcp_values = vcp_value_set_new(value_ct);
+   for (int ndx = 0; ndx < value_ct; ndx++) {
+      const Byte * v = buf + SNAPSHOT_HEADER_SIZE + ndx*SNAPSHOT_VALUE_SIZE;
+      vcp_value_set_add(data->vcp_values, create_cont_vcp_value(v[0], 0, (v[1] << 8) | v[2]));
+   }
+   data->vcp_value_ct = value_ct;
+
+   *dumpload_data_loc = data;
+   DBGMSF(debug, "Returning %p", data);
+   return NULL;
+}
+
+
+/** Converts a #Dumpload_Data struct to a binary snapshot.
+ *
+ *  \param  data  pointer to Dumpload_Data instance, must contain the EDID
+ *  \return newly allocated #Buffer, caller must free
+ *
+ *  \remark
+ *  Table values are not included.  DUMPVCP does not collect them.
+ */
+Buffer *
+convert_dumpload_data_to_snapshot(Dumpload_Data * data) {
+   assert(data);
+   int value_ct = vcp_value_set_size(data->vcp_values);
+   Buffer * buf = buffer_new(SNAPSHOT_HEADER_SIZE + value_ct*SNAPSHOT_VALUE_SIZE, __func__);
+   buffer_set_length(buf, SNAPSHOT_HEADER_SIZE);
+   Byte * hdr = buf->bytes;
+   memset(hdr, 0, SNAPSHOT_HEADER_SIZE);
+   memcpy(hdr, SNAPSHOT_MAGIC, 4);
+   hdr[4] = SNAPSHOT_FORMAT_VERSION;
+   hdr[5] = data->vcp_version.major;
+   hdr[6] = data->vcp_version.minor;
+   hdr[8] = data->product_code & 0xff;
+   hdr[9] = data->product_code >> 8;
+   memcpy(hdr+10, data->mfg_id,       strnlen(data->mfg_id,       3));
+   memcpy(hdr+14, data->model,        strnlen(data->model,        13));
+   memcpy(hdr+28, data->serial_ascii, strnlen(data->serial_ascii, 13));
+   gsize hashsz = 32;
+   GChecksum * checksum = g_checksum_new(G_CHECKSUM_SHA256);
+   g_checksum_update(checksum, data->edidbytes, 128);
+   g_checksum_get_digest(checksum, hdr+42, &hashsz);
+   g_checksum_free(checksum);
+   uint64_t timestamp = data->timestamp_millis;
+   for (int ndx = 0; ndx < 8; ndx++)
+      hdr[74+ndx] = (timestamp >> (8*ndx)) & 0xff;
+
+   int written_ct = 0;
+   for (int ndx = 0; ndx < value_ct; ndx++) {
+      DDCA_Any_Vcp_Value * vrec = vcp_value_set_get(data->vcp_values, ndx);
+      if (vrec->value_type == DDCA_NON_TABLE_VCP_VALUE) {
+         Byte value[SNAPSHOT_VALUE_SIZE] = {vrec->opcode, vrec->val.c_nc.sh, vrec->val.c_nc.sl};
+         buffer_append(buf, value, SNAPSHOT_VALUE_SIZE);
+         written_ct++;
+      }
+   }
+   buf->bytes[82] = written_ct & 0xff;
+   buf->bytes[83] = written_ct >> 8;
+   return buf;
+}
+
+
 void init_ddc_dumpload() {
    RTTI_ADD_FUNC(format_timestamp);
    RTTI_ADD_FUNC(collect_machine_readable_timestamp);
+   RTTI_ADD_FUNC(ddc_set_multiple_differential);
 }
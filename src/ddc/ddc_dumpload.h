@@ -40,6 +40,8 @@ struct {
    DDCA_MCCS_Version_Spec   vcp_version;  ///< monitor VCP/MCCS version
    int            vcp_value_ct;           ///< number of VCP values
    Vcp_Value_Set  vcp_values;             ///< VCP values
+   bool           edid_hash_set;          ///< edid_hash is set, i.e. data is from a snapshot
+   Byte           edid_hash[32];          ///< SHA-256 hash of the EDID
 } Dumpload_Data;
 
 void
@@ -66,10 +68,32 @@ create_dumpload_data_from_g_ptr_array(
       GPtrArray *      garray,
       Dumpload_Data ** dumpload_data_loc);
 
+Error_Info *
+create_dumpload_data_from_buffer(
+      const char *     buf,
+      size_t           bufsz,
+      char             separator,
+      Dumpload_Data ** dumpload_data_loc);
+
 GPtrArray *
 convert_dumpload_data_to_string_array(
       Dumpload_Data *  data);
 
+bool
+is_dumpload_snapshot(
+      const Byte *     buf,
+      size_t           bufsz);
+
+Error_Info *
+create_dumpload_data_from_snapshot(
+      const Byte *     buf,
+      size_t           bufsz,
+      Dumpload_Data ** dumpload_data_loc);
+
+Buffer *
+convert_dumpload_data_to_snapshot(
+      Dumpload_Data *  data);
+
 Public_Status_Code
 dumpvcp_as_dumpload_data(
       Display_Handle * dh,
@@ -80,6 +104,9 @@ dumpvcp_as_string(
       Display_Handle * dh,
       char**           result_loc);
 
+bool
+ddc_enable_differential_loadvcp(bool onoff);
+
 void init_ddc_dumpload();
 
 #endif /* DDC_DUMPLOAD_H_ */
@@ -0,0 +1,252 @@
+/** @file ddc_feature_sampler.c
+ *
+ *  Reads features of multiple displays on a fixed schedule, e.g. to collect
+ *  time series of brightness or power for power and ambient light studies.
+ *
+ *  Round N is scheduled at start + N * interval, so the schedule does not
+ *  drift with the time the reads take.  At each scheduled time the reads of
+ *  all the features of a display are queued to the display's worker thread,
+ *  see ddc_async_requests.c, so the displays are read concurrently.
+ *
+ *  If a display has not completed the reads of its previous round when the
+ *  next round is due, the display skips the round and the missed deadline
+ *  is counted.  If the sampling thread itself wakes up more than one interval
+ *  late, the rounds that passed are counted as missed by every display.
+ *  Each sample reports the deadlines its display missed since its prior
+ *  sample.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/report_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/rtti.h"
+
+#include "ddc/ddc_async_requests.h"
+#include "ddc/ddc_packet_io.h"
+
+#include "ddc/ddc_feature_sampler.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define MAX_SAMPLER_SLEEP_MILLISEC  100    // how often a stop request is checked
+
+static bool stop_requested = false;        // atomic access
+
+typedef struct {
+   Display_Handle *           dh;
+   bool                       pending;           // round queued, not yet reported
+   uint64_t                   scheduled_mono;    // of pending round
+   uint64_t                   scheduled_real;
+   int                        missed_ct;         // since prior round queued
+   int                        round_missed_ct;   // reported with pending round
+   DDCA_Non_Table_Vcp_Value * values;
+   DDCA_Status *              statuses;
+   uint64_t *                 completed;
+} Sampled_Display;
+
+
+static void
+report_round(
+      Sampled_Display *        sd,
+      int                      display_ndx,
+      DDCA_Vcp_Feature_Code *  feature_codes,
+      int                      feature_ct,
+      DDCA_Feature_Sample_Func func,
+      void *                   arg)
+{
+   for (int fndx = 0; fndx < feature_ct; fndx++) {
+      DDCA_Feature_Sample sample = {0};
+      sample.display_ndx     = display_ndx;
+      sample.feature_code    = feature_codes[fndx];
+      sample.scheduled_nanos = sd->scheduled_real;
+      sample.latency_nanos   = (sd->completed[fndx] > sd->scheduled_mono)
+                                  ? sd->completed[fndx] - sd->scheduled_mono : 0;
+      sample.status          = sd->statuses[fndx];
+      if (sample.status == 0)
+         sample.value = sd->values[fndx];
+      sample.missed_ct       = sd->round_missed_ct;
+      func(&sample, arg);
+   }
+   sd->pending = false;
+}
+
+
+static void
+queue_round(Sampled_Display * sd, DDCA_Vcp_Feature_Code * feature_codes, int feature_ct,
+            uint64_t scheduled_mono, uint64_t scheduled_real)
+{
+   sd->scheduled_mono  = scheduled_mono;
+   sd->scheduled_real  = scheduled_real;
+   sd->round_missed_ct = sd->missed_ct;
+   sd->missed_ct       = 0;
+   sd->pending         = true;
+   for (int fndx = 0; fndx < feature_ct; fndx++) {
+      memset(&sd->values[fndx], 0, sizeof(DDCA_Non_Table_Vcp_Value));
+      sd->completed[fndx] = 0;
+      sd->statuses[fndx]  = 0;
+      // once queued, the status is set by the worker thread
+      DDCA_Status ddcrc = ddc_queue_sample_request(sd->dh, feature_codes[fndx],
+            &sd->values[fndx], &sd->statuses[fndx], &sd->completed[fndx]);
+      if (ddcrc != 0)
+         sd->statuses[fndx] = ddcrc;
+   }
+}
+
+
+// Sleeps until a CLOCK_MONOTONIC time, returns false if sampling is stopped
+static bool
+sleep_until(uint64_t target_nanos) {
+   while (!__atomic_load_n(&stop_requested, __ATOMIC_ACQUIRE)) {
+      uint64_t now = cur_monotonic_nanosec();
+      if (now >= target_nanos)
+         return true;
+      uint64_t remaining_micros = (target_nanos - now) / 1000;
+      if (remaining_micros > MAX_SAMPLER_SLEEP_MILLISEC * 1000)
+         remaining_micros = MAX_SAMPLER_SLEEP_MILLISEC * 1000;
+      g_usleep(remaining_micros);
+   }
+   return false;
+}
+
+
+/** Reads non-table features from multiple displays at fixed intervals.
+ *
+ *  \param  drefs              displays to sample
+ *  \param  dref_ct            number of displays
+ *  \param  feature_codes      features to read from each display
+ *  \param  feature_ct         number of features
+ *  \param  interval_millisec  time between rounds
+ *  \param  round_ct           number of rounds, 0 to continue until
+ *                             #ddc_stop_feature_sampling() is called
+ *  \param  callopts           options for opening the displays
+ *  \param  func               called for each value read, in the calling thread
+ *  \param  arg                passed to **func**
+ *  \param  missed_ct_loc      if non-NULL, receives the total number of
+ *                             deadlines missed by all displays
+ *  \retval 0         sampling completed or stopped
+ *  \retval DDCRC_ARG invalid argument
+ *  \retval other     status of opening a display, no samples taken
+ */
+DDCA_Status ddc_sample_features(
+      Display_Ref **           drefs,
+      int                      dref_ct,
+      DDCA_Vcp_Feature_Code *  feature_codes,
+      int                      feature_ct,
+      int                      interval_millisec,
+      int                      round_ct,
+      Call_Options             callopts,
+      DDCA_Feature_Sample_Func func,
+      void *                   arg,
+      int *                    missed_ct_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref_ct=%d, feature_ct=%d, interval_millisec=%d, round_ct=%d",
+                                       dref_ct, feature_ct, interval_millisec, round_ct);
+   if (missed_ct_loc)
+      *missed_ct_loc = 0;
+   if (dref_ct <= 0 || feature_ct <= 0 || interval_millisec <= 0 || round_ct < 0 || !func) {
+      DBGTRC_RET_DDCRC(debug, TRACE_GROUP, DDCRC_ARG, "");
+      return DDCRC_ARG;
+   }
+
+   DDCA_Status ddcrc = 0;
+   Sampled_Display * sds = calloc(dref_ct, sizeof(Sampled_Display));
+   for (int ndx = 0; ndx < dref_ct && ddcrc == 0; ndx++) {
+      ddcrc = ddc_open_display(drefs[ndx], callopts, &sds[ndx].dh);
+      sds[ndx].values    = calloc(feature_ct, sizeof(DDCA_Non_Table_Vcp_Value));
+      sds[ndx].statuses  = calloc(feature_ct, sizeof(DDCA_Status));
+      sds[ndx].completed = calloc(feature_ct, sizeof(uint64_t));
+   }
+
+   int total_missed_ct = 0;
+   if (ddcrc == 0) {
+      __atomic_store_n(&stop_requested, false, __ATOMIC_RELEASE);
+      uint64_t interval_nanos = interval_millisec * (uint64_t) 1000000;
+      uint64_t start_mono = cur_monotonic_nanosec();
+      uint64_t start_real = cur_realtime_nanosec();
+
+      for (int64_t round = 0; round_ct == 0 || round < round_ct; round++) {
+         uint64_t deadline = start_mono + round * interval_nanos;
+         if (!sleep_until(deadline))
+            break;
+
+         // woke up late enough that entire rounds passed
+         uint64_t now = cur_monotonic_nanosec();
+         int64_t skipped = (now - deadline) / interval_nanos;
+         if (round_ct > 0 && round + skipped >= round_ct)
+            skipped = round_ct - round;
+         if (skipped > 0) {
+            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Sampling thread late, skipping %"PRId64" rounds", skipped);
+            for (int ndx = 0; ndx < dref_ct; ndx++)
+               sds[ndx].missed_ct += skipped;
+            total_missed_ct += skipped * dref_ct;
+            round += skipped;
+            if (round_ct > 0 && round >= round_ct)
+               break;
+            deadline = start_mono + round * interval_nanos;
+         }
+
+         for (int ndx = 0; ndx < dref_ct; ndx++) {
+            Sampled_Display * sd = &sds[ndx];
+            if (sd->pending && !ddc_has_pending_async_requests(sd->dh))
+               report_round(sd, ndx, feature_codes, feature_ct, func, arg);
+            if (sd->pending) {
+               sd->missed_ct++;
+               total_missed_ct++;
+            }
+            else {
+               queue_round(sd, feature_codes, feature_ct,
+                           deadline, start_real + round * interval_nanos);
+            }
+         }
+      }
+
+      for (int ndx = 0; ndx < dref_ct; ndx++) {
+         ddc_wait_async_requests(sds[ndx].dh);
+         if (sds[ndx].pending)
+            report_round(&sds[ndx], ndx, feature_codes, feature_ct, func, arg);
+      }
+   }
+
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      if (sds[ndx].dh)
+         ddc_close_display(sds[ndx].dh);
+      free(sds[ndx].values);
+      free(sds[ndx].statuses);
+      free(sds[ndx].completed);
+   }
+   free(sds);
+   if (missed_ct_loc)
+      *missed_ct_loc = total_missed_ct;
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "total_missed_ct=%d", total_missed_ct);
+   return ddcrc;
+}
+
+
+/** Ends sampling by #ddc_sample_features() after the current round.
+ *  Async signal safe, so it may be called from a SIGINT handler.
+ */
+void ddc_stop_feature_sampling() {
+   __atomic_store_n(&stop_requested, true, __ATOMIC_RELEASE);
+}
+
+
+void init_ddc_feature_sampler() {
+   RTTI_ADD_FUNC(ddc_sample_features);
+}
@@ -0,0 +1,31 @@
+/** @file ddc_feature_sampler.h
+ *
+ *  Reads features of multiple displays on a fixed schedule
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_FEATURE_SAMPLER_H_
+#define DDC_FEATURE_SAMPLER_H_
+
+#include "ddcutil_types.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+
+DDCA_Status ddc_sample_features(
+      Display_Ref **           drefs,
+      int                      dref_ct,
+      DDCA_Vcp_Feature_Code *  feature_codes,
+      int                      feature_ct,
+      int                      interval_millisec,
+      int                      round_ct,
+      Call_Options             callopts,
+      DDCA_Feature_Sample_Func func,
+      void *                   arg,
+      int *                    missed_ct_loc);
+void ddc_stop_feature_sampling();
+void init_ddc_feature_sampler();
+
+#endif /* DDC_FEATURE_SAMPLER_H_ */
@@ -0,0 +1,184 @@
+/** @file ddc_feature_scan.c
+ *
+ *  Determines which of a set of non-table features a display supports,
+ *  as for command "getvcp scan".
+ *
+ *  Most of the 256 feature codes are unsupported by any given monitor, and
+ *  probing each with the normal sleep and retry policy means paying the full
+ *  error recovery cost for every one of them.  Instead, features are probed
+ *  in two passes:
+ *  - Each feature is queried once, with shortened sleeps and no retry.
+ *    Features the monitor reports as unsupported, or that
+ *    #ddc_interpret_nontable_vcp_response() determines are unsupported, are
+ *    settled by this single exchange.
+ *  - Only features whose first query failed for another reason, e.g. a
+ *    corrupted response, are queried again, this time using the normal
+ *    sleep and retry policy.
+ *
+ *  Unsupported features are recorded for the display and, on close, saved
+ *  for the monitor model (see #ddc_save_unsupported_features()), so later
+ *  reads of them fail without I/O.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/data_structures.h"
+#include "util/error_info.h"
+
+#include "base/core.h"
+#include "base/ddc_errno.h"
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/status_code_mgt.h"
+#include "base/thread_sleep_data.h"
+
+#include "i2c/i2c_strategy_dispatcher.h"
+
+#include "ddc/ddc_io_scheduler.h"
+#include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_vcp.h"
+
+#include "ddc/ddc_feature_scan.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+
+/** Queries a feature once, without retry.
+ *
+ *  \param  dh            handle for open display
+ *  \param  feature_code  VCP feature code
+ *  \return status code
+ */
+static DDCA_Status
+probe_feature_once(Display_Handle * dh, DDCA_Vcp_Feature_Code feature_code) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x", dh_repr(dh), feature_code);
+
+   DDC_Packet * request_packet = create_ddc_getvcp_request_packet(feature_code, __func__);
+   DDC_Packet * response_packet = NULL;
+   ddc_begin_transaction(dh, false);
+   Error_Info * excp = ddc_write_read(
+                          dh,
+                          request_packet,
+                          I2C_Read_Bytewise,
+                          11,           // see ddc_get_nontable_vcp_value()
+                          DDC_PACKET_TYPE_QUERY_VCP_RESPONSE,
+                          feature_code,
+                          &response_packet);
+   ddc_end_transaction(dh);
+   free_ddc_packet(request_packet);
+   if (!excp) {
+      Parsed_Nontable_Vcp_Response * parsed_response = NULL;
+      // records the feature as unsupported if so reported or determined
+      excp = ddc_interpret_nontable_vcp_response(dh, feature_code, response_packet, &parsed_response);
+      free(parsed_response);
+      free_ddc_packet(response_packet);
+   }
+   else if (ERRINFO_STATUS(excp) == DDCRC_NULL_RESPONSE &&
+            (dh->dref->flags & DREF_DDC_USES_NULL_RESPONSE_FOR_UNSUPPORTED))
+   {
+      ddc_record_unsupported_feature(dh->dref, feature_code);
+      errinfo_free(excp);
+      excp = errinfo_new2(DDCRC_DETERMINED_UNSUPPORTED, __func__, "DDC Null Response");
+   }
+
+   DDCA_Status psc = ERRINFO_STATUS(excp);
+   ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, psc, "");
+   return psc;
+}
+
+
+static inline bool
+is_unsupported_status(DDCA_Status psc) {
+   return psc == DDCRC_REPORTED_UNSUPPORTED || psc == DDCRC_DETERMINED_UNSUPPORTED;
+}
+
+
+/** Determines which of a set of non-table features a display supports.
+ *
+ *  \param  dh                 handle for open I2C display
+ *  \param  candidates         features to check
+ *  \param  unsupported_loc    if non-null, where to return the features
+ *                             found to be unsupported
+ *  \return features found to be supported
+ *
+ *  \remark
+ *  Features in neither returned set could not be read at all.
+ *  Features already known to be unsupported are not queried.
+ */
+Bit_Set_256
+ddc_scan_supported_features(
+      Display_Handle * dh,
+      Bit_Set_256      candidates,
+      Bit_Set_256 *    unsupported_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, candidates: %s",
+                   dh_repr(dh), bs256_to_string(candidates, "x", " "));
+   assert(dh->dref->io_path.io_mode == DDCA_IO_I2C);
+
+   Bit_Set_256 supported   = EMPTY_BIT_SET_256;
+   Bit_Set_256 unsupported = EMPTY_BIT_SET_256;
+   Bit_Set_256 retry       = EMPTY_BIT_SET_256;
+
+   // Pass 1: a single short query per feature
+   double saved_multiplier = tsd_get_sleep_multiplier_factor();
+   tsd_set_sleep_multiplier_factor(saved_multiplier * DDC_SCAN_PROBE_SLEEP_MULTIPLIER);
+   for (int code = 0; code < 256; code++) {
+      if (!bs256_contains(candidates, code))
+         continue;
+      if (ddc_is_known_unsupported_feature(dh->dref, code)) {
+         unsupported = bs256_insert(unsupported, code);
+         continue;
+      }
+      DDCA_Status psc = probe_feature_once(dh, code);
+      if (psc == 0)
+         supported = bs256_insert(supported, code);
+      else if (is_unsupported_status(psc))
+         unsupported = bs256_insert(unsupported, code);
+      else
+         retry = bs256_insert(retry, code);
+   }
+   tsd_set_sleep_multiplier_factor(saved_multiplier);
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Features to retry: %s", bs256_to_string(retry, "x", " "));
+
+   // Pass 2: features whose query failed for reasons other than unsupported
+   for (int code = 0; code < 256; code++) {
+      if (!bs256_contains(retry, code))
+         continue;
+      Parsed_Nontable_Vcp_Response * parsed_response = NULL;
+      Error_Info * excp = ddc_get_nontable_vcp_value(dh, code, &parsed_response);
+      DDCA_Status psc = ERRINFO_STATUS(excp);
+      if (psc == 0)
+         supported = bs256_insert(supported, code);
+      else if (is_unsupported_status(psc) ||
+               (psc == DDCRC_NULL_RESPONSE &&
+                (dh->dref->flags & DREF_DDC_USES_NULL_RESPONSE_FOR_UNSUPPORTED)) )
+         unsupported = bs256_insert(unsupported, code);
+      free(parsed_response);
+      ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+   }
+
+   if (unsupported_loc)
+      *unsupported_loc = unsupported;
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "unsupported: %s", bs256_to_string(unsupported, "x", " "));
+   DBGTRC_DONE(debug, TRACE_GROUP, "supported: %s", bs256_to_string(supported, "x", " "));
+   return supported;
+}
+
+
+void init_ddc_feature_scan() {
+   RTTI_ADD_FUNC(probe_feature_once);
+   RTTI_ADD_FUNC(ddc_scan_supported_features);
+}
@@ -0,0 +1,24 @@
+/** @file ddc_feature_scan.h
+ *
+ *  Quickly determines which non-table features a display supports
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_FEATURE_SCAN_H_
+#define DDC_FEATURE_SCAN_H_
+
+#include "util/data_structures.h"
+
+#include "base/displays.h"
+
+Bit_Set_256
+ddc_scan_supported_features(
+      Display_Handle * dh,
+      Bit_Set_256      candidates,
+      Bit_Set_256 *    unsupported_loc);
+
+void init_ddc_feature_scan();
+
+#endif /* DDC_FEATURE_SCAN_H_ */
@@ -0,0 +1,340 @@
+/** @file ddc_io_scheduler.c
+ *
+ *  Orders the DDC transactions of threads sharing a display.
+ *
+ *  A transaction is one call of #ddc_write_read_with_retry() or
+ *  #ddc_write_only_with_retry(), i.e. a single DDC exchange including its
+ *  retries.  Only one thread performs a transaction on a bus at a time.
+ *  When the bus becomes free, the waiting thread with the highest priority
+ *  goes next, so an interactive write queued while a background poll or a
+ *  capabilities read is in progress is sent as soon as the current
+ *  fragment completes, rather than after the whole multi-part read.
+ *
+ *  The priority of a transaction is that of the thread performing it, see
+ *  #ddc_set_thread_io_priority().  Writes from a thread with normal
+ *  priority are treated as interactive.
+ *
+ *  Optionally, the number of transactions per second on each bus is
+ *  limited, see #ddc_set_max_transaction_rate(), and so is the number of
+ *  simultaneous transactions on buses sharing a physical adapter, e.g. the
+ *  DisplayPort aux channels of one video card or the branches of an MST hub,
+ *  see #ddc_set_max_adapter_concurrency().
+ *
+ *  Background transactions on a display whose health score, see
+ *  display_health.c, is below #DISPLAY_HEALTH_UNHEALTHY_SCORE are spaced at
+ *  least #DISPLAY_HEALTH_BACKGROUND_INTERVAL_MILLIS apart, so that polling
+ *  does not add to the load on a display that is already failing.  The
+ *  delay occurs before the bus is acquired, so other transactions proceed.
+ *
+ *  After a write that disrupts DDC, e.g. of feature x60 (Input Source),
+ *  transactions on the display are held until its settle window has passed,
+ *  see ddc_settle_window.c.  This delay also occurs before the bus is acquired.
+ *
+ *  The scheduling state is maintained in the display's #Display_Async_Rec.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/display_health.h"
+#include "base/displays.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/sleep.h"
+
+#include "i2c/i2c_sysfs.h"
+
+#include "ddc/ddc_io_scheduler.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDCIO;
+
+static int max_transaction_rate = DEFAULT_MAX_DDC_TRANSACTION_RATE;
+static int max_adapter_concurrency = DEFAULT_MAX_ADAPTER_CONCURRENCY;
+
+/** Transactions in progress on the buses of one physical adapter */
+struct Adapter_Slots {
+   char *  adapter;     // sysfs path, see get_physical_adapter_for_busno()
+   int     active;
+};
+
+// adapter -> struct Adapter_Slots *, entries live for the life of the process
+static GHashTable * adapter_slots_table = NULL;
+static GMutex       adapter_slots_mutex;      // protects the table and all Adapter_Slots
+static GCond        adapter_slots_cond;       // signaled when a slot is released
+
+// value stored is priority+1, so that an unset key (NULL) reads as 0
+static GPrivate io_priority_key = G_PRIVATE_INIT(NULL);
+
+
+/** Sets the priority of the DDC transactions performed by the current thread.
+ *
+ *  \param  priority  new priority
+ *  \return prior priority
+ *
+ *  \remark
+ *  This setting is thread-specific.
+ */
+DDCA_IO_Priority
+ddc_set_thread_io_priority(DDCA_IO_Priority priority) {
+   assert(priority >= DDCA_IO_PRIORITY_BACKGROUND && priority <= DDCA_IO_PRIORITY_INTERACTIVE);
+   DDCA_IO_Priority old = ddc_get_thread_io_priority();
+   g_private_set(&io_priority_key, GINT_TO_POINTER(priority+1));
+   return old;
+}
+
+
+/** Returns the priority of the DDC transactions performed by the current thread.
+ *
+ *  \return priority, #DDCA_IO_PRIORITY_NORMAL if never set
+ */
+DDCA_IO_Priority
+ddc_get_thread_io_priority() {
+   int val = GPOINTER_TO_INT(g_private_get(&io_priority_key));
+   return (val == 0) ? DDCA_IO_PRIORITY_NORMAL : val-1;
+}
+
+
+/** Sets the maximum number of DDC transactions per second on each bus.
+ *
+ *  \param  per_sec  maximum rate, 0 for no limit
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global, not thread-specific.
+ */
+int
+ddc_set_max_transaction_rate(int per_sec) {
+   assert(per_sec >= 0);
+   int old = max_transaction_rate;
+   max_transaction_rate = per_sec;
+   return old;
+}
+
+
+/** Returns the maximum number of DDC transactions per second on each bus.
+ *
+ *  \return maximum rate, 0 if no limit
+ */
+int
+ddc_get_max_transaction_rate() {
+   return max_transaction_rate;
+}
+
+
+/** Sets the maximum number of simultaneous DDC transactions on
+ *  buses sharing a physical adapter.
+ *
+ *  \param  limit  maximum transactions, 0 for no limit
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global, not thread-specific.
+ */
+int
+ddc_set_max_adapter_concurrency(int limit) {
+   assert(limit >= 0);
+   g_mutex_lock(&adapter_slots_mutex);
+   int old = max_adapter_concurrency;
+   max_adapter_concurrency = limit;
+   g_cond_broadcast(&adapter_slots_cond);   // a higher limit may release waiters
+   g_mutex_unlock(&adapter_slots_mutex);
+   return old;
+}
+
+
+/** Returns the maximum number of simultaneous DDC transactions on
+ *  buses sharing a physical adapter.
+ *
+ *  \return maximum transactions, 0 if no limit
+ */
+int
+ddc_get_max_adapter_concurrency() {
+   return max_adapter_concurrency;
+}
+
+
+// Must be called with adapter_slots_mutex held
+static struct Adapter_Slots *
+get_adapter_slots(Display_Async_Rec * async_rec) {
+   if (!async_rec->adapter_slots_resolved) {
+      async_rec->adapter_slots_resolved = true;
+      char * adapter = (async_rec->dpath.io_mode == DDCA_IO_I2C)
+                          ? get_physical_adapter_for_busno(async_rec->dpath.path.i2c_busno)
+                          : NULL;
+      if (adapter) {
+         if (!adapter_slots_table)
+            adapter_slots_table = g_hash_table_new(g_str_hash, g_str_equal);
+         struct Adapter_Slots * slots = g_hash_table_lookup(adapter_slots_table, adapter);
+         if (slots) {
+            free(adapter);
+         }
+         else {
+            slots = calloc(1, sizeof(struct Adapter_Slots));
+            slots->adapter = adapter;
+            g_hash_table_insert(adapter_slots_table, slots->adapter, slots);
+         }
+         async_rec->adapter_slots = slots;
+      }
+   }
+   return async_rec->adapter_slots;
+}
+
+
+// Called by the thread owning the bus
+static void
+acquire_adapter_slot(Display_Async_Rec * async_rec) {
+   bool debug = false;
+   g_mutex_lock(&adapter_slots_mutex);
+   if (max_adapter_concurrency > 0) {
+      struct Adapter_Slots * slots = get_adapter_slots(async_rec);
+      if (slots) {
+         while (max_adapter_concurrency > 0 && slots->active >= max_adapter_concurrency) {
+            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Waiting for adapter %s", slots->adapter);
+            g_cond_wait(&adapter_slots_cond, &adapter_slots_mutex);
+         }
+         slots->active++;
+         async_rec->holds_adapter_slot = true;
+      }
+   }
+   g_mutex_unlock(&adapter_slots_mutex);
+}
+
+
+// Called by the thread owning the bus
+static void
+release_adapter_slot(Display_Async_Rec * async_rec) {
+   if (async_rec->holds_adapter_slot) {
+      g_mutex_lock(&adapter_slots_mutex);
+      async_rec->adapter_slots->active--;
+      async_rec->holds_adapter_slot = false;
+      g_cond_broadcast(&adapter_slots_cond);
+      g_mutex_unlock(&adapter_slots_mutex);
+   }
+}
+
+
+static inline bool
+higher_priority_waiting(Display_Async_Rec * async_rec, DDCA_IO_Priority priority) {
+   for (int ndx = priority+1; ndx <= DDCA_IO_PRIORITY_INTERACTIVE; ndx++) {
+      if (async_rec->transactions_waiting[ndx] > 0)
+         return true;
+   }
+   return false;
+}
+
+
+/** Waits until the current thread may perform a DDC transaction on a display.
+ *
+ *  Calls may be nested, in which case only the outermost call waits.
+ *  Each call must be paired with a call to #ddc_end_transaction().
+ *
+ *  \param  dh     display handle
+ *  \param  write  true if the transaction only writes to the display
+ */
+void
+ddc_begin_transaction(Display_Handle * dh, bool write) {
+   bool debug = false;
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+
+   DDCA_IO_Priority priority = ddc_get_thread_io_priority();
+   if (write && priority == DDCA_IO_PRIORITY_NORMAL)
+      priority = DDCA_IO_PRIORITY_INTERACTIVE;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, write=%s, priority=%d",
+                                       dh_repr(dh), sbool(write), priority);
+
+   bool unhealthy = (priority == DDCA_IO_PRIORITY_BACKGROUND &&
+                     get_display_health_score(dh->dref) < DISPLAY_HEALTH_UNHEALTHY_SCORE);
+
+   GThread * self = g_thread_self();
+   g_mutex_lock(&async_rec->transaction_lock);
+   if (async_rec->transaction_thread == self) {
+      async_rec->transaction_depth++;
+      g_mutex_unlock(&async_rec->transaction_lock);
+      DBGTRC_DONE(debug, TRACE_GROUP, "Nested, depth=%d", async_rec->transaction_depth);
+      return;
+   }
+
+   while (async_rec->settle_until > cur_monotonic_nanosec()) {
+      uint64_t until = async_rec->settle_until;
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Holding transaction for settle window");
+      g_mutex_unlock(&async_rec->transaction_lock);
+      sleep_until_with_trace(until, __func__, __LINE__, __FILE__, "settle window");
+      g_mutex_lock(&async_rec->transaction_lock);
+   }
+
+   if (unhealthy) {
+      uint64_t start = async_rec->next_background_start;
+      if (start > cur_monotonic_nanosec()) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Deferring background transaction on unhealthy display");
+         g_mutex_unlock(&async_rec->transaction_lock);
+         sleep_until_with_trace(start, __func__, __LINE__, __FILE__, "unhealthy display");
+         g_mutex_lock(&async_rec->transaction_lock);
+      }
+      async_rec->next_background_start =
+            cur_monotonic_nanosec() + DISPLAY_HEALTH_BACKGROUND_INTERVAL_MILLIS * (uint64_t)1000000;
+   }
+
+   async_rec->transactions_waiting[priority]++;
+   while (async_rec->transaction_thread || higher_priority_waiting(async_rec, priority))
+      g_cond_wait(&async_rec->transaction_cond, &async_rec->transaction_lock);
+   async_rec->transactions_waiting[priority]--;
+   async_rec->transaction_thread = self;
+   async_rec->transaction_depth = 1;
+   g_mutex_unlock(&async_rec->transaction_lock);
+
+   // The bus is now owned by this thread.  The adapter slot is acquired only
+   // after the bus, and released before it, so waits cannot form a cycle.
+   acquire_adapter_slot(async_rec);
+
+   // next_transaction_start is only accessed by the owner,
+   // so it is safe to wait without the lock.
+   if (async_rec->next_transaction_start > cur_monotonic_nanosec()) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Rate limited");
+      sleep_until_with_trace(async_rec->next_transaction_start,
+                             __func__, __LINE__, __FILE__, "rate limit");
+   }
+   int rate = max_transaction_rate;
+   async_rec->next_transaction_start = (rate > 0) ? cur_monotonic_nanosec() + 1000000000/rate : 0;
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+}
+
+
+/** Ends a DDC transaction started by #ddc_begin_transaction(),
+ *  allowing the highest priority waiting thread to proceed.
+ *
+ *  \param  dh     display handle
+ */
+void
+ddc_end_transaction(Display_Handle * dh) {
+   bool debug = false;
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   assert(async_rec && memcmp(async_rec->marker, DISPLAY_ASYNC_REC_MARKER, 4) == 0);
+
+   g_mutex_lock(&async_rec->transaction_lock);
+   assert(async_rec->transaction_thread == g_thread_self());
+   if (--async_rec->transaction_depth == 0) {
+      release_adapter_slot(async_rec);
+      async_rec->transaction_thread = NULL;
+      g_cond_broadcast(&async_rec->transaction_cond);
+   }
+   g_mutex_unlock(&async_rec->transaction_lock);
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+}
+
+
+void init_ddc_io_scheduler() {
+   RTTI_ADD_FUNC(ddc_begin_transaction);
+}
@@ -0,0 +1,30 @@
+/** @file ddc_io_scheduler.h
+ *
+ *  Orders the DDC transactions of threads sharing a display
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_IO_SCHEDULER_H_
+#define DDC_IO_SCHEDULER_H_
+
+#include <stdbool.h>
+
+#include "ddcutil_types.h"
+
+#include "base/displays.h"
+
+DDCA_IO_Priority ddc_set_thread_io_priority(DDCA_IO_Priority priority);
+DDCA_IO_Priority ddc_get_thread_io_priority();
+int              ddc_set_max_transaction_rate(int per_sec);
+int              ddc_get_max_transaction_rate();
+int              ddc_set_max_adapter_concurrency(int limit);
+int              ddc_get_max_adapter_concurrency();
+
+void ddc_begin_transaction(Display_Handle * dh, bool write);
+void ddc_end_transaction(Display_Handle * dh);
+
+void init_ddc_io_scheduler();
+
+#endif /* DDC_IO_SCHEDULER_H_ */
@@ -10,6 +10,7 @@
 /** \cond */
 #include <assert.h>
 #include <errno.h>
+#include <glib-2.0/glib.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,15 +18,21 @@
 
 #include "public/ddcutil_types.h"
 
+#include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/timestamp.h"
 /** \endcond */
 
 #include "base/core.h"
 #include "base/ddc_errno.h"
 #include "base/ddc_packets.h"
 #include "base/execution_stats.h"
+#include "base/latency_stats.h"
 #include "base/parms.h"
+#include "base/dynamic_sleep.h"
 #include "base/rtti.h"
+#include "base/stats_export.h"
+#include "base/thread_sleep_data.h"
 #include "base/tuned_sleep.h"
 
 #include "ddc/ddc_packet_io.h"
@@ -37,30 +44,55 @@
 // Trace management
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
 
+// Number of times a capabilities fragment returned with the wrong offset
+// is requested again before the whole read is restarted
+#define MAX_FRAGMENT_OFFSET_RETRIES 3
 
-/** Makes one attempt to read the entire capabilities string or table feature value
+
+// Sleeps between fragments.  When dynamic sleep is enabled, capabilities
+// reads use the per-display learned fragment pacing.
+static void
+sleep_after_fragment(Display_Handle * dh, bool paced) {
+   if (paced) {
+      int millis = DDC_TIMEOUT_MILLIS_BETWEEN_CAP_TABLE_FRAGMENTS * dsa_get_fragment_pacing_factor(dh);
+      SPECIAL_TUNED_SLEEP_WITH_TRACE(dh, (millis > 0) ? millis : 1, "Paced capabilities fragment");
+   }
+   else
+      TUNED_SLEEP_WITH_TRACE(dh, SE_AFTER_EACH_CAP_TABLE_SEGMENT, NULL);
+}
+
+
+/** Makes one attempt to read the remainder of the capabilities string or table feature value
 *
 * @param  dh             display handle for open i2c or adl device
 * @param  request_type   DDC_PACKET_TYPE_CAPABILITIES_REQUEST or DDC_PACKET_TYPE_TABLE_REQD_REQUEST
 * @param  request_subtype  VCP feature code for table read, ignore for capabilities
 * @param  all_zero_response_ok  if true, an all zero response is not regarded
 *         as an error
-* @param  accumulator    buffer in which to return result (already allocated)
+* @param  fragment_func  function to which each fragment is passed
+* @param  context        passed to **fragment_func**
+* @param  offset_loc     on entry, offset at which to resume the read, i.e.
+*                        the number of bytes already passed to fragment_func,
+*                        on return updated to reflect the bytes read
+* @param  rejected_loc   set true if **fragment_func** rejected a fragment
 *
 * @return @Error_Info struct with error detail, NULL if no error
 */
 static Error_Info *
 try_multi_part_read(
-      Display_Handle * dh,
-      Byte             request_type,
-      Byte             request_subtype,
-      bool             all_zero_response_ok,
-      Buffer *         accumulator)
+      Display_Handle *         dh,
+      Byte                     request_type,
+      Byte                     request_subtype,
+      bool                     all_zero_response_ok,
+      Multi_Part_Fragment_Func fragment_func,
+      void *                   context,
+      int *                    offset_loc,
+      bool *                   rejected_loc)
 {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP,
-          "request_type=0x%02x, request_subtype=x%02x, all_zero_response_ok=%s, accumulator=%p",
-          request_type, request_subtype, sbool(all_zero_response_ok), accumulator);
+          "request_type=0x%02x, request_subtype=x%02x, all_zero_response_ok=%s, *offset_loc=%d",
+          request_type, request_subtype, sbool(all_zero_response_ok), *offset_loc);
 
    const int MAX_FRAGMENT_SIZE = 32;
    const int readbuf_size = 6 + MAX_FRAGMENT_SIZE + 1;
@@ -75,9 +107,13 @@ try_multi_part_read(
                            request_subtype,
                            0,
                            "try_multi_part_read");
-   buffer_set_length(accumulator,0);
-   int  cur_offset = 0;
+   int  cur_offset = *offset_loc;          // fragments already read by a previous try
+   if (cur_offset > 0)
+      all_zero_response_ok = false;
    bool complete   = false;
+   bool paced = request_type == DDC_PACKET_TYPE_CAPABILITIES_REQUEST &&
+                tsd_get_thread_sleep_data()->dynamic_sleep_enabled;
+   int  offset_retry_ct = 0;
    while (!complete && !excp) {         // loop over fragments
       DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "Top of fragment loop");
 
@@ -101,10 +137,12 @@ try_multi_part_read(
       DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE,
              "ddc_write_read_with_retry() request_type=0x%02x, request_subtype=0x%02x, returned %s",
              request_type, request_subtype, errinfo_summary(excp));
-      TUNED_SLEEP_WITH_TRACE(dh, SE_AFTER_EACH_CAP_TABLE_SEGMENT, NULL);
+      sleep_after_fragment(dh, paced);
 
       if (excp) {
       // if (psc != 0) {
+         if (paced)
+            dsa_record_fragment_status(dh, false);
          if (response_packet_ptr)
             free_ddc_packet(response_packet_ptr);
          continue;
@@ -125,10 +163,19 @@ try_multi_part_read(
          DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE,
                 "display_current_offset %d != cur_offset %d", display_current_offset, cur_offset);
          psc = DDCRC_MULTI_PART_READ_FRAGMENT;
-         excp = errinfo_new(psc, __func__);
          COUNT_STATUS_CODE(psc);
+         if (paced) {
+            // request the fragment at the current offset again rather than restarting
+            dsa_record_fragment_status(dh, false);
+            if (++offset_retry_ct > MAX_FRAGMENT_OFFSET_RETRIES)
+               excp = errinfo_new(psc, __func__);
+         }
+         else
+            excp = errinfo_new(psc, __func__);
       }
       else {
+         if (paced)
+            dsa_record_fragment_status(dh, true);
          DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "display_current_offset = %d matches cur_offset", display_current_offset);
 
          fragment_size = aux_data_ptr->fragment_length;         // ***
@@ -137,13 +184,19 @@ try_multi_part_read(
             complete = true;   // redundant
          }
          else {
-            buffer_append(accumulator, aux_data_ptr->bytes, fragment_size);
-            cur_offset = cur_offset + fragment_size;
-            if ( IS_TRACING_BY_FUNC_OR_FILE() || debug ) {
-               DBGMSG("Currently assembled fragment: |%.*s|", accumulator->len, accumulator->bytes);
-               DBGMSG("cur_offset = %d", cur_offset);
+            psc = fragment_func(context, cur_offset, aux_data_ptr->bytes, fragment_size);
+            if (psc != 0) {
+               excp = errinfo_new2(psc, __func__, "Fragment at offset %d rejected", cur_offset);
+               *rejected_loc = true;
+            }
+            else {
+               cur_offset = cur_offset + fragment_size;
+               if ( IS_TRACING_BY_FUNC_OR_FILE() || debug ) {
+                  DBGMSG("Current fragment: |%.*s|", fragment_size, aux_data_ptr->bytes);
+                  DBGMSG("cur_offset = %d", cur_offset);
+               }
+               all_zero_response_ok = false;        // accept all zero response only on first fragment
             }
-            all_zero_response_ok = false;           // accept all zero response only on first fragment
          }
       }
       free_ddc_packet(response_packet_ptr);
@@ -151,37 +204,47 @@ try_multi_part_read(
    } // while loop assembling fragments
 
    free_ddc_packet(request_packet_ptr);
+   *offset_loc = cur_offset;
 
-   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, excp, "");
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, excp, "*offset_loc=%d", *offset_loc);
    return excp;
 }
 
 
-/** Gets the DDC capabilities string for a monitor, performing retries if necessary.
- *  Also used for VCP features of type Table.
-*
-*  @param  dh                    handle of open display
-*  @param  request_type
-*  @param  request_subtype       VCP function code for table read, ignore for capabilities
-*  @param  all_zero_response_ok  if true, zero response is not an error
-*  @param  buffer_loc            address at which to return newly allocated #Buffer in which
-*                                result is returned
-*  @retval  NULL    success
-*  @retval  #Ddc_Error containing status DDCRC_UNSUPPORTED does not support Capabilities Request
-*  @retval  #Ddc_Error containing status DDCRC_TRIES  maximum retries exceeded:
-*
-*  *buffer_loc is set iff returned value is NULL
-*/
+/** Reads the capabilities string or the value of a table feature, passing
+ *  each fragment to a function as it arrives, performing retries if necessary.
+ *
+ *  If a try fails, the next try resumes after the last fragment successfully
+ *  received, so no fragment is passed to **fragment_func** twice.  If
+ *  **fragment_func** returns a status code other than 0, the read is
+ *  abandoned without retry and that status code is returned.
+ *
+ *  @param  dh                    handle of open display
+ *  @param  request_type          DDC_PACKET_TYPE_CAPABILITIES_REQUEST or DDC_PACKET_TYPE_TABLE_REQD_REQUEST
+ *  @param  request_subtype       VCP function code for table read, ignore for capabilities
+ *  @param  all_zero_response_ok  if true, zero response is not an error
+ *  @param  fragment_func         function to which each fragment is passed
+ *  @param  context               passed to **fragment_func**
+ *  @param  bytect_loc            if non-null, where to return the total number
+ *                                of bytes passed to **fragment_func**
+ *  @return NULL if success, pointer to #Error_Info if failure
+ *
+ *  @remark
+ *  On failure, the fragments already passed to **fragment_func** are not
+ *  a complete value.
+ */
 Error_Info *
-multi_part_read_with_retry(
-      Display_Handle * dh,
-      Byte             request_type,
-      Byte             request_subtype,   // VCP feature code for table read, ignore for capabilities
-      bool             all_zero_response_ok,
-      Buffer**         buffer_loc)
+multi_part_read_streaming_with_retry(
+      Display_Handle *         dh,
+      Byte                     request_type,
+      Byte                     request_subtype,
+      bool                     all_zero_response_ok,
+      Multi_Part_Fragment_Func fragment_func,
+      void *                   context,
+      int *                    bytect_loc)
 {
    bool debug = false;
-   Retry_Op_Value max_multi_part_read_tries = try_data_get_maxtries2(MULTI_PART_READ_OP);
+   Retry_Op_Value max_multi_part_read_tries = try_data_get_display_maxtries2(dh, MULTI_PART_READ_OP);
    DBGTRC_STARTING(debug, TRACE_GROUP,
           "request_type=0x%02x, request_subtype=0x%02x, all_zero_response_ok=%s"
           ", max_multi_part_read_tries=%d",
@@ -190,26 +253,35 @@ multi_part_read_with_retry(
    Public_Status_Code rc = -1;   // dummy value for first call of while loop
    Error_Info * ddc_excp = NULL;
    Error_Info * try_errors[MAX_MAX_TRIES];
+   uint64_t start_nanos = cur_monotonic_nanosec();
 
    int tryctr = 0;
    bool can_retry = true;
-   Buffer * accumulator = buffer_new(2048, "multi part read buffer");
+   bool rejected = false;
+   int  offset = 0;
 
    while (tryctr < max_multi_part_read_tries && rc < 0 && can_retry) {
       DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE,
              "Start of while loop. try_ctr=%d, max_multi_part_read_tries=%d",
              tryctr, max_multi_part_read_tries);
 
+      // n. offset is not reset, the read resumes after the last good fragment
       ddc_excp = try_multi_part_read(
               dh,
               request_type,
               request_subtype,
               all_zero_response_ok,
-              accumulator);
+              fragment_func,
+              context,
+              &offset,
+              &rejected);
       try_errors[tryctr] = ddc_excp;
       rc = (ddc_excp) ? ddc_excp->status_code : 0;
 
-      if (rc == DDCRC_NULL_RESPONSE || rc == DDCRC_ALL_RESPONSES_NULL) {
+      if (rejected || rc == DDCRC_TIMEOUT || rc == DDCRC_CANCELLED) {
+         can_retry = false;
+      }
+      else if (rc == DDCRC_NULL_RESPONSE || rc == DDCRC_ALL_RESPONSES_NULL) {
          // generally means this, but could conceivably indicate a protocol error.
          // try multiple times to ensure it's really unsupported?
 
@@ -251,9 +323,8 @@ multi_part_read_with_retry(
    }
 
    if (rc < 0) {
-      buffer_free(accumulator, "capabilities buffer, error");
-      accumulator = NULL;
-      if (tryctr >= max_multi_part_read_tries)
+      if (tryctr >= max_multi_part_read_tries && !rejected &&
+          rc != DDCRC_TIMEOUT && rc != DDCRC_CANCELLED)
          rc = DDCRC_RETRIES;
       ddc_excp = errinfo_new_with_causes(rc, try_errors, tryctr, __func__);
 
@@ -268,7 +339,69 @@ multi_part_read_with_retry(
    }
 
    // if counts for DDCRC_ALL_TRIES_ZERO?
-   try_data_record_tries2(MULTI_PART_READ_OP, rc, tryctr);
+   if (!rejected) {
+      try_data_record_display_tries2(dh, MULTI_PART_READ_OP, rc, tryctr);
+      record_display_latency(dh->dref->io_path, DDCA_LATENCY_MULTI_PART_READ,
+                             cur_monotonic_nanosec() - start_nanos);
+   }
+
+   if (bytect_loc)
+      *bytect_loc = offset;
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "bytes read: %d", offset);
+   return ddc_excp;
+}
+
+
+static DDCA_Status
+append_fragment_to_buffer(void * context, int offset, const Byte * bytes, int bytect) {
+   Buffer * accumulator = context;
+   assert(offset == accumulator->len);
+   buffer_append(accumulator, (Byte *) bytes, bytect);
+   return 0;
+}
+
+
+/** Gets the DDC capabilities string for a monitor, performing retries if necessary.
+ *  Also used for VCP features of type Table.
+*
+*  @param  dh                    handle of open display
+*  @param  request_type
+*  @param  request_subtype       VCP function code for table read, ignore for capabilities
+*  @param  all_zero_response_ok  if true, zero response is not an error
+*  @param  buffer_loc            address at which to return newly allocated #Buffer in which
+*                                result is returned
+*  @retval  NULL    success
+*  @retval  #Ddc_Error containing status DDCRC_UNSUPPORTED does not support Capabilities Request
+*  @retval  #Ddc_Error containing status DDCRC_TRIES  maximum retries exceeded:
+*
+*  *buffer_loc is set iff returned value is NULL
+*/
+Error_Info *
+multi_part_read_with_retry(
+      Display_Handle * dh,
+      Byte             request_type,
+      Byte             request_subtype,   // VCP feature code for table read, ignore for capabilities
+      bool             all_zero_response_ok,
+      Buffer**         buffer_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP,
+          "request_type=0x%02x, request_subtype=0x%02x, all_zero_response_ok=%s",
+          request_type, request_subtype, sbool(all_zero_response_ok));
+
+   Buffer * accumulator = buffer_new(2048, "multi part read buffer");
+   Error_Info * ddc_excp = multi_part_read_streaming_with_retry(
+                              dh,
+                              request_type,
+                              request_subtype,
+                              all_zero_response_ok,
+                              append_fragment_to_buffer,
+                              accumulator,
+                              NULL);
+   if (ddc_excp) {
+      buffer_free(accumulator, "capabilities buffer, error");
+      accumulator = NULL;
+   }
 
    *buffer_loc = accumulator;
    ASSERT_IFF(ddc_excp, !*buffer_loc);
@@ -279,36 +412,114 @@ multi_part_read_with_retry(
 }
 
 
-/** Makes one attempt to write an entire VCP Table value
+//
+// Table write throughput
+//
+
+static GMutex   write_stats_mutex;         // protects the following
+static int      write_stats_tables = 0;    // successful table writes
+static uint64_t write_stats_bytes  = 0;
+static uint64_t write_stats_nanos  = 0;
+static int      write_stats_fragment_retries = 0;   // fragments resumed after a failed try
+
+
+static void
+record_multi_part_write(int bytect, uint64_t elapsed_nanos) {
+   g_mutex_lock(&write_stats_mutex);
+   write_stats_tables++;
+   write_stats_bytes += bytect;
+   write_stats_nanos += elapsed_nanos;
+   g_mutex_unlock(&write_stats_mutex);
+}
+
+
+/** Reports table write throughput.
+ *
+ *  @param depth  logical indentation depth
+ */
+void report_multi_part_write_stats(int depth) {
+   g_mutex_lock(&write_stats_mutex);
+   int      tables  = write_stats_tables;
+   uint64_t bytes   = write_stats_bytes;
+   uint64_t nanos   = write_stats_nanos;
+   int      retries = write_stats_fragment_retries;
+   g_mutex_unlock(&write_stats_mutex);
+
+   if (tables > 0) {
+      int d1 = depth+1;
+      rpt_title("Table Write Stats:", depth);
+      rpt_vstring(d1, "Table values written:                           %10d", tables);
+      rpt_vstring(d1, "Bytes written:                                  %10"PRIu64, bytes);
+      rpt_vstring(d1, "Fragments retried at their offset:              %10d", retries);
+      if (nanos > 0)
+         rpt_vstring(d1, "Throughput (bytes per second):                  %10.1f",
+                         bytes / (nanos / 1e9));
+      rpt_nl();
+   }
+}
+
+
+/** Exports table write throughput.
+ *
+ *  @param exp  export instance
+ */
+void export_multi_part_write_stats(Stats_Export * exp) {
+   g_mutex_lock(&write_stats_mutex);
+   uint64_t bytes = write_stats_bytes;
+   uint64_t nanos = write_stats_nanos;
+   g_mutex_unlock(&write_stats_mutex);
+
+   stats_export_metric(exp, "ddcutil_table_write_bytes_total", STATS_METRIC_COUNTER,
+                            "Bytes written to table features");
+   stats_export_sample(exp, "ddcutil_table_write_bytes_total", bytes, 0);
+   stats_export_metric(exp, "ddcutil_table_write_seconds_total", STATS_METRIC_COUNTER,
+                            "Time spent writing table features, including retries");
+   stats_export_sample(exp, "ddcutil_table_write_seconds_total", nanos / 1e9, 0);
+}
+
+
+/** Makes one attempt to write the remainder of a VCP Table value
 *
 *   @param dh             display handle for open i2c or adl device
 *   @param vcp_code       VCP feature code
-*   @param value_to_set   Table feature value
+*   @param bytes          Table feature value
+*   @param bytect         number of bytes
+*   @param offset_loc     on entry, offset at which to resume the write, i.e.
+*                         the number of bytes already written, on return
+*                         updated to reflect the bytes written
 *
 *   @return status code
+*
+*   @remark
+*   On failure **offset_loc** is the offset of the fragment that failed, so
+*   the next try writes that fragment again instead of starting over.
 */
 static Error_Info *
 try_multi_part_write(
       Display_Handle * dh,
       Byte             vcp_code,
-      Buffer *         value_to_set)
+      const Byte *     bytes,
+      int              bytect,
+      int *            offset_loc)
 {
    bool debug = false;
    Byte request_type = DDC_PACKET_TYPE_TABLE_WRITE_REQUEST;
    Byte request_subtype = vcp_code;
    DBGTRC_STARTING(debug, TRACE_GROUP,
-          "request_type=0x%02x, request_subtype=x%02x, accumulator=%p",
-          request_type, request_subtype, value_to_set);
+          "request_type=0x%02x, request_subtype=x%02x, bytect=%d, *offset_loc=%d",
+          request_type, request_subtype, bytect, *offset_loc);
 
    Public_Status_Code psc = 0;
    Error_Info * ddc_excp = NULL;
    int MAX_FRAGMENT_SIZE = 32;
    int max_fragment_size = MAX_FRAGMENT_SIZE - 4;    // hack
    // const int writebbuf_size = 6 + MAX_FRAGMENT_SIZE + 1;
+   // fragment sleeps are paced in ddc_i2c_write_only()
+   bool paced = tsd_get_thread_sleep_data()->dynamic_sleep_enabled;
 
    DDC_Packet * request_packet_ptr  = NULL;
-   int bytes_remaining = value_to_set->len;
-   int offset = 0;
+   int offset = *offset_loc;
+   int bytes_remaining = bytect - offset;
    while (bytes_remaining >= 0 && psc == 0) {
       int bytect_to_write = (bytes_remaining <= max_fragment_size)
                                     ? bytes_remaining
@@ -317,13 +528,15 @@ try_multi_part_write(
                    DDC_PACKET_TYPE_TABLE_WRITE_REQUEST,
                    vcp_code,       // request_subtype,
                    offset,
-                   value_to_set->bytes+offset,
+                   (Byte *) bytes+offset,
                    bytect_to_write,
                    __func__);
       ddc_excp = ddc_write_only_with_retry(dh, request_packet_ptr);
       psc = (ddc_excp) ? ddc_excp->status_code : 0;
       free_ddc_packet(request_packet_ptr);
       assert( (!ddc_excp && psc == 0) || (ddc_excp && psc!=0) );
+      if (paced)
+         dsa_record_fragment_status(dh, !ddc_excp);
 
       if (!ddc_excp) {
          if (bytect_to_write == 0)   // if just wrote final empty segment to indicate done
@@ -332,27 +545,30 @@ try_multi_part_write(
          bytes_remaining -= bytect_to_write;
       }
    }
+   *offset_loc = offset;
 
-   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "*offset_loc=%d", *offset_loc);
    assert( (ddc_excp && psc<0) || (!ddc_excp && psc==0) );
    return ddc_excp;
 }
 
 
-/** Writes a VCP table feature, with retry.
+/** Writes a VCP table feature directly from a caller's byte array, with retry.
  *
- * @param  dh display handle
- * @param vcp_code  VCP feature code to write
- * @param value_to_set bytes of Table feature
+ * @param  dh        display handle
+ * @param  vcp_code  VCP feature code to write
+ * @param  bytes     bytes of Table feature
+ * @param  bytect    number of bytes
  * @return  NULL if success, pointer to #Ddc_Error if failure
  */
 Error_Info *
-multi_part_write_with_retry(
+multi_part_write_bytes_with_retry(
      Display_Handle * dh,
      Byte             vcp_code,
-     Buffer *         value_to_set)
+     const Byte *     bytes,
+     int              bytect)
 {
-   Retry_Op_Value max_multi_part_write_tries = try_data_get_maxtries2(MULTI_PART_WRITE_OP);
+   Retry_Op_Value max_multi_part_write_tries = try_data_get_display_maxtries2(dh, MULTI_PART_WRITE_OP);
    bool debug = false;
    if (IS_TRACING())
       puts("");
@@ -366,21 +582,32 @@ multi_part_write_with_retry(
 
    int tryctr = 0;
    bool can_retry = true;
+   int offset = 0;     // a failed try resumes at the fragment that failed
+   uint64_t start_nanos = cur_monotonic_nanosec();
 
    while (tryctr < max_multi_part_write_tries && rc < 0 && can_retry) {
       DBGTRC_NOPREFIX(debug, TRACE_GROUP,
-             "Start of while loop. try_ctr=%d, max_multi_part_write_tries=%d",
-             tryctr, max_multi_part_write_tries);
+             "Start of while loop. try_ctr=%d, max_multi_part_write_tries=%d, offset=%d",
+             tryctr, max_multi_part_write_tries, offset);
+      if (tryctr > 0) {
+         g_mutex_lock(&write_stats_mutex);
+         write_stats_fragment_retries++;
+         g_mutex_unlock(&write_stats_mutex);
+      }
 
       ddc_excp = try_multi_part_write(
               dh,
               vcp_code,
-              value_to_set);
+              bytes,
+              bytect,
+              &offset);
       try_errors[tryctr] = ddc_excp;
       rc = (ddc_excp) ? ddc_excp->status_code : 0;
       assert( (ddc_excp && rc<0) || (!ddc_excp && rc==0) );
 
       // TODO: What rc values set can_retry = false?
+      if (rc == DDCRC_TIMEOUT || rc == DDCRC_CANCELLED)
+         can_retry = false;
 
       tryctr++;
    }
@@ -399,6 +626,7 @@ multi_part_write_with_retry(
          // errinfo_free(try_errors[ndx]);
          ERRINFO_FREE_WITH_REPORT(try_errors[ndx], debug || IS_TRACING() || report_freed_exceptions);
       }
+      record_multi_part_write(bytect, cur_monotonic_nanosec() - start_nanos);
    }
 
    DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
@@ -406,10 +634,29 @@ multi_part_write_with_retry(
 }
 
 
+/** Writes a VCP table feature, with retry.
+ *
+ * @param  dh display handle
+ * @param vcp_code  VCP feature code to write
+ * @param value_to_set bytes of Table feature
+ * @return  NULL if success, pointer to #Ddc_Error if failure
+ */
+Error_Info *
+multi_part_write_with_retry(
+     Display_Handle * dh,
+     Byte             vcp_code,
+     Buffer *         value_to_set)
+{
+   return multi_part_write_bytes_with_retry(dh, vcp_code, value_to_set->bytes, value_to_set->len);
+}
+
+
 static inline void init_ddc_multi_part_io_func_name_table() {
 #define ADD_FUNC(_NAME) rtti_func_name_table_add(_NAME, #_NAME);
    ADD_FUNC(try_multi_part_read);
    ADD_FUNC(multi_part_read_with_retry);
+   ADD_FUNC(multi_part_read_streaming_with_retry);
+   ADD_FUNC(multi_part_write_bytes_with_retry);
 #undef ADD_FUNC
 }
 
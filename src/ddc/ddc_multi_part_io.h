@@ -18,9 +18,34 @@
 /** \endcond */
 
 #include "base/displays.h"
+#include "base/stats_export.h"
 #include "base/status_code_mgt.h"
 
 
+/** Receives one fragment of a multi-part read.
+ *
+ *  @param  context  pointer passed by the caller of the read
+ *  @param  offset   offset of the fragment within the value
+ *  @param  bytes    fragment bytes, valid only for the duration of the call
+ *  @param  bytect   number of bytes in fragment
+ *  @return 0 to continue, other status code to abandon the read
+ */
+typedef DDCA_Status (*Multi_Part_Fragment_Func)(
+      void *       context,
+      int          offset,
+      const Byte * bytes,
+      int          bytect);
+
+Error_Info *
+multi_part_read_streaming_with_retry(
+   Display_Handle *         dh,
+   Byte                     request_type,
+   Byte                     request_subtype,
+   bool                     all_zero_response_ok,
+   Multi_Part_Fragment_Func fragment_func,
+   void *                   context,
+   int *                    bytect_loc);
+
 Error_Info *
 multi_part_read_with_retry(
    Display_Handle * dh,
@@ -35,6 +60,16 @@ multi_part_write_with_retry(
      Byte             vcp_code,
      Buffer *         value_to_set);
 
+Error_Info *
+multi_part_write_bytes_with_retry(
+     Display_Handle * dh,
+     Byte             vcp_code,
+     const Byte *     bytes,
+     int              bytect);
+
+void report_multi_part_write_stats(int depth);
+void export_multi_part_write_stats(Stats_Export * exp);
+
 void
 init_ddc_multi_part_io();
 
@@ -0,0 +1,274 @@
+/** @file ddc_multiplexed_io.c
+ *
+ *  Reads a non-table VCP feature from multiple displays using a single
+ *  thread.
+ *
+ *  Each display is driven by a small state machine: write the Get VCP
+ *  Feature request, wait until the write-to-read deadline, then read and
+ *  validate the response, retrying as necessary.  Instead of sleeping after
+ *  each step, the deadline for the display is recorded (see
+ *  #tuned_sleep_deadline()), and the thread services whichever display is
+ *  ready next.  It only sleeps when no display is ready, so N displays need
+ *  one thread rather than N.
+ *
+ *  The individual I2C operations are still blocking ioctl() calls, since
+ *  i2c-dev supports neither nonblocking IO nor poll(), but each one only
+ *  takes as long as the bytes take to cross the bus.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/error_info.h"
+#include "util/string_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/ddc_errno.h"
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+#include "base/dynamic_sleep.h"
+#include "base/execution_stats.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/sleep.h"
+#include "base/tuned_sleep.h"
+
+#include "i2c/i2c_strategy_dispatcher.h"
+
+#include "ddc/ddc_settle_window.h"
+#include "ddc/ddc_try_stats.h"
+#include "ddc/ddc_vcp.h"
+
+#include "ddc/ddc_multiplexed_io.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDCIO;
+
+// (src addr == x6e) (length) (response contents) (checkbyte), +1 for double 0x6e quirk
+#define MUX_READ_BYTES  12
+
+#define MUX_NULL_RESPONSE_MAX 3
+
+typedef enum {
+   MUX_WRITE,            // next step is to write the request
+   MUX_READ,             // request written, next step is to read the response
+   MUX_DONE
+} Mux_State;
+
+/** Progress of the read for one display */
+typedef struct {
+   Multiplexed_Getvcp_Request * request;
+   Mux_State                    state;
+   int                          tryctr;
+   int                          max_tries;
+   int                          null_response_ct;
+   Error_Info *                 try_errors[MAX_MAX_TRIES];
+} Mux_Display_State;
+
+
+static void
+mux_finish(Mux_Display_State * mds, DDCA_Status psc) {
+   Display_Handle * dh = mds->request->dh;
+   if (psc != 0) {
+      assert(!mds->request->excp);
+      mds->request->excp = errinfo_new_with_causes(psc, mds->try_errors, mds->tryctr, __func__);
+   }
+   else {
+      for (int ndx = 0; ndx < mds->tryctr-1; ndx++)
+         errinfo_free(mds->try_errors[ndx]);
+   }
+   try_data_record_display_tries2(dh, WRITE_READ_TRIES_OP, psc, mds->tryctr);
+   mds->state = MUX_DONE;
+}
+
+
+/** Performs the next step of the read for one display.
+ *
+ *  @param mds             display state
+ *  @param request_packet  Get VCP Feature request
+ *  @param feature_code    VCP feature code
+ */
+static void
+mux_step(
+      Mux_Display_State *   mds,
+      DDC_Packet *          request_packet,
+      DDCA_Vcp_Feature_Code feature_code)
+{
+   bool debug = false;
+   Display_Handle * dh = mds->request->dh;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, state=%d, tryctr=%d",
+                                       dh_repr(dh), mds->state, mds->tryctr);
+
+   Status_Errno_DDC rc = 0;
+   Byte readbuf[MUX_READ_BYTES];
+   bool read_performed = false;
+
+   if (mds->state == MUX_WRITE) {
+      mds->tryctr++;
+      if (dh->dref->flags & DREF_I2C_COMBINED_WRITE_READ) {
+         rc = invoke_i2c_write_reader(
+                 dh->fd,
+                 0x37,
+                 get_packet_len(request_packet)-1,
+                 get_packet_start(request_packet)+1,
+                 MUX_READ_BYTES,
+                 readbuf);
+         read_performed = true;
+      }
+      else {
+         rc = invoke_i2c_writer(
+                 dh->fd,
+                 0x37,
+                 get_packet_len(request_packet)-1,
+                 get_packet_start(request_packet)+1);
+         if (rc == 0) {
+            tuned_sleep_deadline(dh, SE_WRITE_TO_READ);
+            mds->state = MUX_READ;
+            DBGTRC_DONE(debug, TRACE_GROUP, "Request written");
+            return;
+         }
+      }
+   }
+   else {
+      assert(mds->state == MUX_READ);
+      rc = invoke_i2c_reader(dh->fd, 0x37, false, MUX_READ_BYTES, readbuf);
+      read_performed = true;
+   }
+
+   if (read_performed) {
+      tuned_sleep_deadline(dh, SE_POST_READ);
+      if (rc == 0 && all_bytes_zero(readbuf, MUX_READ_BYTES))
+         rc = DDCRC_READ_ALL_ZERO;
+   }
+
+   DDC_Packet * response_packet = NULL;
+   if (rc == 0) {
+      rc = create_ddc_typed_response_packet(
+              readbuf,
+              MUX_READ_BYTES,
+              DDC_PACKET_TYPE_QUERY_VCP_RESPONSE,
+              feature_code,
+              __func__,
+              &response_packet);
+      if (rc != 0 && response_packet) {
+         free_ddc_packet(response_packet);
+         response_packet = NULL;
+      }
+   }
+   if (!ddc_is_settle_probe(dh))
+      dsa_record_ddcrw_status_code(dh, rc);
+
+   if (rc == 0) {
+      mds->request->excp = ddc_interpret_nontable_vcp_response(
+                              dh, feature_code, response_packet, &mds->request->response);
+      free_ddc_packet(response_packet);
+      mux_finish(mds, 0);
+      DBGTRC_DONE(debug, TRACE_GROUP, "Response received: %s", errinfo_summary(mds->request->excp));
+      return;
+   }
+
+   COUNT_RETRYABLE_STATUS_CODE(rc);
+   mds->try_errors[mds->tryctr-1] = errinfo_new(rc, __func__);
+   bool retryable = (rc != -EBADF && rc != -ENXIO);
+   if (rc == DDCRC_NULL_RESPONSE) {
+      retryable = !(dh->dref->flags & DREF_DDC_USES_NULL_RESPONSE_FOR_UNSUPPORTED) &&
+                  ++mds->null_response_ct < MUX_NULL_RESPONSE_MAX;
+      if (retryable)
+         tuned_sleep_deadline(dh, SE_DDC_NULL);   // extended delay before retry
+   }
+   if (retryable && mds->tryctr < mds->max_tries)
+      mds->state = MUX_WRITE;
+   else
+      mux_finish(mds, (retryable) ? DDCRC_RETRIES : rc);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "rc=%s, state=%d", psc_desc(rc), mds->state);
+}
+
+
+/** Reads a non-table VCP feature from multiple displays, interleaving the
+ *  DDC exchanges of all displays in the current thread.
+ *
+ *  The result for each display is returned in its request: either a parsed
+ *  response or an #Error_Info, as #ddc_get_nontable_vcp_value() would
+ *  return.  USB displays are read synchronously.
+ *
+ *  @param  requests      array of requests, one per open display
+ *  @param  request_ct    number of requests
+ *  @param  feature_code  VCP feature code
+ */
+void
+ddc_multiplexed_get_nontable_vcp_values(
+      Multiplexed_Getvcp_Request * requests,
+      int                          request_ct,
+      DDCA_Vcp_Feature_Code        feature_code)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "request_ct=%d, feature_code=0x%02x", request_ct, feature_code);
+
+   DDC_Packet * request_packet =
+         create_ddc_getvcp_request_packet(feature_code, "ddc_multiplexed_get_nontable_vcp_values");
+   Mux_Display_State * states = calloc(request_ct, sizeof(Mux_Display_State));
+   for (int ndx = 0; ndx < request_ct; ndx++) {
+      Mux_Display_State * mds = &states[ndx];
+      Multiplexed_Getvcp_Request * request = &requests[ndx];
+      request->response = NULL;
+      request->excp = NULL;
+      mds->request = request;
+      mds->state = MUX_DONE;
+      Display_Handle * dh = request->dh;
+      if (dh->dref->io_path.io_mode != DDCA_IO_I2C) {
+         request->excp = ddc_get_nontable_vcp_value(dh, feature_code, &request->response);
+      }
+      else if (ddc_is_known_unsupported_feature(dh->dref, feature_code)) {
+         request->excp = errinfo_new2(DDCRC_DETERMINED_UNSUPPORTED, __func__, "Cached");
+      }
+      else {
+         mds->state = MUX_WRITE;
+         mds->max_tries = try_data_get_display_maxtries2(dh, WRITE_READ_TRIES_OP);
+      }
+   }
+
+   for (;;) {
+      int active_ct = 0;
+      uint64_t next_deadline = UINT64_MAX;
+      for (int ndx = 0; ndx < request_ct; ndx++) {
+         Mux_Display_State * mds = &states[ndx];
+         if (mds->state == MUX_DONE)
+            continue;
+         uint64_t deadline = deferred_sleep_deadline(mds->request->dh);
+         if (deadline <= cur_monotonic_nanosec()) {
+            mux_step(mds, request_packet, feature_code);
+            if (mds->state == MUX_DONE)
+               continue;
+            deadline = deferred_sleep_deadline(mds->request->dh);
+         }
+         active_ct++;
+         if (deadline < next_deadline)
+            next_deadline = deadline;
+      }
+      if (active_ct == 0)
+         break;
+      if (next_deadline > cur_monotonic_nanosec())
+         sleep_until_with_trace(next_deadline, __func__, __LINE__, __FILE__, "multiplexed");
+   }
+
+   free(states);
+   free_ddc_packet(request_packet);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+void init_ddc_multiplexed_io() {
+   RTTI_ADD_FUNC(mux_step);
+   RTTI_ADD_FUNC(ddc_multiplexed_get_nontable_vcp_values);
+}
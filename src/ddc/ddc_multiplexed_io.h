@@ -0,0 +1,34 @@
+/** @file ddc_multiplexed_io.h
+ *
+ *  Reads a VCP feature from multiple displays using a single thread
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_MULTIPLEXED_IO_H_
+#define DDC_MULTIPLEXED_IO_H_
+
+#include "ddcutil_types.h"
+
+#include "util/error_info.h"
+
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+
+/** One display in a multiplexed read */
+typedef struct {
+   Display_Handle *               dh;         ///< open display
+   Parsed_Nontable_Vcp_Response * response;   ///< set if success, caller must free
+   Error_Info *                   excp;       ///< set if failure, caller must free
+} Multiplexed_Getvcp_Request;
+
+void
+ddc_multiplexed_get_nontable_vcp_values(
+      Multiplexed_Getvcp_Request * requests,
+      int                          request_ct,
+      DDCA_Vcp_Feature_Code        feature_code);
+
+void init_ddc_multiplexed_io();
+
+#endif /* DDC_MULTIPLEXED_IO_H_ */
@@ -15,15 +15,18 @@
 #include <time.h>
 
 #include "util/error_info.h"
+#include "util/json_writer.h"
 #include "util/report_util.h"
 /** \endcond */
 
 #include "base/ddc_errno.h"
 #include "base/ddc_packets.h"
 #include "base/linux_errno.h"
+#include "base/monitor_quirks.h"
 #include "base/parms.h"
 #include "base/rtti.h"
 #include "base/sleep.h"
+#include "base/tuned_sleep.h"
 
 #include "i2c/i2c_bus_core.h"
 #include "i2c/i2c_strategy_dispatcher.h"
@@ -34,10 +37,12 @@
 #endif
 
 #include "vcp/parse_capabilities.h"
+#include "vcp/persistent_capabilities.h"
 
 #include "dynvcp/dyn_feature_set.h"
 #include "dynvcp/dyn_feature_codes.h"
 
+#include "ddc/ddc_feature_scan.h"
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_vcp.h"
@@ -462,6 +467,11 @@ collect_raw_feature_set_values2_dfm(
    // needed when called from C API, o.w. get get NULL response for first feature
    // DBGMSG("Inserting sleep() before first call to get_raw_value_for_feature_table_entry()");
    // sleep_millis_with_trace(DDC_TIMEOUT_MILLIS_DEFAULT, __func__, "initial");
+
+   // Each read is immediately followed by the next, so defer the post-read
+   // sleep until the next request is written, overlapping it with the
+   // processing of the current value.
+   bool old_thread_deferral = enable_deferred_sleep_for_thread(true);
    int ndx;
    for (ndx=0; ndx< features_ct; ndx++) {
       Display_Feature_Metadata * dfm = dyn_get_feature_set_entry(feature_set, ndx);
@@ -496,6 +506,7 @@ collect_raw_feature_set_values2_dfm(
          break;
       }
    }
+   enable_deferred_sleep_for_thread(old_thread_deferral);
 
    DBGMSF(debug, "Done.  Returning: %s", psc_desc(master_status_code));
    return master_status_code;
@@ -737,13 +748,125 @@ ddc_get_formatted_value_for_dfm(
 }
 
 
+/** Queries the monitor for a VCP feature value, and writes it as a
+ *  JSON object.
+ *
+ *  The object contains the feature code and name, the value type ("C",
+ *  "SNC", "CNC" or "T" as in terse output), the raw value, and the value
+ *  formatted as in normal output.  If the value cannot be read, the
+ *  object instead contains the status code name.
+ *
+ * \param  dh         handle for open display
+ * \param  dfm        feature metadata
+ * \param  suppress_unsupported
+ *                    if true, do not write anything for unsupported features
+ * \param  jw         JSON writer
+ * \return status code
+ */
+Public_Status_Code
+ddc_json_value_for_dfm(
+      Display_Handle *            dh,
+      Display_Feature_Metadata *  dfm,
+      bool                        suppress_unsupported,
+      Json_Writer *               jw)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "feature_code=0x%02x, suppress_unsupported=%s",
+                                       dfm->feature_code, sbool(suppress_unsupported));
+
+   Public_Status_Code psc = 0;
+   DDCA_Any_Vcp_Value * pvalrec = NULL;
+   if ( !(dfm->feature_flags & DDCA_READABLE) ) {
+      psc = DDCRC_INVALID_OPERATION;
+   }
+   else {
+      Error_Info * ddc_excp = get_raw_value_for_feature_metadata(
+                                 dh, dfm, suppress_unsupported, &pvalrec, NULL);
+      psc = ERRINFO_STATUS(ddc_excp);
+      ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING() || report_freed_exceptions);
+   }
+
+   bool unsupported = (psc == DDCRC_REPORTED_UNSUPPORTED || psc == DDCRC_DETERMINED_UNSUPPORTED);
+   if ( !(unsupported && suppress_unsupported) ) {
+      json_begin_object(jw);
+      json_key_int(jw, "feature_code", dfm->feature_code);
+      json_key_string(jw, "name", dfm->feature_name);
+      if (psc == DDCRC_INVALID_OPERATION) {
+         json_key_string(jw, "status", psc_name(psc));
+         json_key_string(jw, "detail",
+                         (dfm->feature_flags & DDCA_DEPRECATED) ? "Deprecated" : "Write-only feature");
+      }
+      else if (psc != 0) {
+         json_key_string(jw, "status", psc_name(psc));
+      }
+      else {
+         DDCA_Version_Feature_Flags vflags = dfm->feature_flags;
+         char * type = "T";
+         if (pvalrec->value_type == DDCA_NON_TABLE_VCP_VALUE)
+            type = (vflags & DDCA_CONT) ? "C" : (vflags & DDCA_SIMPLE_NC) ? "SNC" : "CNC";
+         json_key_string(jw, "type", type);
+         write_json_single_vcp_value_members(jw, pvalrec);
+         char * formatted_data = NULL;
+         if (dyn_format_feature_detail(dfm, get_vcp_version_by_dh(dh), pvalrec, &formatted_data)) {
+            json_key_string(jw, "formatted", formatted_data);
+            free(formatted_data);
+         }
+      }
+      json_end_object(jw);
+   }
+
+   if (pvalrec)
+      free_single_vcp_value(pvalrec);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, psc, "");
+   return psc;
+}
+
+
+/** Gets the features listed in the capabilities string of a display,
+ *  if the string is available without DDC I/O, i.e. it has already been
+ *  read or it is in the persistent capabilities cache.
+ *
+ *  @param  dh        display handle
+ *  @param  features  where to return the feature codes
+ *  @return true if the capabilities can be used to select features
+ */
+static bool
+get_capabilities_features_without_io(Display_Handle * dh, Bit_Set_256 * features) {
+   bool debug = false;
+   Display_Ref * dref = dh->dref;
+   bool result = false;
+   Monitor_Quirk_Data * quirk = (dref->mmid) ? get_monitor_quirks(dref->mmid) : NULL;
+   if (quirk && (quirk->quirk_type & MQ_UNRELIABLE_CAPABILITIES)) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Capabilities string of %s is unreliable", dref_repr_t(dref));
+   }
+   else {
+      char * caps = dref->capabilities_string;
+      if (!caps && dref->io_path.io_mode == DDCA_IO_I2C)
+         caps = get_persistent_capabilities(dref->mmid, (dref->pedid) ? dref->pedid->bytes : NULL);
+      if (caps) {
+         Parsed_Capabilities * pcaps = parse_capabilities_string(caps);
+         if (pcaps->caps_validity != CAPABILITIES_INVALID) {
+            *features = get_parsed_capabilities_feature_ids(pcaps, false);
+            result = !bs256_eq(*features, EMPTY_BIT_SET_256);
+         }
+         free_parsed_capabilities(pcaps);
+      }
+   }
+   DBGTRC(debug, TRACE_GROUP, "dh=%s, returning %s, features: %s", dh_repr(dh), sbool(result),
+                              (result) ? bs256_to_string(*features, "x", " ") : "");
+   return result;
+}
+
+
 Public_Status_Code
 show_feature_set_values2_dfm(
       Display_Handle *      dh,
       Dyn_Feature_Set*      feature_set,
       GPtrArray *           collector,     // if null, write to current stdout device
       Feature_Set_Flags     flags,
-      Bit_Set_256 *         features_seen)     // if non-null, collect list of features seen
+      Bit_Set_256 *         features_seen,     // if non-null, collect list of features seen
+      Bit_Set_256 *         caps_features,     // if non-null, skip other features not user defined
+      Json_Writer *         jw)                // if non-null, write values as JSON
 {
    bool debug = false;
    char * s0 = feature_set_flag_names_t(flags);
@@ -776,7 +899,25 @@ show_feature_set_values2_dfm(
       Display_Feature_Metadata * dfm = dyn_get_feature_set_entry(feature_set, ndx);
       // DDCA_Feature_Metadata * extmeta = ifm->external_metadata;
       DBGMSF(debug,"ndx=%d, feature = 0x%02x", ndx, dfm->feature_code);
-      if ( !(dfm->feature_flags & DDCA_READABLE) ) {
+      if (caps_features && !bs256_contains(*caps_features, dfm->feature_code) &&
+          !(dfm->feature_flags & DDCA_USER_DEFINED))
+      {
+         continue;
+      }
+      if (jw) {
+         if (dfm->feature_flags & DDCA_READABLE) {
+            Public_Status_Code psc = ddc_json_value_for_dfm(dh, dfm, suppress_unsupported, jw);
+            if (psc == 0 && features_seen)
+               *features_seen = bs256_insert(*features_seen, dfm->feature_code);
+            if ( psc != 0 && psc != DDCRC_REPORTED_UNSUPPORTED &&
+                 psc != DDCRC_DETERMINED_UNSUPPORTED && master_status_code == 0)
+               master_status_code = psc;
+         }
+         else if (show_unsupported) {
+            ddc_json_value_for_dfm(dh, dfm, suppress_unsupported, jw);
+         }
+      }
+      else if ( !(dfm->feature_flags & DDCA_READABLE) ) {
          // confuses the output if suppressing unsupported
          if (show_unsupported) {
             char * feature_name =  dfm->feature_name;
@@ -810,8 +951,13 @@ show_feature_set_values2_dfm(
             if (psc == 0) {
                if (collector)
                   g_ptr_array_add(collector, formatted_value);
-               else
+               else {
                   f0printf(outf, "%s\n", formatted_value);
+                  // stdout is fully buffered when piped; make each value visible
+                  // as soon as it is read rather than when the command ends
+                  if (outf)
+                     fflush(outf);
+               }
                free(formatted_value);
                if (features_seen)
                   *features_seen = bs256_insert(*features_seen, dfm->feature_code);  // note that feature was read
@@ -864,6 +1010,7 @@ bool hack42(VCP_Feature_Table_Entry * ventry) {
  *  @param  collector  accumulates output    // if null, write to current stdout device
  *  @param  flags      feature set flags
  *  @param  features_seen   collects ids of features that exist
+ *  @param  jw         if non-null, write values as JSON instead of text
  *  @return status code
  */
 // 11/2019: only call is from app_getvcp.c, move there?
@@ -873,7 +1020,8 @@ ddc_show_vcp_values(
         VCP_Feature_Subset  subset,
         GPtrArray *         collector,    // not used
         Feature_Set_Flags   flags,
-        Bit_Set_256 *       features_seen)
+        Bit_Set_256 *       features_seen,
+        Json_Writer *       jw)
 {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "subset=%d, flags=%s,  dh=%s",
@@ -884,10 +1032,20 @@ ddc_show_vcp_values(
    // DDCA_MCCS_Version_Spec vcp_version = get_vcp_version_by_dh(dh);
    // DBGMSG("VCP version = %d.%d", vcp_version.major, vcp_version.minor);
 
+   // FSF_CAPS_ONLY does not change the cached feature set, the features are skipped when read
    Dyn_Feature_Set* feature_set = dyn_create_feature_set(
                                     subset,
                                     dh->dref,   // vcp_version,
-                                    flags);
+                                    flags & ~FSF_CAPS_ONLY);
+
+   Bit_Set_256   caps_features_set = EMPTY_BIT_SET_256;
+   Bit_Set_256 * caps_features = NULL;
+   if ( (flags & FSF_CAPS_ONLY) &&
+        (subset == VCP_SUBSET_KNOWN || subset == VCP_SUBSET_SCAN) &&
+        get_capabilities_features_without_io(dh, &caps_features_set) )
+   {
+      caps_features = &caps_features_set;
+   }
 
 #ifdef FUTURE
    Parsed_Capabilities * pcaps = NULL;   // TODO: HOW TO GET Parsed_Capabilities?, will only be set for probe/interrogate
@@ -903,8 +1061,22 @@ ddc_show_vcp_values(
       DBGMSG("feature_set:");
       dbgrpt_dyn_feature_set(feature_set, true, 0);
    }
+   if (subset == VCP_SUBSET_SCAN && dh->dref->io_path.io_mode == DDCA_IO_I2C) {
+      // Determine cheaply which non-table features are unsupported, so that reading
+      // them below fails immediately instead of paying the full retry cost
+      Bit_Set_256 candidates = EMPTY_BIT_SET_256;
+      int features_ct = dyn_get_feature_set_size(feature_set);
+      for (int ndx = 0; ndx < features_ct; ndx++) {
+         Display_Feature_Metadata * dfm = dyn_get_feature_set_entry(feature_set, ndx);
+         if ( (dfm->feature_flags & DDCA_READABLE) && !(dfm->feature_flags & DDCA_TABLE) )
+            candidates = bs256_insert(candidates, dfm->feature_code);
+      }
+      if (caps_features)
+         candidates = bs256_and(candidates, *caps_features);
+      ddc_scan_supported_features(dh, candidates, NULL);
+   }
    psc = show_feature_set_values2_dfm(
-            dh, feature_set, collector, flags, features_seen);
+            dh, feature_set, collector, flags, features_seen, caps_features, jw);
    dyn_free_feature_set(feature_set);
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, psc, "");
    return psc;
@@ -915,6 +1087,7 @@ static void init_ddc_output_func_name_table() {
 #define ADD_FUNC(_NAME) rtti_func_name_table_add(_NAME, #_NAME);
    ADD_FUNC(get_raw_value_for_feature_metadata);
    ADD_FUNC(ddc_get_formatted_value_for_dfm);
+   ADD_FUNC(ddc_json_value_for_dfm);
 #undef ADD_FUNC
 }
 
@@ -11,6 +11,8 @@
 #include <stdio.h>
 #include <time.h>
 
+#include "util/json_writer.h"
+
 #include "base/core.h"
 #include "base/displays.h"
 #include "base/status_code_mgt.h"
@@ -58,13 +60,21 @@ ddc_get_formatted_value_for_dfm(
       char **                     formatted_value_loc,
       FILE *                      msg_fh);
 
+Public_Status_Code
+ddc_json_value_for_dfm(
+      Display_Handle *            dh,
+      Display_Feature_Metadata *  dfm,
+      bool                        suppress_unsupported,
+      Json_Writer *               jw);
+
 Public_Status_Code
 ddc_show_vcp_values(
       Display_Handle *    dh,
       VCP_Feature_Subset  subset,
       GPtrArray *         collector,
       Feature_Set_Flags   flags,
-      Bit_Set_256 *       features_seen);
+      Bit_Set_256 *       features_seen,
+      Json_Writer *       jw);
 
 
 void init_ddc_output();
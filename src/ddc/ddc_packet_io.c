@@ -27,17 +27,24 @@
 #include "util/debug_util.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/timestamp.h"
 #include "util/utilrpt.h"
 /** \endcond */
 
 #include "base/core.h"
 #include "base/ddc_errno.h"
 #include "base/displays.h"
+#include "base/display_health.h"
 #include "base/dynamic_sleep.h"
 #include "base/execution_stats.h"
+#include "base/io_timeline.h"
+#include "base/latency_stats.h"
+#include "base/op_profile.h"
 #include "base/parms.h"
 #include "base/rtti.h"
+#include "base/sleep.h"
 #include "base/status_code_mgt.h"
+#include "base/trace_ring.h"
 #include "base/tuned_sleep.h"
 #include "base/thread_sleep_data.h"
 
@@ -48,8 +55,16 @@
 #include "usb/usb_displays.h"
 #endif
 
+#include "ddc/ddc_async_requests.h"
+#include "ddc/ddc_deadline.h"
 #include "ddc/ddc_display_lock.h"
+#include "ddc/ddc_io_scheduler.h"
+#include "ddc/ddc_power_state.h"
+#include "ddc/ddc_read_capabilities.h"
+#include "ddc/ddc_settle_window.h"
 #include "ddc/ddc_try_stats.h"
+#include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_change_watch.h"
 
 #include "ddc/ddc_packet_io.h"
 
@@ -58,6 +73,144 @@
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDCIO;
 
 static GHashTable * open_displays = NULL;
+static GMutex       open_displays_mutex;     // protects open_displays
+
+
+//
+// Pool of idle I2C file descriptors
+//
+
+// Instead of closing /dev/i2c-N when a display is closed, its file descriptor
+// can be kept for a while, so that a client that repeatedly opens and closes
+// the same display does not pay for the open each time.  A Display_Handle has
+// exclusive use of its display (see ddc_display_lock.c), so a pooled file
+// descriptor is never shared, and no reference count is needed.
+
+typedef struct {
+   int      fd;
+   uint64_t idle_since;      // nanosec, CLOCK_MONOTONIC
+} Pooled_Fd;
+
+static GHashTable * fd_pool = NULL;       // busno -> Pooled_Fd
+static GMutex       fd_pool_mutex;
+static int          fd_pool_idle_millisec = DEFAULT_FD_POOL_IDLE_MILLISEC;
+
+
+/** Closes pooled file descriptors.
+ *
+ *  @param close_all  if true, close all pooled file descriptors,
+ *                    if false, only those whose idle time expired
+ *  Must be called with #fd_pool_mutex locked.
+ */
+static void
+close_pooled_fds(bool close_all) {
+   bool debug = false;
+   if (!fd_pool)
+      return;
+   uint64_t expired_before = cur_monotonic_nanosec() - (uint64_t) fd_pool_idle_millisec * 1000000;
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, fd_pool);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      Pooled_Fd * pooled = value;
+      if (close_all || pooled->idle_since < expired_before) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Closing pooled fd %d for bus %d",
+                                            pooled->fd, GPOINTER_TO_INT(key));
+         i2c_close_bus(pooled->fd, CALLOPT_NONE);
+         free(pooled);
+         g_hash_table_iter_remove(&iter);
+      }
+   }
+}
+
+
+/** Takes the idle file descriptor for an I2C bus from the pool.
+ *
+ *  @param  busno  I2C bus number
+ *  @return file descriptor, -1 if none
+ */
+static int
+take_pooled_fd(int busno) {
+   int fd = -1;
+   g_mutex_lock(&fd_pool_mutex);
+   close_pooled_fds(false);
+   if (fd_pool) {
+      Pooled_Fd * pooled = g_hash_table_lookup(fd_pool, GINT_TO_POINTER(busno));
+      if (pooled) {
+         fd = pooled->fd;
+         free(pooled);
+         g_hash_table_remove(fd_pool, GINT_TO_POINTER(busno));
+      }
+   }
+   g_mutex_unlock(&fd_pool_mutex);
+   return fd;
+}
+
+
+/** Places the file descriptor of a display being closed in the pool.
+ *
+ *  @param  busno  I2C bus number
+ *  @param  fd     file descriptor
+ *  @return true if the file descriptor was pooled,
+ *          false if pooling is disabled and the caller must close it
+ */
+static bool
+pool_fd(int busno, int fd) {
+   bool pooled = false;
+   g_mutex_lock(&fd_pool_mutex);
+   close_pooled_fds(false);
+   if (fd_pool_idle_millisec > 0) {
+      if (!fd_pool)
+         fd_pool = g_hash_table_new(g_direct_hash, NULL);
+      Pooled_Fd * entry = calloc(1, sizeof(Pooled_Fd));
+      entry->fd = fd;
+      entry->idle_since = cur_monotonic_nanosec();
+      assert(!g_hash_table_contains(fd_pool, GINT_TO_POINTER(busno)));
+      g_hash_table_insert(fd_pool, GINT_TO_POINTER(busno), entry);
+      pooled = true;
+   }
+   g_mutex_unlock(&fd_pool_mutex);
+   return pooled;
+}
+
+
+/** Sets how long the file descriptor of a closed display is kept open
+ *  for reuse by the next open of the display.
+ *
+ *  Idle file descriptors are closed when the pool is next accessed after
+ *  the timeout has expired, when displays are redetected, and at termination.
+ *
+ *  @param  millisec  idle timeout, 0 to disable pooling
+ *  @return prior value
+ */
+int
+ddc_set_fd_pool_idle_timeout(int millisec) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "millisec=%d", millisec);
+   g_mutex_lock(&fd_pool_mutex);
+   int old = fd_pool_idle_millisec;
+   fd_pool_idle_millisec = (millisec > 0) ? millisec : 0;
+   if (fd_pool_idle_millisec == 0)
+      close_pooled_fds(true);
+   g_mutex_unlock(&fd_pool_mutex);
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %d", old);
+   return old;
+}
+
+
+int
+ddc_get_fd_pool_idle_timeout() {
+   return fd_pool_idle_millisec;
+}
+
+
+/** Closes all pooled file descriptors. */
+void
+ddc_close_pooled_fds() {
+   g_mutex_lock(&fd_pool_mutex);
+   close_pooled_fds(true);
+   g_mutex_unlock(&fd_pool_mutex);
+}
 
 #ifdef DEPRECATED
 // Deprecated - use all_bytes_zero() in string_util.c
@@ -92,7 +245,9 @@ ddc_is_valid_display_handle(Display_Handle * dh) {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%p", dh);
    assert(open_displays);
+   g_mutex_lock(&open_displays_mutex);
    bool result = g_hash_table_contains(open_displays, dh);
+   g_mutex_unlock(&open_displays_mutex);
    DBGTRC_DONE(debug, TRACE_GROUP, "Rreturning %s. dh=%p", sbool(result), dh);
    return result;
 }
@@ -101,7 +256,9 @@ ddc_is_valid_display_handle(Display_Handle * dh) {
 void ddc_dbgrpt_valid_display_handles(int depth) {
    rpt_vstring(depth, "Valid display handle = open_displays:");
    assert(open_displays);
+   g_mutex_lock(&open_displays_mutex);
    GList * display_handles = g_hash_table_get_keys(open_displays);
+   g_mutex_unlock(&open_displays_mutex);
    if (g_list_length(display_handles) > 0) {
       for (GList * cur = display_handles; cur; cur = cur->next) {
          Display_Handle * dh = cur->data;
@@ -147,6 +304,9 @@ ddc_open_display(
    Display_Handle * dh = NULL;
    DDCA_Status ddcrc = 0;
 
+   // a background capabilities read would otherwise make the open fail with DDCRC_LOCKED
+   ddc_wait_capabilities_prefetch(dref);
+
    Distinct_Display_Ref ddisp_ref = get_distinct_display_ref(dref);
    Distinct_Display_Flags ddisp_flags = DDISP_NONE;
    if (callopts & CALLOPT_WAIT)
@@ -157,6 +317,10 @@ ddc_open_display(
       ddcrc = DDCRC_LOCKED;          // is there an appropriate errno value?  EBUSY? EACCES?
       goto bye;
    }
+   if (lockrc == DDCRC_TIMEOUT || lockrc == DDCRC_CANCELLED) {   // gave up waiting
+      ddcrc = lockrc;
+      goto bye;
+   }
    // DBGMSF(debug, "lockrc = %s, DREF_OPEN = %s", psc_desc(lockrc), sbool(dref->flags&DREF_OPEN));
    // assumes there is only one Display_Ref for a display
    // DREF_OPEN flag will not be set if caller used a different Display_Ref on this open call
@@ -180,7 +344,13 @@ ddc_open_display(
          TRACED_ASSERT(bus_info);   // need to convert to a test?
          TRACED_ASSERT( bus_info && memcmp(bus_info, I2C_BUS_INFO_MARKER, 4) == 0);
 
-         int fd = i2c_open_bus(dref->io_path.path.i2c_busno, callopts);
+         int fd = -1;
+         if ( !(callopts & CALLOPT_RDONLY) )
+            fd = take_pooled_fd(dref->io_path.path.i2c_busno);
+         if (fd >= 0)
+            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Reusing pooled fd %d", fd);
+         else
+            fd = i2c_open_bus(dref->io_path.path.i2c_busno, callopts);
          if (fd < 0) {
             ddcrc = fd;
          }
@@ -241,9 +411,10 @@ ddc_open_display(
 
    if (ddcrc == 0) {
       dref->flags |= DREF_OPEN;
-      // protect with lock?
       TRACED_ASSERT(open_displays);
+      g_mutex_lock(&open_displays_mutex);
       g_hash_table_add(open_displays, dh);
+      g_mutex_unlock(&open_displays_mutex);
    }
    else {
       unlock_distinct_display(ddisp_ref);
@@ -277,6 +448,18 @@ ddc_close_display(Display_Handle * dh) {
               dh_repr(dh), dref_repr_t(dh->dref), dh->fd, dpath_short_name_t(&dh->dref->io_path) ) ;
    Display_Ref * dref = dh->dref;
    Status_Errno rc = 0;
+
+   // Wait for any operation on dh in another thread to complete, and make dh
+   // invalid for subsequent API calls.
+   g_rec_mutex_lock(&dh->io_mutex);
+   assert(open_displays);
+   g_mutex_lock(&open_displays_mutex);
+   g_hash_table_remove(open_displays, dh);
+   g_mutex_unlock(&open_displays_mutex);
+
+   // queued requests and the VCP change watch refer to dh
+   ddc_unwatch_vcp_changes(dh);
+   ddc_wait_async_requests(dh);
    if (dh->fd == -1) {
       rc = DDCRC_INVALID_OPERATION;    // or DDCRC_ARG?
    }
@@ -284,6 +467,15 @@ ddc_close_display(Display_Handle * dh) {
       switch(dh->dref->io_path.io_mode) {
       case DDCA_IO_I2C:
          {
+            // A display opened read-only is not pooled, since pooled
+            // file descriptors are reused for read/write opens.
+            if ( (dh->dref->flags & DREF_DDC_COMMUNICATION_WORKING) &&
+                 (fcntl(dh->fd, F_GETFL) & O_ACCMODE) == O_RDWR &&
+                 pool_fd(dh->dref->io_path.path.i2c_busno, dh->fd) )
+            {
+               dh->fd = -1;
+               break;
+            }
             rc = i2c_close_bus(dh->fd, CALLOPT_NONE);
             if (rc != 0) {
                TRACED_ASSERT(rc < 0);
@@ -314,12 +506,12 @@ ddc_close_display(Display_Handle * dh) {
       } //switch
    }
 
+   ddc_save_unsupported_features(dh->dref);
    dh->dref->flags &= (~DREF_OPEN);
    Distinct_Display_Ref display_id = get_distinct_display_ref(dh->dref);
    unlock_distinct_display(display_id);
-   assert(open_displays);
-   g_hash_table_remove(open_displays, dh);
 
+   g_rec_mutex_unlock(&dh->io_mutex);
    free_display_handle(dh);
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "dref=%s", dref_repr_t(dref));
    return rc;
@@ -329,14 +521,17 @@ void ddc_close_all_displays() {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
    assert(open_displays);
+   g_mutex_lock(&open_displays_mutex);
    DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Closing %d open displays", g_hash_table_size(open_displays));
    GList * display_handles = g_hash_table_get_keys(open_displays);
+   g_mutex_unlock(&open_displays_mutex);
    for (GList * cur = display_handles; cur; cur = cur->next) {
       Display_Handle * dh = cur->data;
       ddc_close_display(dh);
    }
    // open_displays should be empty at this point
    TRACED_ASSERT(g_hash_table_size(open_displays) == 0);
+   ddc_close_pooled_fds();
    DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
 
@@ -347,6 +542,9 @@ void ddc_close_all_displays() {
 // typedef for ddc_i2c_write_read_raw, ddc_adl_write_read_raw, ddc_write_read_raw
 
 
+// There is no backend using /dev/drm_dp_aux*.  Those devices expose only
+// native AUX access to the DPCD address space; DDC/CI requires I2C-over-AUX
+// transactions, which the kernel makes available solely through i2c-dev.
 typedef
 DDCA_Status (*Write_Read_Raw_Function)(
          Display_Handle * dh,
@@ -411,24 +609,49 @@ DDCA_Status ddc_i2c_write_read_raw(
 #endif
 
    CHECK_DEFERRED_SLEEP(dh);
-   Status_Errno_DDC rc =
-         invoke_i2c_writer(
+   int busno = dh->dref->io_path.path.i2c_busno;
+   Status_Errno_DDC rc = 0;
+   bool read_performed = false;
+   uint64_t io_start = io_timeline_now();
+   if (!read_bytewise && (dh->dref->flags & DREF_I2C_COMBINED_WRITE_READ)) {
+      // Write and read in a single I2C_RDWR transaction.  The write-to-read
+      // delay is whatever the adapter provides, instead of SE_WRITE_TO_READ.
+      rc = invoke_i2c_write_reader(
+                           dh->fd,
+                           0x37,
+                           get_packet_len(request_packet_ptr)-1,
+                           get_packet_start(request_packet_ptr)+1,
+                           max_read_bytes,
+                           readbuf);
+      DBGMSF(debug, "invoke_i2c_write_reader() returned %d", rc);
+      IO_TIMELINE_RECORD(busno, TLE_WRITE_READ, NULL, io_start, 0, rc);
+      read_performed = true;
+   }
+   else {
+      rc = invoke_i2c_writer(
                            dh->fd,
                            0x37,
                            get_packet_len(request_packet_ptr)-1,
                            get_packet_start(request_packet_ptr)+1 );
-   DBGMSF(debug, "invoke_i2c_writer() returned %d", rc);
-   if (rc == 0) {
-      TUNED_SLEEP_WITH_TRACE(dh, SE_WRITE_TO_READ, NULL);
-      // tuned_sleep_i2c_with_trace(SE_WRITE_TO_READ, __func__, NULL);
-
-      // ALTERNATIVE_THAT_DIDNT_WORK:
-      // if (single_byte_reads)  // fails
-      //    rc = invoke_single_byte_i2c_reader(dh->fd, max_read_bytes, readbuf);
-      // else
-
-      CHECK_DEFERRED_SLEEP(dh);
-      rc = invoke_i2c_reader(dh->fd, 0x37, read_bytewise, max_read_bytes, readbuf);
+      DBGMSF(debug, "invoke_i2c_writer() returned %d", rc);
+      IO_TIMELINE_RECORD(busno, TLE_WRITE, NULL, io_start, 0, rc);
+      if (rc == 0) {
+         TUNED_SLEEP_WITH_TRACE(dh, SE_WRITE_TO_READ, NULL);
+         // tuned_sleep_i2c_with_trace(SE_WRITE_TO_READ, __func__, NULL);
+
+         // ALTERNATIVE_THAT_DIDNT_WORK:
+         // if (single_byte_reads)  // fails
+         //    rc = invoke_single_byte_i2c_reader(dh->fd, max_read_bytes, readbuf);
+         // else
+
+         CHECK_DEFERRED_SLEEP(dh);
+         io_start = io_timeline_now();
+         rc = invoke_i2c_reader(dh->fd, 0x37, read_bytewise, max_read_bytes, readbuf);
+         IO_TIMELINE_RECORD(busno, TLE_READ, NULL, io_start, 0, rc);
+         read_performed = true;
+      }
+   }
+   if (read_performed) {
       // try adding sleep to see if improves capabilities read for P2411H
       // tuned_sleep_i2c_with_trace(SE_POST_READ, __func__, NULL);
       TUNED_SLEEP_WITH_TRACE(dh, SE_POST_READ, NULL);
@@ -498,29 +721,23 @@ DDCA_Status ddc_write_read_raw(
 }
 
 
-/** Writes a DDC request packet to a monitor and provides basic response parsing
- *  based whether the response type is continuous, non-continuous, or table.
+/** Performs a DDC write/read exchange, returning the response either as a
+ *  #DDC_Packet or, for a Get VCP Feature request, decoded directly into
+ *  a #Parsed_Nontable_Vcp_Response.
  *
- *  \param dh                  display handle (for either I2C or ADL device)
- *  \param request_packet_ptr  DDC packet to write
- *  \param max_read_bytes      maximum number of bytes to read
- *  \param expected_response_type expected response type to check for
- *  \param expected_subtype    expected subtype to check for
- *  \param response_packet_ptr_loc  where to write address of response packet received
- *
- *  \return pointer to #Error_Info struct if failure, NULL if success
- *  \remark
- *  Issue: positive ADL codes, need to handle?
+ *  Exactly one of **response_packet_ptr_loc** and **parsed_response**
+ *  is non-NULL.
  */
-Error_Info *
-ddc_write_read(
+static Error_Info *
+write_read_core(
       Display_Handle * dh,
       DDC_Packet *     request_packet_ptr,
       bool             read_bytewise,
       int              max_read_bytes,
       Byte             expected_response_type,
       Byte             expected_subtype,
-      DDC_Packet **    response_packet_ptr_loc
+      DDC_Packet **    response_packet_ptr_loc,
+      Parsed_Nontable_Vcp_Response * parsed_response
      )
 {
    bool debug = false;
@@ -528,12 +745,20 @@ ddc_write_read(
                                        " expected_response_type=0x%02x, expected_subtype=0x%02x",
           dh_repr(dh), SBOOL(read_bytewise), max_read_bytes, expected_response_type, expected_subtype  );
 
+   TRACE_EVENT(TRE_WRITE_READ_START, dh->dref->io_path.path.i2c_busno, max_read_bytes, 0, 0);
    DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "Adding 1 to max_read_bytes to allow for initail double 0x63 quirk");
    max_read_bytes++;   //allow for quirk of double 0x6e at start
-   Byte * readbuf = calloc(1, max_read_bytes);
+   // read into the stack unless the caller asks for an exceptionally large response
+   Byte   local_readbuf[MAX_DDC_PACKET_INC_CHECKSUM+1];
+   Byte * readbuf = local_readbuf;
+   if (max_read_bytes <= (int) sizeof(local_readbuf))
+      memset(local_readbuf, 0, max_read_bytes);
+   else
+      readbuf = calloc(1, max_read_bytes);
    int    bytes_received = max_read_bytes;
    DDCA_Status    psc;
-   *response_packet_ptr_loc = NULL;
+   if (response_packet_ptr_loc)
+      *response_packet_ptr_loc = NULL;
 
    psc =  ddc_write_read_raw(
             dh,
@@ -543,7 +768,15 @@ ddc_write_read(
             readbuf,
             &bytes_received
      );
-   if (psc >= 0) {
+   if (psc >= 0 && parsed_response) {
+       assert(expected_response_type == DDC_PACKET_TYPE_QUERY_VCP_RESPONSE);
+       psc = decode_ddc_getvcp_response(
+              readbuf,
+              bytes_received,
+              expected_subtype,
+              parsed_response);
+   }
+   else if (psc >= 0) {
        // readbuf[0] = 0x6e;
        // hex_dump(readbuf, bytes_received+1);
        psc = create_ddc_typed_response_packet(
@@ -558,13 +791,16 @@ ddc_write_read(
               ddcrc_desc_t(psc), *response_packet_ptr_loc );
 
        if (psc != 0 && *response_packet_ptr_loc) {  // paranoid,  should never occur
-          free(*response_packet_ptr_loc);
+          free_ddc_packet(*response_packet_ptr_loc);
           *response_packet_ptr_loc = NULL;
        }
    }
-   dsa_record_ddcrw_status_code(psc);
+   if (!ddc_is_settle_probe(dh))     // errors while recovering from a disruptive write
+      dsa_record_ddcrw_status_code(dh, psc);
+   TRACE_EVENT(TRE_WRITE_READ_DONE, dh->dref->io_path.path.i2c_busno, psc, 0, 0);
 
-   free(readbuf);    // or does response_packet_ptr_loc point into here?
+   if (readbuf != local_readbuf)
+      free(readbuf);    // response packet holds a copy of the bytes
 
    // already done:
    // if (rc != 0)
@@ -579,8 +815,8 @@ ddc_write_read(
       DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", errinfo_summary(excp)  );
    }
    else {
-      DBGTRC_DONE(debug, TRACE_GROUP, "Returning: NULL, *response_packet_ptr_loc ->");
-      if (debug || IS_TRACING())
+      DBGTRC_DONE(debug, TRACE_GROUP, "Returning: NULL");
+      if ((debug || IS_TRACING()) && response_packet_ptr_loc)
          dbgrpt_packet(*response_packet_ptr_loc, 2);
    }
 
@@ -588,27 +824,79 @@ ddc_write_read(
 }
 
 
-/** Wraps #ddc_write_read() in retry logic.
+/** Writes a DDC request packet to a monitor and provides basic response parsing
+ *  based whether the response type is continuous, non-continuous, or table.
  *
  *  \param dh                  display handle (for either I2C or ADL device)
  *  \param request_packet_ptr  DDC packet to write
  *  \param max_read_bytes      maximum number of bytes to read
  *  \param expected_response_type expected response type to check for
  *  \param expected_subtype    expected subtype to check for
- *  \param all_zero_response_ok treat a response of all 0s as valid
  *  \param response_packet_ptr_loc  where to write address of response packet received
  *
  *  \return pointer to #Error_Info struct if failure, NULL if success
+ *  \remark
+ *  Issue: positive ADL codes, need to handle?
  */
 Error_Info *
-ddc_write_read_with_retry(
+ddc_write_read(
+      Display_Handle * dh,
+      DDC_Packet *     request_packet_ptr,
+      bool             read_bytewise,
+      int              max_read_bytes,
+      Byte             expected_response_type,
+      Byte             expected_subtype,
+      DDC_Packet **    response_packet_ptr_loc
+     )
+{
+   return write_read_core(dh, request_packet_ptr, read_bytewise, max_read_bytes,
+                          expected_response_type, expected_subtype,
+                          response_packet_ptr_loc, NULL);
+}
+
+
+/** Sleeps before retrying a DDC Null Message response.
+ *
+ *  Some monitors use a Null Message to indicate they are busy.  Instead of
+ *  increasing the thread's sleep multiplier, which lengthens every subsequent
+ *  sleep, use a short delay that doubles with each consecutive Null Message on
+ *  the display, up to #DDC_NULL_RESPONSE_BACKOFF_MAX_MILLIS.
+ *
+ *  \param  dref  display reference
+ */
+static void
+null_response_backoff(Display_Ref * dref) {
+   int millis = dref->null_response_backoff_millis;
+   millis = (millis == 0) ? DDC_NULL_RESPONSE_BACKOFF_MIN_MILLIS
+                          : MIN(2*millis, DDC_NULL_RESPONSE_BACKOFF_MAX_MILLIS);
+   dref->null_response_backoff_millis = millis;
+   SLEEP_MILLIS_WITH_TRACE(millis, "DDC Null Response backoff");
+}
+
+
+/** Reduces the Null Message backoff of a display after a successful exchange. */
+static void
+null_response_backoff_decay(Display_Ref * dref) {
+   int millis = dref->null_response_backoff_millis / 2;
+   dref->null_response_backoff_millis = (millis < DDC_NULL_RESPONSE_BACKOFF_MIN_MILLIS) ? 0 : millis;
+}
+
+
+/** Wraps #write_read_core() in retry logic.
+ *
+ *  Exactly one of **response_packet_ptr_loc** and **parsed_response**
+ *  is non-NULL.
+ */
+static Error_Info *
+write_read_with_retry_core(
          Display_Handle * dh,
          DDC_Packet *     request_packet_ptr,
          int              max_read_bytes,
          Byte             expected_response_type,
          Byte             expected_subtype,
          bool             all_zero_response_ok,
-         DDC_Packet **    response_packet_ptr_loc
+         DDC_Packet **    response_packet_ptr_loc,
+         Parsed_Nontable_Vcp_Response * parsed_response
         )
 {
    bool debug = false;
@@ -621,8 +909,20 @@ ddc_write_read_with_retry(
    // if (debug)
    //     dbgrpt_display_ref(dh->dref, 1);
 
+   // fail fast rather than retrying a display that cannot respond
+   Error_Info * power_excp = ddc_check_power_state(dh, request_packet_ptr);
+   if (power_excp) {
+      if (response_packet_ptr_loc)
+         *response_packet_ptr_loc = NULL;
+      DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, power_excp, "");
+      return power_excp;
+   }
+
    bool retry_null_response = !(dh->dref->flags & DREF_DDC_USES_NULL_RESPONSE_FOR_UNSUPPORTED);
 
+   ddc_begin_transaction(dh, false);
+   uint64_t start_nanos = cur_monotonic_nanosec();
+
    DDCA_Status  psc;
    bool read_bytewise = I2C_Read_Bytewise;   // normally set to DEFAULT_I2C_READ_BYTEWISE
    int  tryctr;
@@ -630,14 +930,14 @@ ddc_write_read_with_retry(
    int  ddcrc_read_all_zero_ct = 0;
    int  ddcrc_null_response_ct = 0;
    int  ddcrc_null_response_max = (retry_null_response) ? 3 : 0;
-   bool sleep_multiplier_incremented = false;
    // ddcrc_null_response_max = 6;  // *** TEMP *** for testing
    DBGMSF(debug, "retry_null_response = %s, ddcrc_null_response_max = %d",
           sbool(retry_null_response), ddcrc_null_response_max);
    Error_Info * try_errors[MAX_MAX_TRIES];
+   uint64_t last_try_nanos = start_nanos;     // start of most recent try
 
    // TRACED_ASSERT(max_write_read_exchange_tries > 0);   // to avoid clang warning
-   int max_tries = try_data_get_maxtries2(WRITE_READ_TRIES_OP);
+   int max_tries = try_data_get_display_maxtries2(dh, WRITE_READ_TRIES_OP);
    TRACED_ASSERT(max_tries >= 0);
    for (tryctr=0, psc=-999, retryable=true;
         tryctr < max_tries && psc < 0 && retryable;
@@ -647,14 +947,23 @@ ddc_write_read_with_retry(
            "Start of try loop, tryctr=%d, max_tries=%d, rc=%d, retryable=%s, read_bytewise=%s",
            tryctr, max_tries, psc, sbool(retryable), sbool(read_bytewise) );
 
-      Error_Info * cur_excp = ddc_write_read(
-                dh,
-                request_packet_ptr,
-                read_bytewise,
-                max_read_bytes,
-                expected_response_type,
-                expected_subtype,
-                response_packet_ptr_loc);
+      Error_Info * cur_excp = ddc_check_deadline(__func__);   // safe point
+      if (!cur_excp) {
+         last_try_nanos = cur_monotonic_nanosec();
+         io_timeline_set_try(tryctr+1);
+         uint64_t try_start = io_timeline_now();
+         cur_excp = write_read_core(
+                   dh,
+                   request_packet_ptr,
+                   read_bytewise,
+                   max_read_bytes,
+                   expected_response_type,
+                   expected_subtype,
+                   response_packet_ptr_loc,
+                   parsed_response);
+         IO_TIMELINE_RECORD(dh->dref->io_path.path.i2c_busno, TLE_TRY, NULL, try_start, 0,
+                            (cur_excp) ? cur_excp->status_code : 0);
+      }
 
       // TESTCASES:
       // if (tryctr < 2)
@@ -689,9 +998,8 @@ ddc_write_read_with_retry(
                   if (retryable) {
                      if (ddcrc_null_response_ct == 1 && get_output_level() >= DDCA_OL_VERBOSE)
                         f0printf(fout(), "Extended delay as recovery from DDC Null Response...\n");
-                     tsd_set_sleep_multiplier_ct(ddcrc_null_response_ct++);
-                     sleep_multiplier_incremented = true;
-                     // replaces: call_dynamic_tuned_sleep_i2c(SE_DDC_NULL, ddcrc_null_response_ct);
+                     // replaces: tsd_set_sleep_multiplier_ct(ddcrc_null_response_ct++);
+                     null_response_backoff(dh->dref);
                   }
                }
                break;
@@ -708,6 +1016,11 @@ ddc_write_read_with_retry(
               // retryable = false;     // ??
               break;
 
+         case (-EAGAIN):   // e.g. arbitration lost
+              // already retried by the kernel, see i2c_set_kernel_retries()
+              retryable = !i2c_kernel_retries_active(dh->dref->io_path.path.i2c_busno);
+              break;
+
          case (-EBADF):
               // DBGMSG("EBADF");
               retryable = false;
@@ -717,6 +1030,11 @@ ddc_write_read_with_retry(
               retryable = false;  // have seen success after 7 retries of errors including ENXIO, DDCRC_DATA, make retryable?
               break;
 
+         case DDCRC_TIMEOUT:
+         case DDCRC_CANCELLED:
+              retryable = false;
+              break;
+
          default:
               retryable = true;     // for now
          }
@@ -753,10 +1071,8 @@ ddc_write_read_with_retry(
          free(s);
 
    }
-   if (sleep_multiplier_incremented) {
-      tsd_set_sleep_multiplier_ct(1);   // in case we changed it
-      tsd_bump_sleep_multiplier_changer_ct();
-   }
+   if (psc == 0)
+      null_response_backoff_decay(dh->dref);
 
    Error_Info * ddc_excp = NULL;
 
@@ -768,7 +1084,7 @@ ddc_write_read_with_retry(
          psc = DDCRC_RETRIES;
       else if (ddcrc_read_all_zero_ct == max_tries)
          psc = DDCRC_ALL_TRIES_ZERO;
-      else if (ddcrc_null_response_ct > ddcrc_null_response_max)
+      else if (ddcrc_null_response_ct >= ddcrc_null_response_max)
          psc = DDCRC_ALL_RESPONSES_NULL;
 
       ddc_excp = errinfo_new_with_causes(psc, try_errors, tryctr, __func__);
@@ -783,13 +1099,81 @@ ddc_write_read_with_retry(
       }
    }
 
-   try_data_record_tries2(WRITE_READ_TRIES_OP, psc, tryctr);
+   io_timeline_set_try(0);
+   op_profile_add_retries(tryctr-1, last_try_nanos - start_nanos);
+   uint64_t elapsed_nanos = cur_monotonic_nanosec() - start_nanos;
+   record_display_latency(dh->dref->io_path, DDCA_LATENCY_WRITE_READ, elapsed_nanos);
+   record_display_health(dh->dref, psc, tryctr, elapsed_nanos);
+   ddc_record_settle_probe(dh, psc, tryctr, last_try_nanos);
+   ddc_end_transaction(dh);
+   try_data_record_display_tries2(dh, WRITE_READ_TRIES_OP, psc, tryctr);
+   TRACE_EVENT(TRE_TRY_DONE, WRITE_READ_TRIES_OP, tryctr, psc, 0);
 
    DBGTRC_DONE(debug, TRACE_GROUP, "Total Tries (tryctr): %d. Returning: %s", tryctr, errinfo_summary(ddc_excp));
    return ddc_excp;
 }
 
 
+/** Wraps #ddc_write_read() in retry logic.
+ *
+ *  \param dh                  display handle (for either I2C or ADL device)
+ *  \param request_packet_ptr  DDC packet to write
+ *  \param max_read_bytes      maximum number of bytes to read
+ *  \param expected_response_type expected response type to check for
+ *  \param expected_subtype    expected subtype to check for
+ *  \param all_zero_response_ok treat a response of all 0s as valid
+ *  \param response_packet_ptr_loc  where to write address of response packet received
+ *
+ *  \return pointer to #Error_Info struct if failure, NULL if success
+ */
+Error_Info *
+ddc_write_read_with_retry(
+         Display_Handle * dh,
+         DDC_Packet *     request_packet_ptr,
+         int              max_read_bytes,
+         Byte             expected_response_type,
+         Byte             expected_subtype,
+         bool             all_zero_response_ok,
+         DDC_Packet **    response_packet_ptr_loc
+        )
+{
+   return write_read_with_retry_core(dh, request_packet_ptr, max_read_bytes,
+                                     expected_response_type, expected_subtype, all_zero_response_ok,
+                                     response_packet_ptr_loc, NULL);
+}
+
+
+/** Sends a Get VCP Feature request for a non-table feature, with retry,
+ *  decoding the response directly into storage owned by the caller.
+ *
+ *  Unlike #ddc_write_read_with_retry() no response #DDC_Packet is created.
+ *  The 11 byte response is validated and parsed in a single pass by
+ *  #decode_ddc_getvcp_response().
+ *
+ *  \param dh                  display handle
+ *  \param request_packet_ptr  Get VCP Feature request packet
+ *  \param feature_code        VCP feature code
+ *  \param parsed_response     where to return the parsed response
+ *
+ *  \return pointer to #Error_Info struct if failure, NULL if success
+ */
+Error_Info *
+ddc_write_read_nontable_vcp_with_retry(
+         Display_Handle *               dh,
+         DDC_Packet *                   request_packet_ptr,
+         DDCA_Vcp_Feature_Code          feature_code,
+         Parsed_Nontable_Vcp_Response * parsed_response)
+{
+   // expected response size:
+   //  (src addr == x6e) (length) (response contents) (checkbyte)
+   //  1               + 1      + 8                 + 1           == 11
+   return write_read_with_retry_core(dh, request_packet_ptr, 11,
+                                     DDC_PACKET_TYPE_QUERY_VCP_RESPONSE, feature_code,
+                                     false,       // all_zero_response_ok
+                                     NULL, parsed_response);
+}
+
+
 /* Writes a DDC request packet to an open I2C bus.
  *
  * Arguments:
@@ -822,19 +1206,31 @@ ddc_i2c_write_only(
    Byte slave_address = 0x37;
 
    CHECK_DEFERRED_SLEEP(dh);
+   uint64_t io_start = io_timeline_now();
    Status_Errno_DDC rc =
          invoke_i2c_writer(fh,
                            slave_address,
                            get_packet_len(request_packet_ptr)-1,
                            get_packet_start(request_packet_ptr)+1 );
+   IO_TIMELINE_RECORD(dh->dref->io_path.path.i2c_busno, TLE_WRITE, NULL, io_start, 0, rc);
    if (rc < 0)
       log_status_code(rc, __func__);
-   Sleep_Event_Type sleep_type =
-         (request_packet_ptr->type == DDC_PACKET_TYPE_SAVE_CURRENT_SETTINGS )
-            ? SE_POST_SAVE_SETTINGS
-            : SE_POST_WRITE;
-   // tuned_sleep_i2c_with_trace(sleep_type, __func__, NULL);
-   TUNED_SLEEP_WITH_TRACE(dh, sleep_type, NULL);
+   if (request_packet_ptr->type == DDC_PACKET_TYPE_TABLE_WRITE_REQUEST &&
+       tsd_get_thread_sleep_data()->dynamic_sleep_enabled)
+   {
+      // table write fragments use the display's learned fragment pacing,
+      // see try_multi_part_write()
+      int millis = DDC_TIMEOUT_MILLIS_BETWEEN_CAP_TABLE_FRAGMENTS * dsa_get_fragment_pacing_factor(dh);
+      SPECIAL_TUNED_SLEEP_WITH_TRACE(dh, (millis > 0) ? millis : 1, "Paced table fragment");
+   }
+   else {
+      Sleep_Event_Type sleep_type =
+            (request_packet_ptr->type == DDC_PACKET_TYPE_SAVE_CURRENT_SETTINGS )
+               ? SE_POST_SAVE_SETTINGS
+               : SE_POST_WRITE;
+      // tuned_sleep_i2c_with_trace(sleep_type, __func__, NULL);
+      TUNED_SLEEP_WITH_TRACE(dh, sleep_type, NULL);
+   }
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
    return rc;
 }
@@ -864,6 +1260,7 @@ ddc_write_only(
    Error_Info *  ddc_excp = NULL;
    if (psc)
       ddc_excp = errinfo_new(psc, __func__);
+   TRACE_EVENT(TRE_WRITE_ONLY_DONE, dh->dref->io_path.path.i2c_busno, psc, 0, 0);
 
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", errinfo_summary(ddc_excp));
    return ddc_excp;
@@ -889,12 +1286,21 @@ ddc_write_only_with_retry(
 
    TRACED_ASSERT(dh->dref->io_path.io_mode == DDCA_IO_I2C);
 
+   Error_Info * power_excp = ddc_check_power_state(dh, request_packet_ptr);
+   if (power_excp) {
+      DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, power_excp, "");
+      return power_excp;
+   }
+
    DDCA_Status        psc;
    int                tryctr;
    bool               retryable;
    Error_Info *       try_errors[MAX_MAX_TRIES];
 
-   int max_tries = try_data_get_maxtries2(WRITE_ONLY_TRIES_OP);
+   ddc_begin_transaction(dh, true);
+   uint64_t first_try_nanos = cur_monotonic_nanosec();
+   uint64_t last_try_nanos  = first_try_nanos;
+   int max_tries = try_data_get_display_maxtries2(dh, WRITE_ONLY_TRIES_OP);
    TRACED_ASSERT(max_tries > 0);
    for (tryctr=0, psc=-999, retryable=true;
        tryctr < max_tries && psc < 0 && retryable;
@@ -904,12 +1310,26 @@ ddc_write_only_with_retry(
              "Start of try loop, tryctr=%d, max_tries=%d, rc=%d, retryable=%d",
              tryctr, max_tries, psc, retryable );
 
-      Error_Info * cur_excp = ddc_write_only(dh, request_packet_ptr);
+      Error_Info * cur_excp = ddc_check_deadline(__func__);   // safe point
+      if (cur_excp) {
+         psc = cur_excp->status_code;
+         try_errors[tryctr] = cur_excp;
+         retryable = false;
+         continue;
+      }
+
+      last_try_nanos = cur_monotonic_nanosec();
+      io_timeline_set_try(tryctr+1);
+      uint64_t try_start = io_timeline_now();
+      cur_excp = ddc_write_only(dh, request_packet_ptr);
       psc = (cur_excp) ? cur_excp->status_code : 0;
       try_errors[tryctr] = cur_excp;
+      IO_TIMELINE_RECORD(dh->dref->io_path.path.i2c_busno, TLE_TRY, NULL, try_start, 0, psc);
 
       // try_status_codes[tryctr] = psc;   // for future Ddc_Error mechanism
    }
+   io_timeline_set_try(0);
+   op_profile_add_retries(tryctr-1, last_try_nanos - first_try_nanos);
 
    Error_Info * ddc_excp = NULL;
 
@@ -943,7 +1363,10 @@ ddc_write_only_with_retry(
       }
    }
 
-   try_data_record_tries2(WRITE_ONLY_TRIES_OP, psc, tryctr);
+   ddc_record_settle_probe(dh, psc, tryctr, last_try_nanos);
+   ddc_end_transaction(dh);
+   try_data_record_display_tries2(dh, WRITE_ONLY_TRIES_OP, psc, tryctr);
+   TRACE_EVENT(TRE_TRY_DONE, WRITE_ONLY_TRIES_OP, tryctr, psc, 0);
 
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", errinfo_summary(ddc_excp));
    return ddc_excp;
@@ -954,11 +1377,15 @@ static void
 init_ddc_packet_io_func_name_table() {
    RTTI_ADD_FUNC(ddc_open_display);
    RTTI_ADD_FUNC(ddc_close_display);
+   RTTI_ADD_FUNC(ddc_set_fd_pool_idle_timeout);
    RTTI_ADD_FUNC(ddc_i2c_write_read_raw);
    RTTI_ADD_FUNC(ddc_i2c_write_only);
    RTTI_ADD_FUNC(ddc_write_read_raw);
    RTTI_ADD_FUNC(ddc_write_read);
    RTTI_ADD_FUNC(ddc_write_read_with_retry);
+   RTTI_ADD_FUNC(ddc_write_read_nontable_vcp_with_retry);
+   RTTI_ADD_FUNC(write_read_core);
+   RTTI_ADD_FUNC(write_read_with_retry_core);
    RTTI_ADD_FUNC(ddc_write_only);
    RTTI_ADD_FUNC(ddc_write_only_with_retry);
    RTTI_ADD_FUNC(ddc_is_valid_display_handle);
@@ -29,6 +29,10 @@ Status_Errno ddc_close_display(
 
 void  ddc_close_all_displays();
 
+int   ddc_set_fd_pool_idle_timeout(int millisec);
+int   ddc_get_fd_pool_idle_timeout();
+void  ddc_close_pooled_fds();
+
 bool ddc_is_valid_display_handle(Display_Handle * dh);
 
 void ddc_dbgrpt_valid_display_handles(int depth);
@@ -62,6 +66,12 @@ Error_Info * ddc_write_read_with_retry(
       DDC_Packet **    response_packet_ptr_loc
      );
 
+Error_Info * ddc_write_read_nontable_vcp_with_retry(
+      Display_Handle *               dh,
+      DDC_Packet *                   request_packet_ptr,
+      DDCA_Vcp_Feature_Code          feature_code,
+      Parsed_Nontable_Vcp_Response * parsed_response);
+
 void init_ddc_packet_io();
 
 #endif /* DDC_PACKET_IO_H_ */
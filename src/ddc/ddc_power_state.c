@@ -0,0 +1,168 @@
+/** @file ddc_power_state.c
+ *
+ *  Tracks whether displays are in a power saving state, so that DDC
+ *  transactions with a sleeping display fail immediately instead of
+ *  exhausting their retries.
+ *
+ *  A display is considered asleep if:
+ *  - the dpms attribute of its DRM connector is other than "On", or
+ *  - feature xD6 (Power Mode) recently reported a power saving mode.
+ *
+ *  The DRM state is reread for each transaction, so communication resumes
+ *  as soon as the connector is turned on again.  A power saving mode reported
+ *  by feature xD6 suppresses transactions for #DDC_POWER_SAVING_BACKOFF_MILLISEC,
+ *  after which the display is tried again.
+ *
+ *  Transactions that read or write feature xD6 are always performed, so that
+ *  a client can check the power mode and wake the display.  So are the
+ *  transactions of display detection, since many monitors respond to DDC
+ *  while in standby.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/error_info.h"
+#include "util/string_util.h"
+#include "util/sysfs_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/vcp_version.h"
+
+#include "i2c/i2c_sysfs.h"
+
+#include "ddc/ddc_power_state.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+static bool power_state_tracking_enabled = DEFAULT_ENABLE_POWER_STATE_TRACKING;
+
+
+/** Enables or disables tracking of display power state.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global, not thread-specific.
+ */
+bool ddc_enable_power_state_tracking(bool onoff) {
+   bool old = power_state_tracking_enabled;
+   power_state_tracking_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether display power state is tracked.
+ *
+ *  \return true/false
+ */
+bool ddc_is_power_state_tracking_enabled() {
+   return power_state_tracking_enabled;
+}
+
+
+/** Records the value of feature xD6 (Power Mode) read from or written
+ *  to a display.
+ *
+ *  \param  dref        display reference
+ *  \param  power_mode  xD6 value, x01 = on, x02..x05 = power saving modes
+ */
+void
+ddc_record_power_mode(Display_Ref * dref, Byte power_mode) {
+   bool debug = false;
+   dref->power_state.asleep_until = (power_mode >= 0x02 && power_mode <= 0x05)
+         ? cur_monotonic_nanosec() + DDC_POWER_SAVING_BACKOFF_MILLISEC * (uint64_t) 1000000
+         : 0;
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "dref=%s, power_mode=0x%02x", dref_repr_t(dref), power_mode);
+}
+
+
+/** Checks whether the DRM connector of a display is in a power saving state.
+ *
+ *  \param  dref  display reference
+ *  \return true if the connector's dpms attribute is other than "On",
+ *          false if it is "On" or there is no DRM connector for the display
+ */
+static bool
+is_drm_dpms_off(Display_Ref * dref) {
+   Display_Power_State * ps = &dref->power_state;
+   if (!ps->drm_connector) {
+      Sys_Drm_Connector * connector = find_sys_drm_connector_by_busno(dref->io_path.path.i2c_busno);
+      ps->drm_connector = g_strdup( (connector) ? connector->connector_name : "");
+   }
+   if (!*ps->drm_connector)
+      return false;
+
+   char * dpms = NULL;
+   GET_ATTR_TEXT(&dpms, "/sys/class/drm", ps->drm_connector, "dpms");
+   bool off = dpms && !streq(dpms, "On");
+   g_free(dpms);
+
+   if (ps->dpms_off && !off)
+      ps->asleep_until = 0;     // turned on, forget what feature xD6 reported
+   ps->dpms_off = off;
+   return off;
+}
+
+
+/** Checks whether a display is in a power saving state.
+ *
+ *  \param  dref  display reference
+ *  \return true/false, always false if power state tracking is disabled
+ */
+bool
+ddc_is_display_asleep(Display_Ref * dref) {
+   if (!power_state_tracking_enabled || dref->io_path.io_mode != DDCA_IO_I2C)
+      return false;
+   bool dpms_off = is_drm_dpms_off(dref);
+   return dpms_off || dref->power_state.asleep_until > cur_monotonic_nanosec();
+}
+
+
+/** Checks whether a DDC request may be sent to a display, given its power state.
+ *
+ *  \param  dh              display handle
+ *  \param  request_packet  DDC request
+ *  \return NULL if the request may be sent,
+ *          #Error_Info with status #DDCRC_DISPLAY_ASLEEP if not
+ */
+Error_Info *
+ddc_check_power_state(Display_Handle * dh, DDC_Packet * request_packet) {
+   bool debug = false;
+   Error_Info * result = NULL;
+
+   Display_Ref * dref = dh->dref;
+   bool detecting = !(dref->flags & DREF_DDC_COMMUNICATION_CHECKED) ||
+                    vcp_version_eq(dref->vcp_version_xdf, DDCA_VSPEC_UNQUERIED);
+   Byte * data = get_data_start(request_packet);
+   bool power_mode_request = get_data_len(request_packet) >= 2 &&
+                             (data[0] == DDC_PACKET_TYPE_QUERY_VCP_REQUEST ||
+                              data[0] == DDC_PACKET_TYPE_SET_VCP_REQUEST) &&
+                             data[1] == 0xd6;
+   if (!detecting && !power_mode_request && ddc_is_display_asleep(dref)) {
+      result = errinfo_new2(DDCRC_DISPLAY_ASLEEP, __func__,
+                            "Display %s is in a power saving state", dh_repr(dh));
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s", result->detail);
+   }
+   return result;
+}
+
+
+void init_ddc_power_state() {
+   RTTI_ADD_FUNC(ddc_record_power_mode);
+}
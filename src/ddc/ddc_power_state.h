@@ -0,0 +1,27 @@
+/** @file ddc_power_state.h
+ *
+ *  Tracks whether displays are in a power saving state
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_POWER_STATE_H_
+#define DDC_POWER_STATE_H_
+
+#include <stdbool.h>
+
+#include "util/coredefs.h"
+#include "util/error_info.h"
+
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+
+bool         ddc_enable_power_state_tracking(bool onoff);
+bool         ddc_is_power_state_tracking_enabled();
+void         ddc_record_power_mode(Display_Ref * dref, Byte power_mode);
+bool         ddc_is_display_asleep(Display_Ref * dref);
+Error_Info * ddc_check_power_state(Display_Handle * dh, DDC_Packet * request_packet);
+void         init_ddc_power_state();
+
+#endif /* DDC_POWER_STATE_H_ */
@@ -0,0 +1,476 @@
+/** @file ddc_published_state.c
+ *
+ *  A ddcutil server (command SERVE) publishes the latest known value of VCP
+ *  features of each display in a memory mapped file in /dev/shm.  Other
+ *  processes, e.g. a panel widget or a color daemon, map the file read only
+ *  and get current values without performing DDC operations, and after the
+ *  first call without system calls.
+ *
+ *  While publishing is active, every non-table value read from or written
+ *  to a display in the server process is published, whether for a client
+ *  request or by the server's own polling of watched features.
+ *
+ *  Each display record is guarded by a sequence lock.  The single writing
+ *  process increments the sequence number before and after updating the
+ *  record, so it is odd while an update is in progress.  A reader copies the
+ *  value it wants, and retries if the sequence number was odd or changed
+ *  meanwhile.  Readers never block the writer.
+ *
+ *  When the server terminates, it marks the file closed and removes it.  A
+ *  new server creates a new file, which readers map on their next call.
+ *  Readers can tell that values are stale by their age.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+/** \endcond */
+
+#include "public/ddcutil_status_codes.h"
+
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/rtti.h"
+
+#include "ddc/ddc_published_state.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define PUBLISHED_STATE_DIR         "/dev/shm"
+#define PUBLISHED_STATE_MARKER      "DDCP"
+#define PUBLISHED_STATE_VERSION     1
+#define PUBLISHED_DISPLAY_MAX       16
+#define PUBLISHED_READ_RETRIES      100
+#define PUBLISHED_REMAP_MILLISEC    1000    // how often a reader retries mapping the file
+
+/** Value of one feature */
+typedef struct {
+   uint8_t  state;              // PUBLISHED_NONE, PUBLISHED_VALUE, PUBLISHED_ERROR
+   uint8_t  mh;
+   uint8_t  ml;
+   uint8_t  sh;
+   uint8_t  sl;
+   uint8_t  reserved[3];
+   int32_t  status;             // status of the last read, if PUBLISHED_ERROR
+   uint32_t reserved2;
+   uint64_t updated_nanos;      // CLOCK_MONOTONIC
+} Published_Vcp_Value;
+
+#define PUBLISHED_NONE   0
+#define PUBLISHED_VALUE  1
+#define PUBLISHED_ERROR  2
+
+/** Values of one display, guarded by seq */
+typedef struct {
+   uint32_t             seq;          // odd while being updated
+   uint32_t             in_use;
+   int32_t              busno;
+   uint32_t             reserved;
+   Published_Vcp_Value  values[256];
+} Published_Display;
+
+typedef struct {
+   char                 marker[4];    // PUBLISHED_STATE_MARKER
+   uint32_t             version;      // PUBLISHED_STATE_VERSION
+   uint32_t             display_max;  // PUBLISHED_DISPLAY_MAX
+   uint32_t             closed;       // set when the server terminates
+   Published_Display    displays[PUBLISHED_DISPLAY_MAX];
+} Published_State;
+
+static GMutex            published_state_mutex;     // protects the following
+static Published_State * writer_state   = NULL;
+static char *            writer_fn      = NULL;
+static Published_State * reader_state   = NULL;
+static uint64_t          reader_next_map_nanos = 0;
+
+
+static char *
+published_state_file_name() {
+   return g_strdup_printf("%s/ddcutil-state-%d", PUBLISHED_STATE_DIR, getuid());
+}
+
+
+//
+// Writer
+//
+
+/** Creates the shared state file and starts publishing values.
+ *
+ *  An existing file, e.g. left by a server that crashed, is replaced.
+ *  Readers that have mapped it see it as closed.
+ *
+ *  @return true if success, false if the file could not be created
+ */
+bool
+ddc_start_publishing_state() {
+   bool debug = false;
+   char * fn = published_state_file_name();
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn=%s", fn);
+
+   bool ok = false;
+   Published_State * state = NULL;
+
+   // mark an old file closed instead of truncating it, which would make
+   // readers that mapped it fail with SIGBUS
+   int fd = open(fn, O_RDWR|O_CLOEXEC);
+   if (fd >= 0) {
+      struct stat statbuf;
+      if (fstat(fd, &statbuf) == 0 && statbuf.st_size == sizeof(Published_State)) {
+         void * addr = mmap(NULL, sizeof(Published_State), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+         if (addr != MAP_FAILED) {
+            __atomic_store_n(&((Published_State *) addr)->closed, 1, __ATOMIC_RELEASE);
+            munmap(addr, sizeof(Published_State));
+         }
+      }
+      close(fd);
+      unlink(fn);
+   }
+
+   fd = open(fn, O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC, 0644);
+   if (fd < 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Error creating %s: %s", fn, strerror(errno));
+      goto bye;
+   }
+   if (ftruncate(fd, sizeof(Published_State)) < 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "ftruncate() failed: %s", strerror(errno));
+      close(fd);
+      unlink(fn);
+      goto bye;
+   }
+   void * addr = mmap(NULL, sizeof(Published_State), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (addr == MAP_FAILED) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "mmap() failed: %s", strerror(errno));
+      unlink(fn);
+      goto bye;
+   }
+   state = addr;
+   state->version     = PUBLISHED_STATE_VERSION;
+   state->display_max = PUBLISHED_DISPLAY_MAX;
+   // readers check the marker last
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   memcpy(state->marker, PUBLISHED_STATE_MARKER, 4);
+
+   g_mutex_lock(&published_state_mutex);
+   writer_state = state;
+   writer_fn = fn;
+   fn = NULL;
+   g_mutex_unlock(&published_state_mutex);
+   ok = true;
+
+bye:
+   g_free(fn);
+   DBGTRC_RET_BOOL(debug, TRACE_GROUP, ok, "");
+   return ok;
+}
+
+
+/** Stops publishing values, and removes the shared state file. */
+void
+ddc_stop_publishing_state() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "writer_fn=%s", writer_fn);
+
+   g_mutex_lock(&published_state_mutex);
+   if (writer_state) {
+      __atomic_store_n(&writer_state->closed, 1, __ATOMIC_RELEASE);
+      munmap(writer_state, sizeof(Published_State));
+      unlink(writer_fn);
+      g_free(writer_fn);
+      writer_state = NULL;
+      writer_fn = NULL;
+   }
+   g_mutex_unlock(&published_state_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Reports whether values are being published.
+ *
+ *  @return true/false
+ */
+bool
+ddc_is_publishing_state() {
+   return writer_state != NULL;
+}
+
+
+// Must be called with published_state_mutex held
+static Published_Display *
+get_writer_display(int busno) {
+   Published_Display * free_slot = NULL;
+   for (int ndx = 0; ndx < PUBLISHED_DISPLAY_MAX; ndx++) {
+      Published_Display * disp = &writer_state->displays[ndx];
+      if (disp->in_use && disp->busno == busno)
+         return disp;
+      if (!disp->in_use && !free_slot)
+         free_slot = disp;
+   }
+   if (free_slot) {
+      free_slot->busno = busno;
+      __atomic_store_n(&free_slot->in_use, 1, __ATOMIC_RELEASE);
+   }
+   return free_slot;
+}
+
+
+/** Updates the published value of one feature.
+ *
+ *  @param  dref          display reference
+ *  @param  feature_code  VCP feature code
+ *  @param  new_state     PUBLISHED_VALUE or PUBLISHED_ERROR
+ *  @param  psc           status code, if PUBLISHED_ERROR
+ *  @param  response      value, if PUBLISHED_VALUE, NULL to keep the
+ *                        maximum value already published and set sh,sl
+ *  @param  new_value     used if response == NULL
+ */
+static void
+publish(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      uint8_t                              new_state,
+      DDCA_Status                          psc,
+      const Parsed_Nontable_Vcp_Response * response,
+      int                                  new_value)
+{
+   if (dref->io_path.io_mode != DDCA_IO_I2C)
+      return;
+   uint64_t now = cur_monotonic_nanosec();
+   g_mutex_lock(&published_state_mutex);
+   if (writer_state) {
+      Published_Display * disp = get_writer_display(dref->io_path.path.i2c_busno);
+      if (disp) {
+         Published_Vcp_Value * val = &disp->values[feature_code];
+         if (response || val->state == PUBLISHED_VALUE) {
+            uint32_t seq = __atomic_load_n(&disp->seq, __ATOMIC_RELAXED);
+            __atomic_store_n(&disp->seq, seq+1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            val->state  = new_state;
+            val->status = psc;
+            if (response) {
+               val->mh = response->mh;
+               val->ml = response->ml;
+               val->sh = response->sh;
+               val->sl = response->sl;
+            }
+            else if (new_state == PUBLISHED_VALUE) {
+               val->sh = new_value >> 8;
+               val->sl = new_value & 0xff;
+            }
+            val->updated_nanos = now;
+            __atomic_store_n(&disp->seq, seq+2, __ATOMIC_RELEASE);
+         }
+      }
+   }
+   g_mutex_unlock(&published_state_mutex);
+}
+
+
+/** Publishes the result of reading a non-table feature.
+ *
+ *  No action is taken unless publishing is active.  Of errors, only those
+ *  reporting that the feature is unsupported are published.  After other,
+ *  presumably transient, errors the value already published remains.
+ *
+ *  @param  dref          display reference
+ *  @param  feature_code  VCP feature code
+ *  @param  psc           status of the read
+ *  @param  response      value read, if psc == 0
+ */
+void
+ddc_publish_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      DDCA_Status                          psc,
+      const Parsed_Nontable_Vcp_Response * response)
+{
+   if (!writer_state)
+      return;
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x, psc=%s",
+                   dref_repr_t(dref), feature_code, psc_desc(psc));
+   if (psc == 0)
+      publish(dref, feature_code, PUBLISHED_VALUE, 0, response, 0);
+   else if (psc == DDCRC_REPORTED_UNSUPPORTED || psc == DDCRC_DETERMINED_UNSUPPORTED) {
+      Parsed_Nontable_Vcp_Response none;
+      memset(&none, 0, sizeof(none));
+      publish(dref, feature_code, PUBLISHED_ERROR, psc, &none, 0);
+   }
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Publishes a value that has been successfully written.
+ *
+ *  The value is published only if a value read from the display, and so
+ *  its maximum value, has already been published.
+ *
+ *  @param  dref          display reference
+ *  @param  feature_code  VCP feature code
+ *  @param  new_value     value written
+ */
+void
+ddc_publish_written_vcp_value(
+      Display_Ref *          dref,
+      DDCA_Vcp_Feature_Code  feature_code,
+      int                    new_value)
+{
+   if (!writer_state)
+      return;
+   publish(dref, feature_code, PUBLISHED_VALUE, 0, NULL, new_value);
+}
+
+
+//
+// Reader
+//
+
+// Must be called with published_state_mutex held
+static Published_State *
+map_reader_state() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   Published_State * result = NULL;
+   char * fn = published_state_file_name();
+   int fd = open(fn, O_RDONLY|O_CLOEXEC);
+   if (fd < 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Error opening %s: %s", fn, strerror(errno));
+      goto bye;
+   }
+   struct stat statbuf;
+   if (fstat(fd, &statbuf) == 0 && statbuf.st_size == sizeof(Published_State)) {
+      void * addr = mmap(NULL, sizeof(Published_State), PROT_READ, MAP_SHARED, fd, 0);
+      if (addr != MAP_FAILED) {
+         result = addr;
+         if (memcmp(result->marker, PUBLISHED_STATE_MARKER, 4) != 0 ||
+             result->version != PUBLISHED_STATE_VERSION ||
+             result->display_max != PUBLISHED_DISPLAY_MAX)
+         {
+            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Unexpected header in %s", fn);
+            munmap(addr, sizeof(Published_State));
+            result = NULL;
+         }
+         __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      }
+   }
+   close(fd);
+
+bye:
+   g_free(fn);
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %p", result);
+   return result;
+}
+
+
+/** Returns the mapped state file, mapping it if necessary.
+ *
+ *  A mapping of a file that the server has closed is not unmapped, since
+ *  another thread may be reading from it.  This leaks one mapping per
+ *  server restart.
+ */
+static const Published_State *
+get_reader_state() {
+   const Published_State * state = __atomic_load_n(&reader_state, __ATOMIC_ACQUIRE);
+   if (state && !__atomic_load_n(&state->closed, __ATOMIC_ACQUIRE))
+      return state;
+
+   uint64_t now = cur_monotonic_nanosec();
+   g_mutex_lock(&published_state_mutex);
+   if (reader_state == state && now >= reader_next_map_nanos) {
+      reader_next_map_nanos = now + PUBLISHED_REMAP_MILLISEC * (uint64_t) 1000000;
+      Published_State * new_state = map_reader_state();
+      if (new_state || (state && state->closed))
+         __atomic_store_n(&reader_state, new_state, __ATOMIC_RELEASE);
+   }
+   state = reader_state;
+   g_mutex_unlock(&published_state_mutex);
+   return (state && !state->closed) ? state : NULL;
+}
+
+
+/** Gets the value of a non-table feature published by a ddcutil server.
+ *
+ *  @param  busno             I2C bus number of the display
+ *  @param  feature_code      VCP feature code
+ *  @param  valrec            where to return the value
+ *  @param  age_millisec_loc  if non-NULL, where to return how long ago
+ *                            the value was read or written
+ *  @retval 0                 success
+ *  @retval DDCRC_NOT_FOUND   no server is publishing values, or no value
+ *                            has been published for the feature
+ *  @retval DDCRC_LOCKED      the value was being updated continuously
+ *  @return status of the server's last attempt to read the feature,
+ *          e.g. DDCRC_REPORTED_UNSUPPORTED
+ */
+DDCA_Status
+ddc_get_published_vcp_value(
+      int                         busno,
+      DDCA_Vcp_Feature_Code       feature_code,
+      DDCA_Non_Table_Vcp_Value *  valrec,
+      uint64_t *                  age_millisec_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d, feature_code=0x%02x", busno, feature_code);
+
+   DDCA_Status psc = DDCRC_NOT_FOUND;
+   const Published_State * state = get_reader_state();
+   const Published_Display * disp = NULL;
+   for (int ndx = 0; state && ndx < PUBLISHED_DISPLAY_MAX && !disp; ndx++) {
+      if (__atomic_load_n(&state->displays[ndx].in_use, __ATOMIC_ACQUIRE) &&
+          state->displays[ndx].busno == busno)
+         disp = &state->displays[ndx];
+   }
+
+   if (disp) {
+      Published_Vcp_Value val;
+      int tryctr = 0;
+      for (; tryctr < PUBLISHED_READ_RETRIES; tryctr++) {
+         uint32_t seq1 = __atomic_load_n(&disp->seq, __ATOMIC_ACQUIRE);
+         if (seq1 & 1)
+            continue;
+         memcpy(&val, (const void *) &disp->values[feature_code], sizeof(val));
+         __atomic_thread_fence(__ATOMIC_ACQUIRE);
+         if (__atomic_load_n(&disp->seq, __ATOMIC_RELAXED) == seq1)
+            break;
+      }
+      if (tryctr == PUBLISHED_READ_RETRIES)
+         psc = DDCRC_LOCKED;
+      else if (val.state == PUBLISHED_VALUE) {
+         valrec->mh = val.mh;
+         valrec->ml = val.ml;
+         valrec->sh = val.sh;
+         valrec->sl = val.sl;
+         if (age_millisec_loc)
+            *age_millisec_loc = (cur_monotonic_nanosec() - val.updated_nanos) / 1000000;
+         psc = 0;
+      }
+      else if (val.state == PUBLISHED_ERROR) {
+         psc = val.status;
+      }
+   }
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, psc, "");
+   return psc;
+}
+
+
+void init_ddc_published_state() {
+   RTTI_ADD_FUNC(ddc_start_publishing_state);
+   RTTI_ADD_FUNC(ddc_stop_publishing_state);
+   RTTI_ADD_FUNC(ddc_publish_vcp_value);
+   RTTI_ADD_FUNC(ddc_get_published_vcp_value);
+}
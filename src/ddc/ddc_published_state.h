@@ -0,0 +1,44 @@
+/** @file ddc_published_state.h
+ *
+ *  Latest known VCP feature values, published by a ddcutil server in shared
+ *  memory for other processes to read
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_PUBLISHED_STATE_H_
+#define DDC_PUBLISHED_STATE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ddcutil_types.h"
+
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+
+// Writer
+bool ddc_start_publishing_state();
+void ddc_stop_publishing_state();
+bool ddc_is_publishing_state();
+void ddc_publish_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      DDCA_Status                          psc,
+      const Parsed_Nontable_Vcp_Response * response);
+void ddc_publish_written_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      int                                  new_value);
+
+// Reader
+DDCA_Status ddc_get_published_vcp_value(
+      int                                  busno,
+      DDCA_Vcp_Feature_Code                feature_code,
+      DDCA_Non_Table_Vcp_Value *           valrec,
+      uint64_t *                           age_millisec_loc);
+
+void init_ddc_published_state();
+
+#endif /* DDC_PUBLISHED_STATE_H_ */
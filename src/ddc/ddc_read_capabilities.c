@@ -14,12 +14,18 @@
 /** \endcond */
 
 #include "util/data_structures.h"
+#include "util/glib_string_util.h"
 #include "util/report_util.h"
+#include "util/timestamp.h"
 
 #include "public/ddcutil_types.h"
 
 #include "base/core.h"
 #include "base/ddc_errno.h"
+#include "base/executor.h"
+#include "base/latency_stats.h"
+#include "base/monitor_model_key.h"
+#include "base/op_profile.h"
 #include "base/rtti.h"
 #include "base/sleep.h"
 #include "base/tuned_sleep.h"
@@ -30,6 +36,7 @@
 
 #include "vcp/persistent_capabilities.h"
 
+#include "ddc/ddc_deadline.h"
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_packet_io.h"
 
@@ -91,6 +98,128 @@ get_capabilities_into_buffer(
 }
 
 
+//
+// Per-model capabilities reads
+//
+// Within a detection session, displays with the same monitor model key are
+// assumed to report the same capabilities string, as the persistent
+// capabilities cache also assumes.  The first display of a model to need its
+// capabilities string reads it.  Other displays of the model wait for that
+// read instead of performing their own, and reuse its result afterwards.
+// If the read fails, the next display of the model to need the string reads
+// it.  The results are discarded with the detected displays.
+//
+
+#define MODEL_CAPS_WAIT_SLICE_MICROSEC  10000   // how often a waiter checks its deadline
+
+typedef struct {
+   bool   reading;
+   char * caps;            // interned, NULL if not yet read
+} Model_Capabilities;
+
+static GHashTable * model_capabilities = NULL;   // model string -> Model_Capabilities *
+static GMutex       model_capabilities_mutex;    // protects model_capabilities and its values
+static GCond        model_capabilities_cond;     // signaled when a read completes
+
+
+static void
+free_model_capabilities(gpointer data) {
+   Model_Capabilities * rec = data;
+   gaux_release_interned_string(rec->caps);
+   free(rec);
+}
+
+
+static gboolean
+model_capabilities_not_reading(gpointer key, gpointer value, gpointer user_data) {
+   return !((Model_Capabilities *) value)->reading;
+}
+
+
+/** Discards the capabilities strings read for each monitor model,
+ *  except for reads still in progress.
+ */
+void ddc_discard_model_capabilities() {
+   g_mutex_lock(&model_capabilities_mutex);
+   if (model_capabilities)
+      g_hash_table_foreach_remove(model_capabilities, model_capabilities_not_reading, NULL);
+   g_mutex_unlock(&model_capabilities_mutex);
+}
+
+
+/** Reads the capabilities string of a display by DDC, or obtains the string
+ *  read for another display of the same model during this session.
+ *
+ *  @param  dh       display handle
+ *  @param  caps_loc where to return interned capabilities string
+ *  @return pointer to #Error_Info struct, NULL if no error
+ */
+static Error_Info *
+read_model_capabilities(Display_Handle * dh, char ** caps_loc) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+   Error_Info * ddc_excp = NULL;
+   Model_Capabilities * rec = NULL;
+   *caps_loc = NULL;
+
+   if (unique_monitor_model(dh->dref->mmid)) {
+      char * model = monitor_model_string(dh->dref->mmid);
+      DDCA_Status deadline_rc = 0;
+      g_mutex_lock(&model_capabilities_mutex);
+      if (!model_capabilities)
+         model_capabilities = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                                    free_model_capabilities);
+      rec = g_hash_table_lookup(model_capabilities, model);
+      if (!rec) {
+         rec = calloc(1, sizeof(Model_Capabilities));
+         g_hash_table_insert(model_capabilities, g_strdup(model), rec);
+      }
+      if (rec->reading)
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Waiting for read of capabilities for %s", model);
+      while (rec->reading && deadline_rc == 0) {
+         g_cond_wait_until(&model_capabilities_cond, &model_capabilities_mutex,
+                           g_get_monotonic_time() + MODEL_CAPS_WAIT_SLICE_MICROSEC);
+         if (rec->reading)
+            deadline_rc = ddc_check_deadline_status();
+      }
+      if (deadline_rc)
+         ddc_excp = errinfo_new(deadline_rc, __func__);
+      else if (rec->caps)
+         *caps_loc = gaux_intern_string(rec->caps);
+      else
+         rec->reading = true;
+      g_mutex_unlock(&model_capabilities_mutex);
+      if (ddc_excp || *caps_loc) {
+         DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "Using capabilities read for %s", model);
+         return ddc_excp;
+      }
+   }
+
+   Buffer * pcaps_buffer;
+   uint64_t start_nanos = cur_monotonic_nanosec();
+   ddc_excp = get_capabilities_into_buffer(dh, &pcaps_buffer);
+   record_display_latency(dh->dref->io_path, DDCA_LATENCY_CAPABILITIES,
+                          cur_monotonic_nanosec() - start_nanos);
+   if (!ddc_excp) {
+      *caps_loc = gaux_intern_string((char *) pcaps_buffer->bytes);
+      buffer_free(pcaps_buffer,__func__);
+   }
+
+   if (rec) {
+      g_mutex_lock(&model_capabilities_mutex);
+      rec->reading = false;
+      if (*caps_loc)
+         rec->caps = gaux_intern_string(*caps_loc);
+      g_cond_broadcast(&model_capabilities_cond);
+      g_mutex_unlock(&model_capabilities_mutex);
+   }
+
+   ASSERT_IFF(*caps_loc, !ddc_excp);
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "*caps_loc -> |%s|", *caps_loc);
+   return ddc_excp;
+}
+
+
 /** Gets the capabilities string for a display.
  *
  *  The value is cached as this is an expensive operation.
@@ -111,21 +240,29 @@ ddc_get_capabilities_string(
    assert(dh);
    assert(dh->dref);
    DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+   OP_PROFILE(OPT_CAPABILITIES, dh->dref);
 
    // Public_Status_Code psc = 0;
    Error_Info * ddc_excp = NULL;
    if (!dh->dref->capabilities_string) {
       if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
 #ifdef USE_USB
-         // newly created string, can just  reference
-         dh->dref->capabilities_string = usb_get_capabilities_string_by_dh(dh);
+         char * caps = usb_get_capabilities_string_by_dh(dh);
+         if (caps) {
+            dh->dref->capabilities_string = gaux_intern_string(caps);
+            free(caps);
+         }
 #else
          PROGRAM_LOGIC_ERROR("ddcutil not built with USB support");
 #endif
       }
       else {
          // n. persistent_capabilities_enabled handled in get_persistent_capabilities()
-         dh->dref->capabilities_string = g_strdup(get_persistent_capabilities(dh->dref->mmid));
+         // interned, so displays of the same model share a single copy
+         char * persistent_caps = get_persistent_capabilities(dh->dref->mmid,
+                                               (dh->dref->pedid) ? dh->dref->pedid->bytes : NULL);
+         if (persistent_caps)
+            dh->dref->capabilities_string = gaux_intern_string(persistent_caps);
          DBGTRC_NOPREFIX(debug, TRACE_GROUP, "get_persistent_capabilities() returned |%s|",
                                     dh->dref->capabilities_string);
          if (dh->dref->capabilities_string && get_output_level() >= DDCA_OL_VERBOSE) {
@@ -135,12 +272,11 @@ ddc_get_capabilities_string(
          }
 
          if (!dh->dref->capabilities_string) {
-            Buffer * pcaps_buffer;
-            ddc_excp = get_capabilities_into_buffer(dh, &pcaps_buffer);
+            ddc_excp = read_model_capabilities(dh, &dh->dref->capabilities_string);
             if (!ddc_excp) {
-               dh->dref->capabilities_string = strdup((char *) pcaps_buffer->bytes);
-               buffer_free(pcaps_buffer,__func__);
-               set_persistent_capabilites(dh->dref->mmid, dh->dref->capabilities_string);
+               set_persistent_capabilites(dh->dref->mmid,
+                                          (dh->dref->pedid) ? dh->dref->pedid->bytes : NULL,
+                                          dh->dref->capabilities_string);
             }
          }
       }
@@ -153,6 +289,141 @@ ddc_get_capabilities_string(
 }
 
 
+//
+// Capabilities prefetch
+//
+// If enabled, the capabilities strings of displays that are not in the
+// persistent capabilities cache are read by tasks of the shared executor as
+// soon as displays have been detected, one task per display.  Each task opens
+// its display with CALLOPT_WAIT, so it respects the display lock.
+// ddc_open_display() waits for a pending prefetch of the display to finish,
+// so the prefetch never causes a client open to fail with DDCRC_LOCKED.
+//
+
+static bool        capabilities_prefetch_enabled = false;
+static GHashTable * prefetch_recs = NULL;     // Display_Ref * -> Prefetch_Rec *
+static GMutex      prefetch_mutex;
+static GCond       prefetch_done_cond;
+static GPrivate    prefetch_worker_key;       // set while a prefetch task executes
+
+typedef struct {
+   Display_Ref * dref;
+   bool          done;
+} Prefetch_Rec;
+
+
+/** Enables or disables capabilities prefetch after display detection.
+ *
+ *  @param  onoff  true to enable, false to disable
+ *  @return prior setting
+ */
+bool ddc_enable_capabilities_prefetch(bool onoff) {
+   bool old = capabilities_prefetch_enabled;
+   capabilities_prefetch_enabled = onoff;
+   return old;
+}
+
+
+// satisfies Executor_Task_Func
+static void
+prefetch_capabilities_task(gpointer data) {
+   bool debug = false;
+   Prefetch_Rec * rec = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s", dref_repr_t(rec->dref));
+   g_private_set(&prefetch_worker_key, GINT_TO_POINTER(1));
+
+   Display_Handle * dh = NULL;
+   DDCA_Status ddcrc = ddc_open_display(rec->dref, CALLOPT_WAIT, &dh);
+   if (ddcrc == 0) {
+      char * caps = NULL;
+      Error_Info * ddc_excp = ddc_get_capabilities_string(dh, &caps);
+      if (ddc_excp) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "%s", errinfo_summary(ddc_excp));
+         errinfo_free(ddc_excp);
+      }
+      ddc_close_display(dh);
+   }
+
+   g_private_set(&prefetch_worker_key, NULL);
+   g_mutex_lock(&prefetch_mutex);
+   rec->done = true;
+   g_cond_broadcast(&prefetch_done_cond);
+   g_mutex_unlock(&prefetch_mutex);
+   DBGTRC_DONE(debug, TRACE_GROUP, "ddcrc=%s", psc_desc(ddcrc));
+}
+
+
+/** Starts background capabilities reads for the displays in a list that
+ *  do not yet have a capabilities string and are not in the persistent
+ *  capabilities cache.  Does nothing unless prefetch is enabled.
+ *
+ *  @param  display_refs  array of #Display_Ref
+ */
+void ddc_start_capabilities_prefetch(GPtrArray * display_refs) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "capabilities_prefetch_enabled=%s",
+                                       sbool(capabilities_prefetch_enabled));
+   if (capabilities_prefetch_enabled && display_refs) {
+      g_mutex_lock(&prefetch_mutex);
+      if (!prefetch_recs)
+         prefetch_recs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free);
+      for (int ndx = 0; ndx < display_refs->len; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(display_refs, ndx);
+         if ( dref->io_path.io_mode != DDCA_IO_I2C ||
+              dref->dispno <= 0 ||
+              !(dref->flags & DREF_DDC_COMMUNICATION_WORKING) ||
+              (dref->flags & DREF_OPEN) ||
+              dref->capabilities_string ||
+              g_hash_table_contains(prefetch_recs, dref) ||
+              get_persistent_capabilities(dref->mmid, (dref->pedid) ? dref->pedid->bytes : NULL) )
+            continue;
+         Prefetch_Rec * rec = calloc(1, sizeof(Prefetch_Rec));
+         rec->dref = dref;
+         g_hash_table_insert(prefetch_recs, dref, rec);
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Prefetching capabilities for %s", dref_repr_t(dref));
+         executor_submit(NULL, NULL, prefetch_capabilities_task, rec);
+      }
+      g_mutex_unlock(&prefetch_mutex);
+   }
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Waits for capabilities prefetch to complete.
+ *
+ *  @param  dref  display to wait for, NULL to wait for all displays and
+ *                discard the prefetch records
+ *
+ *  @remark
+ *  Does not wait when called from a prefetch task.
+ */
+void ddc_wait_capabilities_prefetch(Display_Ref * dref) {
+   bool debug = false;
+   if (g_private_get(&prefetch_worker_key))
+      return;
+   g_mutex_lock(&prefetch_mutex);
+   if (prefetch_recs) {
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, prefetch_recs);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         Prefetch_Rec * rec = value;
+         if (!dref || rec->dref == dref) {
+            if (!rec->done)
+               DBGTRC(debug, TRACE_GROUP, "Waiting for prefetch of %s", dref_repr_t(rec->dref));
+            while (!rec->done)
+               g_cond_wait(&prefetch_done_cond, &prefetch_mutex);
+         }
+      }
+      if (!dref) {
+         g_hash_table_destroy(prefetch_recs);
+         prefetch_recs = NULL;
+      }
+   }
+   g_mutex_unlock(&prefetch_mutex);
+}
+
+
 #ifdef UNUSED
 Error_Info *
 get_capabilities_string_by_dref(Display_Ref * dref, char **pcaps) {
@@ -188,6 +459,9 @@ get_capabilities_string_by_dref(Display_Ref * dref, char **pcaps) {
 
 void init_ddc_read_capabilities() {
    RTTI_ADD_FUNC(ddc_get_capabilities_string);
+   RTTI_ADD_FUNC(read_model_capabilities);
    RTTI_ADD_FUNC(get_capabilities_into_buffer);
+   RTTI_ADD_FUNC(prefetch_capabilities_task);
+   RTTI_ADD_FUNC(ddc_start_capabilities_prefetch);
 }
 
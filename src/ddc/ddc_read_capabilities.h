@@ -8,6 +8,8 @@
 #define DDC_READ_CAPABILITIES_H_
 
 /** \cond */
+#include <glib-2.0/glib.h>
+
 #include "util/error_info.h"
 /** \endcond */
 
@@ -22,6 +24,11 @@ ddc_get_capabilities_string(
       Display_Handle * dh,
       char**           caps_loc);
 
+bool ddc_enable_capabilities_prefetch(bool onoff);
+void ddc_start_capabilities_prefetch(GPtrArray * display_refs);
+void ddc_wait_capabilities_prefetch(Display_Ref * dref);
+void ddc_discard_model_capabilities();
+
 void init_ddc_read_capabilities();
 
 #endif /* DDC_READ_CAPABILITIES_H_ */
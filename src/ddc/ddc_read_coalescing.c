@@ -0,0 +1,259 @@
+/** @file ddc_read_coalescing.c
+ *
+ *  Coalesces identical concurrent reads of a VCP feature, e.g. when several
+ *  clients of a daemon read feature x10 of the same display right after a
+ *  hotplug event.
+ *
+ *  When enabled, the first thread to read a feature of a display with a
+ *  given value type becomes the leader and performs the read.  Threads that
+ *  request the same read while it is in flight wait for it instead of
+ *  performing their own DDC transactions, and receive copies of its value
+ *  or status.  A waiting thread's own deadline and cancel token, see
+ *  ddc_deadline.c, remain in effect.  If the leader's read fails because the
+ *  leader's deadline passed or it was cancelled, the waiting threads read
+ *  the feature again.
+ *
+ *  A write of a feature ends the coalescing of reads already in flight, so
+ *  a read that starts after a write never receives a value read before it.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/error_info.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/rtti.h"
+#include "base/stats_export.h"
+
+#include "vcp/vcp_feature_values.h"
+
+#include "ddc/ddc_deadline.h"
+
+#include "ddc/ddc_read_coalescing.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define COALESCED_WAIT_SLICE_MICROSEC  10000    // how often a waiter checks its deadline
+
+#define INFLIGHT_READ_MARKER "IFRD"
+/** A read being performed by a leader thread */
+typedef struct {
+   char                 marker[4];
+   Display_Ref *        dref;
+   Byte                 feature_code;
+   DDCA_Vcp_Value_Type  value_type;
+   bool                 completed;
+   int                  waiter_ct;       // waiting threads that have not yet taken the result
+   DDCA_Status          status;          // of the completed read
+   DDCA_Any_Vcp_Value * valrec;          // copy of the value read, if there are waiters
+} Inflight_Read;
+
+static bool        read_coalescing_enabled = false;
+static GMutex      inflight_mutex;            // protects inflight_reads and Inflight_Read fields
+static GCond       inflight_cond;             // signaled when any read completes
+static GPtrArray * inflight_reads = NULL;     // Inflight_Read *, that new readers may join
+static uint64_t    performed_read_ct = 0;     // atomic access
+static uint64_t    shared_read_ct = 0;        // atomic access
+
+
+/** Enables or disables coalescing of identical concurrent reads.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global, not thread-specific.
+ */
+bool ddc_enable_read_coalescing(bool onoff) {
+   bool old = read_coalescing_enabled;
+   read_coalescing_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether coalescing of identical concurrent reads is enabled.
+ *
+ *  \return true/false
+ */
+bool ddc_is_read_coalescing_enabled() {
+   return read_coalescing_enabled;
+}
+
+
+static DDCA_Any_Vcp_Value *
+copy_vcp_value(DDCA_Any_Vcp_Value * valrec) {
+   if (valrec->value_type == DDCA_TABLE_VCP_VALUE)
+      return create_table_vcp_value_by_bytes(valrec->opcode, valrec->val.t.bytes, valrec->val.t.bytect);
+   return create_nontable_vcp_value(valrec->opcode,
+         valrec->val.c_nc.mh, valrec->val.c_nc.ml, valrec->val.c_nc.sh, valrec->val.c_nc.sl);
+}
+
+
+static void
+free_inflight_read(Inflight_Read * flight) {
+   assert(memcmp(flight->marker, INFLIGHT_READ_MARKER, 4) == 0);
+   if (flight->valrec)
+      free_single_vcp_value(flight->valrec);
+   flight->marker[3] = 'x';
+   g_free(flight);
+}
+
+
+// Must be called with inflight_mutex held
+static Inflight_Read *
+find_inflight_read(Display_Ref * dref, Byte feature_code, DDCA_Vcp_Value_Type value_type) {
+   if (!inflight_reads)
+      inflight_reads = g_ptr_array_new();
+   for (int ndx = 0; ndx < inflight_reads->len; ndx++) {
+      Inflight_Read * cur = g_ptr_array_index(inflight_reads, ndx);
+      if (cur->dref == dref && cur->feature_code == feature_code && cur->value_type == value_type)
+         return cur;
+   }
+   return NULL;
+}
+
+
+/** Reads a VCP feature, sharing the result of an identical read by
+ *  another thread that is already in flight.
+ *
+ *  \param  dh            display handle
+ *  \param  feature_code  feature code
+ *  \param  value_type    table or non-table
+ *  \param  read_func     function that performs the read
+ *  \param  valrec_loc    where to return newly allocated value
+ *  \return NULL if success, pointer to #Error_Info if failure
+ */
+Error_Info *
+ddc_coalesced_read(
+      Display_Handle *       dh,
+      Byte                   feature_code,
+      DDCA_Vcp_Value_Type    value_type,
+      Vcp_Read_Func          read_func,
+      DDCA_Any_Vcp_Value **  valrec_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x, value_type=%d",
+                                       dh_repr(dh), feature_code, value_type);
+   Error_Info * excp = NULL;
+   *valrec_loc = NULL;
+   bool done = false;
+   while (!done) {
+      g_mutex_lock(&inflight_mutex);
+      Inflight_Read * flight = find_inflight_read(dh->dref, feature_code, value_type);
+      if (!flight) {
+         flight = g_new0(Inflight_Read, 1);
+         memcpy(flight->marker, INFLIGHT_READ_MARKER, 4);
+         flight->dref         = dh->dref;
+         flight->feature_code = feature_code;
+         flight->value_type   = value_type;
+         g_ptr_array_add(inflight_reads, flight);
+         g_mutex_unlock(&inflight_mutex);
+
+         excp = read_func(dh, feature_code, value_type, valrec_loc);
+         __atomic_add_fetch(&performed_read_ct, 1, __ATOMIC_RELAXED);
+
+         g_mutex_lock(&inflight_mutex);
+         // may already have been removed by ddc_end_coalesced_reads()
+         g_ptr_array_remove(inflight_reads, flight);
+         flight->completed = true;
+         flight->status = ERRINFO_STATUS(excp);
+         bool free_flight = (flight->waiter_ct == 0);
+         if (!free_flight && !excp)
+            flight->valrec = copy_vcp_value(*valrec_loc);
+         g_cond_broadcast(&inflight_cond);
+         g_mutex_unlock(&inflight_mutex);
+         if (free_flight)
+            free_inflight_read(flight);
+         done = true;
+      }
+      else {
+         flight->waiter_ct++;
+         DDCA_Status deadline_rc = 0;
+         while (!flight->completed && deadline_rc == 0) {
+            g_cond_wait_until(&inflight_cond, &inflight_mutex,
+                              g_get_monotonic_time() + COALESCED_WAIT_SLICE_MICROSEC);
+            if (!flight->completed)
+               deadline_rc = ddc_check_deadline_status();
+         }
+         if (!flight->completed) {
+            excp = errinfo_new(deadline_rc, __func__);
+            done = true;
+         }
+         else if (flight->status != DDCRC_TIMEOUT && flight->status != DDCRC_CANCELLED) {
+            if (flight->status == 0)
+               *valrec_loc = copy_vcp_value(flight->valrec);
+            else
+               excp = errinfo_new2(flight->status, __func__, "Concurrent read by another thread failed");
+            __atomic_add_fetch(&shared_read_ct, 1, __ATOMIC_RELAXED);
+            done = true;
+         }
+         else {
+            DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Leader's read ended by its deadline, reading again");
+         }
+         bool free_flight = (--flight->waiter_ct == 0 && flight->completed);
+         g_mutex_unlock(&inflight_mutex);
+         if (free_flight)
+            free_inflight_read(flight);
+      }
+   }
+
+   ASSERT_IFF(!excp, *valrec_loc);
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, excp, "");
+   return excp;
+}
+
+
+/** Prevents reads that start after a write of a feature from sharing
+ *  the results of reads of the feature that are already in flight.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  feature written
+ */
+void
+ddc_end_coalesced_reads(Display_Ref * dref, Byte feature_code) {
+   if (!read_coalescing_enabled)
+      return;
+   g_mutex_lock(&inflight_mutex);
+   if (inflight_reads) {
+      for (int ndx = inflight_reads->len-1; ndx >= 0; ndx--) {
+         Inflight_Read * cur = g_ptr_array_index(inflight_reads, ndx);
+         if (cur->dref == dref && cur->feature_code == feature_code)
+            g_ptr_array_remove_index(inflight_reads, ndx);
+      }
+   }
+   g_mutex_unlock(&inflight_mutex);
+}
+
+
+/** Exports the counts of reads performed and of reads that shared
+ *  the result of a concurrent read.
+ *
+ *  \param exp  export instance
+ */
+void
+export_read_coalescing_stats(Stats_Export * exp) {
+   stats_export_metric(exp, "ddcutil_coalesced_reads_total", STATS_METRIC_COUNTER,
+                            "VCP reads while read coalescing is enabled, by whether the read was performed or shared");
+   stats_export_sample(exp, "ddcutil_coalesced_reads_total",
+                       __atomic_load_n(&performed_read_ct, __ATOMIC_RELAXED), 1, "result", "performed");
+   stats_export_sample(exp, "ddcutil_coalesced_reads_total",
+                       __atomic_load_n(&shared_read_ct, __ATOMIC_RELAXED), 1, "result", "shared");
+}
+
+
+void
+init_ddc_read_coalescing() {
+   RTTI_ADD_FUNC(ddc_coalesced_read);
+}
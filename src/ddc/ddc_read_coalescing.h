@@ -0,0 +1,41 @@
+/** @file ddc_read_coalescing.h
+ *
+ *  Coalesces identical concurrent reads of a VCP feature
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_READ_COALESCING_H_
+#define DDC_READ_COALESCING_H_
+
+#include <stdbool.h>
+
+#include "ddcutil_types.h"
+
+#include "util/coredefs.h"
+#include "util/error_info.h"
+
+#include "base/displays.h"
+#include "base/stats_export.h"
+
+/** Signature of the function that performs a read */
+typedef Error_Info * (*Vcp_Read_Func)(
+      Display_Handle *       dh,
+      Byte                   feature_code,
+      DDCA_Vcp_Value_Type    value_type,
+      DDCA_Any_Vcp_Value **  valrec_loc);
+
+bool         ddc_enable_read_coalescing(bool onoff);
+bool         ddc_is_read_coalescing_enabled();
+Error_Info * ddc_coalesced_read(
+      Display_Handle *       dh,
+      Byte                   feature_code,
+      DDCA_Vcp_Value_Type    value_type,
+      Vcp_Read_Func          read_func,
+      DDCA_Any_Vcp_Value **  valrec_loc);
+void         ddc_end_coalesced_reads(Display_Ref * dref, Byte feature_code);
+void         export_read_coalescing_stats(Stats_Export * exp);
+void         init_ddc_read_coalescing();
+
+#endif /* DDC_READ_COALESCING_H_ */
@@ -0,0 +1,364 @@
+/** @file ddc_remembered_values.c
+ *
+ *  Remembers the last known values of selected non-table features of each
+ *  display across processes, so that a client can show e.g. brightness and
+ *  input source at startup without waiting for DDC reads.
+ *
+ *  Values are kept in the persistent store, see persistent_store.c, keyed by
+ *  a hash of the display's EDID, which is unique per panel.  They are updated
+ *  whenever a selected feature is successfully read or written.
+ *
+ *  #ddc_get_remembered_vcp_value() never performs DDC I/O.  It returns the
+ *  remembered value, flagged as stale unless the value was read or written by
+ *  this process, and queues a background read of a stale value to the
+ *  display's worker thread, see ddc_async_requests.c.  When the read
+ *  completes, the client's callback is called only if the value differs from
+ *  the one returned, or if there was no value to return.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/data_structures.h"
+#include "util/edid.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+#include "base/persistent_store.h"
+#include "base/rtti.h"
+
+#include "vcp/persistent_capabilities.h"
+
+#include "ddc/ddc_async_requests.h"
+
+#include "ddc/ddc_remembered_values.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+/** Remembered values of one display */
+typedef struct {
+   Bit_Set_256              known;        // features with a remembered value
+   Bit_Set_256              fresh;        // read or written by this process
+   Bit_Set_256              refreshing;   // background read queued
+   DDCA_Non_Table_Vcp_Value values[256];
+} Remembered_Display;
+
+static Bit_Set_256  remembered_features;        // protected by remembered_mutex
+// EDID key -> Remembered_Display *, protected by remembered_mutex
+static GHashTable * remembered_display_table = NULL;
+static GMutex       remembered_mutex;
+
+
+/** Sets the features whose values are remembered.
+ *
+ *  \param  features  feature codes, only non-table features are meaningful
+ *  \return prior setting
+ */
+Bit_Set_256
+ddc_set_remembered_features(Bit_Set_256 features) {
+   g_mutex_lock(&remembered_mutex);
+   Bit_Set_256 old = remembered_features;
+   remembered_features = features;
+   g_mutex_unlock(&remembered_mutex);
+   return old;
+}
+
+
+/** Returns the features whose values are remembered.
+ *
+ *  \return feature codes, EMPTY_BIT_SET_256 if none
+ */
+Bit_Set_256
+ddc_get_remembered_features() {
+   g_mutex_lock(&remembered_mutex);
+   Bit_Set_256 result = remembered_features;
+   g_mutex_unlock(&remembered_mutex);
+   return result;
+}
+
+
+// Caller must free.  Returns NULL if the display has no EDID.
+static char *
+remembered_display_key(Display_Ref * dref) {
+   if (!dref->pedid)
+      return NULL;
+   gchar * hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, dref->pedid->bytes, 128);
+   char * key = g_strdup_printf("EDID-%s", hash);
+   g_free(hash);
+   return key;
+}
+
+
+// Parses a stored value, which has the form "<feature>=<mh><ml><sh><sl> ...",
+// e.g. "10=00640032 60=0000000f"
+static void
+parse_remembered_values(const char * value, Remembered_Display * rd) {
+   bool debug = false;
+   Null_Terminated_String_Array pieces = strsplit(value, " ");
+   for (int pndx = 0; pieces[pndx]; pndx++) {
+      unsigned int feature_code, mh, ml, sh, sl;
+      if (sscanf(pieces[pndx], "%2x=%2x%2x%2x%2x", &feature_code, &mh, &ml, &sh, &sl) == 5) {
+         DDCA_Non_Table_Vcp_Value * v = &rd->values[feature_code];
+         v->mh = mh;
+         v->ml = ml;
+         v->sh = sh;
+         v->sl = sl;
+         rd->known = bs256_insert(rd->known, feature_code);
+      }
+      else {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Invalid remembered value: %s", pieces[pndx]);
+      }
+   }
+   ntsa_free(pieces, true);
+}
+
+
+// Must be called with remembered_mutex held
+static Remembered_Display *
+get_remembered_display(const char * key) {
+   if (!remembered_display_table)
+      remembered_display_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+   Remembered_Display * rd = g_hash_table_lookup(remembered_display_table, key);
+   if (!rd) {
+      rd = g_new0(Remembered_Display, 1);
+      char * value = (is_capabilities_cache_enabled())
+                        ? pstore_get(PSTORE_REMEMBERED_VALUES, key) : NULL;
+      if (value) {
+         parse_remembered_values(value, rd);
+         free(value);
+      }
+      g_hash_table_insert(remembered_display_table, g_strdup(key), rd);
+   }
+   return rd;
+}
+
+
+// Must be called with remembered_mutex held.  Caller must free.
+static char *
+format_remembered_values(Remembered_Display * rd) {
+   GString * s = g_string_new(NULL);
+   for (int code = 0; code < 256; code++) {
+      if (bs256_contains(rd->known, code)) {
+         DDCA_Non_Table_Vcp_Value * v = &rd->values[code];
+         g_string_append_printf(s, "%s%02x=%02x%02x%02x%02x",
+                                   (s->len > 0) ? " " : "", code, v->mh, v->ml, v->sh, v->sl);
+      }
+   }
+   return g_string_free(s, false);
+}
+
+
+static void
+remember_value(
+      Display_Ref *            dref,
+      DDCA_Vcp_Feature_Code    feature_code,
+      bool                     max_known,
+      Byte mh, Byte ml, Byte sh, Byte sl)
+{
+   bool debug = false;
+   char * key = remembered_display_key(dref);
+   if (!key)
+      return;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x", dref_repr_t(dref), feature_code);
+
+   char * save_value = NULL;
+   g_mutex_lock(&remembered_mutex);
+   Remembered_Display * rd = get_remembered_display(key);
+   DDCA_Non_Table_Vcp_Value * v = &rd->values[feature_code];
+   bool known = bs256_contains(rd->known, feature_code);
+   if (!max_known && known) {
+      mh = v->mh;
+      ml = v->ml;
+      max_known = true;
+   }
+   if (max_known) {
+      bool changed = !known || v->mh != mh || v->ml != ml || v->sh != sh || v->sl != sl;
+      v->mh = mh;
+      v->ml = ml;
+      v->sh = sh;
+      v->sl = sl;
+      rd->known = bs256_insert(rd->known, feature_code);
+      rd->fresh = bs256_insert(rd->fresh, feature_code);
+      if (changed && is_capabilities_cache_enabled())
+         save_value = format_remembered_values(rd);
+   }
+   g_mutex_unlock(&remembered_mutex);
+
+   // written outside remembered_mutex, since it rewrites the store file
+   bool saved = false;
+   if (save_value)
+      saved = pstore_set(PSTORE_REMEMBERED_VALUES, key, save_value);
+   g_free(save_value);
+   g_free(key);
+   DBGTRC_DONE(debug, TRACE_GROUP, "saved: %s", SBOOL(saved));
+}
+
+
+/** Records a value read from a display, if the feature is remembered.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \param  response      value read
+ */
+void
+ddc_remember_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      const Parsed_Nontable_Vcp_Response * response)
+{
+   if (!bs256_contains(ddc_get_remembered_features(), feature_code))
+      return;
+   remember_value(dref, feature_code, true, response->mh, response->ml, response->sh, response->sl);
+}
+
+
+/** Records a value successfully written to a display, if the feature is
+ *  remembered.  Since a write does not report the maximum value, the value
+ *  is recorded only if the feature already has a remembered value.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \param  new_value     value written
+ */
+void
+ddc_remember_written_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      int                                  new_value)
+{
+   if (!bs256_contains(ddc_get_remembered_features(), feature_code))
+      return;
+   remember_value(dref, feature_code, false, 0, 0, new_value >> 8, new_value & 0xff);
+}
+
+
+/** Returns the remembered value of a feature without DDC I/O.
+ *
+ *  If the value is stale, i.e. it was not read or written by this process,
+ *  or if there is no remembered value, a read of the feature is queued to
+ *  the display's worker thread.  When the read completes, **callback** is
+ *  called if the value read differs from the value returned, or if no value
+ *  was returned.
+ *
+ *  \param  dh            display handle
+ *  \param  feature_code  VCP feature code
+ *  \param  valrec        where to return the value
+ *  \param  stale_loc     where to return whether the value is stale
+ *  \param  callback      function called on the worker thread, may be NULL
+ *  \retval 0                        value returned
+ *  \retval DDCRC_INVALID_OPERATION  feature is not remembered
+ *  \retval DDCRC_NOT_FOUND          no value remembered, read queued
+ */
+DDCA_Status
+ddc_get_remembered_vcp_value(
+      Display_Handle *           dh,
+      DDCA_Vcp_Feature_Code      feature_code,
+      DDCA_Non_Table_Vcp_Value * valrec,
+      bool *                     stale_loc,
+      DDCA_Notification_Func     callback)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x", dh_repr(dh), feature_code);
+
+   DDCA_Status ddcrc = 0;
+   char * key = remembered_display_key(dh->dref);
+   if (!key || !bs256_contains(ddc_get_remembered_features(), feature_code)) {
+      g_free(key);
+      DBGTRC_RET_DDCRC(debug, TRACE_GROUP, DDCRC_INVALID_OPERATION, "");
+      return DDCRC_INVALID_OPERATION;
+   }
+
+   g_mutex_lock(&remembered_mutex);
+   Remembered_Display * rd = get_remembered_display(key);
+   bool known = bs256_contains(rd->known, feature_code);
+   bool stale = !bs256_contains(rd->fresh, feature_code);
+   bool queue_refresh = stale && !bs256_contains(rd->refreshing, feature_code);
+   DDCA_Non_Table_Vcp_Value prior = rd->values[feature_code];
+   if (queue_refresh)
+      rd->refreshing = bs256_insert(rd->refreshing, feature_code);
+   g_mutex_unlock(&remembered_mutex);
+   g_free(key);
+
+   memset(valrec, 0, sizeof(DDCA_Non_Table_Vcp_Value));
+   if (known)
+      *valrec = prior;
+   else
+      ddcrc = DDCRC_NOT_FOUND;
+   *stale_loc = stale;
+
+   if (queue_refresh) {
+      DDCA_Status qrc = ddc_queue_refresh_request(dh, feature_code, (known) ? &prior : NULL, callback);
+      if (qrc != 0)
+         ddc_finish_remembered_value_refresh(dh->dref, feature_code, qrc, NULL, NULL, NULL);
+   }
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "stale=%s, refresh queued=%s",
+                                               SBOOL(stale), SBOOL(queue_refresh));
+   return ddcrc;
+}
+
+
+/** Completes a background read queued by #ddc_get_remembered_vcp_value().
+ *  Called on the display's worker thread.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \param  psc           status of the read
+ *  \param  valrec        value read, NULL if the read was not performed
+ *  \param  prior         value returned to the client, NULL if none
+ *  \param  callback      client function, may be NULL
+ */
+void
+ddc_finish_remembered_value_refresh(
+      Display_Ref *                    dref,
+      DDCA_Vcp_Feature_Code            feature_code,
+      DDCA_Status                      psc,
+      DDCA_Any_Vcp_Value *             valrec,
+      const DDCA_Non_Table_Vcp_Value * prior,
+      DDCA_Notification_Func           callback)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x, psc=%s",
+                                       dref_repr_t(dref), feature_code, psc_desc(psc));
+   char * key = remembered_display_key(dref);
+   if (key) {
+      g_mutex_lock(&remembered_mutex);
+      Remembered_Display * rd = get_remembered_display(key);
+      rd->refreshing = bs256_and_not(rd->refreshing, bs256_insert(EMPTY_BIT_SET_256, feature_code));
+      g_mutex_unlock(&remembered_mutex);
+      g_free(key);
+   }
+
+   bool changed = true;
+   if (psc == 0 && prior) {
+      changed = valrec->val.c_nc.mh != prior->mh || valrec->val.c_nc.ml != prior->ml ||
+                valrec->val.c_nc.sh != prior->sh || valrec->val.c_nc.sl != prior->sl;
+   }
+   else if (psc != 0 && prior) {
+      changed = false;        // client keeps the value it has
+   }
+   if (changed && callback && valrec)
+      callback(psc, valrec);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "changed=%s", SBOOL(changed));
+}
+
+
+void
+init_ddc_remembered_values() {
+   RTTI_ADD_FUNC(ddc_get_remembered_vcp_value);
+   RTTI_ADD_FUNC(ddc_finish_remembered_value_refresh);
+}
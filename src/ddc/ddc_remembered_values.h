@@ -0,0 +1,49 @@
+/** @file ddc_remembered_values.h
+ *
+ *  Last known values of selected features, remembered across processes
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_REMEMBERED_VALUES_H_
+#define DDC_REMEMBERED_VALUES_H_
+
+#include <stdbool.h>
+
+#include "ddcutil_types.h"
+
+#include "util/data_structures.h"
+
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+
+Bit_Set_256 ddc_set_remembered_features(Bit_Set_256 features);
+Bit_Set_256 ddc_get_remembered_features();
+
+void ddc_remember_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      const Parsed_Nontable_Vcp_Response * response);
+void ddc_remember_written_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      int                                  new_value);
+
+DDCA_Status ddc_get_remembered_vcp_value(
+      Display_Handle *                     dh,
+      DDCA_Vcp_Feature_Code                feature_code,
+      DDCA_Non_Table_Vcp_Value *           valrec,
+      bool *                               stale_loc,
+      DDCA_Notification_Func               callback);
+void ddc_finish_remembered_value_refresh(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      DDCA_Status                          psc,
+      DDCA_Any_Vcp_Value *                 valrec,
+      const DDCA_Non_Table_Vcp_Value *     prior,
+      DDCA_Notification_Func               callback);
+
+void init_ddc_remembered_values();
+
+#endif /* DDC_REMEMBERED_VALUES_H_ */
@@ -11,14 +11,25 @@
 /** \cond */
 #include <stdio.h>
 
+#include "util/alloc_stats.h"
 #include "util/report_util.h"
 /** \endcond */
 
+#include "base/api_call_stats.h"
 #include "base/base_init.h"
+#include "base/ddc_packets.h"
+#include "base/dynamic_sleep.h"
+#include "base/execution_stats.h"
+#include "base/executor.h"
 #include "base/feature_metadata.h"
+#include "base/display_health.h"
+#include "base/latency_stats.h"
+#include "base/lock_stats.h"
+#include "base/op_profile.h"
 #include "base/parms.h"
 #include "base/rtti.h"
 #include "base/sleep.h"
+#include "base/stats_export.h"
 #include "base/tuned_sleep.h"
 #include "base/thread_retry_data.h"
 #include "base/thread_sleep_data.h"
@@ -31,22 +42,40 @@
 #include "dynvcp/dyn_feature_files.h"
 
 #include "i2c/i2c_bus_core.h"
+#include "i2c/i2c_io_trace.h"
+#include "i2c/i2c_simulated_monitor.h"
 #include "i2c/i2c_strategy_dispatcher.h"
 #include "i2c/i2c_sysfs.h"
 #ifdef USE_USB
 #include "usb/usb_displays.h"
 #endif
 
+#include "ddc/ddc_adaptive_verify.h"
+#include "ddc/ddc_async_requests.h"
+#include "ddc/ddc_deadline.h"
 #include "ddc/ddc_display_lock.h"
 #include "ddc/ddc_displays.h"
+#include "ddc/ddc_displays_cache.h"
 #include "ddc/ddc_display_ref_reports.h"
 #include "ddc/ddc_dumpload.h"
+#include "ddc/ddc_feature_sampler.h"
+#include "ddc/ddc_feature_scan.h"
+#include "ddc/ddc_completion_queue.h"
+#include "ddc/ddc_io_scheduler.h"
 #include "ddc/ddc_multi_part_io.h"
+#include "ddc/ddc_multiplexed_io.h"
 #include "ddc/ddc_output.h"
 #include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_power_state.h"
+#include "ddc/ddc_read_coalescing.h"
+#include "ddc/ddc_remembered_values.h"
+#include "ddc/ddc_settle_window.h"
 #include "ddc/ddc_read_capabilities.h"
 #include "ddc/ddc_try_stats.h"
 #include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_change_watch.h"
+#include "ddc/ddc_published_state.h"
+#include "ddc/ddc_vcp_value_cache.h"
 #ifdef BUILD_SHARED_LIB
 #include "ddc/ddc_watch_displays.h"
 #endif
@@ -69,6 +98,12 @@ void ddc_reset_stats_main() {
    // ddc_reset_ddc_stats();
    try_data_reset2_all();
    reset_execution_stats();
+   reset_latency_stats();
+   reset_display_health();
+   reset_api_call_stats();
+   reset_lock_stats();
+   reset_op_profiles();
+   reset_alloc_stats();
 }
 
 
@@ -102,24 +137,44 @@ void ddc_report_stats_main(DDCA_Stats_Type stats, bool show_per_thread_stats, in
       report_execution_stats(depth);
       rpt_nl();
 
-#ifdef OLD
-      if (dsa_is_enabled()) {
-         // for now just report current thread
-         dsa_report_stats(depth);
+      if (tsd_get_dsa_enabled_default()) {
+         dsa_report_all_display_data(depth);
          rpt_nl();
       }
-#endif
 
       report_io_call_stats(depth);
       rpt_nl();
+      i2c_report_bus_check_timeouts(depth);
+      rpt_nl();
+      report_ddc_packet_stats(depth);
+      rpt_nl();
+      report_multi_part_write_stats(depth);
       report_sleep_stats(depth);
       rpt_nl();
       report_elapsed_stats(depth);
       rpt_nl();
+      report_persistent_cache_lookups(depth);
+      rpt_nl();
+      report_api_call_stats(depth);
    }
 
    if (stats & (DDCA_STATS_ELAPSED)) {
       report_elapsed_summary(depth);
+      report_startup_phases(depth);
+      report_op_profiles(depth);
+      rpt_nl();
+   }
+
+   if (stats & DDCA_STATS_LATENCY) {
+      report_latency_stats(depth);
+      rpt_nl();
+      report_display_health(depth);
+      rpt_nl();
+      report_lock_stats(depth);
+   }
+
+   if (stats & DDCA_STATS_MEMORY) {
+      report_alloc_stats(depth);
       rpt_nl();
    }
 
@@ -151,6 +206,100 @@ void ddc_report_stats_main(DDCA_Stats_Type stats, bool show_per_thread_stats, in
 }
 
 
+static void
+export_alloc_stats(Stats_Export * exp) {
+   struct {
+      const char *      name;
+      Stats_Metric_Type type;
+      const char *      help;
+   } metrics[] = {
+      {"ddcutil_alloc_current",       STATS_METRIC_GAUGE,   "Live allocations, by subsystem"},
+      {"ddcutil_alloc_current_bytes", STATS_METRIC_GAUGE,   "Bytes in live allocations, by subsystem"},
+      {"ddcutil_alloc_peak_bytes",    STATS_METRIC_GAUGE,   "Peak bytes in live allocations, by subsystem"},
+      {"ddcutil_alloc_total",         STATS_METRIC_COUNTER, "Allocations, by subsystem"},
+   };
+
+   for (int mndx = 0; mndx < ARRAY_SIZE(metrics); mndx++) {
+      stats_export_metric(exp, metrics[mndx].name, metrics[mndx].type, metrics[mndx].help);
+      for (int ndx = 0; ndx < ALLOC_SUBSYSTEM_CT; ndx++) {
+         Alloc_Stats stats;
+         get_alloc_stats(ndx, &stats);
+         double value = 0;
+         switch(mndx) {
+         case 0: value = stats.cur_ct;     break;
+         case 1: value = stats.cur_bytes;  break;
+         case 2: value = stats.peak_bytes; break;
+         case 3: value = stats.total_ct;   break;
+         }
+         stats_export_sample(exp, metrics[mndx].name, value, 1, "subsystem", alloc_subsystem_name(ndx));
+      }
+   }
+}
+
+
+// Exports all statistics, as absolute values or as deltas depending on exp
+static void
+export_all_stats(Stats_Export * exp) {
+   export_execution_stats(exp);
+   export_executor_stats(exp);
+   export_sleep_stats(exp);
+   export_all_thread_sleep_data(exp);
+   dsa_export_all_display_data(exp);
+   try_data_export(exp);
+   export_latency_stats(exp);
+   export_display_health(exp);
+   export_multi_part_write_stats(exp);
+   export_read_coalescing_stats(exp);
+   export_adaptive_verify_stats(exp);
+   i2c_export_bus_check_timeouts(exp);
+   export_api_call_stats(exp);
+   export_lock_stats(exp);
+   export_op_profiles(exp);
+   export_alloc_stats(exp);
+}
+
+
+/** Exports all statistics in a machine readable format.
+ *
+ * \param  format  output format
+ * \return exported statistics, caller must free
+ */
+char * ddc_export_stats_main(DDCA_Stats_Export_Format format) {
+   Stats_Export * exp = stats_export_new(format);
+   export_all_stats(exp);
+   return stats_export_finish(exp);
+}
+
+
+/** Creates a cursor holding the current values of all statistics,
+ *  from which #ddc_export_stats_delta() exports deltas.
+ *
+ * \return newly allocated cursor, free using #stats_cursor_free()
+ */
+Stats_Cursor * ddc_new_stats_cursor() {
+   Stats_Cursor * cursor = stats_cursor_new();
+   Stats_Export * exp = stats_export_new_with_cursor(DDCA_STATS_FORMAT_PROMETHEUS, NULL, cursor);
+   export_all_stats(exp);
+   g_free(stats_export_finish(exp));
+   return cursor;
+}
+
+
+/** Exports all statistics, with counters and latency distributions
+ *  reported as deltas since a cursor.
+ *
+ * \param  cursor   cursor created by #ddc_new_stats_cursor()
+ * \param  format   output format
+ * \param  advance  if true, the cursor is set to the current values
+ * \return exported statistics, caller must free
+ */
+char * ddc_export_stats_delta(Stats_Cursor * cursor, DDCA_Stats_Export_Format format, bool advance) {
+   Stats_Export * exp = stats_export_new_with_cursor(format, cursor, (advance) ? cursor : NULL);
+   export_all_stats(exp);
+   return stats_export_finish(exp);
+}
+
+
 /** Master initialization function for DDC services
  */
 void init_ddc_services() {
@@ -158,32 +307,50 @@ void init_ddc_services() {
    DBGMSF(debug, "Starting");
 
    // i2c:
-   init_i2c_bus_core();
-   init_i2c_sysfs();
+   RECORD_STARTUP_INIT(init_i2c_bus_core);
+   RECORD_STARTUP_INIT(init_i2c_sysfs);
+   RECORD_STARTUP_INIT(init_i2c_simulated_monitor);
+   RECORD_STARTUP_INIT(init_i2c_io_trace);
 
    // usb
 #ifdef USE_USB
-   init_usb_displays();
+   RECORD_STARTUP_INIT(init_usb_displays);
 #endif
 
    // ddc:
-   try_data_init();
-   init_persistent_capabilities();
-   init_parse_capabilities();
-   init_vcp_feature_codes();
-   init_dyn_feature_codes();    // must come after init_vcp_feature_codes()
-   init_dyn_feature_files();
-   init_ddc_display_lock();
-   init_ddc_display_ref_reports();
-   init_ddc_displays();
-   init_ddc_dumpload();
-   init_ddc_output();
-   init_ddc_packet_io();
-   init_ddc_read_capabilities();
-   init_ddc_multi_part_io();
-   init_ddc_vcp();
+   RECORD_STARTUP_INIT(try_data_init);
+   RECORD_STARTUP_INIT(init_persistent_capabilities);
+   RECORD_STARTUP_INIT(init_parse_capabilities);
+   RECORD_STARTUP_INIT(init_vcp_feature_codes);
+   RECORD_STARTUP_INIT(init_dyn_feature_codes);    // must come after init_vcp_feature_codes()
+   RECORD_STARTUP_INIT(init_dyn_feature_files);
+   RECORD_STARTUP_INIT(init_ddc_adaptive_verify);
+   RECORD_STARTUP_INIT(init_ddc_async_requests);
+   RECORD_STARTUP_INIT(init_ddc_completion_queue);
+   RECORD_STARTUP_INIT(init_ddc_deadline);
+   RECORD_STARTUP_INIT(init_ddc_display_lock);
+   RECORD_STARTUP_INIT(init_ddc_display_ref_reports);
+   RECORD_STARTUP_INIT(init_ddc_displays);
+   RECORD_STARTUP_INIT(init_ddc_displays_cache);
+   RECORD_STARTUP_INIT(init_ddc_dumpload);
+   RECORD_STARTUP_INIT(init_ddc_feature_sampler);
+   RECORD_STARTUP_INIT(init_ddc_feature_scan);
+   RECORD_STARTUP_INIT(init_ddc_io_scheduler);
+   RECORD_STARTUP_INIT(init_ddc_output);
+   RECORD_STARTUP_INIT(init_ddc_packet_io);
+   RECORD_STARTUP_INIT(init_ddc_power_state);
+   RECORD_STARTUP_INIT(init_ddc_settle_window);
+   RECORD_STARTUP_INIT(init_ddc_read_capabilities);
+   RECORD_STARTUP_INIT(init_ddc_read_coalescing);
+   RECORD_STARTUP_INIT(init_ddc_remembered_values);
+   RECORD_STARTUP_INIT(init_ddc_multi_part_io);
+   RECORD_STARTUP_INIT(init_ddc_multiplexed_io);
+   RECORD_STARTUP_INIT(init_ddc_vcp);
+   RECORD_STARTUP_INIT(init_ddc_vcp_change_watch);
+   RECORD_STARTUP_INIT(init_ddc_published_state);
+   RECORD_STARTUP_INIT(init_ddc_vcp_value_cache);
 #ifdef BUILD_SHARED_LIB
-   init_ddc_watch_displays();
+   RECORD_STARTUP_INIT(init_ddc_watch_displays);
 #endif
 
    // dbgrpt_rtti_func_name_table(1);
@@ -14,8 +14,13 @@
 
 #include "public/ddcutil_types.h"
 
+#include "base/stats_export.h"
+
 void init_ddc_services();
 void ddc_reset_stats_main();
 void ddc_report_stats_main(DDCA_Stats_Type stats, bool report_per_thread, int depth);
+char * ddc_export_stats_main(DDCA_Stats_Export_Format format);
+Stats_Cursor * ddc_new_stats_cursor();
+char * ddc_export_stats_delta(Stats_Cursor * cursor, DDCA_Stats_Export_Format format, bool advance);
 
 #endif /* DDC_SERVICES_H_ */
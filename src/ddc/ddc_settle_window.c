@@ -0,0 +1,264 @@
+/** @file ddc_settle_window.c
+ *
+ *  Holds DDC transactions with a display while it recovers from a write
+ *  that disrupts its DDC/CI processing, e.g. of feature x60 (Input Source).
+ *
+ *  Many monitors stop responding for a second or more after such a write.
+ *  Retrying during that time only exhausts the retries of the next operation
+ *  and, through the errors recorded, lengthens every later sleep on the
+ *  display, see dynamic_sleep.c.  Instead, after a successful write of one of
+ *  the features listed in #settle_features, ddc_begin_transaction() delays
+ *  further transactions on the display until its settle window has passed.
+ *  Other displays are not affected.
+ *
+ *  The length of the window is learned separately for each monitor model and
+ *  feature, from the first transaction after the window, the probe:
+ *  - if the probe succeeds on its first try, the window was long enough and
+ *    is shortened by #SETTLE_WINDOW_SHRINK_FACTOR
+ *  - if the probe needs retries, the window is lengthened to the time from
+ *    the write to the successful try, times #SETTLE_WINDOW_MARGIN
+ *  - if the probe fails, the window is lengthened to at least twice its
+ *    prior value
+ *
+ *  Status codes of the probe are not recorded for dynamic sleep adjustment.
+ *
+ *  Learned windows are saved in the persistent store, see persistent_store.c,
+ *  if the capabilities cache is enabled.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+
+#include "util/string_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/monitor_model_key.h"
+#include "base/parms.h"
+#include "base/persistent_store.h"
+#include "base/rtti.h"
+
+#include "vcp/persistent_capabilities.h"
+
+#include "ddc/ddc_settle_window.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+/** Features whose writes are followed by a settle window */
+static const Byte settle_features[] = {
+      0x04,    // Restore Factory Defaults
+      0x14,    // Select Color Preset
+      0x60,    // Input Source
+      0xd6,    // Power Mode
+};
+#define SETTLE_FEATURE_CT (sizeof(settle_features)/sizeof(Byte))
+
+/** Learned settle windows of one monitor model */
+typedef struct {
+   int window_millis[SETTLE_FEATURE_CT];
+} Settle_Model_Data;
+
+// monitor model string -> Settle_Model_Data *, protected by settle_mutex
+static GHashTable * settle_model_table = NULL;
+static GMutex       settle_mutex;
+
+
+static int
+settle_feature_index(Byte feature_code) {
+   for (int ndx = 0; ndx < SETTLE_FEATURE_CT; ndx++) {
+      if (settle_features[ndx] == feature_code)
+         return ndx;
+   }
+   return -1;
+}
+
+
+// Returns NULL if the model is not identified
+static const char *
+settle_model_key(Display_Ref * dref) {
+   if (!dref->mmid || !dref->mmid->defined)
+      return NULL;
+   return monitor_model_string(dref->mmid);
+}
+
+
+// Must be called with settle_mutex held
+static Settle_Model_Data *
+get_settle_model_data(const char * model) {
+   bool debug = false;
+   if (!settle_model_table)
+      settle_model_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+   Settle_Model_Data * smd = g_hash_table_lookup(settle_model_table, model);
+   if (!smd) {
+      smd = g_new0(Settle_Model_Data, 1);
+      // value has the form "<feature>=<millis> ...", e.g. "60=1200 d6=2500"
+      char * value = (is_capabilities_cache_enabled())
+                        ? pstore_get(PSTORE_SETTLE_WINDOWS, model) : NULL;
+      if (value) {
+         Null_Terminated_String_Array pieces = strsplit(value, " ");
+         for (int pndx = 0; pieces[pndx]; pndx++) {
+            char * eq = strchr(pieces[pndx], '=');
+            Byte feature_code;
+            int  millis;
+            int  fndx = -1;
+            if (eq) {
+               *eq = '\0';
+               if (hhs_to_byte_in_buf(pieces[pndx], &feature_code) &&
+                   str_to_int(eq+1, &millis, 10) &&
+                   millis >= 0 && millis <= SETTLE_WINDOW_MAX_MILLIS)
+                  fndx = settle_feature_index(feature_code);
+            }
+            if (fndx >= 0)
+               smd->window_millis[fndx] = millis;
+            else
+               DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Invalid settle window: %s", pieces[pndx]);
+         }
+         ntsa_free(pieces, true);
+         free(value);
+      }
+      g_hash_table_insert(settle_model_table, g_strdup(model), smd);
+   }
+   return smd;
+}
+
+
+// Must be called with settle_mutex held
+static void
+save_settle_model_data(const char * model, Settle_Model_Data * smd) {
+   if (!is_capabilities_cache_enabled())
+      return;
+   GString * value = g_string_new(NULL);
+   for (int ndx = 0; ndx < SETTLE_FEATURE_CT; ndx++) {
+      if (smd->window_millis[ndx] > 0)
+         g_string_append_printf(value, "%s%02x=%d",
+               (value->len > 0) ? " " : "", settle_features[ndx], smd->window_millis[ndx]);
+   }
+   if (value->len > 0)
+      pstore_set(PSTORE_SETTLE_WINDOWS, model, value->str);
+   g_string_free(value, true);
+}
+
+
+/** Starts the settle window that follows a successful write of a feature.
+ *  Does nothing if writing the feature does not disrupt DDC.
+ *
+ *  \param  dh            display handle
+ *  \param  feature_code  feature written
+ */
+void
+ddc_begin_settle_window(Display_Handle * dh, Byte feature_code) {
+   bool debug = false;
+   int fndx = settle_feature_index(feature_code);
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   if (fndx < 0 || !async_rec || dh->dref->io_path.io_mode != DDCA_IO_I2C)
+      return;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x", dh_repr(dh), feature_code);
+
+   int millis = 0;
+   const char * model = settle_model_key(dh->dref);
+   if (model) {
+      g_mutex_lock(&settle_mutex);
+      millis = get_settle_model_data(model)->window_millis[fndx];
+      g_mutex_unlock(&settle_mutex);
+   }
+
+   uint64_t now = cur_monotonic_nanosec();
+   g_mutex_lock(&async_rec->transaction_lock);
+   async_rec->settle_write_time = now;
+   async_rec->settle_until      = now + millis * (uint64_t)1000000;
+   async_rec->settle_feature    = feature_code;
+   async_rec->settle_probing    = true;
+   g_mutex_unlock(&async_rec->transaction_lock);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "window=%d millisec", millis);
+}
+
+
+/** Reports whether the current transaction on a display is the probe
+ *  that follows a settle window.
+ *
+ *  \param  dh   display handle
+ *  \return true if status codes are not to be recorded for dynamic sleep adjustment
+ */
+bool
+ddc_is_settle_probe(Display_Handle * dh) {
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   if (!async_rec)
+      return false;
+   g_mutex_lock(&async_rec->transaction_lock);
+   bool result = async_rec->settle_probing;
+   g_mutex_unlock(&async_rec->transaction_lock);
+   return result;
+}
+
+
+/** Adjusts the learned settle window from the outcome of the probe,
+ *  the first transaction after a settle window.  Does nothing if the
+ *  transaction is not a probe.
+ *
+ *  \param  dh               display handle
+ *  \param  psc              status code of the transaction
+ *  \param  tryct            number of tries
+ *  \param  last_try_nanos   CLOCK_MONOTONIC time the last try started
+ */
+void
+ddc_record_settle_probe(Display_Handle * dh, int psc, int tryct, uint64_t last_try_nanos) {
+   bool debug = false;
+   Display_Async_Rec * async_rec = dh->dref->async_rec;
+   if (!async_rec)
+      return;
+
+   g_mutex_lock(&async_rec->transaction_lock);
+   bool probing = async_rec->settle_probing;
+   async_rec->settle_probing = false;
+   uint64_t write_time = async_rec->settle_write_time;
+   int window_millis   = (async_rec->settle_until - write_time) / 1000000;
+   Byte feature_code   = async_rec->settle_feature;
+   g_mutex_unlock(&async_rec->transaction_lock);
+   const char * model = settle_model_key(dh->dref);
+   if (!probing || !model)
+      return;
+
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x, psc=%d, tryct=%d, window=%d",
+                                       dh_repr(dh), feature_code, psc, tryct, window_millis);
+   int new_millis;
+   if (psc == 0 && tryct <= 1) {
+      new_millis = window_millis * SETTLE_WINDOW_SHRINK_FACTOR;
+      if (new_millis < SETTLE_WINDOW_MIN_MILLIS)
+         new_millis = 0;
+   }
+   else {
+      int recovery_millis = (last_try_nanos - write_time) / 1000000;
+      if (psc != 0)
+         recovery_millis = MAX(2*window_millis, (cur_monotonic_nanosec() - write_time) / 1000000);
+      new_millis = MAX(window_millis, recovery_millis * SETTLE_WINDOW_MARGIN);
+      new_millis = CLAMP(new_millis, SETTLE_WINDOW_MIN_MILLIS, SETTLE_WINDOW_MAX_MILLIS);
+   }
+
+   if (new_millis != window_millis) {
+      g_mutex_lock(&settle_mutex);
+      Settle_Model_Data * smd = get_settle_model_data(model);
+      smd->window_millis[settle_feature_index(feature_code)] = new_millis;
+      save_settle_model_data(model, smd);
+      g_mutex_unlock(&settle_mutex);
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "new window=%d millisec", new_millis);
+}
+
+
+void
+init_ddc_settle_window() {
+   RTTI_ADD_FUNC(ddc_begin_settle_window);
+   RTTI_ADD_FUNC(ddc_record_settle_probe);
+}
@@ -0,0 +1,24 @@
+/** @file ddc_settle_window.h
+ *
+ *  Holds DDC transactions with a display after writes that disrupt DDC
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_SETTLE_WINDOW_H_
+#define DDC_SETTLE_WINDOW_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/coredefs.h"
+
+#include "base/displays.h"
+
+void ddc_begin_settle_window(Display_Handle * dh, Byte feature_code);
+bool ddc_is_settle_probe(Display_Handle * dh);
+void ddc_record_settle_probe(Display_Handle * dh, int psc, int tryct, uint64_t last_try_nanos);
+void init_ddc_settle_window();
+
+#endif /* DDC_SETTLE_WINDOW_H_ */
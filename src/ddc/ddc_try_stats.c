@@ -1,6 +1,11 @@
 /** @file ddc_try_stats.c
  *
  *  Maintains statistics on DDC retries, along with maxtries settings.
+ *
+ *  The try counters are kept in a separate shard for each thread and
+ *  updated atomically without locking, so that threads performing DDC I/O
+ *  concurrently do not serialize on **try_data_mutex**.  The shards are
+ *  summed when the statistics are reported.
  */
 
 // Copyright (C) 2014-2022 Sanford Rockowitz <rockowitz@minsoft.com>
@@ -20,6 +25,8 @@
 
 #include "base/core.h"
 #include "base/ddc_errno.h"
+#include "base/displays.h"
+#include "base/lock_stats.h"
 #include "base/parms.h"
 #include "base/per_thread_data.h"    // for retry_type_name()
 #include "base/thread_retry_data.h"
@@ -32,6 +39,7 @@
 //
 
 static GMutex try_data_mutex;
+static Lock_Stats try_data_lock_stats = {.lock_name = "try_data_mutex"};
 static GPrivate this_thread_has_lock;
 static bool debug_mutex = false;
 
@@ -53,7 +61,7 @@ bool lock_if_unlocked() {
    bool thread_has_lock = GPOINTER_TO_INT(g_private_get(&this_thread_has_lock));
    DBGMSF(debug, "Already locked: %s", sbool(thread_has_lock));
    if (!thread_has_lock) {
-      g_mutex_lock(&try_data_mutex);
+      lock_stats_mutex_lock(&try_data_mutex, &try_data_lock_stats);
       lock_performed = true;
       // should this be a depth counter rather than a boolean?
       g_private_set(&this_thread_has_lock, GINT_TO_POINTER(true));
@@ -126,11 +134,23 @@ typedef
 struct {
    Retry_Operation retry_type;
    Retry_Op_Value    maxtries;
-   Retry_Op_Value    counters[MAX_MAX_TRIES+2];
    Retry_Op_Value    highest_maxtries;
    Retry_Op_Value    lowest_maxtries;
 } Try_Data2;
 
+// Try counters recorded by a single thread, updated only by that thread
+#define TRY_COUNTERS_SHARD_MARKER "TRYS"
+typedef
+struct {
+   char              marker[4];
+   int               counters[RETRY_OP_COUNT][MAX_MAX_TRIES+2];
+} Try_Counters_Shard;
+
+// Shards are retained after their thread terminates
+static GPtrArray * try_counters_shards;
+static GMutex      try_counters_shards_mutex;
+static GPrivate    try_counters_shard_key = G_PRIVATE_INIT(NULL);
+
 
 static Retry_Op_Value default_maxtries[] = {
       INITIAL_MAX_WRITE_ONLY_EXCHANGE_TRIES,
@@ -142,6 +162,45 @@ static Retry_Op_Value default_maxtries[] = {
 static Try_Data2 try_data[RETRY_OP_COUNT];
 
 
+static Try_Counters_Shard *
+get_thread_try_counters_shard() {
+   Try_Counters_Shard * shard = g_private_get(&try_counters_shard_key);
+   if (!shard) {
+      shard = g_new0(Try_Counters_Shard, 1);
+      memcpy(shard->marker, TRY_COUNTERS_SHARD_MARKER, 4);
+      g_mutex_lock(&try_counters_shards_mutex);
+      if (!try_counters_shards)
+         try_counters_shards = g_ptr_array_new();
+      g_ptr_array_add(try_counters_shards, shard);
+      g_mutex_unlock(&try_counters_shards_mutex);
+      g_private_set(&try_counters_shard_key, shard);
+   }
+   return shard;
+}
+
+
+/** Sums the try counters of all threads for a #Retry_Operation.
+ *
+ *  @param  retry_type
+ *  @param  counters    array of MAX_MAX_TRIES+2 values to fill in,
+ *                      same usage as in #Try_Counters_Shard
+ */
+static void
+get_try_counters(Retry_Operation retry_type, int * counters) {
+   memset(counters, 0, (MAX_MAX_TRIES+2) * sizeof(int));
+   g_mutex_lock(&try_counters_shards_mutex);
+   if (try_counters_shards) {
+      for (int ndx = 0; ndx < try_counters_shards->len; ndx++) {
+         Try_Counters_Shard * shard = g_ptr_array_index(try_counters_shards, ndx);
+         assert(memcmp(shard->marker, TRY_COUNTERS_SHARD_MARKER, 4) == 0);
+         for (int cndx = 0; cndx <= MAX_MAX_TRIES+1; cndx++)
+            counters[cndx] += __atomic_load_n(&shard->counters[retry_type][cndx], __ATOMIC_RELAXED);
+      }
+   }
+   g_mutex_unlock(&try_counters_shards_mutex);
+}
+
+
 /* Initializes a Try_Data data structure
  *
  * @param  retry_type  Retry_Operation type
@@ -236,8 +295,15 @@ void try_data_reset2(Retry_Operation retry_type) {
    try_data[retry_type].highest_maxtries = current_maxtries;
    try_data[retry_type].lowest_maxtries =  current_maxtries;
 
-   for (int ndx=0; ndx < MAX_MAX_TRIES+1; ndx++)
-      try_data[retry_type].counters[ndx] = 0;
+   g_mutex_lock(&try_counters_shards_mutex);
+   if (try_counters_shards) {
+      for (int ndx = 0; ndx < try_counters_shards->len; ndx++) {
+         Try_Counters_Shard * shard = g_ptr_array_index(try_counters_shards, ndx);
+         for (int cndx = 0; cndx <= MAX_MAX_TRIES+1; cndx++)
+            __atomic_store_n(&shard->counters[retry_type][cndx], 0, __ATOMIC_RELAXED);
+      }
+   }
+   g_mutex_unlock(&try_counters_shards_mutex);
 
    unlock_if_needed(this_function_performed_lock);
 
@@ -320,25 +386,239 @@ void try_data_record_tries2(Retry_Operation retry_type, DDCA_Status ddcrc, int t
 
    trd_record_cur_thread_tries(retry_type, ddcrc, tryct);
 
-   Try_Data2 * stats_rec = &try_data[retry_type];
-   bool locked_by_this_func = lock_if_unlocked();
+   int index;
    if (ddcrc == 0) {
-      DBGMSF(debug, "Current stats_rec->maxtries=%d", stats_rec->maxtries);
-      assert(0 < tryct && tryct <= stats_rec->maxtries);
-
-      stats_rec->counters[tryct+1] += 1;
+      // with adaptive maxtries the per-display ceiling can exceed the global maxtries
+      assert(0 < tryct && tryct <= MAX_MAX_TRIES);
+      index = tryct+1;
    }
    // fragile, but eliminates testing for max_tries:
    else if (ddcrc == DDCRC_RETRIES || ddcrc == DDCRC_ALL_TRIES_ZERO) {
       // failed for max tries exceeded
-      stats_rec->counters[1] += 1;
+      index = 1;
    }
    else {
       // failed fatally
-      stats_rec->counters[0] += 1;
+      index = 0;
+   }
+
+   Try_Counters_Shard * shard = get_thread_try_counters_shard();
+   __atomic_fetch_add(&shard->counters[retry_type][index], 1, __ATOMIC_RELAXED);
+}
+
+
+//
+// Adaptive maxtries
+//
+// The maxtries values above are global and fixed.  When adaptive maxtries is
+// enabled, the distribution of tries required for success is additionally
+// maintained for each display and operation type.  Once enough successes have
+// been observed, the try ceiling for that display is derived from the
+// distribution: it is lowered for monitors that reliably succeed on the first
+// try or two (so that a dead display fails quickly), and raised for monitors
+// that frequently need the full configured number of tries.
+//
+
+#define ADAPTIVE_MIN_SUCCESS_CT      10   // minimum sample before adapting
+#define ADAPTIVE_SUCCESS_PCT         99   // percent of successes to be covered
+#define ADAPTIVE_AT_CEILING_PCT       5   // percent of successes at the ceiling that triggers raising it
+#define ADAPTIVE_RAISE_INCREMENT      2
+
+#define DISPLAY_TRY_DATA_MARKER "DTRY"
+typedef struct {
+   char           marker[4];
+   DDCA_IO_Path   io_path;
+   Retry_Op_Value counters[RETRY_OP_COUNT][MAX_MAX_TRIES+2];  // same usage as Try_Counters_Shard.counters
+} Display_Try_Data;
+
+static bool        adaptive_maxtries_enabled = false;
+static GPtrArray * display_try_data_recs = NULL;     // protected by try_data_mutex
+
+
+/** Enables or disables adaptive maxtries.
+ *
+ *  \param  onoff  new setting
+ *  \return prior setting
+ */
+bool try_data_enable_adaptive_maxtries(bool onoff) {
+   bool old = adaptive_maxtries_enabled;
+   adaptive_maxtries_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether adaptive maxtries is enabled. */
+bool try_data_is_adaptive_maxtries_enabled() {
+   return adaptive_maxtries_enabled;
+}
+
+
+// Must be called with try_data_mutex held
+static Display_Try_Data * get_display_try_data(DDCA_IO_Path io_path) {
+   if (!display_try_data_recs)
+      display_try_data_recs = g_ptr_array_new_with_free_func(g_free);
+
+   for (int ndx = 0; ndx < display_try_data_recs->len; ndx++) {
+      Display_Try_Data * cur = g_ptr_array_index(display_try_data_recs, ndx);
+      assert(memcmp(cur->marker, DISPLAY_TRY_DATA_MARKER, 4) == 0);
+      if (dpath_eq(cur->io_path, io_path))
+         return cur;
+   }
+
+   Display_Try_Data * rec = g_new0(Display_Try_Data, 1);
+   memcpy(rec->marker, DISPLAY_TRY_DATA_MARKER, 4);
+   rec->io_path = io_path;
+   g_ptr_array_add(display_try_data_recs, rec);
+   return rec;
+}
+
+
+// Must be called with try_data_mutex held
+static Retry_Op_Value
+calc_adaptive_maxtries(Retry_Op_Value * counters, Retry_Op_Value configured_maxtries) {
+   int success_ct = 0;
+   for (int ndx = 2; ndx <= MAX_MAX_TRIES+1; ndx++)
+      success_ct += counters[ndx];
+   if (success_ct < ADAPTIVE_MIN_SUCCESS_CT)
+      return configured_maxtries;
+
+   int at_ceiling_ct = 0;
+   for (int ndx = configured_maxtries+1; ndx <= MAX_MAX_TRIES+1; ndx++)
+      at_ceiling_ct += counters[ndx];
+
+   int result;
+   if (at_ceiling_ct * 100 >= success_ct * ADAPTIVE_AT_CEILING_PCT) {
+      result = configured_maxtries + ADAPTIVE_RAISE_INCREMENT;
    }
+   else {
+      // smallest try count that covers the desired percentage of successes,
+      // plus one try of headroom
+      int covered_ct = 0;
+      int tryct = 1;
+      for (; tryct <= MAX_MAX_TRIES; tryct++) {
+         covered_ct += counters[tryct+1];
+         if (covered_ct * 100 >= success_ct * ADAPTIVE_SUCCESS_PCT)
+            break;
+      }
+      result = tryct + 1;
+      // requires a failure due to retries to raise the value above configured setting
+      if (result > configured_maxtries && counters[1] == 0)
+         result = configured_maxtries;
+   }
+
+   if (result < 1)
+      result = 1;
+   if (result > MAX_MAX_TRIES)
+      result = MAX_MAX_TRIES;
+   return result;
+}
+
+
+/** Gets the maximum number of tries for an operation on a specific display.
+ *
+ *  The configured value is the display's own setting if one has been set,
+ *  otherwise the global value.  If adaptive maxtries is not enabled, or too
+ *  few operations have been observed for the display, the configured value
+ *  is returned.
+ *
+ *  \param  dh          display handle
+ *  \param  retry_type  operation type
+ *  \return maxtries value
+ */
+Retry_Op_Value try_data_get_display_maxtries2(Display_Handle * dh, Retry_Operation retry_type) {
+   bool debug = false;
+   Retry_Op_Value configured = (dh && dh->dref->io_settings.max_tries[retry_type] > 0)
+                                  ? dh->dref->io_settings.max_tries[retry_type]
+                                  : try_data_get_maxtries2(retry_type);
+   if (!adaptive_maxtries_enabled || !dh)
+      return configured;
+
+   bool this_function_performed_lock = lock_if_unlocked();
+   Display_Try_Data * rec = get_display_try_data(dh->dref->io_path);
+   Retry_Op_Value result = calc_adaptive_maxtries(rec->counters[retry_type], configured);
+   unlock_if_needed(this_function_performed_lock);
+
+   DBGMSF(debug, "dh=%s, retry type=%s, configured=%d, returning %d",
+                 dh_repr(dh), retry_type_name(retry_type), configured, result);
+   return result;
+}
+
+
+/** Records the status and retry count for a retryable transaction on a
+ *  specific display.
+ *
+ *  The global and per-thread statistics are updated by #try_data_record_tries2().
+ *  If adaptive maxtries is enabled, the display's distribution is also updated.
+ *
+ *  @param  dh         display handle
+ *  @param  retry_type operation type
+ *  @param  ddcrc      status code
+ *  @param  tryct      number of tries required for success, when rc == 0
+ */
+void try_data_record_display_tries2(Display_Handle * dh, Retry_Operation retry_type, DDCA_Status ddcrc, int tryct) {
+   try_data_record_tries2(retry_type, ddcrc, tryct);
+   if (!adaptive_maxtries_enabled || !dh)
+      return;
+
+   bool this_function_performed_lock = lock_if_unlocked();
+   Display_Try_Data * rec = get_display_try_data(dh->dref->io_path);
+   int index;
+   if (ddcrc == 0)
+      index = tryct+1;
+   else if (ddcrc == DDCRC_RETRIES || ddcrc == DDCRC_ALL_TRIES_ZERO)
+      index = 1;
+   else
+      index = 0;
+   assert(index <= MAX_MAX_TRIES+1);
+   rec->counters[retry_type][index] += 1;
+   unlock_if_needed(this_function_performed_lock);
+}
+
+
+/** Reports the per-display try distributions and the resulting maxtries
+ *  values, if adaptive maxtries is enabled.
+ *
+ *  \param depth logical indentation depth
+ */
+void try_data_report_display_tries(int depth) {
+   if (!adaptive_maxtries_enabled)
+      return;
+   int d1 = depth+1;
+   int d2 = depth+2;
+   rpt_nl();
+   rpt_vstring(depth, "Adaptive maxtries by display:");
 
-   unlock_if_needed(locked_by_this_func);
+   bool this_function_performed_lock = lock_if_unlocked();
+   if (!display_try_data_recs || display_try_data_recs->len == 0)
+      rpt_vstring(d1, "No displays");
+   else {
+      for (int ndx = 0; ndx < display_try_data_recs->len; ndx++) {
+         Display_Try_Data * rec = g_ptr_array_index(display_try_data_recs, ndx);
+         rpt_vstring(d1, "%s:", dpath_repr_t(&rec->io_path));
+         for (int retry_type = 0; retry_type < RETRY_OP_COUNT; retry_type++) {
+            Retry_Op_Value * counters = rec->counters[retry_type];
+            int total = 0;
+            for (int cndx = 0; cndx <= MAX_MAX_TRIES+1; cndx++)
+               total += counters[cndx];
+            if (total == 0)
+               continue;
+            rpt_vstring(d2, "%-28s configured maxtries: %2d, adaptive maxtries: %2d",
+                            retry_type_description(retry_type),
+                            try_data[retry_type].maxtries,
+                            calc_adaptive_maxtries(counters, try_data[retry_type].maxtries));
+            char buf[200];
+            int pos = 0;
+            for (int cndx = 2; cndx <= MAX_MAX_TRIES+1; cndx++) {
+               if (counters[cndx] > 0)
+                  pos += snprintf(buf+pos, sizeof(buf)-pos, " %d:%d", cndx-1, counters[cndx]);
+            }
+            buf[pos] = '\0';
+            rpt_vstring(d2+1, "Successes by tries:%s", (pos > 0) ? buf : " None");
+            rpt_vstring(d2+1, "Max tries exceeded: %d, fatal: %d", counters[1], counters[0]);
+         }
+      }
+   }
+   unlock_if_needed(this_function_performed_lock);
 }
 
 //
@@ -346,11 +626,11 @@ void try_data_record_tries2(Retry_Operation retry_type, DDCA_Status ddcrc, int t
 //
 
 // used to test whether there's anything to report
-static int try_data_get_total_attempts2(Retry_Operation retry_type) {
+static int try_data_get_total_attempts2(int * counters) {
    int total_attempts = 0;
    int ndx;
    for (ndx=0; ndx <= MAX_MAX_TRIES+1; ndx++) {
-      total_attempts += try_data[retry_type].counters[ndx];
+      total_attempts += counters[ndx];
    }
    return total_attempts;
 }
@@ -375,7 +655,9 @@ void try_data_report2(Retry_Operation retry_type, int depth) {
 
    // doesn't distinguish write vs read
    // rpt_vstring(depth, "Retry statistics for ddc %s exchange", ddc_retry_type_description(stats_rec->retry_type));
-   int total_attempts = try_data_get_total_attempts2(retry_type);
+   int counters[MAX_MAX_TRIES+2];
+   get_try_counters(retry_type, counters);
+   int total_attempts = try_data_get_total_attempts2(counters);
 
    if (total_attempts == 0) {
       rpt_vstring(d1, "No tries attempted");
@@ -409,7 +691,7 @@ void try_data_report2(Retry_Operation retry_type, int depth) {
 
       int upper_bound = MAX_MAX_TRIES+1;
       while (upper_bound > 1) {
-         if (stats_rec->counters[upper_bound] != 0)
+         if (counters[upper_bound] != 0)
             break;
          upper_bound--;
       }
@@ -419,17 +701,17 @@ void try_data_report2(Retry_Operation retry_type, int depth) {
       rpt_vstring(d1, "Successful attempts by number of tries required:%s", s);
       if (upper_bound > 1) {
          for (int ndx=2; ndx <= upper_bound; ndx++) {
-            total_successful_attempts += stats_rec->counters[ndx];
+            total_successful_attempts += counters[ndx];
             // DBGMSG("ndx=%d", ndx);
-            rpt_vstring(d1, "   %2d:  %3d", ndx-1, stats_rec->counters[ndx]);
+            rpt_vstring(d1, "   %2d:  %3d", ndx-1, counters[ndx]);
          }
       }
       assert( ( (upper_bound == 1) && (total_successful_attempts == 0) ) ||
               ( (upper_bound > 1 ) && (total_successful_attempts >  0) )
             );
       rpt_vstring(d1, "Total successful attempts:        %3d", total_successful_attempts);
-      rpt_vstring(d1, "Failed due to max tries exceeded: %3d", stats_rec->counters[1]);
-      rpt_vstring(d1, "Failed due to fatal error:        %3d", stats_rec->counters[0]);
+      rpt_vstring(d1, "Failed due to max tries exceeded: %3d", counters[1]);
+      rpt_vstring(d1, "Failed due to fatal error:        %3d", counters[0]);
       rpt_vstring(d1, "Total attempts:                   %3d", total_attempts);
    }
 
@@ -457,6 +739,87 @@ void ddc_report_multi_part_write_stats(int depth) {
 }
 #endif
 
+//
+// Export
+//
+
+static const char * try_outcome_labels[] = {"fatal", "retries_exceeded", "success"};
+
+static void
+export_try_counters(Stats_Export * exp, const char * name, Retry_Operation retry_type,
+                    const char * display, int * counters)
+{
+   for (int ndx = 0; ndx <= MAX_MAX_TRIES+1; ndx++) {
+      if (counters[ndx] == 0)
+         continue;
+      char tries_buf[10] = "";
+      if (ndx > 1)
+         g_snprintf(tries_buf, sizeof(tries_buf), "%d", ndx-1);
+      const char * outcome = try_outcome_labels[(ndx > 1) ? 2 : ndx];
+      if (display)
+         stats_export_sample(exp, name, counters[ndx], 4,
+                             "display",   display,
+                             "operation", retry_type_name(retry_type),
+                             "outcome",   outcome,
+                             "tries",     tries_buf);
+      else
+         stats_export_sample(exp, name, counters[ndx], 3,
+                             "operation", retry_type_name(retry_type),
+                             "outcome",   outcome,
+                             "tries",     tries_buf);
+   }
+}
+
+
+/** Exports the try statistics and maxtries settings, and if adaptive maxtries
+ *  is enabled the per-display try distributions.
+ *
+ *  \param exp  export instance
+ */
+void try_data_export(Stats_Export * exp) {
+   stats_export_metric(exp, "ddcutil_maxtries", STATS_METRIC_GAUGE,
+                            "Configured maximum number of tries");
+   for (int retry_type = 0; retry_type < RETRY_OP_COUNT; retry_type++)
+      stats_export_sample(exp, "ddcutil_maxtries", try_data_get_maxtries2(retry_type), 1,
+                               "operation", retry_type_name(retry_type));
+
+   stats_export_metric(exp, "ddcutil_tries_total", STATS_METRIC_COUNTER,
+                            "Retryable operations by outcome and, for successes, number of tries");
+   for (int retry_type = 0; retry_type < RETRY_OP_COUNT; retry_type++) {
+      int counters[MAX_MAX_TRIES+2];
+      get_try_counters(retry_type, counters);
+      export_try_counters(exp, "ddcutil_tries_total", retry_type, NULL, counters);
+   }
+
+   if (!adaptive_maxtries_enabled)
+      return;
+   stats_export_metric(exp, "ddcutil_display_tries_total", STATS_METRIC_COUNTER,
+                            "Retryable operations by display, outcome and, for successes, number of tries");
+   bool this_function_performed_lock = lock_if_unlocked();
+   for (int ndx = 0; display_try_data_recs && ndx < display_try_data_recs->len; ndx++) {
+      Display_Try_Data * rec = g_ptr_array_index(display_try_data_recs, ndx);
+      for (int retry_type = 0; retry_type < RETRY_OP_COUNT; retry_type++) {
+         int counters[MAX_MAX_TRIES+2];
+         for (int cndx = 0; cndx <= MAX_MAX_TRIES+1; cndx++)
+            counters[cndx] = rec->counters[retry_type][cndx];
+         export_try_counters(exp, "ddcutil_display_tries_total", retry_type,
+                             dpath_repr_t(&rec->io_path), counters);
+      }
+   }
+   stats_export_metric(exp, "ddcutil_display_adaptive_maxtries", STATS_METRIC_GAUGE,
+                            "Maximum number of tries determined by adaptive maxtries");
+   for (int ndx = 0; display_try_data_recs && ndx < display_try_data_recs->len; ndx++) {
+      Display_Try_Data * rec = g_ptr_array_index(display_try_data_recs, ndx);
+      for (int retry_type = 0; retry_type < RETRY_OP_COUNT; retry_type++)
+         stats_export_sample(exp, "ddcutil_display_adaptive_maxtries",
+                             calc_adaptive_maxtries(rec->counters[retry_type], try_data[retry_type].maxtries), 2,
+                             "display",   dpath_repr_t(&rec->io_path),
+                             "operation", retry_type_name(retry_type));
+   }
+   unlock_if_needed(this_function_performed_lock);
+}
+
+
 /** Reports the current maxtries settings.
  *
  *  \param depth logical indentation depth
@@ -491,5 +854,6 @@ void ddc_report_ddc_stats(int depth) {
    try_data_report2(WRITE_READ_TRIES_OP, depth);   //   ddc_report_write_read_stats(depth);
    try_data_report2(MULTI_PART_READ_OP,  depth);   //   ddc_report_multi_part_read_stats(depth);
    try_data_report2(MULTI_PART_WRITE_OP, depth);   //   ddc_report_multi_part_write_stats(depth);
+   try_data_report_display_tries(depth);
 }
 
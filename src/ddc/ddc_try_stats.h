@@ -16,8 +16,10 @@
 #include "ddcutil_types.h"
 
 #include "base/core.h"
+#include "base/displays.h"
 #include "base/parms.h"
 #include "base/per_thread_data.h"
+#include "base/stats_export.h"
 
 void     try_data_init_retry_type(Retry_Operation retry_type, Retry_Op_Value maxtries);
 void     try_data_init();
@@ -29,7 +31,15 @@ void     try_data_set_maxtries2(Retry_Operation retry_type, Retry_Op_Value new_m
 void     try_data_reset2_all();
 void     try_data_record_tries2(Retry_Operation retry_type, DDCA_Status rc, int tryct);
 
+bool     try_data_enable_adaptive_maxtries(bool onoff);
+bool     try_data_is_adaptive_maxtries_enabled();
+Retry_Op_Value
+         try_data_get_display_maxtries2(Display_Handle * dh, Retry_Operation retry_type);
+void     try_data_record_display_tries2(Display_Handle * dh, Retry_Operation retry_type, DDCA_Status rc, int tryct);
+void     try_data_report_display_tries(int depth);
+
 void     ddc_report_max_tries(int depth);
 void     ddc_report_ddc_stats(int depth);
+void     try_data_export(Stats_Export * exp);
 
 #endif /* TRY_STATS_H_ */
@@ -20,14 +20,19 @@
 #include "util/error_info.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/timestamp.h"
 #include "util/utilrpt.h"
 /** \endcond */
 
 #include "base/ddc_errno.h"
 #include "base/ddc_packets.h"
 #include "base/displays.h"
+#include "base/latency_stats.h"
+#include "base/monitor_quirks.h"
+#include "base/op_profile.h"
 #include "base/rtti.h"
 #include "base/status_code_mgt.h"
+#include "base/tuned_sleep.h"
 
 #include "i2c/i2c_bus_core.h"
 
@@ -36,12 +41,20 @@
 #include "usb/usb_vcp.h"
 #endif
 
+#include "vcp/persistent_capabilities.h"
 #include "vcp/vcp_feature_codes.h"
 
 #include <dynvcp/dyn_feature_codes.h>
 
+#include "ddc/ddc_adaptive_verify.h"
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_power_state.h"
+#include "ddc/ddc_published_state.h"
+#include "ddc/ddc_read_coalescing.h"
+#include "ddc/ddc_remembered_values.h"
+#include "ddc/ddc_settle_window.h"
+#include "ddc/ddc_vcp_value_cache.h"
 #include "ddc/ddc_vcp_version.h"
 
 #include "ddc/ddc_vcp.h"
@@ -135,6 +148,7 @@ ddc_set_nontable_vcp_value(
    DBGTRC_STARTING(debug, TRACE_GROUP,
           "Writing feature 0x%02x , new value = %d, dh=%s",
           feature_code, new_value, dh_repr(dh) );
+   OP_PROFILE(OPT_SETVCP, dh->dref);
    Public_Status_Code psc = 0;
    Error_Info * ddc_excp = NULL;
 
@@ -158,6 +172,17 @@ ddc_set_nontable_vcp_value(
          free_ddc_packet(request_packet_ptr);
    }
 
+   ddc_end_coalesced_reads(dh->dref, feature_code);
+   if (psc == 0) {
+      ddc_cache_written_vcp_value(dh->dref, feature_code, new_value);
+      ddc_remember_written_vcp_value(dh->dref, feature_code, new_value);
+      ddc_publish_written_vcp_value(dh->dref, feature_code, new_value);
+      if (feature_code == 0xd6)
+         ddc_record_power_mode(dh->dref, new_value & 0xff);
+      ddc_begin_settle_window(dh, feature_code);
+   }
+   else
+      ddc_invalidate_cached_vcp_value(dh->dref, feature_code);
    if ( psc==DDCRC_RETRIES )
       DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Try errors: %s", errinfo_causes_string(ddc_excp));  // needed?
    DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
@@ -198,16 +223,16 @@ set_table_vcp_value(
       ddc_excp = ERRINFO_NEW(psc);
    }
    else {
-      // TODO: clean up function signatures
-      // pointless wrapping in a Buffer just to unwrap
-      Buffer * new_value = buffer_new_with_value(bytes, bytect, __func__);
-
-      ddc_excp = multi_part_write_with_retry(dh, feature_code, new_value);
+      ddc_excp = multi_part_write_bytes_with_retry(dh, feature_code, bytes, bytect);
       psc = (ddc_excp) ? ddc_excp->status_code : 0;
-
-      buffer_free(new_value, __func__);
    }
 
+   ddc_end_coalesced_reads(dh->dref, feature_code);
+   if (psc == 0)
+      ddc_memo_table_vcp_value(dh->dref, feature_code, bytes, bytect);
+   else
+      ddc_invalidate_cached_vcp_value(dh->dref, feature_code);
+
    if ( psc == DDCRC_RETRIES )
       DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Try errors: %s", errinfo_causes_string(ddc_excp));
    DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
@@ -270,16 +295,14 @@ is_rereadable_feature(
    }
 
    if (result) {
-      Display_Feature_Metadata * dfm = dyn_get_feature_metadata_by_dh(
+      Display_Feature_Metadata * dfm = dyn_get_cached_feature_metadata_by_dh(
             opcode,
             dh,
             false    //                  with_default
             );
       // if not found, assume readable  ??
-      if (dfm) {
+      if (dfm)
          result = dfm->feature_flags & DDCA_READABLE;
-         dfm_free(dfm);
-      }
    }
 
    DBGMSF(debug, "Returning: %s", sbool(result));
@@ -338,6 +361,96 @@ single_vcp_value_equal(
 }
 
 
+/** Reads a feature value after it has been written, and checks that the
+ *  display actually changed the value.
+ *
+ *  \param  dh            display handle for open display
+ *  \param  vrec          value that was written
+ *  \param  newval_loc    if non-null, address at which to return value read
+ *  \return NULL if success or feature not verifiable, #Error_Info if failure
+ *
+ *  The caller is responsible for freeing the value returned at **newval_loc**.
+ *
+ *  If **newval_loc** is NULL, the verification may be skipped for a feature
+ *  whose recent writes all verified, see ddc_adaptive_verify.c.
+ */
+Error_Info *
+ddc_verify_vcp_value(
+      Display_Handle *      dh,
+      DDCA_Any_Vcp_Value *  vrec,
+      DDCA_Any_Vcp_Value ** newval_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, opcode=0x%02x", dh_repr(dh), vrec->opcode);
+   FILE * verbose_msg_dest = fout();
+   if ( get_output_level() < DDCA_OL_VERBOSE && !debug )
+      verbose_msg_dest = NULL;
+
+   Public_Status_Code psc = 0;
+   Error_Info * ddc_excp = NULL;
+   if (newval_loc)
+      *newval_loc = NULL;
+   if ( is_rereadable_feature(dh, vrec->opcode) &&
+        ( vrec->value_type != DDCA_NON_TABLE_VCP_VALUE ||
+          !is_unreadable_sl_value(vrec->opcode, vrec->val.c_nc.sl)
+        )
+      )
+   {
+      if (!newval_loc && ddc_skip_verification(dh->dref, vrec->opcode)) {
+         f0printf(verbose_msg_dest, "Recent writes of feature 0x%02x verified, skipping verification\n",
+                                    vrec->opcode);
+         DBGTRC_DONE(debug, TRACE_GROUP, "Verification skipped");
+         return NULL;
+      }
+      f0printf(verbose_msg_dest, "Verifying that value of feature 0x%02x successfully set...\n", vrec->opcode);
+      DDCA_Any_Vcp_Value * newval = NULL;
+      ddc_excp = ddc_get_vcp_value(
+          dh,
+          vrec->opcode,
+          vrec->value_type,
+          &newval);
+      psc = (ddc_excp) ? ddc_excp->status_code : 0;
+      if (ddc_excp) {
+         f0printf(verbose_msg_dest, "(%s) Read after write failed. get_vcp_value() returned: %s\n",
+                        __func__, psc_desc(psc));
+         if (psc == DDCRC_RETRIES)
+            f0printf(verbose_msg_dest, "(%s)    Try errors: %s\n", __func__, errinfo_causes_string(ddc_excp));
+         // psc = DDCRC_VERIFY;
+      }
+      else {
+         assert(vrec && newval);    // silence clang complaint
+         // dbgrpt_ddca_single_vcp_value(vrec, 2);
+         // dbgrpt_ddca_single_vcp_value(newval, 3);
+
+         if (! single_vcp_value_equal(vrec,newval)) {
+            psc = DDCRC_VERIFY;
+            ddc_excp = errinfo_new(DDCRC_VERIFY, __func__);
+            f0printf(verbose_msg_dest, "Current value does not match value set.\n");
+         }
+         else {
+            f0printf(verbose_msg_dest, "Verification succeeded\n");
+         }
+         if (newval_loc)
+            *newval_loc = newval;
+         else
+            free_single_vcp_value(newval);
+      }
+      ddc_record_verification(dh->dref, vrec->opcode, psc);
+   }
+   else {
+      if (!is_rereadable_feature(dh, vrec->opcode) )
+         f0printf(verbose_msg_dest, "Feature 0x%02x does not support verification\n", vrec->opcode);
+      else
+         f0printf(verbose_msg_dest, "Feature 0x%02x, value 0x%02x does not support verification\n",
+                                    vrec->opcode,
+                                    vrec->val.c_nc.sl);
+   }
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
+   return ddc_excp;
+}
+
+
 // TODO: Consider wrapping set_vcp_value() in set_vcp_value_with_retry(), which would
 // retry in case verification fails
 
@@ -364,74 +477,23 @@ ddc_set_vcp_value(
 {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
-   FILE * verbose_msg_dest = fout();
-   if ( get_output_level() < DDCA_OL_VERBOSE && !debug )
-      verbose_msg_dest = NULL;
+   OP_PROFILE(OPT_SETVCP, dh->dref);
 
-   Public_Status_Code psc = 0;
    Error_Info * ddc_excp = NULL;
    if (newval_loc)
       *newval_loc = NULL;
+   uint64_t start_nanos = cur_monotonic_nanosec();
    if (vrec->value_type == DDCA_NON_TABLE_VCP_VALUE) {
       ddc_excp = ddc_set_nontable_vcp_value(dh, vrec->opcode, VALREC_CUR_VAL(vrec));
-      psc = (ddc_excp) ? ddc_excp->status_code : 0;
    }
    else {
       assert(vrec->value_type == DDCA_TABLE_VCP_VALUE);
       ddc_excp = set_table_vcp_value(dh, vrec->opcode, vrec->val.t.bytes, vrec->val.t.bytect);
-      psc = (ddc_excp) ? ddc_excp->status_code : 0;
    }
 
-   if (!ddc_excp && ddc_get_verify_setvcp()) {
-      if ( is_rereadable_feature(dh, vrec->opcode) &&
-           ( vrec->value_type != DDCA_NON_TABLE_VCP_VALUE ||
-             !is_unreadable_sl_value(vrec->opcode, vrec->val.c_nc.sl)
-           )
-         )
-      {
-         f0printf(verbose_msg_dest, "Verifying that value of feature 0x%02x successfully set...\n", vrec->opcode);
-         DDCA_Any_Vcp_Value * newval = NULL;
-         ddc_excp = ddc_get_vcp_value(
-             dh,
-             vrec->opcode,
-             vrec->value_type,
-             &newval);
-         psc = (ddc_excp) ? ddc_excp->status_code : 0;
-         if (ddc_excp) {
-            f0printf(verbose_msg_dest, "(%s) Read after write failed. get_vcp_value() returned: %s\n",
-                           __func__, psc_desc(psc));
-            if (psc == DDCRC_RETRIES)
-               f0printf(verbose_msg_dest, "(%s)    Try errors: %s\n", __func__, errinfo_causes_string(ddc_excp));
-            // psc = DDCRC_VERIFY;
-         }
-         else {
-            assert(vrec && newval);    // silence clang complaint
-            // dbgrpt_ddca_single_vcp_value(vrec, 2);
-            // dbgrpt_ddca_single_vcp_value(newval, 3);
-
-            if (! single_vcp_value_equal(vrec,newval)) {
-               psc = DDCRC_VERIFY;
-               ddc_excp = errinfo_new(DDCRC_VERIFY, __func__);
-               f0printf(verbose_msg_dest, "Current value does not match value set.\n");
-            }
-            else {
-               f0printf(verbose_msg_dest, "Verification succeeded\n");
-            }
-            if (newval_loc)
-               *newval_loc = newval;
-            else
-               free_single_vcp_value(newval);
-         }
-      }
-      else {
-         if (!is_rereadable_feature(dh, vrec->opcode) )
-            f0printf(verbose_msg_dest, "Feature 0x%02x does not support verification\n", vrec->opcode);
-         else
-            f0printf(verbose_msg_dest, "Feature 0x%02x, value 0x%02x does not support verification\n",
-                                       vrec->opcode,
-                                       vrec->val.c_nc.sl);
-      }
-   }
+   if (!ddc_excp && ddc_get_verify_setvcp())
+      ddc_excp = ddc_verify_vcp_value(dh, vrec, newval_loc);
+   record_display_latency(dh->dref->io_path, DDCA_LATENCY_SET_VCP, cur_monotonic_nanosec() - start_nanos);
 
    DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
    return ddc_excp;
@@ -493,140 +555,324 @@ mock_get_nontable_vcp_value(
    return pseudo_errinfo;
 }
 
+//
+// Unsupported features
+//
+
+/** Checks whether a feature is already known to be unsupported by a display.
+ *
+ *  On first use for a #Display_Ref, the set of unsupported features saved
+ *  for the monitor model is loaded, together with any listed in the monitor
+ *  quirks database.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \return true if the feature is known to be unsupported
+ *
+ *  \remark
+ *  Feature x00 is never treated as unsupported, since it is used to determine
+ *  how the monitor indicates unsupported features.
+ */
+bool ddc_is_known_unsupported_feature(Display_Ref * dref, DDCA_Vcp_Feature_Code feature_code) {
+   if (feature_code == 0x00)
+      return false;
+   if (!(dref->flags & DREF_UNSUPPORTED_FEATURES_CHECKED)) {
+      if (dref->mmid) {
+         dref->unsupported_features = get_persistent_unsupported_features(dref->mmid);
+         Monitor_Quirk_Data * quirk = get_monitor_quirks(dref->mmid);
+         if (quirk)
+            dref->unsupported_features = bs256_or(dref->unsupported_features, quirk->unsupported_features);
+      }
+      dref->flags |= DREF_UNSUPPORTED_FEATURES_CHECKED;
+   }
+   return bs256_contains(dref->unsupported_features, feature_code);
+}
+
+
+/** Records that a display does not support a feature.
+ *
+ *  The set is written to the persistent cache when the display is closed.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ */
+void ddc_record_unsupported_feature(Display_Ref * dref, DDCA_Vcp_Feature_Code feature_code) {
+   if (feature_code == 0x00 || bs256_contains(dref->unsupported_features, feature_code))
+      return;
+   dref->unsupported_features = bs256_insert(dref->unsupported_features, feature_code);
+   dref->flags |= DREF_UNSUPPORTED_FEATURES_CHANGED;
+}
+
+
+/** Saves the unsupported features recorded for a display in the persistent
+ *  cache, if they have changed.
+ *
+ *  \param  dref  display reference
+ */
+void ddc_save_unsupported_features(Display_Ref * dref) {
+   bool debug = false;
+   if (dref->flags & DREF_UNSUPPORTED_FEATURES_CHANGED) {
+      DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s", dref_repr_t(dref));
+      if (dref->mmid)
+         set_persistent_unsupported_features(dref->mmid, dref->unsupported_features);
+      dref->flags &= ~DREF_UNSUPPORTED_FEATURES_CHANGED;
+      DBGTRC_DONE(debug, TRACE_GROUP, "");
+   }
+}
+
+
 //
 // Get VCP values
 //
 
-/** Gets the value for a non-table feature.
+/** Checks a parsed response to a Get VCP Feature request for a non-table
+ *  feature, determining whether the feature is reported or determined to
+ *  be unsupported.
+ *
+ *  \param  dh                  handle for open display
+ *  \param  feature_code        VCP feature code
+ *  \param  parsed_response     parsed response
+ *  \return NULL if success, pointer to #Error_Info if failure
+ *
+ *  If the feature is unsupported, this is recorded for the display.
+ */
+static Error_Info *
+check_nontable_vcp_response(
+       Display_Handle *               dh,
+       DDCA_Vcp_Feature_Code          feature_code,
+       Parsed_Nontable_Vcp_Response * parsed_response)
+{
+   Error_Info * excp = NULL;
+#ifdef NO_LONGER_NEEDED
+   if (parsed_response->vcp_code != feature_code) {
+      DBGMSG("!!! WTF! requested feature_code = 0x%02x, but code in response is 0x%02x",
+             feature_code, parsed_response->vcp_code);
+      call_tuned_sleep_i2c(SE_POST_READ);
+      goto retry;
+   }
+#endif
+
+   if (!parsed_response->valid_response)  {
+      excp = errinfo_new(DDCRC_DDC_DATA, __func__);  // was DDCRC_INVALID_DATA
+   }
+   else if (!parsed_response->supported_opcode) {
+      excp = errinfo_new(DDCRC_REPORTED_UNSUPPORTED, __func__);
+      if (!value_bytes_zero(parsed_response)) {
+         // for exploring
+         DBGMSG("supported_opcode == false, but not all value bytes 0");
+      }
+   }
+   else if (value_bytes_zero(parsed_response) &&
+         (dh->dref->flags & DREF_DDC_USES_MH_ML_SH_SL_ZERO_FOR_UNSUPPORTED) )
+   {
+      // just a messages for now
+      DBGMSG("all value bytes 0, supported_opcode == true,"
+             " setting DDCRC_DETERMINED_UNSUPPORTED)");
+      excp = errinfo_new2(DDCRC_DETERMINED_UNSUPPORTED, __func__, "MH=ML=SH=SL=0");
+   }
+
+   if (ERRINFO_STATUS(excp) == DDCRC_REPORTED_UNSUPPORTED ||
+       ERRINFO_STATUS(excp) == DDCRC_DETERMINED_UNSUPPORTED)
+   {
+      ddc_record_unsupported_feature(dh->dref, feature_code);
+   }
+   return excp;
+}
+
+
+/** Interprets the response to a Get VCP Feature request for a non-table
+ *  feature into storage owned by the caller, checking whether the feature
+ *  is reported or determined to be unsupported.
+ *
+ *  \param  dh                  handle for open display
+ *  \param  feature_code        VCP feature code
+ *  \param  response_packet_ptr response packet
+ *  \param  parsed_response     where to return parsed response
+ *  \return NULL if success, pointer to #Error_Info if failure
+ *
+ *  If the feature is unsupported, this is recorded for the display.
+ */
+static Error_Info *
+interpret_nontable_vcp_response_into(
+       Display_Handle *               dh,
+       DDCA_Vcp_Feature_Code          feature_code,
+       DDC_Packet *                   response_packet_ptr,
+       Parsed_Nontable_Vcp_Response * parsed_response)
+{
+   Error_Info * excp = NULL;
+   Parsed_Nontable_Vcp_Response * packet_response = NULL;
+   Public_Status_Code psc = get_interpreted_vcp_code(response_packet_ptr, false /* make_copy */, &packet_response);
+   if (psc == 0) {
+      *parsed_response = *packet_response;
+      excp = check_nontable_vcp_response(dh, feature_code, parsed_response);
+   }
+   else {
+      excp = errinfo_new(psc, __func__);
+   }
+   return excp;
+}
+
+
+/** Interprets the response to a Get VCP Feature request for a non-table
+ *  feature, checking whether the feature is reported or determined to be
+ *  unsupported.
  *
  *  \param  dh                 handle for open display
  *  \param  feature_code       VCP feature code
+ *  \param  response_packet_ptr response packet
  *  \param  ppInterpretedCode  where to return parsed response
  *  \return NULL if success, pointer to #Error_Info if failure
  *
- * It is the responsibility of the caller to free the parsed response.
- *
- * The value pointed to by ppInterpretedCode is non-null iff the returned status code is 0.
+ *  It is the responsibility of the caller to free the parsed response.
+ *  If the feature is unsupported, this is recorded for the display.
  */
 Error_Info *
-ddc_get_nontable_vcp_value(
+ddc_interpret_nontable_vcp_response(
        Display_Handle *               dh,
        DDCA_Vcp_Feature_Code          feature_code,
+       DDC_Packet *                   response_packet_ptr,
        Parsed_Nontable_Vcp_Response** ppInterpretedCode)
+{
+   Parsed_Nontable_Vcp_Response * parsed_response = calloc(1, sizeof(Parsed_Nontable_Vcp_Response));
+   Error_Info * excp = interpret_nontable_vcp_response_into(
+                          dh, feature_code, response_packet_ptr, parsed_response);
+   if (excp) {
+      free(parsed_response);
+      parsed_response = NULL;
+   }
+   *ppInterpretedCode = parsed_response;
+   return excp;
+}
+
+
+/** Gets the value for a non-table feature into storage owned by the caller.
+ *
+ *  The request packet is taken from the current thread's packet pool, and
+ *  the response is decoded directly into **parsed_response** without
+ *  creating a response packet, so once the thread has performed its first
+ *  DDC exchange a successful read does not allocate memory.
+ *
+ *  \param  dh                 handle for open display
+ *  \param  feature_code       VCP feature code
+ *  \param  parsed_response    where to return parsed response
+ *  \return NULL if success, pointer to #Error_Info if failure
+ */
+Error_Info *
+ddc_get_nontable_vcp_value_into(
+       Display_Handle *               dh,
+       DDCA_Vcp_Feature_Code          feature_code,
+       Parsed_Nontable_Vcp_Response * parsed_response)
 {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, Reading feature 0x%02x", dh_repr(dh), feature_code);
+   OP_PROFILE(OPT_GETVCP, dh->dref);
 
    Error_Info * excp = NULL;
-   Parsed_Nontable_Vcp_Response * parsed_response = NULL;
-   *ppInterpretedCode = NULL;
+   memset(parsed_response, 0, sizeof(Parsed_Nontable_Vcp_Response));
 
-   Error_Info * mock_errinfo = mock_get_nontable_vcp_value(feature_code, ppInterpretedCode);
-   if (mock_errinfo || *ppInterpretedCode) {
+   Parsed_Nontable_Vcp_Response * mock_response = NULL;
+   Error_Info * mock_errinfo = mock_get_nontable_vcp_value(feature_code, &mock_response);
+   if (mock_errinfo || mock_response) {
       DBGMSF(debug, "Returning mock response for feature 0x%02x", feature_code);
+      if (mock_response) {
+         *parsed_response = *mock_response;
+         free(mock_response);
+      }
       return mock_errinfo;
    }
 
-   DDC_Packet * request_packet_ptr  = NULL;
-   DDC_Packet * response_packet_ptr = NULL;
-   request_packet_ptr = create_ddc_getvcp_request_packet(
+   if (ddc_is_known_unsupported_feature(dh->dref, feature_code)) {
+      excp = errinfo_new2(DDCRC_DETERMINED_UNSUPPORTED, __func__, "Cached");
+      DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, excp, "Feature 0x%02x known to be unsupported", feature_code);
+      return excp;
+   }
+
+   DDC_Packet * request_packet_ptr = create_ddc_getvcp_request_packet(
                            feature_code, "ddc_get_nontable_vcp_value:request packet");
    // dump_packet(request_packet_ptr);
 
-   Byte expected_response_type = DDC_PACKET_TYPE_QUERY_VCP_RESPONSE;
-   Byte expected_subtype = feature_code;
-   // int max_read_bytes  = 20;    // actually 3 + 8 + 1, or is it 2 + 8 + 1?
-   // expected response size:
-   //  (src addr == x6e) (length) (response contents) (checkbyte)
-   //  1               + 1      + 8                 + 1           == 11
-   //  alternative is DDC Null Response, which is shorter
-   //  N. response does not include initial destination address byte of DDC/CI spec
-   int max_read_bytes = 11;
-
-   excp = ddc_write_read_with_retry(
+   // the response is decoded directly into parsed_response, no response packet is created
+   excp = ddc_write_read_nontable_vcp_with_retry(
            dh,
            request_packet_ptr,
-           max_read_bytes,
-           expected_response_type,
-           expected_subtype,
-           false,                       // all_zero_response_ok
-           &response_packet_ptr
-        );
-   ASSERT_IFF(excp, !response_packet_ptr);
-//   assert( (!excp && response_packet_ptr) || (excp && !response_packet_ptr));
-   if (debug || IS_TRACING() ) {
-      if (excp)
-         DBGTRC_NOPREFIX(debug, TRACE_GROUP,
-                "ddc_write_read_with_retry() returned %s, response_packet_ptr=%p",
-                psc_desc(ERRINFO_STATUS(excp)), response_packet_ptr);
-   }
-
-   if (!excp) {
-      assert(response_packet_ptr);
-      // dump_packet(response_packet_ptr);
-      Public_Status_Code psc = get_interpreted_vcp_code(response_packet_ptr, true /* make_copy */, &parsed_response);   // ???
-      if (psc == 0) {
-#ifdef NO_LONGER_NEEDED
-         if (parsed_response->vcp_code != feature_code) {
-            DBGMSG("!!! WTF! requested feature_code = 0x%02x, but code in response is 0x%02x",
-                   feature_code, parsed_response->vcp_code);
-            call_tuned_sleep_i2c(SE_POST_READ);
-            goto retry;
-         }
-#endif
-
-         if (!parsed_response->valid_response)  {
-            excp = errinfo_new(DDCRC_DDC_DATA, __func__);  // was DDCRC_INVALID_DATA
-         }
-         else if (!parsed_response->supported_opcode) {
-            excp = errinfo_new(DDCRC_REPORTED_UNSUPPORTED, __func__);
-            if (!value_bytes_zero(parsed_response)) {
-               // for exploring
-               DBGMSG("supported_opcode == false, but not all value bytes 0");
-            }
-         }
-         else if (value_bytes_zero(parsed_response) &&
-               (dh->dref->flags & DREF_DDC_USES_MH_ML_SH_SL_ZERO_FOR_UNSUPPORTED) )
-         {
-            // just a messages for now
-            DBGMSG("all value bytes 0, supported_opcode == true,"
-                   " setting DDCRC_DETERMINED_UNSUPPORTED)");
-            excp = errinfo_new2(DDCRC_DETERMINED_UNSUPPORTED, __func__, "MH=ML=SH=SL=0");
-         }
-
-         if (excp) {
-            free(parsed_response);
-            parsed_response = NULL;
-         }
-      }
-      else {
-         excp = errinfo_new(psc, __func__);
-      }
-   }
+           feature_code,
+           parsed_response);
+   if (excp)
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP,
+             "ddc_write_read_nontable_vcp_with_retry() returned %s",
+             psc_desc(ERRINFO_STATUS(excp)));
+   else
+      excp = check_nontable_vcp_response(dh, feature_code, parsed_response);
 
-   if (request_packet_ptr)
-      free_ddc_packet(request_packet_ptr);
-   if (response_packet_ptr)
-      free_ddc_packet(response_packet_ptr);
+   free_ddc_packet(request_packet_ptr);
 
-   ASSERT_IFF(excp, !parsed_response); // needed to avoid clang warning
    if (!excp) {
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Success reading feature x%02x. *ppinterpreted_code=%p",
-                                      feature_code, parsed_response);
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Success reading feature x%02x", feature_code);
       DBGTRC_NOPREFIX(debug, TRACE_GROUP,
                       "mh=0x%02x, ml=0x%02x, sh=0x%02x, sl=0x%02x, max value=%d, cur value=%d",
                       parsed_response->mh, parsed_response->ml,
                       parsed_response->sh, parsed_response->sl,
                       (parsed_response->mh<<8) | parsed_response->ml,
                       (parsed_response->sh<<8) | parsed_response->sl);
+      ddc_cache_nontable_vcp_value(dh->dref, feature_code, parsed_response);
+      ddc_remember_vcp_value(dh->dref, feature_code, parsed_response);
+      ddc_publish_vcp_value(dh->dref, feature_code, 0, parsed_response);
+      if (feature_code == 0xd6)
+         ddc_record_power_mode(dh->dref, parsed_response->sl);
+   }
+   else {
+      ddc_invalidate_cached_vcp_value(dh->dref, feature_code);
+      ddc_publish_vcp_value(dh->dref, feature_code, excp->status_code, NULL);
    }
-   *ppInterpretedCode = parsed_response;
 
    DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, excp, "");
    return excp;
 }
 
 
+/** Gets the value for a non-table feature.
+ *
+ *  \param  dh                 handle for open display
+ *  \param  feature_code       VCP feature code
+ *  \param  ppInterpretedCode  where to return parsed response
+ *  \return NULL if success, pointer to #Error_Info if failure
+ *
+ * It is the responsibility of the caller to free the parsed response.
+ *
+ * The value pointed to by ppInterpretedCode is non-null iff the returned status code is 0.
+ */
+Error_Info *
+ddc_get_nontable_vcp_value(
+       Display_Handle *               dh,
+       DDCA_Vcp_Feature_Code          feature_code,
+       Parsed_Nontable_Vcp_Response** ppInterpretedCode)
+{
+   Parsed_Nontable_Vcp_Response * parsed_response = calloc(1, sizeof(Parsed_Nontable_Vcp_Response));
+   Error_Info * excp = ddc_get_nontable_vcp_value_into(dh, feature_code, parsed_response);
+   if (excp) {
+      free(parsed_response);
+      parsed_response = NULL;
+   }
+   *ppInterpretedCode = parsed_response;
+   return excp;
+}
+
+
+// Lowest level at which this check can be done, multi_part_read_with_retry()
+// doesn't know it's being called for table value
+static Error_Info *
+table_read_null_response_as_unsupported(Error_Info * ddc_excp, const char * func) {
+   if (ddc_excp->status_code == DDCRC_NULL_RESPONSE ||
+       ddc_excp->status_code == DDCRC_ALL_RESPONSES_NULL)
+   {
+      Error_Info * wrapped_exception = ddc_excp;
+      ddc_excp = errinfo_new_with_cause2(
+            DDCRC_DETERMINED_UNSUPPORTED, wrapped_exception, func, "DDC NULL Message");
+   }
+   return ddc_excp;
+}
+
+
 /** Gets the value of a table feature in a newly allocated Buffer struct.
  *  It is the responsibility of the caller to free the Buffer.
  *
@@ -644,6 +890,14 @@ ddc_get_table_vcp_value(
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "Reading feature 0x%02x", feature_code);
 
+   Buffer * memo = ddc_get_memo_table_vcp_value(dh->dref, feature_code);
+   if (memo) {
+      *pp_table_bytes = memo;
+      DBGTRC_DONE(debug, TRACE_GROUP, "Using memoized value, %d bytes", memo->len);
+      return NULL;
+   }
+   OP_PROFILE(OPT_TABLE_READ, dh->dref);
+
    Public_Status_Code psc = 0;
    Error_Info * ddc_excp = NULL;
    DDCA_Output_Level output_level = get_output_level();
@@ -663,19 +917,14 @@ ddc_get_table_vcp_value(
 
    if (psc == 0) {
       *pp_table_bytes = paccumulator;
+      ddc_memo_table_vcp_value(dh->dref, feature_code, paccumulator->bytes, paccumulator->len);
       if (output_level >= DDCA_OL_VERBOSE) {
          DBGMSG("Bytes returned on table read:");
          dbgrpt_buffer(paccumulator, 1);
       }
    }
-   // lowest level at which this check can be done, multi_part_read_with_retry() doesn't
-   // know it's being called for table value
-   else if (ddc_excp->status_code == DDCRC_NULL_RESPONSE ||
-            ddc_excp->status_code == DDCRC_ALL_RESPONSES_NULL)
-   {
-      Error_Info * wrapped_exception = ddc_excp;
-      ddc_excp = errinfo_new_with_cause2(
-            DDCRC_DETERMINED_UNSUPPORTED, wrapped_exception, __func__, "DDC NULL Message");
+   else {
+      ddc_excp = table_read_null_response_as_unsupported(ddc_excp, __func__);
    }
 
    DBGTRC_NOPREFIX(debug, TRACE_GROUP,
@@ -685,20 +934,104 @@ ddc_get_table_vcp_value(
 }
 
 
-/** Gets the value of a VCP feature.
+/** Reads the value of a table feature, passing each fragment to a function
+ *  as it is received rather than assembling the value.
  *
- * \param  dh              handle for open display
- * \param  feature_code    feature code id
- * \param  call_type       indicates whether table or non-table
- * \param  pvalrec         location where to return newly allocated #Single_Vcp_Value
- * \return NULL if success, pointer to #Error_Info if failure
+ *  \param  dh              display handle
+ *  \param  feature_code    VCP feature code
+ *  \param  fragment_func   function to which each fragment is passed
+ *  \param  context         passed to **fragment_func**
+ *  \param  bytect_loc      if non-null, where to return total number of bytes read
+ *  \return NULL if success, pointer to #Error_Info if failure
  *
- * The value pointed to by pvalrec is non-null iff the return value is null
+ *  \remark
+ *  See #multi_part_read_streaming_with_retry() for how retries affect
+ *  the fragments passed.
+ */
+Error_Info *
+ddc_get_table_vcp_value_streaming(
+       Display_Handle *          dh,
+       Byte                      feature_code,
+       Multi_Part_Fragment_Func  fragment_func,
+       void *                    context,
+       int *                     bytect_loc)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "Reading feature 0x%02x", feature_code);
+   OP_PROFILE(OPT_TABLE_READ, dh->dref);
+
+   Error_Info * ddc_excp = NULL;
+   if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
+      ddc_excp = ERRINFO_NEW(DDCRC_UNIMPLEMENTED);
+   }
+   else {
+      ddc_excp = multi_part_read_streaming_with_retry(
+               dh,
+               DDC_PACKET_TYPE_TABLE_READ_REQUEST,
+               feature_code,
+               true,                      // all_zero_response_ok
+               fragment_func,
+               context,
+               bytect_loc);
+      if (ddc_excp)
+         ddc_excp = table_read_null_response_as_unsupported(ddc_excp, __func__);
+   }
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
+   return ddc_excp;
+}
+
+
+typedef struct {
+   Byte * buf;
+   int    bufsz;
+} Table_Read_Target;
+
+
+static DDCA_Status
+copy_fragment_to_target(void * context, int offset, const Byte * bytes, int bytect) {
+   Table_Read_Target * target = context;
+   if (offset + bytect > target->bufsz)
+      return DDCRC_ARG;
+   memcpy(target->buf + offset, bytes, bytect);
+   return 0;
+}
+
+
+/** Reads the value of a table feature into a buffer owned by the caller.
  *
- * The caller is responsible for freeing the value returned at **valrec_loc**.
+ *  \param  dh              display handle
+ *  \param  feature_code    VCP feature code
+ *  \param  buf             buffer in which to return the value
+ *  \param  bufsz           size of buffer
+ *  \param  bytect_loc      where to return the number of bytes read
+ *  \return NULL if success, pointer to #Error_Info if failure,
+ *          with status DDCRC_ARG if the value does not fit in the buffer
  */
 Error_Info *
-ddc_get_vcp_value(
+ddc_get_table_vcp_value_into(
+       Display_Handle *       dh,
+       Byte                   feature_code,
+       Byte *                 buf,
+       int                    bufsz,
+       int *                  bytect_loc)
+{
+   Table_Read_Target target = {buf, bufsz};
+   *bytect_loc = 0;
+   Error_Info * ddc_excp = ddc_get_table_vcp_value_streaming(
+                              dh, feature_code, copy_fragment_to_target, &target, bytect_loc);
+   if (ERRINFO_STATUS(ddc_excp) == DDCRC_ARG) {
+      Error_Info * wrapped_exception = ddc_excp;
+      ddc_excp = errinfo_new_with_cause3(
+            DDCRC_ARG, wrapped_exception, __func__, "Value exceeds buffer size %d", bufsz);
+   }
+   return ddc_excp;
+}
+
+
+// Performs the DDC I/O for ddc_get_vcp_value()
+static Error_Info *
+read_vcp_value(
        Display_Handle *       dh,
        Byte                   feature_code,
        DDCA_Vcp_Value_Type    call_type,
@@ -793,13 +1126,254 @@ ddc_get_vcp_value(
 }
 
 
+/** Gets the value of a VCP feature.
+ *
+ * \param  dh              handle for open display
+ * \param  feature_code    feature code id
+ * \param  call_type       indicates whether table or non-table
+ * \param  pvalrec         location where to return newly allocated #Single_Vcp_Value
+ * \return NULL if success, pointer to #Error_Info if failure
+ *
+ * The value pointed to by pvalrec is non-null iff the return value is null
+ *
+ * The caller is responsible for freeing the value returned at **valrec_loc**.
+ *
+ * If read coalescing is enabled, a thread that requests a read already
+ * in flight on another thread shares its result, see ddc_read_coalescing.c.
+ */
+Error_Info *
+ddc_get_vcp_value(
+       Display_Handle *       dh,
+       Byte                   feature_code,
+       DDCA_Vcp_Value_Type    call_type,
+       DDCA_Any_Vcp_Value **  valrec_loc)
+{
+   if (ddc_is_read_coalescing_enabled())
+      return ddc_coalesced_read(dh, feature_code, call_type, read_vcp_value, valrec_loc);
+   return read_vcp_value(dh, feature_code, call_type, valrec_loc);
+}
+
+
+//
+// Batched reads
+//
+
+// Orders the reads in a batch: non-table features first, in ascending feature
+// code order, followed by table features, which require multi-part reads with
+// their own sleep requirements.
+static int compare_batch_entries(const void * a, const void * b) {
+   const Vcp_Batch_Entry * e1 = *(const Vcp_Batch_Entry **) a;
+   const Vcp_Batch_Entry * e2 = *(const Vcp_Batch_Entry **) b;
+   if (e1->value_type != e2->value_type)
+      return (e1->value_type == DDCA_NON_TABLE_VCP_VALUE) ? -1 : 1;
+   return (int) e1->feature_code - (int) e2->feature_code;
+}
+
+
+/** Reads the values of multiple features as a single batch.
+ *
+ *  The reads are performed in a planned order, and sleeps following each
+ *  read are deferred until immediately before the next request is written,
+ *  so that the time spent processing each response and preparing the next
+ *  request is subtracted from the required post-read wait.  The deferred
+ *  time remaining after the final read is recorded in the #Display_Ref, and
+ *  is honored by the next operation on the display.
+ *
+ *  Features known to be unsupported fail without performing DDC I/O.
+ *
+ *  \param  dh        handle for open display
+ *  \param  entries   array of features to read, the **valrec** and **excp**
+ *                    fields are set on return
+ *  \param  entry_ct  number of entries
+ *  \return number of features successfully read
+ *
+ *  \remark
+ *  The caller is responsible for freeing the **valrec** and **excp** values
+ *  returned in each entry.
+ */
+int
+ddc_get_multiple_vcp_values(
+      Display_Handle *   dh,
+      Vcp_Batch_Entry *  entries,
+      int                entry_ct)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, entry_ct=%d", dh_repr(dh), entry_ct);
+
+   Vcp_Batch_Entry ** plan = calloc(entry_ct, sizeof(Vcp_Batch_Entry*));
+   for (int ndx = 0; ndx < entry_ct; ndx++) {
+      entries[ndx].valrec = NULL;
+      entries[ndx].excp   = NULL;
+      plan[ndx] = &entries[ndx];
+   }
+   qsort(plan, entry_ct, sizeof(Vcp_Batch_Entry*), compare_batch_entries);
+
+   bool old_thread_deferral = enable_deferred_sleep_for_thread(true);
+   int ok_ct = 0;
+   for (int ndx = 0; ndx < entry_ct; ndx++) {
+      Vcp_Batch_Entry * cur = plan[ndx];
+      cur->excp = ddc_get_vcp_value(dh, cur->feature_code, cur->value_type, &cur->valrec);
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "feature 0x%02x: %s",
+                      cur->feature_code, errinfo_summary(cur->excp));
+      if (!cur->excp)
+         ok_ct++;
+   }
+   enable_deferred_sleep_for_thread(old_thread_deferral);
+   free(plan);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %d", ok_ct);
+   return ok_ct;
+}
+
+
+/** Verifies the values of multiple features after they have all been
+ *  written, reading the values back as a single batch.
+ *
+ *  Compared to verifying each feature immediately after it is written, the
+ *  writes are not interleaved with reads, and the post-write settle time is
+ *  waited out once instead of once per feature.
+ *
+ *  \param  dh       display handle for open display
+ *  \param  vrecs    values that were written, in the order written
+ *  \param  vrec_ct  number of values
+ *  \return NULL if all verifiable features have the values written,
+ *          otherwise an #Error_Info with status DDCRC_VERIFY and one cause
+ *          for each feature that failed
+ *
+ *  \remark
+ *  If a feature was written more than once, the last value is verified.
+ */
+Error_Info *
+ddc_verify_multiple_vcp_values(
+      Display_Handle *       dh,
+      DDCA_Any_Vcp_Value **  vrecs,
+      int                    vrec_ct)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, vrec_ct=%d", dh_repr(dh), vrec_ct);
+   FILE * verbose_msg_dest = fout();
+   if ( get_output_level() < DDCA_OL_VERBOSE && !debug )
+      verbose_msg_dest = NULL;
+
+   Vcp_Batch_Entry *     entries = calloc(vrec_ct, sizeof(Vcp_Batch_Entry));
+   DDCA_Any_Vcp_Value ** written = calloc(vrec_ct, sizeof(DDCA_Any_Vcp_Value*));
+   int entry_ct = 0;
+   for (int ndx = 0; ndx < vrec_ct; ndx++) {
+      DDCA_Any_Vcp_Value * vrec = vrecs[ndx];
+      if ( !is_rereadable_feature(dh, vrec->opcode) ||
+           ( vrec->value_type == DDCA_NON_TABLE_VCP_VALUE &&
+             is_unreadable_sl_value(vrec->opcode, vrec->val.c_nc.sl) )
+         )
+      {
+         f0printf(verbose_msg_dest, "Feature 0x%02x does not support verification\n", vrec->opcode);
+         continue;
+      }
+      int entry_ndx = 0;
+      while (entry_ndx < entry_ct && entries[entry_ndx].feature_code != vrec->opcode)
+         entry_ndx++;
+      if (entry_ndx == entry_ct) {
+         entries[entry_ct].feature_code = vrec->opcode;
+         entries[entry_ct].value_type   = vrec->value_type;
+         entry_ct++;
+      }
+      written[entry_ndx] = vrec;
+   }
+
+   Error_Info * ddc_excp = NULL;
+   if (entry_ct > 0) {
+      f0printf(verbose_msg_dest, "Verifying that values of %d features successfully set...\n", entry_ct);
+      ddc_get_multiple_vcp_values(dh, entries, entry_ct);
+
+      Error_Info ** causes = calloc(entry_ct, sizeof(Error_Info*));
+      int cause_ct = 0;
+      for (int ndx = 0; ndx < entry_ct; ndx++) {
+         Vcp_Batch_Entry * cur = &entries[ndx];
+         if (cur->excp) {
+            f0printf(verbose_msg_dest, "Read after write failed for feature 0x%02x: %s\n",
+                                       cur->feature_code, psc_desc(cur->excp->status_code));
+            causes[cause_ct++] = cur->excp;
+         }
+         else {
+            if (!single_vcp_value_equal(written[ndx], cur->valrec)) {
+               f0printf(verbose_msg_dest,
+                        "Current value of feature 0x%02x does not match value set.\n",
+                        cur->feature_code);
+               causes[cause_ct++] = errinfo_new2(DDCRC_VERIFY, __func__,
+                        "Current value of feature 0x%02x does not match value set",
+                        cur->feature_code);
+            }
+            free_single_vcp_value(cur->valrec);
+         }
+      }
+      if (cause_ct > 0)
+         ddc_excp = errinfo_new_with_causes3(DDCRC_VERIFY, causes, cause_ct, __func__,
+                                             "Verification failed for %d features", cause_ct);
+      else
+         f0printf(verbose_msg_dest, "Verification succeeded\n");
+      free(causes);
+   }
+   free(written);
+   free(entries);
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
+   return ddc_excp;
+}
+
+
+/** Sets multiple VCP feature values.
+ *
+ *  If write verification is turned on, the values are verified after all
+ *  have been written, using #ddc_verify_multiple_vcp_values().  The sleep
+ *  after each write is deferred until the next DDC operation.
+ *
+ *  \param  dh       display handle for open display
+ *  \param  vrecs    values to write, in order
+ *  \param  vrec_ct  number of values
+ *  \return NULL if success, pointer to #Error_Info if failure
+ *
+ *  Writing stops at the first value that cannot be written.
+ */
+Error_Info *
+ddc_set_multiple_vcp_values(
+      Display_Handle *       dh,
+      DDCA_Any_Vcp_Value **  vrecs,
+      int                    vrec_ct)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, vrec_ct=%d", dh_repr(dh), vrec_ct);
+
+   Error_Info * ddc_excp = NULL;
+   bool verify = ddc_set_verify_setvcp(false);
+   bool old_thread_deferral = enable_deferred_sleep_for_thread(true);
+   for (int ndx = 0; ndx < vrec_ct && !ddc_excp; ndx++)
+      ddc_excp = ddc_set_vcp_value(dh, vrecs[ndx], NULL);
+   enable_deferred_sleep_for_thread(old_thread_deferral);
+   ddc_set_verify_setvcp(verify);
+
+   if (!ddc_excp && verify)
+      ddc_excp = ddc_verify_multiple_vcp_values(dh, vrecs, vrec_ct);
+   CHECK_DEFERRED_SLEEP(dh);
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, ddc_excp, "");
+   return ddc_excp;
+}
+
+
 void init_ddc_vcp() {
    RTTI_ADD_FUNC(ddc_save_current_settings);
    RTTI_ADD_FUNC(ddc_set_nontable_vcp_value);
+   RTTI_ADD_FUNC(ddc_save_unsupported_features);
+   RTTI_ADD_FUNC(ddc_get_multiple_vcp_values);
+   RTTI_ADD_FUNC(ddc_verify_multiple_vcp_values);
+   RTTI_ADD_FUNC(ddc_set_multiple_vcp_values);
    RTTI_ADD_FUNC(set_table_vcp_value);
    RTTI_ADD_FUNC(ddc_set_vcp_value);
-   RTTI_ADD_FUNC(ddc_get_nontable_vcp_value);
+   RTTI_ADD_FUNC(ddc_verify_vcp_value);
+   RTTI_ADD_FUNC(ddc_get_nontable_vcp_value_into);
+   RTTI_ADD_FUNC(ddc_interpret_nontable_vcp_response);
    RTTI_ADD_FUNC(ddc_get_table_vcp_value);
    RTTI_ADD_FUNC(ddc_get_vcp_value);
+   RTTI_ADD_FUNC(read_vcp_value);
+   RTTI_ADD_FUNC(ddc_get_table_vcp_value_streaming);
 }
 
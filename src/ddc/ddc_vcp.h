@@ -16,12 +16,15 @@
 /** \endcond */
 
 #include "base/core.h"
+#include "base/ddc_packets.h"
 #include "base/displays.h"
 #include "base/status_code_mgt.h"
 
 #include "vcp/vcp_feature_codes.h"
 #include "vcp/vcp_feature_values.h"
 
+#include "ddc/ddc_multi_part_io.h"
+
 
 bool
 ddc_set_verify_setvcp(
@@ -40,6 +43,12 @@ ddc_set_nontable_vcp_value(
       Byte                      feature_code,
       int                       new_value);
 
+Error_Info *
+ddc_verify_vcp_value(
+      Display_Handle *          dh,
+      DDCA_Any_Vcp_Value *      vrec,
+      DDCA_Any_Vcp_Value **     newval_loc);
+
 Error_Info *
 ddc_set_vcp_value(
       Display_Handle *          dh,
@@ -52,12 +61,51 @@ ddc_get_table_vcp_value(
       Byte                      feature_code,
       Buffer**                  table_bytes_loc);
 
+Error_Info *
+ddc_get_table_vcp_value_streaming(
+      Display_Handle *          dh,
+      Byte                      feature_code,
+      Multi_Part_Fragment_Func  fragment_func,
+      void *                    context,
+      int *                     bytect_loc);
+
+Error_Info *
+ddc_get_table_vcp_value_into(
+      Display_Handle *          dh,
+      Byte                      feature_code,
+      Byte *                    buf,
+      int                       bufsz,
+      int *                     bytect_loc);
+
+Error_Info *
+ddc_get_nontable_vcp_value_into(
+      Display_Handle *          dh,
+      Byte                      feature_code,
+      Parsed_Nontable_Vcp_Response * parsed_response);
+
 Error_Info *
 ddc_get_nontable_vcp_value(
       Display_Handle *          dh,
       Byte                      feature_code,
       Parsed_Nontable_Vcp_Response** parsed_response_loc);
 
+Error_Info *
+ddc_interpret_nontable_vcp_response(
+      Display_Handle *          dh,
+      Byte                      feature_code,
+      DDC_Packet *              response_packet_ptr,
+      Parsed_Nontable_Vcp_Response** parsed_response_loc);
+
+bool
+ddc_is_known_unsupported_feature(
+      Display_Ref *             dref,
+      Byte                      feature_code);
+
+void
+ddc_record_unsupported_feature(
+      Display_Ref *             dref,
+      Byte                      feature_code);
+
 Error_Info *
 ddc_get_vcp_value(
        Display_Handle *         dh,
@@ -65,6 +113,36 @@ ddc_get_vcp_value(
        DDCA_Vcp_Value_Type      call_type,
        DDCA_Any_Vcp_Value **    valrec_loc);
 
+/** One feature in a batch read by #ddc_get_multiple_vcp_values() */
+typedef struct {
+   Byte                     feature_code;
+   DDCA_Vcp_Value_Type      value_type;
+   DDCA_Any_Vcp_Value *     valrec;       // set iff excp == NULL
+   Error_Info *             excp;
+} Vcp_Batch_Entry;
+
+int
+ddc_get_multiple_vcp_values(
+       Display_Handle *         dh,
+       Vcp_Batch_Entry *        entries,
+       int                      entry_ct);
+
+Error_Info *
+ddc_verify_multiple_vcp_values(
+       Display_Handle *         dh,
+       DDCA_Any_Vcp_Value **    vrecs,
+       int                      vrec_ct);
+
+Error_Info *
+ddc_set_multiple_vcp_values(
+       Display_Handle *         dh,
+       DDCA_Any_Vcp_Value **    vrecs,
+       int                      vrec_ct);
+
+void
+ddc_save_unsupported_features(
+       Display_Ref *            dref);
+
 void
 init_ddc_vcp();
 
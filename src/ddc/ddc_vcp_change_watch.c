@@ -0,0 +1,617 @@
+/** @file ddc_vcp_change_watch.c
+ *
+ *  Watches any number of displays for VCP feature changes made using the
+ *  monitor's own controls.
+ *
+ *  A single thread services all watched displays.  Displays are kept on a
+ *  timer wheel, a circular array of slots each holding the displays due to
+ *  be checked at that tick.  A display whose check is more than one turn of
+ *  the wheel away records how many turns remain.  The thread sleeps until
+ *  the next tick, and not at all while no display is watched.
+ *
+ *  Each display has its own poll interval.  When a display reports a change
+ *  the interval drops to the minimum, since the user is likely still at the
+ *  controls.  Each check that finds nothing lengthens the interval, up to
+ *  the maximum.
+ *
+ *  A check reads feature x02 (New Control Value).  If changes exist, feature
+ *  x52 (Active Control) is read to get the id of each changed feature.  For
+ *  MCCS 2.2 and 3.0, x52 is a FIFO, which is drained in one burst.  The new
+ *  value of each changed feature is read and passed to the notification
+ *  function.  Finally, feature x02 is reset.
+ *
+ *  DDC transactions are performed with background priority,
+ *  see ddc_io_scheduler.c.
+ *
+ *  USB displays are not polled.  A USB HID monitor sends an input report
+ *  when a control changes, which hiddev delivers as #hiddev_usage_ref
+ *  events by read() on the device.  Each watched USB display has its own
+ *  thread, blocked in poll() until a report arrives or the watch is
+ *  stopped.  The new value of each changed feature is read and passed to
+ *  the same notification function.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef USE_USB
+#include <linux/hiddev.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include "ddcutil_types.h"
+#include "ddcutil_status_codes.h"
+
+#include "util/error_info.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+#include "base/vcp_version.h"
+
+#include "dynvcp/dyn_feature_codes.h"
+
+#include "ddc/ddc_io_scheduler.h"
+#include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_value_cache.h"
+#include "ddc/ddc_vcp_version.h"
+
+#include "ddc/ddc_vcp_change_watch.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define WHEEL_SLOTS          64
+#define WHEEL_TICK_MILLISEC 100
+#define MAX_FIFO_CHANGES     20    // loop guard when draining feature x52
+
+#define WATCHED_DISPLAY_MARKER "VCWD"
+/** A display on the timer wheel */
+typedef struct {
+   char                   marker[4];
+   Display_Handle *       dh;
+   DDCA_Notification_Func callback;
+   int                    interval_millisec;   // current poll interval
+   int                    rounds;              // remaining turns of the wheel before due
+   bool                   unwatched;           // removed while being checked
+} Watched_Display;
+
+static GMutex    watch_mutex;                  // protects all the following
+static GCond     watch_cond;                   // signaled when a display is added or checked
+static GThread * watch_thread = NULL;
+static bool      watch_thread_shutdown = false;
+static GList *   wheel[WHEEL_SLOTS];           // Watched_Display's
+static int       wheel_pos = 0;                // slot of the next tick
+static GList *   due_displays = NULL;          // taken from the wheel, waiting to be checked
+static int       watched_ct = 0;
+static Watched_Display * checking = NULL;      // display currently being checked
+
+#ifdef USE_USB
+#define USB_WATCH_REPORT_CT  16    // usage events read at once
+#define USB_WATCHED_DISPLAY_MARKER "VCUW"
+/** A USB display watched by its own thread */
+typedef struct {
+   char                   marker[4];
+   Display_Handle *       dh;
+   DDCA_Notification_Func callback;            // atomic access
+   GThread *              thread;
+   int                    stop_pipe[2];        // written to stop the thread
+   int                    last_values[256];    // last value reported by feature, -1 if none
+} Usb_Watched_Display;
+
+static GList *   usb_watched_displays = NULL;  // Usb_Watched_Display's, protected by watch_mutex
+#endif
+
+
+static void
+schedule_watched_display(Watched_Display * wd) {
+   int ticks = wd->interval_millisec / WHEEL_TICK_MILLISEC;
+   if (ticks < 1)
+      ticks = 1;
+   wd->rounds = (ticks-1) / WHEEL_SLOTS;
+   int slot = (wheel_pos + ticks - 1) % WHEEL_SLOTS;
+   wheel[slot] = g_list_append(wheel[slot], wd);
+}
+
+
+static Watched_Display *
+find_in_list(GList * list, Display_Handle * dh) {
+   for (GList * l = list; l; l = l->next) {
+      Watched_Display * wd = l->data;
+      if (wd->dh == dh)
+         return wd;
+   }
+   return NULL;
+}
+
+
+// does not find the display currently being checked
+static Watched_Display *
+find_watched_display(Display_Handle * dh) {
+   Watched_Display * wd = find_in_list(due_displays, dh);
+   for (int slot = 0; slot < WHEEL_SLOTS && !wd; slot++)
+      wd = find_in_list(wheel[slot], dh);
+   return wd;
+}
+
+
+static void
+free_watched_display(Watched_Display * wd) {
+   assert(wd && memcmp(wd->marker, WATCHED_DISPLAY_MARKER, 4) == 0);
+   wd->marker[3] = 'x';
+   free(wd);
+}
+
+
+/** Reads the new value of a changed feature and passes it to the
+ *  notification function.
+ */
+static void
+report_changed_feature(Display_Handle * dh, DDCA_Notification_Func callback, Byte feature_code) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x", dh_repr(dh), feature_code);
+
+   ddc_invalidate_cached_vcp_value(dh->dref, feature_code);
+   DDCA_Vcp_Value_Type value_type = DDCA_NON_TABLE_VCP_VALUE;
+   Display_Feature_Metadata * dfm = dyn_get_cached_feature_metadata_by_dh(feature_code, dh, false);
+   if (dfm && (dfm->feature_flags & DDCA_TABLE))
+      value_type = DDCA_TABLE_VCP_VALUE;
+
+   DDCA_Any_Vcp_Value * valrec = NULL;
+   Error_Info * excp = ddc_get_vcp_value(dh, feature_code, value_type, &valrec);
+   DDCA_Status psc = ERRINFO_STATUS(excp);
+   ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+   if (!valrec) {
+      valrec = calloc(1, sizeof(DDCA_Any_Vcp_Value));
+      valrec->opcode = feature_code;
+      valrec->value_type = value_type;
+   }
+
+   callback(psc, valrec);
+
+   if (valrec->value_type == DDCA_TABLE_VCP_VALUE)
+      free(valrec->val.t.bytes);
+   free(valrec);
+   DBGTRC_DONE(debug, TRACE_GROUP, "psc=%s", psc_desc(psc));
+}
+
+
+/** Reads feature x52 (Active Control).
+ *
+ *  \param  wd                  watched display
+ *  \param  changed_feature_loc where to return the id of the changed feature
+ *  \return error reading x52, NULL if success
+ *
+ *  \remark
+ *  If x52 is unsupported, which features changed is unknown.  All cached
+ *  values for the display are discarded, and the notification function
+ *  is called for feature x52 with the error status.
+ */
+static Error_Info *
+read_active_control(Watched_Display * wd, Byte * changed_feature_loc) {
+   Parsed_Nontable_Vcp_Response * response = NULL;
+   Error_Info * excp = ddc_get_nontable_vcp_value(wd->dh, 0x52, &response);
+   if (excp) {
+      if (excp->status_code == DDCRC_REPORTED_UNSUPPORTED ||
+          excp->status_code == DDCRC_DETERMINED_UNSUPPORTED)
+      {
+         ddc_invalidate_all_cached_vcp_values(wd->dh->dref);
+         DDCA_Any_Vcp_Value valrec = {.opcode = 0x52, .value_type = DDCA_NON_TABLE_VCP_VALUE};
+         wd->callback(excp->status_code, &valrec);
+      }
+   }
+   else {
+      *changed_feature_loc = response->sl;
+      free(response);
+   }
+   return excp;
+}
+
+
+/** Checks a display for feature changes, reporting each changed feature.
+ *
+ *  \param  wd  watched display
+ *  \return true if changes were found
+ */
+static bool
+check_watched_display(Watched_Display * wd) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(wd->dh));
+   bool changes_found = false;
+
+   // x01: no new control values, x02: new control values exist, xff: no user controls
+   Parsed_Nontable_Vcp_Response * response = NULL;
+   Error_Info * excp = ddc_get_nontable_vcp_value(wd->dh, 0x02, &response);
+   if (excp) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Error reading feature x02: %s", errinfo_summary(excp));
+   }
+   else {
+      Byte x02_value = response->sl;
+      free(response);
+      if (x02_value == 0x02) {
+         changes_found = true;
+         // For MCCS 2.2 and 3.0, x52 is a FIFO to be read until it returns x00
+         DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dh(wd->dh);
+         int max_reads = (vcp_version_le(vspec, DDCA_VSPEC_V21)) ? 1 : MAX_FIFO_CHANGES;
+         for (int ctr = 0; ctr < max_reads && !excp; ctr++) {
+            Byte changed_feature = 0x00;
+            excp = read_active_control(wd, &changed_feature);
+            if (excp || changed_feature == 0x00)
+               break;
+            report_changed_feature(wd->dh, wd->callback, changed_feature);
+         }
+         // otherwise x02 continues to report that changes exist
+         ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+         excp = ddc_set_nontable_vcp_value(wd->dh, 0x02, 0x01);
+      }
+      else if (x02_value != 0x01) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Feature x02 reports value 0x%02x", x02_value);
+      }
+   }
+   ERRINFO_FREE_WITH_REPORT(excp, debug || IS_TRACING() || report_freed_exceptions);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %s", sbool(changes_found));
+   return changes_found;
+}
+
+
+static gpointer
+vcp_change_watch_thread(gpointer data) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+   ddc_set_thread_io_priority(DDCA_IO_PRIORITY_BACKGROUND);
+
+   gint64 next_tick = g_get_monotonic_time();
+   g_mutex_lock(&watch_mutex);
+   while (!watch_thread_shutdown) {
+      if (watched_ct == 0) {
+         g_cond_wait(&watch_cond, &watch_mutex);
+         next_tick = g_get_monotonic_time() + WHEEL_TICK_MILLISEC*1000;
+         continue;
+      }
+      if (g_get_monotonic_time() < next_tick) {
+         g_cond_wait_until(&watch_cond, &watch_mutex, next_tick);
+         continue;
+      }
+      next_tick += WHEEL_TICK_MILLISEC*1000;
+
+      // collect the displays due at this tick
+      GList * l = wheel[wheel_pos];
+      while (l) {
+         GList * next = l->next;
+         Watched_Display * wd = l->data;
+         if (wd->rounds > 0)
+            wd->rounds--;
+         else {
+            wheel[wheel_pos] = g_list_delete_link(wheel[wheel_pos], l);
+            due_displays = g_list_append(due_displays, wd);
+         }
+         l = next;
+      }
+      wheel_pos = (wheel_pos+1) % WHEEL_SLOTS;
+
+      while (due_displays && !watch_thread_shutdown) {
+         Watched_Display * wd = due_displays->data;
+         due_displays = g_list_delete_link(due_displays, due_displays);
+         checking = wd;
+         g_mutex_unlock(&watch_mutex);
+         bool changes_found = check_watched_display(wd);
+         g_mutex_lock(&watch_mutex);
+         checking = NULL;
+         if (wd->unwatched) {
+            free_watched_display(wd);
+         }
+         else {
+            if (changes_found)
+               wd->interval_millisec = VCP_CHANGE_WATCH_MIN_INTERVAL_MILLISEC;
+            else
+               wd->interval_millisec = MIN(wd->interval_millisec + wd->interval_millisec/2,
+                                           VCP_CHANGE_WATCH_MAX_INTERVAL_MILLISEC);
+            schedule_watched_display(wd);
+         }
+         g_cond_broadcast(&watch_cond);
+      }
+   }
+   g_mutex_unlock(&watch_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+   return NULL;
+}
+
+
+#ifdef USE_USB
+static void
+free_usb_watched_display(Usb_Watched_Display * uwd) {
+   assert(uwd && memcmp(uwd->marker, USB_WATCHED_DISPLAY_MARKER, 4) == 0);
+   close(uwd->stop_pipe[0]);
+   close(uwd->stop_pipe[1]);
+   uwd->marker[3] = 'x';
+   free(uwd);
+}
+
+
+static Usb_Watched_Display *
+find_usb_watched_display(Display_Handle * dh) {
+   for (GList * l = usb_watched_displays; l; l = l->next) {
+      Usb_Watched_Display * uwd = l->data;
+      if (uwd->dh == dh)
+         return uwd;
+   }
+   return NULL;
+}
+
+
+/** Reports the features changed by the usage events of a USB input report.
+ *
+ *  Events for usages outside the VESA monitor control page, and events
+ *  whose value equals the last value reported for the feature, e.g. those
+ *  caused by reading the new value, are ignored.
+ */
+static void
+handle_usb_usage_events(Usb_Watched_Display * uwd, struct hiddev_usage_ref * urefs, int ct) {
+   bool debug = false;
+   for (int ndx = 0; ndx < ct; ndx++) {
+      struct hiddev_usage_ref * uref = &urefs[ndx];
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "usage_code=0x%08x, value=%d", uref->usage_code, uref->value);
+      if (uref->field_index == HID_FIELD_INDEX_NONE || (uref->usage_code >> 16) != 0x0082)
+         continue;
+      Byte feature_code = uref->usage_code & 0xff;
+      if (uwd->last_values[feature_code] == uref->value)
+         continue;
+      uwd->last_values[feature_code] = uref->value;
+      report_changed_feature(uwd->dh, g_atomic_pointer_get(&uwd->callback), feature_code);
+   }
+}
+
+
+static gpointer
+usb_vcp_change_watch_thread(gpointer data) {
+   bool debug = false;
+   Usb_Watched_Display * uwd = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(uwd->dh));
+
+   int fd = uwd->dh->fd;
+   int flags = HIDDEV_FLAG_UREF;
+   if (ioctl(fd, HIDIOCSFLAG, &flags) < 0) {
+      DBGTRC_DONE(debug, TRACE_GROUP, "HIDIOCSFLAG failed, errno=%d", errno);
+      return NULL;
+   }
+
+   struct pollfd fds[2] = { {.fd = fd,                 .events = POLLIN},
+                            {.fd = uwd->stop_pipe[0],  .events = POLLIN} };
+   while (true) {
+      int rc = poll(fds, 2, -1);
+      if (rc < 0 && errno == EINTR)
+         continue;
+      if (rc < 0 || fds[1].revents || (fds[0].revents & (POLLERR|POLLHUP|POLLNVAL)))
+         break;
+      struct hiddev_usage_ref urefs[USB_WATCH_REPORT_CT];
+      ssize_t bytect = read(fd, urefs, sizeof(urefs));
+      if (bytect < 0 && (errno == EINTR || errno == EAGAIN))
+         continue;
+      if (bytect <= 0) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "read() returned %zd, errno=%d", bytect, errno);
+         break;
+      }
+      handle_usb_usage_events(uwd, urefs, bytect / sizeof(struct hiddev_usage_ref));
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "dh=%s", dh_repr(uwd->dh));
+   return NULL;
+}
+
+
+// Must be called with watch_mutex held
+static DDCA_Status
+watch_usb_vcp_changes(Display_Handle * dh, DDCA_Notification_Func callback) {
+   Usb_Watched_Display * uwd = find_usb_watched_display(dh);
+   if (uwd) {
+      g_atomic_pointer_set(&uwd->callback, callback);
+      return DDCRC_OK;
+   }
+   uwd = calloc(1, sizeof(Usb_Watched_Display));
+   memcpy(uwd->marker, USB_WATCHED_DISPLAY_MARKER, 4);
+   uwd->dh = dh;
+   uwd->callback = callback;
+   for (int ndx = 0; ndx < 256; ndx++)
+      uwd->last_values[ndx] = -1;
+   if (pipe(uwd->stop_pipe) < 0) {
+      int errsv = errno;
+      free(uwd);
+      return -errsv;
+   }
+   uwd->thread = g_thread_new("usb_vcp_change_watch", usb_vcp_change_watch_thread, uwd);
+   usb_watched_displays = g_list_append(usb_watched_displays, uwd);
+   return DDCRC_OK;
+}
+
+
+// Must be called without watch_mutex held, and not from the watch thread
+static void
+stop_usb_watched_display(Usb_Watched_Display * uwd) {
+   assert(g_thread_self() != uwd->thread);   // i.e. not from the notification function
+   char c = 0;
+   ssize_t rc = write(uwd->stop_pipe[1], &c, 1);
+   (void) rc;
+   g_thread_join(uwd->thread);
+   free_usb_watched_display(uwd);
+}
+#endif
+
+
+/** Starts watching a display for VCP feature changes.
+ *
+ *  If the display is already watched, only the notification function
+ *  is changed.
+ *
+ *  \param  dh        display handle
+ *  \param  callback  function called with the new value of each changed feature
+ *  \return DDCRC_OK, or -errno if a USB watch thread cannot be created
+ *
+ *  \remark
+ *  The notification function is called on the watch thread, or for a USB
+ *  display on the display's own watch thread.
+ *  The #DDCA_Any_Vcp_Value passed to it is valid only for the duration
+ *  of the call.
+ */
+DDCA_Status
+ddc_watch_vcp_changes(Display_Handle * dh, DDCA_Notification_Func callback) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, callback=%p", dh_repr(dh), callback);
+   assert(callback);
+
+#ifdef USE_USB
+   if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
+      g_mutex_lock(&watch_mutex);
+      DDCA_Status ddcrc = watch_usb_vcp_changes(dh, callback);
+      g_mutex_unlock(&watch_mutex);
+      DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+      return ddcrc;
+   }
+#endif
+
+   g_mutex_lock(&watch_mutex);
+   Watched_Display * wd = find_watched_display(dh);
+   if (!wd && checking && checking->dh == dh && !checking->unwatched)
+      wd = checking;
+   if (wd) {
+      wd->callback = callback;
+   }
+   else {
+      wd = calloc(1, sizeof(Watched_Display));
+      memcpy(wd->marker, WATCHED_DISPLAY_MARKER, 4);
+      wd->dh = dh;
+      wd->callback = callback;
+      wd->interval_millisec = VCP_CHANGE_WATCH_MIN_INTERVAL_MILLISEC;
+      schedule_watched_display(wd);
+      watched_ct++;
+      if (!watch_thread)
+         watch_thread = g_thread_new("vcp_change_watch", vcp_change_watch_thread, NULL);
+      g_cond_broadcast(&watch_cond);
+   }
+   g_mutex_unlock(&watch_mutex);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, DDCRC_OK, "");
+   return DDCRC_OK;
+}
+
+
+/** Stops watching a display for VCP feature changes.
+ *
+ *  If the display is being checked, waits for the check to complete,
+ *  so the notification function is not called for the display after
+ *  this function returns.
+ *
+ *  \param  dh   display handle
+ *  \retval DDCRC_OK
+ *  \retval DDCRC_INVALID_OPERATION  display not watched
+ */
+DDCA_Status
+ddc_unwatch_vcp_changes(Display_Handle * dh) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s", dh_repr(dh));
+   DDCA_Status ddcrc = DDCRC_OK;
+
+#ifdef USE_USB
+   if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
+      g_mutex_lock(&watch_mutex);
+      Usb_Watched_Display * uwd = find_usb_watched_display(dh);
+      if (uwd)
+         usb_watched_displays = g_list_remove(usb_watched_displays, uwd);
+      g_mutex_unlock(&watch_mutex);
+      if (uwd)
+         stop_usb_watched_display(uwd);
+      else
+         ddcrc = DDCRC_INVALID_OPERATION;
+      DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+      return ddcrc;
+   }
+#endif
+
+   g_mutex_lock(&watch_mutex);
+   Watched_Display * wd = find_watched_display(dh);
+   if (wd) {
+      due_displays = g_list_remove(due_displays, wd);
+      for (int slot = 0; slot < WHEEL_SLOTS; slot++)
+         wheel[slot] = g_list_remove(wheel[slot], wd);
+      free_watched_display(wd);
+      watched_ct--;
+   }
+   else if (checking && checking->dh == dh && !checking->unwatched) {
+      assert(g_thread_self() != watch_thread);   // i.e. not from the notification function
+      checking->unwatched = true;
+      watched_ct--;
+      while (checking && checking->dh == dh)
+         g_cond_wait(&watch_cond, &watch_mutex);
+   }
+   else {
+      ddcrc = DDCRC_INVALID_OPERATION;
+   }
+   g_mutex_unlock(&watch_mutex);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Stops the watch thread.  Called at library termination. */
+void
+ddc_terminate_vcp_change_watch() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   g_mutex_lock(&watch_mutex);
+   GThread * thread = watch_thread;
+   watch_thread_shutdown = true;
+   g_cond_broadcast(&watch_cond);
+   g_mutex_unlock(&watch_mutex);
+   if (thread)
+      g_thread_join(thread);   // also releases reference
+
+#ifdef USE_USB
+   g_mutex_lock(&watch_mutex);
+   GList * usb_displays = usb_watched_displays;
+   usb_watched_displays = NULL;
+   g_mutex_unlock(&watch_mutex);
+   for (GList * l = usb_displays; l; l = l->next)
+      stop_usb_watched_display(l->data);
+   g_list_free(usb_displays);
+#endif
+
+   g_mutex_lock(&watch_mutex);
+   g_list_free_full(due_displays, (GDestroyNotify) free_watched_display);
+   due_displays = NULL;
+   for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+      g_list_free_full(wheel[slot], (GDestroyNotify) free_watched_display);
+      wheel[slot] = NULL;
+   }
+   watched_ct = 0;
+   watch_thread = NULL;
+   watch_thread_shutdown = false;
+   g_mutex_unlock(&watch_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+void init_ddc_vcp_change_watch() {
+   RTTI_ADD_FUNC(check_watched_display);
+   RTTI_ADD_FUNC(report_changed_feature);
+   RTTI_ADD_FUNC(vcp_change_watch_thread);
+   RTTI_ADD_FUNC(ddc_watch_vcp_changes);
+   RTTI_ADD_FUNC(ddc_unwatch_vcp_changes);
+   RTTI_ADD_FUNC(ddc_terminate_vcp_change_watch);
+#ifdef USE_USB
+   RTTI_ADD_FUNC(usb_vcp_change_watch_thread);
+#endif
+}
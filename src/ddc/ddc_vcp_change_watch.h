@@ -0,0 +1,21 @@
+/** @file ddc_vcp_change_watch.h
+ *
+ *  Watches any number of displays for VCP feature changes, using a single thread
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_VCP_CHANGE_WATCH_H_
+#define DDC_VCP_CHANGE_WATCH_H_
+
+#include "ddcutil_types.h"
+
+#include "base/displays.h"
+
+DDCA_Status ddc_watch_vcp_changes(Display_Handle * dh, DDCA_Notification_Func callback);
+DDCA_Status ddc_unwatch_vcp_changes(Display_Handle * dh);
+void        ddc_terminate_vcp_change_watch();
+void        init_ddc_vcp_change_watch();
+
+#endif /* DDC_VCP_CHANGE_WATCH_H_ */
@@ -0,0 +1,446 @@
+/** @file ddc_vcp_value_cache.c
+ *
+ *  Optionally remembers the non-table feature values most recently read from
+ *  or written to each display, so that repeated queries of the same feature
+ *  need not go to the monitor every time.
+ *
+ *  How long a value is used depends on the feature:
+ *  - features that are read only and whose value never changes, e.g. xdf
+ *    (VCP version) or xc9 (firmware level), are cached until the
+ *    #Display_Ref is freed
+ *  - other read only features, whose values the monitor changes by itself,
+ *    e.g. xac (horizontal frequency), are cached only briefly
+ *  - read/write features are cached for a longer interval, and the cached
+ *    value is replaced when the feature is written using ddcutil
+ *  - features x02 (New Control Value) and x52 (Active Control) are never cached
+ *
+ *  Values changed with the monitor's on screen display are not seen until the
+ *  cached value expires, unless the change is detected using features x02 and
+ *  x52, as by command WATCH, and the cached value is invalidated.
+ *
+ *  Separately, table feature values, whose multi-part reads can take seconds,
+ *  can be memoized.  A memoized value does not expire.  It is replaced when
+ *  the feature is written, and discarded when the feature is invalidated,
+ *  e.g. because a change is detected, or when the write fails.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ddcutil_types.h"
+
+#include "util/data_structures.h"
+#include "util/error_info.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/feature_metadata.h"
+#include "base/parms.h"
+#include "base/rtti.h"
+
+#include "dynvcp/dyn_feature_codes.h"
+
+#include "ddc/ddc_vcp.h"
+
+#include "ddc/ddc_vcp_value_cache.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+static bool   vcp_value_cache_enabled = false;
+static bool   table_value_memo_enabled = false;
+static GMutex vcp_value_cache_mutex;      // also protects table value memos
+
+// read only features whose value does not change while the display is connected
+static DDCA_Vcp_Feature_Code static_features[] = {
+      0xb2,     // Flat Panel Sub-Pixel Layout
+      0xb6,     // Display Technology Type
+      0xc6,     // Application Enable Key
+      0xc8,     // Display Controller Type
+      0xc9,     // Display Firmware Level
+      0xdf,     // VCP Version
+};
+static const int static_feature_ct = sizeof(static_features)/sizeof(DDCA_Vcp_Feature_Code);
+
+
+/** Enables or disables the VCP value cache.
+ *
+ *  Disabling the cache does not discard values already cached, but they
+ *  are not used.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ */
+bool ddc_enable_vcp_value_cache(bool onoff) {
+   bool old = vcp_value_cache_enabled;
+   vcp_value_cache_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether the VCP value cache is enabled.
+ *
+ *  \return true if enabled
+ */
+bool ddc_is_vcp_value_cache_enabled() {
+   return vcp_value_cache_enabled;
+}
+
+
+/** Enables or disables memoization of table feature values.
+ *
+ *  Disabling memoization discards all memoized values when they are
+ *  next accessed.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ */
+bool ddc_enable_table_value_memo(bool onoff) {
+   bool old = table_value_memo_enabled;
+   table_value_memo_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether table feature values are memoized.
+ *
+ *  \return true if enabled
+ */
+bool ddc_is_table_value_memo_enabled() {
+   return table_value_memo_enabled;
+}
+
+
+static bool is_static_feature(DDCA_Vcp_Feature_Code feature_code) {
+   for (int ndx = 0; ndx < static_feature_ct; ndx++) {
+      if (static_features[ndx] == feature_code)
+         return true;
+   }
+   return false;
+}
+
+
+/** Returns how long a value of a feature may be used.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \return time to live in nanoseconds, 0 if the feature is not cached,
+ *          UINT64_MAX if the value is used until invalidated
+ */
+static uint64_t
+vcp_value_ttl_nanosec(Display_Ref * dref, DDCA_Vcp_Feature_Code feature_code) {
+   if (feature_code == 0x00 || feature_code == 0x02 || feature_code == 0x52)
+      return 0;
+
+   uint64_t result = 0;
+   Display_Feature_Metadata * dfm =
+         dyn_get_cached_feature_metadata_by_dref(feature_code, dref, true);
+   if (dfm && (dfm->feature_flags & DDCA_NON_TABLE)) {
+      if (dfm->feature_flags & DDCA_RO) {
+         if (is_static_feature(feature_code))
+            result = UINT64_MAX;
+         else
+            result = DEFAULT_VCP_VALUE_CACHE_RO_TTL_MILLISEC * (uint64_t) 1000000;
+      }
+      else if (dfm->feature_flags & DDCA_RW) {
+         result = DEFAULT_VCP_VALUE_CACHE_TTL_MILLISEC * (uint64_t) 1000000;
+      }
+   }
+   return result;
+}
+
+
+/** Returns the cache entry for a feature, allocating the cache for the
+ *  display if necessary.  Must be called with #vcp_value_cache_mutex held.
+ */
+static Cached_Vcp_Value *
+get_cache_entry(Display_Ref * dref, DDCA_Vcp_Feature_Code feature_code) {
+   if (!dref->vcp_value_cache)
+      dref->vcp_value_cache = calloc(256, sizeof(Cached_Vcp_Value));
+   return &dref->vcp_value_cache[feature_code];
+}
+
+
+static void
+store_cache_entry(
+      Display_Ref *          dref,
+      DDCA_Vcp_Feature_Code  feature_code,
+      Byte mh, Byte ml, Byte sh, Byte sl)
+{
+   uint64_t ttl = vcp_value_ttl_nanosec(dref, feature_code);
+   if (ttl == 0)
+      return;
+   uint64_t now = cur_monotonic_nanosec();
+   g_mutex_lock(&vcp_value_cache_mutex);
+   Cached_Vcp_Value * entry = get_cache_entry(dref, feature_code);
+   entry->mh = mh;
+   entry->ml = ml;
+   entry->sh = sh;
+   entry->sl = sl;
+   entry->expires_at = (ttl == UINT64_MAX) ? UINT64_MAX : now + ttl;
+   g_mutex_unlock(&vcp_value_cache_mutex);
+}
+
+
+/** Saves a value read from a display.
+ *
+ *  No action is taken if the cache is disabled or the feature is not cached.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \param  response      value read
+ */
+void
+ddc_cache_nontable_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      const Parsed_Nontable_Vcp_Response * response)
+{
+   if (!vcp_value_cache_enabled)
+      return;
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x", dref_repr_t(dref), feature_code);
+   store_cache_entry(dref, feature_code, response->mh, response->ml, response->sh, response->sl);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Updates the cached value of a feature that has been successfully written.
+ *
+ *  The value is updated only for Continuous features for which the maximum
+ *  value is already cached.  For other features the monitor may report
+ *  a value other than exactly what was written, so the cached value is
+ *  discarded.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \param  new_value     value written
+ */
+void
+ddc_cache_written_vcp_value(
+      Display_Ref *          dref,
+      DDCA_Vcp_Feature_Code  feature_code,
+      int                    new_value)
+{
+   if (!dref->vcp_value_cache)
+      return;
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x, new_value=%d",
+                                       dref_repr_t(dref), feature_code, new_value);
+   Display_Feature_Metadata * dfm =
+         dyn_get_cached_feature_metadata_by_dref(feature_code, dref, true);
+   bool is_cont = dfm && (dfm->feature_flags & DDCA_CONT);
+
+   g_mutex_lock(&vcp_value_cache_mutex);
+   Cached_Vcp_Value * entry = &dref->vcp_value_cache[feature_code];
+   Byte mh = entry->mh;
+   Byte ml = entry->ml;
+   bool update = is_cont && vcp_value_cache_enabled && entry->expires_at != 0;
+   if (!update)
+      entry->expires_at = 0;
+   g_mutex_unlock(&vcp_value_cache_mutex);
+   if (update)
+      store_cache_entry(dref, feature_code, mh, ml, new_value >> 8, new_value & 0xff);
+   DBGTRC_DONE(debug, TRACE_GROUP, "is_cont=%s", SBOOL(is_cont));
+}
+
+
+/** Discards the cached value of a feature.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ */
+void
+ddc_invalidate_cached_vcp_value(
+      Display_Ref *          dref,
+      DDCA_Vcp_Feature_Code  feature_code)
+{
+   g_mutex_lock(&vcp_value_cache_mutex);
+   if (dref->vcp_value_cache)
+      dref->vcp_value_cache[feature_code].expires_at = 0;
+   if (dref->table_value_memo && dref->table_value_memo[feature_code]) {
+      buffer_free(dref->table_value_memo[feature_code], __func__);
+      dref->table_value_memo[feature_code] = NULL;
+   }
+   g_mutex_unlock(&vcp_value_cache_mutex);
+}
+
+
+/** Discards all cached values for a display.
+ *
+ *  \param  dref          display reference
+ */
+void
+ddc_invalidate_all_cached_vcp_values(Display_Ref * dref) {
+   g_mutex_lock(&vcp_value_cache_mutex);
+   if (dref->vcp_value_cache)
+      memset(dref->vcp_value_cache, 0, 256 * sizeof(Cached_Vcp_Value));
+   if (dref->table_value_memo) {
+      for (int ndx = 0; ndx < 256; ndx++) {
+         if (dref->table_value_memo[ndx]) {
+            buffer_free(dref->table_value_memo[ndx], __func__);
+            dref->table_value_memo[ndx] = NULL;
+         }
+      }
+   }
+   g_mutex_unlock(&vcp_value_cache_mutex);
+}
+
+
+/** Memoizes the value of a table feature read from or successfully
+ *  written to a display.
+ *
+ *  No action is taken if memoization is disabled.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \param  bytes         value
+ *  \param  bytect        number of bytes in value
+ */
+void
+ddc_memo_table_vcp_value(
+      Display_Ref *          dref,
+      DDCA_Vcp_Feature_Code  feature_code,
+      const Byte *           bytes,
+      int                    bytect)
+{
+   if (!table_value_memo_enabled)
+      return;
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x, bytect=%d",
+                                       dref_repr_t(dref), feature_code, bytect);
+   Buffer * buf = buffer_new_with_value((Byte *) bytes, bytect, __func__);
+   g_mutex_lock(&vcp_value_cache_mutex);
+   if (!dref->table_value_memo)
+      dref->table_value_memo = calloc(256, sizeof(Buffer *));
+   if (dref->table_value_memo[feature_code])
+      buffer_free(dref->table_value_memo[feature_code], __func__);
+   dref->table_value_memo[feature_code] = buf;
+   g_mutex_unlock(&vcp_value_cache_mutex);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Returns a copy of the memoized value of a table feature.
+ *
+ *  \param  dref          display reference
+ *  \param  feature_code  VCP feature code
+ *  \return copy of the value, caller is responsible for freeing,
+ *          NULL if memoization is disabled or no value is memoized
+ */
+Buffer *
+ddc_get_memo_table_vcp_value(
+      Display_Ref *          dref,
+      DDCA_Vcp_Feature_Code  feature_code)
+{
+   Buffer * result = NULL;
+   g_mutex_lock(&vcp_value_cache_mutex);
+   if (dref->table_value_memo && dref->table_value_memo[feature_code]) {
+      if (table_value_memo_enabled) {
+         Buffer * memo = dref->table_value_memo[feature_code];
+         result = buffer_new_with_value(memo->bytes, memo->len, __func__);
+      }
+      else {
+         buffer_free(dref->table_value_memo[feature_code], __func__);
+         dref->table_value_memo[feature_code] = NULL;
+      }
+   }
+   g_mutex_unlock(&vcp_value_cache_mutex);
+   return result;
+}
+
+
+/** Gets the value of a non-table feature into storage owned by the caller,
+ *  using the cached value if one exists and has not expired.
+ *
+ *  \param  dh              handle for open display
+ *  \param  feature_code    VCP feature code
+ *  \param  response        where to return parsed response
+ *  \return NULL if success, pointer to #Error_Info if failure
+ *
+ *  If the cache is disabled, this is simply #ddc_get_nontable_vcp_value_into().
+ */
+Error_Info *
+ddc_get_nontable_vcp_value_cached_into(
+      Display_Handle *                dh,
+      DDCA_Vcp_Feature_Code           feature_code,
+      Parsed_Nontable_Vcp_Response *  response)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x", dh_repr(dh), feature_code);
+
+   Display_Ref * dref = dh->dref;
+   bool found = false;
+   if (vcp_value_cache_enabled) {
+      g_mutex_lock(&vcp_value_cache_mutex);
+      if (dref->vcp_value_cache) {
+         Cached_Vcp_Value * entry = &dref->vcp_value_cache[feature_code];
+         if (entry->expires_at != 0 && cur_monotonic_nanosec() < entry->expires_at) {
+            memset(response, 0, sizeof(Parsed_Nontable_Vcp_Response));
+            response->vcp_code         = feature_code;
+            response->valid_response   = true;
+            response->supported_opcode = true;
+            response->mh = entry->mh;
+            response->ml = entry->ml;
+            response->sh = entry->sh;
+            response->sl = entry->sl;
+            found = true;
+         }
+      }
+      g_mutex_unlock(&vcp_value_cache_mutex);
+   }
+
+   Error_Info * excp = NULL;
+   if (found) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Using cached value");
+   }
+   else {
+      excp = ddc_get_nontable_vcp_value_into(dh, feature_code, response);
+      // successful reads are cached by ddc_get_nontable_vcp_value_into()
+   }
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, excp, "");
+   return excp;
+}
+
+
+/** Gets the value of a non-table feature, using the cached value if one
+ *  exists and has not expired.
+ *
+ *  \param  dh              handle for open display
+ *  \param  feature_code    VCP feature code
+ *  \param  response_loc    where to return parsed response
+ *  \return NULL if success, pointer to #Error_Info if failure
+ *
+ *  The caller is responsible for freeing the response.
+ */
+Error_Info *
+ddc_get_nontable_vcp_value_cached(
+      Display_Handle *                dh,
+      DDCA_Vcp_Feature_Code           feature_code,
+      Parsed_Nontable_Vcp_Response**  response_loc)
+{
+   Parsed_Nontable_Vcp_Response * response = calloc(1, sizeof(Parsed_Nontable_Vcp_Response));
+   Error_Info * excp = ddc_get_nontable_vcp_value_cached_into(dh, feature_code, response);
+   if (excp) {
+      free(response);
+      response = NULL;
+   }
+   *response_loc = response;
+   return excp;
+}
+
+
+void init_ddc_vcp_value_cache() {
+   RTTI_ADD_FUNC(ddc_cache_nontable_vcp_value);
+   RTTI_ADD_FUNC(ddc_cache_written_vcp_value);
+   RTTI_ADD_FUNC(ddc_get_nontable_vcp_value_cached_into);
+   RTTI_ADD_FUNC(ddc_memo_table_vcp_value);
+}
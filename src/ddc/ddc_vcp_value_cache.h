@@ -0,0 +1,65 @@
+/** @file ddc_vcp_value_cache.h
+ *
+ *  In-memory cache of non-table VCP feature values, and memo of table values
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_VCP_VALUE_CACHE_H_
+#define DDC_VCP_VALUE_CACHE_H_
+
+#include <stdbool.h>
+
+#include "ddcutil_types.h"
+
+#include "util/data_structures.h"
+#include "util/error_info.h"
+
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+
+bool ddc_enable_vcp_value_cache(bool onoff);
+bool ddc_is_vcp_value_cache_enabled();
+bool ddc_enable_table_value_memo(bool onoff);
+bool ddc_is_table_value_memo_enabled();
+
+void ddc_cache_nontable_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      const Parsed_Nontable_Vcp_Response * response);
+void ddc_cache_written_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      int                                  new_value);
+void ddc_invalidate_cached_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code);
+void ddc_invalidate_all_cached_vcp_values(
+      Display_Ref *                        dref);
+void ddc_memo_table_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code,
+      const Byte *                         bytes,
+      int                                  bytect);
+
+Buffer *
+ddc_get_memo_table_vcp_value(
+      Display_Ref *                        dref,
+      DDCA_Vcp_Feature_Code                feature_code);
+
+Error_Info *
+ddc_get_nontable_vcp_value_cached_into(
+      Display_Handle *                     dh,
+      DDCA_Vcp_Feature_Code                feature_code,
+      Parsed_Nontable_Vcp_Response *       response);
+
+Error_Info *
+ddc_get_nontable_vcp_value_cached(
+      Display_Handle *                     dh,
+      DDCA_Vcp_Feature_Code                feature_code,
+      Parsed_Nontable_Vcp_Response**       response_loc);
+
+void init_ddc_vcp_value_cache();
+
+#endif /* DDC_VCP_VALUE_CACHE_H_ */
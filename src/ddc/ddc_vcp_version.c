@@ -26,6 +26,8 @@
 #include "usb/usb_vcp.h"
 #endif
 
+#include "vcp/persistent_capabilities.h"
+
 #include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_vcp.h"
 
@@ -36,6 +38,14 @@
 //
 
 
+/** Sets the VCP version of a display from feature xdf.
+ *
+ *  For I2C displays, the version saved for the monitor model by a prior
+ *  execution is used if the EDID is unchanged, avoiding the DDC exchange.
+ *
+ *  \param  dh  display handle
+ *  \return VCP version, DDCA_VSPEC_UNKNOWN if it could not be determined
+ */
 DDCA_MCCS_Version_Spec
 set_vcp_version_xdf_by_dh(Display_Handle * dh)
 {
@@ -44,6 +54,10 @@ set_vcp_version_xdf_by_dh(Display_Handle * dh)
 
    dh->dref->vcp_version_xdf = DDCA_VSPEC_UNKNOWN;
 
+   DDCA_MCCS_Version_Spec saved_vspec = DDCA_VSPEC_UNQUERIED;
+   if (dh->dref->io_path.io_mode == DDCA_IO_I2C && dh->dref->mmid && dh->dref->pedid)
+      saved_vspec = get_persistent_vcp_version(dh->dref->mmid, dh->dref->pedid->bytes);
+
    if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
 #ifdef USE_USB
       // DBGMSG("Trying to get VESA version...");
@@ -61,6 +75,10 @@ set_vcp_version_xdf_by_dh(Display_Handle * dh)
       PROGRAM_LOGIC_ERROR("ddcutil not built with USB support");
   #endif
      }
+     else if (vcp_version_is_valid(saved_vspec, false)) {
+        dh->dref->vcp_version_xdf = saved_vspec;
+        DBGMSF(debug, "Using saved VCP version %s", format_vspec(saved_vspec));
+     }
      else {    // normal case, not USB
         DDCA_Any_Vcp_Value * pvalrec;
 
@@ -86,6 +104,9 @@ set_vcp_version_xdf_by_dh(Display_Handle * dh)
                          dh->dref->vcp_version_xdf.minor,
                          format_vspec(dh->dref->vcp_version_xdf) );
            free_single_vcp_value(pvalrec);
+           if (dh->dref->mmid && dh->dref->pedid)
+              set_persistent_vcp_version(dh->dref->mmid, dh->dref->pedid->bytes,
+                                         dh->dref->vcp_version_xdf);
         }
         else {
            // happens for pre MCCS v2 monitors
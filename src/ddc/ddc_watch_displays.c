@@ -9,15 +9,19 @@
 
 /** \cond */
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <glib-2.0/glib.h>
 #ifdef ENABLE_UDEV
 #include <libudev.h>
 #endif
+#include <linux/netlink.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -34,10 +38,13 @@
 
 #include "base/core.h"
 #include "base/ddc_errno.h"
+#include "base/displays.h"
 #include "base/linux_errno.h"
 #include "base/rtti.h"
 /** \endcond */
 
+#include "ddc/ddc_displays.h"
+
 
 // Experimental code
 static bool watch_displays_enabled = true;
@@ -46,8 +53,19 @@ static bool watch_displays_enabled = true;
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_NONE;
 
 static bool terminate_watch_thread = false;
+static bool watch_displays_requested = false;   // start watch thread on first use
 static GThread * watch_thread = NULL;
 static GMutex    watch_thread_mutex;
+static int       watch_wakeup_fds[2] = {-1, -1};   // pipe, written to stop watch thread
+
+static GMutex      display_status_callbacks_mutex;
+static GPtrArray * display_status_callbacks = NULL;  // DDCA_Display_Status_Callback_Func
+
+#ifdef TARGET_BSD
+#define DRM_SYSFS_DIR "/compat/linux/sys/class/drm"
+#else
+#define DRM_SYSFS_DIR "/sys/class/drm"
+#endif
 
 #define WATCH_DISPLAYS_DATA_MARKER "WDDM"
 typedef struct {
@@ -216,12 +234,8 @@ void get_sysfs_drm_examine_one_connector(
 static
 GPtrArray * get_sysfs_drm_displays() {
    bool debug = false;
-   char * dname =
- #ifdef TARGET_BSD
-              "/compat/linux/sys/class/drm";
- #else
-              "/sys/class/drm";
- #endif
+   char dirbuf[PATH_MAX];
+   char * dname = fs_rooted_path(DRM_SYSFS_DIR, dirbuf, PATH_MAX);
    DBGTRC_STARTING(debug, TRACE_GROUP, "Examining %s", dname);
    GPtrArray * connected_displays = g_ptr_array_new_with_free_func(g_free);
    dir_filtered_ordered_foreach(
@@ -238,19 +252,152 @@ GPtrArray * get_sysfs_drm_displays() {
  }
 
 
-static GPtrArray * check_displays(GPtrArray * prev_displays, gpointer data) {
+// EDIDs of connected connectors, only accessed by the watch thread
+static GHashTable * connector_edids = NULL;   // connector name -> GByteArray
+
+
+/** Records the current EDID of a connected DRM connector.
+ *
+ *  \param  connector  connector name, e.g. card0-DP-1
+ *  \return true if a different EDID was recorded for the connector
+ */
+static bool
+record_connector_edid(const char * connector) {
+   if (!connector_edids)
+      connector_edids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify) g_byte_array_unref);
+   GByteArray * edid = NULL;
+   GET_ATTR_EDID(&edid, DRM_SYSFS_DIR, connector, "edid");
+   if (!edid)
+      edid = g_byte_array_new();
+   GByteArray * prev = g_hash_table_lookup(connector_edids, connector);
+   bool changed = prev && (prev->len != edid->len || memcmp(prev->data, edid->data, edid->len) != 0);
+   g_hash_table_replace(connector_edids, g_strdup(connector), edid);
+   return changed;
+}
+
+
+/** Updates the list of connected displays for a single DRM connector.
+ *
+ *  \param  displays      connected displays, sorted
+ *  \param  connector     connector name, e.g. card0-DP-1
+ *  \param  edid_changed  if the connector remains connected but its EDID
+ *                        changed, the connector name is appended here
+ */
+static void
+update_connector_status(GPtrArray * displays, const char * connector, GPtrArray * edid_changed) {
+   bool debug = false;
+   char * status = NULL;
+   GET_ATTR_TEXT(&status, DRM_SYSFS_DIR, connector, "status");
+   bool connected = status && streq(status, "connected");
+   g_free(status);
+
+   if (!connected) {
+      if (connector_edids)
+         g_hash_table_remove(connector_edids, connector);
+   }
+   else if (record_connector_edid(connector)) {
+      DBGMSF(debug, "EDID changed for connector %s", connector);
+      gaux_unique_string_ptr_array_include(edid_changed, (char*) connector);
+   }
+
+   int ndx = gaux_string_ptr_array_find(displays, connector);
+   if (connected && ndx < 0) {
+      g_ptr_array_add(displays, g_strdup(connector));
+      g_ptr_array_sort(displays, gaux_ptr_scomp);
+   }
+   else if (!connected && ndx >= 0) {
+      g_ptr_array_remove_index(displays, ndx);
+   }
+   DBGMSF(debug, "connector=%s, connected=%s", connector, sbool(connected));
+}
+
+
+/** Updates the list of connected displays for all connectors of one DRM card.
+ *
+ *  \param  displays      connected displays, sorted
+ *  \param  card          card name, e.g. card0
+ *  \param  edid_changed  connectors whose EDID changed are appended here
+ */
+static void
+update_card_connectors(GPtrArray * displays, const char * card, GPtrArray * edid_changed) {
+   char * prefix = g_strdup_printf("%s-", card);
+   for (int ndx = displays->len-1; ndx >= 0; ndx--) {
+      if (str_starts_with(g_ptr_array_index(displays, ndx), prefix))
+         g_ptr_array_remove_index(displays, ndx);
+   }
+   DIR * dir = opendir(fs_rooted_path_t(DRM_SYSFS_DIR));
+   if (dir) {
+      struct dirent * dent;
+      while ((dent = readdir(dir)) != NULL) {
+         if (str_starts_with(dent->d_name, prefix))
+            update_connector_status(displays, dent->d_name, edid_changed);
+      }
+      closedir(dir);
+   }
+   g_free(prefix);
+}
+
+
+/** Finds the connector of a DRM card with a given DRM object id.
+ *
+ *  \param  card          card name, e.g. card0
+ *  \param  connector_id  DRM object id of connector, as a string
+ *  \return connector name, caller must free, NULL if not found,
+ *          e.g. because the kernel does not report connector_id
+ */
+static char *
+find_drm_connector_by_id(const char * card, const char * connector_id) {
+   char * result = NULL;
+   char * prefix = g_strdup_printf("%s-", card);
+   DIR * dir = opendir(fs_rooted_path_t(DRM_SYSFS_DIR));
+   if (dir) {
+      struct dirent * dent;
+      while (!result && (dent = readdir(dir)) != NULL) {
+         if (str_starts_with(dent->d_name, prefix)) {
+            char * id = NULL;
+            GET_ATTR_TEXT(&id, DRM_SYSFS_DIR, dent->d_name, "connector_id");
+            if (id && streq(id, connector_id))
+               result = g_strdup(dent->d_name);
+            g_free(id);
+         }
+      }
+      closedir(dir);
+   }
+   g_free(prefix);
+   return result;
+}
+
+
+/** Reports the difference between two lists of connected displays to
+ *  the display change handler.
+ *
+ *  A connector whose EDID changed is reported as both removed and added.
+ *
+ *  \param  prev_displays  previously connected displays, freed
+ *  \param  cur_displays   currently connected displays
+ *  \param  edid_changed   connected displays whose EDID changed, may be NULL
+ *  \param  wdd            watch thread data
+ *  \return **cur_displays**
+ */
+static GPtrArray *
+report_display_changes(
+      GPtrArray *           prev_displays,
+      GPtrArray *           cur_displays,
+      GPtrArray *           edid_changed,
+      Watch_Displays_Data * wdd)
+{
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "prev_displays=%s",
                  join_string_g_ptr_array_t(prev_displays, ", "));
-
-   Watch_Displays_Data * wdd = data;
    assert(wdd && memcmp(wdd->marker, WATCH_DISPLAYS_DATA_MARKER, 4) == 0 );
 
    // typedef enum _change_type {Changed_None = 0, Changed_Added = 1, Changed_Removed = 2, Changed_Both = 3 } Change_Type;
    Displays_Change_Type change_type = Changed_None;
 
-   GPtrArray * cur_displays = get_sysfs_drm_displays();
-   if ( !gaux_unique_string_ptr_arrays_equal(prev_displays, cur_displays) ) {
+   if ( !gaux_unique_string_ptr_arrays_equal(prev_displays, cur_displays) ||
+        (edid_changed && edid_changed->len > 0) )
+   {
       if ( debug || IS_TRACING() ) {
          DBGMSG("Displays changed!");
          DBGMSG("Previous connected displays: %s", join_string_g_ptr_array_t(prev_displays, ", "));
@@ -258,28 +405,28 @@ static GPtrArray * check_displays(GPtrArray * prev_displays, gpointer data) {
       }
 
       GPtrArray * removed = gaux_unique_string_ptr_arrays_minus(prev_displays, cur_displays);
+      GPtrArray * added   = gaux_unique_string_ptr_arrays_minus(cur_displays, prev_displays);
+      for (int ndx = 0; edid_changed && ndx < edid_changed->len; ndx++) {
+         char * connector = g_ptr_array_index(edid_changed, ndx);
+         gaux_unique_string_ptr_array_include(removed, connector);
+         gaux_unique_string_ptr_array_include(added,   connector);
+      }
+
       if (removed->len > 0) {
          DBGTRC_NOPREFIX(debug, TRACE_GROUP,
                 "Removed displays: %s", join_string_g_ptr_array_t(removed, ", ") );
          change_type = Changed_Removed;
       }
 
-      GPtrArray * added = gaux_unique_string_ptr_arrays_minus(cur_displays, prev_displays);
       if (added->len > 0) {
          DBGTRC_NOPREFIX(debug, TRACE_GROUP,
                 "Added displays: %s", join_string_g_ptr_array_t(added, ", ") );
          change_type = (change_type == Changed_None) ? Changed_Added : Changed_Both;
       }
 
-   //    if (change_type != Changed_None) {
-      // assert( change_type != Changed_Both);
-      // DBGMSG("wdd->display_change_handler = %p (%s)",
-      //         wdd->display_change_handler,
-      //         rtti_get_func_name_by_addr(wdd->display_change_handler) );
       if (wdd->display_change_handler) {
          wdd->display_change_handler( change_type, removed, added);
       }
-      // }
       g_ptr_array_free(removed,       true);
       g_ptr_array_free(added,         true);
    }
@@ -292,6 +439,22 @@ static GPtrArray * check_displays(GPtrArray * prev_displays, gpointer data) {
 }
 
 
+static GPtrArray * check_displays(GPtrArray * prev_displays, gpointer data) {
+   return report_display_changes(prev_displays, get_sysfs_drm_displays(), NULL, data);
+}
+
+
+/** Waits for the specified time, or until the watch thread is told to terminate.
+ *
+ *  \param  millisec  maximum time to wait
+ */
+static void
+wait_for_wakeup(int millisec) {
+   struct pollfd pfd = {.fd = watch_wakeup_fds[0], .events = POLLIN};
+   poll(&pfd, 1, millisec);
+}
+
+
 // How to detect main thread crash?
 
 gpointer watch_displays_using_poll(gpointer data) {
@@ -308,10 +471,11 @@ gpointer watch_displays_using_poll(gpointer data) {
      // else    // logically meaningless, since if() case exits, but avoids clang use after free warning
      prev_displays = check_displays(prev_displays, data);
 
-      usleep(3000*1000);
+      wait_for_wakeup(3000);
       // printf(".");
       // fflush(stdout);
    }
+   g_ptr_array_free(prev_displays, true);
    DBGTRC_DONE(true, TRACE_GROUP, "Terminating");
    free_watch_displays_data(wdd);
    g_thread_exit(0);
@@ -388,123 +552,245 @@ void set_fd_blocking(int fd) {
 }
 
 
-#ifdef ENABLE_UDEV
-gpointer watch_displays_using_udev(gpointer data) {
+//
+// Event driven watch
+//
+// A DRM hotplug uevent names either a card (e.g. card0, possibly with the
+// DRM object id of the connector in property CONNECTOR), or, when a
+// connector is added or removed, the connector itself (e.g. card0-DP-1).
+// Only the status of the connectors it identifies is reread.
+//
+
+/** Handles a DRM uevent, updating the list of connected displays.
+ *
+ *  \param  displays     connected displays, sorted
+ *  \param  sysname      name of device in /sys/class/drm, e.g. card0 or card0-DP-1
+ *  \param  connector_id value of property CONNECTOR, NULL if none
+ *  \param  edid_changed connectors whose EDID changed are appended here
+ */
+static void
+update_displays_for_drm_event(
+      GPtrArray *  displays,
+      const char * sysname,
+      const char * connector_id,
+      GPtrArray *  edid_changed)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "sysname=%s, connector_id=%s", sysname, connector_id);
+
+   if (str_starts_with(sysname, "card")) {
+      char * connector = NULL;
+      if (strchr(sysname, '-'))
+         connector = g_strdup(sysname);
+      else if (connector_id)
+         connector = find_drm_connector_by_id(sysname, connector_id);
+
+      if (connector) {
+         update_connector_status(displays, connector, edid_changed);
+         g_free(connector);
+      }
+      else {
+         update_card_connectors(displays, sysname, edid_changed);
+      }
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Connected displays: %s",
+                                   join_string_g_ptr_array_t(displays, ", "));
+}
+
+
+/** Opens a netlink socket that receives kernel uevents.
+ *
+ *  \return socket file descriptor, -errno if error
+ */
+static int
+open_uevent_socket() {
+   int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+   if (fd < 0)
+      return -errno;
+   struct sockaddr_nl addr = {
+         .nl_family = AF_NETLINK,
+         .nl_pid    = 0,
+         .nl_groups = 1,         // kernel uevents
+   };
+   if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+      int errsv = errno;
+      close(fd);
+      return -errsv;
+   }
+   return fd;
+}
+
+
+/** Reads a kernel uevent from a netlink socket, and processes it if it
+ *  is for subsystem drm.
+ *
+ *  \param  fd           netlink socket
+ *  \param  displays     connected displays
+ *  \param  edid_changed connectors whose EDID changed are appended here
+ *  \return true if the list of displays may have changed
+ */
+static bool
+receive_uevent(int fd, GPtrArray * displays, GPtrArray * edid_changed) {
+   bool debug = false;
+   char buf[4096];
+   ssize_t len = recv(fd, buf, sizeof(buf)-1, 0);
+   if (len <= 0)
+      return false;
+   buf[len] = '\0';
+
+   // ACTION@DEVPATH, followed by null terminated KEY=VALUE strings
+   const char * subsystem    = NULL;
+   const char * devpath      = NULL;
+   const char * connector_id = NULL;
+   for (char * p = buf + strlen(buf) + 1; p < buf + len; p += strlen(p) + 1) {
+      if (str_starts_with(p, "SUBSYSTEM="))
+         subsystem = p + strlen("SUBSYSTEM=");
+      else if (str_starts_with(p, "DEVPATH="))
+         devpath = p + strlen("DEVPATH=");
+      else if (str_starts_with(p, "CONNECTOR="))
+         connector_id = p + strlen("CONNECTOR=");
+   }
+   DBGMSF(debug, "%s, subsystem=%s, connector_id=%s", buf, subsystem, connector_id);
+
+   bool drm_event = subsystem && streq(subsystem, "drm") && devpath;
+   if (drm_event) {
+      const char * sysname = strrchr(devpath, '/');
+      sysname = (sysname) ? sysname+1 : devpath;
+      update_displays_for_drm_event(displays, sysname, connector_id, edid_changed);
+   }
+   return drm_event;
+}
+
+
+/** Watches for display connection changes using DRM uevents.
+ *
+ *  Uses udev if built with udev support, otherwise, or if udev is unavailable,
+ *  reads kernel uevents directly from a netlink socket.  The thread blocks
+ *  until an event arrives.  If no event source can be opened, falls back to
+ *  polling /sys/class/drm.
+ *
+ *  \param  data  #Watch_Displays_Data
+ */
+gpointer watch_displays_using_events(gpointer data) {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
 
    Watch_Displays_Data * wdd = data;
    assert(wdd && memcmp(wdd->marker, WATCH_DISPLAYS_DATA_MARKER, 4) == 0 );
 
-   // DBGMSG("Caller process id: %d, caller thread id: %d", wdd->main_process_id, wdd->main_thread_id);
-   // pid_t cur_pid = getpid();
-   // pid_t cur_tid = get_thread_id();
-   // DBGMSG("Our process id: %d, our thread id: %d", cur_pid, cur_tid);
-
-   struct udev* udev;
-   udev = udev_new();
-   assert(udev);
-   struct udev_monitor* mon = udev_monitor_new_from_netlink(udev, "udev");
-   udev_monitor_filter_add_match_subsystem_devtype(mon, "drm", NULL);   // alt "hidraw"
-   udev_monitor_enable_receiving(mon);
-
-   // make udev_monitor_receive_device() blocking
-   int fd = udev_monitor_get_fd(mon);
-   set_fd_blocking(fd);
+   int fd = -1;
+#ifdef ENABLE_UDEV
+   struct udev *         udev = udev_new();
+   struct udev_monitor * mon  = NULL;
+   if (udev) {
+      mon = udev_monitor_new_from_netlink(udev, "udev");
+      if (mon) {
+         udev_monitor_filter_add_match_subsystem_devtype(mon, "drm", NULL);
+         if (udev_monitor_enable_receiving(mon) == 0)
+            fd = udev_monitor_get_fd(mon);   // nonblocking
+      }
+   }
+   if (fd < 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "udev monitor unavailable, using netlink socket");
+      if (mon)
+         udev_monitor_unref(mon);
+      mon = NULL;
+   }
+#endif
+   bool using_netlink = false;
+   if (fd < 0) {
+      fd = open_uevent_socket();
+      using_netlink = (fd >= 0);
+   }
+   if (fd < 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "open_uevent_socket() returned %s, polling instead",
+                                          linux_errno_name(-fd));
+#ifdef ENABLE_UDEV
+      if (udev)
+         udev_unref(udev);
+#endif
+      return watch_displays_using_poll(data);
+   }
 
    GPtrArray * prev_displays = get_sysfs_drm_displays();
    DBGTRC_NOPREFIX(debug, TRACE_GROUP,
           "Initial connected displays: %s", join_string_g_ptr_array_t(prev_displays, ", ") );
+   for (int ndx = 0; ndx < prev_displays->len; ndx++)
+      record_connector_edid(g_ptr_array_index(prev_displays, ndx));
 
-   while (true) {
-
-      // Doesn't work to kill thread, udev_monitor_receive_device() is blocking
-      // leave in so that code checkers are fooled into thinking that
-      // free_watch_displays_data() is called at program termination
-      if (terminate_watch_thread) {
-         DBGTRC_DONE(true, TRACE_GROUP, "Terminating thread");
-         free_watch_displays_data(wdd);
-         g_ptr_array_free(prev_displays, true);
-         g_thread_exit(0);
-         assert(false);    // avoid clang warning re wdd use after free
-      }
-
-      // Doesn't work to detect client crash, main thread and process remains for some time.
-      // 11/2020: is this even needed since terminate_watch_thread check added?
-#ifdef DOESNT_WORK
-      bool pid_found = check_thread_or_process(cur_pid);
-      if (!pid_found) {
-         DBGMSG("Process %d not found", cur_pid);
-      }
-      bool tid_found = check_thread_or_process(cur_tid);
-      if (!pid_found || !tid_found) {
-         DBGMSG("Thread %d not found", cur_tid);
-         g_thread_exit(GINT_TO_POINTER(-1));
+   struct pollfd pfds[2] = {
+         {.fd = fd,                  .events = POLLIN},
+         {.fd = watch_wakeup_fds[0], .events = POLLIN},
+   };
+   while (!terminate_watch_thread) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Blocking until there is data");
+      int rc = poll(pfds, 2, -1);
+      if (rc < 0) {
+         int errsv = errno;
+         if (errsv == EINTR)
+            continue;
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "poll() failed. errno=%s. Terminating thread.",
+                                             linux_errno_name(errsv));
          break;
       }
-#endif
-
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Blocking until there is data");
-      // by default, is non-blocking as of libudev 171, use fcntl() to make file descriptor blocking
-      struct udev_device* dev = udev_monitor_receive_device(mon);
-      if (dev) {
-         if (debug) {
-            printf("Got Device\n");
-            // printf("   Node: %s\n", udev_device_get_devnode(dev));         // /dev/dri/card0
-            // printf("   Subsystem: %s\n", udev_device_get_subsystem(dev));  // drm
-            // printf("   Devtype: %s\n", udev_device_get_devtype(dev));      // drm_minor
-
-            printf("   Action:    %s\n", udev_device_get_action(   dev));     // "change"
-            printf("   devpath:   %s\n", udev_device_get_devpath(  dev));
-            printf("   subsystem: %s\n", udev_device_get_subsystem(dev));     // drm
-            printf("   devtype:   %s\n", udev_device_get_devtype(  dev));     // drm_minor
-            printf("   syspath:   %s\n", udev_device_get_syspath(  dev));
-            printf("   sysname:   %s\n", udev_device_get_sysname(  dev));
-            printf("   sysnum:    %s\n", udev_device_get_sysnum(   dev));
-            printf("   devnode:   %s\n", udev_device_get_devnode(  dev));     // /dev/dri/card0
-            printf("   initialized: %d\n", udev_device_get_is_initialized(  dev));
-            printf("   driver:    %s\n", udev_device_get_driver(  dev));
-
-            struct udev_list_entry * entries = NULL;
-            entries = udev_device_get_devlinks_list_entry(dev);
-            show_udev_list_entries(entries, "devlinks");
-
-            entries = udev_device_get_properties_list_entry(dev);
-            show_udev_list_entries(entries, "properties");
-
-            entries = udev_device_get_tags_list_entry(dev);
-            show_udev_list_entries(entries, "tags");
-
-            entries = udev_device_get_sysattr_list_entry(dev);
-            //show_udev_list_entries(entries, "sysattrs");
-            show_sysattr_list_entries(dev,entries);
+      if (pfds[1].revents)
+         break;       // woken by ddc_stop_watch_displays()
+      if (!(pfds[0].revents & POLLIN))
+         continue;
+
+      GPtrArray * cur_displays = gaux_ptr_array_copy(prev_displays, (GAuxDupFunc) g_strdup, g_free);
+      GPtrArray * edid_changed = g_ptr_array_new_with_free_func(g_free);
+      bool drm_event = false;
+#ifdef ENABLE_UDEV
+      if (!using_netlink) {
+         struct udev_device* dev = udev_monitor_receive_device(mon);
+         if (dev) {
+            if (debug) {
+               printf("Got Device\n");
+               printf("   Action:    %s\n", udev_device_get_action(   dev));     // "change"
+               printf("   devpath:   %s\n", udev_device_get_devpath(  dev));
+               printf("   sysname:   %s\n", udev_device_get_sysname(  dev));
+               show_udev_list_entries(udev_device_get_properties_list_entry(dev), "properties");
+            }
+            update_displays_for_drm_event(
+                  cur_displays,
+                  udev_device_get_sysname(dev),
+                  udev_device_get_property_value(dev, "CONNECTOR"),
+                  edid_changed);
+            drm_event = true;
+            udev_device_unref(dev);
          }
-
-         const char * hotplug = udev_device_get_property_value(dev, "HOTPLUG");
-         DBGTRC_NOPREFIX(debug, TRACE_GROUP,"HOTPLUG: %s", hotplug);     // "1"
-
-         prev_displays = check_displays(prev_displays, data);
-
-         udev_device_unref(dev);
-      }
-      else {
-         // Failure indicates main thread has died.  Kill this one too.
-         int errsv=errno;
-         DBGTRC_DONE(debug, TRACE_GROUP,
-                            "No Device from udev_monitor_receive_device()."
-                            " An error occurred. errno=%d=%s. Terminating thread.",
-                            errsv, linux_errno_name(errsv));
-         g_thread_exit(GINT_TO_POINTER(-1));
-         // break;
       }
+      else
+#endif
+      drm_event = receive_uevent(fd, cur_displays, edid_changed);
 
-      // printf(".");
-      // fflush(stdout);
-   }  // while
+      if (drm_event)
+         prev_displays = report_display_changes(prev_displays, cur_displays, edid_changed, wdd);
+      else
+         g_ptr_array_free(cur_displays, true);
+      g_ptr_array_free(edid_changed, true);
+   }
 
-    return NULL;
-}
+   g_ptr_array_free(prev_displays, true);
+   if (connector_edids) {
+      g_hash_table_destroy(connector_edids);
+      connector_edids = NULL;
+   }
+#ifdef ENABLE_UDEV
+   if (mon)
+      udev_monitor_unref(mon);
+   if (udev)
+      udev_unref(udev);
 #endif
+   if (using_netlink)
+      close(fd);
+   DBGTRC_DONE(debug, TRACE_GROUP, "Terminating thread");
+   free_watch_displays_data(wdd);
+   return NULL;
+}
+
 
 
 void dummy_display_change_handler(
@@ -524,6 +810,192 @@ void dummy_display_change_handler(
 }
 
 
+//
+// Display status events
+//
+
+/** Registers a function to be called for display hotplug events.
+ *
+ *  \param  func  function to register
+ *  \retval DDCRC_OK
+ *  \retval DDCRC_INVALID_OPERATION  watch thread not running
+ */
+DDCA_Status
+ddc_register_display_status_callback(DDCA_Display_Status_Callback_Func func) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "func=%p", func);
+   DDCA_Status ddcrc = DDCRC_OK;
+
+   ddc_ensure_watch_displays_started();
+   g_mutex_lock(&watch_thread_mutex);
+   bool watching = watch_thread;
+   g_mutex_unlock(&watch_thread_mutex);
+   if (!watching) {
+      ddcrc = DDCRC_INVALID_OPERATION;
+   }
+   else {
+      g_mutex_lock(&display_status_callbacks_mutex);
+      if (!display_status_callbacks)
+         display_status_callbacks = g_ptr_array_new();
+      if (!gaux_ptr_array_find_with_equal_func(display_status_callbacks, func, g_direct_equal, NULL))
+         g_ptr_array_add(display_status_callbacks, func);
+      g_mutex_unlock(&display_status_callbacks_mutex);
+   }
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+/** Unregisters a function registered by #ddc_register_display_status_callback().
+ *
+ *  \param  func  function to unregister
+ *  \retval DDCRC_OK
+ *  \retval DDCRC_INVALID_OPERATION  function not registered
+ */
+DDCA_Status
+ddc_unregister_display_status_callback(DDCA_Display_Status_Callback_Func func) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "func=%p", func);
+
+   g_mutex_lock(&display_status_callbacks_mutex);
+   bool found = display_status_callbacks && g_ptr_array_remove(display_status_callbacks, func);
+   g_mutex_unlock(&display_status_callbacks_mutex);
+   DDCA_Status ddcrc = (found) ? DDCRC_OK : DDCRC_INVALID_OPERATION;
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, ddcrc, "");
+   return ddcrc;
+}
+
+
+static void
+emit_display_status_event(
+      DDCA_Display_Event_Type event_type,
+      Display_Ref *           dref,
+      DDCA_IO_Path            io_path)
+{
+   bool debug = false;
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "event_type=%d, dref=%s, io_path=%s",
+                   event_type, (dref) ? dref_repr_t(dref) : "NULL", dpath_repr_t(&io_path));
+   DDCA_Display_Status_Event event = {.event_type = event_type, .dref = dref, .io_path = io_path};
+
+   // copy, so that a callback can unregister itself
+   g_mutex_lock(&display_status_callbacks_mutex);
+   GPtrArray * callbacks = (display_status_callbacks)
+         ? gaux_ptr_array_copy(display_status_callbacks, NULL, NULL)
+         : g_ptr_array_new();
+   g_mutex_unlock(&display_status_callbacks_mutex);
+   for (int ndx = 0; ndx < callbacks->len; ndx++) {
+      DDCA_Display_Status_Callback_Func func = g_ptr_array_index(callbacks, ndx);
+      func(event);
+   }
+   g_ptr_array_free(callbacks, true);
+}
+
+
+/** A detected display, as it was before redetection */
+typedef struct {
+   Display_Ref * dref;        // not dereferenced after redetection
+   DDCA_IO_Path  io_path;
+   Byte          edid[128];
+   bool          has_edid;
+} Display_Snapshot;
+
+
+static inline bool
+has_same_edid(Display_Snapshot * snapshot, Display_Ref * dref) {
+   if (!dref->pedid)
+      return !snapshot->has_edid;
+   return snapshot->has_edid && memcmp(snapshot->edid, dref->pedid->bytes, 128) == 0;
+}
+
+
+/** Display change handler that redetects displays and reports a
+ *  #DDCA_Display_Status_Event for each affected display.
+ *
+ *  \param  change_type   type of change
+ *  \param  removed       names of removed DRM connectors
+ *  \param  added         names of added DRM connectors
+ */
+void
+ddc_display_status_change_handler(
+      Displays_Change_Type change_type,
+      GPtrArray *          removed,
+      GPtrArray *          added)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "change_type=%s", displays_change_type_name(change_type));
+   dummy_display_change_handler(change_type, removed, added);
+
+   if (!ddc_displays_already_detected()) {
+      // the client has not yet detected displays, so there is nothing to update
+      DBGTRC_DONE(debug, TRACE_GROUP, "Displays not yet detected");
+      return;
+   }
+
+   GPtrArray * prev = ddc_get_displays_snapshot();
+   int prev_ct = prev->len;
+   Display_Snapshot * snapshots = calloc(prev_ct+1, sizeof(Display_Snapshot));
+   for (int ndx = 0; ndx < prev_ct; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(prev, ndx);
+      snapshots[ndx].dref    = dref;
+      snapshots[ndx].io_path = dref->io_path;
+      if (dref->pedid) {
+         memcpy(snapshots[ndx].edid, dref->pedid->bytes, 128);
+         snapshots[ndx].has_edid = true;
+      }
+   }
+   ddc_free_displays_snapshot(prev);
+
+   bool incremental = ddc_redetect_displays();
+   GPtrArray * cur = ddc_get_displays_snapshot();
+
+   // Display_Ref's that are new, and not yet reported
+   GPtrArray * unreported = g_ptr_array_new();
+   for (int ndx = 0; ndx < cur->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(cur, ndx);
+      bool existing = false;
+      // if not incremental, the old Display_Ref's were freed and their addresses may be reused
+      for (int sndx = 0; incremental && sndx < prev_ct && !existing; sndx++)
+         existing = (snapshots[sndx].dref == dref);
+      if (!existing)
+         g_ptr_array_add(unreported, dref);
+   }
+
+   for (int sndx = 0; sndx < prev_ct; sndx++) {
+      Display_Snapshot * snapshot = &snapshots[sndx];
+      if (incremental && gaux_ptr_array_find_with_equal_func(cur, snapshot->dref, g_direct_equal, NULL))
+         continue;          // unchanged
+
+      Display_Ref * replacement = NULL;
+      for (int ndx = 0; ndx < unreported->len && !replacement; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(unreported, ndx);
+         if (dpath_eq(dref->io_path, snapshot->io_path))
+            replacement = dref;
+      }
+      if (replacement && !has_same_edid(snapshot, replacement)) {
+         g_ptr_array_remove(unreported, replacement);
+         emit_display_status_event(DDCA_EVENT_DISPLAY_EDID_CHANGED, replacement, replacement->io_path);
+      }
+      else {
+         // a retired Display_Ref remains allocated until displays are discarded
+         emit_display_status_event(DDCA_EVENT_DISPLAY_DISCONNECTED,
+                                   (incremental) ? snapshot->dref : NULL, snapshot->io_path);
+      }
+   }
+
+   for (int ndx = 0; ndx < unreported->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(unreported, ndx);
+      emit_display_status_event(DDCA_EVENT_DISPLAY_CONNECTED, dref, dref->io_path);
+   }
+
+   g_ptr_array_free(unreported, true);
+   ddc_free_displays_snapshot(cur);
+   free(snapshots);
+   DBGTRC_DONE(debug, TRACE_GROUP, "incremental=%s", sbool(incremental));
+}
+
+
 /** Starts thread that watches for addition or removal of displays
  *
  *  \retval  DDCRC_OK
@@ -557,19 +1029,23 @@ ddc_start_watch_displays()
             terminate_watch_thread = false;
             Watch_Displays_Data * data = calloc(1, sizeof(Watch_Displays_Data));
             memcpy(data->marker, WATCH_DISPLAYS_DATA_MARKER, 4);
-            data->display_change_handler = dummy_display_change_handler;
+            data->display_change_handler = ddc_display_status_change_handler;
             data->main_process_id = getpid();
             // data->main_thread_id = syscall(SYS_gettid);
             data->main_thread_id = get_thread_id();
             data->drm_card_numbers = drm_card_numbers;
-            watch_thread = g_thread_new(
-                             "watch_displays",             // optional thread name
-      #if ENABLE_UDEV
-                             watch_displays_using_udev,
-      #else
-                             watch_displays_using_poll,
-      #endif
-                             data);
+            if (pipe(watch_wakeup_fds) < 0) {
+               int errsv = errno;
+               DBGTRC_NOPREFIX(debug, TRACE_GROUP, "pipe() failed. errno=%s", linux_errno_name(errsv));
+               free_watch_displays_data(data);
+               ddcrc = -errsv;
+            }
+            else {
+               watch_thread = g_thread_new(
+                                "watch_displays",             // optional thread name
+                                watch_displays_using_events,
+                                data);
+            }
          }
          g_mutex_unlock(&watch_thread_mutex);
       }
@@ -580,8 +1056,25 @@ ddc_start_watch_displays()
 }
 
 
-// only makes sense if polling!
-// locks udev_monitor_receive_device() blocks
+/** Requests that the thread that watches for addition or removal of
+ *  displays be started on first use, i.e. when displays are first
+ *  detected or a display status callback is registered, rather than now.
+ */
+void
+ddc_request_watch_displays() {
+   __atomic_store_n(&watch_displays_requested, true, __ATOMIC_RELEASE);
+}
+
+
+/** Starts the watch thread requested by #ddc_request_watch_displays(),
+ *  if it has not already been started.
+ */
+void
+ddc_ensure_watch_displays_started() {
+   if (__atomic_exchange_n(&watch_displays_requested, false, __ATOMIC_ACQ_REL))
+      ddc_start_watch_displays();
+}
+
 
 /** Halts thread that watches for addition or removal of displays.
  *
@@ -597,21 +1090,21 @@ ddc_stop_watch_displays()
    DBGTRC_STARTING(debug, TRACE_GROUP, "watch_displays_enabled=%s", SBOOL(watch_displays_enabled) );
    DDCA_Status ddcrc = DDCRC_OK;
 
+   // a thread requested but never started is no longer wanted
+   __atomic_store_n(&watch_displays_requested, false, __ATOMIC_RELEASE);
    if (watch_displays_enabled) {
       g_mutex_lock(&watch_thread_mutex);
 
-      // does not work if watch_displays_using_udev(), loop doesn't wake up unless there's a udev event
       if (watch_thread) {
          terminate_watch_thread = true;  // signal watch thread to terminate
-   #ifndef ENABLE_UDEV
-         // if using udev, thread never terminates because udev_monitor_receive_device() is blocking,
-         // so termiate flag doesn't get checked
-         // no big deal, ddc_stop_watch_displays() is only called at program termination to
-         // release resources for tidyness
-         g_thread_join(watch_thread);
-   #endif
-         g_thread_unref(watch_thread);
+         // wake the thread if it is blocked in poll()
+         ssize_t ct = write(watch_wakeup_fds[1], "x", 1);
+         DBGMSF(debug, "write() to wakeup pipe returned %zd", ct);
+         g_thread_join(watch_thread);  // releases the GThread reference
          watch_thread = NULL;
+         close(watch_wakeup_fds[0]);
+         close(watch_wakeup_fds[1]);
+         watch_wakeup_fds[0] = watch_wakeup_fds[1] = -1;
       }
       else
          ddcrc = DDCRC_INVALID_OPERATION;
@@ -625,12 +1118,13 @@ ddc_stop_watch_displays()
 
 
 void init_ddc_watch_displays() {
-   RTTI_ADD_FUNC(check_displays);
+   RTTI_ADD_FUNC(ddc_display_status_change_handler);
+   RTTI_ADD_FUNC(ddc_register_display_status_callback);
    RTTI_ADD_FUNC(ddc_start_watch_displays);
    RTTI_ADD_FUNC(ddc_stop_watch_displays);
    RTTI_ADD_FUNC(dummy_display_change_handler);
+   RTTI_ADD_FUNC(report_display_changes);
+   RTTI_ADD_FUNC(update_displays_for_drm_event);
+   RTTI_ADD_FUNC(watch_displays_using_events);
    RTTI_ADD_FUNC(watch_displays_using_poll);
-#ifdef ENABLE_UDEV
-   RTTI_ADD_FUNC(watch_displays_using_udev);
-#endif
 }
@@ -30,7 +30,17 @@ void dummy_display_change_handler(
         GPtrArray *          removed,
         GPtrArray *          added);
 
+void ddc_display_status_change_handler(
+        Displays_Change_Type change_type,
+        GPtrArray *          removed,
+        GPtrArray *          added);
+
+DDCA_Status ddc_register_display_status_callback(DDCA_Display_Status_Callback_Func func);
+DDCA_Status ddc_unregister_display_status_callback(DDCA_Display_Status_Callback_Func func);
+
 DDCA_Status ddc_start_watch_displays();
+void        ddc_request_watch_displays();
+void        ddc_ensure_watch_displays_started();
 DDCA_Status ddc_stop_watch_displays();
 void init_ddc_watch_displays();
 
@@ -9,6 +9,8 @@
 
 /** \cond */
 #include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "util/report_util.h"
@@ -24,11 +26,15 @@
 
 #include "dynvcp/dyn_feature_codes.h"
 #include "dynvcp/dyn_feature_files.h"
+#include "dynvcp/dyn_feature_set.h"
 
 
 // Trace class for this file
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_UDF;
 
+// Protects Display_Ref.dfm_cache
+static GMutex dfm_cache_mutex;
+
 /* Formats the name of a non-continuous feature whose value is returned in byte SL.
  *
  * Arguments:
@@ -63,6 +69,35 @@ bool dyn_format_feature_detail_sl_lookup(
 }
 
 
+/* Formats the name of a non-continuous feature whose value is returned in byte SL,
+ * using the index of dfm->sl_values, which is built on first use.
+ *
+ * dfm may be shared by threads using the same cached metadata, so if two
+ * threads build the index concurrently one of them discards its copy.
+ */
+static bool dyn_format_feature_detail_sl_index(
+        Nontable_Vcp_Value *       code_info,
+        Display_Feature_Metadata * dfm,
+        char *                     buffer,
+        int                        bufsz)
+{
+   SL_Value_Index * index = __atomic_load_n(&dfm->sl_value_index, __ATOMIC_ACQUIRE);
+   if (!index) {
+      SL_Value_Index * new_index = new_sl_value_index(dfm->sl_values);
+      if (__atomic_compare_exchange_n(&dfm->sl_value_index, &index, new_index,
+                                      false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+         index = new_index;
+      else
+         free(new_index);
+   }
+   char * s = index->names[code_info->sl];
+   if (!s)
+      s = "Unrecognized value";
+   snprintf(buffer, bufsz,"%s (sl=0x%02x)", s, code_info->sl);
+   return true;
+}
+
+
 /** Returns a #Display_Feature_Metadata record for a specified feature, first
  *  checking for a user supplied feature definition, and then from the internal
  *  feature definition tables.
@@ -297,6 +332,121 @@ dyn_get_feature_metadata_by_dh(
 }
 
 
+/** Returns the resolved #Display_Feature_Metadata record for a feature,
+ *  from a per-display cache that is filled on first use.
+ *
+ *  @param  feature_code   feature code
+ *  @param  dref           display reference
+ *  @param  vspec          VCP version of the display
+ *  @param  with_default   if the feature is not found, return a default record
+ *  @return borrowed pointer, NULL if not found and with_default == false
+ */
+static Display_Feature_Metadata *
+get_cached_feature_metadata(
+      DDCA_Vcp_Feature_Code  feature_code,
+      Display_Ref *          dref,
+      DDCA_MCCS_Version_Spec vspec,
+      bool                   with_default)
+{
+   g_mutex_lock(&dfm_cache_mutex);
+   if (dref->dfm_cache && !vcp_version_eq(dref->dfm_cache_vspec, vspec))
+      dref_free_dfm_cache(dref);
+   if (!dref->dfm_cache) {
+      dref->dfm_cache = calloc(256, sizeof(Display_Feature_Metadata*));
+      dref->dfm_cache_vspec = vspec;
+   }
+   Display_Feature_Metadata * result = dref->dfm_cache[feature_code];
+   if (!result) {
+      // always resolve with default, so that each code is resolved only once
+      result = dyn_get_feature_metadata_by_dfr_and_vspec_dfm(feature_code, dref->dfr, vspec, true);
+      result->display_ref = dref;
+      dref->dfm_cache[feature_code] = result;
+   }
+   g_mutex_unlock(&dfm_cache_mutex);
+
+   if (!with_default && (result->feature_flags & DDCA_SYNTHETIC))
+      result = NULL;
+   return result;
+}
+
+
+/** Returns a #Display_Feature_Metadata record for a specified feature, as
+ *  #dyn_get_feature_metadata_by_dref(), but from a per-display cache.
+ *
+ * @param  feature_code   feature code
+ * @param  dref           display reference
+ * @param  with_default   create default value if not found
+ * @return Display_Feature_Metadata for the feature, NULL if not found
+ *
+ * @remark
+ * The returned record is owned by the cache and must not be freed.  It
+ * remains valid until the VCP version or user supplied feature definitions
+ * of the display change, see #dyn_invalidate_cached_feature_metadata().
+ */
+Display_Feature_Metadata *
+dyn_get_cached_feature_metadata_by_dref(
+      DDCA_Vcp_Feature_Code feature_code,
+      Display_Ref *         dref,
+      bool                  with_default)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "feature_code=0x%02x, dref=%s, with_default=%s",
+                 feature_code, dref_repr_t(dref), sbool(with_default));
+
+   DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dref(dref);
+   Display_Feature_Metadata * result =
+         get_cached_feature_metadata(feature_code, dref, vspec, with_default);
+
+   DBGTRC_RET_STRUCT(debug, TRACE_GROUP, "Display_Feature_Metadata", dbgrpt_display_feature_metadata, result);
+   return result;
+}
+
+
+/** Returns a #Display_Feature_Metadata record for a specified feature, as
+ *  #dyn_get_feature_metadata_by_dh(), but from a per-display cache.
+ *
+ * @param  feature_code   feature code
+ * @param  dh             display handle
+ * @param  with_default   create default value if not found
+ * @return Display_Feature_Metadata for the feature, NULL if not found
+ *
+ * @remark
+ * The returned record is owned by the cache and must not be freed.
+ */
+Display_Feature_Metadata *
+dyn_get_cached_feature_metadata_by_dh(
+      DDCA_Vcp_Feature_Code feature_code,
+      Display_Handle *      dh,
+      bool                  with_default)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "feature_code=0x%02x, dh=%s, with_default=%s",
+                 feature_code, dh_repr(dh), sbool(with_default));
+
+   // ensure dh->dref->vcp_version set without incurring additional open/close
+   DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dh(dh);
+   Display_Feature_Metadata * result =
+         get_cached_feature_metadata(feature_code, dh->dref, vspec, with_default);
+
+   DBGTRC_RET_STRUCT(debug, TRACE_GROUP, "Display_Feature_Metadata", dbgrpt_display_feature_metadata, result);
+   return result;
+}
+
+
+/** Discards the cached feature metadata for a display, e.g. because its
+ *  user supplied feature definitions have changed.
+ *
+ *  @param  dref  display reference
+ */
+void
+dyn_invalidate_cached_feature_metadata(Display_Ref * dref) {
+   g_mutex_lock(&dfm_cache_mutex);
+   dref_free_dfm_cache(dref);
+   g_mutex_unlock(&dfm_cache_mutex);
+   dyn_invalidate_cached_feature_sets(dref);
+}
+
+
 // Functions that apply formatting
 
 bool
@@ -327,7 +477,10 @@ dyn_format_nontable_feature_detail(
       Format_Normal_Feature_Detail_Function2 ffd_func = dfm->nontable_formatter_sl;
       DBGTRC_NOPREFIX(debug, TRACE_GROUP,
             "Using SL lookup feature detail function: %s", rtti_get_func_name_by_addr(ffd_func) );
-      ok = ffd_func(code_info, dfm->sl_values, buffer, bufsz);
+      if (ffd_func == dyn_format_feature_detail_sl_lookup && dfm->sl_values)
+         ok = dyn_format_feature_detail_sl_index(code_info, dfm, buffer, bufsz);
+      else
+         ok = ffd_func(code_info, dfm->sl_values, buffer, bufsz);
    }
    else
       PROGRAM_LOGIC_ERROR("Neither nontable_formatter nor vcp_nontable_formatter set");
@@ -453,6 +606,8 @@ void init_dyn_feature_codes() {
    RTTI_ADD_FUNC(dyn_get_feature_metadata_by_mmk_and_vspec);
    RTTI_ADD_FUNC(dyn_get_feature_metadata_by_dref);
    RTTI_ADD_FUNC(dyn_get_feature_metadata_by_dh);
+   RTTI_ADD_FUNC(dyn_get_cached_feature_metadata_by_dref);
+   RTTI_ADD_FUNC(dyn_get_cached_feature_metadata_by_dh);
    RTTI_ADD_FUNC(dyn_format_feature_detail);
    RTTI_ADD_FUNC(dyn_format_feature_detail_sl_lookup);
    // dbgrpt_func_name_table(0);
@@ -37,6 +37,22 @@ dyn_get_feature_metadata_by_dh(
       Display_Handle *           dh,
       bool                       with_default);
 
+Display_Feature_Metadata *
+dyn_get_cached_feature_metadata_by_dref(
+      DDCA_Vcp_Feature_Code      id,
+      Display_Ref *              dref,
+      bool                       with_default);
+
+Display_Feature_Metadata *
+dyn_get_cached_feature_metadata_by_dh(
+      DDCA_Vcp_Feature_Code      id,
+      Display_Handle *           dh,
+      bool                       with_default);
+
+void
+dyn_invalidate_cached_feature_metadata(
+      Display_Ref *              dref);
+
 bool
 dyn_format_nontable_feature_detail(
       Display_Feature_Metadata * dfm,
@@ -13,6 +13,7 @@
 #include <stddef.h>
 #include <glib-2.0/glib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <wordexp.h>
 #include <unistd.h>
 
@@ -36,6 +37,7 @@
 #include "base/monitor_model_key.h"
 #include "base/rtti.h"
 
+#include "dyn_feature_codes.h"
 #include "dyn_feature_files.h"
 
 
@@ -169,6 +171,129 @@ get_feature_metadata(
 #endif
 
 
+//
+// Feature definition file index
+//
+// The ddcutil subdirectories of the XDG data path are listed once, instead
+// of checking each directory for the file of each monitor model.  The index
+// is rebuilt if the data path or the modification time of any of the
+// directories changes, which is checked at most once per
+// FEATURE_FILE_INDEX_RECHECK_MILLIS, so that the lookups for all displays
+// found by a detection share a single check.
+//
+
+#define FEATURE_FILE_INDEX_RECHECK_MILLIS 1000
+
+typedef struct {
+   char *          dirname;      // <XDG data directory>/ddcutil
+   bool            exists;
+   struct timespec mtime;
+} Feature_File_Dir;
+
+static GMutex       feature_file_index_mutex;    // protects the following
+static char *       feature_file_data_path = NULL;
+static GPtrArray *  feature_file_dirs      = NULL;  // Feature_File_Dir *, in search order
+static GHashTable * feature_file_index     = NULL;  // simple file name -> fully qualified name
+static gint64       feature_file_index_checked = 0; // monotonic time of last check, microseconds
+
+// Contents of feature definition files, keyed by fully qualified name
+typedef struct {
+   struct timespec mtime;
+   off_t           size;
+   GPtrArray *     lines;
+} Feature_File_Contents;
+
+static GHashTable * feature_file_contents  = NULL;  // fully qualified name -> Feature_File_Contents *
+
+
+static void free_feature_file_dir(gpointer data) {
+   Feature_File_Dir * ffd = data;
+   free(ffd->dirname);
+   free(ffd);
+}
+
+
+static void free_feature_file_contents(gpointer data) {
+   Feature_File_Contents * ffc = data;
+   g_ptr_array_free(ffc->lines, true);
+   free(ffc);
+}
+
+
+static void stat_feature_file_dir(Feature_File_Dir * ffd) {
+   struct stat statbuf;
+   ffd->exists = stat(ffd->dirname, &statbuf) == 0 && S_ISDIR(statbuf.st_mode);
+   if (ffd->exists)
+      ffd->mtime = statbuf.st_mtim;
+   else
+      memset(&ffd->mtime, 0, sizeof(ffd->mtime));
+}
+
+
+// Must be called with feature_file_index_mutex held
+static bool feature_file_index_is_current(const char * data_path) {
+   if (!feature_file_index || !streq(data_path, feature_file_data_path))
+      return false;
+   for (int ndx = 0; ndx < feature_file_dirs->len; ndx++) {
+      Feature_File_Dir * ffd = g_ptr_array_index(feature_file_dirs, ndx);
+      Feature_File_Dir cur = {.dirname = ffd->dirname};
+      stat_feature_file_dir(&cur);
+      if (cur.exists != ffd->exists ||
+          cur.mtime.tv_sec != ffd->mtime.tv_sec || cur.mtime.tv_nsec != ffd->mtime.tv_nsec)
+         return false;
+   }
+   return true;
+}
+
+
+// Must be called with feature_file_index_mutex held
+static void build_feature_file_index(char * data_path) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "data_path=%s", data_path);
+   if (feature_file_index) {
+      g_hash_table_destroy(feature_file_index);
+      g_ptr_array_free(feature_file_dirs, true);
+      free(feature_file_data_path);
+   }
+   feature_file_data_path = data_path;
+   feature_file_dirs  = g_ptr_array_new_with_free_func(free_feature_file_dir);
+   feature_file_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+   char ** dirs = g_strsplit(data_path, ":", -1);
+   for (int ndx = 0; dirs[ndx]; ndx++) {
+      if (strlen(dirs[ndx]) == 0)
+         continue;
+      Feature_File_Dir * ffd = calloc(1, sizeof(Feature_File_Dir));
+      int lastndx = strlen(dirs[ndx]) - 1;
+      if (dirs[ndx][lastndx] == '/')
+         dirs[ndx][lastndx] = '\0';
+      ffd->dirname = g_strdup_printf("%s/ddcutil", dirs[ndx]);
+      stat_feature_file_dir(ffd);
+      g_ptr_array_add(feature_file_dirs, ffd);
+      if (!ffd->exists)
+         continue;
+
+      GDir * gdir = g_dir_open(ffd->dirname, 0, NULL);
+      const char * simple_fn;
+      while ( gdir && (simple_fn = g_dir_read_name(gdir)) ) {
+         // the first directory on the path containing the file takes precedence
+         if (!g_str_has_suffix(simple_fn, ".mccs") || g_hash_table_contains(feature_file_index, simple_fn))
+            continue;
+         char * fqfn = g_strdup_printf("%s/%s", ffd->dirname, simple_fn);
+         if (regular_file_exists(fqfn))
+            g_hash_table_insert(feature_file_index, g_strdup(simple_fn), fqfn);
+         else
+            g_free(fqfn);
+      }
+      if (gdir)
+         g_dir_close(gdir);
+   }
+   g_strfreev(dirs);
+   DBGTRC_DONE(debug, TRACE_GROUP, "%d directories, %d feature definition files",
+                                   feature_file_dirs->len, g_hash_table_size(feature_file_index));
+}
+
+
 /** Look for feature definition file on the XDG_DATA_PATH
  *
  *  \param simple_fn  simple filename, without ".mccs" suffix
@@ -182,12 +307,72 @@ find_feature_def_file(
    DBGTRC_STARTING(debug, TRACE_GROUP, "simple_fn=|%s|", simple_fn);
    char buf[PATH_MAX];
    g_snprintf(buf, PATH_MAX, "%s.mccs", simple_fn);
-   char * result = find_xdg_data_file("ddcutil", buf);
+
+   g_mutex_lock(&feature_file_index_mutex);
+   gint64 now = g_get_monotonic_time();
+   if (!feature_file_index || now - feature_file_index_checked >= FEATURE_FILE_INDEX_RECHECK_MILLIS * 1000) {
+      char * data_path = xdg_data_path();
+      if (feature_file_index_is_current(data_path))
+         free(data_path);
+      else
+         build_feature_file_index(data_path);    // takes ownership of data_path
+      feature_file_index_checked = now;
+   }
+   char * result = g_strdup(g_hash_table_lookup(feature_file_index, buf));
+   g_mutex_unlock(&feature_file_index_mutex);
+
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", result);
    return result;
 }
 
 
+/** Reads the lines of a feature definition file, reusing the lines read
+ *  earlier if the file's modification time and size are unchanged.
+ *
+ *  \param  fqfn   fully qualified file name
+ *  \param  lines  where to append the lines
+ *  \return NULL if successful, #Error_Info if the file could not be read
+ */
+static Error_Info *
+get_feature_def_file_lines(const char * fqfn, GPtrArray * lines) {
+   struct stat statbuf;
+   if (stat(fqfn, &statbuf) < 0)
+      return file_getlines_errinfo(fqfn, lines);   // reports the error
+
+   Error_Info * errs = NULL;
+   g_mutex_lock(&feature_file_index_mutex);
+   if (!feature_file_contents)
+      feature_file_contents = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_feature_file_contents);
+   Feature_File_Contents * ffc = g_hash_table_lookup(feature_file_contents, fqfn);
+   if ( !ffc ||
+        ffc->size != statbuf.st_size ||
+        ffc->mtime.tv_sec  != statbuf.st_mtim.tv_sec ||
+        ffc->mtime.tv_nsec != statbuf.st_mtim.tv_nsec )
+   {
+      GPtrArray * new_lines = g_ptr_array_new_with_free_func(g_free);
+      errs = file_getlines_errinfo(fqfn, new_lines);
+      if (errs) {
+         g_ptr_array_free(new_lines, true);
+         g_hash_table_remove(feature_file_contents, fqfn);
+         ffc = NULL;
+      }
+      else {
+         ffc = calloc(1, sizeof(Feature_File_Contents));
+         ffc->mtime = statbuf.st_mtim;
+         ffc->size  = statbuf.st_size;
+         ffc->lines = new_lines;
+         g_hash_table_replace(feature_file_contents, g_strdup(fqfn), ffc);
+      }
+   }
+   if (ffc) {
+      for (int ndx = 0; ndx < ffc->lines->len; ndx++)
+         g_ptr_array_add(lines, g_strdup(g_ptr_array_index(ffc->lines, ndx)));
+   }
+   g_mutex_unlock(&feature_file_index_mutex);
+   return errs;
+}
+
+
 /** Search the file system for a feature definition file specified by
  *  a #DDCA_Monitor_Model_Key, and create a #Dynamic_Features_Rec for
  *  the result.
@@ -222,7 +407,7 @@ dfr_load_by_mmk(
    char * fqfn = find_feature_def_file(simple_fn);
    if (fqfn) {
       GPtrArray * lines = g_ptr_array_new_with_free_func(g_free);
-      errs = file_getlines_errinfo(fqfn, lines); // read file into lines
+      errs = get_feature_def_file_lines(fqfn, lines); // read file into lines
       // DDCA_Output_Level ol = get_output_level();
       // if (ol >= DDCA_OL_VERBOSE) {
       //    fprintf(fout(), "Using feature definition file: %s\n", fqfn);
@@ -324,6 +509,7 @@ dfr_check_by_dref(
  //     if (!errs) {
          dref->dfr = dfr;   // will be a dummy record if errors
  //     }
+      dyn_invalidate_cached_feature_metadata(dref);
 
       dref->flags |= DREF_DYNAMIC_FEATURES_CHECKED;
    }
@@ -373,4 +559,5 @@ void init_dyn_feature_files() {
    RTTI_ADD_FUNC(dfr_check_by_dref);
    RTTI_ADD_FUNC(dfr_load_by_mmk);
    RTTI_ADD_FUNC(find_feature_def_file);
+   RTTI_ADD_FUNC(build_feature_file_index);
 }
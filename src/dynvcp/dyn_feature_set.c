@@ -6,6 +6,7 @@
 
 #include <string.h>
 
+#include "util/alloc_stats.h"
 #include "util/debug_util.h"
 #include "util/report_util.h"
 
@@ -19,6 +20,9 @@
 
 static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_UDF;
 
+// Protects Display_Ref.feature_set_cache
+static GMutex feature_set_cache_mutex;
+
 void dbgrpt_dyn_feature_set(
       Dyn_Feature_Set * fset,
       bool              verbose,
@@ -146,18 +150,19 @@ dyn_create_feature_set0(
    DBGTRC_STARTING(debug, TRACE_GROUP, "subset_id=%d, number of members=%d",
                               subset_id, (members_dfm) ? members_dfm->len : -1);
 
-   Dyn_Feature_Set * fset = calloc(1,sizeof(Dyn_Feature_Set));
+   Dyn_Feature_Set * fset = counted_calloc(ALLOC_FEATURE_SET, sizeof(Dyn_Feature_Set));
    memcpy(fset->marker, DYN_FEATURE_SET_MARKER, 4);
    fset->subset = subset_id;
    fset->members_dfm = members_dfm;
+   fset->ref_ct = 1;
 
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning %p", fset);
    return fset;
 }
 
 
-Dyn_Feature_Set *
-dyn_create_feature_set(
+static Dyn_Feature_Set *
+dyn_create_uncached_feature_set(
       VCP_Feature_Subset     subset_id,
       DDCA_Display_Ref       display_ref,
       Feature_Set_Flags      feature_set_flags)
@@ -294,7 +299,7 @@ dyn_create_single_feature_set_by_hexid2(
    Display_Ref * dref = (Display_Ref *) display_ref;
    assert( dref && memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0);
 
-   Dyn_Feature_Set * result = calloc(1, sizeof(Dyn_Feature_Set));
+   Dyn_Feature_Set * result = counted_calloc(ALLOC_FEATURE_SET, sizeof(Dyn_Feature_Set));
    memcpy(result->marker, DYN_FEATURE_SET_MARKER, 4);
    result->dref = dref;
    result->subset = VCP_SUBSET_SINGLE_FEATURE;
@@ -401,16 +406,115 @@ free_dfm_func(gpointer data) {
 }
 
 
+/** Releases a reference to a feature set, freeing the set when no
+ *  references remain.
+ *
+ *  @param feature_set  feature set returned by #dyn_create_feature_set()
+ */
 void dyn_free_feature_set(
       Dyn_Feature_Set * feature_set)
 {
    bool debug = false;
    DBGMSF(debug, "Starting. feature_set=%s", dyn_feature_set_repr_t(feature_set));
-   if (feature_set->members_dfm) {
-      g_ptr_array_set_free_func(feature_set->members_dfm, free_dfm_func);
-      g_ptr_array_free(feature_set->members_dfm,true);
+   if (g_atomic_int_dec_and_test(&feature_set->ref_ct)) {
+      if (feature_set->members_dfm) {
+         g_ptr_array_set_free_func(feature_set->members_dfm, free_dfm_func);
+         g_ptr_array_free(feature_set->members_dfm,true);
+      }
+      counted_free(ALLOC_FEATURE_SET, feature_set, sizeof(Dyn_Feature_Set));
    }
-   free(feature_set);
    DBGMSF(debug, "Done");
 }
 
+
+// wrap dyn_free_feature_set() in signature of GDestroyNotify()
+static void
+free_feature_set_func(gpointer data) {
+   dyn_free_feature_set((Dyn_Feature_Set *) data);
+}
+
+
+/** Returns the feature set for a subset of features of a display.
+ *
+ *  Feature sets are cached per display, keyed by subset, flags and
+ *  VCP version, so that repeated requests for the same subset do not
+ *  again scan the VCP feature table and resolve the metadata of each
+ *  feature.
+ *
+ *  @param  subset_id          feature subset
+ *  @param  display_ref        display reference
+ *  @param  feature_set_flags  flags selecting the features of the subset
+ *  @return feature set
+ *
+ *  @remark
+ *  The returned set is shared and must not be modified.  Release it with
+ *  #dyn_free_feature_set().  It remains valid after the cache entry has been
+ *  discarded, e.g. because the VCP version or the user supplied feature
+ *  definitions of the display have changed.
+ */
+Dyn_Feature_Set *
+dyn_create_feature_set(
+      VCP_Feature_Subset     subset_id,
+      DDCA_Display_Ref       display_ref,
+      Feature_Set_Flags      feature_set_flags)
+{
+   bool debug = false;
+   Display_Ref * dref = (Display_Ref *) display_ref;
+   assert( dref && memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0);
+   // may perform DDC I/O, so not called with the cache locked
+   DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dref(dref);
+
+   Dyn_Feature_Set * result = NULL;
+   g_mutex_lock(&feature_set_cache_mutex);
+   for (int ndx = 0; dref->feature_set_cache && ndx < dref->feature_set_cache->len; ndx++) {
+      Dyn_Feature_Set * fset = g_ptr_array_index(dref->feature_set_cache, ndx);
+      if (fset->subset == subset_id && fset->flags == feature_set_flags &&
+          vcp_version_eq(fset->vspec, vspec))
+      {
+         g_atomic_int_inc(&fset->ref_ct);
+         result = fset;
+         break;
+      }
+   }
+   g_mutex_unlock(&feature_set_cache_mutex);
+
+   if (result) {
+      DBGMSF(debug, "Returning cached feature set %p", result);
+   }
+   else {
+      result = dyn_create_uncached_feature_set(subset_id, display_ref, feature_set_flags);
+      result->flags = feature_set_flags;
+      result->vspec = vspec;
+
+      g_mutex_lock(&feature_set_cache_mutex);
+      if (!dref->feature_set_cache)
+         dref->feature_set_cache = g_ptr_array_new_with_free_func(free_feature_set_func);
+      // sets for a prior VCP version will not be requested again
+      for (int ndx = dref->feature_set_cache->len-1; ndx >= 0; ndx--) {
+         Dyn_Feature_Set * fset = g_ptr_array_index(dref->feature_set_cache, ndx);
+         if (!vcp_version_eq(fset->vspec, vspec))
+            g_ptr_array_remove_index(dref->feature_set_cache, ndx);
+      }
+      g_atomic_int_inc(&result->ref_ct);
+      g_ptr_array_add(dref->feature_set_cache, result);
+      g_mutex_unlock(&feature_set_cache_mutex);
+   }
+   return result;
+}
+
+
+/** Discards the feature sets cached for a display, e.g. because its
+ *  user supplied feature definitions have changed.
+ *
+ *  @param  dref  display reference
+ */
+void
+dyn_invalidate_cached_feature_sets(Display_Ref * dref) {
+   g_mutex_lock(&feature_set_cache_mutex);
+   if (dref->feature_set_cache) {
+      g_ptr_array_free(dref->feature_set_cache, true);
+      dref->feature_set_cache = NULL;
+   }
+   g_mutex_unlock(&feature_set_cache_mutex);
+}
+
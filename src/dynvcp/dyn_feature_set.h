@@ -35,6 +35,9 @@ typedef struct {
    VCP_Feature_Subset   subset;      // subset identifier
    DDCA_Display_Ref     dref;
    GPtrArray *          members_dfm; // array of pointers to Display_Feature_Metadata - alt
+   Feature_Set_Flags    flags;       // flags the set was created with
+   DDCA_MCCS_Version_Spec vspec;     // VCP version the set was created for
+   gint                 ref_ct;      // references, including that of the display's cache
 } Dyn_Feature_Set;
 
 void
@@ -89,4 +92,7 @@ filter_feature_set(
 void dyn_free_feature_set(
       Dyn_Feature_Set *  feature_set);
 
+void dyn_invalidate_cached_feature_sets(
+      Display_Ref *      dref);
+
 #endif /* DYN_FEATURE_SET_H_ */
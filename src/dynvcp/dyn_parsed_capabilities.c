@@ -340,10 +340,11 @@ report_capabilities_feature(
    // if (vfr->values)
    //    report_id_array(vfr->values, "Feature values:");
    char * buf0 = NULL;
-   DBGMSF(debug, "vfr->values=%p", vfr->values);
-   if (vfr->values) {
+   Byte_Value_Array values = cfr_get_values(vfr);
+   DBGMSF(debug, "values=%p", values);
+   if (values) {
       if (vfr->feature_id == 0x72) { // special handling for feature x72 (gamma)
-         report_gamma_capabilities(vfr->values, d1);
+         report_gamma_capabilities(values, d1);
       }
       else {
          // Get the descriptions of the documented values for the feature
@@ -353,7 +354,7 @@ report_capabilities_feature(
          DBGMSF(debug, "Feature values %sfound for feature 0x%02x",
                        (feature_values) ? "" : "NOT ",
                        vfr->feature_id);
-         int ct = bva_length(vfr->values);
+         int ct = bva_length(values);
 
          if (feature_values) {  // did we find descriptions for the features?
             if (ol >= DDCA_OL_VERBOSE)
@@ -362,7 +363,7 @@ report_capabilities_feature(
                rpt_label(d1 , "Values:");
             int ndx = 0;
             for (; ndx < ct; ndx++) {
-               Byte hval = bva_get(vfr->values, ndx);
+               Byte hval = bva_get(values, ndx);
                char *  value_name = sl_value_table_lookup(feature_values, hval);
                if (!value_name)
                   value_name = "Unrecognized value";
@@ -377,7 +378,7 @@ report_capabilities_feature(
             char * pos = buf0;
             int ndx = 0;
             for (; ndx < ct; ndx++) {
-               Byte hval = bva_get(vfr->values, ndx);
+               Byte hval = bva_get(values, ndx);
                snprintf(pos, bufend-pos, "%02X ", hval);
                pos = pos+3;
             }
@@ -530,10 +531,12 @@ void dyn_report_parsed_capabilities(
    int d2 = depth+2;
    bool debug = false;
    assert(pcaps && memcmp(pcaps->marker, PARSED_CAPABILITIES_MARKER, 4) == 0);
+   Byte_Value_Array commands     = parsed_capabilities_commands(pcaps);
+   GPtrArray *      vcp_features = parsed_capabilities_vcp_features(pcaps);
    DBGMSF(debug, "Starting. dh-%s, dref=%s, pcaps->raw_cmds_segment_seen=%s, "
-                 "pcaps->commands=%p, pcaps->vcp_features=%p",
+                 "commands=%p, vcp_features=%p",
                  dh_repr(dh), dref_repr_t(dref), sbool(pcaps->raw_cmds_segment_seen),
-                 pcaps->commands, pcaps->vcp_features);
+                 commands, vcp_features);
 
    if (dh)
       dref = dh->dref;
@@ -567,8 +570,8 @@ void dyn_report_parsed_capabilities(
       rpt_vstring(d0, "MCCS version: Not specified");
    }
 
-   if (pcaps->commands)
-      report_commands(pcaps->commands, d0);
+   if (commands)
+      report_commands(commands, d0);
    else {
       // not an error in the case of USB_IO, as the capabilities string was
       // synthesized and does not include a commands segment
@@ -587,7 +590,7 @@ void dyn_report_parsed_capabilities(
          vspec = get_vcp_version_by_dref(dref);
    }
 
-   if (pcaps->vcp_features) {
+   if (vcp_features) {
 
 #ifdef X72_CAPABILITIES_TEST_CASES
       // for testing feature x72 gamma
@@ -595,28 +598,28 @@ void dyn_report_parsed_capabilities(
       Capabilities_Feature_Record * cfr = NULL;
 
       vstring = "05 78 FB 50 64 78 8C";
-       cfr = new_capabilities_feature(0x72, vstring, strlen(vstring));
-      g_ptr_array_add(pcaps->vcp_features, cfr);
+       cfr = new_capabilities_feature_record(0x72, vstring, strlen(vstring));
+      g_ptr_array_add(vcp_features, cfr);
       vstring = "02 96 fe 50 a0";
-       cfr = new_capabilities_feature(0x72, vstring, strlen(vstring));
-      g_ptr_array_add(pcaps->vcp_features, cfr);
+       cfr = new_capabilities_feature_record(0x72, vstring, strlen(vstring));
+      g_ptr_array_add(vcp_features, cfr);
       vstring = "00 78 ff";
-       cfr = new_capabilities_feature(0x72, vstring, strlen(vstring));
-      g_ptr_array_add(pcaps->vcp_features, cfr);
+       cfr = new_capabilities_feature_record(0x72, vstring, strlen(vstring));
+      g_ptr_array_add(vcp_features, cfr);
       // invalid example in spec, inserted 3rd byte FB
       vstring = "FF 00 FB 01 03 05 07 09 11 13 15 17 19";
-       cfr = new_capabilities_feature(0x72, vstring, strlen(vstring));
-      g_ptr_array_add(pcaps->vcp_features, cfr);
+       cfr = new_capabilities_feature_record(0x72, vstring, strlen(vstring));
+      g_ptr_array_add(vcp_features, cfr);
       // invalid example in spec, 3rd byte should be bd or fc
       vstring = "FF 01 FC 05 15";
-       cfr = new_capabilities_feature(0x72, vstring, strlen(vstring));
-      g_ptr_array_add(pcaps->vcp_features, cfr);
+       cfr = new_capabilities_feature_record(0x72, vstring, strlen(vstring));
+      g_ptr_array_add(vcp_features, cfr);
       vstring = "FF 01 FE";
-       cfr = new_capabilities_feature(0x72, vstring, strlen(vstring));
-      g_ptr_array_add(pcaps->vcp_features, cfr);
+       cfr = new_capabilities_feature_record(0x72, vstring, strlen(vstring));
+      g_ptr_array_add(vcp_features, cfr);
 #endif
 
-      report_features(pcaps->vcp_features, dref, vspec);
+      report_features(vcp_features, dref, vspec);
    }
    else {
       // handle pathological case of 0 length capabilities string, e.g. Samsung S32D850T
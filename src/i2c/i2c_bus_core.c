@@ -40,12 +40,15 @@
 
 #include "base/core.h"
 #include "base/ddc_errno.h"
+#include "base/executor.h"
 #include "base/last_io_event.h"
 #include "base/linux_errno.h"
 #include "base/parms.h"
 #include "base/rtti.h"
 #include "base/sleep.h"
+#include "base/stats_export.h"
 #include "base/status_code_mgt.h"
+#include "base/thread_sched.h"
 #include "base/tuned_sleep.h"
 #include "base/per_thread_data.h"
 
@@ -67,11 +70,25 @@ static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_I2C;
 /** All I2C buses.  GPtrArray of pointers to #I2C_Bus_Info - shared with i2c_bus_selector.c */
 /* static */ GPtrArray * i2c_buses = NULL;
 
+/** Buses that were probed and found to have no monitor.  Only their
+ *  numbers are retained, not their #I2C_Bus_Info. */
+static Bit_Set_256 nondisplay_buses;
+
 bool i2c_force_bus = false;
 
 static GMutex  open_failures_mutex;
 static Bit_Set_256 open_failures_reported;
 
+static int bus_check_async_threshold = BUS_CHECK_ASYNC_THRESHOLD_DEFAULT;
+
+static GMutex      bus_check_watch_mutex;      // protects the following and Bus_Check_Watch
+static GCond       bus_check_watch_cond;
+static int         bus_check_timeout_ct = 0;
+static Bit_Set_256 timed_out_buses;
+
+static GHashTable * probe_hints = NULL;   // "driver connector" -> I2C_Probe_Hint
+static bool         edid_only_probing = false;
+
 //
 // Local utility functions
 //
@@ -102,6 +119,7 @@ static char * interpret_i2c_bus_flags(uint16_t flags) {
    ADD_NAME(I2C_BUS_HAS_VALID_NAME     );
    ADD_NAME(I2C_BUS_BUSY               );
    ADD_NAME(I2C_BUS_SYSFS_EDID         );
+   ADD_NAME(I2C_BUS_TIMED_OUT          );
 
 #undef ADD_NAME
 
@@ -152,6 +170,69 @@ void include_open_failures_reported(int busno) {
 }
 
 
+//
+// Kernel retries
+//
+// For adapters that report I2C_FUNC_I2C, i2c_transfer() in the kernel retries
+// a transfer that fails with EAGAIN, e.g. because arbitration was lost, up to
+// the adapter's retry count.  That takes microseconds, instead of the sleep and
+// error handling of a userspace retry.  The count is set using ioctl I2C_RETRIES,
+// which applies to the adapter, not just the file descriptor, so it is set once
+// per bus.
+//
+
+static int         i2c_kernel_retries = DEFAULT_I2C_KERNEL_RETRIES;
+static Bit_Set_256 kernel_retry_buses;          // buses for which I2C_RETRIES was set
+static GMutex      kernel_retry_mutex;
+
+
+/** Sets the number of retries to be performed by the kernel for transfers
+ *  that fail with EAGAIN.  Applies to buses opened subsequently.
+ *
+ *  @param  ct  retry count, 0 to leave the adapter setting unchanged
+ */
+void i2c_set_kernel_retries(int ct) {
+   i2c_kernel_retries = ct;
+}
+
+
+/** Reports whether the kernel retries transfers on a bus, as set by
+ *  #i2c_set_kernel_retries().
+ *
+ *  @param  busno  bus number
+ *  @return true/false
+ */
+bool i2c_kernel_retries_active(int busno) {
+   g_mutex_lock(&kernel_retry_mutex);
+   bool result = bs256_contains(kernel_retry_buses, busno);
+   g_mutex_unlock(&kernel_retry_mutex);
+   return result;
+}
+
+
+static void
+set_kernel_retries(int fd, int busno) {
+   bool debug = false;
+   g_mutex_lock(&kernel_retry_mutex);
+   if (!bs256_contains(kernel_retry_buses, busno)) {
+      unsigned long functionality = i2c_get_functionality_flags_by_fd(fd);
+      if (!(functionality & I2C_FUNC_I2C)) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "bus %d does not support I2C_FUNC_I2C", busno);
+      }
+      else if (ioctl(fd, I2C_RETRIES, (unsigned long) i2c_kernel_retries) < 0) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "ioctl(I2C_RETRIES) failed for bus %d: %s",
+                                             busno, strerror(errno));
+      }
+      else {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Set kernel retries = %d for bus %d",
+                                             i2c_kernel_retries, busno);
+         kernel_retry_buses = bs256_insert(kernel_retry_buses, busno);
+      }
+   }
+   g_mutex_unlock(&kernel_retry_mutex);
+}
+
+
 //
 // Basic I2C bus operations
 //
@@ -171,10 +252,10 @@ int i2c_open_bus(int busno, Byte callopts) {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d, callopts=0x%02x", busno, callopts);
 
-   char filename[20];
+   char filename[PATH_MAX];
    int  fd;             // Linux file descriptor
 
-   snprintf(filename, 19, "/dev/"I2C"-%d", busno);
+   g_snprintf(filename, PATH_MAX, "%s/dev/"I2C"-%d", fs_root_prefix(), busno);
    RECORD_IO_EVENT(
          IE_OPEN,
          ( fd = open(filename, (callopts & CALLOPT_RDONLY) ? O_RDONLY : O_RDWR) )
@@ -192,6 +273,8 @@ int i2c_open_bus(int busno, Byte callopts) {
    else {
       RECORD_IO_FINISH_NOW(fd, IE_OPEN);
       ptd_append_thread_description(filename);
+      if (i2c_kernel_retries > 0 && !(callopts & CALLOPT_RDONLY))
+         set_kernel_retries(fd, busno);
    }
 
    DBGTRC_DONE(debug, TRACE_GROUP, "busno=%d, Returning file descriptor: %d", busno, fd);
@@ -219,6 +302,7 @@ Status_Errno i2c_close_bus(int fd, Call_Options callopts) {
    RECORD_IO_EVENTX(fd, IE_CLOSE, ( rc = close(fd) ) );
    assert( rc == 0 || rc == -1);   // per documentation
    int errsv = errno;
+   free_io_event_timestamp(fd);    // the descriptor number can be reused for another bus
    if (rc < 0) {
       // EBADF (9)  fd isn't a valid open file descriptor
       // EINTR (4)  close() interrupted by a signal
@@ -282,12 +366,77 @@ static bool is_laptop_drm_connector(int busno, char * drm_name_fragment) {
 // I2C Bus Inspection - EDID Retrieval
 //
 
+/** Reads the extension blocks announced in the base EDID block, as many
+ *  as fit in the buffer.
+ *
+ *  The blocks are read in a single I2C_RDWR transfer, with SMBus block
+ *  reads as a fallback.
+ *
+ *  @param  fd       file descriptor for open /dev/i2c-n, slave address x50
+ *  @param  rawedid  buffer containing the valid 128 byte base block
+ *  @return number of extension bytes read
+ */
+static int
+i2c_read_edid_extensions(int fd, Buffer * rawedid) {
+   bool debug = false;
+   int extension_ct = rawedid->bytes[126];
+   int max_extension_ct = (rawedid->buffer_size - 128) / 128;
+   if (extension_ct > max_extension_ct)
+      extension_ct = max_extension_ct;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d, extension count=%d, reading %d",
+                                       fd, rawedid->bytes[126], extension_ct);
+
+   int bytect = extension_ct * 128;
+   if (bytect > 0) {
+      Byte offset = 128;
+      int rc = i2c_ioctl_write_reader(fd, 0x50, 1, &offset, bytect, rawedid->bytes+128);
+      DBGMSF(debug, "i2c_ioctl_write_reader() returned %s", psc_desc(rc));
+      if (rc != 0) {
+         rc = ioctl(fd, I2C_SLAVE_FORCE, 0x50);
+         for (int ndx = 128; ndx < 128+bytect && rc == 0; ndx += I2C_SMBUS_BLOCK_MAX) {
+            union i2c_smbus_data data = {
+               .block = { I2C_SMBUS_BLOCK_MAX },
+            };
+            struct i2c_smbus_ioctl_data args = {
+               .read_write = I2C_SMBUS_READ,
+               .command = ndx,
+               .size = I2C_SMBUS_I2C_BLOCK_DATA,
+               .data = &data,
+            };
+            rc = ioctl(fd, I2C_SMBUS, &args);
+            if (data.block[0] != I2C_SMBUS_BLOCK_MAX)
+               rc = -1;
+            else if (rc == 0)
+               memcpy(&rawedid->bytes[ndx], &data.block[1], I2C_SMBUS_BLOCK_MAX);
+         }
+      }
+      if (rc != 0)
+         bytect = 0;     // the base block is still usable
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %d", bytect);
+   return bytect;
+}
+
+
+/** Reads EDID bytes from an open I2C device.
+ *
+ *  @param  fd               file descriptor for open /dev/i2c-n
+ *  @param  rawedid          buffer in which to return the bytes
+ *  @param  edid_read_size   number of bytes to read
+ *  @param  read_bytewise    read one byte at a time
+ *  @param  read_extensions  if **edid_read_size** is 128 and a valid base
+ *                           block was read, also read the extension blocks
+ *                           it announces
+ *  @return status code
+ */
 static Status_Errno_DDC
 i2c_get_edid_bytes_using_i2c_layer(
       int     fd,
       Buffer* rawedid,
       int     edid_read_size,
-      bool    read_bytewise)
+      bool    read_bytewise,
+      bool    read_extensions)
 {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d, filename=%s, rawedid=%p, edid_read_size=%d, read_bytewise=%s",
@@ -341,6 +490,11 @@ i2c_get_edid_bytes_using_i2c_layer(
       }
       if (rc == 0) {
          rawedid->len = edid_read_size;
+         if (read_extensions && !read_bytewise && edid_read_size == 128 &&
+             is_valid_raw_edid(rawedid->bytes, 128))
+         {
+            rawedid->len += i2c_read_edid_extensions(fd, rawedid);
+         }
       }
    }  // write succeeded
    if ( (debug || IS_TRACING()) && rc == 0) {
@@ -382,7 +536,9 @@ i2c_get_raw_edid_by_fd(int fd, Buffer * rawedid)
                     "Trying EDID read. tryctr=%d, max_tries=%d,"
                     " edid_read_size=%d, read_bytewise=%s",
                     tryctr, max_tries, edid_read_size, sbool(read_bytewise) );
-      rc = i2c_get_edid_bytes_using_i2c_layer(fd, rawedid, edid_read_size, read_bytewise);
+      // In dynamic mode, read only the extension blocks the monitor has
+      rc = i2c_get_edid_bytes_using_i2c_layer(fd, rawedid, edid_read_size, read_bytewise,
+                                              EDID_Read_Size == 0);
       if (rc == -ENXIO || rc == -EOPNOTSUPP || rc == -ETIMEDOUT) {    // removed -EIO 3/4/2021
          // DBGMSG("breaking");
          break;
@@ -444,7 +600,7 @@ i2c_get_parsed_edid_by_fd(int fd, Parsed_Edid ** edid_ptr_loc)
 
    Status_Errno_DDC rc = i2c_get_raw_edid_by_fd(fd, rawedidbuf);
    if (rc == 0) {
-      edid = create_parsed_edid2(rawedidbuf->bytes, "I2C");
+      edid = create_interned_parsed_edid(rawedidbuf->bytes, "I2C");
       if (debug) {
          if (edid)
             report_parsed_edid(edid, false /* verbose */, 0);
@@ -477,7 +633,7 @@ i2c_get_parsed_edid_by_fd(int fd, Parsed_Edid ** edid_ptr_loc)
  * @param busno I2C bus number
  * @return newly allocated #I2C_Bus_Info
  */
-static I2C_Bus_Info * i2c_new_bus_info(int busno) {
+I2C_Bus_Info * i2c_new_bus_info(int busno) {
    I2C_Bus_Info * businfo = calloc(1, sizeof(I2C_Bus_Info));
    memcpy(businfo->marker, I2C_BUS_INFO_MARKER, 4);
    businfo->busno = busno;
@@ -485,8 +641,35 @@ static I2C_Bus_Info * i2c_new_bus_info(int busno) {
 }
 
 
+/** Checks whether a slave responds at address x37 using an SMBus Quick
+ *  Command, which transfers no data bytes.
+ *
+ *  @param  fd   file descriptor for open /dev/i2c-n
+ *  @retval 0    slave acknowledged its address
+ *  @retval <0   negative Linux errno value
+ */
+static Status_Errno_DDC
+i2c_quick_detect_x37(int fd) {
+   bool debug = false;
+   int rc = ioctl(fd, I2C_SLAVE_FORCE, 0x37);
+   if (rc == 0) {
+      struct i2c_smbus_ioctl_data args = {
+         .read_write = I2C_SMBUS_WRITE,
+         .command = 0,
+         .size = I2C_SMBUS_QUICK,
+         .data = NULL,
+      };
+      RECORD_IO_EVENTX(fd, IE_WRITE, ( rc = ioctl(fd, I2C_SMBUS, &args) ) );
+   }
+   if (rc < 0)
+      rc = -errno;
+   DBGMSF(debug, "fd=%d, returning %s", fd, psc_name_code(rc));
+   return rc;
+}
+
+
 static Status_Errno_DDC
-i2c_detect_x37(int fd) {
+i2c_detect_x37(int fd, unsigned long functionality) {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d - %s", fd, filename_for_fd_t(fd) );
 
@@ -496,6 +679,17 @@ i2c_detect_x37(int fd) {
    // - Dell P2715Q does not respond to single byte read, but does respond to
    //   a write (7/2018), so this function checks both
    Status_Errno_DDC rc = 0;
+
+   // An acknowledged quick command is sufficient.  If it fails, the slave may
+   // still respond to a real transfer, so fall through to the full check.
+   if (functionality & I2C_FUNC_SMBUS_QUICK) {
+      rc = i2c_quick_detect_x37(fd);
+      if (rc == 0) {
+         DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "SMBus quick command acknowledged");
+         return rc;
+      }
+   }
+
    // regard either a successful write() or a read() as indication slave address is valid
    Byte    writebuf = {0x00};
 
@@ -514,6 +708,166 @@ i2c_detect_x37(int fd) {
 }
 
 
+/** Gets the EDID for a bus from the DRM connector whose DDC channel is the bus.
+ *
+ *  The kernel has already read the EDID when a monitor is connected, and
+ *  exposes it as /sys/class/drm/card<n>-<connector>/edid.  Using it avoids reading
+ *  128 or 256 bytes over the wire.
+ *
+ *  @param  busno  I2C bus number
+ *  @return newly allocated #Parsed_Edid, NULL if no connector maps to the bus
+ *          or the connector does not have a valid EDID
+ */
+static Parsed_Edid *
+i2c_get_parsed_edid_from_sysfs(int busno) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d", busno);
+
+   Parsed_Edid * edid = NULL;
+   Sys_Drm_Connector * connector = find_sys_drm_connector_by_busno(busno);
+   if (connector && connector->edid_size >= 128 &&
+       is_valid_raw_edid(connector->edid_bytes, connector->edid_size))
+   {
+      edid = create_interned_parsed_edid(connector->edid_bytes, "SYSFS");
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "connector=%s, returning %p",
+                                   (connector) ? connector->connector_name : "NULL", edid);
+   return edid;
+}
+
+
+//
+// Probe hints
+//
+
+static void free_probe_hint(gpointer data) {
+   I2C_Probe_Hint * hint = data;
+   free(hint->edid_bytes);
+   free(hint);
+}
+
+
+/** Creates an empty table of probe hints, for #i2c_add_probe_hint() */
+GHashTable * i2c_new_probe_hints() {
+   return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_probe_hint);
+}
+
+
+/** Records the result of probing a bus in an earlier execution.
+ *
+ *  @param  hints           table created by #i2c_new_probe_hints()
+ *  @param  driver          video driver for the bus
+ *  @param  connector_name  DRM connector using the bus
+ *  @param  flags           I2C_BUS_* flags found when the bus was probed
+ *  @param  edid_bytes      128 byte EDID found, NULL if none
+ */
+void i2c_add_probe_hint(
+      GHashTable * hints,
+      const char * driver,
+      const char * connector_name,
+      uint16_t     flags,
+      Byte *       edid_bytes)
+{
+   I2C_Probe_Hint * hint = calloc(1, sizeof(I2C_Probe_Hint));
+   hint->flags = flags;
+   if (edid_bytes) {
+      hint->edid_bytes = malloc(128);
+      memcpy(hint->edid_bytes, edid_bytes, 128);
+   }
+   g_hash_table_replace(hints, g_strdup_printf("%s %s", driver, connector_name), hint);
+}
+
+
+/** Sets the results of earlier probes to be used by #i2c_check_bus().
+ *
+ *  A hint is used only if the DRM connector of the bus still shows the
+ *  same monitor (or no monitor) as when the hint was recorded.  Then the
+ *  EDID is taken from sysfs and the x37 slave address is not probed, and
+ *  a bus whose connector had and has no monitor is not probed at all.
+ *
+ *  @param  hints  table created by #i2c_new_probe_hints(), ownership is
+ *                 transferred, NULL to discard the current hints
+ */
+void i2c_set_probe_hints(GHashTable * hints) {
+   if (probe_hints)
+      g_hash_table_destroy(probe_hints);
+   probe_hints = hints;
+}
+
+
+/** Finds the probe hint for a bus, if it is still valid.
+ *
+ *  @param  bus_info   bus being probed, driver already set
+ *  @param  connector_loc  where to return the DRM connector for the bus
+ *  @return hint, NULL if none or the connector changed
+ */
+static I2C_Probe_Hint *
+find_valid_probe_hint(I2C_Bus_Info * bus_info, Sys_Drm_Connector ** connector_loc) {
+   bool debug = false;
+   *connector_loc = NULL;
+   if (!probe_hints || !bus_info->driver)
+      return NULL;
+   Sys_Drm_Connector * connector = find_sys_drm_connector_by_busno(bus_info->busno);
+   if (!connector)
+      return NULL;
+   char * key = g_strdup_printf("%s %s", bus_info->driver, connector->connector_name);
+   I2C_Probe_Hint * hint = g_hash_table_lookup(probe_hints, key);
+   g_free(key);
+   if (hint) {
+      bool has_edid = connector->status && streq(connector->status, "connected") &&
+                      connector->edid_size >= 128;
+      if ( has_edid != (hint->edid_bytes != NULL) ||
+           (has_edid && memcmp(hint->edid_bytes, connector->edid_bytes, 128) != 0) ||
+           (hint->flags & I2C_BUS_BUSY) )
+      {
+         DBGMSF(debug, "busno=%d, connector %s changed", bus_info->busno, connector->connector_name);
+         hint = NULL;
+      }
+   }
+   *connector_loc = connector;
+   DBGMSF(debug, "busno=%d, returning %p", bus_info->busno, hint);
+   return hint;
+}
+
+
+/** Controls whether probing a bus only gets its EDID.
+ *
+ *  When set, a bus whose DRM connector exposes a valid EDID is not opened,
+ *  and no bus is probed for slave address x37.  The EDID of a bus without
+ *  a DRM connector is still read over I2C.
+ *
+ *  @param  onoff  true to only get EDIDs, false for full probing
+ */
+void i2c_enable_edid_only_probing(bool onoff) {
+   edid_only_probing = onoff;
+}
+
+
+/** Probes a bus for EDID-only detection, taking the EDID from sysfs
+ *  without opening the bus.
+ *
+ *  If the DRM connector for the bus does not have a valid EDID, the bus is
+ *  left unprobed.
+ *
+ *  @param  bus_info  bus information
+ */
+static void
+i2c_check_bus_edid_only(I2C_Bus_Info * bus_info) {
+   bool debug = false;
+   bus_info->edid = i2c_get_parsed_edid_from_sysfs(bus_info->busno);
+   if (bus_info->edid) {
+      bus_info->flags |= I2C_BUS_PROBED | I2C_BUS_ADDR_0X50 | I2C_BUS_SYSFS_EDID;
+      bus_info->driver = get_driver_for_busno(bus_info->busno);
+      if ( IS_EDP_DEVICE(bus_info->busno) )
+         bus_info->flags |= I2C_BUS_EDP;
+      else if ( IS_LVDS_DEVICE(bus_info->busno) )
+         bus_info->flags |= I2C_BUS_LVDS;
+   }
+   DBGMSF(debug, "busno=%d, edid=%p", bus_info->busno, bus_info->edid);
+}
+
+
 /** Inspects an I2C bus.
  *
  *  Takes the number of the bus to be inspected from the #I2C_Bus_Info struct passed
@@ -533,6 +887,9 @@ void i2c_check_bus(I2C_Bus_Info * bus_info) {
            (bus_info->flags & I2C_BUS_HAS_VALID_NAME)
          );
 
+   if (!(bus_info->flags & I2C_BUS_PROBED) && edid_only_probing)
+      i2c_check_bus_edid_only(bus_info);
+
    if (!(bus_info->flags & I2C_BUS_PROBED)) {
       DBGMSF(debug, "Probing");
       bus_info->flags |= I2C_BUS_PROBED;
@@ -544,8 +901,25 @@ void i2c_check_bus(I2C_Bus_Info * bus_info) {
 
           bus_info->functionality = i2c_get_functionality_flags_by_fd(fd);
 
-          DDCA_Status ddcrc = i2c_get_parsed_edid_by_fd(fd, &bus_info->edid);
-          DBGMSF(debug, "i2c_get_parsed_edid_by_fd() returned %s", psc_desc(ddcrc));
+          DDCA_Status ddcrc = 0;
+          Sys_Drm_Connector * connector = NULL;
+          I2C_Probe_Hint * hint = find_valid_probe_hint(bus_info, &connector);
+          if (hint) {
+             // same monitor, or still no monitor, as when the hint was recorded
+             DBGMSF(debug, "Using probe hint, flags=0x%04x", hint->flags);
+             if (hint->edid_bytes)
+                bus_info->edid = create_interned_parsed_edid(connector->edid_bytes, "SYSFS");
+             if (!bus_info->edid)
+                ddcrc = -ENXIO;
+          }
+          else {
+             if (EDID_Read_Uses_Sysfs)
+                bus_info->edid = i2c_get_parsed_edid_from_sysfs(bus_info->busno);
+             if (!bus_info->edid) {
+                ddcrc = i2c_get_parsed_edid_by_fd(fd, &bus_info->edid);
+                DBGMSF(debug, "i2c_get_parsed_edid_by_fd() returned %s", psc_desc(ddcrc));
+             }
+          }
           if (ddcrc == 0) {
              bus_info->flags |= I2C_BUS_ADDR_0X50;
              if ( IS_EDP_DEVICE(bus_info->busno) ) {
@@ -556,8 +930,9 @@ void i2c_check_bus(I2C_Bus_Info * bus_info) {
                 DBGMSF(debug, "LVDS device detected");
                 bus_info->flags |= I2C_BUS_LVDS;
              }
-             else {
-                int rc = i2c_detect_x37(fd);
+             else if (!edid_only_probing) {
+                int rc = (hint) ? ( (hint->flags & I2C_BUS_ADDR_0X37) ? 0 : -ENXIO )
+                                : i2c_detect_x37(fd, bus_info->functionality);
                 if (rc == 0)
                    bus_info->flags |= I2C_BUS_ADDR_0X37;
                 else if (rc == -EBUSY)
@@ -607,6 +982,143 @@ void i2c_gdestroy_bus_info(gpointer data) {
 }
 
 
+//
+// Bus probe watchdog
+//
+
+// Shared by a probe thread and the thread waiting for it
+typedef struct {
+   I2C_Bus_Info * scratch;      // probed by the worker thread
+   bool           done;
+   bool           abandoned;
+   int            refct;
+} Bus_Check_Watch;
+
+
+// Must be called with bus_check_watch_mutex held
+static void
+unref_bus_check_watch(Bus_Check_Watch * watch) {
+   if (--watch->refct == 0) {
+      i2c_free_bus_info(watch->scratch);
+      free(watch);
+   }
+}
+
+
+static gpointer
+watched_check_bus_thread(gpointer data) {
+   bool debug = false;
+   Bus_Check_Watch * watch = data;
+   apply_worker_thread_sched();
+
+   // opens and closes its own fd, so an abandoned probe releases the bus when it returns
+   i2c_check_bus(watch->scratch);
+
+   g_mutex_lock(&bus_check_watch_mutex);
+   watch->done = true;
+   DBGTRC(debug || watch->abandoned, TRACE_GROUP, "Probe of /dev/"I2C"-%d complete%s",
+          watch->scratch->busno, (watch->abandoned) ? " after timeout" : "");
+   g_cond_broadcast(&bus_check_watch_cond);
+   unref_bus_check_watch(watch);
+   g_mutex_unlock(&bus_check_watch_mutex);
+   return NULL;
+}
+
+
+/** Probes a bus, giving up after #I2C_BUS_CHECK_TIMEOUT_MILLIS.
+ *
+ *  A wedged adapter can block an EDID read or the check for slave
+ *  address x37 for seconds.  The probe is performed by a separate thread
+ *  on a private #I2C_Bus_Info.  If it does not complete in time the
+ *  thread is abandoned, closing the bus when the blocked call eventually
+ *  returns, and the bus is marked #I2C_BUS_BUSY and #I2C_BUS_TIMED_OUT.
+ *
+ *  @param  bus_info  pointer to #I2C_Bus_Info struct in which information will be set
+ */
+static void
+i2c_check_bus_with_timeout(I2C_Bus_Info * bus_info) {
+   bool debug = false;
+   if (I2C_BUS_CHECK_TIMEOUT_MILLIS == 0 || (bus_info->flags & I2C_BUS_PROBED)) {
+      i2c_check_bus(bus_info);
+      return;
+   }
+   DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d", bus_info->busno);
+
+   // scan /sys/class/drm before an abandoned probe can still be looking up a connector
+   get_sys_drm_connectors(false);
+
+   Bus_Check_Watch * watch = calloc(1, sizeof(Bus_Check_Watch));
+   watch->scratch = i2c_new_bus_info(bus_info->busno);
+   watch->scratch->flags = bus_info->flags;
+   watch->refct = 2;
+
+   GError * error = NULL;
+   GThread * thread = g_thread_try_new("i2c_check_bus", watched_check_bus_thread, watch, &error);
+   if (!thread) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "g_thread_try_new() failed: %s", error->message);
+      g_error_free(error);
+      i2c_free_bus_info(watch->scratch);
+      free(watch);
+      i2c_check_bus(bus_info);
+   }
+   else {
+      g_thread_unref(thread);     // never joined
+      gint64 end_time = g_get_monotonic_time() + I2C_BUS_CHECK_TIMEOUT_MILLIS * 1000;
+      g_mutex_lock(&bus_check_watch_mutex);
+      while (!watch->done) {
+         if (!g_cond_wait_until(&bus_check_watch_cond, &bus_check_watch_mutex, end_time))
+            break;
+      }
+      if (watch->done) {
+         // take over the results, including the EDID and driver name
+         *bus_info = *watch->scratch;
+         free(watch->scratch);
+         watch->scratch = NULL;
+      }
+      else {
+         watch->abandoned = true;
+         bus_info->flags |= I2C_BUS_PROBED | I2C_BUS_BUSY | I2C_BUS_TIMED_OUT;
+         bus_check_timeout_ct++;
+         timed_out_buses = bs256_insert(timed_out_buses, bus_info->busno);
+      }
+      unref_bus_check_watch(watch);
+      g_mutex_unlock(&bus_check_watch_mutex);
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "busno=%d, timed out: %s",
+                  bus_info->busno, sbool(bus_info->flags & I2C_BUS_TIMED_OUT));
+}
+
+
+/** Reports the number of bus probes abandoned by the detection watchdog.
+ *
+ *  @param depth logical indentation depth
+ */
+void i2c_report_bus_check_timeouts(int depth) {
+   g_mutex_lock(&bus_check_watch_mutex);
+   int         ct    = bus_check_timeout_ct;
+   Bit_Set_256 buses = timed_out_buses;
+   g_mutex_unlock(&bus_check_watch_mutex);
+   rpt_vstring(depth, "I2C bus probes timed out during detection: %d", ct);
+   if (ct > 0)
+      rpt_vstring(depth+1, "Buses: %s", bs256_to_string_decimal(buses, "", " "));
+}
+
+
+/** Exports the number of bus probes abandoned by the detection watchdog.
+ *
+ *  @param exp  export instance
+ */
+void i2c_export_bus_check_timeouts(Stats_Export * exp) {
+   g_mutex_lock(&bus_check_watch_mutex);
+   int ct = bus_check_timeout_ct;
+   g_mutex_unlock(&bus_check_watch_mutex);
+   stats_export_metric(exp, "ddcutil_i2c_bus_check_timeouts_total", STATS_METRIC_COUNTER,
+                            "I2C bus probes abandoned during display detection");
+   stats_export_sample(exp, "ddcutil_i2c_bus_check_timeouts_total", ct, 0);
+}
+
+
 //
 // Bus Reports
 //
@@ -709,7 +1221,7 @@ void i2c_report_active_display(I2C_Bus_Info * businfo, int depth) {
 
       char fn[PATH_MAX];     // yes, PATH_MAX is dangerous, but not as used here
       sprintf(fn, "/sys/bus/i2c/devices/i2c-%d/name", businfo->busno);
-      char * sysattr_name = file_get_first_line(fn, /* verbose*/ false);
+      char * sysattr_name = file_get_first_line(fs_rooted_path_t(fn), /* verbose*/ false);
       rpt_vstring(d1, "%-*s%s", title_width, fn, sysattr_name);
       free(sysattr_name);
       sprintf(fn, "/sys/bus/i2c/devices/i2c-%d", businfo->busno);
@@ -763,10 +1275,10 @@ bool i2c_device_exists(int busno) {
    bool result = false;
    bool debug = false;
    int  errsv;
-   char namebuf[20];
+   char namebuf[PATH_MAX];
    struct stat statbuf;
    int  rc = 0;
-   sprintf(namebuf, "/dev/"I2C"-%d", busno);
+   g_snprintf(namebuf, PATH_MAX, "%s/dev/"I2C"-%d", fs_root_prefix(), busno);
    errno = 0;
    rc = stat(namebuf, &statbuf);
    errsv = errno;
@@ -814,15 +1326,152 @@ int i2c_device_count() {
 Byte_Value_Array get_i2c_devices_by_existence_test() {
    Byte_Value_Array bva = bva_create();
    for (int busno=0; busno < I2C_BUS_MAX; busno++) {
-      if (i2c_device_exists(busno)) {
-         // if (!is_ignorable_i2c_device(busno))
+      // as get_i2c_device_numbers_using_udev(), skip SMBus and similar devices
+      if (i2c_device_exists(busno) && !sysfs_is_ignorable_i2c_device(busno))
          bva_append(bva, busno);
-      }
    }
    return bva;
 }
 
 
+/** Sets the threshold for probing I2C buses in parallel.
+ *  If the number of /dev/i2c devices to be probed is greater than or equal
+ *  to the threshold value, the buses are probed by the worker threads of
+ *  the shared executor.
+ *
+ *  @param threshold  threshold value
+ */
+void i2c_set_bus_check_async_threshold(int threshold) {
+   bus_check_async_threshold = threshold;
+}
+
+
+// satisfies Executor_Task_Func
+static void threaded_check_bus(gpointer data) {
+   bool debug = false;
+   I2C_Bus_Info * businfo = data;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d", businfo->busno);
+
+   i2c_check_bus_with_timeout(businfo);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "busno=%d", businfo->busno);
+}
+
+
+/** Probes I2C buses using the shared executor, and waits for all
+ *  probes to complete.
+ *
+ *  Each #I2C_Bus_Info is independent, so the buses can be probed
+ *  concurrently.
+ *
+ *  @param buses  #GPtrArray of pointers to #I2C_Bus_Info
+ */
+static void i2c_async_check_buses(GPtrArray * buses) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "bus count=%d", buses->len);
+
+   // scan /sys/class/drm before any probe looks up a connector
+   get_sys_drm_connectors(false);
+
+   Executor_Group * group = executor_group_new();
+   for (int ndx = 0; ndx < buses->len; ndx++)
+      executor_submit(group, NULL, threaded_check_bus, g_ptr_array_index(buses, ndx));
+   executor_wait_group(group);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Gets the numbers of the /dev/i2c devices with valid names.
+ *
+ *  @return Byte_Value_Array of bus numbers, caller must free
+ */
+Byte_Value_Array i2c_get_device_numbers() {
+   // only returns buses with valid name (arg=false)
+#ifdef ENABLE_UDEV
+   Byte_Value_Array i2c_bus_bva = get_i2c_device_numbers_using_udev(false);
+#else
+   Byte_Value_Array i2c_bus_bva = get_i2c_devices_by_existence_test();
+#endif
+   return i2c_bus_bva;
+}
+
+
+/** For a bus that was busy when probed, takes the EDID from the
+ *  corresponding DRM connector in sysfs.
+ *
+ *  @param  businfo  bus information
+ */
+static void i2c_get_busy_bus_edid_from_sysfs(I2C_Bus_Info * businfo) {
+   bool debug = false;
+   int busno = businfo->busno;
+   DBGMSF(debug, "Getting EDID from sysfs");
+   Sys_Drm_Connector * connector_rec = find_sys_drm_connector_by_busno(busno);
+   if (connector_rec && connector_rec->edid_bytes) {
+      businfo->edid = create_interned_parsed_edid(connector_rec->edid_bytes, "SYSFS");
+      if (debug) {
+         if (businfo->edid)
+            report_parsed_edid(businfo->edid, false /* verbose */, 0);
+         else
+            DBGMSG("create_parsed_edid() returned NULL");
+      }
+      if (businfo->edid) {
+         businfo->flags |= I2C_BUS_ADDR_0X50;  // ???
+         businfo->flags |= I2C_BUS_SYSFS_EDID;
+         memcpy(businfo->edid->edid_source, "SYSFS", 6);
+      }
+   }
+
+   if (debug) {
+      GPtrArray * conflicts = collect_conflicting_drivers(busno, -1);
+      // report_conflicting_drivers(conflicts);
+      DBGMSG("Conflicting drivers: %s", conflicting_driver_names_string_t(conflicts));
+      free_conflicting_drivers(conflicts);
+   }
+}
+
+
+/** Checks whether a probed bus has no monitor, in which case only its
+ *  number is retained.
+ *
+ *  Buses that could not be opened or that were busy are kept, since
+ *  they may have a monitor.
+ */
+static bool is_nondisplay_bus(I2C_Bus_Info * businfo) {
+   return (businfo->flags & I2C_BUS_PROBED) && (businfo->flags & I2C_BUS_ACCESSIBLE) &&
+          !(businfo->flags & (I2C_BUS_ADDR_0X50 | I2C_BUS_BUSY)) &&
+          !businfo->edid;
+}
+
+
+/** Adds a probed bus to the detected buses, or if it has no monitor,
+ *  records its number and frees it.
+ *
+ *  @param  businfo  bus information
+ *  @return true if businfo was added, false if freed
+ */
+static bool retain_bus_info(I2C_Bus_Info * businfo) {
+   if (is_nondisplay_bus(businfo)) {
+      nondisplay_buses = bs256_insert(nondisplay_buses, businfo->busno);
+      i2c_free_bus_info(businfo);
+      return false;
+   }
+   g_ptr_array_add(i2c_buses, businfo);
+   return true;
+}
+
+
+/** Returns the numbers of the buses that were probed and have no monitor.
+ *  These are not included in the buses returned by
+ *  #i2c_get_bus_info_by_index() and #i2c_find_bus_info_by_busno().
+ *
+ *  @return bus numbers
+ */
+Bit_Set_256 i2c_get_nondisplay_buses() {
+   return nondisplay_buses;
+}
+
+
 int i2c_detect_buses() {
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_I2C, "i2c_buses = %p", i2c_buses);
@@ -833,58 +1482,129 @@ int i2c_detect_buses() {
 
 
    if (!i2c_buses) {
-      // only returns buses with valid name (arg=false)
-#ifdef ENABLE_UDEV
-      Byte_Value_Array i2c_bus_bva = get_i2c_device_numbers_using_udev(false);
-#else
-      Byte_Value_Array i2c_bus_bva = get_i2c_devices_by_existence_test();
-#endif
+      Byte_Value_Array i2c_bus_bva = i2c_get_device_numbers();
       i2c_buses = g_ptr_array_sized_new(bva_length(i2c_bus_bva));
       g_ptr_array_set_free_func(i2c_buses, i2c_gdestroy_bus_info);
+      GPtrArray * new_buses = g_ptr_array_sized_new(bva_length(i2c_bus_bva));
       for (int ndx = 0; ndx < bva_length(i2c_bus_bva); ndx++) {
          int busno = bva_get(i2c_bus_bva, ndx);
-         DBGMSF(debug, "Checking busno = %d", busno);
          I2C_Bus_Info * businfo = i2c_new_bus_info(busno);
          businfo->flags = I2C_BUS_EXISTS | I2C_BUS_VALID_NAME_CHECKED | I2C_BUS_HAS_VALID_NAME;
-         i2c_check_bus(businfo);
+         g_ptr_array_add(new_buses, businfo);
+      }
+      if (new_buses->len >= bus_check_async_threshold)
+         i2c_async_check_buses(new_buses);
+      else {
+         for (int ndx = 0; ndx < new_buses->len; ndx++)
+            i2c_check_bus_with_timeout(g_ptr_array_index(new_buses, ndx));
+      }
+
+      for (int ndx = 0; ndx < new_buses->len; ndx++) {
+         I2C_Bus_Info * businfo = g_ptr_array_index(new_buses, ndx);
+         int busno = businfo->busno;
+         DBGMSF(debug, "Checked busno = %d", busno);
          if (debug || IS_TRACING() )
             i2c_dbgrpt_bus_info(businfo, 0);
-         if (businfo->flags & I2C_BUS_BUSY) {
-            DBGMSF(debug, "Getting EDID from sysfs");
-            Sys_Drm_Connector * connector_rec = find_sys_drm_connector_by_busno(busno);
-            if (connector_rec && connector_rec->edid_bytes) {
-               businfo->edid = create_parsed_edid2(connector_rec->edid_bytes, "SYSFS");
-               if (debug) {
-                  if (businfo->edid)
-                     report_parsed_edid(businfo->edid, false /* verbose */, 0);
-                  else
-                     DBGMSG("create_parsed_edid() returned NULL");
-               }
-               if (businfo->edid) {
-                  businfo->flags |= I2C_BUS_ADDR_0X50;  // ???
-                  businfo->flags |= I2C_BUS_SYSFS_EDID;
-                  memcpy(businfo->edid->edid_source, "SYSFS", 6);
-               }
-            }
-
-            if (debug) {
-               GPtrArray * conflicts = collect_conflicting_drivers(busno, -1);
-               // report_conflicting_drivers(conflicts);
-               DBGMSG("Conflicting drivers: %s", conflicting_driver_names_string_t(conflicts));
-               free_conflicting_drivers(conflicts);
-            }
-         }
+         if (businfo->flags & I2C_BUS_BUSY)
+            i2c_get_busy_bus_edid_from_sysfs(businfo);
          DBGMSF(debug, "Valid bus: /dev/"I2C"-%d", busno);
-         g_ptr_array_add(i2c_buses, businfo);
+         retain_bus_info(businfo);
       }
+      g_ptr_array_free(new_buses, true);
       bva_free(i2c_bus_bva);
    }
    int result = i2c_buses->len;
-   DBGTRC_DONE(debug, DDCA_TRC_I2C, "Returning: %d", result);
+   DBGTRC_DONE(debug, DDCA_TRC_I2C, "Returning: %d, non-display buses: %s",
+                                    result, bs256_to_string_decimal(nondisplay_buses, "", " "));
    return result;
 }
 
 
+/** Installs a previously saved set of #I2C_Bus_Info records as the detected
+ *  buses, so that #i2c_detect_buses() does not probe the buses.
+ *
+ *  @param buses  #GPtrArray of #I2C_Bus_Info, ownership of the records
+ *                passes to this module
+ */
+void i2c_restore_buses(GPtrArray * buses) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "bus count=%d", buses->len);
+   assert(!i2c_buses);
+
+   i2c_buses = g_ptr_array_sized_new(buses->len);
+   g_ptr_array_set_free_func(i2c_buses, i2c_gdestroy_bus_info);
+   for (int ndx = 0; ndx < buses->len; ndx++)
+      retain_bus_info(g_ptr_array_index(buses, ndx));
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Removes the #I2C_Bus_Info for a bus from the detected buses,
+ *  without freeing it.
+ *
+ *  Used by incremental redetection, since a retired #Display_Ref
+ *  may still point to the bus information.
+ *
+ *  @param  busno  I2C bus number
+ *  @return bus information removed, NULL if not found
+ */
+I2C_Bus_Info * i2c_detach_bus_info(int busno) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d", busno);
+   assert(i2c_buses);
+
+   I2C_Bus_Info * result = NULL;
+   for (int ndx = 0; ndx < i2c_buses->len; ndx++) {
+      I2C_Bus_Info * cur = g_ptr_array_index(i2c_buses, ndx);
+      if (cur->busno == busno) {
+         result = cur;
+         g_ptr_array_set_free_func(i2c_buses, NULL);
+         g_ptr_array_remove_index(i2c_buses, ndx);
+         g_ptr_array_set_free_func(i2c_buses, i2c_gdestroy_bus_info);
+         break;
+      }
+   }
+   nondisplay_buses = bs256_and_not(nondisplay_buses, bs256_insert(EMPTY_BIT_SET_256, busno));
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %p", result);
+   return result;
+}
+
+
+/** Probes a bus and adds it to the detected buses, maintaining bus number order.
+ *  A bus without a monitor is only recorded in #i2c_get_nondisplay_buses().
+ *
+ *  @param  busno  I2C bus number
+ *  @return bus information, NULL if /dev/i2c-N does not exist or has no monitor
+ */
+I2C_Bus_Info * i2c_add_bus(int busno) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d", busno);
+   assert(i2c_buses);
+   assert(!i2c_find_bus_info_by_busno(busno));
+
+   I2C_Bus_Info * businfo = i2c_detect_single_bus(busno);
+   if (businfo && is_nondisplay_bus(businfo)) {
+      nondisplay_buses = bs256_insert(nondisplay_buses, busno);
+      i2c_free_bus_info(businfo);
+      businfo = NULL;
+   }
+   if (businfo) {
+      if (businfo->flags & I2C_BUS_BUSY)
+         i2c_get_busy_bus_edid_from_sysfs(businfo);
+      int ndx = 0;
+      while (ndx < i2c_buses->len &&
+             ((I2C_Bus_Info*) g_ptr_array_index(i2c_buses, ndx))->busno < busno)
+         ndx++;
+      g_ptr_array_insert(i2c_buses, ndx, businfo);
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %p", businfo);
+   return businfo;
+}
+
+
 void i2c_discard_buses() {
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
@@ -892,6 +1612,7 @@ void i2c_discard_buses() {
       g_ptr_array_free(i2c_buses, true);
       i2c_buses= NULL;
    }
+   nondisplay_buses = EMPTY_BIT_SET_256;
    DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
 
@@ -904,7 +1625,7 @@ I2C_Bus_Info * i2c_detect_single_bus(int busno) {
    if (i2c_device_exists(busno) ) {
       businfo = i2c_new_bus_info(busno);
       businfo->flags = I2C_BUS_EXISTS | I2C_BUS_VALID_NAME_CHECKED | I2C_BUS_HAS_VALID_NAME;
-      i2c_check_bus(businfo);
+      i2c_check_bus_with_timeout(businfo);
       if (debug)
          i2c_dbgrpt_bus_info(businfo, 0);
    }
@@ -1055,7 +1776,7 @@ int i2c_dbgrpt_buses(bool report_all, int depth) {
 
    puts("");
    if (report_all)
-      rpt_vstring(depth,"Detected %d non-ignorable I2C buses:", busct);
+      rpt_vstring(depth,"Detected %d non-ignorable I2C buses:", busct + bs256_count(nondisplay_buses));
    else
       rpt_vstring(depth, "I2C buses with monitors detected at address 0x50:");
 
@@ -1069,6 +1790,11 @@ int i2c_dbgrpt_buses(bool report_all, int depth) {
    }
    if (reported_ct == 0)
       rpt_vstring(depth, "   No buses\n");
+   if (report_all && bs256_count(nondisplay_buses) > 0) {
+      rpt_nl();
+      rpt_vstring(depth, "I2C buses without monitors: %s",
+                         bs256_to_string_decimal(nondisplay_buses, "/dev/"I2C"-", " "));
+   }
 
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning %d", reported_ct);
    return reported_ct;
@@ -1079,12 +1805,20 @@ static void init_i2c_bus_core_func_name_table() {
    RTTI_ADD_FUNC(i2c_open_bus);
    RTTI_ADD_FUNC(i2c_close_bus);
    RTTI_ADD_FUNC(i2c_get_edid_bytes_using_i2c_layer);
+   RTTI_ADD_FUNC(i2c_read_edid_extensions);
    RTTI_ADD_FUNC(i2c_detect_buses);
+   RTTI_ADD_FUNC(i2c_restore_buses);
+   RTTI_ADD_FUNC(i2c_detach_bus_info);
+   RTTI_ADD_FUNC(i2c_add_bus);
+   RTTI_ADD_FUNC(threaded_check_bus);
+   RTTI_ADD_FUNC(i2c_async_check_buses);
    RTTI_ADD_FUNC(i2c_detect_single_bus);
    RTTI_ADD_FUNC(i2c_check_bus);
    RTTI_ADD_FUNC(i2c_detect_x37);
+   RTTI_ADD_FUNC(i2c_quick_detect_x37);
    RTTI_ADD_FUNC(i2c_get_raw_edid_by_fd);
    RTTI_ADD_FUNC(i2c_get_parsed_edid_by_fd);
+   RTTI_ADD_FUNC(i2c_get_parsed_edid_from_sysfs);
 }
 
 
@@ -1092,5 +1826,7 @@ void init_i2c_bus_core() {
    init_i2c_bus_core_func_name_table();
    init_i2c_execute_func_name_table();
    open_failures_reported = EMPTY_BIT_SET_256;
+   kernel_retry_buses = EMPTY_BIT_SET_256;
+   timed_out_buses = EMPTY_BIT_SET_256;
 }
 
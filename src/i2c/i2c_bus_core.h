@@ -21,6 +21,7 @@
 #include "base/core.h"
 #include "base/displays.h"
 #include "base/execution_stats.h"
+#include "base/stats_export.h"
 #include "base/status_code_mgt.h"
 
 
@@ -38,6 +39,8 @@ extern bool i2c_force_bus;
 // Basic I2C bus operations
 int           i2c_open_bus(int busno, Call_Options callopts);
 Status_Errno  i2c_close_bus(int fd, Call_Options callopts);
+void          i2c_set_kernel_retries(int ct);
+bool          i2c_kernel_retries_active(int busno);
 
 // EDID inspection
 Status_Errno_DDC i2c_get_raw_edid_by_fd(int fd, Buffer * rawedid);
@@ -58,6 +61,11 @@ Status_Errno_DDC i2c_get_parsed_edid_by_fd(int fd, Parsed_Edid ** edid_ptr_loc);
 #define I2C_BUS_HAS_VALID_NAME     0x0400
 #define I2C_BUS_BUSY               0x0200      ///< for possible future use
 #define I2C_BUS_SYSFS_EDID         0x0100
+#define I2C_BUS_TIMED_OUT          0x1000      ///< probe abandoned after I2C_BUS_CHECK_TIMEOUT_MILLIS
+
+/** Flags of a bus that was probed and has no monitor, see #i2c_get_nondisplay_buses() */
+#define I2C_BUS_NONDISPLAY_FLAGS \
+   (I2C_BUS_EXISTS | I2C_BUS_VALID_NAME_CHECKED | I2C_BUS_HAS_VALID_NAME | I2C_BUS_PROBED | I2C_BUS_ACCESSIBLE)
 
 #define I2C_BUS_INFO_MARKER "BINF"
 /** Information about one I2C bus */
@@ -83,8 +91,33 @@ void add_open_failures_reported(Bit_Set_256 failures);
 void include_open_failures_reported(int busno);
 
 // Bus inventory - detect and probe buses
+void i2c_set_bus_check_async_threshold(int threshold);
+void i2c_report_bus_check_timeouts(int depth);
+void i2c_export_bus_check_timeouts(Stats_Export * exp);
+Byte_Value_Array i2c_get_device_numbers();
 int i2c_detect_buses();            // creates internal array of Bus_Info for I2C buses
+void i2c_restore_buses(GPtrArray * buses);
+Bit_Set_256 i2c_get_nondisplay_buses();
+
+/** Result of probing a bus in an earlier execution */
+typedef struct {
+   uint16_t         flags;              ///< I2C_BUS_* flags found
+   Byte *           edid_bytes;         ///< 128 byte EDID found, NULL if none
+} I2C_Probe_Hint;
+
+GHashTable * i2c_new_probe_hints();
+void i2c_add_probe_hint(
+      GHashTable * hints,
+      const char * driver,
+      const char * connector_name,
+      uint16_t     flags,
+      Byte *       edid_bytes);
+void i2c_set_probe_hints(GHashTable * hints);
+void i2c_enable_edid_only_probing(bool onoff);
+I2C_Bus_Info * i2c_detach_bus_info(int busno);
+I2C_Bus_Info * i2c_add_bus(int busno);
 void i2c_discard_buses();
+I2C_Bus_Info * i2c_new_bus_info(int busno);
 I2C_Bus_Info * i2c_detect_single_bus(int busno);
 void i2c_free_bus_info(I2C_Bus_Info * bus_info);
 
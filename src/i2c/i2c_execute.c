@@ -33,6 +33,7 @@
 #include "base/linux_errno.h"
 #include "base/parms.h"
 #include "base/rtti.h"
+#include "base/trace_ring.h"
 #include "base/tuned_sleep.h"
 
 #ifdef TARGET_BSD
@@ -151,6 +152,7 @@ i2c_ioctl_writer(
       rc = -errsv;
    }
 
+   TRACE_EVENT(TRE_I2C_WRITE, fd, bytect, rc, 0);
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
    return rc;
 }
@@ -244,6 +246,29 @@ ioctl_reader1(
 }
 
 
+/** Returns the number of bytes in a DDC/CI response, once enough of
+ *  the response has been read to know it.
+ *
+ *  The response starts with the source address (0x6e), possibly repeated
+ *  by some monitors, followed by the length byte (0x80 | data length),
+ *  the data, and the checksum.
+ *
+ * @param  readbuf    bytes read so far
+ * @param  bytect     number of bytes read so far
+ * @return total response size, 0 if not yet known
+ */
+static int
+ddc_response_size(Byte * readbuf, int bytect) {
+   for (int ndx = 1; ndx < bytect && ndx <= 2; ndx++) {
+      if (readbuf[ndx] & 0x80)
+         return ndx + 1 + (readbuf[ndx] & 0x7f) + 1;
+      if (readbuf[ndx] != 0x6e)
+         break;
+   }
+   return 0;
+}
+
+
 /** Reads from I2C bus using ioctl(I2C_RDWR)
  *
  * @param  fd         Linux file descriptor
@@ -270,21 +295,111 @@ i2c_ioctl_reader(
    int rc = 0;
 
    if (read_bytewise) {
+      // For DDC/CI, stop once the length byte shows the response is complete.
+      // Bytes not read are left as set by the caller.
+      int response_size = 0;
       int ndx = 0;
       for (; ndx < bytect && rc == 0; ndx++) {
          rc = ioctl_reader1(fd, slave_addr, 1, readbuf+ndx);
+         if (rc == 0 && slave_addr == 0x37 && response_size == 0)
+            response_size = ddc_response_size(readbuf, ndx+1);
+         if (response_size > 0 && ndx+1 >= response_size)
+            break;
       }
    }
    else {
       rc = ioctl_reader1(fd, slave_addr, bytect, readbuf);
    }
 
+   TRACE_EVENT(TRE_I2C_READ, fd, bytect, rc, 0);
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "readbuf: %s", hexstring_t(readbuf, bytect));
    return rc;
 }
 
 
+/** Writes to and then reads from the I2C bus in a single ioctl(I2C_RDWR)
+ *  call, i.e. as a write message followed by a read message using a
+ *  repeated start.
+ *
+ *  There is no delay between the write and the read other than the one imposed
+ *  by the adapter, so this can only be used for monitors that tolerate it.
+ *
+ * @param  fd              Linux file descriptor
+ * @param  slave_addr      slave address
+ * @param  write_bytect    number of bytes to write
+ * @param  bytes_to_write  pointer to bytes to write
+ * @param  read_bytect     number of bytes to read
+ * @param  readbuf         read bytes into this buffer
+ *
+ * @retval 0         success
+ * @retval <0        negative Linux errno value
+ */
+Status_Errno_DDC
+i2c_ioctl_write_reader(
+      int    fd,
+      Byte   slave_addr,
+      int    write_bytect,
+      Byte * bytes_to_write,
+      int    read_bytect,
+      Byte * readbuf)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP,
+                 "fd=%d, fn=%s, slave_addr=0x%02x, write_bytect=%d, bytes_to_write -> %s, read_bytect=%d, readbuf=%p",
+                 fd, filename_for_fd_t(fd), slave_addr, write_bytect,
+                 hexstring_t(bytes_to_write, write_bytect), read_bytect, readbuf);
+
+   // allocated for the same reason as in ioctl_reader1()
+   struct i2c_msg * messages = calloc(2, sizeof(struct i2c_msg));
+
+   int rc = 0;
+
+   struct i2c_rdwr_ioctl_data  msgset;
+   memset(&msgset,0,sizeof(msgset));
+
+   messages[0].addr  = slave_addr;
+   messages[0].flags = 0;
+   messages[0].len   = write_bytect;
+   messages[0].buf   = bytes_to_write;
+
+   messages[1].addr  = slave_addr;
+   messages[1].flags = I2C_M_RD;
+   messages[1].len   = read_bytect;
+   messages[1].buf   = readbuf;
+
+   msgset.msgs  = messages;
+   msgset.nmsgs = 2;
+
+   RECORD_IO_EVENTX(
+      fd,
+      IE_WRITE_READ,
+      ( rc = ioctl(fd, I2C_RDWR, &msgset))
+     );
+   int errsv = errno;
+   if (rc < 0) {
+      if (debug) {
+         REPORT_IOCTL_ERROR("I2C_RDWR", errno);
+      }
+   }
+   if (rc > 0) {
+      // number of messages transferred
+      if (rc != 2) {
+         DBGMSG("ioctl rc = %d, expected 2", rc);
+      }
+      rc = 0;
+   }
+   else if (rc < 0)
+      rc = -errsv;
+
+   free(messages);
+   TRACE_EVENT(TRE_I2C_WRITE_READ, fd, write_bytect, read_bytect, rc);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "readbuf: %s", hexstring_t(readbuf, read_bytect));
+   return rc;
+}
+
+
 void init_i2c_execute_func_name_table() {
    RTTI_ADD_FUNC( i2c_ioctl_writer);
    RTTI_ADD_FUNC( i2c_ioctl_reader);
+   RTTI_ADD_FUNC( i2c_ioctl_write_reader);
 }
@@ -27,6 +27,16 @@ typedef Status_Errno_DDC (*I2C_Reader)(
       int    bytect,
       Byte * readbuf);
 
+/** Function template for I2C function that writes and then reads
+ *  in a single transaction */
+typedef Status_Errno_DDC (*I2C_Write_Reader)(
+      int    fd,
+      Byte   slave_address,
+      int    write_bytect,
+      Byte * bytes_to_write,
+      int    read_bytect,
+      Byte * readbuf);
+
 Status_Errno_DDC i2c_ioctl_writer(
       int    fd,
       Byte   slave_address,
@@ -40,6 +50,14 @@ Status_Errno_DDC i2c_ioctl_reader(
       int    bytect,
       Byte * readbuf);
 
+Status_Errno_DDC i2c_ioctl_write_reader(
+      int    fd,
+      Byte   slave_address,
+      int    write_bytect,
+      Byte * bytes_to_write,
+      int    read_bytect,
+      Byte * readbuf);
+
 void init_i2c_execute_func_name_table();
 
 #endif /* I2C_EXECUTE_H_ */
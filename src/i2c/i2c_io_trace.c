@@ -0,0 +1,509 @@
+/** \file i2c_io_trace.c
+ *
+ *  Records raw I2C writes and reads to a trace file, and replays a
+ *  recorded trace as an alternative I2C IO strategy.
+ *
+ *  Each line of a trace file describes one operation performed by
+ *  invoke_i2c_writer(), invoke_i2c_reader() or invoke_i2c_write_reader():
+ *
+ *      <op> <device> <slave address> <start> <duration> <rc> <written> <read>
+ *
+ *  where op is W (write), R (read) or C (combined write/read), start and
+ *  duration are in nanoseconds, and the bytes written and read are hex
+ *  strings, "-" if none.  Lines beginning with '#' are ignored.
+ *
+ *  On replay, each write is matched by device, slave address and bytes
+ *  written to the writes of the same request in the trace, in recorded
+ *  order, wrapping around when all have been used.  The status code and
+ *  duration of the recorded write are reproduced, and the read that
+ *  followed it in the trace answers the next read.  A read not preceded
+ *  by a matched write uses the recorded reads that had no preceding write.
+ *  Requests not present in the trace fail with -EIO.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/file_util.h"
+#include "util/file_util_base.h"
+#include "util/string_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/rtti.h"
+#include "base/sleep.h"
+
+#include "i2c_io_trace.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_I2C;
+
+#define I2C_TRACE_MAX_BYTES  512
+
+
+//
+// Recording
+//
+
+static GMutex   record_mutex;
+static FILE *   record_fp = NULL;
+static uint64_t record_start_nanos = 0;
+
+
+/** Starts recording I2C operations to a trace file, replacing
+ *  its contents.
+ *
+ *  @param  fn  trace file name
+ *  @retval 0   success
+ *  @retval <0  -errno from fopen()
+ */
+Status_Errno i2c_trace_start_recording(const char * fn) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn=%s", fn);
+
+   Status_Errno rc = 0;
+   g_mutex_lock(&record_mutex);
+   if (record_fp)
+      fclose(record_fp);
+   record_fp = fopen(fn, "w");
+   if (!record_fp) {
+      rc = -errno;
+   }
+   else {
+      record_start_nanos = cur_monotonic_nanosec();
+      fprintf(record_fp, "# ddcutil I2C trace\n");
+      fprintf(record_fp, "# op device slave_address start_ns duration_ns rc written read\n");
+   }
+   g_mutex_unlock(&record_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %d", rc);
+   return rc;
+}
+
+
+/** Stops recording and closes the trace file. */
+void i2c_trace_stop_recording() {
+   g_mutex_lock(&record_mutex);
+   if (record_fp) {
+      fclose(record_fp);
+      record_fp = NULL;
+   }
+   g_mutex_unlock(&record_mutex);
+}
+
+
+bool i2c_trace_is_recording() {
+   return record_fp;
+}
+
+
+static char * trace_hex(Byte * bytes, int bytect, char * buf, int bufsz) {
+   if (!bytes || bytect <= 0)
+      return "-";
+   return hexstring2(bytes, MIN(bytect, I2C_TRACE_MAX_BYTES), NULL, false, buf, bufsz);
+}
+
+
+/** Writes one line to the trace file.
+ *
+ *  @param  op             operation type
+ *  @param  fd             file descriptor of open /dev/i2c device
+ *  @param  slave_address  I2C slave address
+ *  @param  start_nanos    monotonic time at which the operation started
+ *  @param  rc             status code of the operation
+ *  @param  write_bytect   number of bytes written
+ *  @param  bytes_written  bytes written, NULL if none
+ *  @param  read_bytect    number of bytes read
+ *  @param  bytes_read     bytes read, NULL if none or the read failed
+ */
+void i2c_trace_record(
+      I2C_Trace_Op op,
+      int          fd,
+      Byte         slave_address,
+      uint64_t     start_nanos,
+      int          rc,
+      int          write_bytect,
+      Byte *       bytes_written,
+      int          read_bytect,
+      Byte *       bytes_read)
+{
+   uint64_t end_nanos = cur_monotonic_nanosec();
+   char wbuf[2*I2C_TRACE_MAX_BYTES+1];
+   char rbuf[2*I2C_TRACE_MAX_BYTES+1];
+   char * whex = trace_hex(bytes_written, write_bytect, wbuf, sizeof(wbuf));
+   char * rhex = trace_hex((rc == 0) ? bytes_read : NULL, read_bytect, rbuf, sizeof(rbuf));
+   char * devname = filename_for_fd_t(fd);
+
+   g_mutex_lock(&record_mutex);
+   if (record_fp) {
+      fprintf(record_fp, "%c %s 0x%02x %"PRIu64" %"PRIu64" %d %s %s\n",
+              op,
+              (devname) ? devname : "-",
+              slave_address,
+              start_nanos - record_start_nanos,
+              end_nanos - start_nanos,
+              rc,
+              whex,
+              rhex);
+   }
+   g_mutex_unlock(&record_mutex);
+}
+
+
+//
+// Replay
+//
+
+/** One recorded write, with the read that followed it */
+typedef struct {
+   bool     has_write;
+   int      write_rc;
+   uint64_t write_nanos;
+   bool     has_read;
+   int      read_rc;
+   uint64_t read_nanos;
+   int      read_bytect;
+   Byte *   read_bytes;
+} Replay_Exchange;
+
+/** Recorded exchanges for one request */
+typedef struct {
+   GPtrArray * exchanges;       // Replay_Exchange *
+   guint       next;
+} Replay_Queue;
+
+static GMutex       replay_mutex;
+static GHashTable * replay_table = NULL;      // request key -> Replay_Queue *
+static GHashTable * replay_pending = NULL;    // fd -> Replay_Exchange * awaiting read
+
+
+static void free_replay_exchange(void * data) {
+   Replay_Exchange * exch = data;
+   free(exch->read_bytes);
+   free(exch);
+}
+
+
+static void free_replay_queue(void * data) {
+   Replay_Queue * queue = data;
+   g_ptr_array_free(queue->exchanges, true);
+   free(queue);
+}
+
+
+static char * replay_key(const char * devname, Byte slave_address, const char * whex) {
+   return g_strdup_printf("%s 0x%02x %s", devname, slave_address, whex);
+}
+
+
+static void add_exchange(GHashTable * table, char * key, Replay_Exchange * exch) {
+   Replay_Queue * queue = g_hash_table_lookup(table, key);
+   if (!queue) {
+      queue = calloc(1, sizeof(Replay_Queue));
+      queue->exchanges = g_ptr_array_new_with_free_func(free_replay_exchange);
+      g_hash_table_insert(table, key, queue);
+   }
+   else {
+      g_free(key);
+   }
+   g_ptr_array_add(queue->exchanges, exch);
+}
+
+
+/** Loads a trace file for replay, replacing any previously loaded trace.
+ *
+ *  @param  fn  trace file name
+ *  @retval 0              success
+ *  @retval DDCRC_BAD_DATA invalid line in trace file
+ *  @retval <0             -errno reading file
+ */
+Status_Errno_DDC i2c_replay_load(const char * fn) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn=%s", fn);
+
+   Status_Errno_DDC result = 0;
+   GPtrArray * lines = g_ptr_array_new_with_free_func(g_free);
+   int linect = file_getlines(fn, lines, true);
+   if (linect < 0) {
+      result = linect;
+      goto bye;
+   }
+
+   GHashTable * table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_replay_queue);
+   // last write on each device and address, possibly followed by a read
+   GHashTable * last_writes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+   int exchange_ct = 0;
+   for (int ndx = 0; ndx < lines->len && result == 0; ndx++) {
+      char * line = g_ptr_array_index(lines, ndx);
+      if (*line == '#' || *line == '\0')
+         continue;
+      char     op;
+      char     devname[100];
+      unsigned slave_address;
+      uint64_t start_nanos;
+      uint64_t duration;
+      int      rc;
+      char     whex[2*I2C_TRACE_MAX_BYTES+2];
+      char     rhex[2*I2C_TRACE_MAX_BYTES+2];
+      int ct = sscanf(line, "%c %99s %x %"SCNu64" %"SCNu64" %d %1025s %1025s",
+                      &op, devname, &slave_address, &start_nanos, &duration, &rc, whex, rhex);
+      Byte * rbytes = NULL;
+      int    rbytect = 0;
+      if (ct != 8 || (op != I2C_TRACE_WRITE && op != I2C_TRACE_READ && op != I2C_TRACE_WRITE_READ) ||
+          slave_address > 0x7f ||
+          (!streq(rhex, "-") && (rbytect = hhs_to_byte_array(rhex, &rbytes)) < 0) )
+      {
+         f0printf(ferr(), "Invalid I2C trace line %d of %s: %s\n", ndx+1, fn, line);
+         result = DDCRC_BAD_DATA;
+         break;
+      }
+      if (rbytect <= 0) {
+         rbytes  = NULL;
+         rbytect = 0;
+      }
+      char * devaddr = replay_key(devname, slave_address, "");
+
+      if (op == I2C_TRACE_READ) {
+         Replay_Exchange * exch = g_hash_table_lookup(last_writes, devaddr);
+         if (exch && !exch->has_read) {
+            g_free(devaddr);
+         }
+         else {
+            exch = calloc(1, sizeof(Replay_Exchange));
+            add_exchange(table, replay_key(devname, slave_address, "-"), exch);
+            g_hash_table_remove(last_writes, devaddr);
+            g_free(devaddr);
+            exchange_ct++;
+         }
+         exch->has_read    = true;
+         exch->read_rc     = rc;
+         exch->read_nanos  = duration;
+         exch->read_bytect = rbytect;
+         exch->read_bytes  = rbytes;
+      }
+      else {
+         Replay_Exchange * exch = calloc(1, sizeof(Replay_Exchange));
+         exch->has_write   = true;
+         exch->write_rc    = rc;
+         exch->write_nanos = duration;
+         if (op == I2C_TRACE_WRITE_READ) {
+            exch->has_read    = true;
+            exch->read_rc     = rc;
+            exch->read_bytect = rbytect;
+            exch->read_bytes  = rbytes;
+         }
+         else {
+            free(rbytes);
+         }
+         add_exchange(table, replay_key(devname, slave_address, whex), exch);
+         g_hash_table_replace(last_writes, devaddr, exch);
+         exchange_ct++;
+      }
+   }
+   g_hash_table_destroy(last_writes);
+
+   if (result == 0) {
+      g_mutex_lock(&replay_mutex);
+      if (replay_table)
+         g_hash_table_destroy(replay_table);
+      replay_table = table;
+      if (replay_pending)
+         g_hash_table_remove_all(replay_pending);
+      else
+         replay_pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+      g_mutex_unlock(&replay_mutex);
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Loaded %d exchanges for %d requests",
+                      exchange_ct, g_hash_table_size(table));
+   }
+   else {
+      g_hash_table_destroy(table);
+   }
+
+bye:
+   g_ptr_array_free(lines, true);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, result, "");
+   return result;
+}
+
+
+/** Discards the loaded trace. */
+void i2c_replay_reset() {
+   g_mutex_lock(&replay_mutex);
+   if (replay_pending) {
+      g_hash_table_destroy(replay_pending);
+      replay_pending = NULL;
+   }
+   if (replay_table) {
+      g_hash_table_destroy(replay_table);
+      replay_table = NULL;
+   }
+   g_mutex_unlock(&replay_mutex);
+}
+
+
+// Returns the next exchange recorded for a request, NULL if none.
+// Must be called with replay_mutex held.
+static Replay_Exchange * next_exchange(int fd, Byte slave_address, int bytect, Byte * bytes) {
+   if (!replay_table)
+      return NULL;
+   char hbuf[2*I2C_TRACE_MAX_BYTES+1];
+   char * key = replay_key(filename_for_fd_t(fd), slave_address,
+                           trace_hex(bytes, bytect, hbuf, sizeof(hbuf)));
+   Replay_Queue * queue = g_hash_table_lookup(replay_table, key);
+   g_free(key);
+   if (!queue)
+      return NULL;
+   Replay_Exchange * exch = g_ptr_array_index(queue->exchanges, queue->next);
+   queue->next = (queue->next + 1) % queue->exchanges->len;
+   return exch;
+}
+
+
+static int replay_read(Replay_Exchange * exch, int bytect, Byte * readbuf) {
+   memset(readbuf, 0, bytect);
+   if (exch->read_rc == 0)
+      memcpy(readbuf, exch->read_bytes, MIN(bytect, exch->read_bytect));
+   return exch->read_rc;
+}
+
+
+/** Replays a recorded write.
+ *
+ *  @param   fd              file descriptor for open /dev/i2c bus
+ *  @param   slave_address   slave address to write to
+ *  @param   bytect          number of bytes to write
+ *  @param   bytes_to_write  pointer to bytes to be written
+ *  @return  recorded status code, -EIO if the write was not recorded
+ */
+Status_Errno_DDC i2c_replay_writer(
+      int    fd,
+      Byte   slave_address,
+      int    bytect,
+      Byte * bytes_to_write)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d, slave_address=0x%02x, bytect=%d",
+                                       fd, slave_address, bytect);
+   Status_Errno_DDC rc = -EIO;
+   uint64_t delay = 0;
+   g_mutex_lock(&replay_mutex);
+   Replay_Exchange * exch = next_exchange(fd, slave_address, bytect, bytes_to_write);
+   if (replay_pending) {
+      if (exch && exch->write_rc == 0 && exch->has_read)
+         g_hash_table_insert(replay_pending, GINT_TO_POINTER(fd), exch);
+      else
+         g_hash_table_remove(replay_pending, GINT_TO_POINTER(fd));
+   }
+   if (exch) {
+      rc = exch->write_rc;
+      delay = exch->write_nanos;
+   }
+   g_mutex_unlock(&replay_mutex);
+
+   if (delay > 0)
+      sleep_micros(delay/1000);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
+   return rc;
+}
+
+
+/** Replays the read that followed the last replayed write.
+ *
+ *  @param   fd              file descriptor for open /dev/i2c bus
+ *  @param   slave_address   I2C slave address to read from
+ *  @param   read_bytewise   ignored
+ *  @param   bytect          number of bytes to read
+ *  @param   readbuf         location where bytes will be read to
+ *  @return  recorded status code, -EIO if no read was recorded
+ */
+Status_Errno_DDC i2c_replay_reader(
+      int    fd,
+      Byte   slave_address,
+      bool   read_bytewise,
+      int    bytect,
+      Byte * readbuf)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d, slave_address=0x%02x, bytect=%d",
+                                       fd, slave_address, bytect);
+   Status_Errno_DDC rc = -EIO;
+   uint64_t delay = 0;
+   g_mutex_lock(&replay_mutex);
+   Replay_Exchange * exch = NULL;
+   if (replay_pending) {
+      exch = g_hash_table_lookup(replay_pending, GINT_TO_POINTER(fd));
+      g_hash_table_remove(replay_pending, GINT_TO_POINTER(fd));
+   }
+   if (!exch)
+      exch = next_exchange(fd, slave_address, 0, NULL);
+   if (exch && exch->has_read) {
+      rc = replay_read(exch, bytect, readbuf);
+      delay = exch->read_nanos;
+   }
+   g_mutex_unlock(&replay_mutex);
+
+   if (delay > 0)
+      sleep_micros(delay/1000);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
+   return rc;
+}
+
+
+/** Replays a recorded combined write/read.
+ *
+ *  @param   fd              file descriptor for open /dev/i2c bus
+ *  @param   slave_address   I2C slave address
+ *  @param   write_bytect    number of bytes to write
+ *  @param   bytes_to_write  pointer to bytes to be written
+ *  @param   read_bytect     number of bytes to read
+ *  @param   readbuf         location where bytes will be read to
+ *  @return  recorded status code, -EIO if the exchange was not recorded
+ */
+Status_Errno_DDC i2c_replay_write_reader(
+      int    fd,
+      Byte   slave_address,
+      int    write_bytect,
+      Byte * bytes_to_write,
+      int    read_bytect,
+      Byte * readbuf)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d, slave_address=0x%02x, write_bytect=%d, read_bytect=%d",
+                                       fd, slave_address, write_bytect, read_bytect);
+   Status_Errno_DDC rc = -EIO;
+   uint64_t delay = 0;
+   g_mutex_lock(&replay_mutex);
+   Replay_Exchange * exch = next_exchange(fd, slave_address, write_bytect, bytes_to_write);
+   if (exch) {
+      rc = exch->write_rc;
+      delay = exch->write_nanos + exch->read_nanos;
+      if (rc == 0)
+         rc = (exch->has_read) ? replay_read(exch, read_bytect, readbuf) : -EIO;
+   }
+   g_mutex_unlock(&replay_mutex);
+
+   if (delay > 0)
+      sleep_micros(delay/1000);
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
+   return rc;
+}
+
+
+void init_i2c_io_trace() {
+   RTTI_ADD_FUNC(i2c_trace_start_recording);
+   RTTI_ADD_FUNC(i2c_replay_load);
+   RTTI_ADD_FUNC(i2c_replay_writer);
+   RTTI_ADD_FUNC(i2c_replay_reader);
+   RTTI_ADD_FUNC(i2c_replay_write_reader);
+}
@@ -0,0 +1,68 @@
+/** \file i2c_io_trace.h
+ *
+ *  Records raw I2C writes and reads to a trace file, and replays a
+ *  recorded trace as an alternative I2C IO strategy.
+ */
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef I2C_IO_TRACE_H_
+#define I2C_IO_TRACE_H_
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "util/coredefs.h"
+
+#include "base/status_code_mgt.h"
+
+/** Operation types in an I2C trace file */
+typedef enum {
+   I2C_TRACE_WRITE      = 'W',
+   I2C_TRACE_READ       = 'R',
+   I2C_TRACE_WRITE_READ = 'C'
+} I2C_Trace_Op;
+
+// Recording
+Status_Errno     i2c_trace_start_recording(const char * fn);
+void             i2c_trace_stop_recording();
+bool             i2c_trace_is_recording();
+void             i2c_trace_record(
+      I2C_Trace_Op op,
+      int          fd,
+      Byte         slave_address,
+      uint64_t     start_nanos,
+      int          rc,
+      int          write_bytect,
+      Byte *       bytes_written,
+      int          read_bytect,
+      Byte *       bytes_read);
+
+// Replay
+Status_Errno_DDC i2c_replay_load(const char * fn);
+void             i2c_replay_reset();
+
+Status_Errno_DDC i2c_replay_writer(
+      int    fd,
+      Byte   slave_address,
+      int    bytect,
+      Byte * bytes_to_write);
+
+Status_Errno_DDC i2c_replay_reader(
+      int    fd,
+      Byte   slave_address,
+      bool   read_bytewise,
+      int    bytect,
+      Byte * readbuf);
+
+Status_Errno_DDC i2c_replay_write_reader(
+      int    fd,
+      Byte   slave_address,
+      int    write_bytect,
+      Byte * bytes_to_write,
+      int    read_bytect,
+      Byte * readbuf);
+
+void init_i2c_io_trace();
+
+#endif /* I2C_IO_TRACE_H_ */
@@ -0,0 +1,521 @@
+/** \file i2c_simulated_monitor.c
+ *
+ *  Virtual DDC/CI monitor used as an alternative I2C IO strategy,
+ *  so that performance measurements are repeatable.
+ *
+ *  DDC/CI traffic to slave address 0x37 is answered from a table of
+ *  feature values and a capabilities string instead of being sent to the
+ *  bus.  All other slave addresses, in particular EDID reads from 0x50,
+ *  are passed through to the ioctl strategy, so the simulated monitor is
+ *  normally paired with a real bus or one created by the i2c-stub module.
+ *
+ *  The monitor's behavior is described by a control file containing one
+ *  setting per line.  Blank lines and text following '#' are ignored.
+ *
+ *      latency          <millisec>     delay before each response is returned
+ *      write_read_gap   <millisec>     minimum time between a request and
+ *                                      reading its response, otherwise the
+ *                                      monitor returns a DDC Null Response
+ *      error_rate       <fraction>     fraction of responses returned with
+ *                                      a corrupted checksum
+ *      seed             <number>       random number seed for error_rate
+ *      capabilities     <string>       capabilities string
+ *      feature          <hh> <cur> [<max>]   non-table feature and its values
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/file_util_base.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/ddc_packets.h"
+#include "base/rtti.h"
+#include "base/sleep.h"
+
+#include "i2c_execute.h"
+
+#include "i2c_simulated_monitor.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_I2C;
+
+#define SIMMON_DDC_ADDR       0x37
+#define SIMMON_MAX_RESPONSE     40     // 0x6e, length, 35 data bytes, checksum
+#define SIMMON_CAPS_FRAGMENT    32
+
+typedef struct {
+   bool     supported;
+   uint16_t cur_value;
+   uint16_t max_value;
+} Simmon_Feature;
+
+typedef struct {
+   int      latency_millis;
+   int      write_read_gap_millis;
+   double   error_rate;
+   guint32  seed;
+   char *   capabilities;
+   Simmon_Feature features[256];
+} Simmon_Config;
+
+/** Response pending on an open bus */
+typedef struct {
+   Byte     response[SIMMON_MAX_RESPONSE];
+   int      response_len;           // 0 if no response pending
+   uint64_t request_nanos;          // time the request was written
+} Simmon_Fd_State;
+
+static GMutex          simmon_mutex;
+static Simmon_Config * simmon_config   = NULL;
+static GHashTable *    simmon_fd_table = NULL;   // fd -> Simmon_Fd_State*
+static GRand *         simmon_rand     = NULL;
+
+
+static Simmon_Fd_State * get_fd_state(int fd) {
+   if (!simmon_fd_table)
+      simmon_fd_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+   Simmon_Fd_State * state = g_hash_table_lookup(simmon_fd_table, GINT_TO_POINTER(fd));
+   if (!state) {
+      state = g_new0(Simmon_Fd_State, 1);
+      g_hash_table_insert(simmon_fd_table, GINT_TO_POINTER(fd), state);
+   }
+   return state;
+}
+
+
+static void free_simmon_config(Simmon_Config * config) {
+   if (config) {
+      free(config->capabilities);
+      free(config);
+   }
+}
+
+
+//
+// Control file
+//
+
+static bool parse_control_line(Simmon_Config * config, char * line, int linenum, const char * fn) {
+   char * comment = strchr(line, '#');
+   if (comment)
+      *comment = '\0';
+   char * s = trim_in_place(line);
+   if (*s == '\0')
+      return true;
+
+   char * value = s + strcspn(s, " \t");
+   if (*value) {
+      *value++ = '\0';
+      value = trim_in_place(value);
+   }
+
+   bool ok = false;
+   int ival;
+   if (streq(s, "latency")) {
+      ok = str_to_int(value, &ival, 10) && ival >= 0;
+      if (ok)
+         config->latency_millis = ival;
+   }
+   else if (streq(s, "write_read_gap")) {
+      ok = str_to_int(value, &ival, 10) && ival >= 0;
+      if (ok)
+         config->write_read_gap_millis = ival;
+   }
+   else if (streq(s, "error_rate")) {
+      float fval;
+      ok = str_to_float(value, &fval) && fval >= 0.0 && fval <= 1.0;
+      if (ok)
+         config->error_rate = fval;
+   }
+   else if (streq(s, "seed")) {
+      ok = str_to_int(value, &ival, 0);
+      if (ok)
+         config->seed = ival;
+   }
+   else if (streq(s, "capabilities")) {
+      ok = (*value != '\0');
+      if (ok) {
+         free(config->capabilities);
+         config->capabilities = strdup(value);
+      }
+   }
+   else if (streq(s, "feature")) {
+      Null_Terminated_String_Array pieces = strsplit(value, " \t");
+      int ct = ntsa_length(pieces);
+      Byte feature_code;
+      int  cur_value = 0;
+      int  max_value = 0xffff;
+      ok = (ct == 2 || ct == 3) &&
+           any_one_byte_hex_string_to_byte_in_buf(pieces[0], &feature_code) &&
+           str_to_int(pieces[1], &cur_value, 0) &&
+           (ct == 2 || str_to_int(pieces[2], &max_value, 0)) &&
+           cur_value >= 0 && cur_value <= 0xffff &&
+           max_value >= 0 && max_value <= 0xffff;
+      if (ok) {
+         config->features[feature_code].supported = true;
+         config->features[feature_code].cur_value = cur_value;
+         config->features[feature_code].max_value = max_value;
+      }
+      ntsa_free(pieces, true);
+   }
+
+   if (!ok)
+      f0printf(ferr(), "Invalid simulated monitor setting at line %d of %s: %s %s\n",
+                       linenum, fn, s, value);
+   return ok;
+}
+
+
+/** Loads a simulated monitor control file.  If successful, replaces
+ *  any previously loaded settings and discards pending responses.
+ *
+ *  @param fn  control file name
+ *  @retval 0          success
+ *  @retval DDCRC_BAD_DATA invalid line in control file
+ *  @retval <0         -errno reading file
+ */
+Status_Errno_DDC simmon_load_control_file(const char * fn) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn=%s", fn);
+
+   Status_Errno_DDC result = 0;
+   GPtrArray * lines = g_ptr_array_new_with_free_func(g_free);
+   int linect = file_getlines(fn, lines, true);
+   if (linect < 0) {
+      result = linect;
+   }
+   else {
+      Simmon_Config * config = calloc(1, sizeof(Simmon_Config));
+      for (int ndx = 0; ndx < lines->len; ndx++) {
+         if (!parse_control_line(config, g_ptr_array_index(lines, ndx), ndx+1, fn))
+            result = DDCRC_BAD_DATA;
+      }
+      if (result == 0) {
+         g_mutex_lock(&simmon_mutex);
+         free_simmon_config(simmon_config);
+         simmon_config = config;
+         if (simmon_fd_table)
+            g_hash_table_remove_all(simmon_fd_table);
+         if (simmon_rand)
+            g_rand_free(simmon_rand);
+         simmon_rand = g_rand_new_with_seed(config->seed);
+         g_mutex_unlock(&simmon_mutex);
+      }
+      else {
+         free_simmon_config(config);
+      }
+   }
+   g_ptr_array_free(lines, true);
+
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, result, "");
+   return result;
+}
+
+
+/** Reports whether a control file has been loaded */
+bool simmon_is_loaded() {
+   return simmon_config;
+}
+
+
+/** Discards the loaded settings and all pending responses. */
+void simmon_reset() {
+   g_mutex_lock(&simmon_mutex);
+   free_simmon_config(simmon_config);
+   simmon_config = NULL;
+   if (simmon_fd_table) {
+      g_hash_table_destroy(simmon_fd_table);
+      simmon_fd_table = NULL;
+   }
+   if (simmon_rand) {
+      g_rand_free(simmon_rand);
+      simmon_rand = NULL;
+   }
+   g_mutex_unlock(&simmon_mutex);
+}
+
+
+void dbgrpt_simulated_monitor(int depth) {
+   int d1 = depth+1;
+   g_mutex_lock(&simmon_mutex);
+   rpt_label(depth, "Simulated monitor:");
+   if (!simmon_config) {
+      rpt_label(d1, "Not loaded");
+   }
+   else {
+      rpt_vstring(d1, "latency:        %d millisec", simmon_config->latency_millis);
+      rpt_vstring(d1, "write_read_gap: %d millisec", simmon_config->write_read_gap_millis);
+      rpt_vstring(d1, "error_rate:     %4.3f",       simmon_config->error_rate);
+      rpt_vstring(d1, "seed:           %u",          simmon_config->seed);
+      rpt_vstring(d1, "capabilities:   %s",          simmon_config->capabilities);
+      for (int ndx = 0; ndx < 256; ndx++) {
+         Simmon_Feature * f = &simmon_config->features[ndx];
+         if (f->supported)
+            rpt_vstring(d1, "feature 0x%02x:   cur=%d, max=%d", ndx, f->cur_value, f->max_value);
+      }
+   }
+   g_mutex_unlock(&simmon_mutex);
+}
+
+
+//
+// Request processing
+//
+
+static void set_response(Simmon_Fd_State * state, Byte * data, int datalen) {
+   assert(datalen <= SIMMON_MAX_RESPONSE - 3);
+   state->response[0] = 0x6e;
+   state->response[1] = 0x80 | datalen;
+   if (datalen > 0)
+      memcpy(state->response+2, data, datalen);
+   // checksum covers the source address 0x6e and the virtual host address 0x50
+   state->response[2+datalen] = 0x50 ^ ddc_checksum(state->response, 2+datalen, false);
+   state->response_len = 3+datalen;
+}
+
+
+/** Builds the response, if any, to a request packet.
+ *  Must be called with simmon_mutex held.
+ *
+ *  @param state  response state for the bus
+ *  @param bytes  request bytes, starting with the source address 0x51
+ *  @param bytect number of bytes
+ */
+static void process_request(Simmon_Fd_State * state, Byte * bytes, int bytect) {
+   bool debug = false;
+   state->response_len = 0;
+   if (bytect < 3 || bytes[0] != 0x51)
+      return;
+   int datalen = bytes[1] & 0x7f;
+   if (bytect < 3 + datalen)
+      return;
+   Byte request[40] = {0x6e};
+   memcpy(request+1, bytes, 2+datalen);
+   if (ddc_checksum(request, 3+datalen, false) != bytes[2+datalen]) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Invalid request checksum");
+      return;
+   }
+
+   Byte * data = bytes+2;
+   Byte   reply[SIMMON_MAX_RESPONSE];
+   if (datalen == 2 && data[0] == 0x01) {           // Get VCP Feature
+      Simmon_Feature * f = &simmon_config->features[data[1]];
+      reply[0] = 0x02;
+      reply[1] = (f->supported) ? 0x00 : 0x01;
+      reply[2] = data[1];
+      reply[3] = 0x00;
+      reply[4] = f->max_value >> 8;
+      reply[5] = f->max_value & 0xff;
+      reply[6] = f->cur_value >> 8;
+      reply[7] = f->cur_value & 0xff;
+      set_response(state, reply, 8);
+   }
+   else if (datalen == 4 && data[0] == 0x03) {      // Set VCP Feature, no response
+      Simmon_Feature * f = &simmon_config->features[data[1]];
+      if (f->supported)
+         f->cur_value = data[2] << 8 | data[3];
+   }
+   else if (datalen == 3 && data[0] == 0xf3) {      // Capabilities Request
+      int offset = data[1] << 8 | data[2];
+      int capslen = (simmon_config->capabilities) ? strlen(simmon_config->capabilities) : 0;
+      int fraglen = (offset < capslen) ? MIN(capslen - offset, SIMMON_CAPS_FRAGMENT) : 0;
+      reply[0] = 0xe3;
+      reply[1] = data[1];
+      reply[2] = data[2];
+      if (fraglen > 0)
+         memcpy(reply+3, simmon_config->capabilities + offset, fraglen);
+      set_response(state, reply, 3+fraglen);
+   }
+   else if (datalen == 1 && data[0] == 0x0c) {      // Save Current Settings, no response
+   }
+   else {                                           // unsupported request
+      set_response(state, NULL, 0);                 // DDC Null Response
+   }
+}
+
+
+/** Copies the pending response, if any, to the read buffer.
+ *  Must be called with simmon_mutex held.
+ */
+static void read_response(Simmon_Fd_State * state, bool check_gap, int bytect, Byte * readbuf) {
+   bool debug = false;
+   memset(readbuf, 0, bytect);
+   if (check_gap && state->response_len > 0) {
+      uint64_t gap = cur_monotonic_nanosec() - state->request_nanos;
+      if (gap < simmon_config->write_read_gap_millis * (uint64_t) 1000000) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Read %"PRIu64" nanosec after write", gap);
+         set_response(state, NULL, 0);
+      }
+   }
+   if (state->response_len == 0)
+      set_response(state, NULL, 0);
+   memcpy(readbuf, state->response, MIN(bytect, state->response_len));
+   if (simmon_config->error_rate > 0 &&
+       g_rand_double(simmon_rand) < simmon_config->error_rate)
+   {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Simulating corrupted response");
+      int checksum_pos = state->response_len - 1;
+      if (checksum_pos < bytect)
+         readbuf[checksum_pos] ^= 0xff;
+   }
+   state->response_len = 0;
+}
+
+
+//
+// I2C IO strategy functions
+//
+
+// Returns true if requests to the slave address are handled by the simulated
+// monitor, setting *latency_loc to the configured response latency.
+static bool is_simulated(Byte slave_address, int * latency_loc) {
+   if (slave_address != SIMMON_DDC_ADDR)
+      return false;
+   g_mutex_lock(&simmon_mutex);
+   bool result = simmon_config;
+   if (result)
+      *latency_loc = simmon_config->latency_millis;
+   g_mutex_unlock(&simmon_mutex);
+   return result;
+}
+
+/** Writes a DDC request to the simulated monitor.
+ *  Writes to other slave addresses are passed to the ioctl strategy.
+ *
+ *  @param   fd              file descriptor for open /dev/i2c bus
+ *  @param   slave_address   slave address to write to
+ *  @param   bytect          number of bytes to write
+ *  @param   bytes_to_write  pointer to bytes to be written
+ *  @return  status code
+ */
+Status_Errno_DDC simmon_writer(
+      int    fd,
+      Byte   slave_address,
+      int    bytect,
+      Byte * bytes_to_write)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d, slave_address=0x%02x, bytect=%d",
+                                       fd, slave_address, bytect);
+   Status_Errno_DDC rc = 0;
+   int latency;
+   if (!is_simulated(slave_address, &latency)) {
+      rc = i2c_ioctl_writer(fd, slave_address, bytect, bytes_to_write);
+   }
+   else {
+      g_mutex_lock(&simmon_mutex);
+      if (simmon_config) {
+         Simmon_Fd_State * state = get_fd_state(fd);
+         process_request(state, bytes_to_write, bytect);
+         state->request_nanos = cur_monotonic_nanosec();
+      }
+      g_mutex_unlock(&simmon_mutex);
+   }
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
+   return rc;
+}
+
+
+/** Reads the response to the last request written to the simulated monitor.
+ *  Reads from other slave addresses are passed to the ioctl strategy.
+ *
+ *  @param   fd              file descriptor for open /dev/i2c bus
+ *  @param   slave_address   I2C slave address to read from
+ *  @param   read_bytewise   if true, read one byte at a time
+ *  @param   bytect          number of bytes to read
+ *  @param   readbuf         location where bytes will be read to
+ *  @return  status code
+ */
+Status_Errno_DDC simmon_reader(
+      int    fd,
+      Byte   slave_address,
+      bool   read_bytewise,
+      int    bytect,
+      Byte * readbuf)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d, slave_address=0x%02x, bytect=%d",
+                                       fd, slave_address, bytect);
+   Status_Errno_DDC rc = 0;
+   int latency;
+   if (!is_simulated(slave_address, &latency)) {
+      rc = i2c_ioctl_reader(fd, slave_address, read_bytewise, bytect, readbuf);
+   }
+   else {
+      if (latency > 0)
+         sleep_millis(latency);
+      g_mutex_lock(&simmon_mutex);
+      if (simmon_config)
+         read_response(get_fd_state(fd), true, bytect, readbuf);
+      g_mutex_unlock(&simmon_mutex);
+   }
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
+   return rc;
+}
+
+
+/** Writes a request to the simulated monitor and reads its response as a
+ *  single transaction.  The write to read gap is not checked.
+ *
+ *  @param   fd              file descriptor for open /dev/i2c bus
+ *  @param   slave_address   I2C slave address
+ *  @param   write_bytect    number of bytes to write
+ *  @param   bytes_to_write  pointer to bytes to be written
+ *  @param   read_bytect     number of bytes to read
+ *  @param   readbuf         location where bytes will be read to
+ *  @return  status code
+ */
+Status_Errno_DDC simmon_write_reader(
+      int    fd,
+      Byte   slave_address,
+      int    write_bytect,
+      Byte * bytes_to_write,
+      int    read_bytect,
+      Byte * readbuf)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fd=%d, slave_address=0x%02x, write_bytect=%d, read_bytect=%d",
+                                       fd, slave_address, write_bytect, read_bytect);
+   Status_Errno_DDC rc = 0;
+   int latency;
+   if (!is_simulated(slave_address, &latency)) {
+      rc = i2c_ioctl_write_reader(fd, slave_address, write_bytect, bytes_to_write,
+                                  read_bytect, readbuf);
+   }
+   else {
+      if (latency > 0)
+         sleep_millis(latency);
+      g_mutex_lock(&simmon_mutex);
+      if (simmon_config) {
+         Simmon_Fd_State * state = get_fd_state(fd);
+         process_request(state, bytes_to_write, write_bytect);
+         read_response(state, false, read_bytect, readbuf);
+      }
+      g_mutex_unlock(&simmon_mutex);
+   }
+   DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
+   return rc;
+}
+
+
+void init_i2c_simulated_monitor() {
+   RTTI_ADD_FUNC(simmon_load_control_file);
+   RTTI_ADD_FUNC(simmon_writer);
+   RTTI_ADD_FUNC(simmon_reader);
+   RTTI_ADD_FUNC(simmon_write_reader);
+}
@@ -0,0 +1,46 @@
+/** \file i2c_simulated_monitor.h
+ *
+ *  Virtual DDC/CI monitor used as an alternative I2C IO strategy,
+ *  so that performance measurements are repeatable.
+ */
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef I2C_SIMULATED_MONITOR_H_
+#define I2C_SIMULATED_MONITOR_H_
+
+#include <stdbool.h>
+
+#include "util/coredefs.h"
+
+#include "base/status_code_mgt.h"
+
+Status_Errno_DDC simmon_load_control_file(const char * fn);
+bool             simmon_is_loaded();
+void             simmon_reset();
+void             dbgrpt_simulated_monitor(int depth);
+
+Status_Errno_DDC simmon_writer(
+      int    fd,
+      Byte   slave_address,
+      int    bytect,
+      Byte * bytes_to_write);
+
+Status_Errno_DDC simmon_reader(
+      int    fd,
+      Byte   slave_address,
+      bool   read_bytewise,
+      int    bytect,
+      Byte * readbuf);
+
+Status_Errno_DDC simmon_write_reader(
+      int    fd,
+      Byte   slave_address,
+      int    write_bytect,
+      Byte * bytes_to_write,
+      int    read_bytect,
+      Byte * readbuf);
+
+void init_i2c_simulated_monitor();
+
+#endif /* I2C_SIMULATED_MONITOR_H_ */
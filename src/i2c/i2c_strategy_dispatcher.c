@@ -10,13 +10,18 @@
 #include <stdio.h>
 /** \endcond */
 
+#include "util/failsim.h"
 #include "util/file_util.h"
 #include "util/string_util.h"
+#include "util/timestamp.h"
 
 #include "base/core.h"
 #include "base/parms.h"
 #include "base/status_code_mgt.h"
 
+#include "i2c_io_trace.h"
+#include "i2c_simulated_monitor.h"
+
 #include "i2c_strategy_dispatcher.h"
 
 char * i2c_io_strategy_name(I2C_IO_Strategy_Id id) {
@@ -25,6 +30,12 @@ char * i2c_io_strategy_name(I2C_IO_Strategy_Id id) {
    case I2C_IO_STRATEGY_IOCTL:
       result = "I2C_IO_STRATEGY_IOCTL";
       break;
+   case I2C_IO_STRATEGY_SIMULATED:
+      result = "I2C_IO_STRATEGY_SIMULATED";
+      break;
+   case I2C_IO_STRATEGY_REPLAY:
+      result = "I2C_IO_STRATEGY_REPLAY";
+      break;
    }
    return result;
 }
@@ -35,6 +46,9 @@ bool EDID_Write_Before_Read          = DEFAULT_EDID_WRITE_BEFORE_READ;
 bool I2C_Read_Bytewise               = DEFAULT_I2C_READ_BYTEWISE;
 bool EDID_Read_Bytewise              = DEFAULT_EDID_READ_BYTEWISE;
 int  EDID_Read_Size                  = DEFAULT_EDID_READ_SIZE;
+bool EDID_Read_Uses_Sysfs            = DEFAULT_EDID_READ_USES_SYSFS;
+bool I2C_Combined_Write_Read         = DEFAULT_I2C_COMBINED_WRITE_READ;
+bool I2C_Auto_Write_Read             = DEFAULT_I2C_AUTO_WRITE_READ;
 
 
 
@@ -46,8 +60,30 @@ I2C_IO_Strategy i2c_ioctl_io_strategy = {
       I2C_IO_STRATEGY_IOCTL,
       i2c_ioctl_writer,
       i2c_ioctl_reader,
+      i2c_ioctl_write_reader,
       "ioctl_writer",
-      "ioctl_reader"
+      "ioctl_reader",
+      "ioctl_write_reader"
+};
+
+I2C_IO_Strategy i2c_simulated_io_strategy = {
+      I2C_IO_STRATEGY_SIMULATED,
+      simmon_writer,
+      simmon_reader,
+      simmon_write_reader,
+      "simmon_writer",
+      "simmon_reader",
+      "simmon_write_reader"
+};
+
+I2C_IO_Strategy i2c_replay_io_strategy = {
+      I2C_IO_STRATEGY_REPLAY,
+      i2c_replay_writer,
+      i2c_replay_reader,
+      i2c_replay_write_reader,
+      "replay_writer",
+      "replay_reader",
+      "replay_write_reader"
 };
 
 static I2C_IO_Strategy * i2c_io_strategy = &i2c_ioctl_io_strategy;
@@ -66,6 +102,14 @@ i2c_set_io_strategy(I2C_IO_Strategy_Id strategy_id) {
    case (I2C_IO_STRATEGY_IOCTL):
          i2c_io_strategy= &i2c_ioctl_io_strategy;
          break;
+
+   case (I2C_IO_STRATEGY_SIMULATED):
+         i2c_io_strategy= &i2c_simulated_io_strategy;
+         break;
+
+   case (I2C_IO_STRATEGY_REPLAY):
+         i2c_io_strategy= &i2c_replay_io_strategy;
+         break;
    }
    return old;
 }
@@ -93,6 +137,7 @@ Status_Errno_DDC invoke_i2c_writer(
       Byte * bytes_to_write)
 {
    bool debug = false;
+   FAILSIM;
    DBGTRC_STARTING(debug, TRACE_GROUP,
                  "fd=%d, filename=%s, slave_address=0x%02x, bytect=%d, bytes_to_write=%p -> %s",
                  fd,
@@ -103,8 +148,12 @@ Status_Errno_DDC invoke_i2c_writer(
                  hexstring_t(bytes_to_write, bytect));
 
    Status_Errno_DDC rc;
+   uint64_t start = (i2c_trace_is_recording()) ? cur_monotonic_nanosec() : 0;
    rc = i2c_io_strategy->i2c_writer(fd, slave_address, bytect, bytes_to_write );
    assert (rc <= 0);
+   if (start)
+      i2c_trace_record(I2C_TRACE_WRITE, fd, slave_address, start, rc,
+                       bytect, bytes_to_write, 0, NULL);
 
    DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
    return rc;
@@ -129,6 +178,7 @@ Status_Errno_DDC invoke_i2c_reader(
        Byte *     readbuf)
 {
      bool debug = false;
+     FAILSIM;
      DBGTRC_STARTING(debug, TRACE_GROUP,
                    "fd=%d, filename=%s, slave_address=0x%02x, bytect=%d, read_bytewise=%s, readbuf=%p",
                    fd,
@@ -139,8 +189,12 @@ Status_Errno_DDC invoke_i2c_reader(
                    readbuf);
 
      Status_Errno_DDC rc;
+     uint64_t start = (i2c_trace_is_recording()) ? cur_monotonic_nanosec() : 0;
      rc = i2c_io_strategy->i2c_reader(fd, slave_address, read_bytewise, bytect, readbuf);
      assert (rc <= 0);
+     if (start)
+        i2c_trace_record(I2C_TRACE_READ, fd, slave_address, start, rc,
+                         0, NULL, bytect, readbuf);
 
      if (rc == 0) {
         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Bytes read: %s", hexstring_t(readbuf, bytect) );
@@ -150,4 +204,50 @@ Status_Errno_DDC invoke_i2c_reader(
 }
 
 
+/** Writes to and then reads from the I2C bus as a single transaction,
+ *  using the function specified in the currently active strategy.
+ *
+ *  @param   fd              Linux file descriptor for open /dev/i2c bus
+ *  @param   slave_address   I2C slave address
+ *  @param   write_bytect    number of bytes to write
+ *  @param   bytes_to_write  pointer to bytes to be written
+ *  @param   read_bytect     number of bytes to read
+ *  @param   readbuf         location where bytes will be read to
+ *  @return  status code
+ */
+Status_Errno_DDC invoke_i2c_write_reader(
+       int        fd,
+       Byte       slave_address,
+       int        write_bytect,
+       Byte *     bytes_to_write,
+       int        read_bytect,
+       Byte *     readbuf)
+{
+     bool debug = false;
+     FAILSIM;
+     DBGTRC_STARTING(debug, TRACE_GROUP,
+                   "fd=%d, filename=%s, slave_address=0x%02x, write_bytect=%d, bytes_to_write=%p -> %s, read_bytect=%d, readbuf=%p",
+                   fd,
+                   filename_for_fd_t(fd),
+                   slave_address,
+                   write_bytect,
+                   bytes_to_write,
+                   hexstring_t(bytes_to_write, write_bytect),
+                   read_bytect,
+                   readbuf);
+
+     Status_Errno_DDC rc;
+     uint64_t start = (i2c_trace_is_recording()) ? cur_monotonic_nanosec() : 0;
+     rc = i2c_io_strategy->i2c_write_reader(
+                 fd, slave_address, write_bytect, bytes_to_write, read_bytect, readbuf);
+     assert (rc <= 0);
+     if (start)
+        i2c_trace_record(I2C_TRACE_WRITE_READ, fd, slave_address, start, rc,
+                         write_bytect, bytes_to_write, read_bytect, readbuf);
 
+     if (rc == 0) {
+        DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Bytes read: %s", hexstring_t(readbuf, read_bytect) );
+     }
+     DBGTRC_RET_DDCRC(debug, TRACE_GROUP, rc, "");
+     return rc;
+}
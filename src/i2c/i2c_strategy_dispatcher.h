@@ -15,10 +15,12 @@
 
 #include "i2c_execute.h"
 
-/** I2C IO strategy ids  - currently only 1 option*/
+/** I2C IO strategy ids */
 typedef enum {
-   I2C_IO_STRATEGY_IOCTL}     ///< use ioctl(I2C_RDWR)
-I2C_IO_Strategy_Id;
+   I2C_IO_STRATEGY_IOCTL,     ///< use ioctl(I2C_RDWR)
+   I2C_IO_STRATEGY_SIMULATED, ///< DDC/CI answered by simulated monitor
+   I2C_IO_STRATEGY_REPLAY     ///< replay recorded I2C trace
+} I2C_IO_Strategy_Id;
 
 char * i2c_io_strategy_name(I2C_IO_Strategy_Id id);
 
@@ -27,8 +29,10 @@ typedef struct {
    I2C_IO_Strategy_Id strategy_id;       ///< id of strategy
    I2C_Writer         i2c_writer;        ///< writer function
    I2C_Reader         i2c_reader;        ///< read function
+   I2C_Write_Reader   i2c_write_reader;  ///< combined write/read function
    char *             i2c_writer_name;   ///< write function name
    char *             i2c_reader_name;   ///< read function name
+   char *             i2c_write_reader_name;   ///< combined write/read function name
 } I2C_IO_Strategy;
 
 I2C_IO_Strategy_Id i2c_set_io_strategy(I2C_IO_Strategy_Id strategy_id);
@@ -40,6 +44,9 @@ extern bool I2C_Read_Bytewise;
 extern bool EDID_Read_Bytewise;
 extern bool EDID_Write_Before_Read;
 extern int  EDID_Read_Size;
+extern bool EDID_Read_Uses_Sysfs;
+extern bool I2C_Combined_Write_Read;
+extern bool I2C_Auto_Write_Read;
 
 
 Status_Errno_DDC
@@ -57,5 +64,14 @@ invoke_i2c_reader(
        int        bytect,
        Byte *     readbuf);
 
+Status_Errno_DDC
+invoke_i2c_write_reader(
+       int        fd,
+       Byte       slave_address,
+       int        write_bytect,
+       Byte *     bytes_to_write,
+       int        read_bytect,
+       Byte *     readbuf);
+
 
 #endif /* I2C_STRATEGY_DISPATCHER_H_ */
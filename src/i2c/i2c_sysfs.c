@@ -129,9 +129,31 @@ find_adapter_and_get_driver(char * path, int depth) {
  * Caller is responsible for freeing the returned string.
  */
 char * get_driver_for_busno(int busno) {
-   char path[PATH_MAX];
-   g_snprintf(path, PATH_MAX, "/sys/bus/i2c/devices/i2c-%d", busno);
-   char * result = find_adapter_and_get_driver(path, -1);
+   // same search as find_adapter_and_get_driver(), using the attribute snapshot
+   return get_i2c_device_sysfs_driver(busno);
+}
+
+
+/** Returns an identifier for the physical adapter of an I2C bus,
+ *  e.g. the PCI device of the video card.
+ *
+ *  For DisplayPort aux channels and MST displays the I2C bus belongs to
+ *  a DRM connector, so the connector part of the path is discarded.
+ *
+ * @param  busno   I2C bus number
+ * @return sysfs path of the adapter, NULL if it cannot be determined
+ *
+ * Caller is responsible for freeing the returned string.
+ */
+char * get_physical_adapter_for_busno(int busno) {
+   char workbuf[PATH_MAX];
+   g_snprintf(workbuf, PATH_MAX, "%s/sys/bus/i2c/devices/i2c-%d/device", fs_root_prefix(), busno);
+   char * result = realpath(workbuf, NULL);
+   if (result) {
+      char * drm_part = strstr(result, "/drm/");
+      if (drm_part)
+         *drm_part = '\0';
+   }
    return result;
 }
 
@@ -464,13 +486,13 @@ get_i2c_sys_info(
    char i2c_N[20];
    g_snprintf(i2c_N, 20, "i2c-%d", busno);
                                                // Example:
-   char   i2c_device_path[50];                 // /sys/bus/i2c/devices/i2c-13
+   char   i2c_device_path[PATH_MAX];           // /sys/bus/i2c/devices/i2c-13
    char * pci_i2c_device_path = NULL;          // /sys/devices/../card0/card0-DP-1/i2c-13
    char * pci_i2c_device_parent = NULL;        // /sys/devices/.../card0/card0-DP-1
 // char * connector_path = NULL;               // .../card0/card0-DP-1
 // char * drm_dp_aux_dir = NULL;               // .../card0/card0-DP-1/drm_dp_aux0
 // char * ddc_path_fn = NULL;                  // .../card0/card0-DP-1/ddc
-   g_snprintf(i2c_device_path, 50, "/sys/bus/i2c/devices/i2c-%d", busno);
+   g_snprintf(i2c_device_path, PATH_MAX, "%s/sys/bus/i2c/devices/i2c-%d", fs_root_prefix(), busno);
 
    if (directory_exists(i2c_device_path)) {
       result = calloc(1, sizeof(I2C_Sys_Info));
@@ -596,7 +618,8 @@ static void report_one_bus_i2c(
 
 void dbgrpt_sys_bus_i2c(int depth) {
    rpt_label(depth, "Examining /sys/bus/i2c/devices:");
-   dir_ordered_foreach("/sys/bus/i2c/devices", NULL, i2c_compare, report_one_bus_i2c, NULL, depth);
+   char dirbuf[PATH_MAX];
+   dir_ordered_foreach(fs_rooted_path("/sys/bus/i2c/devices", dirbuf, PATH_MAX), NULL, i2c_compare, report_one_bus_i2c, NULL, depth);
 }
 
 
@@ -828,8 +851,9 @@ GPtrArray * scan_sys_drm_connectors(int depth) {
    }
    GPtrArray * sys_drm_connectors = g_ptr_array_new_with_free_func(free_sys_drm_display);
 
+   char dirbuf[PATH_MAX];
    dir_filtered_ordered_foreach(
-         "/sys/class/drm",
+         fs_rooted_path("/sys/class/drm", dirbuf, PATH_MAX),
          is_drm_connector,      // filter function
          NULL,                  // ordering function
          one_drm_connector,
@@ -1018,7 +1042,8 @@ void collect_conflicting_drivers0(GPtrArray * conflicting_drivers, int busno, in
    DBGTRC_STARTING(debug, TRACE_GROUP, "busno=%d, conflicting_drivers=%p", busno, (void*)conflicting_drivers);
 
    char i2c_bus_path[PATH_MAX];
-   g_snprintf(i2c_bus_path, sizeof(i2c_bus_path), "/sys/bus/i2c/devices/i2c-%d", busno);
+   g_snprintf(i2c_bus_path, sizeof(i2c_bus_path), "%s/sys/bus/i2c/devices/i2c-%d",
+                                                  fs_root_prefix(), busno);
    char sbusno[4];
    g_snprintf(sbusno, 4, "%d", busno);
 
@@ -1209,8 +1234,9 @@ Sysfs_I2C_Info *  get_i2c_info(int busno, int depth) {
    DBGMSF(debug, "Looking for D-00hh match");
    char sbusno[4];
    g_snprintf(sbusno, 4, "%d",busno);
+   char dirbuf[PATH_MAX];
    dir_ordered_foreach_with_arg(
-         "/sys/bus/i2c/devices",
+         fs_rooted_path("/sys/bus/i2c/devices", dirbuf, PATH_MAX),
          predicate_exact_D_00hh, sbusno,
          NULL,               // compare func
          simple_one_n_nnnn,
@@ -1260,9 +1286,10 @@ GPtrArray * get_all_i2c_info(bool rescan, int depth) {
 
    if (!all_i2c_info) {
       GPtrArray * all = g_ptr_array_new_with_free_func(destroy_sysfs_i2c_info);
+      char dirbuf[PATH_MAX];
 
       dir_ordered_foreach(
-            "/sys/bus/i2c/devices",
+            fs_rooted_path("/sys/bus/i2c/devices", dirbuf, PATH_MAX),
             startswith_i2c,
             i2c_compare,
             simple_get_i2c_info,
@@ -14,6 +14,7 @@
 char * find_adapter(char * path, int depth);
 char * get_driver_for_adapter(char * adapter_path, int depth);
 char * get_driver_for_busno(int busno);
+char * get_physical_adapter_for_busno(int busno);
 
 typedef struct {
    int     busno;
@@ -22,31 +22,48 @@
 #include "util/file_util.h"
 #include "util/report_util.h"
 #include "util/sysfs_filter_functions.h"
+#include "util/timestamp.h"
 #include "util/xdg_util.h"
 
 #include "base/base_init.h"
 #include "base/build_info.h"
 #include "base/core.h"
 #include "base/core_per_thread_settings.h"
+#include "base/execution_stats.h"
+#include "base/latency_stats.h"
+#include "base/lock_stats.h"
 #include "base/parms.h"
 #include "base/per_thread_data.h"
+#include "base/stats_export.h"
 #include "base/thread_retry_data.h"
 #include "base/thread_sleep_data.h"
+#include "base/trace_ring.h"
 #include "base/tuned_sleep.h"
 
 #include "cmdline/cmd_parser.h"
 #include "cmdline/parsed_cmd.h"
 
 // #include "i2c/i2c_bus_core.h"   // for testing watch_devices
+#include "i2c/i2c_io_trace.h"
+#include "i2c/i2c_simulated_monitor.h"
+#include "i2c/i2c_strategy_dispatcher.h"
 
+#include "ddc/ddc_adaptive_verify.h"
+#include "ddc/ddc_async_requests.h"
 #include "ddc/ddc_common_init.h"
+#include "ddc/ddc_deadline.h"
 #include "ddc/ddc_display_lock.h"
 #include "ddc/ddc_displays.h"
+#include "ddc/ddc_io_scheduler.h"
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_power_state.h"
+#include "ddc/ddc_read_coalescing.h"
 #include "ddc/ddc_services.h"
 #include "ddc/ddc_try_stats.h"
 #include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_change_watch.h"
+#include "ddc/ddc_vcp_value_cache.h"
 #include "ddc/ddc_watch_displays.h"
 
 #include "libmain/api_error_info_internal.h"
@@ -64,6 +81,7 @@ DDCA_Api_Precondition_Failure_Mode
 ddca_set_precondition_failure_mode(
       DDCA_Api_Precondition_Failure_Mode failure_mode)
 {
+   API_TIMED();
    DDCA_Api_Precondition_Failure_Mode old = api_failure_mode;
    api_failure_mode = failure_mode;
    return old;
@@ -72,6 +90,7 @@ ddca_set_precondition_failure_mode(
 DDCA_Api_Precondition_Failure_Mode
 ddca_get_precondition_failure_mode()
 {
+   API_TIMED();
    return api_failure_mode;
 }
 
@@ -82,6 +101,7 @@ ddca_get_precondition_failure_mode()
 
 DDCA_Ddcutil_Version_Spec
 ddca_ddcutil_version(void) {
+   API_TIMED();
    static DDCA_Ddcutil_Version_Spec vspec = {255,255,255};
    static bool vspec_init = false;
 
@@ -104,6 +124,7 @@ ddca_ddcutil_version(void) {
  */
 const char *
 ddca_ddcutil_version_string(void) {
+   API_TIMED();
    return get_base_ddcutil_version();
 }
 
@@ -111,6 +132,7 @@ ddca_ddcutil_version_string(void) {
 // Returns the full ddcutil version as a string that may be suffixed with an extension
 const char *
 ddca_ddcutil_extended_version_string(void) {
+   API_TIMED();
    return get_full_ddcutil_version();
 }
 
@@ -118,6 +140,7 @@ ddca_ddcutil_extended_version_string(void) {
 // Indicates whether the ddcutil library was built with support for USB connected monitors. .
 bool
 ddca_built_with_usb(void) {
+   API_TIMED();
 #ifdef USE_USB
    return true;
 #else
@@ -132,6 +155,7 @@ ddca_built_with_usb(void) {
 
 DDCA_Build_Option_Flags
 ddca_build_options(void) {
+   API_TIMED();
    uint8_t result = 0x00;
 #ifdef USE_USB
          result |= DDCA_BUILT_WITH_USB;
@@ -260,6 +284,10 @@ bool library_initialized = false;
 /** Initializes the ddcutil library module.
  *
  *  Normally called automatically when the shared library is loaded.
+ *  Only settings are established here.  Subsystems that are expensive
+ *  to start, e.g. the thread that watches for display hotplug events,
+ *  the feature table index, and the persistent capabilities and device
+ *  id caches, are started on first use.
  *
  *  It is not an error if this function is called more than once.
  */
@@ -279,8 +307,10 @@ _ddca_init(void) {
       // signal(SIGTERM, dummy_sigterm_handler);
       // atexit(atexit_func);  // TESTING CLAEANUP
 #endif
-      init_base_services();
-      Parsed_Cmd* parsed_cmd = get_parsed_libmain_config();
+      RECORD_STARTUP_INIT(init_base_services);
+      Parsed_Cmd* parsed_cmd = NULL;
+      RECORD_STARTUP_PHASE("get_parsed_libmain_config",
+            parsed_cmd = get_parsed_libmain_config() );
       init_tracing(parsed_cmd);
 
       if (parsed_cmd->library_trace_file) {
@@ -317,8 +347,8 @@ _ddca_init(void) {
          free(trace_file);
       }
 
-      init_api_services();
-      submaster_initializer(parsed_cmd);
+      RECORD_STARTUP_INIT(init_api_services);
+      RECORD_STARTUP_PHASE("submaster_initializer", submaster_initializer(parsed_cmd) );
       free_parsed_cmd(parsed_cmd);
 
      //  explicitly set the async threshold for testing
@@ -331,7 +361,9 @@ _ddca_init(void) {
       // enable_report_ddc_errors(false);
 
       // dummy_display_change_handler() will issue messages if display is added or removed
-      ddc_start_watch_displays();
+      // The watch thread is started when displays are first detected, so that
+      // processes that load the library but never use a display do not pay for it.
+      ddc_request_watch_displays();
 
       library_initialized = true;
 
@@ -352,7 +384,8 @@ _ddca_init(void) {
 
 /** Cleanup at library termination
  *
- *  - Terminates thread that watches for display addition or removal.
+ *  - Terminates thread that watches for display addition or removal,
+ *    if it was started.
  *  - Releases heap memory to avoid error reports from memory analyzers.
  */
 void __attribute__ ((destructor))
@@ -362,9 +395,12 @@ _ddca_terminate(void) {
    if (library_initialized) {
       if (debug)
          dbgrpt_distinct_display_descriptors(2);
+      ddc_terminate_vcp_change_watch();
+      ddc_terminate_async_requests();
       ddc_discard_detected_displays();
       release_base_services();
       ddc_stop_watch_displays();
+      i2c_trace_stop_recording();
       free_regex_hash_table();
       library_initialized = false;
       if (flog)
@@ -385,6 +421,7 @@ _ddca_terminate(void) {
 
 DDCA_Error_Detail *
 ddca_get_error_detail() {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting");
 
@@ -401,11 +438,13 @@ ddca_get_error_detail() {
 
 void
 ddca_free_error_detail(DDCA_Error_Detail * ddca_erec) {
+   API_TIMED();
    free_error_detail(ddca_erec);
 }
 
 
 void ddca_report_error_detail(DDCA_Error_Detail * ddca_erec, int depth) {
+   API_TIMED();
    report_error_detail(ddca_erec, depth);
 }
 
@@ -421,6 +460,7 @@ void ddca_report_error_detail(DDCA_Error_Detail * ddca_erec, int depth) {
 
 const char *
 ddca_rc_name(DDCA_Status status_code) {
+   API_TIMED();
    char * result = NULL;
    Status_Code_Info * code_info = find_status_code_info(status_code);
    if (code_info)
@@ -431,6 +471,7 @@ ddca_rc_name(DDCA_Status status_code) {
 
 const char *
 ddca_rc_desc(DDCA_Status status_code) {
+   API_TIMED();
    char * result = "unknown status code";
    Status_Code_Info * code_info = find_status_code_info(status_code);
    if (code_info)
@@ -443,6 +484,7 @@ ddca_rc_desc(DDCA_Status status_code) {
 // TODO: make thread safe, wrap in mutex
 bool
 ddca_enable_error_info(bool enable) {
+   API_TIMED();
    bool old_value = report_freed_exceptions;
    report_freed_exceptions = enable;            // global in core.c
    return old_value;
@@ -455,6 +497,7 @@ ddca_enable_error_info(bool enable) {
 // Redirects output that normally would go to STDOUT
 void
 ddca_set_fout(FILE * fout) {
+   API_TIMED();
    // DBGMSG("Starting. fout=%p", fout);
    set_fout(fout);
 }
@@ -462,6 +505,7 @@ ddca_set_fout(FILE * fout) {
 
 void
 ddca_set_fout_to_default(void) {
+   API_TIMED();
    set_fout_to_default();
 }
 
@@ -469,12 +513,14 @@ ddca_set_fout_to_default(void) {
 // Redirects output that normally would go to STDERR
 void
 ddca_set_ferr(FILE * ferr) {
+   API_TIMED();
    set_ferr(ferr);
 }
 
 
 void
 ddca_set_ferr_to_default(void) {
+   API_TIMED();
    set_ferr_to_default();
 }
 
@@ -488,6 +534,7 @@ typedef struct {
    char * in_memory_bufstart; ;
    size_t in_memory_bufsize;
    DDCA_Capture_Option_Flags flags;
+   bool   discarding;           // DDCA_CAPTURE_DISCARD in effect
 } In_Memory_File_Desc;
 
 
@@ -512,9 +559,20 @@ get_thread_capture_buf_desc() {
 
 void
 ddca_start_capture(DDCA_Capture_Option_Flags flags) {
+   API_TIMED();
    In_Memory_File_Desc * fdesc = get_thread_capture_buf_desc();
 
-   if (!fdesc->in_memory_file) {
+   if (flags & DDCA_CAPTURE_DISCARD) {
+      if (!fdesc->in_memory_file && !fdesc->discarding) {
+         // a NULL destination makes the report functions skip formatting
+         ddca_set_fout(NULL);
+         fdesc->flags = flags;
+         fdesc->discarding = true;
+         if (flags & DDCA_CAPTURE_STDERR)
+            ddca_set_ferr(NULL);
+      }
+   }
+   else if (!fdesc->in_memory_file && !fdesc->discarding) {
       fdesc->in_memory_file = open_memstream(&fdesc->in_memory_bufstart, &fdesc->in_memory_bufsize);
       ddca_set_fout(fdesc->in_memory_file);   // n. ddca_set_fout() is thread specific
       fdesc->flags = flags;
@@ -527,11 +585,19 @@ ddca_start_capture(DDCA_Capture_Option_Flags flags) {
 
 char *
 ddca_end_capture(void) {
+   API_TIMED();
    In_Memory_File_Desc * fdesc = get_thread_capture_buf_desc();
    // In_Memory_File_Desc * fdesc = &in_memory_file_desc;
 
    char * result = "\0";
    // printf("(%s) Starting.\n", __func__);
+   if (fdesc->discarding) {
+      fdesc->discarding = false;
+      ddca_set_fout_to_default();
+      if (fdesc->flags & DDCA_CAPTURE_STDERR)
+         ddca_set_ferr_to_default();
+      return strdup(result);
+   }
    assert(fdesc->in_memory_file);
    if (fflush(fdesc->in_memory_file) < 0) {
       ddca_set_ferr_to_default();
@@ -566,6 +632,7 @@ ddca_end_capture(void) {
  *  @remark defined and tested but does not appear useful
  */
 int ddca_captured_size() {
+   API_TIMED();
    // printf("(%s) Starting.\n", __func__);
    In_Memory_File_Desc * fdesc = get_thread_capture_buf_desc();
 
@@ -587,30 +654,35 @@ int ddca_captured_size() {
 
 DDCA_Output_Level
 ddca_get_output_level(void) {
+   API_TIMED();
    return get_output_level();
 }
 
 
 DDCA_Output_Level
 ddca_set_output_level(DDCA_Output_Level newval) {
+   API_TIMED();
      return set_output_level(newval);
 }
 
 
 char *
 ddca_output_level_name(DDCA_Output_Level val) {
+   API_TIMED();
    return output_level_name(val);
 }
 
 
 bool
 ddca_enable_report_ddc_errors(bool onoff) {
+   API_TIMED();
    return enable_report_ddc_errors(onoff);
 }
 
 
 bool
 ddca_is_report_ddc_errors_enabled(void) {
+   API_TIMED();
    return is_report_ddc_errors_enabled();
 }
 
@@ -621,12 +693,14 @@ ddca_is_report_ddc_errors_enabled(void) {
 
 int
 ddca_max_max_tries(void) {
+   API_TIMED();
    return MAX_MAX_TRIES;
 }
 
 
 int
 ddca_get_max_tries(DDCA_Retry_Type retry_type) {
+   API_TIMED();
    // stats for multi part writes and reads are separate, but the
    // max tries for both are identical
 #ifndef NDEBUG
@@ -645,6 +719,7 @@ ddca_set_max_tries(
       DDCA_Retry_Type retry_type,
       int             max_tries)
 {
+   API_TIMED();
    DDCA_Status rc = 0;
    free_thread_error_detail();
    if (max_tries < 1 || max_tries > MAX_MAX_TRIES)
@@ -666,21 +741,268 @@ ddca_set_max_tries(
 
 bool
 ddca_enable_verify(bool onoff) {
+   API_TIMED();
    return ddc_set_verify_setvcp(onoff);
 }
 
 
 bool
 ddca_is_verify_enabled() {
+   API_TIMED();
    return ddc_get_verify_setvcp();
 }
 
+
+bool
+ddca_enable_adaptive_verify(bool onoff) {
+   API_TIMED();
+   return ddc_enable_adaptive_verify(onoff);
+}
+
+
+bool
+ddca_is_adaptive_verify_enabled() {
+   API_TIMED();
+   return ddc_is_adaptive_verify_enabled();
+}
+
+
+bool
+ddca_enable_setvcp_coalescing(bool onoff) {
+   API_TIMED();
+   return ddc_enable_setvcp_coalescing(onoff);
+}
+
+
+bool
+ddca_is_setvcp_coalescing_enabled() {
+   API_TIMED();
+   return ddc_is_setvcp_coalescing_enabled();
+}
+
+
+bool
+ddca_enable_read_coalescing(bool onoff) {
+   API_TIMED();
+   return ddc_enable_read_coalescing(onoff);
+}
+
+
+bool
+ddca_is_read_coalescing_enabled() {
+   API_TIMED();
+   return ddc_is_read_coalescing_enabled();
+}
+
+
+bool
+ddca_enable_vcp_value_cache(bool onoff) {
+   API_TIMED();
+   return ddc_enable_vcp_value_cache(onoff);
+}
+
+
+bool
+ddca_enable_table_value_memo(bool onoff) {
+   API_TIMED();
+   return ddc_enable_table_value_memo(onoff);
+}
+
+
+bool
+ddca_is_table_value_memo_enabled() {
+   API_TIMED();
+   return ddc_is_table_value_memo_enabled();
+}
+
+
+bool
+ddca_is_vcp_value_cache_enabled() {
+   API_TIMED();
+   return ddc_is_vcp_value_cache_enabled();
+}
+
+
+bool
+ddca_enable_power_state_tracking(bool onoff) {
+   API_TIMED();
+   return ddc_enable_power_state_tracking(onoff);
+}
+
+
+bool
+ddca_is_power_state_tracking_enabled() {
+   API_TIMED();
+   return ddc_is_power_state_tracking_enabled();
+}
+
+
+int
+ddca_set_fd_pool_idle_timeout(int millisec) {
+   API_TIMED();
+   return ddc_set_fd_pool_idle_timeout(millisec);
+}
+
+
+int
+ddca_get_fd_pool_idle_timeout() {
+   API_TIMED();
+   return ddc_get_fd_pool_idle_timeout();
+}
+
+
+DDCA_IO_Priority
+ddca_set_thread_io_priority(DDCA_IO_Priority priority) {
+   API_TIMED();
+   if (priority < DDCA_IO_PRIORITY_BACKGROUND || priority > DDCA_IO_PRIORITY_INTERACTIVE)
+      return ddc_get_thread_io_priority();
+   return ddc_set_thread_io_priority(priority);
+}
+
+
+DDCA_IO_Priority
+ddca_get_thread_io_priority() {
+   API_TIMED();
+   return ddc_get_thread_io_priority();
+}
+
+
+void
+ddca_set_thread_deadline(uint32_t millis) {
+   API_TIMED();
+   ddc_set_thread_deadline( (millis) ? cur_monotonic_nanosec() + millis * (uint64_t) 1000000 : 0);
+}
+
+
+static Cancel_Token *
+validated_cancel_token(DDCA_Cancel_Token token) {
+   Cancel_Token * ctok = (Cancel_Token *) token;
+   if (ctok && memcmp(ctok->marker, CANCEL_TOKEN_MARKER, 4) != 0)
+      ctok = NULL;
+   return ctok;
+}
+
+
+DDCA_Status
+ddca_create_cancel_token(DDCA_Cancel_Token * token_loc) {
+   API_TIMED();
+   free_thread_error_detail();
+   API_PRECOND(token_loc);
+   *token_loc = ddc_new_cancel_token();
+   return DDCRC_OK;
+}
+
+
+DDCA_Status
+ddca_free_cancel_token(DDCA_Cancel_Token token) {
+   API_TIMED();
+   free_thread_error_detail();
+   if (!token)
+      return DDCRC_OK;
+   Cancel_Token * ctok = validated_cancel_token(token);
+   if (!ctok)
+      return DDCRC_ARG;
+   ddc_free_cancel_token(ctok);
+   return DDCRC_OK;
+}
+
+
+DDCA_Status
+ddca_cancel(DDCA_Cancel_Token token) {
+   API_TIMED();
+   free_thread_error_detail();
+   Cancel_Token * ctok = validated_cancel_token(token);
+   if (!ctok)
+      return DDCRC_ARG;
+   ddc_cancel(ctok);
+   return DDCRC_OK;
+}
+
+
+DDCA_Cancel_Token
+ddca_set_thread_cancel_token(DDCA_Cancel_Token token) {
+   API_TIMED();
+   return ddc_set_thread_cancel_token(validated_cancel_token(token));
+}
+
+
+uint32_t
+ddca_set_display_lock_timeout(uint32_t millis) {
+   API_TIMED();
+   return ddc_set_display_lock_timeout(millis);
+}
+
+
+int
+ddca_set_max_transaction_rate(int per_sec) {
+   API_TIMED();
+   if (per_sec < 0)
+      return ddc_get_max_transaction_rate();
+   return ddc_set_max_transaction_rate(per_sec);
+}
+
+
+int
+ddca_get_max_transaction_rate() {
+   API_TIMED();
+   return ddc_get_max_transaction_rate();
+}
+
+
+int
+ddca_set_max_adapter_concurrency(int limit) {
+   API_TIMED();
+   if (limit < 0)
+      return ddc_get_max_adapter_concurrency();
+   return ddc_set_max_adapter_concurrency(limit);
+}
+
+
+int
+ddca_get_max_adapter_concurrency() {
+   API_TIMED();
+   return ddc_get_max_adapter_concurrency();
+}
+
+
+DDCA_Status
+ddca_enable_simulated_monitor(const char * control_fn) {
+   API_TIMED();
+   if (!control_fn) {
+      i2c_set_io_strategy(I2C_IO_STRATEGY_IOCTL);
+      simmon_reset();
+      return DDCRC_OK;
+   }
+   DDCA_Status rc = simmon_load_control_file(control_fn);
+   if (rc == DDCRC_OK)
+      i2c_set_io_strategy(I2C_IO_STRATEGY_SIMULATED);
+   return rc;
+}
+
+
+int
+ddca_set_save_settings_debounce(int millisec) {
+   API_TIMED();
+   if (millisec < 0)
+      return ddc_get_save_settings_debounce();
+   return ddc_set_save_settings_debounce(millisec);
+}
+
+
+int
+ddca_get_save_settings_debounce() {
+   API_TIMED();
+   return ddc_get_save_settings_debounce();
+}
+
 #ifdef NOT_NEEDED
 void ddca_lock_default_sleep_multiplier() {
+   API_TIMED();
    lock_default_sleep_multiplier();
 }
 
 void ddca_unlock_sleep_multiplier() {
+   API_TIMED();
    unlock_default_sleep_multiplier();
 }
 #endif
@@ -689,12 +1011,14 @@ void ddca_unlock_sleep_multiplier() {
 // deprecated, now a NOOP
 bool
 ddca_enable_sleep_suppression(bool newval) {
+   API_TIMED();
    return false;
 }
 
 // deprecated, now a NOOP
 bool
 ddca_is_sleep_suppression_enabled() {
+   API_TIMED();
    return false;
 }
 
@@ -702,6 +1026,7 @@ ddca_is_sleep_suppression_enabled() {
 double
 ddca_set_default_sleep_multiplier(double multiplier)
 {
+   API_TIMED();
    double result = tsd_get_default_sleep_multiplier_factor();
    tsd_set_default_sleep_multiplier_factor(multiplier);
    return result;
@@ -710,12 +1035,14 @@ ddca_set_default_sleep_multiplier(double multiplier)
 double
 ddca_get_default_sleep_multiplier()
 {
+   API_TIMED();
    return tsd_get_default_sleep_multiplier_factor();
 }
 
 void
 ddca_set_global_sleep_multiplier(double multiplier)
 {
+   API_TIMED();
    ddca_set_default_sleep_multiplier(multiplier);
    return;
 }
@@ -723,6 +1050,7 @@ ddca_set_global_sleep_multiplier(double multiplier)
 double
 ddca_get_global_sleep_multiplier()
 {
+   API_TIMED();
    return ddca_get_default_sleep_multiplier();
 }
 
@@ -730,6 +1058,7 @@ ddca_get_global_sleep_multiplier()
 double
 ddca_set_sleep_multiplier(double multiplier)
 {
+   API_TIMED();
    // bool debug = false;
    double result = tsd_get_sleep_multiplier_factor();
    // DBGMSF(debug, "Setting %5.2f", multiplier);
@@ -741,6 +1070,7 @@ ddca_set_sleep_multiplier(double multiplier)
 double
 ddca_get_sleep_multiplier()
 {
+   API_TIMED();
    // bool debug = false;
    // DBGMSF(debug, "Starting");
    double result = tsd_get_sleep_multiplier_factor();
@@ -758,6 +1088,7 @@ ddca_get_sleep_multiplier()
 int
 ddca_get_timeout_millis(
       DDCA_Timeout_Type timeout_type) {
+   API_TIMED();
    return 0;    // *** UNIMPLEMENTED ***
 }
 
@@ -770,6 +1101,7 @@ ddca_set_timeout_millis(
       DDCA_Timeout_Type timeout_type,
       int               millisec)
 {
+   API_TIMED();
    // *** UNIMPLEMENTED
 }
 #endif
@@ -777,12 +1109,14 @@ ddca_set_timeout_millis(
 
 bool
 ddca_enable_force_slave_address(bool onoff) {
+   API_TIMED();
    return false;
 }
 
 
 bool
 ddca_is_force_slave_address_enabled(void) {
+   API_TIMED();
    return false;
 }
 
@@ -793,36 +1127,42 @@ ddca_is_force_slave_address_enabled(void) {
 
 void
 ddca_add_traced_function(const char * funcname) {
+   API_TIMED();
    add_traced_function(funcname);
 }
 
 
 void
 ddca_add_traced_file(const char * filename) {
+   API_TIMED();
    add_traced_file(filename);
 }
 
 
 void
 ddca_set_trace_groups(DDCA_Trace_Group trace_flags) {
+   API_TIMED();
    set_trace_groups(trace_flags);
 }
 
 
 void
 ddca_add_trace_groups(DDCA_Trace_Group trace_flags) {
+   API_TIMED();
    add_trace_groups(trace_flags);
 }
 
 
 DDCA_Trace_Group
 ddca_trace_group_name_to_value(char * name) {
+   API_TIMED();
    return trace_class_name_to_value(name);
 }
 
 
 void
 ddca_set_trace_options(DDCA_Trace_Options  options) {
+   API_TIMED();
    // DBGMSG("options = 0x%02x", options);
    // global variables in core.c
 
@@ -835,6 +1175,20 @@ ddca_set_trace_options(DDCA_Trace_Options  options) {
 }
 
 
+bool
+ddca_enable_trace_events(bool onoff) {
+   API_TIMED();
+   return enable_trace_ring(onoff);
+}
+
+
+void
+ddca_report_trace_events(int depth) {
+   API_TIMED();
+   report_trace_ring(depth);
+}
+
+
 //
 // Statistics
 //
@@ -845,6 +1199,7 @@ ddca_set_trace_options(DDCA_Trace_Options  options) {
 #ifdef UNUSED
 void
 ddca_register_thread_dref(DDCA_Display_Ref dref) {
+   API_TIMED();
    ptd_register_thread_dref( (Display_Ref *) dref);
 }
 #endif
@@ -853,6 +1208,7 @@ void
 ddca_set_thread_description(
       const char * description)
 {
+   API_TIMED();
    ptd_set_thread_description( description );
 }
 
@@ -860,29 +1216,106 @@ void
 ddca_append_thread_description(
       const char * description)
 {
+   API_TIMED();
    ptd_append_thread_description(description);
 }
 
 const char *
 ddca_get_thread_descripton() {
+   API_TIMED();
    return ptd_get_thread_description_t();
 }
 
 void
 ddca_reset_stats(void) {
+   API_TIMED();
    // DBGMSG("Executing");
    ddc_reset_stats_main();
 }
 
-// TODO: Functions that return stats in data structures
 void
 ddca_show_stats(
       DDCA_Stats_Type stats_types,
       bool            by_thread,
       int             depth)
 {
+   API_TIMED();
    if (stats_types)
       ddc_report_stats_main( stats_types, by_thread, depth);
 }
 
+DDCA_Status
+ddca_get_stats(
+      DDCA_Stats_Snapshot ** snapshot_loc)
+{
+   API_TIMED();
+   free_thread_error_detail();
+   API_PRECOND(snapshot_loc);
+   *snapshot_loc = get_latency_stats_snapshot();
+   return DDCRC_OK;
+}
+
+void
+ddca_free_stats(
+      DDCA_Stats_Snapshot * snapshot)
+{
+   API_TIMED();
+   free_latency_stats_snapshot(snapshot);
+}
+
+DDCA_Status
+ddca_export_stats(
+      DDCA_Stats_Export_Format format,
+      char **                  text_loc)
+{
+   API_TIMED();
+   free_thread_error_detail();
+   API_PRECOND(text_loc);
+   API_PRECOND(format == DDCA_STATS_FORMAT_JSON || format == DDCA_STATS_FORMAT_PROMETHEUS);
+   *text_loc = ddc_export_stats_main(format);
+   return DDCRC_OK;
+}
+
+DDCA_Status
+ddca_create_stats_cursor(
+      DDCA_Stats_Cursor *      cursor_loc)
+{
+   API_TIMED();
+   free_thread_error_detail();
+   API_PRECOND(cursor_loc);
+   *cursor_loc = ddc_new_stats_cursor();
+   return DDCRC_OK;
+}
+
+DDCA_Status
+ddca_export_stats_delta(
+      DDCA_Stats_Cursor        cursor,
+      DDCA_Stats_Export_Format format,
+      bool                     advance,
+      char **                  text_loc)
+{
+   API_TIMED();
+   free_thread_error_detail();
+   API_PRECOND(stats_cursor_is_valid(cursor));
+   API_PRECOND(text_loc);
+   API_PRECOND(format == DDCA_STATS_FORMAT_JSON || format == DDCA_STATS_FORMAT_PROMETHEUS);
+   *text_loc = ddc_export_stats_delta(cursor, format, advance);
+   return DDCRC_OK;
+}
+
+void
+ddca_free_stats_cursor(
+      DDCA_Stats_Cursor        cursor)
+{
+   API_TIMED();
+   if (stats_cursor_is_valid(cursor))
+      stats_cursor_free(cursor);
+}
+
+bool
+ddca_enable_lock_stats(bool onoff) {
+   API_TIMED();
+   return enable_lock_stats(onoff);
+}
+
 
@@ -16,6 +16,8 @@
 #include "public/ddcutil_status_codes.h"
 #include "public/ddcutil_c_api.h"
 
+#include "base/api_call_stats.h"
+
 #define DDCA_PRECOND_STDERR 0x01
 #define DDCA_PRECOND_RETURN 0x02
 
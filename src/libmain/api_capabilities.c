@@ -28,6 +28,7 @@
 
 #include "vcp/parse_capabilities.h"
 #include "vcp/parsed_capabilities_feature.h"
+#include "vcp/persistent_capabilities.h"
 #include "vcp/vcp_feature_codes.h"
 
 #include "dynvcp/dyn_feature_codes.h"
@@ -53,6 +54,7 @@ ddca_get_capabilities_string(
       DDCA_Display_Handle  ddca_dh,
       char**               pcaps_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%s", dh_repr((Display_Handle *) ddca_dh ) );
    free_thread_error_detail();
@@ -123,11 +125,70 @@ dbgrpt_ddca_capabilities(DDCA_Capabilities * p_caps, int depth) {
 }
 
 
+/** Creates a #DDCA_Capabilities from the serialized form of a parsed
+ *  capabilities string, without parsing the string again.
+ *
+ *  @param  capabilities_string  capabilities string
+ *  @param  serialized           value from #serialize_parsed_capabilities()
+ *  @return newly allocated #DDCA_Capabilities, NULL if **serialized** is malformed
+ */
+static DDCA_Capabilities *
+ddca_capabilities_from_serialized(char * capabilities_string, Buffer * serialized) {
+   API_TIMED();
+   bool debug = false;
+   Byte * bytes = serialized->bytes;
+   int    len   = serialized->len;
+   if (len < 5 || bytes[0] != SERIALIZED_CAPABILITIES_VERSION || len < 5 + bytes[3]) {
+      DBGMSF(debug, "Invalid header");
+      return NULL;
+   }
+
+   DDCA_Capabilities * result = calloc(1, sizeof(DDCA_Capabilities));
+   memcpy(result->marker, DDCA_CAPABILITIES_MARKER, 4);
+   result->unparsed_string = strdup(capabilities_string);
+   result->version_spec.major = bytes[1];
+   result->version_spec.minor = bytes[2];
+   result->cmd_ct = bytes[3];
+   if (result->cmd_ct > 0) {
+      result->cmd_codes = malloc(result->cmd_ct);
+      memcpy(result->cmd_codes, bytes+4, result->cmd_ct);
+   }
+   int pos = 4 + result->cmd_ct;
+   result->vcp_code_ct = bytes[pos++];
+   result->vcp_codes = calloc(result->vcp_code_ct, sizeof(DDCA_Cap_Vcp));
+   bool ok = true;
+   for (int ndx = 0; ndx < result->vcp_code_ct; ndx++) {
+      DDCA_Cap_Vcp * cur_cap_vcp = &result->vcp_codes[ndx];
+      memcpy(cur_cap_vcp->marker, DDCA_CAP_VCP_MARKER, 4);
+      if (!ok)
+         continue;     // keep markers consistent for ddca_free_parsed_capabilities()
+      if (pos + 2 > len || pos + 2 + bytes[pos+1] > len) {
+         ok = false;
+         continue;
+      }
+      cur_cap_vcp->feature_code = bytes[pos];
+      cur_cap_vcp->value_ct     = bytes[pos+1];
+      if (cur_cap_vcp->value_ct > 0) {
+         cur_cap_vcp->values = malloc(cur_cap_vcp->value_ct);
+         memcpy(cur_cap_vcp->values, bytes+pos+2, cur_cap_vcp->value_ct);
+      }
+      pos += 2 + cur_cap_vcp->value_ct;
+   }
+   if (!ok || pos != len) {
+      DBGMSF(debug, "Invalid feature table");
+      ddca_free_parsed_capabilities(result);
+      result = NULL;
+   }
+   return result;
+}
+
+
 DDCA_Status
 ddca_parse_capabilities_string(
       char *                   capabilities_string,
       DDCA_Capabilities **     parsed_capabilities_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "parsed_capabilities_loc=%p, capabilities_string: |%s|",
                                        parsed_capabilities_loc, capabilities_string);
@@ -138,8 +199,19 @@ ddca_parse_capabilities_string(
    DBGMSF(debug, "ddcrc initialized to %s", psc_desc(ddcrc));
    DDCA_Capabilities * result = NULL;
 
+   if (capabilities_string) {
+      Buffer * serialized = get_persistent_parsed_capabilities(capabilities_string);
+      if (serialized) {
+         result = ddca_capabilities_from_serialized(capabilities_string, serialized);
+         buffer_free(serialized, NULL);
+         DBGMSF(debug, "Serialized parsed capabilities found, result=%p", result);
+         if (result)
+            ddcrc = 0;
+      }
+   }
+
    // need to control messages?
-   Parsed_Capabilities * pcaps = parse_capabilities_string(capabilities_string);
+   Parsed_Capabilities * pcaps = (result) ? NULL : parse_capabilities_string(capabilities_string);
    if (pcaps) {
       if (debug) {
          DBGMSG("Parsing succeeded: ");
@@ -151,22 +223,23 @@ ddca_parse_capabilities_string(
       result->unparsed_string = strdup(capabilities_string);     // needed?
       result->version_spec = pcaps->parsed_mccs_version;
       DBGMSF(debug, "version: %d.%d", result->version_spec.major,  result->version_spec.minor);
-      Byte_Value_Array bva = pcaps->commands;
+      Byte_Value_Array bva = parsed_capabilities_commands(pcaps);
       if (bva) {
          result->cmd_ct = bva_length(bva);
          result->cmd_codes = malloc(result->cmd_ct);
          memcpy(result->cmd_codes, bva_bytes(bva), result->cmd_ct);
       }
       // n. needen't set vcp_code_ct if !pcaps, calloc() has done it
-      if (pcaps->vcp_features) {
-         result->vcp_code_ct = pcaps->vcp_features->len;
+      GPtrArray * vcp_features = parsed_capabilities_vcp_features(pcaps);
+      if (vcp_features) {
+         result->vcp_code_ct = vcp_features->len;
          result->vcp_codes = calloc(result->vcp_code_ct, sizeof(DDCA_Cap_Vcp));
          DBGMSF(debug, "allocate %d bytes at %p", result->vcp_code_ct * sizeof(DDCA_Cap_Vcp), result->vcp_codes);
          for (int ndx = 0; ndx < result->vcp_code_ct; ndx++) {
             DDCA_Cap_Vcp * cur_cap_vcp = &result->vcp_codes[ndx];
             DBGMSF(debug, "cur_cap_vcp = %p", &result->vcp_codes[ndx]);
             memcpy(cur_cap_vcp->marker, DDCA_CAP_VCP_MARKER, 4);
-            Capabilities_Feature_Record * cur_cfr = g_ptr_array_index(pcaps->vcp_features, ndx);
+            Capabilities_Feature_Record * cur_cfr = g_ptr_array_index(vcp_features, ndx);
             DBGMSF(debug, "Capabilities_Feature_Record * cur_cfr = %p", cur_cfr);
             assert(memcmp(cur_cfr->marker, CAPABILITIES_FEATURE_MARKER, 4) == 0);
             if (debug)
@@ -178,7 +251,7 @@ ddca_parse_capabilities_string(
             // cur_cap_vcp->raw_values = strdup(cur_cfr->value_string);
             // TODO: get values from Byte_Bit_Flags cur_cfr->bbflags
 #ifdef CFR_BVA
-            Byte_Value_Array bva = cur_cfr->values;
+            Byte_Value_Array bva = cfr_get_values(cur_cfr);
             if (bva) {
                cur_cap_vcp->value_ct = bva_length(bva);
                cur_cap_vcp->values = calloc( cur_cap_vcp->value_ct, sizeof(Byte));
@@ -205,6 +278,12 @@ ddca_parse_capabilities_string(
          result->messages = g_ptr_array_to_ntsa(pcaps->messages, /*duplicate=*/ true);
       }
 
+      Buffer * serialized = serialize_parsed_capabilities(pcaps);
+      if (serialized) {
+         set_persistent_parsed_capabilities(capabilities_string, serialized);
+         buffer_free(serialized, NULL);
+      }
+
       ddcrc = 0;
       free_parsed_capabilities(pcaps);
    }
@@ -224,6 +303,7 @@ void
 ddca_free_parsed_capabilities(
       DDCA_Capabilities * pcaps)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "pcaps=%p", pcaps);
    if (pcaps) {
@@ -252,6 +332,7 @@ ddca_report_parsed_capabilities_by_dref(
       DDCA_Display_Ref         ddca_dref,
       int                      depth)
 {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting. p_caps=%p, ddca_dref=%s", p_caps, dref_repr_t((Display_Ref*) ddca_dref));
 
@@ -355,6 +436,7 @@ ddca_report_parsed_capabilities(
       DDCA_Capabilities *      p_caps,
       int                      depth)
 {
+   API_TIMED();
    ddca_report_parsed_capabilities_by_dref(p_caps, NULL, depth);
 }
 
@@ -365,6 +447,7 @@ ddca_report_parsed_capabilities_by_dh(
       DDCA_Display_Handle      ddca_dh,
       int                      depth)
 {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting. p_caps=%p, ddca_dh=%s, depth=%d", p_caps, ddca_dh_repr(ddca_dh), depth);
    DDCA_Status ddcrc = 0;
@@ -379,11 +462,13 @@ ddca_report_parsed_capabilities_by_dh(
 
    // Ensure dh->dref->vcp_version is not unqueried,
    // ddca_report_parsed_capabilities_by_dref() will fail trying to lock the already open device
+   g_rec_mutex_lock(&dh->io_mutex);
    get_vcp_version_by_dh(dh);
    DBGMSF(debug, "After get_vcp_version_by_dh(), dh->dref->vcp_version_df=%s",
                  format_vspec_verbose(dh->dref->vcp_version_xdf));
 
    ddca_report_parsed_capabilities_by_dref(p_caps, dh->dref, depth);
+   g_rec_mutex_unlock(&dh->io_mutex);
 
 bye:
    DBGMSF(debug, "Done.     Returning %s", ddca_rc_desc(ddcrc));
@@ -398,6 +483,7 @@ ddca_parse_and_report_capabilities(
       DDCA_Display_Ref          dref,
       int                       depth)
 {
+   API_TIMED();
       Parsed_Capabilities* pcaps = parse_capabilities_string(capabilities_string);
       dyn_report_parsed_capabilities(pcaps, NULL, dref, 0);
       free_parsed_capabilities(pcaps);
@@ -408,6 +494,7 @@ DDCA_Feature_List
 ddca_feature_list_from_capabilities(
       DDCA_Capabilities * parsed_caps)
 {
+   API_TIMED();
    DDCA_Feature_List result = {{0}};
    for (int ndx = 0; ndx < parsed_caps->vcp_code_ct; ndx++) {
       DDCA_Cap_Vcp curVcp = parsed_caps->vcp_codes[ndx];
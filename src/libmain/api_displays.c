@@ -19,8 +19,11 @@
 #include "util/string_util.h"
 
 #include "base/core.h"
+#include "base/display_health.h"
 #include "base/displays.h"
 #include "base/monitor_model_key.h"
+#include "base/parms.h"
+#include "base/thread_sleep_data.h"
 
 #include "i2c/i2c_sysfs.h"
 
@@ -28,7 +31,10 @@
 #include "ddc/ddc_display_ref_reports.h"
 #include "ddc/ddc_display_selection.h"
 #include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_try_stats.h"
+#include "ddc/ddc_vcp_value_cache.h"
 #include "ddc/ddc_vcp_version.h"
+#include "ddc/ddc_watch_displays.h"
 
 #include "libmain/api_base_internal.h"
 #include "libmain/api_error_info_internal.h"
@@ -73,14 +79,28 @@ void dbgrpt_display_info_list(DDCA_Display_Info_List * dlist, int depth);
 
 DDCA_Status
 ddca_enable_usb_display_detection(bool onoff) {
+   API_TIMED();
    return ddc_enable_usb_display_detection(onoff);
 }
 
 bool
 ddca_ddca_is_usb_display_detection_enabled() {
+   API_TIMED();
    return ddc_is_usb_display_detection_enabled();
 }
 
+DDCA_Status
+ddca_enable_edid_only_detection(bool onoff) {
+   API_TIMED();
+   return ddc_enable_edid_only_detection(onoff);
+}
+
+bool
+ddca_is_edid_only_detection_enabled() {
+   API_TIMED();
+   return ddc_is_edid_only_detection_enabled();
+}
+
 
 //
 // Display Identifiers
@@ -91,6 +111,7 @@ ddca_create_dispno_display_identifier(
       int                      dispno,
       DDCA_Display_Identifier* did_loc)
 {
+   API_TIMED();
    free_thread_error_detail();
    // assert(did_loc);
    API_PRECOND(did_loc);
@@ -106,6 +127,7 @@ ddca_create_busno_display_identifier(
       int busno,
       DDCA_Display_Identifier* did_loc)
 {
+   API_TIMED();
    free_thread_error_detail();
    // assert(did_loc);
    API_PRECOND(did_loc);
@@ -123,6 +145,7 @@ ddca_create_mfg_model_sn_display_identifier(
       const char*              serial_ascii,
       DDCA_Display_Identifier* did_loc)
 {
+   API_TIMED();
    free_thread_error_detail();
    // assert(did_loc);
    API_PRECOND(did_loc);
@@ -160,6 +183,7 @@ ddca_create_edid_display_identifier(
       const Byte *              edid,
       DDCA_Display_Identifier * did_loc)    // 128 byte EDID
 {
+   API_TIMED();
    // assert(did_loc);
    free_thread_error_detail();
    API_PRECOND(did_loc);
@@ -183,6 +207,7 @@ ddca_create_usb_display_identifier(
       int                      device,
       DDCA_Display_Identifier* did_loc)
 {
+   API_TIMED();
    // assert(did_loc);
    free_thread_error_detail();
    API_PRECOND(did_loc);
@@ -198,6 +223,7 @@ ddca_create_usb_hiddev_display_identifier(
       int                      hiddev_devno,
       DDCA_Display_Identifier* did_loc)
 {
+   API_TIMED();
    // assert(did_loc);
    free_thread_error_detail();
    API_PRECOND(did_loc);
@@ -212,6 +238,7 @@ DDCA_Status
 ddca_free_display_identifier(
       DDCA_Display_Identifier did)
 {
+   API_TIMED();
    free_thread_error_detail();
    DDCA_Status rc = 0;
    Display_Identifier * pdid = (Display_Identifier *) did;
@@ -227,6 +254,7 @@ ddca_free_display_identifier(
 
 const char *
 ddca_did_repr(DDCA_Display_Identifier ddca_did) {
+   API_TIMED();
    // DBGMSG("Starting.  ddca_did=%p", ddca_did);
    char * result = NULL;
    Display_Identifier * pdid = (Display_Identifier *) ddca_did;
@@ -247,6 +275,7 @@ ddca_get_display_ref(
       DDCA_Display_Identifier did,
       DDCA_Display_Ref*       dref_loc)
 {
+   API_TIMED();
    free_thread_error_detail();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "did=%p, dref_loc=%p", did, dref_loc);
@@ -256,14 +285,17 @@ ddca_get_display_ref(
    DDCA_Status rc = 0;
    *dref_loc = NULL;
 
-   ddc_ensure_displays_detected();
-
    Display_Identifier * pdid = (Display_Identifier *) did;
    if (!pdid || memcmp(pdid->marker, DISPLAY_IDENTIFIER_MARKER, 4) != 0 )  {
      rc = DDCRC_ARG;
    }
    else {
-      Display_Ref* dref = get_display_ref_for_display_identifier(pdid, CALLOPT_ERR_MSG);
+      // a bus number or EDID identifier can be resolved without detecting all displays
+      Display_Ref* dref = ddc_get_targeted_display_ref(pdid);
+      if (!dref) {
+         ddc_ensure_displays_detected();
+         dref = get_display_ref_for_display_identifier(pdid, CALLOPT_ERR_MSG);
+      }
       if (debug)
          DBGMSG("get_display_ref_for_display_identifier() returned %p", dref);
       if (dref)
@@ -283,6 +315,7 @@ ddca_create_display_ref(
       DDCA_Display_Identifier did,
       DDCA_Display_Ref*       dref_loc)
 {
+   API_TIMED();
    return ddca_get_display_ref(did, dref_loc);
 }
 
@@ -290,6 +323,7 @@ ddca_create_display_ref(
 // deprecated, not needed, in library there are no transient display refs
 DDCA_Status
 ddca_free_display_ref(DDCA_Display_Ref ddca_dref) {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dref=%p", ddca_dref);
    DDCA_Status psc = 0;
@@ -309,6 +343,7 @@ ddca_free_display_ref(DDCA_Display_Ref ddca_dref) {
 
 DDCA_Status
 ddca_redetect_displays() {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "");
    ddc_redetect_displays();
@@ -317,10 +352,55 @@ ddca_redetect_displays() {
 }
 
 
+DDCA_Status
+ddca_register_display_status_callback(
+      DDCA_Display_Status_Callback_Func func)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "func=%p", func);
+   free_thread_error_detail();
+   API_PRECOND(func);
+   DDCA_Status ddcrc = ddc_register_display_status_callback(func);
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "");
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_unregister_display_status_callback(
+      DDCA_Display_Status_Callback_Func func)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "func=%p", func);
+   free_thread_error_detail();
+   DDCA_Status ddcrc = ddc_unregister_display_status_callback(func);
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "");
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_start_display_detection(
+      DDCA_Display_Detection_Callback_Func func)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "func=%p", func);
+   free_thread_error_detail();
+   API_PRECOND(func);
+   DDCA_Status ddcrc = ddc_start_display_detection(func);
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "");
+   return ddcrc;
+}
+
+
 // static char dref_work_buf[100];
 
 const char *
 ddca_dref_repr(DDCA_Display_Ref ddca_dref) {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting.  ddca_dref = %p", ddca_dref);
    char * result = NULL;
@@ -353,6 +433,7 @@ ddca_dbgrpt_display_ref(
       DDCA_Display_Ref ddca_dref,
       int              depth)
 {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting.  ddca_dref = %p, depth=%d", ddca_dref, depth);
    Display_Ref * dref = validated_ddca_display_ref(ddca_dref);
@@ -367,6 +448,7 @@ ddca_report_display_by_dref(
       DDCA_Display_Ref ddca_dref,
       int              depth)
 {
+   API_TIMED();
    DBGTRC_STARTING(false, DDCA_TRC_API, "ddca_dref=%p", ddca_dref);
    free_thread_error_detail();
    DDCA_Status rc = 0;
@@ -392,6 +474,7 @@ ddca_open_display(
       DDCA_Display_Ref      ddca_dref,
       DDCA_Display_Handle * dh_loc)
 {
+   API_TIMED();
    return ddca_open_display2(ddca_dref, false, dh_loc);
 }
 
@@ -416,6 +499,7 @@ ddca_open_display3(
       DDCA_Open_Options     options,
       DDCA_Display_Handle * dh_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API,
           "ddca_dref=%p, options=0x%02x, dh_loc=%p, on thread %d",
@@ -425,7 +509,6 @@ ddca_open_display3(
           sbool(library_initialized), ddc_displays_already_detected());
    free_thread_error_detail();
    TRACED_ASSERT(library_initialized);
-   TRACED_ASSERT(ddc_displays_already_detected());
 
    API_PRECOND(dh_loc);
 
@@ -464,6 +547,7 @@ ddca_open_display2(
       bool                  wait,
       DDCA_Display_Handle * dh_loc)
 {
+   API_TIMED();
    return ddca_open_display3(ddca_dref,
                              (wait) ? DDCA_OPENOPT_WAIT : DDCA_OPENOPT_NONE,
                              dh_loc);
@@ -472,6 +556,7 @@ ddca_open_display2(
 
 DDCA_Status
 ddca_close_display(DDCA_Display_Handle ddca_dh) {
+   API_TIMED();
    bool debug = false;
    free_thread_error_detail();
    assert(library_initialized);
@@ -498,6 +583,7 @@ ddca_close_display(DDCA_Display_Handle ddca_dh) {
 
 const char *
 ddca_dh_repr(DDCA_Display_Handle ddca_dh) {
+   API_TIMED();
    char * repr = NULL;
    Display_Handle * dh = (Display_Handle *) ddca_dh;
    if (valid_display_handle(dh))
@@ -510,6 +596,7 @@ DDCA_Display_Ref
 ddca_display_ref_from_handle(
       DDCA_Display_Handle   ddca_dh)
 {
+   API_TIMED();
    DDCA_Display_Ref result = NULL;
    Display_Handle * dh = (Display_Handle *) ddca_dh;
    if (valid_display_handle(dh))
@@ -523,6 +610,7 @@ ddca_get_mccs_version_by_dh(
       DDCA_Display_Handle     ddca_dh,
       DDCA_MCCS_Version_Spec* p_spec)
 {
+   API_TIMED();
    free_thread_error_detail();
    assert(library_initialized);
    DDCA_Status rc = 0;
@@ -550,6 +638,7 @@ ddca_get_mccs_version_with_default(
       DDCA_MCCS_Version_Spec  default_spec,
       DDCA_MCCS_Version_Spec* p_spec)
 {
+   API_TIMED();
    DDCA_Status rc = ddca_get_mccs_version_by_dh(ddca_dh, p_spec);
    if (rc == 0 && vcp_version_eq(*p_spec, DDCA_VSPEC_UNKNOWN))
       *p_spec = default_spec;
@@ -567,6 +656,7 @@ ddca_get_mccs_version_id(
       DDCA_Display_Handle    ddca_dh,
       DDCA_MCCS_Version_Id*  p_id)
 {
+   API_TIMED();
    DDCA_MCCS_Version_Spec vspec;
    DDCA_Status rc = ddca_get_mccs_version_by_dh(ddca_dh, &vspec);
    if (rc == 0) {
@@ -582,6 +672,7 @@ ddca_get_mccs_version_id(
 
 char *
 ddca_mccs_version_id_name(DDCA_MCCS_Version_Id version_id) {
+   API_TIMED();
    return vcp_version_id_name(version_id);
 }
 
@@ -599,12 +690,14 @@ ddca_mccs_version_id_name(DDCA_MCCS_Version_Id version_id) {
 
 char *
 ddca_mccs_version_id_string(DDCA_MCCS_Version_Id version_id) {
+   API_TIMED();
    return format_vcp_version_id(version_id);
 }
 #endif
 
 char *
 ddca_mccs_version_id_desc(DDCA_MCCS_Version_Id version_id) {
+   API_TIMED();
    return format_vcp_version_id(version_id);
 }
 #endif
@@ -622,6 +715,7 @@ ddca_mmk(
       const char * model_name,
       uint16_t     product_code)
 {
+   API_TIMED();
    DDCA_Monitor_Model_Key result = DDCA_UNDEFINED_MONITOR_MODEL_KEY;
    if (mfg_id     && strlen(mfg_id)     < DDCA_EDID_MFG_ID_FIELD_SIZE &&
        model_name && strlen(model_name) < DDCA_EDID_MODEL_NAME_FIELD_SIZE)
@@ -636,6 +730,7 @@ ddca_mmk_eq(
       DDCA_Monitor_Model_Key mmk1,
       DDCA_Monitor_Model_Key mmk2)
 {
+   API_TIMED();
    return monitor_model_key_eq(mmk1, mmk2);
 }
 
@@ -644,6 +739,7 @@ bool
 ddca_mmk_is_defined(
       DDCA_Monitor_Model_Key mmk)
 {
+   API_TIMED();
    return mmk.defined;
 }
 
@@ -652,6 +748,7 @@ DDCA_Monitor_Model_Key
 ddca_mmk_from_dref(
       DDCA_Display_Ref   ddca_dref)
 {
+   API_TIMED();
    DDCA_Monitor_Model_Key result = DDCA_UNDEFINED_MONITOR_MODEL_KEY;
    Display_Ref * dref = (Display_Ref *) ddca_dref;
    if (valid_display_ref(dref) && dref->mmid)
@@ -664,6 +761,7 @@ DDCA_Monitor_Model_Key
 ddca_mmk_from_dh(
       DDCA_Display_Handle   ddca_dh)
 {
+   API_TIMED();
    DDCA_Monitor_Model_Key result = DDCA_UNDEFINED_MONITOR_MODEL_KEY;
    Display_Handle * dh = (Display_Handle *) ddca_dh;
    if (valid_display_handle(dh) && dh->dref->mmid)
@@ -679,6 +777,7 @@ ddca_mmk_from_dh(
 DDCA_Display_Info_List *
 ddca_get_display_info_list(void)
 {
+   API_TIMED();
    DDCA_Display_Info_List * result = NULL;
    ddca_get_display_info_list2(false, &result);
    return result;
@@ -740,6 +839,7 @@ ddca_get_display_info(
       DDCA_Display_Ref  ddca_dref,
       DDCA_Display_Info ** dinfo_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API,  "ddca_dref=%p", ddca_dref);
    DDCA_Status ddcrc = 0;
@@ -788,6 +888,7 @@ ddca_get_display_refs(
       bool                include_invalid_displays,
       DDCA_Display_Ref**  drefs_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API|DDCA_TRC_DDC,
                  "include_invalid_displays=%s", SBOOL(include_invalid_displays));
@@ -834,6 +935,7 @@ ddca_get_display_info_list2(
       bool                      include_invalid_displays,
       DDCA_Display_Info_List**  dlist_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API|DDCA_TRC_DDC, "");
    free_thread_error_detail();
@@ -879,8 +981,49 @@ ddca_get_display_info_list2(
 }
 
 
+DDCA_Status
+ddca_get_display_info_snapshot(
+      bool                           include_invalid_displays,
+      uint32_t                       known_generation,
+      DDCA_Display_Info_Snapshot **  snapshot_loc)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API|DDCA_TRC_DDC, "include_invalid_displays=%s, known_generation=%u",
+                                                     SBOOL(include_invalid_displays), known_generation);
+   free_thread_error_detail();
+   API_PRECOND(snapshot_loc);
+   *snapshot_loc = NULL;
+
+   ddc_ensure_displays_detected();
+   uint32_t generation = ddc_get_display_list_generation();
+   if (known_generation != 0 && known_generation == generation) {
+      DBGTRC_RET_DDCRC(debug, DDCA_TRC_API|DDCA_TRC_DDC, 0, "Unchanged, generation=%u", generation);
+      return 0;
+   }
+
+   GPtrArray * filtered_displays = ddc_get_filtered_displays(include_invalid_displays);  // array of Display_Ref
+   int filtered_ct = filtered_displays->len;
+   int reqd_size = offsetof(DDCA_Display_Info_Snapshot,info) + filtered_ct * sizeof(DDCA_Display_Info);
+   DDCA_Display_Info_Snapshot * snapshot = calloc(1, reqd_size);
+   memcpy(snapshot->marker, DDCA_DISPLAY_INFO_SNAPSHOT_MARKER, 4);
+   snapshot->generation = generation;
+   snapshot->ct = filtered_ct;
+   for (int ndx = 0; ndx < filtered_ct; ndx++)
+      init_display_info(g_ptr_array_index(filtered_displays, ndx), &snapshot->info[ndx]);
+   g_ptr_array_free(filtered_displays, true);
+
+   set_ddca_error_detail_from_open_errors();
+   *snapshot_loc = snapshot;
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API|DDCA_TRC_DDC, 0,
+                    "generation=%u, snapshot has %d displays", generation, snapshot->ct);
+   return 0;
+}
+
+
 void
 ddca_free_display_info(DDCA_Display_Info * info_rec) {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "info_rec->%p", info_rec);
    // DDCA_Display_Info contains no pointers, can simply be free'd
@@ -895,6 +1038,7 @@ ddca_free_display_info(DDCA_Display_Info * info_rec) {
 
 void
 ddca_free_display_info_list(DDCA_Display_Info_List * dlist) {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "dlist=%p", dlist);
    if (dlist) {
@@ -916,6 +1060,7 @@ ddca_report_display_info(
       DDCA_Display_Info * dinfo,
       int                 depth)
 {
+   API_TIMED();
    API_PRECOND_NORC(dinfo);
    API_PRECOND_NORC(memcmp(dinfo->marker, DDCA_DISPLAY_INFO_MARKER, 4) == 0);
    bool debug = false;
@@ -1035,6 +1180,7 @@ ddca_report_display_info_list(
       DDCA_Display_Info_List * dlist,
       int                      depth)
 {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting.  dlist=%p, depth=%d", dlist, depth);
 
@@ -1073,6 +1219,7 @@ ddca_get_edid_by_dref(
       DDCA_Display_Ref ddca_dref,
       uint8_t**        p_bytes)
 {
+   API_TIMED();
    DDCA_Status rc = 0;
    *p_bytes = NULL;
    free_thread_error_detail();
@@ -1105,6 +1252,172 @@ ddca_get_edid(DDCA_Display_Handle * dh, uint8_t* edid_buffer);
 #endif
 
 
+//
+// Per display I/O settings
+//
+
+DDCA_Status
+ddca_set_display_sleep_multiplier(
+      DDCA_Display_Ref  ddca_dref,
+      double            multiplier)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dref=%p, multiplier=%5.2f", ddca_dref, multiplier);
+   DDCA_Status ddcrc = 0;
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+      {
+         if (multiplier < 0)
+            ddcrc = DDCRC_ARG;
+         else
+            dref->io_settings.sleep_multiplier = multiplier;
+      }
+   );
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "");
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_get_display_sleep_multiplier(
+      DDCA_Display_Ref  ddca_dref,
+      double *          multiplier_loc)
+{
+   API_TIMED();
+   DDCA_Status ddcrc = 0;
+   API_PRECOND(multiplier_loc);
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+      {
+         *multiplier_loc = tsd_get_display_sleep_multiplier_factor(dref);
+      }
+   );
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_get_display_health(
+      DDCA_Display_Ref      ddca_dref,
+      DDCA_Display_Health * health_loc)
+{
+   API_TIMED();
+   DDCA_Status ddcrc = 0;
+   API_PRECOND(health_loc);
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+      {
+         get_display_health(dref, health_loc);
+      }
+   );
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_invalidate_cached_vcp_values(
+      DDCA_Display_Ref  ddca_dref)
+{
+   API_TIMED();
+   DDCA_Status ddcrc = 0;
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+      {
+         ddc_invalidate_all_cached_vcp_values(dref);
+      }
+   );
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_set_display_max_tries(
+      DDCA_Display_Ref  ddca_dref,
+      DDCA_Retry_Type   retry_type,
+      int               max_tries)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dref=%p, retry_type=%d, max_tries=%d",
+                                        ddca_dref, retry_type, max_tries);
+   DDCA_Status ddcrc = 0;
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+      {
+         if (max_tries < 0 || max_tries > MAX_MAX_TRIES ||
+             retry_type < DDCA_WRITE_ONLY_TRIES || retry_type > DDCA_MULTI_PART_TRIES)
+         {
+            ddcrc = DDCRC_ARG;
+         }
+         else {
+            dref->io_settings.max_tries[retry_type] = max_tries;
+            // for DDCA_MULTI_PART_TRIES, set both MULTI_PART_READ_OP and MULTI_PART_WRITE_OP
+            if (retry_type == DDCA_MULTI_PART_TRIES)
+               dref->io_settings.max_tries[MULTI_PART_WRITE_OP] = max_tries;
+         }
+      }
+   );
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "");
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_get_display_max_tries(
+      DDCA_Display_Ref  ddca_dref,
+      DDCA_Retry_Type   retry_type,
+      int *             max_tries_loc)
+{
+   API_TIMED();
+   DDCA_Status ddcrc = 0;
+   API_PRECOND(max_tries_loc);
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+      {
+         if (retry_type < DDCA_WRITE_ONLY_TRIES || retry_type > DDCA_MULTI_PART_TRIES)
+            ddcrc = DDCRC_ARG;
+         else if (dref->io_settings.max_tries[retry_type] > 0)
+            *max_tries_loc = dref->io_settings.max_tries[retry_type];
+         else
+            *max_tries_loc = try_data_get_maxtries2((Retry_Operation) retry_type);
+      }
+   );
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_enable_display_dynamic_sleep(
+      DDCA_Display_Ref  ddca_dref,
+      bool              onoff)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dref=%p, onoff=%s", ddca_dref, SBOOL(onoff));
+   DDCA_Status ddcrc = 0;
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+      {
+         dref->io_settings.dynamic_sleep = (onoff) ? 1 : -1;
+      }
+   );
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "");
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_reset_display_io_settings(
+      DDCA_Display_Ref  ddca_dref)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dref=%p", ddca_dref);
+   DDCA_Status ddcrc = 0;
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+      {
+         memset(&dref->io_settings, 0, sizeof(Display_Io_Settings));
+      }
+   );
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "");
+   return ddcrc;
+}
+
+
 //
 // Reports
 //
@@ -1112,11 +1425,13 @@ ddca_get_edid(DDCA_Display_Handle * dh, uint8_t* edid_buffer);
 // deprecated, use ddca_report_displays()
 int
 ddca_report_active_displays(int depth) {
+   API_TIMED();
    return ddc_report_displays(false, depth);
 }
 
 int
 ddca_report_displays(bool include_invalid_displays, int depth) {
+   API_TIMED();
    return ddc_report_displays(include_invalid_displays, depth);
 }
 
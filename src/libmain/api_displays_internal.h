@@ -37,7 +37,9 @@ Display_Handle * validated_ddca_display_handle(DDCA_Display_Handle ddca_dh);
          psc = DDCRC_ARG; \
       } \
       else { \
+         g_rec_mutex_lock(&dh->io_mutex); \
          (action); \
+         g_rec_mutex_unlock(&dh->io_mutex); \
       } \
       return psc; \
    } while(0);
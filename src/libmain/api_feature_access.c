@@ -9,6 +9,9 @@
 #include "config.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "public/ddcutil_c_api.h"
@@ -20,15 +23,25 @@
 
 #include "base/core.h"
 #include "base/displays.h"
+#include "base/feature_lists.h"
 #include "base/monitor_model_key.h"
 
+#include "vcp/vcp_feature_codes.h"
 #include "vcp/vcp_feature_values.h"
 
 #include "dynvcp/dyn_feature_codes.h"
 
+#include "ddc/ddc_async_requests.h"
+#include "ddc/ddc_completion_queue.h"
 #include "ddc/ddc_dumpload.h"
+#include "ddc/ddc_feature_sampler.h"
+#include "ddc/ddc_remembered_values.h"
+#include "ddc/ddc_multiplexed_io.h"
+#include "ddc/ddc_published_state.h"
 #include "ddc/ddc_vcp_version.h"
 #include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_change_watch.h"
+#include "ddc/ddc_vcp_value_cache.h"
 
 #include "libmain/api_error_info_internal.h"
 #include "libmain/api_base_internal.h"
@@ -84,26 +97,26 @@ ddca_get_non_table_vcp_value(
       DDCA_Vcp_Feature_Code      feature_code,
       DDCA_Non_Table_Vcp_Value*  valrec)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p, feature_code=0x%02x, valrec=%p",
                                ddca_dh, feature_code, valrec );
    API_PRECOND(valrec);
    WITH_VALIDATED_DH2(ddca_dh,  {
        Error_Info * ddc_excp = NULL;
-       Parsed_Nontable_Vcp_Response * code_info;
-       ddc_excp = ddc_get_nontable_vcp_value(
+       Parsed_Nontable_Vcp_Response code_info;
+       ddc_excp = ddc_get_nontable_vcp_value_cached_into(
                      dh,
                      feature_code,
                      &code_info);
 
        if (!ddc_excp) {
-          valrec->mh = code_info->mh;
-          valrec->ml = code_info->ml;;
-          valrec->sh = code_info->sh;
-          valrec->sl = code_info->sl;
+          valrec->mh = code_info.mh;
+          valrec->ml = code_info.ml;
+          valrec->sh = code_info.sh;
+          valrec->sl = code_info.sl;
           // DBGMSG("valrec:  mh=0x%02x, ml=0x%02x, sh=0x%02x, sl=0x%02x",
           //        valrec->mh, valrec->ml, valrec->sh, valrec->sl);
-          free(code_info);
           DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc,
                 "valrec:  mh=0x%02x, ml=0x%02x, sh=0x%02x, sl=0x%02x",
                 valrec->mh, valrec->ml, valrec->sh, valrec->sl);
@@ -119,6 +132,164 @@ ddca_get_non_table_vcp_value(
 }
 
 
+static int
+dh_address_compare(const void * a, const void * b) {
+   uintptr_t p1 = (uintptr_t) *(Display_Handle * const *) a;
+   uintptr_t p2 = (uintptr_t) *(Display_Handle * const *) b;
+   return (p1 < p2) ? -1 : (p1 > p2);
+}
+
+
+DDCA_Status
+ddca_get_non_table_vcp_values_multi(
+      DDCA_Display_Handle *      ddca_dhs,
+      int                        dh_ct,
+      DDCA_Vcp_Feature_Code      feature_code,
+      DDCA_Non_Table_Vcp_Value*  valrecs,
+      DDCA_Status *              statuses)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "dh_ct=%d, feature_code=0x%02x", dh_ct, feature_code);
+   API_PRECOND(ddca_dhs);
+   API_PRECOND(valrecs);
+   API_PRECOND(statuses);
+   API_PRECOND(dh_ct >= 0);
+   assert(library_initialized);
+   free_thread_error_detail();
+
+   DDCA_Status psc = 0;
+   Multiplexed_Getvcp_Request * requests = calloc(dh_ct, sizeof(Multiplexed_Getvcp_Request));
+   for (int ndx = 0; ndx < dh_ct; ndx++) {
+      requests[ndx].dh = validated_ddca_display_handle(ddca_dhs[ndx]);
+      if (!requests[ndx].dh) {
+         psc = DDCRC_ARG;
+         break;
+      }
+   }
+
+   if (psc == 0) {
+      // lock the handles in address order, so that concurrent calls with
+      // overlapping handles cannot deadlock
+      Display_Handle ** locked = calloc(dh_ct, sizeof(Display_Handle *));
+      for (int ndx = 0; ndx < dh_ct; ndx++)
+         locked[ndx] = requests[ndx].dh;
+      qsort(locked, dh_ct, sizeof(Display_Handle *), dh_address_compare);
+      for (int ndx = 0; ndx < dh_ct; ndx++)
+         g_rec_mutex_lock(&locked[ndx]->io_mutex);
+      ddc_multiplexed_get_nontable_vcp_values(requests, dh_ct, feature_code);
+      for (int ndx = dh_ct-1; ndx >= 0; ndx--)
+         g_rec_mutex_unlock(&locked[ndx]->io_mutex);
+      free(locked);
+      for (int ndx = 0; ndx < dh_ct; ndx++) {
+         Multiplexed_Getvcp_Request * request = &requests[ndx];
+         statuses[ndx] = ERRINFO_STATUS(request->excp);
+         memset(&valrecs[ndx], 0, sizeof(DDCA_Non_Table_Vcp_Value));
+         if (request->response) {
+            valrecs[ndx].mh = request->response->mh;
+            valrecs[ndx].ml = request->response->ml;
+            valrecs[ndx].sh = request->response->sh;
+            valrecs[ndx].sl = request->response->sl;
+            free(request->response);
+         }
+         if (request->excp)
+            errinfo_free(request->excp);
+      }
+   }
+   free(requests);
+
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+   return psc;
+}
+
+
+DDCA_Status
+ddca_get_non_table_vcp_values_by_drefs(
+      DDCA_Display_Ref *         ddca_drefs,
+      int                        dref_ct,
+      DDCA_Vcp_Feature_Code      feature_code,
+      DDCA_Non_Table_Vcp_Value*  valrecs,
+      DDCA_Status *              statuses)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "dref_ct=%d, feature_code=0x%02x", dref_ct, feature_code);
+   API_PRECOND(ddca_drefs);
+   API_PRECOND(valrecs);
+   API_PRECOND(statuses);
+   API_PRECOND(dref_ct >= 0);
+   assert(library_initialized);
+   free_thread_error_detail();
+
+   DDCA_Status psc = 0;
+   Display_Ref ** drefs = calloc(dref_ct, sizeof(Display_Ref *));
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      drefs[ndx] = validated_ddca_display_ref(ddca_drefs[ndx]);
+      if (!drefs[ndx]) {
+         psc = DDCRC_ARG;
+         break;
+      }
+   }
+
+   if (psc == 0)
+      ddc_get_nontable_vcp_values_multi(drefs, dref_ct, feature_code, CALLOPT_NONE, valrecs, statuses);
+   free(drefs);
+
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+   return psc;
+}
+
+
+DDCA_Status
+ddca_sample_features(
+      DDCA_Display_Ref *         ddca_drefs,
+      int                        dref_ct,
+      DDCA_Vcp_Feature_Code *    feature_codes,
+      int                        feature_ct,
+      int                        interval_millisec,
+      int                        round_ct,
+      DDCA_Feature_Sample_Func   func,
+      void *                     arg,
+      int *                      missed_ct_loc)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "dref_ct=%d, feature_ct=%d, interval_millisec=%d, round_ct=%d",
+                                        dref_ct, feature_ct, interval_millisec, round_ct);
+   API_PRECOND(ddca_drefs);
+   API_PRECOND(feature_codes);
+   API_PRECOND(func);
+   API_PRECOND(dref_ct > 0);
+   API_PRECOND(feature_ct > 0);
+   assert(library_initialized);
+   free_thread_error_detail();
+
+   DDCA_Status psc = 0;
+   Display_Ref ** drefs = calloc(dref_ct, sizeof(Display_Ref *));
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      drefs[ndx] = validated_ddca_display_ref(ddca_drefs[ndx]);
+      if (!drefs[ndx]) {
+         psc = DDCRC_ARG;
+         break;
+      }
+   }
+
+   if (psc == 0)
+      psc = ddc_sample_features(drefs, dref_ct, feature_codes, feature_ct, interval_millisec,
+                                round_ct, CALLOPT_NONE, func, arg, missed_ct_loc);
+   free(drefs);
+
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+   return psc;
+}
+
+
+void
+ddca_stop_feature_sampling() {
+   ddc_stop_feature_sampling();
+}
+
+
 // untested
 DDCA_Status
 ddca_get_table_vcp_value(
@@ -126,6 +297,7 @@ ddca_get_table_vcp_value(
       DDCA_Vcp_Feature_Code   feature_code,
       DDCA_Table_Vcp_Value ** table_value_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API,
          "ddca_dh=%p, feature_code=0x%02x, table_value_loc=%p",
@@ -161,6 +333,60 @@ ddca_get_table_vcp_value(
 }
 
 
+DDCA_Status
+ddca_get_table_vcp_value_into(
+      DDCA_Display_Handle     ddca_dh,
+      DDCA_Vcp_Feature_Code   feature_code,
+      uint8_t *               buf,
+      int                     bufsz,
+      int *                   bytect_loc)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API,
+         "ddca_dh=%p, feature_code=0x%02x, buf=%p, bufsz=%d",
+         ddca_dh, feature_code, buf, bufsz);
+   API_PRECOND(buf);
+   API_PRECOND(bytect_loc);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         Error_Info * ddc_excp =
+               ddc_get_table_vcp_value_into(dh, feature_code, buf, bufsz, bytect_loc);
+         psc = (ddc_excp) ? ddc_excp->status_code : 0;
+         save_thread_error_detail(error_info_to_ddca_detail(ddc_excp));
+         errinfo_free(ddc_excp);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "*bytect_loc=%d", *bytect_loc);
+      }
+   );
+}
+
+
+DDCA_Status
+ddca_get_table_vcp_value_fragments(
+      DDCA_Display_Handle      ddca_dh,
+      DDCA_Vcp_Feature_Code    feature_code,
+      DDCA_Table_Fragment_Func func,
+      void *                   context,
+      int *                    bytect_loc)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API,
+         "ddca_dh=%p, feature_code=0x%02x, func=%p", ddca_dh, feature_code, func);
+   API_PRECOND(func);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         Error_Info * ddc_excp =
+               ddc_get_table_vcp_value_streaming(dh, feature_code, func, context, bytect_loc);
+         psc = (ddc_excp) ? ddc_excp->status_code : 0;
+         save_thread_error_detail(error_info_to_ddca_detail(ddc_excp));
+         errinfo_free(ddc_excp);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
+}
+
+
 static
 DDCA_Status
 ddca_get_vcp_value(
@@ -169,6 +395,7 @@ ddca_get_vcp_value(
       DDCA_Vcp_Value_Type    call_type,   // why is this needed?   look it up from dh and feature_code
       DDCA_Any_Vcp_Value **  pvalrec)
 {
+   API_TIMED();
 
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API,
@@ -221,6 +448,7 @@ ddca_get_any_vcp_value_using_explicit_type(
        DDCA_Vcp_Value_Type         call_type,
        DDCA_Any_Vcp_Value **       valrec_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting. ddca_dh=%p, feature_code=0x%02x, call_type=%d, valrec_loc=%p",
           ddca_dh, feature_code, call_type, valrec_loc);
@@ -247,6 +475,7 @@ ddca_get_any_vcp_value_using_explicit_type_new(
        DDCA_Vcp_Value_Type_Parm    call_type,
        DDCA_Any_Vcp_Value **       pvalrec)
 {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting. ddca_dh=%p, feature_code=0x%02x, call_type=%d, pvalrec=%p",
           ddca_dh, feature_code, call_type, pvalrec);
@@ -278,6 +507,7 @@ ddca_get_any_vcp_value_using_implicit_type(
        DDCA_Vcp_Feature_Code       feature_code,
        DDCA_Any_Vcp_Value **       valrec_loc)
 {
+   API_TIMED();
    assert(valrec_loc);
    free_thread_error_detail();
 
@@ -295,10 +525,74 @@ ddca_get_any_vcp_value_using_implicit_type(
 }
 
 
+DDCA_Status
+ddca_get_multiple_vcp_values(
+      DDCA_Display_Handle           ddca_dh,
+      DDCA_Feature_List *           feature_list,
+      DDCA_Vcp_Value_Result_List ** results_loc)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p, feature_list=%p, results_loc=%p",
+                                        ddca_dh, feature_list, results_loc);
+   API_PRECOND(feature_list);
+   API_PRECOND(results_loc);
+   *results_loc = NULL;
+
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         int feature_ct = feature_list_count(feature_list);
+         Vcp_Batch_Entry * entries = calloc(feature_ct, sizeof(Vcp_Batch_Entry));
+         int ct = 0;
+         for (int code = 0; code < 256; code++) {
+            if (feature_list_contains(feature_list, code)) {
+               DDCA_Vcp_Value_Type value_type = DDCA_NON_TABLE_VCP_VALUE;
+               get_value_type(ddca_dh, code, &value_type);  // default if not found
+               entries[ct].feature_code = code;
+               entries[ct].value_type   = value_type;
+               ct++;
+            }
+         }
+         assert(ct == feature_ct);
+
+         ddc_get_multiple_vcp_values(dh, entries, feature_ct);
+
+         DDCA_Vcp_Value_Result_List * results =
+               calloc(1, sizeof(DDCA_Vcp_Value_Result_List) + feature_ct * sizeof(DDCA_Vcp_Value_Result));
+         results->ct = feature_ct;
+         for (int ndx = 0; ndx < feature_ct; ndx++) {
+            DDCA_Vcp_Value_Result * result = &results->results[ndx];
+            result->feature_code = entries[ndx].feature_code;
+            result->status       = ERRINFO_STATUS(entries[ndx].excp);
+            result->value        = entries[ndx].valrec;
+            ERRINFO_FREE_WITH_REPORT(entries[ndx].excp, debug || IS_TRACING() || report_freed_exceptions);
+         }
+         free(entries);
+         *results_loc = results;
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "*results_loc=%p, ct=%d", *results_loc, feature_ct);
+      }
+   );
+}
+
+
+void
+ddca_free_vcp_value_result_list(
+      DDCA_Vcp_Value_Result_List * results)
+{
+   API_TIMED();
+   if (results) {
+      for (int ndx = 0; ndx < results->ct; ndx++)
+         ddca_free_any_vcp_value(results->results[ndx].value);
+      free(results);
+   }
+}
+
+
 void
 ddca_free_table_vcp_value(
       DDCA_Table_Vcp_Value * table_value)
 {
+   API_TIMED();
    if (table_value) {
       free(table_value->bytes);
       free(table_value);
@@ -310,6 +604,7 @@ void
 ddca_free_any_vcp_value(
       DDCA_Any_Vcp_Value * valrec)
 {
+   API_TIMED();
    if (valrec) {
       if (valrec->value_type == DDCA_TABLE_VCP_VALUE) {
          free(valrec->val.t.bytes);
@@ -355,6 +650,7 @@ ddca_get_formatted_vcp_value(
       DDCA_Vcp_Feature_Code  feature_code,
       char**                 formatted_value_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "feature_code=0x%02x, formatted_value_loc=%p",
                  feature_code, formatted_value_loc);
@@ -428,6 +724,7 @@ ddca_format_any_vcp_value(
       DDCA_Any_Vcp_Value *     anyval,
       char **                  formatted_value_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "feature_code=0x%02x, vspec=%d.%d, mmid=%p -> %s",
                  feature_code,
@@ -503,6 +800,7 @@ ddca_format_any_vcp_value_by_dref(
       DDCA_Any_Vcp_Value *    valrec,
       char **                 formatted_value_loc)
 {
+   API_TIMED();
    bool debug = true;
    DBGTRC_STARTING(debug, TRACE_GROUP, "feature_code=0x%02x, ddca_dref=%p, valrec=%s",
              feature_code,
@@ -541,6 +839,7 @@ ddca_format_non_table_vcp_value(
       DDCA_Non_Table_Vcp_Value *  valrec,
       char **                     formatted_value_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API,"feature_code=0x%02x, vspec=%d.%d, mmid=%s, formatted_value_loc=%p",
              feature_code,
@@ -579,6 +878,7 @@ ddca_format_non_table_vcp_value_by_dref(
       DDCA_Non_Table_Vcp_Value *  valrec,
       char **                     formatted_value_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "feature_code=0x%02x, ddca_dref=%p",
                           feature_code, ddca_dref);
@@ -606,6 +906,52 @@ ddca_format_non_table_vcp_value_by_dref(
 }
 
 
+DDCA_Status
+ddca_format_non_table_vcp_value_in_buffer(
+      DDCA_Vcp_Feature_Code       feature_code,
+      DDCA_MCCS_Version_Spec      vspec,
+      DDCA_Non_Table_Vcp_Value *  valrec,
+      char *                      buffer,
+      int                         bufsz)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "feature_code=0x%02x, vspec=%d.%d, buffer=%p, bufsz=%d",
+                                        feature_code, vspec.major, vspec.minor, buffer, bufsz);
+   free_thread_error_detail();
+   API_PRECOND(valrec);
+   API_PRECOND(buffer);
+   API_PRECOND(bufsz > 0);
+
+   DDCA_Status ddcrc = 0;
+   buffer[0] = '\0';
+   VCP_Feature_Table_Entry * vfte = vcp_find_feature_by_hexid(feature_code);
+   if (!vfte) {
+      ddcrc = DDCRC_ARG;
+   }
+   else if (is_table_feature_by_vcp_version(vfte, vspec) ||
+            !is_feature_readable_by_vcp_version(vfte, vspec))
+   {
+      ddcrc = DDCRC_INVALID_OPERATION;
+   }
+   else {
+      Nontable_Vcp_Value code_info;
+      code_info.vcp_code  = feature_code;
+      code_info.mh        = valrec->mh;
+      code_info.ml        = valrec->ml;
+      code_info.sh        = valrec->sh;
+      code_info.sl        = valrec->sl;
+      code_info.max_value = valrec->mh << 8 | valrec->ml;
+      code_info.cur_value = valrec->sh << 8 | valrec->sl;
+      if (!vcp_format_nontable_feature_detail(vfte, vspec, &code_info, buffer, bufsz))
+         ddcrc = DDCRC_ARG;
+   }
+
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "buffer -> |%s|", buffer);
+   return ddcrc;
+}
+
+
 DDCA_Status
 ddca_format_table_vcp_value(
       DDCA_Vcp_Feature_Code   feature_code,
@@ -614,6 +960,7 @@ ddca_format_table_vcp_value(
       DDCA_Table_Vcp_Value *  table_value,
       char **                 formatted_value_loc)
 {
+   API_TIMED();
    // free_thread_error_detail();   // unnecessary, done by ddca_format_any_vcp_value();
    DDCA_Any_Vcp_Value anyval;
    anyval.opcode = feature_code;
@@ -633,6 +980,7 @@ ddca_format_table_vcp_value_by_dref(
       DDCA_Table_Vcp_Value *  table_value,
       char **                 formatted_value_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP,
                           "feature_code=0x%02x, ddca_dref=%p", feature_code, ddca_dref);
@@ -659,6 +1007,31 @@ ddca_format_table_vcp_value_by_dref(
 }
 
 
+static DDCA_Notification_Func registered_notification_func = NULL;
+
+
+/** Checks whether a write can be queued for coalescing with later writes
+ *  to the same feature, instead of being performed immediately.
+ *
+ *  Only Continuous features are coalesced, since for them only the final
+ *  value matters, e.g. when a slider drives brightness or contrast.
+ */
+static bool
+is_coalescable_write(
+      Display_Handle *       dh,
+      DDCA_Any_Vcp_Value *   valrec)
+{
+   if (!ddc_is_setvcp_coalescing_enabled() || valrec->value_type != DDCA_NON_TABLE_VCP_VALUE)
+      return false;
+
+   bool result = false;
+   Display_Feature_Metadata * dfm = dyn_get_cached_feature_metadata_by_dh(valrec->opcode, dh, false);
+   if (dfm)
+      result = dfm->feature_flags & DDCA_CONT;
+   return result;
+}
+
+
 static
 DDCA_Status
 set_single_vcp_value(
@@ -670,9 +1043,16 @@ set_single_vcp_value(
       DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p, valrec=%p, verified_value_loc = %p",
                                   ddca_dh, valrec, verified_value_loc);
       WITH_VALIDATED_DH2(ddca_dh,  {
-            Error_Info * ddc_excp = ddc_set_vcp_value(dh, valrec, verified_value_loc);
-            psc = (ddc_excp) ? ddc_excp->status_code : 0;
-            errinfo_free(ddc_excp);
+            if (!verified_value_loc && is_coalescable_write(dh, valrec)) {
+               // completion, if of interest, is reported to the registered notification function
+               psc = ddc_queue_coalesced_set_request(dh, valrec->opcode, VALREC_CUR_VAL(valrec),
+                                                     registered_notification_func);
+            }
+            else {
+               Error_Info * ddc_excp = ddc_set_vcp_value(dh, valrec, verified_value_loc);
+               psc = (ddc_excp) ? ddc_excp->status_code : 0;
+               errinfo_free(ddc_excp);
+            }
             DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
          } );
 }
@@ -704,6 +1084,7 @@ ddca_set_continuous_vcp_value_verify(
       uint16_t              new_value,
       uint16_t *            verified_value_loc)
 {
+   API_TIMED();
    DDCA_Status rc = 0;
    free_thread_error_detail();
 
@@ -744,6 +1125,7 @@ ddca_set_continuous_vcp_value(
       DDCA_Vcp_Feature_Code feature_code,
       uint16_t              new_value)
 {
+   API_TIMED();
    return ddca_set_continuous_vcp_value_verify(ddca_dh, feature_code, new_value, NULL);
 }
 
@@ -755,6 +1137,7 @@ ddca_set_simple_nc_vcp_value(
       DDCA_Vcp_Feature_Code  feature_code,
       Byte                   new_value)
 {
+   API_TIMED();
    return ddca_set_continuous_vcp_value_verify(ddca_dh, feature_code, new_value, NULL);
 }
 
@@ -789,6 +1172,7 @@ ddca_set_non_table_vcp_value_verify(
       Byte *                 verified_hi_byte_loc,
       Byte *                 verified_lo_byte_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API,
           "ddca_dh=%p, feature_code=0x%02x, hi_byte=0x%02x, lo_byte=0x%02x",
@@ -828,9 +1212,49 @@ ddca_set_non_table_vcp_value(
       Byte                   hi_byte,
       Byte                   lo_byte)
 {
+   API_TIMED();
    return ddca_set_non_table_vcp_value_verify(ddca_dh, feature_code, hi_byte, lo_byte, NULL, NULL);
 }
 
+
+DDCA_Status
+ddca_set_non_table_vcp_values_multi(
+      DDCA_Display_Ref *     ddca_drefs,
+      int                    dref_ct,
+      DDCA_Vcp_Feature_Code  feature_code,
+      Byte                   hi_byte,
+      Byte                   lo_byte,
+      DDCA_Status *          statuses)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "dref_ct=%d, feature_code=0x%02x, hi_byte=0x%02x, lo_byte=0x%02x",
+                                        dref_ct, feature_code, hi_byte, lo_byte);
+   API_PRECOND(ddca_drefs);
+   API_PRECOND(statuses);
+   API_PRECOND(dref_ct >= 0);
+   assert(library_initialized);
+   free_thread_error_detail();
+
+   DDCA_Status psc = 0;
+   Display_Ref ** drefs = calloc(dref_ct, sizeof(Display_Ref *));
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      drefs[ndx] = validated_ddca_display_ref(ddca_drefs[ndx]);
+      if (!drefs[ndx]) {
+         psc = DDCRC_ARG;
+         break;
+      }
+   }
+
+   if (psc == 0)
+      ddc_set_nontable_vcp_values_multi(drefs, dref_ct, feature_code, (hi_byte << 8) | lo_byte,
+                                        CALLOPT_NONE, statuses);
+   free(drefs);
+
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+   return psc;
+}
+
 // UNPUBLISHED
 /** Sets a table VCP value.
  *  Optionally returns the value set by reading the feature code after writing.
@@ -856,6 +1280,7 @@ ddca_set_table_vcp_value_verify(
       DDCA_Table_Vcp_Value *      table_value,
       DDCA_Table_Vcp_Value **     verified_value_loc)
 {
+   API_TIMED();
     free_thread_error_detail();
     DDCA_Status rc = 0;
 
@@ -889,6 +1314,7 @@ ddca_set_table_vcp_value(
       DDCA_Vcp_Feature_Code   feature_code,
       DDCA_Table_Vcp_Value *      table_value)
 {
+   API_TIMED();
    return ddca_set_table_vcp_value_verify(ddca_dh, feature_code, table_value, NULL);
 }
 
@@ -917,6 +1343,7 @@ ddca_set_any_vcp_value_verify(
       DDCA_Any_Vcp_Value *    new_value,
       DDCA_Any_Vcp_Value **   verified_value_loc)
 {
+   API_TIMED();
    free_thread_error_detail();
    DDCA_Status rc = 0;
 
@@ -942,15 +1369,44 @@ ddca_set_any_vcp_value(
       DDCA_Vcp_Feature_Code   feature_code,
       DDCA_Any_Vcp_Value *    new_value)
 {
+   API_TIMED();
    return ddca_set_any_vcp_value_verify(ddca_dh, feature_code, new_value, NULL);
 }
 
 
+DDCA_Status
+ddca_save_current_settings(
+      DDCA_Display_Handle     ddca_dh)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p", ddca_dh);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         if (dh->dref->io_path.io_mode == DDCA_IO_USB) {
+            psc = DDCRC_INVALID_OPERATION;    // MCCS over USB has no Save Current Settings
+         }
+         else if (ddc_get_save_settings_debounce() > 0) {
+            psc = ddc_queue_debounced_save(dh);
+         }
+         else {
+            Error_Info * ddc_excp = ddc_save_current_settings(dh);
+            psc = (ddc_excp) ? ddc_excp->status_code : 0;
+            save_thread_error_detail(error_info_to_ddca_detail(ddc_excp));
+            errinfo_free(ddc_excp);
+         }
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
+}
+
+
 DDCA_Status
 ddca_get_profile_related_values(
       DDCA_Display_Handle ddca_dh,
       char**              profile_values_string_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API,
           "ddca_dh=%p, profile_values_string_loc=%p",
@@ -975,6 +1431,7 @@ ddca_set_profile_related_values(
       DDCA_Display_Handle  ddca_dh,
       char *               profile_values_string)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API,
           "ddca_h=%p, profile_values_string = %s",
@@ -995,10 +1452,10 @@ ddca_set_profile_related_values(
 
 
 //
-// Vestiges of old experimental async API.
-// Never published, retained for ABI compatibility.
+// Asynchronous feature access
 //
 
+
 DDCA_Status
 ddca_start_get_any_vcp_value(
       DDCA_Display_Handle         ddca_dh,
@@ -1006,7 +1463,69 @@ ddca_start_get_any_vcp_value(
       DDCA_Vcp_Value_Type         call_type,
       DDCA_Notification_Func      callback_func)
 {
-   return DDCRC_UNIMPLEMENTED;
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p, feature_code=0x%02x, call_type=%d, callback_func=%p",
+                                        ddca_dh, feature_code, call_type, callback_func);
+   API_PRECOND(callback_func);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         psc = ddc_queue_async_request(dh, DDCA_Q_VCP_GET, feature_code, call_type, 0, callback_func);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
+}
+
+
+DDCA_Status
+ddca_start_set_non_table_vcp_value(
+      DDCA_Display_Handle         ddca_dh,
+      DDCA_Vcp_Feature_Code       feature_code,
+      uint8_t                     hi_byte,
+      uint8_t                     lo_byte,
+      DDCA_Notification_Func      callback_func)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p, feature_code=0x%02x, hi_byte=0x%02x, lo_byte=0x%02x",
+                                        ddca_dh, feature_code, hi_byte, lo_byte);
+   API_PRECOND(callback_func);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         psc = ddc_queue_async_request(dh, DDCA_Q_VCP_SET, feature_code, DDCA_NON_TABLE_VCP_VALUE,
+                                       (hi_byte << 8) | lo_byte, callback_func);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
+}
+
+
+DDCA_Status
+ddca_start_ramp_non_table_vcp_value(
+      DDCA_Display_Handle         ddca_dh,
+      DDCA_Vcp_Feature_Code       feature_code,
+      uint16_t                    target_value,
+      int                         duration_millisec,
+      DDCA_Ramp_Easing            easing,
+      DDCA_Notification_Func      callback_func)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API,
+         "ddca_dh=%p, feature_code=0x%02x, target_value=%d, duration_millisec=%d, easing=%d",
+         ddca_dh, feature_code, target_value, duration_millisec, easing);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         Display_Feature_Metadata * dfm = dyn_get_feature_metadata_by_dh(feature_code, dh, false);
+         if (!dfm || !(dfm->feature_flags & DDCA_CONT))
+            psc = DDCRC_INVALID_OPERATION;
+         else
+            psc = ddc_queue_ramp_request(dh, feature_code, target_value, duration_millisec,
+                                         easing, callback_func);
+         dfm_free(dfm);    // handles dfm == NULL
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
 }
 
 
@@ -1015,15 +1534,248 @@ ddca_register_callback(
       DDCA_Notification_Func func,
       uint8_t                callback_options) // type is a placeholder
 {
-   return DDCRC_UNIMPLEMENTED;
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "func=%p, callback_options=0x%02x", func, callback_options);
+   registered_notification_func = func;
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, 0, "");
+   return 0;
 }
 
+
 DDCA_Status
 ddca_queue_get_non_table_vcp_value(
       DDCA_Display_Handle      ddca_dh,
       DDCA_Vcp_Feature_Code    feature_code)
 {
-   return DDCRC_UNIMPLEMENTED;
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p, feature_code=0x%02x", ddca_dh, feature_code);
+   DDCA_Notification_Func func = registered_notification_func;
+   if (!func) {
+      DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, DDCRC_INVALID_OPERATION, "No callback registered");
+      return DDCRC_INVALID_OPERATION;
+   }
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         psc = ddc_queue_async_request(dh, DDCA_Q_VCP_GET, feature_code, DDCA_NON_TABLE_VCP_VALUE, 0, func);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
+}
+
+
+DDCA_Status
+ddca_start_watch_vcp_changes(
+      DDCA_Display_Handle      ddca_dh)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p", ddca_dh);
+   DDCA_Notification_Func func = registered_notification_func;
+   if (!func) {
+      DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, DDCRC_INVALID_OPERATION, "No callback registered");
+      return DDCRC_INVALID_OPERATION;
+   }
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         psc = ddc_watch_vcp_changes(dh, func);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
+}
+
+
+DDCA_Status
+ddca_stop_watch_vcp_changes(
+      DDCA_Display_Handle      ddca_dh)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p", ddca_dh);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         psc = ddc_unwatch_vcp_changes(dh);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
+}
+
+
+DDCA_Status
+ddca_get_published_non_table_vcp_value(
+      DDCA_Display_Ref            ddca_dref,
+      DDCA_Vcp_Feature_Code       feature_code,
+      DDCA_Non_Table_Vcp_Value *  valrec,
+      uint64_t *                  age_millisec_loc)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dref=%p, feature_code=0x%02x", ddca_dref, feature_code);
+   assert(valrec);
+   DDCA_Status ddcrc = 0;
+   WITH_VALIDATED_DR3(ddca_dref, ddcrc,
+         {
+            if (dref->io_path.io_mode != DDCA_IO_I2C)
+               ddcrc = DDCRC_NOT_FOUND;
+            else
+               ddcrc = ddc_get_published_vcp_value(
+                          dref->io_path.path.i2c_busno, feature_code, valrec, age_millisec_loc);
+         }
+   )
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, ddcrc, "");
+   return ddcrc;
+}
+
+
+DDCA_Status
+ddca_set_remembered_features(
+      DDCA_Feature_List *         features)
+{
+   API_TIMED();
+   bool debug = false;
+   API_PRECOND(features);
+   Bit_Set_256 bs;
+   memcpy(bs.bytes, features->bytes, sizeof(bs.bytes));
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "features: %s", bs256_to_string(bs, "x", " "));
+   ddc_set_remembered_features(bs);
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, 0, "");
+   return 0;
+}
+
+
+DDCA_Feature_List
+ddca_get_remembered_features(void) {
+   API_TIMED();
+   Bit_Set_256 bs = ddc_get_remembered_features();
+   DDCA_Feature_List result;
+   memcpy(result.bytes, bs.bytes, sizeof(result.bytes));
+   return result;
+}
+
+
+DDCA_Status
+ddca_get_remembered_non_table_vcp_value(
+      DDCA_Display_Handle         ddca_dh,
+      DDCA_Vcp_Feature_Code       feature_code,
+      DDCA_Non_Table_Vcp_Value *  valrec,
+      bool *                      stale_loc,
+      DDCA_Notification_Func      callback_func)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p, feature_code=0x%02x", ddca_dh, feature_code);
+   API_PRECOND(valrec);
+   API_PRECOND(stale_loc);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         psc = ddc_get_remembered_vcp_value(dh, feature_code, valrec, stale_loc, callback_func);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "stale=%s", SBOOL(*stale_loc));
+      }
+   );
+}
+
+
+DDCA_Status
+ddca_create_completion_queue(
+      DDCA_Completion_Queue *     cq_loc)
+{
+   API_TIMED();
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "");
+   API_PRECOND(cq_loc);
+   DDCA_Status psc = 0;
+   Completion_Queue * cq = ddc_new_completion_queue();
+   if (!cq)
+      psc = -errno;
+   *cq_loc = cq;
+   DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "*cq_loc=%p", *cq_loc);
+   return psc;
+}
+
+
+int
+ddca_get_completion_queue_fd(
+      DDCA_Completion_Queue       ddca_cq)
+{
+   API_TIMED();
+   Completion_Queue * cq = ddc_validated_completion_queue(ddca_cq);
+   return (cq) ? ddc_get_completion_queue_fd(cq) : -1;
+}
+
+
+static DDCA_Status
+submit_completion_request(
+      DDCA_Completion_Queue       ddca_cq,
+      DDCA_Display_Handle         ddca_dh,
+      DDCA_Queued_Request_Type    request_type,
+      DDCA_Vcp_Feature_Code       feature_code,
+      uint16_t                    new_value,
+      uint64_t                    user_data)
+{
+   bool debug = false;
+   DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_cq=%p, ddca_dh=%p, request_type=0x%02x, feature_code=0x%02x",
+                                        ddca_cq, ddca_dh, request_type, feature_code);
+   Completion_Queue * cq = ddc_validated_completion_queue(ddca_cq);
+   API_PRECOND(cq);
+   WITH_VALIDATED_DH2(ddca_dh,
+      {
+         psc = ddc_queue_completion_request(cq, dh, request_type, feature_code, new_value, user_data);
+         DBGTRC_RET_DDCRC(debug, DDCA_TRC_API, psc, "");
+      }
+   );
+}
+
+
+DDCA_Status
+ddca_cq_get_non_table_vcp_value(
+      DDCA_Completion_Queue       ddca_cq,
+      DDCA_Display_Handle         ddca_dh,
+      DDCA_Vcp_Feature_Code       feature_code,
+      uint64_t                    user_data)
+{
+   API_TIMED();
+   return submit_completion_request(ddca_cq, ddca_dh, DDCA_Q_VCP_GET, feature_code, 0, user_data);
+}
+
+
+DDCA_Status
+ddca_cq_set_non_table_vcp_value(
+      DDCA_Completion_Queue       ddca_cq,
+      DDCA_Display_Handle         ddca_dh,
+      DDCA_Vcp_Feature_Code       feature_code,
+      uint8_t                     hi_byte,
+      uint8_t                     lo_byte,
+      uint64_t                    user_data)
+{
+   API_TIMED();
+   return submit_completion_request(ddca_cq, ddca_dh, DDCA_Q_VCP_SET, feature_code,
+                                    hi_byte << 8 | lo_byte, user_data);
+}
+
+
+int
+ddca_drain_completions(
+      DDCA_Completion_Queue       ddca_cq,
+      DDCA_Completion *           completions,
+      int                         max_ct)
+{
+   API_TIMED();
+   Completion_Queue * cq = ddc_validated_completion_queue(ddca_cq);
+   if (!cq || !completions || max_ct < 0)
+      return DDCRC_ARG;
+   return ddc_drain_completions(cq, completions, max_ct);
+}
+
+
+void
+ddca_free_completion_queue(
+      DDCA_Completion_Queue       ddca_cq)
+{
+   API_TIMED();
+   Completion_Queue * cq = ddc_validated_completion_queue(ddca_cq);
+   if (cq)
+      ddc_free_completion_queue(cq);
 }
 
 
@@ -1035,6 +1787,7 @@ ddca_pass_callback(
       Simple_Callback_Func  func,
       int                   parm)
 {
+   API_TIMED();
    DBGMSG("parm=%d", parm);
    int callback_rc = func(parm+2);
    DBGMSG("returning %d", callback_rc);
@@ -48,18 +48,21 @@ const DDCA_Feature_List DDCA_EMPTY_FEATURE_LIST = {{0}};
 
 
 void ddca_feature_list_clear(DDCA_Feature_List* vcplist) {
+   API_TIMED();
    feature_list_clear(vcplist);
 }
 
 
 DDCA_Feature_List
 ddca_feature_list_add(DDCA_Feature_List * vcplist, uint8_t vcp_code) {
+   API_TIMED();
    feature_list_add(vcplist, vcp_code);
    return *vcplist;
 }
 
 
 bool ddca_feature_list_contains(DDCA_Feature_List vcplist, uint8_t vcp_code) {
+   API_TIMED();
    return feature_list_contains(&vcplist, vcp_code);
 }
 
@@ -68,6 +71,7 @@ const char *
 ddca_feature_list_id_name(
       DDCA_Feature_Subset_Id  feature_subset_id)
 {
+   API_TIMED();
    char * result = NULL;
    switch (feature_subset_id) {
    case DDCA_SUBSET_KNOWN:
@@ -107,6 +111,7 @@ ddca_get_feature_list(
       bool                    include_table_features,
       DDCA_Feature_List*      p_feature_list)   // location to fill in
 {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "Starting. feature_subset_id=%d, vcp_version=%d.%d, include_table_features=%s, p_feature_list=%p",
           feature_subset_id, vspec.major, vspec.minor, sbool(include_table_features), p_feature_list);
@@ -220,6 +225,7 @@ ddca_get_feature_list_by_dref(
       bool                    include_table_features,
       DDCA_Feature_List*      feature_list_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "feature_subset_id=%d=0x%08x=%s, ddca_dref=%p, "
               "include_table_features=%s, feature_list_loc=%p",
@@ -301,6 +307,7 @@ ddca_feature_list_eq(
       DDCA_Feature_List vcplist1,
       DDCA_Feature_List vcplist2)
 {
+   API_TIMED();
    return memcmp(&vcplist1, &vcplist2, sizeof(DDCA_Feature_List)) == 0;
 }
 
@@ -310,6 +317,7 @@ ddca_feature_list_or(
       DDCA_Feature_List vcplist1,
       DDCA_Feature_List vcplist2)
 {
+   API_TIMED();
    return feature_list_or(&vcplist1, &vcplist2);
 }
 
@@ -319,6 +327,7 @@ ddca_feature_list_and(
       DDCA_Feature_List vcplist1,
       DDCA_Feature_List vcplist2)
 {
+   API_TIMED();
    return feature_list_and(&vcplist1, &vcplist2);
 }
 
@@ -328,6 +337,7 @@ ddca_feature_list_and_not(
       DDCA_Feature_List vcplist1,
       DDCA_Feature_List vcplist2)
 {
+   API_TIMED();
    return feature_list_and_not(&vcplist1, &vcplist2);
 }
 
@@ -356,6 +366,7 @@ void ddca_feature_list_to_codes(
       int*               codect,
       uint8_t            vcp_codes[256])
 {
+   API_TIMED();
    int ctr = 0;
    for (int ndx = 0; ndx < 256; ndx++) {
       if (ddca_feature_list_contains(vcplist, ndx)) {
@@ -371,6 +382,7 @@ int
 ddca_feature_list_count(
       DDCA_Feature_List feature_list)
 {
+   API_TIMED();
    return feature_list_count(&feature_list);
 }
 
@@ -381,6 +393,7 @@ ddca_feature_list_string(
       const char * value_prefix,
       const char * sepstr)
 {
+   API_TIMED();
    return feature_list_string(&feature_list, value_prefix, sepstr);
 }
 
@@ -398,6 +411,7 @@ ddca_get_simplified_feature_info(
  //   DDCA_MCCS_Version_Id          mccs_version_id,
       DDCA_Feature_Metadata *   info)
 {
+   API_TIMED();
    DDCA_Status psc = DDCRC_ARG;
    DDCA_Version_Feature_Info * full_info =  get_version_feature_info_by_vspec(
          feature_code,
@@ -440,6 +454,7 @@ ddca_get_feature_flags_by_vspec(
       DDCA_MCCS_Version_Spec        vspec,
       DDCA_Feature_Flags *          feature_flags)
 {
+   API_TIMED();
    free_thread_error_detail();
    DDCA_Status psc = DDCRC_ARG;
    // assert(feature_flags);
@@ -473,6 +488,7 @@ ddca_get_feature_flags_by_version_id(
       DDCA_MCCS_Version_Id          mccs_version_id,
       DDCA_Feature_Flags *          feature_flags)
 {
+   API_TIMED();
    free_thread_error_detail();
    DDCA_Status psc = DDCRC_ARG;
    DDCA_Version_Feature_Info * full_info =  get_version_feature_info_by_version_id(
@@ -495,6 +511,7 @@ ddca_get_highest_version_sl_values(
       DDCA_Vcp_Feature_Code       feature_code,
       DDCA_Feature_Value_Entry ** sl_table_loc)
 {
+   API_TIMED();
    DDCA_Status rc = DDCRC_NOT_FOUND;
    DDCA_Feature_Value_Entry * result = NULL;
    VCP_Feature_Table_Entry * vfte = vcp_find_feature_by_hexid(feature_code);
@@ -516,6 +533,7 @@ ddca_get_feature_metadata_by_vspec(
       bool                        create_default_if_not_found,
       DDCA_Feature_Metadata **    info_loc) //
 {
+   API_TIMED();
    bool debug = false;
    DBGMSF(debug, "feature_code=0x%02x, vspec=%s, create_default_if_not_found=%s, info_loc=%p",
                  feature_code, format_vspec_verbose(vspec), sbool(create_default_if_not_found), info_loc);
@@ -555,6 +573,7 @@ ddca_get_feature_metadata_by_dref(
       bool                        create_default_if_not_found,
       DDCA_Feature_Metadata **    metadata_loc)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC(debug, TRACE_GROUP, "feature_code=0x%02x, ddca_dref=%p, create_default_if_not_found=%s, meta_loc=%p",
                  feature_code, ddca_dref, sbool(create_default_if_not_found), metadata_loc);
@@ -565,14 +584,13 @@ ddca_get_feature_metadata_by_dref(
          ddca_dref, psc,
          {
                DDCA_Feature_Metadata * external_metadata = NULL;
-               Display_Feature_Metadata * internal_metadata =
-                  dyn_get_feature_metadata_by_dref(feature_code, dref, create_default_if_not_found);
+               Display_Feature_Metadata * internal_metadata =    // owned by cache
+                  dyn_get_cached_feature_metadata_by_dref(feature_code, dref, create_default_if_not_found);
                if (!internal_metadata) {
                   psc = DDCRC_NOT_FOUND;
                }
                else {
                   external_metadata = dfm_to_ddca_feature_metadata(internal_metadata);
-                  dfm_free(internal_metadata);
                }
                *metadata_loc = external_metadata;
          }
@@ -590,6 +608,7 @@ ddca_get_feature_metadata_by_dh(
       bool                        create_default_if_not_found,
       DDCA_Feature_Metadata **    metadata_loc)
 {
+   API_TIMED();
    bool debug = false;
    // if (feature_code == 0xca)
    //    debug = true;
@@ -604,14 +623,13 @@ ddca_get_feature_metadata_by_dh(
                   dbgrpt_display_ref(dh->dref, 1);
 
                DDCA_Feature_Metadata * external_metadata = NULL;
-               Display_Feature_Metadata * internal_metadata =
-                  dyn_get_feature_metadata_by_dh(feature_code, dh, create_default_if_not_found);
+               Display_Feature_Metadata * internal_metadata =    // owned by cache
+                  dyn_get_cached_feature_metadata_by_dh(feature_code, dh, create_default_if_not_found);
                if (!internal_metadata) {
                   psc = DDCRC_NOT_FOUND;
                }
                else {
                   external_metadata = dfm_to_ddca_feature_metadata(internal_metadata);
-                  dfm_free(internal_metadata);
                }
                *metadata_loc = external_metadata;
                ASSERT_IFF(psc == 0, *metadata_loc);
@@ -629,6 +647,7 @@ ddca_get_feature_metadata_by_dh(
 // frees the contents of info, not info itself
 DDCA_Status
 ddca_free_feature_metadata_contents(DDCA_Feature_Metadata info) {
+   API_TIMED();
    if ( memcmp(info.marker, DDCA_FEATURE_METADATA_MARKER, 4) == 0) {
       if (info.feature_flags & DDCA_SYNTHETIC_VCP_FEATURE_TABLE_ENTRY) {
          free(info.feature_name);
@@ -643,6 +662,7 @@ ddca_free_feature_metadata_contents(DDCA_Feature_Metadata info) {
 
 void
 ddca_free_feature_metadata(DDCA_Feature_Metadata* metadata) {
+   API_TIMED();
    if (metadata) {
       // Internal DDCA_Feature_Metadata instances (DDCA_PERSISTENT_METADATA) should never make it out into the wild
       if ( (memcmp(metadata->marker, DDCA_FEATURE_METADATA_MARKER, 4) == 0) &&
@@ -657,6 +677,7 @@ ddca_free_feature_metadata(DDCA_Feature_Metadata* metadata) {
 // returns pointer into permanent internal data structure, caller should not free
 const char *
 ddca_get_feature_name(DDCA_Vcp_Feature_Code feature_code) {
+   API_TIMED();
    // do we want get_feature_name()'s handling of mfg specific and unrecognized codes?
    char * result = get_feature_name_by_id_only(feature_code);
    return result;
@@ -669,6 +690,7 @@ ddca_feature_name_by_vspec(
       DDCA_MCCS_Version_Spec   vspec,
       DDCA_Monitor_Model_Key * p_mmid)  // currently ignored
 {
+   API_TIMED();
    char * result = get_feature_name_by_id_and_vcp_version(feature_code, vspec);
    return result;
 }
@@ -680,6 +702,7 @@ ddca_feature_name_by_version_id(
       DDCA_Vcp_Feature_Code  feature_code,
       DDCA_MCCS_Version_Id   mccs_version_id)
 {
+   API_TIMED();
    DDCA_MCCS_Version_Spec vspec = mccs_version_id_to_spec(mccs_version_id);
    char * result = get_feature_name_by_id_and_vcp_version(feature_code, vspec);
    return result;
@@ -694,6 +717,7 @@ ddca_get_feature_name_by_dref(
       DDCA_Display_Ref       ddca_dref,
       char **                name_loc)
 {
+   API_TIMED();
    DDCA_Status psc = 0;
    WITH_VALIDATED_DR3(ddca_dref, psc,
          {
@@ -722,6 +746,7 @@ ddca_get_simple_sl_value_table_by_vspec(
       const DDCA_Monitor_Model_Key * p_mmid,   // currently ignored
       DDCA_Feature_Value_Entry**     value_table_loc)
 {
+   API_TIMED();
    bool debug = false;
    DDCA_Status rc = 0;
    *value_table_loc = NULL;
@@ -778,6 +803,7 @@ ddca_get_simple_sl_value_table_by_dref(
       DDCA_Display_Ref           ddca_dref,
       DDCA_Feature_Value_Entry** value_table_loc)
 {
+   API_TIMED();
    WITH_DR(ddca_dref,
       {
          assert(value_table_loc);
@@ -797,6 +823,7 @@ ddca_get_simple_sl_value_table(
       DDCA_MCCS_Version_Id       mccs_version_id,
       DDCA_Feature_Value_Entry** value_table_loc)
 {
+   API_TIMED();
    bool debug = false;
    DDCA_Status rc = 0;
    assert(value_table_loc);
@@ -824,6 +851,7 @@ ddca_get_simple_nc_feature_value_name_by_table(
       uint8_t                     feature_value,
       char**                      value_name_loc)
 {
+   API_TIMED();
    // DBGMSG("feature_value_table=%p", feature_value_table);
    // DBGMSG("*feature_value_table=%p", *feature_value_table);
    DDCA_Status rc = 0;
@@ -847,6 +875,7 @@ ddca_get_simple_nc_feature_value_name_by_vspec(
       uint8_t                  feature_value,
       char**                   feature_name_loc)
 {
+   API_TIMED();
    assert(feature_name_loc);
    free_thread_error_detail();
    DDCA_Feature_Value_Entry * feature_value_entries = NULL;
@@ -872,6 +901,7 @@ ddca_get_simple_nc_feature_value_name_by_display(
       uint8_t                feature_value,
       char**                 feature_name_loc)
 {
+   API_TIMED();
    WITH_DH(ddca_dh,  {
          DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_dh(dh);
          DDCA_Monitor_Model_Key * p_mmid = dh->dref->mmid;
@@ -887,6 +917,7 @@ ddca_dbgrpt_feature_metadata(
       DDCA_Feature_Metadata * md,
       int                     depth)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "");
    // rpt_push_output_dest(stdout);
@@ -903,6 +934,7 @@ ddca_dbgrpt_feature_metadata(
 bool
 ddca_enable_udf(bool onoff)
 {
+   API_TIMED();
    bool oldval = enable_dynamic_features;
    enable_dynamic_features = onoff;
    return oldval;
@@ -912,6 +944,7 @@ ddca_enable_udf(bool onoff)
 bool
 ddca_is_udf_enabled(void)
 {
+   API_TIMED();
    return enable_dynamic_features;
 }
 
@@ -919,6 +952,7 @@ ddca_is_udf_enabled(void)
 DDCA_Status
 ddca_dfr_check_by_dref(DDCA_Display_Ref ddca_dref)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, TRACE_GROUP, "ddca_dref=%p", ddca_dref);
 
@@ -941,6 +975,7 @@ ddca_dfr_check_by_dref(DDCA_Display_Ref ddca_dref)
 DDCA_Status
 ddca_dfr_check_by_dh(DDCA_Display_Handle ddca_dh)
 {
+   API_TIMED();
    bool debug = false;
    DBGTRC_STARTING(debug, DDCA_TRC_API, "ddca_dh=%p", ddca_dh);
    WITH_VALIDATED_DH2(ddca_dh,
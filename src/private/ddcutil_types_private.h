@@ -96,8 +96,7 @@ typedef struct {
 } DDCA_Queued_Request;
 
 
-/** Callback function to report VCP value change */
-typedef void (*DDCA_Notification_Func)(DDCA_Status psc, DDCA_Any_Vcp_Value* valrec);
+// DDCA_Notification_Func is now defined in ddcutil_types.h
 
 typedef int (*Simple_Callback_Func)(int val);
 
@@ -241,6 +241,451 @@ ddca_enable_verify(
 bool
 ddca_is_verify_enabled(void);
 
+/** Controls whether verification of VCP values adapts to each display.
+ *
+ *  When enabled and verification is in effect, see #ddca_enable_verify(),
+ *  the outcome of verifying writes is tracked for each display and feature.
+ *  Once the last 10 verifications of a feature have passed, only every 8th
+ *  write of the feature is verified.  A value read back that does not match
+ *  the value written returns the feature to verifying every write.  Writes
+ *  that return the verified value are always verified.
+ *
+ *  The numbers of verifications passed, failed, and skipped are reported
+ *  by #ddca_export_stats().
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+bool
+ddca_enable_adaptive_verify(
+      bool onoff);
+
+/** Query whether verification of VCP values adapts to each display.
+ * \retval true  verification is adaptive
+ * \retval false all values are verified if verification is enabled
+ *
+ * \since 1.3.0
+ */
+bool
+ddca_is_adaptive_verify_enabled(void);
+
+/** Controls whether writes to Continuous features are coalesced.
+ *
+ *  When enabled, #ddca_set_non_table_vcp_value() queues a write to a
+ *  Continuous feature (e.g. brightness or contrast) instead of performing
+ *  it immediately, and returns as soon as it is queued.  A queued write that
+ *  has not yet been sent replaces any earlier write to the same feature on
+ *  the same display, so only the newest value goes to the monitor once the
+ *  bus is free.  If verification is enabled, the value is read back only
+ *  after the last write.
+ *
+ *  The outcome of each write actually performed is reported to the function
+ *  registered with #ddca_register_callback(), if any.  Writes that request
+ *  the verified value are never coalesced.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+bool
+ddca_enable_setvcp_coalescing(
+      bool onoff);
+
+/** Query whether writes to Continuous features are coalesced.
+ * \retval true  writes are coalesced
+ * \retval false writes are performed immediately
+ *
+ * \since 1.3.0
+ */
+bool
+ddca_is_setvcp_coalescing_enabled(void);
+
+/** Controls whether identical concurrent reads are coalesced.
+ *
+ *  When enabled, a thread that reads a feature of a display while another
+ *  thread is already reading the same feature of the same display, with the
+ *  same value type, waits for that read instead of performing its own DDC
+ *  transaction, and receives a copy of its value or status.  The waiting
+ *  thread's deadline and cancel token remain in effect.  A read never shares
+ *  the result of a read that started before a write of the feature.
+ *
+ *  The number of reads performed and shared is reported by
+ *  #ddca_export_stats().
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+bool
+ddca_enable_read_coalescing(
+      bool onoff);
+
+/** Query whether identical concurrent reads are coalesced.
+ * \retval true  reads are coalesced
+ * \retval false each read performs its own DDC transaction
+ *
+ * \since 1.3.0
+ */
+bool
+ddca_is_read_coalescing_enabled(void);
+
+/** Controls whether non-table feature values are cached.
+ *
+ *  When enabled, #ddca_get_non_table_vcp_value() returns the value most
+ *  recently read from or written to the display if it is recent enough,
+ *  instead of querying the monitor.  Values of read only features that
+ *  cannot change, e.g. xdf (VCP version) or xc9 (firmware level), are
+ *  retained until the display is disconnected.  Values of read/write
+ *  features are retained for 2 seconds, those of other read only features
+ *  for 0.5 seconds.  Features x02 and x52 are never cached.
+ *
+ *  Successful writes to a Continuous feature update its cached value.
+ *  Changes made using the monitor's on screen display are not seen until
+ *  the cached value expires.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+bool
+ddca_enable_vcp_value_cache(
+      bool onoff);
+
+/** Query whether non-table feature values are cached.
+ * \retval true  values are cached
+ * \retval false every read queries the monitor
+ *
+ * \since 1.3.0
+ */
+bool
+ddca_is_vcp_value_cache_enabled(void);
+
+/** Controls whether table feature values are memoized.
+ *
+ *  When enabled, the value of a table feature read from or successfully
+ *  written to a display is remembered, and subsequent reads of the feature
+ *  return it without a multi-part read.  A memoized value does not expire.
+ *  It is discarded when a change to the feature is detected, see
+ *  #ddca_start_watch_vcp_changes(), when a write of the feature fails,
+ *  or by #ddca_invalidate_cached_vcp_values().
+ *
+ *  Use only for features that do not change except when written using
+ *  this library.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+bool
+ddca_enable_table_value_memo(
+      bool onoff);
+
+/** Query whether table feature values are memoized.
+ * \retval true  values are memoized
+ * \retval false every read queries the monitor
+ *
+ * \since 1.3.0
+ */
+bool
+ddca_is_table_value_memo_enabled(void);
+
+/** Discards all cached non-table feature values and memoized table
+ *  feature values for a display, e.g. after its settings were changed
+ *  by another program.
+ *
+ *  \param[in] ddca_dref   display reference
+ *  \retval    DDCRC_OK    success
+ *  \retval    DDCRC_ARG   invalid display reference
+ *  \since 1.3.0
+ */
+DDCA_Status
+ddca_invalidate_cached_vcp_values(
+      DDCA_Display_Ref  ddca_dref);
+
+/** Controls whether DDC communication is suppressed while a display is
+ *  in a power saving state.
+ *
+ *  When enabled, a display is considered asleep if the dpms attribute of
+ *  its DRM connector is other than "On", or if feature xD6 (Power Mode)
+ *  reported a power saving mode within the last 10 seconds.  Operations
+ *  on a sleeping display then fail immediately with status
+ *  #DDCRC_DISPLAY_ASLEEP, instead of tying up the bus while retries are
+ *  exhausted.  Communication resumes as soon as the DRM connector is turned
+ *  on.  Reads and writes of feature xD6 are always performed, so the
+ *  display can be woken.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+bool
+ddca_enable_power_state_tracking(
+      bool onoff);
+
+/** Query whether DDC communication is suppressed while a display is
+ *  in a power saving state.
+ * \retval true  communication is suppressed
+ * \retval false communication is always attempted
+ *
+ * \since 1.3.0
+ */
+bool
+ddca_is_power_state_tracking_enabled(void);
+
+
+/** Controls whether the device file of a display is kept open after the
+ *  display is closed, so that the next #ddca_open_display2() for the display
+ *  reuses it.  This benefits clients that open and close a display for each
+ *  request.
+ *
+ *  A file descriptor that has been idle for longer than the timeout is
+ *  closed the next time a display is opened or closed, and all are closed
+ *  by #ddca_redetect_displays() and at library termination.
+ *  Applies only to I2C displays.
+ *
+ * \param[in] millisec  idle timeout, 0 to disable
+ * \return    prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+int
+ddca_set_fd_pool_idle_timeout(
+      int millisec);
+
+/** Returns the idle timeout set by #ddca_set_fd_pool_idle_timeout().
+ * \return idle timeout in milliseconds, 0 if disabled
+ *
+ * \since 1.3.0
+ */
+int
+ddca_get_fd_pool_idle_timeout(void);
+
+/** Sets the priority of the DDC transactions performed by the current thread.
+ *
+ *  Only one thread performs a DDC exchange on a display at a time.  When
+ *  several are waiting, the one with the highest priority goes next.  Since
+ *  each fragment of a capabilities or table read is a separate exchange,
+ *  a write with interactive priority does not wait for a long read with
+ *  background priority to complete.
+ *
+ *  Writes from a thread with normal priority are performed with interactive
+ *  priority.  Requests queued using #ddca_queue_get_non_table_vcp_value()
+ *  are performed with background priority, queued writes with interactive
+ *  priority.
+ *
+ * \param[in] priority  new priority
+ * \return    prior priority
+ *
+ * \remark This setting is thread-specific.
+ * \since 1.3.0
+ */
+DDCA_IO_Priority
+ddca_set_thread_io_priority(
+      DDCA_IO_Priority priority);
+
+/** Returns the priority set by #ddca_set_thread_io_priority().
+ * \return priority of the current thread, #DDCA_IO_PRIORITY_NORMAL if not set
+ *
+ * \since 1.3.0
+ */
+DDCA_IO_Priority
+ddca_get_thread_io_priority(void);
+
+/** Sets a deadline for the DDC operations performed by the current thread.
+ *
+ *  The deadline is checked before each try of a DDC exchange, before each
+ *  fragment of a capabilities or table read, and while waiting to open
+ *  a display.  Once it has passed, the operation in progress fails with
+ *  DDCRC_TIMEOUT.  Since an exchange is never interrupted, the display is
+ *  left in a consistent state, and its lock is not held.
+ *
+ *  The deadline applies to all subsequent calls on the thread, e.g. an
+ *  application can set it before calling #ddca_get_capabilities_string()
+ *  and clear it afterwards.
+ *
+ * \param[in] millis  deadline, in milliseconds from now, 0 for no deadline
+ *
+ * \remark This setting is thread-specific.
+ * \since 1.3.0
+ */
+void
+ddca_set_thread_deadline(
+      uint32_t millis);
+
+/** Creates a token that can be used to cancel DDC operations.
+ *
+ * \param[out] token_loc  where to return the token
+ * \retval DDCRC_OK
+ * \retval DDCRC_ARG  token_loc == NULL
+ *
+ * \since 1.3.0
+ */
+DDCA_Status
+ddca_create_cancel_token(
+      DDCA_Cancel_Token* token_loc);
+
+/** Frees a cancel token.
+ *
+ *  The token must not be set on any thread, see #ddca_set_thread_cancel_token().
+ *
+ * \param[in] token  token to free, if NULL do nothing
+ * \retval DDCRC_OK
+ * \retval DDCRC_ARG  invalid token
+ *
+ * \since 1.3.0
+ */
+DDCA_Status
+ddca_free_cancel_token(
+      DDCA_Cancel_Token token);
+
+/** Cancels the DDC operations of all threads using a token.
+ *
+ *  The operations fail with DDCRC_CANCELLED at the same points at which a
+ *  deadline is checked, see #ddca_set_thread_deadline().  Subsequent
+ *  operations using the token fail immediately.  Can be called from any
+ *  thread, e.g. a user interface thread.
+ *
+ * \param[in] token  token to cancel
+ * \retval DDCRC_OK
+ * \retval DDCRC_ARG  invalid token
+ *
+ * \since 1.3.0
+ */
+DDCA_Status
+ddca_cancel(
+      DDCA_Cancel_Token token);
+
+/** Sets the cancel token checked by the DDC operations of the current thread.
+ *
+ * \param[in] token  token, NULL for none
+ * \return    prior token
+ *
+ * \remark This setting is thread-specific.
+ * \since 1.3.0
+ */
+DDCA_Cancel_Token
+ddca_set_thread_cancel_token(
+      DDCA_Cancel_Token token);
+
+/** Limits how long #ddca_open_display2() waits for a display that is
+ *  open in another thread, when called with **wait** = true.
+ *
+ *  If the display cannot be opened within the timeout, #ddca_open_display2()
+ *  returns DDCRC_LOCKED, as when **wait** = false.
+ *
+ * \param[in] millis  timeout in milliseconds, 0 to wait indefinitely
+ * \return    prior value
+ *
+ * \remark This setting is global, not thread-specific.  A deadline set
+ *         by #ddca_set_thread_deadline() also ends the wait.
+ * \since 1.3.0
+ */
+uint32_t
+ddca_set_display_lock_timeout(
+      uint32_t millis);
+
+/** Limits the number of DDC exchanges per second on each I2C bus.
+ *
+ *  Some monitors become unresponsive when queried too frequently.
+ *
+ * \param[in] per_sec  maximum rate, 0 for no limit
+ * \return    prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+int
+ddca_set_max_transaction_rate(
+      int per_sec);
+
+/** Returns the limit set by #ddca_set_max_transaction_rate().
+ * \return maximum exchanges per second, 0 if no limit
+ *
+ * \since 1.3.0
+ */
+int
+ddca_get_max_transaction_rate(void);
+
+/** Limits the number of simultaneous DDC exchanges on I2C buses that share
+ *  a physical adapter, e.g. the DisplayPort connectors of one video card or
+ *  the displays on an MST hub.
+ *
+ *  Buses on the same adapter may share one I2C engine, so exchanges
+ *  performed in parallel are serialized in the kernel and can time out.
+ *
+ * \param[in] limit  maximum simultaneous exchanges, 0 for no limit
+ * \return    prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+int
+ddca_set_max_adapter_concurrency(
+      int limit);
+
+/** Returns the limit set by #ddca_set_max_adapter_concurrency().
+ * \return maximum simultaneous exchanges, 0 if no limit
+ *
+ * \since 1.3.0
+ */
+int
+ddca_get_max_adapter_concurrency(void);
+
+/** Directs DDC/CI communication to a simulated monitor instead of the
+ *  I2C bus, so that performance measurements are repeatable.
+ *
+ *  The control file sets the simulated response latency, the minimum
+ *  write to read delay, the fraction of responses returned corrupted,
+ *  and the monitor's capabilities string and feature values.
+ *  EDID reads still go to the bus.
+ *
+ * \param[in] control_fn  control file name, NULL to stop simulation
+ * \retval    DDCRC_OK        success
+ * \retval    DDCRC_BAD_DATA  invalid control file
+ * \retval    -errno          error reading control file
+ *
+ * \remark This setting is global, not thread-specific.
+ * \remark Also set by option **--simulate-monitor**
+ * \since 1.3.0
+ */
+DDCA_Status
+ddca_enable_simulated_monitor(
+      const char * control_fn);
+
+/** Sets the interval used to debounce #ddca_save_current_settings().
+ *
+ * \param[in] millisec  interval, 0 to send each save immediately
+ * \return    prior value
+ *
+ * \remark This setting is global, not thread-specific.
+ * \since 1.3.0
+ */
+int
+ddca_set_save_settings_debounce(
+      int millisec);
+
+/** Returns the interval set by #ddca_set_save_settings_debounce().
+ * \return interval in milliseconds, 0 if saves are not debounced
+ *
+ * \since 1.3.0
+ */
+int
+ddca_get_save_settings_debounce(void);
+
 
 /** Controls the force I2C slave address setting.
  *
@@ -313,6 +758,101 @@ double
 ddca_get_sleep_multiplier();
 
 
+//
+// Per display I/O settings
+//
+// These settings apply to a single display, regardless of the thread
+// performing I/O, and take precedence over the thread and global settings.
+// They are kept in the display reference, so they are lost if displays
+// are redetected and the display reference is replaced.
+//
+
+/** Sets the sleep multiplier factor for a display.
+ *
+ *  @param[in] ddca_dref   display reference
+ *  @param[in] multiplier  sleep multiplier, 0 to use the thread setting
+ *  @retval DDCRC_OK   success
+ *  @retval DDCRC_ARG  invalid display reference or negative multiplier
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_set_display_sleep_multiplier(
+      DDCA_Display_Ref  ddca_dref,
+      double            multiplier);
+
+/** Gets the sleep multiplier factor that applies to a display when
+ *  accessed from the current thread.
+ *
+ *  @param[in]  ddca_dref       display reference
+ *  @param[out] multiplier_loc  where to return the multiplier
+ *  @retval DDCRC_OK   success
+ *  @retval DDCRC_ARG  invalid display reference
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_get_display_sleep_multiplier(
+      DDCA_Display_Ref  ddca_dref,
+      double *          multiplier_loc);
+
+/** Sets the maximum number of tries for an operation type on a display.
+ *
+ *  @param[in] ddca_dref   display reference
+ *  @param[in] retry_type  I2C operation type
+ *  @param[in] max_tries   maximum count, 0 to use the global setting
+ *  @retval DDCRC_OK   success
+ *  @retval DDCRC_ARG  invalid display reference, retry type or count
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_set_display_max_tries(
+      DDCA_Display_Ref  ddca_dref,
+      DDCA_Retry_Type   retry_type,
+      int               max_tries);
+
+/** Gets the maximum number of tries for an operation type on a display.
+ *
+ *  @param[in]  ddca_dref      display reference
+ *  @param[in]  retry_type     I2C operation type
+ *  @param[out] max_tries_loc  where to return the maximum count
+ *  @retval DDCRC_OK   success
+ *  @retval DDCRC_ARG  invalid display reference or retry type
+ *
+ *  @remark
+ *  If adaptive maxtries is enabled, fewer tries may be performed.
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_get_display_max_tries(
+      DDCA_Display_Ref  ddca_dref,
+      DDCA_Retry_Type   retry_type,
+      int *             max_tries_loc);
+
+/** Enables or disables dynamic sleep adjustment for a display.
+ *
+ *  @param[in] ddca_dref  display reference
+ *  @param[in] onoff      true to enable, false to disable
+ *  @retval DDCRC_OK   success
+ *  @retval DDCRC_ARG  invalid display reference
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_enable_display_dynamic_sleep(
+      DDCA_Display_Ref  ddca_dref,
+      bool              onoff);
+
+/** Discards all per display I/O settings for a display, so that the
+ *  thread and global settings apply.
+ *
+ *  @param[in] ddca_dref  display reference
+ *  @retval DDCRC_OK   success
+ *  @retval DDCRC_ARG  invalid display reference
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_reset_display_io_settings(
+      DDCA_Display_Ref  ddca_dref);
+
+
 //
 // Output Redirection
 //
@@ -344,6 +884,11 @@ ddca_set_ferr_to_default(void);
 /** Begins capture of **stdout** and optionally **stderr** output on the
  *  current thread to a thread-specific in-memory buffer.
  *
+ *  If flag **DDCA_CAPTURE_DISCARD** is set, output is instead discarded
+ *  until #ddca_end_capture() is called.  No in-memory buffer is created,
+ *  and report text is not formatted at all, which saves the cost of
+ *  building output that a client would throw away.
+ *
  *  @note  If output is already being captured, this function has no effect.
  *  @since 0.9.0
  */
@@ -361,7 +906,8 @@ ddca_start_capture(
  *  @return captured output as a string, caller responsible for freeing
  *
  *  @note
- *  If output is not currently being captured, returns a 0 length string.
+ *  If output is not currently being captured, or is being discarded,
+ *  returns a 0 length string.
  *
  *  @note  Writes messages to actual **stderr** in case of error.
  *  @since 0.9.0
@@ -476,6 +1022,32 @@ ddca_trace_group_name_to_value(char * name);
 void
 ddca_set_trace_options(DDCA_Trace_Options  options);
 
+/** Enables or disables recording of binary trace events.
+ *
+ *  Each thread records its most recent DDC and I2C operations and sleeps
+ *  in a ring buffer.  Recording is inexpensive enough to be left enabled
+ *  in production, so that the events leading up to an intermittent failure
+ *  can be reported using #ddca_report_trace_events().
+ *
+ *  \param[in] onoff  true to enable, false to disable
+ *  \return    prior setting
+ *
+ *  \remark
+ *  Has no effect if ddcutil was configured with --disable-trace-ring.
+ *  \since 1.3.0
+ */
+bool
+ddca_enable_trace_events(bool onoff);
+
+/** Reports the recorded trace events of all threads, in time order.
+ *
+ *  \param[in] depth  logical indentation depth
+ *
+ *  \since 1.3.0
+ */
+void
+ddca_report_trace_events(int depth);
+
 
 //
 // Performance Options
@@ -528,7 +1100,142 @@ ddca_show_stats(
       bool            include_per_thread_data,
       int             depth);
 
-// TODO: Add functions to get stats
+/** Gets a snapshot of the latency statistics.
+ *
+ *  The snapshot contains the distribution of the elapsed time of DDC
+ *  operations for each display, and of the requested and actual sleep
+ *  time for each sleep event type.
+ *
+ *  \param[out] snapshot_loc  where to return pointer to newly allocated snapshot
+ *  \retval     DDCRC_OK      success
+ *  \retval     DDCRC_ARG     snapshot_loc is NULL
+ *
+ *  \remark
+ *  Use #ddca_free_stats() to free the snapshot.
+ *  \since 1.3.0
+ */
+DDCA_Status
+ddca_get_stats(
+      DDCA_Stats_Snapshot ** snapshot_loc);
+
+/** Frees a snapshot returned by #ddca_get_stats().
+ *
+ *  \param[in] snapshot  pointer to snapshot, if NULL do nothing
+ *  \since 1.3.0
+ */
+void
+ddca_free_stats(
+      DDCA_Stats_Snapshot * snapshot);
+
+/** Gets the health of a display.
+ *
+ *  The score combines the recent rate of failed tries, the 95th percentile
+ *  of recent write/read exchange times, and the current sleep multiplier,
+ *  including any dynamic sleep adjustment.  A display on which no exchanges
+ *  have occurred has score 100.
+ *
+ *  Background priority transactions, see #ddca_set_thread_io_priority(),
+ *  on a display with a low score are spaced out.
+ *
+ *  \param[in]  ddca_dref   display reference
+ *  \param[out] health_loc  where to return the health
+ *  \retval     DDCRC_OK    success
+ *  \retval     DDCRC_ARG   invalid display reference, or health_loc is NULL
+ *  \since 1.3.0
+ */
+DDCA_Status
+ddca_get_display_health(
+      DDCA_Display_Ref      ddca_dref,
+      DDCA_Display_Health * health_loc);
+
+/** Exports all statistics in a machine readable format.
+ *
+ *  Exports the counters of I/O calls, status codes, sleeps, retries and
+ *  dynamic sleep adjustment, and the latency distributions, using
+ *  Prometheus naming conventions.
+ *
+ *  \param[in]  format    #DDCA_STATS_FORMAT_JSON or #DDCA_STATS_FORMAT_PROMETHEUS
+ *  \param[out] text_loc  where to return newly allocated string,
+ *                        which the caller must free
+ *  \retval     DDCRC_OK  success
+ *  \retval     DDCRC_ARG invalid format, or text_loc is NULL
+ *
+ *  \since 1.3.0
+ */
+DDCA_Status
+ddca_export_stats(
+      DDCA_Stats_Export_Format format,
+      char **                  text_loc);
+
+/** Creates a cursor that records the current values of all statistics.
+ *
+ *  Unlike #ddca_reset_stats(), a cursor does not change the global
+ *  statistics, so multiple consumers, e.g. a metrics exporter and an
+ *  interactive tool, can each observe rates using their own cursor.
+ *
+ *  \param[out] cursor_loc  where to return the cursor
+ *  \retval     DDCRC_OK    success
+ *  \retval     DDCRC_ARG   cursor_loc is NULL
+ *
+ *  \remark
+ *  Use #ddca_free_stats_cursor() to free the cursor.
+ *  \since 1.3.0
+ */
+DDCA_Status
+ddca_create_stats_cursor(
+      DDCA_Stats_Cursor *      cursor_loc);
+
+/** Exports all statistics as deltas since a cursor, in the formats of
+ *  #ddca_export_stats().
+ *
+ *  Counters are reported as their increase since the cursor, or as their
+ *  current value if they have been reset since, and latency summaries
+ *  describe only the operations and sleeps recorded since the cursor.
+ *  Gauges are reported unchanged.
+ *
+ *  \param[in]  cursor    cursor created by #ddca_create_stats_cursor()
+ *  \param[in]  format    #DDCA_STATS_FORMAT_JSON or #DDCA_STATS_FORMAT_PROMETHEUS
+ *  \param[in]  advance   if true, the cursor is moved to the current values,
+ *                        so that the next call reports the following interval
+ *  \param[out] text_loc  where to return newly allocated string,
+ *                        which the caller must free
+ *  \retval     DDCRC_OK  success
+ *  \retval     DDCRC_ARG invalid cursor or format, or text_loc is NULL
+ *
+ *  \remark
+ *  A cursor must not be used by multiple threads at the same time.
+ *  \since 1.3.0
+ */
+DDCA_Status
+ddca_export_stats_delta(
+      DDCA_Stats_Cursor        cursor,
+      DDCA_Stats_Export_Format format,
+      bool                     advance,
+      char **                  text_loc);
+
+/** Frees a cursor created by #ddca_create_stats_cursor().
+ *
+ *  \param[in] cursor  cursor, if NULL do nothing
+ *  \since 1.3.0
+ */
+void
+ddca_free_stats_cursor(
+      DDCA_Stats_Cursor        cursor);
+
+/** Enables or disables recording of lock contention statistics.
+ *
+ *  For the locks guarding each display, the retry statistics, and the
+ *  per-thread data, counts acquisitions, acquisitions that had to wait,
+ *  and the total and maximum wait time.  The statistics are reported by
+ *  #ddca_show_stats() with #DDCA_STATS_LATENCY, and by #ddca_export_stats().
+ *
+ *  \param[in] onoff  true to enable, false to disable
+ *  \return    prior setting
+ *
+ *  \since 1.3.0
+ */
+bool
+ddca_enable_lock_stats(bool onoff);
 
 /** Enable display of internal exception reports (Error_Info).
  *
@@ -569,6 +1276,42 @@ ddca_enable_usb_display_detection(bool onoff);
 bool
 ddca_ddca_is_usb_display_detection_enabled();
 
+/** Controls whether display detection reads only EDIDs.
+ *
+ *  With EDID-only detection the EDID of each display is taken from
+ *  /sys/class/drm when the kernel exposes it, otherwise it is read over I2C.
+ *  The I2C buses are not probed for the DDC slave address, and no DDC
+ *  communication checks are performed, so monitors in a power saving mode
+ *  are not woken.  Every display found is assigned a display number, which
+ *  does not indicate that the display supports DDC/CI.
+ *
+ *  Intended for collecting an inventory of connected monitors, e.g. using
+ *  #ddca_get_display_info_list2().
+ *
+ *  Must be called before any API call that triggers display detection.
+ *
+ *  @param[in] onoff
+ *  @retval    DDCRC_OK                success
+ *  @retval    DDCRC_INVALID_OPERATION display detection has already occurred
+ *
+ *  @remark
+ *  The default is full detection.
+ *
+ *  This setting is global to all threads.
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_enable_edid_only_detection(bool onoff);
+
+/** Reports whether display detection reads only EDIDs
+ *
+ *  @retval true  EDID-only detection
+ *  @retval false full detection
+ *  @since 1.3.0
+ */
+bool
+ddca_is_edid_only_detection_enabled();
+
 /** Gets display references list for all detected displays.
  *
  *  @param[in]  include_invalid_displays if true, displays that do not support DDC are included
@@ -635,6 +1378,32 @@ void
 ddca_free_display_info_list(
       DDCA_Display_Info_List * dlist);
 
+/** Gets a snapshot of the detected displays, unless the display list is
+ *  unchanged since an earlier snapshot.
+ *
+ *  The display list generation changes whenever displays are detected,
+ *  redetected, or discarded.  If **known_generation** is the current
+ *  generation, the function returns at once without building a snapshot.
+ *  Pass 0 to always obtain a snapshot.
+ *
+ *  @param[in]  include_invalid_displays if true, displays that do not support DDC are included
+ *  @param[in]  known_generation  generation of the caller's current snapshot, or 0
+ *  @param[out] snapshot_loc      where to return pointer to a newly allocated
+ *                                #DDCA_Display_Info_Snapshot, set to NULL if
+ *                                the display list is unchanged
+ *  @retval     DDCRC_OK   success, including when the list is unchanged
+ *  @retval     DDCRC_ARG  snapshot_loc is NULL
+ *
+ *  @remark
+ *  The snapshot is a single block of memory, to be released using free().
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_get_display_info_snapshot(
+      bool                           include_invalid_displays,
+      uint32_t                       known_generation,
+      DDCA_Display_Info_Snapshot **  snapshot_loc);
+
 /** Presents a report on a single display.
  *  The report is written to the current FOUT device for the current thread.
  *
@@ -687,6 +1456,71 @@ ddca_report_displays(
 DDCA_Status
 ddca_redetect_displays();
 
+/** Registers a function to be called when a display is connected,
+ *  disconnected, or replaced by a different monitor.
+ *
+ *  When a DRM connector changes, the displays are redetected, probing only
+ *  the I2C buses whose connectors changed, and one event is reported for
+ *  each affected display.  The #DDCA_Display_Ref of other displays remain
+ *  valid, so clients need not poll #ddca_get_display_refs().
+ *
+ *  The function is called on the library's display watch thread.
+ *
+ *  @param[in]  func  function to register
+ *  @retval DDCRC_OK
+ *  @retval DDCRC_INVALID_OPERATION  display change detection unavailable,
+ *                                   e.g. no DRM video driver
+ *
+ *  @remark
+ *  If incremental redetection is not possible, e.g. because USB display
+ *  detection is enabled, all display references are freed when displays
+ *  are redetected.  A #DDCA_EVENT_DISPLAY_DISCONNECTED event with a NULL
+ *  **dref** is reported for every previously detected display, followed by
+ *  a #DDCA_EVENT_DISPLAY_CONNECTED event for every display now detected.
+ *  @remark
+ *  Events are reported only after displays have first been detected,
+ *  e.g. by #ddca_get_display_refs().
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_register_display_status_callback(
+      DDCA_Display_Status_Callback_Func func);
+
+/** Unregisters a function registered by #ddca_register_display_status_callback().
+ *
+ *  @param[in]  func  function to unregister
+ *  @retval DDCRC_OK
+ *  @retval DDCRC_INVALID_OPERATION  function was not registered
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_unregister_display_status_callback(
+      DDCA_Display_Status_Callback_Func func);
+
+/** Starts display detection without waiting for it to complete, reporting
+ *  each display as soon as DDC communication with it has been verified.
+ *
+ *  Displays are checked in parallel, so a display that is slow to respond
+ *  does not delay the report of the others.  **func** is called with each
+ *  valid display, on the library thread that checked it.  The display can
+ *  be opened immediately, but its display number is assigned only when
+ *  detection is complete.  **func** is then called with NULL, after which
+ *  #ddca_get_display_refs() returns without waiting.
+ *
+ *  If displays have already been detected, **func** is called for each
+ *  valid display and then with NULL.
+ *
+ *  @param[in]  func  function to call
+ *  @retval DDCRC_OK                 detection started
+ *  @retval DDCRC_ARG                **func** is NULL
+ *  @retval DDCRC_INVALID_OPERATION  a detection started by this function
+ *                                   is already in progress
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_start_display_detection(
+      DDCA_Display_Detection_Callback_Func func);
+
 
 //
 // Display Identifier
@@ -890,11 +1724,18 @@ ddca_dbgrpt_display_ref(
 
 /** Open a display
  * @param[in]  ddca_dref    display reference for display to open
- * @param[in]  wait         if true, wait if display locked by another thread
+ * @param[in]  wait         if true, wait if display already open
  * @param[out] ddca_dh_loc  where to return display handle
  * @return     status code
  *
- * Fails if display is already opened by another thread.
+ * If the display is already open and **wait** is false, fails with
+ * DDCRC_LOCKED.  If **wait** is true, waiting callers are granted the
+ * display in the order in which they asked for it.
+ *
+ * The display handle returned is not tied to the opening thread. It can be
+ * passed to, used by, and closed on any thread.  Operations on the handle
+ * by different threads are performed one at a time. The handle must not be
+ * used after ddca_close_display() has been called on it.
  * \ingroup api_display_spec
  */
 DDCA_Status
@@ -1572,6 +2413,111 @@ ddca_get_non_table_vcp_value(
        DDCA_Vcp_Feature_Code      feature_code,
        DDCA_Non_Table_Vcp_Value*  valrec);
 
+/** Gets the value of a non-table VCP feature from multiple displays.
+ *
+ * The DDC exchanges with all the displays are interleaved in the calling
+ * thread: while one display is in its write-to-read delay, another is
+ * accessed.  Reading N displays this way takes little longer than reading
+ * one, without requiring a thread per display.
+ *
+ * @param[in]  ddca_dhs      array of display handles
+ * @param[in]  dh_ct         number of display handles
+ * @param[in]  feature_code  VCP feature code
+ * @param[out] valrecs       array of **dh_ct** response buffers provided
+ *                           by the caller, which will be filled in
+ * @param[out] statuses      array of **dh_ct** status codes provided by the
+ *                           caller, set to the status of each read
+ * @retval DDCRC_OK     reads performed, see **statuses** for the result of each
+ * @retval DDCRC_ARG    invalid display handle or argument
+ *
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_get_non_table_vcp_values_multi(
+       DDCA_Display_Handle *      ddca_dhs,
+       int                        dh_ct,
+       DDCA_Vcp_Feature_Code      feature_code,
+       DDCA_Non_Table_Vcp_Value*  valrecs,
+       DDCA_Status *              statuses);
+
+/** Gets the value of a non-table VCP feature from multiple displays,
+ *  given their display references.
+ *
+ * Each display is opened by the library, and the reads from all displays
+ * are performed concurrently, each by the display's worker thread.  Reads
+ * from displays on the same physical adapter are still limited as set by
+ * #ddca_set_max_adapter_concurrency().
+ *
+ * @param[in]  ddca_drefs    array of display references
+ * @param[in]  dref_ct       number of display references
+ * @param[in]  feature_code  VCP feature code
+ * @param[out] valrecs       array of **dref_ct** response buffers provided
+ *                           by the caller, which will be filled in
+ * @param[out] statuses      array of **dref_ct** status codes provided by the
+ *                           caller, set to the status of each read
+ * @retval DDCRC_OK     reads performed, see **statuses** for the result of each
+ * @retval DDCRC_ARG    invalid display reference or argument
+ *
+ * @remark
+ * The displays must not be open in the calling program.
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_get_non_table_vcp_values_by_drefs(
+       DDCA_Display_Ref *         ddca_drefs,
+       int                        dref_ct,
+       DDCA_Vcp_Feature_Code      feature_code,
+       DDCA_Non_Table_Vcp_Value*  valrecs,
+       DDCA_Status *              statuses);
+
+/** Reads non-table VCP features from multiple displays at fixed intervals.
+ *
+ * Round N is scheduled at start + N * **interval_millisec**, so the
+ * schedule does not drift.  At each scheduled time the reads of a display
+ * are queued to the display's worker thread, so the displays are read
+ * concurrently.  A display whose previous round has not completed skips the
+ * round, which is counted as a missed deadline, rather than falling behind.
+ *
+ * @param[in]  ddca_drefs         array of display references
+ * @param[in]  dref_ct            number of display references
+ * @param[in]  feature_codes      array of features to read from each display
+ * @param[in]  feature_ct         number of features
+ * @param[in]  interval_millisec  time between rounds
+ * @param[in]  round_ct           number of rounds, 0 to continue until
+ *                                #ddca_stop_feature_sampling() is called
+ * @param[in]  func               called in the calling thread for each value read
+ * @param[in]  arg                passed to **func**
+ * @param[out] missed_ct_loc      if non-NULL, receives the total number of
+ *                                deadlines missed by all displays
+ * @retval DDCRC_OK     sampling completed or was stopped
+ * @retval DDCRC_ARG    invalid display reference or argument
+ * @retval other        error opening a display, no samples taken
+ *
+ * @remark
+ * The displays must not be open in the calling program.
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_sample_features(
+       DDCA_Display_Ref *         ddca_drefs,
+       int                        dref_ct,
+       DDCA_Vcp_Feature_Code *    feature_codes,
+       int                        feature_ct,
+       int                        interval_millisec,
+       int                        round_ct,
+       DDCA_Feature_Sample_Func   func,
+       void *                     arg,
+       int *                      missed_ct_loc);
+
+/** Ends #ddca_sample_features() after its current round.
+ *
+ * May be called from another thread or from a signal handler.
+ *
+ * @since 1.3.0
+ */
+void
+ddca_stop_feature_sampling();
+
 /** Gets the value of a table VCP feature.
  *
  * @param[in]  ddca_dh         display handle
@@ -1591,6 +2537,55 @@ ddca_get_table_vcp_value(
        DDCA_Vcp_Feature_Code   feature_code,
        DDCA_Table_Vcp_Value ** table_value_loc);
 
+/** Gets the value of a table VCP feature into a buffer owned by the caller.
+ *
+ * @param[in]  ddca_dh         display handle
+ * @param[in]  feature_code    VCP feature code
+ * @param[in]  buf             buffer in which to return the value
+ * @param[in]  bufsz           size of buffer
+ * @param[out] bytect_loc      where to return the number of bytes read
+ * @retval DDCRC_OK  success
+ * @retval DDCRC_ARG value exceeds **bufsz** bytes
+ *
+ * @remark
+ * If the returned status code is other than **DDCRC_OK**, a detailed
+ * error report can be obtained using #ddca_get_error_detail()
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_get_table_vcp_value_into(
+       DDCA_Display_Handle     ddca_dh,
+       DDCA_Vcp_Feature_Code   feature_code,
+       uint8_t *               buf,
+       int                     bufsz,
+       int *                   bytect_loc);
+
+/** Reads the value of a table VCP feature, passing each fragment to a
+ *  callback function as it is received.
+ *
+ * Each fragment is at most 32 bytes.  If a DDC exchange fails and is
+ * retried, the read resumes with the fragment following the last one passed
+ * to **func**, so each offset is passed at most once.  If the returned
+ * status code is other than **DDCRC_OK**, the fragments already passed do
+ * not form a complete value.
+ *
+ * @param[in]  ddca_dh         display handle
+ * @param[in]  feature_code    VCP feature code
+ * @param[in]  func            function to which each fragment is passed
+ * @param[in]  context         passed to **func**
+ * @param[out] bytect_loc      if non-null, where to return the total number of bytes read
+ * @return status code, the status returned by **func** if it abandoned the read
+ *
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_get_table_vcp_value_fragments(
+       DDCA_Display_Handle      ddca_dh,
+       DDCA_Vcp_Feature_Code    feature_code,
+       DDCA_Table_Fragment_Func func,
+       void *                   context,
+       int *                    bytect_loc);
+
 /** Gets the value of a VCP feature of any type.
  *
  * @param[in]  ddca_dh       display handle
@@ -1643,6 +2638,381 @@ ddca_get_any_vcp_value_using_implicit_type(
        DDCA_Vcp_Feature_Code       feature_code,
        DDCA_Any_Vcp_Value **       valrec_loc);
 
+/** Gets the values of multiple VCP features in a single batch.
+ *
+ *  The reads are ordered by ddcutil, and the sleeps required after each
+ *  read are overlapped with preparation of the next request, which is
+ *  significantly faster than reading the features individually.
+ *  The value type of each feature is determined using ddcutil's internal
+ *  feature description table. Unrecognized features, including
+ *  manufacturer-specific features, are read as non-table values.
+ *
+ * @param[in]  ddca_dh       display handle
+ * @param[in]  feature_list  features to read
+ * @param[out] results_loc   address at which to return a pointer to a newly
+ *                           allocated #DDCA_Vcp_Value_Result_List, with one
+ *                           entry for each feature in ascending feature code order
+ * @return status code, DDCRC_OK if the batch was executed, even if reads
+ *         of individual features failed
+ *
+ * @remark
+ * The status of each read is returned in its #DDCA_Vcp_Value_Result.
+ * @remark
+ * Use #ddca_free_vcp_value_result_list() to free the returned value.
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_get_multiple_vcp_values(
+       DDCA_Display_Handle           ddca_dh,
+       DDCA_Feature_List *           feature_list,
+       DDCA_Vcp_Value_Result_List ** results_loc);
+
+/** Frees a #DDCA_Vcp_Value_Result_List, including the values it contains.
+ *
+ *  @param[in] results  pointer to #DDCA_Vcp_Value_Result_List, may be NULL
+ *  @since 1.3.0
+ */
+void
+ddca_free_vcp_value_result_list(
+       DDCA_Vcp_Value_Result_List *  results);
+
+/** Queues a request to get the value of a VCP feature.
+ *
+ *  The request is executed by a worker thread for the display, in the order
+ *  in which requests for the display were queued.  **callback_func** is
+ *  called from the worker thread when the request completes.
+ *
+ * @param[in]  ddca_dh        display handle
+ * @param[in]  feature_code   VCP feature code
+ * @param[in]  call_type      value type
+ * @param[in]  callback_func  function to call when the request completes
+ * @return status code of queueing the request
+ *
+ * @remark
+ * While requests for a display are outstanding, the client should not
+ * perform synchronous operations using the same display handle.
+ * #ddca_close_display() waits for outstanding requests to complete.
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_start_get_any_vcp_value(
+       DDCA_Display_Handle         ddca_dh,
+       DDCA_Vcp_Feature_Code       feature_code,
+       DDCA_Vcp_Value_Type         call_type,
+       DDCA_Notification_Func      callback_func);
+
+/** Queues a request to set the value of a non-table VCP feature.
+ *
+ *  See #ddca_start_get_any_vcp_value() for how requests are executed.
+ *  On success, the value passed to the callback contains the value set.
+ *
+ * @param[in]  ddca_dh        display handle
+ * @param[in]  feature_code   VCP feature code
+ * @param[in]  hi_byte        high byte of new value
+ * @param[in]  lo_byte        low byte of new value
+ * @param[in]  callback_func  function to call when the request completes
+ * @return status code of queueing the request
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_start_set_non_table_vcp_value(
+       DDCA_Display_Handle         ddca_dh,
+       DDCA_Vcp_Feature_Code       feature_code,
+       uint8_t                     hi_byte,
+       uint8_t                     lo_byte,
+       DDCA_Notification_Func      callback_func);
+
+/** Queues a gradual change of a continuous VCP feature to a new value,
+ *  e.g. to fade brightness.
+ *
+ *  The display's worker thread writes intermediate values as often as the
+ *  display accepts writes, up to the duration of the ramp.  The value
+ *  written at each step is determined by the time elapsed, so if a write
+ *  takes longer than expected the values already due are skipped rather
+ *  than the ramp running late.
+ *
+ *  Queueing another write to the feature, including another ramp, ends the
+ *  ramp in progress.  The new request starts from the value last written.
+ *
+ *  On success, the value passed to the callback contains the last value
+ *  written, which is **target_value** unless the ramp was ended early or
+ *  **target_value** exceeds the feature's maximum value.
+ *
+ * @param[in]  ddca_dh            display handle
+ * @param[in]  feature_code       VCP feature code of a continuous feature
+ * @param[in]  target_value       final value
+ * @param[in]  duration_millisec  duration of the ramp
+ * @param[in]  easing             progression of the value over the ramp
+ * @param[in]  callback_func      function to call when the ramp completes,
+ *                                may be NULL
+ * @retval DDCRC_OK                 request queued
+ * @retval DDCRC_ARG                invalid display handle
+ * @retval DDCRC_INVALID_OPERATION  feature is not continuous, or display is being closed
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_start_ramp_non_table_vcp_value(
+       DDCA_Display_Handle         ddca_dh,
+       DDCA_Vcp_Feature_Code       feature_code,
+       uint16_t                    target_value,
+       int                         duration_millisec,
+       DDCA_Ramp_Easing            easing,
+       DDCA_Notification_Func      callback_func);
+
+/** Registers the function called on completion of requests queued by
+ *  #ddca_queue_get_non_table_vcp_value(), and with the new values of
+ *  features changed on displays watched using #ddca_start_watch_vcp_changes().
+ *
+ * @param[in]  func              notification function, NULL to unregister
+ * @param[in]  callback_options  currently unused
+ * @return DDCRC_OK
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_register_callback(
+       DDCA_Notification_Func      func,
+       uint8_t                     callback_options);
+
+/** Queues a request to get the value of a non-table VCP feature, reporting
+ *  the result to the function registered by #ddca_register_callback().
+ *
+ * @param[in]  ddca_dh        display handle
+ * @param[in]  feature_code   VCP feature code
+ * @retval DDCRC_OK                 request queued
+ * @retval DDCRC_INVALID_OPERATION  no callback function registered
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_queue_get_non_table_vcp_value(
+       DDCA_Display_Handle         ddca_dh,
+       DDCA_Vcp_Feature_Code       feature_code);
+
+/** Starts watching a display for VCP feature changes made using the
+ *  monitor's own controls.
+ *
+ *  A single library thread watches all displays.  The poll interval for each
+ *  display shortens while it reports changes, and lengthens while it does not.
+ *  The new value of each changed feature is passed to the function registered
+ *  by #ddca_register_callback(), which is called on the watch thread.
+ *
+ *  USB displays are not polled.  Each has its own thread, which waits for
+ *  the input reports the monitor sends when a control changes.
+ *
+ *  If feature x52 is unsupported, so which features changed cannot be
+ *  determined, the function is called for feature x52 with the error status.
+ *
+ * @param[in]  ddca_dh        display handle
+ * @retval DDCRC_OK                 display watched
+ * @retval DDCRC_INVALID_OPERATION  no callback function registered
+ *
+ * @remark
+ * #ddca_close_display() stops watching the display.
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_start_watch_vcp_changes(
+       DDCA_Display_Handle         ddca_dh);
+
+/** Stops watching a display for VCP feature changes.
+ *
+ *  Once this function returns, the callback function is not called for
+ *  the display.  It must not be called from the callback function.
+ *
+ * @param[in]  ddca_dh        display handle
+ * @retval DDCRC_OK                 watch stopped
+ * @retval DDCRC_INVALID_OPERATION  display not watched
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_stop_watch_vcp_changes(
+       DDCA_Display_Handle         ddca_dh);
+
+/** Gets the latest value of a non-table feature published by a running
+ *  **ddcutil serve** process of the same user.
+ *
+ *  The server polls the features commonly watched, e.g. brightness and
+ *  input source, and publishes every value it reads or writes in shared
+ *  memory.  This function only reads the shared memory.  It performs no
+ *  DDC operation, need not open the display, and other than on the first
+ *  call makes no system call.
+ *
+ * @param[in]  ddca_dref         display reference of an I2C display
+ * @param[in]  feature_code      VCP feature code
+ * @param[out] valrec            where to return the value
+ * @param[out] age_millisec_loc  if non-NULL, where to return how many
+ *                               milliseconds ago the server read or wrote the value
+ * @retval DDCRC_OK                    success
+ * @retval DDCRC_ARG                   invalid display reference
+ * @retval DDCRC_NOT_FOUND             no server is publishing values, or no value
+ *                                     has been published for the feature
+ * @retval DDCRC_REPORTED_UNSUPPORTED  feature is not supported
+ * @retval DDCRC_DETERMINED_UNSUPPORTED feature is not supported
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_get_published_non_table_vcp_value(
+       DDCA_Display_Ref            ddca_dref,
+       DDCA_Vcp_Feature_Code       feature_code,
+       DDCA_Non_Table_Vcp_Value *  valrec,
+       uint64_t *                  age_millisec_loc);
+
+/** Selects the non-table features whose last known values are remembered
+ *  for each display, across processes, e.g. brightness and input source.
+ *
+ *  Values are saved in the same file as other learned monitor data, keyed
+ *  by a hash of the EDID, whenever a selected feature is successfully read
+ *  or written.  They are saved only if the capabilities cache is enabled.
+ *
+ * @param[in]  features  features to remember, replaces the prior selection
+ * @return DDCRC_OK
+ *
+ * @remark This setting is global, not thread-specific.
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_set_remembered_features(
+       DDCA_Feature_List *         features);
+
+/** Returns the features selected by #ddca_set_remembered_features().
+ *
+ * @return features remembered, empty if none
+ * @since 1.3.0
+ */
+DDCA_Feature_List
+ddca_get_remembered_features(void);
+
+/** Gets the last known value of a feature selected by
+ *  #ddca_set_remembered_features(), without DDC I/O, e.g. to populate a
+ *  user interface at startup.
+ *
+ *  The value is stale unless it was read from or written to the display by
+ *  this process.  If the value is stale, or if none is remembered, a read of
+ *  the feature is queued to the display's worker thread, as by
+ *  #ddca_start_get_any_vcp_value().  When the read completes,
+ *  **callback_func** is called on the worker thread if the value read differs
+ *  from the value returned, or if no value was returned.  Only one read of a
+ *  feature is queued at a time.
+ *
+ * @param[in]  ddca_dh        display handle
+ * @param[in]  feature_code   VCP feature code
+ * @param[out] valrec         where to return the value
+ * @param[out] stale_loc      where to return whether the value is stale
+ * @param[in]  callback_func  function to call if the value read differs, may be NULL
+ * @retval DDCRC_OK                 value returned
+ * @retval DDCRC_ARG                invalid display handle
+ * @retval DDCRC_INVALID_OPERATION  feature is not remembered, or the display has no EDID
+ * @retval DDCRC_NOT_FOUND          no value is remembered, read queued
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_get_remembered_non_table_vcp_value(
+       DDCA_Display_Handle         ddca_dh,
+       DDCA_Vcp_Feature_Code       feature_code,
+       DDCA_Non_Table_Vcp_Value *  valrec,
+       bool *                      stale_loc,
+       DDCA_Notification_Func      callback_func);
+
+/** Creates a completion queue, an alternative to callbacks on library
+ *  threads for clients that run their own event loop.
+ *
+ *  Requests submitted with the queue, e.g. by #ddca_cq_get_non_table_vcp_value(),
+ *  are executed by the display's worker thread, as by
+ *  #ddca_start_get_any_vcp_value().  As each request completes, a
+ *  #DDCA_Completion is appended to the queue and the queue's file descriptor,
+ *  see #ddca_get_completion_queue_fd(), becomes readable.  It remains
+ *  readable until all completions have been removed by
+ *  #ddca_drain_completions().
+ *
+ * @param[out] cq_loc  where to return the queue
+ * @retval DDCRC_OK  success
+ * @retval DDCRC_ARG cq_loc is NULL
+ * @retval < 0       negative errno value, the eventfd could not be created
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_create_completion_queue(
+       DDCA_Completion_Queue *     cq_loc);
+
+/** Returns the file descriptor of a completion queue, to be polled for
+ *  readability, e.g. using **poll()**, **epoll** or **g_unix_fd_add()**.
+ *  The descriptor is owned by the queue, and must not be read or closed
+ *  by the client.
+ *
+ * @param[in]  cq   completion queue
+ * @return file descriptor, -1 if **cq** is invalid
+ * @since 1.3.0
+ */
+int
+ddca_get_completion_queue_fd(
+       DDCA_Completion_Queue       cq);
+
+/** Queues a read of a non-table feature, whose result is returned
+ *  by #ddca_drain_completions().
+ *
+ * @param[in]  cq            completion queue
+ * @param[in]  ddca_dh       display handle
+ * @param[in]  feature_code  VCP feature code
+ * @param[in]  user_data     returned in the completion
+ * @retval DDCRC_OK                 request queued
+ * @retval DDCRC_ARG                invalid queue or display handle
+ * @retval DDCRC_INVALID_OPERATION  display is being closed
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_cq_get_non_table_vcp_value(
+       DDCA_Completion_Queue       cq,
+       DDCA_Display_Handle         ddca_dh,
+       DDCA_Vcp_Feature_Code       feature_code,
+       uint64_t                    user_data);
+
+/** Queues a write of a non-table feature, whose result is returned
+ *  by #ddca_drain_completions().
+ *
+ * @param[in]  cq            completion queue
+ * @param[in]  ddca_dh       display handle
+ * @param[in]  feature_code  VCP feature code
+ * @param[in]  hi_byte       high byte of new value
+ * @param[in]  lo_byte       low byte of new value
+ * @param[in]  user_data     returned in the completion
+ * @retval DDCRC_OK                 request queued
+ * @retval DDCRC_ARG                invalid queue or display handle
+ * @retval DDCRC_INVALID_OPERATION  display is being closed
+ * @since 1.3.0
+ */
+DDCA_Status
+ddca_cq_set_non_table_vcp_value(
+       DDCA_Completion_Queue       cq,
+       DDCA_Display_Handle         ddca_dh,
+       DDCA_Vcp_Feature_Code       feature_code,
+       uint8_t                     hi_byte,
+       uint8_t                     lo_byte,
+       uint64_t                    user_data);
+
+/** Removes completions from a queue, oldest first, without blocking.
+ *
+ * @param[in]  cq           completion queue
+ * @param[out] completions  array to receive the completions
+ * @param[in]  max_ct       size of **completions**
+ * @return number of completions returned, DDCRC_ARG if invalid arguments
+ * @since 1.3.0
+ */
+int
+ddca_drain_completions(
+       DDCA_Completion_Queue       cq,
+       DDCA_Completion *           completions,
+       int                         max_ct);
+
+/** Frees a completion queue and closes its file descriptor.
+ *  Requests that are still pending are executed, but their completions
+ *  are discarded.
+ *
+ * @param[in]  cq   completion queue
+ * @since 1.3.0
+ */
+void
+ddca_free_completion_queue(
+       DDCA_Completion_Queue       cq);
+
 /** Returns a string containing a formatted representation of the VCP value
  *  of a feature.  It is the responsibility of the caller to free this value.
  *
@@ -1694,6 +3064,31 @@ ddca_format_non_table_vcp_value_by_dref(
       DDCA_Non_Table_Vcp_Value *  valrec,
       char **                     formatted_value_loc);
 
+/** Formats a non-table VCP value into a buffer provided by the caller.
+ *
+ *  Unlike #ddca_format_non_table_vcp_value_by_dref(), this function does not
+ *  allocate memory, so it is suitable for clients that repeatedly read and
+ *  format values.  It uses the built-in feature definitions, not
+ *  user-supplied feature definitions.
+ *
+ *  @param[in]  feature_code  VCP feature code
+ *  @param[in]  vspec         MCCS version of the display
+ *  @param[in]  valrec        non-table VCP value
+ *  @param[out] buffer        buffer in which to return the formatted value
+ *  @param[in]  bufsz         buffer size
+ *  @retval     DDCRC_OK                 success
+ *  @retval     DDCRC_ARG                invalid argument, or unrecognized feature code
+ *  @retval     DDCRC_INVALID_OPERATION  feature is not a readable non-table feature
+ *  @since 1.3.0
+ */
+DDCA_Status
+ddca_format_non_table_vcp_value_in_buffer(
+      DDCA_Vcp_Feature_Code       feature_code,
+      DDCA_MCCS_Version_Spec      vspec,
+      DDCA_Non_Table_Vcp_Value *  valrec,
+      char *                      buffer,
+      int                         bufsz);
+
 /** Returns a formatted representation of a VCP value of any type
  *  It is the responsibility of the caller to free the returned string.
  *
@@ -1732,6 +3127,38 @@ ddca_set_non_table_vcp_value(
       uint8_t                  lo_byte
      );
 
+/** Sets a non-table VCP value on multiple displays.
+ *
+ *  Each display is opened by the library, and the writes to all displays
+ *  are performed concurrently, each by the display's worker thread.  Writes
+ *  to displays on the same physical adapter are still limited as set by
+ *  #ddca_set_max_adapter_concurrency().
+ *
+ *  \param[in]   ddca_drefs    array of display references
+ *  \param[in]   dref_ct       number of display references
+ *  \param[in]   feature_code  feature code
+ *  \param[in]   hi_byte       high byte of new value
+ *  \param[in]   lo_byte       low byte of new value
+ *  \param[out]  statuses      array of **dref_ct** status codes provided by the
+ *                             caller, set to the status of each write
+ *  \retval DDCRC_OK     writes performed, see **statuses** for the result of each
+ *  \retval DDCRC_ARG    invalid display reference or argument
+ *
+ *  \remark
+ *  The displays must not be open in the calling program.
+ *  \remark
+ *  Each write is verified if verification is enabled, see #ddca_enable_verify().
+ *  \since 1.3.0
+ */
+DDCA_Status
+ddca_set_non_table_vcp_values_multi(
+      DDCA_Display_Ref *       ddca_drefs,
+      int                      dref_ct,
+      DDCA_Vcp_Feature_Code    feature_code,
+      uint8_t                  hi_byte,
+      uint8_t                  lo_byte,
+      DDCA_Status *            statuses);
+
 /** Sets a Table VCP value.
  *
  *  \param[in]   ddca_dh             display handle
@@ -1760,6 +3187,26 @@ ddca_set_any_vcp_value(
       DDCA_Vcp_Feature_Code   feature_code,
       DDCA_Any_Vcp_Value *    new_value);
 
+/** Tells the monitor to save its current settings, using the DDC
+ *  Save Current Settings command.
+ *
+ *  If debouncing is enabled (see #ddca_set_save_settings_debounce()),
+ *  the command is not sent immediately.  It is sent once no further call
+ *  for the display has been made for the debounce interval, or when the
+ *  display is closed, and this function returns as soon as the save is
+ *  scheduled.  A client that saves after every change of a slider then
+ *  sends only one command, reducing writes to the monitor's non-volatile
+ *  memory.  A failure of a debounced save is only logged.
+ *
+ *  \param[in]   ddca_dh        display handle
+ *  \retval      0                        success, or save scheduled
+ *  \retval      DDCRC_INVALID_OPERATION  USB display, or display is being closed
+ *  \since 1.3.0
+ */
+DDCA_Status
+ddca_save_current_settings(
+      DDCA_Display_Handle     ddca_dh);
+
 
 //
 // Get or set multiple values
@@ -51,6 +51,9 @@
 #define DDCRC_BAD_DATA               (-(RCRANGE_DDC_START+27) ) ///< invalid data
 // #define DDCRC_CAP_FATAL              (-(RCRANGE_DDC_START+28) ) ///< invalid, unusable capabilities string"
 // #define DDCRC_CAP_WARNING            (-(RCRANGE_DDC_START+29) ) ///< capabilities string has errors but is beautiful
+#define DDCRC_DISPLAY_ASLEEP         (-(RCRANGE_DDC_START+30) ) ///< display is in a power saving state
+#define DDCRC_TIMEOUT                (-(RCRANGE_DDC_START+31) ) ///< deadline passed before operation completed
+#define DDCRC_CANCELLED              (-(RCRANGE_DDC_START+32) ) ///< operation cancelled
 
 // TODO: consider replacing DDCRC_INVALID_EDID by a more generic DDCRC_BAD_DATA,
 //       or DDC_INVALID_DATA, could be used for e.g. invalid capabilities string
@@ -108,6 +108,17 @@ typedef enum{
    DDCA_MULTI_PART_TRIES      /**< Maximum multi-part operation tries */
 } DDCA_Retry_Type;
 
+//! Priority of the DDC transactions performed by a thread
+//! @since 1.3.0
+typedef enum {
+   DDCA_IO_PRIORITY_BACKGROUND  = 0,  /**< e.g. polling, capabilities reads */
+   DDCA_IO_PRIORITY_NORMAL      = 1,  /**< default */
+   DDCA_IO_PRIORITY_INTERACTIVE = 2   /**< e.g. writes driven by a slider */
+} DDCA_IO_Priority;
+
+/** Opaque token used to cancel DDC operations, see #ddca_create_cancel_token() */
+typedef void * DDCA_Cancel_Token;
+
 
 //
 // Message Control
@@ -172,9 +183,21 @@ typedef enum {
    DDCA_STATS_ERRORS   = 0x02,    ///< error statistics
    DDCA_STATS_CALLS    = 0x04,    ///< system calls
    DDCA_STATS_ELAPSED  = 0x08,    ///< total elapsed time
+   DDCA_STATS_LATENCY  = 0x10,    ///< latency distributions
+   DDCA_STATS_MEMORY   = 0x20,    ///< allocations by subsystem
    DDCA_STATS_ALL      = 0xFF     ///< indicates all statistics types
 } DDCA_Stats_Type;
 
+//! Formats in which statistics can be exported, see #ddca_export_stats()
+typedef enum {
+   DDCA_STATS_FORMAT_JSON,        ///< JSON document
+   DDCA_STATS_FORMAT_PROMETHEUS   ///< Prometheus text exposition format
+} DDCA_Stats_Export_Format;
+
+//! Opaque cursor from which statistics deltas are exported,
+//! see #ddca_create_stats_cursor()
+typedef void * DDCA_Stats_Cursor;
+
 
 //
 // Output capture
@@ -187,7 +210,8 @@ typedef enum {
 //!  @since 0.9.0
 typedef enum {
    DDCA_CAPTURE_NOOPTS     = 0,     ///< @brief no options specified
-   DDCA_CAPTURE_STDERR     = 1      ///< @brief capture **stderr** as well as **stdout**
+   DDCA_CAPTURE_STDERR     = 1,     ///< @brief capture **stderr** as well as **stdout**
+   DDCA_CAPTURE_DISCARD    = 2      ///< @brief discard output without formatting it (since 1.3.0)
 } DDCA_Capture_Option_Flags;
 
 
@@ -340,6 +364,63 @@ typedef struct {
 } DDCA_IO_Path;
 
 
+//
+// Latency statistics
+//
+
+//! Operations for which latency distributions are recorded
+typedef enum {
+   DDCA_LATENCY_WRITE_READ,       ///< DDC write/read exchange, including retries
+   DDCA_LATENCY_MULTI_PART_READ,  ///< capabilities or table read, including retries
+   DDCA_LATENCY_CAPABILITIES,     ///< capabilities string retrieval from the display
+   DDCA_LATENCY_SET_VCP,          ///< setting a VCP feature value, including verification
+   DDCA_LATENCY_LOCK_WAIT         ///< acquiring the display lock, including time queued behind other threads
+} DDCA_Latency_Operation;
+#define DDCA_LATENCY_OPERATION_CT 5
+
+//! Summary of a latency distribution.  Times are in microseconds.
+//! Percentiles are accurate to within about 6%.
+typedef struct {
+   uint64_t count;                ///< number of samples
+   uint64_t p50;                  ///< median
+   uint64_t p90;                  ///< 90th percentile
+   uint64_t p99;                  ///< 99th percentile
+   uint64_t max;                  ///< maximum
+} DDCA_Latency_Summary;
+
+//! Latency distributions for the operations on one display
+typedef struct {
+   DDCA_IO_Path         io_path;                               ///< display
+   DDCA_Latency_Summary operations[DDCA_LATENCY_OPERATION_CT]; ///< indexed by #DDCA_Latency_Operation
+} DDCA_Display_Latency_Stats;
+
+//! Distributions of requested and actual sleep time for one sleep event type
+typedef struct {
+   const char *         sleep_event_name;   ///< e.g. "SE_WRITE_TO_READ"
+   DDCA_Latency_Summary requested;          ///< requested sleep time
+   DDCA_Latency_Summary actual;             ///< actual sleep time
+} DDCA_Sleep_Event_Latency_Stats;
+
+//! Snapshot of latency statistics, returned by #ddca_get_stats()
+typedef struct {
+   int                              display_ct;      ///< number of entries in **displays**
+   DDCA_Display_Latency_Stats *     displays;        ///< per display statistics
+   int                              sleep_event_ct;  ///< number of entries in **sleep_events**
+   DDCA_Sleep_Event_Latency_Stats * sleep_events;    ///< per sleep event type statistics
+} DDCA_Stats_Snapshot;
+
+
+//! Health of a display, returned by #ddca_get_display_health().
+//! Computed from the recent DDC write/read exchanges with the display.
+typedef struct {
+   int      score;                ///< 0 (unusable) to 100 (no recent errors or delays)
+   double   error_rate;           ///< recent fraction of tries that failed, 0..1
+   uint64_t p95_latency_micros;   ///< 95th percentile of recent write/read exchange time
+   double   sleep_factor;         ///< current sleep multiplier, including dynamic adjustment
+   int      sample_ct;            ///< number of recent exchanges used, 0 if none
+} DDCA_Display_Health;
+
+
 // Maximum length of strings extracted from EDID, plus 1 for trailing NULL
 #define DDCA_EDID_MFG_ID_FIELD_SIZE 4
 #define DDCA_EDID_MODEL_NAME_FIELD_SIZE 14
@@ -377,6 +458,21 @@ typedef struct {
 } DDCA_Display_Info_List;
 
 
+#define DDCA_DISPLAY_INFO_SNAPSHOT_MARKER "DDSN"
+/** Collection of #DDCA_Display_Info, tagged with the generation of the
+ *  display list from which it was taken.
+ *
+ *  The snapshot is a single allocation containing no pointers other than
+ *  the opaque display references, and can simply be freed.
+ */
+typedef struct {
+   char               marker[4];    ///< always "DDSN"
+   uint32_t           generation;   ///< display list generation
+   int                ct;           ///< number of records
+   DDCA_Display_Info  info[];       ///< array whose size is determined by ct
+} DDCA_Display_Info_Snapshot;
+
+
 /** @name Version Feature Flags
  *
  * #DDCA_Version_Feature_Flags is a byte of flags describing attributes of a
@@ -550,6 +646,147 @@ typedef struct {
    }       val;
 } DDCA_Any_Vcp_Value;
 
+
+/** Callback function to report completion of a queued VCP request
+ *
+ *  **valrec->opcode** identifies the feature.  The value fields are valid
+ *  only if **psc** is 0.  The value is owned by the library and is valid
+ *  only for the duration of the callback.
+ */
+typedef void (*DDCA_Notification_Func)(DDCA_Status psc, DDCA_Any_Vcp_Value* valrec);
+
+
+/** Opaque handle of a queue that receives the completions of VCP requests,
+ *  see #ddca_create_completion_queue()
+ *
+ * @since 1.3.0
+ */
+typedef void * DDCA_Completion_Queue;
+
+/** Completion of a request submitted to a #DDCA_Completion_Queue
+ *
+ * @since 1.3.0
+ */
+typedef struct {
+   uint64_t                 user_data;      ///< value passed when the request was submitted
+   DDCA_Display_Handle      dh;             ///< display handle of the request
+   bool                     is_write;       ///< true if the request was a write
+   DDCA_Vcp_Feature_Code    feature_code;
+   DDCA_Status              status;         ///< status of the request
+   DDCA_Non_Table_Vcp_Value value;          ///< value read or written, zeroed if the request failed
+} DDCA_Completion;
+
+
+/** One value read by #ddca_sample_features()
+ *
+ * @since 1.3.0
+ */
+typedef struct {
+   int                      display_ndx;      ///< index of the display in the array passed
+   DDCA_Vcp_Feature_Code    feature_code;
+   uint64_t                 scheduled_nanos;  ///< scheduled time, nanoseconds since the epoch
+   uint64_t                 latency_nanos;    ///< from scheduled time until the read completed
+   DDCA_Status              status;           ///< status of the read
+   DDCA_Non_Table_Vcp_Value value;            ///< zeroed if the read failed
+   int                      missed_ct;        ///< deadlines the display missed since its prior sample
+} DDCA_Feature_Sample;
+
+/** Callback function that receives the values read by #ddca_sample_features()
+ *
+ *  The sample is valid only for the duration of the callback.
+ *
+ * @since 1.3.0
+ */
+typedef void (*DDCA_Feature_Sample_Func)(DDCA_Feature_Sample * sample, void * arg);
+
+
+/** Progression of the value over the course of a ramp started by
+ *  #ddca_start_ramp_non_table_vcp_value()
+ *
+ * @since 1.3.0
+ */
+typedef enum {
+   DDCA_RAMP_LINEAR       = 0,    ///< constant rate of change
+   DDCA_RAMP_EASE_IN      = 1,    ///< slow start
+   DDCA_RAMP_EASE_OUT     = 2,    ///< slow finish
+   DDCA_RAMP_EASE_IN_OUT  = 3     ///< slow start and finish
+} DDCA_Ramp_Easing;
+
+
+/** Callback function that receives one fragment of a table feature value
+ *  read by #ddca_get_table_vcp_value_fragments()
+ *
+ *  **bytes** is owned by the library and is valid only for the duration of
+ *  the callback.  Returning a status code other than 0 abandons the read.
+ *
+ * @since 1.3.0
+ */
+typedef DDCA_Status (*DDCA_Table_Fragment_Func)(
+      void *          context,
+      int             offset,
+      const uint8_t * bytes,
+      int             bytect);
+
+
+/** Type of change reported by a #DDCA_Display_Status_Callback_Func
+ *
+ * @since 1.3.0
+ */
+typedef enum {
+   DDCA_EVENT_DISPLAY_CONNECTED    = 1,   ///< display detected
+   DDCA_EVENT_DISPLAY_DISCONNECTED = 2,   ///< display no longer detected
+   DDCA_EVENT_DISPLAY_EDID_CHANGED = 3,   ///< different monitor on the same connector
+} DDCA_Display_Event_Type;
+
+
+/** Display hotplug event
+ *
+ *  For #DDCA_EVENT_DISPLAY_CONNECTED and #DDCA_EVENT_DISPLAY_EDID_CHANGED,
+ *  **dref** is the newly detected display.  For #DDCA_EVENT_DISPLAY_DISCONNECTED
+ *  it is the display reference that is no longer valid, or NULL if it has
+ *  already been freed.  **io_path** always identifies the affected device.
+ *
+ * @since 1.3.0
+ */
+typedef struct {
+   DDCA_Display_Event_Type event_type;
+   DDCA_Display_Ref        dref;
+   DDCA_IO_Path            io_path;
+} DDCA_Display_Status_Event;
+
+
+/** Callback function to report display hotplug events,
+ *  see #ddca_register_display_status_callback()
+ *
+ * @since 1.3.0
+ */
+typedef void (*DDCA_Display_Status_Callback_Func)(DDCA_Display_Status_Event event);
+
+
+/** Callback function to report each display found by progressive detection,
+ *  see #ddca_start_display_detection()
+ *
+ *  **dref** is NULL once detection is complete.
+ *
+ * @since 1.3.0
+ */
+typedef void (*DDCA_Display_Detection_Callback_Func)(DDCA_Display_Ref dref);
+
+
+/** Result of reading one feature with #ddca_get_multiple_vcp_values() */
+typedef struct {
+   DDCA_Vcp_Feature_Code  feature_code;   ///< VCP feature code
+   DDCA_Status            status;         ///< status code of the read
+   DDCA_Any_Vcp_Value *   value;          ///< value read, NULL if status != 0
+} DDCA_Vcp_Value_Result;
+
+
+/** Collection of #DDCA_Vcp_Value_Result */
+typedef struct {
+   int                    ct;             ///< number of records
+   DDCA_Vcp_Value_Result  results[];      ///< array whose size is determined by ct
+} DDCA_Vcp_Value_Result_List;
+
 #define VALREC_CUR_VAL(valrec) ( valrec->val.c_nc.sh << 8 | valrec->val.c_nc.sl )
 #define VALREC_MAX_VAL(valrec) ( valrec->val.c_nc.mh << 8 | valrec->val.c_nc.ml )
 
@@ -0,0 +1,418 @@
+/* demo_stress.c
+ *
+ * Stress test of concurrent use of libddcutil.
+ *
+ * Worker threads repeatedly open a display, perform a randomly chosen
+ * operation (get a VCP value, set a VCP value, or get the capabilities
+ * string), and close the display, while another thread periodically calls
+ * ddca_redetect_displays().  Displays are shared among the workers, so that
+ * they compete for the display lock.
+ *
+ * At the end of the run, reports the throughput and latency percentiles of
+ * each operation, the status codes returned other than success, and the
+ * display lock wait times recorded by the library.
+ *
+ * Returns EXIT_FAILURE if any unexpected status code was returned.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "public/ddcutil_c_api.h"
+#include "public/ddcutil_status_codes.h"
+
+
+#define DEFAULT_THREADS                4
+#define DEFAULT_DURATION_SECS         10
+#define DEFAULT_REDETECT_MILLIS     2000
+#define DEFAULT_MIX          "get:60,set:30,caps:10"
+#define DEFAULT_FEATURE             0x10     // brightness
+#define LOCKED_RETRY_MAX             100
+#define LOCKED_RETRY_MICROS         1000
+
+
+typedef enum {
+   OP_OPEN,
+   OP_GET,
+   OP_SET,
+   OP_CAPS,
+   OP_REDETECT,
+} Stress_Op;
+#define STRESS_OP_CT (OP_REDETECT+1)
+
+static const char * op_names[] = {"open", "get", "set", "caps", "redetect"};
+
+
+typedef struct {
+   int          thread_no;
+   GRand *      rand;
+   GArray *     latencies[STRESS_OP_CT];    // uint64_t, microseconds
+   GHashTable * status_counts;              // DDCA_Status -> count
+   int          opened_while_locked;        // DDCRC_LOCKED despite waiting
+   int          locked_retries;             // opens retried after DDCRC_LOCKED
+   int          unexpected_ct;
+} Stress_Worker;
+
+
+// Settings
+static int    thread_ct        = DEFAULT_THREADS;
+static int    duration_secs    = DEFAULT_DURATION_SECS;
+static int    redetect_millis  = DEFAULT_REDETECT_MILLIS;
+static int    feature_code     = DEFAULT_FEATURE;
+static gboolean nowait         = false;    // open without waiting for the display lock
+static int    op_weights[STRESS_OP_CT];
+static int    total_weight;
+
+static gint   stop_requested      = 0;
+static gint   detection_generation = 0;    // incremented by each redetection
+
+
+static bool parse_mix(const char * mix) {
+   bool ok = true;
+   memset(op_weights, 0, sizeof(op_weights));
+   total_weight = 0;
+   char ** pieces = g_strsplit(mix, ",", -1);
+   for (int ndx = 0; pieces[ndx] && ok; ndx++) {
+      char ** nv = g_strsplit(pieces[ndx], ":", 2);
+      char * end = NULL;
+      long weight = (nv[0] && nv[1]) ? strtol(nv[1], &end, 10) : -1;
+      if (weight < 0 || !end || *end != '\0') {
+         ok = false;
+      }
+      else if (g_ascii_strcasecmp(nv[0], "get") == 0)
+         op_weights[OP_GET] = weight;
+      else if (g_ascii_strcasecmp(nv[0], "set") == 0)
+         op_weights[OP_SET] = weight;
+      else if (g_ascii_strcasecmp(nv[0], "caps") == 0)
+         op_weights[OP_CAPS] = weight;
+      else
+         ok = false;
+      g_strfreev(nv);
+   }
+   g_strfreev(pieces);
+   total_weight = op_weights[OP_GET] + op_weights[OP_SET] + op_weights[OP_CAPS];
+   if (!ok || total_weight == 0) {
+      fprintf(stderr, "Invalid operation mix: %s\n", mix);
+      ok = false;
+   }
+   return ok;
+}
+
+
+static Stress_Op choose_op(Stress_Worker * w) {
+   int r = g_rand_int_range(w->rand, 0, total_weight);
+   if (r < op_weights[OP_GET])
+      return OP_GET;
+   if (r < op_weights[OP_GET] + op_weights[OP_SET])
+      return OP_SET;
+   return OP_CAPS;
+}
+
+
+static void record_status(Stress_Worker * w, DDCA_Status ddcrc) {
+   if (ddcrc == 0)
+      return;
+   gpointer key = GINT_TO_POINTER(ddcrc);
+   int ct = GPOINTER_TO_INT(g_hash_table_lookup(w->status_counts, key));
+   g_hash_table_insert(w->status_counts, key, GINT_TO_POINTER(ct+1));
+   if (ddcrc != DDCRC_LOCKED && ddcrc != DDCRC_REPORTED_UNSUPPORTED && ddcrc != DDCRC_DETERMINED_UNSUPPORTED)
+      w->unexpected_ct++;
+}
+
+
+static void record_latency(Stress_Worker * w, Stress_Op op, gint64 start_micros) {
+   uint64_t elapsed = g_get_monotonic_time() - start_micros;
+   g_array_append_val(w->latencies[op], elapsed);
+}
+
+
+static DDCA_Status
+open_display(Stress_Worker * w, DDCA_Display_Ref dref, DDCA_Display_Handle * dh_loc) {
+   gint64 start = g_get_monotonic_time();
+   DDCA_Status ddcrc = ddca_open_display2(dref, !nowait, dh_loc);
+   for (int tryctr = 0; nowait && ddcrc == DDCRC_LOCKED && tryctr < LOCKED_RETRY_MAX; tryctr++) {
+      w->locked_retries++;
+      g_usleep(LOCKED_RETRY_MICROS);
+      ddcrc = ddca_open_display2(dref, false, dh_loc);
+   }
+   if (ddcrc == 0)
+      record_latency(w, OP_OPEN, start);
+   else if (ddcrc == DDCRC_LOCKED && !nowait)
+      w->opened_while_locked++;
+   record_status(w, ddcrc);
+   return ddcrc;
+}
+
+
+static void perform_op(Stress_Worker * w, Stress_Op op, DDCA_Display_Handle dh) {
+   DDCA_Status ddcrc = 0;
+   DDCA_Non_Table_Vcp_Value valrec;
+   gint64 start = g_get_monotonic_time();
+   switch (op) {
+   case OP_GET:
+      ddcrc = ddca_get_non_table_vcp_value(dh, feature_code, &valrec);
+      break;
+   case OP_SET:
+      // rewrite the current value, so the display's state is unchanged
+      ddcrc = ddca_get_non_table_vcp_value(dh, feature_code, &valrec);
+      if (ddcrc == 0) {
+         start = g_get_monotonic_time();
+         ddcrc = ddca_set_non_table_vcp_value(dh, feature_code, valrec.sh, valrec.sl);
+      }
+      break;
+   case OP_CAPS:
+   {
+      char * caps = NULL;
+      ddcrc = ddca_get_capabilities_string(dh, &caps);
+      free(caps);
+      break;
+   }
+   default:
+      break;
+   }
+   if (ddcrc == 0)
+      record_latency(w, op, start);
+   record_status(w, ddcrc);
+}
+
+
+static gpointer worker_thread(gpointer data) {
+   Stress_Worker * w = data;
+   char buf[40];
+   g_snprintf(buf, sizeof(buf), "stress worker %d", w->thread_no);
+   ddca_set_thread_description(buf);
+
+   DDCA_Display_Info_List * dlist = NULL;
+   int seen_generation = -1;
+   for (int iteration = 0; !g_atomic_int_get(&stop_requested); iteration++) {
+      int generation = g_atomic_int_get(&detection_generation);
+      if (generation != seen_generation) {
+         ddca_free_display_info_list(dlist);
+         ddca_get_display_info_list2(false, &dlist);
+         seen_generation = generation;
+      }
+      if (dlist->ct == 0) {
+         g_usleep(100000);
+         seen_generation = -1;
+         continue;
+      }
+
+      // spread the workers over the displays, so each display is shared
+      DDCA_Display_Info * dinfo = &dlist->info[(w->thread_no + iteration) % dlist->ct];
+      DDCA_Display_Handle dh = NULL;
+      DDCA_Status ddcrc = open_display(w, dinfo->dref, &dh);
+      if (ddcrc != 0) {
+         if (ddcrc != DDCRC_LOCKED)
+            seen_generation = -1;    // reference may have been invalidated by redetection
+         continue;
+      }
+      perform_op(w, choose_op(w), dh);
+      ddcrc = ddca_close_display(dh);
+      record_status(w, ddcrc);
+   }
+   ddca_free_display_info_list(dlist);
+   return NULL;
+}
+
+
+static gpointer redetect_thread(gpointer data) {
+   Stress_Worker * w = data;
+   ddca_set_thread_description("stress redetect");
+   while (!g_atomic_int_get(&stop_requested)) {
+      g_usleep(redetect_millis * 1000);
+      if (g_atomic_int_get(&stop_requested))
+         break;
+      gint64 start = g_get_monotonic_time();
+      DDCA_Status ddcrc = ddca_redetect_displays();
+      if (ddcrc == 0)
+         record_latency(w, OP_REDETECT, start);
+      record_status(w, ddcrc);
+      g_atomic_int_inc(&detection_generation);
+   }
+   return NULL;
+}
+
+
+static Stress_Worker * new_worker(int thread_no) {
+   Stress_Worker * w = g_new0(Stress_Worker, 1);
+   w->thread_no = thread_no;
+   w->rand = g_rand_new_with_seed(thread_no);
+   for (int op = 0; op < STRESS_OP_CT; op++)
+      w->latencies[op] = g_array_new(false, false, sizeof(uint64_t));
+   w->status_counts = g_hash_table_new(g_direct_hash, g_direct_equal);
+   return w;
+}
+
+
+static void free_worker(Stress_Worker * w) {
+   g_rand_free(w->rand);
+   for (int op = 0; op < STRESS_OP_CT; op++)
+      g_array_free(w->latencies[op], true);
+   g_hash_table_destroy(w->status_counts);
+   g_free(w);
+}
+
+
+// Merges the results of all workers into the first
+static void merge_workers(Stress_Worker ** workers, int ct) {
+   Stress_Worker * total = workers[0];
+   for (int ndx = 1; ndx < ct; ndx++) {
+      Stress_Worker * w = workers[ndx];
+      for (int op = 0; op < STRESS_OP_CT; op++)
+         g_array_append_vals(total->latencies[op], w->latencies[op]->data, w->latencies[op]->len);
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, w->status_counts);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         int ct = GPOINTER_TO_INT(g_hash_table_lookup(total->status_counts, key));
+         g_hash_table_insert(total->status_counts, key, GINT_TO_POINTER(ct + GPOINTER_TO_INT(value)));
+      }
+      total->opened_while_locked += w->opened_while_locked;
+      total->locked_retries      += w->locked_retries;
+      total->unexpected_ct       += w->unexpected_ct;
+   }
+}
+
+
+static gint compare_uint64(gconstpointer a, gconstpointer b) {
+   uint64_t v1 = *(const uint64_t *) a;
+   uint64_t v2 = *(const uint64_t *) b;
+   return (v1 > v2) - (v1 < v2);
+}
+
+
+static uint64_t percentile(GArray * sorted, int pct) {
+   return g_array_index(sorted, uint64_t, (sorted->len - 1) * pct / 100);
+}
+
+
+static void report_results(Stress_Worker * total, double elapsed_secs) {
+   printf("\nElapsed time: %.1f seconds\n", elapsed_secs);
+   printf("\nSuccessful operations (latency in microseconds):\n");
+   printf("   %-10s %8s %9s %9s %9s %9s %9s\n", "Operation", "Count", "per sec", "p50", "p90", "p99", "max");
+   for (int op = 0; op < STRESS_OP_CT; op++) {
+      GArray * lats = total->latencies[op];
+      if (lats->len == 0) {
+         printf("   %-10s %8d\n", op_names[op], 0);
+         continue;
+      }
+      g_array_sort(lats, compare_uint64);
+      printf("   %-10s %8u %9.1f %9"PRIu64" %9"PRIu64" %9"PRIu64" %9"PRIu64"\n",
+             op_names[op], lats->len, lats->len / elapsed_secs,
+             percentile(lats, 50), percentile(lats, 90), percentile(lats, 99), percentile(lats, 100));
+   }
+
+   printf("\nStatus codes other than success:\n");
+   if (g_hash_table_size(total->status_counts) == 0)
+      printf("   None\n");
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, total->status_counts);
+   while (g_hash_table_iter_next(&iter, &key, &value))
+      printf("   %-30s %8d\n", ddca_rc_name(GPOINTER_TO_INT(key)), GPOINTER_TO_INT(value));
+   if (nowait)
+      printf("   Opens retried after DDCRC_LOCKED: %d\n", total->locked_retries);
+   if (total->opened_while_locked > 0)
+      printf("   DDCRC_LOCKED returned to waiting opens: %d\n", total->opened_while_locked);
+
+   printf("\nDisplay lock wait (microseconds):\n");
+   DDCA_Stats_Snapshot * snapshot = NULL;
+   if (ddca_get_stats(&snapshot) == 0) {
+      printf("   %-16s %8s %9s %9s %9s %9s\n", "Display", "Count", "p50", "p90", "p99", "max");
+      for (int ndx = 0; ndx < snapshot->display_ct; ndx++) {
+         DDCA_Display_Latency_Stats * cur = &snapshot->displays[ndx];
+         DDCA_Latency_Summary * lock_wait = &cur->operations[DDCA_LATENCY_LOCK_WAIT];
+         char name[20];
+         if (cur->io_path.io_mode == DDCA_IO_I2C)
+            g_snprintf(name, sizeof(name), "bus /dev/i2c-%d", cur->io_path.path.i2c_busno);
+         else
+            g_snprintf(name, sizeof(name), "usb %d", cur->io_path.path.hiddev_devno);
+         printf("   %-16s %8"PRIu64" %9"PRIu64" %9"PRIu64" %9"PRIu64" %9"PRIu64"\n",
+                name, lock_wait->count, lock_wait->p50, lock_wait->p90, lock_wait->p99, lock_wait->max);
+      }
+      ddca_free_stats(snapshot);
+   }
+}
+
+
+int main(int argc, char** argv) {
+   char * mix = NULL;
+   GOptionEntry option_entries[] = {
+      {"threads",   't', 0, G_OPTION_ARG_INT,    &thread_ct,       "Number of worker threads", "number"},
+      {"duration",  'd', 0, G_OPTION_ARG_INT,    &duration_secs,   "Duration of the run", "seconds"},
+      {"mix",       'm', 0, G_OPTION_ARG_STRING, &mix,             "Relative weights of operations, default " DEFAULT_MIX, "get:n,set:n,caps:n"},
+      {"redetect",  'r', 0, G_OPTION_ARG_INT,    &redetect_millis, "Interval between redetections, 0 to disable", "milliseconds"},
+      {"feature",   'f', 0, G_OPTION_ARG_INT,    &feature_code,    "Feature to get and set, default 16 (brightness)", "number"},
+      {"nowait",    'n', 0, G_OPTION_ARG_NONE,   &nowait,          "Retry opening locked displays instead of waiting", NULL},
+      {NULL}
+   };
+   GError * error = NULL;
+   GOptionContext * context = g_option_context_new("- libddcutil concurrency stress test");
+   g_option_context_add_main_entries(context, option_entries, NULL);
+   bool ok = g_option_context_parse(context, &argc, &argv, &error);
+   g_option_context_free(context);
+   if (!ok) {
+      fprintf(stderr, "Option parsing failed: %s\n", error->message);
+      g_error_free(error);
+      return EXIT_FAILURE;
+   }
+   if (!parse_mix((mix) ? mix : DEFAULT_MIX) || thread_ct <= 0 || duration_secs <= 0 ||
+       redetect_millis < 0 || feature_code < 0 || feature_code > 255)
+   {
+      fprintf(stderr, "Invalid arguments\n");
+      g_free(mix);
+      return EXIT_FAILURE;
+   }
+   g_free(mix);
+
+   printf("Running %d worker threads for %d seconds, feature 0x%02x, ", thread_ct, duration_secs, feature_code);
+   if (redetect_millis > 0)
+      printf("redetecting displays every %d milliseconds\n", redetect_millis);
+   else
+      printf("no redetection\n");
+
+   DDCA_Display_Info_List * dlist = NULL;
+   ddca_get_display_info_list2(false, &dlist);
+   printf("%d valid displays detected\n", dlist->ct);
+   bool have_displays = dlist->ct > 0;
+   ddca_free_display_info_list(dlist);
+   if (!have_displays)
+      return EXIT_FAILURE;
+
+   ddca_reset_stats();
+   Stress_Worker ** workers = g_new0(Stress_Worker *, thread_ct+1);
+   GThread ** threads = g_new0(GThread *, thread_ct+1);
+   gint64 start = g_get_monotonic_time();
+   for (int ndx = 0; ndx < thread_ct; ndx++) {
+      workers[ndx] = new_worker(ndx);
+      threads[ndx] = g_thread_new("stress worker", worker_thread, workers[ndx]);
+   }
+   workers[thread_ct] = new_worker(thread_ct);
+   if (redetect_millis > 0)
+      threads[thread_ct] = g_thread_new("stress redetect", redetect_thread, workers[thread_ct]);
+
+   g_usleep(duration_secs * G_USEC_PER_SEC);
+   g_atomic_int_set(&stop_requested, 1);
+   for (int ndx = 0; ndx <= thread_ct; ndx++) {
+      if (threads[ndx])
+         g_thread_join(threads[ndx]);
+   }
+   double elapsed_secs = (g_get_monotonic_time() - start) / (double) G_USEC_PER_SEC;
+
+   merge_workers(workers, thread_ct+1);
+   report_results(workers[0], elapsed_secs);
+   bool unexpected = workers[0]->unexpected_ct > 0 || workers[0]->opened_while_locked > 0;
+
+   for (int ndx = 0; ndx <= thread_ct; ndx++)
+      free_worker(workers[ndx]);
+   g_free(workers);
+   g_free(threads);
+   return (unexpected) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
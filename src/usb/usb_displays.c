@@ -17,6 +17,7 @@
 #include "util/device_id_util.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/sysfs_util.h"
 #include "util/udev_usb_util.h"
 #include "util/udev_util.h"
 
@@ -51,6 +52,12 @@ static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_USB;  // may be unused if all dia
 static GPtrArray * usb_monitors = NULL;    // array of Usb_Monitor_Info
 static GPtrArray * usb_open_errors = NULL;
 
+// Usb_Monitor_Info records retained across detections, keyed by cache_key
+static GHashTable *          usb_monitor_cache = NULL;
+static GHashTable *          usb_nonmonitor_keys = NULL;      // devices found not to be monitors
+static struct udev *         usb_cache_udev = NULL;
+static struct udev_monitor * usb_cache_udev_monitor = NULL;   // USB add/remove events
+
 
 #define HID_USAGE_PAGE_MASK   0xffff0000
 
@@ -120,6 +127,9 @@ dbgrpt_usb_monitor_info(Usb_Monitor_Info * moninfo, int depth) {
    rpt_vstring(d1, "%-20s:    %s",     "hiddev_device_name",  moninfo->hiddev_device_name);
    rpt_vstring(d1, "%-20s:    %p",     "edid",                moninfo->edid);
    rpt_vstring(d1, "%-20s:    %p",     "hiddev_devinfo",      moninfo->hiddev_devinfo);
+   rpt_vstring(d1, "%-20s:    %p",     "hidraw",              moninfo->hidraw);
+   if (moninfo->hidraw)
+      dbgrpt_usb_hidraw_info(moninfo->hidraw, d2);
    rpt_title("Non-empty vcp_codes entries:", d1);
    int feature_code;
    for (feature_code = 0; feature_code < 256; feature_code++) {
@@ -129,6 +139,15 @@ dbgrpt_usb_monitor_info(Usb_Monitor_Info * moninfo, int depth) {
          for (int ndx=0; ndx<monrecs->len; ndx++) {
             dbgrpt_usb_monitor_vcp_rec( g_ptr_array_index(monrecs, ndx), d2);
          }
+         Usb_Vcp_Usage_Locators * locs = &moninfo->usage_locators[feature_code];
+         if (locs->get.found)
+            rpt_vstring(d2, "get locator: report_type=%d, report_id=%d, field_index=%d, usage_index=%d, maxval=%d",
+                            locs->get.report_type, locs->get.report_id, locs->get.field_index,
+                            locs->get.usage_index, locs->get.logical_maximum);
+         if (locs->set.found)
+            rpt_vstring(d2, "set locator: report_type=%d, report_id=%d, field_index=%d, usage_index=%d",
+                            locs->set.report_type, locs->set.report_id, locs->set.field_index,
+                            locs->set.usage_index);
       }
    }
 }
@@ -139,12 +158,14 @@ void free_usb_monitor_info(gpointer p) {
    if (moninfo) {
       assert(memcmp(moninfo->marker, USB_MONITOR_INFO_MARKER, 4) == 0);
       free(moninfo->hiddev_device_name);
+      free(moninfo->cache_key);
       free_parsed_edid(moninfo->edid);
       free(moninfo->hiddev_devinfo);
       for (int ndx = 0; ndx < 256; ndx++) {
          if (moninfo->vcp_codes[ndx])
             free_usb_monitor_vcp_rec(moninfo->vcp_codes[ndx]);
       }
+      usb_hidraw_close(moninfo->hidraw);
       free(moninfo);
    }
 }
@@ -267,6 +288,51 @@ collect_vcp_reports(int fd) {
 }
 
 
+/** Sets a #Usb_Usage_Locator from a #Usb_Monitor_Vcp_Rec */
+static void
+set_usage_locator(Usb_Usage_Locator * loc, Usb_Monitor_Vcp_Rec * vcprec) {
+   loc->found           = true;
+   loc->report_type     = vcprec->report_type;
+   loc->report_id       = vcprec->report_id;
+   loc->field_index     = vcprec->field_index;
+   loc->usage_index     = vcprec->usage_index;
+   loc->logical_maximum = vcprec->finfo->logical_maximum;
+}
+
+
+/** Builds the table of usage locators for a monitor from the VCP reports
+ *  distributed by feature code.
+ *
+ *  When given only a usage code, hiddev uses the first matching usage of
+ *  the report type, in report, field, and usage order.  This is the order
+ *  in which #collect_vcp_reports() records the usages, so the first entry
+ *  of the required type is the one hiddev would find.
+ *
+ *  @param  moninfo  pointer to #Usb_Monitor_Info instance
+ */
+static void
+build_usage_locators(Usb_Monitor_Info * moninfo) {
+   for (int feature_code = 0; feature_code < 256; feature_code++) {
+      GPtrArray * vcp_recs = moninfo->vcp_codes[feature_code];
+      if (!vcp_recs)
+         continue;
+      Usb_Vcp_Usage_Locators * locs = &moninfo->usage_locators[feature_code];
+      Usb_Monitor_Vcp_Rec * first_input = NULL;
+      for (int ndx = 0; ndx < vcp_recs->len; ndx++) {
+         Usb_Monitor_Vcp_Rec * vcprec = g_ptr_array_index(vcp_recs, ndx);
+         if (vcprec->report_type == HID_REPORT_TYPE_FEATURE && !locs->set.found) {
+            set_usage_locator(&locs->get, vcprec);
+            set_usage_locator(&locs->set, vcprec);
+         }
+         else if (vcprec->report_type == HID_REPORT_TYPE_INPUT && !first_input)
+            first_input = vcprec;
+      }
+      if (!locs->get.found && first_input)
+         set_usage_locator(&locs->get, first_input);
+   }
+}
+
+
 //
 // Capabilities
 //
@@ -389,6 +455,133 @@ is_possible_monitor_by_hiddev_name(const char * hiddev_name) {
 }
 
 
+//
+// Cache of Usb_Monitor_Info records
+//
+
+/** Creates the key of the #Usb_Monitor_Info cache for a hiddev device,
+ *  using the attributes of its USB device in sysfs.  No device is opened.
+ *
+ *  @param  hiddev_fn  hiddev device name, e.g. /dev/usb/hiddev2
+ *  @return key string of the form bus:device:vid:pid:serial, caller must free,
+ *          NULL if the USB device attributes are not found
+ */
+static char *
+usb_monitor_cache_key(const char * hiddev_fn) {
+   bool debug = false;
+   char * result = NULL;
+   char * base = g_path_get_basename(hiddev_fn);
+   // device is the HID interface, its parent the USB device
+   char * usbdev_dir = g_strdup_printf("/sys/class/usbmisc/%s/device/..", base);
+   char * busnum  = read_sysfs_attr(usbdev_dir, "busnum",    false);
+   char * devnum  = read_sysfs_attr(usbdev_dir, "devnum",    false);
+   char * vid     = read_sysfs_attr(usbdev_dir, "idVendor",  false);
+   char * pid     = read_sysfs_attr(usbdev_dir, "idProduct", false);
+   char * serial  = read_sysfs_attr(usbdev_dir, "serial",    false);   // optional
+   if (busnum && devnum && vid && pid)
+      result = g_strdup_printf("%s:%s:%s:%s:%s", busnum, devnum, vid, pid, (serial) ? serial : "");
+   free(busnum);
+   free(devnum);
+   free(vid);
+   free(pid);
+   free(serial);
+   g_free(usbdev_dir);
+   g_free(base);
+   DBGTRC(debug, TRACE_GROUP, "hiddev_fn=%s, returning %s", hiddev_fn, result);
+   return result;
+}
+
+
+static gboolean
+moninfo_is_on_usb_device(gpointer key, gpointer value, gpointer user_data) {
+   Usb_Monitor_Info * moninfo = value;
+   int * busnum_devnum = user_data;
+   return moninfo->hiddev_devinfo->busnum == busnum_devnum[0] &&
+          moninfo->hiddev_devinfo->devnum == busnum_devnum[1];
+}
+
+
+static gboolean
+key_is_on_usb_device(gpointer key, gpointer value, gpointer user_data) {
+   int * busnum_devnum = user_data;
+   char prefix[24];
+   g_snprintf(prefix, sizeof(prefix), "%d:%d:", busnum_devnum[0], busnum_devnum[1]);
+   return str_starts_with(key, prefix);
+}
+
+
+static gboolean
+moninfo_not_detected(gpointer key, gpointer value, gpointer user_data) {
+   GPtrArray * detected = user_data;
+   for (int ndx = 0; ndx < detected->len; ndx++) {
+      if (g_ptr_array_index(detected, ndx) == value)
+         return false;
+   }
+   return true;
+}
+
+
+/** Discards cached #Usb_Monitor_Info records for USB devices that have been
+ *  added or removed since the last detection, as reported by udev.
+ *
+ *  If the udev monitor cannot be created all records are discarded,
+ *  i.e. there is no caching.
+ */
+static void
+process_usb_hotplug_events() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   if (!usb_monitor_cache) {
+      usb_monitor_cache = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_usb_monitor_info);
+      usb_nonmonitor_keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+   }
+
+   if (!usb_cache_udev_monitor) {
+      // Events received from now on.  There is nothing cached that predates them.
+      if (!usb_cache_udev)
+         usb_cache_udev = udev_new();
+      if (usb_cache_udev) {
+         usb_cache_udev_monitor = udev_monitor_new_from_netlink(usb_cache_udev, "udev");
+         if (usb_cache_udev_monitor) {
+            udev_monitor_filter_add_match_subsystem_devtype(usb_cache_udev_monitor, "usb", "usb_device");
+            if (udev_monitor_enable_receiving(usb_cache_udev_monitor) != 0) {
+               udev_monitor_unref(usb_cache_udev_monitor);
+               usb_cache_udev_monitor = NULL;
+            }
+         }
+      }
+      g_hash_table_remove_all(usb_monitor_cache);
+      g_hash_table_remove_all(usb_nonmonitor_keys);
+   }
+   else {
+      // the monitor socket is nonblocking, returns NULL when no more events are queued
+      struct udev_device * dev;
+      while ( (dev = udev_monitor_receive_device(usb_cache_udev_monitor)) ) {
+         const char * busnum_s = udev_device_get_property_value(dev, "BUSNUM");
+         const char * devnum_s = udev_device_get_property_value(dev, "DEVNUM");
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "action=%s, devpath=%s, BUSNUM=%s, DEVNUM=%s",
+                         udev_device_get_action(dev), udev_device_get_devpath(dev), busnum_s, devnum_s);
+         int busnum_devnum[2];
+         if (busnum_s && devnum_s &&
+             str_to_int(busnum_s, &busnum_devnum[0], 10) &&
+             str_to_int(devnum_s, &busnum_devnum[1], 10) )
+         {
+            g_hash_table_foreach_remove(usb_monitor_cache, moninfo_is_on_usb_device, busnum_devnum);
+            g_hash_table_foreach_remove(usb_nonmonitor_keys, key_is_on_usb_device, busnum_devnum);
+         }
+         else {
+            g_hash_table_remove_all(usb_monitor_cache);
+            g_hash_table_remove_all(usb_nonmonitor_keys);
+         }
+         udev_device_unref(dev);
+      }
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "%d cached monitors", g_hash_table_size(usb_monitor_cache));
+}
+
+
 //
 // Probe HID devices, create USB_Mon_Info data stuctures
 //
@@ -403,6 +596,11 @@ is_possible_monitor_by_hiddev_name(const char * hiddev_name) {
  *   usb_open_errors.
  *
  *  The result is cached in global variables usb_monitors and usb_open_errors.
+ *
+ *  The #Usb_Monitor_Info records are also retained across calls, keyed
+ *  by USB bus number, device number, vendor id, product id, and serial
+ *  number, so that a device is only probed again after udev reports that
+ *  its USB device has changed.
  */
 GPtrArray *
 get_usb_monitor_list() {
@@ -418,14 +616,39 @@ get_usb_monitor_list() {
 
    usb_monitors = g_ptr_array_new();
    usb_open_errors = g_ptr_array_new();
+   process_usb_hotplug_events();
+   // devices found not to be monitors in this detection
+   GHashTable * nonmonitor_keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
    GPtrArray * hiddev_names = get_hiddev_device_names();
    for (int devname_ndx = 0; devname_ndx < hiddev_names->len; devname_ndx++) {
       char * hiddev_fn = g_ptr_array_index(hiddev_names, devname_ndx);
       DBGTRC(debug, TRACE_GROUP, "Examining device: %s", hiddev_fn);
 
+      char * cache_key = (usb_cache_udev_monitor) ? usb_monitor_cache_key(hiddev_fn) : NULL;
+      if (cache_key) {
+         Usb_Monitor_Info * cached = g_hash_table_lookup(usb_monitor_cache, cache_key);
+         if (cached) {
+            DBGTRC(debug, TRACE_GROUP, "Using cached monitor info for %s", cache_key);
+            if (!streq(cached->hiddev_device_name, hiddev_fn)) {
+               free(cached->hiddev_device_name);
+               cached->hiddev_device_name = strdup(hiddev_fn);
+            }
+            g_ptr_array_add(usb_monitors, cached);
+            free(cache_key);
+            continue;
+         }
+         if (g_hash_table_contains(usb_nonmonitor_keys, cache_key)) {
+            DBGTRC(debug, TRACE_GROUP, "Previously found not to be a monitor: %s", cache_key);
+            g_hash_table_add(nonmonitor_keys, cache_key);
+            continue;
+         }
+      }
+
       if (!is_possible_monitor_by_hiddev_name(hiddev_fn)) {
          DBGTRC(debug, TRACE_GROUP, "Not a possible monitor: %s", hiddev_fn);
+         if (cache_key)
+            g_hash_table_add(nonmonitor_keys, cache_key);
          continue;
       }
 
@@ -476,11 +699,15 @@ get_usb_monitor_list() {
          if ( hiddev_get_device_info(fd, devinfo, CALLOPT_ERR_MSG) != 0 )
             goto close;
 
-         if (deny_hid_monitor_by_vid_pid(devinfo->vendor, devinfo->product) )
-            goto close;
-
-         if (!is_hiddev_monitor(fd))
+         if (deny_hid_monitor_by_vid_pid(devinfo->vendor, devinfo->product) ||
+             !is_hiddev_monitor(fd) )
+         {
+            if (cache_key) {
+               g_hash_table_add(nonmonitor_keys, cache_key);
+               cache_key = NULL;
+            }
             goto close;
+         }
 
          parsed_edid = get_hiddev_edid_with_fallback(fd, devinfo);
          if (!parsed_edid) {
@@ -515,8 +742,16 @@ get_usb_monitor_list() {
          // by moninfo->vcp_codes
          // n. no free function set
          g_ptr_array_free(vcp_reports, true);
+         build_usage_locators(moninfo);
+         // whole feature report access, if the hidraw device can be used
+         moninfo->hidraw = usb_hidraw_open_for_hiddev(hiddev_fn);
 
          g_ptr_array_add(usb_monitors, moninfo);
+         if (cache_key) {
+            moninfo->cache_key = cache_key;
+            g_hash_table_replace(usb_monitor_cache, cache_key, moninfo);
+            cache_key = NULL;
+         }
 
  close:
          if (devinfo)
@@ -527,8 +762,14 @@ get_usb_monitor_list() {
          usb_close_device(fd, hiddev_fn, CALLOPT_NONE); // return error if failure
          DBGTRC(debug, TRACE_GROUP, "Closed");
       }  // monitor opened
+      free(cache_key);
    } // loop over device names
 
+   // discard cached records for devices no longer present
+   g_hash_table_foreach_remove(usb_monitor_cache, moninfo_not_detected, usb_monitors);
+   g_hash_table_destroy(usb_nonmonitor_keys);
+   usb_nonmonitor_keys = nonmonitor_keys;
+
    g_ptr_array_set_free_func(hiddev_names, g_free);
    g_ptr_array_free(hiddev_names, true);
 
@@ -546,12 +787,23 @@ GPtrArray * get_usb_open_errors() {
 }
 
 
+/** Discards the current USB monitor list.
+ *
+ *  Records in the monitor cache are retained for the next detection.
+ *  Records that were not cached are freed.
+ */
 void
 discard_usb_monitor_list() {
    if (usb_monitors) {
-      g_ptr_array_set_free_func(usb_monitors, free_usb_monitor_info);
+      for (int ndx = 0; ndx < usb_monitors->len; ndx++) {
+         Usb_Monitor_Info * moninfo = g_ptr_array_index(usb_monitors, ndx);
+         if (!moninfo->cache_key)
+            free_usb_monitor_info(moninfo);
+      }
       g_ptr_array_free(usb_monitors, true);
       g_ptr_array_free(usb_open_errors, true);  // array of Bus_Open_Error *, no special free function needed
+      usb_monitors = NULL;
+      usb_open_errors = NULL;
    }
 }
 
@@ -813,7 +1065,9 @@ void
 init_usb_displays() {
    RTTI_ADD_FUNC(collect_vcp_reports);
    RTTI_ADD_FUNC(get_usb_monitor_list);
+   RTTI_ADD_FUNC(process_usb_hotplug_events);
    RTTI_ADD_FUNC(avoid_device_by_usb_interfaces_property_string);
    RTTI_ADD_FUNC(is_possible_monitor_by_hiddev_name);
+   init_usb_hidraw();
    // dbgrpt_func_name_table(0);
 }
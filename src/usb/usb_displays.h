@@ -21,6 +21,7 @@
 #include "vcp/vcp_feature_values.h"
 
 #include "usb/usb_base.h"
+#include "usb/usb_hidraw.h"
 
 
 bool check_usb_monitor( char * device_name );
@@ -54,15 +55,35 @@ typedef struct usb_monitor_vcp_rec {
    struct hiddev_usage_ref   * uref;
 } Usb_Monitor_Vcp_Rec;
 
+/* Locates the HID usage for a VCP feature, as hiddev would find it by
+ * usage code, so that the value can be accessed without a lookup.
+ */
+typedef struct {
+   bool                        found;
+   __u32                       report_type;
+   __u32                       report_id;
+   __u32                       field_index;
+   __u32                       usage_index;
+   __s32                       logical_maximum;
+} Usb_Usage_Locator;
+
+typedef struct {
+   Usb_Usage_Locator           get;               // feature report, else input report
+   Usb_Usage_Locator           set;               // feature report
+} Usb_Vcp_Usage_Locators;
+
 /* Describes a USB connected monitor.  */
 #define USB_MONITOR_INFO_MARKER "UMNF"
 typedef struct usb_monitor_info {
    char                     marker[4];
    char *                   hiddev_device_name;
+   char *                   cache_key;        // bus:device:vid:pid:serial, NULL if not cached
    Parsed_Edid *            edid;
    struct hiddev_devinfo *  hiddev_devinfo;
    // a flagrant waste of space, avoid premature optimization
    GPtrArray *              vcp_codes[256];   // array of Usb_Monitor_Vcp_Rec *
+   Usb_Vcp_Usage_Locators   usage_locators[256];
+   Usb_Hidraw_Info *        hidraw;           // NULL if hidraw device not usable
 } Usb_Monitor_Info;
 
 void        dbgrpt_usb_monitor_info(Usb_Monitor_Info * moninfo, int depth);
@@ -0,0 +1,470 @@
+/** @file usb_hidraw.c
+ *
+ *  Access the VCP feature values of a USB connected monitor using whole
+ *  feature reports read and written through its hidraw device.
+ *
+ *  The hiddev interface reads and writes values one usage at a time.
+ *  A monitor's controls are usually packed into a few feature reports,
+ *  so reading the report once with HIDIOCGFEATURE and decoding each value
+ *  using the parsed report descriptor requires far fewer device
+ *  transactions, e.g. when dumping all the controls of a monitor.
+ *
+ *  A report read is reused for subsequent reads of values in the same
+ *  report during a short interval.  Writes always read the current report
+ *  before modifying the value, so as not to overwrite changes made by
+ *  the monitor's own controls, and discard the reused copy.
+ *
+ *  If the hidraw device cannot be found or opened, the caller uses hiddev.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-2.0/glib.h>
+#include <linux/hid.h>
+#include <linux/hidraw.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+/** \endcond */
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/timestamp.h"
+
+#include "usb_util/hid_report_descriptor.h"
+
+#include "base/core.h"
+#include "base/ddc_errno.h"
+#include "base/execution_stats.h"
+#include "base/rtti.h"
+
+#include "usb/usb_hidraw.h"
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_USB;
+
+#define HIDRAW_REPORT_REUSE_MILLIS  250     // how long a report read is reused
+#define HIDRAW_MAX_REPORT_SIZE      4096    // HID_MAX_BUFFER_SIZE in the kernel
+
+/* Location of a VCP feature value within a feature report */
+typedef struct {
+   bool      found;
+   Byte      report_id;
+   uint16_t  bit_offset;           // from start of report data, i.e. after report id byte
+   uint16_t  bit_size;
+   int32_t   logical_minimum;
+   int32_t   logical_maximum;
+} Hidraw_Vcp_Locator;
+
+/* A feature report as last read from the device */
+typedef struct {
+   int       report_len;           // including report id byte, 0 if report not used
+   uint64_t  read_nanos;           // time of last read, 0 if no valid copy
+   Byte *    buf;
+} Hidraw_Report_Copy;
+
+#define USB_HIDRAW_INFO_MARKER "UHRI"
+struct usb_hidraw_info {
+   char                marker[4];
+   char *              hidraw_device_name;
+   int                 fd;
+   GMutex              mutex;                // serializes use of fd and reports
+   Hidraw_Vcp_Locator  locators[256];        // indexed by VCP feature code
+   Hidraw_Report_Copy  reports[256];         // indexed by report id
+};
+
+
+//
+// Device lookup
+//
+
+/** Finds the hidraw device for the same USB interface as a hiddev device.
+ *
+ *  The hidraw node is found in sysfs, e.g.
+ *  /sys/class/usbmisc/hiddev2/device/0003:0419:8002.0004/hidraw/hidraw3
+ *
+ *  @param  hiddev_name  hiddev device name, e.g. /dev/usb/hiddev2
+ *  @return hidraw device name, e.g. /dev/hidraw3, NULL if not found,
+ *          caller must free
+ */
+static char *
+find_hidraw_for_hiddev(const char * hiddev_name) {
+   bool debug = false;
+   char * result = NULL;
+   char * base = g_path_get_basename(hiddev_name);
+   char * intf_path = g_strdup_printf("/sys/class/usbmisc/%s/device", base);
+   GDir * intf_dir = g_dir_open(intf_path, 0, NULL);
+   if (intf_dir) {
+      const char * hid_dev;
+      while (!result && (hid_dev = g_dir_read_name(intf_dir)) ) {
+         char * hidraw_path = g_strdup_printf("%s/%s/hidraw", intf_path, hid_dev);
+         GDir * hidraw_dir = g_dir_open(hidraw_path, 0, NULL);
+         if (hidraw_dir) {
+            const char * node = g_dir_read_name(hidraw_dir);
+            if (node && str_starts_with(node, "hidraw"))
+               result = g_strdup_printf("/dev/%s", node);
+            g_dir_close(hidraw_dir);
+         }
+         g_free(hidraw_path);
+      }
+      g_dir_close(intf_dir);
+   }
+   g_free(intf_path);
+   g_free(base);
+   DBGTRC(debug, TRACE_GROUP, "hiddev_name=%s, returning %s", hiddev_name, result);
+   return result;
+}
+
+
+//
+// Report layout
+//
+
+/** Returns the usage of a report field element.
+ *
+ *  @param  hf   field
+ *  @param  ndx  element number, 0 based
+ *  @return extended usage, 0 if none
+ */
+static uint32_t
+field_element_usage(Parsed_Hid_Field * hf, int ndx) {
+   if (hf->extended_usages && hf->extended_usages->len > 0) {
+      int usagect = hf->extended_usages->len;
+      return g_array_index(hf->extended_usages, uint32_t, (ndx < usagect) ? ndx : usagect-1);
+   }
+   if (hf->min_extended_usage) {
+      uint32_t usage = hf->min_extended_usage + ndx;
+      return (usage <= hf->max_extended_usage) ? usage : hf->max_extended_usage;
+   }
+   return 0;
+}
+
+
+/** Records the location of each VCP feature value in the feature reports
+ *  of a parsed report descriptor.
+ *
+ *  Fields are packed in descriptor order, least significant bit first.
+ *  The fields of a report can be split over several collections, so the
+ *  bit position is maintained per report id.
+ */
+static void
+build_locators(Usb_Hidraw_Info * hinfo, Parsed_Hid_Descriptor * phd) {
+   bool debug = false;
+   int bit_pos[256] = {0};
+   GPtrArray * feature_reports = select_parsed_hid_report_descriptors(phd, HIDF_REPORT_TYPE_FEATURE);
+   for (int rndx = 0; rndx < feature_reports->len; rndx++) {
+      Parsed_Hid_Report * hr = g_ptr_array_index(feature_reports, rndx);
+      if (hr->report_id > 255 || !hr->hid_fields)
+         continue;
+      Byte report_id = hr->report_id;
+      for (int fndx = 0; fndx < hr->hid_fields->len; fndx++) {
+         Parsed_Hid_Field * hf = g_ptr_array_index(hr->hid_fields, fndx);
+         bool is_variable = (hf->item_flags & 0x03) == 0x02;   // data, variable
+         for (int endx = 0; endx < hf->report_count; endx++) {
+            uint32_t usage = (is_variable) ? field_element_usage(hf, endx) : 0;
+            if ( (usage & 0xffffff00) == 0x00820000 && hf->report_size <= 32) {  // VESA Virtual Controls page
+               Hidraw_Vcp_Locator * loc = &hinfo->locators[usage & 0xff];
+               if (!loc->found) {
+                  loc->found           = true;
+                  loc->report_id       = report_id;
+                  loc->bit_offset      = bit_pos[report_id] + endx * hf->report_size;
+                  loc->bit_size        = hf->report_size;
+                  loc->logical_minimum = hf->logical_minimum;
+                  loc->logical_maximum = hf->logical_maximum;
+               }
+            }
+         }
+         bit_pos[report_id] += hf->report_size * hf->report_count;
+      }
+   }
+   g_ptr_array_free(feature_reports, true);
+
+   for (int ndx = 0; ndx < 256; ndx++) {
+      if (bit_pos[ndx] > 0) {
+         int len = 1 + (bit_pos[ndx] + 7) / 8;
+         if (len <= HIDRAW_MAX_REPORT_SIZE) {
+            hinfo->reports[ndx].report_len = len;
+            hinfo->reports[ndx].buf = calloc(1, len);
+         }
+      }
+   }
+   for (int ndx = 0; ndx < 256; ndx++) {
+      Hidraw_Vcp_Locator * loc = &hinfo->locators[ndx];
+      if (loc->found && hinfo->reports[loc->report_id].report_len == 0)
+         loc->found = false;
+      if (loc->found)
+         DBGTRC(debug, TRACE_GROUP, "feature 0x%02x: report_id=%d, bit_offset=%d, bit_size=%d",
+                                    ndx, loc->report_id, loc->bit_offset, loc->bit_size);
+   }
+}
+
+
+//
+// Value extraction
+//
+
+static uint32_t
+get_report_bits(const Byte * data, int bit_offset, int bit_size) {
+   uint32_t result = 0;
+   for (int ndx = 0; ndx < bit_size; ndx++) {
+      int bitno = bit_offset + ndx;
+      if (data[bitno/8] & (1 << (bitno%8)))
+         result |= (uint32_t) 1 << ndx;
+   }
+   return result;
+}
+
+
+static void
+set_report_bits(Byte * data, int bit_offset, int bit_size, uint32_t value) {
+   for (int ndx = 0; ndx < bit_size; ndx++) {
+      int bitno = bit_offset + ndx;
+      if (value & ((uint32_t) 1 << ndx))
+         data[bitno/8] |= (1 << (bitno%8));
+      else
+         data[bitno/8] &= ~(1 << (bitno%8));
+   }
+}
+
+
+/** Reads a feature report from the device.
+ *
+ *  @param  hinfo      pointer to #Usb_Hidraw_Info, mutex must be held
+ *  @param  report_id  report number
+ *  @return 0 if success, -errno if error
+ */
+static Status_Errno
+read_feature_report(Usb_Hidraw_Info * hinfo, Byte report_id) {
+   bool debug = false;
+   Hidraw_Report_Copy * rpt = &hinfo->reports[report_id];
+   assert(rpt->report_len > 0);
+   Status_Errno rc = 0;
+   rpt->buf[0] = report_id;
+   RECORD_IO_EVENT(
+         IE_OTHER,
+         ( rc = ioctl(hinfo->fd, HIDIOCGFEATURE(rpt->report_len), rpt->buf) )
+      );
+   if (rc < 0) {
+      rc = -errno;
+      rpt->read_nanos = 0;
+   }
+   else {
+      if (rc < rpt->report_len)       // short report, zero the remainder
+         memset(rpt->buf + rc, 0, rpt->report_len - rc);
+      rc = 0;
+      rpt->read_nanos = cur_monotonic_nanosec();
+   }
+   DBGTRC(debug, TRACE_GROUP, "report_id=%d, report_len=%d, returning %s",
+                              report_id, rpt->report_len, psc_desc(rc));
+   return rc;
+}
+
+
+//
+// Public functions
+//
+
+/** Opens the hidraw device for a USB connected monitor, and determines
+ *  the location of its VCP features in the feature reports.
+ *
+ *  @param  hiddev_name  hiddev device name of the monitor
+ *  @return pointer to newly allocated #Usb_Hidraw_Info,
+ *          NULL if the hidraw device cannot be used
+ */
+Usb_Hidraw_Info *
+usb_hidraw_open_for_hiddev(const char * hiddev_name) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "hiddev_name=%s", hiddev_name);
+
+   Usb_Hidraw_Info * hinfo = NULL;
+   Parsed_Hid_Descriptor * phd = NULL;
+   int fd = -1;
+   char * hidraw_name = find_hidraw_for_hiddev(hiddev_name);
+   if (!hidraw_name)
+      goto bye;
+
+   fd = open(hidraw_name, O_RDWR|O_CLOEXEC);
+   if (fd < 0) {
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Unable to open %s: %s", hidraw_name, strerror(errno));
+      goto bye;
+   }
+
+   int desc_size = 0;
+   struct hidraw_report_descriptor rpt_desc = {0};
+   if (ioctl(fd, HIDIOCGRDESCSIZE, &desc_size) < 0 || desc_size > HID_MAX_DESCRIPTOR_SIZE)
+      goto bye;
+   rpt_desc.size = desc_size;
+   if (ioctl(fd, HIDIOCGRDESC, &rpt_desc) < 0)
+      goto bye;
+   phd = get_parsed_hid_report_desc(rpt_desc.value, rpt_desc.size);   // shared, not freed
+   if (!phd || !phd->valid_descriptor)
+      goto bye;
+
+   hinfo = calloc(1, sizeof(Usb_Hidraw_Info));
+   memcpy(hinfo->marker, USB_HIDRAW_INFO_MARKER, 4);
+   hinfo->hidraw_device_name = hidraw_name;
+   hinfo->fd = fd;
+   g_mutex_init(&hinfo->mutex);
+   build_locators(hinfo, phd);
+   hidraw_name = NULL;
+   fd = -1;
+
+bye:
+   if (fd >= 0)
+      close(fd);
+   free(hidraw_name);
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning %p", hinfo);
+   return hinfo;
+}
+
+
+/** Closes the hidraw device and frees a #Usb_Hidraw_Info
+ *
+ *  @param  hinfo  pointer to instance, if NULL do nothing
+ */
+void
+usb_hidraw_close(Usb_Hidraw_Info * hinfo) {
+   if (hinfo) {
+      assert(memcmp(hinfo->marker, USB_HIDRAW_INFO_MARKER, 4) == 0);
+      close(hinfo->fd);
+      for (int ndx = 0; ndx < 256; ndx++)
+         free(hinfo->reports[ndx].buf);
+      g_mutex_clear(&hinfo->mutex);
+      free(hinfo->hidraw_device_name);
+      hinfo->marker[3] = 'x';
+      free(hinfo);
+   }
+}
+
+
+/** Indicates whether the location of a feature in the feature reports is known.
+ *
+ *  @param  hinfo         pointer to #Usb_Hidraw_Info
+ *  @param  feature_code  VCP feature code
+ */
+bool
+usb_hidraw_has_feature(Usb_Hidraw_Info * hinfo, Byte feature_code) {
+   return hinfo->locators[feature_code].found;
+}
+
+
+/** Gets the value of a VCP feature from its feature report.
+ *
+ *  @param  hinfo         pointer to #Usb_Hidraw_Info
+ *  @param  feature_code  VCP feature code
+ *  @param  maxval        where to return the maximum value
+ *  @param  curval        where to return the current value
+ *  @retval 0                           success
+ *  @retval DDCRC_REPORTED_UNSUPPORTED  feature not in any feature report
+ *  @retval -errno                      ioctl failure
+ */
+DDCA_Status
+usb_hidraw_get_vcp_value(
+      Usb_Hidraw_Info * hinfo,
+      Byte              feature_code,
+      __s32 *           maxval,
+      __s32 *           curval)
+{
+   bool debug = false;
+   assert(hinfo && memcmp(hinfo->marker, USB_HIDRAW_INFO_MARKER, 4) == 0);
+   Hidraw_Vcp_Locator * loc = &hinfo->locators[feature_code];
+   if (!loc->found)
+      return DDCRC_REPORTED_UNSUPPORTED;
+
+   DDCA_Status psc = 0;
+   g_mutex_lock(&hinfo->mutex);
+   Hidraw_Report_Copy * rpt = &hinfo->reports[loc->report_id];
+   uint64_t now = cur_monotonic_nanosec();
+   if (rpt->read_nanos == 0 || now - rpt->read_nanos > HIDRAW_REPORT_REUSE_MILLIS * (uint64_t) 1000000)
+      psc = read_feature_report(hinfo, loc->report_id);
+   if (psc == 0) {
+      uint32_t raw = get_report_bits(rpt->buf+1, loc->bit_offset, loc->bit_size);
+      __s32 value = raw;
+      if (loc->logical_minimum < 0 && loc->bit_size < 32 && (raw & ((uint32_t) 1 << (loc->bit_size-1))))
+         value = (__s32) (raw | ~(((uint32_t) 1 << loc->bit_size) - 1));    // sign extend
+      *curval = value;
+      *maxval = loc->logical_maximum;
+   }
+   g_mutex_unlock(&hinfo->mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "feature_code=0x%02x, returning %s, curval=%d",
+                              feature_code, psc_desc(psc), (psc == 0) ? *curval : 0);
+   return psc;
+}
+
+
+/** Sets the value of a VCP feature by rewriting its feature report.
+ *
+ *  @param  hinfo         pointer to #Usb_Hidraw_Info
+ *  @param  feature_code  VCP feature code
+ *  @param  new_value     value to set
+ *  @retval 0                           success
+ *  @retval DDCRC_REPORTED_UNSUPPORTED  feature not in any feature report
+ *  @retval -errno                      ioctl failure
+ */
+DDCA_Status
+usb_hidraw_set_vcp_value(
+      Usb_Hidraw_Info * hinfo,
+      Byte              feature_code,
+      __s32             new_value)
+{
+   bool debug = false;
+   assert(hinfo && memcmp(hinfo->marker, USB_HIDRAW_INFO_MARKER, 4) == 0);
+   Hidraw_Vcp_Locator * loc = &hinfo->locators[feature_code];
+   if (!loc->found)
+      return DDCRC_REPORTED_UNSUPPORTED;
+
+   g_mutex_lock(&hinfo->mutex);
+   Hidraw_Report_Copy * rpt = &hinfo->reports[loc->report_id];
+   DDCA_Status psc = read_feature_report(hinfo, loc->report_id);
+   if (psc == 0) {
+      set_report_bits(rpt->buf+1, loc->bit_offset, loc->bit_size, (uint32_t) new_value);
+      rpt->buf[0] = loc->report_id;
+      int rc;
+      RECORD_IO_EVENT(
+            IE_OTHER,
+            ( rc = ioctl(hinfo->fd, HIDIOCSFEATURE(rpt->report_len), rpt->buf) )
+         );
+      if (rc < 0)
+         psc = -errno;
+   }
+   rpt->read_nanos = 0;     // the monitor may adjust the value written
+   g_mutex_unlock(&hinfo->mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "feature_code=0x%02x, new_value=%d, returning %s",
+                              feature_code, new_value, psc_desc(psc));
+   return psc;
+}
+
+
+/** Emits a debug report of a #Usb_Hidraw_Info
+ *
+ *  @param  hinfo  pointer to instance
+ *  @param  depth  logical indentation depth
+ */
+void
+dbgrpt_usb_hidraw_info(Usb_Hidraw_Info * hinfo, int depth) {
+   int d1 = depth+1;
+   rpt_structure_loc("Usb_Hidraw_Info", hinfo, depth);
+   rpt_vstring(d1, "hidraw_device_name: %s", hinfo->hidraw_device_name);
+   rpt_vstring(d1, "fd:                 %d", hinfo->fd);
+   for (int ndx = 0; ndx < 256; ndx++) {
+      Hidraw_Vcp_Locator * loc = &hinfo->locators[ndx];
+      if (loc->found)
+         rpt_vstring(d1, "feature 0x%02x: report_id=%d, bit_offset=%d, bit_size=%d, logical range %d..%d",
+                          ndx, loc->report_id, loc->bit_offset, loc->bit_size,
+                          loc->logical_minimum, loc->logical_maximum);
+   }
+}
+
+
+void init_usb_hidraw() {
+   RTTI_ADD_FUNC(usb_hidraw_open_for_hiddev);
+}
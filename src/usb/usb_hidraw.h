@@ -0,0 +1,39 @@
+/** @file usb_hidraw.h
+ *
+ *  Access the VCP feature values of a USB connected monitor using whole
+ *  feature reports read and written through its hidraw device
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef USB_HIDRAW_H_
+#define USB_HIDRAW_H_
+
+/** \cond */
+#include <linux/types.h>
+#include <stdbool.h>
+/** \endcond */
+
+#include "ddcutil_types.h"
+
+#include "util/coredefs.h"
+
+typedef struct usb_hidraw_info Usb_Hidraw_Info;
+
+Usb_Hidraw_Info *  usb_hidraw_open_for_hiddev(const char * hiddev_name);
+void               usb_hidraw_close(Usb_Hidraw_Info * hinfo);
+bool               usb_hidraw_has_feature(Usb_Hidraw_Info * hinfo, Byte feature_code);
+DDCA_Status        usb_hidraw_get_vcp_value(
+                      Usb_Hidraw_Info * hinfo,
+                      Byte              feature_code,
+                      __s32 *           maxval,
+                      __s32 *           curval);
+DDCA_Status        usb_hidraw_set_vcp_value(
+                      Usb_Hidraw_Info * hinfo,
+                      Byte              feature_code,
+                      __s32             new_value);
+void               dbgrpt_usb_hidraw_info(Usb_Hidraw_Info * hinfo, int depth);
+void               init_usb_hidraw();
+
+#endif /* USB_HIDRAW_H_ */
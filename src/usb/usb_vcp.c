@@ -276,6 +276,49 @@ bye:
 }
 
 
+//
+// Get and set based on a Usb_Usage_Locator
+//
+
+/* Gets the current value of a usage whose location is known.
+ *
+ * Arguments:
+ *    fd      file descriptor for open hiddev device
+ *    loc     pointer to a Usb_Usage_Locator
+ *    maxval  address at which to return max value of the usage
+ *    curval  address at which to return the current value of the usage
+ *
+ * Returns:  status code
+ *
+ * Since the report, field and usage indexes are known, a single
+ * HIDIOCGUSAGE call is required, without a search by usage code.
+ */
+static Public_Status_Code
+usb_get_usage_value_by_locator(
+      int                   fd,
+      Usb_Usage_Locator *   loc,
+      __s32 *               maxval,
+      __s32 *               curval)
+{
+   bool debug = false;
+   assert(loc->found);
+   struct hiddev_usage_ref uref = {
+      .report_type = loc->report_type,
+      .report_id   = loc->report_id,
+      .field_index = loc->field_index,
+      .usage_index = loc->usage_index,
+   };
+   Public_Status_Code psc = hiddev_get_usage_value(fd, &uref, CALLOPT_NONE);
+   if (psc == 0) {
+      *curval = uref.value;
+      *maxval = loc->logical_maximum;
+   }
+   DBGMSF(debug, "report_type=%d, report_id=%d, field_index=%d, usage_index=%d, returning: %s",
+                 loc->report_type, loc->report_id, loc->field_index, loc->usage_index, psc_desc(psc));
+   return psc;
+}
+
+
 //
 // Get and set based on a Usb_Monitor_Vcp_Rec
 //
@@ -448,7 +491,19 @@ usb_get_nontable_vcp_value(
    __s32 curval = 0;    // ditto
    bool use_alt_method = true;
 
-   if (use_alt_method) {
+   Usb_Usage_Locator * loc = &moninfo->usage_locators[feature_code].get;
+   if (moninfo->hidraw && usb_hidraw_has_feature(moninfo->hidraw, feature_code)) {
+      // value decoded from a whole feature report, which may be reused
+      psc = usb_hidraw_get_vcp_value(moninfo->hidraw, feature_code, &maxval, &curval);
+   }
+   if (psc != 0 && loc->found) {
+      // a single ioctl, no lookup by usage code
+      psc = usb_get_usage_value_by_locator(dh->fd, loc, &maxval, &curval);
+   }
+   if (psc == 0) {
+      // value obtained using the locator
+   }
+   else if (use_alt_method) {
       __u32 usage_code = 0x0082 << 16 | feature_code;
       psc = usb_get_usage_value_by_report_type_and_ucode(
                   dh->fd, HID_REPORT_TYPE_FEATURE, usage_code, &maxval, &curval);
@@ -606,7 +661,21 @@ usb_set_nontable_vcp_value(
    assert(moninfo);
 
    bool use_alt = true;
-   if (use_alt) {
+   Usb_Usage_Locator * loc = &moninfo->usage_locators[feature_code].set;
+   if (moninfo->hidraw && usb_hidraw_has_feature(moninfo->hidraw, feature_code)) {
+      psc = usb_hidraw_set_vcp_value(moninfo->hidraw, feature_code, new_value);
+   }
+   if (psc == 0) {
+      // value set by rewriting the feature report
+   }
+   else if (loc->found) {
+      // report, field, and usage indexes are known, no lookup by usage code
+      psc = set_control_value(dh->fd, loc->report_type, loc->report_id,
+                              loc->field_index, loc->usage_index, new_value);
+      if (psc == -EINVAL)
+         psc = DDCRC_REPORTED_UNSUPPORTED;
+   }
+   else if (use_alt) {
       __u32 usage_code = 0x0082 << 16 | feature_code;
       psc = set_usage_value_by_report_type_and_ucode(
                dh->fd, HID_REPORT_TYPE_FEATURE, usage_code, new_value);
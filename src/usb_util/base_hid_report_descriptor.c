@@ -204,12 +204,11 @@ void report_raw_hid_report_item(Hid_Report_Descriptor_Item * item, int depth) {
 
 
 
+/* Frees a list of Hid_Report_Items created by tokenize_hid_report_descriptor().
+ * The items are allocated as a single block headed by the first item.
+ */
 void free_hid_report_item_list(Hid_Report_Descriptor_Item * head) {
-   while (head) {
-      Hid_Report_Descriptor_Item * next = head->next;
-      free(head);
-      head = next;
-   }
+   free(head);
 }
 
 
@@ -220,7 +219,10 @@ void free_hid_report_item_list(Hid_Report_Descriptor_Item * head) {
  *    b        address of bytes
  *    l        number of bytes
  *
- * Returns:    linked list of Hid_Report_Items
+ * Returns:    linked list of Hid_Report_Items, NULL if no items
+ *
+ * The items are counted first and allocated in a single block, linked in
+ * descriptor order.  A truncated final item is ignored.
  */
 // need better name
 Hid_Report_Descriptor_Item * tokenize_hid_report_descriptor(Byte * b, int l) {
@@ -237,8 +239,21 @@ Hid_Report_Descriptor_Item * tokenize_hid_report_descriptor(Byte * b, int l) {
    // if (debug)
    //   printf("(%s)          Report Descriptor: (length is %d)\n", __func__, l);
 
-   for (i = 0; i < l; ) {
-      cur = calloc(1, sizeof(Hid_Report_Descriptor_Item));
+   int itemct = 0;
+   for (i = 0; i < l; itemct++) {
+      int bytect = b[i] & 0x03;
+      int next_i = i + 1 + ((bytect == 3) ? 4 : bytect);
+      if (next_i > l)
+         break;
+      i = next_i;
+   }
+   if (itemct == 0)
+      return NULL;
+   Hid_Report_Descriptor_Item * items = calloc(itemct, sizeof(Hid_Report_Descriptor_Item));
+
+   i = 0;
+   for (int itemndx = 0; itemndx < itemct; itemndx++) {
+      cur = &items[itemndx];
 
       Byte b0 = b[i] & 0x03;                  // first 2 bits are size indicator, 0, 1, 2, or 3
       cur->bsize_bytect = (b0 == 3) ? 4 : b0; // actual number of bytes
@@ -986,6 +986,42 @@ Parsed_Hid_Descriptor * parse_hid_report_desc(Byte * b, int desclen) {
 }
 
 
+// Parsed descriptors, keyed by descriptor bytes.
+// Identical devices, e.g. multiple monitors of the same model, share a parse.
+static GHashTable * parsed_descriptor_cache = NULL;
+static GMutex       parsed_descriptor_cache_mutex;
+
+/* Gets the parsed form of a HID report descriptor, parsing the descriptor
+ * only the first time its bytes are seen.
+ *
+ * Arguments:
+ *    b             address of first byte
+ *    desclen       number of bytes
+ *
+ * Returns:         parsed report descriptor, NULL if the descriptor cannot be parsed
+ *
+ * The returned descriptor is shared by all callers and must not be
+ * modified or freed.
+ */
+Parsed_Hid_Descriptor * get_parsed_hid_report_desc(Byte * b, int desclen) {
+   g_mutex_lock(&parsed_descriptor_cache_mutex);
+   if (!parsed_descriptor_cache)
+      parsed_descriptor_cache = g_hash_table_new_full(
+            g_bytes_hash, g_bytes_equal,
+            (GDestroyNotify) g_bytes_unref, (GDestroyNotify) free_parsed_hid_descriptor);
+   GBytes * key = g_bytes_new(b, desclen);
+   Parsed_Hid_Descriptor * result = NULL;
+   if (!g_hash_table_lookup_extended(parsed_descriptor_cache, key, NULL, (gpointer*) &result)) {
+      result = parse_hid_report_desc(b, desclen);
+      g_hash_table_insert(parsed_descriptor_cache, key, result);   // table owns key
+   }
+   else
+      g_bytes_unref(key);
+   g_mutex_unlock(&parsed_descriptor_cache_mutex);
+   return result;
+}
+
+
 //
 // Functions that extract information from a Parsed_Hid_Descriptor
 //
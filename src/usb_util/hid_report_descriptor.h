@@ -111,6 +111,7 @@ void free_parsed_hid_descriptor(Parsed_Hid_Descriptor * phd);
 
 Parsed_Hid_Descriptor * parse_hid_report_desc_from_item_list(Hid_Report_Descriptor_Item * items_head);
 Parsed_Hid_Descriptor * parse_hid_report_desc(Byte * b, int desclen);
+Parsed_Hid_Descriptor * get_parsed_hid_report_desc(Byte * b, int desclen);   // cached, do not free
 
 void dbgrpt_parsed_hid_report(Parsed_Hid_Report * hr, int depth);
 void summarize_parsed_hid_report(Parsed_Hid_Report * hr, int depth);
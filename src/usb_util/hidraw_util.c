@@ -227,7 +227,7 @@ void probe_hidraw_device(char * devname, bool show_monitors_only,  int depth) {
 
    if (is_monitor) {
       puts("");
-      phd =  parse_hid_report_desc(rpt_desc.value, rpt_desc.size);
+      phd = get_parsed_hid_report_desc(rpt_desc.value, rpt_desc.size);   // shared, not freed
       Parsed_Hid_Report * edid_report = find_edid_report_descriptor(phd);
       if (edid_report) {
          rpt_title("Report descriptor for EDID:", d1);
@@ -270,7 +270,6 @@ void probe_hidraw_device(char * devname, bool show_monitors_only,  int depth) {
             rpt_hex_dump(buf, res, d2);
          }
       }
-      free_parsed_hid_descriptor(phd);  // not defined, but need to free phd
    }
 
    free_hid_report_item_list(report_item_list);
@@ -1065,7 +1065,7 @@ static void report_retrieved_report_descriptor_and_probe(
    Hid_Report_Descriptor_Item* item_list = tokenize_hid_report_descriptor(dbuf, dbufct);
    report_hid_report_item_list(item_list, d1);
    puts("");
-   Parsed_Hid_Descriptor* phd = parse_hid_report_desc_from_item_list(item_list);
+   Parsed_Hid_Descriptor* phd = get_parsed_hid_report_desc(dbuf, dbufct);   // shared, not freed
    if (phd) {
       rpt_vstring(depth, "Parsed report descriptor:");
       dbgrpt_parsed_hid_descriptor(phd, d1);
@@ -1134,7 +1134,6 @@ static void report_retrieved_report_descriptor_and_probe(
          rpt_vstring(d2, "Not found");
          puts("");
       }
-      free_parsed_hid_descriptor(phd);
    }
    free_hid_report_item_list(item_list);
 }
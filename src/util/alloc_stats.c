@@ -0,0 +1,172 @@
+/** \file alloc_stats.c
+ *  Counts of live and total allocations, by subsystem
+ *
+ *  The allocators of the longer lived data structures, e.g. display
+ *  references, parsed EDIDs and capabilities, and the device id maps, count
+ *  each allocation and free, and its size, against their subsystem.  This
+ *  shows which structures account for memory growth in a long running
+ *  process.  Sizes are those of the structure, plus any variable length part
+ *  the allocator knows about.  Strings and arrays hung off a structure by
+ *  other code are not included.
+ *
+ *  Counters are updated using atomic operations, so counting takes no lock.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "report_util.h"
+
+#include "alloc_stats.h"
+
+static Alloc_Stats alloc_stats[ALLOC_SUBSYSTEM_CT];
+
+static const char * subsystem_names[] = {
+      "Display references",
+      "Parsed EDIDs",
+      "Parsed capabilities",
+      "Feature sets",
+      "Error_Info records",
+      "Buffers",
+      "Device id maps",
+      "Per-thread data",
+};
+
+
+/** Returns the name of a subsystem.
+ *
+ *  \param  subsys  subsystem id
+ *  \return name
+ */
+const char * alloc_subsystem_name(Alloc_Subsystem subsys) {
+   assert(subsys >= 0 && subsys < ALLOC_SUBSYSTEM_CT);
+   return subsystem_names[subsys];
+}
+
+
+static void
+update_peak(int64_t * peak, int64_t value) {
+   int64_t cur = __atomic_load_n(peak, __ATOMIC_RELAXED);
+   while (value > cur &&
+          !__atomic_compare_exchange_n(peak, &cur, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+}
+
+
+/** Counts an allocation made by the caller.
+ *
+ *  \param  subsys  subsystem id
+ *  \param  size    number of bytes allocated
+ */
+void alloc_stats_add(Alloc_Subsystem subsys, size_t size) {
+   Alloc_Stats * stats = &alloc_stats[subsys];
+   update_peak(&stats->peak_ct,    __atomic_add_fetch(&stats->cur_ct,    1,    __ATOMIC_RELAXED));
+   update_peak(&stats->peak_bytes, __atomic_add_fetch(&stats->cur_bytes, size, __ATOMIC_RELAXED));
+   __atomic_add_fetch(&stats->total_ct,    1,    __ATOMIC_RELAXED);
+   __atomic_add_fetch(&stats->total_bytes, size, __ATOMIC_RELAXED);
+}
+
+
+/** Counts the release of an allocation counted by #alloc_stats_add().
+ *
+ *  \param  subsys  subsystem id
+ *  \param  size    number of bytes released
+ */
+void alloc_stats_remove(Alloc_Subsystem subsys, size_t size) {
+   Alloc_Stats * stats = &alloc_stats[subsys];
+   __atomic_sub_fetch(&stats->cur_ct,    1,    __ATOMIC_RELAXED);
+   __atomic_sub_fetch(&stats->cur_bytes, size, __ATOMIC_RELAXED);
+}
+
+
+/** Counts the change of size of an allocation that has been reallocated.
+ *
+ *  \param  subsys    subsystem id
+ *  \param  old_size  prior number of bytes
+ *  \param  new_size  new number of bytes
+ */
+void alloc_stats_resize(Alloc_Subsystem subsys, size_t old_size, size_t new_size) {
+   Alloc_Stats * stats = &alloc_stats[subsys];
+   int64_t delta = (int64_t) new_size - (int64_t) old_size;
+   update_peak(&stats->peak_bytes, __atomic_add_fetch(&stats->cur_bytes, delta, __ATOMIC_RELAXED));
+   if (delta > 0)
+      __atomic_add_fetch(&stats->total_bytes, delta, __ATOMIC_RELAXED);
+}
+
+
+/** Allocates zeroed memory, counting it against a subsystem.
+ *
+ *  \param  subsys  subsystem id
+ *  \param  size    number of bytes
+ *  \return pointer to allocated memory, free using #counted_free()
+ */
+void * counted_calloc(Alloc_Subsystem subsys, size_t size) {
+   alloc_stats_add(subsys, size);
+   return calloc(1, size);
+}
+
+
+/** Frees memory allocated by #counted_calloc().
+ *
+ *  \param  subsys  subsystem id
+ *  \param  p       pointer to memory, if NULL do nothing
+ *  \param  size    size specified when allocated
+ */
+void counted_free(Alloc_Subsystem subsys, void * p, size_t size) {
+   if (p) {
+      alloc_stats_remove(subsys, size);
+      free(p);
+   }
+}
+
+
+/** Gets the counts of a subsystem.
+ *
+ *  \param  subsys  subsystem id
+ *  \param  stats   where to return the counts
+ */
+void get_alloc_stats(Alloc_Subsystem subsys, Alloc_Stats * stats) {
+   Alloc_Stats * src = &alloc_stats[subsys];
+   stats->cur_ct      = __atomic_load_n(&src->cur_ct,      __ATOMIC_RELAXED);
+   stats->peak_ct     = __atomic_load_n(&src->peak_ct,     __ATOMIC_RELAXED);
+   stats->total_ct    = __atomic_load_n(&src->total_ct,    __ATOMIC_RELAXED);
+   stats->cur_bytes   = __atomic_load_n(&src->cur_bytes,   __ATOMIC_RELAXED);
+   stats->peak_bytes  = __atomic_load_n(&src->peak_bytes,  __ATOMIC_RELAXED);
+   stats->total_bytes = __atomic_load_n(&src->total_bytes, __ATOMIC_RELAXED);
+}
+
+
+/** Resets the peak and total counts.  Peaks are set to the current values. */
+void reset_alloc_stats() {
+   for (int ndx = 0; ndx < ALLOC_SUBSYSTEM_CT; ndx++) {
+      Alloc_Stats * stats = &alloc_stats[ndx];
+      __atomic_store_n(&stats->peak_ct,    __atomic_load_n(&stats->cur_ct,    __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+      __atomic_store_n(&stats->peak_bytes, __atomic_load_n(&stats->cur_bytes, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+      __atomic_store_n(&stats->total_ct,    0, __ATOMIC_RELAXED);
+      __atomic_store_n(&stats->total_bytes, 0, __ATOMIC_RELAXED);
+   }
+}
+
+
+/** Reports the counts of all subsystems.
+ *
+ *  \param  depth  logical indentation depth
+ */
+void report_alloc_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("Memory allocations by subsystem:", depth);
+   rpt_vstring(d1, "%-22s %8s %8s %10s  %10s %10s %12s",
+                   "Subsystem", "Current", "Peak", "Total", "Cur bytes", "Peak bytes", "Total bytes");
+   for (int ndx = 0; ndx < ALLOC_SUBSYSTEM_CT; ndx++) {
+      Alloc_Stats stats;
+      get_alloc_stats(ndx, &stats);
+      rpt_vstring(d1, "%-22s %8"PRId64" %8"PRId64" %10"PRIu64"  %10"PRId64" %10"PRId64" %12"PRIu64,
+                      subsystem_names[ndx],
+                      stats.cur_ct, stats.peak_ct, stats.total_ct,
+                      stats.cur_bytes, stats.peak_bytes, stats.total_bytes);
+   }
+}
@@ -0,0 +1,47 @@
+/** \file alloc_stats.h
+ *  Counts of live and total allocations, by subsystem
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef ALLOC_STATS_H_
+#define ALLOC_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+   ALLOC_DISPLAY_REF,
+   ALLOC_EDID,
+   ALLOC_CAPABILITIES,
+   ALLOC_FEATURE_SET,
+   ALLOC_ERROR_INFO,
+   ALLOC_BUFFER,
+   ALLOC_DEVICE_ID_MAP,
+   ALLOC_THREAD_DATA,
+} Alloc_Subsystem;
+#define ALLOC_SUBSYSTEM_CT (ALLOC_THREAD_DATA+1)
+
+typedef struct {
+   int64_t  cur_ct;
+   int64_t  peak_ct;
+   uint64_t total_ct;
+   int64_t  cur_bytes;
+   int64_t  peak_bytes;
+   uint64_t total_bytes;
+} Alloc_Stats;
+
+const char * alloc_subsystem_name(Alloc_Subsystem subsys);
+
+void * counted_calloc(Alloc_Subsystem subsys, size_t size);
+void   counted_free(Alloc_Subsystem subsys, void * p, size_t size);
+void   alloc_stats_add(Alloc_Subsystem subsys, size_t size);
+void   alloc_stats_remove(Alloc_Subsystem subsys, size_t size);
+void   alloc_stats_resize(Alloc_Subsystem subsys, size_t old_size, size_t new_size);
+
+void   get_alloc_stats(Alloc_Subsystem subsys, Alloc_Stats * stats);
+void   reset_alloc_stats();
+void   report_alloc_stats(int depth);
+
+#endif /* ALLOC_STATS_H_ */
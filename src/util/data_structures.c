@@ -9,12 +9,14 @@
 #include <assert.h>
 #include <glib-2.0/glib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>     // for MIN, MAX
 /** \endcond */
 
+#include "alloc_stats.h"
 #include "report_util.h"
 #include "string_util.h"
 
@@ -29,6 +31,16 @@ bool trace_buffer_malloc_free = false;
 bool trace_buffer = false;    // controls buffer tracing
 bool trace_buffer_resize = false;
 
+// Buffers of up to this size, e.g. DDC packets and EDIDs, are allocated
+// with their bytes following the Buffer struct in a single block.
+#define BUFFER_INLINE_MAX 512
+
+#define BUFFER_SLACK 16    // extra space see if free failures go away - overruns?
+
+static inline bool buffer_bytes_inline(Buffer * buffer) {
+   return buffer->bytes == (Byte *) (buffer + 1);
+}
+
 
 /** Allocates a **Buffer** instance
  *
@@ -38,14 +50,23 @@ bool trace_buffer_resize = false;
  *  @return pointer to newly allocated instance
  */
 Buffer * buffer_new(int size, const char * trace_msg) {
-   int hacked_size = size+16;     // try allocating extra space see if free failures go away - overruns?
+   int hacked_size = size+BUFFER_SLACK;
    // printf("(%s) sizeof(Buffer)=%ld, size=%d\n", __func__, sizeof(Buffer), size);    // sizeof(Buffer) == 16
-   Buffer * buffer = (Buffer *) malloc(sizeof(Buffer));
+   Buffer * buffer = NULL;
+   if (size <= BUFFER_INLINE_MAX) {
+      buffer = (Buffer *) malloc(sizeof(Buffer) + hacked_size);
+      buffer->bytes = (Byte *) (buffer + 1);
+      memset(buffer->bytes, 0, hacked_size);
+   }
+   else {
+      buffer = (Buffer *) malloc(sizeof(Buffer));
+      buffer->bytes = (Byte *) calloc(1, hacked_size);
+   }
    memcpy(buffer->marker, BUFFER_MARKER, 4);
-   buffer->bytes = (Byte *) calloc(1, hacked_size);    // hack
    buffer->buffer_size = size;
    buffer->len = 0;
    buffer->size_increment = 0;
+   alloc_stats_add(ALLOC_BUFFER, sizeof(Buffer) + hacked_size);
    if (trace_buffer_malloc_free)
       printf("(%s) Allocated buffer.  buffer=%p, buffer->bytes=%p, &buffer->bytes=%p, %s\n",
              __func__, (void*)buffer, buffer->bytes, (void*)&(buffer->bytes), trace_msg);
@@ -58,7 +79,11 @@ Buffer * buffer_new(int size, const char * trace_msg) {
  *
  *  @param buf   pointer to Buffer instance
  *  @param size_increment if resizing is necessary, the buffer size will be
- *                         increased by this amount
+ *                         increased by at least this amount
+ *
+ *  @remark
+ *  The size is increased by at least half its current size, so that a
+ *  sequence of appends takes amortized linear time.
  */
 void buffer_set_size_increment(Buffer * buf, uint16_t size_increment) {
    buf->size_increment = size_increment;
@@ -115,7 +140,7 @@ void buffer_free(Buffer * buffer, const char * trace_msg) {
    // ASSERT_WITH_BACKTRACE(buffe#ifdef TEMPr);
    // ASSERT_WITH_BACKTRACE(memcmp(buffer->marker, BUFFER_MARKER, 4) == 0);
 
-   if (buffer->bytes) {
+   if (buffer->bytes && !buffer_bytes_inline(buffer)) {
      if (trace_buffer_malloc_free)
          printf("(%s) Freeing buffer->bytes = %p, &buffer->bytes=%p\n",
                 __func__, buffer->bytes, (void*)&(buffer->bytes));
@@ -123,6 +148,7 @@ void buffer_free(Buffer * buffer, const char * trace_msg) {
    }
    if (trace_buffer_malloc_free)
       printf("(%s) Freeing buffer = %p, %s\n", __func__, (void*)buffer, trace_msg);
+   alloc_stats_remove(ALLOC_BUFFER, sizeof(Buffer) + buffer->buffer_size + BUFFER_SLACK);
    buffer->marker[3] = 'x';
    free(buffer);
 
@@ -212,6 +238,24 @@ void buffer_set_bytes(Buffer * buf, int offset, Byte * bytes, int bytect) {
 }
 
 
+/** If the buffer is auto-extending, increases its size if necessary
+ *  to hold a given number of bytes.
+ *
+ *  @param  buffer         pointer to Buffer instance
+ *  @param  required_size  number of bytes required
+ */
+static void buffer_ensure_size(Buffer * buffer, int required_size) {
+   if (required_size > buffer->buffer_size && buffer->size_increment > 0) {
+      int new_size = MAX(required_size,
+                         buffer->buffer_size + MAX(buffer->size_increment, buffer->buffer_size/2));
+      if (trace_buffer_resize)
+         printf("(%s) Resizing. old size = %d, new size = %d\n",
+                __func__, buffer->buffer_size, new_size);
+      buffer_extend(buffer, new_size - buffer->buffer_size);
+   }
+}
+
+
 /** Appends a sequence of bytes to the current contents of a Buffer.
  *  The buffer length is updated.
  *
@@ -229,14 +273,7 @@ void buffer_append(Buffer * buffer, Byte * bytes, int bytect) {
    }
    //  buffer->len + 2 + bytect  .. why the  + 2?
 
-   int required_size = buffer->len + 2 + bytect;
-   if (required_size > buffer->buffer_size && buffer->size_increment > 0) {
-      int new_size = MAX(required_size, buffer->buffer_size + buffer->size_increment);
-      if (trace_buffer_resize)
-         printf("(%s) Resizing. old size = %d, new size = %d\n",
-                __func__, buffer->buffer_size, new_size);
-      buffer_extend(buffer, new_size - buffer->buffer_size);
-   }
+   buffer_ensure_size(buffer, buffer->len + 2 + bytect);
 
    assert(buffer->len + 2 + bytect <= buffer->buffer_size);
 
@@ -275,10 +312,11 @@ void buffer_strcat(Buffer * buffer, char * str) {
  *  @param buffer   pointer to Buffer instance
  *  @param byte     value to append
  *
- *  @todo Increase buffer size if necessary and size_increment > 0
+ *  The buffer size is increased if necessary and size_increment > 0.
  */
 void     buffer_add(Buffer * buffer, Byte byte) {
    assert( memcmp(buffer->marker, BUFFER_MARKER, 4) == 0);
+   buffer_ensure_size(buffer, buffer->len + 1);
    assert(buffer->len + 1 <= buffer->buffer_size);
    buffer->bytes[buffer->len++] = byte;
 }
@@ -314,7 +352,15 @@ bool     buffer_eq(Buffer* buf1, Buffer* buf2) {
  */
 void     buffer_extend(Buffer* buf, int addl_size) {
    int new_size = buf->buffer_size + addl_size;
-   buf->bytes = realloc(buf->bytes, new_size);
+   if (buffer_bytes_inline(buf)) {
+      // bytes move out of the Buffer's own allocation
+      Byte * new_bytes = malloc(new_size + BUFFER_SLACK);
+      memcpy(new_bytes, buf->bytes, buf->buffer_size);
+      buf->bytes = new_bytes;
+   }
+   else
+      buf->bytes = realloc(buf->bytes, new_size + BUFFER_SLACK);
+   alloc_stats_resize(ALLOC_BUFFER, buf->buffer_size, new_size);
    buf->buffer_size = new_size;
 }
 
@@ -428,6 +474,121 @@ csb_to_g_ptr_array(Circular_String_Buffer * csb) {
 // Identifier id to name and description lookup
 //
 
+// Most tables are small, and are simply scanned.  For a table with more
+// than VNT_SCAN_MAX entries, if the value is not found among the first
+// VNT_SCAN_MAX entries an index is built on first use: a direct array if
+// the values are dense, otherwise a hash table.  Names are also hashed,
+// for vnt_find_id().  Lookups using the index return the first matching
+// entry, as does a scan.
+//
+// Indexes are keyed by table address, so tables must be static.
+
+#define VNT_SCAN_MAX        16
+#define VNT_DIRECT_MAX_SPAN 4096
+
+typedef struct {
+   uint32_t            min_value;
+   uint32_t            span;              // direct != NULL iff span > 0
+   Value_Name_Title ** direct;            // indexed by value - min_value
+   GHashTable *        by_value;          // if not direct
+   GHashTable *        by_name;
+   GHashTable *        by_name_casefold;  // lower case names
+} Vnt_Index;
+
+static GHashTable * vnt_indexes = NULL;   // Value_Name_Title * -> Vnt_Index *
+static GRWLock      vnt_indexes_lock;
+
+
+static Vnt_Index * vnt_build_index(Value_Name_Title * table) {
+   Vnt_Index * index = calloc(1, sizeof(Vnt_Index));
+   int ct = 0;
+   uint32_t min_value = UINT32_MAX;
+   uint32_t max_value = 0;
+   for (Value_Name_Title * cur = table; cur->name; cur++, ct++) {
+      min_value = MIN(min_value, cur->value);
+      max_value = MAX(max_value, cur->value);
+   }
+   uint64_t span = (uint64_t) max_value - min_value + 1;
+   if (span <= VNT_DIRECT_MAX_SPAN && span <= 4 * (uint64_t) ct) {
+      index->min_value = min_value;
+      index->span = span;
+      index->direct = calloc(span, sizeof(Value_Name_Title *));
+   }
+   else
+      index->by_value = g_hash_table_new(g_direct_hash, g_direct_equal);
+   index->by_name = g_hash_table_new(g_str_hash, g_str_equal);
+   index->by_name_casefold = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+   for (Value_Name_Title * cur = table; cur->name; cur++) {
+      // first entry wins, as with a scan
+      if (index->direct) {
+         if (!index->direct[cur->value - min_value])
+            index->direct[cur->value - min_value] = cur;
+      }
+      else if (!g_hash_table_contains(index->by_value, GUINT_TO_POINTER(cur->value)))
+         g_hash_table_insert(index->by_value, GUINT_TO_POINTER(cur->value), cur);
+      if (!g_hash_table_contains(index->by_name, cur->name))
+         g_hash_table_insert(index->by_name, cur->name, cur);
+      char * folded = g_ascii_strdown(cur->name, -1);
+      if (!g_hash_table_contains(index->by_name_casefold, folded))
+         g_hash_table_insert(index->by_name_casefold, folded, cur);
+      else
+         g_free(folded);
+   }
+   return index;
+}
+
+
+/** Gets the index for a Value_Name_Title table, building it if necessary.
+ *  The index is never freed.
+ */
+static Vnt_Index * vnt_get_index(Value_Name_Title * table) {
+   g_rw_lock_reader_lock(&vnt_indexes_lock);
+   Vnt_Index * index = (vnt_indexes) ? g_hash_table_lookup(vnt_indexes, table) : NULL;
+   g_rw_lock_reader_unlock(&vnt_indexes_lock);
+   if (!index) {
+      g_rw_lock_writer_lock(&vnt_indexes_lock);
+      if (!vnt_indexes)
+         vnt_indexes = g_hash_table_new(g_direct_hash, g_direct_equal);
+      index = g_hash_table_lookup(vnt_indexes, table);
+      if (!index) {
+         index = vnt_build_index(table);
+         g_hash_table_insert(vnt_indexes, table, index);
+      }
+      g_rw_lock_writer_unlock(&vnt_indexes_lock);
+   }
+   return index;
+}
+
+
+/** Finds the entry for a value in a Value_Name_Title table.
+ *
+ * @param table  pointer to table
+ * @param val    value to lookup
+ *
+ * @return pointer to entry, NULL if not found
+ */
+static Value_Name_Title * vnt_find_entry(Value_Name_Title * table, uint32_t val) {
+   Value_Name_Title * cur = table;
+   for (int ndx = 0; cur->name && ndx < VNT_SCAN_MAX; cur++, ndx++) {
+      if (val == cur->value)
+         return cur;
+   }
+   if (!cur->name)
+      return NULL;
+
+   Value_Name_Title * result = NULL;
+   Vnt_Index * index = vnt_get_index(table);
+   if (index->direct) {
+      if (val >= index->min_value && val - index->min_value < index->span)
+         result = index->direct[val - index->min_value];
+   }
+   else
+      result = g_hash_table_lookup(index->by_value, GUINT_TO_POINTER(val));
+   return result;
+}
+
+
 /** Returns the name of an entry in a Value_Name_Title table.
  *
  * @param table  pointer to table
@@ -438,16 +599,8 @@ csb_to_g_ptr_array(Circular_String_Buffer * csb) {
 char * vnt_name(Value_Name_Title* table, uint32_t val) {
    // printf("(%s) val=%d\n", __func__, val);
    // debug_vnt_table(table);
-   char * result = NULL;
-
-   Value_Name_Title * cur = table;
-   for (; cur->name; cur++) {
-      if (val == cur->value) {
-         result = cur->name;
-         break;
-      }
-   }
-   return result;
+   Value_Name_Title * entry = vnt_find_entry(table, val);
+   return (entry) ? entry->name : NULL;
 }
 
 
@@ -461,16 +614,8 @@ char * vnt_name(Value_Name_Title* table, uint32_t val) {
 char * vnt_title(Value_Name_Title* table, uint32_t val) {
    // printf("(%s) val=%d\n", __func__, val);
    // debug_vnt_table(table);
-   char * result = NULL;
-
-   Value_Name_Title * cur = table;
-   for (; cur->name; cur++) {
-      if (val == cur->value) {
-         result = cur->title;
-         break;
-      }
-   }
-   return result;
+   Value_Name_Title * entry = vnt_find_entry(table, val);
+   return (entry) ? entry->title : NULL;
 }
 
 
@@ -496,18 +641,30 @@ uint32_t vnt_find_id(
    assert(s);
    uint32_t result = default_id;
    Value_Name_Title * cur = table;
-   for (; cur->name; cur++) {
+   for (int ndx = 0; cur->name && (use_title || ndx < VNT_SCAN_MAX); cur++, ndx++) {
       char * comparand = (use_title) ? cur->title : cur->name;
       if (comparand) {
          int comprc = (ignore_case)
                          ? strcasecmp(s, comparand)
                          : strcmp(    s, comparand);
-         if (comprc == 0) {
-            result = cur->value;
-            break;
-         }
+         if (comprc == 0)
+            return cur->value;
       }
    }
+   if (cur->name) {
+      // searching by name in a large table, not found in the first entries
+      Vnt_Index * index = vnt_get_index(table);
+      Value_Name_Title * entry = NULL;
+      if (ignore_case) {
+         char * folded = g_ascii_strdown(s, -1);
+         entry = g_hash_table_lookup(index->by_name_casefold, folded);
+         g_free(folded);
+      }
+      else
+         entry = g_hash_table_lookup(index->by_name, s);
+      if (entry)
+         result = entry->value;
+   }
    return result;
 }
 
@@ -876,6 +1033,23 @@ void test_value_array() {
 
 const Bit_Set_256 EMPTY_BIT_SET_256 = {{0}};
 
+// The set operations work on the 32 bytes as 4 64-bit words, where bit n
+// of the set is bit n%64 of word n/64.  On little-endian hosts this is
+// simply the bytes reinterpreted.  Loops over the 4 words are short enough
+// that the compiler unrolls and, where available, vectorizes them.
+
+static inline uint64_t bs256_word(const Bit_Set_256 * bitset, int wordndx) {
+   uint64_t w;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+   memcpy(&w, bitset->bytes + 8*wordndx, 8);
+#else
+   w = 0;
+   for (int ndx = 7; ndx >= 0; ndx--)
+      w = (w << 8) | bitset->bytes[8*wordndx + ndx];
+#endif
+   return w;
+}
+
 /** Sets a flag in a #Bit_Set_256
  *
  *  @param  flags   existing #Bit_Set_256 value
@@ -948,14 +1122,37 @@ bool bs256_contains(
 int bs256_first_bit_set(
       Bit_Set_256 bitset)
 {
-   int result = -1;
-   for (int ndx = 0; ndx < 256; ndx++) {
-      if (bs256_contains(bitset, ndx)) {
-         result = ndx;
-         break;
-      }
+   return bs256_next_bit_set(&bitset, -1);
+}
+
+
+/** Returns the number of the first bit set after a given bit.
+ *
+ *  This is the fast way to iterate over a #Bit_Set_256, no iterator
+ *  needs to be allocated:
+ *  @code
+ *  for (int bitno = bs256_next_bit_set(&set, -1); bitno >= 0; bitno = bs256_next_bit_set(&set, bitno))
+ *  @endcode
+ *
+ *  @param  bitset  pointer to #Bit_Set_256 to check
+ *  @param  lastpos bit number after which to start, -1 to start at bit 0
+ *  @return number of next bit that is set, -1 if none
+ */
+int bs256_next_bit_set(
+      const Bit_Set_256 * bitset,
+      int                 lastpos)
+{
+   int pos = lastpos + 1;
+   if (pos < 0 || pos >= 256)
+      return -1;
+   int wordndx = pos >> 6;
+   uint64_t w = bs256_word(bitset, wordndx) & (~(uint64_t)0 << (pos & 63));
+   while (!w) {
+      if (++wordndx == 4)
+         return -1;
+      w = bs256_word(bitset, wordndx);
    }
-   return result;
+   return (wordndx << 6) + __builtin_ctzll(w);
 }
 
 
@@ -971,10 +1168,13 @@ Bit_Set_256 bs256_or(
    Bit_Set_256 set1,
    Bit_Set_256 set2)
 {
+   uint64_t w1[4], w2[4];
+   memcpy(w1, set1.bytes, 32);
+   memcpy(w2, set2.bytes, 32);
+   for (int ndx = 0; ndx < 4; ndx++)
+      w1[ndx] |= w2[ndx];
    Bit_Set_256 result;
-   for (int ndx = 0; ndx < 32; ndx++) {
-      result.bytes[ndx] =  set1.bytes[ndx] | set2.bytes[ndx];
-   }
+   memcpy(result.bytes, w1, 32);
    return result;
 }
 
@@ -983,10 +1183,13 @@ Bit_Set_256 bs256_and(
    Bit_Set_256 set1,
    Bit_Set_256 set2)
 {
+   uint64_t w1[4], w2[4];
+   memcpy(w1, set1.bytes, 32);
+   memcpy(w2, set2.bytes, 32);
+   for (int ndx = 0; ndx < 4; ndx++)
+      w1[ndx] &= w2[ndx];
    Bit_Set_256 result;
-   for (int ndx = 0; ndx < 32; ndx++) {
-      result.bytes[ndx] =  set1.bytes[ndx] & set2.bytes[ndx];
-   }
+   memcpy(result.bytes, w1, 32);
    return result;
 }
 
@@ -995,10 +1198,13 @@ Bit_Set_256 bs256_and_not(
       Bit_Set_256 set2)
 {
    // DBGMSG("Starting. vcplist1=%p, vcplist2=%p", vcplist1, vcplist2);
+   uint64_t w1[4], w2[4];
+   memcpy(w1, set1.bytes, 32);
+   memcpy(w2, set2.bytes, 32);
+   for (int ndx = 0; ndx < 4; ndx++)
+      w1[ndx] &= ~w2[ndx];
    Bit_Set_256 result;
-   for (int ndx = 0; ndx < 32; ndx++) {
-      result.bytes[ndx] =  set1.bytes[ndx] & ~set2.bytes[ndx];
-   }
+   memcpy(result.bytes, w1, 32);
 
    // char * s = ddca_bs256_string(&result, "0x",", ");
    // DBGMSG("Returning: %s", s);
@@ -1042,16 +1248,11 @@ int bs256_count(
 {
    bool debug = false;
 
-   int result = 0;
-   int flagndx;
-   int bitndx;
-   for (flagndx=0; flagndx < 32; flagndx++) {
-      for (bitndx = 0; bitndx < 8; bitndx++) {
-         unsigned char flagbit = (0x80 >> bitndx);
-         if (bbset.bytes[flagndx] & flagbit)
-            result += 1;
-      }
-   }
+   // byte order within the words is irrelevant for counting
+   uint64_t words[4];
+   memcpy(words, bbset.bytes, 32);
+   int result = __builtin_popcountll(words[0]) + __builtin_popcountll(words[1]) +
+                __builtin_popcountll(words[2]) + __builtin_popcountll(words[3]);
    if (debug) {
       char buf[BB256_REPR_BUF_SZ];
       bb256_repr(buf, sizeof(buf), bbset);
@@ -1060,27 +1261,6 @@ int bs256_count(
    return result;
 }
 
-#ifdef COMPILE_ERRORS
-int bs256_count(
-      Bit_Set_256 bbset)
-{
-   // regard the array of 32 bytes as an array of 8 4-byte unsigned integers
-   uint64_t  list2 = (uint64_t) bbset.bytes;
-   unsigned int ct = 0;
-   for (int ndx = 0; ndx < 4; ndx++) {
-      // clever algorithm for counting number of bits per Brian Kernihgan
-      uint64_t v = list2[ndx];
-      for (; v; ct++) {
-        v &= v - 1; // clear the least significant bit set
-      }
-      // DBGMSG("feature_list_count() returning: %d", ct);
-   }
-// #ifdef OLD
-   assert(ct == bs256_count0(bbset));
-// #endif
-   return ct;
-}
-#endif
 
 /** Returns a string representation of a #Bit_Set_256 as a list of hex numbers.
  *
@@ -1132,13 +1312,12 @@ bs256_to_string_general(
    // printf("(%s) feature_ct=%d, vsize=%d, buf size = %d",
    //          __func__, feature_ct, vsize, vsize*feature_ct);
 
-   for (int ndx = 0; ndx < 256; ndx++) {
-      if ( bs256_contains(bitset, ndx) ) {
-         if (decimal_format)
-            sprintf(buf + strlen(buf), "%s%d%s", value_prefix, ndx, sepstr);
-         else
-            sprintf(buf + strlen(buf), "%s%02x%s", value_prefix, ndx, sepstr);
-      }
+   char * end = buf;
+   for (int ndx = bs256_next_bit_set(&bitset, -1); ndx >= 0; ndx = bs256_next_bit_set(&bitset, ndx)) {
+      if (decimal_format)
+         end += sprintf(end, "%s%d%s", value_prefix, ndx, sepstr);
+      else
+         end += sprintf(end, "%s%02x%s", value_prefix, ndx, sepstr);
    }
 
    if (bit_ct > 0)
@@ -1203,16 +1382,10 @@ int bs256_to_bytes(Bit_Set_256 flags, Byte * buffer, int buflen) {
 #endif
 
    unsigned int bufpos = 0;
-   unsigned int flagno = 0;
    // printf("(%s) bs256lags->byte=0x%s\n", __func__, hexstring(flags->byte,32));
-   for (flagno = 0; flagno < 256; flagno++) {
-      Byte flg = (Byte) flagno;
-      // printf("(%s) flagno=%d, flg=0x%02x\n", __func__, flagno, flg);
-      if (bs256_contains(flags, flg)) {
-         // printf("(%s) Flag is set: %d, 0x%02x\n", __func__, flagno, flg);
-         buffer[bufpos++] = flg;
-      }
-   }
+   int bitno;
+   for (bitno = bs256_next_bit_set(&flags, -1); bitno >= 0; bitno = bs256_next_bit_set(&flags, bitno))
+      buffer[bufpos++] = (Byte) bitno;
    // printf("(%s) Done.  Returning: %d\n", __func__, bupos);
    return bufpos;
 }
@@ -1228,13 +1401,8 @@ int bs256_to_bytes(Bit_Set_256 flags, Byte * buffer, int buflen) {
 Buffer * bs256_to_buffer(Bit_Set_256 flags) {
    int bit_set_ct = bs256_count(flags);
    Buffer * buf = buffer_new(bit_set_ct, __func__);
-   for (unsigned int flagno = 0; flagno < 256; flagno++) {
-      Byte flg = (Byte) flagno;
-      // printf("(%s) flagno=%d, flg=0x%02x\n", __func__, flagno, flg);
-      if (bs256_contains(flags, flg)) {
-         buffer_add(buf, flg);
-      }
-   }
+   for (int bitno = bs256_next_bit_set(&flags, -1); bitno >= 0; bitno = bs256_next_bit_set(&flags, bitno))
+      buffer_add(buf, (Byte) bitno);
    // printf("(%s) Done.  Returning: %s\n", __func__, buffer);
    return buf;
 }
@@ -1308,14 +1476,9 @@ bs256_iter_next(
    assert( iter && memcmp(iter->marker, BS256_ITER_MARKER, 4) == 0);
    // printf("(%s) Starting. lastpos = %d\n", __func__, iter->lastpos);
 
-   int result = -1;
-   for (int ndx = iter->lastpos + 1; ndx < 256; ndx++) {
-      if (bs256_contains(iter->bbflags, ndx)) {
-         result = ndx;
-         iter->lastpos = ndx;
-         break;
-      }
-   }
+   int result = bs256_next_bit_set(&iter->bbflags, iter->lastpos);
+   if (result >= 0)
+      iter->lastpos = result;
    // printf("(%s) Returning: %d\n", __func__, result);
    return result;
 }
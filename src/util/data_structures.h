@@ -183,6 +183,7 @@ bool           bs256_eq(Bit_Set_256 set1, Bit_Set_256 set2);
 int            bs256_count(Bit_Set_256 set);
 bool           bs256_contains(Bit_Set_256 flags, uint8_t val);
 int            bs256_first_bit_set(Bit_Set_256 bitset);
+int            bs256_next_bit_set(const Bit_Set_256 * bitset, int lastpos);
 Bit_Set_256    bs256_insert(Bit_Set_256 flags, uint8_t val);
 
 Bit_Set_256    bs256_or(Bit_Set_256 set1, Bit_Set_256 set2);         // union
@@ -15,6 +15,8 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <wordexp.h>
 
 #include "debug_util.h"
@@ -25,6 +27,34 @@
 #include "ddcutil_config_file.h"
 
 
+/** Characters that wordexp() gives special meaning.
+ *  '#' is included since it starts a comment at the beginning of a word.
+ */
+static const char * wordexp_special_chars = "|&;<>(){}$`\\\"'*?[]~#\n";
+
+
+/** Splits a string on blanks and tabs, for strings containing nothing
+ *  that wordexp() would expand or reject.
+ *
+ *  \param  string     string to tokenize
+ *  \param  tokens_loc where to return the address of a null-terminated list of tokens
+ *  \return number of tokens
+ */
+static int tokenize_simple_options_line(const char * string, char *** tokens_loc) {
+   char ** tokens = g_strsplit_set(string, " \t", -1);
+   int ct = 0;
+   for (int ndx = 0; tokens[ndx]; ndx++) {
+      if (*tokens[ndx])
+         tokens[ct++] = tokens[ndx];
+      else
+         free(tokens[ndx]);
+   }
+   tokens[ct] = NULL;
+   *tokens_loc = tokens;
+   return ct;
+}
+
+
 /** Tokenize a string as per the command line
  *
  *  \param  string to tokenize
@@ -33,11 +63,24 @@
  *
  *  \remark
  *  The caller is responsible for freeing the list of tokens
+ *  \remark
+ *  wordexp() is only used if the string contains quotes, variable
+ *  references, or other characters it handles specially.  Typical option
+ *  strings are simply split on whitespace.
  */
 int tokenize_options_line(char * string, char ***tokens_loc) {
    bool debug = false;
    if (debug)
       printf("(%s) string -> |%s|\n", __func__, string);
+   if (!strpbrk(string, wordexp_special_chars)) {
+      int ct = tokenize_simple_options_line(string, tokens_loc);
+      if (debug) {
+         printf("(%s) Tokens:\n", __func__);
+         ntsa_show(*tokens_loc);
+         printf("(%s) Returning: %d\n", __func__, ct);
+      }
+      return ct;
+   }
    wordexp_t p;
    int flags = WRDE_NOCMD;
    if (debug)
@@ -55,6 +98,76 @@ int tokenize_options_line(char * string, char ***tokens_loc) {
 }
 
 
+//
+// Cache of the most recently processed configuration file
+//
+// libddcutil and ddcui can process the configuration file more than once in
+// a process.  The combined option string and its tokens are saved, and
+// reused as long as the file's modification time and size are unchanged.
+// Loads that reported errors are not cached, so that the errors are
+// reported each time.
+//
+
+typedef struct {
+   char *          application;
+   char *          config_fn;
+   struct timespec mtime;
+   off_t           size;
+   char *          combined_options;
+   char **         tokens;          // NULL until first tokenized
+   int             token_ct;
+} Config_File_Cache;
+
+static Config_File_Cache config_cache;
+static GMutex            config_cache_mutex;
+
+
+static void clear_config_cache() {
+   free(config_cache.application);
+   free(config_cache.config_fn);
+   free(config_cache.combined_options);
+   if (config_cache.tokens)
+      ntsa_free(config_cache.tokens, true);
+   memset(&config_cache, 0, sizeof(config_cache));
+}
+
+
+// must be called with config_cache_mutex held
+static bool config_cache_matches(
+      const char *        application,
+      const char *        config_fn,
+      const struct stat * statbuf)
+{
+   return config_cache.config_fn                                   &&
+          streq(config_cache.application, application)             &&
+          streq(config_cache.config_fn,   config_fn)               &&
+          config_cache.mtime.tv_sec  == statbuf->st_mtim.tv_sec    &&
+          config_cache.mtime.tv_nsec == statbuf->st_mtim.tv_nsec   &&
+          config_cache.size          == statbuf->st_size;
+}
+
+
+/** Returns a copy of the tokens for a combined option string, using the
+ *  tokens saved in the cache if the string is the one cached.
+ */
+static int get_options_tokens(char * combined_options, char *** tokens_loc) {
+   int ct = -1;
+   g_mutex_lock(&config_cache_mutex);
+   if (config_cache.combined_options && streq(config_cache.combined_options, combined_options)) {
+      if (!config_cache.tokens)
+         config_cache.token_ct = tokenize_options_line(combined_options, &config_cache.tokens);
+      if (config_cache.tokens) {
+         *tokens_loc = ntsa_copy(config_cache.tokens, true);
+         ct = config_cache.token_ct;
+      }
+   }
+   g_mutex_unlock(&config_cache_mutex);
+   if (ct < 0)
+      ct = tokenize_options_line(combined_options, tokens_loc);
+   return ct;
+}
+
+
 /** Processes a ddcutil configuration file, returning an options string obtained
  *  both the global and applictation-specific sections of the configuration file.nd
  *
@@ -70,6 +183,10 @@ int tokenize_options_line(char * string, char ***tokens_loc) {
  *  \retval < 0                     other error
  *
  *  An untokenized option string is returned iff rc == 0.
+ *
+ *  \remark
+ *  If the configuration file is unchanged since it was last read,
+ *  the option string is taken from the cache instead of reparsing the file.
  */
 int read_ddcutil_config_file(
       const char *   ddcutil_application,
@@ -100,6 +217,21 @@ int read_ddcutil_config_file(
       printf("(%s) Found configuration file: %s\n", __func__, config_fn);
    *config_fn_loc = config_fn;
 
+   struct stat statbuf;
+   bool have_stat = (stat(config_fn, &statbuf) == 0);
+   if (have_stat) {
+      g_mutex_lock(&config_cache_mutex);
+      if (config_cache_matches(ddcutil_application, config_fn, &statbuf))
+         *untokenized_option_string_loc = strdup(config_cache.combined_options);
+      g_mutex_unlock(&config_cache_mutex);
+      if (*untokenized_option_string_loc) {
+         if (debug)
+            printf("(%s) Using cached options for unchanged %s\n", __func__, config_fn);
+         goto bye;
+      }
+   }
+
+   int errmsg_ct_before = (errmsgs) ? errmsgs->len : 0;
    Parsed_Ini_File * ini_file = NULL;
    int load_rc = ini_file_load(config_fn, errmsgs, verbose, &ini_file);
    ASSERT_IFF(load_rc==0, ini_file);
@@ -131,6 +263,17 @@ int read_ddcutil_config_file(
 
       *untokenized_option_string_loc = combined_options;
       ini_file_free(ini_file);
+
+      if (have_stat && (!errmsgs || errmsgs->len == errmsg_ct_before)) {
+         g_mutex_lock(&config_cache_mutex);
+         clear_config_cache();
+         config_cache.application      = strdup(ddcutil_application);
+         config_cache.config_fn        = strdup(config_fn);
+         config_cache.mtime            = statbuf.st_mtim;
+         config_cache.size             = statbuf.st_size;
+         config_cache.combined_options = strdup(combined_options);
+         g_mutex_unlock(&config_cache_mutex);
+      }
    }
    else
       result = load_rc;
@@ -282,7 +425,7 @@ int apply_config_file(
    else {
       char ** cmd_prefix_tokens = NULL;
       int prefix_token_ct =
-            tokenize_options_line(*untokenized_config_options_loc, &cmd_prefix_tokens);
+            get_options_tokens(*untokenized_config_options_loc, &cmd_prefix_tokens);
 
       DBGF(debug, "prefix_token_ct = %d, cmd_prefix_tokens: ", prefix_token_ct);
       if (debug)
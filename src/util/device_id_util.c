@@ -11,6 +11,7 @@
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <glib-2.0/glib.h>
 #include <limits.h>
 #include <linux/limits.h>
@@ -18,6 +19,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -27,6 +29,7 @@
 #include "multi_level_map.h"
 #include "report_util.h"
 #include "string_util.h"
+#include "xdg_util.h"
 
 #include "device_id_util.h"
 
@@ -151,6 +154,8 @@ static void report_simple_id_table(Simple_Id_Table * simple_table, int depth) {
 
 static char * get_simple_id_name(Simple_Id_Table * simple_table, ushort id) {
    char * result = NULL;
+   if (!simple_table)
+      return NULL;
    for (int ndx = 0; ndx < simple_table->len; ndx++) {
       Simple_Id_Table_Entry * cur_entry = g_ptr_array_index(simple_table, ndx);
       if (cur_entry->id == id) {
@@ -682,12 +687,290 @@ static void load_file_lines(Device_Id_Type id_type, GPtrArray * all_lines) {
       }
    }
 
+   if (pci_vendors_mlm)
+      mlm_sort_children(pci_vendors_mlm);
+   if (usb_vendors_mlm)
+      mlm_sort_children(usb_vendors_mlm);
+   if (hid_usages_table)
+      mlm_sort_children(hid_usages_table);
+
    if (debug)
       printf("(%s) Done.  id_type=%d\n", __func__, id_type);
 }
 
 
-/* Locates a pci.ids or usb.ids file and loads its contents into internal tables.
+//
+// *** Binary Index ***
+//
+// Parsing the text pci.ids and usb.ids files is by far the most expensive
+// part of initialization.  Once a file has been parsed, the tables are
+// written to a binary index file in the XDG cache directory, e.g.
+// $HOME/.cache/ddcutil/usb.ids.idx.  Subsequent executions mmap the index
+// and look up names by binary search, without reading the text file.
+// The index is rebuilt when the modification time or size of the text file
+// changes.
+//
+// Layout: header, array of entries sorted by table and codes, string area.
+//
+
+#define DEVID_INDEX_MAGIC "DDCIDX01"
+
+typedef struct {
+   char      magic[8];
+   int64_t   source_mtime_sec;
+   int64_t   source_mtime_nsec;
+   int64_t   source_size;
+   uint32_t  entry_ct;
+   uint32_t  strings_size;
+} Devid_Index_Header;
+
+/** Tables within a device id index */
+typedef enum {
+   DIT_PCI,          ///< vendor, device, subvendor<<16|subdevice
+   DIT_USB,          ///< vendor, product, interface
+   DIT_HUT,          ///< usage page, usage id
+   DIT_HID,          ///< HID descriptor type
+   DIT_R,            ///< HID descriptor item type
+   DIT_HCC           ///< HID country code
+} Devid_Index_Table;
+
+typedef struct {
+   uint8_t   table;          ///< Devid_Index_Table
+   uint8_t   levels;         ///< number of codes used
+   uint16_t  unused;
+   uint32_t  codes[3];
+   uint32_t  name_offset;    ///< offset of name in string area
+} Devid_Index_Entry;
+
+typedef struct {
+   void *                    map;
+   size_t                    map_size;
+   const Devid_Index_Entry * entries;
+   uint32_t                  entry_ct;
+   const char *              strings;
+} Devid_Index;
+
+static Devid_Index * devid_indexes[2];     // indexed by Device_Id_Type
+
+
+static int compare_devid_index_entries(const void * p1, const void * p2) {
+   const Devid_Index_Entry * e1 = p1;
+   const Devid_Index_Entry * e2 = p2;
+   if (e1->table != e2->table)
+      return (e1->table < e2->table) ? -1 : 1;
+   if (e1->levels != e2->levels)
+      return (e1->levels < e2->levels) ? -1 : 1;
+   for (int ndx = 0; ndx < e1->levels; ndx++) {
+      if (e1->codes[ndx] != e2->codes[ndx])
+         return (e1->codes[ndx] < e2->codes[ndx]) ? -1 : 1;
+   }
+   return 0;
+}
+
+
+/* Gets the names for a sequence of codes in one table of a device id index,
+ * with the same semantics as mlm_get_names2().
+ */
+static Multi_Level_Names
+devid_index_get_names(Devid_Index * index, Devid_Index_Table table, int levelct, uint * ids) {
+   assert(levelct >= 1 && levelct <= 3);
+   Multi_Level_Names result = {0};
+   Devid_Index_Entry key = {.table = table};
+   for (int level = 1; level <= levelct; level++) {
+      key.levels = level;
+      key.codes[level-1] = ids[level-1];
+      const Devid_Index_Entry * found =
+            bsearch(&key, index->entries, index->entry_ct,
+                    sizeof(Devid_Index_Entry), compare_devid_index_entries);
+      if (!found)
+         break;
+      result.levels = level;
+      result.names[level-1] = (char *) index->strings + found->name_offset;
+   }
+   return result;
+}
+
+
+/* Returns the name of the index file for a pci.ids or usb.ids file,
+ * caller must free.
+ */
+static char * devid_index_fn(Device_Id_Type id_type) {
+   char * simple_fn = g_strdup_printf("%s.idx", simple_device_fn[id_type]);
+   char * result = xdg_cache_home_file("ddcutil", simple_fn);
+   g_free(simple_fn);
+   return result;
+}
+
+
+/* Maps an index file, if it exists and was built from the current version
+ * of the text file.
+ *
+ * Arguments:
+ *    id_type
+ *    source_stat    stat of text file
+ *
+ * Returns:          pointer to Devid_Index, NULL if the index cannot be used
+ */
+static Devid_Index *
+devid_index_load(Device_Id_Type id_type, struct stat * source_stat) {
+   bool debug = false;
+   Devid_Index * result = NULL;
+   char * index_fn = devid_index_fn(id_type);
+   int fd = (index_fn) ? open(index_fn, O_RDONLY|O_CLOEXEC) : -1;
+   if (fd >= 0) {
+      struct stat index_stat;
+      void * map = MAP_FAILED;
+      if (fstat(fd, &index_stat) == 0 && index_stat.st_size > sizeof(Devid_Index_Header))
+         map = mmap(NULL, index_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (map != MAP_FAILED) {
+         const Devid_Index_Header * hdr = map;
+         size_t expected_size = sizeof(Devid_Index_Header) +
+                                (size_t) hdr->entry_ct * sizeof(Devid_Index_Entry) +
+                                hdr->strings_size;
+         const char * strings = (char *) map + sizeof(Devid_Index_Header) +
+                                (size_t) hdr->entry_ct * sizeof(Devid_Index_Entry);
+         if (memcmp(hdr->magic, DEVID_INDEX_MAGIC, 8) == 0               &&
+             hdr->source_mtime_sec  == source_stat->st_mtim.tv_sec       &&
+             hdr->source_mtime_nsec == source_stat->st_mtim.tv_nsec      &&
+             hdr->source_size       == source_stat->st_size              &&
+             expected_size          == index_stat.st_size                &&
+             hdr->strings_size > 0 && strings[hdr->strings_size-1] == '\0')
+         {
+            result = calloc(1, sizeof(Devid_Index));
+            result->map      = map;
+            result->map_size = index_stat.st_size;
+            result->entries  = (Devid_Index_Entry *) ((char *) map + sizeof(Devid_Index_Header));
+            result->entry_ct = hdr->entry_ct;
+            result->strings  = strings;
+         }
+         else
+            munmap(map, index_stat.st_size);
+      }
+   }
+   if (debug)
+      printf("(%s) index_fn=%s, returning %p\n", __func__, index_fn, (void*) result);
+   free(index_fn);
+   return result;
+}
+
+
+static void
+devid_index_add(GArray * entries, GByteArray * strings,
+                Devid_Index_Table table, int levels, uint * codes, char * name)
+{
+   Devid_Index_Entry entry = {.table = table, .levels = levels};
+   for (int ndx = 0; ndx < levels; ndx++)
+      entry.codes[ndx] = codes[ndx];
+   entry.name_offset = strings->len;
+   g_byte_array_append(strings, (guint8 *) name, strlen(name)+1);
+   g_array_append_val(entries, entry);
+}
+
+
+static void
+devid_index_add_mlm_nodes(GArray * entries, GByteArray * strings,
+                          Devid_Index_Table table, GPtrArray * nodes, int level, uint * codes)
+{
+   if (!nodes || level > 3)
+      return;
+   for (int ndx = 0; ndx < nodes->len; ndx++) {
+      MLM_Node * node = g_ptr_array_index(nodes, ndx);
+      codes[level-1] = node->code;
+      devid_index_add(entries, strings, table, level, codes, node->name);
+      devid_index_add_mlm_nodes(entries, strings, table, node->children, level+1, codes);
+   }
+}
+
+
+static void
+devid_index_add_simple_table(GArray * entries, GByteArray * strings,
+                             Devid_Index_Table table, Simple_Id_Table * simple_table)
+{
+   if (!simple_table)
+      return;
+   for (int ndx = 0; ndx < simple_table->len; ndx++) {
+      Simple_Id_Table_Entry * cur_entry = g_ptr_array_index(simple_table, ndx);
+      uint code = cur_entry->id;
+      devid_index_add(entries, strings, table, 1, &code, cur_entry->name);
+   }
+}
+
+
+/* Writes the index file for the tables loaded from a text file.
+ * Failure to write the index is not an error, the text file is simply
+ * parsed again next time.
+ *
+ * Arguments:
+ *    id_type
+ *    source_stat    stat of text file
+ */
+static void
+devid_index_save(Device_Id_Type id_type, struct stat * source_stat) {
+   bool debug = false;
+   GArray *     entries = g_array_sized_new(false, false, sizeof(Devid_Index_Entry), 30000);
+   GByteArray * strings = g_byte_array_sized_new(30000*24);
+   uint codes[3] = {0};
+   if (id_type == ID_TYPE_PCI) {
+      devid_index_add_mlm_nodes(entries, strings, DIT_PCI, pci_vendors_mlm->root, 1, codes);
+   }
+   else {
+      devid_index_add_mlm_nodes(entries, strings, DIT_USB, usb_vendors_mlm->root, 1, codes);
+      if (hid_usages_table)
+         devid_index_add_mlm_nodes(entries, strings, DIT_HUT, hid_usages_table->root, 1, codes);
+      devid_index_add_simple_table(entries, strings, DIT_HID, hid_descriptor_types);
+      devid_index_add_simple_table(entries, strings, DIT_R,   hid_descriptor_item_types);
+      devid_index_add_simple_table(entries, strings, DIT_HCC, hid_country_codes);
+   }
+   g_array_sort(entries, compare_devid_index_entries);
+
+   Devid_Index_Header hdr = {0};
+   memcpy(hdr.magic, DEVID_INDEX_MAGIC, 8);
+   hdr.source_mtime_sec  = source_stat->st_mtim.tv_sec;
+   hdr.source_mtime_nsec = source_stat->st_mtim.tv_nsec;
+   hdr.source_size       = source_stat->st_size;
+   hdr.entry_ct          = entries->len;
+   hdr.strings_size      = strings->len;
+
+   // write to a temporary file and rename, so a concurrent reader never
+   // sees a partial index
+   char * index_fn = devid_index_fn(id_type);
+   char * tmp_fn = (index_fn) ? g_strdup_printf("%s.%d", index_fn, getpid()) : NULL;
+   FILE * fp = NULL;
+   if (tmp_fn && fopen_mkdir(tmp_fn, "w", NULL, &fp) == 0) {
+      bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1                                &&
+                fwrite(entries->data, sizeof(Devid_Index_Entry), entries->len, fp)
+                      == entries->len                                                &&
+                fwrite(strings->data, 1, strings->len, fp) == strings->len;
+      ok = (fclose(fp) == 0) && ok;
+      if (!ok || rename(tmp_fn, index_fn) != 0)
+         unlink(tmp_fn);
+      if (debug)
+         printf("(%s) Wrote %s, %d entries, ok=%s\n", __func__, index_fn, entries->len, sbool(ok));
+   }
+   g_free(tmp_fn);
+   free(index_fn);
+   g_array_free(entries, true);
+   g_byte_array_free(strings, true);
+}
+
+
+/* Gets the name for an id in one of the simple tables in usb.ids, using
+ * the index if it has been mapped.
+ */
+static char *
+lookup_simple_id_name(Simple_Id_Table * simple_table, Devid_Index_Table table, ushort id) {
+   if (devid_indexes[ID_TYPE_USB]) {
+      uint ids[1] = {id};
+      Multi_Level_Names names = devid_index_get_names(devid_indexes[ID_TYPE_USB], table, 1, ids);
+      return names.names[0];
+   }
+   return get_simple_id_name(simple_table, id);
+}
+
+
+/* Locates a pci.ids or usb.ids file and loads its contents into internal tables,
+ * or maps the binary index built from the file.
  *
  * Arguments:
  *    id_type
@@ -700,7 +983,15 @@ static void load_id_file(Device_Id_Type id_type){
       printf("(%s) id_type=%d\n", __func__, id_type);
 
    char * device_id_fqfn = devid_find_file(id_type);
-   if (device_id_fqfn) {
+   struct stat source_stat;
+   if (device_id_fqfn && stat(device_id_fqfn, &source_stat) == 0 &&
+       (devid_indexes[id_type] = devid_index_load(id_type, &source_stat)) )
+   {
+      if (debug)
+         printf("(%s) Using index for %s\n", __func__, device_id_fqfn);
+      free(device_id_fqfn);
+   }
+   else if (device_id_fqfn) {
       // char device_id_fqfn[MAX_PATH];
       // snprintf(device_id_fqfn, MAX_PATH, id_fqfn, id_fn);  // ???
       if (debug)
@@ -710,6 +1001,8 @@ static void load_id_file(Device_Id_Type id_type){
       int linect = file_getlines(device_id_fqfn, all_lines, true);
       if (linect > 0) {
          load_file_lines(id_type, all_lines);
+         if (stat(device_id_fqfn, &source_stat) == 0)
+            devid_index_save(id_type, &source_stat);
       }       // if (all_lines)
       // to do: call
 
@@ -758,6 +1051,10 @@ static void load_id_file(Device_Id_Type id_type){
  */
 void report_device_ids_mlm(Device_Id_Type id_type) {
    Multi_Level_Map * all_devices = (id_type == ID_TYPE_PCI) ? pci_vendors_mlm : usb_vendors_mlm;
+   if (!all_devices) {
+      printf("(%s) Device ids loaded from binary index\n", __func__);
+      return;
+   }
    GPtrArray * top_level_nodes = all_devices->root;
    int total_vendors = 0;
    int total_devices = 0;
@@ -834,7 +1131,9 @@ Pci_Usb_Id_Names devid_get_pci_names(
    devid_ensure_initialized();
    uint ids[3] = {vendor_id, device_id, subvendor_id << 16 | subdevice_id};   // only diff from usb_id_get_names
    int levelct = (argct == 4) ? 3 : argct;              // also this
-   Multi_Level_Names mlm_names =  mlm_get_names2(pci_vendors_mlm, levelct, ids);  // and this
+   Multi_Level_Names mlm_names = (devid_indexes[ID_TYPE_PCI])
+         ? devid_index_get_names(devid_indexes[ID_TYPE_PCI], DIT_PCI, levelct, ids)
+         : mlm_get_names2(pci_vendors_mlm, levelct, ids);  // and this
    Pci_Usb_Id_Names names2;
    names2.vendor_name = mlm_names.names[0];
    names2.device_name = mlm_names.names[1];
@@ -842,7 +1141,9 @@ Pci_Usb_Id_Names devid_get_pci_names(
    if (levelct == 3 && mlm_names.levels == 2) {
       // couldn't find the subsystem, see if at least we can look up the subsystem vendor
       uint ids[1] = {subvendor_id};
-      Multi_Level_Names mlm_names3 = mlm_get_names2(pci_vendors_mlm, 1, ids);
+      Multi_Level_Names mlm_names3 = (devid_indexes[ID_TYPE_PCI])
+            ? devid_index_get_names(devid_indexes[ID_TYPE_PCI], DIT_PCI, 1, ids)
+            : mlm_get_names2(pci_vendors_mlm, 1, ids);
       if (mlm_names3.levels == 1) {
          names2.subsys_or_interface_name = mlm_names3.names[0];
       }
@@ -884,7 +1185,9 @@ Pci_Usb_Id_Names devid_get_usb_names(
    assert( argct==1 || argct==2 || argct==3);
    devid_ensure_initialized();
    uint ids[3] = {vendor_id, device_id, interface_id};
-   Multi_Level_Names mlm_names =  mlm_get_names2(usb_vendors_mlm, argct, ids);
+   Multi_Level_Names mlm_names = (devid_indexes[ID_TYPE_USB])
+         ? devid_index_get_names(devid_indexes[ID_TYPE_USB], DIT_USB, argct, ids)
+         : mlm_get_names2(usb_vendors_mlm, argct, ids);
    Pci_Usb_Id_Names names2;
    names2.vendor_name = mlm_names.names[0];
    names2.device_name = mlm_names.names[1];
@@ -926,7 +1229,10 @@ char * devid_usage_code_page_name(ushort usage_page_code) {
       result = "Vendor-defined";
    else {
       // ushort * args = {usage_page_code};
-      Multi_Level_Names names_found = mlm_get_names(hid_usages_table, /*argct=*/ 1, usage_page_code);
+      uint ids[1] = {usage_page_code};
+      Multi_Level_Names names_found = (devid_indexes[ID_TYPE_USB])
+            ? devid_index_get_names(devid_indexes[ID_TYPE_USB], DIT_HUT, 1, ids)
+            : mlm_get_names(hid_usages_table, /*argct=*/ 1, usage_page_code);
       if (names_found.levels == 1)
          result = names_found.names[0];
    }
@@ -960,7 +1266,10 @@ char * devid_usage_code_id_name(ushort usage_page_code, ushort usage_simple_id)
    }
    else {
       // ushort * args = {usage_page_code, usage_simple_id};
-      Multi_Level_Names names_found = mlm_get_names(hid_usages_table, 2, usage_page_code, usage_simple_id);
+      uint ids[2] = {usage_page_code, usage_simple_id};
+      Multi_Level_Names names_found = (devid_indexes[ID_TYPE_USB])
+            ? devid_index_get_names(devid_indexes[ID_TYPE_USB], DIT_HUT, 2, ids)
+            : mlm_get_names(hid_usages_table, 2, usage_page_code, usage_simple_id);
       if (names_found.levels == 2)
          result = names_found.names[1];
    }
@@ -995,7 +1304,7 @@ char * devid_usage_code_name_by_extended_id(uint32_t extended_usage) {
 char * devid_hid_descriptor_item_type(ushort id) {
    devid_ensure_initialized();
    char * result = NULL;
-   result = get_simple_id_name(hid_descriptor_item_types, id);
+   result = lookup_simple_id_name(hid_descriptor_item_types, DIT_R, id);
    return result;
 }
 
@@ -1004,7 +1313,7 @@ char * devid_hid_descriptor_item_type(ushort id) {
 char * devid_hid_descriptor_type(ushort id) {
    devid_ensure_initialized();
    char * result = NULL;
-   result = get_simple_id_name(hid_descriptor_types, id);
+   result = lookup_simple_id_name(hid_descriptor_types, DIT_HID, id);
    return result;
 }
 
@@ -1012,7 +1321,7 @@ char * devid_hid_descriptor_type(ushort id) {
 char * devid_hid_descriptor_country_code(ushort id) {
    devid_ensure_initialized();
    char * result = NULL;
-   result = get_simple_id_name(hid_country_codes, id);
+   result = lookup_simple_id_name(hid_country_codes, DIT_HCC, id);
    return result;
 }
 
@@ -1029,7 +1338,8 @@ bool devid_ensure_initialized() {
    if (debug)
       printf("(%s) Starting. pci_vendors_mlm=%p, usb_vendors_mlm=%p\n",
              __func__, (void*)pci_vendors_mlm, (void*)usb_vendors_mlm);
-   bool ok = (pci_vendors_mlm && usb_vendors_mlm);
+   bool ok = ( (pci_vendors_mlm || devid_indexes[ID_TYPE_PCI]) &&
+               (usb_vendors_mlm || devid_indexes[ID_TYPE_USB]) );
 
    if (!ok) {
       if (debug)
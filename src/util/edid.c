@@ -15,11 +15,13 @@
 
 /** \cond */
 #include <assert.h>
+#include <glib-2.0/glib.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 /** \endcond */
 
+#include "alloc_stats.h"
 #include "pnp_ids.h"
 #include "report_util.h"
 #include "string_util.h"
@@ -205,7 +207,46 @@ static void get_edid_descriptor_strings(
 }
 
 
+// FNV-1a
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME        1099511628211ULL
+
+static uint64_t fnv1a(uint64_t hash, const void * data, int len) {
+   const Byte * bytes = data;
+   for (int ndx = 0; ndx < len; ndx++)
+      hash = (hash ^ bytes[ndx]) * FNV_PRIME;
+   return hash;
+}
+
+
+/** Returns a 64 bit hash of the 128 bytes of an EDID.
+ *
+ * @param edidbytes   pointer to 128 byte EDID block
+ * @return hash value, equal to #Parsed_Edid.bytes_hash for the EDID
+ */
+uint64_t edid_bytes_hash(const Byte * edidbytes) {
+   return fnv1a(FNV_OFFSET_BASIS, edidbytes, 128);
+}
+
+
+// Hash of the fields that identify a monitor, i.e. those compared when
+// deciding if two EDIDs describe the same monitor.  EDIDs that identify the
+// same monitor can differ in other bytes.
+static uint64_t edid_ids_hash(Parsed_Edid * edid) {
+   uint64_t hash = FNV_OFFSET_BASIS;
+   hash = fnv1a(hash, edid->mfg_id,       strlen(edid->mfg_id)+1);
+   hash = fnv1a(hash, edid->model_name,   strlen(edid->model_name)+1);
+   hash = fnv1a(hash, &edid->product_code,  sizeof(edid->product_code));
+   hash = fnv1a(hash, edid->serial_ascii, strlen(edid->serial_ascii)+1);
+   hash = fnv1a(hash, &edid->serial_binary, sizeof(edid->serial_binary));
+   return hash;
+}
+
+
 /** Parses an EDID.
+ *
+ * Values derived from the identifier fields, i.e. hashes used for quick
+ * comparison and the manufacturer name, are computed once here.
  *
  * @param edidbytes   pointer to 128 byte EDID block
  *
@@ -221,7 +262,7 @@ Parsed_Edid * create_parsed_edid(Byte* edidbytes) {
    if ( !is_valid_edid_header(edidbytes) || !is_valid_edid_checksum(edidbytes) )
       goto bye;
 
-   parsed_edid = calloc(1,sizeof(Parsed_Edid));
+   parsed_edid = counted_calloc(ALLOC_EDID, sizeof(Parsed_Edid));
    assert(sizeof(parsed_edid->bytes) == 128);
    memcpy(parsed_edid->marker, EDID_MARKER_NAME, 4);
    memcpy(parsed_edid->bytes,  edidbytes, 128);
@@ -269,6 +310,10 @@ Parsed_Edid * create_parsed_edid(Byte* edidbytes) {
    parsed_edid->supported_features = edidbytes[0x18];
    parsed_edid->extension_flag = edidbytes[0x7e];
 
+   parsed_edid->bytes_hash = edid_bytes_hash(edidbytes);
+   parsed_edid->ids_hash   = edid_ids_hash(parsed_edid);
+   parsed_edid->mfg_name   = pnp_name(parsed_edid->mfg_id);
+
 bye:
    return parsed_edid;
 }
@@ -294,16 +339,79 @@ Parsed_Edid * create_parsed_edid2(Byte* edidbytes, char * source) {
 }
 
 
-/** Frees a Parsed_Edid struct.
+//
+// Interned EDIDs
+//
+// Displays with identical EDIDs, e.g. the panels of a video wall, share
+// a single reference counted Parsed_Edid.  An interned Parsed_Edid must
+// not be modified.  free_parsed_edid() releases a reference.
+//
+
+static GPtrArray * interned_edids = NULL;     // protected by interned_edids_mutex
+static GMutex      interned_edids_mutex;
+
+
+/** Returns a shared, reference counted #Parsed_Edid for an EDID.
+ *
+ * If a #Parsed_Edid with the same bytes and source already exists, a
+ * reference to it is returned, without parsing the bytes again.
+ *
+ * @param edidbytes   pointer to 128 byte EDID block
+ * @param source      source of EDID, e.g. I2C or SYSFS
+ *
+ * @return pointer to Parsed_Edid struct, which must not be modified,
+ *         or NULL if the bytes could not be parsed.
+ *         The caller releases its reference using #free_parsed_edid().
+ */
+Parsed_Edid * create_interned_parsed_edid(Byte* edidbytes, char * source) {
+   assert(edidbytes);
+   uint64_t hash = edid_bytes_hash(edidbytes);
+   Parsed_Edid * result = NULL;
+
+   g_mutex_lock(&interned_edids_mutex);
+   if (!interned_edids)
+      interned_edids = g_ptr_array_new();
+   for (int ndx = 0; ndx < interned_edids->len && !result; ndx++) {
+      Parsed_Edid * cur = g_ptr_array_index(interned_edids, ndx);
+      if (cur->bytes_hash == hash &&
+          memcmp(cur->bytes, edidbytes, 128) == 0 &&
+          streq(cur->edid_source, source))
+      {
+         cur->refct++;
+         result = cur;
+      }
+   }
+   if (!result) {
+      result = create_parsed_edid2(edidbytes, source);
+      if (result) {
+         result->refct = 1;
+         g_ptr_array_add(interned_edids, result);
+      }
+   }
+   g_mutex_unlock(&interned_edids_mutex);
+   return result;
+}
+
+
+/** Frees a Parsed_Edid struct, or releases a reference to an interned one.
  *
  * @param  parsed_edid  pointer to Parsed_Edid struct to free
  */
 void free_parsed_edid(Parsed_Edid * parsed_edid) {
    assert( parsed_edid );
    assert( memcmp(parsed_edid->marker, EDID_MARKER_NAME, 4)==0 );
+   if (parsed_edid->refct > 0) {
+      g_mutex_lock(&interned_edids_mutex);
+      bool last = (--parsed_edid->refct == 0);
+      if (last)
+         g_ptr_array_remove_fast(interned_edids, parsed_edid);
+      g_mutex_unlock(&interned_edids_mutex);
+      if (!last)
+         return;
+   }
    parsed_edid->marker[3] = 'x';
    // n. Parsed_Edid contains no pointers
-   free(parsed_edid);
+   counted_free(ALLOC_EDID, parsed_edid, sizeof(Parsed_Edid));
 }
 
 
@@ -333,7 +441,7 @@ void report_parsed_edid_base(
    // verbose = true;
    if (edid) {
       rpt_vstring(depth,"EDID synopsis:");
-      rpt_vstring(d1,"Mfg id:               %s - %s",     edid->mfg_id, pnp_name(edid->mfg_id));
+      rpt_vstring(d1,"Mfg id:               %s - %s",     edid->mfg_id, edid->mfg_name);
       rpt_vstring(d1,"Model:                %s",          edid->model_name);
       rpt_vstring(d1,"Product code:         %u  (0x%04x)", edid->product_code, edid->product_code);
    // rpt_vstring(d1,"Product code:         %u",          edid->product_code);
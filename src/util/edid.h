@@ -76,11 +76,17 @@ struct {
    Byte         supported_features;      ///< EDID byte 24 (x18) supported features bitmap
    uint8_t      extension_flag;          ///< number of optional extension blocks
    char         edid_source[EDID_SOURCE_FIELD_SIZE];  ///< describes source of EDID
+   uint64_t     bytes_hash;              ///< hash of the 128 raw bytes
+   uint64_t     ids_hash;                ///< hash of the identifier fields, see #edid_ids_hash()
+   const char * mfg_name;                ///< manufacturer name for mfg_id, "UNK" if unknown
+   int          refct;                   ///< references if interned, see #create_interned_parsed_edid(), else 0
 } Parsed_Edid;
 
 
+uint64_t      edid_bytes_hash(const Byte * edidbytes);
 Parsed_Edid * create_parsed_edid(Byte* edidbytes);
 Parsed_Edid * create_parsed_edid2(Byte* edidbytes, char * source);
+Parsed_Edid * create_interned_parsed_edid(Byte* edidbytes, char * source);
 void          report_parsed_edid_base(Parsed_Edid * edid, bool verbose_synopsis, bool show_raw, int depth);
 void          report_parsed_edid(Parsed_Edid * edid, bool verbose, int depth);
 void          free_parsed_edid(Parsed_Edid * parsed_edid);
@@ -22,6 +22,7 @@
 #include <string.h>
 /** \endcond */
 
+#include "alloc_stats.h"
 #include "debug_util.h"
 #include "glib_util.h"
 #include "report_util.h"
@@ -50,6 +51,67 @@ static ErrInfo_Status_String errinfo_desc_func = default_status_code_desc;
 static ErrInfo_Status_String errinfo_name_func =  NULL;
 
 
+//
+// Record pool
+//
+// Failed tries create and free many short lived instances.  Freed
+// instances are kept on a per-thread list for reuse, avoiding a
+// malloc/free pair per instance.  An instance freed on a thread other
+// than the one that created it simply joins the freeing thread's list.
+//
+
+#define ERRINFO_POOL_MAX 32
+
+typedef struct {
+   Error_Info * recs[ERRINFO_POOL_MAX];
+   int          ct;
+} Errinfo_Pool;
+
+
+static void free_errinfo_pool(gpointer data) {
+   Errinfo_Pool * pool = data;
+   for (int ndx = 0; ndx < pool->ct; ndx++)
+      free(pool->recs[ndx]);
+   free(pool);
+}
+
+
+static Errinfo_Pool * get_errinfo_pool() {
+   static GPrivate errinfo_pool_key = G_PRIVATE_INIT(free_errinfo_pool);
+   Errinfo_Pool * pool = g_private_get(&errinfo_pool_key);
+   if (!pool) {
+      pool = calloc(1, sizeof(Errinfo_Pool));
+      g_private_set(&errinfo_pool_key, pool);
+   }
+   return pool;
+}
+
+
+static Error_Info * alloc_errinfo() {
+   Errinfo_Pool * pool = get_errinfo_pool();
+   Error_Info * erec = NULL;
+   if (pool->ct > 0) {
+      erec = pool->recs[--pool->ct];
+      memset(erec, 0, sizeof(Error_Info));
+   }
+   else {
+      erec = calloc(1, sizeof(Error_Info));
+   }
+   alloc_stats_add(ALLOC_ERROR_INFO, sizeof(Error_Info));
+   return erec;
+}
+
+
+static void release_errinfo(Error_Info * erec) {
+   alloc_stats_remove(ALLOC_ERROR_INFO, sizeof(Error_Info));
+   Errinfo_Pool * pool = get_errinfo_pool();
+   if (pool->ct < ERRINFO_POOL_MAX)
+      pool->recs[pool->ct++] = erec;
+   else
+      free(erec);
+}
+
+
 //
 // Initialization
 //
@@ -109,9 +171,8 @@ errinfo_free(Error_Info * erec){
       }
 #endif
 
-      free(erec->func);
       erec->marker[3] = 'x';
-      free(erec);
+      release_errinfo(erec);
    }
 }
 
@@ -211,6 +272,21 @@ void errinfo_set_detail3(
 }
 
 
+/** Ensures that the cause array of an instance without causes
+ *  has room for a given number of causes.
+ *
+ *  \param  erec     instance
+ *  \param  cause_ct number of causes to be added
+ */
+static void
+reserve_causes(Error_Info * erec, int cause_ct) {
+   if (erec->causes == empty_list && cause_ct > 0) {
+      erec->causes = calloc(cause_ct+1, sizeof(Error_Info *) );
+      erec->max_causes = cause_ct;
+   }
+}
+
+
 /** Adds a cause to an existing #Error_Info instance
  *
  *  \param  parent instance to which cause will be added
@@ -271,7 +347,8 @@ errinfo_add_cause(
  *  detail string are specified as an arg_list.
  *
  *  \param  status_code  status code
- *  \param  func         name of function generating status code
+ *  \param  func         name of function generating status code,
+ *                       must remain valid for the life of the instance
  *  \param  detail       detail string, may be NULL
  *  \param  args         substitution values
  *  \return pointer to new instance
@@ -283,11 +360,11 @@ errinfo_newv(
       const char *   detail,
       va_list        args)
 {
-   Error_Info * erec = calloc(1, sizeof(Error_Info));
+   Error_Info * erec = alloc_errinfo();
    memcpy(erec->marker, ERROR_INFO_MARKER, 4);
    erec->status_code = status_code;
    erec->causes = empty_list;
-   erec->func = strdup(func);   // strdup to avoid constness warning, must free
+   erec->func = func;    // always __func__ or similar, so not copied
 
    if (detail) {
       erec->detail = g_strdup_vprintf(detail, args);
@@ -389,7 +466,7 @@ errinfo_new_with_cause2(
       char *         detail)
 {
    VALID_DDC_ERROR_PTR(cause);
-   Error_Info * erec = errinfo_new2(status_code, func, detail);
+   Error_Info * erec = errinfo_new2(status_code, func, (detail) ? "%s" : NULL, detail);
    errinfo_add_cause(erec, cause);
    return erec;
 }
@@ -458,7 +535,8 @@ errinfo_new_with_causes2(
       const char *   func,
       char *         detail)
 {
-   Error_Info * result = errinfo_new2(status_code, func, detail);
+   Error_Info * result = errinfo_new2(status_code, func, (detail) ? "%s" : NULL, detail);
+   reserve_causes(result, cause_ct);
    for (int ndx = 0; ndx < cause_ct; ndx++) {
       errinfo_add_cause(result, causes[ndx]);
    }
@@ -479,6 +557,7 @@ errinfo_new_with_causes3(
    va_start(ap, detail);
    Error_Info * result = errinfo_newv(status_code, func, detail, ap);
    va_end(ap);
+   reserve_causes(result, cause_ct);
    for (int ndx = 0; ndx < cause_ct; ndx++) {
       errinfo_add_cause(result, causes[ndx]);
    }
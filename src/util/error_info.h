@@ -9,7 +9,7 @@
  *  error is retained for use by higher levels in the call stack.
  */
 
-// Copyright (C) 2017-2020 Sanford Rockowitz <rockowitz@minsoft.com>
+// Copyright (C) 2017-2022 Sanford Rockowitz <rockowitz@minsoft.com>
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 
@@ -26,7 +26,7 @@
 typedef struct error_info {
    char               marker[4];    ///<  always EINF
    int                status_code;  ///<  status code
-   char *             func;         ///<  name of function generating status code
+   const char *       func;         ///<  name of function generating status code, not copied
    char *             detail;       ///<  explanation (may be NULL)
    int                max_causes;   ///<  max number entries in array currently pointed to by **causes**
    int                cause_ct;     ///<  number of causal errors
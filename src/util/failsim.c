@@ -48,9 +48,11 @@ static GHashTable * fst = NULL;
 // Describes a call occurrence for which an error is to be simulated
 typedef struct fsim_call_occ_rec {
    Fsim_Call_Occ_Type   call_occ_type;
-   int                  occno;
+   int                  occno;         // for FSIM_CALL_OCC_PROBABILISTIC, percent of calls
    int                  rc;
    bool                 modulated;
+   bool                 delay_only;    // stall the call, but do not fail it
+   int                  delay_millis;
 } Fsim_Call_Occ_Rec;
 
 
@@ -67,9 +69,22 @@ typedef struct fsim_func_rec {
 
 
 char * fsim_call_occ_type_names[] = {"FSIM_CALL_OCC_RECURRING",
-                                     "FSIM_CALL_OCC_SINGLE"
+                                     "FSIM_CALL_OCC_SINGLE",
+                                     "FSIM_CALL_OCC_PROBABILISTIC"
 };
 
+static bool   verbose = true;     // report each simulated failure
+static GMutex fsim_mutex;         // call counts are updated by concurrent threads
+
+
+/** Controls whether each simulated failure is reported, with a backtrace.
+ *
+ *  @param onoff  true to report, false to be silent
+ */
+void fsim_set_verbose(bool onoff) {
+   verbose = onoff;
+}
+
 
 // GHashTable destroy function for hash value (i.e. pointer to Fsim_Func_Rec)
 static void fsim_destroy_func_rec(gpointer data) {
@@ -87,6 +102,16 @@ void fsim_destroy_key(gpointer data) {
 }
 
 
+static const char * fsim_occ_type_desc(Fsim_Call_Occ_Type call_occ_type) {
+   switch(call_occ_type) {
+   case FSIM_CALL_OCC_RECURRING:      return "recurring";
+   case FSIM_CALL_OCC_SINGLE:         return "single";
+   case FSIM_CALL_OCC_PROBABILISTIC:  return "percent";
+   }
+   return "invalid";
+}
+
+
 /* Reports a single entry in the error simulation table,
  * i.e. the conditions under which an error will be simulated
  * for the function and the error value for the function to return.
@@ -112,10 +137,15 @@ static void report_error_table_entry(
     rpt_vstring(depth, "function:      %s", key);
     for (int ndx = 0; ndx < frec->call_occ_recs->len; ndx++) {
        Fsim_Call_Occ_Rec  occ_rec = g_array_index(frec->call_occ_recs, Fsim_Call_Occ_Rec, ndx);
-       rpt_vstring(depth+1, "rc = %d, occurrences=(%s, %d)",
-                             occ_rec.rc,
-                             (occ_rec.call_occ_type == FSIM_CALL_OCC_RECURRING) ? "recurring" : "single",
-                             occ_rec.occno);
+       char delay[40] = "";
+       if (occ_rec.delay_millis > 0)
+          g_snprintf(delay, sizeof(delay), ", delay=%d ms", occ_rec.delay_millis);
+       if (occ_rec.delay_only)
+          rpt_vstring(depth+1, "no failure, occurrences=(%s, %d)%s",
+                                fsim_occ_type_desc(occ_rec.call_occ_type), occ_rec.occno, delay);
+       else
+          rpt_vstring(depth+1, "rc = %d, occurrences=(%s, %d)%s",
+                                occ_rec.rc, fsim_occ_type_desc(occ_rec.call_occ_type), occ_rec.occno, delay);
     }
 
 }
@@ -188,14 +218,39 @@ void fsim_add_error(
               occno,
               rc);
 
-   Fsim_Call_Occ_Rec callocc_rec;
+   fsim_add_error2(funcname, call_occ_type, occno, rc, false, 0);
+}
+
+
+/** Adds an error or delay description to the failure simulation table
+ *  entry for a function.
+ *
+ * @param  funcname       function name
+ * @param  call_occ_type  recurring, single, or probabilistic
+ * @param  occno          occurrence number, or percent of calls if probabilistic
+ * @param  rc             return code to simulate
+ * @param  delay_only     if true, the call is delayed but does not fail
+ * @param  delay_millis   milliseconds to stall the call before returning
+ */
+void fsim_add_error2(
+       char *               funcname,
+       Fsim_Call_Occ_Type   call_occ_type,
+       int                  occno,
+       int                  rc,
+       bool                 delay_only,
+       int                  delay_millis)
+{
+   Fsim_Call_Occ_Rec callocc_rec = {0};
    callocc_rec.call_occ_type = call_occ_type;
    callocc_rec.occno = occno;
    callocc_rec.rc = rc;
+   callocc_rec.delay_only = delay_only;
+   callocc_rec.delay_millis = delay_millis;
 
+   g_mutex_lock(&fsim_mutex);
    Fsim_Func_Rec* frec = fsim_get_or_create_func_rec(funcname);
-
    g_array_append_val(frec->call_occ_recs, callocc_rec);
+   g_mutex_unlock(&fsim_mutex);
 }
 
 
@@ -227,10 +282,12 @@ void fsim_clear_errors_for_func(char * funcname) {
 /* Clears the entire failure simulation table.
  */
 void fsim_clear_error_table() {
+   g_mutex_lock(&fsim_mutex);
    if (fst) {
       g_hash_table_destroy(fst);
       fst = NULL;
    }
+   g_mutex_unlock(&fsim_mutex);
 }
 
 
@@ -334,16 +391,22 @@ bool eval_fsim_rc(char * rc_string, int * evaluated_rc) {
  @endverbatim
  * where:
  * - **status_code** has a form documented for eval_fsim_rc()
- * - **occurrence_descriptor** has the form "[*]integer"\n
+ *   or is "delay", in which case calls are stalled but do not fail
+ * - **occurrence_descriptor** has the form "[*]integer" or "integer%"\n
  *   examples:
  *     - *7   every 7th call fails
  *     - 7    the 7th call fails
  *     - *1   every call fails
+ *     - 10%  each call fails with probability 10%
+ * - **delay**, optional, is the number of milliseconds by which a failing
+ *   call is stalled
  *
  * Examples:
  * \verbatim
-   i2c_set_addr  base:EBUSY 6
-   ddc_verify    false      *1
+   i2c_set_addr       base:EBUSY     6
+   ddc_verify         false          *1
+   invoke_i2c_reader  DDCRC_DDC_DATA 10%  100
+   invoke_i2c_writer  delay          *5   30
  \endverbatim
  *
  * @param lines     array of lines
@@ -362,7 +425,7 @@ bool fsim_load_control_from_gptrarray(GPtrArray * lines) {
    }
 
    bool ok = true;
-   fst = g_hash_table_new(g_str_hash, g_str_equal);
+   fsim_clear_error_table();
    for (int ndx = 0; ndx < lines->len; ndx++) {
       char * aline = g_ptr_array_index(lines, ndx);
       if (debug)
@@ -377,11 +440,17 @@ bool fsim_load_control_from_gptrarray(GPtrArray * lines) {
          int    fsim_rc  = 0;
          Fsim_Call_Occ_Type occtype = FSIM_CALL_OCC_SINGLE;
          int  occno = 0;
-         if (ntsa_length(pieces) != 3)
+         bool delay_only = false;
+         int  delay_millis = 0;
+         int  piecect = ntsa_length(pieces);
+         if (piecect != 3 && piecect != 4)
             valid_line = false;
          else {
             funcname = pieces[0];
-            valid_line = eval_fsim_rc(pieces[1], &fsim_rc);
+            if (streq(pieces[1], "delay"))
+               delay_only = true;
+            else
+               valid_line = eval_fsim_rc(pieces[1], &fsim_rc);
             if (valid_line) {
                char * occdef = pieces[2];
                if (*occdef == '*') {
@@ -393,17 +462,29 @@ bool fsim_load_control_from_gptrarray(GPtrArray * lines) {
                else {
                   char * end;
                   occno = strtol(occdef, &end, 10);
-                  if (*end != '\0')
+                  if (*end == '%' && *(end+1) == '\0' && occtype == FSIM_CALL_OCC_SINGLE &&
+                      occno >= 0 && occno <= 100)
+                     occtype = FSIM_CALL_OCC_PROBABILISTIC;
+                  else if (*end != '\0' || occno <= 0)
                      valid_line = false;
                }
-
             }
+            if (valid_line && piecect == 4) {
+               char * end;
+               delay_millis = strtol(pieces[3], &end, 10);
+               if (*end != '\0' || delay_millis < 0)
+                  valid_line = false;
+            }
+            if (valid_line && delay_only && delay_millis == 0)
+               valid_line = false;
 
             if (valid_line) {
-               fsim_add_error( funcname,
+               fsim_add_error2( funcname,
                       occtype,
                       occno,
-                      fsim_rc);
+                      fsim_rc,
+                      delay_only,
+                      delay_millis);
             }
 
          }
@@ -425,10 +506,21 @@ bool fsim_load_control_from_gptrarray(GPtrArray * lines) {
 }
 
 
-// TODO: implement
+/** Loads the failure simulation table from a string.  Lines have the form
+ *  documented for #fsim_load_control_from_gptrarray(), and are separated
+ *  by newlines or semicolons.
+ *
+ *  @param s   control string
+ *  @return true if success, false if error
+ */
 bool fsim_load_control_string(char * s) {
-   bool ok = false;
-
+   GPtrArray * lines = g_ptr_array_new_with_free_func(g_free);
+   gchar ** pieces = g_strsplit_set(s, "\n;", -1);
+   for (int ndx = 0; pieces[ndx]; ndx++)
+      g_ptr_array_add(lines, g_strdup(pieces[ndx]));
+   g_strfreev(pieces);
+   bool ok = fsim_load_control_from_gptrarray(lines);
+   g_ptr_array_free(lines, true);
    return ok;
 }
 
@@ -477,8 +569,10 @@ bool fsim_load_control_file(char * fn) {
 Failsim_Result fsim_check_failure(const char * fn, const char * funcname) {
    bool debug = false;
    Failsim_Result result = {false, 0};
+   int delay_millis = 0;
    if (fst) {
-      Fsim_Func_Rec * frec = g_hash_table_lookup(fst, funcname);
+      g_mutex_lock(&fsim_mutex);
+      Fsim_Func_Rec * frec = (fst) ? g_hash_table_lookup(fst, funcname) : NULL;
       if (frec) {
          frec->callct++;
          for (int ndx = 0; ndx < frec->call_occ_recs->len; ndx++) {
@@ -486,32 +580,34 @@ Failsim_Result fsim_check_failure(const char * fn, const char * funcname) {
             if (debug)
                printf("(%s) call_occ_type=%d, callct = %d, occno=%d\n", __func__,
                       occ_rec->call_occ_type, frec->callct, occ_rec->occno);
-            if (occ_rec->call_occ_type == FSIM_CALL_OCC_RECURRING) {
-
-               if ( frec->callct % occ_rec->occno == 0) {
+            bool occurs;
+            if (occ_rec->call_occ_type == FSIM_CALL_OCC_RECURRING)
+               occurs = (frec->callct % occ_rec->occno == 0);
+            else if (occ_rec->call_occ_type == FSIM_CALL_OCC_PROBABILISTIC)
+               occurs = (g_random_int_range(0, 100) < occ_rec->occno);
+            else
+               occurs = (frec->callct == occ_rec->occno);
+            if (occurs) {
+               delay_millis = occ_rec->delay_millis;
+               if (!occ_rec->delay_only) {
                   result.force_failure = true;
                   result.failure_value = occ_rec->rc;
-                  break;
-               }
-            }
-            else {
-               if (frec->callct == occ_rec->occno) {
-                  result.force_failure = true;
-                  result.failure_value = occ_rec->rc;
-                  break;
                }
+               break;
             }
          }
-         if (result.force_failure) {
+         if (result.force_failure && verbose) {
             printf("Simulating failure for call %d of function %s, returning %d\n",
                    frec->callct, funcname, result.failure_value);
             // printf("Call stack:\n");
             // why wasn't this here in the original version?
             show_backtrace(2);
          }
-
       }
+      g_mutex_unlock(&fsim_mutex);
    }
+   if (delay_millis > 0)
+      g_usleep(delay_millis * 1000);
 
    if (debug)
       printf("(%s) funcname=%s, returning (%d,%d)\n",
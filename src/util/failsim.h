@@ -29,8 +29,13 @@ void fsim_set_name_to_number_funcs(
       Fsim_Name_To_Number_Func  func,
       Fsim_Name_To_Number_Func  unmodulated_func);
 
-/** Indicates whether a failure should occur exactly one or be recurring */
-typedef enum {FSIM_CALL_OCC_RECURRING, FSIM_CALL_OCC_SINGLE} Fsim_Call_Occ_Type;
+/** Indicates whether a failure should occur exactly once, be recurring,
+ *  or occur randomly for a percentage of calls */
+typedef enum {FSIM_CALL_OCC_RECURRING,
+              FSIM_CALL_OCC_SINGLE,
+              FSIM_CALL_OCC_PROBABILISTIC} Fsim_Call_Occ_Type;
+
+void fsim_set_verbose(bool onoff);
 
 
 //
@@ -42,6 +47,13 @@ void fsim_add_error(
        Fsim_Call_Occ_Type   call_occ_type,
        int                  occno,
        int                  rc);
+void fsim_add_error2(
+       char *               funcname,
+       Fsim_Call_Occ_Type   call_occ_type,
+       int                  occno,
+       int                  rc,
+       bool                 delay_only,
+       int                  delay_millis);
 void fsim_clear_errors_for_func(char * funcname);
 void fsim_clear_error_table();
 void fsim_report_error_table(int depth);
@@ -54,7 +66,7 @@ void fsim_reset_callct(char * funcname);
 
 bool fsim_load_control_from_gptrarray(GPtrArray * lines);
 
-// bool fsim_load_control_string(char * s);         // unimplemented
+bool fsim_load_control_string(char * s);
 
 bool fsim_load_control_file(char * fn);
 
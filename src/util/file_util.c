@@ -48,12 +48,10 @@ file_getlines_errinfo(
 
    int rc = file_getlines(filename,  lines, false);
    if (rc < 0) {
-      char * detail = g_strdup_printf("Error reading file %s", filename);
       errs = errinfo_new2(
             rc,
             __func__,
-            detail);
-      free(detail);
+            "Error reading file %s", filename);
    }
    return errs;
 }
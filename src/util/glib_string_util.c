@@ -9,6 +9,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 /** \cond */
+#include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -208,3 +209,62 @@ void gaux_unique_string_ptr_array_include(GPtrArray * arry, char * new_value) {
       }
    }
 }
+
+
+//
+// Interned strings
+//
+// Long lived strings that are often identical, e.g. the capabilities strings
+// of many displays of the same model, are kept once, with a reference count.
+//
+
+static GHashTable * interned_strings = NULL;   // string -> reference count
+static GMutex       interned_strings_mutex;
+
+
+/** Returns a shared copy of a string.
+ *
+ *  @param  s  string to intern
+ *  @return interned copy, which must not be modified; release it
+ *          using #gaux_release_interned_string()
+ */
+char * gaux_intern_string(const char * s) {
+   assert(s);
+   g_mutex_lock(&interned_strings_mutex);
+   if (!interned_strings)
+      interned_strings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+   gpointer key = NULL;
+   gpointer refct = NULL;
+   if (g_hash_table_lookup_extended(interned_strings, s, &key, &refct))
+      g_hash_table_insert(interned_strings, key, GINT_TO_POINTER(GPOINTER_TO_INT(refct)+1));
+   else {
+      key = g_strdup(s);
+      g_hash_table_insert(interned_strings, key, GINT_TO_POINTER(1));
+   }
+   g_mutex_unlock(&interned_strings_mutex);
+   return key;
+}
+
+
+/** Releases a reference to a string returned by #gaux_intern_string(),
+ *  freeing it when no references remain.
+ *
+ *  @param  s  interned string, if NULL do nothing
+ */
+void gaux_release_interned_string(char * s) {
+   if (!s)
+      return;
+   g_mutex_lock(&interned_strings_mutex);
+   gpointer key = NULL;
+   gpointer refct = NULL;
+   bool found = interned_strings && g_hash_table_lookup_extended(interned_strings, s, &key, &refct);
+   assert(found && key == s);
+   if (found) {
+      int new_refct = GPOINTER_TO_INT(refct) - 1;
+      if (new_refct == 0)
+         g_hash_table_remove(interned_strings, key);
+      else
+         g_hash_table_insert(interned_strings, key, GINT_TO_POINTER(new_refct));
+   }
+   g_mutex_unlock(&interned_strings_mutex);
+}
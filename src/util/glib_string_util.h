@@ -26,4 +26,7 @@ bool        gaux_unique_string_ptr_arrays_equal(GPtrArray *first, GPtrArray* sec
 GPtrArray * gaux_unique_string_ptr_arrays_minus(GPtrArray *first, GPtrArray* second);
 void        gaux_unique_string_ptr_array_include(GPtrArray * arry, char * new_value);
 
+char *      gaux_intern_string(const char * s);
+void        gaux_release_interned_string(char * s);
+
 #endif /* GLIB_STRING_UTIL_H_ */
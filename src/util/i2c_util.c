@@ -19,6 +19,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <glib-2.0/glib.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
@@ -28,6 +29,7 @@
 #include "report_util.h"
 #include "string_util.h"
 #include "sysfs_filter_functions.h"
+#include "sysfs_util.h"
 
 #include "i2c_util.h"
 
@@ -246,7 +248,8 @@ bool dev_i2c_devices_exist() {
       printf("(%s) Starting.\n", __func__);
    Boolean_Accumulator accumulator = {false};
 
-   dir_foreach("/dev",
+   char dirbuf[PATH_MAX];
+   dir_foreach(fs_rooted_path("/dev", dirbuf, PATH_MAX),
                startswith_i2c, // Dir_Filter_Func,
                set_true,       // Dir_Foreach_Func,
                &accumulator,
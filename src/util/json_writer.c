@@ -0,0 +1,226 @@
+/** \file json_writer.c
+ *  Streaming JSON writer
+ *
+ *  Values are written to the output stream as they are supplied, without
+ *  building a document tree.  The writer only tracks the nesting depth and
+ *  whether a separator is needed, so the caller is responsible for
+ *  supplying keys inside objects and for balancing begin and end calls.
+ *
+ *  Output is compact, with a newline following the outermost value.
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_writer.h"
+
+
+/** Creates a writer.
+ *
+ *  \param  fh   output stream
+ *  \return newly allocated writer, free using #json_writer_free()
+ */
+Json_Writer * json_writer_new(FILE * fh) {
+   Json_Writer * jw = calloc(1, sizeof(Json_Writer));
+   memcpy(jw->marker, JSON_WRITER_MARKER, 4);
+   jw->fh = fh;
+   return jw;
+}
+
+
+/** Frees a writer.  The output stream is flushed but not closed.
+ *
+ *  \param  jw   writer
+ */
+void json_writer_free(Json_Writer * jw) {
+   if (jw) {
+      assert(memcmp(jw->marker, JSON_WRITER_MARKER, 4) == 0);
+      assert(jw->depth == 0);
+      fflush(jw->fh);
+      jw->marker[3] = 'x';
+      free(jw);
+   }
+}
+
+
+// Writes the separator, if any, that precedes a value
+static void begin_value(Json_Writer * jw) {
+   assert(memcmp(jw->marker, JSON_WRITER_MARKER, 4) == 0);
+   if (jw->after_key)
+      jw->after_key = false;
+   else if (jw->has_members[jw->depth])
+      fputc(',', jw->fh);
+   jw->has_members[jw->depth] = true;
+}
+
+
+// Called after a complete value has been written
+static void end_value(Json_Writer * jw) {
+   if (jw->depth == 0) {
+      fputc('\n', jw->fh);
+      jw->has_members[0] = false;
+   }
+}
+
+
+static void write_escaped(FILE * fh, const char * s) {
+   fputc('"', fh);
+   for (const unsigned char * p = (const unsigned char *) s; *p; p++) {
+      switch (*p) {
+      case '"':  fputs("\\\"", fh); break;
+      case '\\': fputs("\\\\", fh); break;
+      case '\n': fputs("\\n",  fh); break;
+      case '\r': fputs("\\r",  fh); break;
+      case '\t': fputs("\\t",  fh); break;
+      default:
+         if (*p < 0x20)
+            fprintf(fh, "\\u%04x", *p);
+         else
+            fputc(*p, fh);
+      }
+   }
+   fputc('"', fh);
+}
+
+
+static void begin_container(Json_Writer * jw, char bracket) {
+   begin_value(jw);
+   assert(jw->depth < JSON_WRITER_MAX_DEPTH-1);
+   fputc(bracket, jw->fh);
+   jw->depth++;
+   jw->has_members[jw->depth] = false;
+}
+
+
+static void end_container(Json_Writer * jw, char bracket) {
+   assert(memcmp(jw->marker, JSON_WRITER_MARKER, 4) == 0);
+   assert(jw->depth > 0 && !jw->after_key);
+   fputc(bracket, jw->fh);
+   jw->depth--;
+   end_value(jw);
+}
+
+
+void json_begin_object(Json_Writer * jw) {
+   begin_container(jw, '{');
+}
+
+void json_end_object(Json_Writer * jw) {
+   end_container(jw, '}');
+}
+
+void json_begin_array(Json_Writer * jw) {
+   begin_container(jw, '[');
+}
+
+void json_end_array(Json_Writer * jw) {
+   end_container(jw, ']');
+}
+
+
+/** Writes an object member name.  The next value written is its value.
+ *
+ *  \param  jw   writer
+ *  \param  key  member name
+ */
+void json_key(Json_Writer * jw, const char * key) {
+   assert(!jw->after_key);
+   begin_value(jw);
+   write_escaped(jw->fh, key);
+   fputc(':', jw->fh);
+   jw->after_key = true;
+}
+
+
+/** Writes a string value.
+ *
+ *  \param  jw     writer
+ *  \param  value  string, if NULL writes null
+ */
+void json_string(Json_Writer * jw, const char * value) {
+   begin_value(jw);
+   if (value)
+      write_escaped(jw->fh, value);
+   else
+      fputs("null", jw->fh);
+   end_value(jw);
+}
+
+
+void json_int(Json_Writer * jw, int64_t value) {
+   begin_value(jw);
+   fprintf(jw->fh, "%" PRId64, value);
+   end_value(jw);
+}
+
+
+void json_bool(Json_Writer * jw, bool value) {
+   begin_value(jw);
+   fputs((value) ? "true" : "false", jw->fh);
+   end_value(jw);
+}
+
+
+void json_null(Json_Writer * jw) {
+   begin_value(jw);
+   fputs("null", jw->fh);
+   end_value(jw);
+}
+
+
+/** Writes a value already formatted as JSON, e.g. the output of another
+ *  writer.  Trailing newlines are not copied.
+ *
+ *  \param  jw    writer
+ *  \param  text  complete JSON value
+ */
+void json_raw(Json_Writer * jw, const char * text) {
+   begin_value(jw);
+   int len = strlen(text);
+   while (len > 0 && text[len-1] == '\n')
+      len--;
+   fwrite(text, 1, len, jw->fh);
+   end_value(jw);
+}
+
+
+/** Writes a byte array as a string of lower case hex digits.
+ *
+ *  \param  jw      writer
+ *  \param  bytes   pointer to bytes
+ *  \param  bytect  number of bytes
+ */
+void json_hex_bytes(Json_Writer * jw, const uint8_t * bytes, int bytect) {
+   static const char hexdigits[] = "0123456789abcdef";
+   begin_value(jw);
+   fputc('"', jw->fh);
+   for (int ndx = 0; ndx < bytect; ndx++) {
+      fputc(hexdigits[bytes[ndx] >> 4],  jw->fh);
+      fputc(hexdigits[bytes[ndx] & 0x0f], jw->fh);
+   }
+   fputc('"', jw->fh);
+   end_value(jw);
+}
+
+
+void json_key_string(Json_Writer * jw, const char * key, const char * value) {
+   json_key(jw, key);
+   json_string(jw, value);
+}
+
+
+void json_key_int(Json_Writer * jw, const char * key, int64_t value) {
+   json_key(jw, key);
+   json_int(jw, value);
+}
+
+
+void json_key_bool(Json_Writer * jw, const char * key, bool value) {
+   json_key(jw, key);
+   json_bool(jw, value);
+}
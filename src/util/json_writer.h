@@ -0,0 +1,47 @@
+/** \file json_writer.h
+ *  Streaming JSON writer
+ */
+
+// Copyright (C) 2022 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef JSON_WRITER_H_
+#define JSON_WRITER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define JSON_WRITER_MAX_DEPTH 16
+
+#define JSON_WRITER_MARKER "JSNW"
+typedef struct {
+   char    marker[4];
+   FILE *  fh;
+   int     depth;                                ///< current nesting depth
+   bool    has_members[JSON_WRITER_MAX_DEPTH];   ///< a value has been written at this depth
+   bool    after_key;                            ///< value follows a key just written
+} Json_Writer;
+
+Json_Writer * json_writer_new(FILE * fh);
+void          json_writer_free(Json_Writer * jw);
+
+void json_begin_object(Json_Writer * jw);
+void json_end_object(  Json_Writer * jw);
+void json_begin_array( Json_Writer * jw);
+void json_end_array(   Json_Writer * jw);
+
+void json_key(   Json_Writer * jw, const char * key);
+void json_string(Json_Writer * jw, const char * value);
+void json_int(   Json_Writer * jw, int64_t value);
+void json_bool(  Json_Writer * jw, bool value);
+void json_null(  Json_Writer * jw);
+void json_hex_bytes(Json_Writer * jw, const uint8_t * bytes, int bytect);
+void json_raw(   Json_Writer * jw, const char * text);
+
+// Convenience functions for object members
+void json_key_string(Json_Writer * jw, const char * key, const char * value);
+void json_key_int(   Json_Writer * jw, const char * key, int64_t value);
+void json_key_bool(  Json_Writer * jw, const char * key, bool value);
+
+#endif /* JSON_WRITER_H_ */
@@ -35,6 +35,7 @@
 #include <string.h>
 /** \endcond */
 
+#include "alloc_stats.h"
 #include "report_util.h"
 
 #include "multi_level_map.h"
@@ -78,7 +79,8 @@ Multi_Level_Map * mlm_create(char * table_name, int levels, MLM_Level* level_det
  */
 MLM_Node * mlm_add_node(Multi_Level_Map * map, MLM_Node * parent, uint key, char * value) {
    // printf("(%s) parent=%p, key=0x%04x, value=|%s|\n", __func__, parent, key, value);
-   MLM_Node * new_node = calloc(1,sizeof(MLM_Node));
+   // nodes are never freed
+   MLM_Node * new_node = counted_calloc(ALLOC_DEVICE_ID_MAP, sizeof(MLM_Node));
    new_node->code = key;
    new_node->name = value;
    new_node->children = NULL;
@@ -96,10 +98,40 @@ MLM_Node * mlm_add_node(Multi_Level_Map * map, MLM_Node * parent, uint key, char
       g_ptr_array_add(parent->children, new_node);
    }
    map->level_detail[new_node->level].total_entries += 1;
+   map->sorted = false;
    return new_node;
 }
 
 
+static gint mlm_node_compare(gconstpointer a, gconstpointer b) {
+   const MLM_Node * n1 = *(MLM_Node **) a;
+   const MLM_Node * n2 = *(MLM_Node **) b;
+   return (n1->code < n2->code) ? -1 : (n1->code > n2->code) ? 1 : 0;
+}
+
+
+static void mlm_sort_nodelist(GPtrArray * nodelist) {
+   // stable, so the first of several nodes with the same code remains first
+   g_ptr_array_sort(nodelist, mlm_node_compare);
+   for (int ndx = 0; ndx < nodelist->len; ndx++) {
+      MLM_Node * node = g_ptr_array_index(nodelist, ndx);
+      if (node->children)
+         mlm_sort_nodelist(node->children);
+   }
+}
+
+
+/** Sorts the children of every node by code, so that lookups
+ *  can use a binary search.  Call once all nodes have been added.
+ *
+ * @param map    pointer to **Multi_Level_Map** table
+ */
+void mlm_sort_children(Multi_Level_Map * map) {
+   mlm_sort_nodelist(map->root);
+   map->sorted = true;
+}
+
+
 //
 // Debug data structure
 //
@@ -176,11 +208,36 @@ void report_multi_level_map(Multi_Level_Map * header, int depth) {
 // Data structure query
 //
 
+// Finds the first node with the specified code in a sorted node list
+static
+MLM_Node * mlm_find_sorted_child(GPtrArray * nodelist, uint id) {
+   int lo = 0;
+   int hi = nodelist->len;
+   while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      MLM_Node * cur_entry = g_ptr_array_index(nodelist, mid);
+      if (cur_entry->code < id)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   MLM_Node * result = NULL;
+   if (lo < nodelist->len) {
+      MLM_Node * cur_entry = g_ptr_array_index(nodelist, lo);
+      if (cur_entry->code == id)
+         result = cur_entry;
+   }
+   return result;
+}
+
+
 static
-MLM_Node * mlm_find_child(GPtrArray * nodelist, uint id) {
+MLM_Node * mlm_find_child(GPtrArray * nodelist, uint id, bool sorted) {
    bool debug = false;
    if (debug)
       printf("(%s) Starting, id=0x%08x\n", __func__, id);
+   if (sorted)
+      return mlm_find_sorted_child(nodelist, id);
    MLM_Node * result = NULL;
 
    for (int ndx = 0; ndx < nodelist->len; ndx++) {
@@ -239,7 +296,7 @@ Multi_Level_Names mlm_get_names2(Multi_Level_Map * mlm, int levelct, uint* ids)
       // printf("(%s) argndx=%d\n", __func__, argndx);
       if (!children)
          break;
-      MLM_Node * level_entry = mlm_find_child(children, ids[argndx]);
+      MLM_Node * level_entry = mlm_find_child(children, ids[argndx], mlm->sorted);
       if (!level_entry) {
          break;
       }
@@ -313,7 +370,7 @@ Multi_Level_Names mlm_get_names_old(Multi_Level_Map * table, int argct, ...) {
   GPtrArray * children = table->root;
   while (argndx < argct) {
      assert(children);
-     MLM_Node * level_entry = mlm_find_child(children, args[argndx]);
+     MLM_Node * level_entry = mlm_find_child(children, args[argndx], table->sorted);
      if (!level_entry) {
         result.levels = 0;   // indicates not found
         break;
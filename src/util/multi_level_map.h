@@ -30,6 +30,7 @@
 
 /** \cond */
 #include <glib-2.0/glib.h>
+#include <stdbool.h>
 /** \endcond */
 
 
@@ -72,6 +73,7 @@ typedef struct {
    char*       segment_tag;
    int         levels;
    GPtrArray * root;
+   bool        sorted;      // children at every level sorted by code
    MLM_Level   level_detail[];
    // MLM_Level * level_detail;
 } Multi_Level_Map;
@@ -79,6 +81,7 @@ typedef struct {
 
 Multi_Level_Map * mlm_create(char * table_name, int levels, MLM_Level* level_detail);
 MLM_Node * mlm_add_node(Multi_Level_Map * mlm, MLM_Node * parent, uint key, char * value);
+void mlm_sort_children(Multi_Level_Map * mlm);
 
 void report_multi_level_map(Multi_Level_Map * mlm, int depth);
 
@@ -16,7 +16,11 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 /** \cond */
+#include <assert.h>
+#include <ctype.h>
+#include <glib-2.0/glib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 /** \endcond */
@@ -2274,24 +2278,64 @@ Pnp_Id_Table_Entry pnp_id_table[] =   {
 const int pnp_table_size = sizeof(pnp_id_table) / sizeof(Pnp_Id_Table_Entry); // ARRAY_SIZE(pnp_id_table);
 
 
-static char * pnp_name0(char * id, int first, int last) {
+#define PNP_TABLE_SIZE ((int) (sizeof(pnp_id_table) / sizeof(Pnp_Id_Table_Entry)))
+
+// Manufacturer ids packed as in an EDID, 5 bits per letter, 'A' = 1.
+// Parallel to pnp_id_table, which is sorted by id, so also sorted.
+static uint16_t pnp_keys[PNP_TABLE_SIZE];
+
+
+/** Packs a 3 character manufacturer id into 16 bits.
+ *
+ *  \param  id  manufacturer id, only the first 3 characters are used
+ *  \return packed id, -1 if id is not 3 characters in the range '@'..'Z'
+ */
+static int pnp_key(const char * id) {
+   int key = 0;
+   for (int ndx = 0; ndx < 3; ndx++) {
+      int ch = toupper((unsigned char) id[ndx]);
+      if (ch < '@' || ch > 'Z')
+         return -1;
+      key = (key << 5) | (ch - '@');
+   }
+   return key;
+}
+
+
+static void init_pnp_keys() {
+   static gsize keys_initialized = 0;
+   if (g_once_init_enter(&keys_initialized)) {
+      for (int ndx = 0; ndx < PNP_TABLE_SIZE; ndx++) {
+         pnp_keys[ndx] = pnp_key(pnp_id_table[ndx].mfg_code);
+         assert(ndx == 0 || pnp_keys[ndx-1] <= pnp_keys[ndx]);
+      }
+      g_once_init_leave(&keys_initialized, 1);
+   }
+}
+
+
+static char * pnp_name0(char * id) {
    bool debug = false;
    if (debug)
-      printf("(%s) Starting, id=%s, first=%d, last=%d\n",  __func__, id, first, last);
+      printf("(%s) Starting, id=%s\n",  __func__, id);
 
    char * result = "UNK";
-   if (first <= last && first >= 0 && last < pnp_table_size) {
-      if (debug)
-         printf("(%s) mfg_code[%d] = %s, mfg_code[%d] = %s\n",
-               __func__, first, pnp_id_table[first].mfg_name, last, pnp_id_table[last].mfg_name);
-      int middle = (last-first)/2 + first;
-      int cmprc = strcmp(id,pnp_id_table[middle].mfg_code);
-      if (cmprc == 0)
+   int key = (strlen(id) >= 3) ? pnp_key(id) : -1;
+   if (key >= 0) {
+      init_pnp_keys();
+      int first = 0;
+      int last = PNP_TABLE_SIZE-1;
+      while (first <= last) {
+         int middle = (last-first)/2 + first;
+         if (pnp_keys[middle] == key) {
             result = pnp_id_table[middle].mfg_name;
-      else if (cmprc < 0)
-         result = pnp_name0(id, first, middle-1);
-      else
-         result = pnp_name0(id, middle+1, last);
+            break;
+         }
+         if (pnp_keys[middle] > key)
+            last = middle-1;
+         else
+            first = middle+1;
+      }
    }
 
    if (debug)
@@ -2308,7 +2352,7 @@ static char * pnp_name0(char * id, int first, int last) {
 char * pnp_name(char * id) {
    char * result = NULL;
    strupper(id);      // "inu" is a lower case code
-   result = pnp_name0(id, 0, pnp_table_size-1);
+   result = pnp_name0(id);
    return result;
 }
 
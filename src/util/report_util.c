@@ -72,14 +72,25 @@ typedef struct {
    // work around for fact that can't initialize the initial stack entry to stdout
    FILE* alt_initial_output_dest;     // initial NULL;
    bool  initial_output_dest_changed; // initial false;
+
+   // formatting buffer for rpt_vstring(), grows as needed
+   char * line_buf;
+   int    line_buf_size;
 } Per_Thread_Settings;
 
 
+static void free_thread_settings(gpointer data) {
+   Per_Thread_Settings * settings = data;
+   free(settings->line_buf);
+   g_free(settings);
+}
+
+
 /** Returns a struct for maintaining thread-specific settings
  *  @return thread-specific struct of global settings
  */
 static Per_Thread_Settings *  get_thread_settings() {
-   static GPrivate per_thread_settings_key = G_PRIVATE_INIT(g_free);
+   static GPrivate per_thread_settings_key = G_PRIVATE_INIT(free_thread_settings);
 
    Per_Thread_Settings* settings = g_private_get(&per_thread_settings_key);
 
@@ -151,10 +162,9 @@ void rpt_reset_indent_stack() {
  *  @param depth logical indentation depth, if < 0 perform no indentation
  *  @return number of indentation spaces
  */
-int rpt_get_indent(int depth) {
+static int get_indent(Per_Thread_Settings * settings, int depth) {
    if (depth < 0)
       depth = 0;
-   Per_Thread_Settings * settings = get_thread_settings();
    int spaces_ct = DEFAULT_INDENT_SPACES_PER_DEPTH;
    if (settings->indent_spaces_stack_pos >= 0)
       spaces_ct = settings->indent_spaces_stack[settings->indent_spaces_stack_pos];
@@ -162,6 +172,11 @@ int rpt_get_indent(int depth) {
 }
 
 
+int rpt_get_indent(int depth) {
+   return get_indent(get_thread_settings(), depth);
+}
+
+
 // Functions that allow for temporarily changing the output destination
 // on the current thread.
 
@@ -200,8 +215,7 @@ void rpt_reset_output_dest_stack() {
  *
  * @return current output destination
  */
-FILE * rpt_cur_output_dest() {
-   Per_Thread_Settings * settings = get_thread_settings();
+static FILE * cur_output_dest(Per_Thread_Settings * settings) {
    // special handling for unpushed case because can't statically initialize
    // output_dest_stack[0] to stdout
    FILE * result = NULL;
@@ -213,6 +227,11 @@ FILE * rpt_cur_output_dest() {
 }
 
 
+FILE * rpt_cur_output_dest() {
+   return cur_output_dest(get_thread_settings());
+}
+
+
 /** Debugging function to show output destination.
  */
 void rpt_debug_output_dest() {
@@ -266,11 +285,26 @@ void rpt_nl() {
  *
  * @remark This is the core function through which all output is funneled.
  */
+static void write_line(Per_Thread_Settings * settings, const char * title, int depth) {
+   static const char blanks[] = "                                                                ";
+   FILE * dest = cur_output_dest(settings);
+   if (!dest)
+      return;
+   // written as one locked sequence so lines from different threads do not interleave
+   flockfile(dest);
+   for (int indent = get_indent(settings, depth); indent > 0; indent -= sizeof(blanks)-1)
+      fwrite(blanks, 1, MIN(indent, sizeof(blanks)-1), dest);
+   fputs(title, dest);
+   putc('\n', dest);
+   funlockfile(dest);
+}
+
+
 void rpt_title(const char * title, int depth) {
    bool debug = false;
    if (debug)
       printf("(%s) Writing to %p\n", __func__, (void*)rpt_cur_output_dest());
-   f0printf(rpt_cur_output_dest(), "%*s%s\n", rpt_get_indent(depth), "", title);
+   write_line(get_thread_settings(), title, depth);
 }
 
 
@@ -305,25 +339,29 @@ void rpt_label(int depth, const char * text) {
  * @remark Note that the depth parm is first on this function because of variable args
  */
 void rpt_vstring(int depth, char * format, ...) {
-   int buffer_size = 200;
-   char buffer[buffer_size];
-   char * buf = buffer;
+   Per_Thread_Settings * settings = get_thread_settings();
+   if (!cur_output_dest(settings))     // output suppressed, don't bother formatting
+      return;
+   if (!settings->line_buf) {
+      settings->line_buf_size = 200;
+      settings->line_buf = malloc(settings->line_buf_size);
+   }
    va_list(args);
    va_start(args, format);
-   int reqd_size = vsnprintf(buffer, buffer_size, format, args);
-   // if buffer wasn't sufficiently large, allocate a temporary buffer
-   if (reqd_size >= buffer_size) {
-      // printf("(%s) Allocating temp buffer, reqd_size=%d\n", __func__, reqd_size);
-      buf = malloc(reqd_size+1);
-      va_start(args, format);
-      vsnprintf(buf, reqd_size+1, format, args);
+   va_list args2;
+   va_copy(args2, args);
+   int reqd_size = vsnprintf(settings->line_buf, settings->line_buf_size, format, args);
+   // if buffer wasn't sufficiently large, enlarge it and format again
+   if (reqd_size >= settings->line_buf_size) {
+      free(settings->line_buf);
+      settings->line_buf_size = reqd_size+1;
+      settings->line_buf = malloc(settings->line_buf_size);
+      vsnprintf(settings->line_buf, settings->line_buf_size, format, args2);
    }
+   va_end(args2);
    va_end(args);
 
-   rpt_title(buf, depth);
-
-   if (buf != buffer)
-      free(buf);
+   write_line(settings, settings->line_buf, depth);
 }
 
 
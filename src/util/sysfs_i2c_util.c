@@ -7,11 +7,15 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <glib-2.0/glib.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "file_util.h"
 #include "report_util.h"
@@ -60,6 +64,156 @@ is_module_loaded_using_sysfs(
 // properly belong in a file in subdirectory base, but to avoid yet more file
 // proliferation are included here.
 
+//
+// Snapshot of per-bus attributes
+//
+// Bus detection, the conflicting driver checks, and the environment
+// command all need the same few attributes of each /sys/bus/i2c/devices/i2c-N
+// node, often several times per bus.  They are read once, relative to a
+// directory file descriptor for the node, and cached until
+// sysfs_i2c_reset_bus_attrs() is called, e.g. when displays are redetected.
+//
+
+static GHashTable * bus_attrs_cache = NULL;     // busno -> Sysfs_I2C_Bus_Attrs *
+static GMutex       bus_attrs_mutex;
+
+
+static void free_sysfs_i2c_bus_attrs(void * data) {
+   Sysfs_I2C_Bus_Attrs * attrs = data;
+   if (attrs) {
+      free(attrs->name);
+      free(attrs->adapter_path);
+      free(attrs->driver);
+      free(attrs);
+   }
+}
+
+
+/** Reads the first line of a sysfs attribute relative to a directory fd.
+ *
+ *  \param  dirfd  open directory
+ *  \param  attr   attribute name
+ *  \return newly allocated string with trailing newline removed,
+ *          NULL if the attribute cannot be read
+ */
+static char * read_attr_at(int dirfd, const char * attr) {
+   char * result = NULL;
+   int fd = openat(dirfd, attr, O_RDONLY);
+   if (fd >= 0) {
+      char buf[256];
+      ssize_t ct = read(fd, buf, sizeof(buf)-1);
+      if (ct >= 0) {
+         buf[ct] = '\0';
+         char * nl = strchr(buf, '\n');
+         if (nl)
+            *nl = '\0';
+         result = strdup(buf);
+      }
+      close(fd);
+   }
+   return result;
+}
+
+
+/** Returns the basename of a symbolic link relative to a directory fd. */
+static char * readlink_basename_at(int dirfd, const char * link) {
+   char buf[PATH_MAX];
+   ssize_t ct = readlinkat(dirfd, link, buf, sizeof(buf)-1);
+   if (ct < 0)
+      return NULL;
+   buf[ct] = '\0';
+   return g_path_get_basename(buf);
+}
+
+
+static Sysfs_I2C_Bus_Attrs * read_sysfs_i2c_bus_attrs(int busno) {
+   Sysfs_I2C_Bus_Attrs * attrs = calloc(1, sizeof(Sysfs_I2C_Bus_Attrs));
+   attrs->busno = busno;
+
+   char path[PATH_MAX];
+   g_snprintf(path, sizeof(path), "%s/sys/bus/i2c/devices/i2c-%d", fs_root_prefix(), busno);
+   int dirfd = open(path, O_RDONLY | O_DIRECTORY);
+   if (dirfd < 0)
+      return attrs;
+   attrs->name = read_attr_at(dirfd, "name");
+
+   // Walk up the chain of device links until a node with a class
+   // attribute, i.e. the adapter, is found.
+   GString * rel = g_string_new(NULL);
+   int fd = dirfd;
+   for (int level = 0; level < 4; level++) {
+      int devfd = openat(fd, "device", O_RDONLY | O_DIRECTORY);
+      if (fd != dirfd)
+         close(fd);
+      if (devfd < 0) {
+         fd = dirfd;
+         break;
+      }
+      fd = devfd;
+      g_string_append(rel, "/device");
+      char * s_class = read_attr_at(fd, "class");
+      if (s_class) {
+         str_to_int(s_class, (int*) &attrs->adapter_class, 16);   // if fails, unchanged
+         free(s_class);
+         char * p = g_strdup_printf("%s%s", path, rel->str);
+         attrs->adapter_path = realpath(p, NULL);
+         g_free(p);
+         char * driver = readlink_basename_at(fd, "driver/module");
+         if (driver) {
+            attrs->driver = strdup(driver);
+            g_free(driver);
+         }
+         break;
+      }
+   }
+   if (fd != dirfd)
+      close(fd);
+   g_string_free(rel, true);
+   if (!attrs->driver) {
+      char * driver = readlink_basename_at(dirfd, "device/driver/module");
+      if (driver) {
+         attrs->driver = strdup(driver);
+         g_free(driver);
+      }
+   }
+   close(dirfd);
+   return attrs;
+}
+
+
+/** Gets the cached sysfs attributes of an I2C bus, reading them if
+ *  they have not yet been read.
+ *
+ *  \param  busno  I2C bus number
+ *  \return pointer to attributes record, owned by the cache
+ */
+Sysfs_I2C_Bus_Attrs *
+sysfs_i2c_get_bus_attrs(int busno) {
+   g_mutex_lock(&bus_attrs_mutex);
+   if (!bus_attrs_cache)
+      bus_attrs_cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_sysfs_i2c_bus_attrs);
+   Sysfs_I2C_Bus_Attrs * attrs = g_hash_table_lookup(bus_attrs_cache, GINT_TO_POINTER(busno));
+   if (!attrs) {
+      attrs = read_sysfs_i2c_bus_attrs(busno);
+      g_hash_table_insert(bus_attrs_cache, GINT_TO_POINTER(busno), attrs);
+   }
+   g_mutex_unlock(&bus_attrs_mutex);
+   return attrs;
+}
+
+
+/** Discards all cached bus attributes, e.g. when displays are redetected. */
+void
+sysfs_i2c_reset_bus_attrs() {
+   g_mutex_lock(&bus_attrs_mutex);
+   if (bus_attrs_cache) {
+      g_hash_table_destroy(bus_attrs_cache);
+      bus_attrs_cache = NULL;
+   }
+   g_mutex_unlock(&bus_attrs_mutex);
+}
+
+
 /** Gets the sysfs name of an I2C device,
  *  i.e. the value of /sys/bus/i2c/devices/i2c-n/name
  *
@@ -74,16 +228,14 @@ char *
 get_i2c_device_sysfs_name(
       int busno)
 {
-   char workbuf[50];
-   snprintf(workbuf, 50, "/sys/bus/i2c/devices/i2c-%d/name", busno);
-   char * name = file_get_first_line(workbuf, /*verbose */ false);
-   // DBGMSG("busno=%d, returning: %s", busno, bool_repr(result));
-   return name;
+   Sysfs_I2C_Bus_Attrs * attrs = sysfs_i2c_get_bus_attrs(busno);
+   return (attrs->name) ? strdup(attrs->name) : NULL;
 }
 
 
 /** Gets the driver name of an I2C device,
- *  i.e. the basename of /sys/bus/i2c/devices/i2c-n/device/driver/module
+ *  i.e. the basename of the driver/module link of its adapter, e.g.
+ *  /sys/bus/i2c/devices/i2c-n/device/driver/module
  *
  *  \param  busno   I2C bus number
  *  \return newly allocated string containing driver name
@@ -94,21 +246,13 @@ get_i2c_device_sysfs_name(
  */
 char *
 get_i2c_device_sysfs_driver(int busno) {
-   char * driver_name = NULL;
-   char workbuf[100];
-   snprintf(workbuf, 100, "/sys/bus/i2c/devices/i2c-%d/device/driver/module", busno);
-   driver_name = get_rpath_basename(workbuf);
-   if (!driver_name) {
-      snprintf(workbuf, 100, "/sys/bus/i2c/devices/i2c-%d/device/device/device/driver/module", busno);
-      driver_name = get_rpath_basename(workbuf);
-   }
-   // printf("(%s) busno=%d, returning %s\n", __func__, busno, driver_name);
-   return driver_name;
+   Sysfs_I2C_Bus_Attrs * attrs = sysfs_i2c_get_bus_attrs(busno);
+   return (attrs->driver) ? strdup(attrs->driver) : NULL;
 }
 
 
-/** Gets the class of an I2C device,
- *  i.e. /sys/bus/i2c/devices/i2c-n/device/class
+/** Gets the class of an I2C device, i.e. the class of its adapter, e.g.
+ *  /sys/bus/i2c/devices/i2c-n/device/class
  *  or   /sys/bus/i2c/devices/i2c-n/device/device/device/class
  *
  *  \param  busno   I2C bus number
@@ -116,25 +260,7 @@ get_i2c_device_sysfs_driver(int busno) {
  *          0 if not found (should never occur)
  */
 uint32_t get_i2c_device_sysfs_class(int busno) {
-   uint32_t result = 0;
-   char workbuf[100];
-   snprintf(workbuf, 100, "/sys/bus/i2c/devices/i2c-%d/device", busno);
-
-   char * s_class = read_sysfs_attr(workbuf, "class", /*verbose*/ false);
-   if (!s_class) {
-     snprintf(workbuf, 100, "/sys/bus/i2c/devices/i2c-%d/device/device/device", busno);
-     s_class = read_sysfs_attr(workbuf, "class", /*verbose*/ false);
-   }
-   if (s_class) {
-      // printf("(%s) Found %s/class\n", __func__, workbuf);
-      /* bool ok =*/  str_to_int(s_class, (int*) &result, 16);   // if fails, &result unchanged
-      free(s_class);
-   }
-   else{
-      // printf("(%s) class for bus %d not found\n", __func__, busno);
-   }
-   // printf("(%s) busno=%d, returning 0x%08x\n", __func__, busno, result);
-   return result;
+   return sysfs_i2c_get_bus_attrs(busno)->adapter_class;
 }
 
 
@@ -330,11 +456,12 @@ void do_sysfs_drm_card_number_dir(
 
 Bit_Set_256 get_sysfs_drm_card_numbers() {
    bool debug = false;
+   char dirbuf[PATH_MAX];
    char * dname =
  #ifdef TARGET_BSD
               "/compat/linux/sys/class/drm";
  #else
-              "/sys/class/drm";
+              fs_rooted_path("/sys/class/drm", dirbuf, PATH_MAX);
  #endif
    if (debug)
       printf("(%s) Examining %s\n", __func__, dname);
@@ -9,9 +9,26 @@
 #define SYSFS_I2C_UTIL_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "data_structures.h"
 
+/** Attributes of /sys/bus/i2c/devices/i2c-N, read once per detection */
+typedef struct {
+   int      busno;
+   char *   name;            ///< value of attribute name
+   char *   adapter_path;    ///< real path of the adapter device node
+   uint32_t adapter_class;   ///< class of the adapter, 0 if not found
+   char *   driver;          ///< basename of adapter's driver/module link
+} Sysfs_I2C_Bus_Attrs;
+
+Sysfs_I2C_Bus_Attrs *
+sysfs_i2c_get_bus_attrs(
+      int busno);
+
+void
+sysfs_i2c_reset_bus_attrs();
+
 char *
 get_i2c_device_sysfs_driver(
       int busno);
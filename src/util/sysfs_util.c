@@ -17,6 +17,7 @@
 /** \endcond */
 
 #include "file_util.h"
+#include "glib_util.h"
 #include "report_util.h"
 #include "string_util.h"
 
@@ -29,6 +30,104 @@
 // #pragma GCC diagnostic ignored "-Wstringop-truncation"
 
 
+//
+// Root prefix
+//
+
+static char fs_root[PATH_MAX] = "";
+
+
+/** Sets a directory that is prepended to /sys and /dev paths, so that
+ *  topology scanning can run against a snapshot of another machine's
+ *  file system.
+ *
+ *  Must be called before any thread other than the main thread starts.
+ *
+ * \param  dir  root directory, NULL or "" for the real file system
+ * \return true if set, false if dir is not a directory
+ */
+bool
+set_fs_root_prefix(const char * dir)
+{
+   if (!dir || !*dir || streq(dir, "/")) {
+      fs_root[0] = '\0';
+      return true;
+   }
+   if (!directory_exists(dir) || strlen(dir) >= PATH_MAX-64)
+      return false;
+   STRLCPY(fs_root, dir, sizeof(fs_root));
+   int len = strlen(fs_root);
+   while (len > 1 && fs_root[len-1] == '/')
+      fs_root[--len] = '\0';
+   return true;
+}
+
+
+/** Returns the directory set by #set_fs_root_prefix().
+ *
+ * \return root prefix, "" if none
+ */
+const char *
+fs_root_prefix()
+{
+   return fs_root;
+}
+
+
+static bool
+needs_root_prefix(const char * path)
+{
+   if (!fs_root[0] || !path ||
+       !(str_starts_with(path, "/sys/") || streq(path, "/sys") ||
+         str_starts_with(path, "/dev/") || streq(path, "/dev")) )
+      return false;
+   int rootlen = strlen(fs_root);
+   return !(strncmp(path, fs_root, rootlen) == 0 && path[rootlen] == '/');
+}
+
+
+/** Applies the root prefix to an absolute /sys or /dev path.
+ *
+ *  Paths that are relative, that are not in /sys or /dev, or that already
+ *  begin with the prefix, e.g. the result of realpath(), are copied unchanged.
+ *
+ * \param  path   path name
+ * \param  buf    where to return the path
+ * \param  bufsz  size of buf
+ * \return buf
+ */
+char *
+fs_rooted_path(const char * path, char * buf, int bufsz)
+{
+   if (needs_root_prefix(path))
+      g_snprintf(buf, bufsz, "%s%s", fs_root, path);
+   else
+      g_strlcpy(buf, path, bufsz);
+   return buf;
+}
+
+
+/** Variant of #fs_rooted_path() for values that are used immediately.
+ *
+ * \param  path  path name
+ * \return path, or the prefixed path in a thread specific buffer that is
+ *          valid until the next call on the current thread
+ *
+ *  \remark
+ *  Do not use for the directory passed to a dir_foreach() function, since
+ *  the callback may overwrite the buffer.
+ */
+const char *
+fs_rooted_path_t(const char * path)
+{
+   if (!needs_root_prefix(path))
+      return path;
+   static GPrivate  rooted_path_key = G_PRIVATE_INIT(g_free);
+   char * buf = get_thread_fixed_buffer(&rooted_path_key, PATH_MAX);
+   return fs_rooted_path(path, buf, PATH_MAX);
+}
+
+
 /** Reads a /sys attribute file, which is 1 line of text
  *
  * \param  dirname    directory name
@@ -43,7 +142,7 @@ read_sysfs_attr(
       bool         verbose)
 {
    char fn[PATH_MAX];
-   sprintf(fn, "%s/%s", dirname, attrname);
+   g_snprintf(fn, PATH_MAX, "%s/%s", fs_rooted_path_t(dirname), attrname);
    return file_get_first_line(fn, verbose);
 }
 
@@ -65,7 +164,7 @@ read_sysfs_attr_w_default(
       bool         verbose)
 {
    char fn[PATH_MAX];
-   sprintf(fn, "%s/%s", dirname, attrname);
+   g_snprintf(fn, PATH_MAX, "%s/%s", fs_rooted_path_t(dirname), attrname);
    char * result = file_get_first_line(fn, verbose);
    if (!result)
       result = strdup(default_value);  // strdup() so caller can free any result
@@ -99,7 +198,7 @@ read_sysfs_attr_w_default_r(
 {
    assert(strlen(default_value) < bufsz);
    char fn[PATH_MAX];
-   sprintf(fn, "%s/%s", dirname, attrname);
+   g_snprintf(fn, PATH_MAX, "%s/%s", fs_rooted_path_t(dirname), attrname);
    char * result = file_get_first_line(fn, verbose);
    if (result) {
       STRLCPY(buf, result, bufsz);
@@ -132,7 +231,7 @@ read_binary_sysfs_attr(
    assert(attrname);
 
    char fn[PATH_MAX];
-   sprintf(fn, "%s/%s", dirname, attrname);
+   g_snprintf(fn, PATH_MAX, "%s/%s", fs_rooted_path_t(dirname), attrname);
 
    return read_binary_file(fn, est_size, verbose);
 }
@@ -150,7 +249,7 @@ get_rpath_basename(
 {
    char * result = NULL;
    char   resolved_path[PATH_MAX];
-   char * rpath = realpath(path, resolved_path);
+   char * rpath = realpath(fs_rooted_path_t(path), resolved_path);
    // printf("(%s) rpath=|%s|\n", __func__, rpath);
    if (rpath) {
       result = g_path_get_basename(rpath);
@@ -302,7 +401,7 @@ assemble_sysfs_path2(
    bool debug = false;
    if (debug)
       printf("(%s) Starting.  bufsz=%d, fn_segment=|%s|\n", __func__, bufsz, fn_segment);
-   STRLCPY(buffer, fn_segment, bufsz-1);
+   STRLCPY(buffer, fs_rooted_path_t(fn_segment), bufsz-1);
    while(true) {
       char * segment = va_arg(ap, char*);
       if (debug)
@@ -14,6 +14,18 @@
 #include <glib-2.0/glib.h>
 
 
+bool
+set_fs_root_prefix(const char * dir);
+
+const char *
+fs_root_prefix();
+
+char *
+fs_rooted_path(const char * path, char * buf, int bufsz);
+
+const char *
+fs_rooted_path_t(const char * path);
+
 char *
 read_sysfs_attr(
       const char * dirname,
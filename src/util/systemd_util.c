@@ -101,7 +101,27 @@ char * d_strcasestr(const char * haystack, const char * needle) {
 
 
 
-GPtrArray * get_current_boot_messages(char ** filter_terms, bool ignore_case, int limit) {
+/** Collects the messages logged to the systemd journal during the current
+ *  boot.
+ *
+ *  To bound the cost of scanning a large journal, entries are read backwards
+ *  from the most recent, and at most **max_entries** entries are examined.
+ *
+ *  \param  filter_terms  if non-null, null terminated array of strings,
+ *                        only messages containing one of them are kept
+ *  \param  ignore_case   ignore case when testing filter terms
+ *  \param  limit         if > 0, keep only the first **limit** matching messages
+ *                        if < 0, keep only the last **-limit** matching messages
+ *  \param  max_entries   maximum number of journal entries to examine, 0 for no maximum
+ *  \return GPtrArray of newly allocated messages, in chronological order,
+ *          NULL if the journal cannot be opened
+ */
+GPtrArray * get_current_boot_messages(
+      char ** filter_terms,
+      bool    ignore_case,
+      int     limit,
+      int     max_entries)
+{
    bool debug = false;
    if (debug) {
       if (filter_terms) {
@@ -120,48 +140,52 @@ GPtrArray * get_current_boot_messages(char ** filter_terms, bool ignore_case, in
 
    char b0[50];
    snprintf(b0, 50, "_BOOT_ID=%s", cur_boot_id);
+   free(cur_boot_id);
    sd_journal_add_match(j,b0, 0);
 
    GPtrArray * lines = g_ptr_array_new_full(1000, free);
-   // int ct = 0;
+   int prefix_size = strlen("MESSAGE=");
+   int ct = 0;
 
-   SD_JOURNAL_FOREACH(j) {
+   // most recent first
+   sd_journal_seek_tail(j);
+   while (sd_journal_previous(j) > 0 && (max_entries == 0 || ct < max_entries)) {
+      ct++;
       const char *d;
       size_t l;
-
       r = sd_journal_get_data(j, "MESSAGE", (const void **)&d, &l);
       if (r < 0) {
-         fprintf(stderr, "Failed to read message field: %s\n", strerror(-r));
+         if (debug)
+            fprintf(stderr, "Failed to read message field: %s\n", strerror(-r));
          continue;
       }
 
-      // printf("%.*s\n", (int) l, d);
-      int prefix_size = strlen("MESSAGE=");
       int adj_size = l-prefix_size;
-      // printf("l=%zd, prefix_size=%d, adj_size=%d\n", l,prefix_size,adj_size);
-      char * s = malloc( (l-prefix_size)+1);
+      char * s = malloc(adj_size+1);
       memcpy(s,d+prefix_size,adj_size);
-      s[l-prefix_size] = '\0';
+      s[adj_size] = '\0';
       bool keep = true;
       if (filter_terms)
          keep = apply_filter_terms(s, filter_terms, ignore_case);
-      if (keep) {
+      if (keep)
          g_ptr_array_add(lines, s);
-         // printf("(%s) Copied line |%s|\n", __func__, s);
-      }
-      else {
-         // printf("(%s) Rejected line |%s|\n", __func__, s);
+      else
          free(s);
-      }
-      // if (ct++ > 10)
-      //    break;
    }
    sd_journal_close(j);
 
-   // printf("(%s) Found %d lines\n", __func__, lines->len);
+   // restore chronological order
+   for (int ndx = 0; ndx < lines->len/2; ndx++) {
+      gpointer temp = g_ptr_array_index(lines, ndx);
+      g_ptr_array_index(lines, ndx) = g_ptr_array_index(lines, lines->len-1-ndx);
+      g_ptr_array_index(lines, lines->len-1-ndx) = temp;
+   }
+   if (limit > 0 && lines->len > limit)
+      g_ptr_array_remove_range(lines, limit, lines->len - limit);
+   else if (limit < 0 && lines->len > -limit)
+      g_ptr_array_remove_range(lines, 0, lines->len + limit);
 
+   if (debug)
+      printf("(%s) Examined %d entries, found %d lines\n", __func__, ct, lines->len);
    return lines;
 }
-
-
-
@@ -25,9 +25,11 @@
 #define SYSTEMD_UTIL_H_
 
 #include <glib-2.0/glib.h>
+#include <stdbool.h>
 
 
-GPtrArray * get_current_boot_messages(char ** filter_terms, bool ignore_case, int limit);
+char *      get_current_boot_id();
+GPtrArray * get_current_boot_messages(char ** filter_terms, bool ignore_case, int limit, int max_entries);
 
 // bool apply_filter_terms(const char * text, char ** terms, bool ignore_case);
 
@@ -35,6 +35,21 @@ static uint64_t * timestamp_history = NULL;
 
 
 
+/** Returns the current value of the monotonic clock in nanoseconds.
+ *
+ * Unlike #cur_realtime_nanosec(), the value is not affected by changes
+ * to the system time, so is suitable for computing sleep deadlines.
+ * The clock is system wide, so values can be compared across processes.
+ *
+ * @return timestamp, in nanoseconds
+ */
+uint64_t cur_monotonic_nanosec() {
+   struct timespec tvNow;
+   clock_gettime(CLOCK_MONOTONIC, &tvNow);
+   return tvNow.tv_sec * (uint64_t)(1000*1000*1000) + tvNow.tv_nsec;
+}
+
+
 /** Returns the current value of the realtime clock in nanoseconds.
  *
  * @return timestamp, in nanoseconds
@@ -314,9 +314,7 @@ static char * xdg_dirs_iter_next(Iter_State * state) {
    char * p = state->iter_start;
    while (p < state->iter_end && *p != ':')
       p++;
-   if (p == state->iter_end) {
-      return NULL;
-   }
+   // the last directory in the list need not be followed by ':'
    int len = p - state->iter_start;
    char * buf = calloc(len + 1, 1);
    memcpy(buf, state->iter_start, len);
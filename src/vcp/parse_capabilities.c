@@ -14,6 +14,7 @@
 #include <string.h>
 /** \endcond */
 
+#include "util/alloc_stats.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
 
@@ -79,13 +80,22 @@ void dbgrpt_parsed_capabilities(Parsed_Capabilities * pcaps, int depth) {
 
        rpt_vstring(d1, "raw_cmds_segment_seen:   %s",  sbool(pcaps->raw_cmds_segment_seen));
        rpt_vstring(d1, "raw_cmds_segment_valid:  %s", sbool(pcaps->raw_cmds_segment_valid) );
+       rpt_vstring(d1, "cmds segment:            offset %d, len %d",
+                                                   pcaps->cmds_segment_offset, pcaps->cmds_segment_len);
        char * t = (pcaps->commands) ? bva_as_string(pcaps->commands, /*as_hex=*/true, " ") : NULL;
         rpt_vstring(d1, "commands:                %s", (t) ? t : "NULL");
         if (t)
            free(t);
 
        rpt_vstring(d1, "raw_vcp_features_seen:   %s", sbool(pcaps->raw_vcp_features_seen));
-       rpt_vstring(d1, "vcp_features.len:        %d", pcaps->vcp_features->len);
+       rpt_vstring(d1, "vcp segment:             offset %d, len %d",
+                                                   pcaps->vcp_segment_offset, pcaps->vcp_segment_len);
+       rpt_vstring(d1, "vcp_feature_ids:         %s",
+                                                   bs256_to_string(pcaps->vcp_feature_ids, "x", " "));
+       if (pcaps->vcp_features)
+          rpt_vstring(d1, "vcp_features.len:        %d", pcaps->vcp_features->len);
+       else
+          rpt_vstring(d1, "vcp_features:            Not built");
 
        rpt_vstring(d1, "caps_validity:           %s", capabilities_validity_name(pcaps->caps_validity));
 
@@ -111,6 +121,7 @@ void free_parsed_capabilities(Parsed_Capabilities * pcaps) {
    assert( pcaps );
    assert( memcmp(pcaps->marker, PARSED_CAPABILITIES_MARKER, 4) == 0);
 
+   alloc_stats_remove(ALLOC_CAPABILITIES, sizeof(Parsed_Capabilities) + strlen(pcaps->raw_value) + 1);
    free(pcaps->raw_value);
    free(pcaps->mccs_version_string);
    free(pcaps->model);
@@ -129,9 +140,9 @@ void free_parsed_capabilities(Parsed_Capabilities * pcaps) {
          g_ptr_array_remove_index(pcaps->vcp_features, ndx);
       }
       g_ptr_array_free(pcaps->vcp_features, true);
-      if (pcaps->messages)
-         g_ptr_array_free(pcaps->messages, true);
    }
+   if (pcaps->messages)
+      g_ptr_array_free(pcaps->messages, true);
 
    pcaps->marker[3] = 'x';
    free(pcaps);
@@ -224,7 +235,7 @@ update_validity(
  *
  * @param   start    start of values
  * @param   len      segment length
- * @param   messages accumulates error messages
+ * @param   messages accumulates error messages, may be NULL
  * @return  #Byte_Value_Array indicating command values seen,
  *          NULL if a parsing error
  *
@@ -248,7 +259,7 @@ static Byte_Value_Array parse_cmds_segment(
    Byte_Value_Array cmd_ids = bva_create();
    bool ok = store_bytehex_list(start, len, cmd_ids, bva_appender);
    // ok = false;   // force failure for testing
-   if (!ok) {
+   if (!ok && messages) {
       char * s = g_strdup_printf("Error processing commands list: %.*s", len, start);
       g_ptr_array_add(messages, s);
    }
@@ -272,6 +283,48 @@ void parse_vcp_values(char * start, int len, GPtrArray* messages) {
 #endif
 
 
+/** Parses a list of hex values separated by blanks without allocating memory.
+ *
+ *  Single digit values are accepted, as in #store_bytehex_list().
+ *
+ *  @param  start   start of values
+ *  @param  len     length of values
+ *  @param  result  values are added to this set
+ *  @return false if any value is invalid, true otherwise
+ */
+static bool
+scan_bytehex_list(const char * start, int len, Bit_Set_256 * result) {
+   bool ok = true;
+   const char * pos = start;
+   const char * end = start + len;
+   while (pos < end) {
+      while (pos < end && *pos == ' ') pos++;
+      if (pos == end)
+         break;
+      const char * tok = pos;
+      while (pos < end && *pos != ' ') pos++;
+      char hh[2];
+      Byte val;
+      bool hexok = false;
+      if (pos - tok == 2) {
+         hh[0] = tok[0];
+         hh[1] = tok[1];
+         hexok = hhc_to_byte_in_buf(hh, &val);
+      }
+      else if (pos - tok == 1) {
+         hh[0] = '0';
+         hh[1] = tok[0];
+         hexok = hhc_to_byte_in_buf(hh, &val);
+      }
+      if (hexok)
+         *result = bs256_insert(*result, val);
+      else
+         ok = false;
+   }
+   return ok;
+}
+
+
 //
 // vcp() segment
 //
@@ -290,24 +343,29 @@ struct {
 
 /** Parse the value of a vcp() segment..
  *
- *  @param  start    offset to start of segment
- *  @param  len      length of segment
- *  @param  messages accumulates error messages
+ *  @param  start       offset to start of segment
+ *  @param  len         length of segment
+ *  @param  feature_ids if non-NULL, feature codes are added to this set
+ *  @param  vcp_array   if non-NULL, a #Capabilities_Feature_Record is added
+ *                      to this array for each feature
+ *  @param  messages    if non-NULL, accumulates error messages
+ *  @return validity of the segment
  *
  *  A VCP contains either the feature code in hex, or the feature code followed
  *  by a parenthesized list of values (in hex).
  *
- *  @returns GPtrArray of Capabilities_Feature_Record *
- *
- *  The returned pointer is never NULL.  The **GPtrArray** it points to may
- *  contain 0 pointers.
+ *  The segment is first scanned by #parse_capabilities() to check its
+ *  validity and collect the feature codes. The value lists are checked, but
+ *  not stored.  The feature records are built by a second call, without
+ *  messages, when first needed.
  */
 static Parsed_Capabilities_Validity
 parse_vcp_segment(
-      char *       start,
-      int          len,
-      GPtrArray *  vcp_array,
-      GPtrArray *  messages)
+      char *        start,
+      int           len,
+      Bit_Set_256 * feature_ids,
+      GPtrArray *   vcp_array,
+      GPtrArray *   messages)
 {
    bool debug = false;
    DBGMSF(debug, "Starting.  len = %d, start=%p -> %.*s", len, start, len, start);
@@ -349,8 +407,10 @@ parse_vcp_segment(
          }
       }
       if (!feature_code_ok) {
-         char * s = g_strdup_printf("Feature %.*s (Invalid code)",1,st);
-         g_ptr_array_add(messages, s);
+         if (messages) {
+            char * s = g_strdup_printf("Feature %.*s (Invalid code)",1,st);
+            g_ptr_array_add(messages, s);
+         }
          // f0printf(ferr(), "Feature: %.*s (invalid code)\n", 1, st);
          if (result == CAPABILITIES_VALID)
             result = CAPABILITIES_USABLE;
@@ -360,7 +420,8 @@ parse_vcp_segment(
          // find matching )
          char * value_end = find_closing_paren(pos, end);
          if (value_end == end) {
-            g_ptr_array_add(messages, strdup("Value parse terminated without closing parenthesis") );
+            if (messages)
+               g_ptr_array_add(messages, strdup("Value parse terminated without closing parenthesis") );
             // TODO: recover from error, this is bad data from the monitor
             result = CAPABILITIES_INVALID;
             goto bye;  // Error is fatal
@@ -372,15 +433,25 @@ parse_vcp_segment(
       }
 
       if (valid_feature) {
-         Capabilities_Feature_Record * vfr =
-               parse_capabilities_feature(cur_feature_id, value_start, value_len, messages);
-         // if (debug) {
-         //    DDCA_MCCS_Version_Spec dummy_version = {0,0};
-         //    report_capabilities_feature(vfr, dummy_version, 1);
-         // }
-         if (!vfr->valid_values && result == CAPABILITIES_VALID)
-            result = CAPABILITIES_USABLE;
-         g_ptr_array_add(vcp_array, vfr);
+         if (feature_ids)
+            *feature_ids = bs256_insert(*feature_ids, cur_feature_id);
+         if (value_start) {
+            Bit_Set_256 scratch = EMPTY_BIT_SET_256;
+            if (!scan_bytehex_list(value_start, value_len, &scratch)) {
+               if (messages) {
+                  char * s = g_strdup_printf("Invalid VCP value in list for feature x%02x: %.*s",
+                                             cur_feature_id, value_len, value_start);
+                  g_ptr_array_add(messages, s);
+               }
+               if (result == CAPABILITIES_VALID)
+                  result = CAPABILITIES_USABLE;
+            }
+         }
+         if (vcp_array) {
+            Capabilities_Feature_Record * vfr =
+                  new_capabilities_feature_record(cur_feature_id, value_start, value_len);
+            g_ptr_array_add(vcp_array, vfr);
+         }
       }
    }
 bye:
@@ -653,15 +724,20 @@ Parsed_Capabilities * parse_capabilities(
 
    // Explicitly initialize all fields as documentation
    pcaps->raw_value = chars_to_string(buf_start, buf_len);
+   alloc_stats_add(ALLOC_CAPABILITIES, sizeof(Parsed_Capabilities) + buf_len + 1);
    pcaps->raw_value_synthesized = false;   // set by user of function
    pcaps->mccs_version_string  = NULL;
    pcaps->parsed_mccs_version = DDCA_VSPEC_UNQUERIED;
    pcaps->raw_cmds_segment_seen = false;
-   pcaps->commands = NULL;
+   pcaps->cmds_segment_offset = -1;
+   pcaps->commands = NULL;           // built by parsed_capabilities_commands()
    pcaps->raw_vcp_features_seen = false;
+   pcaps->vcp_segment_offset = -1;
+   pcaps->vcp_feature_ids = EMPTY_BIT_SET_256;
+   pcaps->vcp_features_built = false;
+   pcaps->vcp_features = NULL;       // built by parsed_capabilities_vcp_features()
    pcaps->raw_cmds_segment_valid = false;
    pcaps->caps_validity = CAPABILITIES_VALID;
-   pcaps->vcp_features = g_ptr_array_sized_new(40);
    pcaps->messages = g_ptr_array_new();
 
    // DBGMSG("Initial buf_len=%d, buf_start=%p -> |%.*s|", buf_len, buf_start, buf_len, buf_start);
@@ -700,9 +776,14 @@ Parsed_Capabilities * parse_capabilities(
           memcmp(seg->name_start, "cmds", seg->name_len) == 0)
       {
          pcaps->raw_cmds_segment_seen = true;
-         pcaps->commands = parse_cmds_segment(seg->value_start, seg->value_len, pcaps->messages);
-         pcaps->raw_cmds_segment_valid = (pcaps->commands);   // ??
-         if (!pcaps->commands) {
+         pcaps->cmds_segment_offset = seg->value_start - capabilities_string_start;
+         pcaps->cmds_segment_len    = seg->value_len;
+         Bit_Set_256 scratch = EMPTY_BIT_SET_256;
+         pcaps->raw_cmds_segment_valid = scan_bytehex_list(seg->value_start, seg->value_len, &scratch);
+         if (!pcaps->raw_cmds_segment_valid) {
+            char * s = g_strdup_printf("Error processing commands list: %.*s",
+                                       seg->value_len, seg->value_start);
+            g_ptr_array_add(pcaps->messages, s);
             if (pcaps->caps_validity == CAPABILITIES_VALID)
                pcaps->caps_validity = CAPABILITIES_USABLE;
          }
@@ -716,8 +797,11 @@ Parsed_Capabilities * parse_capabilities(
               )
       {
          pcaps->raw_vcp_features_seen = true;
+         pcaps->vcp_segment_offset = seg->value_start - capabilities_string_start;
+         pcaps->vcp_segment_len    = seg->value_len;
          Parsed_Capabilities_Validity vcp_segment_validity =
-               parse_vcp_segment(seg->value_start, seg->value_len, pcaps->vcp_features, pcaps->messages);
+               parse_vcp_segment(seg->value_start, seg->value_len,
+                                 &pcaps->vcp_feature_ids, NULL, pcaps->messages);
 
          pcaps->caps_validity = update_validity(pcaps->caps_validity, vcp_segment_validity);
       }
@@ -780,10 +864,202 @@ Parsed_Capabilities* parse_capabilities_string(
 }
 
 
+//
+// Allocation-free parsing
+//
+// For bulk analysis of capabilities strings, parse_capabilities_compact()
+// extracts the command codes, feature codes, and feature values in a single
+// pass over a borrowed string.  No memory is allocated and no messages
+// are collected.  Value sets are stored in an arena supplied by the caller.
+//
+
+static void
+scan_vcp_segment(const char * start, int len, Compact_Capabilities * ccaps) {
+   const char * pos = start;
+   const char * end = start + len;
+   while (pos < end) {
+      while (pos < end && *pos == ' ') pos++;
+      if (pos == end)
+         break;
+
+      const char * st = pos;
+      while (pos < end && *pos != ' ' && *pos != '(') pos++;
+      // If length > 2, feature codes not separated by blanks.  Take just the first 2 characters
+      if (pos - st > 2)
+         pos = st + 2;
+      Byte feature_code;
+      bool feature_code_ok = (pos - st == 2) && hhc_to_byte_in_buf(st, &feature_code);
+      if (feature_code_ok)
+         ccaps->features = bs256_insert(ccaps->features, feature_code);
+      else
+         ccaps->caps_validity = update_validity(ccaps->caps_validity, CAPABILITIES_USABLE);
+
+      if (pos < end && *pos == '(') {
+         const char * value_end = find_closing_paren((char *) pos, (char *) end);
+         if (value_end == end) {
+            ccaps->caps_validity = CAPABILITIES_INVALID;  // fatal, as in parse_vcp_segment()
+            return;
+         }
+         if (feature_code_ok) {
+            Bit_Set_256 * values = NULL;
+            if (bs256_contains(ccaps->features_with_values, feature_code))
+               values = &ccaps->value_sets[ccaps->value_set_ndx[feature_code]];
+            else if (ccaps->value_set_ct < ccaps->value_set_max) {
+               ccaps->value_set_ndx[feature_code] = ccaps->value_set_ct;
+               values = &ccaps->value_sets[ccaps->value_set_ct++];
+               *values = EMPTY_BIT_SET_256;
+               ccaps->features_with_values = bs256_insert(ccaps->features_with_values, feature_code);
+            }
+            if (!values || !scan_bytehex_list(pos+1, value_end - (pos+1), values))
+               ccaps->caps_validity = update_validity(ccaps->caps_validity, CAPABILITIES_USABLE);
+         }
+         pos = value_end + 1;
+      }
+   }
+}
+
+
+/** Parses a capabilities string in a single pass without allocating memory.
+ *
+ *  @param  caps      capabilities string, need not be null terminated
+ *  @param  len       length of capabilities string
+ *  @param  arena     where to store the value sets of features
+ *  @param  arena_ct  number of entries in **arena**, at most 256
+ *  @param  result    where to return the parsed information
+ *
+ *  @remark
+ *  If **arena** is exhausted, the values of the remaining features are not
+ *  recorded and the result is marked #CAPABILITIES_USABLE.
+ */
+void
+parse_capabilities_compact(
+      const char *           caps,
+      int                    len,
+      Bit_Set_256 *          arena,
+      int                    arena_ct,
+      Compact_Capabilities * result)
+{
+   assert(caps && result);
+   assert(arena_ct <= 256);
+   memset(result, 0, sizeof(Compact_Capabilities));
+   result->parsed_mccs_version = DDCA_VSPEC_UNQUERIED;
+   result->value_sets = arena;
+   result->value_set_max = (arena) ? arena_ct : 0;
+   result->caps_validity = CAPABILITIES_VALID;
+
+   while (len > 0 && caps[len-1] == ' ')
+      len--;
+   if (len > 0 && caps[0] == '(') {
+      if (caps[len-1] != ')') {
+         result->caps_validity = CAPABILITIES_INVALID;
+         return;
+      }
+      caps++;
+      len -= 2;
+   }
+
+   const char * pos = caps;
+   const char * end = caps + len;
+   while (pos < end) {
+      while (pos < end && *pos == ' ') pos++;      // n. Apple Cinema Display precedes name with blank
+      if (pos == end)
+         break;
+      const char * name = pos;
+      while (pos < end && *pos != '(' && *pos != ' ') pos++;
+      int name_len = pos - name;
+      while (pos < end && *pos == ' ') pos++;
+      if (name_len == 0 || pos == end || *pos != '(') {
+         result->caps_validity = CAPABILITIES_INVALID;
+         break;
+      }
+      const char * value_end = find_closing_paren((char *) pos, (char *) end);
+      if (value_end == end || value_end == pos+1) {
+         result->caps_validity = CAPABILITIES_INVALID;
+         break;
+      }
+      const char * value = pos+1;
+      int value_len = value_end - value;
+      pos = value_end + 1;
+
+      if (name_len == 4 && memcmp(name, "cmds", 4) == 0) {
+         if (!scan_bytehex_list(value, value_len, &result->commands))
+            result->caps_validity = update_validity(result->caps_validity, CAPABILITIES_USABLE);
+      }
+      else if (name_len == 3 && (memcmp(name, "vcp", 3) == 0 || memcmp(name, "VCP", 3) == 0)) {
+         scan_vcp_segment(value, value_len, result);
+         if (result->caps_validity == CAPABILITIES_INVALID)
+            break;
+      }
+      else if (name_len == 8 && memcmp(name, "mccs_ver", 8) == 0) {
+         char vbuf[16];
+         g_snprintf(vbuf, sizeof(vbuf), "%.*s", value_len, value);
+         result->parsed_mccs_version = parse_vspec(vbuf);
+         if (vcp_version_eq(result->parsed_mccs_version, DDCA_VSPEC_UNKNOWN))
+            result->caps_validity = update_validity(result->caps_validity, CAPABILITIES_USABLE);
+      }
+   }
+}
+
+
+/** Returns the values of a feature parsed by #parse_capabilities_compact().
+ *
+ *  @param  ccaps         parsed capabilities
+ *  @param  feature_code  VCP feature code
+ *  @return set of values, #EMPTY_BIT_SET_256 if the feature has no value list
+ */
+Bit_Set_256
+compact_capabilities_feature_values(Compact_Capabilities * ccaps, Byte feature_code) {
+   if (!bs256_contains(ccaps->features_with_values, feature_code))
+      return EMPTY_BIT_SET_256;
+   return ccaps->value_sets[ccaps->value_set_ndx[feature_code]];
+}
+
+
 //
 // Functions to query Parsed_Capabilities
 //
 
+/** Returns the command codes in the cmds() segment of a #Parsed_Capabilities,
+ *  parsing the segment on first call.
+ *
+ *  @param  pcaps  pointer to #Parsed_Capabilities
+ *  @return command codes, NULL if no cmds() segment or the segment is invalid
+ */
+Byte_Value_Array parsed_capabilities_commands(Parsed_Capabilities * pcaps) {
+   assert( pcaps && memcmp(pcaps->marker, PARSED_CAPABILITIES_MARKER, 4) == 0);
+   if (!pcaps->commands && pcaps->raw_cmds_segment_seen && pcaps->raw_cmds_segment_valid) {
+      pcaps->commands = parse_cmds_segment(pcaps->raw_value + pcaps->cmds_segment_offset,
+                                           pcaps->cmds_segment_len, NULL);
+   }
+   return pcaps->commands;
+}
+
+
+/** Returns the features in the vcp() segment of a #Parsed_Capabilities,
+ *  building the feature records on first call.
+ *
+ *  The value string of each feature is parsed only when #cfr_get_values()
+ *  is called for it.  Any errors in the segment were reported in
+ *  **pcaps->messages** when the capabilities string was parsed.
+ *
+ *  @param  pcaps  pointer to #Parsed_Capabilities
+ *  @return GPtrArray of #Capabilities_Feature_Record *, never NULL
+ */
+GPtrArray * parsed_capabilities_vcp_features(Parsed_Capabilities * pcaps) {
+   bool debug = false;
+   assert( pcaps && memcmp(pcaps->marker, PARSED_CAPABILITIES_MARKER, 4) == 0);
+   if (!pcaps->vcp_features_built) {
+      pcaps->vcp_features = g_ptr_array_sized_new(bs256_count(pcaps->vcp_feature_ids));
+      if (pcaps->raw_vcp_features_seen)
+         parse_vcp_segment(pcaps->raw_value + pcaps->vcp_segment_offset, pcaps->vcp_segment_len,
+                           NULL, pcaps->vcp_features, NULL);
+      pcaps->vcp_features_built = true;
+      DBGMSF(debug, "Built %d feature records", pcaps->vcp_features->len);
+   }
+   return pcaps->vcp_features;
+}
+
+
 /** Returns list of feature ids in a #Parsed_Capabilities structure.
  *
  *  @param pcaps           pointer to #Parsed_Capabilities
@@ -798,27 +1074,22 @@ Bit_Set_256 get_parsed_capabilities_feature_ids(
    assert(pcaps);
    bool debug = false;
    DBGMSF(debug, "Starting. readable_only=%s, feature count=%d",
-                 sbool(readable_only), pcaps->vcp_features->len);
-
-   // Byte_Bit_Flags flags = bbf_create();
-   Bit_Set_256 flags = EMPTY_BIT_SET_256;
-   if (pcaps->vcp_features) {    // pathological case of 0 length capabilities string
-      for (int ndx = 0; ndx < pcaps->vcp_features->len; ndx++) {
-         Capabilities_Feature_Record * frec = g_ptr_array_index(pcaps->vcp_features, ndx);
-         // DBGMSG("Feature 0x%02x", frec->feature_id);
-
-         bool add_feature_to_list = true;
-         if (readable_only) {
-            VCP_Feature_Table_Entry * vfte = vcp_find_feature_by_hexid_w_default(frec->feature_id);
-            if (!is_feature_readable_by_vcp_version(vfte, pcaps->parsed_mccs_version))
-               add_feature_to_list = false;
-            if (vfte->vcp_global_flags & DDCA_SYNTHETIC_VCP_FEATURE_TABLE_ENTRY)
-               free_synthetic_vcp_entry(vfte);
-         }
-         if (add_feature_to_list)
-            // bbf_insert(flags, frec->feature_id);
-            flags = bs256_insert(flags, frec->feature_id);
+                 sbool(readable_only), bs256_count(pcaps->vcp_feature_ids));
+
+   // the feature records are not needed, so are not built
+   Bit_Set_256 flags = pcaps->vcp_feature_ids;
+   if (readable_only) {
+      flags = EMPTY_BIT_SET_256;
+      Bit_Set_256_Iterator iter = bs256_iter_new(pcaps->vcp_feature_ids);
+      int feature_id;
+      while ( (feature_id = bs256_iter_next(iter)) >= 0) {
+         VCP_Feature_Table_Entry * vfte = vcp_find_feature_by_hexid_w_default(feature_id);
+         if (is_feature_readable_by_vcp_version(vfte, pcaps->parsed_mccs_version))
+            flags = bs256_insert(flags, feature_id);
+         if (vfte->vcp_global_flags & DDCA_SYNTHETIC_VCP_FEATURE_TABLE_ENTRY)
+            free_synthetic_vcp_entry(vfte);
       }
+      bs256_iter_free(iter);
    }
 
    DBGMSF(debug, "Returning Bit_Set_256: %s", bs256_to_string(flags, "x", ", ") );
@@ -836,12 +1107,13 @@ Bit_Set_256 get_parsed_capabilities_feature_ids(
  */
 bool parsed_capabilities_supports_table_commands(Parsed_Capabilities * pcaps) {
    bool result = false;
-   if (pcaps && pcaps->raw_cmds_segment_seen && pcaps->commands &&
-       bva_contains(pcaps->commands, 0xe2) &&      // Table Read Request
-       bva_contains(pcaps->commands, 0xe4)         // Table Read Reply
+   Byte_Value_Array commands = (pcaps) ? parsed_capabilities_commands(pcaps) : NULL;
+   if (commands &&
+       bva_contains(commands, 0xe2) &&      // Table Read Request
+       bva_contains(commands, 0xe4)         // Table Read Reply
       )
    {
-         result = false;
+         result = true;
    }
    return result;
 }
@@ -881,6 +1153,64 @@ void test_parse_caps() {
 #endif
 
 
+/** Saves the information in a #Parsed_Capabilities that API clients use
+ *  in a compact form, so that it can be cached and loaded without
+ *  parsing the capabilities string again.
+ *
+ *  The format is described at #SERIALIZED_CAPABILITIES_VERSION.
+ *
+ * @param  pcaps  parsed capabilities
+ * @return newly allocated #Buffer,
+ *         NULL if parsing reported messages or the result does not fit the format
+ */
+Buffer * serialize_parsed_capabilities(Parsed_Capabilities * pcaps) {
+   bool debug = false;
+   assert( pcaps && memcmp(pcaps->marker, PARSED_CAPABILITIES_MARKER, 4) == 0);
+
+   Byte_Value_Array commands = parsed_capabilities_commands(pcaps);
+   GPtrArray * vcp_features  = parsed_capabilities_vcp_features(pcaps);
+   int cmd_ct = (commands) ? bva_length(commands) : 0;
+   int feature_ct = vcp_features->len;
+   if ( (pcaps->messages && pcaps->messages->len > 0) || cmd_ct > 255 || feature_ct > 255) {
+      DBGMSF(debug, "Not serializable");
+      return NULL;
+   }
+
+   int size = 5 + cmd_ct;
+   for (int ndx = 0; ndx < feature_ct; ndx++) {
+      Capabilities_Feature_Record * cfr = g_ptr_array_index(vcp_features, ndx);
+      Byte_Value_Array values = cfr_get_values(cfr);
+      int value_ct = (values) ? bva_length(values) : 0;
+      if (value_ct > 255) {
+         DBGMSF(debug, "Too many values for feature 0x%02x", cfr->feature_id);
+         return NULL;
+      }
+      size += 2 + value_ct;
+   }
+
+   Buffer * buf = buffer_new(size+2, __func__);   // buffer_append() requires 2 spare bytes
+   buffer_add(buf, SERIALIZED_CAPABILITIES_VERSION);
+   buffer_add(buf, pcaps->parsed_mccs_version.major);
+   buffer_add(buf, pcaps->parsed_mccs_version.minor);
+   buffer_add(buf, cmd_ct);
+   if (cmd_ct > 0)
+      buffer_append(buf, bva_bytes(commands), cmd_ct);
+   buffer_add(buf, feature_ct);
+   for (int ndx = 0; ndx < feature_ct; ndx++) {
+      Capabilities_Feature_Record * cfr = g_ptr_array_index(vcp_features, ndx);
+      Byte_Value_Array values = cfr_get_values(cfr);
+      int value_ct = (values) ? bva_length(values) : 0;
+      buffer_add(buf, cfr->feature_id);
+      buffer_add(buf, value_ct);
+      if (value_ct > 0)
+         buffer_append(buf, bva_bytes(values), value_ct);
+   }
+
+   DBGMSF(debug, "Returning buffer of %d bytes", buf->len);
+   return buf;
+}
+
+
 /** Module initialization */
 void init_parse_capabilities() {
    RTTI_ADD_FUNC(parse_capabilities);
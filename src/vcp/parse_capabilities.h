@@ -23,7 +23,15 @@ typedef enum {
 
 
 #define PARSED_CAPABILITIES_MARKER "CAPA"
-/** Contains parsed capabilities information */
+/** Contains parsed capabilities information
+ *
+ *  The capabilities string is scanned once, which validates it, records
+ *  the location of the cmds() and vcp() segments, and collects the feature
+ *  codes.  The command list and the feature records are built on first use,
+ *  see #parsed_capabilities_commands() and #parsed_capabilities_vcp_features(),
+ *  and the values of each feature when requested, see #cfr_get_values().
+ *  An instance is therefore not thread safe.
+ */
 typedef struct {
    char                    marker[4];             // always "CAPA"
    char *                  raw_value;
@@ -33,16 +41,61 @@ typedef struct {
    DDCA_MCCS_Version_Spec  parsed_mccs_version;  // parsed mccs_version_string, DDCA_VSPEC_UNKNOWN if parsing fails
    bool                    raw_cmds_segment_seen;
    bool                    raw_cmds_segment_valid;
-   Byte_Value_Array        commands;             // each stored byte is command id
+   int                     cmds_segment_offset;  // offset of cmds() value in raw_value
+   int                     cmds_segment_len;
+   Byte_Value_Array        commands;             // each stored byte is command id, built on first use
    bool                    raw_vcp_features_seen;
-   GPtrArray *             vcp_features;         // entries are Capabilities_Feature_Record *
+   int                     vcp_segment_offset;   // offset of vcp() value in raw_value
+   int                     vcp_segment_len;
+   Bit_Set_256             vcp_feature_ids;      // feature codes in vcp() segment
+   bool                    vcp_features_built;
+   GPtrArray *             vcp_features;         // entries are Capabilities_Feature_Record *, built on first use
    Parsed_Capabilities_Validity caps_validity;
    GPtrArray *             messages;
 } Parsed_Capabilities;
 
 
+/** Capabilities information produced by #parse_capabilities_compact().
+ *
+ *  Value sets are bit sets, so unlike #Capabilities_Feature_Record they do
+ *  not preserve the order of values, which matters for feature x72.
+ */
+typedef struct {
+   DDCA_MCCS_Version_Spec  parsed_mccs_version;  ///< DDCA_VSPEC_UNQUERIED if no mccs_ver segment
+   Bit_Set_256             commands;             ///< command codes in cmds() segment
+   Bit_Set_256             features;             ///< feature codes in vcp() segment
+   Bit_Set_256             features_with_values; ///< features having a value list
+   Byte                    value_set_ndx[256];   ///< for features with values, index into **value_sets**
+   Bit_Set_256 *           value_sets;           ///< caller supplied arena
+   int                     value_set_ct;         ///< number of arena entries used
+   int                     value_set_max;        ///< number of arena entries
+   Parsed_Capabilities_Validity caps_validity;
+} Compact_Capabilities;
+
+/** Version of the format produced by #serialize_parsed_capabilities()
+ *
+ *  byte 0         format version
+ *  bytes 1-2      parsed MCCS version, major and minor
+ *  byte 3         number of command codes, followed by the command codes
+ *  next byte      number of features, followed for each feature by
+ *                 the feature code, the number of values, and the values
+ */
+#define SERIALIZED_CAPABILITIES_VERSION 1
+
 Parsed_Capabilities* parse_capabilities_string(char * capabilities);
+Buffer *             serialize_parsed_capabilities(Parsed_Capabilities * pcaps);
+void                 parse_capabilities_compact(
+                        const char *           caps,
+                        int                    len,
+                        Bit_Set_256 *          arena,
+                        int                    arena_ct,
+                        Compact_Capabilities * result);
+Bit_Set_256          compact_capabilities_feature_values(
+                        Compact_Capabilities * ccaps,
+                        Byte                   feature_code);
 void                 free_parsed_capabilities(Parsed_Capabilities * pcaps);
+Byte_Value_Array     parsed_capabilities_commands(Parsed_Capabilities * pcaps);
+GPtrArray *          parsed_capabilities_vcp_features(Parsed_Capabilities * pcaps);
 Bit_Set_256          get_parsed_capabilities_feature_ids(Parsed_Capabilities * pcaps, bool readable_only);
 bool                 parsed_capabilities_supports_table_commands(Parsed_Capabilities * pcaps);
 char *               parsed_capabilities_validity_name(Parsed_Capabilities_Validity validity);
@@ -36,32 +36,33 @@ void dbgrpt_capabilities_feature_record(
    rpt_structure_loc("Capabilities_Feature_Record", vfr, depth);
    rpt_vstring(d1, "marker:       %.4s", vfr->marker);
    rpt_vstring(d1, "feature_ide:  0x%02x", vfr->feature_id);
-   if (vfr->values) {
+   if (vfr->values_parsed && vfr->values) {
       char * s =  bva_as_string(vfr->values, true, " ");
       rpt_vstring(d1, "values:       %s", s);
       free(s);
    }
    else
-      rpt_vstring(d1, "values:       None");
+      rpt_vstring(d1, "values:       %s", (vfr->values_parsed) ? "None" : "Not parsed");
    rpt_vstring(d1, "value_string: %s", vfr->value_string);
+   rpt_vstring(d1, "values_parsed: %s", sbool(vfr->values_parsed));
    rpt_vstring(d1, "valid_values: %s", sbool(vfr->valid_values));
 }
 
 
 /** Given a feature code and the unparenthesized value string extracted
- *  from a capabilities string, parses the value string and creates
- *  a #Capabilities_Feature_Record.
+ *  from a capabilities string, creates a #Capabilities_Feature_Record.
+ *
+ *  The value string is not parsed until #cfr_get_values() is called.
  *
  *  \param  feature_id
  *  \param  value_string_start start of value string, NULL if no values string
  *  \param  value_string_len   length of value string
  *  \return newly allocated #Capabilities_Feature_Record
  */
-Capabilities_Feature_Record * parse_capabilities_feature(
+Capabilities_Feature_Record * new_capabilities_feature_record(
       Byte        feature_id,
       char *      value_string_start,
-      int         value_string_len,
-      GPtrArray * error_messages)
+      int         value_string_len)
 {
    bool debug = false;
    if (debug) {
@@ -82,6 +83,36 @@ Capabilities_Feature_Record * parse_capabilities_feature(
       vfr->value_string = (char *) malloc( value_string_len+1);
       memcpy(vfr->value_string, value_string_start, value_string_len);
       vfr->value_string[value_string_len] = '\0';
+   }
+   else {
+      vfr->values_parsed = true;   // nothing to parse
+      vfr->valid_values = true;
+   }
+
+   return vfr;
+}
+
+
+/** Returns the values of a #Capabilities_Feature_Record, parsing
+ *  the value string on the first call.
+ *
+ *  Invalid values are skipped, and **valid_values** is set false.
+ *  The error has already been reported when the capabilities
+ *  string was parsed.
+ *
+ *  \param  vfr  pointer to #Capabilities_Feature_Record
+ *  \return values in the order they appear in the capabilities string,
+ *          NULL if the feature has no value string
+ */
+Byte_Value_Array cfr_get_values(
+      Capabilities_Feature_Record * vfr)
+{
+   bool debug = false;
+   assert(vfr && memcmp(vfr->marker, CAPABILITIES_FEATURE_MARKER, 4) == 0);
+
+   if (!vfr->values_parsed) {
+      char * value_string_start = vfr->value_string;
+      int    value_string_len   = strlen(vfr->value_string);
 
 #if !defined(CFR_BVA) && !defined(CFR_BBF)     // sanity check
       assert(false);
@@ -90,14 +121,9 @@ Capabilities_Feature_Record * parse_capabilities_feature(
 #ifdef CFR_BVA
       Byte_Value_Array bva_values = bva_create();
       bool ok1 = store_bytehex_list(value_string_start, value_string_len, bva_values, bva_appender);
-      if (!ok1) {
-         char * s = g_strdup_printf("Invalid VCP value in list for feature x%02x: %.*s",
-                    feature_id, value_string_len, value_string_start);
-         g_ptr_array_add(error_messages, s);
-      }
       if (debug) {
          DBGMSG("store_bytehex_list for bva returned %s", sbool(ok1));
-         bva_report(vfr->values, "Feature values (array):");
+         bva_report(bva_values, "Feature values (array):");
       }
       vfr->valid_values = ok1;
       vfr->values = bva_values;
@@ -106,12 +132,6 @@ Capabilities_Feature_Record * parse_capabilities_feature(
 #ifdef CFR_BBF
       Byte_Bit_Flags bbf_values = bbf_create();
       bool ok2 = store_bytehex_list(value_string_start, value_string_len, bbf_values, bbf_appender);
-      if (!ok2) {
-          char * s = g_strdup_printf("Invalid VCP value in list for feature x%02x: %.*s",
-                     feature_id, value_string_len, value_string_start);
-          g_ptr_array_add(error_messages, s);
-       }
-
       if (debug) {
          DBGMSG("store_bytehex_list for bbf returned %s", sbool(ok2));
          char buf[768];
@@ -127,10 +147,10 @@ Capabilities_Feature_Record * parse_capabilities_feature(
          assert(bva_bbf_same_values(bva_values, bbf_values));
       }
 #endif
+      vfr->values_parsed = true;
+   }
 
-   }   // value_string_start not NULL
-
-   return vfr;
+   return vfr->values;
 }
 
 
@@ -22,23 +22,29 @@
 #undef  CFR_BBF     // Use Byte_Bit_Flags for values
 
 #define CAPABILITIES_FEATURE_MARKER "VCPF"
-/** Parsed description of a VCP Feature in a capabilities string. */
+/** Parsed description of a VCP Feature in a capabilities string.
+ *
+ *  The value string is parsed on first use, see #cfr_get_values().
+ */
 typedef struct {
      char              marker[4];     ///<  always "VCPF"
      Byte              feature_id;    ///<  VCP feature code
-     Byte_Value_Array  values;        ///<  need unsorted values for feature x72 gamma
+     Byte_Value_Array  values;        ///<  need unsorted values for feature x72 gamma, use #cfr_get_values()
 #ifdef CFR_BBF
      Byte_Bit_Flags    bbflags;       //    alternative, but sorts values, screws up x72 gamma
 #endif
      char *            value_string;  ///<  value substring from capabilities string
-     bool              valid_values;  ///<  string is valid
+     bool              values_parsed; ///<  value_string has been parsed into values
+     bool              valid_values;  ///<  string is valid, set when parsed
 } Capabilities_Feature_Record;
 
-Capabilities_Feature_Record * parse_capabilities_feature(
+Capabilities_Feature_Record * new_capabilities_feature_record(
       Byte   feature_id,
       char * value_string_start,
-      int    value_string_len,
-      GPtrArray* error_messages);
+      int    value_string_len);
+
+Byte_Value_Array cfr_get_values(
+      Capabilities_Feature_Record * vfr);
 
 void free_capabilities_feature_record(
       Capabilities_Feature_Record * vfr);
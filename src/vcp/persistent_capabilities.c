@@ -5,23 +5,33 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <glib-2.0/glib.h>
 #include <stddef.h>
 #include <strings.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "public/ddcutil_types.h"
 #include "public/ddcutil_status_codes.h"
 
+#include "util/data_structures.h"
 #include "util/error_info.h"
 #include "util/file_util.h"
+#include "util/glib_string_util.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
 #include "util/xdg_util.h"
 
 #include "base/core.h"
 #include "base/monitor_model_key.h"
+#include "base/persistent_store.h"
 #include "base/rtti.h"
+#include "base/vcp_version.h"
+
+#include "vcp/parse_capabilities.h"
 
 #include "persistent_capabilities.h"
 
@@ -30,6 +40,25 @@ static DDCA_Trace_Group TRACE_GROUP  = DDCA_TRC_VCP;
 static bool capabilities_cache_enabled = false;   // default set in parser
 static GHashTable *  capabilities_hash = NULL;
 static GMutex persistent_capabilities_mutex;
+static GHashTable *  parsed_capabilities_hash = NULL;   // protected by persistent_capabilities_mutex
+
+// Lookup counts for the current process, updated atomically
+typedef struct {
+   int lookups;
+   int hits;
+} Cache_Lookup_Counts;
+
+static Cache_Lookup_Counts capabilities_counts;
+static Cache_Lookup_Counts unsupported_features_counts;
+static Cache_Lookup_Counts vcp_version_counts;
+static Cache_Lookup_Counts unsupported_signaling_counts;
+static Cache_Lookup_Counts parsed_capabilities_counts;
+
+static inline void count_lookup(Cache_Lookup_Counts * counts, bool hit) {
+   g_atomic_int_inc(&counts->lookups);
+   if (hit)
+      g_atomic_int_inc(&counts->hits);
+}
 
 
 static void dbgrpt_capabilities_hash0(int depth, const char * msg) {
@@ -77,97 +106,244 @@ static void delete_capabilities_file() {
 }
 
 
-static Error_Info * load_persistent_capabilities_file() {
+/** Looks up a monitor model in the capabilities file, without loading it.
+ *
+ *  The file is mapped into memory and scanned under a shared lock.  Entries
+ *  are only ever appended, so the last line for the model wins.
+ *
+ *  \param  mms  monitor model string
+ *  \return capabilities string, caller must free, NULL if not found
+ */
+static char * find_persistent_capabilities_in_file(const char * mms) {
    bool debug = false;
-   if (debug || IS_TRACING()) {
-      DBGTRC_STARTING(debug, TRACE_GROUP, "capabilities_hash:");
-      dbgrpt_capabilities_hash0(2,NULL);
-   }
-   Error_Info * errs = NULL;
-   if (capabilities_cache_enabled) {
-      if (capabilities_hash) {
-         g_hash_table_destroy(capabilities_hash);
-      }
-      capabilities_hash = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
-
-      char * data_file_name = get_capabilities_cache_file_name();
-      // char * data_file_name = xdg_cache_home_file("ddcutil", "capabilities");
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "data_file_name: %s", data_file_name);
-      GPtrArray * linearray = g_ptr_array_new_with_free_func(g_free);
-      errs = file_getlines_errinfo(data_file_name, linearray);
-      free(data_file_name);
-      if (!errs) {
-         for (int ndx = 0; ndx < linearray->len; ndx++) {
-            char * aline = strtrim(g_ptr_array_index(linearray, ndx));
-            // DBGMSF(debug, "Processing line %d: %s", ndx+1, aline);
-            if (strlen(aline) > 0 && aline[0] != '*' && aline[0] != '#') {
-               char * colon = strchr(aline, ':');
-               if (!colon) {
-                  if (!errs)
-                     errs = errinfo_new(DDCRC_BAD_DATA, __func__);
-                  errinfo_add_cause(errs, errinfo_new2(DDCRC_BAD_DATA, __func__,
-                                                       "Line %d, No colon in %s",
-                                                        ndx+1, aline));
-               }
-               else {
-                  *colon = '\0';
-                  g_hash_table_insert(capabilities_hash, strdup(aline), strdup(colon+1));
+   char * data_file_name = get_capabilities_cache_file_name();
+   DBGTRC_STARTING(debug, TRACE_GROUP, "mms=|%s|, data_file_name: %s", mms, data_file_name);
+
+   char * result = NULL;
+   int fd = open(data_file_name, O_RDONLY|O_CLOEXEC);
+   if (fd >= 0) {
+      flock(fd, LOCK_SH);
+      struct stat statbuf;
+      if (fstat(fd, &statbuf) == 0 && statbuf.st_size > 0) {
+         char * data = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (data != MAP_FAILED) {
+            size_t keylen = strlen(mms);
+            const char * end = data + statbuf.st_size;
+            const char * line = data;
+            const char * eol;
+            // n. a final line without newline is incomplete and ignored
+            while (line < end && (eol = memchr(line, '\n', end-line)) ) {
+               if (eol - line > keylen && line[keylen] == ':' && memcmp(line, mms, keylen) == 0) {
+                  free(result);
+                  result = strndup(line+keylen+1, eol-line-keylen-1);
                }
+               line = eol+1;
             }
-            free(aline);
+            munmap(data, statbuf.st_size);
          }
-         g_ptr_array_free(linearray, true);
       }
+      flock(fd, LOCK_UN);
+      close(fd);
    }
    else {
-      if (capabilities_hash) {
-         g_hash_table_destroy(capabilities_hash);
-         capabilities_hash = NULL;
-      }
-
-      delete_capabilities_file();
+      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Error opening file: %s", strerror(errno));
    }
+   free(data_file_name);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", result);
+   return result;
+}
+
+
+/** Appends an entry to the capabilities file.
+ *
+ *  The line is written under an exclusive lock, so concurrent processes
+ *  never interleave or lose entries, and the file is never rewritten.
+ *
+ *  \param  mms           monitor model string
+ *  \param  capabilities  capabilities string
+ */
+static void append_persistent_capabilities_file(const char * mms, const char * capabilities) {
+   bool debug = false;
+   char * data_file_name = get_capabilities_cache_file_name();
+   DBGTRC_STARTING(debug, TRACE_GROUP, "data_file_name=%s", data_file_name);
 
-   if (debug || IS_TRACING()) {
-      DBGTRC_RET_ERRINFO(true, TRACE_GROUP, errs, "capabilities_hash:");
-      dbgrpt_capabilities_hash0(2, NULL);
+   FILE * fp = NULL;
+   fopen_mkdir(data_file_name, "a", ferr(), &fp);
+   if (fp) {
+      flock(fileno(fp), LOCK_EX);
+      int ct = fprintf(fp, "%s:%s\n", mms, capabilities);
+      if (ct < 0 || fflush(fp) != 0)
+         SEVEREMSG("Error writing to file %s:%s", data_file_name, strerror(errno) );
+      flock(fileno(fp), LOCK_UN);
+      fclose(fp);
    }
 
-   return errs;
+   free(data_file_name);
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
 
 
-static void save_persistent_capabilities_file() {
+//
+// Learned monitor data
+//
+// Features that a monitor model has reported as unsupported, the VCP version
+// reported by feature xdf, and how the monitor indicates that a feature is
+// unsupported are saved in the persistent store (see persistent_store.c),
+// so that the first operations on a display need not rediscover them.
+//
+// Unsupported features are keyed by monitor model string, the value is a list
+// of hex feature codes.  The VCP version and unsupported feature signaling are
+// keyed by capabilities cache key.  Since they are properties of the monitor
+// firmware, the SHA-256 hash of the EDID is saved with them, and the saved
+// value is used only if the EDID is unchanged.  The values have the forms
+// <EDID hash> <major>.<minor> and <EDID hash> <hex flags>
+//
+
+// Returns the value saved for a monitor if the EDID hash saved with it matches
+// the EDID, NULL otherwise.  Caller must free.
+static char * get_edid_qualified_value(const char * record_type, const char * key, const Byte * edid) {
    bool debug = false;
-   char * data_file_name = xdg_cache_home_file("ddcutil", "capabilities");
-   DBGTRC_STARTING(debug, TRACE_GROUP, "capabilities_cache_enabled: %s, data_file_name=%s",
-                              sbool(capabilities_cache_enabled), data_file_name);
+   char * result = NULL;
+   char * saved = pstore_get(record_type, key);
+   if (saved) {
+      gchar * edid_hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, edid, 128);
+      size_t hashlen = strlen(edid_hash);
+      if (strlen(saved) > hashlen && saved[hashlen] == ' ' && memcmp(saved, edid_hash, hashlen) == 0)
+         result = strdup(saved+hashlen+1);
+      else
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "EDID changed, ignoring saved %s", record_type);
+      g_free(edid_hash);
+      free(saved);
+   }
+   return result;
+}
 
-   if (capabilities_cache_enabled) {
-      FILE * fp = NULL;
-      fopen_mkdir(data_file_name, "w", ferr(), &fp);
-      if (!fp) {
-         // SEVEREMSG("Error opening %s: %s", data_file_name, strerror(errno));   // handled by fopen_mdkr()
-         goto bye;
+
+static void set_edid_qualified_value(
+      const char * record_type, const char * key, const Byte * edid, const char * value)
+{
+   gchar * edid_hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, edid, 128);
+   char * s = g_strdup_printf("%s %s", edid_hash, value);
+   pstore_set(record_type, key, s);
+   g_free(s);
+   g_free(edid_hash);
+}
+
+//
+// Parsed capabilities
+//
+// The compact form of parsed capabilities strings (see
+// serialize_parsed_capabilities()) is saved so that capabilities strings
+// need not be parsed again.  The table is keyed by the capabilities string
+// rather than by monitor model, since that is what callers have in hand.
+// Each line has the form <hex serialized capabilities>:<capabilities string>
+//
+
+/** Returns the name of the file that stores parsed capabilities
+ *
+ *  \return name of file, normally $HOME/.cache/ddcutil/parsed_capabilities
+ */
+/* caller is responsible for freeing returned value */
+char * get_parsed_capabilities_cache_file_name() {
+   return xdg_cache_home_file("ddcutil", "parsed_capabilities");
+}
+
+
+static void delete_parsed_capabilities_file() {
+   bool debug = false;
+   char * fn = get_parsed_capabilities_cache_file_name();
+   if (regular_file_exists(fn)) {
+      DBGMSF(debug, "Deleting file: %s", fn);
+      int rc = unlink(fn);
+      if (rc < 0) {
+         // should never occur
+         fprintf(fout(), "Unexpected error deleting file %s: %s\n",
+                         fn, strerror(errno));
       }
-      if (capabilities_hash) {
-         GHashTableIter iter;
-         gpointer key, value;
-         g_hash_table_iter_init(&iter, capabilities_hash);
+   }
+   free(fn);
+}
+
 
-         for (int line_ctr=1; g_hash_table_iter_next(&iter, &key, &value); line_ctr++) {
-            DBGTRC_NOPREFIX(debug, DDCA_TRC_NONE, "Writing line %d: %s:%s", line_ctr, key, value);
-            int ct = fprintf(fp, "%s:%s\n", (char *) key, (char*) value);
-            if (ct < 0) {
-               SEVEREMSG("Error writing to file %s:%s", data_file_name, strerror(errno) );
-               break;
+static void free_buffer_value(gpointer data) {
+   buffer_free((Buffer *) data, NULL);
+}
+
+
+// Must be called with persistent_capabilities_mutex held
+static Error_Info * load_parsed_capabilities_file() {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+   Error_Info * errs = NULL;
+
+   if (parsed_capabilities_hash)
+      g_hash_table_destroy(parsed_capabilities_hash);
+   parsed_capabilities_hash = g_hash_table_new_full(g_str_hash, g_str_equal, free, free_buffer_value);
+
+   char * data_file_name = get_parsed_capabilities_cache_file_name();
+   DBGTRC_NOPREFIX(debug, TRACE_GROUP, "data_file_name: %s", data_file_name);
+   GPtrArray * linearray = g_ptr_array_new_with_free_func(g_free);
+   errs = file_getlines_errinfo(data_file_name, linearray);
+   free(data_file_name);
+   if (!errs) {
+      for (int ndx = 0; ndx < linearray->len; ndx++) {
+         char * aline = strtrim(g_ptr_array_index(linearray, ndx));
+         if (strlen(aline) > 0 && aline[0] != '*' && aline[0] != '#') {
+            char * colon = strchr(aline, ':');
+            Byte * bytes = NULL;
+            int bytect = -1;
+            if (colon) {
+               *colon = '\0';
+               bytect = hhs_to_byte_array(aline, &bytes);
+            }
+            if (bytect <= 0 || bytes[0] != SERIALIZED_CAPABILITIES_VERSION) {
+               if (!errs)
+                  errs = errinfo_new(DDCRC_BAD_DATA, __func__);
+               errinfo_add_cause(errs, errinfo_new2(DDCRC_BAD_DATA, __func__,
+                                                    "Line %d, Invalid parsed capabilities", ndx+1));
+            }
+            else {
+               g_hash_table_insert(parsed_capabilities_hash, strdup(colon+1),
+                                   buffer_new_with_value(bytes, bytect, NULL));
             }
+            free(bytes);
+         }
+         free(aline);
+      }
+      g_ptr_array_free(linearray, true);
+   }
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, errs, "");
+   return errs;
+}
+
+
+// Must be called with persistent_capabilities_mutex held
+static void save_parsed_capabilities_file() {
+   bool debug = false;
+   char * data_file_name = get_parsed_capabilities_cache_file_name();
+   DBGTRC_STARTING(debug, TRACE_GROUP, "data_file_name=%s", data_file_name);
+
+   FILE * fp = NULL;
+   fopen_mkdir(data_file_name, "w", ferr(), &fp);
+   if (fp) {
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, parsed_capabilities_hash);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         Buffer * buf = value;
+         char * hs = hexstring2(buf->bytes, buf->len, NULL, true, NULL, 0);
+         int ct = fprintf(fp, "%s:%s\n", hs, (char *) key);
+         free(hs);
+         if (ct < 0) {
+            SEVEREMSG("Error writing to file %s:%s", data_file_name, strerror(errno) );
+            break;
          }
       }
       fclose(fp);
    }
 
-bye:
    free(data_file_name);
    DBGTRC_DONE(debug, TRACE_GROUP, "");
 }
@@ -201,6 +377,16 @@ static inline bool non_unique_model_id(DDCA_Monitor_Model_Key* mmk)
 
 // Publicly visible functions
 
+/** Reports whether a monitor model key identifies a single model, so that
+ *  all monitors with the key can be assumed to report the same capabilities.
+ *
+ *  \param  mmk  monitor model key, may be NULL
+ *  \return true/false
+ */
+bool unique_monitor_model(DDCA_Monitor_Model_Key* mmk) {
+   return mmk && !non_unique_model_id(mmk);
+}
+
 /** Emit a debug report of the capabilities hash table
  *
  *  \param depth  logical indentation depth
@@ -246,6 +432,16 @@ bool enable_capabilities_cache(bool newval) {
          capabilities_hash = NULL;
       }
       delete_capabilities_file();
+      pstore_delete_records(PSTORE_UNSUPPORTED_FEATURES);
+      pstore_delete_records(PSTORE_VCP_VERSION);
+      pstore_delete_records(PSTORE_UNSUPPORTED_SIGNALING);
+      pstore_delete_records(PSTORE_SETTLE_WINDOWS);
+      pstore_delete_records(PSTORE_REMEMBERED_VALUES);
+      if (parsed_capabilities_hash) {
+         g_hash_table_destroy(parsed_capabilities_hash);
+         parsed_capabilities_hash = NULL;
+      }
+      delete_parsed_capabilities_file();
    }
    g_mutex_unlock(&persistent_capabilities_mutex);
    DBGTRC_RET_BOOL(debug, TRACE_GROUP, old, "capabilities_cache_enabled has been set = %s",
@@ -254,15 +450,38 @@ bool enable_capabilities_cache(bool newval) {
 }
 
 
-/** Look up the capabilities string for a monitor model.
+/** Returns the key under which the capabilities string of a monitor is cached.
+ *
+ *  Normally this is the monitor model string.  Monitors whose model key is
+ *  not unique are instead keyed by a hash of their EDID, which is unique
+ *  per panel.
+ *
+ *  \param  mmk   monitor model key
+ *  \param  edid  128 byte EDID, may be NULL
+ *  \return key, caller must free, NULL if the monitor cannot be cached
+ */
+static char * capabilities_cache_key(DDCA_Monitor_Model_Key * mmk, const Byte * edid) {
+   if (!non_unique_model_id(mmk))
+      return strdup(monitor_model_string(mmk));
+   if (!edid)
+      return NULL;
+   gchar * hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, edid, 128);
+   char * key = g_strdup_printf("EDID-%s", hash);
+   g_free(hash);
+   return key;
+}
+
+
+/** Look up the capabilities string for a monitor.
  *
  *  The returned value is owned by the persistent capabilities
  *  hash table and should not be freed.
  *
- *  \param mmk monitor model key
+ *  \param mmk   monitor model key
+ *  \param edid  128 byte EDID, used if the model key is not unique, may be NULL
  *  \return capabilities string, NULL if not found
  */
-char * get_persistent_capabilities(DDCA_Monitor_Model_Key* mmk)
+char * get_persistent_capabilities(DDCA_Monitor_Model_Key* mmk, const Byte * edid)
 {
    assert(mmk);
    bool debug = false;
@@ -270,37 +489,30 @@ char * get_persistent_capabilities(DDCA_Monitor_Model_Key* mmk)
    g_mutex_lock(&persistent_capabilities_mutex);
 
    char * result = NULL;
-   if (non_unique_model_id(mmk)) {
-      DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Non unique Monitor_Model_Key. Returning NULL");
-      goto bye;
-   }
-
    if (capabilities_cache_enabled) {
-      if (!capabilities_hash) {  // if not yet loaded
-         Error_Info * errs = load_persistent_capabilities_file();
-         if (errs) {
-            if (ERRINFO_STATUS(errs) == -ENOENT)
-               errinfo_free(errs);
-            else
-               ERRINFO_FREE_WITH_REPORT(errs,true);
-         }
+      char * key = capabilities_cache_key(mmk, edid);
+      if (!key) {
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Non unique Monitor_Model_Key and no EDID");
       }
-
-      if (mmk) {
-         char * mms = strdup(monitor_model_string(mmk));
-
-         if (debug) {
-            DBGMSG("Hash table before lookup:");
-            dbgrpt_capabilities_hash0(2, NULL);
-            DBGMSG("Looking for key: mms -> |%s|", mms);
+      else {
+         if (!capabilities_hash)
+            capabilities_hash = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+                                                      (GDestroyNotify) gaux_release_interned_string);
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Looking for key: |%s|", key);
+         result = g_hash_table_lookup(capabilities_hash, key);
+         if (!result) {
+            char * file_caps = find_persistent_capabilities_in_file(key);
+            if (file_caps) {
+               result = gaux_intern_string(file_caps);
+               free(file_caps);
+               g_hash_table_insert(capabilities_hash, strdup(key), result);
+            }
          }
-
-         result = g_hash_table_lookup (capabilities_hash, mms);
-         free(mms);
-     }
+         count_lookup(&capabilities_counts, result);
+         free(key);
+      }
    }
 
-bye:
    g_mutex_unlock(&persistent_capabilities_mutex);
    DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", result);
    return result;
@@ -312,6 +524,7 @@ bye:
  *  key to the table on the file system.
  *
  *  \param mmk            monitor model key
+ *  \param edid           128 byte EDID, used if the model key is not unique, may be NULL
  *  \param capabilities   capabilities string
  *
  *  \remark
@@ -319,6 +532,7 @@ bye:
  */
 void set_persistent_capabilites(
         DDCA_Monitor_Model_Key * mmk,
+        const Byte *             edid,
         const char *             capabilities)
 {
    bool debug = false;
@@ -327,16 +541,150 @@ void set_persistent_capabilites(
 
    g_mutex_lock(&persistent_capabilities_mutex);
    if (capabilities_cache_enabled) {
-      if (non_unique_model_id(mmk))
+      char * key = capabilities_cache_key(mmk, edid);
+      if (!key)
          DBGTRC_NOPREFIX(debug, TRACE_GROUP,
-                         "Not saving capabilities for non-unique Monitor_Model_Key.");
+                         "Not saving capabilities for non-unique Monitor_Model_Key without EDID.");
       else {
-         char * mms = strdup(monitor_model_string(mmk));
-         g_hash_table_insert(capabilities_hash, mms, strdup(capabilities));
+         if (!capabilities_hash)
+            capabilities_hash = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+                                                      (GDestroyNotify) gaux_release_interned_string);
+         g_hash_table_insert(capabilities_hash, strdup(key), gaux_intern_string(capabilities));
          if (debug || IS_TRACING())
             dbgrpt_capabilities_hash0(2, "Capabilities hash after insert and before saving");
-         save_persistent_capabilities_file();
+         append_persistent_capabilities_file(key, capabilities);
+         free(key);
+      }
+   }
+   g_mutex_unlock(&persistent_capabilities_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Looks up the features known to be unsupported by a monitor model.
+ *
+ *  \param mmk monitor model key
+ *  \return set of unsupported features, EMPTY_BIT_SET_256 if none recorded
+ *          or the capabilities cache is not enabled
+ */
+Bit_Set_256 get_persistent_unsupported_features(DDCA_Monitor_Model_Key * mmk) {
+   assert(mmk);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "mmk -> %s", mmk_repr(*mmk));
+
+   Bit_Set_256 result = EMPTY_BIT_SET_256;
+   g_mutex_lock(&persistent_capabilities_mutex);
+   bool enabled = capabilities_cache_enabled;
+   g_mutex_unlock(&persistent_capabilities_mutex);
+   if (enabled && !non_unique_model_id(mmk)) {
+      char * value = pstore_get(PSTORE_UNSUPPORTED_FEATURES, monitor_model_string(mmk));
+      count_lookup(&unsupported_features_counts, value);
+      if (value) {
+         Null_Terminated_String_Array pieces = strsplit(value, " ");
+         for (int pndx = 0; pieces[pndx]; pndx++) {
+            Byte feature_code;
+            if (hhs_to_byte_in_buf(pieces[pndx], &feature_code))
+               result = bs256_insert(result, feature_code);
+            else
+               DBGTRC_NOPREFIX(debug, TRACE_GROUP, "Invalid feature code: %s", pieces[pndx]);
+         }
+         ntsa_free(pieces, true);
+         free(value);
+      }
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", bs256_to_string(result, "x", " "));
+   return result;
+}
+
+
+/** Saves the set of features known to be unsupported by a monitor model
+ *  and, if the capabilities cache is enabled, writes it to the file system.
+ *
+ *  \param mmk       monitor model key
+ *  \param features  set of unsupported features, replaces any prior value
+ */
+void set_persistent_unsupported_features(DDCA_Monitor_Model_Key * mmk, Bit_Set_256 features) {
+   assert(mmk);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "mmk -> %s, features: %s",
+                   mmk_repr(*mmk), bs256_to_string(features, "x", " "));
+
+   g_mutex_lock(&persistent_capabilities_mutex);
+   if (capabilities_cache_enabled) {
+      if (non_unique_model_id(mmk))
+         DBGTRC_NOPREFIX(debug, TRACE_GROUP,
+                         "Not saving unsupported features for non-unique Monitor_Model_Key.");
+      else {
+         pstore_set(PSTORE_UNSUPPORTED_FEATURES, monitor_model_string(mmk),
+                    bs256_to_string(features, "", " "));
+      }
+   }
+   g_mutex_unlock(&persistent_capabilities_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Looks up the VCP version saved for a monitor.
+ *
+ *  \param mmk   monitor model key
+ *  \param edid  128 byte EDID
+ *  \return saved VCP version, DDCA_VSPEC_UNQUERIED if none is saved for the
+ *          monitor, the EDID has changed, or the capabilities cache is not
+ *          enabled
+ */
+DDCA_MCCS_Version_Spec get_persistent_vcp_version(DDCA_Monitor_Model_Key * mmk, const Byte * edid) {
+   assert(mmk && edid);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "mmk -> %s", mmk_repr(*mmk));
+
+   DDCA_MCCS_Version_Spec result = DDCA_VSPEC_UNQUERIED;
+   g_mutex_lock(&persistent_capabilities_mutex);
+   bool enabled = capabilities_cache_enabled;
+   g_mutex_unlock(&persistent_capabilities_mutex);
+   if (enabled) {
+      char * key = capabilities_cache_key(mmk, edid);
+      char * value = get_edid_qualified_value(PSTORE_VCP_VERSION, key, edid);
+      if (value) {
+         DDCA_MCCS_Version_Spec vspec = parse_vspec(value);
+         if (vcp_version_is_valid(vspec, false))
+            result = vspec;
+         free(value);
       }
+      count_lookup(&vcp_version_counts, vcp_version_is_valid(result, false));
+      free(key);
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %s", format_vspec(result));
+   return result;
+}
+
+
+/** Saves the VCP version of a monitor and, if the capabilities cache is
+ *  enabled, writes it to the file system.
+ *
+ *  \param mmk    monitor model key
+ *  \param edid   128 byte EDID
+ *  \param vspec  VCP version read from feature xdf
+ */
+void set_persistent_vcp_version(
+        DDCA_Monitor_Model_Key * mmk,
+        const Byte *             edid,
+        DDCA_MCCS_Version_Spec   vspec)
+{
+   assert(mmk && edid);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "mmk -> %s, vspec=%s", mmk_repr(*mmk), format_vspec(vspec));
+
+   g_mutex_lock(&persistent_capabilities_mutex);
+   if (capabilities_cache_enabled && vcp_version_is_valid(vspec, false)) {
+      char * key = capabilities_cache_key(mmk, edid);
+      char value[20];
+      g_snprintf(value, sizeof(value), "%d.%d", vspec.major, vspec.minor);
+      set_edid_qualified_value(PSTORE_VCP_VERSION, key, edid, value);
+      free(key);
    }
    g_mutex_unlock(&persistent_capabilities_mutex);
 
@@ -344,11 +692,436 @@ void set_persistent_capabilites(
 }
 
 
+/** Looks up how a monitor indicates that a feature is unsupported.
+ *
+ *  \param mmk   monitor model key
+ *  \param edid  128 byte EDID
+ *  \return flags saved by #set_persistent_unsupported_signaling(), 0 if none
+ *          are saved for the monitor, the EDID has changed, or the capabilities
+ *          cache is not enabled
+ */
+uint16_t get_persistent_unsupported_signaling(DDCA_Monitor_Model_Key * mmk, const Byte * edid) {
+   assert(mmk && edid);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "mmk -> %s", mmk_repr(*mmk));
+
+   uint16_t result = 0;
+   g_mutex_lock(&persistent_capabilities_mutex);
+   bool enabled = capabilities_cache_enabled;
+   g_mutex_unlock(&persistent_capabilities_mutex);
+   if (enabled) {
+      char * key = capabilities_cache_key(mmk, edid);
+      char * value = get_edid_qualified_value(PSTORE_UNSUPPORTED_SIGNALING, key, edid);
+      if (value) {
+         unsigned int flags = 0;
+         if (sscanf(value, "%x", &flags) == 1 && flags <= 0xffff)
+            result = flags;
+         free(value);
+      }
+      count_lookup(&unsupported_signaling_counts, result);
+      free(key);
+   }
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: 0x%04x", result);
+   return result;
+}
+
+
+/** Saves how a monitor indicates that a feature is unsupported and, if the
+ *  capabilities cache is enabled, writes it to the file system.
+ *
+ *  \param mmk    monitor model key
+ *  \param edid   128 byte EDID
+ *  \param flags  non-zero flags describing the monitor's behavior, opaque at this level
+ */
+void set_persistent_unsupported_signaling(
+        DDCA_Monitor_Model_Key * mmk,
+        const Byte *             edid,
+        uint16_t                 flags)
+{
+   assert(mmk && edid);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "mmk -> %s, flags=0x%04x", mmk_repr(*mmk), flags);
+
+   g_mutex_lock(&persistent_capabilities_mutex);
+   if (capabilities_cache_enabled && flags) {
+      char * key = capabilities_cache_key(mmk, edid);
+      char value[10];
+      g_snprintf(value, sizeof(value), "%04x", flags);
+      set_edid_qualified_value(PSTORE_UNSUPPORTED_SIGNALING, key, edid, value);
+      free(key);
+   }
+   g_mutex_unlock(&persistent_capabilities_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+/** Looks up the serialized form of a parsed capabilities string.
+ *
+ *  Serialized capabilities are remembered for the life of the process,
+ *  and are read from the file system if the capabilities cache is enabled.
+ *
+ *  \param capabilities  capabilities string
+ *  \return copy of the serialized parsed capabilities, caller must free,
+ *          NULL if not found
+ */
+Buffer * get_persistent_parsed_capabilities(const char * capabilities) {
+   assert(capabilities);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "capabilities = %s", capabilities);
+
+   Buffer * result = NULL;
+   g_mutex_lock(&persistent_capabilities_mutex);
+   if (!parsed_capabilities_hash) {  // if not yet loaded
+      if (capabilities_cache_enabled) {
+         Error_Info * errs = load_parsed_capabilities_file();
+         if (errs)
+            ERRINFO_FREE_WITH_REPORT(errs, debug || (ERRINFO_STATUS(errs) != -ENOENT));
+      }
+      else
+         parsed_capabilities_hash = g_hash_table_new_full(g_str_hash, g_str_equal, free, free_buffer_value);
+   }
+   Buffer * buf = g_hash_table_lookup(parsed_capabilities_hash, capabilities);
+   if (buf)
+      result = buffer_dup(buf, NULL);
+   count_lookup(&parsed_capabilities_counts, buf);
+   g_mutex_unlock(&persistent_capabilities_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %p", result);
+   return result;
+}
+
+
+/** Saves the serialized form of a parsed capabilities string and, if the
+ *  capabilities cache is enabled, writes it to the file system.
+ *
+ *  \param capabilities  capabilities string
+ *  \param serialized    value returned by #serialize_parsed_capabilities(),
+ *                       copied into the table
+ */
+void set_persistent_parsed_capabilities(const char * capabilities, Buffer * serialized) {
+   assert(capabilities && serialized);
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "capabilities = %s", capabilities);
+
+   g_mutex_lock(&persistent_capabilities_mutex);
+   if (!parsed_capabilities_hash) {
+      if (capabilities_cache_enabled) {
+         Error_Info * errs = load_parsed_capabilities_file();
+         if (errs)
+            ERRINFO_FREE_WITH_REPORT(errs, debug || (ERRINFO_STATUS(errs) != -ENOENT));
+      }
+      else
+         parsed_capabilities_hash = g_hash_table_new_full(g_str_hash, g_str_equal, free, free_buffer_value);
+   }
+   g_hash_table_replace(parsed_capabilities_hash, strdup(capabilities), buffer_dup(serialized, NULL));
+   if (capabilities_cache_enabled)
+      save_parsed_capabilities_file();
+   g_mutex_unlock(&persistent_capabilities_mutex);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "");
+}
+
+
+//
+// Cache management, for command CACHE
+//
+// Export files contain both the capabilities cache and the records of the
+// persistent store.  The first line identifies the format version, each
+// subsequent line has the form <record type> TAB <key> TAB <value>, where
+// the record type of capabilities strings is "capabilities".
+//
+
+#define CACHE_EXPORT_VERSION_LINE  "# ddcutil cache export, version 1"
+#define CAPABILITIES_RECORD_TYPE   "capabilities"
+
+/** Reports whether the capabilities cache, and the learned monitor data
+ *  saved with it, is enabled.
+ */
+bool is_capabilities_cache_enabled() {
+   return capabilities_cache_enabled;
+}
+
+
+// Reads all entries of the capabilities file, which must be open and locked.
+// Since entries are only appended, later entries for a key replace earlier ones.
+static GHashTable * read_capabilities_file_entries(int fd, int * line_ct_loc) {
+   GHashTable * entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+   int line_ct = 0;
+   struct stat statbuf;
+   if (fstat(fd, &statbuf) == 0 && statbuf.st_size > 0) {
+      char * data = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+         const char * end = data + statbuf.st_size;
+         const char * line = data;
+         const char * eol;
+         while (line < end && (eol = memchr(line, '\n', end-line)) ) {
+            const char * colon = memchr(line, ':', eol-line);
+            if (colon && colon > line) {
+               g_hash_table_replace(entries, g_strndup(line, colon-line),
+                                             g_strndup(colon+1, eol-(colon+1)));
+               line_ct++;
+            }
+            line = eol+1;
+         }
+         munmap(data, statbuf.st_size);
+      }
+   }
+   if (line_ct_loc)
+      *line_ct_loc = line_ct;
+   return entries;
+}
+
+
+static void count_lookups_row(int depth, const char * title, Cache_Lookup_Counts * counts) {
+   int lookups = g_atomic_int_get(&counts->lookups);
+   int hits    = g_atomic_int_get(&counts->hits);
+   if (lookups > 0)
+      rpt_vstring(depth, "%-28s %8d %8d %7.1f%%", title, lookups, hits, hits * 100.0 / lookups);
+   else
+      rpt_vstring(depth, "%-28s %8d %8d %8s", title, lookups, hits, "-");
+}
+
+
+/** Reports the number of persistent cache lookups made by the current
+ *  process, and how many of them found a saved value.
+ *
+ *  \param depth  logical indentation depth
+ */
+void report_persistent_cache_lookups(int depth) {
+   rpt_vstring(depth, "Persistent cache lookups:");
+   rpt_vstring(depth+1, "%-28s %8s %8s %8s", "Cache", "Lookups", "Hits", "Hit rate");
+   count_lookups_row(depth+1, "Capabilities",          &capabilities_counts);
+   count_lookups_row(depth+1, "Parsed capabilities",   &parsed_capabilities_counts);
+   count_lookups_row(depth+1, "VCP versions",          &vcp_version_counts);
+   count_lookups_row(depth+1, "Unsupported features",  &unsupported_features_counts);
+   count_lookups_row(depth+1, "Unsupported signaling", &unsupported_signaling_counts);
+}
+
+
+/** Reports the files and number of entries of the persistent caches.
+ *
+ *  \param depth  logical indentation depth
+ */
+void report_persistent_caches(int depth) {
+   int d1 = depth+1;
+   rpt_vstring(depth, "Capabilities cache is %s", (capabilities_cache_enabled) ? "enabled" : "disabled");
+
+   char * fn = get_capabilities_cache_file_name();
+   int entry_ct = 0;
+   int line_ct = 0;
+   int fd = open(fn, O_RDONLY|O_CLOEXEC);
+   if (fd >= 0) {
+      flock(fd, LOCK_SH);
+      GHashTable * entries = read_capabilities_file_entries(fd, &line_ct);
+      entry_ct = g_hash_table_size(entries);
+      g_hash_table_destroy(entries);
+      flock(fd, LOCK_UN);
+      close(fd);
+   }
+   rpt_vstring(depth, "Capabilities file: %s", fn);
+   rpt_vstring(d1, "Monitor models:             %5d", entry_ct);
+   rpt_vstring(d1, "Superseded entries:         %5d", line_ct - entry_ct);
+   free(fn);
+
+   fn = get_persistent_store_file_name();
+   rpt_vstring(depth, "Learned monitor data file: %s", fn);
+   rpt_vstring(d1, "VCP versions:               %5d", pstore_foreach(PSTORE_VCP_VERSION, NULL, NULL));
+   rpt_vstring(d1, "Unsupported features:       %5d", pstore_foreach(PSTORE_UNSUPPORTED_FEATURES, NULL, NULL));
+   rpt_vstring(d1, "Unsupported signaling:      %5d", pstore_foreach(PSTORE_UNSUPPORTED_SIGNALING, NULL, NULL));
+   rpt_vstring(d1, "Settle windows:             %5d", pstore_foreach(PSTORE_SETTLE_WINDOWS, NULL, NULL));
+   rpt_vstring(d1, "Remembered values:          %5d", pstore_foreach(PSTORE_REMEMBERED_VALUES, NULL, NULL));
+   free(fn);
+
+   fn = get_parsed_capabilities_cache_file_name();
+   g_mutex_lock(&persistent_capabilities_mutex);
+   if (!parsed_capabilities_hash && capabilities_cache_enabled) {
+      Error_Info * errs = load_parsed_capabilities_file();
+      if (errs)
+         ERRINFO_FREE_WITH_REPORT(errs, ERRINFO_STATUS(errs) != -ENOENT);
+   }
+   rpt_vstring(depth, "Parsed capabilities file: %s", fn);
+   rpt_vstring(d1, "Capabilities strings:       %5d",
+                   (parsed_capabilities_hash) ? g_hash_table_size(parsed_capabilities_hash) : 0);
+   g_mutex_unlock(&persistent_capabilities_mutex);
+   free(fn);
+}
+
+
+static void export_pstore_record(
+      const char * record_type, const char * key, const char * value, void * data)
+{
+   fprintf((FILE *) data, "%s\t%s\t%s\n", record_type, key, value);
+}
+
+
+/** Writes the capabilities cache and the learned monitor data to a file,
+ *  for import on another system with the same monitor models.
+ *
+ *  \param  fp  where to write
+ *  \return number of records written
+ */
+int export_persistent_caches(FILE * fp) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "");
+
+   int ct = 0;
+   fprintf(fp, "%s\n", CACHE_EXPORT_VERSION_LINE);
+   char * fn = get_capabilities_cache_file_name();
+   int fd = open(fn, O_RDONLY|O_CLOEXEC);
+   if (fd >= 0) {
+      flock(fd, LOCK_SH);
+      GHashTable * entries = read_capabilities_file_entries(fd, NULL);
+      flock(fd, LOCK_UN);
+      close(fd);
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, entries);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         fprintf(fp, "%s\t%s\t%s\n", CAPABILITIES_RECORD_TYPE, (char *) key, (char *) value);
+         ct++;
+      }
+      g_hash_table_destroy(entries);
+   }
+   free(fn);
+   ct += pstore_foreach(NULL, export_pstore_record, fp);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %d", ct);
+   return ct;
+}
+
+
+/** Imports the records in a file written by #export_persistent_caches().
+ *
+ *  \param  fn               file name
+ *  \param  imported_ct_loc  where to return the number of records imported
+ *  \return NULL if success, Error_Info if the file could not be read or
+ *          contains invalid lines
+ */
+Error_Info * import_persistent_caches(const char * fn, int * imported_ct_loc) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "fn=%s", fn);
+
+   int imported_ct = 0;
+   GPtrArray * linearray = g_ptr_array_new_with_free_func(g_free);
+   Error_Info * errs = file_getlines_errinfo(fn, linearray);
+   if (!errs) {
+      bool valid_header = linearray->len > 0 &&
+            streq(g_strchomp(g_ptr_array_index(linearray, 0)), CACHE_EXPORT_VERSION_LINE);
+      if (!valid_header)
+         errs = errinfo_new2(DDCRC_BAD_DATA, __func__, "Not a ddcutil cache export file: %s", fn);
+      for (int ndx = 1; valid_header && ndx < linearray->len; ndx++) {
+         char * aline = g_strchomp(g_ptr_array_index(linearray, ndx));
+         if (strlen(aline) == 0 || aline[0] == '#')
+            continue;
+         char ** fields = g_strsplit(aline, "\t", 3);
+         bool ok = g_strv_length(fields) == 3;
+         if (ok && streq(fields[0], CAPABILITIES_RECORD_TYPE)) {
+            g_mutex_lock(&persistent_capabilities_mutex);
+            char * cur = find_persistent_capabilities_in_file(fields[1]);
+            if (!cur || !streq(cur, fields[2])) {
+               if (capabilities_hash)
+                  g_hash_table_replace(capabilities_hash, strdup(fields[1]), gaux_intern_string(fields[2]));
+               append_persistent_capabilities_file(fields[1], fields[2]);
+            }
+            free(cur);
+            g_mutex_unlock(&persistent_capabilities_mutex);
+         }
+         else if (ok && (streq(fields[0], PSTORE_VCP_VERSION)          ||
+                         streq(fields[0], PSTORE_UNSUPPORTED_FEATURES) ||
+                         streq(fields[0], PSTORE_UNSUPPORTED_SIGNALING)) )
+         {
+            ok = pstore_set(fields[0], fields[1], fields[2]);
+         }
+         else {
+            ok = false;
+         }
+         g_strfreev(fields);
+         if (ok) {
+            imported_ct++;
+         }
+         else {
+            if (!errs)
+               errs = errinfo_new2(DDCRC_BAD_DATA, __func__, "Invalid records in %s", fn);
+            errinfo_add_cause(errs, errinfo_new2(DDCRC_BAD_DATA, __func__,
+                                                 "Line %d, Invalid record: %s", ndx+1, aline));
+         }
+      }
+   }
+   g_ptr_array_free(linearray, true);
+   *imported_ct_loc = imported_ct;
+
+   DBGTRC_RET_ERRINFO(debug, TRACE_GROUP, errs, "imported_ct=%d", imported_ct);
+   return errs;
+}
+
+
+/** Removes stale data from the persistent caches:
+ *  - superseded entries are removed from the capabilities file
+ *  - learned monitor data not saved within a period is deleted
+ *
+ *  \param  max_age_days  maximum age of learned monitor data
+ *  \return number of entries removed
+ */
+int prune_persistent_caches(int max_age_days) {
+   bool debug = false;
+   DBGTRC_STARTING(debug, TRACE_GROUP, "max_age_days=%d", max_age_days);
+
+   int removed_ct = 0;
+   char * fn = get_capabilities_cache_file_name();
+   g_mutex_lock(&persistent_capabilities_mutex);
+   int fd = open(fn, O_RDWR|O_CLOEXEC);
+   if (fd >= 0) {
+      // rewritten in place under the lock used by appenders and readers
+      flock(fd, LOCK_EX);
+      int line_ct = 0;
+      GHashTable * entries = read_capabilities_file_entries(fd, &line_ct);
+      if (line_ct > g_hash_table_size(entries)) {
+         GString * contents = g_string_new(NULL);
+         GHashTableIter iter;
+         gpointer key, value;
+         g_hash_table_iter_init(&iter, entries);
+         while (g_hash_table_iter_next(&iter, &key, &value))
+            g_string_append_printf(contents, "%s:%s\n", (char *) key, (char *) value);
+         if (ftruncate(fd, 0) == 0 && pwrite(fd, contents->str, contents->len, 0) == contents->len)
+            removed_ct += line_ct - g_hash_table_size(entries);
+         else
+            SEVEREMSG("Error writing to file %s:%s", fn, strerror(errno) );
+         g_string_free(contents, true);
+      }
+      g_hash_table_destroy(entries);
+      flock(fd, LOCK_UN);
+      close(fd);
+   }
+   g_mutex_unlock(&persistent_capabilities_mutex);
+   free(fn);
+
+   removed_ct += pstore_prune((uint64_t) max_age_days * 24 * 60 * 60);
+
+   DBGTRC_DONE(debug, TRACE_GROUP, "Returning: %d", removed_ct);
+   return removed_ct;
+}
+
+
 void init_persistent_capabilities() {
    RTTI_ADD_FUNC(enable_capabilities_cache);
-   RTTI_ADD_FUNC(load_persistent_capabilities_file);
-   RTTI_ADD_FUNC(save_persistent_capabilities_file);
+   RTTI_ADD_FUNC(find_persistent_capabilities_in_file);
+   RTTI_ADD_FUNC(append_persistent_capabilities_file);
    RTTI_ADD_FUNC(get_persistent_capabilities);
    RTTI_ADD_FUNC(set_persistent_capabilites);
+   RTTI_ADD_FUNC(get_persistent_unsupported_features);
+   RTTI_ADD_FUNC(set_persistent_unsupported_features);
+   RTTI_ADD_FUNC(get_persistent_vcp_version);
+   RTTI_ADD_FUNC(set_persistent_vcp_version);
+   RTTI_ADD_FUNC(get_persistent_unsupported_signaling);
+   RTTI_ADD_FUNC(set_persistent_unsupported_signaling);
+   RTTI_ADD_FUNC(load_parsed_capabilities_file);
+   RTTI_ADD_FUNC(save_parsed_capabilities_file);
+   RTTI_ADD_FUNC(get_persistent_parsed_capabilities);
+   RTTI_ADD_FUNC(set_persistent_parsed_capabilities);
+   RTTI_ADD_FUNC(export_persistent_caches);
+   RTTI_ADD_FUNC(import_persistent_caches);
+   RTTI_ADD_FUNC(prune_persistent_caches);
 }
 
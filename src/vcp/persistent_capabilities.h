@@ -6,14 +6,40 @@
 #ifndef PERSISTENT_CAPABILITIES_H_
 #define PERSISTENT_CAPABILITIES_H_
 
+#include <stdio.h>
+
 #include "private/ddcutil_types_private.h"
+#include "util/data_structures.h"
 #include "util/error_info.h"
 
 bool   enable_capabilities_cache(bool onoff);
+bool   unique_monitor_model(DDCA_Monitor_Model_Key* mmk);
 char * get_capabilities_cache_file_name();
-char * get_persistent_capabilities(DDCA_Monitor_Model_Key* mmk);
-void   set_persistent_capabilites(DDCA_Monitor_Model_Key* mmk, const char * capabilities);
+char * get_persistent_capabilities(DDCA_Monitor_Model_Key* mmk, const Byte * edid);
+void   set_persistent_capabilites(DDCA_Monitor_Model_Key* mmk, const Byte * edid, const char * capabilities);
 void   dbgrpt_capabilities_hash(int depth, const char * msg);
+Bit_Set_256
+       get_persistent_unsupported_features(DDCA_Monitor_Model_Key* mmk);
+void   set_persistent_unsupported_features(DDCA_Monitor_Model_Key* mmk, Bit_Set_256 features);
+DDCA_MCCS_Version_Spec
+       get_persistent_vcp_version(DDCA_Monitor_Model_Key* mmk, const Byte * edid);
+void   set_persistent_vcp_version(DDCA_Monitor_Model_Key* mmk, const Byte * edid, DDCA_MCCS_Version_Spec vspec);
+uint16_t
+       get_persistent_unsupported_signaling(DDCA_Monitor_Model_Key* mmk, const Byte * edid);
+void   set_persistent_unsupported_signaling(DDCA_Monitor_Model_Key* mmk, const Byte * edid, uint16_t flags);
+char * get_parsed_capabilities_cache_file_name();
+Buffer * get_persistent_parsed_capabilities(const char * capabilities);
+void   set_persistent_parsed_capabilities(const char * capabilities, Buffer * serialized);
+
+// Cache management
+bool   is_capabilities_cache_enabled();
+void   report_persistent_caches(int depth);
+void   report_persistent_cache_lookups(int depth);
+int    export_persistent_caches(FILE * fp);
+Error_Info *
+       import_persistent_caches(const char * fn, int * imported_ct_loc);
+int    prune_persistent_caches(int max_age_days);
+
 void   init_persistent_capabilities();
 
 #endif /* PERSISTENT_CAPABILITIES_H_ */
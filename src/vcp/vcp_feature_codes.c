@@ -8,6 +8,7 @@
 
 /** \cond */
 #include <assert.h>
+#include <glib-2.0/glib.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,7 +45,56 @@ static DDCA_Feature_Value_Entry xca_osd_values[];
 static DDCA_Feature_Value_Entry xca_v22_osd_button_sl_values[];
 static DDCA_Feature_Value_Entry xca_v22_osd_button_sh_values[];
 
-static bool vcp_feature_codes_initialized = false;
+// Direct index into vcp_code_table by feature code, built on first use
+static VCP_Feature_Table_Entry * vcp_code_table_index[256];
+static GOnce vcp_code_table_index_once = G_ONCE_INIT;
+
+// Hot fields of vcp_code_table, same order, built with vcp_code_table_index
+static VCP_Feature_Hot_Entry *   vcp_hot_table = NULL;
+static VCP_Feature_Hot_Entry *   vcp_hot_table_index[256];
+
+// Representative VCP version of each vcp_version_class()
+static const DDCA_MCCS_Version_Spec version_class_vspecs[4] = { {2,0}, {2,1}, {2,2}, {3,0} };
+
+// Indexes of the sl value table for each feature code and VCP version, built on first use
+static GHashTable * sl_value_indexes = NULL;   // key: code and version, value: SL_Value_Index *
+static GMutex       sl_value_indexes_mutex;
+
+#ifdef DEVELOPMENT_ONLY
+void validate_vcp_feature_table();
+#endif
+
+static gpointer index_vcp_code_table(gpointer data) {
+#ifdef DEVELOPMENT_ONLY
+   validate_vcp_feature_table();  // enable for development
+#endif
+   for (int ndx=0; ndx < vcp_feature_code_count; ndx++) {
+      memcpy( vcp_code_table[ndx].marker, VCP_FEATURE_TABLE_ENTRY_MARKER, 4);
+   }
+   vcp_hot_table = calloc(vcp_feature_code_count, sizeof(VCP_Feature_Hot_Entry));
+   for (int ndx=0; ndx < vcp_feature_code_count; ndx++) {
+      VCP_Feature_Table_Entry * pentry = &vcp_code_table[ndx];
+      VCP_Feature_Hot_Entry *   hot    = &vcp_hot_table[ndx];
+      hot->code            = pentry->code;
+      hot->vcp_spec_groups = pentry->vcp_spec_groups;
+      hot->vcp_subsets     = pentry->vcp_subsets;
+      for (int vclass = 0; vclass < 4; vclass++)
+         hot->vflags[vclass] = get_version_sensitive_feature_flags(pentry, version_class_vspecs[vclass]);
+      // first entry wins, as for a linear search
+      if (!vcp_code_table_index[pentry->code]) {
+         vcp_code_table_index[pentry->code] = pentry;
+         vcp_hot_table_index[pentry->code] = hot;
+      }
+   }
+   return NULL;
+}
+
+/** Builds the feature code index, and sets the table entry markers,
+ *  the first time the table is accessed.
+ */
+static inline void ensure_vcp_code_table_indexed() {
+   g_once(&vcp_code_table_index_once, index_vcp_code_table, NULL);
+}
 
 //
 // Functions implementing the VCPINFO command
@@ -178,6 +228,25 @@ int vcp_get_feature_code_count() {
 }
 
 
+/** Returns the range of VCP versions for which feature flags are resolved
+ *  in #VCP_Feature_Hot_Entry.vflags, corresponding to the version tests of
+ *  #get_version_specific_feature_flags().
+ *
+ *  @param  vcp_version  VCP version
+ *  @return 0 for versions before 2.1, 1 for 2.1, 2 for 2.2 and later 2.x, 3 for 3.0 and later
+ */
+int vcp_version_class(DDCA_MCCS_Version_Spec vcp_version) {
+   int result = 0;
+   if (vcp_version.major >= 3)
+      result = 3;
+   else if (vcp_version.major == 2 && vcp_version.minor >= 2)
+      result = 2;
+   else if (vcp_version.major == 2 && vcp_version.minor == 1)
+      result = 1;
+   return result;
+}
+
+
 
 /* Gets the appropriate VCP flags value for a feature, given
  * the VCP version for the monitor.
@@ -971,10 +1040,37 @@ VCP_Feature_Table_Entry *
 vcp_get_feature_table_entry(int ndx) {
    // DBGMSG("ndx=%d, vcp_code_count=%d  ", ndx, vcp_code_count );
    assert( 0 <= ndx && ndx < vcp_feature_code_count);
+   ensure_vcp_code_table_indexed();
    return &vcp_code_table[ndx];
 }
 
 
+/** Returns the hot fields of the #VCP_Feature_Table_Entry at the same index
+ *  of the feature table.
+ *
+ *  @param  ndx  table index
+ *  @return pointer to #VCP_Feature_Hot_Entry, do not free
+ */
+VCP_Feature_Hot_Entry *
+vcp_get_feature_hot_entry(int ndx) {
+   assert( 0 <= ndx && ndx < vcp_feature_code_count);
+   ensure_vcp_code_table_indexed();
+   return &vcp_hot_table[ndx];
+}
+
+
+/** Returns the hot fields of the feature table entry for a feature code.
+ *
+ *  @param  id  feature code
+ *  @return pointer to #VCP_Feature_Hot_Entry, NULL if not a known feature, do not free
+ */
+VCP_Feature_Hot_Entry *
+vcp_find_feature_hot_entry_by_hexid(DDCA_Vcp_Feature_Code id) {
+   ensure_vcp_code_table_indexed();
+   return vcp_hot_table_index[id];
+}
+
+
 #ifdef UNUSED
 VCP_Feature_Table_Entry *
 vcp_create_dynamic_feature(
@@ -1085,17 +1181,8 @@ vcp_create_table_dummy_feature_for_hexid(DDCA_Vcp_Feature_Code id) {
 VCP_Feature_Table_Entry *
 vcp_find_feature_by_hexid(DDCA_Vcp_Feature_Code id) {
    // DBGMSG("Starting. id=0x%02x ", id );
-   int ndx = 0;
-   VCP_Feature_Table_Entry * result = NULL;
-
-   for (;ndx < vcp_feature_code_count; ndx++) {
-      if (id == vcp_code_table[ndx].code) {
-         result = &vcp_code_table[ndx];
-         break;
-      }
-   }
-   // DBGMSG("Done.  ndx=%d. returning %p", ndx, result);
-   return result;
+   ensure_vcp_code_table_indexed();
+   return vcp_code_table_index[id];
 }
 
 
@@ -1276,6 +1363,35 @@ find_feature_values_for_capabilities(
 }
 
 
+/** Returns the index of the sl value table for a feature, building it
+ *  the first time the feature is looked up for the VCP version.
+ *
+ *  @param  feature_code  VCP feature code
+ *  @param  vcp_version   VCP version
+ *  @return index, NULL if the feature has no sl value table
+ */
+static SL_Value_Index *
+get_sl_value_index(
+      DDCA_Vcp_Feature_Code   feature_code,
+      DDCA_MCCS_Version_Spec  vcp_version)
+{
+   gpointer key = GUINT_TO_POINTER(feature_code << 16 | vcp_version.major << 8 | vcp_version.minor);
+   g_mutex_lock(&sl_value_indexes_mutex);
+   if (!sl_value_indexes)
+      sl_value_indexes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free);
+   SL_Value_Index * index = g_hash_table_lookup(sl_value_indexes, key);
+   if (!index) {
+      DDCA_Feature_Value_Entry * values_for_feature = find_feature_value_table(feature_code, vcp_version);
+      if (values_for_feature) {
+         index = new_sl_value_index(values_for_feature);
+         g_hash_table_insert(sl_value_indexes, key, index);
+      }
+   }
+   g_mutex_unlock(&sl_value_indexes_mutex);
+   return index;
+}
+
+
 /* Given the ids for a feature code and a SL byte value,
  * return the explanation string for value.
  *
@@ -1301,9 +1417,9 @@ char * lookup_value_name(
    DBGMSF(debug, "feature_code=0x%02x, vcp_version=%d.%d, sl_value=-0x%02x",
                  feature_code, vcp_version.major, vcp_version.minor, sl_value);
 
-   DDCA_Feature_Value_Entry * values_for_feature = find_feature_value_table(feature_code, vcp_version);
-   assert(values_for_feature);
-   char * name = sl_value_table_lookup(values_for_feature, sl_value);
+   SL_Value_Index * index = get_sl_value_index(feature_code, vcp_version);
+   assert(index);
+   char * name = index->names[sl_value];
    if (!name)
       name = "Invalid value";
 
@@ -4398,16 +4514,11 @@ static void init_func_name_table() {
 
 /** Initialize the vcp_feature_codes module.
  *  Must be called before any other function in this file.
+ *
+ *  The feature table itself is indexed on first use.
  */
 void init_vcp_feature_codes() {
-#ifdef DEVELOPMENT_ONLY
-   validate_vcp_feature_table();  // enable for development
-#endif
-   for (int ndx=0; ndx < vcp_feature_code_count; ndx++) {
-      memcpy( vcp_code_table[ndx].marker, VCP_FEATURE_TABLE_ENTRY_MARKER, 4);
-   }
    init_func_name_table();
    // dbgrpt_func_name_table(0);
-   vcp_feature_codes_initialized = true;
 }
 
@@ -161,6 +161,19 @@ struct {
    DDCA_Feature_Value_Entry *            v22_sl_values;
 } VCP_Feature_Table_Entry;
 
+/** Fields of a #VCP_Feature_Table_Entry used when selecting features, with the
+ *  version sensitive flags resolved for each range of VCP versions.  Kept in
+ *  a compact array parallel to the feature table, so that scans for building
+ *  feature sets do not touch the descriptive fields.
+ */
+typedef
+struct {
+   Byte                                  code;
+   ushort                                vcp_spec_groups;
+   VCP_Feature_Subset                    vcp_subsets;
+   DDCA_Version_Feature_Flags            vflags[4];     ///< by vcp_version_class()
+} VCP_Feature_Hot_Entry;
+
 void dbgrpt_vcp_entry(VCP_Feature_Table_Entry * pfte, int depth);
 
 char *
@@ -342,6 +355,9 @@ vcp_format_feature_detail(
 int
 vcp_get_feature_code_count();
 VCP_Feature_Table_Entry *  vcp_get_feature_table_entry(int ndx);
+VCP_Feature_Hot_Entry *    vcp_get_feature_hot_entry(int ndx);
+VCP_Feature_Hot_Entry *    vcp_find_feature_hot_entry_by_hexid(DDCA_Vcp_Feature_Code id);
+int                        vcp_version_class(DDCA_MCCS_Version_Spec vcp_version);
 
 void
 init_vcp_feature_codes();
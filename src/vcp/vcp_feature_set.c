@@ -90,6 +90,7 @@ create_vcp_feature_set(
    }
 
    bool exclude_table_features = feature_setflags & FSF_NOTABLE;
+   int  vclass = vcp_version_class(vcp_version);
 
    struct vcp_feature_set * fset = calloc(1,sizeof(struct vcp_feature_set));
    memcpy(fset->marker, VCP_FEATURE_SET_MARKER, 4);
@@ -104,20 +105,21 @@ create_vcp_feature_set(
          Byte id = ndx;
          // DBGMSF(debug, "examining id 0x%02x", id);
          // n. this is a pointer into permanent data structures, should not be freed:
-         VCP_Feature_Table_Entry* vcp_entry = vcp_find_feature_by_hexid(id);
+         VCP_Feature_Hot_Entry * hot_entry = vcp_find_feature_hot_entry_by_hexid(id);
          // original code looks at VCP2_READABLE, output level
-         if (vcp_entry) {
+         if (hot_entry) {
+            DDCA_Version_Feature_Flags vflags = hot_entry->vflags[vclass];
             bool showit = true;
-            if ( is_table_feature_by_vcp_version(vcp_entry, vcp_version) ) {
+            if (vflags & DDCA_NORMAL_TABLE) {
                if ( /* get_output_level() < DDCA_OL_VERBOSE || */
                     exclude_table_features  )
                   showit = false;
             }
-            if (!is_feature_readable_by_vcp_version(vcp_entry, vcp_version)) {
+            if (!(vflags & DDCA_READABLE)) {
                showit = false;
             }
             if (showit) {
-               g_ptr_array_add(fset->members, vcp_entry);
+               g_ptr_array_add(fset->members, vcp_find_feature_by_hexid(id));
             }
          }
          else {  // unknown feature or manufacturer specific feature
@@ -138,14 +140,13 @@ create_vcp_feature_set(
       int known_feature_ct = vcp_get_feature_code_count();
       int ndx = 0;
       for (ndx=0; ndx < known_feature_ct; ndx++) {
-         VCP_Feature_Table_Entry * vcp_entry = vcp_get_feature_table_entry(ndx);
-         assert(vcp_entry);
-         DDCA_Version_Feature_Flags vflags =
-               get_version_sensitive_feature_flags(vcp_entry, vcp_version);
+         // only the hot fields are examined until the feature is selected
+         VCP_Feature_Hot_Entry * hot_entry = vcp_get_feature_hot_entry(ndx);
+         DDCA_Version_Feature_Flags vflags = hot_entry->vflags[vclass];
          bool showit = false;
          switch(subset_id) {
          case VCP_SUBSET_PRESET:
-            showit = vcp_entry->vcp_spec_groups & VCP_SPEC_PRESET;
+            showit = hot_entry->vcp_spec_groups & VCP_SPEC_PRESET;
             break;
          case VCP_SUBSET_TABLE:
             showit = vflags & DDCA_TABLE;
@@ -187,7 +188,7 @@ create_vcp_feature_set(
          case VCP_SUBSET_WINDOW:
          case VCP_SUBSET_DPVL:
          case VCP_SUBSET_CRT:
-            showit = vcp_entry->vcp_subsets & subset_id;
+            showit = hot_entry->vcp_subsets & subset_id;
             break;
          case VCP_SUBSET_SCAN:    // will never happen, inserted to avoid compiler warning
          case VCP_SUBSET_MFG:     // will never happen
@@ -219,7 +220,7 @@ create_vcp_feature_set(
             // DBGMSF(debug, "After final check for table feature.  showit=%s", bool_repr(showit));
          }
          if (showit) {
-            g_ptr_array_add(fset->members, vcp_entry);
+            g_ptr_array_add(fset->members, vcp_get_feature_table_entry(ndx));
          }
       }
    }
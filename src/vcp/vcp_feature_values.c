@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "util/data_structures.h"
+#include "util/json_writer.h"
 #include "util/report_util.h"
 #include "util/string_util.h"
 
@@ -204,6 +205,33 @@ char * summarize_single_vcp_value(DDCA_Any_Vcp_Value * valrec) {
 }
 
 
+/** Writes the value of a single vcp value as members of the JSON object
+ *  currently being written.
+ *
+ *  Non-table values are written as their mh, ml, sh, and sl bytes, along
+ *  with the current (sh,sl) and maximum (mh,ml) values formed from them.
+ *  Table values are written as a hex string.
+ *
+ *  \param jw      JSON writer
+ *  \param valrec  vcp value
+ */
+void write_json_single_vcp_value_members(Json_Writer * jw, DDCA_Any_Vcp_Value * valrec) {
+   if (valrec->value_type == DDCA_NON_TABLE_VCP_VALUE) {
+      json_key_int(jw, "mh", valrec->val.c_nc.mh);
+      json_key_int(jw, "ml", valrec->val.c_nc.ml);
+      json_key_int(jw, "sh", valrec->val.c_nc.sh);
+      json_key_int(jw, "sl", valrec->val.c_nc.sl);
+      json_key_int(jw, "current_value", VALREC_CUR_VAL(valrec));
+      json_key_int(jw, "maximum_value", VALREC_MAX_VAL(valrec));
+   }
+   else {
+      assert(valrec->value_type == DDCA_TABLE_VCP_VALUE);
+      json_key(jw, "bytes");
+      json_hex_bytes(jw, valrec->val.t.bytes, valrec->val.t.bytect);
+   }
+}
+
+
 /** Frees a single vcp value instance
  *
  *  \param vcp_value pointer to instance (may be NULL)
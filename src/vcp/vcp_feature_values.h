@@ -12,6 +12,7 @@
 
 #include "util/coredefs.h"
 #include "util/data_structures.h"
+#include "util/json_writer.h"
 
 #include "base/ddc_packets.h"
 #include "base/feature_metadata.h"
@@ -123,6 +124,7 @@ void  dbgrpt_single_vcp_value( DDCA_Any_Vcp_Value * valrec, int depth);
 extern const int summzrize_single_vcp_value_buffer_size;
 char * summarize_single_vcp_value_r(DDCA_Any_Vcp_Value * valrec, char * buffer, int bufsz);
 char * summarize_single_vcp_value(DDCA_Any_Vcp_Value * valrec);
+void   write_json_single_vcp_value_members(Json_Writer * jw, DDCA_Any_Vcp_Value * valrec);
 
 
 // Vcp_Value_Set declarations